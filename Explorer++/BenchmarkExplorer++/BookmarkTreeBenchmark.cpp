@@ -0,0 +1,111 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "Bookmarks/BookmarkTree.h"
+#include <benchmark/benchmark.h>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+// Adds the specified number of bookmarks, spread across a set of folders, to the bookmarks menu.
+// The bookmarks that were added are returned.
+std::vector<BookmarkItem *> PopulateTree(BookmarkTree &bookmarkTree, size_t numBookmarks)
+{
+	constexpr size_t NUM_FOLDERS = 100;
+
+	std::vector<BookmarkItem *> folders;
+
+	for (size_t i = 0; i < NUM_FOLDERS; i++)
+	{
+		auto folder = std::make_unique<BookmarkItem>(
+			std::nullopt, L"Folder " + std::to_wstring(i), std::nullopt);
+		folders.push_back(bookmarkTree.AddBookmarkItem(
+			bookmarkTree.GetBookmarksMenuFolder(), std::move(folder), i));
+	}
+
+	std::vector<BookmarkItem *> bookmarks;
+	bookmarks.reserve(numBookmarks);
+
+	for (size_t i = 0; i < numBookmarks; i++)
+	{
+		BookmarkItem *parent = folders[i % NUM_FOLDERS];
+		auto bookmark = std::make_unique<BookmarkItem>(std::nullopt,
+			L"Bookmark " + std::to_wstring(i), L"C:\\Folder " + std::to_wstring(i));
+		bookmarks.push_back(
+			bookmarkTree.AddBookmarkItem(parent, std::move(bookmark), parent->GetChildren().size()));
+	}
+
+	return bookmarks;
+}
+
+void BM_BookmarkTreeAdd(benchmark::State &state)
+{
+	auto numBookmarks = static_cast<size_t>(state.range(0));
+
+	for (auto _ : state)
+	{
+		BookmarkTree bookmarkTree;
+		benchmark::DoNotOptimize(PopulateTree(bookmarkTree, numBookmarks));
+	}
+
+	state.SetItemsProcessed(state.iterations() * numBookmarks);
+}
+
+void BM_BookmarkTreeLookupById(benchmark::State &state)
+{
+	BookmarkTree bookmarkTree;
+	auto bookmarks = PopulateTree(bookmarkTree, static_cast<size_t>(state.range(0)));
+
+	std::vector<std::wstring> guids;
+	guids.reserve(bookmarks.size());
+
+	for (const auto *bookmark : bookmarks)
+	{
+		guids.push_back(bookmark->GetGUID());
+	}
+
+	for (auto _ : state)
+	{
+		for (const auto &guid : guids)
+		{
+			benchmark::DoNotOptimize(bookmarkTree.GetBookmarkItemById(guid));
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * guids.size());
+}
+
+// Moves each bookmark to the start of the bookmarks toolbar folder, then removes it.
+void BM_BookmarkTreeMoveAndRemove(benchmark::State &state)
+{
+	auto numBookmarks = static_cast<size_t>(state.range(0));
+
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		BookmarkTree bookmarkTree;
+		auto bookmarks = PopulateTree(bookmarkTree, numBookmarks);
+		state.ResumeTiming();
+
+		for (auto *bookmark : bookmarks)
+		{
+			bookmarkTree.MoveBookmarkItem(bookmark, bookmarkTree.GetBookmarksToolbarFolder(), 0);
+		}
+
+		for (auto *bookmark : bookmarks)
+		{
+			bookmarkTree.RemoveBookmarkItem(bookmark);
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * numBookmarks);
+}
+
+}
+
+BENCHMARK(BM_BookmarkTreeAdd)->Arg(1'000)->Arg(10'000);
+BENCHMARK(BM_BookmarkTreeLookupById)->Arg(1'000)->Arg(10'000);
+BENCHMARK(BM_BookmarkTreeMoveAndRemove)->Arg(1'000)->Arg(10'000);
\ No newline at end of file
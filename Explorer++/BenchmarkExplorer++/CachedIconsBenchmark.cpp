@@ -0,0 +1,105 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/CachedIcons.h"
+#include <benchmark/benchmark.h>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+std::vector<std::wstring> CreatePaths(size_t numPaths)
+{
+	std::vector<std::wstring> paths;
+	paths.reserve(numPaths);
+
+	for (size_t i = 0; i < numPaths; i++)
+	{
+		paths.push_back(L"C:\\Users\\Public\\Documents\\Folder " + std::to_wstring(i % 100)
+			+ L"\\File " + std::to_wstring(i) + L".txt");
+	}
+
+	return paths;
+}
+
+// A cache that's large enough to hold every path, so that nothing is evicted.
+size_t GetCapacityForPaths(const std::vector<std::wstring> &paths)
+{
+	size_t capacity = 0;
+
+	for (const auto &path : paths)
+	{
+		capacity += CachedIcons::getEntrySize(path);
+	}
+
+	return capacity;
+}
+
+void BM_CachedIconsInsert(benchmark::State &state)
+{
+	auto paths = CreatePaths(static_cast<size_t>(state.range(0)));
+
+	for (auto _ : state)
+	{
+		CachedIcons cachedIcons(GetCapacityForPaths(paths));
+
+		for (const auto &path : paths)
+		{
+			cachedIcons.addOrUpdateFileIcon(path, 0);
+		}
+
+		benchmark::DoNotOptimize(cachedIcons.getSizeInBytes());
+	}
+
+	state.SetItemsProcessed(state.iterations() * paths.size());
+}
+
+// Inserting into a full cache means an entry has to be evicted each time.
+void BM_CachedIconsInsertWithEviction(benchmark::State &state)
+{
+	auto paths = CreatePaths(static_cast<size_t>(state.range(0)));
+
+	for (auto _ : state)
+	{
+		CachedIcons cachedIcons(GetCapacityForPaths(paths) / 4);
+
+		for (const auto &path : paths)
+		{
+			cachedIcons.addOrUpdateFileIcon(path, 0);
+		}
+
+		benchmark::DoNotOptimize(cachedIcons.getSizeInBytes());
+	}
+
+	state.SetItemsProcessed(state.iterations() * paths.size());
+}
+
+void BM_CachedIconsLookup(benchmark::State &state)
+{
+	auto paths = CreatePaths(static_cast<size_t>(state.range(0)));
+	CachedIcons cachedIcons(GetCapacityForPaths(paths));
+
+	// Only every second path is added, so half the lookups miss.
+	for (size_t i = 0; i < paths.size(); i += 2)
+	{
+		cachedIcons.addOrUpdateFileIcon(paths[i], static_cast<int>(i));
+	}
+
+	for (auto _ : state)
+	{
+		for (const auto &path : paths)
+		{
+			benchmark::DoNotOptimize(cachedIcons.findByPath(path));
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * paths.size());
+}
+
+}
+
+BENCHMARK(BM_CachedIconsInsert)->Arg(1'000)->Arg(100'000);
+BENCHMARK(BM_CachedIconsInsertWithEviction)->Arg(1'000)->Arg(100'000);
+BENCHMARK(BM_CachedIconsLookup)->Arg(1'000)->Arg(100'000);
\ No newline at end of file
@@ -0,0 +1,176 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "ShellBrowser/ColumnDataRetrieval.h"
+#include "ShellBrowser/FolderSettings.h"
+#include "ShellBrowser/SortHelper.h"
+#include "SyntheticItems.h"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <numeric>
+
+namespace
+{
+
+constexpr size_t NUM_COMPARISON_ITEMS = 10'000;
+
+GlobalFolderSettings GetGlobalFolderSettings()
+{
+	GlobalFolderSettings globalFolderSettings = {};
+	globalFolderSettings.showExtensions = TRUE;
+	globalFolderSettings.useNaturalSortOrder = TRUE;
+	return globalFolderSettings;
+}
+
+// Compares each item with the one that follows it, which gives a mix of comparison results.
+template <typename Compare>
+void RunComparisons(benchmark::State &state, Compare compare)
+{
+	auto items = CreateSyntheticItems(NUM_COMPARISON_ITEMS);
+
+	for (auto _ : state)
+	{
+		for (size_t i = 0; i + 1 < items.size(); i++)
+		{
+			benchmark::DoNotOptimize(compare(items[i], items[i + 1]));
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * (items.size() - 1));
+}
+
+void BM_SortByName(benchmark::State &state)
+{
+	auto globalFolderSettings = GetGlobalFolderSettings();
+	RunComparisons(state,
+		[&globalFolderSettings](const BasicItemInfo_t &item1, const BasicItemInfo_t &item2)
+		{ return SortByName(item1, item2, globalFolderSettings); });
+}
+
+void BM_SortBySize(benchmark::State &state)
+{
+	auto globalFolderSettings = GetGlobalFolderSettings();
+	RunComparisons(state,
+		[&globalFolderSettings](const BasicItemInfo_t &item1, const BasicItemInfo_t &item2)
+		{ return SortBySize(item1, item2, globalFolderSettings); });
+}
+
+void BM_SortByDate(benchmark::State &state)
+{
+	RunComparisons(state,
+		[](const BasicItemInfo_t &item1, const BasicItemInfo_t &item2)
+		{ return SortByDate(item1, item2, DateType::Modified); });
+}
+
+void BM_SortByAttributes(benchmark::State &state)
+{
+	RunComparisons(state, SortByAttributes);
+}
+
+void BM_SortByExtension(benchmark::State &state)
+{
+	RunComparisons(state, SortByExtension);
+}
+
+void BM_ProcessItemFileName(benchmark::State &state)
+{
+	auto items = CreateSyntheticItems(NUM_COMPARISON_ITEMS);
+	auto globalFolderSettings = GetGlobalFolderSettings();
+	globalFolderSettings.showExtensions = FALSE;
+	globalFolderSettings.hideLinkExtension = TRUE;
+
+	for (auto _ : state)
+	{
+		for (const auto &item : items)
+		{
+			benchmark::DoNotOptimize(ProcessItemFileName(item, globalFolderSettings));
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * items.size());
+}
+
+// Sorts a folder's worth of items in the same way ShellBrowser does: a key is built for each item,
+// after which the items are sorted by comparing the keys.
+void SortItems(benchmark::State &state, SortMode sortMode)
+{
+	auto items = CreateSyntheticItems(static_cast<size_t>(state.range(0)));
+	auto globalFolderSettings = GetGlobalFolderSettings();
+	auto comparison = GetSortKeyComparison(sortMode, globalFolderSettings);
+
+	if (!comparison)
+	{
+		state.SkipWithError("Sort mode doesn't support sort keys");
+		return;
+	}
+
+	for (auto _ : state)
+	{
+		std::vector<SortKey> keys;
+		keys.reserve(items.size());
+
+		for (const auto &item : items)
+		{
+			SortKey key = BuildSortKey(item, sortMode, globalFolderSettings);
+
+			if (*comparison == SortKeyComparison::Collation)
+			{
+				key.collationKey =
+					CreateCollationKey(key.text, globalFolderSettings.useNaturalSortOrder);
+			}
+
+			keys.push_back(std::move(key));
+		}
+
+		std::vector<size_t> order(items.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(),
+			[&keys, comparison](size_t index1, size_t index2)
+			{ return CompareSortKeys(keys[index1], keys[index2], *comparison) < 0; });
+
+		benchmark::DoNotOptimize(order.data());
+	}
+
+	state.SetItemsProcessed(state.iterations() * items.size());
+}
+
+void BM_SortItemsByName(benchmark::State &state)
+{
+	SortItems(state, SortMode::Name);
+}
+
+void BM_SortItemsBySize(benchmark::State &state)
+{
+	SortItems(state, SortMode::Size);
+}
+
+void BM_SortItemsByDateModified(benchmark::State &state)
+{
+	SortItems(state, SortMode::DateModified);
+}
+
+}
+
+BENCHMARK(BM_SortByName);
+BENCHMARK(BM_SortBySize);
+BENCHMARK(BM_SortByDate);
+BENCHMARK(BM_SortByAttributes);
+BENCHMARK(BM_SortByExtension);
+BENCHMARK(BM_ProcessItemFileName);
+
+BENCHMARK(BM_SortItemsByName)
+	->Arg(10'000)
+	->Arg(100'000)
+	->Arg(1'000'000)
+	->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SortItemsBySize)
+	->Arg(10'000)
+	->Arg(100'000)
+	->Arg(1'000'000)
+	->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SortItemsByDateModified)
+	->Arg(10'000)
+	->Arg(100'000)
+	->Arg(1'000'000)
+	->Unit(benchmark::kMillisecond);
\ No newline at end of file
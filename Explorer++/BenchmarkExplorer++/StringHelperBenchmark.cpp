@@ -0,0 +1,86 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/DisplayFormatter.h"
+#include "../Helper/StringHelper.h"
+#include "SyntheticItems.h"
+#include <benchmark/benchmark.h>
+
+namespace
+{
+
+constexpr size_t NUM_ITEMS = 10'000;
+
+void CheckWildcardMatches(benchmark::State &state, const wchar_t *pattern, BOOL caseSensitive)
+{
+	auto items = CreateSyntheticItems(NUM_ITEMS);
+
+	for (auto _ : state)
+	{
+		for (const auto &item : items)
+		{
+			benchmark::DoNotOptimize(
+				CheckWildcardMatch(pattern, item.szDisplayName, caseSensitive));
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * items.size());
+}
+
+void BM_CheckWildcardMatchExtension(benchmark::State &state)
+{
+	CheckWildcardMatches(state, L"*.txt", FALSE);
+}
+
+void BM_CheckWildcardMatchMultiplePatterns(benchmark::State &state)
+{
+	CheckWildcardMatches(state, L"*.jpg:*.png:*.pdf", FALSE);
+}
+
+void BM_CheckWildcardMatchComplexPattern(benchmark::State &state)
+{
+	CheckWildcardMatches(state, L"IMG_*1?_*.jp*g", TRUE);
+}
+
+void BM_FormatSizeString(benchmark::State &state)
+{
+	auto items = CreateSyntheticItems(NUM_ITEMS);
+
+	for (auto _ : state)
+	{
+		for (const auto &item : items)
+		{
+			TCHAR sizeText[64];
+			FormatSizeString({ item.wfd.nFileSizeLow, item.wfd.nFileSizeHigh }, sizeText,
+				std::size(sizeText));
+			benchmark::DoNotOptimize(sizeText);
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * items.size());
+}
+
+void BM_FormatFileTime(benchmark::State &state)
+{
+	auto items = CreateSyntheticItems(NUM_ITEMS);
+
+	for (auto _ : state)
+	{
+		for (const auto &item : items)
+		{
+			benchmark::DoNotOptimize(
+				GetDisplayFormatter().FormatFileTime(item.wfd.ftLastWriteTime, false));
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * items.size());
+}
+
+}
+
+BENCHMARK(BM_CheckWildcardMatchExtension);
+BENCHMARK(BM_CheckWildcardMatchMultiplePatterns);
+BENCHMARK(BM_CheckWildcardMatchComplexPattern);
+BENCHMARK(BM_FormatSizeString);
+BENCHMARK(BM_FormatFileTime);
\ No newline at end of file
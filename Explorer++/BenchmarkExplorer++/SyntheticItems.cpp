@@ -0,0 +1,71 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "SyntheticItems.h"
+#include <random>
+
+namespace
+{
+
+const wchar_t *const NAME_PREFIXES[] = { L"Document ", L"IMG_", L"report-v", L"Photo (",
+	L"data_", L"Meeting notes ", L"setup", L"~temp" };
+
+const wchar_t *const EXTENSIONS[] = { L".txt", L".jpg", L".docx", L".cpp", L".h", L".png",
+	L".pdf", L".zip", L".lnk", L"" };
+
+FILETIME MakeFileTime(uint64_t value)
+{
+	return { static_cast<DWORD>(value), static_cast<DWORD>(value >> 32) };
+}
+
+}
+
+std::vector<BasicItemInfo_t> CreateSyntheticItems(size_t numItems)
+{
+	std::mt19937_64 generator(numItems);
+	std::uniform_int_distribution<size_t> prefixDistribution(0, std::size(NAME_PREFIXES) - 1);
+	std::uniform_int_distribution<size_t> extensionDistribution(0, std::size(EXTENSIONS) - 1);
+	std::uniform_int_distribution<size_t> numberDistribution(0, numItems);
+
+	// File sizes are spread over several orders of magnitude.
+	std::uniform_int_distribution<int> sizeShiftDistribution(0, 36);
+
+	// Timestamps between 2000 and 2025.
+	std::uniform_int_distribution<uint64_t> timeDistribution(
+		125911584000000000ULL, 133801632000000000ULL);
+
+	std::vector<BasicItemInfo_t> items(numItems);
+
+	for (size_t i = 0; i < numItems; i++)
+	{
+		auto &item = items[i];
+		bool isFolder = (i % 10) == 0;
+
+		// The index is appended to make each name unique.
+		swprintf_s(item.szDisplayName, L"%s%zu_%zu%s", NAME_PREFIXES[prefixDistribution(generator)],
+			numberDistribution(generator), i,
+			isFolder ? L"" : EXTENSIONS[extensionDistribution(generator)]);
+
+		item.wfd = {};
+		StringCchCopy(item.wfd.cFileName, std::size(item.wfd.cFileName), item.szDisplayName);
+		item.wfd.dwFileAttributes = isFolder ? FILE_ATTRIBUTE_DIRECTORY : FILE_ATTRIBUTE_ARCHIVE;
+
+		if (!isFolder)
+		{
+			uint64_t size = generator() >> (63 - sizeShiftDistribution(generator));
+			item.wfd.nFileSizeLow = static_cast<DWORD>(size);
+			item.wfd.nFileSizeHigh = static_cast<DWORD>(size >> 32);
+		}
+
+		item.wfd.ftCreationTime = MakeFileTime(timeDistribution(generator));
+		item.wfd.ftLastWriteTime = MakeFileTime(timeDistribution(generator));
+		item.wfd.ftLastAccessTime = MakeFileTime(timeDistribution(generator));
+		item.isFindDataValid = true;
+		item.isRoot = false;
+		item.parsingPath = std::make_shared<const std::wstring>(
+			std::wstring(L"C:\\Synthetic\\") + item.szDisplayName);
+	}
+
+	return items;
+}
\ No newline at end of file
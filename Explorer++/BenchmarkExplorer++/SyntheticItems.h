@@ -0,0 +1,14 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "ShellBrowser/ItemData.h"
+#include <vector>
+
+// Builds a set of items resembling the contents of a large folder: mostly files, with a spread of
+// names, extensions, sizes and timestamps, plus some folders. The items are generated from a fixed
+// seed, so every run works with the same data. No pidls are set, so the items can only be used
+// with the columns and sort modes that work from the find data and display name.
+std::vector<BasicItemInfo_t> CreateSyntheticItems(size_t numItems);
\ No newline at end of file
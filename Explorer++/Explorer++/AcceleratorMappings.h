@@ -82,6 +82,8 @@ const std::unordered_map<std::wstring, int> ACCELERATOR_MAPPINGS = {
 
 	{L"auto_arrange", IDM_VIEW_AUTOARRANGE},
 	{L"toggle_hidden_files", IDM_VIEW_SHOWHIDDENFILES},
+	{L"toggle_cloud_downloads", IDM_VIEW_ALLOWCLOUDDOWNLOADS},
+	{L"toggle_flat_view", IDM_VIEW_FLATVIEW},
 	{L"refresh", IDM_VIEW_REFRESH},
 
 	{L"sort_by_name", IDM_SORTBY_NAME},
@@ -146,6 +148,8 @@ const std::unordered_map<std::wstring, int> ACCELERATOR_MAPPINGS = {
 	{L"sort_by_media_publisher", IDM_SORTBY_MEDIA_PUBLISHER},
 	{L"sort_by_media_writer", IDM_SORTBY_MEDIA_WRITER},
 	{L"sort_by_media_year", IDM_SORTBY_MEDIA_YEAR},
+	{L"sort_by_checksum", IDM_SORTBY_CHECKSUM},
+	{L"sort_by_relative_path", IDM_SORTBY_RELATIVEPATH},
 
 	{L"group_by_name", IDM_GROUPBY_NAME},
 	{L"group_by_size", IDM_GROUPBY_SIZE},
@@ -209,6 +213,8 @@ const std::unordered_map<std::wstring, int> ACCELERATOR_MAPPINGS = {
 	{L"group_by_media_publisher", IDM_GROUPBY_MEDIA_PUBLISHER},
 	{L"group_by_media_writer", IDM_GROUPBY_MEDIA_WRITER},
 	{L"group_by_media_year", IDM_GROUPBY_MEDIA_YEAR},
+	{L"group_by_checksum", IDM_GROUPBY_CHECKSUM},
+	{L"group_by_relative_path", IDM_GROUPBY_RELATIVEPATH},
 
 	{L"select_columns", IDM_VIEW_SELECTCOLUMNS},
 	{L"autosize_columns", IDM_VIEW_AUTOSIZECOLUMNS},
@@ -217,15 +223,18 @@ const std::unordered_map<std::wstring, int> ACCELERATOR_MAPPINGS = {
 
 	{L"set_filter", IDM_FILTER_FILTERRESULTS},
 	{L"apply_filter", IDM_FILTER_APPLYFILTER},
+	{L"quick_filter", IDM_FILTER_QUICKFILTER},
 
 	{L"new_folder", IDM_ACTIONS_NEWFOLDER},
 	{L"split_file", IDM_ACTIONS_SPLITFILE},
 	{L"merge_files", IDM_ACTIONS_MERGEFILES},
 	{L"destroy_files", IDM_ACTIONS_DESTROYFILES},
+	{L"compute_hashes", IDM_ACTIONS_COMPUTEHASHES},
 
 	{L"back", IDM_GO_BACK},
 	{L"forward", IDM_GO_FORWARD},
 	{L"up", IDM_GO_UPONELEVEL},
+	{L"stop", IDM_GO_STOP},
 	{L"go_computer", IDM_GO_MYCOMPUTER},
 	{L"go_documents", IDM_GO_MYDOCUMENTS},
 	{L"go_music", IDM_GO_MYMUSIC},
@@ -242,8 +251,11 @@ const std::unordered_map<std::wstring, int> ACCELERATOR_MAPPINGS = {
 	{L"manage_bookmarks", IDM_BOOKMARKS_MANAGEBOOKMARKS},
 
 	{L"search", IDM_TOOLS_SEARCH},
+	{L"find_duplicate_files", IDM_TOOLS_FINDDUPLICATES},
+	{L"disk_usage", IDM_TOOLS_DISKUSAGE},
 	{L"customize_colors", IDM_TOOLS_CUSTOMIZECOLORS},
 	{L"run_script", IDM_TOOLS_RUNSCRIPT},
+	{L"diagnostics", IDM_TOOLS_DIAGNOSTICS},
 	{L"options", IDM_TOOLS_OPTIONS},
 
 	{L"help", IDM_HELP_HELP},
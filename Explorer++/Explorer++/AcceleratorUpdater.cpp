@@ -11,39 +11,97 @@ AcceleratorUpdater::AcceleratorUpdater(HACCEL *acceleratorTable) :
 
 }
 
-void AcceleratorUpdater::update(const std::vector<ShortcutKey> &shortcutKeys)
+void AcceleratorUpdater::beginBatch()
 {
-	int numAccelerators = CopyAcceleratorTable(*m_acceleratorTable, nullptr, 0);
+	if (m_batchDepth++ > 0)
+	{
+		return;
+	}
 
-	std::vector<ACCEL> accelerators(numAccelerators);
-	CopyAcceleratorTable(*m_acceleratorTable, &accelerators[0], static_cast<int>(accelerators.size()));
+	m_pendingAccelerators = copyAcceleratorTable();
+	m_batchModified = false;
+}
+
+void AcceleratorUpdater::endBatch()
+{
+	assert(m_batchDepth > 0);
+
+	if (--m_batchDepth > 0)
+	{
+		return;
+	}
+
+	if (m_batchModified)
+	{
+		rebuildAcceleratorTable(*m_pendingAccelerators);
+	}
+
+	m_pendingAccelerators.reset();
+}
 
-	for (const auto &shortcutKey : shortcutKeys)
+void AcceleratorUpdater::update(const std::vector<ShortcutKey> &shortcutKeys)
+{
+	if (shortcutKeys.empty())
 	{
-		accelerators.erase(std::remove_if(accelerators.begin(), accelerators.end(), [shortcutKey] (const ACCEL &accel) {
-			return accel.cmd == shortcutKey.command;
-		}), accelerators.end());
+		return;
+	}
 
-		for (const auto &key : shortcutKey.accelerators)
+	modify([&shortcutKeys] (std::vector<ACCEL> &accelerators) {
+		for (const auto &shortcutKey : shortcutKeys)
 		{
-			auto itr = std::find_if(accelerators.begin(), accelerators.end(), [key] (const ACCEL &accel) {
-				return (accel.fVirt & ~FNOINVERT) == key.modifiers && accel.key == key.key;
-			});
+			accelerators.erase(std::remove_if(accelerators.begin(), accelerators.end(), [shortcutKey] (const ACCEL &accel) {
+				return accel.cmd == shortcutKey.command;
+			}), accelerators.end());
 
-			if (itr != accelerators.end())
+			for (const auto &key : shortcutKey.accelerators)
 			{
-				continue;
-			}
+				auto itr = std::find_if(accelerators.begin(), accelerators.end(), [key] (const ACCEL &accel) {
+					return (accel.fVirt & ~FNOINVERT) == key.modifiers && accel.key == key.key;
+				});
 
-			ACCEL newAccel;
-			newAccel.fVirt = key.modifiers;
-			newAccel.key = key.key;
-			newAccel.cmd = static_cast<WORD>(shortcutKey.command);
-			accelerators.push_back(newAccel);
+				if (itr != accelerators.end())
+				{
+					continue;
+				}
+
+				ACCEL newAccel;
+				newAccel.fVirt = key.modifiers;
+				newAccel.key = key.key;
+				newAccel.cmd = static_cast<WORD>(shortcutKey.command);
+				accelerators.push_back(newAccel);
+			}
 		}
+	});
+}
+
+void AcceleratorUpdater::modify(const std::function<void(std::vector<ACCEL> &accelerators)> &change)
+{
+	if (m_pendingAccelerators)
+	{
+		change(*m_pendingAccelerators);
+		m_batchModified = true;
+		return;
 	}
 
-	HACCEL newAcceleratorTable = CreateAcceleratorTable(&accelerators[0], static_cast<int>(accelerators.size()));
+	auto accelerators = copyAcceleratorTable();
+	change(accelerators);
+	rebuildAcceleratorTable(accelerators);
+}
+
+std::vector<ACCEL> AcceleratorUpdater::copyAcceleratorTable() const
+{
+	int numAccelerators = CopyAcceleratorTable(*m_acceleratorTable, nullptr, 0);
+
+	std::vector<ACCEL> accelerators(numAccelerators);
+	CopyAcceleratorTable(*m_acceleratorTable, accelerators.data(), static_cast<int>(accelerators.size()));
+
+	return accelerators;
+}
+
+void AcceleratorUpdater::rebuildAcceleratorTable(const std::vector<ACCEL> &accelerators)
+{
+	HACCEL newAcceleratorTable = CreateAcceleratorTable(const_cast<ACCEL *>(accelerators.data()),
+		static_cast<int>(accelerators.size()));
 
 	if (newAcceleratorTable == nullptr)
 	{
@@ -5,14 +5,32 @@
 #pragma once
 
 #include "Accelerator.h"
+#include <functional>
+#include <optional>
 
 class AcceleratorUpdater
 {
 public:
 	AcceleratorUpdater(HACCEL *acceleratorTable);
 
+	// While a batch is open, changes are made to a copy of the accelerators and the table is only
+	// rebuilt once, when the outermost batch ends. This allows a set of plugins to each register
+	// their shortcuts without the table being recreated for every plugin.
+	void beginBatch();
+	void endBatch();
+
 	void update(const std::vector<ShortcutKey> &shortcutKeys);
 
+	// Applies an arbitrary change to the set of accelerators.
+	void modify(const std::function<void(std::vector<ACCEL> &accelerators)> &change);
+
 private:
+	std::vector<ACCEL> copyAcceleratorTable() const;
+	void rebuildAcceleratorTable(const std::vector<ACCEL> &accelerators);
+
 	HACCEL *m_acceleratorTable;
+
+	int m_batchDepth = 0;
+	std::optional<std::vector<ACCEL>> m_pendingAccelerators;
+	bool m_batchModified = false;
 };
\ No newline at end of file
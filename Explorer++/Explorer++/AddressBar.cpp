@@ -4,6 +4,7 @@
 
 #include "stdafx.h"
 #include "AddressBar.h"
+#include "Bookmarks/BookmarkTree.h"
 #include "CoreInterface.h"
 #include "DarkModeHelper.h"
 #include "ShellBrowser/ShellBrowser.h"
@@ -14,6 +15,7 @@
 #include "../Helper/DataExchangeHelper.h"
 #include "../Helper/DragDropHelper.h"
 #include "../Helper/Helper.h"
+#include "../Helper/PathPrefixIndex.h"
 #include "../Helper/ShellHelper.h"
 #include "../Helper/WindowHelper.h"
 #include "../Helper/iDataObject.h"
@@ -22,16 +24,18 @@
 #include <wil/common.h>
 #include <wil/resource.h>
 
-AddressBar *AddressBar::Create(HWND parent, IExplorerplusplus *expp)
+AddressBar *AddressBar::Create(HWND parent, IExplorerplusplus *expp, BookmarkTree *bookmarkTree)
 {
-	return new AddressBar(parent, expp);
+	return new AddressBar(parent, expp, bookmarkTree);
 }
 
-AddressBar::AddressBar(HWND parent, IExplorerplusplus *expp) :
+AddressBar::AddressBar(HWND parent, IExplorerplusplus *expp, BookmarkTree *bookmarkTree) :
 	BaseWindow(CreateAddressBar(parent)),
 	m_expp(expp),
+	m_bookmarkTree(bookmarkTree),
 	m_backgroundBrush(CreateSolidBrush(DARK_MODE_BACKGROUND_COLOR)),
-	m_defaultFolderIconIndex(GetDefaultFolderIconIndex())
+	m_defaultFolderIconIndex(GetDefaultFolderIconIndex()),
+	m_autoCompleteIndexOutdated(true)
 {
 	Initialize(parent);
 }
@@ -66,9 +70,7 @@ void AddressBar::Initialize(HWND parent)
 	m_windowSubclasses.push_back(std::make_unique<WindowSubclassWrapper>(
 		hEdit, EditSubclassStub, SUBCLASS_ID, reinterpret_cast<DWORD_PTR>(this)));
 
-	/* Turn on auto complete for the edit control within the combobox.
-	This will let the os complete paths as they are typed. */
-	SHAutoComplete(hEdit, SHACF_FILESYSTEM | SHACF_AUTOSUGGEST_FORCE_ON);
+	InitializeAutoComplete(hEdit);
 
 	m_windowSubclasses.push_back(std::make_unique<WindowSubclassWrapper>(
 		parent, ParentWndProcStub, PARENT_SUBCLASS_ID, reinterpret_cast<DWORD_PTR>(this)));
@@ -81,7 +83,135 @@ void AddressBar::Initialize(HWND parent)
 			m_connections.push_back(
 				m_expp->GetTabContainer()->tabNavigationCommittedSignal.AddObserver(
 					std::bind_front(&AddressBar::OnNavigationCommitted, this)));
+
+			// Any change to the tabs, or the folders they've shown, can change the set of paths
+			// that are suggested. The arguments passed by each signal aren't needed.
+			auto *tabContainer = m_expp->GetTabContainer();
+			m_connections.push_back(tabContainer->tabCreatedSignal.AddObserver(
+				std::bind(&AddressBar::InvalidateAutoCompleteIndex, this)));
+			m_connections.push_back(tabContainer->tabRemovedSignal.AddObserver(
+				std::bind(&AddressBar::InvalidateAutoCompleteIndex, this)));
+			m_connections.push_back(tabContainer->tabDirectoryModifiedSignal.AddObserver(
+				std::bind(&AddressBar::InvalidateAutoCompleteIndex, this)));
 		});
+
+	m_connections.push_back(m_bookmarkTree->bookmarkItemAddedSignal.AddObserver(
+		std::bind(&AddressBar::InvalidateAutoCompleteIndex, this)));
+	m_connections.push_back(m_bookmarkTree->bookmarkItemUpdatedSignal.AddObserver(
+		std::bind(&AddressBar::InvalidateAutoCompleteIndex, this)));
+	m_connections.push_back(m_bookmarkTree->bookmarkItemRemovedSignal.AddObserver(
+		std::bind(&AddressBar::InvalidateAutoCompleteIndex, this)));
+}
+
+void AddressBar::InitializeAutoComplete(HWND edit)
+{
+	m_autoCompleteSource = winrt::make_self<PathAutoCompleteSource>();
+
+	wil::com_ptr_nothrow<IAutoComplete2> autoComplete;
+	HRESULT hr = CoCreateInstance(
+		CLSID_AutoComplete, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&autoComplete));
+
+	if (SUCCEEDED(hr))
+	{
+		hr = autoComplete->Init(
+			edit, static_cast<IEnumString *>(m_autoCompleteSource.get()), nullptr, nullptr);
+	}
+
+	if (FAILED(hr))
+	{
+		/* Turn on auto complete for the edit control within the combobox.
+		This will let the os complete paths as they are typed. */
+		SHAutoComplete(edit, SHACF_FILESYSTEM | SHACF_AUTOSUGGEST_FORCE_ON);
+		return;
+	}
+
+	autoComplete->SetOptions(ACO_AUTOSUGGEST | ACO_UPDOWNKEYDROPSLIST);
+}
+
+void AddressBar::InvalidateAutoCompleteIndex()
+{
+	m_autoCompleteIndexOutdated = true;
+}
+
+void AddressBar::UpdateAutoCompleteIndex()
+{
+	if (!m_autoCompleteIndexOutdated || !m_expp->GetTabContainer())
+	{
+		return;
+	}
+
+	auto index = std::make_shared<PathPrefixIndex>();
+
+	auto addPath = [&index](const std::wstring &path)
+	{
+		// Virtual folders and URLs can't be completed.
+		if (!PathIsRelative(path.c_str()))
+		{
+			index->AddPath(path);
+		}
+	};
+
+	for (const auto &[tabId, tab] : m_expp->GetTabContainer()->GetAllTabs())
+	{
+		const ShellBrowser *shellBrowser = tab->GetShellBrowser();
+		addPath(shellBrowser->GetDirectory());
+
+		const auto *navigationController = shellBrowser->GetNavigationController();
+
+		for (int i = 0; i < navigationController->GetNumHistoryEntries(); i++)
+		{
+			std::wstring path;
+			HRESULT hr = GetDisplayName(navigationController->GetEntryAtIndex(i)->GetPidl().get(),
+				SHGDN_FORPARSING, path);
+
+			if (SUCCEEDED(hr))
+			{
+				addPath(path);
+			}
+		}
+
+		for (const auto &listing : shellBrowser->GetRecentFolderListings())
+		{
+			index->AddListedDirectory(listing.directory);
+
+			std::wstring prefix = listing.directory;
+
+			if (!prefix.ends_with(L'\\'))
+			{
+				prefix += L'\\';
+			}
+
+			for (const auto &subfolderName : listing.subfolderNames)
+			{
+				index->AddPath(prefix + subfolderName);
+			}
+		}
+	}
+
+	AddBookmarksToIndex(m_bookmarkTree->GetRoot(), *index);
+
+	m_autoCompleteSource->SetIndex(index);
+	m_autoCompleteIndexOutdated = false;
+}
+
+void AddressBar::AddBookmarksToIndex(const BookmarkItem *bookmarkItem, PathPrefixIndex &index)
+{
+	if (!bookmarkItem->IsFolder())
+	{
+		std::wstring location = bookmarkItem->GetLocation();
+
+		if (!PathIsRelative(location.c_str()))
+		{
+			index.AddPath(location);
+		}
+
+		return;
+	}
+
+	for (const auto &child : bookmarkItem->GetChildren())
+	{
+		AddBookmarksToIndex(child.get(), index);
+	}
 }
 
 LRESULT AddressBar::ComboBoxExSubclass(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
@@ -132,6 +262,10 @@ LRESULT CALLBACK AddressBar::EditSubclass(HWND hwnd, UINT msg, WPARAM wParam, LP
 	switch (msg)
 	{
 	case WM_KEYDOWN:
+		// The index may have become outdated while the address bar had focus (e.g. if a
+		// navigation took place).
+		UpdateAutoCompleteIndex();
+
 		switch (wParam)
 		{
 		case VK_RETURN:
@@ -141,6 +275,7 @@ LRESULT CALLBACK AddressBar::EditSubclass(HWND hwnd, UINT msg, WPARAM wParam, LP
 		break;
 
 	case WM_SETFOCUS:
+		UpdateAutoCompleteIndex();
 		m_expp->FocusChanged(WindowFocusSource::AddressBar);
 		break;
 
@@ -375,7 +510,11 @@ std::optional<wil::unique_stg_medium> AddressBar::GenerateShortcutContentsStgMed
 
 void AddressBar::OnTabSelected(const Tab &tab)
 {
-	UpdateTextAndIcon(tab);
+	UNREFERENCED_PARAMETER(tab);
+
+	m_expp->GetTabContainer()->ScheduleSelectionUpdate(this,
+		TabContainer::SelectionUpdatePriority::Navigation,
+		std::bind_front(&AddressBar::UpdateTextAndIcon, this));
 }
 
 void AddressBar::OnNavigationCommitted(const Tab &tab, PCIDLIST_ABSOLUTE pidl, bool addHistoryEntry)
@@ -383,6 +522,8 @@ void AddressBar::OnNavigationCommitted(const Tab &tab, PCIDLIST_ABSOLUTE pidl, b
 	UNREFERENCED_PARAMETER(pidl);
 	UNREFERENCED_PARAMETER(addHistoryEntry);
 
+	InvalidateAutoCompleteIndex();
+
 	if (m_expp->GetTabContainer()->IsTabSelected(tab))
 	{
 		UpdateTextAndIcon(tab);
@@ -401,46 +542,23 @@ void AddressBar::UpdateTextAndIcon(const Tab &tab)
 
 	auto entry = tab.GetShellBrowser()->GetNavigationController()->GetCurrentEntry();
 
+	// The full path and icon are both resolved in the background when the navigation is
+	// committed. Until the full path is available, the entry's display name is shown instead.
 	auto cachedFullPath = entry->GetFullPathForDisplay();
-	std::optional<std::wstring> text;
-
-	if (cachedFullPath)
-	{
-		text = cachedFullPath;
-	}
-	else
-	{
-		text = GetFolderPathForDisplay(entry->GetPidl().get());
-
-		if (text)
-		{
-			entry->SetFullPathForDisplay(*text);
-		}
-	}
-
-	if (!text)
-	{
-		return;
-	}
+	std::wstring text = cachedFullPath ? *cachedFullPath : entry->GetDisplayName();
 
 	auto cachedIconIndex = entry->GetSystemIconIndex();
-	int iconIndex;
+	int iconIndex = cachedIconIndex.value_or(m_defaultFolderIconIndex);
 
-	if (cachedIconIndex)
-	{
-		iconIndex = *cachedIconIndex;
-	}
-	else
+	if (!cachedFullPath || !cachedIconIndex)
 	{
-		iconIndex = m_defaultFolderIconIndex;
-
 		m_historyEntryUpdatedConnection = entry->historyEntryUpdatedSignal.AddObserver(
 			std::bind_front(&AddressBar::OnHistoryEntryUpdated, this));
 	}
 
 	SendMessage(m_hwnd, CB_RESETCONTENT, 0, 0);
 
-	UpdateTextAndIconInUI(&*text, iconIndex);
+	UpdateTextAndIconInUI(&text, iconIndex);
 }
 
 void AddressBar::UpdateTextAndIconInUI(std::wstring *text, int iconIndex)
@@ -472,5 +590,14 @@ void AddressBar::OnHistoryEntryUpdated(
 			UpdateTextAndIconInUI(nullptr, *entry.GetSystemIconIndex());
 		}
 		break;
+
+	case HistoryEntry::PropertyType::FullPathForDisplay:
+		if (entry.GetFullPathForDisplay())
+		{
+			auto text = *entry.GetFullPathForDisplay();
+			UpdateTextAndIconInUI(
+				&text, entry.GetSystemIconIndex().value_or(m_defaultFolderIconIndex));
+		}
+		break;
 	}
 }
\ No newline at end of file
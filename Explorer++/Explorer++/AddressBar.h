@@ -4,19 +4,23 @@
 
 #pragma once
 
+#include "PathAutoCompleteSource.h"
 #include "ShellBrowser/HistoryEntry.h"
 #include "../Helper/BaseWindow.h"
 #include "../Helper/WindowSubclassWrapper.h"
 #include <wil/resource.h>
 #include <optional>
 
+class BookmarkItem;
+class BookmarkTree;
 __interface IExplorerplusplus;
+class PathPrefixIndex;
 class Tab;
 
 class AddressBar : public BaseWindow
 {
 public:
-	static AddressBar *Create(HWND parent, IExplorerplusplus *expp);
+	static AddressBar *Create(HWND parent, IExplorerplusplus *expp, BookmarkTree *bookmarkTree);
 
 private:
 	static const UINT_PTR SUBCLASS_ID = 0;
@@ -25,7 +29,7 @@ private:
 	// This is the same background color as used in the Explorer address bar.
 	static inline constexpr COLORREF DARK_MODE_BACKGROUND_COLOR = RGB(25, 25, 25);
 
-	AddressBar(HWND parent, IExplorerplusplus *expp);
+	AddressBar(HWND parent, IExplorerplusplus *expp, BookmarkTree *bookmarkTree);
 	~AddressBar() = default;
 
 	static HWND CreateAddressBar(HWND parent);
@@ -41,6 +45,10 @@ private:
 	LRESULT CALLBACK ParentWndProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
 
 	void Initialize(HWND parent);
+	void InitializeAutoComplete(HWND edit);
+	void InvalidateAutoCompleteIndex();
+	void UpdateAutoCompleteIndex();
+	static void AddBookmarksToIndex(const BookmarkItem *bookmarkItem, PathPrefixIndex &index);
 	std::optional<LRESULT> OnComboBoxExCtlColorEdit(HWND hwnd, HDC hdc);
 	void OnGo();
 	void OnBeginDrag();
@@ -56,11 +64,17 @@ private:
 	void OnHistoryEntryUpdated(const HistoryEntry &entry, HistoryEntry::PropertyType propertyType);
 
 	IExplorerplusplus *m_expp;
+	BookmarkTree *m_bookmarkTree;
 	wil::unique_hbrush m_backgroundBrush;
 
 	boost::signals2::scoped_connection m_historyEntryUpdatedConnection;
 	int m_defaultFolderIconIndex;
 
+	// The index used for autocompletion is only rebuilt once the address bar is being typed into
+	// and only if one of the sources it's built from has changed since it was last built.
+	winrt::com_ptr<PathAutoCompleteSource> m_autoCompleteSource;
+	bool m_autoCompleteIndexOutdated;
+
 	std::vector<std::unique_ptr<WindowSubclassWrapper>> m_windowSubclasses;
 	std::vector<boost::signals2::scoped_connection> m_connections;
 };
\ No newline at end of file
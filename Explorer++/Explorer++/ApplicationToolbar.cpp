@@ -25,7 +25,9 @@
 #include "ResourceHelper.h"
 #include "../Helper/Controls.h"
 #include "../Helper/Macros.h"
+#include "../Helper/ParsedPathCache.h"
 #include "../Helper/RegistrySettings.h"
+#include "../Helper/RegistryValueCache.h"
 #include "../Helper/ShellHelper.h"
 #include "../Helper/XMLSettings.h"
 #include <boost/algorithm/string.hpp>
@@ -53,7 +55,13 @@ ApplicationToolbar::ApplicationToolbar(
 	m_hInstance(hInstance),
 	m_uIDStart(uIDStart),
 	m_uIDEnd(uIDEnd),
-	m_pexpp(pexpp)
+	m_pexpp(pexpp),
+	m_resolveThreadPool(
+		1, std::bind(CoInitializeEx, nullptr, COINIT_APARTMENTTHREADED), CoUninitialize),
+	m_resolveResultIDCounter(0),
+	m_launchThreadPool(LAUNCH_THREADS,
+		std::bind(CoInitializeEx, nullptr, COINIT_APARTMENTTHREADED), CoUninitialize),
+	m_launchResultIDCounter(0)
 {
 	Initialize(hParent);
 }
@@ -104,6 +112,9 @@ void ApplicationToolbar::Initialize(HWND hParent)
 
 ApplicationToolbar::~ApplicationToolbar()
 {
+	m_resolveThreadPool.clear_queue();
+	m_launchThreadPool.clear_queue();
+
 	RevokeDragDrop(m_hwnd);
 	m_patd->Release();
 }
@@ -218,20 +229,8 @@ void ApplicationToolbar::AddButtonsToToolbar()
 
 void ApplicationToolbar::AddButtonToToolbar(const ApplicationButton &Button)
 {
-	ApplicationInfo ai = ParseCommandString(Button.Command);
-
-	SHFILEINFO shfi;
-	DWORD_PTR ret =
-		SHGetFileInfo(ai.application.c_str(), 0, &shfi, sizeof(shfi), SHGFI_SYSICONINDEX);
-
-	/* Assign a generic icon if the file was not found. */
-	if (ret == 0)
-	{
-		shfi.iIcon = 0;
-	}
-
 	TBBUTTON tbButton;
-	tbButton.iBitmap = shfi.iIcon;
+	tbButton.iBitmap = GetCachedIconIndex(Button);
 	tbButton.idCommand = m_uIDStart + Button.ID;
 	tbButton.fsState = TBSTATE_ENABLED;
 	tbButton.fsStyle = BTNS_AUTOSIZE | BTNS_SHOWTEXT;
@@ -256,22 +255,11 @@ void ApplicationToolbar::UpdateButton(int iItem)
 
 	if (button != nullptr)
 	{
-		ApplicationInfo ai = ParseCommandString(button->Command);
-
-		SHFILEINFO shfi;
-		DWORD_PTR ret =
-			SHGetFileInfo(ai.application.c_str(), 0, &shfi, sizeof(shfi), SHGFI_SYSICONINDEX);
-
-		if (ret == 0)
-		{
-			shfi.iIcon = 0;
-		}
-
 		TBBUTTONINFO tbi;
 		TCHAR name[512];
 		tbi.cbSize = sizeof(tbi);
 		tbi.dwMask = TBIF_BYINDEX | TBIF_IMAGE;
-		tbi.iImage = shfi.iIcon;
+		tbi.iImage = GetCachedIconIndex(*button);
 
 		if (button->ShowNameOnToolbar)
 		{
@@ -285,6 +273,123 @@ void ApplicationToolbar::UpdateButton(int iItem)
 	}
 }
 
+// Returns the icon for the button, if its command has already been resolved. Otherwise, the command
+// will be resolved in the background and a generic icon is returned in the meantime.
+int ApplicationToolbar::GetCachedIconIndex(const ApplicationButton &button)
+{
+	auto itr = m_resolvedCommands.find(button.ID);
+
+	if (itr != m_resolvedCommands.end() && itr->second.command == button.Command)
+	{
+		return itr->second.iconIndex;
+	}
+
+	QueueResolveTask(button);
+
+	return 0;
+}
+
+void ApplicationToolbar::QueueResolveTask(const ApplicationButton &button)
+{
+	int resolveResultID = m_resolveResultIDCounter++;
+
+	auto result = m_resolveThreadPool.push(
+		[toolbar = m_hwnd, resolveResultID, buttonId = button.ID, command = button.Command](
+			int id) {
+			UNREFERENCED_PARAMETER(id);
+
+			auto resolveResult = ResolveCommand(buttonId, command);
+			PostMessage(toolbar, WM_APP_RESOLVE_RESULT_READY, resolveResultID, 0);
+			return resolveResult;
+		});
+
+	m_resolveResults.insert({ resolveResultID, std::move(result) });
+}
+
+void ApplicationToolbar::ProcessResolveResult(int resolveResultId)
+{
+	auto itr = m_resolveResults.find(resolveResultId);
+
+	if (itr == m_resolveResults.end())
+	{
+		return;
+	}
+
+	auto cleanup = wil::scope_exit([this, itr]() {
+		m_resolveResults.erase(itr);
+	});
+
+	OnCommandResolved(itr->second.get());
+}
+
+void ApplicationToolbar::OnCommandResolved(const ResolveResult &resolveResult)
+{
+	if (!resolveResult.resolvedCommand)
+	{
+		return;
+	}
+
+	// The button may have been deleted, or its command changed, while the command was being
+	// resolved.
+	auto itr = std::find_if(m_atps->m_Buttons.begin(), m_atps->m_Buttons.end(),
+		[&resolveResult](const ApplicationButton &button) {
+			return button.ID == resolveResult.buttonId;
+		});
+
+	if (itr == m_atps->m_Buttons.end()
+		|| itr->Command != resolveResult.resolvedCommand->command)
+	{
+		return;
+	}
+
+	m_resolvedCommands.erase(resolveResult.buttonId);
+	m_resolvedCommands.emplace(resolveResult.buttonId, *resolveResult.resolvedCommand);
+
+	SendMessage(m_hwnd, TB_CHANGEBITMAP, m_uIDStart + resolveResult.buttonId,
+		MAKELPARAM(resolveResult.resolvedCommand->iconIndex, 0));
+}
+
+// Parses the command and locates the application it refers to. As the application may be on a
+// slow (or unavailable) network share, this is always called on a background thread.
+ApplicationToolbar::ResolveResult ApplicationToolbar::ResolveCommand(
+	int buttonId, const std::wstring &command)
+{
+	ApplicationInfo ai = ParseCommandString(command);
+
+	ResolveResult resolveResult;
+	resolveResult.buttonId = buttonId;
+	resolveResult.application = ai.application;
+
+	unique_pidl_absolute pidl;
+	resolveResult.hr =
+		ParsedPathCache::GetInstance().ParsePath(ai.application, wil::out_param(pidl));
+
+	if (FAILED(resolveResult.hr))
+	{
+		return resolveResult;
+	}
+
+	ResolvedCommand resolvedCommand;
+	resolvedCommand.command = command;
+	resolvedCommand.parameters = ai.parameters;
+
+	unique_pidl_absolute pidlParent(ILCloneFull(pidl.get()));
+	ILRemoveLastID(pidlParent.get());
+	GetDisplayName(pidlParent.get(), SHGDN_FORPARSING, resolvedCommand.directory);
+
+	SHFILEINFO shfi;
+	DWORD_PTR ret = SHGetFileInfo(reinterpret_cast<LPCTSTR>(pidl.get()), 0, &shfi, sizeof(shfi),
+		SHGFI_PIDL | SHGFI_SYSICONINDEX);
+
+	/* Assign a generic icon if the file was not found. */
+	resolvedCommand.iconIndex = (ret != 0) ? shfi.iIcon : 0;
+
+	resolvedCommand.pidl = std::move(pidl);
+	resolveResult.resolvedCommand.emplace(resolvedCommand);
+
+	return resolveResult;
+}
+
 void ApplicationToolbar::ShowNewItemDialog()
 {
 	ApplicationButton button;
@@ -330,33 +435,154 @@ void ApplicationToolbar::OpenItem(int iItem, std::wstring *parameters)
 		return;
 	}
 
-	ApplicationInfo ai = ParseCommandString(button->Command);
+	QueueLaunchTask(*button, (parameters != nullptr) ? *parameters : std::wstring());
+}
 
-	unique_pidl_absolute pidl;
-	HRESULT hr =
-		SHParseDisplayName(ai.application.c_str(), nullptr, wil::out_param(pidl), 0, nullptr);
+// Both resolving the command (if it hasn't already been cached) and launching the application can
+// block, so they're performed in the background. The button is shown as busy in the meantime.
+void ApplicationToolbar::QueueLaunchTask(
+	const ApplicationButton &button, const std::wstring &extraParameters)
+{
+	std::optional<ResolvedCommand> resolvedCommand;
+	auto itr = m_resolvedCommands.find(button.ID);
 
-	if (FAILED(hr))
+	if (itr != m_resolvedCommands.end() && itr->second.command == button.Command)
+	{
+		resolvedCommand.emplace(itr->second);
+	}
+
+	int launchResultID = m_launchResultIDCounter++;
+
+	auto result = m_launchThreadPool.push(
+		[toolbar = m_hwnd, owner = m_pexpp->GetMainWindow(), launchResultID,
+			buttonId = button.ID, command = button.Command, resolvedCommand,
+			extraParameters](int id) {
+			UNREFERENCED_PARAMETER(id);
+
+			return LaunchAsync(toolbar, owner, launchResultID, buttonId, command, resolvedCommand,
+				extraParameters);
+		});
+
+	m_launchResults.insert({ launchResultID, std::move(result) });
+
+	SetButtonBusy(button.ID, true);
+}
+
+ApplicationToolbar::LaunchResult ApplicationToolbar::LaunchAsync(HWND toolbar, HWND owner,
+	int launchResultId, int buttonId, const std::wstring &command,
+	std::optional<ResolvedCommand> resolvedCommand, const std::wstring &extraParameters)
+{
+	LaunchResult launchResult{ buttonId,
+		resolvedCommand ? ResolveResult{ buttonId, L"", S_OK, resolvedCommand }
+						: ResolveCommand(buttonId, command),
+		false };
+
+	const auto &resolved = launchResult.resolveResult.resolvedCommand;
+
+	if (resolved)
+	{
+		std::wstring combinedParameters = resolved->parameters;
+
+		if (!extraParameters.empty())
+		{
+			combinedParameters.append(_T(" "));
+			combinedParameters.append(extraParameters);
+		}
+
+		launchResult.launched = ExecuteFileAction(owner, EMPTY_STRING, combinedParameters.c_str(),
+			resolved->directory.c_str(), resolved->pidl.get());
+	}
+
+	PostMessage(toolbar, WM_APP_LAUNCH_RESULT_READY, launchResultId, 0);
+
+	return launchResult;
+}
+
+void ApplicationToolbar::ProcessLaunchResult(int launchResultId)
+{
+	auto itr = m_launchResults.find(launchResultId);
+
+	if (itr == m_launchResults.end())
+	{
+		return;
+	}
+
+	auto cleanup = wil::scope_exit([this, itr]() {
+		m_launchResults.erase(itr);
+	});
+
+	auto launchResult = itr->second.get();
+
+	SetButtonBusy(launchResult.buttonId, false);
+
+	const auto &resolveResult = launchResult.resolveResult;
+
+	if (FAILED(resolveResult.hr))
 	{
 		std::wstring messageTemplate =
 			ResourceHelper::LoadString(m_hInstance, IDS_APPLICATION_TOOLBAR_OPEN_ERROR);
-		_com_error error(hr);
-		std::wstring message =
-			(boost::wformat(messageTemplate) % ai.application % error.ErrorMessage()).str();
+		_com_error error(resolveResult.hr);
+		std::wstring message = (boost::wformat(messageTemplate) % resolveResult.application
+			% error.ErrorMessage())
+								   .str();
 
 		MessageBox(m_hwnd, message.c_str(), NExplorerplusplus::APP_NAME, MB_ICONWARNING | MB_OK);
 		return;
 	}
 
-	std::wstring combinedParameters = ai.parameters;
+	if (!launchResult.launched)
+	{
+		// The shell will already have shown an error. The application may have been moved or
+		// deleted, so the command will be resolved again the next time the button is clicked.
+		m_resolvedCommands.erase(launchResult.buttonId);
+		return;
+	}
+
+	if (!m_resolvedCommands.contains(launchResult.buttonId))
+	{
+		OnCommandResolved(resolveResult);
+	}
+}
+
+void ApplicationToolbar::SetButtonBusy(int buttonId, bool busy)
+{
+	int &pendingLaunches = m_pendingLaunches[buttonId];
+
+	if (busy)
+	{
+		pendingLaunches++;
+	}
+	else
+	{
+		pendingLaunches--;
+	}
+
+	bool marked = (pendingLaunches > 0);
+
+	if (!marked)
+	{
+		m_pendingLaunches.erase(buttonId);
+	}
+
+	SendMessage(m_hwnd, TB_MARKBUTTON, m_uIDStart + buttonId, MAKELPARAM(marked, 0));
+}
+
+INT_PTR ApplicationToolbar::OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
+{
+	UNREFERENCED_PARAMETER(lParam);
 
-	if (parameters != nullptr && parameters->length() > 0)
+	switch (uMsg)
 	{
-		combinedParameters.append(_T(" "));
-		combinedParameters.append(*parameters);
+	case WM_APP_RESOLVE_RESULT_READY:
+		ProcessResolveResult(static_cast<int>(wParam));
+		break;
+
+	case WM_APP_LAUNCH_RESULT_READY:
+		ProcessLaunchResult(static_cast<int>(wParam));
+		break;
 	}
 
-	m_pexpp->OpenFileItem(pidl.get(), combinedParameters.c_str());
+	return 0;
 }
 
 void ApplicationToolbar::ShowItemProperties(int iItem)
@@ -404,6 +630,7 @@ void ApplicationToolbar::DeleteItem(int iItem)
 			if (itr != m_atps->m_Buttons.end())
 			{
 				m_atps->m_Buttons.erase(itr);
+				m_resolvedCommands.erase(id);
 				SendMessage(m_hwnd, TB_DELETEBUTTON, iItem, 0);
 				UpdateToolbarBandSizing(GetParent(m_hwnd), m_hwnd);
 			}
@@ -480,6 +707,8 @@ void ApplicationToolbarPersistentSettings::LoadRegistrySettings(HKEY hParentKey)
 
 	while (returnValue == ERROR_SUCCESS)
 	{
+		RegistryValueCache buttonValues(hKeyChild);
+
 		TCHAR szName[512];
 		TCHAR szCommand[512];
 		BOOL bShowNameOnToolbar = TRUE;
@@ -6,8 +6,13 @@
 
 #include "ApplicationToolbarDropHandler.h"
 #include "../Helper/BaseWindow.h"
+#include "../Helper/ShellHelper.h"
 #include "../Helper/WindowSubclassWrapper.h"
+#include "../ThirdParty/CTPL/cpl_stl.h"
 #include <objbase.h>
+#include <future>
+#include <optional>
+#include <unordered_map>
 #include <vector>
 
 class ApplicationToolbar;
@@ -68,6 +73,53 @@ public:
 private:
 	static const UINT_PTR PARENT_SUBCLASS_ID = 0;
 
+	static const UINT WM_APP_RESOLVE_RESULT_READY = WM_APP + 1;
+	static const UINT WM_APP_LAUNCH_RESULT_READY = WM_APP + 2;
+
+	// Launches can block for a long time (e.g. when the application is on a slow network share, or
+	// when SmartScreen checks it), so more than one is allowed to run at a time.
+	static const int LAUNCH_THREADS = 2;
+
+	// The result of resolving a button's command. This is cached, so that the command doesn't need
+	// to be parsed (and the application located) each time the button is clicked.
+	struct ResolvedCommand
+	{
+		ResolvedCommand() = default;
+
+		ResolvedCommand(const ResolvedCommand &other)
+		{
+			command = other.command;
+			parameters = other.parameters;
+			pidl.reset(ILCloneFull(other.pidl.get()));
+			directory = other.directory;
+			iconIndex = other.iconIndex;
+		}
+
+		// The command this was resolved from. If the button's command is later changed, the cached
+		// result will no longer be used.
+		std::wstring command;
+
+		std::wstring parameters;
+		unique_pidl_absolute pidl;
+		std::wstring directory;
+		int iconIndex = 0;
+	};
+
+	struct ResolveResult
+	{
+		int buttonId;
+		std::wstring application;
+		HRESULT hr;
+		std::optional<ResolvedCommand> resolvedCommand;
+	};
+
+	struct LaunchResult
+	{
+		int buttonId;
+		ResolveResult resolveResult;
+		bool launched;
+	};
+
 	static LRESULT CALLBACK ParentWndProcStub(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam,
 		UINT_PTR uIdSubclass, DWORD_PTR dwRefData);
 	LRESULT CALLBACK ParentWndProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
@@ -83,6 +135,21 @@ private:
 	void AddButtonsToToolbar();
 	void AddButtonToToolbar(const ApplicationButton &Button);
 	void UpdateButton(int iItem);
+	int GetCachedIconIndex(const ApplicationButton &button);
+
+	void QueueResolveTask(const ApplicationButton &button);
+	void ProcessResolveResult(int resolveResultId);
+	void OnCommandResolved(const ResolveResult &resolveResult);
+	static ResolveResult ResolveCommand(int buttonId, const std::wstring &command);
+
+	void QueueLaunchTask(const ApplicationButton &button, const std::wstring &extraParameters);
+	static LaunchResult LaunchAsync(HWND toolbar, HWND owner, int launchResultId, int buttonId,
+		const std::wstring &command, std::optional<ResolvedCommand> resolvedCommand,
+		const std::wstring &extraParameters);
+	void ProcessLaunchResult(int launchResultId);
+	void SetButtonBusy(int buttonId, bool busy);
+
+	INT_PTR OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lParam) override;
 
 	void OnToolbarContextMenuPreShow(HMENU menu, HWND sourceWindow, const POINT &pt);
 
@@ -101,6 +168,20 @@ private:
 
 	ApplicationToolbarPersistentSettings *m_atps;
 
+	std::unordered_map<int, ResolvedCommand> m_resolvedCommands;
+
+	ctpl::thread_pool m_resolveThreadPool;
+	std::unordered_map<int, std::future<ResolveResult>> m_resolveResults;
+	int m_resolveResultIDCounter;
+
+	ctpl::thread_pool m_launchThreadPool;
+	std::unordered_map<int, std::future<LaunchResult>> m_launchResults;
+	int m_launchResultIDCounter;
+
+	// The number of launches that are in progress for each button. A button is shown as busy while
+	// this is non-zero.
+	std::unordered_map<int, int> m_pendingLaunches;
+
 	std::vector<std::unique_ptr<WindowSubclassWrapper>> m_windowSubclasses;
 	std::vector<boost::signals2::scoped_connection> m_connections;
 };
\ No newline at end of file
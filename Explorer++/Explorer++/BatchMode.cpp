@@ -0,0 +1,406 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "BatchMode.h"
+#include "../Helper/DriveInfo.h"
+#include "../Helper/FileHash.h"
+#include "../Helper/FileOperations.h"
+#include "../Helper/FolderSize.h"
+#include "../Helper/ParallelWalk.h"
+#include "../Helper/StringHelper.h"
+#include "../Helper/TextSearcher.h"
+#include "../Helper/WildcardMatcher.h"
+#include "../ThirdParty/CLI11/CLI11.hpp"
+#include <nlohmann/json.hpp>
+#include <wil/resource.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+	struct CommonSettings
+	{
+		int numJobs;
+	};
+
+	struct BatchResult
+	{
+		nlohmann::json output;
+		bool succeeded;
+	};
+
+	// Processes each of the items on a set of threads. The results are returned in the same
+	// order as the items, so that the output doesn't depend on the order in which the items
+	// happened to finish.
+	std::vector<nlohmann::json> ProcessInParallel(const std::vector<std::string> &items,
+		int numJobs, const std::function<nlohmann::json(const std::wstring &item)> &process)
+	{
+		std::vector<nlohmann::json> results(items.size());
+		std::atomic<size_t> nextIndex = 0;
+
+		auto work = [&items, &process, &results, &nextIndex] {
+			for (size_t index = nextIndex++; index < items.size(); index = nextIndex++)
+			{
+				results[index] = process(utf8StrToWstr(items[index]));
+			}
+		};
+
+		size_t numThreads = (std::min)(static_cast<size_t>(numJobs), items.size());
+
+		{
+			// The calling thread does its share of the work as well. The other threads are joined
+			// at the end of this scope.
+			std::vector<std::jthread> threads;
+
+			for (size_t i = 1; i < numThreads; i++)
+			{
+				threads.emplace_back(work);
+			}
+
+			work();
+		}
+
+		return results;
+	}
+
+	BatchResult CollectResults(std::vector<nlohmann::json> results)
+	{
+		bool succeeded = std::none_of(results.begin(), results.end(),
+			[](const nlohmann::json &result) { return result.contains("error"); });
+		return { std::move(results), succeeded };
+	}
+
+	nlohmann::json MakeError(const std::wstring &path, const std::string &error)
+	{
+		return { { "path", wstrToUtf8Str(path) }, { "error", error } };
+	}
+
+	BatchResult HashFiles(const std::vector<std::string> &paths, const CommonSettings &settings)
+	{
+		return CollectResults(
+			ProcessInParallel(paths, settings.numJobs, [](const std::wstring &path) {
+				auto hash = CalculateFileHash(path);
+
+				if (!hash)
+				{
+					return MakeError(path, "The file couldn't be read");
+				}
+
+				return nlohmann::json{ { "path", wstrToUtf8Str(path) },
+					{ "sha256", wstrToUtf8Str(FormatFileHash(*hash)) } };
+			}));
+	}
+
+	BatchResult CalculateFolderSizes(const std::vector<std::string> &paths,
+		const CommonSettings &settings)
+	{
+		// Each folder is itself walked in parallel (using the threads shared by all walks), so the
+		// number of jobs only controls how many folders are walked at once.
+		return CollectResults(
+			ProcessInParallel(paths, settings.numJobs, [](const std::wstring &path) {
+				DWORD attributes = GetFileAttributes(path.c_str());
+
+				if (attributes == INVALID_FILE_ATTRIBUTES
+					|| WI_IsFlagClear(attributes, FILE_ATTRIBUTE_DIRECTORY))
+				{
+					return MakeError(path, "The folder doesn't exist");
+				}
+
+				auto folderInfo = GetFolderInfo(path);
+
+				return nlohmann::json{ { "path", wstrToUtf8Str(path) },
+					{ "size", folderInfo.size }, { "files", folderInfo.numFiles },
+					{ "folders", folderInfo.numFolders } };
+			}));
+	}
+
+	BatchResult SecurelyDeleteFiles(const std::vector<std::string> &paths,
+		NFileOperations::OverwriteMethod overwriteMethod, const CommonSettings &settings)
+	{
+		return CollectResults(ProcessInParallel(paths, settings.numJobs,
+			[overwriteMethod](const std::wstring &path) {
+				DWORD attributes = GetFileAttributes(path.c_str());
+
+				if (attributes == INVALID_FILE_ATTRIBUTES
+					|| WI_IsFlagSet(attributes, FILE_ATTRIBUTE_DIRECTORY))
+				{
+					return MakeError(path, "The file doesn't exist");
+				}
+
+				NFileOperations::DeleteFileSecurely(path, overwriteMethod);
+
+				// DeleteFileSecurely() doesn't report failures directly.
+				if (GetFileAttributes(path.c_str()) != INVALID_FILE_ATTRIBUTES)
+				{
+					return MakeError(path, "The file couldn't be deleted");
+				}
+
+				return nlohmann::json{ { "path", wstrToUtf8Str(path) }, { "deleted", true } };
+			}));
+	}
+
+	BatchResult SaveDirectoryListing(const std::string &directory, const std::string &outputFile,
+		DirectoryListingFormatter::Format format, bool recursive)
+	{
+		std::wstring directoryPath = utf8StrToWstr(directory);
+		std::wstring outputPath = utf8StrToWstr(outputFile);
+
+		if (!NFileOperations::SaveDirectoryListing(directoryPath, outputPath, format, recursive))
+		{
+			return { MakeError(directoryPath, "The listing couldn't be saved"), false };
+		}
+
+		return { { { "path", directory }, { "output", outputFile } }, true };
+	}
+
+	struct SearchSettings
+	{
+		std::string folder;
+		std::string namePattern = "*";
+		std::string text;
+		bool useRegularExpressions = false;
+		bool caseInsensitive = false;
+		bool noSubfolders = false;
+	};
+
+	// Searches in the same way as the search dialog. Folders are walked in parallel and, if text
+	// has been specified, each file with a matching name is queued so that the contents of the
+	// files in a single folder are also searched in parallel.
+	BatchResult Search(const SearchSettings &settings)
+	{
+		struct SearchItem
+		{
+			std::wstring path;
+			bool isFolder;
+		};
+
+		WildcardMatcher nameMatcher(utf8StrToWstr(settings.namePattern), !settings.caseInsensitive);
+		std::optional<TextSearcher> textSearcher;
+
+		if (!settings.text.empty())
+		{
+			try
+			{
+				textSearcher.emplace(utf8StrToWstr(settings.text), settings.useRegularExpressions,
+					settings.caseInsensitive);
+			}
+			catch (const std::invalid_argument &)
+			{
+				return { { { "error", "The regular expression is invalid" } }, false };
+			}
+		}
+
+		std::mutex resultsMutex;
+		std::vector<nlohmann::json> results;
+
+		auto addResult = [&resultsMutex, &results](nlohmann::json result) {
+			std::scoped_lock lock(resultsMutex);
+			results.push_back(std::move(result));
+		};
+
+		// As in the search dialog, the number of files read at once is limited to what suits the
+		// device when searching file contents.
+		int maxThreads = 0;
+
+		if (textSearcher)
+		{
+			maxThreads = GetStorageInfo(utf8StrToWstr(settings.folder)).ioSettings.parallelism;
+		}
+
+		ParallelWalk<SearchItem>::Run(SearchItem{ utf8StrToWstr(settings.folder), true },
+			[&](const SearchItem &item, ParallelWalk<SearchItem>::Worker &worker) {
+				if (!item.isFolder)
+				{
+					auto match = textSearcher->SearchFile(item.path, {});
+
+					if (match)
+					{
+						addResult({ { "path", wstrToUtf8Str(item.path) },
+							{ "lineNumber", match->lineNumber },
+							{ "line", wstrToUtf8Str(match->line) } });
+					}
+
+					return;
+				}
+
+				WIN32_FIND_DATA findData;
+				wil::unique_hfind findHandle(
+					FindFirstFileEx((std::filesystem::path(item.path) / L"*").c_str(),
+						FindExInfoBasic, &findData, FindExSearchNameMatch, nullptr,
+						FIND_FIRST_EX_LARGE_FETCH));
+
+				if (!findHandle)
+				{
+					return;
+				}
+
+				do
+				{
+					if (lstrcmp(findData.cFileName, L".") == 0
+						|| lstrcmp(findData.cFileName, L"..") == 0)
+					{
+						continue;
+					}
+
+					bool isFolder = WI_IsFlagSet(findData.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY);
+					std::wstring path = (std::filesystem::path(item.path) / findData.cFileName).wstring();
+
+					if (nameMatcher.Matches(findData.cFileName))
+					{
+						if (!textSearcher)
+						{
+							addResult({ { "path", wstrToUtf8Str(path) }, { "isFolder", isFolder } });
+						}
+						else if (!isFolder)
+						{
+							worker.AddItem({ path, false });
+						}
+					}
+
+					// As in the search dialog, reparse points aren't followed, since they can form
+					// cycles.
+					if (isFolder && !settings.noSubfolders
+						&& WI_IsFlagClear(findData.dwFileAttributes, FILE_ATTRIBUTE_REPARSE_POINT))
+					{
+						worker.AddItem({ std::move(path), true });
+					}
+				} while (FindNextFile(findHandle.get(), &findData));
+			},
+			{}, nullptr, ParallelWalk<SearchItem>::DEFAULT_PERIODIC_INTERVAL, maxThreads);
+
+		std::sort(results.begin(), results.end(),
+			[](const nlohmann::json &first, const nlohmann::json &second) {
+				return first["path"].get<std::string>() < second["path"].get<std::string>();
+			});
+
+		return { std::move(results), true };
+	}
+
+	// Standard output may be a console or (more typically, when run from a script) a file or pipe.
+	// In the latter case, the output is written as UTF-8.
+	void WriteOutput(const std::string &output)
+	{
+		HANDLE outputHandle = GetStdHandle(STD_OUTPUT_HANDLE);
+
+		if (!outputHandle || outputHandle == INVALID_HANDLE_VALUE)
+		{
+			return;
+		}
+
+		DWORD mode;
+
+		if (GetConsoleMode(outputHandle, &mode))
+		{
+			std::wstring wideOutput = utf8StrToWstr(output);
+			DWORD numWritten;
+			WriteConsole(outputHandle, wideOutput.c_str(), static_cast<DWORD>(wideOutput.size()),
+				&numWritten, nullptr);
+			return;
+		}
+
+		DWORD numWritten;
+		WriteFile(outputHandle, output.c_str(), static_cast<DWORD>(output.size()), &numWritten,
+			nullptr);
+	}
+}
+
+int BatchMode::Run(const std::vector<std::string> &args)
+{
+	CLI::App app("Runs a bulk operation without showing any windows. The results are written to "
+				 "standard output as JSON.");
+	app.require_subcommand(1);
+
+	// Allows the common options to appear after the name of the operation.
+	app.fallthrough();
+
+	CommonSettings commonSettings;
+	commonSettings.numJobs = (std::max)(static_cast<int>(std::thread::hardware_concurrency()), 1);
+	app.add_option("--jobs", commonSettings.numJobs,
+		"The maximum number of items to process at once (defaults to the number of processors)")
+		->check(CLI::PositiveNumber);
+
+	std::optional<BatchResult> result;
+
+	std::vector<std::string> hashPaths;
+	CLI::App *hashCommand = app.add_subcommand("hash", "Calculate the SHA-256 hash of each file");
+	hashCommand->add_option("files", hashPaths, "The files to hash")->required();
+	hashCommand->callback([&] { result = HashFiles(hashPaths, commonSettings); });
+
+	std::vector<std::string> folderSizePaths;
+	CLI::App *folderSizeCommand =
+		app.add_subcommand("folder-size", "Calculate the total size of each folder");
+	folderSizeCommand->add_option("folders", folderSizePaths, "The folders to measure")->required();
+	folderSizeCommand->callback(
+		[&] { result = CalculateFolderSizes(folderSizePaths, commonSettings); });
+
+	std::string listDirectory;
+	std::string listOutputFile;
+	auto listFormat = DirectoryListingFormatter::Format::Json;
+	bool listRecursive = false;
+	CLI::App *listCommand =
+		app.add_subcommand("list", "Save a listing of the contents of a folder to a file");
+	listCommand->add_option("folder", listDirectory, "The folder to list")->required();
+	listCommand->add_option("--output", listOutputFile, "The file to save the listing to")
+		->required();
+	listCommand->add_option("--format", listFormat, "The format of the listing")
+		->transform(CLI::CheckedTransformer(CLI::TransformPairs<DirectoryListingFormatter::Format>{
+			{ "text", DirectoryListingFormatter::Format::Text },
+			{ "csv", DirectoryListingFormatter::Format::Csv },
+			{ "json", DirectoryListingFormatter::Format::Json } }));
+	listCommand->add_flag("--recursive", listRecursive, "Include the contents of subfolders");
+	listCommand->callback([&] {
+		result = SaveDirectoryListing(listDirectory, listOutputFile, listFormat, listRecursive);
+	});
+
+	SearchSettings searchSettings;
+	CLI::App *searchCommand =
+		app.add_subcommand("search", "Search a folder for items by name and/or contents");
+	searchCommand->add_option("folder", searchSettings.folder, "The folder to search")
+		->required();
+	searchCommand->add_option("--name", searchSettings.namePattern,
+		"A wildcard pattern that item names must match");
+	searchCommand->add_option("--text", searchSettings.text, "Text that files must contain");
+	searchCommand->add_flag("--regex", searchSettings.useRegularExpressions,
+		"Treat the text as a regular expression");
+	searchCommand->add_flag(
+		"--case-insensitive", searchSettings.caseInsensitive, "Ignore case when matching");
+	searchCommand->add_flag(
+		"--no-subfolders", searchSettings.noSubfolders, "Don't search within subfolders");
+	searchCommand->callback([&] { result = Search(searchSettings); });
+
+	std::vector<std::string> deletePaths;
+	auto overwriteMethod = NFileOperations::OverwriteMethod::OnePass;
+	CLI::App *secureDeleteCommand = app.add_subcommand(
+		"secure-delete", "Overwrite, then delete, each file, so that it can't be recovered");
+	secureDeleteCommand->add_option("files", deletePaths, "The files to delete")->required();
+	secureDeleteCommand->add_option("--passes", overwriteMethod, "The number of overwrite passes")
+		->transform(CLI::CheckedTransformer(CLI::TransformPairs<NFileOperations::OverwriteMethod>{
+			{ "1", NFileOperations::OverwriteMethod::OnePass },
+			{ "3", NFileOperations::OverwriteMethod::ThreePass } }));
+	secureDeleteCommand->callback(
+		[&] { result = SecurelyDeleteFiles(deletePaths, overwriteMethod, commonSettings); });
+
+	// CLI11 expects the arguments in reverse order.
+	std::vector<std::string> reversedArgs(args.rbegin(), args.rend());
+
+	try
+	{
+		app.parse(reversedArgs);
+	}
+	catch (const CLI::ParseError &e)
+	{
+		return app.exit(e);
+	}
+
+	if (!result)
+	{
+		return EXIT_FAILURE;
+	}
+
+	WriteOutput(result->output.dump(2) + "\n");
+
+	return result->succeeded ? EXIT_SUCCESS : EXIT_FAILURE;
+}
\ No newline at end of file
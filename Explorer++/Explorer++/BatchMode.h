@@ -0,0 +1,25 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Runs one of the application's bulk operations (hashing, folder sizes, directory listings,
+// searches and secure deletion) directly from the command line, e.g.
+//
+// Explorer++.exe --batch hash --jobs 4 C:\file1 C:\file2
+//
+// No windows are created and none of the main window's state (settings, tabs, plugins, etc.) is
+// loaded, so an operation starts almost immediately. The results are written to standard output as
+// JSON.
+namespace BatchMode
+{
+	inline const wchar_t ARGUMENT[] = L"--batch";
+
+	// The arguments are those that follow ARGUMENT, in their original order. Returns the exit
+	// code for the process, which is EXIT_FAILURE if any item couldn't be processed.
+	int Run(const std::vector<std::string> &args);
+}
\ No newline at end of file
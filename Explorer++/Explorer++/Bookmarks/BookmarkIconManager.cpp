@@ -62,11 +62,11 @@ int BookmarkIconManager::GetIconForBookmark(const BookmarkItem *bookmark)
 {
 	int iconIndex = m_defaultFolderIconIndex;
 
-	auto cachedItr = m_expp->GetCachedIcons()->findByPath(bookmark->GetLocation());
+	auto cachedIconIndex = m_expp->GetCachedIcons()->findByPath(bookmark->GetLocation());
 
-	if (cachedItr != m_expp->GetCachedIcons()->end())
+	if (cachedIconIndex)
 	{
-		iconIndex = AddSystemIconToImageList(cachedItr->iconIndex);
+		iconIndex = AddSystemIconToImageList(*cachedIconIndex);
 	}
 	else if (m_callback)
 	{
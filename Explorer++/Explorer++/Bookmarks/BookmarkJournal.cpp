@@ -0,0 +1,454 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "Bookmarks/BookmarkJournal.h"
+#include "Bookmarks/BookmarkTree.h"
+#include "../ThirdParty/cereal/archives/binary.hpp"
+#include "../ThirdParty/cereal/types/string.hpp"
+#include "../ThirdParty/cereal/types/vector.hpp"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+
+// Each record is stored as its size, followed by the serialized record. A record that was only
+// partially written (e.g. because the application exited while it was being written) is detected
+// by its size and ignored, along with anything that follows it.
+using RecordSize = uint32_t;
+
+}
+
+template <class Archive>
+void serialize(Archive &archive, FILETIME &fileTime)
+{
+	archive(fileTime.dwLowDateTime, fileTime.dwHighDateTime);
+}
+
+template <class Archive>
+void BookmarkJournal::ItemEntry::serialize(Archive &archive)
+{
+	archive(guid, isFolder, name, location, dateCreated, dateModified, children);
+}
+
+template <class Archive>
+void BookmarkJournal::Record::serialize(Archive &archive)
+{
+	archive(sequenceNumber, type, parentGuid, index, item);
+}
+
+BookmarkJournal::BookmarkJournal(BookmarkTree *bookmarkTree, const std::wstring &filePath) :
+	m_bookmarkTree(bookmarkTree),
+	m_filePath(filePath)
+{
+	size_t validLength;
+	auto records = ReadRecordsFromFile(&validLength);
+
+	if (!records.empty())
+	{
+		m_lastSequenceNumber = records.back().sequenceNumber;
+	}
+
+	// Any partially written record is removed, so that it doesn't hide the records that are
+	// appended after it.
+	std::error_code errorCode;
+	auto fileSize = std::filesystem::file_size(m_filePath, errorCode);
+
+	if (!errorCode && fileSize > validLength)
+	{
+		std::filesystem::resize_file(m_filePath, validLength, errorCode);
+	}
+
+	m_connections.push_back(bookmarkTree->bookmarkItemAddedSignal.AddObserver(
+		std::bind_front(&BookmarkJournal::OnBookmarkItemAdded, this)));
+	m_connections.push_back(bookmarkTree->bookmarkItemUpdatedSignal.AddObserver(
+		std::bind_front(&BookmarkJournal::OnBookmarkItemUpdated, this)));
+	m_connections.push_back(bookmarkTree->bookmarkItemMovedSignal.AddObserver(
+		std::bind_front(&BookmarkJournal::OnBookmarkItemMoved, this)));
+	m_connections.push_back(bookmarkTree->bookmarkItemRemovedSignal.AddObserver(
+		std::bind_front(&BookmarkJournal::OnBookmarkItemRemoved, this)));
+}
+
+size_t BookmarkJournal::Replay()
+{
+	auto records = ReadRecordsFromFile();
+
+	m_replaying = true;
+
+	for (const auto &record : records)
+	{
+		ApplyRecord(record);
+	}
+
+	m_replaying = false;
+
+	return records.size();
+}
+
+uint64_t BookmarkJournal::GetLastSequenceNumber() const
+{
+	std::scoped_lock lock(m_mutex);
+	return m_lastSequenceNumber;
+}
+
+// The remaining records are written to a temporary file, which then replaces the journal, so that
+// the journal is left intact if the application exits part way through.
+bool BookmarkJournal::Compact(uint64_t sequenceNumber)
+{
+	std::scoped_lock lock(m_mutex);
+
+	std::ifstream inputStream(m_filePath, std::ios::binary);
+
+	if (!inputStream)
+	{
+		// There's nothing to compact.
+		return true;
+	}
+
+	std::stringstream stringstream;
+	stringstream << inputStream.rdbuf();
+	inputStream.close();
+
+	auto records = ReadRecords(stringstream.str());
+
+	if (records.empty() || records.front().sequenceNumber > sequenceNumber)
+	{
+		return true;
+	}
+
+	std::wstring tempFilePath = m_filePath + L".tmp";
+
+	{
+		std::ofstream outputStream(tempFilePath, std::ios::binary | std::ios::trunc);
+
+		if (!outputStream)
+		{
+			return false;
+		}
+
+		for (const auto &record : records)
+		{
+			if (record.sequenceNumber <= sequenceNumber)
+			{
+				continue;
+			}
+
+			std::string data = SerializeRecord(record);
+			outputStream.write(data.data(), data.size());
+		}
+
+		if (!outputStream.good())
+		{
+			return false;
+		}
+	}
+
+	return MoveFileEx(tempFilePath.c_str(), m_filePath.c_str(), MOVEFILE_REPLACE_EXISTING);
+}
+
+BookmarkJournal::ItemEntry BookmarkJournal::CaptureItem(
+	const BookmarkItem *bookmarkItem, bool includeChildren)
+{
+	ItemEntry itemEntry;
+	itemEntry.guid = bookmarkItem->GetGUID();
+	itemEntry.isFolder = bookmarkItem->IsFolder();
+	itemEntry.name = bookmarkItem->GetName();
+	itemEntry.dateCreated = bookmarkItem->GetDateCreated();
+	itemEntry.dateModified = bookmarkItem->GetDateModified();
+
+	if (bookmarkItem->IsBookmark())
+	{
+		itemEntry.location = bookmarkItem->GetLocation();
+	}
+
+	if (includeChildren)
+	{
+		for (const auto &child : bookmarkItem->GetChildren())
+		{
+			itemEntry.children.push_back(CaptureItem(child.get(), true));
+		}
+	}
+
+	return itemEntry;
+}
+
+std::string BookmarkJournal::SerializeRecord(const Record &record)
+{
+	std::stringstream recordStream;
+
+	{
+		cereal::BinaryOutputArchive outputArchive(recordStream);
+		outputArchive(record);
+	}
+
+	std::string recordData = recordStream.str();
+	auto size = static_cast<RecordSize>(recordData.size());
+
+	std::string data(reinterpret_cast<const char *>(&size), sizeof(size));
+	data += recordData;
+
+	return data;
+}
+
+std::vector<BookmarkJournal::Record> BookmarkJournal::ReadRecords(
+	const std::string &data, size_t *validLength)
+{
+	std::vector<Record> records;
+	size_t offset = 0;
+
+	if (validLength)
+	{
+		*validLength = 0;
+	}
+
+	while (data.size() - offset >= sizeof(RecordSize))
+	{
+		RecordSize size;
+		memcpy(&size, data.data() + offset, sizeof(size));
+
+		if (data.size() - offset - sizeof(size) < size)
+		{
+			break;
+		}
+
+		std::stringstream recordStream(data.substr(offset + sizeof(size), size));
+
+		// cereal reports malformed data by throwing.
+		try
+		{
+			cereal::BinaryInputArchive inputArchive(recordStream);
+
+			Record record;
+			inputArchive(record);
+			records.push_back(std::move(record));
+		}
+		catch (const std::exception &)
+		{
+			break;
+		}
+
+		offset += sizeof(size) + size;
+
+		if (validLength)
+		{
+			*validLength = offset;
+		}
+	}
+
+	return records;
+}
+
+std::vector<BookmarkJournal::Record> BookmarkJournal::ReadRecordsFromFile(
+	size_t *validLength) const
+{
+	std::scoped_lock lock(m_mutex);
+
+	if (validLength)
+	{
+		*validLength = 0;
+	}
+
+	std::ifstream stream(m_filePath, std::ios::binary);
+
+	if (!stream)
+	{
+		return {};
+	}
+
+	std::stringstream stringstream;
+	stringstream << stream.rdbuf();
+
+	return ReadRecords(stringstream.str(), validLength);
+}
+
+void BookmarkJournal::AppendRecord(Record &record)
+{
+	if (m_replaying)
+	{
+		return;
+	}
+
+	std::scoped_lock lock(m_mutex);
+
+	record.sequenceNumber = ++m_lastSequenceNumber;
+
+	std::ofstream stream(m_filePath, std::ios::binary | std::ios::app);
+
+	if (!stream)
+	{
+		return;
+	}
+
+	std::string data = SerializeRecord(record);
+	stream.write(data.data(), data.size());
+}
+
+void BookmarkJournal::ApplyRecord(const Record &record)
+{
+	switch (record.type)
+	{
+	case RecordType::Added:
+	{
+		BookmarkItem *parent = m_bookmarkTree->GetBookmarkItemById(record.parentGuid);
+
+		if (!parent || !parent->IsFolder() || !m_bookmarkTree->CanAddChildren(parent))
+		{
+			return;
+		}
+
+		RestoreItem(record.item, parent, static_cast<size_t>(record.index));
+	}
+	break;
+
+	case RecordType::Updated:
+	{
+		BookmarkItem *bookmarkItem = m_bookmarkTree->GetBookmarkItemById(record.item.guid);
+
+		if (!bookmarkItem || bookmarkItem->IsFolder() != record.item.isFolder)
+		{
+			return;
+		}
+
+		bookmarkItem->SetName(record.item.name);
+
+		if (bookmarkItem->IsBookmark())
+		{
+			bookmarkItem->SetLocation(record.item.location);
+		}
+
+		bookmarkItem->SetDateCreated(record.item.dateCreated);
+		bookmarkItem->SetDateModified(record.item.dateModified);
+	}
+	break;
+
+	case RecordType::Moved:
+	{
+		BookmarkItem *bookmarkItem = m_bookmarkTree->GetBookmarkItemById(record.item.guid);
+		BookmarkItem *newParent = m_bookmarkTree->GetBookmarkItemById(record.parentGuid);
+
+		if (!bookmarkItem || !newParent || !newParent->IsFolder()
+			|| m_bookmarkTree->IsPermanentNode(bookmarkItem)
+			|| !m_bookmarkTree->CanAddChildren(newParent)
+			|| IsSameOrAncestor(bookmarkItem, newParent))
+		{
+			return;
+		}
+
+		// The recorded index is the final position of the item. When moving an item within the
+		// same folder, MoveBookmarkItem() expects the index as it would be before the item is
+		// removed from its current position.
+		auto index = static_cast<size_t>(record.index);
+		BookmarkItem *currentParent = bookmarkItem->GetParent();
+
+		if (currentParent == newParent && currentParent->GetChildIndex(bookmarkItem) < index)
+		{
+			index++;
+		}
+
+		m_bookmarkTree->MoveBookmarkItem(bookmarkItem, newParent, index);
+	}
+	break;
+
+	case RecordType::Removed:
+	{
+		BookmarkItem *bookmarkItem = m_bookmarkTree->GetBookmarkItemById(record.item.guid);
+
+		if (!bookmarkItem || m_bookmarkTree->IsPermanentNode(bookmarkItem))
+		{
+			return;
+		}
+
+		m_bookmarkTree->RemoveBookmarkItem(bookmarkItem);
+	}
+	break;
+	}
+}
+
+// The dates are set once the children have been added, since adding a child updates the
+// modification date of the parent folder.
+void BookmarkJournal::RestoreItem(const ItemEntry &entry, BookmarkItem *parent, size_t index)
+{
+	if (m_bookmarkTree->GetBookmarkItemById(entry.guid))
+	{
+		return;
+	}
+
+	std::optional<std::wstring> location;
+
+	if (!entry.isFolder)
+	{
+		location = entry.location;
+	}
+
+	auto *bookmarkItem = m_bookmarkTree->AddBookmarkItem(
+		parent, std::make_unique<BookmarkItem>(entry.guid, entry.name, location), index);
+
+	for (const auto &childEntry : entry.children)
+	{
+		RestoreItem(childEntry, bookmarkItem, bookmarkItem->GetChildren().size());
+	}
+
+	bookmarkItem->SetDateCreated(entry.dateCreated);
+	bookmarkItem->SetDateModified(entry.dateModified);
+}
+
+bool BookmarkJournal::IsSameOrAncestor(
+	const BookmarkItem *ancestor, const BookmarkItem *bookmarkItem) const
+{
+	for (const BookmarkItem *current = bookmarkItem; current; current = current->GetParent())
+	{
+		if (current == ancestor)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void BookmarkJournal::OnBookmarkItemAdded(BookmarkItem &bookmarkItem, size_t index)
+{
+	Record record;
+	record.type = RecordType::Added;
+	record.parentGuid = bookmarkItem.GetParent()->GetGUID();
+	record.index = index;
+	record.item = CaptureItem(&bookmarkItem, true);
+	AppendRecord(record);
+}
+
+void BookmarkJournal::OnBookmarkItemUpdated(
+	BookmarkItem &bookmarkItem, BookmarkItem::PropertyType propertyType)
+{
+	UNREFERENCED_PARAMETER(propertyType);
+
+	Record record;
+	record.type = RecordType::Updated;
+	record.item = CaptureItem(&bookmarkItem, false);
+	AppendRecord(record);
+}
+
+void BookmarkJournal::OnBookmarkItemMoved(BookmarkItem *bookmarkItem,
+	const BookmarkItem *oldParent, size_t oldIndex, const BookmarkItem *newParent,
+	size_t newIndex)
+{
+	UNREFERENCED_PARAMETER(oldParent);
+	UNREFERENCED_PARAMETER(oldIndex);
+
+	Record record;
+	record.type = RecordType::Moved;
+	record.parentGuid = newParent->GetGUID();
+	record.index = newIndex;
+	record.item.guid = bookmarkItem->GetGUID();
+	AppendRecord(record);
+}
+
+void BookmarkJournal::OnBookmarkItemRemoved(const std::wstring &guid)
+{
+	Record record;
+	record.type = RecordType::Removed;
+	record.item.guid = guid;
+	AppendRecord(record);
+}
\ No newline at end of file
@@ -0,0 +1,104 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "Bookmarks/BookmarkItem.h"
+#include <boost/signals2.hpp>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class BookmarkTree;
+
+// An append-only log of the changes made to a bookmark tree. A small record is appended to the
+// journal file each time the tree changes, which is much cheaper than saving the entire tree. If the
+// application exits before the bookmarks are next saved, the changes can be recovered by replaying
+// the journal once the bookmarks have been loaded.
+//
+// Once the bookmarks have been saved in full, the records up to that point are redundant, and
+// compacting the journal removes them. Items are identified by their GUID when a record is
+// replayed, so replaying a record that's already reflected in the tree has no effect.
+class BookmarkJournal
+{
+public:
+	BookmarkJournal(BookmarkTree *bookmarkTree, const std::wstring &filePath);
+
+	// Applies the records in the journal file to the tree. Returns the number of records applied.
+	size_t Replay();
+
+	// Records are numbered consecutively. The numbering continues from the records already in the
+	// journal file when this instance was created.
+	uint64_t GetLastSequenceNumber() const;
+
+	// Removes the records up to and including the specified sequence number from the journal file.
+	// Can be called from a background thread.
+	bool Compact(uint64_t sequenceNumber);
+
+private:
+	enum class RecordType : uint8_t
+	{
+		Added = 0,
+		Updated = 1,
+		Moved = 2,
+		Removed = 3
+	};
+
+	struct ItemEntry
+	{
+		std::wstring guid;
+		bool isFolder = true;
+		std::wstring name;
+		std::wstring location;
+		FILETIME dateCreated = {};
+		FILETIME dateModified = {};
+		std::vector<ItemEntry> children;
+
+		template <class Archive>
+		void serialize(Archive &archive);
+	};
+
+	struct Record
+	{
+		uint64_t sequenceNumber = 0;
+		RecordType type = RecordType::Added;
+		std::wstring parentGuid;
+		uint64_t index = 0;
+		ItemEntry item;
+
+		template <class Archive>
+		void serialize(Archive &archive);
+	};
+
+	static ItemEntry CaptureItem(const BookmarkItem *bookmarkItem, bool includeChildren);
+	static std::string SerializeRecord(const Record &record);
+	static std::vector<Record> ReadRecords(
+		const std::string &data, size_t *validLength = nullptr);
+	std::vector<Record> ReadRecordsFromFile(size_t *validLength = nullptr) const;
+
+	void AppendRecord(Record &record);
+	void ApplyRecord(const Record &record);
+	void RestoreItem(const ItemEntry &entry, BookmarkItem *parent, size_t index);
+	bool IsSameOrAncestor(const BookmarkItem *ancestor, const BookmarkItem *bookmarkItem) const;
+
+	void OnBookmarkItemAdded(BookmarkItem &bookmarkItem, size_t index);
+	void OnBookmarkItemUpdated(BookmarkItem &bookmarkItem, BookmarkItem::PropertyType propertyType);
+	void OnBookmarkItemMoved(BookmarkItem *bookmarkItem, const BookmarkItem *oldParent,
+		size_t oldIndex, const BookmarkItem *newParent, size_t newIndex);
+	void OnBookmarkItemRemoved(const std::wstring &guid);
+
+	BookmarkTree *m_bookmarkTree;
+	const std::wstring m_filePath;
+
+	// Guards the journal file, which is appended to on the main thread and may be compacted on a
+	// background thread.
+	mutable std::mutex m_mutex;
+	uint64_t m_lastSequenceNumber = 0;
+
+	// Changes made while the journal is being replayed are already recorded.
+	bool m_replaying = false;
+
+	std::vector<boost::signals2::scoped_connection> m_connections;
+};
\ No newline at end of file
@@ -7,13 +7,21 @@
 #include "Bookmarks/BookmarkItem.h"
 #include "Bookmarks/BookmarkStorage.h"
 #include "Bookmarks/BookmarkTree.h"
+#include "../Helper/Helper.h"
 #include "../Helper/RegistrySettings.h"
+#include "../Helper/RegistryValueCache.h"
 #include <wil/resource.h>
 
 namespace V2
 {
 	const TCHAR bookmarksKeyPath[] = _T("Bookmarksv2");
 
+	// Identifies the process and tree state that the bookmarks key was last written from. Changes
+	// are only written incrementally on top of a state this process wrote itself.
+	const TCHAR saveStateValueName[] = _T("SaveState");
+
+	std::wstring BuildSaveState(uint64_t change);
+
 	void Load(HKEY parentKey, BookmarkTree *bookmarkTree);
 	void LoadPermanentFolder(HKEY parentKey, BookmarkTree *bookmarkTree, BookmarkItem *bookmarkItem,
 		const std::wstring &name);
@@ -26,6 +34,14 @@ namespace V2
 		HKEY parentKey, const BookmarkItem *bookmarkItem, const std::wstring &name);
 	void SaveBookmarkChildren(HKEY parentKey, const BookmarkItem *parentBookmarkItem);
 	void SaveBookmarkItem(HKEY key, const BookmarkItem *bookmarkItem);
+	void SaveBookmarkItemProperties(HKEY key, const BookmarkItem *bookmarkItem);
+
+	void SaveChanges(HKEY parentKey, const BookmarkTree *bookmarkTree, uint64_t lastSavedChange);
+	void SavePermanentFolderChanges(HKEY parentKey, const BookmarkTree *bookmarkTree,
+		const BookmarkItem *bookmarkItem, const std::wstring &name, uint64_t lastSavedChange);
+	void SaveBookmarkChildrenChanges(HKEY parentKey, const BookmarkTree *bookmarkTree,
+		const BookmarkItem *parentBookmarkItem, uint64_t lastSavedChange);
+	void DeleteBookmarkChildren(HKEY parentKey);
 }
 
 // Note that there's no ability to save bookmarks in the v1 format, as they will
@@ -127,6 +143,8 @@ void V2::LoadBookmarkChildren(
 
 std::unique_ptr<BookmarkItem> V2::LoadBookmarkItem(HKEY key, BookmarkTree *bookmarkTree)
 {
+	RegistryValueCache values(key);
+
 	DWORD type;
 	RegistrySettings::ReadDword(key, _T("Type"), &type);
 
@@ -226,6 +244,8 @@ void V1::LoadBookmarkChildren(
 std::unique_ptr<BookmarkItem> V1::LoadBookmarkItem(
 	HKEY key, BookmarkTree *bookmarkTree, bool &showOnToolbarOutput)
 {
+	RegistryValueCache values(key);
+
 	DWORD type;
 	RegistrySettings::ReadDword(key, _T("Type"), &type);
 
@@ -257,10 +277,31 @@ std::unique_ptr<BookmarkItem> V1::LoadBookmarkItem(
 	return bookmarkItem;
 }
 
-void BookmarkRegistryStorage::Save(
-	const std::wstring &applicationKeyPath, BookmarkTree *bookmarkTree)
+void BookmarkRegistryStorage::Save(const std::wstring &applicationKeyPath,
+	BookmarkTree *bookmarkTree, std::optional<uint64_t> lastSavedChange)
 {
 	std::wstring v2KeyPath = BuildFullKeyPath(applicationKeyPath, V2::bookmarksKeyPath);
+
+	if (lastSavedChange)
+	{
+		wil::unique_hkey bookmarksKey;
+		LONG res = RegOpenKeyEx(
+			HKEY_CURRENT_USER, v2KeyPath.c_str(), 0, KEY_READ | KEY_WRITE, &bookmarksKey);
+		std::wstring saveState;
+
+		if (res == ERROR_SUCCESS
+			&& RegistrySettings::ReadString(
+				   bookmarksKey.get(), V2::saveStateValueName, saveState)
+				== ERROR_SUCCESS
+			&& saveState == V2::BuildSaveState(*lastSavedChange))
+		{
+			V2::SaveChanges(bookmarksKey.get(), bookmarkTree, *lastSavedChange);
+			RegistrySettings::SaveString(bookmarksKey.get(), V2::saveStateValueName,
+				V2::BuildSaveState(bookmarkTree->GetChangeCounter()).c_str());
+			return;
+		}
+	}
+
 	SHDeleteKey(HKEY_CURRENT_USER, v2KeyPath.c_str());
 
 	wil::unique_hkey bookmarksKey;
@@ -270,9 +311,17 @@ void BookmarkRegistryStorage::Save(
 	if (res == ERROR_SUCCESS)
 	{
 		V2::Save(bookmarksKey.get(), bookmarkTree);
+		RegistrySettings::SaveString(bookmarksKey.get(), V2::saveStateValueName,
+			V2::BuildSaveState(bookmarkTree->GetChangeCounter()).c_str());
 	}
 }
 
+std::wstring V2::BuildSaveState(uint64_t change)
+{
+	static const std::wstring sessionId = CreateGUID();
+	return sessionId + L":" + std::to_wstring(change);
+}
+
 void V2::Save(HKEY parentKey, BookmarkTree *bookmarkTree)
 {
 	SavePermanentFolder(parentKey, bookmarkTree->GetBookmarksToolbarFolder(),
@@ -321,6 +370,16 @@ void V2::SaveBookmarkChildren(HKEY parentKey, const BookmarkItem *parentBookmark
 }
 
 void V2::SaveBookmarkItem(HKEY key, const BookmarkItem *bookmarkItem)
+{
+	SaveBookmarkItemProperties(key, bookmarkItem);
+
+	if (bookmarkItem->GetType() == BookmarkItem::Type::Folder)
+	{
+		SaveBookmarkChildren(key, bookmarkItem);
+	}
+}
+
+void V2::SaveBookmarkItemProperties(HKEY key, const BookmarkItem *bookmarkItem)
 {
 	RegistrySettings::SaveDword(key, _T("Type"), static_cast<int>(bookmarkItem->GetType()));
 	RegistrySettings::SaveString(key, _T("GUID"), bookmarkItem->GetGUID().c_str());
@@ -333,10 +392,99 @@ void V2::SaveBookmarkItem(HKEY key, const BookmarkItem *bookmarkItem)
 
 	RegistrySettings::SaveDateTime(key, _T("DateCreated"), bookmarkItem->GetDateCreated());
 	RegistrySettings::SaveDateTime(key, _T("DateModified"), bookmarkItem->GetDateModified());
+}
 
-	if (bookmarkItem->GetType() == BookmarkItem::Type::Folder)
+void V2::SaveChanges(HKEY parentKey, const BookmarkTree *bookmarkTree, uint64_t lastSavedChange)
+{
+	SavePermanentFolderChanges(parentKey, bookmarkTree, bookmarkTree->GetBookmarksToolbarFolder(),
+		BookmarkStorage::BOOKMARKS_TOOLBAR_NODE_NAME, lastSavedChange);
+	SavePermanentFolderChanges(parentKey, bookmarkTree, bookmarkTree->GetBookmarksMenuFolder(),
+		BookmarkStorage::BOOKMARKS_MENU_NODE_NAME, lastSavedChange);
+	SavePermanentFolderChanges(parentKey, bookmarkTree, bookmarkTree->GetOtherBookmarksFolder(),
+		BookmarkStorage::OTHER_BOOKMARKS_NODE_NAME, lastSavedChange);
+}
+
+void V2::SavePermanentFolderChanges(HKEY parentKey, const BookmarkTree *bookmarkTree,
+	const BookmarkItem *bookmarkItem, const std::wstring &name, uint64_t lastSavedChange)
+{
+	if (bookmarkTree->GetPropertiesChange(bookmarkItem) <= lastSavedChange
+		&& bookmarkTree->GetSubtreeChange(bookmarkItem) <= lastSavedChange)
 	{
-		SaveBookmarkChildren(key, bookmarkItem);
+		return;
+	}
+
+	wil::unique_hkey childKey;
+	LONG res = RegCreateKeyEx(parentKey, name.c_str(), 0, nullptr, REG_OPTION_NON_VOLATILE,
+		KEY_READ | KEY_WRITE, nullptr, &childKey, nullptr);
+
+	if (res == ERROR_SUCCESS)
+	{
+		RegistrySettings::SaveDateTime(
+			childKey.get(), _T("DateCreated"), bookmarkItem->GetDateCreated());
+		RegistrySettings::SaveDateTime(
+			childKey.get(), _T("DateModified"), bookmarkItem->GetDateModified());
+
+		SaveBookmarkChildrenChanges(childKey.get(), bookmarkTree, bookmarkItem, lastSavedChange);
+	}
+}
+
+// Child keys are named after the index of the child, so any change to the set of children requires
+// all of them to be rewritten. Otherwise, only the children that have been modified are visited.
+void V2::SaveBookmarkChildrenChanges(HKEY parentKey, const BookmarkTree *bookmarkTree,
+	const BookmarkItem *parentBookmarkItem, uint64_t lastSavedChange)
+{
+	if (bookmarkTree->GetChildrenChange(parentBookmarkItem) > lastSavedChange)
+	{
+		DeleteBookmarkChildren(parentKey);
+		SaveBookmarkChildren(parentKey, parentBookmarkItem);
+		return;
+	}
+
+	if (bookmarkTree->GetSubtreeChange(parentBookmarkItem) <= lastSavedChange)
+	{
+		return;
+	}
+
+	int index = 0;
+
+	for (auto &child : parentBookmarkItem->GetChildren())
+	{
+		bool propertiesChanged = bookmarkTree->GetPropertiesChange(child.get()) > lastSavedChange;
+		bool subtreeChanged = child->IsFolder()
+			&& bookmarkTree->GetSubtreeChange(child.get()) > lastSavedChange;
+
+		if (propertiesChanged || subtreeChanged)
+		{
+			wil::unique_hkey childKey;
+			LONG res = RegCreateKeyEx(parentKey, std::to_wstring(index).c_str(), 0, nullptr,
+				REG_OPTION_NON_VOLATILE, KEY_READ | KEY_WRITE, nullptr, &childKey, nullptr);
+
+			if (res == ERROR_SUCCESS)
+			{
+				if (propertiesChanged)
+				{
+					SaveBookmarkItemProperties(childKey.get(), child.get());
+				}
+
+				if (subtreeChanged)
+				{
+					SaveBookmarkChildrenChanges(
+						childKey.get(), bookmarkTree, child.get(), lastSavedChange);
+				}
+			}
+		}
+
+		index++;
+	}
+}
+
+void V2::DeleteBookmarkChildren(HKEY parentKey)
+{
+	int index = 0;
+
+	while (SHDeleteKey(parentKey, std::to_wstring(index).c_str()) == ERROR_SUCCESS)
+	{
+		index++;
 	}
 }
 
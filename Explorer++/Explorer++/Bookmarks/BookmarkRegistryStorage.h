@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <cstdint>
+#include <optional>
 #include <string>
 
 class BookmarkTree;
@@ -11,5 +13,11 @@ class BookmarkTree;
 namespace BookmarkRegistryStorage
 {
 void Load(const std::wstring &applicationKeyPath, BookmarkTree *bookmarkTree);
-void Save(const std::wstring &applicationKeyPath, BookmarkTree *bookmarkTree);
+
+// If lastSavedChange is provided (see BookmarkTree::GetChangeCounter()) and the registry still
+// contains the tree as this process saved it at that point, only the parts of the tree that have
+// been modified since are rewritten. Otherwise (e.g. if another instance has saved its bookmarks
+// in the meantime), the bookmarks key is rewritten in full.
+void Save(const std::wstring &applicationKeyPath, BookmarkTree *bookmarkTree,
+	std::optional<uint64_t> lastSavedChange = std::nullopt);
 }
\ No newline at end of file
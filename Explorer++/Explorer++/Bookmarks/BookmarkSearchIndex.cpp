@@ -0,0 +1,278 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "Bookmarks/BookmarkSearchIndex.h"
+#include "Bookmarks/BookmarkTree.h"
+#include <algorithm>
+#include <iterator>
+
+BookmarkSearchIndex::BookmarkSearchIndex(BookmarkTree *bookmarkTree)
+{
+	// The root folder is never shown, so there's no reason to return it in any results.
+	for (auto &child : bookmarkTree->GetRoot()->GetChildren())
+	{
+		AddItemRecursive(child.get());
+	}
+
+	m_connections.push_back(bookmarkTree->bookmarkItemAddedSignal.AddObserver(
+		std::bind_front(&BookmarkSearchIndex::OnBookmarkItemAdded, this)));
+	m_connections.push_back(bookmarkTree->bookmarkItemUpdatedSignal.AddObserver(
+		std::bind_front(&BookmarkSearchIndex::OnBookmarkItemUpdated, this)));
+	m_connections.push_back(bookmarkTree->bookmarkItemPreRemovalSignal.AddObserver(
+		std::bind_front(&BookmarkSearchIndex::OnBookmarkItemPreRemoval, this)));
+}
+
+std::vector<BookmarkItem *> BookmarkSearchIndex::Search(
+	std::wstring_view text, size_t maxResults) const
+{
+	std::wstring foldedText = FoldCase(text);
+
+	if (foldedText.empty())
+	{
+		return {};
+	}
+
+	std::vector<BookmarkItem *> namePrefixMatches;
+	std::vector<BookmarkItem *> nameMatches;
+	std::vector<BookmarkItem *> locationMatches;
+
+	for (ItemId id : GetCandidates(foldedText))
+	{
+		const IndexedItem &indexedItem = *m_items[id];
+		auto namePosition = indexedItem.name.find(foldedText);
+
+		if (namePosition == 0)
+		{
+			namePrefixMatches.push_back(indexedItem.bookmarkItem);
+		}
+		else if (namePosition != std::wstring::npos)
+		{
+			nameMatches.push_back(indexedItem.bookmarkItem);
+		}
+		else if (indexedItem.location.find(foldedText) != std::wstring::npos)
+		{
+			locationMatches.push_back(indexedItem.bookmarkItem);
+		}
+
+		// Items in the first group will always be returned ahead of everything else, so there's no
+		// need to check any more candidates once that group is full.
+		if (namePrefixMatches.size() >= maxResults)
+		{
+			break;
+		}
+	}
+
+	std::vector<BookmarkItem *> results = std::move(namePrefixMatches);
+	results.insert(results.end(), nameMatches.begin(), nameMatches.end());
+	results.insert(results.end(), locationMatches.begin(), locationMatches.end());
+
+	if (results.size() > maxResults)
+	{
+		results.resize(maxResults);
+	}
+
+	return results;
+}
+
+// Returns the IDs of the items that could potentially contain the specified text. That's every item
+// that contains all of the trigrams in the text, or every item, if the text is too short to contain
+// any trigrams. The IDs are returned in ascending order.
+std::vector<BookmarkSearchIndex::ItemId> BookmarkSearchIndex::GetCandidates(
+	std::wstring_view foldedText) const
+{
+	std::vector<ItemId> candidates;
+	auto trigrams = GetTrigrams(foldedText);
+
+	if (trigrams.empty())
+	{
+		for (ItemId id = 0; id < m_items.size(); id++)
+		{
+			if (m_items[id])
+			{
+				candidates.push_back(id);
+			}
+		}
+
+		return candidates;
+	}
+
+	std::vector<const std::vector<ItemId> *> postings;
+
+	for (Trigram trigram : trigrams)
+	{
+		auto itr = m_postings.find(trigram);
+
+		if (itr == m_postings.end())
+		{
+			return {};
+		}
+
+		postings.push_back(&itr->second);
+	}
+
+	// Starting with the shortest list keeps the intermediate results as small as possible.
+	std::sort(postings.begin(), postings.end(),
+		[](const auto *first, const auto *second) { return first->size() < second->size(); });
+
+	candidates = *postings[0];
+
+	for (size_t i = 1; i < postings.size() && !candidates.empty(); i++)
+	{
+		std::vector<ItemId> intersection;
+		std::set_intersection(candidates.begin(), candidates.end(), postings[i]->begin(),
+			postings[i]->end(), std::back_inserter(intersection));
+		candidates = std::move(intersection);
+	}
+
+	return candidates;
+}
+
+std::wstring BookmarkSearchIndex::FoldCase(std::wstring_view text)
+{
+	std::wstring foldedText(text);
+
+	if (!foldedText.empty())
+	{
+		CharLowerBuff(foldedText.data(), static_cast<DWORD>(foldedText.size()));
+	}
+
+	return foldedText;
+}
+
+// Returns the unique trigrams in the specified text, in sorted order.
+std::vector<BookmarkSearchIndex::Trigram> BookmarkSearchIndex::GetTrigrams(std::wstring_view text)
+{
+	std::vector<Trigram> trigrams;
+
+	for (size_t i = 0; i + 3 <= text.size(); i++)
+	{
+		Trigram trigram = (static_cast<Trigram>(static_cast<uint16_t>(text[i])) << 32)
+			| (static_cast<Trigram>(static_cast<uint16_t>(text[i + 1])) << 16)
+			| static_cast<Trigram>(static_cast<uint16_t>(text[i + 2]));
+		trigrams.push_back(trigram);
+	}
+
+	std::sort(trigrams.begin(), trigrams.end());
+	trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+	return trigrams;
+}
+
+std::vector<BookmarkSearchIndex::Trigram> BookmarkSearchIndex::GetItemTrigrams(
+	const IndexedItem &indexedItem)
+{
+	auto trigrams = GetTrigrams(indexedItem.name);
+	auto locationTrigrams = GetTrigrams(indexedItem.location);
+
+	std::vector<Trigram> allTrigrams;
+	std::set_union(trigrams.begin(), trigrams.end(), locationTrigrams.begin(),
+		locationTrigrams.end(), std::back_inserter(allTrigrams));
+
+	return allTrigrams;
+}
+
+void BookmarkSearchIndex::AddItemRecursive(BookmarkItem *bookmarkItem)
+{
+	bookmarkItem->VisitRecursively([this](BookmarkItem *currentItem) { AddItem(currentItem); });
+}
+
+void BookmarkSearchIndex::AddItem(BookmarkItem *bookmarkItem)
+{
+	assert(!m_itemIds.contains(bookmarkItem));
+
+	ItemId id;
+
+	if (!m_freeIds.empty())
+	{
+		id = m_freeIds.back();
+		m_freeIds.pop_back();
+	}
+	else
+	{
+		id = static_cast<ItemId>(m_items.size());
+		m_items.emplace_back();
+	}
+
+	IndexedItem indexedItem;
+	indexedItem.bookmarkItem = bookmarkItem;
+	indexedItem.name = FoldCase(bookmarkItem->GetName());
+
+	if (bookmarkItem->IsBookmark())
+	{
+		indexedItem.location = FoldCase(bookmarkItem->GetLocation());
+	}
+
+	for (Trigram trigram : GetItemTrigrams(indexedItem))
+	{
+		auto &posting = m_postings[trigram];
+		posting.insert(std::upper_bound(posting.begin(), posting.end(), id), id);
+	}
+
+	m_items[id] = std::move(indexedItem);
+	m_itemIds.insert({ bookmarkItem, id });
+}
+
+void BookmarkSearchIndex::RemoveItemRecursive(BookmarkItem *bookmarkItem)
+{
+	bookmarkItem->VisitRecursively([this](BookmarkItem *currentItem) { RemoveItem(currentItem); });
+}
+
+void BookmarkSearchIndex::RemoveItem(const BookmarkItem *bookmarkItem)
+{
+	auto itr = m_itemIds.find(bookmarkItem);
+
+	if (itr == m_itemIds.end())
+	{
+		assert(false);
+		return;
+	}
+
+	ItemId id = itr->second;
+
+	for (Trigram trigram : GetItemTrigrams(*m_items[id]))
+	{
+		auto postingItr = m_postings.find(trigram);
+		assert(postingItr != m_postings.end());
+
+		auto &posting = postingItr->second;
+		auto idItr = std::lower_bound(posting.begin(), posting.end(), id);
+		assert(idItr != posting.end() && *idItr == id);
+		posting.erase(idItr);
+
+		if (posting.empty())
+		{
+			m_postings.erase(postingItr);
+		}
+	}
+
+	m_items[id].reset();
+	m_freeIds.push_back(id);
+	m_itemIds.erase(itr);
+}
+
+void BookmarkSearchIndex::OnBookmarkItemAdded(BookmarkItem &bookmarkItem, size_t index)
+{
+	UNREFERENCED_PARAMETER(index);
+
+	AddItemRecursive(&bookmarkItem);
+}
+
+void BookmarkSearchIndex::OnBookmarkItemUpdated(
+	BookmarkItem &bookmarkItem, BookmarkItem::PropertyType propertyType)
+{
+	if (propertyType != BookmarkItem::PropertyType::Name
+		&& propertyType != BookmarkItem::PropertyType::Location)
+	{
+		return;
+	}
+
+	RemoveItem(&bookmarkItem);
+	AddItem(&bookmarkItem);
+}
+
+void BookmarkSearchIndex::OnBookmarkItemPreRemoval(BookmarkItem &bookmarkItem)
+{
+	RemoveItemRecursive(&bookmarkItem);
+}
\ No newline at end of file
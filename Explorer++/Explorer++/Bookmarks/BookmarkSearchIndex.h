@@ -0,0 +1,69 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "Bookmarks/BookmarkItem.h"
+#include <boost/signals2.hpp>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+class BookmarkTree;
+
+// Allows bookmarks and bookmark folders to be found by searching for text within their name or
+// location. Each item is indexed by the trigrams (sequences of three characters) its name and
+// location contain, so a query only has to examine the items that contain every trigram in the
+// query text, rather than every item in the tree. The index is built from the tree on construction
+// and then kept up to date as items are added, updated and removed.
+class BookmarkSearchIndex
+{
+public:
+	BookmarkSearchIndex(BookmarkTree *bookmarkTree);
+
+	// Returns the items whose name or location contains the specified text. The comparison is
+	// case-insensitive. Items whose name starts with the text are returned first, followed by items
+	// whose name otherwise contains the text, followed by items where only the location matches.
+	std::vector<BookmarkItem *> Search(std::wstring_view text,
+		size_t maxResults = (std::numeric_limits<size_t>::max)()) const;
+
+private:
+	using ItemId = uint32_t;
+	using Trigram = uint64_t;
+
+	struct IndexedItem
+	{
+		BookmarkItem *bookmarkItem;
+		std::wstring name;
+		std::wstring location;
+	};
+
+	static std::wstring FoldCase(std::wstring_view text);
+	static std::vector<Trigram> GetTrigrams(std::wstring_view text);
+	static std::vector<Trigram> GetItemTrigrams(const IndexedItem &indexedItem);
+
+	void AddItemRecursive(BookmarkItem *bookmarkItem);
+	void AddItem(BookmarkItem *bookmarkItem);
+	void RemoveItemRecursive(BookmarkItem *bookmarkItem);
+	void RemoveItem(const BookmarkItem *bookmarkItem);
+	std::vector<ItemId> GetCandidates(std::wstring_view foldedText) const;
+
+	void OnBookmarkItemAdded(BookmarkItem &bookmarkItem, size_t index);
+	void OnBookmarkItemUpdated(BookmarkItem &bookmarkItem, BookmarkItem::PropertyType propertyType);
+	void OnBookmarkItemPreRemoval(BookmarkItem &bookmarkItem);
+
+	// Indexed by item ID. IDs of removed items are reused.
+	std::vector<std::optional<IndexedItem>> m_items;
+	std::vector<ItemId> m_freeIds;
+	std::unordered_map<const BookmarkItem *, ItemId> m_itemIds;
+
+	// Maps each trigram to the sorted list of items that contain it.
+	std::unordered_map<Trigram, std::vector<ItemId>> m_postings;
+
+	std::vector<boost::signals2::scoped_connection> m_connections;
+};
\ No newline at end of file
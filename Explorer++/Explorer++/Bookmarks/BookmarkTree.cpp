@@ -30,6 +30,10 @@ BookmarkTree::BookmarkTree() :
 		std::nullopt);
 	m_otherBookmarks = otherBookmarksFolder.get();
 	m_root.AddChild(std::move(otherBookmarksFolder));
+
+	m_root.VisitRecursively([this](BookmarkItem *currentItem) {
+		m_guidIndex.insert({ currentItem->GetGUID(), currentItem });
+	});
 }
 
 BookmarkItem *BookmarkTree::GetRoot()
@@ -85,6 +89,10 @@ BookmarkItem *BookmarkTree::AddBookmarkItem(
 			currentItem->updatedSignal.AddObserver(
 				std::bind_front(&BookmarkTree::OnBookmarkItemUpdated, this),
 				boost::signals2::at_front);
+
+		[[maybe_unused]] auto [itr, inserted] =
+			m_guidIndex.insert({ currentItem->GetGUID(), currentItem });
+		assert(inserted);
 	});
 
 	if (index > parent->GetChildren().size())
@@ -93,6 +101,8 @@ BookmarkItem *BookmarkTree::AddBookmarkItem(
 	}
 
 	BookmarkItem *rawBookmarkItem = parent->AddChild(std::move(bookmarkItem), index);
+	RecordChildrenChange(parent);
+
 	bookmarkItemAddedSignal.m_signal(*rawBookmarkItem, index);
 
 	return rawBookmarkItem;
@@ -128,6 +138,9 @@ void BookmarkTree::MoveBookmarkItem(
 	auto item = oldParent->RemoveChild(oldIndex);
 	newParent->AddChild(std::move(item), index);
 
+	RecordChildrenChange(oldParent);
+	RecordChildrenChange(newParent);
+
 	bookmarkItemMovedSignal.m_signal(bookmarkItem, oldParent, oldIndex, newParent, index);
 }
 
@@ -146,17 +159,119 @@ void BookmarkTree::RemoveBookmarkItem(BookmarkItem *bookmarkItem)
 
 	std::wstring guid = bookmarkItem->GetGUID();
 
+	bookmarkItem->VisitRecursively([this](BookmarkItem *currentItem) {
+		m_guidIndex.erase(currentItem->GetGUID());
+		m_changeRecords.erase(currentItem);
+	});
+
 	size_t childIndex = parent->GetChildIndex(bookmarkItem);
 	parent->RemoveChild(childIndex);
+	RecordChildrenChange(parent);
+
 	bookmarkItemRemovedSignal.m_signal(guid);
 }
 
+BookmarkItem *BookmarkTree::GetBookmarkItemById(std::wstring_view guid)
+{
+	auto itr = m_guidIndex.find(guid);
+
+	if (itr == m_guidIndex.end())
+	{
+		return nullptr;
+	}
+
+	return itr->second;
+}
+
+const BookmarkItem *BookmarkTree::GetBookmarkItemById(std::wstring_view guid) const
+{
+	auto itr = m_guidIndex.find(guid);
+
+	if (itr == m_guidIndex.end())
+	{
+		return nullptr;
+	}
+
+	return itr->second;
+}
+
 void BookmarkTree::OnBookmarkItemUpdated(
 	BookmarkItem &bookmarkItem, BookmarkItem::PropertyType propertyType)
 {
+	RecordPropertiesChange(&bookmarkItem);
+
 	bookmarkItemUpdatedSignal.m_signal(bookmarkItem, propertyType);
 }
 
+uint64_t BookmarkTree::GetChangeCounter() const
+{
+	return m_changeCounter;
+}
+
+uint64_t BookmarkTree::GetPropertiesChange(const BookmarkItem *bookmarkItem) const
+{
+	const ChangeRecord *changeRecord = GetChangeRecord(bookmarkItem);
+	return changeRecord ? changeRecord->propertiesChange : 0;
+}
+
+uint64_t BookmarkTree::GetChildrenChange(const BookmarkItem *bookmarkItem) const
+{
+	const ChangeRecord *changeRecord = GetChangeRecord(bookmarkItem);
+	return changeRecord ? changeRecord->childrenChange : 0;
+}
+
+uint64_t BookmarkTree::GetSubtreeChange(const BookmarkItem *bookmarkItem) const
+{
+	const ChangeRecord *changeRecord = GetChangeRecord(bookmarkItem);
+	return changeRecord ? changeRecord->subtreeChange : 0;
+}
+
+const BookmarkTree::ChangeRecord *BookmarkTree::GetChangeRecord(
+	const BookmarkItem *bookmarkItem) const
+{
+	auto itr = m_changeRecords.find(bookmarkItem);
+
+	if (itr == m_changeRecords.end())
+	{
+		return nullptr;
+	}
+
+	return &itr->second;
+}
+
+// The properties of an item are stored alongside the item itself, so a change to them is also a
+// change within the subtree of each of the item's ancestors.
+void BookmarkTree::RecordPropertiesChange(const BookmarkItem *bookmarkItem)
+{
+	m_changeCounter++;
+	m_changeRecords[bookmarkItem].propertiesChange = m_changeCounter;
+
+	if (bookmarkItem->GetParent())
+	{
+		PropagateSubtreeChange(bookmarkItem->GetParent());
+	}
+}
+
+// Changing the children of a folder also updates the folder's modification date.
+void BookmarkTree::RecordChildrenChange(const BookmarkItem *folder)
+{
+	m_changeCounter++;
+
+	auto &changeRecord = m_changeRecords[folder];
+	changeRecord.childrenChange = m_changeCounter;
+	changeRecord.propertiesChange = m_changeCounter;
+
+	PropagateSubtreeChange(folder);
+}
+
+void BookmarkTree::PropagateSubtreeChange(const BookmarkItem *folder)
+{
+	for (const BookmarkItem *current = folder; current; current = current->GetParent())
+	{
+		m_changeRecords[current].subtreeChange = m_changeCounter;
+	}
+}
+
 bool BookmarkTree::CanAddChildren(const BookmarkItem *bookmarkItem) const
 {
 	return bookmarkItem != &m_root;
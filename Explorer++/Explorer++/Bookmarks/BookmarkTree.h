@@ -7,6 +7,8 @@
 #include "Bookmarks/BookmarkItem.h"
 #include "SignalWrapper.h"
 #include <tchar.h>
+#include <string_view>
+#include <unordered_map>
 
 class BookmarkTree
 {
@@ -21,6 +23,11 @@ public:
 	BookmarkItem *GetOtherBookmarksFolder();
 	const BookmarkItem *GetOtherBookmarksFolder() const;
 
+	// Returns the item with the specified GUID, or null if there's no such item in the tree. This
+	// is a constant time operation, regardless of the size of the tree.
+	BookmarkItem *GetBookmarkItemById(std::wstring_view guid);
+	const BookmarkItem *GetBookmarkItemById(std::wstring_view guid) const;
+
 	bool CanAddChildren(const BookmarkItem *bookmarkItem) const;
 	bool IsPermanentNode(const BookmarkItem *bookmarkItem) const;
 
@@ -29,6 +36,24 @@ public:
 	void MoveBookmarkItem(BookmarkItem *bookmarkItem, BookmarkItem *newParent, size_t index);
 	void RemoveBookmarkItem(BookmarkItem *bookmarkItem);
 
+	// Change tracking. Each modification to the tree increments the change counter and is
+	// recorded against the items it affects, so that a storage implementation can compare the
+	// values below with the counter value at the time it last saved and only rewrite the parts of
+	// the tree that have since been modified. Items that haven't been modified since they were
+	// added to the tree report a value of 0.
+	uint64_t GetChangeCounter() const;
+
+	// The last change to the item's own properties (e.g. its name or location). That includes the
+	// modification date of a folder, which changes whenever its children change.
+	uint64_t GetPropertiesChange(const BookmarkItem *bookmarkItem) const;
+
+	// The last change to the set or order of the folder's direct children.
+	uint64_t GetChildrenChange(const BookmarkItem *bookmarkItem) const;
+
+	// The last change to any item below the folder (including changes to the set of children of
+	// the folder itself).
+	uint64_t GetSubtreeChange(const BookmarkItem *bookmarkItem) const;
+
 	// Signals
 	SignalWrapper<BookmarkTree, void(BookmarkItem &bookmarkItem, size_t index)>
 		bookmarkItemAddedSignal;
@@ -50,9 +75,44 @@ private:
 	static inline const TCHAR *MENU_FOLDER_GUID = _T("00000000-0000-0000-0000-000000000003");
 	static inline const TCHAR *OTHER_FOLDER_GUID = _T("00000000-0000-0000-0000-000000000004");
 
+	// Allows the index to be queried with a std::wstring_view, without having to construct a
+	// std::wstring first.
+	struct GuidHash
+	{
+		using is_transparent = void;
+
+		size_t operator()(std::wstring_view guid) const
+		{
+			return std::hash<std::wstring_view>{}(guid);
+		}
+	};
+
+	struct ChangeRecord
+	{
+		uint64_t propertiesChange = 0;
+		uint64_t childrenChange = 0;
+		uint64_t subtreeChange = 0;
+	};
+
 	void OnBookmarkItemUpdated(BookmarkItem &bookmarkItem, BookmarkItem::PropertyType propertyType);
 
+	void RecordPropertiesChange(const BookmarkItem *bookmarkItem);
+	void RecordChildrenChange(const BookmarkItem *folder);
+	void PropagateSubtreeChange(const BookmarkItem *folder);
+	const ChangeRecord *GetChangeRecord(const BookmarkItem *bookmarkItem) const;
+
 	BookmarkItem m_root;
+
+	// Maps the GUID of every item in the tree (including the permanent folders) to the item
+	// itself. Updated whenever items are added to or removed from the tree. Moving an item doesn't
+	// affect the index, since the item itself remains the same.
+	std::unordered_map<std::wstring, BookmarkItem *, GuidHash, std::equal_to<>> m_guidIndex;
+
+	// Only items that have been modified since being added have an entry here. Entries are
+	// removed along with the items they refer to.
+	uint64_t m_changeCounter = 0;
+	std::unordered_map<const BookmarkItem *, ChangeRecord> m_changeRecords;
+
 	BookmarkItem *m_bookmarksToolbar;
 	BookmarkItem *m_bookmarksMenu;
 	BookmarkItem *m_otherBookmarks;
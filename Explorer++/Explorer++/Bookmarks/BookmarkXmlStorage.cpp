@@ -8,6 +8,7 @@
 #include "Bookmarks/BookmarkStorage.h"
 #include "Bookmarks/BookmarkTree.h"
 #include "../Helper/XMLSettings.h"
+#include "../Helper/XmlStreamReader.h"
 #include <wil/com.h>
 
 namespace V2
@@ -21,6 +22,10 @@ void LoadBookmarkChildren(
 	IXMLDOMNode *parentNode, BookmarkTree *bookmarkTree, BookmarkItem *parentBookmarkItem);
 std::unique_ptr<BookmarkItem> LoadBookmarkItem(IXMLDOMNode *parentNode, BookmarkTree *bookmarkTree);
 
+bool Load(XmlStreamReader *reader, BookmarkTree *bookmarkTree);
+BookmarkItem *GetPermanentFolder(BookmarkTree *bookmarkTree, const std::wstring &name);
+std::unique_ptr<BookmarkItem> LoadBookmarkItem(const XmlStreamReader::Element &element);
+
 void Save(IXMLDOMDocument *xmlDocument, IXMLDOMElement *parentNode, BookmarkTree *bookmarkTree,
 	int indent);
 void SavePermanentFolder(IXMLDOMDocument *xmlDocument, IXMLDOMElement *parentNode,
@@ -40,6 +45,16 @@ void LoadBookmarkChildren(
 	IXMLDOMNode *parentNode, BookmarkTree *bookmarkTree, BookmarkItem *parentBookmarkItem);
 std::unique_ptr<BookmarkItem> LoadBookmarkItem(
 	IXMLDOMNode *parentNode, BookmarkTree *bookmarkTree, bool &showOnToolbarOutput);
+
+bool Load(XmlStreamReader *reader, BookmarkTree *bookmarkTree);
+std::unique_ptr<BookmarkItem> LoadBookmarkItem(
+	const XmlStreamReader::Element &element, bool &showOnToolbarOutput);
+}
+
+namespace
+{
+std::wstring GetAttribute(const XmlStreamReader::Element &element, std::wstring_view name);
+void ReadDates(const XmlStreamReader::Element &element, BookmarkItem *bookmarkItem);
 }
 
 void BookmarkXmlStorage::Load(IXMLDOMDocument *xmlDocument, BookmarkTree *bookmarkTree)
@@ -255,6 +270,294 @@ std::unique_ptr<BookmarkItem> V1::LoadBookmarkItem(
 	return bookmarkItem;
 }
 
+void BookmarkXmlStorage::Load(IStream *stream, BookmarkTree *bookmarkTree)
+{
+	LARGE_INTEGER zero = {};
+	ULARGE_INTEGER startPosition;
+	HRESULT hr = stream->Seek(zero, STREAM_SEEK_CUR, &startPosition);
+
+	if (FAILED(hr))
+	{
+		return;
+	}
+
+	auto reader = XmlStreamReader::Create(stream);
+
+	if (!reader || V2::Load(reader.get(), bookmarkTree))
+	{
+		return;
+	}
+
+	// There's no v2 section, so the file is read again, this time looking for the v1 section.
+	LARGE_INTEGER start;
+	start.QuadPart = startPosition.QuadPart;
+	hr = stream->Seek(start, STREAM_SEEK_SET, nullptr);
+
+	if (FAILED(hr))
+	{
+		return;
+	}
+
+	reader = XmlStreamReader::Create(stream);
+
+	if (!reader)
+	{
+		return;
+	}
+
+	V1::Load(reader.get(), bookmarkTree);
+}
+
+// Each element is appended to the folder recorded for the level above it, so the tree is built
+// in a single pass over the file. An entry is null when the element at that level can't contain
+// bookmarks (e.g. because it's a bookmark, rather than a folder, or because it isn't recognized).
+bool V2::Load(XmlStreamReader *reader, BookmarkTree *bookmarkTree)
+{
+	XmlStreamReader::Element element;
+	bool sectionFound = false;
+
+	while (reader->ReadNextElement(element))
+	{
+		if (element.depth == 1 && element.name == bookmarksKeyNodeName)
+		{
+			sectionFound = true;
+			break;
+		}
+	}
+
+	if (!sectionFound)
+	{
+		return false;
+	}
+
+	std::vector<BookmarkItem *> folders;
+
+	while (reader->ReadNextElement(element) && element.depth > 1)
+	{
+		size_t level = element.depth - 2;
+		folders.resize(level, nullptr);
+
+		if (level == 0)
+		{
+			BookmarkItem *permanentFolder = nullptr;
+
+			if (element.name == L"PermanentItem")
+			{
+				permanentFolder = GetPermanentFolder(bookmarkTree, GetAttribute(element, L"name"));
+			}
+
+			if (permanentFolder)
+			{
+				ReadDates(element, permanentFolder);
+			}
+
+			folders.push_back(permanentFolder);
+			continue;
+		}
+
+		BookmarkItem *parentFolder = folders[level - 1];
+
+		if (!parentFolder || element.name != L"Bookmark")
+		{
+			folders.push_back(nullptr);
+			continue;
+		}
+
+		auto *bookmarkItem = bookmarkTree->AddBookmarkItem(
+			parentFolder, LoadBookmarkItem(element), parentFolder->GetChildren().size());
+		folders.push_back(bookmarkItem->IsFolder() ? bookmarkItem : nullptr);
+	}
+
+	return true;
+}
+
+BookmarkItem *V2::GetPermanentFolder(BookmarkTree *bookmarkTree, const std::wstring &name)
+{
+	if (name == BookmarkStorage::BOOKMARKS_TOOLBAR_NODE_NAME)
+	{
+		return bookmarkTree->GetBookmarksToolbarFolder();
+	}
+	else if (name == BookmarkStorage::BOOKMARKS_MENU_NODE_NAME)
+	{
+		return bookmarkTree->GetBookmarksMenuFolder();
+	}
+	else if (name == BookmarkStorage::OTHER_BOOKMARKS_NODE_NAME)
+	{
+		return bookmarkTree->GetOtherBookmarksFolder();
+	}
+
+	return nullptr;
+}
+
+std::unique_ptr<BookmarkItem> V2::LoadBookmarkItem(const XmlStreamReader::Element &element)
+{
+	int type = NXMLSettings::DecodeIntValue(GetAttribute(element, L"Type").c_str());
+
+	std::optional<std::wstring> locationOptional;
+
+	if (type == static_cast<int>(BookmarkItem::Type::Bookmark))
+	{
+		locationOptional = GetAttribute(element, L"Location");
+	}
+
+	auto bookmarkItem = std::make_unique<BookmarkItem>(
+		GetAttribute(element, L"GUID"), GetAttribute(element, L"ItemName"), locationOptional);
+	ReadDates(element, bookmarkItem.get());
+
+	return bookmarkItem;
+}
+
+// In the v1 format, the children of a folder are stored within a separate Bookmarks element
+// nested inside the folder's element. Those wrapper elements are tracked alongside the folders,
+// so that a bookmark is only added when it's nested in the expected way.
+bool V1::Load(XmlStreamReader *reader, BookmarkTree *bookmarkTree)
+{
+	struct Level
+	{
+		BookmarkItem *folder;
+		bool isChildrenWrapper;
+	};
+
+	XmlStreamReader::Element element;
+	bool sectionFound = false;
+
+	while (reader->ReadNextElement(element))
+	{
+		if (element.depth == 1 && element.name == bookmarksKeyNodeName)
+		{
+			sectionFound = true;
+			break;
+		}
+	}
+
+	if (!sectionFound)
+	{
+		return false;
+	}
+
+	std::vector<Level> levels;
+
+	while (reader->ReadNextElement(element) && element.depth > 1)
+	{
+		size_t level = element.depth - 2;
+		levels.resize(level, { nullptr, false });
+
+		if (level > 0)
+		{
+			const Level &parentLevel = levels[level - 1];
+
+			if (element.name == L"Bookmarks" && parentLevel.folder
+				&& !parentLevel.isChildrenWrapper)
+			{
+				levels.push_back({ parentLevel.folder, true });
+				continue;
+			}
+
+			if (element.name != L"Bookmark" || !parentLevel.folder
+				|| !parentLevel.isChildrenWrapper)
+			{
+				levels.push_back({ nullptr, false });
+				continue;
+			}
+		}
+		else if (element.name != L"Bookmark")
+		{
+			levels.push_back({ nullptr, false });
+			continue;
+		}
+
+		bool showOnToolbar;
+		auto childBookmarkItem = LoadBookmarkItem(element, showOnToolbar);
+
+		BookmarkItem *parentFolder;
+
+		if (level > 0)
+		{
+			parentFolder = levels[level - 1].folder;
+		}
+		else if (showOnToolbar)
+		{
+			parentFolder = bookmarkTree->GetBookmarksToolbarFolder();
+		}
+		else
+		{
+			parentFolder = bookmarkTree->GetBookmarksMenuFolder();
+		}
+
+		auto *bookmarkItem = bookmarkTree->AddBookmarkItem(
+			parentFolder, std::move(childBookmarkItem), parentFolder->GetChildren().size());
+		levels.push_back({ bookmarkItem->IsFolder() ? bookmarkItem : nullptr, false });
+	}
+
+	return true;
+}
+
+std::unique_ptr<BookmarkItem> V1::LoadBookmarkItem(
+	const XmlStreamReader::Element &element, bool &showOnToolbarOutput)
+{
+	int type = NXMLSettings::DecodeIntValue(GetAttribute(element, L"Type").c_str());
+
+	showOnToolbarOutput =
+		NXMLSettings::DecodeBoolValue(GetAttribute(element, L"ShowOnBookmarksToolbar").c_str());
+
+	std::optional<std::wstring> locationOptional;
+
+	if (type == static_cast<int>(BookmarkStorage::BookmarkTypeV1::Bookmark))
+	{
+		locationOptional = GetAttribute(element, L"Location");
+	}
+
+	return std::make_unique<BookmarkItem>(
+		std::nullopt, GetAttribute(element, L"name"), locationOptional);
+}
+
+namespace
+{
+std::wstring GetAttribute(const XmlStreamReader::Element &element, std::wstring_view name)
+{
+	const std::wstring *value = element.GetAttribute(name);
+
+	if (!value)
+	{
+		return {};
+	}
+
+	return *value;
+}
+
+void ReadDates(const XmlStreamReader::Element &element, BookmarkItem *bookmarkItem)
+{
+	auto readDateTime = [&element](const std::wstring &baseKeyName) -> std::optional<FILETIME> {
+		const std::wstring *lowDateTime = element.GetAttribute(baseKeyName + L"Low");
+		const std::wstring *highDateTime = element.GetAttribute(baseKeyName + L"High");
+
+		if (!lowDateTime || !highDateTime)
+		{
+			return std::nullopt;
+		}
+
+		FILETIME dateTime;
+		dateTime.dwLowDateTime = stoul(*lowDateTime);
+		dateTime.dwHighDateTime = stoul(*highDateTime);
+		return dateTime;
+	};
+
+	auto dateCreated = readDateTime(L"DateCreated");
+
+	if (dateCreated)
+	{
+		bookmarkItem->SetDateCreated(*dateCreated);
+	}
+
+	auto dateModified = readDateTime(L"DateModified");
+
+	if (dateModified)
+	{
+		bookmarkItem->SetDateModified(*dateModified);
+	}
+}
+}
+
 void BookmarkXmlStorage::Save(IXMLDOMDocument *xmlDocument, IXMLDOMElement *parentNode,
 	BookmarkTree *bookmarkTree, int indent)
 {
@@ -11,6 +11,9 @@ class BookmarkTree;
 namespace BookmarkXmlStorage
 {
 void Load(IXMLDOMDocument *xmlDocument, BookmarkTree *bookmarkTree);
+
+// Reads the bookmarks directly from the stream, without building a DOM for the whole file.
+void Load(IStream *stream, BookmarkTree *bookmarkTree);
 void Save(IXMLDOMDocument *xmlDocument, IXMLDOMElement *parentNode, BookmarkTree *bookmarkTree,
 	int indent);
 }
\ No newline at end of file
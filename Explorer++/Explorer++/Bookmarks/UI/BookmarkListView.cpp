@@ -23,8 +23,100 @@
 #include "../Helper/iDropSource.h"
 #include <boost/range/adaptor/filtered.hpp>
 #include <boost/range/adaptor/indexed.hpp>
+#include <algorithm>
 #include <utility>
 
+namespace
+{
+
+// The values that items are compared by when sorting. Retrieving these values (e.g. copying an
+// item's name) isn't free, so they're calculated once for each item, rather than once per
+// comparison.
+struct SortKey
+{
+	bool isFolder;
+	std::wstring textValue;
+	ULONGLONG dateValue;
+};
+
+ULONGLONG FileTimeToInteger(const FILETIME &fileTime)
+{
+	ULARGE_INTEGER value;
+	value.LowPart = fileTime.dwLowDateTime;
+	value.HighPart = fileTime.dwHighDateTime;
+	return value.QuadPart;
+}
+
+SortKey GetSortKey(const BookmarkItem *bookmarkItem, BookmarkHelper::ColumnType columnType)
+{
+	SortKey sortKey = { bookmarkItem->IsFolder(), {}, 0 };
+
+	switch (columnType)
+	{
+	case BookmarkHelper::ColumnType::Name:
+		sortKey.textValue = bookmarkItem->GetName();
+		break;
+
+	case BookmarkHelper::ColumnType::Location:
+		// Folders don't have a location, so they're sorted by name instead.
+		sortKey.textValue =
+			bookmarkItem->IsFolder() ? bookmarkItem->GetName() : bookmarkItem->GetLocation();
+		break;
+
+	case BookmarkHelper::ColumnType::DateCreated:
+		sortKey.dateValue = FileTimeToInteger(bookmarkItem->GetDateCreated());
+		break;
+
+	case BookmarkHelper::ColumnType::DateModified:
+		sortKey.dateValue = FileTimeToInteger(bookmarkItem->GetDateModified());
+		break;
+
+	default:
+		assert(false);
+		break;
+	}
+
+	return sortKey;
+}
+
+// Matches the ordering used by BookmarkHelper::Sort().
+int CompareSortKeys(
+	const SortKey &firstKey, const SortKey &secondKey, BookmarkHelper::ColumnType columnType)
+{
+	if (firstKey.isFolder != secondKey.isFolder)
+	{
+		return firstKey.isFolder ? -1 : 1;
+	}
+
+	switch (columnType)
+	{
+	case BookmarkHelper::ColumnType::Name:
+		return StrCmpLogicalW(firstKey.textValue.c_str(), secondKey.textValue.c_str());
+
+	case BookmarkHelper::ColumnType::Location:
+		if (firstKey.isFolder)
+		{
+			return StrCmpLogicalW(firstKey.textValue.c_str(), secondKey.textValue.c_str());
+		}
+
+		return firstKey.textValue.compare(secondKey.textValue);
+
+	case BookmarkHelper::ColumnType::DateCreated:
+	case BookmarkHelper::ColumnType::DateModified:
+		if (firstKey.dateValue == secondKey.dateValue)
+		{
+			return 0;
+		}
+
+		return firstKey.dateValue < secondKey.dateValue ? -1 : 1;
+	}
+
+	assert(false);
+	return 0;
+}
+
+}
+
 BookmarkListView::BookmarkListView(HWND hListView, HMODULE resourceModule,
 	BookmarkTree *bookmarkTree, IExplorerplusplus *expp, IconFetcher *iconFetcher,
 	const std::vector<Column> &initialColumns) :
@@ -32,6 +124,7 @@ BookmarkListView::BookmarkListView(HWND hListView, HMODULE resourceModule,
 	m_hListView(hListView),
 	m_resourceModule(resourceModule),
 	m_bookmarkTree(bookmarkTree),
+	m_currentBookmarkFolder(nullptr),
 	m_expp(expp),
 	m_columns(initialColumns),
 	m_sortColumn(BookmarkHelper::ColumnType::Default),
@@ -255,6 +348,9 @@ LRESULT CALLBACK BookmarkListView::ParentWndProc(HWND hwnd, UINT uMsg, WPARAM wP
 				OnGetDispInfo(reinterpret_cast<NMLVDISPINFO *>(lParam));
 				break;
 
+			case LVN_ODFINDITEM:
+				return OnFindItem(reinterpret_cast<NMLVFINDITEM *>(lParam));
+
 			case LVN_BEGINLABELEDIT:
 				return OnBeginLabelEdit(reinterpret_cast<NMLVDISPINFO *>(lParam));
 
@@ -302,14 +398,10 @@ void BookmarkListView::NavigateToBookmarkFolder(BookmarkItem *bookmarkFolder, bo
 
 	ListView_DeleteAllItems(m_hListView);
 
-	int position = 0;
+	m_items = GetSortedItems();
+	m_iconIndexes.clear();
 
-	for (auto &childItem : bookmarkFolder->GetChildren())
-	{
-		InsertBookmarkItemIntoListView(childItem.get(), position);
-
-		position++;
-	}
+	ListView_SetItemCountEx(m_hListView, static_cast<int>(m_items.size()), 0);
 
 	m_navigationCompletedSignal(bookmarkFolder, addHistoryEntry);
 }
@@ -323,12 +415,7 @@ boost::signals2::connection BookmarkListView::AddNavigationCompletedObserver(
 
 int BookmarkListView::InsertBookmarkItemIntoListView(BookmarkItem *bookmarkItem, int position)
 {
-	assert(position >= 0 && position <= ListView_GetItemCount(m_hListView));
-
-	TCHAR szName[256];
-	StringCchCopy(szName, SIZEOF_ARRAY(szName), bookmarkItem->GetName().c_str());
-
-	int iconIndex = m_bookmarkIconManager->GetBookmarkItemIconIndex(bookmarkItem);
+	assert(position >= 0 && position <= static_cast<int>(m_items.size()));
 
 	int sortedPosition;
 
@@ -341,33 +428,48 @@ int BookmarkListView::InsertBookmarkItemIntoListView(BookmarkItem *bookmarkItem,
 		sortedPosition = GetItemSortedPosition(bookmarkItem);
 	}
 
-	LVITEM lvi;
-	lvi.mask = LVIF_TEXT | LVIF_IMAGE | LVIF_PARAM;
-	lvi.iItem = sortedPosition;
-	lvi.iSubItem = 0;
-	lvi.iImage = iconIndex;
-	lvi.pszText = szName;
-	lvi.lParam = reinterpret_cast<LPARAM>(bookmarkItem);
-	int iItem = ListView_InsertItem(m_hListView, &lvi);
+	auto selectionState = SaveSelectionState();
+	m_items.insert(m_items.begin() + sortedPosition, bookmarkItem);
+	OnItemsChanged(selectionState);
+
+	return sortedPosition;
+}
+
+int BookmarkListView::GetBookmarkItemIconIndex(const BookmarkItem *bookmarkItem)
+{
+	auto itr = m_iconIndexes.find(bookmarkItem);
+
+	if (itr != m_iconIndexes.end())
+	{
+		return itr->second;
+	}
+
+	// If the icon for a bookmark isn't cached, this will return a default icon and queue a request
+	// for the actual icon.
+	int iconIndex = m_bookmarkIconManager->GetBookmarkItemIconIndex(bookmarkItem);
+	m_iconIndexes.insert({ bookmarkItem, iconIndex });
 
-	return iItem;
+	return iconIndex;
 }
 
 void BookmarkListView::OnBookmarkIconAvailable(std::wstring_view guid, int iconIndex)
 {
-	auto index = GetBookmarkItemIndexUsingGuid(guid);
+	const BookmarkItem *bookmarkItem = m_bookmarkTree->GetBookmarkItemById(guid);
+
+	if (!bookmarkItem)
+	{
+		return;
+	}
+
+	auto index = GetBookmarkItemIndex(bookmarkItem);
 
 	if (!index)
 	{
 		return;
 	}
 
-	LVITEM item;
-	item.mask = LVIF_IMAGE;
-	item.iItem = *index;
-	item.iSubItem = 0;
-	item.iImage = iconIndex;
-	ListView_SetItem(m_hListView, &item);
+	m_iconIndexes[bookmarkItem] = iconIndex;
+	ListView_RedrawItems(m_hListView, *index, *index);
 }
 
 BookmarkItem *BookmarkListView::GetBookmarkItemFromListView(int iItem)
@@ -377,32 +479,68 @@ BookmarkItem *BookmarkListView::GetBookmarkItemFromListView(int iItem)
 
 const BookmarkItem *BookmarkListView::GetBookmarkItemFromListView(int iItem) const
 {
-	LVITEM lvi;
-	lvi.mask = LVIF_PARAM;
-	lvi.iItem = iItem;
-	lvi.iSubItem = 0;
-	ListView_GetItem(m_hListView, &lvi);
+	assert(iItem >= 0 && iItem < static_cast<int>(m_items.size()));
 
-	return reinterpret_cast<BookmarkItem *>(lvi.lParam);
+	return m_items[iItem];
 }
 
 void BookmarkListView::SortItems()
 {
-	ListView_SortItems(m_hListView, SortBookmarksStub, reinterpret_cast<LPARAM>(this));
+	auto selectionState = SaveSelectionState();
+	m_items = GetSortedItems();
+	OnItemsChanged(selectionState);
 }
 
-int CALLBACK BookmarkListView::SortBookmarksStub(LPARAM lParam1, LPARAM lParam2, LPARAM lParamSort)
+std::vector<BookmarkItem *> BookmarkListView::GetSortedItems() const
 {
-	auto *listView = reinterpret_cast<BookmarkListView *>(lParamSort);
+	std::vector<BookmarkItem *> items;
+
+	if (!m_currentBookmarkFolder)
+	{
+		return items;
+	}
+
+	// When using the default sort mode, items are shown in the same order as they appear within the
+	// parent folder (and in ascending order only).
+	if (m_sortColumn == BookmarkHelper::ColumnType::Default)
+	{
+		items.reserve(m_currentBookmarkFolder->GetChildren().size());
+
+		for (auto &childItem : m_currentBookmarkFolder->GetChildren())
+		{
+			items.push_back(childItem.get());
+		}
+
+		return items;
+	}
+
+	std::vector<std::pair<SortKey, BookmarkItem *>> keyedItems;
+	keyedItems.reserve(m_currentBookmarkFolder->GetChildren().size());
+
+	for (auto &childItem : m_currentBookmarkFolder->GetChildren())
+	{
+		keyedItems.emplace_back(GetSortKey(childItem.get(), m_sortColumn), childItem.get());
+	}
+
+	std::stable_sort(keyedItems.begin(), keyedItems.end(),
+		[this](const auto &firstItem, const auto &secondItem) {
+			int res = CompareSortKeys(firstItem.first, secondItem.first, m_sortColumn);
+			return m_sortAscending ? (res < 0) : (res > 0);
+		});
 
-	return listView->SortBookmarks(lParam1, lParam2);
+	items.reserve(keyedItems.size());
+
+	for (const auto &keyedItem : keyedItems)
+	{
+		items.push_back(keyedItem.second);
+	}
+
+	return items;
 }
 
-int CALLBACK BookmarkListView::SortBookmarks(LPARAM lParam1, LPARAM lParam2)
+int BookmarkListView::CompareBookmarkItems(
+	const BookmarkItem *firstItem, const BookmarkItem *secondItem) const
 {
-	auto firstItem = reinterpret_cast<BookmarkItem *>(lParam1);
-	auto secondItem = reinterpret_cast<BookmarkItem *>(lParam2);
-
 	int iRes = BookmarkHelper::Sort(m_sortColumn, firstItem, secondItem);
 
 	// When using the default sort mode (in which items are sorted according to
@@ -418,24 +556,58 @@ int CALLBACK BookmarkListView::SortBookmarks(LPARAM lParam1, LPARAM lParam2)
 
 int BookmarkListView::GetItemSortedPosition(const BookmarkItem *bookmarkItem) const
 {
-	int numItems = ListView_GetItemCount(m_hListView);
-	int res = 1;
-	int i = 0;
+	auto itr = std::upper_bound(m_items.begin(), m_items.end(), bookmarkItem,
+		[this](const BookmarkItem *firstItem, const BookmarkItem *secondItem) {
+			return CompareBookmarkItems(firstItem, secondItem) < 0;
+		});
 
-	while (res > 0 && i < numItems)
+	return static_cast<int>(itr - m_items.begin());
+}
+
+BookmarkListView::SelectionState BookmarkListView::SaveSelectionState() const
+{
+	SelectionState selectionState;
+	int index = -1;
+
+	while ((index = ListView_GetNextItem(m_hListView, index, LVNI_SELECTED)) != -1)
 	{
-		const BookmarkItem *currentItem = GetBookmarkItemFromListView(i);
-		res = BookmarkHelper::Sort(m_sortColumn, bookmarkItem, currentItem);
+		selectionState.selectedItems.insert(GetBookmarkItemFromListView(index));
+	}
+
+	int focusedIndex = ListView_GetNextItem(m_hListView, -1, LVNI_FOCUSED);
 
-		i++;
+	if (focusedIndex != -1)
+	{
+		selectionState.focusedItem = GetBookmarkItemFromListView(focusedIndex);
 	}
 
-	if (i < numItems || res < 0)
+	return selectionState;
+}
+
+// Should be called once the list of items has changed.
+void BookmarkListView::OnItemsChanged(const SelectionState &selectionState)
+{
+	ListView_SetItemCountEx(m_hListView, static_cast<int>(m_items.size()), LVSICF_NOSCROLL);
+
+	ListViewHelper::SelectAllItems(m_hListView, FALSE);
+	ListView_SetItemState(m_hListView, -1, 0, LVIS_FOCUSED);
+
+	for (const auto &item : m_items | boost::adaptors::indexed(0))
 	{
-		i--;
+		int index = static_cast<int>(item.index());
+
+		if (selectionState.selectedItems.contains(item.value()))
+		{
+			ListView_SetItemState(m_hListView, index, LVIS_SELECTED, LVIS_SELECTED);
+		}
+
+		if (item.value() == selectionState.focusedItem)
+		{
+			ListView_SetItemState(m_hListView, index, LVIS_FOCUSED, LVIS_FOCUSED);
+		}
 	}
 
-	return i;
+	InvalidateRect(m_hListView, nullptr, FALSE);
 }
 
 BookmarkHelper::ColumnType BookmarkListView::GetSortColumn() const
@@ -681,7 +853,7 @@ RawBookmarkItems BookmarkListView::GetSelectedBookmarkItems()
 	return bookmarksItems;
 }
 
-void BookmarkListView::SelectItem(const BookmarkItem *bookmarkItem)
+void BookmarkListView::SelectItem(const BookmarkItem *bookmarkItem, bool setFocus)
 {
 	auto index = GetBookmarkItemIndex(bookmarkItem);
 
@@ -690,9 +862,14 @@ void BookmarkListView::SelectItem(const BookmarkItem *bookmarkItem)
 		return;
 	}
 
-	SetFocus(m_hListView);
+	if (setFocus)
+	{
+		SetFocus(m_hListView);
+	}
+
 	ListViewHelper::SelectAllItems(m_hListView, FALSE);
 	ListViewHelper::SelectItem(m_hListView, *index, TRUE);
+	ListView_EnsureVisible(m_hListView, *index, FALSE);
 }
 
 void BookmarkListView::CreateNewFolder()
@@ -714,19 +891,71 @@ void BookmarkListView::CreateNewFolder()
 
 void BookmarkListView::OnGetDispInfo(NMLVDISPINFO *dispInfo)
 {
+	auto bookmarkItem = GetBookmarkItemFromListView(dispInfo->item.iItem);
+
 	if (WI_IsFlagSet(dispInfo->item.mask, LVIF_TEXT))
 	{
-		auto bookmarkItem = GetBookmarkItemFromListView(dispInfo->item.iItem);
-
 		auto columnType = GetColumnTypeByIndex(dispInfo->item.iSubItem);
 		assert(columnType);
 
 		std::wstring columnText = GetBookmarkItemColumnInfo(bookmarkItem, *columnType);
 
 		StringCchCopy(dispInfo->item.pszText, dispInfo->item.cchTextMax, columnText.c_str());
+	}
+
+	if (WI_IsFlagSet(dispInfo->item.mask, LVIF_IMAGE) && dispInfo->item.iSubItem == 0)
+	{
+		dispInfo->item.iImage = GetBookmarkItemIconIndex(bookmarkItem);
+	}
+}
+
+// Used when the user types in the listview, to find the next item whose name starts with the
+// typed text.
+int BookmarkListView::OnFindItem(const NMLVFINDITEM *findItem) const
+{
+	if (WI_IsFlagClear(findItem->lvfi.flags, LVFI_STRING) || !findItem->lvfi.psz)
+	{
+		return -1;
+	}
+
+	bool partial = WI_IsAnyFlagSet(findItem->lvfi.flags, LVFI_PARTIAL | LVFI_SUBSTRING);
+	int textLength = lstrlen(findItem->lvfi.psz);
+	int numItems = static_cast<int>(m_items.size());
+	int startIndex = (findItem->iStart < numItems) ? findItem->iStart : 0;
+
+	for (int i = 0; i < numItems; i++)
+	{
+		int index = startIndex + i;
+
+		if (index >= numItems)
+		{
+			if (WI_IsFlagClear(findItem->lvfi.flags, LVFI_WRAP))
+			{
+				break;
+			}
 
-		WI_SetFlag(dispInfo->item.mask, LVIF_DI_SETITEM);
+			index -= numItems;
+		}
+
+		std::wstring name = m_items[index]->GetName();
+		int res;
+
+		if (partial)
+		{
+			res = StrCmpNIW(name.c_str(), findItem->lvfi.psz, textLength);
+		}
+		else
+		{
+			res = lstrcmpi(name.c_str(), findItem->lvfi.psz);
+		}
+
+		if (res == 0)
+		{
+			return index;
+		}
 	}
+
+	return -1;
 }
 
 std::wstring BookmarkListView::GetBookmarkItemColumnInfo(
@@ -1070,17 +1299,15 @@ void BookmarkListView::OnBookmarkItemUpdated(
 	auto index = GetBookmarkItemIndex(&bookmarkItem);
 	assert(index);
 
-	BookmarkHelper::ColumnType columnType = MapPropertyTypeToColumnType(propertyType);
-	Column &column = GetColumnByType(columnType);
-
-	if (!column.active)
+	if (propertyType == BookmarkItem::PropertyType::Location)
 	{
-		return;
+		// The icon is based on the location, so will need to be retrieved again.
+		m_iconIndexes.erase(&bookmarkItem);
 	}
 
-	int columnIndex = GetColumnIndexByType(columnType);
-	std::wstring columnText = GetBookmarkItemColumnInfo(&bookmarkItem, columnType);
-	ListView_SetItemText(m_hListView, *index, columnIndex, columnText.data());
+	// The item text isn't stored by the listview, so all that's needed is for the item to be
+	// redrawn.
+	ListView_RedrawItems(m_hListView, *index, *index);
 }
 
 void BookmarkListView::OnBookmarkItemMoved(BookmarkItem *bookmarkItem,
@@ -1112,61 +1339,25 @@ void BookmarkListView::RemoveBookmarkItem(const BookmarkItem *bookmarkItem)
 	auto index = GetBookmarkItemIndex(bookmarkItem);
 	assert(index);
 
-	ListView_DeleteItem(m_hListView, *index);
-}
-
-std::optional<int> BookmarkListView::GetBookmarkItemIndex(const BookmarkItem *bookmarkItem) const
-{
-	LVFINDINFO findInfo;
-	findInfo.flags = LVFI_PARAM;
-	findInfo.lParam = reinterpret_cast<LPARAM>(bookmarkItem);
-	int index = ListView_FindItem(m_hListView, -1, &findInfo);
+	auto selectionState = SaveSelectionState();
+	selectionState.selectedItems.erase(bookmarkItem);
 
-	if (index == -1)
-	{
-		return std::nullopt;
-	}
+	m_items.erase(m_items.begin() + *index);
+	m_iconIndexes.erase(bookmarkItem);
 
-	return index;
+	OnItemsChanged(selectionState);
 }
 
-std::optional<int> BookmarkListView::GetBookmarkItemIndexUsingGuid(std::wstring_view guid) const
+std::optional<int> BookmarkListView::GetBookmarkItemIndex(const BookmarkItem *bookmarkItem) const
 {
-	int numItems = ListView_GetItemCount(m_hListView);
+	auto itr = std::find(m_items.begin(), m_items.end(), bookmarkItem);
 
-	for (int i = 0; i < numItems; i++)
+	if (itr == m_items.end())
 	{
-		const BookmarkItem *bookmarkItem = GetBookmarkItemFromListView(i);
-
-		if (bookmarkItem->GetGUID() == guid)
-		{
-			return i;
-		}
+		return std::nullopt;
 	}
 
-	return std::nullopt;
-}
-
-BookmarkHelper::ColumnType BookmarkListView::MapPropertyTypeToColumnType(
-	BookmarkItem::PropertyType propertyType) const
-{
-	switch (propertyType)
-	{
-	case BookmarkItem::PropertyType::Name:
-		return BookmarkHelper::ColumnType::Name;
-
-	case BookmarkItem::PropertyType::Location:
-		return BookmarkHelper::ColumnType::Location;
-
-	case BookmarkItem::PropertyType::DateCreated:
-		return BookmarkHelper::ColumnType::DateCreated;
-
-	case BookmarkItem::PropertyType::DateModified:
-		return BookmarkHelper::ColumnType::DateModified;
-
-	default:
-		throw std::runtime_error("Bookmark column not found");
-	}
+	return static_cast<int>(itr - m_items.begin());
 }
 
 BookmarkListView::Column &BookmarkListView::GetColumnByType(BookmarkHelper::ColumnType columnType)
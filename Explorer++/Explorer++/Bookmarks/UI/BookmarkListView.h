@@ -15,12 +15,17 @@
 #include <boost/signals2.hpp>
 #include <wil/resource.h>
 #include <optional>
+#include <unordered_map>
+#include <unordered_set>
 
 class BookmarkIconManager;
 class BookmarkTree;
 class IconFetcher;
 __interface IExplorerplusplus;
 
+// The listview is expected to have the LVS_OWNERDATA style. Each row is rendered on demand from the
+// list of items below, so showing (or sorting) a large folder doesn't require a listview item to be
+// created for each bookmark.
 class BookmarkListView : public BookmarkNavigatorInterface, private BookmarkDropTargetWindow
 {
 public:
@@ -42,7 +47,7 @@ public:
 
 	std::optional<int> GetLastSelectedItemIndex() const;
 	RawBookmarkItems GetSelectedBookmarkItems();
-	void SelectItem(const BookmarkItem *bookmarkItem);
+	void SelectItem(const BookmarkItem *bookmarkItem, bool setFocus = true);
 	void CreateNewFolder();
 	bool CanDelete();
 	void DeleteSelection();
@@ -61,6 +66,14 @@ private:
 
 	static inline const double FOLDER_CENTRAL_RECT_INDENT_PERCENTAGE = 0.2;
 
+	// Since the listview tracks the selection by index, the selection needs to be saved and then
+	// restored whenever items are added, removed or reordered.
+	struct SelectionState
+	{
+		std::unordered_set<const BookmarkItem *> selectedItems;
+		const BookmarkItem *focusedItem = nullptr;
+	};
+
 	static LRESULT CALLBACK WndProcStub(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam,
 		UINT_PTR uIdSubclass, DWORD_PTR dwRefData);
 	LRESULT CALLBACK WndProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
@@ -79,6 +92,7 @@ private:
 	std::optional<BookmarkHelper::ColumnType> GetColumnTypeByIndex(int index) const;
 
 	int InsertBookmarkItemIntoListView(BookmarkItem *bookmarkItem, int position);
+	int GetBookmarkItemIconIndex(const BookmarkItem *bookmarkItem);
 	void OnBookmarkIconAvailable(std::wstring_view guid, int iconIndex);
 	std::wstring GetBookmarkItemColumnInfo(
 		const BookmarkItem *bookmarkItem, BookmarkHelper::ColumnType columnType);
@@ -88,9 +102,11 @@ private:
 	const BookmarkItem *GetBookmarkItemFromListView(int iItem) const;
 
 	void SortItems();
-	static int CALLBACK SortBookmarksStub(LPARAM lParam1, LPARAM lParam2, LPARAM lParamSort);
-	int CALLBACK SortBookmarks(LPARAM lParam1, LPARAM lParam2);
+	std::vector<BookmarkItem *> GetSortedItems() const;
+	int CompareBookmarkItems(const BookmarkItem *firstItem, const BookmarkItem *secondItem) const;
 	int GetItemSortedPosition(const BookmarkItem *bookmarkItem) const;
+	SelectionState SaveSelectionState() const;
+	void OnItemsChanged(const SelectionState &selectionState);
 
 	void OnDblClk(const NMITEMACTIVATE *itemActivate);
 	void OnShowContextMenu(const POINT &ptScreen);
@@ -98,6 +114,7 @@ private:
 	void OnMenuItemSelected(int menuItemId);
 	void OnNewBookmark();
 	void OnGetDispInfo(NMLVDISPINFO *dispInfo);
+	int OnFindItem(const NMLVFINDITEM *findItem) const;
 	BOOL OnBeginLabelEdit(const NMLVDISPINFO *dispInfo);
 	BOOL OnEndLabelEdit(const NMLVDISPINFO *dispInfo);
 	void OnKeyDown(const NMLVKEYDOWN *keyDown);
@@ -120,9 +137,6 @@ private:
 
 	void RemoveBookmarkItem(const BookmarkItem *bookmarkItem);
 	std::optional<int> GetBookmarkItemIndex(const BookmarkItem *bookmarkItem) const;
-	std::optional<int> GetBookmarkItemIndexUsingGuid(std::wstring_view guid) const;
-	BookmarkHelper::ColumnType MapPropertyTypeToColumnType(
-		BookmarkItem::PropertyType propertyType) const;
 	Column &GetColumnByType(BookmarkHelper::ColumnType columnType);
 	std::optional<int> GetColumnHeaderIndexByType(BookmarkHelper::ColumnType columnType) const;
 	int GetColumnIndexByType(BookmarkHelper::ColumnType columnType) const;
@@ -142,6 +156,13 @@ private:
 
 	BookmarkTree *m_bookmarkTree;
 	BookmarkItem *m_currentBookmarkFolder;
+
+	// The items shown in the listview, in display order.
+	std::vector<BookmarkItem *> m_items;
+
+	// Icons are only retrieved once an item is actually displayed.
+	std::unordered_map<const BookmarkItem *, int> m_iconIndexes;
+
 	BookmarkHelper::ColumnType m_sortColumn;
 	bool m_sortAscending;
 	std::optional<BookmarkHelper::ColumnType> m_previousSortColumn;
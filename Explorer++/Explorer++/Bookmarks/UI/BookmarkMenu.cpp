@@ -9,7 +9,7 @@
 BookmarkMenu::BookmarkMenu(BookmarkTree *bookmarkTree, HMODULE resourceModule,
 	IExplorerplusplus *expp, Navigation *navigation, IconFetcher *iconFetcher, HWND parentWindow) :
 	m_parentWindow(parentWindow),
-	m_menuBuilder(expp, iconFetcher, resourceModule),
+	m_menuBuilder(expp, bookmarkTree, iconFetcher, resourceModule),
 	m_bookmarkContextMenu(bookmarkTree, resourceModule, expp),
 	m_controller(navigation),
 	m_showingMenu(false),
@@ -41,6 +41,13 @@ LRESULT CALLBACK BookmarkMenu::ParentWindowSubclass(
 		OnMenuRightButtonUp(reinterpret_cast<HMENU>(lParam), static_cast<int>(wParam), pt);
 	}
 	break;
+
+	case WM_INITMENUPOPUP:
+		if (m_showingMenu)
+		{
+			m_menuBuilder.OnInitMenuPopup(reinterpret_cast<HMENU>(wParam));
+		}
+		break;
 	}
 
 	return DefSubclassProc(hwnd, msg, wParam, lParam);
@@ -93,10 +100,11 @@ BOOL BookmarkMenu::ShowMenu(BookmarkItem *bookmarkItem, const POINT &pt,
 	BookmarkMenuBuilder::ItemIdMap menuItemIdMappings;
 	BookmarkMenuBuilder::ItemPositionMap menuItemPositionMappings;
 	BOOL res = m_menuBuilder.BuildMenu(m_parentWindow, menu.get(), bookmarkItem, { MIN_ID, MAX_ID },
-		0, menuItemIdMappings, menuImages, &menuItemPositionMappings, nullptr, includePredicate);
+		0, menuItemIdMappings, menuImages, &menuItemPositionMappings, includePredicate);
 
 	if (!res)
 	{
+		m_menuBuilder.EndMenu();
 		return FALSE;
 	}
 
@@ -109,6 +117,10 @@ BOOL BookmarkMenu::ShowMenu(BookmarkItem *bookmarkItem, const POINT &pt,
 	m_showingMenu = false;
 	m_menuItemPositionMappings = nullptr;
 
+	// The menu and the maps above are about to be destroyed, so the builder shouldn't make any
+	// further changes to them (e.g. when an icon is retrieved).
+	m_menuBuilder.EndMenu();
+
 	if (cmd != 0)
 	{
 		OnMenuItemSelected(cmd, menuItemIdMappings);
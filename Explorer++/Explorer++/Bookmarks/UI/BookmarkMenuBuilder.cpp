@@ -5,53 +5,112 @@
 #include "stdafx.h"
 #include "Bookmarks/UI/BookmarkMenuBuilder.h"
 #include "Bookmarks/BookmarkIconManager.h"
+#include "Bookmarks/BookmarkTree.h"
 #include "MainResource.h"
 #include "ResourceHelper.h"
 #include "../Helper/DpiCompatibility.h"
 #include "../Helper/ImageHelper.h"
 #include <boost/format.hpp>
-#include <wil/common.h>
 
-BookmarkMenuBuilder::BookmarkMenuBuilder(
-	IExplorerplusplus *expp, IconFetcher *iconFetcher, HMODULE resourceModule) :
+BookmarkMenuBuilder::BookmarkMenuBuilder(IExplorerplusplus *expp, BookmarkTree *bookmarkTree,
+	IconFetcher *iconFetcher, HMODULE resourceModule) :
 	m_expp(expp),
+	m_bookmarkTree(bookmarkTree),
 	m_iconFetcher(iconFetcher),
 	m_resourceModule(resourceModule)
 {
 }
 
-BOOL BookmarkMenuBuilder::BuildMenu(HWND parentWindow, HMENU menu, BookmarkItem *bookmarkItem,
-	const MenuIdRange &menuIdRange, int startPosition, ItemIdMap &itemIdMap,
-	std::vector<wil::unique_hbitmap> &menuImages, ItemPositionMap *itemPositionMap,
-	int *nextMenuItemId, IncludePredicate includePredicate)
+BookmarkMenuBuilder::~BookmarkMenuBuilder() = default;
+
+void BookmarkMenuBuilder::BeginMenu(HWND parentWindow, const MenuIdRange &menuIdRange,
+	ItemIdMap &itemIdMap, std::vector<wil::unique_hbitmap> &menuImages,
+	ItemPositionMap *itemPositionMap)
 {
-	assert(bookmarkItem->IsFolder());
+	EndMenu();
 
 	m_menuIdRange = menuIdRange;
 	m_idCounter = menuIdRange.startId;
+	m_itemIdMap = &itemIdMap;
+	m_menuImages = &menuImages;
+	m_itemPositionMap = itemPositionMap;
 
 	auto &dpiCompat = DpiCompatibility::GetInstance();
 	UINT dpi = dpiCompat.GetDpiForWindow(parentWindow);
 	int iconWidth = dpiCompat.GetSystemMetricsForDpi(SM_CXSMICON, dpi);
 	int iconHeight = dpiCompat.GetSystemMetricsForDpi(SM_CYSMICON, dpi);
 
-	BookmarkIconManager bookmarkIconManager(m_expp, m_iconFetcher, nullptr, iconWidth, iconHeight);
+	m_bookmarkIconManager = std::make_unique<BookmarkIconManager>(m_expp, m_iconFetcher,
+		std::bind_front(&BookmarkMenuBuilder::OnIconAvailable, this), iconWidth, iconHeight);
+}
 
-	BOOL res = BuildMenu(menu, bookmarkItem, startPosition, itemIdMap, bookmarkIconManager,
-		menuImages, itemPositionMap, true, includePredicate);
-	wil::assign_to_opt_param(nextMenuItemId, m_idCounter);
+BOOL BookmarkMenuBuilder::AddFolderToMenu(HMENU menu, BookmarkItem *bookmarkFolder,
+	int startPosition, IncludePredicate includePredicate)
+{
+	assert(bookmarkFolder->IsFolder());
+	assert(m_bookmarkIconManager);
 
-	return res;
+	return BuildMenu(menu, bookmarkFolder, startPosition, true, includePredicate);
 }
 
-BOOL BookmarkMenuBuilder::BuildMenu(HMENU menu, BookmarkItem *bookmarkItem, int startPosition,
-	ItemIdMap &itemIdMap, BookmarkIconManager &bookmarkIconManager,
+BOOL BookmarkMenuBuilder::BuildMenu(HWND parentWindow, HMENU menu, BookmarkItem *bookmarkItem,
+	const MenuIdRange &menuIdRange, int startPosition, ItemIdMap &itemIdMap,
 	std::vector<wil::unique_hbitmap> &menuImages, ItemPositionMap *itemPositionMap,
+	IncludePredicate includePredicate)
+{
+	BeginMenu(parentWindow, menuIdRange, itemIdMap, menuImages, itemPositionMap);
+	return AddFolderToMenu(menu, bookmarkItem, startPosition, includePredicate);
+}
+
+void BookmarkMenuBuilder::AddDeferredSubmenu(HMENU subMenu, const BookmarkItem *bookmarkFolder)
+{
+	assert(bookmarkFolder->IsFolder());
+	assert(m_bookmarkIconManager);
+
+	m_deferredSubmenus.insert({ subMenu, bookmarkFolder->GetGUID() });
+}
+
+void BookmarkMenuBuilder::OnInitMenuPopup(HMENU menu)
+{
+	auto itr = m_deferredSubmenus.find(menu);
+
+	if (itr == m_deferredSubmenus.end())
+	{
+		return;
+	}
+
+	std::wstring guid = itr->second;
+	m_deferredSubmenus.erase(itr);
+
+	BookmarkItem *bookmarkFolder = m_bookmarkTree->GetBookmarkItemById(guid);
+
+	if (!bookmarkFolder)
+	{
+		return;
+	}
+
+	BuildMenu(menu, bookmarkFolder, 0, false, nullptr);
+}
+
+void BookmarkMenuBuilder::EndMenu()
+{
+	// Destroying the icon manager ensures that any icons that are still being retrieved won't
+	// result in a callback.
+	m_bookmarkIconManager.reset();
+
+	m_itemIdMap = nullptr;
+	m_menuImages = nullptr;
+	m_itemPositionMap = nullptr;
+	m_deferredSubmenus.clear();
+	m_bookmarkPositions.clear();
+}
+
+BOOL BookmarkMenuBuilder::BuildMenu(HMENU menu, BookmarkItem *bookmarkItem, int startPosition,
 	bool applyIncludePredicate, IncludePredicate includePredicate)
 {
 	if (bookmarkItem->GetChildren().empty())
 	{
-		return AddEmptyBookmarkFolderToMenu(menu, bookmarkItem, startPosition, itemPositionMap);
+		return AddEmptyBookmarkFolderToMenu(menu, bookmarkItem, startPosition);
 	}
 
 	int position = startPosition;
@@ -67,13 +126,11 @@ BOOL BookmarkMenuBuilder::BuildMenu(HMENU menu, BookmarkItem *bookmarkItem, int
 
 		if (childItem->IsFolder())
 		{
-			res = AddBookmarkFolderToMenu(menu, childItem.get(), position, itemIdMap,
-				bookmarkIconManager, menuImages, itemPositionMap);
+			res = AddBookmarkFolderToMenu(menu, childItem.get(), position);
 		}
 		else
 		{
-			res = AddBookmarkToMenu(menu, childItem.get(), position, itemIdMap, bookmarkIconManager,
-				menuImages, itemPositionMap);
+			res = AddBookmarkToMenu(menu, childItem.get(), position);
 		}
 
 		if (!res)
@@ -88,7 +145,7 @@ BOOL BookmarkMenuBuilder::BuildMenu(HMENU menu, BookmarkItem *bookmarkItem, int
 }
 
 BOOL BookmarkMenuBuilder::AddEmptyBookmarkFolderToMenu(
-	HMENU menu, BookmarkItem *bookmarkItem, int position, ItemPositionMap *itemPositionMap)
+	HMENU menu, BookmarkItem *bookmarkItem, int position)
 {
 	std::wstring bookmarkFolderEmpty =
 		ResourceHelper::LoadString(m_resourceModule, IDS_BOOKMARK_FOLDER_EMPTY);
@@ -106,7 +163,7 @@ BOOL BookmarkMenuBuilder::AddEmptyBookmarkFolderToMenu(
 		return FALSE;
 	}
 
-	if (itemPositionMap)
+	if (m_itemPositionMap)
 	{
 		// If you right-click the empty item shown in a bookmark drop-down in
 		// Chrome/Firefox, the parent item will be used as the target of any
@@ -114,16 +171,17 @@ BOOL BookmarkMenuBuilder::AddEmptyBookmarkFolderToMenu(
 		// folder).
 		// To enable similar behavior here, the empty item is mapped to the
 		// parent.
-		itemPositionMap->insert({ { menu, position }, bookmarkItem });
+		m_itemPositionMap->insert({ { menu, position }, bookmarkItem });
 	}
 
 	return res;
 }
 
-BOOL BookmarkMenuBuilder::AddBookmarkFolderToMenu(HMENU menu, BookmarkItem *bookmarkItem,
-	int position, ItemIdMap &itemIdMap, BookmarkIconManager &bookmarkIconManager,
-	std::vector<wil::unique_hbitmap> &menuImages, ItemPositionMap *itemPositionMap)
+BOOL BookmarkMenuBuilder::AddBookmarkFolderToMenu(
+	HMENU menu, BookmarkItem *bookmarkItem, int position)
 {
+	// The submenu is destroyed along with its parent menu. Its contents are only added once it's
+	// about to be shown.
 	HMENU subMenu = CreatePopupMenu();
 
 	if (subMenu == nullptr)
@@ -142,23 +200,24 @@ BOOL BookmarkMenuBuilder::AddBookmarkFolderToMenu(HMENU menu, BookmarkItem *book
 
 	if (!res)
 	{
+		DestroyMenu(subMenu);
 		return FALSE;
 	}
 
-	AddIconToMenuItem(menu, position, bookmarkItem, bookmarkIconManager, menuImages);
+	SetMenuItemIcon(
+		menu, position, m_bookmarkIconManager->GetBookmarkItemIconIndex(bookmarkItem));
 
-	if (itemPositionMap)
+	if (m_itemPositionMap)
 	{
-		itemPositionMap->insert({ { menu, position }, bookmarkItem });
+		m_itemPositionMap->insert({ { menu, position }, bookmarkItem });
 	}
 
-	return BuildMenu(subMenu, bookmarkItem, 0, itemIdMap, bookmarkIconManager, menuImages,
-		itemPositionMap, false, nullptr);
+	AddDeferredSubmenu(subMenu, bookmarkItem);
+
+	return TRUE;
 }
 
-BOOL BookmarkMenuBuilder::AddBookmarkToMenu(HMENU menu, BookmarkItem *bookmarkItem, int position,
-	ItemIdMap &itemIdMap, BookmarkIconManager &bookmarkIconManager,
-	std::vector<wil::unique_hbitmap> &menuImages, ItemPositionMap *itemPositionMap)
+BOOL BookmarkMenuBuilder::AddBookmarkToMenu(HMENU menu, BookmarkItem *bookmarkItem, int position)
 {
 	int id = m_idCounter++;
 
@@ -181,27 +240,37 @@ BOOL BookmarkMenuBuilder::AddBookmarkToMenu(HMENU menu, BookmarkItem *bookmarkIt
 		return FALSE;
 	}
 
-	AddIconToMenuItem(menu, position, bookmarkItem, bookmarkIconManager, menuImages);
+	// This will return a default icon if the actual icon hasn't been retrieved yet. The item will
+	// be updated in OnIconAvailable() once the actual icon is available.
+	m_bookmarkPositions.insert({ bookmarkItem->GetGUID(), { menu, position } });
+	SetMenuItemIcon(
+		menu, position, m_bookmarkIconManager->GetBookmarkItemIconIndex(bookmarkItem));
 
-	itemIdMap.insert({ id, bookmarkItem });
+	m_itemIdMap->insert({ id, bookmarkItem });
 
-	if (itemPositionMap)
+	if (m_itemPositionMap)
 	{
-		itemPositionMap->insert({ { menu, position }, bookmarkItem });
+		m_itemPositionMap->insert({ { menu, position }, bookmarkItem });
 	}
 
 	return res;
 }
 
-void BookmarkMenuBuilder::AddIconToMenuItem(HMENU menu, int position,
-	const BookmarkItem *bookmarkItem, BookmarkIconManager &bookmarkIconManager,
-	std::vector<wil::unique_hbitmap> &menuImages)
+void BookmarkMenuBuilder::OnIconAvailable(std::wstring_view guid, int iconIndex)
 {
-	int iconIndex = bookmarkIconManager.GetBookmarkItemIconIndex(bookmarkItem);
+	auto [begin, end] = m_bookmarkPositions.equal_range(std::wstring(guid));
 
+	for (auto itr = begin; itr != end; ++itr)
+	{
+		SetMenuItemIcon(itr->second.first, itr->second.second, iconIndex);
+	}
+}
+
+void BookmarkMenuBuilder::SetMenuItemIcon(HMENU menu, int position, int iconIndex)
+{
 	wil::com_ptr_nothrow<IImageList> imageList;
-	HRESULT hr =
-		HIMAGELIST_QueryInterface(bookmarkIconManager.GetImageList(), IID_PPV_ARGS(&imageList));
+	HRESULT hr = HIMAGELIST_QueryInterface(
+		m_bookmarkIconManager->GetImageList(), IID_PPV_ARGS(&imageList));
 
 	if (FAILED(hr))
 	{
@@ -223,6 +292,6 @@ void BookmarkMenuBuilder::AddIconToMenuItem(HMENU menu, int position,
 
 	if (res)
 	{
-		menuImages.push_back(std::move(bitmap));
+		m_menuImages->push_back(std::move(bitmap));
 	}
 }
\ No newline at end of file
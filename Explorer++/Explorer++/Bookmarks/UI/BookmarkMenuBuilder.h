@@ -8,13 +8,19 @@
 #include "MenuHelper.h"
 #include <boost/functional/hash.hpp>
 #include <functional>
+#include <memory>
 #include <unordered_map>
 #include <utility>
 
 class BookmarkIconManager;
+class BookmarkTree;
 class IconFetcher;
 __interface IExplorerplusplus;
 
+// Builds menus from bookmark folders. Only the top level of a menu is built straight away. Each
+// submenu is populated when it's about to be shown, which requires the owner of the menu to forward
+// WM_INITMENUPOPUP to OnInitMenuPopup(). Bookmark icons that haven't been cached are retrieved in
+// the background and the relevant menu items are updated in place once the icons are available.
 class BookmarkMenuBuilder
 {
 public:
@@ -30,32 +36,61 @@ public:
 
 	using IncludePredicate = std::function<bool(const BookmarkItem *bookmarkItem)>;
 
-	BookmarkMenuBuilder(IExplorerplusplus *expp, IconFetcher *iconFetcher, HMODULE resourceModule);
+	BookmarkMenuBuilder(IExplorerplusplus *expp, BookmarkTree *bookmarkTree,
+		IconFetcher *iconFetcher, HMODULE resourceModule);
+	~BookmarkMenuBuilder();
 
+	// Starts a new menu, discarding the state associated with any previous menu. The maps and the
+	// list of images are updated as submenus are populated and icons are retrieved, so they need to
+	// remain valid until either EndMenu() is called or another menu is started.
+	void BeginMenu(HWND parentWindow, const MenuIdRange &menuIdRange, ItemIdMap &itemIdMap,
+		std::vector<wil::unique_hbitmap> &menuImages, ItemPositionMap *itemPositionMap = nullptr);
+
+	// Adds the children of the folder to the current menu. Menu item IDs continue on from any items
+	// that have already been added.
+	BOOL AddFolderToMenu(HMENU menu, BookmarkItem *bookmarkFolder, int startPosition,
+		IncludePredicate includePredicate = nullptr);
+
+	// Marks the specified submenu as one that should be populated with the children of the folder
+	// once it's shown.
+	void AddDeferredSubmenu(HMENU subMenu, const BookmarkItem *bookmarkFolder);
+
+	// Equivalent to calling BeginMenu(), followed by AddFolderToMenu().
 	BOOL BuildMenu(HWND parentWindow, HMENU menu, BookmarkItem *bookmarkItem,
 		const MenuIdRange &menuIdRange, int startPosition, ItemIdMap &itemIdMap,
 		std::vector<wil::unique_hbitmap> &menuImages, ItemPositionMap *itemPositionMap = nullptr,
-		int *nextMenuItemId = nullptr, IncludePredicate includePredicate = nullptr);
+		IncludePredicate includePredicate = nullptr);
+
+	void OnInitMenuPopup(HMENU menu);
+	void EndMenu();
 
 private:
-	BOOL BuildMenu(HMENU menu, BookmarkItem *bookmarkItem, int startPosition, ItemIdMap &itemIdMap,
-		BookmarkIconManager &bookmarkIconManager, std::vector<wil::unique_hbitmap> &menuImages,
-		ItemPositionMap *itemPositionMap, bool applyIncludePredicate,
-		IncludePredicate includePredicate);
-	BOOL AddEmptyBookmarkFolderToMenu(
-		HMENU menu, BookmarkItem *bookmarkItem, int position, ItemPositionMap *itemPositionMap);
-	BOOL AddBookmarkFolderToMenu(HMENU menu, BookmarkItem *bookmarkItem, int position,
-		ItemIdMap &itemIdMap, BookmarkIconManager &bookmarkIconManager,
-		std::vector<wil::unique_hbitmap> &menuImages, ItemPositionMap *itemPositionMap);
-	BOOL AddBookmarkToMenu(HMENU menu, BookmarkItem *bookmarkItem, int position,
-		ItemIdMap &itemIdMap, BookmarkIconManager &bookmarkIconManager,
-		std::vector<wil::unique_hbitmap> &menuImages, ItemPositionMap *itemPositionMap);
-	void AddIconToMenuItem(HMENU menu, int position, const BookmarkItem *bookmarkItem,
-		BookmarkIconManager &bookmarkIconManager, std::vector<wil::unique_hbitmap> &menuImages);
+	BOOL BuildMenu(HMENU menu, BookmarkItem *bookmarkItem, int startPosition,
+		bool applyIncludePredicate, IncludePredicate includePredicate);
+	BOOL AddEmptyBookmarkFolderToMenu(HMENU menu, BookmarkItem *bookmarkItem, int position);
+	BOOL AddBookmarkFolderToMenu(HMENU menu, BookmarkItem *bookmarkItem, int position);
+	BOOL AddBookmarkToMenu(HMENU menu, BookmarkItem *bookmarkItem, int position);
+	void SetMenuItemIcon(HMENU menu, int position, int iconIndex);
+	void OnIconAvailable(std::wstring_view guid, int iconIndex);
 
 	IExplorerplusplus *m_expp;
+	BookmarkTree *m_bookmarkTree;
 	IconFetcher *m_iconFetcher;
 	HMODULE m_resourceModule;
+
+	// The state associated with the current menu.
 	MenuIdRange m_menuIdRange;
 	int m_idCounter;
+	ItemIdMap *m_itemIdMap = nullptr;
+	std::vector<wil::unique_hbitmap> *m_menuImages = nullptr;
+	ItemPositionMap *m_itemPositionMap = nullptr;
+	std::unique_ptr<BookmarkIconManager> m_bookmarkIconManager;
+
+	// Maps submenus that haven't been populated yet to the GUIDs of the folders they represent.
+	// GUIDs are used, since a folder may be removed while the menu is being shown.
+	std::unordered_map<HMENU, std::wstring> m_deferredSubmenus;
+
+	// Maps the GUID of each bookmark shown to its position within the menu, so that the icon can be
+	// updated once it's been retrieved.
+	std::unordered_multimap<std::wstring, MenuPositionPair> m_bookmarkPositions;
 };
\ No newline at end of file
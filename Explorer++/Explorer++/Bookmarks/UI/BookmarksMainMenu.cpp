@@ -19,10 +19,12 @@ BookmarksMainMenu::BookmarksMainMenu(IExplorerplusplus *expp, IconFetcher *iconF
 	m_expp(expp),
 	m_bookmarkTree(bookmarkTree),
 	m_menuIdRange(menuIdRange),
-	m_menuBuilder(expp, iconFetcher, expp->GetLanguageModule())
+	m_menuBuilder(expp, bookmarkTree, iconFetcher, expp->GetLanguageModule())
 {
 	m_connections.push_back(expp->AddMainMenuPreShowObserver(
 		std::bind_front(&BookmarksMainMenu::OnMainMenuPreShow, this)));
+	m_connections.push_back(expp->AddMainMenuPopupObserver(
+		std::bind_front(&BookmarksMainMenu::OnMainMenuPopup, this)));
 }
 
 BookmarksMainMenu::~BookmarksMainMenu()
@@ -36,9 +38,13 @@ BookmarksMainMenu::~BookmarksMainMenu()
 
 void BookmarksMainMenu::OnMainMenuPreShow(HMENU mainMenu)
 {
-	std::vector<wil::unique_hbitmap> menuImages;
-	BookmarkMenuBuilder::ItemIdMap menuItemIdMappings;
-	auto bookmarksMenu = BuildMainBookmarksMenu(menuImages, menuItemIdMappings);
+	// The new menu is built directly into the member variables, since the menu builder holds on to
+	// them. The previous menu images are only released once the previous menu has been replaced.
+	auto previousMenuImages = std::move(m_menuImages);
+	m_menuImages.clear();
+	m_menuItemIdMappings.clear();
+
+	auto bookmarksMenu = BuildMainBookmarksMenu();
 
 	MENUITEMINFO mii;
 	mii.cbSize = sizeof(mii);
@@ -47,13 +53,14 @@ void BookmarksMainMenu::OnMainMenuPreShow(HMENU mainMenu)
 	SetMenuItemInfo(mainMenu, IDM_BOOKMARKS, FALSE, &mii);
 
 	m_bookmarksMenu = std::move(bookmarksMenu);
-	m_menuImages = std::move(menuImages);
-	m_menuItemIdMappings = menuItemIdMappings;
 }
 
-wil::unique_hmenu BookmarksMainMenu::BuildMainBookmarksMenu(
-	std::vector<wil::unique_hbitmap> &menuImages,
-	BookmarkMenuBuilder::ItemIdMap &menuItemIdMappings)
+void BookmarksMainMenu::OnMainMenuPopup(HMENU popupMenu)
+{
+	m_menuBuilder.OnInitMenuPopup(popupMenu);
+}
+
+wil::unique_hmenu BookmarksMainMenu::BuildMainBookmarksMenu()
 {
 	wil::unique_hmenu menu(CreatePopupMenu());
 
@@ -70,7 +77,7 @@ wil::unique_hmenu BookmarksMainMenu::BuildMainBookmarksMenu(
 	InsertMenuItem(menu.get(), 0, TRUE, &mii);
 
 	ResourceHelper::SetMenuItemImage(menu.get(), IDM_BOOKMARKS_BOOKMARKTHISTAB,
-		m_expp->GetIconResourceLoader(), Icon::AddBookmark, dpi, menuImages);
+		m_expp->GetIconResourceLoader(), Icon::AddBookmark, dpi, m_menuImages);
 
 	std::wstring bookmarkAllTabsText =
 		ResourceHelper::LoadString(m_expp->GetLanguageModule(), IDS_MENU_BOOKMARK_ALL_TABS);
@@ -93,21 +100,18 @@ wil::unique_hmenu BookmarksMainMenu::BuildMainBookmarksMenu(
 	InsertMenuItem(menu.get(), 2, TRUE, &mii);
 
 	ResourceHelper::SetMenuItemImage(menu.get(), IDM_BOOKMARKS_MANAGEBOOKMARKS,
-		m_expp->GetIconResourceLoader(), Icon::Bookmarks, dpi, menuImages);
+		m_expp->GetIconResourceLoader(), Icon::Bookmarks, dpi, m_menuImages);
 
-	int nextMenuItemId;
-	AddBookmarkItemsToMenu(menu.get(), m_menuIdRange, GetMenuItemCount(menu.get()), menuImages,
-		menuItemIdMappings, &nextMenuItemId);
+	m_menuBuilder.BeginMenu(
+		m_expp->GetMainWindow(), m_menuIdRange, m_menuItemIdMappings, m_menuImages);
 
-	AddOtherBookmarksToMenu(menu.get(), { nextMenuItemId, m_menuIdRange.endId },
-		GetMenuItemCount(menu.get()), menuImages, menuItemIdMappings);
+	AddBookmarkItemsToMenu(menu.get(), GetMenuItemCount(menu.get()));
+	AddOtherBookmarksToMenu(menu.get(), GetMenuItemCount(menu.get()));
 
 	return menu;
 }
 
-void BookmarksMainMenu::AddBookmarkItemsToMenu(HMENU menu, const MenuIdRange &menuIdRange,
-	int position, std::vector<wil::unique_hbitmap> &menuImages,
-	BookmarkMenuBuilder::ItemIdMap &menuItemIdMappings, int *maxMenuItemId)
+void BookmarksMainMenu::AddBookmarkItemsToMenu(HMENU menu, int position)
 {
 	BookmarkItem *bookmarksMenuFolder = m_bookmarkTree->GetBookmarksMenuFolder();
 
@@ -122,13 +126,10 @@ void BookmarksMainMenu::AddBookmarkItemsToMenu(HMENU menu, const MenuIdRange &me
 	mii.fType = MFT_SEPARATOR;
 	InsertMenuItem(menu, position++, TRUE, &mii);
 
-	m_menuBuilder.BuildMenu(m_expp->GetMainWindow(), menu, bookmarksMenuFolder, menuIdRange,
-		position, menuItemIdMappings, menuImages, nullptr, maxMenuItemId);
+	m_menuBuilder.AddFolderToMenu(menu, bookmarksMenuFolder, position);
 }
 
-void BookmarksMainMenu::AddOtherBookmarksToMenu(HMENU menu, const MenuIdRange &menuIdRange,
-	int position, std::vector<wil::unique_hbitmap> &menuImages,
-	BookmarkMenuBuilder::ItemIdMap &menuItemIdMappings)
+void BookmarksMainMenu::AddOtherBookmarksToMenu(HMENU menu, int position)
 {
 	BookmarkItem *otherBookmarksFolder = m_bookmarkTree->GetOtherBookmarksFolder();
 
@@ -144,10 +145,9 @@ void BookmarksMainMenu::AddOtherBookmarksToMenu(HMENU menu, const MenuIdRange &m
 	InsertMenuItem(menu, position++, TRUE, &mii);
 
 	// Note that as DestroyMenu is recursive, this menu will be destroyed when
-	// its parent menu is.
+	// its parent menu is. It will only be populated once it's shown.
 	HMENU subMenu = CreatePopupMenu();
-	m_menuBuilder.BuildMenu(m_expp->GetMainWindow(), subMenu, otherBookmarksFolder, menuIdRange, 0,
-		menuItemIdMappings, menuImages);
+	m_menuBuilder.AddDeferredSubmenu(subMenu, otherBookmarksFolder);
 
 	std::wstring otherBookmarksName = otherBookmarksFolder->GetName();
 
@@ -24,14 +24,10 @@ public:
 
 private:
 	void OnMainMenuPreShow(HMENU mainMenu);
-	wil::unique_hmenu BuildMainBookmarksMenu(std::vector<wil::unique_hbitmap> &menuImages,
-		BookmarkMenuBuilder::ItemIdMap &menuItemIdMappings);
-	void AddBookmarkItemsToMenu(HMENU menu, const MenuIdRange &menuIdRange, int position,
-		std::vector<wil::unique_hbitmap> &menuImages,
-		BookmarkMenuBuilder::ItemIdMap &menuItemIdMappings, int *maxMenuItemId);
-	void AddOtherBookmarksToMenu(HMENU menu, const MenuIdRange &menuIdRange, int position,
-		std::vector<wil::unique_hbitmap> &menuImages,
-		BookmarkMenuBuilder::ItemIdMap &menuItemIdMappings);
+	void OnMainMenuPopup(HMENU popupMenu);
+	wil::unique_hmenu BuildMainBookmarksMenu();
+	void AddBookmarkItemsToMenu(HMENU menu, int position);
+	void AddOtherBookmarksToMenu(HMENU menu, int position);
 
 	IExplorerplusplus *m_expp;
 	BookmarkTree *m_bookmarkTree;
@@ -40,8 +36,9 @@ private:
 
 	wil::unique_hmenu m_bookmarksMenu;
 
+	// The menu builder continues to add to these as submenus are shown and bookmark icons are
+	// retrieved.
 	std::vector<wil::unique_hbitmap> m_menuImages;
-
 	BookmarkMenuBuilder::ItemIdMap m_menuItemIdMappings;
 
 	std::vector<boost::signals2::scoped_connection> m_connections;
@@ -7,6 +7,7 @@
 #include "Bookmarks/BookmarkHelper.h"
 #include "Bookmarks/BookmarkIconManager.h"
 #include "Bookmarks/BookmarkNavigationController.h"
+#include "Bookmarks/BookmarkSearchIndex.h"
 #include "Bookmarks/BookmarkTree.h"
 #include "Bookmarks/UI/BookmarkTreeView.h"
 #include "CoreInterface.h"
@@ -20,6 +21,7 @@
 #include "../Helper/ListViewHelper.h"
 #include "../Helper/Macros.h"
 #include "../Helper/MenuHelper.h"
+#include "../Helper/WindowHelper.h"
 #include "../Helper/WindowSubclassWrapper.h"
 
 const TCHAR ManageBookmarksDialogPersistentSettings::SETTINGS_KEY[] = _T("ManageBookmarks");
@@ -52,6 +54,7 @@ INT_PTR ManageBookmarksDialog::OnInitDialog()
 	SetupToolbar();
 	SetupTreeView();
 	SetupListView();
+	SetupSearch();
 
 	m_navigationController =
 		std::make_unique<BookmarkNavigationController>(m_bookmarkTree, m_bookmarkListView);
@@ -81,6 +84,11 @@ void ManageBookmarksDialog::GetResizableControlInformation(
 	control.Constraint = ResizableDialog::ControlConstraint::None;
 	controlList.push_back(control);
 
+	control.iID = IDC_MANAGEBOOKMARKS_SEARCH;
+	control.Type = ResizableDialog::ControlType::Move;
+	control.Constraint = ResizableDialog::ControlConstraint::X;
+	controlList.push_back(control);
+
 	control.iID = IDOK;
 	control.Type = ResizableDialog::ControlType::Move;
 	control.Constraint = ResizableDialog::ControlConstraint::None;
@@ -167,17 +175,18 @@ void ManageBookmarksDialog::SetupToolbar()
 	GetWindowRect(GetDlgItem(m_hDlg, IDC_MANAGEBOOKMARKS_TREEVIEW), &rcTreeView);
 	MapWindowPoints(HWND_DESKTOP, m_hDlg, reinterpret_cast<LPPOINT>(&rcTreeView), 2);
 
-	RECT rcListView;
-	GetWindowRect(GetDlgItem(m_hDlg, IDC_MANAGEBOOKMARKS_LISTVIEW), &rcListView);
-	MapWindowPoints(HWND_DESKTOP, m_hDlg, reinterpret_cast<LPPOINT>(&rcListView), 2);
+	// The toolbar extends up to the search box.
+	RECT rcSearch;
+	GetWindowRect(GetDlgItem(m_hDlg, IDC_MANAGEBOOKMARKS_SEARCH), &rcSearch);
+	MapWindowPoints(HWND_DESKTOP, m_hDlg, reinterpret_cast<LPPOINT>(&rcSearch), 2);
 
 	auto dwButtonSize = static_cast<DWORD>(SendMessage(m_hToolbar, TB_GETBUTTONSIZE, 0, 0));
 
 	SetWindowPos(m_toolbarParent, nullptr, rcTreeView.left,
-		(rcTreeView.top - HIWORD(dwButtonSize)) / 2, rcListView.right - rcTreeView.left,
+		(rcTreeView.top - HIWORD(dwButtonSize)) / 2, rcSearch.left - rcTreeView.left,
 		HIWORD(dwButtonSize), 0);
 	SetWindowPos(
-		m_hToolbar, nullptr, 0, 0, rcListView.right - rcTreeView.left, HIWORD(dwButtonSize), 0);
+		m_hToolbar, nullptr, 0, 0, rcSearch.left - rcTreeView.left, HIWORD(dwButtonSize), 0);
 }
 
 void ManageBookmarksDialog::SetupTreeView()
@@ -202,6 +211,16 @@ void ManageBookmarksDialog::SetupListView()
 		std::bind_front(&ManageBookmarksDialog::OnListViewNavigation, this)));
 }
 
+void ManageBookmarksDialog::SetupSearch()
+{
+	m_searchIndex = std::make_unique<BookmarkSearchIndex>(m_bookmarkTree);
+
+	std::wstring cueBanner =
+		ResourceHelper::LoadString(GetInstance(), IDS_MANAGE_BOOKMARKS_SEARCH_CUE_BANNER);
+	Edit_SetCueBannerTextFocused(
+		GetDlgItem(m_hDlg, IDC_MANAGEBOOKMARKS_SEARCH), cueBanner.c_str(), TRUE);
+}
+
 LRESULT CALLBACK ManageBookmarksDialog::ParentWndProc(
 	HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 {
@@ -306,6 +325,12 @@ INT_PTR ManageBookmarksDialog::OnCommand(WPARAM wParam, LPARAM lParam)
 		return HandleMenuOrAccelerator(wParam);
 	}
 
+	if (HIWORD(wParam) == EN_CHANGE && LOWORD(wParam) == IDC_MANAGEBOOKMARKS_SEARCH)
+	{
+		OnSearchTextChanged();
+		return 0;
+	}
+
 	return 1;
 }
 
@@ -770,6 +795,40 @@ void ManageBookmarksDialog::OnListViewNavigation(BookmarkItem *bookmarkFolder, b
 	UpdateToolbarState();
 }
 
+// Selects the best match for the text in the search box, switching to the folder that contains it
+// if necessary. Focus is left in the search box, so that the text can continue to be refined.
+void ManageBookmarksDialog::OnSearchTextChanged()
+{
+	std::wstring text = GetWindowString(GetDlgItem(m_hDlg, IDC_MANAGEBOOKMARKS_SEARCH));
+	auto results = m_searchIndex->Search(text, 1);
+
+	if (results.empty())
+	{
+		return;
+	}
+
+	BookmarkItem *bookmarkItem = results[0];
+
+	// The permanent folders sit directly below the root folder, which is never shown, so they're
+	// opened instead.
+	if (m_bookmarkTree->IsPermanentNode(bookmarkItem))
+	{
+		if (bookmarkItem != m_currentBookmarkFolder)
+		{
+			m_navigationController->BrowseFolder(bookmarkItem);
+		}
+
+		return;
+	}
+
+	if (bookmarkItem->GetParent() != m_currentBookmarkFolder)
+	{
+		m_navigationController->BrowseFolder(bookmarkItem->GetParent());
+	}
+
+	m_bookmarkListView->SelectItem(bookmarkItem, false);
+}
+
 void ManageBookmarksDialog::UpdateToolbarState()
 {
 	SendMessage(m_hToolbar, TB_ENABLEBUTTON, TOOLBAR_ID_BACK, m_navigationController->CanGoBack());
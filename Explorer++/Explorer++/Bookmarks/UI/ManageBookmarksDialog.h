@@ -13,6 +13,7 @@
 #include <unordered_set>
 
 class BookmarkNavigationController;
+class BookmarkSearchIndex;
 class BookmarkTree;
 class BookmarkTreeView;
 class IconFetcher;
@@ -79,12 +80,14 @@ private:
 	void SetupToolbar();
 	void SetupTreeView();
 	void SetupListView();
+	void SetupSearch();
 
 	LRESULT CALLBACK ParentWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
 	std::optional<LRESULT> OnToolbarCustomDraw(NMTBCUSTOMDRAW *customDraw);
 
 	void OnTreeViewSelectionChanged(BookmarkItem *bookmarkFolder);
 	void OnListViewNavigation(BookmarkItem *bookmarkFolder, bool addHistoryEntry);
+	void OnSearchTextChanged();
 
 	void UpdateToolbarState();
 
@@ -129,6 +132,9 @@ private:
 
 	std::unique_ptr<BookmarkNavigationController> m_navigationController;
 
+	// Used to find the first bookmark that matches the text entered into the search box.
+	std::unique_ptr<BookmarkSearchIndex> m_searchIndex;
+
 	std::vector<std::unique_ptr<WindowSubclassWrapper>> m_windowSubclasses;
 	std::vector<boost::signals2::scoped_connection> m_connections;
 
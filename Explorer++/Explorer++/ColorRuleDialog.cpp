@@ -9,6 +9,7 @@
 #include "ResourceHelper.h"
 #include "../Helper/Helper.h"
 #include "../Helper/Macros.h"
+#include "../Helper/RegistrySettings.h"
 #include "../Helper/StringHelper.h"
 #include "../Helper/WindowHelper.h"
 #include "../Helper/XMLSettings.h"
@@ -294,11 +295,11 @@ void ColorRuleDialogPersistentSettings::SaveExtraRegistrySettings(HKEY hKey)
 void ColorRuleDialogPersistentSettings::LoadExtraRegistrySettings(HKEY hKey)
 {
 	DWORD dwSize = sizeof(m_cfInitialColor);
-	RegQueryValueEx(hKey, SETTING_INITIAL_COLOR, nullptr, nullptr,
+	RegistrySettings::QueryValue(hKey, SETTING_INITIAL_COLOR, nullptr,
 		reinterpret_cast<LPBYTE>(&m_cfInitialColor), &dwSize);
 
 	dwSize = sizeof(m_cfCustomColors);
-	RegQueryValueEx(hKey, SETTING_CUSTOM_COLORS, nullptr, nullptr,
+	RegistrySettings::QueryValue(hKey, SETTING_CUSTOM_COLORS, nullptr,
 		reinterpret_cast<LPBYTE>(&m_cfCustomColors), &dwSize);
 }
 
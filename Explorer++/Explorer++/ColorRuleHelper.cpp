@@ -8,7 +8,9 @@
 #include "ResourceHelper.h"
 #include "../Helper/Macros.h"
 #include "../Helper/RegistrySettings.h"
+#include "../Helper/RegistryValueCache.h"
 #include "../Helper/XMLSettings.h"
+#include "../Helper/XmlStreamReader.h"
 #include <wil/com.h>
 #include <comdef.h>
 #include <vector>
@@ -85,6 +87,8 @@ namespace
 
 			if (res == ERROR_SUCCESS)
 			{
+				RegistryValueCache colorRuleValues(hKeyChild);
+
 				NColorRuleHelper::ColorRule colorRule;
 
 				colorRule.caseInsensitive = FALSE;
@@ -100,7 +104,7 @@ namespace
 
 				DWORD dwType = REG_BINARY;
 				DWORD dwSize = sizeof(colorRule.rgbColour);
-				RegQueryValueEx(hKeyChild, _T("Color"), nullptr, &dwType,
+				RegistrySettings::QueryValue(hKeyChild, _T("Color"), &dwType,
 					reinterpret_cast<LPBYTE>(&colorRule.rgbColour), &dwSize);
 
 				if (lDescriptionStatus == ERROR_SUCCESS && lFilenamePatternStatus == ERROR_SUCCESS)
@@ -169,37 +173,54 @@ namespace
 }
 
 void NColorRuleHelper::LoadColorRulesFromXML(
-	IXMLDOMDocument *pXMLDom, std::vector<NColorRuleHelper::ColorRule> &ColorRules)
+	IStream *stream, std::vector<NColorRuleHelper::ColorRule> &ColorRules)
 {
-	if (!pXMLDom)
+	if (!stream)
 	{
 		return;
 	}
 
-	wil::com_ptr_nothrow<IXMLDOMNode> pNode;
-	auto bstr = wil::make_bstr_nothrow(L"//ColorRule");
-	HRESULT hr = pXMLDom->selectSingleNode(bstr.get(), &pNode);
+	auto reader = XmlStreamReader::Create(stream);
 
-	if (hr == S_OK)
+	if (!reader)
 	{
-		ColorRules.clear();
-		LoadColorRulesFromXMLInternal(pNode.get(), ColorRules);
+		return;
 	}
-}
 
-namespace
-{
-	void LoadColorRulesFromXMLInternal(
-		IXMLDOMNode *pNode, std::vector<NColorRuleHelper::ColorRule> &ColorRules)
+	XmlStreamReader::Element element;
+	bool inColorRulesSection = false;
+	bool colorRulesFound = false;
+
+	while (reader->ReadNextElement(element))
 	{
-		wil::com_ptr_nothrow<IXMLDOMNamedNodeMap> am;
-		HRESULT hr = pNode->get_attributes(&am);
+		if (element.depth == 1)
+		{
+			inColorRulesSection = (element.name == L"ColorRules");
+			continue;
+		}
 
-		if (FAILED(hr))
+		if (!inColorRulesSection || element.depth != 2 || element.name != L"ColorRule")
 		{
-			return;
+			continue;
 		}
 
+		/* The existing rules are only replaced if the file actually
+		contains a set of rules. */
+		if (!colorRulesFound)
+		{
+			ColorRules.clear();
+			colorRulesFound = true;
+		}
+
+		LoadColorRuleFromXMLElement(element, ColorRules);
+	}
+}
+
+namespace
+{
+	void LoadColorRuleFromXMLElement(
+		const XmlStreamReader::Element &element, std::vector<NColorRuleHelper::ColorRule> &ColorRules)
+	{
 		NColorRuleHelper::ColorRule colorRule;
 		colorRule.caseInsensitive = FALSE;
 
@@ -209,51 +230,39 @@ namespace
 		BYTE g = 0;
 		BYTE b = 0;
 
-		long nAttributeNodes;
-		am->get_length(&nAttributeNodes);
-
-		for (long i = 0; i < nAttributeNodes; i++)
+		for (const auto &[name, value] : element.attributes)
 		{
-			wil::com_ptr_nothrow<IXMLDOMNode> pAttributeNode;
-			am->get_item(i, &pAttributeNode);
-
-			wil::unique_bstr bstrName;
-			pAttributeNode->get_nodeName(&bstrName);
-
-			wil::unique_bstr bstrValue;
-			pAttributeNode->get_text(&bstrValue);
-
-			if (lstrcmpi(bstrName.get(), L"Name") == 0)
+			if (lstrcmpi(name.c_str(), L"Name") == 0)
 			{
-				colorRule.strDescription = _bstr_t(bstrValue.get());
+				colorRule.strDescription = value;
 
 				bDescriptionFound = TRUE;
 			}
-			else if (lstrcmpi(bstrName.get(), L"FilenamePattern") == 0)
+			else if (lstrcmpi(name.c_str(), L"FilenamePattern") == 0)
 			{
-				colorRule.strFilterPattern = _bstr_t(bstrValue.get());
+				colorRule.strFilterPattern = value;
 
 				bFilenamePatternFound = TRUE;
 			}
-			else if (lstrcmpi(bstrName.get(), L"CaseInsensitive") == 0)
+			else if (lstrcmpi(name.c_str(), L"CaseInsensitive") == 0)
 			{
-				colorRule.caseInsensitive = NXMLSettings::DecodeBoolValue(bstrValue.get());
+				colorRule.caseInsensitive = NXMLSettings::DecodeBoolValue(value.c_str());
 			}
-			else if (lstrcmpi(bstrName.get(), L"Attributes") == 0)
+			else if (lstrcmpi(name.c_str(), L"Attributes") == 0)
 			{
-				colorRule.dwFilterAttributes = NXMLSettings::DecodeIntValue(bstrValue.get());
+				colorRule.dwFilterAttributes = NXMLSettings::DecodeIntValue(value.c_str());
 			}
-			else if (lstrcmpi(bstrName.get(), L"r") == 0)
+			else if (lstrcmpi(name.c_str(), L"r") == 0)
 			{
-				r = static_cast<BYTE>(NXMLSettings::DecodeIntValue(bstrValue.get()));
+				r = static_cast<BYTE>(NXMLSettings::DecodeIntValue(value.c_str()));
 			}
-			else if (lstrcmpi(bstrName.get(), L"g") == 0)
+			else if (lstrcmpi(name.c_str(), L"g") == 0)
 			{
-				g = static_cast<BYTE>(NXMLSettings::DecodeIntValue(bstrValue.get()));
+				g = static_cast<BYTE>(NXMLSettings::DecodeIntValue(value.c_str()));
 			}
-			else if (lstrcmpi(bstrName.get(), L"b") == 0)
+			else if (lstrcmpi(name.c_str(), L"b") == 0)
 			{
-				b = static_cast<BYTE>(NXMLSettings::DecodeIntValue(bstrValue.get()));
+				b = static_cast<BYTE>(NXMLSettings::DecodeIntValue(value.c_str()));
 			}
 		}
 
@@ -263,20 +272,6 @@ namespace
 
 			ColorRules.push_back(colorRule);
 		}
-
-		wil::com_ptr_nothrow<IXMLDOMNode> pNextSibling;
-		hr = pNode->get_nextSibling(&pNextSibling);
-
-		if (hr == S_OK)
-		{
-			wil::com_ptr_nothrow<IXMLDOMNode> secondSibling;
-			hr = pNextSibling->get_nextSibling(&secondSibling);
-
-			if (hr == S_OK)
-			{
-				LoadColorRulesFromXMLInternal(secondSibling.get(), ColorRules);
-			}
-		}
 	}
 }
 
@@ -26,7 +26,7 @@ namespace NColorRuleHelper
 	void LoadColorRulesFromRegistry(std::vector<ColorRule> &ColorRules);
 	void SaveColorRulesToRegistry(const std::vector<ColorRule> &ColorRules);
 
-	void LoadColorRulesFromXML(IXMLDOMDocument *pXMLDom, std::vector<ColorRule> &ColorRules);
+	void LoadColorRulesFromXML(IStream *stream, std::vector<ColorRule> &ColorRules);
 	void SaveColorRulesToXML(
 		IXMLDOMDocument *pXMLDom, IXMLDOMElement *pRoot, const std::vector<ColorRule> &ColorRules);
 }
\ No newline at end of file
@@ -4,9 +4,12 @@
 
 #include "stdafx.h"
 #include "CommandLine.h"
+#include "BatchMode.h"
 #include "Explorer++_internal.h"
 #include "MainResource.h"
 #include "ResourceHelper.h"
+#include "ShellExtensionHost.h"
+#include "ShellExtensionHostPool.h"
 #include "Version.h"
 #include "../Helper/Macros.h"
 #include "../Helper/ProcessHelper.h"
@@ -54,6 +57,7 @@ struct CommandLineSettings
 	bool clearRegistrySettings;
 	bool enableLogging;
 	bool enablePlugins;
+	bool isolateShellExtensions;
 	bool registerForShellNotifications;
 	bool removeAsDefault;
 	ReplaceExplorerMode replaceExplorerMode;
@@ -114,6 +118,13 @@ std::optional<CommandLine::ExitInfo> CommandLine::ProcessCommandLine()
 		"Enable the Lua plugin system"
 	);
 
+	commandLineSettings.isolateShellExtensions = false;
+	app.add_flag(
+		"--isolate-shell-extensions",
+		commandLineSettings.isolateShellExtensions,
+		"Run thumbnail and property handlers in separate processes"
+	);
+
 	commandLineSettings.registerForShellNotifications = false;
 	app.add_flag(
 		"--register-for-shell-notifications",
@@ -147,6 +158,11 @@ std::optional<CommandLine::ExitInfo> CommandLine::ProcessCommandLine()
 		"Allows you to select your desired language. Should be a two-letter language code (e.g. FR, RU, etc)."
 	);
 
+	app.add_flag(
+		wstrToUtf8Str(BatchMode::ARGUMENT),
+		"Run a bulk operation without showing any windows (see --batch --help)"
+	);
+
 	app.add_option(
 		"directories",
 		commandLineSettings.directories,
@@ -181,6 +197,26 @@ std::optional<CommandLine::ExitInfo> CommandLine::ProcessCommandLine()
 		LocalFree(args);
 	});
 
+	// Batch mode has its own set of options, so the remaining arguments are processed separately.
+	// Nothing else on the command line applies in that case.
+	if (numArgs > 1 && lstrcmp(args[1], BatchMode::ARGUMENT) == 0)
+	{
+		std::vector<std::string> batchArgs;
+
+		for (int i = 2; i < numArgs; i++)
+		{
+			batchArgs.emplace_back(wstrToUtf8Str(args[i]));
+		}
+
+		return ExitInfo{ BatchMode::Run(batchArgs) };
+	}
+
+	// Likewise, a shell extension host only needs the arguments that identify its parent.
+	if (numArgs > 1 && lstrcmp(args[1], ShellExtensionHost::ARGUMENT) == 0)
+	{
+		return ExitInfo{ ShellExtensionHost::Run({ args + 2, args + numArgs }) };
+	}
+
 	std::vector<std::string> utf8Args;
 
 	for (int i = numArgs - 1; i > 0; i--)
@@ -271,6 +307,11 @@ std::optional<CommandLine::ExitInfo> ProcessCommandLineSettings(
 		g_enablePlugins = true;
 	}
 
+	if (commandLineSettings.isolateShellExtensions)
+	{
+		ShellExtensionHostPool::GetInstance().SetEnabled(true);
+	}
+
 	if (commandLineSettings.registerForShellNotifications)
 	{
 		g_registerForShellNotifications = true;
@@ -309,6 +350,54 @@ std::optional<CommandLine::ExitInfo> ProcessCommandLineSettings(
 	return std::nullopt;
 }
 
+void CommandLine::OpenControlPanelChildrenInExplorer(std::vector<std::wstring> &directories)
+{
+	unique_pidl_absolute pidlControlPanel;
+	HRESULT hr = SHGetFolderLocation(nullptr, CSIDL_CONTROLS, nullptr, 0,
+		wil::out_param(pidlControlPanel));
+
+	if (FAILED(hr))
+	{
+		return;
+	}
+
+	unique_pidl_absolute pidlControlPanelCategory;
+	SHParseDisplayName(CONTROL_PANEL_CATEGORY_VIEW, nullptr,
+		wil::out_param(pidlControlPanelCategory), 0, nullptr);
+
+	auto isChildOf = [](PCIDLIST_ABSOLUTE parent, PCIDLIST_ABSOLUTE pidl) {
+		return parent && ILIsParent(parent, pidl, FALSE) && !ArePidlsEquivalent(parent, pidl);
+	};
+
+	auto itr = directories.begin();
+
+	while (itr != directories.end())
+	{
+		// This could fail on a 64-bit version of Windows if the executable is 32-bit, and the
+		// folder is 64-bit specific (as is the case with some of the folders under the control
+		// panel).
+		unique_pidl_absolute pidl;
+		hr = SHParseDisplayName(itr->c_str(), nullptr, wil::out_param(pidl), 0, nullptr);
+
+		if (SUCCEEDED(hr)
+			&& (isChildOf(pidlControlPanel.get(), pidl.get())
+				|| isChildOf(pidlControlPanelCategory.get(), pidl.get())))
+		{
+			TCHAR szExplorerPath[MAX_PATH];
+			MyExpandEnvironmentStrings(
+				_T("%windir%\\explorer.exe"), szExplorerPath, SIZEOF_ARRAY(szExplorerPath));
+
+			ShellExecute(nullptr, _T("open"), szExplorerPath, itr->c_str(), nullptr, SW_SHOWNORMAL);
+
+			itr = directories.erase(itr);
+		}
+		else
+		{
+			++itr;
+		}
+	}
+}
+
 void OnClearRegistrySettings()
 {
 	LSTATUS lStatus;
@@ -5,6 +5,8 @@
 #pragma once
 
 #include <optional>
+#include <string>
+#include <vector>
 
 namespace CommandLine
 {
@@ -14,4 +16,8 @@ namespace CommandLine
 	};
 
 	std::optional<ExitInfo> ProcessCommandLine();
+
+	// Folders that are children of the control panel can't be opened, so they're passed to Windows
+	// Explorer instead. Any such folders are removed from the list.
+	void OpenControlPanelChildrenInExplorer(std::vector<std::wstring> &directories);
 }
\ No newline at end of file
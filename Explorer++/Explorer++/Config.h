@@ -57,7 +57,7 @@ struct Config
 		useFullRowSelect = FALSE;
 		showFilePreviews = TRUE;
 		extendTabControl = FALSE;
-		allowMultipleInstances = TRUE;
+		allowMultipleInstances.set(TRUE);
 		doubleClickTabClose = TRUE;
 		useLargeToolbarIcons.set(FALSE);
 		handleZipFiles = FALSE;
@@ -72,6 +72,13 @@ struct Config
 		treeViewWidth = DEFAULT_TREEVIEW_WIDTH;
 		checkPinnedToNamespaceTreeProperty = false;
 		registerForShellNotifications = false;
+		virtualListViewThreshold = DEFAULT_VIRTUAL_LISTVIEW_THRESHOLD;
+		useGridRenderer = false;
+		persistFolderSizes = false;
+		persistIconCache = false;
+		persistClosedTabs = false;
+		useNativeFileTransfers = false;
+		fileTransferBandwidthLimit = 0;
 
 		replaceExplorerMode = DefaultFileManager::ReplaceExplorerMode::None;
 
@@ -140,6 +147,8 @@ struct Config
 
 	static const UINT DEFAULT_TREEVIEW_WIDTH = 208;
 
+	static const UINT DEFAULT_VIRTUAL_LISTVIEW_THRESHOLD = 50000;
+
 	DWORD language;
 	IconTheme iconTheme;
 	bool enableDarkMode;
@@ -164,7 +173,7 @@ struct Config
 	BOOL useFullRowSelect;
 	BOOL showFilePreviews;
 	BOOL extendTabControl;
-	BOOL allowMultipleInstances;
+	ValueWrapper<BOOL> allowMultipleInstances;
 	BOOL doubleClickTabClose;
 	ValueWrapper<BOOL> useLargeToolbarIcons;
 	BOOL handleZipFiles;
@@ -180,6 +189,36 @@ struct Config
 	bool checkPinnedToNamespaceTreeProperty;
 	bool registerForShellNotifications;
 
+	// Folders containing at least this many items will be shown using an owner data (virtual)
+	// listview. A value of 0 disables this.
+	unsigned int virtualListViewThreshold;
+
+	// If set, the owner data listview will be drawn using Direct2D and DirectWrite in details
+	// mode, rather than by the listview itself.
+	bool useGridRenderer;
+
+	// If set, calculated folder sizes will be saved on exit and reloaded on startup, so that they
+	// don't need to be calculated again in the next session.
+	bool persistFolderSizes;
+
+	// If set, the locations of the icons shown for files and folders will be saved on exit, so
+	// that those icons can be shown straight away in the next session.
+	bool persistIconCache;
+
+	// If set, the list of recently closed tabs will be saved on exit, so that those tabs can still
+	// be reopened in the next session.
+	bool persistClosedTabs;
+
+	// If set, copying or moving file system items to a folder will be done directly (using
+	// several threads), rather than through the shell. Transfers that need the shell (e.g. because
+	// there's a naming conflict) will still go through the shell. Transfers started through "Copy
+	// To Folder" or "Move To Folder" are queued and run in the background.
+	bool useNativeFileTransfers;
+
+	// The maximum combined rate (in KB per second) of the transfers that are run in the background
+	// when native file transfers are enabled. A value of 0 means the rate is unlimited.
+	unsigned int fileTransferBandwidthLimit;
+
 	DefaultFileManager::ReplaceExplorerMode replaceExplorerMode;
 
 	BOOL showInfoTips;
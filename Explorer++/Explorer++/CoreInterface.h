@@ -30,6 +30,7 @@ enum class WindowFocusSource
 
 using TabsInitializedSignal = boost::signals2::signal<void()>;
 using MainMenuPreShowSignal = boost::signals2::signal<void(HMENU mainMenu)>;
+using MainMenuPopupSignal = boost::signals2::signal<void(HMENU popupMenu)>;
 using ToolbarContextMenuSignal =
 	boost::signals2::signal<void(HMENU menu, HWND sourceWindow, const POINT &pt)>;
 using FocusChangedSignal = boost::signals2::signal<void(WindowFocusSource windowFocusSource)>;
@@ -37,6 +38,7 @@ using ApplicationShuttingDownSignal = boost::signals2::signal<void()>;
 
 class CachedIcons;
 struct Config;
+class FileOperationQueue;
 class IconResourceLoader;
 __interface IDirectoryMonitor;
 class ShellBrowser;
@@ -44,6 +46,11 @@ class StatusBar;
 class TabContainer;
 class TabRestorer;
 
+namespace Plugins
+{
+	class PluginManager;
+}
+
 /* Basic interface between Explorerplusplus
 and some of the other components (such as the
 dialogs and toolbars). */
@@ -61,6 +68,12 @@ __interface IExplorerplusplus
 	TabRestorer *GetTabRestorer() const;
 	IDirectoryMonitor *GetDirectoryMonitor() const;
 
+	// May return null (e.g. while the application is shutting down).
+	FileOperationQueue *GetFileOperationQueue() const;
+
+	// Returns null if plugins aren't enabled.
+	Plugins::PluginManager *GetPluginManager() const;
+
 	IconResourceLoader *GetIconResourceLoader() const;
 	CachedIcons *GetCachedIcons();
 
@@ -105,6 +118,11 @@ __interface IExplorerplusplus
 		const TabsInitializedSignal::slot_type &observer);
 	boost::signals2::connection AddMainMenuPreShowObserver(
 		const MainMenuPreShowSignal::slot_type &observer);
+
+	// Triggered whenever a popup menu owned by the main window (e.g. a drop-down menu or submenu
+	// of the main menu) is about to be shown.
+	boost::signals2::connection AddMainMenuPopupObserver(
+		const MainMenuPopupSignal::slot_type &observer);
 	boost::signals2::connection AddToolbarContextMenuObserver(
 		const ToolbarContextMenuSignal::slot_type &observer);
 	boost::signals2::connection AddFocusChangeObserver(
@@ -5,30 +5,41 @@
 #include "stdafx.h"
 #include "DarkModeButton.h"
 #include "DarkModeHelper.h"
+#include "UiTheming.h"
 #include "../Helper/Controls.h"
 #include "../Helper/DpiCompatibility.h"
+#include "../Helper/ThemeResourceCache.h"
 #include "../Helper/WindowHelper.h"
+#include <VSStyle.h>
 
 // Also applies to radio buttons.
 constexpr int CHECKBOX_TEXT_SPACING_96DPI = 3;
 
 void DarkModeButton::DrawButtonText(const NMCUSTOMDRAW *customDraw, ButtonType buttonType)
 {
+	UINT dpi = DpiCompatibility::GetInstance().GetDpiForWindow(customDraw->hdr.hwndFrom);
+
 	// The size of the interactive element of the control (i.e. the check box or radio button
-	// part).
+	// part). The themed size is cached, so that the theme doesn't need to be opened each time the
+	// button is drawn.
+	std::optional<SIZE> themedElementSize;
 	SIZE elementSize;
 
 	if (buttonType == ButtonType::Checkbox)
 	{
-		elementSize = GetCheckboxSize(customDraw->hdr.hwndFrom);
+		themedElementSize = UiTheming::GetThemeResourceCache().GetThemePartSize(
+			L"BUTTON", dpi, BP_CHECKBOX, CBS_UNCHECKEDNORMAL);
+		elementSize = themedElementSize ? *themedElementSize
+										: GetCheckboxSize(customDraw->hdr.hwndFrom);
 	}
 	else
 	{
-		elementSize = GetRadioButtonSize(customDraw->hdr.hwndFrom);
+		themedElementSize = UiTheming::GetThemeResourceCache().GetThemePartSize(
+			L"BUTTON", dpi, BP_RADIOBUTTON, RBS_UNCHECKEDNORMAL);
+		elementSize = themedElementSize ? *themedElementSize
+										: GetRadioButtonSize(customDraw->hdr.hwndFrom);
 	}
 
-	UINT dpi = DpiCompatibility::GetInstance().GetDpiForWindow(customDraw->hdr.hwndFrom);
-
 	RECT textRect = customDraw->rc;
 	textRect.left +=
 		elementSize.cx + MulDiv(CHECKBOX_TEXT_SPACING_96DPI, dpi, USER_DEFAULT_SCREEN_DPI);
@@ -5,11 +5,13 @@
 #include "stdafx.h"
 #include "DarkModeGroupBox.h"
 #include "DarkModeHelper.h"
+#include "UiTheming.h"
 #include "../Helper/DpiCompatibility.h"
+#include "../Helper/ThemeResourceCache.h"
 #include "../Helper/WindowHelper.h"
 #include <VSStyle.h>
 
-DarkModeGroupBox::DarkModeGroupBox(HWND groupBox) : m_theme(OpenThemeData(nullptr, L"BUTTON"))
+DarkModeGroupBox::DarkModeGroupBox(HWND groupBox)
 {
 	m_windowSubclass = std::make_unique<WindowSubclassWrapper>(groupBox,
 		std::bind_front(&DarkModeGroupBox::WndProc, this), 0);
@@ -41,15 +43,10 @@ void DarkModeGroupBox::OnPaint(HWND hwnd)
 	SetBkMode(hdc, TRANSPARENT);
 	SetTextColor(hdc, DarkModeHelper::TEXT_COLOR);
 
-	auto &dpiCompat = DpiCompatibility::GetInstance();
+	UINT dpi = DpiCompatibility::GetInstance().GetDpiForWindow(hwnd);
+	auto &themeResources = UiTheming::GetThemeResourceCache();
 
-	NONCLIENTMETRICS metrics;
-	metrics.cbSize = sizeof(metrics);
-	dpiCompat.SystemParametersInfoForDpi(
-		SPI_GETNONCLIENTMETRICS, sizeof(metrics), &metrics, 0, dpiCompat.GetDpiForWindow(hwnd));
-
-	wil::unique_hfont captionFont(CreateFontIndirect(&metrics.lfCaptionFont));
-	wil::unique_select_object object(SelectObject(hdc, captionFont.get()));
+	wil::unique_select_object object(SelectObject(hdc, themeResources.GetCaptionFont(dpi)));
 
 	RECT textRect = rect;
 	DrawText(hdc, text.c_str(), static_cast<int>(text.size()), &textRect, DT_CALCRECT);
@@ -62,7 +59,8 @@ void DarkModeGroupBox::OnPaint(HWND hwnd)
 
 	// The group box border isn't shown behind the caption; instead, the text appears as if its
 	// drawn directly on top of the parent.
-	DrawThemeBackground(m_theme.get(), hdc, BP_GROUPBOX, GBS_NORMAL, &groupBoxRect, &ps.rcPaint);
+	DrawThemeBackground(themeResources.GetTheme(L"BUTTON", dpi), hdc, BP_GROUPBOX, GBS_NORMAL,
+		&groupBoxRect, &ps.rcPaint);
 
 	// It appears this offset isn't DPI-adjusted.
 	OffsetRect(&textRect, 9, 0);
@@ -4,6 +4,8 @@
 
 #include "stdafx.h"
 #include "DarkModeHelper.h"
+#include "UiTheming.h"
+#include "../Helper/ThemeResourceCache.h"
 #include <wil/common.h>
 
 DarkModeHelper &DarkModeHelper::GetInstance()
@@ -173,12 +175,7 @@ bool DarkModeHelper::IsDarkModeEnabled() const
 
 HBRUSH DarkModeHelper::GetBackgroundBrush()
 {
-	if (!m_backgroundBrush)
-	{
-		m_backgroundBrush.reset(CreateSolidBrush(BACKGROUND_COLOR));
-	}
-
-	return m_backgroundBrush.get();
+	return UiTheming::GetThemeResourceCache().GetSolidBrush(BACKGROUND_COLOR);
 }
 
 void DarkModeHelper::SetListViewDarkModeColors(HWND listView)
@@ -121,5 +121,4 @@ private:
 	wil::unique_hmodule m_uxThemeLib;
 	bool m_darkModeSupported;
 	bool m_darkModeEnabled;
-	wil::unique_hbrush m_backgroundBrush;
 };
\ No newline at end of file
@@ -60,7 +60,9 @@ static const Column_t REAL_FOLDER_DEFAULT_COLUMNS[] ={
 	{ColumnType::MediaProducer, FALSE, DEFAULT_COLUMN_WIDTH},
 	{ColumnType::MediaPublisher, FALSE, DEFAULT_COLUMN_WIDTH},
 	{ColumnType::MediaWriter, FALSE, DEFAULT_COLUMN_WIDTH},
-	{ColumnType::MediaYear, FALSE, DEFAULT_COLUMN_WIDTH}
+	{ColumnType::MediaYear, FALSE, DEFAULT_COLUMN_WIDTH},
+	{ColumnType::Checksum, FALSE, DEFAULT_COLUMN_WIDTH},
+	{ColumnType::RelativePath, FALSE, DEFAULT_COLUMN_WIDTH}
 };
 
 static const Column_t MY_COMPUTER_DEFAULT_COLUMNS[] = {
@@ -12,6 +12,13 @@
 #include "../Helper/RegistrySettings.h"
 #include "../Helper/StringHelper.h"
 #include "../Helper/XMLSettings.h"
+#include <algorithm>
+#include <thread>
+
+namespace NDestroyFilesDialog
+{
+	const int WM_APP_DESTROYFINISHED = WM_APP + 1;
+}
 
 const TCHAR DestroyFilesDialogPersistentSettings::SETTINGS_KEY[] = _T("DestroyFiles");
 
@@ -20,7 +27,11 @@ const TCHAR DestroyFilesDialogPersistentSettings::SETTING_OVERWRITE_METHOD[] =
 
 DestroyFilesDialog::DestroyFilesDialog(HINSTANCE hInstance, HWND hParent,
 	const std::list<std::wstring> &FullFilenameList, BOOL bShowFriendlyDates) :
-	DarkModeDialogBase(hInstance, IDD_DESTROYFILES, hParent, true)
+	DarkModeDialogBase(hInstance, IDD_DESTROYFILES, hParent, true),
+	m_destroying(false),
+	m_cancelled(false),
+	m_progress(0),
+	m_filesRemaining(0)
 {
 	m_FullFilenameList = FullFilenameList;
 	m_bShowFriendlyDates = bShowFriendlyDates;
@@ -174,6 +185,16 @@ void DestroyFilesDialog::GetResizableControlInformation(
 	control.Constraint = ResizableDialog::ControlConstraint::X;
 	ControlList.push_back(control);
 
+	control.iID = IDC_DESTROYFILES_PROGRESS;
+	control.Type = ResizableDialog::ControlType::Move;
+	control.Constraint = ResizableDialog::ControlConstraint::Y;
+	ControlList.push_back(control);
+
+	control.iID = IDC_DESTROYFILES_PROGRESS;
+	control.Type = ResizableDialog::ControlType::Resize;
+	control.Constraint = ResizableDialog::ControlConstraint::X;
+	ControlList.push_back(control);
+
 	control.iID = IDOK;
 	control.Type = ResizableDialog::ControlType::Move;
 	control.Constraint = ResizableDialog::ControlConstraint::None;
@@ -215,9 +236,34 @@ INT_PTR DestroyFilesDialog::OnCommand(WPARAM wParam, LPARAM lParam)
 	return 0;
 }
 
+INT_PTR DestroyFilesDialog::OnTimer(int iTimerID)
+{
+	if (iTimerID == PROGRESS_TIMER_ID)
+	{
+		SendDlgItemMessage(m_hDlg, IDC_DESTROYFILES_PROGRESS, PBM_SETPOS, m_progress, 0);
+	}
+
+	return 0;
+}
+
 INT_PTR DestroyFilesDialog::OnClose()
 {
-	EndDialog(m_hDlg, 0);
+	OnCancel();
+	return 0;
+}
+
+INT_PTR DestroyFilesDialog::OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
+{
+	UNREFERENCED_PARAMETER(wParam);
+	UNREFERENCED_PARAMETER(lParam);
+
+	switch (uMsg)
+	{
+	case NDestroyFilesDialog::WM_APP_DESTROYFINISHED:
+		OnDestroyFinished();
+		break;
+	}
+
 	return 0;
 }
 
@@ -239,6 +285,11 @@ void DestroyFilesDialog::SaveState()
 
 void DestroyFilesDialog::OnOk()
 {
+	if (m_destroying)
+	{
+		return;
+	}
+
 	TCHAR szConfirmation[128];
 	LoadString(GetInstance(), IDS_DESTROY_FILES_CONFIRMATION, szConfirmation,
 		SIZEOF_ARRAY(szConfirmation));
@@ -262,6 +313,16 @@ void DestroyFilesDialog::OnOk()
 
 void DestroyFilesDialog::OnCancel()
 {
+	if (m_destroying)
+	{
+		/* Any files that have already been overwritten will still be
+		deleted. The dialog will close once the worker threads have
+		finished. */
+		m_cancelled = true;
+		EnableWindow(GetDlgItem(m_hDlg, IDCANCEL), FALSE);
+		return;
+	}
+
 	EndDialog(m_hDlg, 0);
 }
 
@@ -278,12 +339,80 @@ void DestroyFilesDialog::OnConfirmDestroy()
 		overwriteMethod = NFileOperations::OverwriteMethod::ThreePass;
 	}
 
-	/* TODO: Perform in background thread. */
+	if (m_FullFilenameList.empty())
+	{
+		EndDialog(m_hDlg, 1);
+		return;
+	}
+
+	m_destroying = true;
+
+	EnableWindow(GetDlgItem(m_hDlg, IDOK), FALSE);
+	EnableWindow(GetDlgItem(m_hDlg, IDC_DESTROYFILES_RADIO_ONEPASS), FALSE);
+	EnableWindow(GetDlgItem(m_hDlg, IDC_DESTROYFILES_RADIO_THREEPASS), FALSE);
+
+	auto numFiles = static_cast<int>(m_FullFilenameList.size());
+	SendDlgItemMessage(m_hDlg, IDC_DESTROYFILES_PROGRESS, PBM_SETRANGE32, 0,
+		numFiles * PROGRESS_UNITS_PER_FILE);
+
+	m_filesRemaining = numFiles;
+
+	/* Overwriting is limited by the speed of the disk, rather than
+	the CPU, so only a few files are processed at once. */
+	int numThreads = std::clamp(static_cast<int>(std::thread::hardware_concurrency()), 1,
+		(std::min)(numFiles, MAX_DESTROY_THREADS));
+	m_threadPool = std::make_unique<ctpl::thread_pool>(numThreads);
+
 	for (const auto &strFullFilename : m_FullFilenameList)
 	{
-		DeleteFileSecurely(strFullFilename, overwriteMethod);
+		m_threadPool->push(
+			[this, strFullFilename, overwriteMethod](int id)
+			{
+				UNREFERENCED_PARAMETER(id);
+
+				DestroyFile(strFullFilename, overwriteMethod);
+			});
 	}
 
+	SetTimer(m_hDlg, PROGRESS_TIMER_ID, PROGRESS_TIMER_INTERVAL, nullptr);
+}
+
+/* Runs on one of the worker threads. */
+void DestroyFilesDialog::DestroyFile(
+	const std::wstring &strFullFilename, NFileOperations::OverwriteMethod overwriteMethod)
+{
+	int fileProgress = 0;
+
+	if (!m_cancelled)
+	{
+		NFileOperations::DeleteFileSecurely(strFullFilename, overwriteMethod,
+			[this, &fileProgress](ULONGLONG bytesWritten, ULONGLONG totalBytes)
+			{
+				auto newProgress =
+					static_cast<int>(bytesWritten * PROGRESS_UNITS_PER_FILE / totalBytes);
+				m_progress += newProgress - fileProgress;
+				fileProgress = newProgress;
+
+				return !m_cancelled;
+			});
+	}
+
+	/* Files that were skipped (or that couldn't be overwritten) still
+	count as processed. */
+	m_progress += PROGRESS_UNITS_PER_FILE - fileProgress;
+
+	if (--m_filesRemaining == 0)
+	{
+		PostMessage(m_hDlg, NDestroyFilesDialog::WM_APP_DESTROYFINISHED, 0, 0);
+	}
+}
+
+void DestroyFilesDialog::OnDestroyFinished()
+{
+	KillTimer(m_hDlg, PROGRESS_TIMER_ID);
+
+	m_destroying = false;
+
 	EndDialog(m_hDlg, 1);
 }
 
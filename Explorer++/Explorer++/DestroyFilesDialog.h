@@ -8,7 +8,10 @@
 #include "../Helper/DialogSettings.h"
 #include "../Helper/FileOperations.h"
 #include "../Helper/ResizableDialog.h"
+#include "../ThirdParty/CTPL/cpl_stl.h"
 #include <wil/resource.h>
+#include <atomic>
+#include <memory>
 
 class DestroyFilesDialog;
 
@@ -48,9 +51,23 @@ protected:
 	INT_PTR OnInitDialog() override;
 	INT_PTR OnCtlColorStaticExtra(HWND hwnd, HDC hdc) override;
 	INT_PTR OnCommand(WPARAM wParam, LPARAM lParam) override;
+	INT_PTR OnTimer(int iTimerID) override;
 	INT_PTR OnClose() override;
 
+	INT_PTR OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lParam) override;
+
 private:
+	/* Files are overwritten in parallel, using up to this many
+	threads. */
+	static const int MAX_DESTROY_THREADS = 4;
+
+	/* The progress of each file is tracked in these units, so that
+	all files contribute equally to the progress bar. */
+	static const int PROGRESS_UNITS_PER_FILE = 1000;
+
+	static const UINT_PTR PROGRESS_TIMER_ID = 1;
+	static const UINT PROGRESS_TIMER_INTERVAL = 100;
+
 	void GetResizableControlInformation(BaseDialog::DialogSizeConstraint &dsc,
 		std::list<ResizableDialog::Control> &ControlList) override;
 	void SaveState() override;
@@ -58,6 +75,9 @@ private:
 	void OnOk();
 	void OnCancel();
 	void OnConfirmDestroy();
+	void DestroyFile(
+		const std::wstring &strFullFilename, NFileOperations::OverwriteMethod overwriteMethod);
+	void OnDestroyFinished();
 
 	std::list<std::wstring> m_FullFilenameList;
 
@@ -66,4 +86,13 @@ private:
 	DestroyFilesDialogPersistentSettings *m_pdfdps;
 
 	BOOL m_bShowFriendlyDates;
+
+	bool m_destroying;
+	std::atomic<bool> m_cancelled;
+	std::atomic<int> m_progress;
+	std::atomic<int> m_filesRemaining;
+
+	/* Declared last, so that any running tasks finish before the
+	rest of the members are destroyed. */
+	std::unique_ptr<ctpl::thread_pool> m_threadPool;
 };
\ No newline at end of file
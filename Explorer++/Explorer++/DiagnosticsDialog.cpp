@@ -0,0 +1,197 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "DiagnosticsDialog.h"
+#include "CoreInterface.h"
+#include "MainResource.h"
+#include "ResourceHelper.h"
+#include "Plugins/PluginManager.h"
+#include "ShellBrowser/ShellBrowser.h"
+#include "../Helper/StringHelper.h"
+#include "../Helper/WindowHelper.h"
+#include <boost/format.hpp>
+#include <cmath>
+
+DiagnosticsDialog::DiagnosticsDialog(HINSTANCE hInstance, HWND hParent, IExplorerplusplus *expp) :
+	DarkModeDialogBase(hInstance, IDD_DIAGNOSTICS, hParent, true),
+	m_expp(expp)
+{
+}
+
+INT_PTR DiagnosticsDialog::OnInitDialog()
+{
+	Refresh();
+
+	SetTimer(m_hDlg, REFRESH_TIMER_ID, REFRESH_TIMER_INTERVAL, nullptr);
+
+	return TRUE;
+}
+
+void DiagnosticsDialog::GetResizableControlInformation(
+	BaseDialog::DialogSizeConstraint &dsc, std::list<ResizableDialog::Control> &ControlList)
+{
+	dsc = BaseDialog::DialogSizeConstraint::None;
+
+	ResizableDialog::Control control;
+	control.iID = IDC_DIAGNOSTICS_TEXT;
+	control.Type = ResizableDialog::ControlType::Resize;
+	control.Constraint = ResizableDialog::ControlConstraint::None;
+	ControlList.push_back(control);
+}
+
+INT_PTR DiagnosticsDialog::OnTimer(int iTimerID)
+{
+	if (iTimerID == REFRESH_TIMER_ID)
+	{
+		Refresh();
+	}
+
+	return 0;
+}
+
+void DiagnosticsDialog::Refresh()
+{
+	const ShellBrowser *shellBrowser = m_expp->GetActiveShellBrowser();
+	BrowserDiagnostics diagnostics = shellBrowser->GetDiagnostics();
+
+	Sample currentSample;
+	currentSample.browserId = shellBrowser->GetId();
+	currentSample.time = std::chrono::steady_clock::now();
+	currentSample.columnResultsProcessed = diagnostics.columnResultsProcessed;
+	currentSample.thumbnailResultsProcessed = diagnostics.thumbnailResultsProcessed;
+	currentSample.iconResultsProcessed = diagnostics.iconResultsProcessed;
+
+	// The counters are per-browser, so if the active tab has changed, the previous sample can't
+	// be used.
+	if (m_previousSample && m_previousSample->browserId != currentSample.browserId)
+	{
+		m_previousSample.reset();
+	}
+
+	std::wstring report = FormatReport(diagnostics, currentSample) + FormatPluginReport();
+
+	HWND textControl = GetDlgItem(m_hDlg, IDC_DIAGNOSTICS_TEXT);
+
+	// Setting the text resets the scroll position, so it's only done if something has changed.
+	if (GetWindowString(textControl) != report)
+	{
+		SetWindowText(textControl, report.c_str());
+	}
+
+	m_previousSample = currentSample;
+}
+
+std::wstring DiagnosticsDialog::FormatReport(
+	const BrowserDiagnostics &diagnostics, const Sample &currentSample)
+{
+	const NavigationTiming &timing = diagnostics.lastNavigation;
+
+	std::wstring pending = ResourceHelper::LoadString(GetInstance(), IDS_DIAGNOSTICS_PENDING);
+	std::wstring source = timing.fromSnapshot
+		? ResourceHelper::LoadString(GetInstance(), IDS_DIAGNOSTICS_FROM_SNAPSHOT)
+		: L"";
+
+	std::wstring columnRate = pending;
+	std::wstring thumbnailRate = pending;
+	std::wstring iconRate = pending;
+
+	if (m_previousSample)
+	{
+		auto elapsed = currentSample.time - m_previousSample->time;
+		columnRate = FormatRate(currentSample.columnResultsProcessed,
+			m_previousSample->columnResultsProcessed, elapsed);
+		thumbnailRate = FormatRate(currentSample.thumbnailResultsProcessed,
+			m_previousSample->thumbnailResultsProcessed, elapsed);
+		iconRate = FormatRate(currentSample.iconResultsProcessed,
+			m_previousSample->iconResultsProcessed, elapsed);
+	}
+
+	std::wstring reportTemplate =
+		ResourceHelper::LoadString(GetInstance(), IDS_DIAGNOSTICS_REPORT);
+
+	return (boost::wformat(reportTemplate) % source % FormatDuration(timing.bind)
+		% (timing.completed ? FormatDuration(timing.enumerate) : pending)
+		% (timing.completed ? FormatDuration(timing.itemInfo) : pending)
+		% FormatDuration(timing.insert) % FormatDuration(timing.sort)
+		% (timing.painted ? FormatDuration(timing.firstPaint) : pending)
+		% (timing.painted ? FormatDuration(timing.total) : pending) % timing.numItems
+		% diagnostics.pendingColumnTasks % columnRate % diagnostics.pendingThumbnailTasks
+		% thumbnailRate % diagnostics.pendingIconTasks % iconRate % diagnostics.numItems
+		% FormatSize(diagnostics.itemInfoBytes) % FormatSize(diagnostics.imageListBytes))
+		.str();
+}
+
+std::wstring DiagnosticsDialog::FormatPluginReport()
+{
+	const Plugins::PluginManager *pluginManager = m_expp->GetPluginManager();
+
+	if (!pluginManager)
+	{
+		return L"";
+	}
+
+	std::wstring report = ResourceHelper::LoadString(GetInstance(), IDS_DIAGNOSTICS_PLUGINS);
+	std::wstring pluginTemplate =
+		ResourceHelper::LoadString(GetInstance(), IDS_DIAGNOSTICS_PLUGIN_MEMORY);
+
+	for (const auto &memoryUsage : pluginManager->getMemoryUsage())
+	{
+		const auto &stats = memoryUsage.stats;
+
+		report += (boost::wformat(pluginTemplate) % memoryUsage.name
+			% FormatSize(stats.allocator.bytesInUse) % FormatSize(stats.allocator.peakBytesInUse)
+			% FormatSize(stats.allocator.bytesReserved) % FormatSize(stats.softLimit)
+			% FormatSize(stats.hardLimit) % stats.allocator.numAllocations
+			% stats.allocator.numRefusedAllocations % stats.numSoftLimitCollections)
+			.str();
+	}
+
+	return report;
+}
+
+std::wstring DiagnosticsDialog::FormatDuration(std::chrono::microseconds duration)
+{
+	std::wstring durationTemplate =
+		ResourceHelper::LoadString(GetInstance(), IDS_DIAGNOSTICS_MILLISECONDS);
+	std::wstring milliseconds =
+		(boost::wformat(L"%.1f") % (static_cast<double>(duration.count()) / 1000.0)).str();
+	return (boost::wformat(durationTemplate) % milliseconds).str();
+}
+
+std::wstring DiagnosticsDialog::FormatRate(
+	uint64_t current, uint64_t previous, std::chrono::steady_clock::duration elapsed)
+{
+	double seconds = std::chrono::duration<double>(elapsed).count();
+
+	if (seconds <= 0)
+	{
+		return L"0";
+	}
+
+	return std::to_wstring(std::lround(static_cast<double>(current - previous) / seconds));
+}
+
+std::wstring DiagnosticsDialog::FormatSize(size_t bytes)
+{
+	ULARGE_INTEGER size;
+	size.QuadPart = bytes;
+
+	TCHAR sizeText[32];
+	FormatSizeString(size, sizeText, std::size(sizeText));
+	return sizeText;
+}
+
+INT_PTR DiagnosticsDialog::OnClose()
+{
+	DestroyWindow(m_hDlg);
+	return 0;
+}
+
+INT_PTR DiagnosticsDialog::OnNcDestroy()
+{
+	delete this;
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "DarkModeDialogBase.h"
+#include "ShellBrowser/NavigationDiagnostics.h"
+#include <chrono>
+#include <optional>
+
+__interface IExplorerplusplus;
+
+// Shows how long the last navigation in the active tab took, broken down by stage, along with the
+// state of the background tasks, the approximate memory used by the items in the folder and the
+// memory used by each plugin. The information is refreshed once a second while the dialog is open.
+class DiagnosticsDialog : public DarkModeDialogBase
+{
+public:
+	DiagnosticsDialog(HINSTANCE hInstance, HWND hParent, IExplorerplusplus *expp);
+
+protected:
+	INT_PTR OnInitDialog() override;
+	INT_PTR OnTimer(int iTimerID) override;
+	INT_PTR OnClose() override;
+	INT_PTR OnNcDestroy() override;
+
+private:
+	static const UINT_PTR REFRESH_TIMER_ID = 1;
+	static const UINT REFRESH_TIMER_INTERVAL = 1000;
+
+	// The counters from the previous refresh. The throughput of each type of task is calculated
+	// from the difference between two samples.
+	struct Sample
+	{
+		int browserId;
+		std::chrono::steady_clock::time_point time;
+		uint64_t columnResultsProcessed;
+		uint64_t thumbnailResultsProcessed;
+		uint64_t iconResultsProcessed;
+	};
+
+	void GetResizableControlInformation(BaseDialog::DialogSizeConstraint &dsc,
+		std::list<ResizableDialog::Control> &ControlList) override;
+
+	void Refresh();
+	std::wstring FormatReport(const BrowserDiagnostics &diagnostics, const Sample &currentSample);
+	std::wstring FormatPluginReport();
+	std::wstring FormatDuration(std::chrono::microseconds duration);
+	static std::wstring FormatRate(uint64_t current, uint64_t previous,
+		std::chrono::steady_clock::duration elapsed);
+	static std::wstring FormatSize(size_t bytes);
+
+	IExplorerplusplus *m_expp;
+	std::optional<Sample> m_previousSample;
+};
\ No newline at end of file
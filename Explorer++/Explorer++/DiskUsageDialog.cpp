@@ -0,0 +1,514 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "DiskUsageDialog.h"
+#include "MainResource.h"
+#include "ResourceHelper.h"
+#include "../Helper/DpiCompatibility.h"
+#include "../Helper/FolderSizeCache.h"
+#include "../Helper/StringHelper.h"
+#include "../Helper/WindowHelper.h"
+#include <boost/format.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+// Folders are colored by depth, so that neighboring levels can be told apart.
+const COLORREF FOLDER_COLORS[] = { RGB(141, 182, 205), RGB(155, 205, 155), RGB(238, 203, 173),
+	RGB(205, 181, 205), RGB(238, 230, 133), RGB(176, 196, 222) };
+const COLORREF FILES_COLOR = RGB(220, 220, 220);
+const COLORREF OTHER_COLOR = RGB(180, 180, 180);
+const COLORREF BORDER_COLOR = RGB(96, 96, 96);
+
+std::wstring FormatSize(ULONGLONG bytes)
+{
+	ULARGE_INTEGER size;
+	size.QuadPart = bytes;
+
+	TCHAR sizeText[32];
+	FormatSizeString(size, sizeText, std::size(sizeText));
+	return sizeText;
+}
+
+RECT ToRect(const TreemapRect &rect)
+{
+	return { static_cast<LONG>(std::lround(rect.left)), static_cast<LONG>(std::lround(rect.top)),
+		static_cast<LONG>(std::lround(rect.left + rect.width)),
+		static_cast<LONG>(std::lround(rect.top + rect.height)) };
+}
+
+int ScaleForDpi(int value, UINT dpi)
+{
+	return MulDiv(value, dpi, USER_DEFAULT_SCREEN_DPI);
+}
+
+}
+
+DiskUsageDialog::DiskUsageDialog(HINSTANCE hInstance, HWND hParent, const std::wstring &rootPath) :
+	DarkModeDialogBase(hInstance, IDD_DISK_USAGE, hParent, true),
+	m_tree(rootPath)
+{
+}
+
+INT_PTR DiskUsageDialog::OnInitDialog()
+{
+	m_treemapSubclass = std::make_unique<WindowSubclassWrapper>(
+		GetDlgItem(m_hDlg, IDC_DISK_USAGE_TREEMAP),
+		std::bind_front(&DiskUsageDialog::TreemapWndProc, this), 0);
+
+	AllowDarkModeForControls({ IDC_DISK_USAGE_UP, IDCANCEL });
+
+	const DiskUsageNode *root = nullptr;
+	m_tree.Read([&root](const DiskUsageNode &treeRoot) { root = &treeRoot; });
+	SetViewRoot(root);
+	StartBuild();
+
+	return TRUE;
+}
+
+void DiskUsageDialog::GetResizableControlInformation(
+	BaseDialog::DialogSizeConstraint &dsc, std::list<ResizableDialog::Control> &ControlList)
+{
+	dsc = BaseDialog::DialogSizeConstraint::None;
+
+	ResizableDialog::Control control;
+
+	control.iID = IDC_DISK_USAGE_TREEMAP;
+	control.Type = ResizableDialog::ControlType::Resize;
+	control.Constraint = ResizableDialog::ControlConstraint::None;
+	ControlList.push_back(control);
+
+	control.iID = IDC_DISK_USAGE_STATUS;
+	control.Type = ResizableDialog::ControlType::Move;
+	control.Constraint = ResizableDialog::ControlConstraint::Y;
+	ControlList.push_back(control);
+
+	control.iID = IDC_DISK_USAGE_STATUS;
+	control.Type = ResizableDialog::ControlType::Resize;
+	control.Constraint = ResizableDialog::ControlConstraint::X;
+	ControlList.push_back(control);
+
+	control.iID = IDC_DISK_USAGE_UP;
+	control.Type = ResizableDialog::ControlType::Move;
+	control.Constraint = ResizableDialog::ControlConstraint::None;
+	ControlList.push_back(control);
+
+	control.iID = IDCANCEL;
+	control.Type = ResizableDialog::ControlType::Move;
+	control.Constraint = ResizableDialog::ControlConstraint::None;
+	ControlList.push_back(control);
+}
+
+void DiskUsageDialog::StartBuild()
+{
+	HWND dialog = m_hDlg;
+
+	m_buildThread = std::jthread([this, dialog](std::stop_token stopToken) {
+		m_tree.Build(stopToken, nullptr, &FolderSizeCache::GetInstance());
+
+		if (!stopToken.stop_requested())
+		{
+			PostMessage(dialog, WM_APP_BUILD_FINISHED, 0, 0);
+		}
+	});
+
+	UpdateStatusText();
+	SetTimer(m_hDlg, REFRESH_TIMER_ID, REFRESH_TIMER_INTERVAL, nullptr);
+}
+
+INT_PTR DiskUsageDialog::OnTimer(int iTimerID)
+{
+	if (iTimerID == REFRESH_TIMER_ID && m_tree.GetVersion() != m_lastDrawnVersion)
+	{
+		UpdateStatusText();
+		InvalidateRect(GetDlgItem(m_hDlg, IDC_DISK_USAGE_TREEMAP), nullptr, FALSE);
+	}
+
+	return 0;
+}
+
+INT_PTR DiskUsageDialog::OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
+{
+	UNREFERENCED_PARAMETER(wParam);
+	UNREFERENCED_PARAMETER(lParam);
+
+	switch (uMsg)
+	{
+	case WM_APP_BUILD_FINISHED:
+		OnBuildFinished();
+		break;
+	}
+
+	return 0;
+}
+
+void DiskUsageDialog::OnBuildFinished()
+{
+	KillTimer(m_hDlg, REFRESH_TIMER_ID);
+
+	// The thread has already finished at this point, so this won't block.
+	m_buildThread.join();
+
+	UpdateStatusText();
+	InvalidateRect(GetDlgItem(m_hDlg, IDC_DISK_USAGE_TREEMAP), nullptr, FALSE);
+}
+
+void DiskUsageDialog::UpdateStatusText()
+{
+	ULONGLONG totalSize = 0;
+	m_tree.Read([&totalSize](const DiskUsageNode &root) { totalSize = root.totalSize; });
+
+	UINT stringId = m_tree.IsComplete() ? IDS_DISK_USAGE_FINISHED : IDS_DISK_USAGE_SCANNING;
+	std::wstring statusTemplate = ResourceHelper::LoadString(GetInstance(), stringId);
+	SetStatusText((boost::wformat(statusTemplate) % FormatSize(totalSize)).str());
+}
+
+void DiskUsageDialog::SetStatusText(const std::wstring &text)
+{
+	SetDlgItemText(m_hDlg, IDC_DISK_USAGE_STATUS, text.c_str());
+}
+
+void DiskUsageDialog::SetViewRoot(const DiskUsageNode *viewRoot)
+{
+	m_viewRoot = viewRoot;
+
+	EnableWindow(GetDlgItem(m_hDlg, IDC_DISK_USAGE_UP), viewRoot->parent != nullptr);
+
+	std::wstring title = ResourceHelper::LoadString(GetInstance(), IDS_DISK_USAGE_TITLE);
+	SetWindowText(m_hDlg, (boost::wformat(title) % m_tree.GetPath(*viewRoot)).str().c_str());
+
+	InvalidateRect(GetDlgItem(m_hDlg, IDC_DISK_USAGE_TREEMAP), nullptr, FALSE);
+}
+
+LRESULT DiskUsageDialog::TreemapWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
+{
+	switch (msg)
+	{
+	case WM_ERASEBKGND:
+		return 1;
+
+	case WM_PAINT:
+		OnPaintTreemap(hwnd);
+		return 0;
+
+	case WM_SIZE:
+		InvalidateRect(hwnd, nullptr, FALSE);
+		break;
+
+	case WM_LBUTTONDOWN:
+		OnTreemapClick({ GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam) });
+		break;
+
+	case WM_LBUTTONDBLCLK:
+		OnTreemapDoubleClick({ GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam) });
+		break;
+	}
+
+	return DefSubclassProc(hwnd, msg, wParam, lParam);
+}
+
+void DiskUsageDialog::OnPaintTreemap(HWND hwnd)
+{
+	PAINTSTRUCT ps;
+	HDC hdc = BeginPaint(hwnd, &ps);
+
+	RECT clientRect;
+	GetClientRect(hwnd, &clientRect);
+
+	// The treemap is drawn into an offscreen bitmap first, so that redrawing it while the tree is
+	// being built doesn't cause any flicker.
+	wil::unique_hdc memoryDC(CreateCompatibleDC(hdc));
+	wil::unique_hbitmap bitmap(CreateCompatibleBitmap(
+		hdc, GetRectWidth(&clientRect), GetRectHeight(&clientRect)));
+	auto previousBitmap = wil::SelectObject(memoryDC.get(), bitmap.get());
+
+	auto font = reinterpret_cast<HFONT>(SendMessage(m_hDlg, WM_GETFONT, 0, 0));
+	auto previousFont = wil::SelectObject(memoryDC.get(), font);
+
+	TEXTMETRIC textMetrics;
+	GetTextMetrics(memoryDC.get(), &textMetrics);
+
+	UINT dpi = DpiCompatibility::GetInstance().GetDpiForWindow(hwnd);
+
+	// The layout is recalculated on every paint. That's cheap, since the number of tiles is bound
+	// by the size of the window, rather than by the number of folders in the tree.
+	m_lastDrawnVersion = m_tree.GetVersion();
+	LayoutTiles(clientRect, textMetrics.tmHeight + ScaleForDpi(2, dpi), dpi);
+
+	FillRect(memoryDC.get(), &clientRect, GetSysColorBrush(COLOR_WINDOW));
+	DrawTiles(memoryDC.get(), ScaleForDpi(3, dpi));
+
+	BitBlt(hdc, 0, 0, GetRectWidth(&clientRect), GetRectHeight(&clientRect), memoryDC.get(), 0,
+		0, SRCCOPY);
+
+	EndPaint(hwnd, &ps);
+}
+
+void DiskUsageDialog::LayoutTiles(const RECT &bounds, int labelHeight, UINT dpi)
+{
+	m_tiles.clear();
+
+	// The view root is part of the tree, so its contents can only be read while the tree is
+	// locked.
+	m_tree.Read([this, &bounds, labelHeight, dpi](const DiskUsageNode &) {
+		TreemapRect treemapBounds = { static_cast<double>(bounds.left),
+			static_cast<double>(bounds.top), static_cast<double>(GetRectWidth(&bounds)),
+			static_cast<double>(GetRectHeight(&bounds)) };
+		AddContentTiles(*m_viewRoot, treemapBounds, 0, labelHeight, dpi);
+	});
+}
+
+void DiskUsageDialog::AddFolderTile(const DiskUsageNode &node, const TreemapRect &bounds,
+	int depth, int labelHeight, UINT dpi)
+{
+	RECT rect = ToRect(bounds);
+
+	// The folder's name is shown along the top of the tile, provided there's room for it.
+	int tileLabelHeight = (GetRectHeight(&rect) >= labelHeight * 3) ? labelHeight : 0;
+	m_tiles.push_back({ rect, TileType::Folder, depth, node.totalSize, tileLabelHeight, &node });
+
+	int minNestedSize = ScaleForDpi(MIN_NESTED_TILE_SIZE, dpi);
+
+	if (depth >= MAX_NESTING_DEPTH || GetRectWidth(&rect) < minNestedSize
+		|| GetRectHeight(&rect) < minNestedSize)
+	{
+		return;
+	}
+
+	double border = ScaleForDpi(2, dpi);
+	double header = (tileLabelHeight > 0) ? tileLabelHeight : border;
+	TreemapRect innerBounds = { bounds.left + border, bounds.top + header,
+		bounds.width - (border * 2), bounds.height - header - border };
+
+	if (innerBounds.width <= 0 || innerBounds.height <= 0)
+	{
+		return;
+	}
+
+	AddContentTiles(node, innerBounds, depth + 1, labelHeight, dpi);
+}
+
+void DiskUsageDialog::AddContentTiles(const DiskUsageNode &node, const TreemapRect &bounds,
+	int depth, int labelHeight, UINT dpi)
+{
+	if (node.totalSize == 0)
+	{
+		return;
+	}
+
+	std::vector<TileItem> items;
+
+	for (const auto &child : node.children)
+	{
+		if (child->totalSize > 0)
+		{
+			items.push_back({ child->totalSize, TileType::Folder, child.get() });
+		}
+	}
+
+	if (node.filesSize > 0)
+	{
+		items.push_back({ node.filesSize, TileType::Files, &node });
+	}
+
+	std::sort(items.begin(), items.end(),
+		[](const TileItem &item1, const TileItem &item2) { return item1.size > item2.size; });
+
+	// Anything that would be too small to see is merged into a single tile. Since the items are
+	// sorted, these are all at the end.
+	double scale = (bounds.width * bounds.height) / static_cast<double>(node.totalSize);
+	double minTileSize = ScaleForDpi(MIN_TILE_SIZE, dpi);
+	double minTileArea = minTileSize * minTileSize;
+	auto firstSmallItr = std::find_if(items.begin(), items.end(),
+		[scale, minTileArea](const TileItem &item) { return item.size * scale < minTileArea; });
+
+	if (std::distance(firstSmallItr, items.end()) > 1)
+	{
+		ULONGLONG otherSize = 0;
+
+		for (auto itr = firstSmallItr; itr != items.end(); ++itr)
+		{
+			otherSize += itr->size;
+		}
+
+		items.erase(firstSmallItr, items.end());
+
+		auto insertItr = std::find_if(items.begin(), items.end(),
+			[otherSize](const TileItem &item) { return item.size < otherSize; });
+		items.insert(insertItr, TileItem{ otherSize, TileType::Other, &node });
+	}
+
+	std::vector<double> sizes;
+	sizes.reserve(items.size());
+
+	for (const auto &item : items)
+	{
+		sizes.push_back(static_cast<double>(item.size));
+	}
+
+	auto rects = LayoutSquarifiedTreemap(sizes, bounds);
+
+	for (size_t i = 0; i < items.size(); i++)
+	{
+		if (items[i].type == TileType::Folder)
+		{
+			AddFolderTile(*items[i].node, rects[i], depth, labelHeight, dpi);
+		}
+		else
+		{
+			m_tiles.push_back({ ToRect(rects[i]), items[i].type, depth, items[i].size, 0,
+				items[i].node });
+		}
+	}
+}
+
+void DiskUsageDialog::DrawTiles(HDC hdc, int padding)
+{
+	wil::unique_hbrush borderBrush(CreateSolidBrush(BORDER_COLOR));
+	SetBkMode(hdc, TRANSPARENT);
+	SetTextColor(hdc, RGB(0, 0, 0));
+
+	for (const auto &tile : m_tiles)
+	{
+		COLORREF color;
+
+		switch (tile.type)
+		{
+		case TileType::Folder:
+			color = FOLDER_COLORS[tile.depth % std::size(FOLDER_COLORS)];
+			break;
+
+		case TileType::Files:
+			color = FILES_COLOR;
+			break;
+
+		case TileType::Other:
+		default:
+			color = OTHER_COLOR;
+			break;
+		}
+
+		wil::unique_hbrush brush(CreateSolidBrush(color));
+		FillRect(hdc, &tile.rect, brush.get());
+		FrameRect(hdc, &tile.rect, borderBrush.get());
+
+		if (tile.labelHeight == 0)
+		{
+			continue;
+		}
+
+		// The name of a node doesn't change once the node has been created, so this doesn't need
+		// to be done while the tree is locked.
+		RECT labelRect = { tile.rect.left + padding, tile.rect.top, tile.rect.right - padding,
+			tile.rect.top + tile.labelHeight };
+		DrawText(hdc, tile.node->name.c_str(), static_cast<int>(tile.node->name.size()),
+			&labelRect, DT_SINGLELINE | DT_VCENTER | DT_END_ELLIPSIS | DT_NOPREFIX);
+	}
+}
+
+const DiskUsageDialog::Tile *DiskUsageDialog::GetTileAtPoint(POINT pt) const
+{
+	// Nested tiles are drawn after the folders that contain them, so the last matching tile is
+	// the innermost one.
+	auto itr = std::find_if(m_tiles.rbegin(), m_tiles.rend(),
+		[pt](const Tile &tile) { return PtInRect(&tile.rect, pt); });
+
+	if (itr == m_tiles.rend())
+	{
+		return nullptr;
+	}
+
+	return &*itr;
+}
+
+void DiskUsageDialog::OnTreemapClick(POINT pt)
+{
+	const Tile *tile = GetTileAtPoint(pt);
+
+	if (!tile)
+	{
+		return;
+	}
+
+	UINT stringId;
+
+	switch (tile->type)
+	{
+	case TileType::Folder:
+		stringId = IDS_DISK_USAGE_FOLDER;
+		break;
+
+	case TileType::Files:
+		stringId = IDS_DISK_USAGE_FILES;
+		break;
+
+	case TileType::Other:
+	default:
+		stringId = IDS_DISK_USAGE_OTHER;
+		break;
+	}
+
+	std::wstring textTemplate = ResourceHelper::LoadString(GetInstance(), stringId);
+	SetStatusText(
+		(boost::wformat(textTemplate) % m_tree.GetPath(*tile->node) % FormatSize(tile->size))
+			.str());
+}
+
+void DiskUsageDialog::OnTreemapDoubleClick(POINT pt)
+{
+	const Tile *tile = GetTileAtPoint(pt);
+
+	if (!tile || tile->type != TileType::Folder)
+	{
+		return;
+	}
+
+	// Zoom into the outermost folder below the current view that contains the point, so that
+	// each double-click descends a single level.
+	const DiskUsageNode *node = tile->node;
+
+	while (node->parent != m_viewRoot)
+	{
+		node = node->parent;
+	}
+
+	SetViewRoot(node);
+}
+
+INT_PTR DiskUsageDialog::OnCommand(WPARAM wParam, LPARAM lParam)
+{
+	UNREFERENCED_PARAMETER(lParam);
+
+	switch (LOWORD(wParam))
+	{
+	case IDC_DISK_USAGE_UP:
+		if (m_viewRoot->parent)
+		{
+			SetViewRoot(m_viewRoot->parent);
+		}
+		break;
+
+	case IDCANCEL:
+		DestroyWindow(m_hDlg);
+		break;
+	}
+
+	return 0;
+}
+
+INT_PTR DiskUsageDialog::OnClose()
+{
+	DestroyWindow(m_hDlg);
+	return 0;
+}
+
+INT_PTR DiskUsageDialog::OnNcDestroy()
+{
+	delete this;
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,125 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "DarkModeDialogBase.h"
+#include "../Helper/DiskUsageTree.h"
+#include "../Helper/Treemap.h"
+#include "../Helper/WindowSubclassWrapper.h"
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Shows where the space within a folder is being used, as a squarified treemap of its subfolders.
+// The tree of folder sizes is built on a background thread and the treemap is redrawn periodically
+// while that happens, so the largest folders appear almost immediately. Folders that have been
+// cached by FolderSizeCache (e.g. because their size has been shown in a listview) aren't
+// enumerated again, which makes reopening the view for the same folder close to instant.
+//
+// The size of the treemap only depends on the size of the window, not on the number of folders:
+// folders too small to be seen are merged into a single tile and nesting stops once tiles become
+// too small to contain anything useful. Files are shown as a single tile within each folder.
+class DiskUsageDialog : public DarkModeDialogBase
+{
+public:
+	DiskUsageDialog(HINSTANCE hInstance, HWND hParent, const std::wstring &rootPath);
+
+protected:
+	INT_PTR OnInitDialog() override;
+	INT_PTR OnCommand(WPARAM wParam, LPARAM lParam) override;
+	INT_PTR OnTimer(int iTimerID) override;
+	INT_PTR OnClose() override;
+	INT_PTR OnNcDestroy() override;
+	INT_PTR OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lParam) override;
+
+private:
+	static const UINT_PTR REFRESH_TIMER_ID = 1;
+	static const UINT REFRESH_TIMER_INTERVAL = 200;
+
+	// Posted by the background thread once the tree has been built.
+	static const UINT WM_APP_BUILD_FINISHED = WM_APP + 1;
+
+	// Tiles with less area than a square of this size (in pixels, at 96 DPI) are merged into a
+	// single tile.
+	static const int MIN_TILE_SIZE = 8;
+
+	// Folders are only subdivided while they're at least this wide and tall (at 96 DPI).
+	static const int MIN_NESTED_TILE_SIZE = 24;
+
+	static const int MAX_NESTING_DEPTH = 16;
+
+	enum class TileType
+	{
+		Folder,
+
+		// The files directly within a folder.
+		Files,
+
+		// Subfolders that were too small to be shown individually.
+		Other
+	};
+
+	struct Tile
+	{
+		RECT rect;
+		TileType type;
+		int depth;
+		ULONGLONG size;
+
+		// The height of the folder name shown along the top of the tile, or 0 if there's no room
+		// for it.
+		int labelHeight;
+
+		// For Files and Other tiles, this is the folder containing the items.
+		const DiskUsageNode *node;
+	};
+
+	struct TileItem
+	{
+		ULONGLONG size;
+		TileType type;
+		const DiskUsageNode *node;
+	};
+
+	void GetResizableControlInformation(BaseDialog::DialogSizeConstraint &dsc,
+		std::list<ResizableDialog::Control> &ControlList) override;
+
+	void StartBuild();
+	void OnBuildFinished();
+	void UpdateStatusText();
+	void SetStatusText(const std::wstring &text);
+	void SetViewRoot(const DiskUsageNode *viewRoot);
+
+	LRESULT TreemapWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
+	void OnPaintTreemap(HWND hwnd);
+	void LayoutTiles(const RECT &bounds, int labelHeight, UINT dpi);
+	void AddFolderTile(const DiskUsageNode &node, const TreemapRect &bounds, int depth,
+		int labelHeight, UINT dpi);
+	void AddContentTiles(const DiskUsageNode &node, const TreemapRect &bounds, int depth,
+		int labelHeight, UINT dpi);
+	void DrawTiles(HDC hdc, int padding);
+	const Tile *GetTileAtPoint(POINT pt) const;
+	void OnTreemapClick(POINT pt);
+	void OnTreemapDoubleClick(POINT pt);
+
+	DiskUsageTree m_tree;
+
+	// The folder currently shown in the treemap. Nodes are never removed from the tree, so this
+	// remains valid for as long as the tree does.
+	const DiskUsageNode *m_viewRoot = nullptr;
+
+	// The tiles that were last drawn, in the order they were drawn. Used to determine which tile
+	// was clicked.
+	std::vector<Tile> m_tiles;
+
+	int m_lastDrawnVersion = -1;
+
+	std::unique_ptr<WindowSubclassWrapper> m_treemapSubclass;
+
+	// Declared last, so that the build is stopped (and the thread joined) before the tree is
+	// destroyed.
+	std::jthread m_buildThread;
+};
\ No newline at end of file
@@ -9,11 +9,17 @@
 #include "MainResource.h"
 #include "ShellBrowser/ShellBrowser.h"
 #include "TabContainer.h"
-#include "../Helper/FolderSize.h"
+#include "../Helper/FolderSizeCache.h"
 #include "../Helper/ShellHelper.h"
+#include "../Helper/ThreadQos.h"
+#include "../Helper/WicImageLoader.h"
+#include <algorithm>
 
 void Explorerplusplus::UpdateDisplayWindow(const Tab &tab)
 {
+	// Any details that are still being read are for the previous selection.
+	CancelDisplayWindowDetails();
+
 	DisplayWindow_ClearTextBuffer(m_hDisplayWindow);
 
 	int nSelected = tab.GetShellBrowser()->GetNumSelected();
@@ -36,7 +42,7 @@ void Explorerplusplus::UpdateDisplayWindowForZeroFiles(const Tab &tab)
 {
 	/* Clear out any previous data shown in the display window. */
 	DisplayWindow_ClearTextBuffer(m_hDisplayWindow);
-	DisplayWindow_SetThumbnailFile(m_hDisplayWindow, EMPTY_STRING, FALSE);
+	DisplayWindow_SetThumbnailFile(m_hDisplayWindow, nullptr, FALSE);
 
 	std::wstring currentDirectory = tab.GetShellBrowser()->GetDirectory();
 	auto pidlDirectory = tab.GetShellBrowser()->GetDirectoryIdl();
@@ -117,60 +123,26 @@ void Explorerplusplus::UpdateDisplayWindowForOneFile(const Tab &tab)
 
 			wfd = tab.GetShellBrowser()->GetItemFileFindData(iSelected);
 
-			dwAttributes = GetFileAttributes(fullItemName.c_str());
+			// The attributes were read when the item was enumerated, so there's no need to query the
+			// file system again.
+			dwAttributes = wfd.dwFileAttributes;
 
 			if (((dwAttributes & FILE_ATTRIBUTE_DIRECTORY) == FILE_ATTRIBUTE_DIRECTORY)
 				&& m_config->globalFolderSettings.showFolderSizes)
 			{
-				FolderSize_t *pfs = nullptr;
-				FolderSizeExtraInfo *pfsei = nullptr;
-				DWFolderSize displayWindowFolderSize;
 				TCHAR szDisplayText[256];
 				TCHAR szTotalSize[64];
 				TCHAR szCalculating[64];
-				DWORD threadId;
-
-				pfs = (FolderSize_t *) malloc(sizeof(FolderSize_t));
-
-				if (pfs != nullptr)
-				{
-					pfsei = (FolderSizeExtraInfo *) malloc(sizeof(FolderSizeExtraInfo));
-
-					if (pfsei != nullptr)
-					{
-						pfsei->pContainer = (void *) this;
-						pfsei->uId = m_iDWFolderSizeUniqueId;
-						pfs->pData = (LPVOID) pfsei;
-
-						pfs->pfnCallback = FolderSizeCallbackStub;
-
-						StringCchCopy(pfs->szPath, SIZEOF_ARRAY(pfs->szPath), fullItemName.c_str());
-
-						LoadString(m_hLanguageModule, IDS_GENERAL_TOTALSIZE, szTotalSize,
-							SIZEOF_ARRAY(szTotalSize));
-						LoadString(m_hLanguageModule, IDS_GENERAL_CALCULATING, szCalculating,
-							SIZEOF_ARRAY(szCalculating));
-						StringCchPrintf(szDisplayText, SIZEOF_ARRAY(szDisplayText), _T("%s: %s"),
-							szTotalSize, szCalculating);
-						DisplayWindow_BufferText(m_hDisplayWindow, szDisplayText);
-
-						/* Maintain a global list of folder size operations. */
-						displayWindowFolderSize.uId = m_iDWFolderSizeUniqueId;
-						displayWindowFolderSize.iTabId = m_tabContainer->GetSelectedTab().GetId();
-						displayWindowFolderSize.bValid = TRUE;
-						m_DWFolderSizes.push_back(displayWindowFolderSize);
-
-						HANDLE hThread = CreateThread(
-							nullptr, 0, Thread_CalculateFolderSize, (LPVOID) pfs, 0, &threadId);
-						CloseHandle(hThread);
-
-						m_iDWFolderSizeUniqueId++;
-					}
-					else
-					{
-						free(pfs);
-					}
-				}
+
+				LoadString(m_hLanguageModule, IDS_GENERAL_TOTALSIZE, szTotalSize,
+					SIZEOF_ARRAY(szTotalSize));
+				LoadString(m_hLanguageModule, IDS_GENERAL_CALCULATING, szCalculating,
+					SIZEOF_ARRAY(szCalculating));
+				StringCchPrintf(szDisplayText, SIZEOF_ARRAY(szDisplayText), _T("%s: %s"),
+					szTotalSize, szCalculating);
+				DisplayWindow_BufferText(m_hDisplayWindow, szDisplayText);
+
+				CalculateDisplayWindowFolderSize(tab, fullItemName);
 			}
 			else
 			{
@@ -194,109 +166,7 @@ void Explorerplusplus::UpdateDisplayWindowForOneFile(const Tab &tab)
 
 			if (IsImage(fullItemName.c_str()))
 			{
-				TCHAR szOutput[256];
-				TCHAR szTemp[64];
-				UINT uWidth;
-				UINT uHeight;
-				Gdiplus::Image *pimg = nullptr;
-
-				pimg = new Gdiplus::Image(fullItemName.c_str(), FALSE);
-
-				if (pimg->GetLastStatus() == Gdiplus::Ok)
-				{
-					uWidth = pimg->GetWidth();
-					LoadString(m_hLanguageModule, IDS_GENERAL_DISPLAYWINDOW_IMAGEWIDTH, szTemp,
-						SIZEOF_ARRAY(szTemp));
-					StringCchPrintf(szOutput, SIZEOF_ARRAY(szOutput), szTemp, uWidth);
-					DisplayWindow_BufferText(m_hDisplayWindow, szOutput);
-
-					uHeight = pimg->GetHeight();
-					LoadString(m_hLanguageModule, IDS_GENERAL_DISPLAYWINDOW_IMAGEHEIGHT, szTemp,
-						SIZEOF_ARRAY(szTemp));
-					StringCchPrintf(szOutput, SIZEOF_ARRAY(szOutput), szTemp, uHeight);
-					DisplayWindow_BufferText(m_hDisplayWindow, szOutput);
-
-					Gdiplus::PixelFormat format;
-					UINT uBitDepth;
-
-					format = pimg->GetPixelFormat();
-
-					switch (format)
-					{
-					case PixelFormat1bppIndexed:
-						uBitDepth = 1;
-						break;
-
-					case PixelFormat4bppIndexed:
-						uBitDepth = 4;
-						break;
-
-					case PixelFormat8bppIndexed:
-						uBitDepth = 8;
-						break;
-
-					case PixelFormat16bppARGB1555:
-					case PixelFormat16bppGrayScale:
-					case PixelFormat16bppRGB555:
-					case PixelFormat16bppRGB565:
-						uBitDepth = 16;
-						break;
-
-					case PixelFormat24bppRGB:
-						uBitDepth = 24;
-						break;
-
-					case PixelFormat32bppARGB:
-					case PixelFormat32bppPARGB:
-					case PixelFormat32bppRGB:
-						uBitDepth = 32;
-						break;
-
-					case PixelFormat48bppRGB:
-						uBitDepth = 48;
-						break;
-
-					case PixelFormat64bppARGB:
-					case PixelFormat64bppPARGB:
-						uBitDepth = 64;
-						break;
-
-					default:
-						uBitDepth = 0;
-						break;
-					}
-
-					if (uBitDepth == 0)
-					{
-						LoadString(m_hLanguageModule, IDS_GENERAL_DISPLAYWINDOW_BITDEPTHUNKNOWN,
-							szTemp, SIZEOF_ARRAY(szTemp));
-						StringCchCopy(szOutput, SIZEOF_ARRAY(szOutput), szTemp);
-					}
-					else
-					{
-						LoadString(m_hLanguageModule, IDS_GENERAL_DISPLAYWINDOW_BITDEPTH, szTemp,
-							SIZEOF_ARRAY(szTemp));
-						StringCchPrintf(szOutput, SIZEOF_ARRAY(szOutput), szTemp, uBitDepth);
-					}
-
-					DisplayWindow_BufferText(m_hDisplayWindow, szOutput);
-
-					Gdiplus::REAL res;
-
-					res = pimg->GetHorizontalResolution();
-					LoadString(m_hLanguageModule, IDS_GENERAL_DISPLAYWINDOW_HORIZONTALRESOLUTION,
-						szTemp, SIZEOF_ARRAY(szTemp));
-					StringCchPrintf(szOutput, SIZEOF_ARRAY(szOutput), szTemp, res);
-					DisplayWindow_BufferText(m_hDisplayWindow, szOutput);
-
-					res = pimg->GetVerticalResolution();
-					LoadString(m_hLanguageModule, IDS_GENERAL_DISPLAYWINDOW_VERTICALRESOLUTION,
-						szTemp, SIZEOF_ARRAY(szTemp));
-					StringCchPrintf(szOutput, SIZEOF_ARRAY(szOutput), szTemp, res);
-					DisplayWindow_BufferText(m_hDisplayWindow, szOutput);
-				}
-
-				delete pimg;
+				RequestDisplayWindowImageDetails(fullItemName, wfd.ftLastWriteTime);
 			}
 
 			/* Only attempt to show file previews for files (not folders). Also, only
@@ -304,51 +174,19 @@ void Explorerplusplus::UpdateDisplayWindowForOneFile(const Tab &tab)
 			if (((dwAttributes & FILE_ATTRIBUTE_DIRECTORY) != FILE_ATTRIBUTE_DIRECTORY)
 				&& m_config->showFilePreviews && m_config->showDisplayWindow)
 			{
-				DisplayWindow_SetThumbnailFile(m_hDisplayWindow, fullItemName.c_str(), TRUE);
+				DWThumbnailFile_t thumbnailFile = { fullItemName.c_str(), wfd.ftLastWriteTime };
+				DisplayWindow_SetThumbnailFile(m_hDisplayWindow, &thumbnailFile, TRUE);
 			}
 			else
 			{
-				DisplayWindow_SetThumbnailFile(m_hDisplayWindow, EMPTY_STRING, FALSE);
+				DisplayWindow_SetThumbnailFile(m_hDisplayWindow, nullptr, FALSE);
 			}
 		}
 		else
 		{
 			if (PathIsRoot(fullItemName.c_str()))
 			{
-				TCHAR szMsg[64];
-				TCHAR szTemp[64];
-				ULARGE_INTEGER ulTotalNumberOfBytes;
-				ULARGE_INTEGER ulTotalNumberOfFreeBytes;
-				BOOL bRet = GetDiskFreeSpaceEx(fullItemName.c_str(), nullptr, &ulTotalNumberOfBytes,
-					&ulTotalNumberOfFreeBytes);
-
-				if (bRet)
-				{
-					TCHAR szSize[32];
-					FormatSizeString(ulTotalNumberOfFreeBytes, szSize, SIZEOF_ARRAY(szSize));
-					LoadString(m_hLanguageModule, IDS_GENERAL_DISPLAY_WINDOW_FREE_SPACE, szTemp,
-						SIZEOF_ARRAY(szTemp));
-					StringCchPrintf(szMsg, SIZEOF_ARRAY(szMsg), szTemp, szSize);
-					DisplayWindow_BufferText(m_hDisplayWindow, szMsg);
-
-					FormatSizeString(ulTotalNumberOfBytes, szSize, SIZEOF_ARRAY(szSize));
-					LoadString(m_hLanguageModule, IDS_GENERAL_DISPLAY_WINDOW_TOTAL_SIZE, szTemp,
-						SIZEOF_ARRAY(szTemp));
-					StringCchPrintf(szMsg, SIZEOF_ARRAY(szMsg), szTemp, szSize);
-					DisplayWindow_BufferText(m_hDisplayWindow, szMsg);
-				}
-
-				TCHAR szFileSystem[MAX_PATH + 1];
-				bRet = GetVolumeInformation(fullItemName.c_str(), nullptr, 0, nullptr, nullptr,
-					nullptr, szFileSystem, SIZEOF_ARRAY(szFileSystem));
-
-				if (bRet)
-				{
-					LoadString(m_hLanguageModule, IDS_GENERAL_DISPLAY_WINDOW_FILE_SYSTEM, szTemp,
-						SIZEOF_ARRAY(szTemp));
-					StringCchPrintf(szMsg, SIZEOF_ARRAY(szMsg), szTemp, szFileSystem);
-					DisplayWindow_BufferText(m_hDisplayWindow, szMsg);
-				}
+				RequestDisplayWindowDriveDetails(fullItemName);
 			}
 		}
 	}
@@ -361,10 +199,9 @@ void Explorerplusplus::UpdateDisplayWindowForMultipleFiles(const Tab &tab)
 	TCHAR szTotalSizeFragment[32] = EMPTY_STRING;
 	TCHAR szMore[64];
 	TCHAR szTotalSizeString[64];
-	FolderInfo_t folderInfo;
 	int nSelected;
 
-	DisplayWindow_SetThumbnailFile(m_hDisplayWindow, EMPTY_STRING, FALSE);
+	DisplayWindow_SetThumbnailFile(m_hDisplayWindow, nullptr, FALSE);
 
 	nSelected = tab.GetShellBrowser()->GetNumSelected();
 
@@ -376,9 +213,18 @@ void Explorerplusplus::UpdateDisplayWindowForMultipleFiles(const Tab &tab)
 
 	if (!tab.GetShellBrowser()->InVirtualFolder())
 	{
-		tab.GetShellBrowser()->GetFolderInfo(&folderInfo);
+		const SelectionInfo &selectionInfo = tab.GetShellBrowser()->GetSelectionInfo();
+
+		// Folder sizes are only included once the size of every selected folder is known.
+		ULARGE_INTEGER selectionSize;
+		selectionSize.QuadPart = selectionInfo.filesSize;
+
+		if (selectionInfo.numFoldersSized == selectionInfo.numFolders)
+		{
+			selectionSize.QuadPart += selectionInfo.foldersSize;
+		}
 
-		FormatSizeString(folderInfo.TotalSelectionSize, szTotalSizeFragment,
+		FormatSizeString(selectionSize, szTotalSizeFragment,
 			SIZEOF_ARRAY(szTotalSizeFragment), m_config->globalFolderSettings.forceSize,
 			m_config->globalFolderSettings.sizeDisplayFormat);
 
@@ -390,4 +236,262 @@ void Explorerplusplus::UpdateDisplayWindowForMultipleFiles(const Tab &tab)
 	}
 
 	DisplayWindow_BufferText(m_hDisplayWindow, szTotalSize);
+}
+
+void Explorerplusplus::CalculateDisplayWindowFolderSize(const Tab &tab, const std::wstring &path)
+{
+	/* Maintain a global list of folder size operations. */
+	DWFolderSize displayWindowFolderSize;
+	displayWindowFolderSize.uId = m_iDWFolderSizeUniqueId++;
+	displayWindowFolderSize.iTabId = tab.GetId();
+	displayWindowFolderSize.bValid = TRUE;
+	m_DWFolderSizes.push_back(displayWindowFolderSize);
+
+	// Calculations that are no longer needed are stopped as soon as the selection changes, so a
+	// single thread is enough; any queued calculations that have been stopped will finish
+	// immediately.
+	HWND hwnd = m_hContainer;
+	int id = displayWindowFolderSize.uId;
+	std::stop_token stopToken = displayWindowFolderSize.stopSource.get_token();
+	bool populateCloudFolders = tab.GetShellBrowser()->GetAllowCloudHydration();
+
+	m_folderSizeThreadPool.push([hwnd, id, path, stopToken, populateCloudFolders](int threadId) {
+		UNREFERENCED_PARAMETER(threadId);
+
+		// The walk's helper threads inherit this class.
+		SetCurrentThreadTaskClass(TaskClass::Background);
+
+		auto folderInfo = FolderSizeCache::GetInstance().GetFolderInfo(
+			path, stopToken,
+			[hwnd, id](const FolderInfo &partialFolderInfo) {
+				PostDisplayWindowFolderSize(hwnd, id, partialFolderInfo, false);
+			},
+			populateCloudFolders);
+
+		if (!stopToken.stop_requested())
+		{
+			PostDisplayWindowFolderSize(hwnd, id, folderInfo, true);
+		}
+	});
+}
+
+void Explorerplusplus::PostDisplayWindowFolderSize(
+	HWND hwnd, int id, const FolderInfo &folderInfo, bool finished)
+{
+	auto completion = std::make_unique<DWFolderSizeCompletion>();
+	completion->liFolderSize.QuadPart = folderInfo.size;
+	completion->uId = id;
+	completion->finished = finished;
+
+	/* Queue the result back to the main thread, so that
+	the folder size can be displayed. It is up to the main
+	thread to determine whether the folder size should actually
+	be shown. */
+	BOOL res = PostMessage(
+		hwnd, WM_APP_FOLDERSIZECOMPLETED, reinterpret_cast<WPARAM>(completion.get()), 0);
+
+	if (res)
+	{
+		completion.release();
+	}
+}
+
+void Explorerplusplus::StopDisplayWindowFolderSizes()
+{
+	for (auto &item : m_DWFolderSizes)
+	{
+		item.bValid = FALSE;
+		item.stopSource.request_stop();
+	}
+}
+
+void Explorerplusplus::RequestDisplayWindowImageDetails(
+	const std::wstring &path, const FILETIME &lastWriteTime)
+{
+	ULARGE_INTEGER lastWriteTimeValue;
+	lastWriteTimeValue.LowPart = lastWriteTime.dwLowDateTime;
+	lastWriteTimeValue.HighPart = lastWriteTime.dwHighDateTime;
+
+	DWDetailsKey key = { path, lastWriteTimeValue.QuadPart };
+
+	auto itr = std::find_if(m_displayWindowDetailsCache.begin(),
+		m_displayWindowDetailsCache.end(), [&key](const auto &entry) { return entry.first == key; });
+
+	if (itr != m_displayWindowDetailsCache.end())
+	{
+		m_displayWindowDetailsCache.splice(
+			m_displayWindowDetailsCache.begin(), m_displayWindowDetailsCache, itr);
+
+		for (const auto &line : itr->second)
+		{
+			DisplayWindow_BufferText(m_hDisplayWindow, line.c_str());
+		}
+
+		return;
+	}
+
+	QueueDisplayWindowDetails([languageModule = m_hLanguageModule, path]()
+		{ return ReadImageDetails(languageModule, path); },
+		key);
+}
+
+void Explorerplusplus::RequestDisplayWindowDriveDetails(const std::wstring &path)
+{
+	// The amount of free space changes constantly, so drive details aren't cached.
+	QueueDisplayWindowDetails([languageModule = m_hLanguageModule, path]()
+		{ return ReadDriveDetails(languageModule, path); },
+		std::nullopt);
+}
+
+void Explorerplusplus::QueueDisplayWindowDetails(
+	std::function<std::vector<std::wstring>()> readDetails, std::optional<DWDetailsKey> cacheKey)
+{
+	CancelDisplayWindowDetails();
+
+	m_pendingDisplayWindowDetailsKey = cacheKey;
+
+	m_displayWindowDetailsResult = m_displayWindowDetailsThreadPool.push(
+		[hwnd = m_hContainer, requestId = m_displayWindowDetailsRequestId,
+			readDetails = std::move(readDetails)](int id)
+		{
+			UNREFERENCED_PARAMETER(id);
+
+			auto details = readDetails();
+
+			PostMessage(hwnd, WM_APP_DISPLAYWINDOWDETAILSREADY, requestId, 0);
+
+			return details;
+		});
+}
+
+void Explorerplusplus::OnDisplayWindowDetailsReady(int requestId)
+{
+	// Details for a selection that's since changed are ignored.
+	if (requestId != m_displayWindowDetailsRequestId || !m_displayWindowDetailsResult.valid())
+	{
+		return;
+	}
+
+	auto details = m_displayWindowDetailsResult.get();
+
+	if (m_pendingDisplayWindowDetailsKey)
+	{
+		m_displayWindowDetailsCache.emplace_front(*m_pendingDisplayWindowDetailsKey, details);
+
+		if (m_displayWindowDetailsCache.size() > MAX_CACHED_DISPLAY_WINDOW_DETAILS)
+		{
+			m_displayWindowDetailsCache.pop_back();
+		}
+	}
+
+	for (const auto &line : details)
+	{
+		DisplayWindow_BufferText(m_hDisplayWindow, line.c_str());
+	}
+}
+
+void Explorerplusplus::CancelDisplayWindowDetails()
+{
+	// A request that's already running can't be interrupted, but its result will be ignored. Any
+	// request that hasn't started yet is dropped, so at most one request is ever in flight.
+	m_displayWindowDetailsThreadPool.clear_queue();
+	m_displayWindowDetailsResult = {};
+	m_displayWindowDetailsRequestId++;
+}
+
+std::vector<std::wstring> Explorerplusplus::ReadImageDetails(
+	HMODULE languageModule, const std::wstring &path)
+{
+	std::vector<std::wstring> details;
+
+	// The details are read from the image's header, so the image itself isn't decoded.
+	auto imageInfo = WicImageLoader::GetImageInfo(path);
+
+	if (!imageInfo)
+	{
+		return details;
+	}
+
+	TCHAR szOutput[256];
+	TCHAR szTemp[64];
+
+	LoadString(
+		languageModule, IDS_GENERAL_DISPLAYWINDOW_IMAGEWIDTH, szTemp, SIZEOF_ARRAY(szTemp));
+	StringCchPrintf(szOutput, SIZEOF_ARRAY(szOutput), szTemp, imageInfo->width);
+	details.emplace_back(szOutput);
+
+	LoadString(
+		languageModule, IDS_GENERAL_DISPLAYWINDOW_IMAGEHEIGHT, szTemp, SIZEOF_ARRAY(szTemp));
+	StringCchPrintf(szOutput, SIZEOF_ARRAY(szOutput), szTemp, imageInfo->height);
+	details.emplace_back(szOutput);
+
+	if (imageInfo->bitsPerPixel == 0)
+	{
+		LoadString(languageModule, IDS_GENERAL_DISPLAYWINDOW_BITDEPTHUNKNOWN, szTemp,
+			SIZEOF_ARRAY(szTemp));
+		StringCchCopy(szOutput, SIZEOF_ARRAY(szOutput), szTemp);
+	}
+	else
+	{
+		LoadString(
+			languageModule, IDS_GENERAL_DISPLAYWINDOW_BITDEPTH, szTemp, SIZEOF_ARRAY(szTemp));
+		StringCchPrintf(szOutput, SIZEOF_ARRAY(szOutput), szTemp, imageInfo->bitsPerPixel);
+	}
+
+	details.emplace_back(szOutput);
+
+	LoadString(languageModule, IDS_GENERAL_DISPLAYWINDOW_HORIZONTALRESOLUTION, szTemp,
+		SIZEOF_ARRAY(szTemp));
+	StringCchPrintf(szOutput, SIZEOF_ARRAY(szOutput), szTemp, imageInfo->horizontalResolution);
+	details.emplace_back(szOutput);
+
+	LoadString(languageModule, IDS_GENERAL_DISPLAYWINDOW_VERTICALRESOLUTION, szTemp,
+		SIZEOF_ARRAY(szTemp));
+	StringCchPrintf(szOutput, SIZEOF_ARRAY(szOutput), szTemp, imageInfo->verticalResolution);
+	details.emplace_back(szOutput);
+
+	return details;
+}
+
+std::vector<std::wstring> Explorerplusplus::ReadDriveDetails(
+	HMODULE languageModule, const std::wstring &path)
+{
+	std::vector<std::wstring> details;
+
+	TCHAR szMsg[64];
+	TCHAR szTemp[64];
+	ULARGE_INTEGER ulTotalNumberOfBytes;
+	ULARGE_INTEGER ulTotalNumberOfFreeBytes;
+	BOOL bRet = GetDiskFreeSpaceEx(
+		path.c_str(), nullptr, &ulTotalNumberOfBytes, &ulTotalNumberOfFreeBytes);
+
+	if (bRet)
+	{
+		TCHAR szSize[32];
+		FormatSizeString(ulTotalNumberOfFreeBytes, szSize, SIZEOF_ARRAY(szSize));
+		LoadString(
+			languageModule, IDS_GENERAL_DISPLAY_WINDOW_FREE_SPACE, szTemp, SIZEOF_ARRAY(szTemp));
+		StringCchPrintf(szMsg, SIZEOF_ARRAY(szMsg), szTemp, szSize);
+		details.emplace_back(szMsg);
+
+		FormatSizeString(ulTotalNumberOfBytes, szSize, SIZEOF_ARRAY(szSize));
+		LoadString(
+			languageModule, IDS_GENERAL_DISPLAY_WINDOW_TOTAL_SIZE, szTemp, SIZEOF_ARRAY(szTemp));
+		StringCchPrintf(szMsg, SIZEOF_ARRAY(szMsg), szTemp, szSize);
+		details.emplace_back(szMsg);
+	}
+
+	TCHAR szFileSystem[MAX_PATH + 1];
+	bRet = GetVolumeInformation(path.c_str(), nullptr, 0, nullptr, nullptr, nullptr, szFileSystem,
+		SIZEOF_ARRAY(szFileSystem));
+
+	if (bRet)
+	{
+		LoadString(
+			languageModule, IDS_GENERAL_DISPLAY_WINDOW_FILE_SYSTEM, szTemp, SIZEOF_ARRAY(szTemp));
+		StringCchPrintf(szMsg, SIZEOF_ARRAY(szMsg), szTemp, szFileSystem);
+		details.emplace_back(szMsg);
+	}
+
+	return details;
 }
\ No newline at end of file
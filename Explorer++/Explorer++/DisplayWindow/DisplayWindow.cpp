@@ -78,7 +78,10 @@ DisplayWindow::DisplayWindow(HWND hDisplayWindow, DWInitialSettings_t *pInitialS
 	m_SurroundColor(pInitialSettings->SurroundColor),
 	m_hMainIcon(pInitialSettings->hIcon),
 	m_hDisplayFont(pInitialSettings->hFont),
-	m_bVertical(FALSE)
+	m_bVertical(FALSE),
+	m_thumbnailThreadPool(
+		1, std::bind(CoInitializeEx, nullptr, COINIT_APARTMENTTHREADED), CoUninitialize),
+	m_thumbnailRequestId(0)
 {
 	g_ObjectCount++;
 
@@ -86,18 +89,19 @@ DisplayWindow::DisplayWindow(HWND hDisplayWindow, DWInitialSettings_t *pInitialS
 	m_LeftIndent = 80;
 
 	m_bSizing = FALSE;
-	m_hbmThumbnail = nullptr;
+	m_imageLastWriteTime = 0;
 	m_bShowThumbnail = FALSE;
-	m_bThumbnailExtracted = FALSE;
-	m_bThumbnailExtractionFailed = FALSE;
+	m_bThumbnailRequested = FALSE;
+	m_iImageWidth = 0;
+	m_iImageHeight = 0;
 	m_hBitmapBackground = nullptr;
-
-	InitializeCriticalSection(&m_csDWThumbnails);
 }
 
 DisplayWindow::~DisplayWindow()
 {
-	DeleteCriticalSection(&m_csDWThumbnails);
+	// The thread pool waits for any remaining tasks when it's destroyed, so there's no point
+	// leaving any queued.
+	CancelThumbnailExtraction();
 
 	DeleteDC(m_hdcBackground);
 	DeleteObject(m_hBitmapBackground);
@@ -235,10 +239,14 @@ LRESULT CALLBACK DisplayWindow::DisplayWindowProc(
 	break;
 
 	case DWM_SETTHUMBNAILFILE:
-		OnSetThumbnailFile(wParam, lParam);
+		OnSetThumbnailFile(reinterpret_cast<const DWThumbnailFile_t *>(wParam), (BOOL) lParam);
 		RedrawWindow(displayWindow, nullptr, nullptr, RDW_INVALIDATE);
 		break;
 
+	case WM_APP_THUMBNAIL_EXTRACTED:
+		OnThumbnailExtracted(static_cast<int>(wParam));
+		break;
+
 	case DWM_GETCENTRECOLOR:
 		return m_CentreColor.ToCOLORREF();
 
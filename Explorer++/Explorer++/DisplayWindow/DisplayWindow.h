@@ -9,6 +9,13 @@
 #include <gdiplus.h>
 #pragma warning(pop)
 
+#include "../ThirdParty/CTPL/cpl_stl.h"
+#include <wil/resource.h>
+#include <future>
+#include <list>
+#include <memory>
+#include <stop_token>
+#include <string>
 #include <vector>
 
 #define DWM_BASE (WM_APP + 100)
@@ -27,8 +34,8 @@
 #define DWM_CLEARTEXTBUFFER (DWM_BASE + 16)
 #define DWM_SETLINE (DWM_BASE + 17)
 
-#define DisplayWindow_SetThumbnailFile(hDisplay, FileName, bShowImage)                             \
-	SendMessage(hDisplay, DWM_SETTHUMBNAILFILE, (WPARAM) FileName, bShowImage)
+#define DisplayWindow_SetThumbnailFile(hDisplay, pThumbnailFile, bShowImage)                       \
+	SendMessage(hDisplay, DWM_SETTHUMBNAILFILE, (WPARAM) pThumbnailFile, bShowImage)
 
 #define DisplayWindow_GetSurroundColor(hDisplay) SendMessage(hDisplay, DWM_GETSURROUNDCOLOR, 0, 0)
 
@@ -73,11 +80,14 @@ typedef struct
 	TCHAR szText[512];
 } LineData_t;
 
+/* Identifies the file whose thumbnail is shown. The
+modification time is part of the file's identity, so that
+a thumbnail cached before the file changed isn't reused. */
 typedef struct
 {
-	void *pdw;
-	BOOL bCancelled;
-} ThumbnailEntry_t;
+	const TCHAR *szFileName;
+	FILETIME ftLastWriteTime;
+} DWThumbnailFile_t;
 
 static int g_ObjectCount = 0;
 
@@ -90,11 +100,32 @@ public:
 	static LRESULT CALLBACK DisplayWindowProcStub(
 		HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
 
-	void ExtractThumbnailImageInternal(ThumbnailEntry_t *pte);
-
 private:
 #define BORDER_COLOUR Gdiplus::Color(128, 128, 128)
 
+	// Sent by the thumbnail thread once a thumbnail has been extracted (or extraction has failed).
+	static const UINT WM_APP_THUMBNAIL_EXTRACTED = DWM_BASE + 18;
+
+	// The number of thumbnails kept, so that returning to a file that was recently selected doesn't
+	// require its thumbnail to be extracted again.
+	static const size_t MAX_CACHED_THUMBNAILS = 16;
+
+	struct ThumbnailKey
+	{
+		std::wstring path;
+		ULONGLONG lastWriteTime;
+		int height;
+
+		bool operator==(const ThumbnailKey &) const = default;
+	};
+
+	struct Thumbnail
+	{
+		wil::unique_hbitmap bitmap;
+		int width;
+		int height;
+	};
+
 	LRESULT CALLBACK DisplayWindowProc(HWND displayWindow, UINT msg, WPARAM wParam, LPARAM lParam);
 
 	LONG OnMouseMove(LPARAM lParam);
@@ -104,7 +135,7 @@ private:
 	void PaintText(HDC, unsigned int);
 	void TransparentTextOut(HDC hdc, TCHAR *text, RECT *prcText);
 	void DrawThumbnail(HDC hdcMem);
-	void OnSetThumbnailFile(WPARAM wParam, LPARAM lParam);
+	void OnSetThumbnailFile(const DWThumbnailFile_t *thumbnailFile, BOOL showImage);
 	void OnSetFont(HFONT hFont);
 	void OnSetTextColor(COLORREF hColor);
 
@@ -112,8 +143,20 @@ private:
 
 	void OnSize(int width, int height);
 
-	void ExtractThumbnailImage();
+	void RequestThumbnail();
+	static std::shared_ptr<const Thumbnail> ExtractThumbnail(const std::wstring &path,
+		int maxWidth, int height, HFONT font, std::stop_token stopToken);
+	static std::shared_ptr<const Thumbnail> ExtractShellThumbnail(
+		const std::wstring &path, int height, std::stop_token stopToken);
+	static std::shared_ptr<const Thumbnail> CreateImagePreview(
+		const std::wstring &path, int maxWidth, int height);
+	static std::shared_ptr<const Thumbnail> CreateTextPreview(
+		const std::wstring &path, int maxWidth, int height, HFONT font);
+	void OnThumbnailExtracted(int requestId);
 	void CancelThumbnailExtraction();
+	void SetThumbnail(std::shared_ptr<const Thumbnail> thumbnail);
+	std::shared_ptr<const Thumbnail> GetCachedThumbnail(const ThumbnailKey &key);
+	void CacheThumbnail(const ThumbnailKey &key, std::shared_ptr<const Thumbnail> thumbnail);
 
 	HWND m_hDisplayWindow;
 
@@ -125,6 +168,7 @@ private:
 	/* Text buffers (for internal redrawing operations). */
 	std::vector<LineData_t> m_LineList;
 	TCHAR m_ImageFile[MAX_PATH];
+	ULONGLONG m_imageLastWriteTime;
 	BOOL m_bSizing;
 	Gdiplus::Color m_CentreColor;
 	Gdiplus::Color m_SurroundColor;
@@ -133,12 +177,22 @@ private:
 	int m_iImageHeight;
 	BOOL m_bVertical;
 
-	/* Thumbnails. */
-	CRITICAL_SECTION m_csDWThumbnails;
-	HBITMAP m_hbmThumbnail;
+	/* Thumbnails. Thumbnails are extracted on a single background
+	thread and only the most recent request is kept. Any request
+	that's still queued when another file is selected is dropped
+	and any request that's running is stopped, with its result
+	ignored. */
+	ctpl::thread_pool m_thumbnailThreadPool;
+	std::stop_source m_thumbnailStopSource;
+	std::future<std::shared_ptr<const Thumbnail>> m_thumbnailResult;
+	ThumbnailKey m_pendingThumbnailKey;
+	int m_thumbnailRequestId;
+	std::shared_ptr<const Thumbnail> m_thumbnail;
 	BOOL m_bShowThumbnail;
-	BOOL m_bThumbnailExtracted;
-	BOOL m_bThumbnailExtractionFailed;
+	BOOL m_bThumbnailRequested;
+
+	// Ordered from most to least recently used.
+	std::list<std::pair<ThumbnailKey, std::shared_ptr<const Thumbnail>>> m_thumbnailCache;
 
 	int m_xColumnFinal;
 
@@ -5,9 +5,14 @@
 #include "stdafx.h"
 #include "DisplayWindow.h"
 #include "../Helper/Helper.h"
+#include "../Helper/ImageHelper.h"
 #include "../Helper/Macros.h"
 #include "../Helper/ShellHelper.h"
+#include "../Helper/TextPreview.h"
+#include "../Helper/WicImageLoader.h"
 #include "../Helper/WindowHelper.h"
+#include <wil/com.h>
+#include <algorithm>
 
 /* Defines how close the text can get to the bottom
 of the display window before it is moved into the
@@ -34,7 +39,9 @@ can float. */
 at the top and bottom of the thumbnail. */
 #define THUMB_HEIGHT_DELTA 20
 
-std::list<ThumbnailEntry_t> g_ThumbnailEntries;
+/* The margin around the text in a text file
+preview. */
+#define TEXT_PREVIEW_MARGIN 4
 
 void DisplayWindow::DrawGradientFill(HDC hdc, RECT *rc)
 {
@@ -107,168 +114,337 @@ void DisplayWindow::PatchBackground(HDC hdc, RECT *rc, RECT *updateRect)
 
 void DisplayWindow::DrawThumbnail(HDC hdcMem)
 {
-	if (!m_bThumbnailExtracted)
+	if (!m_bThumbnailRequested)
 	{
-		ExtractThumbnailImage();
+		// If the thumbnail is cached, it will be available straight away.
+		RequestThumbnail();
 	}
-	else
+
+	if (!m_thumbnail)
 	{
-		if (!m_bThumbnailExtractionFailed)
-		{
-			RECT rc;
-			GetClientRect(m_hDisplayWindow, &rc);
+		return;
+	}
 
-			HDC hdcSrc = CreateCompatibleDC(hdcMem);
-			auto hBitmapOld = (HBITMAP) SelectObject(hdcSrc, m_hbmThumbnail);
+	RECT rc;
+	GetClientRect(m_hDisplayWindow, &rc);
 
-			BitBlt(hdcMem, m_xColumnFinal, THUMB_IMAGE_TOP, GetRectWidth(&rc) - m_xColumnFinal,
-				GetRectHeight(&rc) - THUMB_HEIGHT_DELTA, hdcSrc, 0, 0, SRCCOPY);
+	HDC hdcSrc = CreateCompatibleDC(hdcMem);
+	auto hBitmapOld = (HBITMAP) SelectObject(hdcSrc, m_thumbnail->bitmap.get());
 
-			SelectObject(hdcSrc, hBitmapOld);
-			DeleteDC(hdcSrc);
-		}
-	}
+	BitBlt(hdcMem, m_xColumnFinal, THUMB_IMAGE_TOP,
+		(std::min)(m_thumbnail->width, GetRectWidth(&rc) - m_xColumnFinal),
+		(std::min)(m_thumbnail->height, GetRectHeight(&rc) - THUMB_HEIGHT_DELTA), hdcSrc, 0, 0,
+		SRCCOPY);
+
+	SelectObject(hdcSrc, hBitmapOld);
+	DeleteDC(hdcSrc);
 }
 
-DWORD WINAPI Thread_ExtractThumbnailImage(LPVOID lpParameter)
+void DisplayWindow::RequestThumbnail()
 {
-	DisplayWindow *pdw = nullptr;
+	m_bThumbnailRequested = TRUE;
 
-	pdw = (DisplayWindow *) ((ThumbnailEntry_t *) lpParameter)->pdw;
+	RECT rc;
+	GetClientRect(m_hDisplayWindow, &rc);
 
-	CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
+	ThumbnailKey key = { m_ImageFile, m_imageLastWriteTime,
+		GetRectHeight(&rc) - THUMB_HEIGHT_DELTA };
 
-	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+	if (key.height <= 0)
+	{
+		return;
+	}
 
-	pdw->ExtractThumbnailImageInternal((ThumbnailEntry_t *) lpParameter);
+	auto cachedThumbnail = GetCachedThumbnail(key);
 
-	/* TODO: Erase the item. */
-	// g_ThumbnailEntries.erase();
+	if (cachedThumbnail)
+	{
+		SetThumbnail(cachedThumbnail);
+		return;
+	}
+
+	CancelThumbnailExtraction();
 
-	CoUninitialize();
+	m_thumbnailStopSource = std::stop_source();
+	m_pendingThumbnailKey = key;
+
+	m_thumbnailResult = m_thumbnailThreadPool.push(
+		[displayWindow = m_hDisplayWindow, requestId = m_thumbnailRequestId, path = key.path,
+			maxWidth = GetRectWidth(&rc), height = key.height, font = m_hDisplayFont,
+			stopToken = m_thumbnailStopSource.get_token()](int id)
+		{
+			UNREFERENCED_PARAMETER(id);
 
-	return 0;
+			auto thumbnail = ExtractThumbnail(path, maxWidth, height, font, stopToken);
+
+			PostMessage(displayWindow, WM_APP_THUMBNAIL_EXTRACTED, requestId, 0);
+
+			return thumbnail;
+		});
 }
 
-void DisplayWindow::ExtractThumbnailImage()
+std::shared_ptr<const DisplayWindow::Thumbnail> DisplayWindow::ExtractThumbnail(
+	const std::wstring &path, int maxWidth, int height, HFONT font, std::stop_token stopToken)
 {
-	ThumbnailEntry_t te;
+	if (stopToken.stop_requested())
+	{
+		return nullptr;
+	}
 
-	te.pdw = (void *) this;
-	te.bCancelled = FALSE;
-	g_ThumbnailEntries.push_back(te);
+	// Images and text files are previewed directly, reading only as much of the file as is needed
+	// for the preview. That means that previewing a very large file is no slower than previewing a
+	// small one. Other files are previewed using the thumbnail provided by the shell.
+	PERCEIVED perceivedType;
+	PERCEIVEDFLAG perceivedFlags;
+	HRESULT hr = AssocGetPerceivedType(
+		PathFindExtension(path.c_str()), &perceivedType, &perceivedFlags, nullptr);
 
-	HANDLE hThread = CreateThread(
-		nullptr, 0, Thread_ExtractThumbnailImage, (LPVOID) &g_ThumbnailEntries.back(), 0, nullptr);
-	CloseHandle(hThread);
+	if (SUCCEEDED(hr) && perceivedType == PERCEIVED_TYPE_IMAGE)
+	{
+		auto preview = CreateImagePreview(path, maxWidth, height);
+
+		if (preview)
+		{
+			return preview;
+		}
+	}
+	else if (SUCCEEDED(hr) && perceivedType == PERCEIVED_TYPE_TEXT)
+	{
+		return CreateTextPreview(path, maxWidth, height, font);
+	}
+
+	return ExtractShellThumbnail(path, height, stopToken);
 }
 
-void DisplayWindow::ExtractThumbnailImageInternal(ThumbnailEntry_t *pte)
+std::shared_ptr<const DisplayWindow::Thumbnail> DisplayWindow::CreateImagePreview(
+	const std::wstring &path, int maxWidth, int height)
 {
-	IExtractImage *pExtractImage = nullptr;
-	IShellFolder *pShellFolder = nullptr;
-	PIDLIST_ABSOLUTE pidlParent = nullptr;
-	PIDLIST_ABSOLUTE pidlFull = nullptr;
-	PITEMID_CHILD pridl = nullptr;
-	HBITMAP hBitmap;
+	auto thumbnail = std::make_shared<Thumbnail>();
+	thumbnail->bitmap = WicImageLoader::LoadImageAtSize(path, maxWidth, height);
+
+	if (!thumbnail->bitmap)
+	{
+		return nullptr;
+	}
+
 	BITMAP bm;
-	RECT rc;
-	SIZE size;
+
+	if (GetObject(thumbnail->bitmap.get(), sizeof(bm), &bm) == 0)
+	{
+		return nullptr;
+	}
+
+	thumbnail->width = bm.bmWidth;
+	thumbnail->height = bm.bmHeight;
+
+	return thumbnail;
+}
+
+std::shared_ptr<const DisplayWindow::Thumbnail> DisplayWindow::CreateTextPreview(
+	const std::wstring &path, int maxWidth, int height, HFONT font)
+{
+	int width = (std::min)(maxWidth, height * 4 / 3);
+
+	if (width <= 2 * TEXT_PREVIEW_MARGIN || height <= 2 * TEXT_PREVIEW_MARGIN)
+	{
+		return nullptr;
+	}
+
+	wil::unique_hdc hdc(CreateCompatibleDC(nullptr));
+	auto previousFont = wil::SelectObject(hdc.get(), font);
+
+	TEXTMETRIC textMetrics;
+	GetTextMetrics(hdc.get(), &textMetrics);
+
+	// Only as many lines as will fit in the preview are read.
+	int maxLines = (height - 2 * TEXT_PREVIEW_MARGIN) / textMetrics.tmHeight;
+	auto lines = TextPreview::ReadLines(path, maxLines);
+
+	if (!lines)
+	{
+		return nullptr;
+	}
+
+	auto thumbnail = std::make_shared<Thumbnail>();
+
+	// A negative height results in a top-down bitmap.
+	BITMAPINFO bmi;
+	ImageHelper::InitBitmapInfo(&bmi, sizeof(bmi), width, -height, 32);
+
+	void *bits;
+	thumbnail->bitmap.reset(CreateDIBSection(nullptr, &bmi, DIB_RGB_COLORS, &bits, nullptr, 0));
+
+	if (!thumbnail->bitmap)
+	{
+		return nullptr;
+	}
+
+	thumbnail->width = width;
+	thumbnail->height = height;
+
+	auto previousBitmap = wil::SelectObject(hdc.get(), thumbnail->bitmap.get());
+
+	RECT rc = { 0, 0, width, height };
+	FillRect(hdc.get(), &rc, GetSysColorBrush(COLOR_WINDOW));
+	FrameRect(hdc.get(), &rc, GetSysColorBrush(COLOR_BTNSHADOW));
+
+	SetBkMode(hdc.get(), TRANSPARENT);
+	SetTextColor(hdc.get(), GetSysColor(COLOR_WINDOWTEXT));
+
+	RECT rcLine = { TEXT_PREVIEW_MARGIN, TEXT_PREVIEW_MARGIN, width - TEXT_PREVIEW_MARGIN,
+		TEXT_PREVIEW_MARGIN + textMetrics.tmHeight };
+
+	for (const auto &line : *lines)
+	{
+		DrawText(hdc.get(), line.c_str(), static_cast<int>(line.size()), &rcLine,
+			DT_LEFT | DT_NOPREFIX | DT_SINGLELINE | DT_EXPANDTABS | DT_END_ELLIPSIS);
+		OffsetRect(&rcLine, 0, textMetrics.tmHeight);
+	}
+
+	return thumbnail;
+}
+
+std::shared_ptr<const DisplayWindow::Thumbnail> DisplayWindow::ExtractShellThumbnail(
+	const std::wstring &path, int height, std::stop_token stopToken)
+{
+	unique_pidl_absolute pidl;
+	HRESULT hr = SHParseDisplayName(path.c_str(), nullptr, wil::out_param(pidl), 0, nullptr);
+
+	if (FAILED(hr))
+	{
+		return nullptr;
+	}
+
+	wil::com_ptr_nothrow<IShellFolder> parent;
+	PCITEMID_CHILD child;
+	hr = SHBindToParent(pidl.get(), IID_PPV_ARGS(&parent), &child);
+
+	if (FAILED(hr))
+	{
+		return nullptr;
+	}
+
+	wil::com_ptr_nothrow<IExtractImage> extractImage;
+	hr = GetUIObjectOf(parent.get(), nullptr, 1, &child, IID_PPV_ARGS(&extractImage));
+
+	if (FAILED(hr))
+	{
+		return nullptr;
+	}
+
+	/* First, query the thumbnail so that its actual aspect
+	ratio can be calculated. */
 	TCHAR szImage[MAX_PATH];
 	DWORD dwPriority;
-	DWORD dwFlags;
-	HRESULT hr;
+	DWORD dwFlags = IEIFLAG_OFFLINE | IEIFLAG_QUALITY | IEIFLAG_ORIGSIZE;
+	SIZE size = { height, height };
+	hr = extractImage->GetLocation(
+		szImage, SIZEOF_ARRAY(szImage), &dwPriority, &size, 32, &dwFlags);
 
-	m_bThumbnailExtracted = TRUE;
-	m_bThumbnailExtractionFailed = TRUE;
+	if (FAILED(hr))
+	{
+		return nullptr;
+	}
 
-	hr = SHParseDisplayName(m_ImageFile, nullptr, &pidlFull, 0, nullptr);
+	wil::unique_hbitmap originalBitmap;
+	hr = extractImage->Extract(wil::out_param(originalBitmap));
 
-	if (SUCCEEDED(hr))
+	if (FAILED(hr))
 	{
-		pidlParent = ILCloneFull(pidlFull);
-		ILRemoveLastID(pidlParent);
+		return nullptr;
+	}
 
-		pridl = ILCloneChild(ILFindLastID(pidlFull));
+	BITMAP bm;
 
-		hr = BindToIdl(pidlParent, IID_PPV_ARGS(&pShellFolder));
+	if (GetObject(originalBitmap.get(), sizeof(bm), &bm) == 0 || bm.bmHeight <= 0
+		|| stopToken.stop_requested())
+	{
+		return nullptr;
+	}
 
-		if (SUCCEEDED(hr))
-		{
-			hr = GetUIObjectOf(
-				pShellFolder, nullptr, 1, &pridl, IID_PPV_ARGS(&pExtractImage));
-
-			if (SUCCEEDED(hr))
-			{
-				GetClientRect(m_hDisplayWindow, &rc);
-
-				/* First, query the thumbnail so that its actual aspect
-				ratio can be calculated. */
-				dwFlags = IEIFLAG_OFFLINE | IEIFLAG_QUALITY | IEIFLAG_ORIGSIZE;
-				size.cx = GetRectHeight(&rc) - THUMB_HEIGHT_DELTA;
-				size.cy = GetRectHeight(&rc) - THUMB_HEIGHT_DELTA;
-
-				hr = pExtractImage->GetLocation(
-					szImage, SIZEOF_ARRAY(szImage), &dwPriority, &size, 32, &dwFlags);
-
-				if (SUCCEEDED(hr))
-				{
-					hr = pExtractImage->Extract(&hBitmap);
-
-					if (SUCCEEDED(hr))
-					{
-						/* Get bitmap information (including height and width). */
-						GetObject(hBitmap, sizeof(BITMAP), &bm);
-
-						/* Delete the original bitmap. */
-						DeleteObject(hBitmap);
-
-						/* ...now query the thumbnail again, this time adjusting
-						the width of the suggested area based on the actual aspect
-						ratio. */
-						dwFlags =
-							IEIFLAG_OFFLINE | IEIFLAG_QUALITY | IEIFLAG_ASPECT | IEIFLAG_ORIGSIZE;
-						size.cy = GetRectHeight(&rc) - THUMB_HEIGHT_DELTA;
-						size.cx =
-							(LONG)((double) size.cy * ((double) bm.bmWidth / (double) bm.bmHeight));
-						m_iImageWidth = size.cx;
-						m_iImageHeight = size.cy;
-						pExtractImage->GetLocation(
-							szImage, SIZEOF_ARRAY(szImage), &dwPriority, &size, 32, &dwFlags);
-						hr = pExtractImage->Extract(&m_hbmThumbnail);
-
-						if (SUCCEEDED(hr))
-						{
-							/* Check first if we've been cancelled. This might happen,
-							for example, if another file is selected while the current
-							thumbnail is been found. */
-							EnterCriticalSection(&m_csDWThumbnails);
-
-							if (!pte->bCancelled)
-							{
-								m_bThumbnailExtractionFailed = FALSE;
-								InvalidateRect(m_hDisplayWindow, nullptr, FALSE);
-							}
-
-							LeaveCriticalSection(&m_csDWThumbnails);
-						}
-						else
-						{
-							m_bThumbnailExtractionFailed = TRUE;
-							m_hbmThumbnail = nullptr;
-						}
-					}
-				}
-
-				pExtractImage->Release();
-			}
-
-			pShellFolder->Release();
-		}
+	/* ...now query the thumbnail again, this time adjusting
+	the width of the suggested area based on the actual aspect
+	ratio. */
+	dwFlags = IEIFLAG_OFFLINE | IEIFLAG_QUALITY | IEIFLAG_ASPECT | IEIFLAG_ORIGSIZE;
+	size.cy = height;
+	size.cx = (LONG) ((double) size.cy * ((double) bm.bmWidth / (double) bm.bmHeight));
+	extractImage->GetLocation(szImage, SIZEOF_ARRAY(szImage), &dwPriority, &size, 32, &dwFlags);
 
-		CoTaskMemFree(pidlFull);
-		CoTaskMemFree(pidlParent);
-		CoTaskMemFree(pridl);
+	auto thumbnail = std::make_shared<Thumbnail>();
+	hr = extractImage->Extract(wil::out_param(thumbnail->bitmap));
+
+	if (FAILED(hr))
+	{
+		return nullptr;
+	}
+
+	thumbnail->width = size.cx;
+	thumbnail->height = size.cy;
+
+	return thumbnail;
+}
+
+void DisplayWindow::OnThumbnailExtracted(int requestId)
+{
+	// Results for requests that have since been superseded are ignored. Their futures have
+	// already been replaced.
+	if (requestId != m_thumbnailRequestId || !m_thumbnailResult.valid())
+	{
+		return;
+	}
+
+	auto thumbnail = m_thumbnailResult.get();
+
+	if (!thumbnail)
+	{
+		return;
+	}
+
+	CacheThumbnail(m_pendingThumbnailKey, thumbnail);
+	SetThumbnail(thumbnail);
+
+	InvalidateRect(m_hDisplayWindow, nullptr, FALSE);
+}
+
+void DisplayWindow::CancelThumbnailExtraction()
+{
+	m_thumbnailThreadPool.clear_queue();
+	m_thumbnailStopSource.request_stop();
+	m_thumbnailResult = {};
+	m_thumbnailRequestId++;
+}
+
+void DisplayWindow::SetThumbnail(std::shared_ptr<const Thumbnail> thumbnail)
+{
+	m_iImageWidth = thumbnail->width;
+	m_iImageHeight = thumbnail->height;
+	m_thumbnail = thumbnail;
+}
+
+std::shared_ptr<const DisplayWindow::Thumbnail> DisplayWindow::GetCachedThumbnail(
+	const ThumbnailKey &key)
+{
+	auto itr = std::find_if(m_thumbnailCache.begin(), m_thumbnailCache.end(),
+		[&key](const auto &entry) { return entry.first == key; });
+
+	if (itr == m_thumbnailCache.end())
+	{
+		return nullptr;
+	}
+
+	m_thumbnailCache.splice(m_thumbnailCache.begin(), m_thumbnailCache, itr);
+
+	return itr->second;
+}
+
+void DisplayWindow::CacheThumbnail(
+	const ThumbnailKey &key, std::shared_ptr<const Thumbnail> thumbnail)
+{
+	m_thumbnailCache.emplace_front(key, thumbnail);
+
+	if (m_thumbnailCache.size() > MAX_CACHED_THUMBNAILS)
+	{
+		m_thumbnailCache.pop_back();
 	}
 }
 
@@ -446,38 +622,24 @@ void DisplayWindow::OnRButtonUp(WPARAM wParam, LPARAM lParam)
 	}
 }
 
-void DisplayWindow::CancelThumbnailExtraction()
+void DisplayWindow::OnSetThumbnailFile(const DWThumbnailFile_t *thumbnailFile, BOOL showImage)
 {
-	std::list<ThumbnailEntry_t>::iterator itr;
-
-	EnterCriticalSection(&m_csDWThumbnails);
+	CancelThumbnailExtraction();
 
-	for (itr = g_ThumbnailEntries.begin(); itr != g_ThumbnailEntries.end(); itr++)
-	{
-		itr->bCancelled = TRUE;
-	}
-
-	LeaveCriticalSection(&m_csDWThumbnails);
-}
-
-void DisplayWindow::OnSetThumbnailFile(WPARAM wParam, LPARAM lParam)
-{
-	m_bShowThumbnail = (BOOL) lParam;
+	m_thumbnail.reset();
+	m_iImageWidth = 0;
+	m_iImageHeight = 0;
+	m_bThumbnailRequested = FALSE;
+	m_bShowThumbnail = showImage && thumbnailFile;
 
 	if (m_bShowThumbnail)
 	{
-		CancelThumbnailExtraction();
+		ULARGE_INTEGER lastWriteTime;
+		lastWriteTime.LowPart = thumbnailFile->ftLastWriteTime.dwLowDateTime;
+		lastWriteTime.HighPart = thumbnailFile->ftLastWriteTime.dwHighDateTime;
 
-		if (m_hbmThumbnail)
-		{
-			DeleteObject(m_hbmThumbnail);
-		}
-
-		m_iImageWidth = 0;
-		m_iImageHeight = 0;
-		m_bThumbnailExtracted = FALSE;
-		m_bThumbnailExtractionFailed = FALSE;
-		StringCchCopy(m_ImageFile, SIZEOF_ARRAY(m_ImageFile), (TCHAR *) wParam);
+		StringCchCopy(m_ImageFile, SIZEOF_ARRAY(m_ImageFile), thumbnailFile->szFileName);
+		m_imageLastWriteTime = lastWriteTime.QuadPart;
 	}
 }
 
@@ -500,6 +662,12 @@ void DisplayWindow::OnSetFont(HFONT hFont)
 {
 	m_hDisplayFont = hFont;
 
+	// Text previews are drawn using the display font, so any that have been cached are out of date.
+	CancelThumbnailExtraction();
+	m_thumbnailCache.clear();
+	m_thumbnail.reset();
+	m_bThumbnailRequested = FALSE;
+
 	RedrawWindow(m_hDisplayWindow, nullptr, nullptr, RDW_INVALIDATE);
 }
 
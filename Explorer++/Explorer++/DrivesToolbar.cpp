@@ -9,9 +9,9 @@
 #include "DarkModeHelper.h"
 #include "MainResource.h"
 #include "ResourceHelper.h"
+#include "ShellBrowser/ShellBrowser.h"
 #include "TabContainer.h"
 #include "../Helper/Controls.h"
-#include "../Helper/DriveInfo.h"
 #include "../Helper/FileContextMenuManager.h"
 #include "../Helper/Helper.h"
 #include "../Helper/Macros.h"
@@ -31,16 +31,19 @@ DrivesToolbar::DrivesToolbar(HWND hParent, UINT uIDStart, UINT uIDEnd, HINSTANCE
 	m_uIDEnd(uIDEnd),
 	m_pexpp(pexpp),
 	m_navigation(navigation),
-	m_IDCounter(0)
+	m_IDCounter(0),
+	m_iconFetcher(m_hwnd, pexpp->GetCachedIcons(), &ShellBrowser::GetBackgroundTaskScheduler())
 {
 	Initialize(hParent);
 
-	HardwareChangeNotifier::GetInstance().AddObserver(this);
+	m_connections.push_back(HardwareChangeNotifier::GetInstance().AddDriveChangedObserver(
+		std::bind_front(&DrivesToolbar::OnDriveChanged, this)));
 }
 
 DrivesToolbar::~DrivesToolbar()
 {
-	HardwareChangeNotifier::GetInstance().RemoveObserver(this);
+	// The enumeration task doesn't reference this instance, so there's no need to wait for it.
+	ShellBrowser::GetBackgroundTaskScheduler().CancelTasks(this);
 }
 
 HWND DrivesToolbar::CreateDrivesToolbar(HWND hParent)
@@ -68,8 +71,6 @@ void DrivesToolbar::Initialize(HWND hParent)
 	m_windowSubclasses.push_back(std::make_unique<WindowSubclassWrapper>(hParent,
 		DrivesToolbarParentProcStub, PARENT_SUBCLASS_ID, reinterpret_cast<DWORD_PTR>(this)));
 
-	InsertDrives();
-
 	auto &darkModeHelper = DarkModeHelper::GetInstance();
 
 	if (darkModeHelper.IsDarkModeEnabled())
@@ -109,62 +110,37 @@ INT_PTR DrivesToolbar::OnMButtonUp(const POINTS *pts, UINT keysDown)
 	return 0;
 }
 
-void DrivesToolbar::OnDeviceArrival(DEV_BROADCAST_HDR *dbh)
+INT_PTR DrivesToolbar::OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
 {
-	if (dbh->dbch_devicetype != DBT_DEVTYP_VOLUME)
-	{
-		return;
-	}
+	UNREFERENCED_PARAMETER(wParam);
+	UNREFERENCED_PARAMETER(lParam);
 
-	auto *pdbv = reinterpret_cast<DEV_BROADCAST_VOLUME *>(dbh);
-
-	/* Build a string that will form the drive name. */
-	TCHAR szDrive[4];
-	TCHAR chDrive = GetDriveLetterFromMask(pdbv->dbcv_unitmask);
-	StringCchPrintf(szDrive, SIZEOF_ARRAY(szDrive), _T("%c:\\"), chDrive);
-
-	/* Is there a change in media, or a change
-	in the physical device?
-	If this is only a change in media, simply
-	update any icons that may need updating;
-	else if this is a change in the physical
-	device, add the device in the required
-	areas. */
-	if (pdbv->dbcv_flags & DBTF_MEDIA)
-	{
-		UpdateDriveIcon(szDrive);
-	}
-	else
+	switch (uMsg)
 	{
-		/* A drive was added to the system,
-		so add it to the toolbar. */
-		InsertDrive(szDrive);
+	case WM_APP_DRIVES_ENUMERATED:
+		OnDrivesEnumerated();
+		break;
 	}
+
+	return 0;
 }
 
-void DrivesToolbar::OnDeviceRemoveComplete(DEV_BROADCAST_HDR *dbh)
+void DrivesToolbar::OnDriveChanged(const DriveChange &change)
 {
-	if (dbh->dbch_devicetype != DBT_DEVTYP_VOLUME)
+	switch (change.type)
 	{
-		return;
-	}
-
-	auto *pdbv = reinterpret_cast<DEV_BROADCAST_VOLUME *>(dbh);
+	case DriveChange::Type::Added:
+		InsertDrive(change.path);
+		break;
 
-	TCHAR szDrive[4];
-	TCHAR chDrive = GetDriveLetterFromMask(pdbv->dbcv_unitmask);
-	StringCchPrintf(szDrive, SIZEOF_ARRAY(szDrive), _T("%c:\\"), chDrive);
+	case DriveChange::Type::Removed:
+		RemoveDrive(change.path);
+		break;
 
-	/* Media changed or drive removed? */
-	if (pdbv->dbcv_flags & DBTF_MEDIA)
-	{
-		UpdateDriveIcon(szDrive);
-	}
-	else
-	{
-		/* The device was removed from the system.
-		Remove its button from the toolbar. */
-		RemoveDrive(szDrive);
+	case DriveChange::Type::MediaChanged:
+		// The icon was already retrieved when the notification was received.
+		SetDriveIcon(change.path, change.iconIndex);
+		break;
 	}
 }
 
@@ -267,6 +243,20 @@ LRESULT CALLBACK DrivesToolbar::DrivesToolbarParentProc(
 
 void DrivesToolbar::InsertDrives()
 {
+	m_drivesResult = ShellBrowser::GetBackgroundTaskScheduler().PushTask(this, std::nullopt,
+		DRIVE_ENUMERATION_TASK_PRIORITY, [hwnd = m_hwnd]() {
+			auto drives = EnumerateDrives();
+
+			PostMessage(hwnd, WM_APP_DRIVES_ENUMERATED, 0, 0);
+
+			return drives;
+		});
+}
+
+std::vector<std::wstring> DrivesToolbar::EnumerateDrives()
+{
+	std::vector<std::wstring> drives;
+
 	DWORD dwSize = GetLogicalDriveStrings(0, nullptr);
 
 	auto driveStrings = std::make_unique<TCHAR[]>(dwSize);
@@ -278,15 +268,40 @@ void DrivesToolbar::InsertDrives()
 
 		while (*pDrive != '\0')
 		{
-			InsertDrive(pDrive);
+			drives.emplace_back(pDrive);
 
 			pDrive += (lstrlen(pDrive) + 1);
 		}
 	}
+
+	return drives;
+}
+
+void DrivesToolbar::OnDrivesEnumerated()
+{
+	if (!m_drivesResult.valid())
+	{
+		return;
+	}
+
+	auto drives = m_drivesResult.get();
+
+	for (const auto &drive : drives)
+	{
+		InsertDrive(drive);
+	}
+
+	drivesInsertedSignal.m_signal();
 }
 
 void DrivesToolbar::InsertDrive(const std::wstring &DrivePath)
 {
+	// A drive may have already been added in response to a device arrival notification.
+	if (GetDrivePosition(DrivePath).Position != -1)
+	{
+		return;
+	}
+
 	TCHAR szDisplayName[32];
 	StringCchCopy(szDisplayName, SIZEOF_ARRAY(szDisplayName), DrivePath.c_str());
 
@@ -296,6 +311,8 @@ void DrivesToolbar::InsertDrive(const std::wstring &DrivePath)
 		szDisplayName[lstrlen(szDisplayName) - 1] = '\0';
 	}
 
+	// This only returns a generic drive icon and doesn't access the drive itself, so the button can
+	// be shown straight away. The actual icon is then retrieved in the background.
 	SHFILEINFO shfi;
 	SHGetFileInfo(
 		DrivePath.c_str(), 0, &shfi, sizeof(shfi), SHGFI_SYSICONINDEX | SHGFI_USEFILEATTRIBUTES);
@@ -314,6 +331,8 @@ void DrivesToolbar::InsertDrive(const std::wstring &DrivePath)
 
 	m_mapID.insert(std::make_pair(m_IDCounter, DrivePath));
 	++m_IDCounter;
+
+	UpdateDriveIcon(DrivePath);
 }
 
 void DrivesToolbar::RemoveDrive(const std::wstring &DrivePath)
@@ -332,13 +351,23 @@ void DrivesToolbar::RemoveDrive(const std::wstring &DrivePath)
 for example, if a cd/dvd is inserted/removed. */
 void DrivesToolbar::UpdateDriveIcon(const std::wstring &DrivePath)
 {
-	DriveInformation di = GetDrivePosition(DrivePath);
+	if (GetDrivePosition(DrivePath).Position == -1)
+	{
+		return;
+	}
+
+	m_iconFetcher.QueueIconTask(DrivePath,
+		[this, DrivePath](int iconIndex) { SetDriveIcon(DrivePath, iconIndex); });
+}
+
+void DrivesToolbar::SetDriveIcon(const std::wstring &drivePath, int iconIndex)
+{
+	// The drive may have been removed while its icon was being retrieved.
+	DriveInformation di = GetDrivePosition(drivePath);
 
 	if (di.Position != -1)
 	{
-		SHFILEINFO shfi;
-		SHGetFileInfo(DrivePath.c_str(), 0, &shfi, sizeof(shfi), SHGFI_SYSICONINDEX);
-		SendMessage(m_hwnd, TB_CHANGEBITMAP, di.ID, shfi.iIcon);
+		SendMessage(m_hwnd, TB_CHANGEBITMAP, m_uIDStart + di.ID, iconIndex);
 	}
 }
 
@@ -6,23 +6,31 @@
 
 #include "HardwareChangeNotifier.h"
 #include "Navigation.h"
+#include "SignalWrapper.h"
 #include "../Helper/BaseWindow.h"
 #include "../Helper/FileContextMenuManager.h"
+#include "../Helper/IconFetcher.h"
 #include "../Helper/WindowSubclassWrapper.h"
 #include <boost/serialization/strong_typedef.hpp>
+#include <future>
 #include <unordered_map>
 
 __interface IExplorerplusplus;
 
-class DrivesToolbar :
-	public BaseWindow,
-	public IFileContextMenuExternal,
-	public NHardwareChangeNotifier::INotification
+class DrivesToolbar : public BaseWindow, public IFileContextMenuExternal
 {
 public:
 	static DrivesToolbar *Create(HWND hParent, UINT uIDStart, UINT uIDEnd, HINSTANCE hInstance,
 		IExplorerplusplus *pexpp, Navigation *navigation);
 
+	// Drives aren't enumerated when the toolbar is created, since doing so can be slow (e.g. when
+	// there are network drives present). This should be called once the toolbar is needed. The
+	// drives are enumerated in the background and drivesInsertedSignal is triggered once their
+	// buttons have been added.
+	void InsertDrives();
+
+	SignalWrapper<DrivesToolbar, void()> drivesInsertedSignal;
+
 	/* IFileContextMenuExternal methods. */
 	void UpdateMenuEntries(PCIDLIST_ABSOLUTE pidlParent,
 		const std::vector<PITEMID_CHILD> &pidlItems, DWORD_PTR dwData, IContextMenu *contextMenu,
@@ -34,6 +42,7 @@ public:
 
 protected:
 	INT_PTR OnMButtonUp(const POINTS *pts, UINT keysDown) override;
+	INT_PTR OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lParam) override;
 
 private:
 	BOOST_STRONG_TYPEDEF(UINT, IDCounter);
@@ -46,6 +55,10 @@ private:
 
 	static const UINT_PTR PARENT_SUBCLASS_ID = 0;
 
+	static const UINT WM_APP_DRIVES_ENUMERATED = WM_APP + 1;
+
+	static const int DRIVE_ENUMERATION_TASK_PRIORITY = 0;
+
 	static const int MIN_SHELL_MENU_ID = 1;
 	static const int MAX_SHELL_MENU_ID = 1000;
 
@@ -63,7 +76,8 @@ private:
 
 	void Initialize(HWND hParent);
 
-	void InsertDrives();
+	static std::vector<std::wstring> EnumerateDrives();
+	void OnDrivesEnumerated();
 	void InsertDrive(const std::wstring &DrivePath);
 	void RemoveDrive(const std::wstring &DrivePath);
 
@@ -72,9 +86,9 @@ private:
 	std::wstring GetDrivePath(int iIndex);
 
 	void UpdateDriveIcon(const std::wstring &DrivePath);
+	void SetDriveIcon(const std::wstring &drivePath, int iconIndex);
 
-	void OnDeviceArrival(DEV_BROADCAST_HDR *dbh) override;
-	void OnDeviceRemoveComplete(DEV_BROADCAST_HDR *dbh) override;
+	void OnDriveChanged(const DriveChange &change);
 
 	HINSTANCE m_hInstance;
 
@@ -96,5 +110,13 @@ private:
 
 	IDCounter m_IDCounter;
 
+	std::future<std::vector<std::wstring>> m_drivesResult;
+
+	// Drive icons are retrieved in the background, since retrieving the icon for a disconnected
+	// network drive can take a long time. The fetcher also stops looking up icons for a drive
+	// that's timed out, until a cool-down period has passed.
+	IconFetcher m_iconFetcher;
+
 	std::vector<std::unique_ptr<WindowSubclassWrapper>> m_windowSubclasses;
+	std::vector<boost::signals2::scoped_connection> m_connections;
 };
\ No newline at end of file
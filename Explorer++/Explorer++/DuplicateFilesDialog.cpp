@@ -0,0 +1,341 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "DuplicateFilesDialog.h"
+#include "CoreInterface.h"
+#include "MainResource.h"
+#include "ResourceHelper.h"
+#include "../Helper/StringHelper.h"
+#include "../Helper/WindowHelper.h"
+#include <boost/format.hpp>
+
+namespace
+{
+
+std::wstring FormatSize(ULONGLONG bytes)
+{
+	ULARGE_INTEGER size;
+	size.QuadPart = bytes;
+
+	TCHAR sizeText[32];
+	FormatSizeString(size, sizeText, std::size(sizeText));
+	return sizeText;
+}
+
+}
+
+DuplicateFilesDialog::DuplicateFilesDialog(HINSTANCE hInstance, HWND hParent,
+	IExplorerplusplus *expp, std::vector<std::wstring> folders) :
+	DarkModeDialogBase(hInstance, IDD_DUPLICATE_FILES, hParent, true),
+	m_expp(expp),
+	m_folders(std::move(folders))
+{
+}
+
+INT_PTR DuplicateFilesDialog::OnInitDialog()
+{
+	SetUpListView();
+
+	AllowDarkModeForControls({ IDC_DUPLICATES_STOP, IDCANCEL });
+	AllowDarkModeForListView(IDC_DUPLICATES_LISTVIEW);
+
+	StartSearch();
+
+	return TRUE;
+}
+
+void DuplicateFilesDialog::SetUpListView()
+{
+	HWND listView = GetDlgItem(m_hDlg, IDC_DUPLICATES_LISTVIEW);
+
+	ListView_SetExtendedListViewStyleEx(listView,
+		LVS_EX_DOUBLEBUFFER | LVS_EX_FULLROWSELECT | LVS_EX_GRIDLINES,
+		LVS_EX_DOUBLEBUFFER | LVS_EX_FULLROWSELECT | LVS_EX_GRIDLINES);
+
+	HIMAGELIST smallImageList;
+	Shell_GetImageLists(nullptr, &smallImageList);
+	ListView_SetImageList(listView, smallImageList, LVSIL_SMALL);
+
+	SetWindowTheme(listView, L"Explorer", nullptr);
+
+	RECT clientRect;
+	GetClientRect(listView, &clientRect);
+	int width = GetRectWidth(&clientRect);
+
+	// Each column is given a fixed share of the initial width of the listview.
+	const std::pair<UINT, int> columns[] = { { IDS_DUPLICATES_COLUMN_NAME, 30 },
+		{ IDS_DUPLICATES_COLUMN_FOLDER, 45 }, { IDS_DUPLICATES_COLUMN_SIZE, 15 },
+		{ IDS_DUPLICATES_COLUMN_GROUP, 10 } };
+	int index = 0;
+
+	for (const auto &[stringId, percentage] : columns)
+	{
+		std::wstring text = ResourceHelper::LoadString(GetInstance(), stringId);
+
+		LVCOLUMN lvColumn;
+		lvColumn.mask = LVCF_TEXT | LVCF_WIDTH;
+		lvColumn.pszText = text.data();
+		lvColumn.cx = MulDiv(width, percentage, 100);
+		ListView_InsertColumn(listView, index++, &lvColumn);
+	}
+}
+
+void DuplicateFilesDialog::GetResizableControlInformation(
+	BaseDialog::DialogSizeConstraint &dsc, std::list<ResizableDialog::Control> &ControlList)
+{
+	dsc = BaseDialog::DialogSizeConstraint::None;
+
+	ResizableDialog::Control control;
+
+	control.iID = IDC_DUPLICATES_LISTVIEW;
+	control.Type = ResizableDialog::ControlType::Resize;
+	control.Constraint = ResizableDialog::ControlConstraint::None;
+	ControlList.push_back(control);
+
+	control.iID = IDC_DUPLICATES_STATUS;
+	control.Type = ResizableDialog::ControlType::Move;
+	control.Constraint = ResizableDialog::ControlConstraint::Y;
+	ControlList.push_back(control);
+
+	control.iID = IDC_DUPLICATES_STATUS;
+	control.Type = ResizableDialog::ControlType::Resize;
+	control.Constraint = ResizableDialog::ControlConstraint::X;
+	ControlList.push_back(control);
+
+	control.iID = IDC_DUPLICATES_STOP;
+	control.Type = ResizableDialog::ControlType::Move;
+	control.Constraint = ResizableDialog::ControlConstraint::None;
+	ControlList.push_back(control);
+
+	control.iID = IDCANCEL;
+	control.Type = ResizableDialog::ControlType::Move;
+	control.Constraint = ResizableDialog::ControlConstraint::None;
+	ControlList.push_back(control);
+}
+
+void DuplicateFilesDialog::StartSearch()
+{
+	HWND dialog = m_hDlg;
+
+	m_searchThread = std::jthread([this, dialog](std::stop_token stopToken) {
+		HRESULT hr = FindDuplicateFiles(m_folders, m_groups, stopToken,
+			[this](int filesFound, int filesHashed) {
+				m_filesFound = filesFound;
+				m_filesHashed = filesHashed;
+			});
+
+		PostMessage(dialog, WM_APP_SEARCH_FINISHED, static_cast<WPARAM>(hr), 0);
+	});
+
+	UpdateProgress();
+	SetTimer(m_hDlg, PROGRESS_TIMER_ID, PROGRESS_TIMER_INTERVAL, nullptr);
+}
+
+void DuplicateFilesDialog::StopSearch()
+{
+	m_searchThread.request_stop();
+	EnableWindow(GetDlgItem(m_hDlg, IDC_DUPLICATES_STOP), FALSE);
+}
+
+INT_PTR DuplicateFilesDialog::OnTimer(int iTimerID)
+{
+	if (iTimerID == PROGRESS_TIMER_ID)
+	{
+		UpdateProgress();
+	}
+
+	return 0;
+}
+
+void DuplicateFilesDialog::UpdateProgress()
+{
+	std::wstring progressTemplate =
+		ResourceHelper::LoadString(GetInstance(), IDS_DUPLICATES_SEARCHING);
+	SetStatusText(
+		(boost::wformat(progressTemplate) % m_filesFound.load() % m_filesHashed.load()).str());
+}
+
+void DuplicateFilesDialog::SetStatusText(const std::wstring &text)
+{
+	SetDlgItemText(m_hDlg, IDC_DUPLICATES_STATUS, text.c_str());
+}
+
+INT_PTR DuplicateFilesDialog::OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
+{
+	UNREFERENCED_PARAMETER(lParam);
+
+	switch (uMsg)
+	{
+	case WM_APP_SEARCH_FINISHED:
+		OnSearchFinished(static_cast<HRESULT>(wParam));
+		break;
+	}
+
+	return 0;
+}
+
+void DuplicateFilesDialog::OnSearchFinished(HRESULT hr)
+{
+	KillTimer(m_hDlg, PROGRESS_TIMER_ID);
+	EnableWindow(GetDlgItem(m_hDlg, IDC_DUPLICATES_STOP), FALSE);
+
+	// The thread has already finished at this point, so this won't block.
+	m_searchThread.join();
+
+	if (hr == HRESULT_FROM_WIN32(ERROR_CANCELLED))
+	{
+		SetStatusText(ResourceHelper::LoadString(GetInstance(), IDS_DUPLICATES_CANCELLED));
+		return;
+	}
+
+	if (FAILED(hr))
+	{
+		SetStatusText(ResourceHelper::LoadString(GetInstance(), IDS_DUPLICATES_ERROR));
+		return;
+	}
+
+	ULONGLONG wastedSpace = 0;
+
+	for (size_t groupIndex = 0; groupIndex < m_groups.size(); groupIndex++)
+	{
+		const auto &group = m_groups[groupIndex];
+
+		for (size_t pathIndex = 0; pathIndex < group.paths.size(); pathIndex++)
+		{
+			m_items.push_back({ groupIndex, pathIndex, std::nullopt });
+		}
+
+		wastedSpace += group.size * (group.paths.size() - 1);
+	}
+
+	ListView_SetItemCountEx(GetDlgItem(m_hDlg, IDC_DUPLICATES_LISTVIEW),
+		static_cast<int>(m_items.size()), 0);
+
+	std::wstring finishedTemplate =
+		ResourceHelper::LoadString(GetInstance(), IDS_DUPLICATES_FINISHED);
+	SetStatusText(
+		(boost::wformat(finishedTemplate) % m_groups.size() % FormatSize(wastedSpace)).str());
+}
+
+INT_PTR DuplicateFilesDialog::OnNotify(NMHDR *pnmhdr)
+{
+	if (pnmhdr->hwndFrom != GetDlgItem(m_hDlg, IDC_DUPLICATES_LISTVIEW))
+	{
+		return 0;
+	}
+
+	switch (pnmhdr->code)
+	{
+	case LVN_GETDISPINFO:
+		OnListViewGetDisplayInfo(reinterpret_cast<NMLVDISPINFO *>(pnmhdr));
+		break;
+
+	case NM_DBLCLK:
+		OnListViewDoubleClick();
+		break;
+	}
+
+	return 0;
+}
+
+void DuplicateFilesDialog::OnListViewGetDisplayInfo(NMLVDISPINFO *dispInfo)
+{
+	if (dispInfo->item.iItem < 0 || dispInfo->item.iItem >= static_cast<int>(m_items.size()))
+	{
+		return;
+	}
+
+	auto &item = m_items[dispInfo->item.iItem];
+	const std::wstring &path = GetItemPath(item);
+
+	if (WI_IsFlagSet(dispInfo->item.mask, LVIF_IMAGE))
+	{
+		if (!item.iconIndex)
+		{
+			SHFILEINFO shfi;
+			DWORD_PTR res = SHGetFileInfo(path.c_str(), 0, &shfi, sizeof(shfi), SHGFI_SYSICONINDEX);
+			item.iconIndex = (res != 0) ? shfi.iIcon : 0;
+		}
+
+		dispInfo->item.iImage = *item.iconIndex;
+	}
+
+	if (WI_IsFlagClear(dispInfo->item.mask, LVIF_TEXT))
+	{
+		return;
+	}
+
+	std::wstring text;
+
+	switch (dispInfo->item.iSubItem)
+	{
+	case COLUMN_NAME:
+		text = PathFindFileName(path.c_str());
+		break;
+
+	case COLUMN_FOLDER:
+		text = path.substr(0, path.size() - wcslen(PathFindFileName(path.c_str())));
+		break;
+
+	case COLUMN_SIZE:
+		text = FormatSize(m_groups[item.groupIndex].size);
+		break;
+
+	case COLUMN_GROUP:
+		text = std::to_wstring(item.groupIndex + 1);
+		break;
+	}
+
+	StringCchCopy(dispInfo->item.pszText, dispInfo->item.cchTextMax, text.c_str());
+}
+
+void DuplicateFilesDialog::OnListViewDoubleClick()
+{
+	int selectedItem = ListView_GetNextItem(
+		GetDlgItem(m_hDlg, IDC_DUPLICATES_LISTVIEW), -1, LVNI_ALL | LVNI_SELECTED);
+
+	if (selectedItem == -1)
+	{
+		return;
+	}
+
+	m_expp->OpenItem(GetItemPath(m_items[selectedItem]).c_str());
+}
+
+const std::wstring &DuplicateFilesDialog::GetItemPath(const ResultItem &item) const
+{
+	return m_groups[item.groupIndex].paths[item.pathIndex];
+}
+
+INT_PTR DuplicateFilesDialog::OnCommand(WPARAM wParam, LPARAM lParam)
+{
+	UNREFERENCED_PARAMETER(lParam);
+
+	switch (LOWORD(wParam))
+	{
+	case IDC_DUPLICATES_STOP:
+		StopSearch();
+		break;
+
+	case IDCANCEL:
+		DestroyWindow(m_hDlg);
+		break;
+	}
+
+	return 0;
+}
+
+INT_PTR DuplicateFilesDialog::OnClose()
+{
+	DestroyWindow(m_hDlg);
+	return 0;
+}
+
+INT_PTR DuplicateFilesDialog::OnNcDestroy()
+{
+	delete this;
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "DarkModeDialogBase.h"
+#include "../Helper/DuplicateFinder.h"
+#include <atomic>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+__interface IExplorerplusplus;
+
+// Searches a set of folders for files with identical contents (see FindDuplicateFiles()) and lists
+// the files found, one group after another. The search runs on a background thread, with its
+// progress shown in the status text. The listview is virtual, so that a large set of results can
+// be shown without inserting an item for each file.
+class DuplicateFilesDialog : public DarkModeDialogBase
+{
+public:
+	DuplicateFilesDialog(HINSTANCE hInstance, HWND hParent, IExplorerplusplus *expp,
+		std::vector<std::wstring> folders);
+
+protected:
+	INT_PTR OnInitDialog() override;
+	INT_PTR OnCommand(WPARAM wParam, LPARAM lParam) override;
+	INT_PTR OnNotify(NMHDR *pnmhdr) override;
+	INT_PTR OnTimer(int iTimerID) override;
+	INT_PTR OnClose() override;
+	INT_PTR OnNcDestroy() override;
+	INT_PTR OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lParam) override;
+
+private:
+	static const UINT_PTR PROGRESS_TIMER_ID = 1;
+	static const UINT PROGRESS_TIMER_INTERVAL = 250;
+
+	// Posted by the search thread once the search has finished. The wParam holds the result.
+	static const UINT WM_APP_SEARCH_FINISHED = WM_APP + 1;
+
+	enum Column
+	{
+		COLUMN_NAME = 0,
+		COLUMN_FOLDER = 1,
+		COLUMN_SIZE = 2,
+		COLUMN_GROUP = 3
+	};
+
+	// A single row in the listview.
+	struct ResultItem
+	{
+		size_t groupIndex;
+		size_t pathIndex;
+
+		// Only retrieved once the item is shown.
+		std::optional<int> iconIndex;
+	};
+
+	void GetResizableControlInformation(BaseDialog::DialogSizeConstraint &dsc,
+		std::list<ResizableDialog::Control> &ControlList) override;
+
+	void SetUpListView();
+	void StartSearch();
+	void StopSearch();
+	void OnSearchFinished(HRESULT hr);
+	void UpdateProgress();
+	void SetStatusText(const std::wstring &text);
+	void OnListViewGetDisplayInfo(NMLVDISPINFO *dispInfo);
+	void OnListViewDoubleClick();
+	const std::wstring &GetItemPath(const ResultItem &item) const;
+
+	IExplorerplusplus *m_expp;
+	const std::vector<std::wstring> m_folders;
+
+	// Updated by the search thread. The groups are only read once the search has finished.
+	std::atomic<int> m_filesFound = 0;
+	std::atomic<int> m_filesHashed = 0;
+	std::vector<DuplicateFileGroup> m_groups;
+
+	std::vector<ResultItem> m_items;
+
+	// Declared last, so that the search is stopped (and the thread joined) before anything the
+	// thread uses is destroyed.
+	std::jthread m_searchThread;
+};
\ No newline at end of file
@@ -5,15 +5,21 @@
 #include "stdafx.h"
 #include "Explorer++.h"
 #include "Bookmarks/BookmarkIconManager.h"
+#include "Bookmarks/BookmarkJournal.h"
 #include "Bookmarks/UI/BookmarksMainMenu.h"
 #include "Bookmarks/UI/BookmarksToolbar.h"
 #include "ColorRuleHelper.h"
 #include "Config.h"
 #include "Explorer++_internal.h"
+#include "HangWatchdog.h"
 #include "MenuRanges.h"
 #include "Plugins/PluginManager.h"
+#include "ShellBrowser/ShellBrowser.h"
 #include "TabRestorerUI.h"
+#include "TabSessionJournal.h"
 #include "UiTheming.h"
+#include "../Helper/FileOperationQueue.h"
+#include "../Helper/PhaseTimer.h"
 #include "../Helper/WindowSubclassWrapper.h"
 #include "../Helper/iDirectoryMonitor.h"
 
@@ -32,12 +38,22 @@ const std::vector<std::wstring> Explorerplusplus::BLACKLISTED_BACKGROUND_MENU_CL
 
 Explorerplusplus::Explorerplusplus(HWND hwnd) :
 	m_hContainer(hwnd),
-	m_cachedIcons(MAX_CACHED_ICONS),
+	m_cachedIcons(MAX_CACHED_ICONS_SIZE),
+	m_pluginEventQueue([hwnd] { PostMessage(hwnd, WM_APP_DELIVERPLUGINEVENTS, 0, 0); }),
+	m_pluginTaskRunner(&m_pluginEventQueue,
+		[hwnd] { PostMessage(hwnd, WM_APP_DELIVERPLUGINTASKCOMPLETIONS, 0, 0); }),
+	m_pluginDirectoryWatcher(&m_pluginEventQueue,
+		[hwnd] { PostMessage(hwnd, WM_APP_DELIVERPLUGINDIRECTORYCHANGES, 0, 0); }),
 	m_pluginMenuManager(hwnd, MENU_PLUGIN_STARTID, MENU_PLUGIN_ENDID),
 	m_acceleratorUpdater(&g_hAccl),
-	m_pluginCommandManager(&g_hAccl, ACCELERATOR_PLUGIN_STARTID, ACCELERATOR_PLUGIN_ENDID),
-	m_bookmarkIconFetcher(hwnd, &m_cachedIcons),
-	m_tabBarBackgroundBrush(CreateSolidBrush(TAB_BAR_DARK_MODE_BACKGROUND_COLOR))
+	m_pluginCommandManager(&m_acceleratorUpdater, ACCELERATOR_PLUGIN_STARTID, ACCELERATOR_PLUGIN_ENDID),
+	m_bookmarkIconFetcher(hwnd, &m_cachedIcons, &ShellBrowser::GetBackgroundTaskScheduler()),
+	m_folderSizeThreadPool(1),
+	m_displayWindowDetailsThreadPool(
+		1, std::bind(CoInitializeEx, nullptr, COINIT_APARTMENTTHREADED), CoUninitialize),
+	m_tabBarBackgroundBrush(CreateSolidBrush(TAB_BAR_DARK_MODE_BACKGROUND_COLOR)),
+	m_statusBarThreadPool(1),
+	m_settingsWriter(1)
 {
 	m_hLanguageModule = nullptr;
 
@@ -57,6 +73,7 @@ Explorerplusplus::Explorerplusplus(HWND hwnd) :
 	m_hTabBacking = nullptr;
 	m_hTabWindowToolbar = nullptr;
 	m_hDisplayWindow = nullptr;
+	m_quickFilterBar = nullptr;
 	m_foldersToolbarParent = nullptr;
 	m_hFoldersToolbar = nullptr;
 	m_hLastActiveWindow = nullptr;
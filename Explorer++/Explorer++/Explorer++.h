@@ -7,9 +7,13 @@
 #include "AcceleratorUpdater.h"
 #include "Bookmarks/BookmarkTree.h"
 #include "CoreInterface.h"
+#include "InstanceHandoff.h"
 #include "Navigation.h"
 #include "PluginInterface.h"
 #include "Plugins/PluginCommandManager.h"
+#include "Plugins/PluginEventQueue.h"
+#include "Plugins/PluginDirectoryWatcher.h"
+#include "Plugins/PluginTaskRunner.h"
 #include "Plugins/PluginMenuManager.h"
 #include "ShellBrowser/Columns.h"
 #include "ShellBrowser/SortModes.h"
@@ -17,17 +21,37 @@
 #include "TabNavigationInterface.h"
 #include "ValueWrapper.h"
 #include "../Helper/CachedIcons.h"
+#include "../Helper/ContextMenuPrewarmer.h"
 #include "../Helper/DropHandler.h"
 #include "../Helper/FileActionHandler.h"
 #include "../Helper/FileContextMenuManager.h"
 #include "../Helper/IconFetcher.h"
+#include "../Helper/NewMenuPrewarmer.h"
+#include "../Helper/PriorityTaskScheduler.h"
+#include "../Helper/SectionChangeTracker.h"
+#include "../Helper/VolumeInfoCache.h"
+#include "../Helper/WildcardMatcher.h"
+#include "../ThirdParty/CTPL/cpl_stl.h"
 #include <boost/signals2.hpp>
 #include <wil/resource.h>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <mutex>
 #include <optional>
+#include <stop_token>
+#include <unordered_set>
 
-/* Sent when a folder size calculation has finished. */
+/* Sent when a folder size calculation has progressed or finished. */
 #define WM_APP_FOLDERSIZECOMPLETED WM_APP + 3
 
+/* Sent when the display window details for the selected item
+(e.g. the dimensions of an image) have been read. */
+#define WM_APP_DISPLAYWINDOWDETAILSREADY WM_APP + 4
+
+/* Sent when the free space shown in the status bar has been read. */
+#define WM_APP_STATUSBARFREESPACEREADY WM_APP + 5
+
 /* Private definitions. */
 #define FROM_LISTVIEW 0
 #define FROM_TREEVIEW 1
@@ -35,11 +59,17 @@
 // Forward declarations.
 class AddressBar;
 class ApplicationToolbar;
+class BookmarkJournal;
 class BookmarksMainMenu;
 class BookmarksToolbar;
 struct ColumnWidth;
 struct Config;
+struct DirectoryChange;
+struct DriveChange;
 class DrivesToolbar;
+class FileOperationQueue;
+struct FolderInfo;
+class HangWatchdog;
 class IconResourceLoader;
 __interface IDirectoryMonitor;
 class ILoadSave;
@@ -47,9 +77,16 @@ class LoadSaveRegistry;
 class LoadSaveXML;
 class MainToolbar;
 class MainWindow;
+class MemoryPressureMonitor;
+class NamedPipeServer;
+enum class NetworkLocationMode;
+struct PendingSortProgress;
+class PhaseTimer;
+class QuickFilterBar;
 class ShellBrowser;
 class ShellTreeView;
 class TabContainer;
+class TabSessionJournal;
 class TabRestorer;
 class TabRestorerUI;
 struct TabSettings;
@@ -67,6 +104,11 @@ namespace Plugins
 	class PluginManager;
 }
 
+namespace SettingsCache
+{
+	struct Contents;
+}
+
 class Explorerplusplus :
 	public IExplorerplusplus,
 	public TabNavigationInterface,
@@ -88,7 +130,8 @@ public:
 	LRESULT CALLBACK TreeViewSubclass(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
 
 	/* Directory modification. */
-	static void DirectoryAlteredCallback(const TCHAR *szFileName, DWORD dwAction, void *pData);
+	static void DirectoryAlteredCallback(
+		const std::vector<DirectoryChange> &changes, bool overflowed, void *pData);
 
 private:
 	static const int MIN_SHELL_MENU_ID = 1;
@@ -97,6 +140,11 @@ private:
 	static const UINT MINIMUM_DISPLAYWINDOW_WIDTH = 70;
 	static const UINT MINIMUM_DISPLAYWINDOW_HEIGHT = 70;
 
+	/* The number of items whose display window details are
+	kept, so that moving back to a recently selected item
+	doesn't require its details to be read again. */
+	static const size_t MAX_CACHED_DISPLAY_WINDOW_DETAILS = 64;
+
 	/* The number of toolbars that appear in the
 	main rebar. */
 	static const int NUM_MAIN_TOOLBARS = 5;
@@ -113,12 +161,19 @@ private:
 	static const UINT_PTR AUTOSAVE_TIMER_ID = 100000;
 	static const UINT AUTOSAVE_TIMEOUT = 30000;
 
+	/* Changes to the set of tabs are journaled, so the tabs
+	are only saved in full this often (or once the journal
+	has been idle for an autosave interval). */
+	static constexpr auto TABS_FULL_SAVE_INTERVAL = std::chrono::minutes(5);
+
 	static const UINT_PTR LISTVIEW_ITEM_CHANGED_TIMER_ID = 100001;
 	static const UINT LISTVIEW_ITEM_CHANGED_TIMEOUT = 50;
 
+	static const int MAX_PREWARMED_SELECTION = 100;
+
 	// Represents the maximum number of icons that can be cached. This cache is
 	// shared between various components in the application.
-	static const int MAX_CACHED_ICONS = 1000;
+	static const size_t MAX_CACHED_ICONS_SIZE = 1024 * 1024;
 
 	static inline constexpr COLORREF TAB_BAR_DARK_MODE_BACKGROUND_COLOR = RGB(25, 25, 25);
 
@@ -141,7 +196,9 @@ private:
 	{
 		ULARGE_INTEGER liFolderSize;
 		int uId;
-		int iTabId;
+
+		// False if this is a running total, sent while the calculation is still in progress.
+		bool finished;
 	};
 
 	struct DWFolderSize
@@ -149,12 +206,17 @@ private:
 		int uId;
 		int iTabId;
 		BOOL bValid;
+		std::stop_source stopSource;
 	};
 
-	struct FolderSizeExtraInfo
+	// Identifies the item that a set of display window details was read for. The modification
+	// time is included, so that details cached before the item changed aren't reused.
+	struct DWDetailsKey
 	{
-		void *pContainer;
-		int uId;
+		std::wstring path;
+		ULONGLONG lastWriteTime;
+
+		bool operator==(const DWDetailsKey &) const = default;
 	};
 
 	enum class PasteType
@@ -175,6 +237,7 @@ private:
 	LRESULT HandleControlNotification(HWND hwnd, WPARAM wParam);
 	LRESULT CALLBACK NotifyHandler(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
 	void OnCreate();
+	void OnDeferredInitialization();
 	BOOL OnSize(int MainWindowWidth, int MainWindowHeight);
 	void OnDpiChanged(const RECT *updatedWindowRect);
 	std::optional<LRESULT> OnCtlColorStatic(HWND hwnd, HDC hdc);
@@ -190,6 +253,9 @@ private:
 	void OnIdaRClick();
 	void OnAssocChanged();
 	LRESULT OnCustomDraw(LPARAM lParam);
+	void UpdateColorRuleMatchers();
+	std::optional<size_t> FindMatchingColorRule(
+		const std::wstring &fullFileName, DWORD attributes) const;
 	void OnSelectTabByIndex(int iTab);
 
 	/* Main menu handlers. */
@@ -215,6 +281,9 @@ private:
 	void OnGroupBy(SortMode sortMode);
 	void OnSortByAscending(BOOL bSortAscending);
 	void OnShowHiddenFiles();
+	void OnToggleAllowCloudDownloads();
+	void OnToggleFlatView();
+	void OnSetNetworkLocationMode(NetworkLocationMode mode);
 	void OnRefresh();
 	void OnSelectColumns();
 	void OnAutoSizeColumns();
@@ -222,9 +291,13 @@ private:
 	void OnMergeFiles();
 	void OnSplitFile();
 	void OnDestroyFiles();
+	void OnComputeHashes();
 	void OnSearch();
+	void OnFindDuplicateFiles();
+	void OnShowDiskUsage();
 	void OnCustomizeColors();
 	void OnRunScript();
+	void OnShowDiagnostics();
 	void OnShowOptions();
 	void OnShowHelp();
 	void OnCheckForUpdates();
@@ -252,6 +325,7 @@ private:
 	void OnListViewBackgroundRClickWindows8OrGreater(POINT *pCursorPos);
 	void OnListViewBackgroundRClickWindows7(POINT *pCursorPos);
 	void OnListViewItemRClick(POINT *pCursorPos);
+	void PrewarmSelectionContextMenu();
 	void OnListViewCopyItemPath() const;
 	void OnListViewCopyUniversalPaths() const;
 	void OnListViewSetFileAttributes() const;
@@ -284,10 +358,16 @@ private:
 		const TabsInitializedSignal::slot_type &observer) override;
 	void OnTabCreated(int tabId, BOOL switchToNewTab);
 	void OnTabSelected(const Tab &tab);
+	void OnTabListViewChanged(HWND previousListView, HWND newListView);
 	void ShowTabBar() override;
 	void HideTabBar() override;
 	HRESULT RestoreTabs(ILoadSave *pLoadSave);
+	void StartStartupFolderEnumeration(ILoadSave *pLoadSave);
+	void InitializeTabSessionJournal(bool tabsMatchSavedSession);
+	void ReplayTabSessionJournal();
+	void StartTabSessionJournal();
 	void OnTabListViewSelectionChanged(const Tab &tab);
+	void OnTabListViewSelectionAttributesChanged(const Tab &tab);
 
 	/* TabNavigationInterface methods. */
 	void CreateNewTab(PCIDLIST_ABSOLUTE pidlDirectory, bool selected) override;
@@ -303,6 +383,9 @@ private:
 	UiTheming *GetUiTheming() override;
 	AcceleratorUpdater *GetAccleratorUpdater() override;
 	Plugins::PluginCommandManager *GetPluginCommandManager() override;
+	Plugins::PluginEventQueue *GetPluginEventQueue() override;
+	Plugins::PluginTaskRunner *GetPluginTaskRunner() override;
+	Plugins::PluginDirectoryWatcher *GetPluginDirectoryWatcher() override;
 
 	/* Plugins. */
 	void InitializePlugins();
@@ -330,9 +413,36 @@ private:
 	/* Main toolbar private message handlers. */
 	void OnToolbarRClick(HWND sourceWindow);
 
+	/* Instance handoff. */
+	void UpdateInstanceHandoffServer();
+	bool OnInstanceHandoffMessage(const std::wstring &message);
+	void OnInstanceHandoff();
+
+	/* Hang detection. */
+	void StartHangWatchdog();
+	void OnHangWatchdogPing(uint64_t pingId);
+
+	/* Memory budget. */
+	void StartMemoryPressureMonitor();
+	void OnMemoryPressure(size_t workingSetBytes, bool lowMemory);
+
 	/* Settings. */
 	void SaveAllSettings() override;
+	void SaveAllSettingsAndWait();
+	void SaveSettings(bool waitForCompletion);
+	SettingsCache::Contents CaptureCachedSettings();
+	bool ShouldSaveTabsInFull() const;
 	void LoadAllSettings(ILoadSave **pLoadSave);
+	void LoadFolderSizes();
+	void SaveFolderSizes();
+	void LoadNetworkLocations();
+	void SaveNetworkLocations();
+	void LoadIconCache();
+	void SaveIconCache();
+	void LoadClosedTabs();
+	void SaveClosedTabs();
+	void LoadBookmarkJournal();
+	static std::wstring GetCacheFilePath(const TCHAR *fileName);
 	void ValidateLoadedSettings();
 	void ValidateColumns(FolderColumns &folderColumns);
 	void ValidateSingleColumnSet(int iColumnSet, std::vector<Column_t> &columns);
@@ -345,6 +455,7 @@ private:
 	LONG SaveGenericSettingsToRegistry();
 	void SaveTabSettingsToRegistry();
 	int LoadTabSettingsFromRegistry();
+	std::optional<std::wstring> LoadTabDirectoryFromRegistry(int index);
 	std::vector<Column_t> LoadColumnFromRegistry(HKEY hColumnsKey, const TCHAR *szKeyName);
 	void SaveColumnToRegistry(
 		HKEY hColumnsKey, const TCHAR *szKeyName, std::vector<Column_t> *pColumns);
@@ -366,12 +477,12 @@ private:
 	void LoadGenericSettingsFromXML(IXMLDOMDocument *pXMLDom);
 	void SaveGenericSettingsToXML(IXMLDOMDocument *pXMLDom, IXMLDOMElement *pRoot);
 	int LoadTabSettingsFromXML(IXMLDOMDocument *pXMLDom);
+	std::optional<std::wstring> LoadTabDirectoryFromXML(IXMLDOMDocument *pXMLDom, int index);
 	void SaveTabSettingsToXML(IXMLDOMDocument *pXMLDom, IXMLDOMElement *pRoot);
 	void SaveTabSettingsToXMLnternal(IXMLDOMDocument *pXMLDom, IXMLDOMElement *pe);
 	int LoadColumnFromXML(IXMLDOMNode *pNode, std::vector<Column_t> &outputColumns);
 	void SaveColumnToXML(IXMLDOMDocument *pXMLDom, IXMLDOMElement *pColumnsNode,
 		const std::vector<Column_t> &columns, const TCHAR *szColumnSet, int iIndent);
-	void LoadBookmarksFromXML(IXMLDOMDocument *pXMLDom);
 	void SaveBookmarksToXML(IXMLDOMDocument *pXMLDom, IXMLDOMElement *pRoot);
 	void LoadDefaultColumnsFromXML(IXMLDOMDocument *pXMLDom);
 	void SaveDefaultColumnsToXML(IXMLDOMDocument *pXMLDom, IXMLDOMElement *pRoot);
@@ -392,10 +503,13 @@ private:
 	/* Window state update. */
 	void UpdateWindowStates(const Tab &tab);
 	void UpdateTreeViewSelection();
+	void ScheduleTreeViewSelectionUpdate();
 	void ResizeWindows();
 	void SetListViewInitialPosition(HWND hListView) override;
 	void AdjustFolderPanePosition();
 	void ToggleFolders();
+	void CreateQuickFilterBar();
+	void ToggleQuickFilterBar();
 	void UpdateLayout();
 
 	// Status bar
@@ -406,8 +520,15 @@ private:
 	void SetStatusBarLoadingText(PCIDLIST_ABSOLUTE pidl);
 	void OnNavigationCompletedStatusBar(const Tab &tab);
 	void OnNavigationFailedStatusBar(const Tab &tab);
+	void OnPendingSortProgressChangedStatusBar(const Tab &tab);
+	void SetStatusBarSortingText(const PendingSortProgress &progress);
+	void OnDriveChangedStatusBar(const DriveChange &change);
 	HRESULT UpdateStatusBarText(const Tab &tab);
-	int CreateDriveFreeSpaceString(const TCHAR *szPath, TCHAR *szBuffer, int nBuffer);
+	void RequestStatusBarFreeSpace(const std::wstring &directory);
+	void OnStatusBarFreeSpaceReady(int requestId);
+	void CancelStatusBarFreeSpace();
+	void UpdateStatusBarFileTransferText();
+	std::wstring CreateDriveFreeSpaceString(const VolumeInfoCache::SpaceInfo &spaceInfo);
 
 	/* Languages. */
 	void SetLanguageModule();
@@ -415,6 +536,14 @@ private:
 
 	/* File operations. */
 	void CopyToFolder(bool move);
+	void QueueCopyToFolder(const std::wstring &title, std::vector<PCIDLIST_ABSOLUTE> &pidls,
+		bool move);
+	bool QueueInternalPaste(PCIDLIST_ABSOLUTE destination);
+	void CreateFileOperationQueue();
+	void OnFileOperationQueueUpdated();
+	void TransferFilesUsingShell(const std::vector<std::wstring> &sourcePaths,
+		const std::wstring &destinationFolder, bool move);
+	void OnTogglePauseFileTransfers();
 	void OpenAllSelectedItems(
 		OpenFolderDisposition openFolderDisposition = OpenFolderDisposition::CurrentTab);
 	void OpenListViewItem(
@@ -483,6 +612,8 @@ private:
 	TabRestorer *GetTabRestorer() const override;
 	HWND GetTreeView() const override;
 	IDirectoryMonitor *GetDirectoryMonitor() const override;
+	FileOperationQueue *GetFileOperationQueue() const override;
+	Plugins::PluginManager *GetPluginManager() const override;
 	IconResourceLoader *GetIconResourceLoader() const override;
 	CachedIcons *GetCachedIcons() override;
 	BOOL GetSavePreferencesToXmlFile() const override;
@@ -499,6 +630,8 @@ private:
 	void SetMainMenuImages();
 	boost::signals2::connection AddMainMenuPreShowObserver(
 		const MainMenuPreShowSignal::slot_type &observer) override;
+	boost::signals2::connection AddMainMenuPopupObserver(
+		const MainMenuPopupSignal::slot_type &observer) override;
 	wil::unique_hmenu BuildViewsMenu() override;
 	void AddViewModesToMenu(HMENU menu, UINT startPosition, BOOL byPosition);
 
@@ -512,16 +645,29 @@ private:
 
 	/* Miscellaneous. */
 	void InitializeDisplayWindow();
+	void PopulateDrivesToolbar();
+	void OnDrivesToolbarPopulated();
+	void WarmUpBookmarkIcons();
 	void ShowMainRebarBand(HWND hwnd, BOOL bShow);
 	BOOL OnMouseWheel(MousewheelSource mousewheelSource, WPARAM wParam, LPARAM lParam) override;
 	StatusBar *GetStatusBar() override;
 	void HandleDirectoryMonitoring(int iTabId);
 	int DetermineListViewObjectIndex(HWND hListView);
 
-	static void FolderSizeCallbackStub(
-		int nFolders, int nFiles, PULARGE_INTEGER lTotalFolderSize, LPVOID pData);
-	void FolderSizeCallback(
-		FolderSizeExtraInfo *pfsei, int nFolders, int nFiles, PULARGE_INTEGER lTotalFolderSize);
+	void CalculateDisplayWindowFolderSize(const Tab &tab, const std::wstring &path);
+	static void PostDisplayWindowFolderSize(
+		HWND hwnd, int id, const FolderInfo &folderInfo, bool finished);
+	void StopDisplayWindowFolderSizes();
+	void RequestDisplayWindowImageDetails(const std::wstring &path, const FILETIME &lastWriteTime);
+	void RequestDisplayWindowDriveDetails(const std::wstring &path);
+	void QueueDisplayWindowDetails(std::function<std::vector<std::wstring>()> readDetails,
+		std::optional<DWDetailsKey> cacheKey);
+	void OnDisplayWindowDetailsReady(int requestId);
+	void CancelDisplayWindowDetails();
+	static std::vector<std::wstring> ReadImageDetails(
+		HMODULE languageModule, const std::wstring &path);
+	static std::vector<std::wstring> ReadDriveDetails(
+		HMODULE languageModule, const std::wstring &path);
 
 	HWND m_hContainer;
 	HWND m_hStatusBar;
@@ -552,11 +698,15 @@ private:
 	ULONG m_SHChangeNotifyID;
 	ValueWrapper<bool> m_InitializationFinished;
 
+	// Tracks the time taken by each step of startup. Destroyed once startup has finished.
+	std::unique_ptr<PhaseTimer> m_startupTimer;
+
 	/* Initialization. */
 	BOOL m_bLoadSettingsFromXML;
 
 	MainWindow *m_mainWindow;
 	AddressBar *m_addressBar;
+	QuickFilterBar *m_quickFilterBar;
 
 	std::unique_ptr<Navigation> m_navigation;
 
@@ -565,6 +715,7 @@ private:
 	CachedIcons m_cachedIcons;
 
 	MainMenuPreShowSignal m_mainMenuPreShowSignal;
+	MainMenuPopupSignal m_mainMenuPopupSignal;
 	FocusChangedSignal m_focusChangedSignal;
 	ApplicationShuttingDownSignal m_applicationShuttingDownSignal;
 
@@ -581,6 +732,9 @@ private:
 	std::unique_ptr<UiTheming> m_uiTheming;
 
 	/* Plugins. */
+	Plugins::PluginEventQueue m_pluginEventQueue;
+	Plugins::PluginTaskRunner m_pluginTaskRunner;
+	Plugins::PluginDirectoryWatcher m_pluginDirectoryWatcher;
 	std::unique_ptr<Plugins::PluginManager> m_pluginManager;
 	Plugins::PluginMenuManager m_pluginMenuManager;
 	AcceleratorUpdater m_acceleratorUpdater;
@@ -601,6 +755,11 @@ private:
 	/* Bookmarks. */
 	BookmarkTree m_bookmarkTree;
 	std::unique_ptr<BookmarksMainMenu> m_bookmarksMainMenu;
+
+	/* The value of the bookmark tree's change counter when the
+	bookmarks were last saved to the registry, used to only
+	write out the parts of the tree that have changed since. */
+	std::optional<uint64_t> m_bookmarksSavedToRegistryChange;
 	BookmarksToolbar *m_pBookmarksToolbar;
 
 	// IconFetcher retrieves file icons in a background thread. A queue of requests is maintained
@@ -624,6 +783,17 @@ private:
 	/* Customize colors. */
 	std::vector<NColorRuleHelper::ColorRule> m_ColorRules;
 
+	/* The compiled filename pattern for each of the color rules
+	above. These are used when drawing each item, so the patterns
+	are only parsed when the rules change. */
+	std::vector<WildcardMatcher> m_colorRuleMatchers;
+
+	/* Incremented each time the rules above change. Each item
+	caches the rule it matches, along with the generation it was
+	matched against, so that drawing an item doesn't require the
+	rules to be re-evaluated. */
+	int m_colorRuleGeneration = 0;
+
 	/* Undo support. */
 	FileActionHandler m_FileActionHandler;
 
@@ -636,6 +806,82 @@ private:
 	/* Display window folder sizes. */
 	std::list<DWFolderSize> m_DWFolderSizes;
 	int m_iDWFolderSizeUniqueId;
+	ctpl::thread_pool m_folderSizeThreadPool;
+
+	/* Display window details. Details that are slow to read
+	(e.g. image dimensions, which require the image to be
+	loaded) are read on a single background thread, with only
+	the request for the current selection being kept. */
+	ctpl::thread_pool m_displayWindowDetailsThreadPool;
+	std::future<std::vector<std::wstring>> m_displayWindowDetailsResult;
+	std::optional<DWDetailsKey> m_pendingDisplayWindowDetailsKey;
+	int m_displayWindowDetailsRequestId = 0;
+
+	// Ordered from most to least recently used.
+	std::list<std::pair<DWDetailsKey, std::vector<std::wstring>>> m_displayWindowDetailsCache;
+
+	/* Status bar free space. Finding the volume that contains
+	a directory (and querying its free space) can block on a
+	network drive, so it's done in the background each time the
+	selection changes. The text that's shown is left in place
+	while the directory stays the same, so it doesn't flicker. */
+	ctpl::thread_pool m_statusBarThreadPool;
+	std::future<std::optional<VolumeInfoCache::SpaceInfo>> m_statusBarFreeSpaceResult;
+	std::wstring m_statusBarFreeSpaceDirectory;
+	int m_statusBarFreeSpaceRequestId = 0;
+
+	/* Background file transfers. When native file transfers
+	are enabled, items copied or moved to a folder are queued
+	here, rather than being transferred behind a modal
+	progress dialog. While any transfers are pending, their
+	progress is shown in an extra status bar part. */
+	std::unique_ptr<FileOperationQueue> m_fileOperationQueue;
+	bool m_statusBarFileTransferPartShown = false;
+
+	/* Context menu prewarming. Any shell extensions that would
+	be loaded for the current selection are loaded ahead of time,
+	so that right-clicking doesn't stall. */
+	ContextMenuPrewarmer m_contextMenuPrewarmer;
+
+	/* The shell's New menu is built in the background
+	after startup, so that its first use doesn't stall. */
+	NewMenuPrewarmer m_newMenuPrewarmer;
+
+	/* Settings persistence. The writer is declared after the
+	change tracker and journals, since write tasks refer to
+	them. */
+	std::unique_ptr<BookmarkJournal> m_bookmarkJournal;
+
+	/* Null if another instance has the journal open. The tabs
+	XML is the copy last saved in full, which is reused until
+	they're next saved in full. */
+	std::unique_ptr<TabSessionJournal> m_tabSessionJournal;
+	std::vector<boost::signals2::scoped_connection> m_tabSessionConnections;
+	std::unordered_set<int> m_tabSessionTabIds;
+	std::optional<uint64_t> m_tabsSavedSequenceNumber;
+	std::chrono::steady_clock::time_point m_tabsSavedTime;
+	std::wstring m_savedTabsXml;
+	SectionChangeTracker m_settingsChangeTracker;
+	PriorityTaskScheduler m_settingsWriter;
+
+	/* Instance handoff. Requests are received on the
+	server thread and queued until the main thread
+	processes them. The server is declared last, so
+	that its thread is stopped before the queue is
+	destroyed. */
+	std::mutex m_instanceHandoffMutex;
+	std::vector<InstanceHandoff::Request> m_pendingInstanceHandoffRequests;
+	std::unique_ptr<NamedPipeServer> m_instanceHandoffServer;
+
+	/* Hang detection. Stopped as soon as the application
+	starts closing, since saving settings at that point can
+	legitimately take a while. */
+	std::unique_ptr<HangWatchdog> m_hangWatchdog;
+
+	/* Memory budget. The caches trimmed by the budget
+	are registered when the monitor is started. */
+	std::unique_ptr<MemoryPressureMonitor> m_memoryPressureMonitor;
+	int m_cachedIconsMemoryConsumerId = -1;
 
 	/* Rename support. */
 	bool m_bListViewRenaming;
@@ -23,6 +23,33 @@ namespace NExplorerplusplus
 
 	const TCHAR LOG_FILENAME[] = _T("Explorer++.log");
 
+	// The most recent reports generated when the UI thread stopped responding.
+	const TCHAR HANG_REPORTS_FILENAME[] = _T("HangReports.txt");
+
+	// The file that calculated folder sizes are saved to, if that's enabled.
+	const TCHAR FOLDER_SIZE_CACHE_FILENAME[] = _T("FolderSizes.dat");
+
+	// The per-server network location modes that have been chosen by the user.
+	const TCHAR NETWORK_LOCATIONS_FILENAME[] = _T("NetworkLocations.dat");
+
+	// The file that icon locations are saved to, if that's enabled.
+	const TCHAR ICON_CACHE_FILENAME[] = _T("IconCache.dat");
+
+	// The file that recently closed tabs are saved to, if that's enabled.
+	const TCHAR CLOSED_TABS_FILENAME[] = _T("ClosedTabs.dat");
+
+	// A binary copy of the larger sections of the XML config file, used to speed up loading.
+	const TCHAR SETTINGS_CACHE_FILENAME[] = _T("SettingsCache.dat");
+
+	// Changes made to the bookmarks since they were last saved.
+	const TCHAR BOOKMARK_JOURNAL_FILENAME[] = _T("BookmarkJournal.dat");
+
+	// Changes made to the set of open tabs since they were last saved.
+	const TCHAR TAB_SESSION_JOURNAL_FILENAME[] = _T("TabSessionJournal.dat");
+
+	// Background file transfers that haven't finished yet.
+	const TCHAR FILE_OPERATION_QUEUE_FILENAME[] = _T("FileOperationQueue.dat");
+
 	// Internal command line arguments.
 	const TCHAR JUMPLIST_TASK_NEWTAB_ARGUMENT[] = _T("--open-new-tab");
 	const TCHAR APPLICATION_CRASHED_ARGUMENT[] = _T("--application-crashed");
@@ -36,6 +63,14 @@ static const TCHAR SHELL_DEFAULT_INTERNAL_COMMAND_NAME[] = _T("openinexplorer++"
 
 #define WM_APP_ASSOCCHANGED (WM_APP + 54)
 #define WM_APP_KEYDOWN (WM_APP + 55)
+#define WM_APP_DEFERREDINITIALIZATION (WM_APP + 56)
+#define WM_APP_INSTANCEHANDOFF (WM_APP + 57)
+#define WM_APP_DELIVERPLUGINEVENTS (WM_APP + 58)
+#define WM_APP_FILEOPERATIONQUEUEUPDATED (WM_APP + 59)
+#define WM_APP_DELIVERPLUGINTASKCOMPLETIONS (WM_APP + 60)
+#define WM_APP_HANGWATCHDOGPING (WM_APP + 61)
+#define WM_APP_MEMORYPRESSURE (WM_APP + 62)
+#define WM_APP_DELIVERPLUGINDIRECTORYCHANGES (WM_APP + 63)
 
 /* Rebar menu id's. */
 #define ID_REBAR_MENU_BACK_START 2000
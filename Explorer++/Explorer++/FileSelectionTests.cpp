@@ -162,7 +162,7 @@ BOOL Explorerplusplus::CanPasteShellData(PasteType pastType) const
 	if (focus == m_hActiveListView)
 	{
 		const Tab &selectedTab = m_tabContainer->GetSelectedTab();
-		directory = selectedTab.GetShellBrowser()->GetDirectoryIdl();
+		directory = selectedTab.GetShellBrowser()->GetDirectoryIdl().Clone();
 	}
 	else if (focus == m_shellTreeView->GetHWND())
 	{
@@ -6,13 +6,16 @@
 #include "Explorer++.h"
 #include "Config.h"
 #include "MainResource.h"
+#include "QuickFilterBar.h"
 #include "ShellBrowser/ShellBrowser.h"
 #include "ShellBrowser/ShellNavigationController.h"
 #include "ShellBrowser/ViewModes.h"
 #include "ShellTreeView/ShellTreeView.h"
 #include "SortMenuBuilder.h"
 #include "TabContainer.h"
+#include "../Helper/FileOperationQueue.h"
 #include "../Helper/MenuHelper.h"
+#include "../Helper/NetworkLocationPolicy.h"
 
 void Explorerplusplus::UpdateWindowStates(const Tab &tab)
 {
@@ -78,8 +81,34 @@ void Explorerplusplus::SetProgramMenuItemStates(HMENU hProgramMenu)
 	MenuHelper::CheckItem(hProgramMenu, IDM_TOOLBARS_LOCKTOOLBARS, m_config->lockToolbars);
 	MenuHelper::CheckItem(
 		hProgramMenu, IDM_VIEW_SHOWHIDDENFILES, tab.GetShellBrowser()->GetShowHidden());
+	MenuHelper::CheckItem(hProgramMenu, IDM_VIEW_ALLOWCLOUDDOWNLOADS,
+		tab.GetShellBrowser()->GetAllowCloudHydration());
+	MenuHelper::CheckItem(hProgramMenu, IDM_VIEW_FLATVIEW, tab.GetShellBrowser()->GetFlatView());
+	MenuHelper::EnableItem(hProgramMenu, IDM_VIEW_FLATVIEW, !virtualFolder);
+
+	const std::wstring &networkServer = tab.GetShellBrowser()->GetNetworkServer();
+	MenuHelper::EnableItem(hProgramMenu, IDM_NETWORKLOCATION_AUTOMATIC, !networkServer.empty());
+	MenuHelper::EnableItem(hProgramMenu, IDM_NETWORKLOCATION_FULL, !networkServer.empty());
+	MenuHelper::EnableItem(hProgramMenu, IDM_NETWORKLOCATION_REDUCED, !networkServer.empty());
+
+	UINT networkLocationItem = IDM_NETWORKLOCATION_AUTOMATIC;
+
+	switch (NetworkLocationPolicy::GetInstance().GetMode(networkServer))
+	{
+	case NetworkLocationMode::Full:
+		networkLocationItem = IDM_NETWORKLOCATION_FULL;
+		break;
+
+	case NetworkLocationMode::Reduced:
+		networkLocationItem = IDM_NETWORKLOCATION_REDUCED;
+		break;
+	}
+
+	CheckMenuRadioItem(hProgramMenu, IDM_NETWORKLOCATION_AUTOMATIC, IDM_NETWORKLOCATION_REDUCED,
+		networkLocationItem, MF_BYCOMMAND);
 	MenuHelper::CheckItem(
 		hProgramMenu, IDM_FILTER_APPLYFILTER, tab.GetShellBrowser()->GetFilterStatus());
+	MenuHelper::CheckItem(hProgramMenu, IDM_FILTER_QUICKFILTER, m_quickFilterBar->IsShown());
 
 	MenuHelper::EnableItem(hProgramMenu, IDM_ACTIONS_NEWFOLDER, CanCreate());
 	MenuHelper::EnableItem(hProgramMenu, IDM_ACTIONS_SPLITFILE,
@@ -87,6 +116,10 @@ void Explorerplusplus::SetProgramMenuItemStates(HMENU hProgramMenu)
 	MenuHelper::EnableItem(
 		hProgramMenu, IDM_ACTIONS_MERGEFILES, tab.GetShellBrowser()->GetNumSelectedFiles() > 1);
 	MenuHelper::EnableItem(hProgramMenu, IDM_ACTIONS_DESTROYFILES, anySelected);
+	MenuHelper::EnableItem(hProgramMenu, IDM_ACTIONS_COMPUTEHASHES,
+		(tab.GetShellBrowser()->GetNumSelectedFiles() > 0) && !virtualFolder);
+	MenuHelper::CheckItem(hProgramMenu, IDM_ACTIONS_PAUSEFILETRANSFERS,
+		m_fileOperationQueue && m_fileOperationQueue->IsPaused());
 
 	UINT itemToCheck = GetViewModeMenuId(viewMode);
 	CheckMenuRadioItem(
@@ -98,6 +131,8 @@ void Explorerplusplus::SetProgramMenuItemStates(HMENU hProgramMenu)
 		tab.GetShellBrowser()->GetNavigationController()->CanGoForward());
 	MenuHelper::EnableItem(hProgramMenu, IDM_GO_UPONELEVEL,
 		tab.GetShellBrowser()->GetNavigationController()->CanGoUp());
+	MenuHelper::EnableItem(
+		hProgramMenu, IDM_GO_STOP, tab.GetShellBrowser()->IsNavigationPending());
 
 	MenuHelper::EnableItem(hProgramMenu, IDM_VIEW_AUTOSIZECOLUMNS, viewMode == +ViewMode::Details);
 
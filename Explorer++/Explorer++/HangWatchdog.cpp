@@ -0,0 +1,330 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "HangWatchdog.h"
+#include "Version.h"
+#include "../Helper/Logging.h"
+#include "../Helper/StringHelper.h"
+#include <boost/format.hpp>
+#include <DbgHelp.h>
+#include <fstream>
+
+HangWatchdog::HangWatchdog(HWND hwnd, UINT pingMessage, const std::wstring &reportsFilePath) :
+	m_hwnd(hwnd),
+	m_pingMessage(pingMessage),
+	m_reportsFilePath(reportsFilePath),
+	m_uiThread(OpenThread(THREAD_SUSPEND_RESUME | THREAD_GET_CONTEXT | THREAD_QUERY_INFORMATION,
+		FALSE, GetCurrentThreadId())),
+	m_detector(HANG_THRESHOLD),
+	m_thread(&HangWatchdog::Run, this)
+{
+}
+
+HangWatchdog::~HangWatchdog()
+{
+	{
+		std::lock_guard lock(m_mutex);
+		m_stopRequested = true;
+	}
+
+	m_stopCondition.notify_one();
+	m_thread.join();
+
+	if (m_symbolsInitialized)
+	{
+		SymCleanup(GetCurrentProcess());
+	}
+}
+
+void HangWatchdog::OnPing(uint64_t pingId, Context context)
+{
+	std::lock_guard lock(m_mutex);
+	m_lastAcknowledgedPingId = pingId;
+	m_context = std::move(context);
+}
+
+void HangWatchdog::SetNavigationPath(const std::wstring &navigationPath)
+{
+	std::lock_guard lock(m_mutex);
+	m_context.navigationPath = navigationPath;
+}
+
+void HangWatchdog::Run()
+{
+	LoadReports();
+
+	std::unique_lock lock(m_mutex);
+
+	while (!m_stopRequested)
+	{
+		auto now = HangDetector::Clock::now();
+		auto action = m_detector.Check(now, m_lastAcknowledgedPingId);
+
+		switch (action)
+		{
+		case HangDetector::Action::SendPing:
+			PostMessage(m_hwnd, m_pingMessage, static_cast<WPARAM>(m_detector.GetPendingPingId()),
+				0);
+			break;
+
+		case HangDetector::Action::ReportHang:
+			lock.unlock();
+			OnHangDetected(m_detector.GetHangDuration(now));
+			lock.lock();
+			break;
+
+		case HangDetector::Action::HangEnded:
+			lock.unlock();
+			OnHangEnded(m_detector.GetHangDuration(now));
+			lock.lock();
+			break;
+
+		case HangDetector::Action::None:
+			break;
+		}
+
+		m_stopCondition.wait_for(lock, CHECK_INTERVAL, [this] { return m_stopRequested; });
+	}
+}
+
+void HangWatchdog::OnHangDetected(HangDetector::Clock::duration hangDuration)
+{
+	Context context;
+
+	{
+		std::lock_guard lock(m_mutex);
+		context = m_context;
+	}
+
+	// Symbols are only needed once a hang has occurred, so they're not set up until then.
+	// Subsequent hangs refresh the module list, so that any modules loaded since (e.g. shell
+	// extensions) can be identified.
+	if (!m_symbolsInitialized)
+	{
+		SymSetOptions(SYMOPT_UNDNAME | SYMOPT_DEFERRED_LOADS);
+		m_symbolsInitialized = SymInitializeW(GetCurrentProcess(), nullptr, TRUE);
+	}
+	else
+	{
+		SymRefreshModuleList(GetCurrentProcess());
+	}
+
+	StackTrace stackTrace;
+	bool stackCaptured = CaptureUiThreadStack(stackTrace);
+
+	m_reports.push_back(
+		FormatReport(context, stackCaptured ? &stackTrace : nullptr, hangDuration));
+
+	while (m_reports.size() > MAX_REPORTS)
+	{
+		m_reports.pop_front();
+	}
+
+	SaveReports();
+
+	LOG(warning) << L"UI thread hasn't responded for "
+				 << std::chrono::duration_cast<std::chrono::milliseconds>(hangDuration).count()
+				 << L" ms. Hang report saved to \"" << m_reportsFilePath << L"\"";
+}
+
+void HangWatchdog::OnHangEnded(HangDetector::Clock::duration hangDuration)
+{
+	auto durationMs = std::chrono::duration_cast<std::chrono::milliseconds>(hangDuration).count();
+
+	if (!m_reports.empty())
+	{
+		m_reports.back() += (boost::wformat(L"Recovered after: %d ms\r\n") % durationMs).str();
+		SaveReports();
+	}
+
+	LOG(warning) << L"UI thread became responsive again after " << durationMs << L" ms";
+}
+
+// The UI thread is suspended while its stack is walked. Since the thread could be holding any lock
+// (including the heap lock) at that point, the frames are written to a fixed-size buffer and are
+// only resolved to modules and symbols once the thread has been resumed. The module list is
+// refreshed before this is called, so that dbghelp has as little work as possible to do while the
+// thread is suspended.
+bool HangWatchdog::CaptureUiThreadStack(StackTrace &stackTrace)
+{
+	if (!m_uiThread || !m_symbolsInitialized)
+	{
+		return false;
+	}
+
+	if (SuspendThread(m_uiThread.get()) == static_cast<DWORD>(-1))
+	{
+		return false;
+	}
+
+	auto resumeThread = wil::scope_exit([this] { ResumeThread(m_uiThread.get()); });
+
+	CONTEXT context = {};
+	context.ContextFlags = CONTEXT_FULL;
+
+	if (!GetThreadContext(m_uiThread.get(), &context))
+	{
+		return false;
+	}
+
+	STACKFRAME64 frame = {};
+	DWORD machineType;
+
+#if defined(_M_X64)
+	machineType = IMAGE_FILE_MACHINE_AMD64;
+	frame.AddrPC.Offset = context.Rip;
+	frame.AddrFrame.Offset = context.Rbp;
+	frame.AddrStack.Offset = context.Rsp;
+#elif defined(_M_IX86)
+	machineType = IMAGE_FILE_MACHINE_I386;
+	frame.AddrPC.Offset = context.Eip;
+	frame.AddrFrame.Offset = context.Ebp;
+	frame.AddrStack.Offset = context.Esp;
+#else
+	return false;
+#endif
+
+	frame.AddrPC.Mode = AddrModeFlat;
+	frame.AddrFrame.Mode = AddrModeFlat;
+	frame.AddrStack.Mode = AddrModeFlat;
+
+	while (stackTrace.numFrames < stackTrace.frames.size()
+		&& StackWalk64(machineType, GetCurrentProcess(), m_uiThread.get(), &frame, &context,
+			nullptr, SymFunctionTableAccess64, SymGetModuleBase64, nullptr)
+		&& frame.AddrPC.Offset != 0)
+	{
+		stackTrace.frames[stackTrace.numFrames++] = frame.AddrPC.Offset;
+	}
+
+	return stackTrace.numFrames > 0;
+}
+
+std::wstring HangWatchdog::FormatReport(const Context &context, const StackTrace *stackTrace,
+	HangDetector::Clock::duration hangDuration)
+{
+	SYSTEMTIME localTime;
+	GetLocalTime(&localTime);
+
+	std::wstring report = std::wstring(REPORT_HEADER) + L"\r\n";
+	report += (boost::wformat(L"Time: %04d-%02d-%02d %02d:%02d:%02d\r\n") % localTime.wYear
+		% localTime.wMonth % localTime.wDay % localTime.wHour % localTime.wMinute
+		% localTime.wSecond)
+				  .str();
+	report += (boost::wformat(L"Version: %s\r\n") % VERSION_STRING_W).str();
+	report += (boost::wformat(L"Unresponsive for: %d ms\r\n")
+		% std::chrono::duration_cast<std::chrono::milliseconds>(hangDuration).count())
+				  .str();
+	report += (boost::wformat(L"Navigation path: %s\r\n") % context.navigationPath).str();
+	report += (boost::wformat(L"Tabs: %d\r\n") % context.numTabs).str();
+	report += (boost::wformat(L"Pending tasks: %d column, %d thumbnail, %d icon\r\n")
+		% context.pendingColumnTasks % context.pendingThumbnailTasks % context.pendingIconTasks)
+				  .str();
+
+	if (!stackTrace)
+	{
+		report += L"Stack: unavailable\r\n";
+		return report;
+	}
+
+	report += L"Stack:\r\n";
+
+	for (size_t i = 0; i < stackTrace->numFrames; i++)
+	{
+		report += L"  " + FormatStackFrame(stackTrace->frames[i]) + L"\r\n";
+	}
+
+	return report;
+}
+
+std::wstring HangWatchdog::FormatStackFrame(DWORD64 address)
+{
+	std::wstring moduleName = L"<unknown>";
+	DWORD64 moduleOffset = address;
+	HMODULE module;
+
+	if (GetModuleHandleEx(
+			GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+			reinterpret_cast<LPCWSTR>(static_cast<uintptr_t>(address)), &module))
+	{
+		TCHAR modulePath[MAX_PATH];
+
+		if (GetModuleFileName(module, modulePath, SIZEOF_ARRAY(modulePath)) != 0)
+		{
+			moduleName = PathFindFileName(modulePath);
+		}
+
+		moduleOffset = address - reinterpret_cast<uintptr_t>(module);
+	}
+
+	// Symbols will often only be available for exported functions, but that's generally enough to
+	// determine which system call the thread is stuck in.
+	alignas(SYMBOL_INFOW) BYTE symbolBuffer[sizeof(SYMBOL_INFOW) + MAX_SYM_NAME * sizeof(WCHAR)];
+	auto *symbol = reinterpret_cast<SYMBOL_INFOW *>(symbolBuffer);
+	symbol->SizeOfStruct = sizeof(SYMBOL_INFOW);
+	symbol->MaxNameLen = MAX_SYM_NAME;
+
+	DWORD64 displacement;
+
+	if (SymFromAddrW(GetCurrentProcess(), address, &displacement, symbol))
+	{
+		return (boost::wformat(L"%s!%s+0x%x") % moduleName % symbol->Name % displacement).str();
+	}
+
+	return (boost::wformat(L"%s+0x%x") % moduleName % moduleOffset).str();
+}
+
+// Reports from previous sessions are kept, so that the file always contains the most recent
+// reports, regardless of which session they came from.
+void HangWatchdog::LoadReports()
+{
+	std::ifstream stream(m_reportsFilePath, std::ios::binary);
+
+	if (!stream)
+	{
+		return;
+	}
+
+	std::string contents(
+		(std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+	std::wstring text = utf8StrToWstr(contents);
+
+	size_t start = text.find(REPORT_HEADER);
+
+	while (start != std::wstring::npos)
+	{
+		size_t next = text.find(REPORT_HEADER, start + 1);
+
+		std::wstring report = text.substr(start, next - start);
+		TrimStringRight(report, L"\r\n");
+		m_reports.push_back(report + L"\r\n");
+
+		start = next;
+	}
+
+	while (m_reports.size() > MAX_REPORTS)
+	{
+		m_reports.pop_front();
+	}
+}
+
+void HangWatchdog::SaveReports()
+{
+	std::ofstream stream(m_reportsFilePath, std::ios::binary | std::ios::trunc);
+
+	if (!stream)
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < m_reports.size(); i++)
+	{
+		if (i > 0)
+		{
+			stream << "\r\n";
+		}
+
+		stream << wstrToUtf8Str(m_reports[i]);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,98 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "../Helper/HangDetector.h"
+#include "../Helper/Macros.h"
+#include <wil/resource.h>
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Watches for the UI thread becoming unresponsive. A background thread posts a ping message to the
+// main window once a second and the window acknowledges it by calling OnPing(). If a ping isn't
+// acknowledged within the threshold, the stack of the UI thread is captured, along with the state
+// that was last published by the UI thread, and a report is written out.
+//
+// The most recent reports are kept in a file, so that they're still available if the application
+// had to be terminated.
+class HangWatchdog
+{
+public:
+	// Published by the UI thread each time it acknowledges a ping. Since the UI thread can't be
+	// queried once it's hung, the report contains the last state that was published.
+	struct Context
+	{
+		// The folder that's open in the active tab, or the folder that's currently being navigated
+		// to.
+		std::wstring navigationPath;
+
+		size_t numTabs = 0;
+
+		// The background tasks queued by the active tab, whose results haven't been processed yet.
+		size_t pendingColumnTasks = 0;
+		size_t pendingThumbnailTasks = 0;
+		size_t pendingIconTasks = 0;
+	};
+
+	// Should be constructed on the UI thread. pingMessage will be posted to hwnd, with the ping id
+	// as the WPARAM.
+	HangWatchdog(HWND hwnd, UINT pingMessage, const std::wstring &reportsFilePath);
+	~HangWatchdog();
+
+	void OnPing(uint64_t pingId, Context context);
+
+	// Can be called when a navigation starts, so that a hang during the navigation will be
+	// attributed to the folder being navigated to.
+	void SetNavigationPath(const std::wstring &navigationPath);
+
+private:
+	DISALLOW_COPY_AND_ASSIGN(HangWatchdog);
+
+	static constexpr auto HANG_THRESHOLD = std::chrono::seconds(5);
+	static constexpr auto CHECK_INTERVAL = std::chrono::seconds(1);
+	static constexpr size_t MAX_STACK_FRAMES = 64;
+	static constexpr size_t MAX_REPORTS = 10;
+
+	// Each report in the file starts with this line.
+	static constexpr wchar_t REPORT_HEADER[] = L"=== Hang report ===";
+
+	struct StackTrace
+	{
+		std::array<DWORD64, MAX_STACK_FRAMES> frames;
+		size_t numFrames = 0;
+	};
+
+	void Run();
+	void OnHangDetected(HangDetector::Clock::duration hangDuration);
+	void OnHangEnded(HangDetector::Clock::duration hangDuration);
+	bool CaptureUiThreadStack(StackTrace &stackTrace);
+	std::wstring FormatReport(const Context &context, const StackTrace *stackTrace,
+		HangDetector::Clock::duration hangDuration);
+	std::wstring FormatStackFrame(DWORD64 address);
+	void LoadReports();
+	void SaveReports();
+
+	const HWND m_hwnd;
+	const UINT m_pingMessage;
+	const std::wstring m_reportsFilePath;
+	wil::unique_handle m_uiThread;
+
+	std::mutex m_mutex;
+	uint64_t m_lastAcknowledgedPingId = 0;
+	Context m_context;
+	std::condition_variable m_stopCondition;
+	bool m_stopRequested = false;
+
+	// Only accessed from the watchdog thread.
+	HangDetector m_detector;
+	bool m_symbolsInitialized = false;
+	std::deque<std::wstring> m_reports;
+
+	std::thread m_thread;
+};
\ No newline at end of file
@@ -4,6 +4,10 @@
 
 #include "stdafx.h"
 #include "HardwareChangeNotifier.h"
+#include "../Helper/ParsedPathCache.h"
+#include "../Helper/ShellHelper.h"
+#include "../Helper/UniversalPathCache.h"
+#include "../Helper/VolumeInfoCache.h"
 
 HardwareChangeNotifier &HardwareChangeNotifier::GetInstance()
 {
@@ -11,48 +15,86 @@ HardwareChangeNotifier &HardwareChangeNotifier::GetInstance()
 	return hcn;
 }
 
-void HardwareChangeNotifier::AddObserver(NHardwareChangeNotifier::INotification *hcn)
+boost::signals2::connection HardwareChangeNotifier::AddDriveChangedObserver(
+	const DriveChangedSignal::slot_type &observer)
 {
-	m_Observers.push_back(hcn);
+	return m_driveChangedSignal.connect(observer);
 }
 
-void HardwareChangeNotifier::RemoveObserver(NHardwareChangeNotifier::INotification *hcn)
+void HardwareChangeNotifier::OnDeviceChange(WPARAM wParam, LPARAM lParam)
 {
-	auto itr = std::find_if(m_Observers.begin(), m_Observers.end(),
-		[hcn](const NHardwareChangeNotifier::INotification *hcnCurrent) {
-			return hcnCurrent == hcn;
-		});
+	if (wParam != DBT_DEVICEARRIVAL && wParam != DBT_DEVICEREMOVECOMPLETE)
+	{
+		return;
+	}
 
-	if (itr != m_Observers.end())
+	auto changes = GetDriveChanges(wParam, reinterpret_cast<const DEV_BROADCAST_HDR *>(lParam));
+
+	for (auto &change : changes)
 	{
-		m_Observers.erase(itr);
+		VolumeInfoCache::GetInstance().InvalidateVolume(change.path);
+
+		// Network drives are reported here as well, when they're connected or disconnected.
+		UniversalPathCache::GetInstance().InvalidateDrive(change.path);
+
+		// A different volume may be mounted at the same drive letter.
+		ParsedPathCache::GetInstance().InvalidateFolderContents(change.path);
+
+		if (change.type != DriveChange::Type::Removed)
+		{
+			// Note that the icon for a CD/DVD drive may not have been updated by the time the
+			// notification is received, in which case the existing icon will be returned here.
+			SHFILEINFO shfi;
+			SHGetFileInfo(change.path.c_str(), 0, &shfi, sizeof(shfi), SHGFI_SYSICONINDEX);
+			change.iconIndex = shfi.iIcon;
+
+			GetDisplayName(change.path, SHGDN_INFOLDER, change.displayName);
+		}
+
+		m_driveChangedSignal(change);
 	}
 }
 
-void HardwareChangeNotifier::NotifyDeviceArrival(DEV_BROADCAST_HDR *dbh)
+std::vector<DriveChange> HardwareChangeNotifier::GetDriveChanges(
+	WPARAM wParam, const DEV_BROADCAST_HDR *dbh)
 {
-	NotifyObservers(NotificationType::Arrival, dbh);
-}
+	std::vector<DriveChange> changes;
 
-void HardwareChangeNotifier::NotifyDeviceRemovalComplete(DEV_BROADCAST_HDR *dbh)
-{
-	NotifyObservers(NotificationType::RemovalComplete, dbh);
-}
+	if (dbh->dbch_devicetype != DBT_DEVTYP_VOLUME)
+	{
+		return changes;
+	}
 
-void HardwareChangeNotifier::NotifyObservers(
-	NotificationType notificationType, DEV_BROADCAST_HDR *dbh)
-{
-	for (const auto &hcn : m_Observers)
+	auto *pdbv = reinterpret_cast<const DEV_BROADCAST_VOLUME *>(dbh);
+
+	DriveChange::Type type;
+
+	if (pdbv->dbcv_flags & DBTF_MEDIA)
 	{
-		switch (notificationType)
-		{
-		case NotificationType::Arrival:
-			hcn->OnDeviceArrival(dbh);
-			break;
+		type = DriveChange::Type::MediaChanged;
+	}
+	else if (wParam == DBT_DEVICEARRIVAL)
+	{
+		type = DriveChange::Type::Added;
+	}
+	else
+	{
+		type = DriveChange::Type::Removed;
+	}
 
-		case NotificationType::RemovalComplete:
-			hcn->OnDeviceRemoveComplete(dbh);
-			break;
+	// A single notification can refer to more than one drive.
+	for (int i = 0; i < 26; i++)
+	{
+		if (!(pdbv->dbcv_unitmask & (1 << i)))
+		{
+			continue;
 		}
+
+		DriveChange change;
+		change.type = type;
+		change.path = std::wstring(1, static_cast<wchar_t>('A' + i)) + L":\\";
+		changes.push_back(change);
 	}
+
+	return changes;
 }
\ No newline at end of file
@@ -4,41 +4,55 @@
 
 #pragma once
 
-#include <list>
+#include <boost/signals2.hpp>
+#include <string>
+#include <vector>
 
-namespace NHardwareChangeNotifier
+// A change to a single drive. The information for the drive is queried once, when the device
+// notification is received, and then passed to each of the observers.
+struct DriveChange
 {
-	__interface INotification
+	enum class Type
 	{
-		void OnDeviceArrival(DEV_BROADCAST_HDR * dbh);
-		void OnDeviceRemoveComplete(DEV_BROADCAST_HDR * dbh);
+		// A drive was added to the system.
+		Added,
+
+		// A drive was removed from the system. The drive no longer exists, so only its path is set.
+		Removed,
+
+		// The media in a drive (e.g. a CD/DVD drive) was inserted or removed.
+		MediaChanged
 	};
-}
+
+	Type type;
+
+	// The root of the drive (e.g. E:\).
+	std::wstring path;
+
+	std::wstring displayName;
+	int iconIndex = -1;
+};
 
 class HardwareChangeNotifier
 {
 public:
+	using DriveChangedSignal = boost::signals2::signal<void(const DriveChange &change)>;
+
 	static HardwareChangeNotifier &GetInstance();
 
-	void AddObserver(NHardwareChangeNotifier::INotification *hcn);
-	void RemoveObserver(NHardwareChangeNotifier::INotification *hcn);
+	boost::signals2::connection AddDriveChangedObserver(
+		const DriveChangedSignal::slot_type &observer);
 
-	void NotifyDeviceArrival(DEV_BROADCAST_HDR *dbh);
-	void NotifyDeviceRemovalComplete(DEV_BROADCAST_HDR *dbh);
+	// Should be passed each WM_DEVICECHANGE message received by the main window.
+	void OnDeviceChange(WPARAM wParam, LPARAM lParam);
 
-private:
-	enum class NotificationType
-	{
-		Arrival,
-		RemovalComplete
-	};
+	static std::vector<DriveChange> GetDriveChanges(WPARAM wParam, const DEV_BROADCAST_HDR *dbh);
 
+private:
 	HardwareChangeNotifier() = default;
 
 	HardwareChangeNotifier(const HardwareChangeNotifier &) = delete;
 	HardwareChangeNotifier &operator=(const HardwareChangeNotifier &) = delete;
 
-	void NotifyObservers(NotificationType notificationType, DEV_BROADCAST_HDR *dbh);
-
-	std::list<NHardwareChangeNotifier::INotification *> m_Observers;
+	DriveChangedSignal m_driveChangedSignal;
 };
\ No newline at end of file
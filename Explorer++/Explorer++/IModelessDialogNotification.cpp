@@ -44,5 +44,17 @@ void ModelessDialogNotification::OnModelessDialogDestroy(int iResource)
 	case IDD_MANAGE_BOOKMARKS:
 		g_hwndManageBookmarks = nullptr;
 		break;
+
+	case IDD_DIAGNOSTICS:
+		g_hwndDiagnostics = nullptr;
+		break;
+
+	case IDD_DUPLICATE_FILES:
+		g_hwndDuplicateFiles = nullptr;
+		break;
+
+	case IDD_DISK_USAGE:
+		g_hwndDiskUsage = nullptr;
+		break;
 	}
 }
\ No newline at end of file
@@ -22,7 +22,7 @@ wil::unique_hbitmap IconResourceLoader::LoadBitmapFromPNGForDpi(
 wil::unique_hbitmap IconResourceLoader::LoadBitmapFromPNGAndScale(
 	Icon icon, int iconWidth, int iconHeight) const
 {
-	auto gdiplusBitmap = LoadGdiplusBitmapFromPNGAndScalePlusInvert(icon, iconWidth, iconHeight);
+	auto gdiplusBitmap = GetCachedGdiplusBitmap(icon, iconWidth, iconHeight);
 	return RetrieveBitmapFromGdiplusBitmap(gdiplusBitmap.get());
 }
 
@@ -34,6 +34,9 @@ wil::unique_hbitmap IconResourceLoader::RetrieveBitmapFromGdiplusBitmap(
 		return nullptr;
 	}
 
+	// The cached bitmap can be shared between threads, so conversions from it are serialized.
+	std::scoped_lock lock(m_bitmapCacheMutex);
+
 	wil::unique_hbitmap bitmap;
 	Gdiplus::Color color(0, 0, 0);
 	Gdiplus::Status status = gdiplusBitmap->GetHBITMAP(color, &bitmap);
@@ -56,7 +59,7 @@ wil::unique_hicon IconResourceLoader::LoadIconFromPNGForDpi(
 wil::unique_hicon IconResourceLoader::LoadIconFromPNGAndScale(
 	Icon icon, int iconWidth, int iconHeight) const
 {
-	auto gdiplusBitmap = LoadGdiplusBitmapFromPNGAndScalePlusInvert(icon, iconWidth, iconHeight);
+	auto gdiplusBitmap = GetCachedGdiplusBitmap(icon, iconWidth, iconHeight);
 	return RetrieveIconFromGdiplusBitmap(gdiplusBitmap.get());
 }
 
@@ -68,6 +71,8 @@ wil::unique_hicon IconResourceLoader::RetrieveIconFromGdiplusBitmap(
 		return nullptr;
 	}
 
+	std::scoped_lock lock(m_bitmapCacheMutex);
+
 	wil::unique_hicon hicon;
 	Gdiplus::Status status = gdiplusBitmap->GetHICON(&hicon);
 
@@ -79,21 +84,52 @@ wil::unique_hicon IconResourceLoader::RetrieveIconFromGdiplusBitmap(
 	return hicon;
 }
 
-std::unique_ptr<Gdiplus::Bitmap> IconResourceLoader::LoadGdiplusBitmapFromPNGForDpi(
+std::shared_ptr<Gdiplus::Bitmap> IconResourceLoader::LoadGdiplusBitmapFromPNGForDpi(
 	Icon icon, int iconWidth, int iconHeight, int dpi) const
 {
 	int scaledIconWidth = MulDiv(iconWidth, dpi, USER_DEFAULT_SCREEN_DPI);
 	int scaledIconHeight = MulDiv(iconHeight, dpi, USER_DEFAULT_SCREEN_DPI);
-	return LoadGdiplusBitmapFromPNGAndScalePlusInvert(icon, scaledIconWidth, scaledIconHeight);
+	return GetCachedGdiplusBitmap(icon, scaledIconWidth, scaledIconHeight);
 }
 
-// Loads and scales a PNG and then inverts the colors, when required by the current color mode.
-std::unique_ptr<Gdiplus::Bitmap> IconResourceLoader::LoadGdiplusBitmapFromPNGAndScalePlusInvert(
+std::shared_ptr<Gdiplus::Bitmap> IconResourceLoader::GetCachedGdiplusBitmap(
 	Icon icon, int iconWidth, int iconHeight) const
+{
+	bool invert = ShouldInvertColors();
+	CachedBitmapKey key(icon, iconWidth, iconHeight, invert);
+
+	{
+		std::scoped_lock lock(m_bitmapCacheMutex);
+
+		auto itr = m_bitmapCache.find(key);
+
+		if (itr != m_bitmapCache.end())
+		{
+			return itr->second;
+		}
+	}
+
+	// The PNG is decoded outside the lock. If two threads load the same icon at once, the first
+	// bitmap to be added is the one that's kept.
+	std::shared_ptr<Gdiplus::Bitmap> bitmap =
+		LoadGdiplusBitmapFromPNGAndScalePlusInvert(icon, iconWidth, iconHeight, invert);
+
+	std::scoped_lock lock(m_bitmapCacheMutex);
+	return m_bitmapCache.emplace(key, bitmap).first->second;
+}
+
+bool IconResourceLoader::ShouldInvertColors() const
+{
+	return m_iconTheme != +IconTheme::Color && DarkModeHelper::GetInstance().IsDarkModeEnabled();
+}
+
+// Loads and scales a PNG and then inverts the colors, if requested.
+std::unique_ptr<Gdiplus::Bitmap> IconResourceLoader::LoadGdiplusBitmapFromPNGAndScalePlusInvert(
+	Icon icon, int iconWidth, int iconHeight, bool invert) const
 {
 	auto bitmap = LoadGdiplusBitmapFromPNGAndScale(icon, iconWidth, iconHeight);
 
-	if (m_iconTheme == +IconTheme::Color || !DarkModeHelper::GetInstance().IsDarkModeEnabled())
+	if (!invert)
 	{
 		return bitmap;
 	}
@@ -8,6 +8,10 @@
 #include "Icon.h"
 #include <wil/resource.h>
 #include <gdiplus.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
 
 // Note that the values in this enumeration are used when saving/loading the icon theme and should
 // not be changed.
@@ -35,12 +39,25 @@ private:
 	wil::unique_hbitmap RetrieveBitmapFromGdiplusBitmap(Gdiplus::Bitmap *gdiplusBitmap) const;
 	wil::unique_hicon RetrieveIconFromGdiplusBitmap(Gdiplus::Bitmap *gdiplusBitmap) const;
 
-	std::unique_ptr<Gdiplus::Bitmap> LoadGdiplusBitmapFromPNGForDpi(
+	// The icon, its width and height and whether or not its colors are inverted.
+	using CachedBitmapKey = std::tuple<Icon, int, int, bool>;
+
+	std::shared_ptr<Gdiplus::Bitmap> LoadGdiplusBitmapFromPNGForDpi(
 		Icon icon, int iconWidth, int iconHeight, int dpi) const;
-	std::unique_ptr<Gdiplus::Bitmap> LoadGdiplusBitmapFromPNGAndScalePlusInvert(
+	std::shared_ptr<Gdiplus::Bitmap> GetCachedGdiplusBitmap(
 		Icon icon, int iconWidth, int iconHeight) const;
+	std::unique_ptr<Gdiplus::Bitmap> LoadGdiplusBitmapFromPNGAndScalePlusInvert(
+		Icon icon, int iconWidth, int iconHeight, bool invert) const;
 	std::unique_ptr<Gdiplus::Bitmap> LoadGdiplusBitmapFromPNGAndScale(
 		Icon icon, int iconWidth, int iconHeight) const;
+	bool ShouldInvertColors() const;
 
 	const IconTheme m_iconTheme;
+
+	// Menus and toolbars load the same icons each time they're rebuilt (or the DPI changes), so
+	// each decoded and scaled bitmap is kept. Only a bitmap or icon handle then needs to be created
+	// for each request. The number of entries is bounded by the number of icons and the handful of
+	// sizes each is requested at.
+	mutable std::map<CachedBitmapKey, std::shared_ptr<Gdiplus::Bitmap>> m_bitmapCache;
+	mutable std::mutex m_bitmapCacheMutex;
 };
\ No newline at end of file
@@ -9,6 +9,7 @@
 #include "DarkModeHelper.h"
 #include "DisplayWindow/DisplayWindow.h"
 #include "Explorer++_internal.h"
+#include "HardwareChangeNotifier.h"
 #include "LoadSaveInterface.h"
 #include "MainResource.h"
 #include "MainToolbar.h"
@@ -25,21 +26,49 @@
 #include "ViewModeHelper.h"
 #include "../Helper/CustomGripper.h"
 #include "../Helper/ImageHelper.h"
+#include "../Helper/Logging.h"
 #include "../Helper/Macros.h"
+#include "../Helper/PhaseTimer.h"
 #include "../Helper/iDirectoryMonitor.h"
 
+namespace
+{
+
+void LogStartupTrace(const PhaseTimer &startupTimer)
+{
+	for (const auto &phase : startupTimer.GetPhases())
+	{
+		LOG(info) << L"Startup - " << phase.name << L": " << phase.duration.count() << L" ms";
+	}
+
+	LOG(info) << L"Startup - Total: " << startupTimer.GetTotalDuration().count() << L" ms";
+}
+
+}
+
 /*
  * Main window creation.
  *
  * Settings are loaded very early on. Any initial settings must be in place before this.
+ *
+ * Only the work needed to show the window for the first time is performed here. Anything else is
+ * performed in OnDeferredInitialization(), once the window has been painted.
  */
 void Explorerplusplus::OnCreate()
 {
+	m_startupTimer = std::make_unique<PhaseTimer>();
+
 	InitializeMainToolbars();
 
 	ILoadSave *pLoadSave = nullptr;
 	LoadAllSettings(&pLoadSave);
+	StartStartupFolderEnumeration(pLoadSave);
+	LoadBookmarkJournal();
+	UpdateColorRuleMatchers();
 	ApplyToolbarSettings();
+	LoadFolderSizes();
+	LoadNetworkLocations();
+	LoadIconCache();
 
 	m_config->registerForShellNotifications = g_registerForShellNotifications;
 
@@ -52,6 +81,8 @@ void Explorerplusplus::OnCreate()
 		SetUpDarkMode();
 	}
 
+	m_startupTimer->EndPhase(L"Load settings");
+
 	m_bookmarksMainMenu = std::make_unique<BookmarksMainMenu>(this, &m_bookmarkIconFetcher,
 		&m_bookmarkTree, MenuIdRange{ MENU_BOOKMARK_STARTID, MENU_BOOKMARK_ENDID });
 
@@ -63,9 +94,15 @@ void Explorerplusplus::OnCreate()
 
 	CreateDirectoryMonitor(&m_pDirMon);
 
+	m_startupTimer->EndPhase(L"Create main window");
+
 	CreateStatusBar();
 	CreateMainControls();
+	CreateQuickFilterBar();
 	InitializeDisplayWindow();
+
+	m_startupTimer->EndPhase(L"Create controls");
+
 	InitializeTabs();
 	CreateFolderControls();
 
@@ -85,6 +122,8 @@ void Explorerplusplus::OnCreate()
 	RestoreTabs(pLoadSave);
 	delete pLoadSave;
 
+	m_startupTimer->EndPhase(L"Create tabs");
+
 	// Register for any shell changes. This should be done after the tabs have
 	// been created.
 	SHChangeNotifyEntry shcne;
@@ -93,6 +132,11 @@ void Explorerplusplus::OnCreate()
 	m_SHChangeNotifyID = SHChangeNotifyRegister(
 		m_hContainer, SHCNRF_ShellLevel, SHCNE_ASSOCCHANGED, WM_APP_ASSOCCHANGED, 1, &shcne);
 
+	// The status bar refers to the selected tab when a drive changes, so this is also done after
+	// the tabs have been created.
+	m_connections.push_back(HardwareChangeNotifier::GetInstance().AddDriveChangedObserver(
+		std::bind_front(&Explorerplusplus::OnDriveChangedStatusBar, this)));
+
 	SetFocus(m_hActiveListView);
 
 	m_uiTheming = std::make_unique<UiTheming>(this, m_tabContainer);
@@ -110,11 +154,67 @@ void Explorerplusplus::OnCreate()
 
 	CustomGripper::Initialize(m_hContainer, gripperBackgroundColor);
 
-	InitializePlugins();
-
 	SetTimer(m_hContainer, AUTOSAVE_TIMER_ID, AUTOSAVE_TIMEOUT, nullptr);
 
 	m_InitializationFinished.set(true);
+
+	m_startupTimer->EndPhase(L"Finish window creation");
+
+	// The window is shown and painted once this method returns. Since posted messages are only
+	// retrieved once the message loop starts, the remaining work will run after that.
+	PostMessage(m_hContainer, WM_APP_DEFERREDINITIALIZATION, 0, 0);
+}
+
+void Explorerplusplus::OnDeferredInitialization()
+{
+	m_startupTimer->EndPhase(L"Show window");
+
+	InitializePlugins();
+	m_startupTimer->EndPhase(L"Load plugins");
+
+	PopulateDrivesToolbar();
+	m_startupTimer->EndPhase(L"Enumerate drives");
+
+	WarmUpBookmarkIcons();
+	m_startupTimer->EndPhase(L"Queue bookmark icons");
+
+	m_newMenuPrewarmer.Start();
+	m_startupTimer->EndPhase(L"Queue New menu");
+
+	LoadClosedTabs();
+	m_startupTimer->EndPhase(L"Load closed tabs");
+
+	CreateFileOperationQueue();
+	m_startupTimer->EndPhase(L"Restore file transfers");
+
+	// Other instances can only hand off their command lines once this instance is able to open
+	// tabs, so the server isn't started until now.
+	UpdateInstanceHandoffServer();
+	m_connections.push_back(m_config->allowMultipleInstances.addObserver(
+		[this](BOOL) { UpdateInstanceHandoffServer(); }));
+	m_startupTimer->EndPhase(L"Start instance handoff server");
+
+	StartHangWatchdog();
+	StartMemoryPressureMonitor();
+
+	LogStartupTrace(*m_startupTimer);
+	m_startupTimer.reset();
+}
+
+// Queues icon retrieval for the items shown directly in the bookmarks menu, so that the icons are
+// already cached by the time the menu is first opened. Items on the bookmarks toolbar don't need to
+// be handled here, since the toolbar retrieves its icons as soon as it's created.
+void Explorerplusplus::WarmUpBookmarkIcons()
+{
+	for (const auto &bookmarkItem : m_bookmarkTree.GetBookmarksMenuFolder()->GetChildren())
+	{
+		if (!bookmarkItem->IsBookmark() || m_cachedIcons.findByPath(bookmarkItem->GetLocation()))
+		{
+			continue;
+		}
+
+		m_bookmarkIconFetcher.QueueIconTask(bookmarkItem->GetLocation(), [](int) {});
+	}
 }
 
 void Explorerplusplus::InitializeDisplayWindow()
@@ -0,0 +1,149 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "InstanceHandoff.h"
+#include "Explorer++_internal.h"
+#include "../Helper/Macros.h"
+#include "../Helper/NamedPipeServer.h"
+#include "../Helper/ProcessHelper.h"
+#include <wil/resource.h>
+#include <filesystem>
+
+namespace
+{
+
+// Identifies the format of the request. This should be updated if the format changes, so that
+// instances running different versions don't misinterpret each other's requests.
+const wchar_t REQUEST_PROTOCOL_ID[] = L"OpenPaths1";
+
+}
+
+namespace InstanceHandoff
+{
+
+std::wstring GetPipeName()
+{
+	DWORD sessionId;
+	BOOL res = ProcessIdToSessionId(GetCurrentProcessId(), &sessionId);
+
+	if (!res)
+	{
+		sessionId = 0;
+	}
+
+	return L"\\\\.\\pipe\\Explorer++-" + std::to_wstring(sessionId);
+}
+
+// The request is encoded as a sequence of null-terminated strings: the protocol ID, the base
+// directory and then each of the paths. A null character can't appear within a path, so no
+// escaping is necessary.
+std::wstring EncodeRequest(const Request &request)
+{
+	std::wstring message;
+
+	message.append(REQUEST_PROTOCOL_ID);
+	message.push_back('\0');
+	message.append(request.baseDirectory);
+	message.push_back('\0');
+
+	for (const auto &path : request.paths)
+	{
+		message.append(path);
+		message.push_back('\0');
+	}
+
+	return message;
+}
+
+std::optional<Request> DecodeRequest(const std::wstring &message)
+{
+	std::vector<std::wstring> parts;
+	size_t start = 0;
+
+	while (start < message.size())
+	{
+		size_t end = message.find('\0', start);
+
+		if (end == std::wstring::npos)
+		{
+			return std::nullopt;
+		}
+
+		parts.emplace_back(message, start, end - start);
+		start = end + 1;
+	}
+
+	if (parts.size() < 2 || parts[0] != REQUEST_PROTOCOL_ID)
+	{
+		return std::nullopt;
+	}
+
+	Request request;
+	request.baseDirectory = parts[1];
+	request.paths.assign(parts.begin() + 2, parts.end());
+
+	return request;
+}
+
+bool TryHandOffCommandLine()
+{
+	int numArgs;
+	wil::unique_hlocal_ptr<LPWSTR> args(CommandLineToArgvW(GetCommandLine(), &numArgs));
+
+	if (!args)
+	{
+		return false;
+	}
+
+	Request request;
+
+	for (int i = 1; i < numArgs; i++)
+	{
+		std::wstring arg = args.get()[i];
+
+		if (arg.empty())
+		{
+			continue;
+		}
+
+		if (arg[0] == '-')
+		{
+			// Opening a new tab from the jump list is equivalent to a request without any paths.
+			// Any other option requires the full command line processing.
+			if (arg == NExplorerplusplus::JUMPLIST_TASK_NEWTAB_ARGUMENT && numArgs == 2)
+			{
+				continue;
+			}
+
+			return false;
+		}
+
+		// See PreprocessCommandLineSettings() for an explanation of why this is necessary.
+		if (arg.back() == '\"')
+		{
+			arg.back() = '\\';
+		}
+
+		request.paths.push_back(arg);
+	}
+
+	TCHAR processImageName[MAX_PATH];
+	GetProcessImageName(GetCurrentProcessId(), processImageName, SIZEOF_ARRAY(processImageName));
+
+	std::filesystem::path processDirectoryPath(processImageName);
+	processDirectoryPath.remove_filename();
+	request.baseDirectory = processDirectoryPath.wstring();
+
+	auto result = SendNamedPipeMessage(GetPipeName(), EncodeRequest(request),
+		[](DWORD serverProcessId) {
+			// The running instance will try to bring itself to the foreground once it's processed
+			// the request. That will only work if it's allowed to do so by this process.
+			AllowSetForegroundWindow(serverProcessId);
+		});
+
+	return result.value_or(false);
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+// When multiple instances aren't allowed, the running instance listens on a named pipe. A newly
+// started instance can then hand its command line off to the running instance, without having to
+// perform any of the usual initialization work (loading settings, creating windows, etc.).
+namespace InstanceHandoff
+{
+	struct Request
+	{
+		// The directory relative paths are resolved against.
+		std::wstring baseDirectory;
+
+		// The paths to open, exactly as they appeared on the command line. If this is empty, the
+		// receiving instance will open a single tab in the default directory.
+		std::vector<std::wstring> paths;
+	};
+
+	// The pipe name is specific to the current session, so that separate logon sessions for the
+	// same user don't interfere with each other.
+	std::wstring GetPipeName();
+
+	std::wstring EncodeRequest(const Request &request);
+	std::optional<Request> DecodeRequest(const std::wstring &message);
+
+	// Attempts to pass the current process's command line to the running instance. This only
+	// succeeds if the command line consists solely of paths (or the jump list new tab argument) and
+	// there's an instance listening. Returns true if the running instance accepted the request, in
+	// which case the current process can exit.
+	bool TryHandOffCommandLine();
+}
\ No newline at end of file
@@ -36,10 +36,14 @@
 #include "../Helper/Macros.h"
 #include "../Helper/MenuHelper.h"
 #include "../Helper/ShellHelper.h"
+#include "../Helper/UniversalPathCache.h"
 #include "../Helper/iDataObject.h"
 #include "../Helper/iDropSource.h"
+#include <boost/algorithm/string/case_conv.hpp>
+#include <boost/algorithm/string/join.hpp>
 #include <wil/com.h>
 #include <winrt/base.h>
+#include <set>
 
 LRESULT CALLBACK Explorerplusplus::ListViewProcStub(
 	HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam, UINT_PTR uIdSubclass, DWORD_PTR dwRefData)
@@ -499,7 +503,7 @@ void Explorerplusplus::OnListViewRClick(POINT *pCursorPos)
 			if (ListView_GetItemState(m_hActiveListView, lvhti.iItem, LVIS_SELECTED)
 				!= LVIS_SELECTED)
 			{
-				ListViewHelper::SelectAllItems(m_hActiveListView, FALSE);
+				m_pActiveShellBrowser->DeselectAllItems();
 				ListViewHelper::SelectItem(m_hActiveListView, lvhti.iItem, TRUE);
 			}
 		}
@@ -662,6 +666,51 @@ void Explorerplusplus::OnListViewItemRClick(POINT *pCursorPos)
 	}
 }
 
+// The handlers that are loaded for a context menu depend on the types of the selected items (and on
+// whether more than one item is selected), rather than on the items themselves. So the menu only
+// needs to be prewarmed the first time a particular combination is selected.
+void Explorerplusplus::PrewarmSelectionContextMenu()
+{
+	int nSelected = ListView_GetSelectedCount(m_hActiveListView);
+
+	// Building a menu for a very large selection is expensive in itself and it's unlikely that the
+	// user is about to right-click it.
+	if (nSelected == 0 || nSelected > MAX_PREWARMED_SELECTION)
+	{
+		return;
+	}
+
+	std::vector<unique_pidl_child> pidlPtrs;
+	std::vector<PCITEMID_CHILD> pidlItems;
+	std::set<std::wstring> types;
+	int iItem = -1;
+
+	while ((iItem = ListView_GetNextItem(m_hActiveListView, iItem, LVNI_SELECTED)) != -1)
+	{
+		auto pidlPtr = m_pActiveShellBrowser->GetItemChildIdl(iItem);
+
+		pidlItems.push_back(pidlPtr.get());
+		pidlPtrs.push_back(std::move(pidlPtr));
+
+		WIN32_FIND_DATA wfd = m_pActiveShellBrowser->GetItemFileFindData(iItem);
+
+		if (WI_IsFlagSet(wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+		{
+			types.insert(L"<folder>");
+		}
+		else
+		{
+			types.insert(boost::to_lower_copy(std::wstring(PathFindExtension(wfd.cFileName))));
+		}
+	}
+
+	std::wstring signature =
+		(nSelected == 1 ? L"single:" : L"multiple:") + boost::algorithm::join(types, L"|");
+
+	auto pidlDirectory = m_pActiveShellBrowser->GetDirectoryIdl();
+	m_contextMenuPrewarmer.Prewarm(pidlDirectory.get(), pidlItems, signature);
+}
+
 void Explorerplusplus::OnListViewDoubleClick(NMHDR *nmhdr)
 {
 	if (nmhdr->hwndFrom == m_hActiveListView)
@@ -725,34 +774,20 @@ void Explorerplusplus::OnListViewCopyUniversalPaths() const
 		return;
 	}
 
-	std::wstring strUniversalPaths;
+	std::vector<std::wstring> fullFilenames;
 	int iItem = -1;
 
 	while ((iItem = ListView_GetNextItem(m_hActiveListView, iItem, LVNI_SELECTED)) != -1)
 	{
-		std::wstring fullFilename = m_pActiveShellBrowser->GetItemFullName(iItem);
-
-		TCHAR szBuffer[1024];
-
-		DWORD dwBufferSize = SIZEOF_ARRAY(szBuffer);
-		auto *puni = reinterpret_cast<UNIVERSAL_NAME_INFO *>(&szBuffer);
-		DWORD dwRet = WNetGetUniversalName(fullFilename.c_str(), UNIVERSAL_NAME_INFO_LEVEL,
-			reinterpret_cast<LPVOID>(puni), &dwBufferSize);
-
-		if (dwRet == NO_ERROR)
-		{
-			strUniversalPaths += puni->lpUniversalName + std::wstring(_T("\r\n"));
-		}
-		else
-		{
-			strUniversalPaths += fullFilename + std::wstring(_T("\r\n"));
-		}
+		fullFilenames.push_back(m_pActiveShellBrowser->GetItemFullName(iItem));
 	}
 
-	strUniversalPaths = strUniversalPaths.substr(0, strUniversalPaths.size() - 2);
+	// Each mapped drive is only resolved once, no matter how many items are selected.
+	std::wstring universalPaths =
+		UniversalPathCache::GetInstance().GetUniversalPaths(fullFilenames, L"\r\n");
 
 	BulkClipboardWriter clipboardWriter;
-	clipboardWriter.WriteText(strUniversalPaths);
+	clipboardWriter.WriteText(universalPaths);
 }
 
 void Explorerplusplus::OnListViewSetFileAttributes() const
@@ -774,6 +809,11 @@ void Explorerplusplus::OnListViewPaste()
 	const auto &selectedTab = m_tabContainer->GetSelectedTab();
 	auto directory = selectedTab.GetShellBrowser()->GetDirectoryIdl();
 
+	if (QueueInternalPaste(directory.get()))
+	{
+		return;
+	}
+
 	if (CanShellPasteDataObject(
 			directory.get(), clipboardObject.get(), DROPEFFECT_COPY | DROPEFFECT_MOVE))
 	{
@@ -824,22 +864,24 @@ int Explorerplusplus::HighlightSimilarFiles(HWND ListView) const
 
 	nItems = ListView_GetItemCount(ListView);
 
-	for (i = 0; i < nItems; i++)
-	{
-		std::wstring fullFileName = m_pActiveShellBrowser->GetItemFullName(i);
+	m_pActiveShellBrowser->PerformBulkSelectionChange([&] {
+		for (i = 0; i < nItems; i++)
+		{
+			std::wstring fullFileName = m_pActiveShellBrowser->GetItemFullName(i);
 
-		bSimilarTypes = CompareFileTypes(fullFileName.c_str(), testFile.c_str());
+			bSimilarTypes = CompareFileTypes(fullFileName.c_str(), testFile.c_str());
 
-		if (bSimilarTypes)
-		{
-			ListViewHelper::SelectItem(ListView, i, TRUE);
-			nSimilar++;
-		}
-		else
-		{
-			ListViewHelper::SelectItem(ListView, i, FALSE);
+			if (bSimilarTypes)
+			{
+				ListViewHelper::SelectItem(ListView, i, TRUE);
+				nSimilar++;
+			}
+			else
+			{
+				ListViewHelper::SelectItem(ListView, i, FALSE);
+			}
 		}
-	}
+	});
 
 	return nSimilar;
 }
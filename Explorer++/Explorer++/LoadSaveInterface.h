@@ -4,6 +4,9 @@
 
 #pragma once
 
+#include <optional>
+#include <string>
+
 /* Save/load interface. This allows multiple
 methods of saving/loading data, as long as it
 conforms to this specification. */
@@ -16,6 +19,10 @@ public:
 	virtual void LoadGenericSettings() = 0;
 	virtual void LoadBookmarks() = 0;
 	virtual int LoadPreviousTabs() = 0;
+
+	/* Returns the directory of a single saved tab, without
+	creating it. */
+	virtual std::optional<std::wstring> LoadPreviousTabDirectory(int index) = 0;
 	virtual void LoadDefaultColumns() = 0;
 	virtual void LoadApplicationToolbar() = 0;
 	virtual void LoadToolbarInformation() = 0;
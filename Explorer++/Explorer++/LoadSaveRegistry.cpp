@@ -28,6 +28,11 @@ int LoadSaveRegistry::LoadPreviousTabs()
 	return m_pContainer->LoadTabSettingsFromRegistry();
 }
 
+std::optional<std::wstring> LoadSaveRegistry::LoadPreviousTabDirectory(int index)
+{
+	return m_pContainer->LoadTabDirectoryFromRegistry(index);
+}
+
 void LoadSaveRegistry::LoadDefaultColumns()
 {
 	m_pContainer->LoadDefaultColumnsFromRegistry();
@@ -18,6 +18,7 @@ public:
 	void	LoadGenericSettings() override;
 	void	LoadBookmarks() override;
 	int		LoadPreviousTabs() override;
+	std::optional<std::wstring>	LoadPreviousTabDirectory(int index) override;
 	void	LoadDefaultColumns() override;
 	void	LoadApplicationToolbar() override;
 	void	LoadToolbarInformation() override;
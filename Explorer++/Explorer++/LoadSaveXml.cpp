@@ -4,7 +4,9 @@
 
 #include "stdafx.h"
 #include "LoadSaveXml.h"
+#include "Bookmarks/BookmarkXmlStorage.h"
 #include "ColorRuleHelper.h"
+#include "Config.h"
 #include "Explorer++.h"
 #include "Explorer++_internal.h"
 #include "../Helper/ProcessHelper.h"
@@ -29,14 +31,6 @@ LoadSaveXML::LoadSaveXML(Explorerplusplus *pContainer, BOOL bLoad) :
 	}
 }
 
-LoadSaveXML::~LoadSaveXML()
-{
-	if (!m_bLoad)
-	{
-		ReleaseSaveEnvironment();
-	}
-}
-
 void LoadSaveXML::InitializeLoadEnvironment()
 {
 	m_pXMLDom.attach(NXMLSettings::DomFromCOM());
@@ -51,7 +45,21 @@ void LoadSaveXML::InitializeLoadEnvironment()
 	PathRemoveFileSpec(szConfigFile);
 	PathAppend(szConfigFile, NExplorerplusplus::XML_FILENAME);
 
-	wil::unique_variant var(NXMLSettings::VariantString(NExplorerplusplus::XML_FILENAME));
+	auto sourceFileKey = SettingsCache::GetSourceFileKey(szConfigFile);
+
+	if (sourceFileKey)
+	{
+		m_cachedSettings = SettingsCache::LoadFromFile(
+			Explorerplusplus::GetCacheFilePath(NExplorerplusplus::SETTINGS_CACHE_FILENAME),
+			*sourceFileKey);
+	}
+
+	/* The larger sections (e.g. bookmarks) are read directly from the
+	file, rather than being queried from the DOM. */
+	SHCreateStreamOnFileEx(szConfigFile, STGM_READ | STGM_SHARE_DENY_WRITE, FILE_ATTRIBUTE_NORMAL,
+		FALSE, nullptr, &m_configStream);
+
+	wil::unique_variant var(NXMLSettings::VariantString(szConfigFile));
 	VARIANT_BOOL status;
 	m_pXMLDom->load(var, &status);
 
@@ -61,6 +69,26 @@ void LoadSaveXML::InitializeLoadEnvironment()
 	}
 }
 
+/* Each streamed section reads the file from the start. Returns
+nullptr if the file couldn't be opened. */
+IStream *LoadSaveXML::GetConfigStream()
+{
+	if (!m_configStream)
+	{
+		return nullptr;
+	}
+
+	LARGE_INTEGER start = {};
+	HRESULT hr = m_configStream->Seek(start, STREAM_SEEK_SET, nullptr);
+
+	if (FAILED(hr))
+	{
+		return nullptr;
+	}
+
+	return m_configStream.get();
+}
+
 void LoadSaveXML::InitializeSaveEnvironment()
 {
 	m_pXMLDom.attach(NXMLSettings::DomFromCOM());
@@ -94,7 +122,7 @@ void LoadSaveXML::InitializeSaveEnvironment()
 	NXMLSettings::AddWhiteSpaceToNode(m_pXMLDom.get(), bstr_wsnt.get(), m_pRoot.get());
 }
 
-void LoadSaveXML::ReleaseSaveEnvironment()
+std::wstring LoadSaveXML::GetXml()
 {
 	auto bstr_wsn = wil::make_bstr_nothrow(L"\n");
 	NXMLSettings::AddWhiteSpaceToNode(m_pXMLDom.get(), bstr_wsn.get(), m_pRoot.get());
@@ -102,9 +130,105 @@ void LoadSaveXML::ReleaseSaveEnvironment()
 	wil::unique_bstr bstr;
 	m_pXMLDom->get_xml(&bstr);
 
-	/* To ensure the configuration file is saved to the same directory
-	as the executable, determine the fully qualified path of the executable,
-	then save the configuration file in that directory. */
+	if (!bstr)
+	{
+		return {};
+	}
+
+	return bstr.get();
+}
+
+long LoadSaveXML::GetNumSavedNodes()
+{
+	wil::com_ptr_nothrow<IXMLDOMNodeList> childNodes;
+	m_pRoot->get_childNodes(&childNodes);
+
+	long numNodes = 0;
+	childNodes->get_length(&numNodes);
+
+	return numNodes;
+}
+
+std::wstring LoadSaveXML::GetSavedNodesXml(long firstNode)
+{
+	wil::com_ptr_nothrow<IXMLDOMNodeList> childNodes;
+	m_pRoot->get_childNodes(&childNodes);
+
+	long numNodes = 0;
+	childNodes->get_length(&numNodes);
+
+	std::wstring xml;
+
+	for (long i = firstNode; i < numNodes; i++)
+	{
+		wil::com_ptr_nothrow<IXMLDOMNode> node;
+		childNodes->get_item(i, &node);
+
+		wil::unique_bstr nodeXml;
+		node->get_xml(&nodeXml);
+
+		if (nodeXml)
+		{
+			xml += nodeXml.get();
+		}
+	}
+
+	return xml;
+}
+
+bool LoadSaveXML::AppendSavedNodesXml(const std::wstring &xml)
+{
+	wil::com_ptr_nothrow<IXMLDOMDocument> document;
+	document.attach(NXMLSettings::DomFromCOM());
+
+	if (!document)
+	{
+		return false;
+	}
+
+	/* There may be several nodes (including whitespace), so
+	they're wrapped in a temporary element while parsed. */
+	auto bstr = wil::make_bstr_nothrow((L"<SavedNodes>" + xml + L"</SavedNodes>").c_str());
+	VARIANT_BOOL status;
+	document->loadXML(bstr.get(), &status);
+
+	if (status != VARIANT_TRUE)
+	{
+		return false;
+	}
+
+	wil::com_ptr_nothrow<IXMLDOMElement> wrapper;
+	document->get_documentElement(&wrapper);
+
+	if (!wrapper)
+	{
+		return false;
+	}
+
+	wil::com_ptr_nothrow<IXMLDOMNodeList> childNodes;
+	wrapper->get_childNodes(&childNodes);
+
+	long numNodes = 0;
+	childNodes->get_length(&numNodes);
+
+	for (long i = 0; i < numNodes; i++)
+	{
+		wil::com_ptr_nothrow<IXMLDOMNode> node;
+		childNodes->get_item(i, &node);
+
+		wil::com_ptr_nothrow<IXMLDOMNode> clonedNode;
+		node->cloneNode(VARIANT_TRUE, &clonedNode);
+		m_pRoot->appendChild(clonedNode.get(), nullptr);
+	}
+
+	return true;
+}
+
+/* To ensure the configuration file is saved to the same directory
+as the executable, determine the fully qualified path of the executable,
+then save the configuration file in that directory. */
+std::wstring LoadSaveXML::GetConfigFilePath()
+{
 	TCHAR szConfigFile[MAX_PATH];
 	DWORD dwProcessId = GetCurrentProcessId();
 	wil::unique_process_handle process(
@@ -114,8 +238,7 @@ void LoadSaveXML::ReleaseSaveEnvironment()
 	PathRemoveFileSpec(szConfigFile);
 	PathAppend(szConfigFile, NExplorerplusplus::XML_FILENAME);
 
-	wil::unique_variant var(NXMLSettings::VariantString(szConfigFile));
-	m_pXMLDom->save(var);
+	return szConfigFile;
 }
 
 void LoadSaveXML::LoadGenericSettings()
@@ -125,7 +248,20 @@ void LoadSaveXML::LoadGenericSettings()
 
 void LoadSaveXML::LoadBookmarks()
 {
-	m_pContainer->LoadBookmarksFromXML(m_pXMLDom.get());
+	if (m_cachedSettings)
+	{
+		SettingsCache::RestoreBookmarks(*m_cachedSettings, &m_pContainer->m_bookmarkTree);
+		return;
+	}
+
+	IStream *configStream = GetConfigStream();
+
+	if (!configStream)
+	{
+		return;
+	}
+
+	BookmarkXmlStorage::Load(configStream, &m_pContainer->m_bookmarkTree);
 }
 
 int LoadSaveXML::LoadPreviousTabs()
@@ -133,8 +269,20 @@ int LoadSaveXML::LoadPreviousTabs()
 	return m_pContainer->LoadTabSettingsFromXML(m_pXMLDom.get());
 }
 
+std::optional<std::wstring> LoadSaveXML::LoadPreviousTabDirectory(int index)
+{
+	return m_pContainer->LoadTabDirectoryFromXML(m_pXMLDom.get(), index);
+}
+
 void LoadSaveXML::LoadDefaultColumns()
 {
+	if (m_cachedSettings)
+	{
+		m_pContainer->m_config->globalFolderSettings.folderColumns =
+			m_cachedSettings->defaultColumns;
+		return;
+	}
+
 	m_pContainer->LoadDefaultColumnsFromXML(m_pXMLDom.get());
 }
 
@@ -145,12 +293,48 @@ void LoadSaveXML::LoadApplicationToolbar()
 
 void LoadSaveXML::LoadToolbarInformation()
 {
+	if (m_cachedSettings)
+	{
+		LoadToolbarInformationFromCache();
+		return;
+	}
+
 	m_pContainer->LoadToolbarInformationFromXML(m_pXMLDom.get());
 }
 
 void LoadSaveXML::LoadColorRules()
 {
-	NColorRuleHelper::LoadColorRulesFromXML(m_pXMLDom.get(), m_pContainer->m_ColorRules);
+	if (m_cachedSettings)
+	{
+		m_pContainer->m_ColorRules = m_cachedSettings->colorRules;
+		return;
+	}
+
+	NColorRuleHelper::LoadColorRulesFromXML(GetConfigStream(), m_pContainer->m_ColorRules);
+}
+
+/* Mirrors Explorerplusplus::LoadToolbarInformationFromXML(). */
+void LoadSaveXML::LoadToolbarInformationFromCache()
+{
+	const auto &toolbarBands = m_cachedSettings->toolbarBands;
+
+	size_t numBands = std::min(
+		toolbarBands.size(), static_cast<size_t>(Explorerplusplus::NUM_MAIN_TOOLBARS));
+
+	for (size_t i = 0; i < numBands; i++)
+	{
+		REBARBANDINFO &toolbarInformation = m_pContainer->m_ToolbarInformation[i];
+		BOOL bUseChevron = (toolbarInformation.fStyle & RBBS_USECHEVRON) != 0;
+
+		toolbarInformation.wID = toolbarBands[i].id;
+		toolbarInformation.fStyle = toolbarBands[i].style;
+		toolbarInformation.cx = toolbarBands[i].length;
+
+		if (bUseChevron)
+		{
+			toolbarInformation.fStyle |= RBBS_USECHEVRON;
+		}
+	}
 }
 
 void LoadSaveXML::LoadDialogStates()
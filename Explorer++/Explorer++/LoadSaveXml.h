@@ -5,9 +5,12 @@
 #pragma once
 
 #include "LoadSaveInterface.h"
+#include "SettingsCache.h"
 #include <wil/com.h>
 #include <MsXml2.h>
 #include <objbase.h>
+#include <optional>
+#include <string>
 
 class Explorerplusplus;
 
@@ -16,12 +19,14 @@ class LoadSaveXML : public ILoadSave
 public:
 
 	LoadSaveXML(Explorerplusplus *pContainer, BOOL bLoad);
-	~LoadSaveXML();
+
+	static std::wstring GetConfigFilePath();
 
 	/* Loading functions. */
 	void	LoadGenericSettings() override;
 	void	LoadBookmarks() override;
 	int		LoadPreviousTabs() override;
+	std::optional<std::wstring>	LoadPreviousTabDirectory(int index) override;
 	void	LoadDefaultColumns() override;
 	void	LoadApplicationToolbar() override;
 	void	LoadToolbarInformation() override;
@@ -38,12 +43,29 @@ public:
 	void	SaveColorRules() override;
 	void	SaveDialogStates() override;
 
+	/* Nothing is written out when saving. Instead, the
+	resulting document is retrieved using GetXml(), which
+	should be called once all the settings have been saved. */
+	std::wstring	GetXml();
+
+	/* Each of the saving functions above appends nodes to the
+	root element. Returns the XML for the nodes appended since
+	the specified number of nodes had been saved. */
+	long			GetNumSavedNodes();
+	std::wstring	GetSavedNodesXml(long firstNode);
+
+	/* Appends nodes previously retrieved using GetSavedNodesXml()
+	to the root element, in place of calling the corresponding
+	saving function. */
+	bool			AppendSavedNodesXml(const std::wstring &xml);
+
 private:
 
 	void	InitializeLoadEnvironment();
 	void	ReleaseLoadEnvironment();
 	void	InitializeSaveEnvironment();
-	void	ReleaseSaveEnvironment();
+	IStream	*GetConfigStream();
+	void	LoadToolbarInformationFromCache();
 
 	Explorerplusplus *m_pContainer;
 	BOOL					m_bLoad;
@@ -51,6 +73,13 @@ private:
 	/* Used for saving + loading. */
 	wil::com_ptr_nothrow<IXMLDOMDocument> m_pXMLDom;
 
+	/* Used exclusively for loading. */
+	wil::com_ptr_nothrow<IStream> m_configStream;
+
+	/* Set if the cache matches the config file, in which
+	case the cached sections are loaded from it instead. */
+	std::optional<SettingsCache::Contents> m_cachedSettings;
+
 	/* Used exclusively for saving. */
 	wil::com_ptr_nothrow<IXMLDOMElement> m_pRoot;
 };
\ No newline at end of file
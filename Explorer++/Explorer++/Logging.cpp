@@ -9,12 +9,32 @@
 #include "../Helper/ProcessHelper.h"
 #include <boost/locale/generator.hpp>
 #include <boost/log/expressions.hpp>
+#include <boost/log/sinks/async_frontend.hpp>
+#include <boost/log/sinks/bounded_fifo_queue.hpp>
+#include <boost/log/sinks/drop_on_overflow.hpp>
+#include <boost/log/sinks/text_file_backend.hpp>
 #include <boost/log/support/date_time.hpp>
 #include <boost/log/utility/setup/common_attributes.hpp>
-#include <boost/log/utility/setup/file.hpp>
 
 BOOST_LOG_ATTRIBUTE_KEYWORD(severity, "Severity", SeverityLevel);
 
+namespace
+{
+
+// The maximum number of records that can be waiting to be written. If the queue is full (e.g.
+// because something is logging in a tight loop), further records are dropped, rather than blocking
+// the thread that's logging.
+constexpr size_t LOG_QUEUE_CAPACITY = 4096;
+
+using LogQueue = boost::log::sinks::bounded_fifo_queue<LOG_QUEUE_CAPACITY,
+	boost::log::sinks::drop_on_overflow>;
+using LogFileSink =
+	boost::log::sinks::asynchronous_sink<boost::log::sinks::text_file_backend, LogQueue>;
+
+boost::shared_ptr<LogFileSink> g_logFileSink;
+
+}
+
 void InitializeLogging(const TCHAR *filename)
 {
 	TCHAR szLogFile[MAX_PATH];
@@ -25,18 +45,42 @@ void InitializeLogging(const TCHAR *filename)
 
 	boost::log::add_common_attributes();
 
-	boost::shared_ptr<boost::log::sinks::synchronous_sink<boost::log::sinks::text_file_backend>> sink = boost::log::add_file_log(
+	auto backend = boost::make_shared<boost::log::sinks::text_file_backend>(
 		boost::log::keywords::file_name = szLogFile,
-		boost::log::keywords::open_mode = std::ios_base::app,
-		boost::log::keywords::format =
-		(
-			boost::log::expressions::stream
-			<< "[" << boost::log::expressions::format_date_time<boost::posix_time::ptime>("TimeStamp", "%Y-%m-%d %H:%M:%S")
-			<< "; " << severity.or_default(info)
-			<< "]: " << boost::log::expressions::message
-			)
+		boost::log::keywords::open_mode = std::ios_base::app);
+
+	// Records are written (and flushed) on the sink's own thread, so flushing each record doesn't
+	// hold up the thread that logged it, but does mean that the log is complete if the application
+	// crashes.
+	backend->auto_flush(true);
+
+	// The sink starts a dedicated thread that takes records from the queue and writes them to the
+	// file. Logging a message only involves formatting it and adding it to the queue.
+	g_logFileSink = boost::make_shared<LogFileSink>(backend);
+	g_logFileSink->set_formatter(
+		boost::log::expressions::stream
+		<< "[" << boost::log::expressions::format_date_time<boost::posix_time::ptime>(
+			"TimeStamp", "%Y-%m-%d %H:%M:%S")
+		<< "; " << severity.or_default(info)
+		<< "]: " << boost::log::expressions::message
 	);
 
 	std::locale locale = boost::locale::generator()("en_US.UTF-8");
-	sink->imbue(locale);
+	g_logFileSink->imbue(locale);
+
+	boost::log::core::get()->add_sink(g_logFileSink);
+}
+
+void ShutdownLogging()
+{
+	if (!g_logFileSink)
+	{
+		return;
+	}
+
+	// Any records that are still queued are written out before the sink's thread exits.
+	boost::log::core::get()->remove_sink(g_logFileSink);
+	g_logFileSink->stop();
+	g_logFileSink->flush();
+	g_logFileSink.reset();
 }
\ No newline at end of file
@@ -4,4 +4,7 @@
 
 #pragma once
 
-void InitializeLogging(const TCHAR *filename);
\ No newline at end of file
+void InitializeLogging(const TCHAR *filename);
+
+// Writes out any messages that are still queued. Nothing will be logged after this is called.
+void ShutdownLogging();
\ No newline at end of file
@@ -127,4 +127,10 @@ boost::signals2::connection Explorerplusplus::AddMainMenuPreShowObserver(
 	const MainMenuPreShowSignal::slot_type &observer)
 {
 	return m_mainMenuPreShowSignal.connect(observer);
+}
+
+boost::signals2::connection Explorerplusplus::AddMainMenuPopupObserver(
+	const MainMenuPopupSignal::slot_type &observer)
+{
+	return m_mainMenuPopupSignal.connect(observer);
 }
\ No newline at end of file
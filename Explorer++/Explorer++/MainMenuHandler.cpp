@@ -8,7 +8,10 @@
 #include "Config.h"
 #include "CustomizeColorsDialog.h"
 #include "DestroyFilesDialog.h"
+#include "DiagnosticsDialog.h"
+#include "DiskUsageDialog.h"
 #include "DisplayColoursDialog.h"
+#include "DuplicateFilesDialog.h"
 #include "Explorer++_internal.h"
 #include "FileProgressSink.h"
 #include "FilterDialog.h"
@@ -18,6 +21,7 @@
 #include "MergeFilesDialog.h"
 #include "ModelessDialogs.h"
 #include "OptionsDialog.h"
+#include "ResourceHelper.h"
 #include "ScriptingDialog.h"
 #include "SearchDialog.h"
 #include "ShellBrowser/ShellBrowser.h"
@@ -26,9 +30,13 @@
 #include "TabContainer.h"
 #include "UpdateCheckDialog.h"
 #include "WildcardSelectDialog.h"
+#include "../Helper/BulkClipboardWriter.h"
+#include "../Helper/FileOperationQueue.h"
+#include "../Helper/FileOperations.h"
 #include "../Helper/ListViewHelper.h"
 #include "../Helper/ProcessHelper.h"
 #include "../Helper/ShellHelper.h"
+#include <boost/format.hpp>
 #include <wil/com.h>
 
 void Explorerplusplus::OnChangeDisplayColors()
@@ -92,6 +100,86 @@ void Explorerplusplus::OnDestroyFiles()
 	destroyFilesDialog.ShowModalDialog();
 }
 
+// The hashes are copied to the clipboard in the format used by sha256sum, so that they can be
+// saved and verified later.
+void Explorerplusplus::OnComputeHashes()
+{
+	std::vector<std::wstring> paths;
+	int iItem = -1;
+
+	while ((iItem = ListView_GetNextItem(m_hActiveListView, iItem, LVNI_SELECTED)) != -1)
+	{
+		WIN32_FIND_DATA findData = m_pActiveShellBrowser->GetItemFileFindData(iItem);
+
+		if (WI_IsFlagSet(findData.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+		{
+			continue;
+		}
+
+		paths.push_back(m_pActiveShellBrowser->GetItemFullName(iItem));
+	}
+
+	if (paths.empty())
+	{
+		return;
+	}
+
+	std::vector<std::optional<FileHash>> hashes;
+	HRESULT hr = NFileOperations::CalculateFileHashes(
+		m_hContainer, m_pActiveShellBrowser->GetDirectory(), paths, hashes);
+
+	if (FAILED(hr))
+	{
+		return;
+	}
+
+	std::wstring text;
+	int numFailed = 0;
+
+	for (size_t i = 0; i < paths.size(); i++)
+	{
+		if (!hashes[i])
+		{
+			numFailed++;
+			continue;
+		}
+
+		text += FormatFileHash(*hashes[i]) + L"  " + PathFindFileName(paths[i].c_str()) + L"\r\n";
+	}
+
+	if (!text.empty())
+	{
+		BulkClipboardWriter clipboardWriter;
+		clipboardWriter.WriteText(text);
+	}
+
+	int numHashed = static_cast<int>(paths.size()) - numFailed;
+	std::wstring message;
+
+	if (numFailed == 0)
+	{
+		message = (boost::wformat(ResourceHelper::LoadString(
+					   m_hLanguageModule, IDS_COMPUTE_HASHES_COPIED))
+			% numHashed)
+					  .str();
+	}
+	else
+	{
+		message = (boost::wformat(ResourceHelper::LoadString(
+					   m_hLanguageModule, IDS_COMPUTE_HASHES_PARTIALLY_FAILED))
+			% numHashed % numFailed)
+					  .str();
+	}
+
+	MessageBox(m_hContainer, message.c_str(), NExplorerplusplus::APP_NAME,
+		(numFailed == 0 ? MB_ICONINFORMATION : MB_ICONWARNING) | MB_OK);
+}
+
+void Explorerplusplus::OnTogglePauseFileTransfers()
+{
+	m_fileOperationQueue->SetPaused(!m_fileOperationQueue->IsPaused());
+}
+
 void Explorerplusplus::OnWildcardSelect(BOOL bSelect)
 {
 	WildcardSelectDialog wilcardSelectDialog(m_hLanguageModule, m_hContainer, bSelect, this);
@@ -121,6 +209,8 @@ void Explorerplusplus::OnCustomizeColors()
 		m_hLanguageModule, m_hContainer, this, &m_ColorRules);
 	customizeColorsDialog.ShowModalDialog();
 
+	UpdateColorRuleMatchers();
+
 	/* Causes the active listview to redraw (therefore
 	applying any updated color schemes). */
 	InvalidateRect(m_hActiveListView, nullptr, FALSE);
@@ -139,6 +229,78 @@ void Explorerplusplus::OnRunScript()
 	}
 }
 
+// Searches the selected folders or, if no folders are selected, the current folder.
+void Explorerplusplus::OnFindDuplicateFiles()
+{
+	if (g_hwndDuplicateFiles != nullptr)
+	{
+		SetFocus(g_hwndDuplicateFiles);
+		return;
+	}
+
+	std::vector<std::wstring> folders;
+	int iItem = -1;
+
+	while ((iItem = ListView_GetNextItem(m_hActiveListView, iItem, LVNI_SELECTED)) != -1)
+	{
+		WIN32_FIND_DATA findData = m_pActiveShellBrowser->GetItemFileFindData(iItem);
+
+		if (WI_IsFlagSet(findData.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+		{
+			folders.push_back(m_pActiveShellBrowser->GetItemFullName(iItem));
+		}
+	}
+
+	if (folders.empty())
+	{
+		folders.push_back(m_pActiveShellBrowser->GetDirectory());
+	}
+
+	auto *duplicateFilesDialog =
+		new DuplicateFilesDialog(m_hLanguageModule, m_hContainer, this, std::move(folders));
+	g_hwndDuplicateFiles =
+		duplicateFilesDialog->ShowModelessDialog(new ModelessDialogNotification());
+}
+
+// Shows the selected folder or, if a single folder isn't selected, the current folder.
+void Explorerplusplus::OnShowDiskUsage()
+{
+	if (g_hwndDiskUsage != nullptr)
+	{
+		SetFocus(g_hwndDiskUsage);
+		return;
+	}
+
+	std::wstring folder = m_pActiveShellBrowser->GetDirectory();
+
+	if (ListView_GetSelectedCount(m_hActiveListView) == 1)
+	{
+		int selectedItem = ListView_GetNextItem(m_hActiveListView, -1, LVNI_SELECTED);
+		WIN32_FIND_DATA findData = m_pActiveShellBrowser->GetItemFileFindData(selectedItem);
+
+		if (WI_IsFlagSet(findData.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+		{
+			folder = m_pActiveShellBrowser->GetItemFullName(selectedItem);
+		}
+	}
+
+	auto *diskUsageDialog = new DiskUsageDialog(m_hLanguageModule, m_hContainer, folder);
+	g_hwndDiskUsage = diskUsageDialog->ShowModelessDialog(new ModelessDialogNotification());
+}
+
+void Explorerplusplus::OnShowDiagnostics()
+{
+	if (g_hwndDiagnostics == nullptr)
+	{
+		auto *diagnosticsDialog = new DiagnosticsDialog(m_hLanguageModule, m_hContainer, this);
+		g_hwndDiagnostics = diagnosticsDialog->ShowModelessDialog(new ModelessDialogNotification());
+	}
+	else
+	{
+		SetFocus(g_hwndDiagnostics);
+	}
+}
+
 void Explorerplusplus::OnShowOptions()
 {
 	if (g_hwndOptions == nullptr)
@@ -196,20 +358,98 @@ void Explorerplusplus::OnAbout()
 
 void Explorerplusplus::OnSaveDirectoryListing() const
 {
-	TCHAR fileName[MAX_PATH];
-	LoadString(m_hLanguageModule, IDS_GENERAL_DIRECTORY_LISTING_FILENAME, fileName,
-		SIZEOF_ARRAY(fileName));
-	StringCchCat(fileName, SIZEOF_ARRAY(fileName), _T(".txt"));
+	wil::com_ptr_nothrow<IFileSaveDialog> fileSaveDialog;
+	HRESULT hr = CoCreateInstance(
+		CLSID_FileSaveDialog, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&fileSaveDialog));
+
+	if (FAILED(hr))
+	{
+		return;
+	}
+
+	std::wstring textType =
+		ResourceHelper::LoadString(m_hLanguageModule, IDS_DIRECTORY_LISTING_TYPE_TEXT);
+	std::wstring csvType =
+		ResourceHelper::LoadString(m_hLanguageModule, IDS_DIRECTORY_LISTING_TYPE_CSV);
+	std::wstring jsonType =
+		ResourceHelper::LoadString(m_hLanguageModule, IDS_DIRECTORY_LISTING_TYPE_JSON);
+
+	const COMDLG_FILTERSPEC fileTypes[] = { { textType.c_str(), L"*.txt" },
+		{ csvType.c_str(), L"*.csv" }, { jsonType.c_str(), L"*.json" } };
+	fileSaveDialog->SetFileTypes(SIZEOF_ARRAY(fileTypes), fileTypes);
+	fileSaveDialog->SetFileTypeIndex(1);
+	fileSaveDialog->SetDefaultExtension(L"txt");
+	fileSaveDialog->SetFileName(
+		ResourceHelper::LoadString(m_hLanguageModule, IDS_GENERAL_DIRECTORY_LISTING_FILENAME)
+			.c_str());
 
 	std::wstring directory = m_pActiveShellBrowser->GetDirectory();
 
-	BOOL bSaveNameRetrieved =
-		GetFileNameFromUser(m_hContainer, fileName, SIZEOF_ARRAY(fileName), directory.c_str());
+	wil::com_ptr_nothrow<IShellItem> directoryItem;
+	hr = SHCreateItemFromParsingName(directory.c_str(), nullptr, IID_PPV_ARGS(&directoryItem));
 
-	if (bSaveNameRetrieved)
+	if (SUCCEEDED(hr))
 	{
-		NFileOperations::SaveDirectoryListing(directory, fileName);
+		fileSaveDialog->SetFolder(directoryItem.get());
 	}
+
+	const DWORD includeSubfoldersId = 1;
+	auto customize = fileSaveDialog.try_query<IFileDialogCustomize>();
+
+	if (customize)
+	{
+		customize->AddCheckButton(includeSubfoldersId,
+			ResourceHelper::LoadString(m_hLanguageModule, IDS_DIRECTORY_LISTING_INCLUDE_SUBFOLDERS)
+				.c_str(),
+			FALSE);
+	}
+
+	hr = fileSaveDialog->Show(m_hContainer);
+
+	if (FAILED(hr))
+	{
+		return;
+	}
+
+	wil::com_ptr_nothrow<IShellItem> result;
+	hr = fileSaveDialog->GetResult(&result);
+
+	if (FAILED(hr))
+	{
+		return;
+	}
+
+	wil::unique_cotaskmem_string fileName;
+	hr = result->GetDisplayName(SIGDN_FILESYSPATH, &fileName);
+
+	if (FAILED(hr))
+	{
+		return;
+	}
+
+	UINT fileTypeIndex = 1;
+	fileSaveDialog->GetFileTypeIndex(&fileTypeIndex);
+
+	auto format = DirectoryListingFormatter::Format::Text;
+
+	if (fileTypeIndex == 2)
+	{
+		format = DirectoryListingFormatter::Format::Csv;
+	}
+	else if (fileTypeIndex == 3)
+	{
+		format = DirectoryListingFormatter::Format::Json;
+	}
+
+	BOOL includeSubfolders = FALSE;
+
+	if (customize)
+	{
+		customize->GetCheckButtonState(includeSubfoldersId, &includeSubfolders);
+	}
+
+	NFileOperations::SaveDirectoryListing(
+		directory, fileName.get(), format, includeSubfolders == TRUE);
 }
 
 void Explorerplusplus::OnCreateNewFolder()
@@ -226,7 +466,7 @@ void Explorerplusplus::OnCreateNewFolder()
 
 	FileProgressSink *sink = FileProgressSink::CreateNew();
 	sink->SetPostNewItemObserver([this](PIDLIST_ABSOLUTE pidl) {
-		ListViewHelper::SelectAllItems(m_hActiveListView, FALSE);
+		m_pActiveShellBrowser->DeselectAllItems();
 		SetFocus(m_hActiveListView);
 
 		m_pActiveShellBrowser->QueueRename(pidl);
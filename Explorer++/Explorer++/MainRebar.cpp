@@ -295,7 +295,7 @@ boost::signals2::connection Explorerplusplus::AddToolbarContextMenuObserver(
 
 void Explorerplusplus::CreateAddressBar()
 {
-	m_addressBar = AddressBar::Create(m_hMainRebar, this);
+	m_addressBar = AddressBar::Create(m_hMainRebar, this, &m_bookmarkTree);
 }
 
 void Explorerplusplus::CreateMainToolbar()
@@ -360,6 +360,31 @@ void Explorerplusplus::CreateDrivesToolbar()
 		TOOLBAR_DRIVES_ID_END, m_hLanguageModule, this, m_navigation.get());
 }
 
+void Explorerplusplus::PopulateDrivesToolbar()
+{
+	m_pDrivesToolbar->drivesInsertedSignal.AddObserver(
+		std::bind_front(&Explorerplusplus::OnDrivesToolbarPopulated, this));
+	m_pDrivesToolbar->InsertDrives();
+}
+
+void Explorerplusplus::OnDrivesToolbarPopulated()
+{
+	// The band height was set from the empty toolbar when it was created, so needs to be updated
+	// now that the buttons are present.
+	auto buttonSize =
+		static_cast<DWORD>(SendMessage(m_pDrivesToolbar->GetHWND(), TB_GETBUTTONSIZE, 0, 0));
+	int bandIndex = static_cast<int>(SendMessage(m_hMainRebar, RB_IDTOINDEX, ID_DRIVESTOOLBAR, 0));
+
+	REBARBANDINFO bandInfo;
+	bandInfo.cbSize = sizeof(bandInfo);
+	bandInfo.fMask = RBBIM_CHILDSIZE;
+	bandInfo.cxMinChild = 0;
+	bandInfo.cyMinChild = HIWORD(buttonSize);
+	bandInfo.cyChild = HIWORD(buttonSize);
+	bandInfo.cyMaxChild = HIWORD(buttonSize);
+	SendMessage(m_hMainRebar, RB_SETBANDINFO, bandIndex, reinterpret_cast<LPARAM>(&bandInfo));
+}
+
 void Explorerplusplus::CreateApplicationToolbar()
 {
 	m_pApplicationToolbar = ApplicationToolbar::Create(m_hMainRebar, TOOLBAR_APPLICATIONS_ID_START,
@@ -923,7 +923,7 @@ void MainToolbar::OnMButtonUp(HWND hwnd, int x, int y, UINT keysDown)
 	}
 
 	const Tab &tab = m_pexpp->GetTabContainer()->GetSelectedTab();
-	unique_pidl_absolute pidl;
+	SharedPidl pidl;
 
 	if (tbButton.idCommand == ToolbarButton::Back || tbButton.idCommand == ToolbarButton::Forward)
 	{
@@ -980,7 +980,12 @@ void MainToolbar::OnTabSelected(const Tab &tab)
 {
 	UNREFERENCED_PARAMETER(tab);
 
-	UpdateToolbarButtonStates();
+	m_pexpp->GetTabContainer()->ScheduleSelectionUpdate(this,
+		TabContainer::SelectionUpdatePriority::Navigation, [this](const Tab &selectedTab) {
+			UNREFERENCED_PARAMETER(selectedTab);
+
+			UpdateToolbarButtonStates();
+		});
 }
 
 void MainToolbar::OnNavigationCommitted(
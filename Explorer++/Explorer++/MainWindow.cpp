@@ -61,7 +61,12 @@ void MainWindow::OnTabSelected(const Tab &tab)
 {
 	UNREFERENCED_PARAMETER(tab);
 
-	UpdateWindowText();
+	m_expp->GetTabContainer()->ScheduleSelectionUpdate(this,
+		TabContainer::SelectionUpdatePriority::Status, [this](const Tab &selectedTab) {
+			UNREFERENCED_PARAMETER(selectedTab);
+
+			UpdateWindowText();
+		});
 }
 
 void MainWindow::OnShowFullTitlePathUpdated(BOOL newValue)
@@ -29,11 +29,17 @@
 #include "TabContainer.h"
 #include "TabRestorerUI.h"
 #include "ToolbarButtons.h"
+#include "UiTheming.h"
 #include "../Helper/BulkClipboardWriter.h"
 #include "../Helper/Controls.h"
+#include "../Helper/DisplayFormatter.h"
+#include "../Helper/ExtensionIconCache.h"
 #include "../Helper/FileOperations.h"
+#include "../Helper/FileTypeNameCache.h"
+#include "../Helper/IconLocationCache.h"
 #include "../Helper/ListViewHelper.h"
 #include "../Helper/Macros.h"
+#include "../Helper/NetworkLocationPolicy.h"
 #include "../Helper/ShellHelper.h"
 #include "../Helper/WindowHelper.h"
 
@@ -103,6 +109,14 @@ LRESULT CALLBACK Explorerplusplus::WindowProcedure(HWND hwnd,UINT Msg,WPARAM wPa
 		}
 		break;
 
+	case WM_INITMENUPOPUP:
+		// The window menu isn't part of the main menu.
+		if (!HIWORD(lParam))
+		{
+			m_mainMenuPopupSignal(reinterpret_cast<HMENU>(wParam));
+		}
+		break;
+
 	case WM_MENUSELECT:
 		StatusBarMenuSelect(wParam,lParam);
 		break;
@@ -123,6 +137,7 @@ LRESULT CALLBACK Explorerplusplus::WindowProcedure(HWND hwnd,UINT Msg,WPARAM wPa
 			UpdateDisplayWindow(selectedTab);
 			UpdateStatusBarText(selectedTab);
 			m_mainToolbar->UpdateToolbarButtonStates();
+			PrewarmSelectionContextMenu();
 
 			KillTimer(m_hContainer, LISTVIEW_ITEM_CHANGED_TIMER_ID);
 		}
@@ -148,9 +163,43 @@ LRESULT CALLBACK Explorerplusplus::WindowProcedure(HWND hwnd,UINT Msg,WPARAM wPa
 		break;
 
 	// See https://github.com/derceg/explorerplusplus/issues/169.
-	/*case WM_APP_ASSOCCHANGED:
-		OnAssocChanged();
-		break;*/
+	case WM_APP_ASSOCCHANGED:
+		GetExtensionIconCache().Clear();
+		GetFileTypeNameCache().Clear();
+		GetIconLocationCache().Clear();
+		break;
+
+	case WM_APP_DEFERREDINITIALIZATION:
+		OnDeferredInitialization();
+		break;
+
+	case WM_APP_INSTANCEHANDOFF:
+		OnInstanceHandoff();
+		break;
+
+	case WM_APP_DELIVERPLUGINEVENTS:
+		m_pluginEventQueue.deliverEvents();
+		break;
+
+	case WM_APP_DELIVERPLUGINTASKCOMPLETIONS:
+		m_pluginTaskRunner.deliverCompletions();
+		break;
+
+	case WM_APP_DELIVERPLUGINDIRECTORYCHANGES:
+		m_pluginDirectoryWatcher.deliverChanges();
+		break;
+
+	case WM_APP_FILEOPERATIONQUEUEUPDATED:
+		OnFileOperationQueueUpdated();
+		break;
+
+	case WM_APP_HANGWATCHDOGPING:
+		OnHangWatchdogPing(static_cast<uint64_t>(wParam));
+		break;
+
+	case WM_APP_MEMORYPRESSURE:
+		OnMemoryPressure(static_cast<size_t>(wParam), lParam != 0);
+		break;
 
 	case WM_USER_HOLDERRESIZED:
 		{
@@ -164,16 +213,23 @@ LRESULT CALLBACK Explorerplusplus::WindowProcedure(HWND hwnd,UINT Msg,WPARAM wPa
 		}
 		break;
 
+	case WM_APP_DISPLAYWINDOWDETAILSREADY:
+		OnDisplayWindowDetailsReady(static_cast<int>(wParam));
+		break;
+
+	case WM_APP_STATUSBARFREESPACEREADY:
+		OnStatusBarFreeSpaceReady(static_cast<int>(wParam));
+		break;
+
 	case WM_APP_FOLDERSIZECOMPLETED:
 		{
-			DWFolderSizeCompletion *pDWFolderSizeCompletion = nullptr;
+			std::unique_ptr<DWFolderSizeCompletion> pDWFolderSizeCompletion(
+				reinterpret_cast<DWFolderSizeCompletion *>(wParam));
 			TCHAR szFolderSize[32];
-			TCHAR szSizeString[64];
+			TCHAR szSizeString[128];
 			TCHAR szTotalSize[64];
 			BOOL bValid = FALSE;
 
-			pDWFolderSizeCompletion = (DWFolderSizeCompletion *)wParam;
-
 			std::list<DWFolderSize>::iterator itr;
 
 			/* First, make sure we should still display the
@@ -189,7 +245,10 @@ LRESULT CALLBACK Explorerplusplus::WindowProcedure(HWND hwnd,UINT Msg,WPARAM wPa
 						bValid = itr->bValid;
 					}
 
-					m_DWFolderSizes.erase(itr);
+					if(pDWFolderSizeCompletion->finished)
+					{
+						m_DWFolderSizes.erase(itr);
+					}
 
 					break;
 				}
@@ -204,14 +263,25 @@ LRESULT CALLBACK Explorerplusplus::WindowProcedure(HWND hwnd,UINT Msg,WPARAM wPa
 				LoadString(m_hLanguageModule,IDS_GENERAL_TOTALSIZE,
 					szTotalSize,SIZEOF_ARRAY(szTotalSize));
 
-				StringCchPrintf(szSizeString,SIZEOF_ARRAY(szSizeString),
-					_T("%s: %s"),szTotalSize,szFolderSize);
+				if(pDWFolderSizeCompletion->finished)
+				{
+					StringCchPrintf(szSizeString,SIZEOF_ARRAY(szSizeString),
+						_T("%s: %s"),szTotalSize,szFolderSize);
+				}
+				else
+				{
+					TCHAR szCalculating[64];
+					LoadString(m_hLanguageModule,IDS_GENERAL_CALCULATING,
+						szCalculating,SIZEOF_ARRAY(szCalculating));
+
+					/* Show the running total while the calculation continues. */
+					StringCchPrintf(szSizeString,SIZEOF_ARRAY(szSizeString),
+						_T("%s: %s (%s)"),szTotalSize,szFolderSize,szCalculating);
+				}
 
 				/* TODO: The line index should be stored in some other (variable) way. */
 				DisplayWindow_SetLine(m_hDisplayWindow,FOLDER_SIZE_LINE_INDEX,szSizeString);
 			}
-
-			free(pDWFolderSizeCompletion);
 		}
 		break;
 
@@ -264,6 +334,29 @@ LRESULT CALLBACK Explorerplusplus::WindowProcedure(HWND hwnd,UINT Msg,WPARAM wPa
 		OnDpiChanged(reinterpret_cast<RECT *>(lParam));
 		return 0;
 
+	case WM_THEMECHANGED:
+		if (m_uiTheming)
+		{
+			m_uiTheming->OnThemeChanged();
+		}
+		break;
+
+	case WM_SETTINGCHANGE:
+		if (m_uiTheming && wParam == SPI_SETNONCLIENTMETRICS)
+		{
+			m_uiTheming->OnThemeChanged();
+		}
+
+		if (lParam && lstrcmp(reinterpret_cast<LPCTSTR>(lParam), _T("intl")) == 0)
+		{
+			GetDisplayFormatter().OnLocaleChanged();
+		}
+		break;
+
+	case WM_TIMECHANGE:
+		GetDisplayFormatter().OnTimeZoneChanged();
+		break;
+
 	case WM_CTLCOLORSTATIC:
 		if (auto res = OnCtlColorStatic(reinterpret_cast<HWND>(lParam), reinterpret_cast<HDC>(wParam)))
 		{
@@ -421,7 +514,7 @@ LRESULT Explorerplusplus::HandleMenuOrAccelerator(HWND hwnd, WPARAM wParam)
 		break;
 
 	case IDM_EDIT_PASTEHARDLINK:
-		PasteHardLinks(m_pActiveShellBrowser->GetDirectory().c_str());
+		PasteHardLinks(m_hContainer, m_pActiveShellBrowser->GetDirectory());
 		break;
 
 	case IDM_EDIT_COPYTOFOLDER:
@@ -435,12 +528,12 @@ LRESULT Explorerplusplus::HandleMenuOrAccelerator(HWND hwnd, WPARAM wParam)
 		break;
 
 	case IDM_EDIT_SELECTALL:
-		ListViewHelper::SelectAllItems(m_hActiveListView, TRUE);
+		m_pActiveShellBrowser->SelectAllItems();
 		SetFocus(m_hActiveListView);
 		break;
 
 	case IDM_EDIT_INVERTSELECTION:
-		ListViewHelper::InvertSelection(m_hActiveListView);
+		m_pActiveShellBrowser->InvertSelection();
 		SetFocus(m_hActiveListView);
 		break;
 
@@ -450,7 +543,7 @@ LRESULT Explorerplusplus::HandleMenuOrAccelerator(HWND hwnd, WPARAM wParam)
 		break;
 
 	case IDM_EDIT_SELECTNONE:
-		ListViewHelper::SelectAllItems(m_hActiveListView, FALSE);
+		m_pActiveShellBrowser->DeselectAllItems();
 		SetFocus(m_hActiveListView);
 		break;
 
@@ -576,6 +669,10 @@ LRESULT Explorerplusplus::HandleMenuOrAccelerator(HWND hwnd, WPARAM wParam)
 		m_pActiveShellBrowser->SetFilterStatus(!m_pActiveShellBrowser->GetFilterStatus());
 		break;
 
+	case IDM_FILTER_QUICKFILTER:
+		ToggleQuickFilterBar();
+		break;
+
 	case IDM_SORTBY_NAME:
 		OnSortBy(SortMode::Name);
 		break;
@@ -824,6 +921,14 @@ LRESULT Explorerplusplus::HandleMenuOrAccelerator(HWND hwnd, WPARAM wParam)
 		OnSortBy(SortMode::MediaYear);
 		break;
 
+	case IDM_SORTBY_CHECKSUM:
+		OnSortBy(SortMode::Checksum);
+		break;
+
+	case IDM_SORTBY_RELATIVEPATH:
+		OnSortBy(SortMode::RelativePath);
+		break;
+
 	case IDM_GROUPBY_NAME:
 		OnGroupBy(SortMode::Name);
 		break;
@@ -1072,6 +1177,14 @@ LRESULT Explorerplusplus::HandleMenuOrAccelerator(HWND hwnd, WPARAM wParam)
 		OnGroupBy(SortMode::MediaYear);
 		break;
 
+	case IDM_GROUPBY_CHECKSUM:
+		OnGroupBy(SortMode::Checksum);
+		break;
+
+	case IDM_GROUPBY_RELATIVEPATH:
+		OnGroupBy(SortMode::RelativePath);
+		break;
+
 	case IDM_SORT_ASCENDING:
 		OnSortByAscending(TRUE);
 		break;
@@ -1088,6 +1201,26 @@ LRESULT Explorerplusplus::HandleMenuOrAccelerator(HWND hwnd, WPARAM wParam)
 		OnShowHiddenFiles();
 		break;
 
+	case IDM_VIEW_ALLOWCLOUDDOWNLOADS:
+		OnToggleAllowCloudDownloads();
+		break;
+
+	case IDM_VIEW_FLATVIEW:
+		OnToggleFlatView();
+		break;
+
+	case IDM_NETWORKLOCATION_AUTOMATIC:
+		OnSetNetworkLocationMode(NetworkLocationMode::Automatic);
+		break;
+
+	case IDM_NETWORKLOCATION_FULL:
+		OnSetNetworkLocationMode(NetworkLocationMode::Full);
+		break;
+
+	case IDM_NETWORKLOCATION_REDUCED:
+		OnSetNetworkLocationMode(NetworkLocationMode::Reduced);
+		break;
+
 	case ToolbarButton::Refresh:
 	case IDM_VIEW_REFRESH:
 		OnRefresh();
@@ -1183,6 +1316,14 @@ LRESULT Explorerplusplus::HandleMenuOrAccelerator(HWND hwnd, WPARAM wParam)
 		OnDestroyFiles();
 		break;
 
+	case IDM_ACTIONS_COMPUTEHASHES:
+		OnComputeHashes();
+		break;
+
+	case IDM_ACTIONS_PAUSEFILETRANSFERS:
+		OnTogglePauseFileTransfers();
+		break;
+
 	case ToolbarButton::Back:
 	case IDM_GO_BACK:
 		OnGoBack();
@@ -1198,6 +1339,10 @@ LRESULT Explorerplusplus::HandleMenuOrAccelerator(HWND hwnd, WPARAM wParam)
 		m_navigation->OnNavigateUp();
 		break;
 
+	case IDM_GO_STOP:
+		m_tabContainer->GetSelectedTab().GetShellBrowser()->CancelPendingNavigation();
+		break;
+
 	case IDM_GO_MYCOMPUTER:
 		OnGoToKnownFolder(FOLDERID_ComputerFolder);
 		break;
@@ -1271,6 +1416,14 @@ LRESULT Explorerplusplus::HandleMenuOrAccelerator(HWND hwnd, WPARAM wParam)
 		OnSearch();
 		break;
 
+	case IDM_TOOLS_FINDDUPLICATES:
+		OnFindDuplicateFiles();
+		break;
+
+	case IDM_TOOLS_DISKUSAGE:
+		OnShowDiskUsage();
+		break;
+
 	case IDM_TOOLS_CUSTOMIZECOLORS:
 		OnCustomizeColors();
 		break;
@@ -1279,6 +1432,10 @@ LRESULT Explorerplusplus::HandleMenuOrAccelerator(HWND hwnd, WPARAM wParam)
 		OnRunScript();
 		break;
 
+	case IDM_TOOLS_DIAGNOSTICS:
+		OnShowDiagnostics();
+		break;
+
 	case IDM_TOOLS_OPTIONS:
 		OnShowOptions();
 		break;
@@ -4,13 +4,8 @@
 
 /*
  * Provides support for the mass renaming of files.
- * The following special characters are supported:
- * /N	- Counter
- * /F	- Filename
- * /B	- Basename (filename without extension)
- * /E	- Extension
- * /L	- Lowercase filename
- * /U	- Uppercase filename
+ * See MassRenamePattern for the special characters that
+ * are supported.
  */
 
 #include "stdafx.h"
@@ -18,15 +13,17 @@
 #include "DarkModeHelper.h"
 #include "IconResourceLoader.h"
 #include "MainResource.h"
+#include "MassRenamePattern.h"
 #include "ResourceHelper.h"
 #include "../Helper/DpiCompatibility.h"
 #include "../Helper/Macros.h"
 #include "../Helper/RegistrySettings.h"
 #include "../Helper/XMLSettings.h"
-#include <boost/locale.hpp>
-#include <iomanip>
+#include <wil/common.h>
+#include <algorithm>
+#include <execution>
 #include <list>
-#include <regex>
+#include <numeric>
 
 const TCHAR MassRenameDialogPersistentSettings::SETTINGS_KEY[] = _T("MassRename");
 
@@ -37,11 +34,18 @@ MassRenameDialog::MassRenameDialog(HINSTANCE hInstance, HWND hParent,
 	const std::list<std::wstring> &FullFilenameList, IconResourceLoader *iconResourceLoader,
 	FileActionHandler *pFileActionHandler) :
 	DarkModeDialogBase(hInstance, IDD_MASSRENAME, hParent, true),
-	m_FullFilenameList(FullFilenameList),
 	m_iconResourceLoader(iconResourceLoader),
-	m_pFileActionHandler(pFileActionHandler)
+	m_pFileActionHandler(pFileActionHandler),
+	m_latestPreviewId(0)
 {
 	m_persistentSettings = &MassRenameDialogPersistentSettings::GetInstance();
+
+	m_items.reserve(FullFilenameList.size());
+
+	for (const auto &fullFilename : FullFilenameList)
+	{
+		m_items.push_back({ fullFilename, PathFindFileName(fullFilename.c_str()) });
+	}
 }
 
 INT_PTR MassRenameDialog::OnInitDialog()
@@ -79,34 +83,9 @@ INT_PTR MassRenameDialog::OnInitDialog()
 	SendMessage(hListView, LVM_SETCOLUMNWIDTH, 0, m_persistentSettings->m_iColumnWidth1);
 	SendMessage(hListView, LVM_SETCOLUMNWIDTH, 1, m_persistentSettings->m_iColumnWidth2);
 
-	LVITEM lvItem;
-	SHFILEINFO shfi;
-	TCHAR szFilename[MAX_PATH];
-	int iItem = 0;
-
-	/* Add each file to the listview, along with its icon. */
-	for (const auto &strFilename : m_FullFilenameList)
-	{
-		SHGetFileInfo(strFilename.c_str(), 0, &shfi, sizeof(SHFILEINFO), SHGFI_SYSICONINDEX);
-
-		StringCchCopy(szFilename, SIZEOF_ARRAY(szFilename), strFilename.c_str());
-		PathStripPath(szFilename);
-
-		lvItem.mask = LVIF_TEXT | LVIF_IMAGE;
-		lvItem.iItem = iItem;
-		lvItem.iSubItem = 0;
-		lvItem.iImage = shfi.iIcon;
-		lvItem.pszText = szFilename;
-		ListView_InsertItem(hListView, &lvItem);
-
-		lvItem.mask = LVIF_TEXT;
-		lvItem.iItem = iItem;
-		lvItem.iSubItem = 1;
-		lvItem.pszText = szFilename;
-		ListView_SetItem(hListView, &lvItem);
-
-		iItem++;
-	}
+	// The listview is virtual, so the text and icon for each item are only retrieved when the item
+	// is displayed.
+	ListView_SetItemCountEx(hListView, static_cast<int>(m_items.size()), LVSICF_NOINVALIDATEALL);
 
 	SetDlgItemText(m_hDlg, IDC_MASSRENAME_EDIT, _T("/F"));
 	SendMessage(GetDlgItem(m_hDlg, IDC_MASSRENAME_EDIT), EM_SETSEL, 0, -1);
@@ -167,37 +146,8 @@ INT_PTR MassRenameDialog::OnCommand(WPARAM wParam, LPARAM lParam)
 		switch (HIWORD(wParam))
 		{
 		case EN_CHANGE:
-		{
-			TCHAR szNamePattern[MAX_PATH];
-			GetDlgItemText(m_hDlg, IDC_MASSRENAME_EDIT, szNamePattern, SIZEOF_ARRAY(szNamePattern));
-
-			HWND hListView = GetDlgItem(m_hDlg, IDC_MASSRENAME_FILELISTVIEW);
-
-			LVITEM lvItem;
-			std::wstring strNewFilename;
-			TCHAR szFilename[MAX_PATH];
-			TCHAR szNewFilename[MAX_PATH];
-			int iItem = 0;
-
-			for (const auto &strFilename : m_FullFilenameList)
-			{
-				StringCchCopy(szFilename, SIZEOF_ARRAY(szFilename), strFilename.c_str());
-				PathStripPath(szFilename);
-
-				ProcessFileName(szNamePattern, szFilename, iItem, strNewFilename);
-
-				StringCchCopy(szNewFilename, SIZEOF_ARRAY(szNewFilename), strNewFilename.c_str());
-
-				lvItem.mask = LVIF_TEXT;
-				lvItem.iItem = iItem;
-				lvItem.iSubItem = 1;
-				lvItem.pszText = szNewFilename;
-				ListView_SetItem(hListView, &lvItem);
-
-				iItem++;
-			}
-		}
-		break;
+			OnPatternChanged();
+			break;
 		}
 	}
 	else
@@ -263,6 +213,126 @@ INT_PTR MassRenameDialog::OnCommand(WPARAM wParam, LPARAM lParam)
 	return 0;
 }
 
+INT_PTR MassRenameDialog::OnNotify(NMHDR *pnmhdr)
+{
+	if (pnmhdr->idFrom == IDC_MASSRENAME_FILELISTVIEW && pnmhdr->code == LVN_GETDISPINFO)
+	{
+		OnGetDisplayInfo(reinterpret_cast<NMLVDISPINFO *>(pnmhdr));
+	}
+
+	return 0;
+}
+
+void MassRenameDialog::OnGetDisplayInfo(NMLVDISPINFO *dispInfo)
+{
+	auto &item = m_items[dispInfo->item.iItem];
+
+	if (WI_IsFlagSet(dispInfo->item.mask, LVIF_IMAGE))
+	{
+		if (dispInfo->item.iSubItem == 0)
+		{
+			if (!item.iconIndex)
+			{
+				SHFILEINFO shfi;
+				DWORD_PTR res = SHGetFileInfo(
+					item.fullPath.c_str(), 0, &shfi, sizeof(SHFILEINFO), SHGFI_SYSICONINDEX);
+				item.iconIndex = res ? shfi.iIcon : 0;
+			}
+
+			dispInfo->item.iImage = *item.iconIndex;
+		}
+		else
+		{
+			dispInfo->item.iImage = I_IMAGENONE;
+		}
+	}
+
+	if (WI_IsFlagSet(dispInfo->item.mask, LVIF_TEXT))
+	{
+		const std::wstring *text = &item.name;
+
+		if (dispInfo->item.iSubItem == 1
+			&& static_cast<size_t>(dispInfo->item.iItem) < m_previewNames.size())
+		{
+			text = &m_previewNames[dispInfo->item.iItem];
+		}
+
+		StringCchCopy(dispInfo->item.pszText, dispInfo->item.cchTextMax, text->c_str());
+	}
+}
+
+void MassRenameDialog::OnPatternChanged()
+{
+	TCHAR szNamePattern[MAX_PATH];
+	GetDlgItemText(m_hDlg, IDC_MASSRENAME_EDIT, szNamePattern, SIZEOF_ARRAY(szNamePattern));
+
+	int previewId = ++m_latestPreviewId;
+
+	// The new names are generated in the background, so that typing remains responsive when there
+	// are a large number of items. Replacing the existing future waits for any previous task,
+	// though that task will stop early, since its results are no longer needed.
+	m_previewFuture = std::async(std::launch::async,
+		[this, pattern = MassRenamePattern(szNamePattern), previewId] {
+			auto newNames = GenerateNewNames(pattern, previewId);
+			PostMessage(m_hDlg, WM_APP_PREVIEW_READY, previewId, 0);
+			return newNames;
+		});
+}
+
+INT_PTR MassRenameDialog::OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
+{
+	UNREFERENCED_PARAMETER(lParam);
+
+	switch (uMsg)
+	{
+	case WM_APP_PREVIEW_READY:
+		OnPreviewReady(static_cast<int>(wParam));
+		break;
+	}
+
+	return 0;
+}
+
+void MassRenameDialog::OnPreviewReady(int previewId)
+{
+	if (previewId != m_latestPreviewId || !m_previewFuture.valid())
+	{
+		return;
+	}
+
+	m_previewNames = m_previewFuture.get();
+
+	InvalidateRect(GetDlgItem(m_hDlg, IDC_MASSRENAME_FILELISTVIEW), nullptr, FALSE);
+}
+
+std::vector<std::wstring> MassRenameDialog::GenerateNewNames(
+	const MassRenamePattern &pattern, std::optional<int> previewId) const
+{
+	std::vector<std::wstring> newNames(m_items.size());
+
+	std::vector<size_t> chunks(
+		(m_items.size() + NAME_GENERATION_CHUNK_SIZE - 1) / NAME_GENERATION_CHUNK_SIZE);
+	std::iota(chunks.begin(), chunks.end(), 0);
+
+	std::for_each(std::execution::par, chunks.begin(), chunks.end(),
+		[this, &pattern, previewId, &newNames](size_t chunk) {
+			if (previewId && *previewId != m_latestPreviewId)
+			{
+				return;
+			}
+
+			size_t start = chunk * NAME_GENERATION_CHUNK_SIZE;
+			size_t end = (std::min)(start + NAME_GENERATION_CHUNK_SIZE, m_items.size());
+
+			for (size_t i = start; i < end; i++)
+			{
+				newNames[i] = pattern.Apply(m_items[i].name, static_cast<int>(i));
+			}
+		});
+
+	return newNames;
+}
+
 INT_PTR MassRenameDialog::OnClose()
 {
 	EndDialog(m_hDlg, 0);
@@ -281,30 +351,23 @@ void MassRenameDialog::OnOk()
 		return;
 	}
 
+	auto newNames = GenerateNewNames(MassRenamePattern(szNamePattern), std::nullopt);
+
 	std::list<FileActionHandler::RenamedItem_t> renamedItemList;
-	int iItem = 0;
 
-	for (const auto &strOldFilename : m_FullFilenameList)
+	for (size_t i = 0; i < m_items.size(); i++)
 	{
-		TCHAR szFilename[MAX_PATH];
-		StringCchCopy(szFilename, SIZEOF_ARRAY(szFilename), strOldFilename.c_str());
-		PathStripPath(szFilename);
-
-		std::wstring strNewFilename;
-		ProcessFileName(szNamePattern, szFilename, iItem, strNewFilename);
-
-		StringCchCopy(szFilename, SIZEOF_ARRAY(szFilename), strOldFilename.c_str());
-		PathRemoveFileSpec(szFilename);
-		strNewFilename = szFilename + std::wstring(_T("\\")) + strNewFilename;
+		const auto &item = m_items[i];
 
 		FileActionHandler::RenamedItem_t renamedItem;
-		renamedItem.strOldFilename = strOldFilename;
-		renamedItem.strNewFilename = strNewFilename;
+		renamedItem.strOldFilename = item.fullPath;
+		renamedItem.strNewFilename =
+			std::wstring(item.fullPath.c_str(), PathFindFileName(item.fullPath.c_str()))
+			+ newNames[i];
 		renamedItemList.push_back(renamedItem);
-
-		iItem++;
 	}
 
+	// The files are all renamed in a single batch.
 	m_pFileActionHandler->RenameFiles(renamedItemList);
 
 	EndDialog(m_hDlg, 1);
@@ -326,73 +389,6 @@ void MassRenameDialog::SaveState()
 	m_persistentSettings->m_bStateSaved = TRUE;
 }
 
-void MassRenameDialog::ProcessFileName(const std::wstring &strTarget,
-	const std::wstring &strFilename, int iFileIndex, std::wstring &strOutput)
-{
-	TCHAR szBaseName[MAX_PATH];
-	StringCchCopy(szBaseName, SIZEOF_ARRAY(szBaseName), strFilename.c_str());
-	PathRemoveExtension(szBaseName);
-
-	TCHAR *pExt = PathFindExtension(strFilename.c_str());
-
-	size_t iPos;
-
-	strOutput = strTarget;
-
-	std::wregex rxPattern;
-	rxPattern.assign(_T("/[0]*N"));
-
-	bool bStop = false;
-
-	while (!bStop)
-	{
-		std::match_results<std::wstring::const_iterator> mr;
-		std::wstring::const_iterator itrStart = strOutput.begin();
-		std::wstring::const_iterator itrEnd = strOutput.end();
-
-		if (std::regex_search(itrStart, itrEnd, mr, rxPattern))
-		{
-			std::wstringstream ss;
-
-			/* The minimum length is the number of zeros present plus one. */
-			ss << std::setfill(_T('0')) << std::setw((mr.length() - 2) + 1) << iFileIndex;
-
-			strOutput.replace(mr.position(), mr.length(), ss.str());
-		}
-		else
-		{
-			bStop = true;
-		}
-	}
-
-	while ((iPos = strOutput.find(_T("/F"))) != std::wstring::npos)
-	{
-		strOutput.replace(iPos, 2, strFilename);
-	}
-
-	while ((iPos = strOutput.find(_T("/B"))) != std::wstring::npos)
-	{
-		strOutput.replace(iPos, 2, szBaseName);
-	}
-
-	while ((iPos = strOutput.find(_T("/E"))) != std::wstring::npos)
-	{
-		strOutput.replace(iPos, 2, pExt);
-	}
-
-	while ((iPos = strOutput.find(_T("/L"))) != std::wstring::npos)
-	{
-		strOutput.replace(iPos, 2, strFilename);
-		strOutput = boost::locale::to_lower(strOutput);
-	}
-
-	while ((iPos = strOutput.find(_T("/U"))) != std::wstring::npos)
-	{
-		strOutput.replace(iPos, 2, strFilename);
-		strOutput = boost::locale::to_upper(strOutput);
-	}
-}
-
 MassRenameDialogPersistentSettings::MassRenameDialogPersistentSettings() :
 	DialogSettings(SETTINGS_KEY)
 {
@@ -8,9 +8,14 @@
 #include "../Helper/DialogSettings.h"
 #include "../Helper/FileActionHandler.h"
 #include "../Helper/ResizableDialog.h"
+#include <atomic>
+#include <future>
+#include <optional>
+#include <vector>
 
 class IconResourceLoader;
 class MassRenameDialog;
+class MassRenamePattern;
 
 class MassRenameDialogPersistentSettings : public DialogSettings
 {
@@ -52,11 +57,27 @@ public:
 protected:
 	INT_PTR OnInitDialog() override;
 	INT_PTR OnCommand(WPARAM wParam, LPARAM lParam) override;
+	INT_PTR OnNotify(NMHDR *pnmhdr) override;
 	INT_PTR OnClose() override;
+	INT_PTR OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lParam) override;
 
 	virtual wil::unique_hicon GetDialogIcon(int iconWidth, int iconHeight) const override;
 
 private:
+	struct Item
+	{
+		std::wstring fullPath;
+		std::wstring name;
+
+		// Only retrieved once the item is displayed.
+		std::optional<int> iconIndex;
+	};
+
+	static const UINT WM_APP_PREVIEW_READY = WM_APP + 1;
+
+	// New names are generated in parallel, with each task handling this many items.
+	static const size_t NAME_GENERATION_CHUNK_SIZE = 1000;
+
 	void GetResizableControlInformation(BaseDialog::DialogSizeConstraint &dsc,
 		std::list<ResizableDialog::Control> &ControlList) override;
 	void SaveState() override;
@@ -64,13 +85,26 @@ private:
 	void OnOk();
 	void OnCancel();
 
-	void ProcessFileName(const std::wstring &strTarget, const std::wstring &strFilename,
-		int iFileIndex, std::wstring &strOutput);
+	void OnPatternChanged();
+	void OnPreviewReady(int previewId);
+	void OnGetDisplayInfo(NMLVDISPINFO *dispInfo);
 
-	std::list<std::wstring> m_FullFilenameList;
+	// If a preview ID is provided, generation stops early once a newer preview is requested.
+	std::vector<std::wstring> GenerateNewNames(
+		const MassRenamePattern &pattern, std::optional<int> previewId) const;
+
+	std::vector<Item> m_items;
 	wil::unique_hicon m_moreIcon;
 	IconResourceLoader *m_iconResourceLoader;
 	FileActionHandler *m_pFileActionHandler;
 
 	MassRenameDialogPersistentSettings *m_persistentSettings;
+
+	// The listview is virtual. Until the first preview is ready, the existing names are shown.
+	std::vector<std::wstring> m_previewNames;
+	std::atomic<int> m_latestPreviewId;
+
+	// This is declared last, so that it's destroyed first. Destroying it waits for the preview
+	// task, which accesses the items above.
+	std::future<std::vector<std::wstring>> m_previewFuture;
 };
\ No newline at end of file
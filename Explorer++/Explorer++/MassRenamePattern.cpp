@@ -0,0 +1,147 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "MassRenamePattern.h"
+#include <boost/locale.hpp>
+
+MassRenamePattern::MassRenamePattern(const std::wstring &pattern)
+{
+	for (size_t i = 0; i < pattern.size(); i++)
+	{
+		if (pattern[i] != '/' || i + 1 == pattern.size())
+		{
+			AddLiteral(pattern[i]);
+			continue;
+		}
+
+		size_t numZeros = 0;
+
+		while (i + 1 + numZeros < pattern.size() && pattern[i + 1 + numZeros] == '0')
+		{
+			numZeros++;
+		}
+
+		wchar_t specifier = (i + 1 + numZeros < pattern.size()) ? pattern[i + 1 + numZeros] : 0;
+
+		if (specifier == 'N')
+		{
+			// The minimum width is the number of zeros present plus one.
+			m_tokens.push_back({ TokenType::Counter, {}, static_cast<int>(numZeros) + 1 });
+			i += numZeros + 1;
+			continue;
+		}
+
+		if (numZeros > 0)
+		{
+			AddLiteral(pattern[i]);
+			continue;
+		}
+
+		switch (specifier)
+		{
+		case 'F':
+			m_tokens.push_back({ TokenType::Filename });
+			break;
+
+		case 'B':
+			m_tokens.push_back({ TokenType::Basename });
+			break;
+
+		case 'E':
+			m_tokens.push_back({ TokenType::Extension });
+			break;
+
+		// Both of these insert the filename and convert the case of the entire output. Uppercase
+		// conversion takes precedence, since it's applied last.
+		case 'L':
+			m_tokens.push_back({ TokenType::Filename });
+
+			if (m_caseConversion == CaseConversion::None)
+			{
+				m_caseConversion = CaseConversion::Lower;
+			}
+			break;
+
+		case 'U':
+			m_tokens.push_back({ TokenType::Filename });
+			m_caseConversion = CaseConversion::Upper;
+			break;
+
+		default:
+			AddLiteral(pattern[i]);
+			continue;
+		}
+
+		i++;
+	}
+}
+
+void MassRenamePattern::AddLiteral(wchar_t c)
+{
+	if (m_tokens.empty() || m_tokens.back().type != TokenType::Literal)
+	{
+		m_tokens.push_back({ TokenType::Literal });
+	}
+
+	m_tokens.back().text.push_back(c);
+}
+
+std::wstring MassRenamePattern::Apply(const std::wstring &filename, int fileIndex) const
+{
+	size_t extensionPosition = PathFindExtension(filename.c_str()) - filename.c_str();
+
+	std::wstring output;
+
+	for (const auto &token : m_tokens)
+	{
+		switch (token.type)
+		{
+		case TokenType::Literal:
+			output += token.text;
+			break;
+
+		case TokenType::Counter:
+		{
+			std::wstring counter = std::to_wstring(fileIndex);
+
+			if (counter.size() < static_cast<size_t>(token.width))
+			{
+				output.append(token.width - counter.size(), '0');
+			}
+
+			output += counter;
+		}
+		break;
+
+		case TokenType::Filename:
+			output += filename;
+			break;
+
+		case TokenType::Basename:
+			output.append(filename, 0, extensionPosition);
+			break;
+
+		case TokenType::Extension:
+			output.append(filename, extensionPosition);
+			break;
+		}
+	}
+
+	switch (m_caseConversion)
+	{
+	case CaseConversion::Lower:
+		output = boost::locale::to_lower(output);
+		break;
+
+	case CaseConversion::Upper:
+		output = boost::locale::to_upper(output);
+		break;
+
+	case CaseConversion::None:
+		break;
+	}
+
+	return output;
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+// A mass rename pattern, parsed once so that it can be applied to a large number of files (from
+// multiple threads, if necessary). The following special sequences are supported:
+//
+// /N	- Counter (zeros between the slash and the N set the minimum width, e.g. /00N)
+// /F	- Filename
+// /B	- Basename (filename without extension)
+// /E	- Extension
+// /L	- Filename, with the entire output converted to lowercase
+// /U	- Filename, with the entire output converted to uppercase
+class MassRenamePattern
+{
+public:
+	explicit MassRenamePattern(const std::wstring &pattern);
+
+	std::wstring Apply(const std::wstring &filename, int fileIndex) const;
+
+private:
+	enum class TokenType
+	{
+		Literal,
+		Counter,
+		Filename,
+		Basename,
+		Extension
+	};
+
+	struct Token
+	{
+		TokenType type;
+
+		// The text of a literal token.
+		std::wstring text;
+
+		// The minimum width of a counter token.
+		int width = 1;
+	};
+
+	enum class CaseConversion
+	{
+		None,
+		Lower,
+		Upper
+	};
+
+	void AddLiteral(wchar_t c);
+
+	std::vector<Token> m_tokens;
+	CaseConversion m_caseConversion = CaseConversion::None;
+};
\ No newline at end of file
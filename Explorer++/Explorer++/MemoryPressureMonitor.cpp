@@ -0,0 +1,73 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "MemoryPressureMonitor.h"
+
+MemoryPressureMonitor::MemoryPressureMonitor(
+	HWND hwnd, UINT pressureMessage, size_t maxWorkingSetBytes) :
+	m_hwnd(hwnd),
+	m_pressureMessage(pressureMessage),
+	m_maxWorkingSetBytes(maxWorkingSetBytes),
+	m_lowMemoryNotification(CreateMemoryResourceNotification(LowMemoryResourceNotification))
+{
+	m_stopEvent.create(wil::EventOptions::ManualReset);
+
+	m_thread = std::thread(&MemoryPressureMonitor::Run, this);
+}
+
+MemoryPressureMonitor::~MemoryPressureMonitor()
+{
+	m_stopEvent.SetEvent();
+	m_thread.join();
+}
+
+void MemoryPressureMonitor::Run()
+{
+	HANDLE handles[] = { m_stopEvent.get(), m_lowMemoryNotification.get() };
+
+	// If the notification couldn't be created, only the working set is checked.
+	DWORD numHandles = m_lowMemoryNotification ? 2 : 1;
+
+	while (true)
+	{
+		DWORD res = WaitForMultipleObjects(numHandles, handles, FALSE, CHECK_INTERVAL_MS);
+
+		if (res == WAIT_OBJECT_0 || res == WAIT_FAILED)
+		{
+			return;
+		}
+
+		bool lowMemory = (res == WAIT_OBJECT_0 + 1);
+		size_t workingSetSize = GetWorkingSetSize();
+
+		if (!lowMemory && workingSetSize <= m_maxWorkingSetBytes)
+		{
+			continue;
+		}
+
+		PostMessage(m_hwnd, m_pressureMessage, workingSetSize, lowMemory);
+
+		// The low memory notification stays signaled for as long as the condition persists, and
+		// releasing memory isn't immediately reflected in the working set, so there's always a
+		// pause before the next check.
+		if (m_stopEvent.wait(CHECK_INTERVAL_MS))
+		{
+			return;
+		}
+	}
+}
+
+size_t MemoryPressureMonitor::GetWorkingSetSize()
+{
+	PROCESS_MEMORY_COUNTERS memoryCounters;
+	BOOL res = GetProcessMemoryInfo(GetCurrentProcess(), &memoryCounters, sizeof(memoryCounters));
+
+	if (!res)
+	{
+		return 0;
+	}
+
+	return memoryCounters.WorkingSetSize;
+}
\ No newline at end of file
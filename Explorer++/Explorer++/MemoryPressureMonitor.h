@@ -0,0 +1,38 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "../Helper/Macros.h"
+#include <wil/resource.h>
+#include <thread>
+
+// Watches for memory pressure on a background thread. The thread waits on the system's low memory
+// notification and, in between, periodically checks the working set of the process. If the system
+// is low on memory, or the working set is larger than the budget, pressureMessage is posted to the
+// main window, with the size of the working set as the WPARAM and whether the system is low on
+// memory as the LPARAM. The caches themselves are then trimmed on the UI thread, since that's the
+// thread that owns most of them.
+class MemoryPressureMonitor
+{
+public:
+	MemoryPressureMonitor(HWND hwnd, UINT pressureMessage, size_t maxWorkingSetBytes);
+	~MemoryPressureMonitor();
+
+	static size_t GetWorkingSetSize();
+
+private:
+	DISALLOW_COPY_AND_ASSIGN(MemoryPressureMonitor);
+
+	static constexpr DWORD CHECK_INTERVAL_MS = 15000;
+
+	void Run();
+
+	const HWND m_hwnd;
+	const UINT m_pressureMessage;
+	const size_t m_maxWorkingSetBytes;
+	wil::unique_handle m_lowMemoryNotification;
+	wil::unique_event_nothrow m_stopEvent;
+	std::thread m_thread;
+};
\ No newline at end of file
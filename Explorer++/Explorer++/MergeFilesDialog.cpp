@@ -10,15 +10,29 @@
 #include "IconResourceLoader.h"
 #include "MainResource.h"
 #include "ResourceHelper.h"
+#include "../Helper/DriveInfo.h"
 #include "../Helper/FileOperations.h"
 #include "../Helper/Helper.h"
 #include "../Helper/ListViewHelper.h"
 #include "../Helper/Macros.h"
+#include "../Helper/Regex.h"
 #include "../Helper/ShellHelper.h"
 #include "../Helper/StringHelper.h"
+#include "../Helper/ThreadQos.h"
+#include "../Helper/UnbufferedIo.h"
 #include "../Helper/WindowHelper.h"
 #include <wil/resource.h>
-#include <regex>
+
+/* Block cloning is only available on Windows 10 and later, so
+these definitions aren't visible when targeting earlier versions. */
+#ifndef FILE_SUPPORTS_BLOCK_REFCOUNTING
+#define FILE_SUPPORTS_BLOCK_REFCOUNTING 0x08000000
+#endif
+
+#ifndef FSCTL_DUPLICATE_EXTENTS_TO_FILE
+#define FSCTL_DUPLICATE_EXTENTS_TO_FILE \
+	CTL_CODE(FILE_DEVICE_FILE_SYSTEM, 209, METHOD_BUFFERED, FILE_WRITE_ACCESS)
+#endif
 
 namespace NMergeFilesDialog
 {
@@ -27,6 +41,15 @@ namespace NMergeFilesDialog
 	const int WM_APP_MERGINGFINISHED = WM_APP + 3;
 	const int WM_APP_OUTPUTFILEINVALID = WM_APP + 4;
 
+	/* Equivalent to DUPLICATE_EXTENTS_DATA, which is also Windows 10 only. */
+	struct DuplicateExtentsData
+	{
+		HANDLE FileHandle;
+		LARGE_INTEGER SourceFileOffset;
+		LARGE_INTEGER TargetFileOffset;
+		LARGE_INTEGER ByteCount;
+	};
+
 	DWORD WINAPI MergeFilesThread(LPVOID pParam);
 }
 
@@ -65,16 +88,14 @@ bool CompareFilenames(const std::wstring &strFirst, const std::wstring &strSecon
 
 INT_PTR MergeFilesDialog::OnInitDialog()
 {
-	std::wregex rxPattern;
+	Regex rxPattern(_T(".*[\\.]?part[0-9]+"), true);
 	bool bAllMatchPattern = true;
 
-	rxPattern.assign(_T(".*[\\.]?part[0-9]+"), std::regex_constants::icase);
-
 	/* If the files all match the pattern .*[\\.]?part[0-9]+
 	(e.g. document.txt.part1), order them alphabetically. */
 	for (const auto &strFullFilename : m_FullFilenameList)
 	{
-		if (!std::regex_match(strFullFilename, rxPattern))
+		if (!rxPattern.Matches(strFullFilename))
 		{
 			bAllMatchPattern = false;
 			break;
@@ -90,9 +111,8 @@ INT_PTR MergeFilesDialog::OnInitDialog()
 		/* Since the filenames all match the
 		pattern, construct the output filename
 		from the first files name. */
-		rxPattern.assign(_T("[\\.]?part[0-9]+"), std::regex_constants::icase);
-		strOutputFilename =
-			std::regex_replace(m_FullFilenameList.front(), rxPattern, std::wstring(_T("")));
+		Regex rxPartPattern(_T("[\\.]?part[0-9]+"), true);
+		strOutputFilename = rxPartPattern.ReplaceAll(m_FullFilenameList.front(), _T(""));
 	}
 	else
 	{
@@ -387,7 +407,6 @@ void MergeFilesDialog::OnOk()
 
 		HANDLE hThread = CreateThread(nullptr, 0, NMergeFilesDialog::MergeFilesThread,
 			reinterpret_cast<LPVOID>(m_pMergeFiles), 0, nullptr);
-		SetThreadPriority(hThread, THREAD_PRIORITY_LOWEST);
 		CloseHandle(hThread);
 	}
 	else
@@ -499,6 +518,9 @@ DWORD WINAPI NMergeFilesDialog::MergeFilesThread(LPVOID pParam)
 {
 	assert(pParam != nullptr);
 
+	// Unlike a lower thread priority, this also lowers the priority of the thread's I/O.
+	SetCurrentThreadTaskClass(TaskClass::Bulk);
+
 	auto *pMergeFiles = reinterpret_cast<MergeFiles *>(pParam);
 	pMergeFiles->StartMerging();
 
@@ -524,14 +546,13 @@ MergeFiles::~MergeFiles()
 
 void MergeFiles::StartMerging()
 {
-	LARGE_INTEGER lMergeFileSize;
 	int nFilesMerged = 1;
-	bool bStop = false;
 
-	HANDLE hOutputFile = CreateFile(m_strOutputFilename.c_str(), GENERIC_WRITE, 0, nullptr,
-		CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
+	wil::unique_hfile outputFile(CreateFile(m_strOutputFilename.c_str(), GENERIC_WRITE, 0, nullptr,
+		CREATE_NEW,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_NO_BUFFERING | FILE_FLAG_OVERLAPPED, nullptr));
 
-	if (hOutputFile == INVALID_HANDLE_VALUE)
+	if (!outputFile)
 	{
 		PostMessage(m_hDlg, NMergeFilesDialog::WM_APP_OUTPUTFILEINVALID, 0, 0);
 		return;
@@ -540,53 +561,269 @@ void MergeFiles::StartMerging()
 	PostMessage(m_hDlg, NMergeFilesDialog::WM_APP_SETTOTALMERGECOUNT,
 		static_cast<WPARAM>(m_FullFilenameList.size()), 0);
 
+	/* Allocating the entire output file up front means that it
+	won't be extended (and potentially fragmented) piece by piece. */
+	ULONGLONG totalSize = 0;
+
 	for (const auto &strFullFilename : m_FullFilenameList)
 	{
-		if (bStop)
+		WIN32_FILE_ATTRIBUTE_DATA fileAttributeData;
+
+		if (GetFileAttributesEx(strFullFilename.c_str(), GetFileExInfoStandard, &fileAttributeData))
 		{
-			break;
+			ULARGE_INTEGER fileSize;
+			fileSize.LowPart = fileAttributeData.nFileSizeLow;
+			fileSize.HighPart = fileAttributeData.nFileSizeHigh;
+			totalSize += fileSize.QuadPart;
 		}
+	}
+
+	PreallocateFileSpace(outputFile.get(), totalSize);
+
+	/* A cloned range has to lie within the current size of the
+	output file. The file is truncated to the actual size of the
+	merged data once merging has finished. */
+	DWORD cloneClusterSize = GetBlockCloneClusterSize();
+
+	if (cloneClusterSize != 0 && !SetFileSize(outputFile.get(), totalSize))
+	{
+		cloneClusterSize = 0;
+	}
 
-		HANDLE hInputFile = CreateFile(strFullFilename.c_str(), GENERIC_READ, FILE_SHARE_READ,
-			nullptr, OPEN_EXISTING, 0, nullptr);
+	size_t bufferSize = GetStorageInfo(m_strOutputFilename).ioSettings.bufferSize;
+	UnbufferedFileWriter writer(outputFile.get(), bufferSize, NUM_BUFFERS);
+	auto readBuffer = AllocateUnbufferedIoBuffer(bufferSize);
 
-		if (hInputFile != INVALID_HANDLE_VALUE)
+	if (writer.IsValid() && readBuffer)
+	{
+		for (const auto &strFullFilename : m_FullFilenameList)
 		{
-			GetFileSizeEx(hInputFile, &lMergeFileSize);
+			wil::unique_hfile inputFile(CreateFile(strFullFilename.c_str(), GENERIC_READ,
+				FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+				FILE_FLAG_NO_BUFFERING | FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN,
+				nullptr));
 
-			if (lMergeFileSize.QuadPart != 0)
+			if (!inputFile)
 			{
-				auto buffer = std::make_unique<char[]>(lMergeFileSize.LowPart);
+				continue;
+			}
 
-				DWORD dwNumberOfBytesRead;
-				ReadFile(hInputFile, reinterpret_cast<LPVOID>(buffer.get()),
-					static_cast<DWORD>(lMergeFileSize.LowPart), &dwNumberOfBytesRead, nullptr);
+			LARGE_INTEGER lMergeFileSize;
+			bool bSuccess = false;
 
-				DWORD dwNumberOfBytesWritten;
-				WriteFile(hOutputFile, reinterpret_cast<LPCVOID>(buffer.get()), dwNumberOfBytesRead,
-					&dwNumberOfBytesWritten, nullptr);
+			if (GetFileSizeEx(inputFile.get(), &lMergeFileSize))
+			{
+				bSuccess = MergeFile(inputFile.get(), lMergeFileSize.QuadPart, outputFile.get(),
+					writer, cloneClusterSize, { readBuffer.get(), bufferSize });
 			}
 
-			CloseHandle(hInputFile);
-
 			PostMessage(m_hDlg, NMergeFilesDialog::WM_APP_SETCURRENTMERGECOUNT, nFilesMerged, 0);
 
 			nFilesMerged++;
 
-			EnterCriticalSection(&m_csStop);
-			if (m_bstopMerging)
+			if (!bSuccess || ShouldStopMerging())
 			{
-				bStop = true;
+				break;
 			}
-			LeaveCriticalSection(&m_csStop);
 		}
 	}
 
-	CloseHandle(hOutputFile);
+	writer.Finish();
+	outputFile.reset();
 
 	SendMessage(m_hDlg, NMergeFilesDialog::WM_APP_MERGINGFINISHED, 0, 0);
 }
 
+/* Returns the cluster size of the output volume if it supports
+block cloning (i.e. it's a ReFS volume) and 0 otherwise. When a
+file is cloned, the output file simply references the clusters
+that make up the input file, rather than containing a copy of
+the data. */
+DWORD MergeFiles::GetBlockCloneClusterSize()
+{
+	TCHAR volumePath[MAX_PATH];
+
+	if (!GetVolumePathName(m_strOutputFilename.c_str(), volumePath, SIZEOF_ARRAY(volumePath)))
+	{
+		return 0;
+	}
+
+	DWORD fileSystemFlags;
+
+	if (!GetVolumeInformation(volumePath, nullptr, 0, nullptr, nullptr, &fileSystemFlags, nullptr,
+			0)
+		|| !(fileSystemFlags & FILE_SUPPORTS_BLOCK_REFCOUNTING))
+	{
+		return 0;
+	}
+
+	DWORD sectorsPerCluster;
+	DWORD bytesPerSector;
+	DWORD numberOfFreeClusters;
+	DWORD totalNumberOfClusters;
+
+	if (!GetDiskFreeSpace(volumePath, &sectorsPerCluster, &bytesPerSector, &numberOfFreeClusters,
+			&totalNumberOfClusters))
+	{
+		return 0;
+	}
+
+	DWORD clusterSize = sectorsPerCluster * bytesPerSector;
+
+	if (clusterSize % UNBUFFERED_IO_ALIGNMENT != 0)
+	{
+		return 0;
+	}
+
+	return clusterSize;
+}
+
+/* Appends the contents of the input file to the output. Returns
+false if merging should stop, either because an error occurred,
+or because the user cancelled the operation. */
+bool MergeFiles::MergeFile(HANDLE hInputFile, ULONGLONG fileSize, HANDLE hOutputFile,
+	UnbufferedFileWriter &writer, DWORD cloneClusterSize, std::span<std::byte> readBuffer)
+{
+	ULONGLONG offset = 0;
+
+	/* Cloning can only be used when both the source and destination
+	ranges start on a cluster boundary. Any partial cluster at the end
+	of the input file is copied. */
+	if (cloneClusterSize != 0 && writer.GetPosition() % cloneClusterSize == 0)
+	{
+		ULONGLONG cloneSize = AlignDown(fileSize, cloneClusterSize);
+
+		if (cloneSize > 0)
+		{
+			if (!writer.FlushAndSkip(0))
+			{
+				return false;
+			}
+
+			offset = CloneFileRange(hInputFile, cloneSize, hOutputFile, writer.GetPosition());
+
+			if (!writer.FlushAndSkip(offset))
+			{
+				return false;
+			}
+		}
+	}
+
+	while (offset < fileSize)
+	{
+		if (ShouldStopMerging())
+		{
+			return false;
+		}
+
+		/* If the output position is suitably aligned, the data can be
+		read directly into the output buffer. Otherwise, it has to be
+		read into a separate buffer and copied. */
+		bool directRead = (writer.GetPosition() % UNBUFFERED_IO_ALIGNMENT == 0);
+
+		std::byte *buffer;
+		DWORD readSize;
+
+		if (directRead)
+		{
+			auto space = writer.GetWritableSpace();
+			buffer = space.data();
+			readSize = static_cast<DWORD>(space.size());
+		}
+		else
+		{
+			buffer = readBuffer.data();
+			readSize = static_cast<DWORD>(readBuffer.size());
+		}
+
+		OverlappedOperation readOperation;
+
+		if (!readOperation.StartRead(hInputFile, buffer, readSize, offset))
+		{
+			return false;
+		}
+
+		auto numBytesRead = readOperation.Wait();
+
+		if (!numBytesRead)
+		{
+			return false;
+		}
+
+		if (*numBytesRead == 0)
+		{
+			/* The file has shrunk since its size was retrieved. */
+			break;
+		}
+
+		bool bSuccess;
+
+		if (directRead)
+		{
+			bSuccess = writer.Commit(*numBytesRead);
+		}
+		else
+		{
+			bSuccess = writer.Write({ readBuffer.data(), *numBytesRead });
+		}
+
+		if (!bSuccess)
+		{
+			return false;
+		}
+
+		offset += *numBytesRead;
+	}
+
+	return true;
+}
+
+/* Clones the specified number of bytes from the start of the input
+file. Returns the number of bytes successfully cloned. */
+ULONGLONG MergeFiles::CloneFileRange(HANDLE hInputFile, ULONGLONG size, HANDLE hOutputFile,
+	ULONGLONG outputOffset)
+{
+	ULONGLONG offset = 0;
+
+	while (offset < size)
+	{
+		if (ShouldStopMerging())
+		{
+			break;
+		}
+
+		ULONGLONG chunkSize = (std::min)(size - offset, MAX_CLONE_SIZE);
+
+		NMergeFilesDialog::DuplicateExtentsData duplicateExtentsData;
+		duplicateExtentsData.FileHandle = hInputFile;
+		duplicateExtentsData.SourceFileOffset.QuadPart = offset;
+		duplicateExtentsData.TargetFileOffset.QuadPart = outputOffset + offset;
+		duplicateExtentsData.ByteCount.QuadPart = chunkSize;
+
+		OverlappedOperation operation;
+
+		if (!operation.StartControl(hOutputFile, FSCTL_DUPLICATE_EXTENTS_TO_FILE,
+				&duplicateExtentsData, sizeof(duplicateExtentsData))
+			|| !operation.Wait())
+		{
+			break;
+		}
+
+		offset += chunkSize;
+	}
+
+	return offset;
+}
+
+bool MergeFiles::ShouldStopMerging()
+{
+	EnterCriticalSection(&m_csStop);
+	bool bStop = m_bstopMerging;
+	LeaveCriticalSection(&m_csStop);
+
+	return bStop;
+}
+
 void MergeFiles::StopMerging()
 {
 	EnterCriticalSection(&m_csStop);
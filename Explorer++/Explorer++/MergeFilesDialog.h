@@ -8,9 +8,11 @@
 #include "../Helper/DialogSettings.h"
 #include "../Helper/ReferenceCount.h"
 #include "../Helper/ResizableDialog.h"
+#include <span>
 
 __interface IExplorerplusplus;
 class MergeFilesDialog;
+class UnbufferedFileWriter;
 
 class MergeFilesDialogPersistentSettings : public DialogSettings
 {
@@ -39,6 +41,22 @@ public:
 	void StopMerging();
 
 private:
+	// Data is streamed through a set of buffers, with the input and output files opened for
+	// unbuffered I/O, so that merging large files doesn't flush the system file cache. The buffers
+	// are sized according to the device the output file is on (see GetStorageInfo).
+	static constexpr int NUM_BUFFERS = 2;
+
+	// The maximum amount of data cloned by a single request.
+	static constexpr ULONGLONG MAX_CLONE_SIZE = 1024 * 1024 * 1024;
+
+	DWORD GetBlockCloneClusterSize();
+	bool MergeFile(HANDLE hInputFile, ULONGLONG fileSize, HANDLE hOutputFile,
+		UnbufferedFileWriter &writer, DWORD cloneClusterSize,
+		std::span<std::byte> readBuffer);
+	ULONGLONG CloneFileRange(HANDLE hInputFile, ULONGLONG size, HANDLE hOutputFile,
+		ULONGLONG outputOffset);
+	bool ShouldStopMerging();
+
 	HWND m_hDlg;
 
 	std::wstring m_strOutputFilename;
@@ -7,18 +7,23 @@
 #include "Config.h"
 #include "DisplayWindow/DisplayWindow.h"
 #include "Explorer++_internal.h"
+#include "FileProgressSink.h"
 #include "HardwareChangeNotifier.h"
 #include "MainResource.h"
+#include "ResourceHelper.h"
 #include "SelectColumnsDialog.h"
 #include "ShellBrowser/ShellBrowser.h"
-#include "ShellTreeView/ShellTreeView.h"
 #include "TabContainer.h"
 #include "../Helper/Controls.h"
+#include "../Helper/DragDropHelper.h"
+#include "../Helper/FileOperationQueue.h"
 #include "../Helper/FileOperations.h"
 #include "../Helper/Logging.h"
 #include "../Helper/Macros.h"
 #include "../Helper/WindowHelper.h"
-#include <boost/range/adaptor/map.hpp>
+#include "../Helper/iDirectoryMonitor.h"
+#include <boost/format.hpp>
+#include <comdef.h>
 
 void Explorerplusplus::ValidateLoadedSettings()
 {
@@ -274,35 +279,210 @@ void Explorerplusplus::CopyToFolder(bool move)
 
 	TCHAR szTemp[128];
 	LoadString(m_hLanguageModule, IDS_GENERAL_COPY_TO_FOLDER_TITLE, szTemp, SIZEOF_ARRAY(szTemp));
-	NFileOperations::CopyFilesToFolder(m_hContainer, szTemp, pidls, move);
+
+	if (m_config->useNativeFileTransfers)
+	{
+		QueueCopyToFolder(szTemp, pidls, move);
+		return;
+	}
+
+	FileProgressSink *sink = FileProgressSink::CreateNew();
+	NFileOperations::CopyFilesToFolder(m_hContainer, szTemp, pidls, move, false, sink);
+	sink->Release();
 }
 
-LRESULT Explorerplusplus::OnDeviceChange(WPARAM wParam, LPARAM lParam)
+// Transfers the items in the background, provided they (and the destination) are all in the
+// filesystem. Otherwise, the transfer is performed by the shell straight away.
+void Explorerplusplus::QueueCopyToFolder(
+	const std::wstring &title, std::vector<PCIDLIST_ABSOLUTE> &pidls, bool move)
 {
-	/* Forward this notification out to all tabs (if a
-	tab is currently in my computer, it will need to
-	update its contents). */
-	for (auto &tab : m_tabContainer->GetAllTabs() | boost::adaptors::map_values)
+	unique_pidl_absolute destinationPidl;
+	BOOL res = NFileOperations::CreateBrowseDialog(
+		m_hContainer, title, wil::out_param(destinationPidl));
+
+	if (!res)
 	{
-		tab->GetShellBrowser()->OnDeviceChange(wParam, lParam);
+		return;
 	}
 
-	/* Forward the message to the treeview, so that
-	it can handle the message as well. */
-	SendMessage(m_shellTreeView->GetHWND(), WM_DEVICECHANGE, wParam, lParam);
+	bool allInFileSystem = true;
+	TCHAR destinationFolder[MAX_PATH];
 
-	switch (wParam)
+	if (!SHGetPathFromIDList(destinationPidl.get(), destinationFolder))
 	{
-	case DBT_DEVICEARRIVAL:
-		HardwareChangeNotifier::GetInstance().NotifyDeviceArrival(
-			reinterpret_cast<DEV_BROADCAST_HDR *>(lParam));
-		break;
+		allInFileSystem = false;
+	}
 
-	case DBT_DEVICEREMOVECOMPLETE:
-		HardwareChangeNotifier::GetInstance().NotifyDeviceRemovalComplete(
-			reinterpret_cast<DEV_BROADCAST_HDR *>(lParam));
-		break;
+	std::vector<std::wstring> sourcePaths;
+
+	for (auto pidl : pidls)
+	{
+		TCHAR sourcePath[MAX_PATH];
+
+		if (!allInFileSystem || !SHGetPathFromIDList(pidl, sourcePath))
+		{
+			allInFileSystem = false;
+			break;
+		}
+
+		sourcePaths.emplace_back(sourcePath);
+	}
+
+	if (allInFileSystem)
+	{
+		m_fileOperationQueue->AddJob(sourcePaths, destinationFolder, move);
+		return;
+	}
+
+	wil::com_ptr_nothrow<IShellItem> destinationItem;
+	HRESULT hr = SHCreateItemFromIDList(destinationPidl.get(), IID_PPV_ARGS(&destinationItem));
+
+	if (FAILED(hr))
+	{
+		return;
+	}
+
+	FileProgressSink *sink = FileProgressSink::CreateNew();
+	NFileOperations::CopyFiles(m_hContainer, destinationItem.get(), pidls, move, false, sink);
+	sink->Release();
+}
+
+// If the items on the clipboard were cut or copied from a tab (or the treeview) in this process,
+// they're added directly to the queue, without their paths being extracted from the clipboard.
+// Returns true if the items were queued.
+bool Explorerplusplus::QueueInternalPaste(PCIDLIST_ABSOLUTE destination)
+{
+	if (!m_config->useNativeFileTransfers || !m_fileOperationQueue)
+	{
+		return false;
+	}
+
+	IDataObject *clipboardDataObject = GetInternalClipboardDataObject();
+
+	if (!clipboardDataObject)
+	{
+		return false;
+	}
+
+	auto transfer = GetInternalTransfer(clipboardDataObject, destination);
+
+	if (!transfer)
+	{
+		return false;
+	}
+
+	DWORD effect;
+	HRESULT hr = GetPreferredDropEffect(clipboardDataObject, effect);
+
+	if (FAILED(hr))
+	{
+		return false;
+	}
+
+	bool move = WI_IsFlagSet(effect, DROPEFFECT_MOVE);
+
+	m_fileOperationQueue->AddJob(transfer->sourcePaths, transfer->destinationFolder, move);
+
+	// As with a paste performed by the shell, cut items can only be pasted once.
+	if (move)
+	{
+		OleSetClipboard(nullptr);
+	}
+
+	return true;
+}
+
+void Explorerplusplus::CreateFileOperationQueue()
+{
+	m_fileOperationQueue = std::make_unique<FileOperationQueue>(
+		GetCacheFilePath(NExplorerplusplus::FILE_OPERATION_QUEUE_FILENAME),
+		[hwnd = m_hContainer] { PostMessage(hwnd, WM_APP_FILEOPERATIONQUEUEUPDATED, 0, 0); });
+	m_fileOperationQueue->SetBytesPerSecondLimit(
+		static_cast<ULONGLONG>(m_config->fileTransferBandwidthLimit) * 1024);
+
+	// Any transfers that were still pending when the application last exited are picked up from
+	// where they left off.
+	size_t numJobsRestored = m_fileOperationQueue->RestorePendingJobs();
+
+	if (numJobsRestored > 0)
+	{
+		LOG(info) << L"Restored " << numJobsRestored << L" pending file transfers";
 	}
+}
+
+void Explorerplusplus::OnFileOperationQueueUpdated()
+{
+	UpdateStatusBarFileTransferText();
+
+	for (const auto &finishedJob : m_fileOperationQueue->TakeFinishedJobs())
+	{
+		const auto &job = finishedJob.job;
+
+		if (finishedJob.result == HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED))
+		{
+			// Nothing will have been transferred, so the whole operation can be handed over to the
+			// shell (which will, for example, prompt the user about any naming conflicts).
+			TransferFilesUsingShell(job.sourcePaths, job.destinationFolder, job.move);
+		}
+		else if (FAILED(finishedJob.result)
+			&& finishedJob.result != HRESULT_FROM_WIN32(ERROR_CANCELLED))
+		{
+			_com_error error(finishedJob.result);
+			std::wstring message = (boost::wformat(ResourceHelper::LoadString(
+										m_hLanguageModule, IDS_FILE_TRANSFER_ERROR))
+				% job.destinationFolder % error.ErrorMessage())
+									   .str();
+			MessageBox(
+				m_hContainer, message.c_str(), NExplorerplusplus::APP_NAME, MB_ICONWARNING | MB_OK);
+		}
+	}
+}
+
+void Explorerplusplus::TransferFilesUsingShell(const std::vector<std::wstring> &sourcePaths,
+	const std::wstring &destinationFolder, bool move)
+{
+	wil::com_ptr_nothrow<IShellItem> destinationItem;
+	HRESULT hr = SHCreateItemFromParsingName(
+		destinationFolder.c_str(), nullptr, IID_PPV_ARGS(&destinationItem));
+
+	if (FAILED(hr))
+	{
+		return;
+	}
+
+	std::vector<unique_pidl_absolute> pidlPtrs;
+	std::vector<PCIDLIST_ABSOLUTE> pidls;
+
+	for (const auto &sourcePath : sourcePaths)
+	{
+		unique_pidl_absolute pidl;
+		hr = SHParseDisplayName(sourcePath.c_str(), nullptr, wil::out_param(pidl), 0, nullptr);
+
+		// Items that no longer exist are skipped.
+		if (FAILED(hr))
+		{
+			continue;
+		}
+
+		pidls.push_back(pidl.get());
+		pidlPtrs.push_back(std::move(pidl));
+	}
+
+	if (pidls.empty())
+	{
+		return;
+	}
+
+	FileProgressSink *sink = FileProgressSink::CreateNew();
+	NFileOperations::CopyFiles(m_hContainer, destinationItem.get(), pidls, move, false, sink);
+	sink->Release();
+}
+
+LRESULT Explorerplusplus::OnDeviceChange(WPARAM wParam, LPARAM lParam)
+{
+	// The drive information is queried once here and then passed to each of the observers (the
+	// tabs, treeview, drives toolbar and status bar).
+	HardwareChangeNotifier::GetInstance().OnDeviceChange(wParam, lParam);
 
 	return TRUE;
 }
@@ -323,7 +503,7 @@ Possible bugs:
    check will fail, and the shell browser function won't be called.
 */
 void Explorerplusplus::DirectoryAlteredCallback(
-	const TCHAR *szFileName, DWORD dwAction, void *pData)
+	const std::vector<DirectoryChange> &changes, bool overflowed, void *pData)
 {
 	DirectoryAltered *pDirectoryAltered = nullptr;
 	Explorerplusplus *pContainer = nullptr;
@@ -337,43 +517,14 @@ void Explorerplusplus::DirectoryAlteredCallback(
 	{
 		std::wstring directory = tab->GetShellBrowser()->GetDirectory();
 		LOG(debug) << _T("Directory change notification received for \"") << directory
-				   << _T("\", Action = ") << dwAction << _T(", Filename = \"") << szFileName
-				   << _T("\"");
+				   << _T("\", Changes = ") << changes.size() << _T(", Overflowed = ")
+				   << overflowed;
 
-		tab->GetShellBrowser()->FilesModified(
-			dwAction, szFileName, pDirectoryAltered->iIndex, pDirectoryAltered->iFolderIndex);
+		tab->GetShellBrowser()->FilesModified(changes, overflowed, pDirectoryAltered->iIndex,
+			pDirectoryAltered->iFolderIndex);
 	}
 }
 
-void Explorerplusplus::FolderSizeCallbackStub(
-	int nFolders, int nFiles, PULARGE_INTEGER lTotalFolderSize, LPVOID pData)
-{
-	auto *pfsei = reinterpret_cast<Explorerplusplus::FolderSizeExtraInfo *>(pData);
-	reinterpret_cast<Explorerplusplus *>(pfsei->pContainer)
-		->FolderSizeCallback(pfsei, nFolders, nFiles, lTotalFolderSize);
-	free(pfsei);
-}
-
-void Explorerplusplus::FolderSizeCallback(
-	FolderSizeExtraInfo *pfsei, int nFolders, int nFiles, PULARGE_INTEGER lTotalFolderSize)
-{
-	UNREFERENCED_PARAMETER(nFolders);
-	UNREFERENCED_PARAMETER(nFiles);
-
-	DWFolderSizeCompletion *pDWFolderSizeCompletion = nullptr;
-
-	pDWFolderSizeCompletion = (DWFolderSizeCompletion *) malloc(sizeof(DWFolderSizeCompletion));
-
-	pDWFolderSizeCompletion->liFolderSize = *lTotalFolderSize;
-	pDWFolderSizeCompletion->uId = pfsei->uId;
-
-	/* Queue the result back to the main thread, so that
-	the folder size can be displayed. It is up to the main
-	thread to determine whether the folder size should actually
-	be shown. */
-	PostMessage(m_hContainer, WM_APP_FOLDERSIZECOMPLETED, (WPARAM) pDWFolderSizeCompletion, 0);
-}
-
 void Explorerplusplus::OnSelectColumns()
 {
 	SelectColumnsDialog selectColumnsDialog(m_hLanguageModule, m_hContainer,
@@ -8,4 +8,7 @@
 extern HWND g_hwndSearch;
 extern HWND g_hwndRunScript;
 extern HWND g_hwndOptions;
-extern HWND g_hwndManageBookmarks;
\ No newline at end of file
+extern HWND g_hwndManageBookmarks;
+extern HWND g_hwndDiagnostics;
+extern HWND g_hwndDuplicateFiles;
+extern HWND g_hwndDiskUsage;
\ No newline at end of file
@@ -5,31 +5,47 @@
 #include "stdafx.h"
 #include "Explorer++.h"
 #include "AddressBar.h"
+#include "Bookmarks/BookmarkJournal.h"
 #include "ColorRuleHelper.h"
+#include "CommandLine.h"
 #include "Config.h"
 #include "DarkModeHelper.h"
 #include "Explorer++_internal.h"
+#include "HangWatchdog.h"
 #include "LoadSaveRegistry.h"
 #include "LoadSaveXml.h"
 #include "MainResource.h"
 #include "MainToolbar.h"
+#include "MemoryPressureMonitor.h"
 #include "Navigation.h"
 #include "Plugins/PluginManager.h"
+#include "QuickFilterBar.h"
 #include "ResourceHelper.h"
+#include "SettingsCache.h"
 #include "ShellBrowser/ShellBrowser.h"
 #include "ShellBrowser/ShellNavigationController.h"
 #include "ShellBrowser/ViewModes.h"
 #include "ShellTreeView/ShellTreeView.h"
 #include "TabContainer.h"
+#include "TabRestorer.h"
+#include "TabSessionJournal.h"
 #include "ToolbarButtons.h"
 #include "ViewModeHelper.h"
 #include "../Helper/BulkClipboardWriter.h"
 #include "../Helper/Controls.h"
 #include "../Helper/DpiCompatibility.h"
+#include "../Helper/FileOperationQueue.h"
 #include "../Helper/FileOperations.h"
+#include "../Helper/FolderSizeCache.h"
+#include "../Helper/IconLocationCache.h"
 #include "../Helper/Logging.h"
+#include "../Helper/MemoryBudget.h"
 #include "../Helper/Macros.h"
 #include "../Helper/MenuHelper.h"
+#include "../Helper/NamedPipeServer.h"
+#include "../Helper/NetworkLocationPolicy.h"
+#include "../Helper/ParsedPathCache.h"
+#include "../Helper/PerformanceTrace.h"
 #include "../Helper/ProcessHelper.h"
 #include "../Helper/RegistrySettings.h"
 #include "../Helper/ShellHelper.h"
@@ -50,6 +66,28 @@ static const int TREEVIEW_HOLDER_CLEARANCE = 4;
 const int CLOSE_TOOLBAR_X_OFFSET = 4;
 const int CLOSE_TOOLBAR_Y_OFFSET = 1;
 
+namespace
+{
+	struct SettingsSection
+	{
+		const TCHAR *name;
+		void (ILoadSave::*save)();
+	};
+}
+
+/* The order here determines the order in which the
+sections appear within the config file. */
+static const SettingsSection SETTINGS_SECTIONS[] = {
+	{ _T("GenericSettings"), &ILoadSave::SaveGenericSettings },
+	{ _T("Tabs"), &ILoadSave::SaveTabs },
+	{ _T("DefaultColumns"), &ILoadSave::SaveDefaultColumns },
+	{ _T("Bookmarks"), &ILoadSave::SaveBookmarks },
+	{ _T("ApplicationToolbar"), &ILoadSave::SaveApplicationToolbar },
+	{ _T("ToolbarInformation"), &ILoadSave::SaveToolbarInformation },
+	{ _T("ColorRules"), &ILoadSave::SaveColorRules },
+	{ _T("DialogStates"), &ILoadSave::SaveDialogStates }
+};
+
 void Explorerplusplus::TestConfigFile()
 {
 	m_bLoadSettingsFromXML = TestConfigFileInternal();
@@ -82,6 +120,115 @@ BOOL TestConfigFileInternal()
 	return bLoadSettingsFromXML;
 }
 
+void Explorerplusplus::LoadFolderSizes()
+{
+	if (!m_config->persistFolderSizes)
+	{
+		return;
+	}
+
+	FolderSizeCache::GetInstance().LoadFromFile(
+		GetCacheFilePath(NExplorerplusplus::FOLDER_SIZE_CACHE_FILENAME));
+}
+
+void Explorerplusplus::SaveFolderSizes()
+{
+	if (!m_config->persistFolderSizes)
+	{
+		return;
+	}
+
+	FolderSizeCache::GetInstance().SaveToFile(
+		GetCacheFilePath(NExplorerplusplus::FOLDER_SIZE_CACHE_FILENAME));
+}
+
+void Explorerplusplus::LoadNetworkLocations()
+{
+	NetworkLocationPolicy::GetInstance().LoadFromFile(
+		GetCacheFilePath(NExplorerplusplus::NETWORK_LOCATIONS_FILENAME));
+}
+
+void Explorerplusplus::SaveNetworkLocations()
+{
+	NetworkLocationPolicy::GetInstance().SaveToFile(
+		GetCacheFilePath(NExplorerplusplus::NETWORK_LOCATIONS_FILENAME));
+}
+
+// This needs to be called before any icons are requested, so that the items shown initially (e.g.
+// those in the restored tabs) can use the saved icons.
+void Explorerplusplus::LoadIconCache()
+{
+	if (!m_config->persistIconCache)
+	{
+		return;
+	}
+
+	auto &iconLocationCache = GetIconLocationCache();
+	iconLocationCache.SetEnabled(true);
+
+	if (iconLocationCache.LoadFromFile(GetCacheFilePath(NExplorerplusplus::ICON_CACHE_FILENAME)))
+	{
+		iconLocationCache.PrimeCachedIcons(m_cachedIcons);
+	}
+}
+
+void Explorerplusplus::SaveIconCache()
+{
+	if (!m_config->persistIconCache)
+	{
+		return;
+	}
+
+	GetIconLocationCache().SaveToFile(GetCacheFilePath(NExplorerplusplus::ICON_CACHE_FILENAME));
+}
+
+void Explorerplusplus::LoadClosedTabs()
+{
+	if (!m_config->persistClosedTabs)
+	{
+		return;
+	}
+
+	m_tabRestorer->LoadFromFile(GetCacheFilePath(NExplorerplusplus::CLOSED_TABS_FILENAME));
+}
+
+void Explorerplusplus::SaveClosedTabs()
+{
+	if (!m_config->persistClosedTabs)
+	{
+		return;
+	}
+
+	m_tabRestorer->SaveToFile(GetCacheFilePath(NExplorerplusplus::CLOSED_TABS_FILENAME));
+}
+
+// Any changes to the bookmarks that were made after they were last saved (e.g. because the
+// application exited unexpectedly) are recovered from the journal.
+void Explorerplusplus::LoadBookmarkJournal()
+{
+	m_bookmarkJournal = std::make_unique<BookmarkJournal>(
+		&m_bookmarkTree, GetCacheFilePath(NExplorerplusplus::BOOKMARK_JOURNAL_FILENAME));
+
+	size_t numRecordsApplied = m_bookmarkJournal->Replay();
+
+	if (numRecordsApplied > 0)
+	{
+		LOG(info) << L"Replayed " << numRecordsApplied << L" bookmark journal records";
+	}
+}
+
+// Cache files are saved alongside the executable, in the same way as the XML config file.
+std::wstring Explorerplusplus::GetCacheFilePath(const TCHAR *fileName)
+{
+	TCHAR cacheFilePath[MAX_PATH];
+	GetProcessImageName(GetCurrentProcessId(), cacheFilePath, SIZEOF_ARRAY(cacheFilePath));
+
+	PathRemoveFileSpec(cacheFilePath);
+	PathAppend(cacheFilePath, fileName);
+
+	return cacheFilePath;
+}
+
 void Explorerplusplus::LoadAllSettings(ILoadSave **pLoadSave)
 {
 	/* Tests for the existence of the configuration
@@ -121,7 +268,7 @@ void Explorerplusplus::LoadAllSettings(ILoadSave **pLoadSave)
 void Explorerplusplus::OpenItem(const TCHAR *itemPath, OpenFolderDisposition openFolderDisposition)
 {
 	unique_pidl_absolute pidlItem;
-	HRESULT hr = SHParseDisplayName(itemPath, nullptr, wil::out_param(pidlItem), 0, nullptr);
+	HRESULT hr = ParsedPathCache::GetInstance().ParsePath(itemPath, wil::out_param(pidlItem));
 
 	if (SUCCEEDED(hr))
 	{
@@ -493,6 +640,18 @@ BOOL Explorerplusplus::OnSize(int MainWindowWidth, int MainWindowHeight)
 			m_config->displayWindowHeight, SWP_SHOWWINDOW | SWP_NOZORDER);
 	}
 
+	/* <---- Quick filter bar ----> */
+
+	if (m_quickFilterBar->IsShown())
+	{
+		int quickFilterBarHeight = m_quickFilterBar->GetHeight();
+
+		SetWindowPos(m_quickFilterBar->GetHWND(), nullptr, indentLeft, indentTop,
+			MainWindowWidth - indentLeft - indentRight, quickFilterBarHeight, SWP_NOZORDER);
+
+		indentTop += quickFilterBarHeight;
+	}
+
 	/* <---- ALL listview windows ----> */
 
 	for (auto &tab : m_tabContainer->GetAllTabs() | boost::adaptors::map_values)
@@ -595,6 +754,11 @@ int Explorerplusplus::CloseApplication()
 			return 1;
 	}
 
+	m_hangWatchdog.reset();
+
+	m_memoryPressureMonitor.reset();
+	MemoryBudget::GetInstance().RemoveConsumer(m_cachedIconsMemoryConsumerId);
+
 	// It's important that the plugins are destroyed before the main
 	// window is destroyed and before this class is destroyed.
 	// The first because the API binding classes may interact with the
@@ -608,7 +772,19 @@ int Explorerplusplus::CloseApplication()
 
 	KillTimer(m_hContainer, AUTOSAVE_TIMER_ID);
 
-	SaveAllSettings();
+	SaveAllSettingsAndWait();
+
+	StopDisplayWindowFolderSizes();
+	CancelDisplayWindowDetails();
+	CancelStatusBarFreeSpace();
+	SaveFolderSizes();
+	SaveNetworkLocations();
+	SaveIconCache();
+	SaveClosedTabs();
+
+	// Any transfers that are still running are stopped. They remain queued on disk, so will be
+	// resumed the next time the application starts.
+	m_fileOperationQueue.reset();
 
 	DestroyWindow(m_hContainer);
 
@@ -648,14 +824,17 @@ void Explorerplusplus::HandleDirectoryMonitoring(int iTabId)
 		pDirectoryAltered->iFolderIndex = tab.GetShellBrowser()->GetUniqueFolderId();
 		pDirectoryAltered->pData = this;
 
-		/* Start monitoring the directory that was opened. */
+		/* Start monitoring the directory that was opened. In flat
+		view, every file below the directory is shown, so the whole
+		subtree is watched. */
 		LOG(debug) << _T("Starting directory monitoring for \"") << directoryToWatch << _T("\"");
 		iDirMonitorId = m_pDirMon->WatchDirectory(directoryToWatch.c_str(),
 			FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_DIR_NAME
 				| FILE_NOTIFY_CHANGE_ATTRIBUTES | FILE_NOTIFY_CHANGE_LAST_WRITE
 				| FILE_NOTIFY_CHANGE_LAST_ACCESS | FILE_NOTIFY_CHANGE_CREATION
 				| FILE_NOTIFY_CHANGE_SECURITY,
-			DirectoryAlteredCallback, FALSE, (void *) pDirectoryAltered);
+			DirectoryAlteredCallback, tab.GetShellBrowser()->GetFlatView(),
+			(void *) pDirectoryAltered);
 	}
 
 	tab.GetShellBrowser()->SetDirMonitorId(iDirMonitorId);
@@ -683,15 +862,7 @@ void Explorerplusplus::OnDisplayWindowResized(WPARAM wParam)
  */
 void Explorerplusplus::OnAutoSizeColumns()
 {
-	size_t nColumns;
-	UINT iCol = 0;
-
-	nColumns = m_pActiveShellBrowser->GetNumActiveColumns();
-
-	for (iCol = 0; iCol < nColumns; iCol++)
-	{
-		ListView_SetColumnWidth(m_hActiveListView, iCol, LVSCW_AUTOSIZE);
-	}
+	m_pActiveShellBrowser->AutoSizeColumns();
 }
 
 /* Cycle through the current views. */
@@ -907,7 +1078,7 @@ void Explorerplusplus::OnAppCommand(UINT cmd)
 void Explorerplusplus::OnRefresh()
 {
 	Tab &tab = m_tabContainer->GetSelectedTab();
-	tab.GetShellBrowser()->GetNavigationController()->Refresh();
+	tab.GetShellBrowser()->RefreshFolderContents();
 }
 
 void Explorerplusplus::CopyColumnInfoToClipboard()
@@ -1221,6 +1392,47 @@ void Explorerplusplus::OnDisplayWindowRClick(POINT *ptClient)
 		m_hContainer, nullptr);
 }
 
+void Explorerplusplus::UpdateColorRuleMatchers()
+{
+	m_colorRuleMatchers.clear();
+
+	for (const auto &colorRule : m_ColorRules)
+	{
+		m_colorRuleMatchers.emplace_back(colorRule.strFilterPattern, !colorRule.caseInsensitive);
+	}
+
+	m_colorRuleGeneration++;
+}
+
+std::optional<size_t> Explorerplusplus::FindMatchingColorRule(
+	const std::wstring &fullFileName, DWORD attributes) const
+{
+	assert(m_colorRuleMatchers.size() == m_ColorRules.size());
+
+	const TCHAR *fileName = PathFindFileName(fullFileName.c_str());
+
+	/* Decide whether to change the font of the item based on its
+	filename and/or attributes. The first matching rule is used. */
+	for (size_t i = 0; i < m_ColorRules.size(); i++)
+	{
+		const auto &colorRule = m_ColorRules[i];
+
+		/* Only match against the filename if it's not empty. */
+		bool matchFileName =
+			colorRule.strFilterPattern.empty() || m_colorRuleMatchers[i].Matches(fileName);
+
+		bool matchAttributes = colorRule.dwFilterAttributes == 0
+			|| WI_IsAnyFlagSet(colorRule.dwFilterAttributes, attributes);
+
+		if (matchFileName && matchAttributes)
+		{
+			return i;
+		}
+	}
+
+	return std::nullopt;
+}
+
 LRESULT Explorerplusplus::OnCustomDraw(LPARAM lParam)
 {
 	NMLVCUSTOMDRAW *pnmlvcd = nullptr;
@@ -1239,56 +1451,20 @@ LRESULT Explorerplusplus::OnCustomDraw(LPARAM lParam)
 
 		case CDDS_ITEMPREPAINT:
 		{
-			DWORD dwAttributes =
-				m_pActiveShellBrowser->GetItemFileFindData(static_cast<int>(pnmcd->dwItemSpec))
-					.dwFileAttributes;
-
-			std::wstring fullFileName =
-				m_pActiveShellBrowser->GetItemFullName(static_cast<int>(pnmcd->dwItemSpec));
-
-			TCHAR fileName[MAX_PATH];
-			StringCchCopy(fileName, SIZEOF_ARRAY(fileName), fullFileName.c_str());
-			PathStripPath(fileName);
-
-			/* Loop through each filter. Decide whether to change the font of the
-			current item based on its filename and/or attributes. */
-			for (const auto &colorRule : m_ColorRules)
+			/* The matching rule is cached on the item, so the rules
+			only need to be evaluated the first time the item is drawn
+			after it was added, renamed or modified, or after the rules
+			themselves change. */
+			auto colorRuleIndex = m_pActiveShellBrowser->GetItemColorRule(
+				static_cast<int>(pnmcd->dwItemSpec), m_colorRuleGeneration,
+				[this](const std::wstring &fullFileName, DWORD attributes) {
+					return FindMatchingColorRule(fullFileName, attributes);
+				});
+
+			if (colorRuleIndex)
 			{
-				BOOL bMatchFileName = FALSE;
-				BOOL bMatchAttributes = FALSE;
-
-				/* Only match against the filename if it's not empty. */
-				if (!colorRule.strFilterPattern.empty())
-				{
-					if (CheckWildcardMatch(colorRule.strFilterPattern.c_str(), fileName,
-							!colorRule.caseInsensitive)
-						== 1)
-					{
-						bMatchFileName = TRUE;
-					}
-				}
-				else
-				{
-					bMatchFileName = TRUE;
-				}
-
-				if (colorRule.dwFilterAttributes != 0)
-				{
-					if (colorRule.dwFilterAttributes & dwAttributes)
-					{
-						bMatchAttributes = TRUE;
-					}
-				}
-				else
-				{
-					bMatchAttributes = TRUE;
-				}
-
-				if (bMatchFileName && bMatchAttributes)
-				{
-					pnmlvcd->clrText = colorRule.rgbColour;
-					return CDRF_NEWFONT;
-				}
+				pnmlvcd->clrText = m_ColorRules[*colorRuleIndex].rgbColour;
+				return CDRF_NEWFONT;
 			}
 		}
 		break;
@@ -1341,25 +1517,244 @@ void Explorerplusplus::OnGroupBy(SortMode sortMode)
 
 void Explorerplusplus::SaveAllSettings()
 {
+	SaveSettings(false);
+}
+
+/* Used on exit. Everything is saved, regardless of whether
+it's changed, and the config file is written out before
+this method returns. */
+void Explorerplusplus::SaveAllSettingsAndWait()
+{
+	m_settingsWriter.CancelTasks(this, true);
+	m_settingsChangeTracker.Reset();
+
+	SaveSettings(true);
+}
+
+/* The XML for each section is used as a snapshot of the
+settings. The snapshot is taken here, on the UI thread, and
+only the sections that have changed since they were last
+saved are written out. When saving to the config file, the
+file is written on a background thread (unless
+waitForCompletion is set). Saving to the registry is done
+directly, since the registry saving functions read the
+current state of the application.
+Once the bookmarks have been saved, the records in the
+bookmark journal up to that point are no longer needed, so
+the journal is compacted. The same applies to the tab session
+journal, though the tabs themselves are only saved in full
+when necessary (see ShouldSaveTabsInFull()). */
+void Explorerplusplus::SaveSettings(bool waitForCompletion)
+{
+	PerformanceTraceActivity traceActivity(L"SaveSettings");
+
 	m_iLastSelectedTab = m_tabContainer->GetSelectedTabIndex();
 
-	ILoadSave *pLoadSave = nullptr;
+	LoadSaveXML xmlSnapshot(this, FALSE);
+	std::unique_ptr<LoadSaveRegistry> registrySaver;
 
-	if (m_bSavePreferencesToXMLFile)
-		pLoadSave = new LoadSaveXML(this, FALSE);
-	else
-		pLoadSave = new LoadSaveRegistry(this);
+	if (!m_bSavePreferencesToXMLFile)
+	{
+		registrySaver = std::make_unique<LoadSaveRegistry>(this);
+	}
+
+	/* The sections are tracked separately for each storage
+	location, since switching between them doesn't change
+	what was previously saved to the other location. */
+	std::wstring trackerPrefix = m_bSavePreferencesToXMLFile ? L"XML\\" : L"Registry\\";
+	bool anySectionChanged = false;
+	uint64_t journalSequenceNumber = m_bookmarkJournal->GetLastSequenceNumber();
+
+	bool saveTabsInFull = waitForCompletion || ShouldSaveTabsInFull();
+	uint64_t tabJournalSequenceNumber =
+		m_tabSessionJournal ? m_tabSessionJournal->GetLastSequenceNumber() : 0;
+
+	for (const auto &section : SETTINGS_SECTIONS)
+	{
+		bool isTabsSection = (section.save == &ILoadSave::SaveTabs);
+
+		/* The registry retains the tabs that were last saved, so
+		there's nothing to reuse in that case. */
+		if (isTabsSection && !saveTabsInFull
+			&& (!m_bSavePreferencesToXMLFile || xmlSnapshot.AppendSavedNodesXml(m_savedTabsXml)))
+		{
+			continue;
+		}
+
+		long firstNode = xmlSnapshot.GetNumSavedNodes();
+		(xmlSnapshot.*section.save)();
+		std::wstring sectionXml = xmlSnapshot.GetSavedNodesXml(firstNode);
+
+		if (isTabsSection)
+		{
+			m_savedTabsXml = sectionXml;
+			saveTabsInFull = true;
+		}
+
+		std::wstring trackerName = trackerPrefix + section.name;
+
+		if (!m_settingsChangeTracker.HasChanged(trackerName, sectionXml))
+		{
+			continue;
+		}
+
+		if (registrySaver)
+		{
+			(registrySaver.get()->*section.save)();
+		}
+
+		m_settingsChangeTracker.MarkSaved(trackerName, sectionXml);
+		anySectionChanged = true;
+	}
 
-	pLoadSave->SaveGenericSettings();
-	pLoadSave->SaveTabs();
-	pLoadSave->SaveDefaultColumns();
-	pLoadSave->SaveBookmarks();
-	pLoadSave->SaveApplicationToolbar();
-	pLoadSave->SaveToolbarInformation();
-	pLoadSave->SaveColorRules();
-	pLoadSave->SaveDialogStates();
+	bool compactTabJournal = saveTabsInFull && m_tabSessionJournal;
 
-	delete pLoadSave;
+	if (compactTabJournal)
+	{
+		m_tabsSavedSequenceNumber = tabJournalSequenceNumber;
+		m_tabsSavedTime = std::chrono::steady_clock::now();
+
+		/* If the tabs weren't restored from the saved copy, changes
+		are only journaled from the point they're first saved. */
+		if (m_tabSessionConnections.empty())
+		{
+			StartTabSessionJournal();
+		}
+	}
+
+	if (registrySaver)
+	{
+		m_bookmarkJournal->Compact(journalSequenceNumber);
+
+		if (compactTabJournal)
+		{
+			m_tabSessionJournal->Compact(tabJournalSequenceNumber);
+		}
+
+		return;
+	}
+
+	if (!anySectionChanged)
+	{
+		/* The tabs match the copy that was last written out, but
+		that copy may still be being written. */
+		if (compactTabJournal)
+		{
+			m_settingsWriter.PushTask(this, std::nullopt, 0, [this, tabJournalSequenceNumber]() {
+				m_tabSessionJournal->Compact(tabJournalSequenceNumber);
+			});
+		}
+
+		return;
+	}
+
+	std::wstring xml = xmlSnapshot.GetXml();
+	std::wstring configFile = LoadSaveXML::GetConfigFilePath();
+
+	/* The cache is keyed on the config file as written, so it's
+	saved once the config file has been written out. */
+	auto writeConfigFile = [this, xml = std::move(xml), configFile,
+							   cachedSettings = CaptureCachedSettings(), journalSequenceNumber,
+							   compactTabJournal, tabJournalSequenceNumber]() {
+		PerformanceTraceActivity traceActivity(L"WriteSettingsFile");
+
+		if (!NFileOperations::SaveTextFileAtomically(configFile, xml))
+		{
+			LOG(warning) << L"Couldn't save settings to \"" << configFile << L"\"";
+
+			// Ensures that everything will be written out again on the next save.
+			m_settingsChangeTracker.Reset();
+			return;
+		}
+
+		m_bookmarkJournal->Compact(journalSequenceNumber);
+
+		if (compactTabJournal)
+		{
+			m_tabSessionJournal->Compact(tabJournalSequenceNumber);
+		}
+
+		auto sourceFileKey = SettingsCache::GetSourceFileKey(configFile);
+
+		if (sourceFileKey)
+		{
+			SettingsCache::SaveToFile(GetCacheFilePath(NExplorerplusplus::SETTINGS_CACHE_FILENAME),
+				cachedSettings, *sourceFileKey);
+		}
+	};
+
+	if (waitForCompletion)
+	{
+		writeConfigFile();
+		return;
+	}
+
+	/* If a previous write hasn't started yet, there's no need to
+	perform it, since this write will supersede it. */
+	m_settingsWriter.CancelTasks(this);
+	m_settingsWriter.PushTask(this, std::nullopt, 0, std::move(writeConfigFile));
+}
+
+/* Each change to the set of tabs is recorded by the tab session
+journal as it happens, so an autosave only needs to save the
+tabs in full once the journal has recorded changes and then
+been idle for an autosave interval, or once the full save
+interval has passed (which picks up the changes the journal
+doesn't record, such as a tab's view mode). Until then, the
+copy that was last saved is reused. */
+bool Explorerplusplus::ShouldSaveTabsInFull() const
+{
+	if (!m_tabSessionJournal || !m_tabsSavedSequenceNumber)
+	{
+		return true;
+	}
+
+	/* The last copy can't be reused if it was never written out
+	(e.g. because writing the config file failed). */
+	std::wstring trackerName =
+		std::wstring(m_bSavePreferencesToXMLFile ? L"XML\\" : L"Registry\\") + L"Tabs";
+
+	if (m_settingsChangeTracker.HasChanged(trackerName, m_savedTabsXml))
+	{
+		return true;
+	}
+
+	auto now = std::chrono::steady_clock::now();
+
+	if (now - m_tabsSavedTime >= TABS_FULL_SAVE_INTERVAL)
+	{
+		return true;
+	}
+
+	auto lastRecordTime = m_tabSessionJournal->GetLastRecordTime();
+
+	return m_tabSessionJournal->GetLastSequenceNumber() != *m_tabsSavedSequenceNumber
+		&& lastRecordTime
+		&& now - *lastRecordTime >= std::chrono::milliseconds(AUTOSAVE_TIMEOUT);
+}
+
+/* Captures the same state that's written to the config file
+by the corresponding sections. */
+SettingsCache::Contents Explorerplusplus::CaptureCachedSettings()
+{
+	SettingsCache::Contents contents;
+	SettingsCache::CaptureBookmarks(&m_bookmarkTree, contents);
+	contents.colorRules = m_ColorRules;
+	contents.defaultColumns = m_config->globalFolderSettings.folderColumns;
+
+	int numBands = static_cast<int>(SendMessage(m_hMainRebar, RB_GETBANDCOUNT, 0, 0));
+
+	for (int i = 0; i < numBands; i++)
+	{
+		REBARBANDINFO rbi;
+		rbi.cbSize = sizeof(rbi);
+		rbi.fMask = RBBIM_ID | RBBIM_SIZE | RBBIM_STYLE;
+		SendMessage(m_hMainRebar, RB_GETBANDINFO, i, reinterpret_cast<LPARAM>(&rbi));
+
+		contents.toolbarBands.push_back({ rbi.wID, rbi.fStyle, rbi.cx });
+	}
+
+	return contents;
 }
 
 const Config *Explorerplusplus::GetConfig() const
@@ -1412,6 +1807,16 @@ IDirectoryMonitor *Explorerplusplus::GetDirectoryMonitor() const
 	return m_pDirMon;
 }
 
+FileOperationQueue *Explorerplusplus::GetFileOperationQueue() const
+{
+	return m_fileOperationQueue.get();
+}
+
+Plugins::PluginManager *Explorerplusplus::GetPluginManager() const
+{
+	return m_pluginManager.get();
+}
+
 IconResourceLoader *Explorerplusplus::GetIconResourceLoader() const
 {
 	return m_iconResourceLoader.get();
@@ -1439,6 +1844,38 @@ void Explorerplusplus::OnShowHiddenFiles()
 	tab.GetShellBrowser()->GetNavigationController()->Refresh();
 }
 
+void Explorerplusplus::OnToggleAllowCloudDownloads()
+{
+	Tab &tab = m_tabContainer->GetSelectedTab();
+	tab.GetShellBrowser()->SetAllowCloudHydration(
+		!tab.GetShellBrowser()->GetAllowCloudHydration());
+	tab.GetShellBrowser()->GetNavigationController()->Refresh();
+}
+
+void Explorerplusplus::OnToggleFlatView()
+{
+	Tab &tab = m_tabContainer->GetSelectedTab();
+	tab.GetShellBrowser()->SetFlatView(!tab.GetShellBrowser()->GetFlatView());
+	tab.GetShellBrowser()->GetNavigationController()->Refresh();
+}
+
+// The mode applies to every location on the server that the current tab is showing. Only the
+// current tab is refreshed; other tabs showing the same server pick up the change the next time
+// they navigate.
+void Explorerplusplus::OnSetNetworkLocationMode(NetworkLocationMode mode)
+{
+	Tab &tab = m_tabContainer->GetSelectedTab();
+	const std::wstring &server = tab.GetShellBrowser()->GetNetworkServer();
+
+	if (server.empty())
+	{
+		return;
+	}
+
+	NetworkLocationPolicy::GetInstance().SetMode(server, mode);
+	tab.GetShellBrowser()->GetNavigationController()->Refresh();
+}
+
 void Explorerplusplus::FocusChanged(WindowFocusSource windowFocusSource)
 {
 	switch (windowFocusSource)
@@ -1463,4 +1900,151 @@ boost::signals2::connection Explorerplusplus::AddFocusChangeObserver(
 	const FocusChangedSignal::slot_type &observer)
 {
 	return m_focusChangedSignal.connect(observer);
+}
+
+void Explorerplusplus::UpdateInstanceHandoffServer()
+{
+	// Requests are only accepted when multiple instances are disallowed. Otherwise, a newly started
+	// instance should open its own window.
+	if (m_config->allowMultipleInstances.get())
+	{
+		m_instanceHandoffServer.reset();
+		return;
+	}
+
+	if (m_instanceHandoffServer)
+	{
+		return;
+	}
+
+	// This will fail if another instance is already listening, in which case that instance will
+	// continue to receive the requests.
+	m_instanceHandoffServer = NamedPipeServer::Create(InstanceHandoff::GetPipeName(),
+		std::bind_front(&Explorerplusplus::OnInstanceHandoffMessage, this));
+}
+
+// Called on the server thread.
+bool Explorerplusplus::OnInstanceHandoffMessage(const std::wstring &message)
+{
+	auto request = InstanceHandoff::DecodeRequest(message);
+
+	if (!request)
+	{
+		return false;
+	}
+
+	{
+		std::scoped_lock lock(m_instanceHandoffMutex);
+		m_pendingInstanceHandoffRequests.push_back(std::move(*request));
+	}
+
+	// The request is accepted as soon as it's been queued, so that the other instance can exit
+	// without waiting for the tabs to be opened.
+	return PostMessage(m_hContainer, WM_APP_INSTANCEHANDOFF, 0, 0) != 0;
+}
+
+void Explorerplusplus::OnInstanceHandoff()
+{
+	std::vector<InstanceHandoff::Request> requests;
+
+	{
+		std::scoped_lock lock(m_instanceHandoffMutex);
+		requests = std::move(m_pendingInstanceHandoffRequests);
+		m_pendingInstanceHandoffRequests.clear();
+	}
+
+	if (requests.empty())
+	{
+		return;
+	}
+
+	for (const auto &request : requests)
+	{
+		if (request.paths.empty())
+		{
+			m_tabContainer->CreateNewTabInDefaultDirectory(TabSettings(_selected = true));
+			continue;
+		}
+
+		std::vector<std::wstring> directories;
+
+		for (const auto &path : request.paths)
+		{
+			TCHAR szParsingPath[MAX_PATH];
+			DecodePath(path.c_str(), request.baseDirectory.c_str(), szParsingPath,
+				SIZEOF_ARRAY(szParsingPath));
+			directories.emplace_back(szParsingPath);
+		}
+
+		CommandLine::OpenControlPanelChildrenInExplorer(directories);
+
+		for (const auto &directory : directories)
+		{
+			m_tabContainer->CreateNewTab(directory.c_str(), TabSettings(_selected = true));
+		}
+	}
+
+	SetForegroundWindow(m_hContainer);
+	ShowWindow(m_hContainer, SW_RESTORE);
+}
+
+void Explorerplusplus::StartHangWatchdog()
+{
+	m_hangWatchdog = std::make_unique<HangWatchdog>(m_hContainer, WM_APP_HANGWATCHDOGPING,
+		GetCacheFilePath(NExplorerplusplus::HANG_REPORTS_FILENAME));
+
+	// Binding to a folder happens on the UI thread and is a common cause of hangs (e.g. when a
+	// network share is unreachable), so the folder is published as soon as the navigation starts.
+	m_connections.push_back(m_tabContainer->tabNavigationStartedSignal.AddObserver(
+		[this](const Tab &tab, PCIDLIST_ABSOLUTE pidl) {
+			if (!m_hangWatchdog || !m_tabContainer->IsTabSelected(tab))
+			{
+				return;
+			}
+
+			std::wstring path;
+			GetDisplayName(pidl, SHGDN_FORPARSING, path);
+			m_hangWatchdog->SetNavigationPath(path);
+		}));
+}
+
+void Explorerplusplus::OnHangWatchdogPing(uint64_t pingId)
+{
+	if (!m_hangWatchdog)
+	{
+		return;
+	}
+
+	BrowserDiagnostics diagnostics = m_pActiveShellBrowser->GetTaskDiagnostics();
+
+	HangWatchdog::Context context;
+	context.navigationPath = m_pActiveShellBrowser->GetDirectory();
+	context.numTabs = m_tabContainer->GetNumTabs();
+	context.pendingColumnTasks = diagnostics.pendingColumnTasks;
+	context.pendingThumbnailTasks = diagnostics.pendingThumbnailTasks;
+	context.pendingIconTasks = diagnostics.pendingIconTasks;
+	m_hangWatchdog->OnPing(pingId, std::move(context));
+}
+
+// The folder snapshots, column text and thumbnails register themselves with the budget. The icon
+// cache is owned by this class, so it's registered here.
+void Explorerplusplus::StartMemoryPressureMonitor()
+{
+	auto &memoryBudget = MemoryBudget::GetInstance();
+	m_cachedIconsMemoryConsumerId = memoryBudget.AddConsumer(MemoryBudget::Priority::Icons,
+		[this] { return m_cachedIcons.getSizeInBytes(); },
+		[this](size_t maxBytes) { m_cachedIcons.trimToSize(maxBytes); });
+
+	m_memoryPressureMonitor = std::make_unique<MemoryPressureMonitor>(
+		m_hContainer, WM_APP_MEMORYPRESSURE, memoryBudget.GetMaxWorkingSetBytes());
+}
+
+void Explorerplusplus::OnMemoryPressure(size_t workingSetBytes, bool lowMemory)
+{
+	size_t bytesReleased =
+		MemoryBudget::GetInstance().OnMemoryPressure(workingSetBytes, lowMemory);
+
+	LOG(info) << L"Memory pressure (working set of " << workingSetBytes << L" bytes"
+			  << (lowMemory ? L", system low on memory" : L"") << L"), released "
+			  << bytesReleased << L" bytes from caches";
 }
\ No newline at end of file
@@ -20,7 +20,7 @@ Navigation::Navigation(IExplorerplusplus *expp) : m_expp(expp), m_tabContainer(n
 void Navigation::OnNavigateUp()
 {
 	Tab &tab = m_tabContainer->GetSelectedTab();
-	unique_pidl_absolute directory = tab.GetShellBrowser()->GetDirectoryIdl();
+	auto directory = tab.GetShellBrowser()->GetDirectoryIdl();
 
 	HRESULT hr = E_FAIL;
 	int resultingTabId = -1;
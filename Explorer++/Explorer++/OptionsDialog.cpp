@@ -941,7 +941,7 @@ INT_PTR CALLBACK OptionsDialog::WindowProc(HWND hDlg, UINT uMsg, WPARAM wParam,
 	{
 	case WM_INITDIALOG:
 	{
-		if (m_config->allowMultipleInstances)
+		if (m_config->allowMultipleInstances.get())
 		{
 			CheckDlgButton(hDlg, IDC_OPTION_MULTIPLEINSTANCES, BST_CHECKED);
 		}
@@ -1090,8 +1090,8 @@ INT_PTR CALLBACK OptionsDialog::WindowProc(HWND hDlg, UINT uMsg, WPARAM wParam,
 		{
 			BOOL bCheckBoxSelection;
 
-			m_config->allowMultipleInstances =
-				(IsDlgButtonChecked(hDlg, IDC_OPTION_MULTIPLEINSTANCES) == BST_CHECKED);
+			m_config->allowMultipleInstances.set(
+				IsDlgButtonChecked(hDlg, IDC_OPTION_MULTIPLEINSTANCES) == BST_CHECKED);
 
 			m_config->alwaysShowTabBar.set(
 				IsDlgButtonChecked(hDlg, IDC_OPTION_ALWAYSSHOWTABBAR) == BST_CHECKED);
@@ -0,0 +1,169 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "PathAutoCompleteSource.h"
+#include "../Helper/PathPrefixIndex.h"
+#include <wil/resource.h>
+#include <unordered_set>
+
+void PathAutoCompleteSource::SetIndex(std::shared_ptr<const PathPrefixIndex> index)
+{
+	std::scoped_lock lock(m_mutex);
+	m_index = index;
+}
+
+// IACList
+IFACEMETHODIMP PathAutoCompleteSource::Expand(PCWSTR root)
+{
+	std::shared_ptr<const PathPrefixIndex> index;
+
+	{
+		std::scoped_lock lock(m_mutex);
+		index = m_index;
+	}
+
+	std::vector<std::wstring> suggestions;
+
+	if (index)
+	{
+		suggestions = index->GetChildren(root, MAX_SUGGESTIONS);
+	}
+
+	// Relative paths are resolved against the current tab's directory when they're navigated to,
+	// which isn't known here, so only absolute paths are enumerated.
+	if ((!index || !index->IsDirectoryListed(root)) && !PathIsRelative(root))
+	{
+		// Only this method modifies these members and it's always called on the same thread, so
+		// the lock isn't needed while enumerating.
+		if (lstrcmpi(m_enumeratedDirectory.c_str(), root) != 0)
+		{
+			m_enumeratedItems = EnumerateDirectory(root);
+			m_enumeratedDirectory = root;
+		}
+
+		std::unordered_set<std::wstring> knownSuggestions;
+
+		for (const auto &suggestion : suggestions)
+		{
+			std::wstring lowercaseSuggestion = suggestion;
+			CharLowerBuff(lowercaseSuggestion.data(), static_cast<DWORD>(lowercaseSuggestion.size()));
+			knownSuggestions.insert(lowercaseSuggestion);
+		}
+
+		for (const auto &item : m_enumeratedItems)
+		{
+			if (suggestions.size() >= MAX_SUGGESTIONS)
+			{
+				break;
+			}
+
+			std::wstring lowercaseItem = item;
+			CharLowerBuff(lowercaseItem.data(), static_cast<DWORD>(lowercaseItem.size()));
+
+			if (knownSuggestions.insert(lowercaseItem).second)
+			{
+				suggestions.push_back(item);
+			}
+		}
+	}
+
+	std::scoped_lock lock(m_mutex);
+	m_suggestions = std::move(suggestions);
+	m_position = 0;
+
+	return S_OK;
+}
+
+std::vector<std::wstring> PathAutoCompleteSource::EnumerateDirectory(const std::wstring &directory)
+{
+	std::wstring searchPath = directory;
+
+	if (!searchPath.empty() && searchPath.back() != '\\')
+	{
+		searchPath += '\\';
+	}
+
+	std::vector<std::wstring> items;
+
+	WIN32_FIND_DATA findData;
+	wil::unique_hfind findHandle(FindFirstFileEx((searchPath + L"*").c_str(), FindExInfoBasic,
+		&findData, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH));
+
+	if (!findHandle)
+	{
+		return items;
+	}
+
+	do
+	{
+		if (lstrcmp(findData.cFileName, L".") == 0 || lstrcmp(findData.cFileName, L"..") == 0)
+		{
+			continue;
+		}
+
+		items.push_back(searchPath + findData.cFileName);
+	} while (items.size() < MAX_SUGGESTIONS && FindNextFile(findHandle.get(), &findData));
+
+	return items;
+}
+
+// IEnumString
+IFACEMETHODIMP PathAutoCompleteSource::Next(
+	ULONG numElements, LPOLESTR *elements, ULONG *numElementsFetched)
+{
+	std::scoped_lock lock(m_mutex);
+
+	ULONG numFetched = 0;
+
+	while (numFetched < numElements && m_position < m_suggestions.size())
+	{
+		HRESULT hr = SHStrDup(m_suggestions[m_position].c_str(), &elements[numFetched]);
+
+		if (FAILED(hr))
+		{
+			break;
+		}
+
+		numFetched++;
+		m_position++;
+	}
+
+	if (numElementsFetched)
+	{
+		*numElementsFetched = numFetched;
+	}
+
+	return (numFetched == numElements) ? S_OK : S_FALSE;
+}
+
+IFACEMETHODIMP PathAutoCompleteSource::Skip(ULONG numElements)
+{
+	std::scoped_lock lock(m_mutex);
+
+	size_t numRemaining = m_suggestions.size() - m_position;
+
+	if (numElements > numRemaining)
+	{
+		m_position = m_suggestions.size();
+		return S_FALSE;
+	}
+
+	m_position += numElements;
+
+	return S_OK;
+}
+
+IFACEMETHODIMP PathAutoCompleteSource::Reset()
+{
+	std::scoped_lock lock(m_mutex);
+	m_position = 0;
+	return S_OK;
+}
+
+IFACEMETHODIMP PathAutoCompleteSource::Clone(IEnumString **enumString)
+{
+	*enumString = nullptr;
+	return E_NOTIMPL;
+}
\ No newline at end of file
@@ -0,0 +1,54 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <winrt/base.h>
+#include <ShlObj.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class PathPrefixIndex;
+
+// Supplies suggestions to the shell autocomplete object as a path is typed. The autocomplete object
+// calls Expand() each time the directory portion of the text changes and then enumerates the
+// strings returned. Both of those happen on the autocomplete object's own thread, so the UI thread
+// is never blocked, even if a directory is slow to enumerate.
+//
+// Suggestions come from a prefix index of known paths (built on the UI thread from the history,
+// bookmarks, tabs and recently viewed folders). The directory being typed is only enumerated if the
+// index doesn't already contain a full listing of it.
+class PathAutoCompleteSource : public winrt::implements<PathAutoCompleteSource, IEnumString, IACList>
+{
+public:
+	// Should be called from the UI thread. The index can't be modified once it's been passed in.
+	void SetIndex(std::shared_ptr<const PathPrefixIndex> index);
+
+	// IACList
+	IFACEMETHODIMP Expand(PCWSTR root);
+
+	// IEnumString
+	IFACEMETHODIMP Next(ULONG numElements, LPOLESTR *elements, ULONG *numElementsFetched);
+	IFACEMETHODIMP Skip(ULONG numElements);
+	IFACEMETHODIMP Reset();
+	IFACEMETHODIMP Clone(IEnumString **enumString);
+
+private:
+	static const size_t MAX_SUGGESTIONS = 1000;
+
+	static std::vector<std::wstring> EnumerateDirectory(const std::wstring &directory);
+
+	std::mutex m_mutex;
+	std::shared_ptr<const PathPrefixIndex> m_index;
+	std::vector<std::wstring> m_suggestions;
+	size_t m_position = 0;
+
+	// The results from the last directory that was enumerated. Expand() can be called for the same
+	// directory repeatedly (e.g. as a separator is removed and then retyped), so this avoids
+	// having to enumerate the directory again each time.
+	std::wstring m_enumeratedDirectory;
+	std::vector<std::wstring> m_enumeratedItems;
+};
\ No newline at end of file
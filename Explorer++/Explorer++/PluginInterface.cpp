@@ -34,4 +34,19 @@ AcceleratorUpdater *Explorerplusplus::GetAccleratorUpdater()
 Plugins::PluginCommandManager *Explorerplusplus::GetPluginCommandManager()
 {
 	return &m_pluginCommandManager;
+}
+
+Plugins::PluginEventQueue *Explorerplusplus::GetPluginEventQueue()
+{
+	return &m_pluginEventQueue;
+}
+
+Plugins::PluginTaskRunner *Explorerplusplus::GetPluginTaskRunner()
+{
+	return &m_pluginTaskRunner;
+}
+
+Plugins::PluginDirectoryWatcher *Explorerplusplus::GetPluginDirectoryWatcher()
+{
+	return &m_pluginDirectoryWatcher;
 }
\ No newline at end of file
@@ -13,7 +13,10 @@ class UiTheming;
 namespace Plugins
 {
 	class PluginCommandManager;
+	class PluginDirectoryWatcher;
+	class PluginEventQueue;
 	class PluginMenuManager;
+	class PluginTaskRunner;
 }
 
 __interface PluginInterface
@@ -25,4 +28,7 @@ __interface PluginInterface
 	UiTheming *GetUiTheming();
 	AcceleratorUpdater *GetAccleratorUpdater();
 	Plugins::PluginCommandManager *GetPluginCommandManager();
+	Plugins::PluginEventQueue *GetPluginEventQueue();
+	Plugins::PluginTaskRunner *GetPluginTaskRunner();
+	Plugins::PluginDirectoryWatcher *GetPluginDirectoryWatcher();
 };
\ No newline at end of file
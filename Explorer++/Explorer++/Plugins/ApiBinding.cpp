@@ -4,7 +4,11 @@
 
 #include "stdafx.h"
 #include "Plugins/ApiBinding.h"
+#include "CoreInterface.h"
+#include "Plugins/AsyncApi.h"
 #include "Plugins/CommandApi/Events/CommandInvoked.h"
+#include "Plugins/FileSystemApi.h"
+#include "Plugins/FolderApi.h"
 #include "Plugins/MenuApi.h"
 #include "Plugins/PluginMenuManager.h"
 #include "Plugins/TabsApi/Events/TabCreated.h"
@@ -19,10 +23,16 @@
 #include "TabContainer.h"
 #include "UiTheming.h"
 
-void BindTabsAPI(sol::state &state, IExplorerplusplus *expp, TabContainer *tabContainer);
+void BindTabsAPI(int pluginId, sol::state &state, IExplorerplusplus *expp, TabContainer *tabContainer,
+	Plugins::PluginEventQueue *pluginEventQueue);
+void BindFolderApi(sol::state &state, TabContainer *tabContainer);
 void BindMenuApi(sol::state &state, Plugins::PluginMenuManager *pluginMenuManager);
 void BindUiApi(sol::state &state, UiTheming *uiTheming);
-void BindCommandApi(int pluginId, sol::state &state, Plugins::PluginCommandManager *pluginCommandManager);
+void BindAsyncApi(int pluginId, sol::state &state, Plugins::PluginTaskRunner *pluginTaskRunner);
+void BindCommandApi(int pluginId, sol::state &state, Plugins::PluginCommandManager *pluginCommandManager,
+	Plugins::PluginEventQueue *pluginEventQueue);
+void BindFileSystemApi(int pluginId, sol::state &state, IDirectoryMonitor *directoryMonitor,
+	Plugins::PluginDirectoryWatcher *pluginDirectoryWatcher);
 template<typename T>
 void BindObserverMethods(sol::state &state, sol::table &parentTable, const std::string &observerTableName, const std::shared_ptr<T> &object);
 template<typename T>
@@ -32,13 +42,20 @@ int deny(lua_State *state);
 
 void Plugins::BindAllApiMethods(int pluginId, sol::state &state, PluginInterface *pluginInterface)
 {
-	BindTabsAPI(state, pluginInterface->GetCoreInterface(), pluginInterface->GetTabContainer());
+	BindTabsAPI(pluginId, state, pluginInterface->GetCoreInterface(), pluginInterface->GetTabContainer(),
+		pluginInterface->GetPluginEventQueue());
+	BindFolderApi(state, pluginInterface->GetTabContainer());
 	BindMenuApi(state, pluginInterface->GetPluginMenuManager());
 	BindUiApi(state, pluginInterface->GetUiTheming());
-	BindCommandApi(pluginId, state, pluginInterface->GetPluginCommandManager());
+	BindAsyncApi(pluginId, state, pluginInterface->GetPluginTaskRunner());
+	BindCommandApi(pluginId, state, pluginInterface->GetPluginCommandManager(),
+		pluginInterface->GetPluginEventQueue());
+	BindFileSystemApi(pluginId, state, pluginInterface->GetCoreInterface()->GetDirectoryMonitor(),
+		pluginInterface->GetPluginDirectoryWatcher());
 }
 
-void BindTabsAPI(sol::state &state, IExplorerplusplus *expp, TabContainer *tabContainer)
+void BindTabsAPI(int pluginId, sol::state &state, IExplorerplusplus *expp, TabContainer *tabContainer,
+	Plugins::PluginEventQueue *pluginEventQueue)
 {
 	std::shared_ptr<Plugins::TabsApi> tabsApi = std::make_shared<Plugins::TabsApi>(expp, tabContainer);
 
@@ -53,16 +70,16 @@ void BindTabsAPI(sol::state &state, IExplorerplusplus *expp, TabContainer *tabCo
 	tabsMetaTable.set_function("move", &Plugins::TabsApi::move, tabsApi);
 	tabsMetaTable.set_function("close", &Plugins::TabsApi::close, tabsApi);
 
-	std::shared_ptr<Plugins::TabCreated> tabCreated = std::make_shared<Plugins::TabCreated>(tabContainer);
+	std::shared_ptr<Plugins::TabCreated> tabCreated = std::make_shared<Plugins::TabCreated>(tabContainer, pluginEventQueue, pluginId);
 	BindObserverMethods(state, tabsMetaTable, "onCreated", tabCreated);
 
-	std::shared_ptr<Plugins::TabMoved> tabMoved = std::make_shared<Plugins::TabMoved>(tabContainer);
+	std::shared_ptr<Plugins::TabMoved> tabMoved = std::make_shared<Plugins::TabMoved>(tabContainer, pluginEventQueue, pluginId);
 	BindObserverMethods(state, tabsMetaTable, "onMoved", tabMoved);
 
-	std::shared_ptr<Plugins::TabUpdated> tabUpdated = std::make_shared<Plugins::TabUpdated>(tabContainer);
+	std::shared_ptr<Plugins::TabUpdated> tabUpdated = std::make_shared<Plugins::TabUpdated>(tabContainer, pluginEventQueue, pluginId);
 	BindObserverMethods(state, tabsMetaTable, "onUpdated", tabUpdated);
 
-	std::shared_ptr<Plugins::TabRemoved> tabRemoved = std::make_shared<Plugins::TabRemoved>(tabContainer);
+	std::shared_ptr<Plugins::TabRemoved> tabRemoved = std::make_shared<Plugins::TabRemoved>(tabContainer, pluginEventQueue, pluginId);
 	BindObserverMethods(state, tabsMetaTable, "onRemoved", tabRemoved);
 
 	tabsMetaTable.new_usertype<Plugins::TabsApi::FolderSettings>("FolderSettings",
@@ -82,6 +99,17 @@ void BindTabsAPI(sol::state &state, IExplorerplusplus *expp, TabContainer *tabCo
 	AddEnum<SortMode>(state, tabsMetaTable, "SortMode");
 }
 
+void BindFolderApi(sol::state &state, TabContainer *tabContainer)
+{
+	std::shared_ptr<Plugins::FolderApi> folderApi = std::make_shared<Plugins::FolderApi>(tabContainer);
+
+	sol::table folderTable = state.create_named_table("folder");
+	sol::table metaTable = MarkTableReadOnly(state, folderTable);
+
+	metaTable.set_function("getItems", &Plugins::FolderApi::getItems, folderApi);
+	metaTable.set_function("getItemBatches", &Plugins::FolderApi::getItemBatches, folderApi);
+}
+
 void BindMenuApi(sol::state &state, Plugins::PluginMenuManager *pluginMenuManager)
 {
 	std::shared_ptr<Plugins::MenuApi> menuApi = std::make_shared<Plugins::MenuApi>(pluginMenuManager);
@@ -104,15 +132,55 @@ void BindUiApi(sol::state &state, UiTheming *uiTheming)
 	metaTable.set_function("setTreeViewColors", &Plugins::UiApi::setTreeViewColors, uiApi);
 }
 
-void BindCommandApi(int pluginId, sol::state &state, Plugins::PluginCommandManager *pluginCommandManager)
+void BindAsyncApi(int pluginId, sol::state &state, Plugins::PluginTaskRunner *pluginTaskRunner)
+{
+	std::shared_ptr<Plugins::AsyncApi> asyncApi = std::make_shared<Plugins::AsyncApi>(state.lua_state(), pluginTaskRunner, pluginId);
+
+	sol::table asyncTable = state.create_named_table("async");
+	sol::table metaTable = MarkTableReadOnly(state, asyncTable);
+
+	metaTable.set_function("run", &Plugins::AsyncApi::run, asyncApi);
+
+	// Each of these functions suspends the calling coroutine once the
+	// operation has been started. The coroutine is resumed (with the result
+	// of the operation) when the operation finishes.
+	metaTable.set_function("enumerateFolder", sol::yielding([asyncApi] (const std::wstring &path, sol::this_state state) {
+		asyncApi->enumerateFolder(path, state);
+	}));
+	metaTable.set_function("hashFile", sol::yielding([asyncApi] (const std::wstring &path, sol::this_state state) {
+		asyncApi->hashFile(path, state);
+	}));
+	metaTable.set_function("copyFiles", sol::yielding([asyncApi] (sol::table sourcePaths, const std::wstring &destinationFolder, sol::this_state state) {
+		asyncApi->copyFiles(sourcePaths, destinationFolder, state);
+	}));
+	metaTable.set_function("moveFiles", sol::yielding([asyncApi] (sol::table sourcePaths, const std::wstring &destinationFolder, sol::this_state state) {
+		asyncApi->moveFiles(sourcePaths, destinationFolder, state);
+	}));
+}
+
+void BindCommandApi(int pluginId, sol::state &state, Plugins::PluginCommandManager *pluginCommandManager,
+	Plugins::PluginEventQueue *pluginEventQueue)
 {
 	sol::table commandsTable = state.create_named_table("commands");
 	sol::table commandsMetaTable = MarkTableReadOnly(state, commandsTable);
 
-	std::shared_ptr<Plugins::CommandInvoked> commandInvoked = std::make_shared<Plugins::CommandInvoked>(pluginCommandManager, pluginId);
+	std::shared_ptr<Plugins::CommandInvoked> commandInvoked = std::make_shared<Plugins::CommandInvoked>(pluginCommandManager, pluginEventQueue, pluginId);
 	BindObserverMethods(state, commandsMetaTable, "onCommand", commandInvoked);
 }
 
+void BindFileSystemApi(int pluginId, sol::state &state, IDirectoryMonitor *directoryMonitor,
+	Plugins::PluginDirectoryWatcher *pluginDirectoryWatcher)
+{
+	std::shared_ptr<Plugins::FileSystemApi> fileSystemApi =
+		std::make_shared<Plugins::FileSystemApi>(directoryMonitor, pluginDirectoryWatcher, pluginId);
+
+	sol::table fileSystemTable = state.create_named_table("fileSystem");
+	sol::table metaTable = MarkTableReadOnly(state, fileSystemTable);
+
+	metaTable.set_function("watch", &Plugins::FileSystemApi::watch, fileSystemApi);
+	metaTable.set_function("unwatch", &Plugins::FileSystemApi::unwatch, fileSystemApi);
+}
+
 template<typename T>
 void BindObserverMethods(sol::state &state, sol::table &parentTable, const std::string &observerTableName, const std::shared_ptr<T> &object)
 {
@@ -0,0 +1,260 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "Plugins/AsyncApi.h"
+#include "Plugins/PluginTaskRunner.h"
+#include "SolWrapper.h"
+#include "../Helper/BulkFileTransfer.h"
+#include "../Helper/FileHash.h"
+#include <wil/resource.h>
+#include <comdef.h>
+
+Plugins::AsyncApi::AsyncApi(lua_State *luaState, PluginTaskRunner *pluginTaskRunner,
+	int pluginId) :
+	m_luaState(luaState),
+	m_pluginTaskRunner(pluginTaskRunner),
+	m_pluginId(pluginId),
+	m_coroutineIdCounter(1)
+{
+
+}
+
+Plugins::AsyncApi::~AsyncApi()
+{
+	// The API is only destroyed when the Lua state is closed, so there's no
+	// need to release the references to any coroutines that are still
+	// waiting. Operations that are running are stopped, so that unloading
+	// the plugin doesn't have to wait for them to finish.
+	m_stopSource.request_stop();
+	m_pluginTaskRunner->cancelTasks(this);
+}
+
+void Plugins::AsyncApi::run(sol::function function, sol::this_state state)
+{
+	lua_State *coroutine = lua_newthread(state);
+
+	// The new thread stays on the calling thread's stack until it first
+	// suspends (at which point it's referenced from m_suspendedCoroutines) or
+	// finishes, so that it can't be collected while it's running.
+	function.push(coroutine);
+	resume(coroutine, state, 0);
+
+	lua_pop(state, 1);
+}
+
+void Plugins::AsyncApi::enumerateFolder(const std::wstring &path, sol::this_state state)
+{
+	runTask<FolderContents>(
+		state,
+		[path](std::stop_token stopToken) -> FolderContents {
+			WIN32_FIND_DATA findData;
+			wil::unique_hfind findHandle(
+				FindFirstFileEx((std::filesystem::path(path) / L"*").c_str(), FindExInfoBasic,
+					&findData, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH));
+
+			if (!findHandle)
+			{
+				DWORD error = GetLastError();
+
+				// An empty root folder has no entries at all (not even "." and "..").
+				return { error == ERROR_FILE_NOT_FOUND ? S_OK : HRESULT_FROM_WIN32(error) };
+			}
+
+			std::vector<FolderEntry> entries;
+
+			do
+			{
+				if (stopToken.stop_requested())
+				{
+					return { HRESULT_FROM_WIN32(ERROR_CANCELLED) };
+				}
+
+				if (lstrcmp(findData.cFileName, L".") == 0
+					|| lstrcmp(findData.cFileName, L"..") == 0)
+				{
+					continue;
+				}
+
+				entries.push_back({ findData.cFileName,
+					WI_IsFlagSet(findData.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY),
+					(static_cast<long long>(findData.nFileSizeHigh) << 32)
+						| findData.nFileSizeLow });
+			} while (FindNextFile(findHandle.get(), &findData));
+
+			return { S_OK, std::move(entries) };
+		},
+		[](lua_State *coroutine, const FolderContents &contents) {
+			if (FAILED(contents.hr))
+			{
+				return pushError(coroutine, contents.hr);
+			}
+
+			// The items are returned in the same format as folder.getItems().
+			sol::state_view view(coroutine);
+			int count = static_cast<int>(contents.entries.size());
+			sol::table itemTable = view.create_table(0, 4);
+			sol::table names = view.create_table(count, 0);
+			sol::table isFolder = view.create_table(count, 0);
+			sol::table sizes = view.create_table(count, 0);
+
+			for (int i = 0; i < count; i++)
+			{
+				const auto &entry = contents.entries[i];
+				names.raw_set(i + 1, entry.name);
+				isFolder.raw_set(i + 1, entry.isFolder);
+				sizes.raw_set(i + 1, entry.size);
+			}
+
+			itemTable["count"] = count;
+			itemTable["name"] = names;
+			itemTable["isFolder"] = isFolder;
+			itemTable["size"] = sizes;
+
+			return sol::stack::push(coroutine, itemTable);
+		});
+}
+
+void Plugins::AsyncApi::hashFile(const std::wstring &path, sol::this_state state)
+{
+	runTask<std::optional<FileHash>>(
+		state, [path](std::stop_token stopToken) { return CalculateFileHash(path, stopToken); },
+		[](lua_State *coroutine, const std::optional<FileHash> &hash) {
+			if (!hash)
+			{
+				return pushError(coroutine, E_FAIL);
+			}
+
+			return sol::stack::push(coroutine, FormatFileHash(*hash));
+		});
+}
+
+void Plugins::AsyncApi::copyFiles(sol::table sourcePaths, const std::wstring &destinationFolder,
+	sol::this_state state)
+{
+	transferFiles(sourcePaths, destinationFolder, false, state);
+}
+
+void Plugins::AsyncApi::moveFiles(sol::table sourcePaths, const std::wstring &destinationFolder,
+	sol::this_state state)
+{
+	transferFiles(sourcePaths, destinationFolder, true, state);
+}
+
+void Plugins::AsyncApi::transferFiles(sol::table sourcePaths,
+	const std::wstring &destinationFolder, bool move, sol::this_state state)
+{
+	std::vector<std::wstring> paths;
+
+	for (const auto &[key, value] : sourcePaths)
+	{
+		auto path = value.as<sol::optional<std::wstring>>();
+
+		if (path)
+		{
+			paths.push_back(*path);
+		}
+	}
+
+	// Unlike transfers started from the UI, a transfer that can only be
+	// performed by the shell (e.g. because there's a naming conflict) isn't
+	// handed over to IFileOperation, since that would require user
+	// interaction. It's reported as an error instead.
+	runTask<HRESULT>(
+		state,
+		[paths, destinationFolder, move](std::stop_token stopToken) {
+			return TransferFiles(paths, destinationFolder, move, stopToken);
+		},
+		[](lua_State *coroutine, const HRESULT &hr) {
+			if (FAILED(hr))
+			{
+				return pushError(coroutine, hr);
+			}
+
+			return sol::stack::push(coroutine, true);
+		});
+}
+
+template <typename Result>
+void Plugins::AsyncApi::runTask(sol::this_state state,
+	std::function<Result(std::stop_token stopToken)> task,
+	std::function<int(lua_State *coroutine, const Result &result)> pushResult)
+{
+	int coroutineId = suspendCoroutine(state);
+
+	// The completion may be delivered after the plugin has been unloaded, so
+	// it only holds a weak reference to this object.
+	m_pluginTaskRunner->runTask(m_pluginId, this,
+		[weakSelf = weak_from_this(), coroutineId, stopToken = m_stopSource.get_token(),
+			task = std::move(task), pushResult = std::move(pushResult)]() {
+			return [weakSelf, coroutineId, result = task(stopToken), pushResult]() {
+				auto self = weakSelf.lock();
+
+				if (!self)
+				{
+					return;
+				}
+
+				self->resumeCoroutine(coroutineId, [&result, &pushResult](lua_State *coroutine) {
+					return pushResult(coroutine, result);
+				});
+			};
+		});
+}
+
+int Plugins::AsyncApi::suspendCoroutine(sol::this_state state)
+{
+	if (!lua_isyieldable(state))
+	{
+		throw sol::error("This function can only be called from within a coroutine (e.g. one "
+						 "started by async.run)");
+	}
+
+	lua_pushthread(state);
+	int reference = luaL_ref(state, LUA_REGISTRYINDEX);
+
+	int coroutineId = m_coroutineIdCounter++;
+	m_suspendedCoroutines.insert({ coroutineId, reference });
+
+	return coroutineId;
+}
+
+void Plugins::AsyncApi::resumeCoroutine(int coroutineId, const ResultPusher &pushResult)
+{
+	auto itr = m_suspendedCoroutines.find(coroutineId);
+
+	if (itr == m_suspendedCoroutines.end())
+	{
+		return;
+	}
+
+	int reference = itr->second;
+	m_suspendedCoroutines.erase(itr);
+
+	// As in run(), the coroutine is kept on the main stack while it runs.
+	lua_rawgeti(m_luaState, LUA_REGISTRYINDEX, reference);
+	lua_State *coroutine = lua_tothread(m_luaState, -1);
+	luaL_unref(m_luaState, LUA_REGISTRYINDEX, reference);
+
+	int numResults = pushResult(coroutine);
+	resume(coroutine, nullptr, numResults);
+
+	lua_pop(m_luaState, 1);
+}
+
+void Plugins::AsyncApi::resume(lua_State *coroutine, lua_State *from, int numArgs)
+{
+	// If the coroutine raises an error, it's ignored, in the same way that
+	// errors in a plugin's main script are. Any values it yields or returns
+	// aren't used.
+	lua_resume(coroutine, from, numArgs);
+	lua_settop(coroutine, 0);
+}
+
+int Plugins::AsyncApi::pushError(lua_State *coroutine, HRESULT hr)
+{
+	lua_pushnil(coroutine);
+	sol::stack::push(coroutine, std::wstring(_com_error(hr).ErrorMessage()));
+	return 2;
+}
\ No newline at end of file
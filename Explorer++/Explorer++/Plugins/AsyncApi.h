@@ -0,0 +1,94 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "../ThirdParty/Sol/forward.hpp"
+#include <functional>
+#include <memory>
+#include <stop_token>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Plugins
+{
+	class PluginTaskRunner;
+
+	// Provides versions of slow operations that don't block the UI thread.
+	// Each operation suspends the calling coroutine, runs in the background,
+	// then resumes the coroutine with its result, e.g.
+	//
+	// async.run(function()
+	//     local hash, err = async.hashFile("C:\\file.txt")
+	//     print(hash or err)
+	// end)
+	//
+	// async.run() starts the function in a new coroutine, so the plugin
+	// doesn't need to load the coroutine library. Operations can also be
+	// called from a coroutine the script has created itself, as long as the
+	// script doesn't resume that coroutine while it's waiting.
+	//
+	// As is usual in Lua, failures are indicated by returning nil, followed
+	// by an error message.
+	class AsyncApi : public std::enable_shared_from_this<AsyncApi>
+	{
+	public:
+
+		AsyncApi(lua_State *luaState, PluginTaskRunner *pluginTaskRunner, int pluginId);
+		~AsyncApi();
+
+		void run(sol::function function, sol::this_state state);
+
+		// Each of these needs to be bound using sol::yielding(), so that the
+		// calling coroutine is suspended once the operation has been started.
+		void enumerateFolder(const std::wstring &path, sol::this_state state);
+		void hashFile(const std::wstring &path, sol::this_state state);
+		void copyFiles(sol::table sourcePaths, const std::wstring &destinationFolder,
+			sol::this_state state);
+		void moveFiles(sol::table sourcePaths, const std::wstring &destinationFolder,
+			sol::this_state state);
+
+	private:
+
+		struct FolderEntry
+		{
+			std::wstring name;
+			bool isFolder;
+			long long size;
+		};
+
+		struct FolderContents
+		{
+			HRESULT hr;
+			std::vector<FolderEntry> entries;
+		};
+
+		// Pushes the result of an operation onto the coroutine's stack and
+		// returns the number of values pushed.
+		using ResultPusher = std::function<int(lua_State *coroutine)>;
+
+		template <typename Result>
+		void runTask(sol::this_state state, std::function<Result(std::stop_token stopToken)> task,
+			std::function<int(lua_State *coroutine, const Result &result)> pushResult);
+		void transferFiles(sol::table sourcePaths, const std::wstring &destinationFolder,
+			bool move, sol::this_state state);
+		int suspendCoroutine(sol::this_state state);
+		void resumeCoroutine(int coroutineId, const ResultPusher &pushResult);
+		static void resume(lua_State *coroutine, lua_State *from, int numArgs);
+		static int pushError(lua_State *coroutine, HRESULT hr);
+
+		lua_State *const m_luaState;
+		PluginTaskRunner *const m_pluginTaskRunner;
+		const int m_pluginId;
+
+		// Used to stop any running operations when the plugin is unloaded.
+		std::stop_source m_stopSource;
+
+		// Maps each suspended coroutine to the registry reference that keeps
+		// it alive while it's waiting.
+		std::unordered_map<int, int> m_suspendedCoroutines;
+		int m_coroutineIdCounter;
+	};
+}
\ No newline at end of file
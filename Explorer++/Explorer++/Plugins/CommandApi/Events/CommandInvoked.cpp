@@ -6,29 +6,34 @@
 #include "Plugins/CommandApi/Events/CommandInvoked.h"
 #include "SolWrapper.h"
 
-Plugins::CommandInvoked::CommandInvoked(PluginCommandManager *pluginCommandManager, int pluginId) :
+Plugins::CommandInvoked::CommandInvoked(PluginCommandManager *pluginCommandManager,
+	PluginEventQueue *pluginEventQueue, int pluginId) :
+	Event(pluginEventQueue, pluginId),
 	m_pluginCommandManager(pluginCommandManager),
 	m_pluginId(pluginId)
 {
 
 }
 
-boost::signals2::connection Plugins::CommandInvoked::connectObserver(sol::protected_function observer, sol::this_state state)
+boost::signals2::connection Plugins::CommandInvoked::connectObserver(sol::protected_function observer, sol::this_state state,
+	ObserverDispatcher dispatch)
 {
 	UNREFERENCED_PARAMETER(state);
 
-	return m_pluginCommandManager->AddCommandInvokedObserver([this, observer](int pluginId, const std::wstring &name) {
-		onCommandInvoked(pluginId, name, observer);
+	return m_pluginCommandManager->AddCommandInvokedObserver([this, observer, dispatch](int pluginId, const std::wstring &name) {
+		onCommandInvoked(pluginId, name, observer, dispatch);
 	});
 }
 
 void Plugins::CommandInvoked::onCommandInvoked(int pluginId, const std::wstring &name,
-	sol::protected_function observer)
+	sol::protected_function observer, ObserverDispatcher dispatch)
 {
 	if (pluginId != m_pluginId)
 	{
 		return;
 	}
 
-	observer(name);
+	dispatch([observer, name]() {
+		observer(name);
+	});
 }
\ No newline at end of file
@@ -13,15 +13,17 @@ namespace Plugins
 	{
 	public:
 
-		CommandInvoked(PluginCommandManager *pluginCommandManager, int pluginId);
+		CommandInvoked(PluginCommandManager *pluginCommandManager, PluginEventQueue *pluginEventQueue, int pluginId);
 
 	protected:
 
-		boost::signals2::connection connectObserver(sol::protected_function observer, sol::this_state state) override;
+		boost::signals2::connection connectObserver(sol::protected_function observer, sol::this_state state,
+			ObserverDispatcher dispatch) override;
 
 	private:
 
-		void onCommandInvoked(int pluginId, const std::wstring &name, sol::protected_function observer);
+		void onCommandInvoked(int pluginId, const std::wstring &name, sol::protected_function observer,
+			ObserverDispatcher dispatch);
 
 		PluginCommandManager *m_pluginCommandManager;
 		int m_pluginId;
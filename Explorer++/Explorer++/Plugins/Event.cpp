@@ -4,9 +4,12 @@
 
 #include "stdafx.h"
 #include "Plugins/Event.h"
+#include "Plugins/PluginEventQueue.h"
 #include "SolWrapper.h"
 
-Plugins::Event::Event() :
+Plugins::Event::Event(PluginEventQueue *pluginEventQueue, int pluginId) :
+	m_pluginEventQueue(pluginEventQueue),
+	m_pluginId(pluginId),
 	m_connectionIdCounter(1)
 {
 
@@ -16,7 +19,8 @@ Plugins::Event::~Event()
 {
 	for (auto &item : m_connections)
 	{
-		item.second.disconnect();
+		item.second.connection.disconnect();
+		*item.second.active = false;
 	}
 }
 
@@ -27,10 +31,21 @@ int Plugins::Event::addObserver(sol::protected_function observer, sol::this_stat
 		return -1;
 	}
 
-	auto connection = connectObserver(observer, state);
+	auto active = std::make_shared<bool>(true);
+
+	auto dispatch = [pluginEventQueue = m_pluginEventQueue, pluginId = m_pluginId, active](std::function<void()> observerCall) {
+		pluginEventQueue->queueEvent(pluginId, [active, observerCall]() {
+			if (*active)
+			{
+				observerCall();
+			}
+		});
+	};
+
+	auto connection = connectObserver(observer, state, dispatch);
 
 	int id = m_connectionIdCounter++;
-	m_connections.insert(std::make_pair(id, connection));
+	m_connections.insert(std::make_pair(id, ObserverConnection{ connection, active }));
 
 	return id;
 }
@@ -44,7 +59,8 @@ void Plugins::Event::removeObserver(int id)
 		return;
 	}
 
-	itr->second.disconnect();
+	itr->second.connection.disconnect();
+	*itr->second.active = false;
 
 	m_connections.erase(itr);
 }
\ No newline at end of file
@@ -6,15 +6,25 @@
 
 #include "../ThirdParty/Sol/forward.hpp"
 #include <boost/signals2.hpp>
+#include <functional>
+#include <memory>
 #include <unordered_map>
 
 namespace Plugins
 {
+	class PluginEventQueue;
+
+	// Observers are invoked via the plugin event queue, rather than directly
+	// from the underlying signal. Derived classes should capture whatever data
+	// the observer needs at the time the signal fires and pass a callback that
+	// invokes the observer to the supplied dispatch function.
 	class Event
 	{
 	public:
 
-		Event();
+		using ObserverDispatcher = std::function<void(std::function<void()> observerCall)>;
+
+		Event(PluginEventQueue *pluginEventQueue, int pluginId);
 		virtual ~Event();
 
 		int addObserver(sol::protected_function observer, sol::this_state state);
@@ -22,11 +32,24 @@ namespace Plugins
 
 	protected:
 
-		virtual boost::signals2::connection connectObserver(sol::protected_function observer, sol::this_state state) = 0;
+		virtual boost::signals2::connection connectObserver(sol::protected_function observer, sol::this_state state,
+			ObserverDispatcher dispatch) = 0;
 
 	private:
 
+		struct ObserverConnection
+		{
+			boost::signals2::connection connection;
+
+			// Cleared when the observer is removed, so that any calls that have
+			// already been queued won't be made.
+			std::shared_ptr<bool> active;
+		};
+
+		PluginEventQueue *m_pluginEventQueue;
+		const int m_pluginId;
+
 		int m_connectionIdCounter;
-		std::unordered_map<int, boost::signals2::connection> m_connections;
+		std::unordered_map<int, ObserverConnection> m_connections;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,134 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "Plugins/FileSystemApi.h"
+#include "SolWrapper.h"
+
+Plugins::FileSystemApi::FileSystemApi(IDirectoryMonitor *directoryMonitor,
+	PluginDirectoryWatcher *pluginDirectoryWatcher, int pluginId) :
+	m_directoryMonitor(directoryMonitor),
+	m_pluginDirectoryWatcher(pluginDirectoryWatcher),
+	m_pluginId(pluginId)
+{
+
+}
+
+Plugins::FileSystemApi::~FileSystemApi()
+{
+	for (const auto &[watchId, callback] : m_callbacks)
+	{
+		m_pluginDirectoryWatcher->removeWatch(m_directoryMonitor, watchId);
+	}
+}
+
+std::optional<int> Plugins::FileSystemApi::watch(const std::wstring &path,
+	sol::optional<sol::table> options, sol::protected_function callback)
+{
+	if (!callback || PathIsRelative(path.c_str()))
+	{
+		return std::nullopt;
+	}
+
+	bool recursive = false;
+
+	if (options)
+	{
+		recursive = options->get_or("recursive", false);
+	}
+
+	// The watcher doesn't hold any references into the Lua state. Batches are routed back
+	// through this object instead, so that nothing is invoked once the plugin has been unloaded.
+	auto watchId = m_pluginDirectoryWatcher->addWatch(m_directoryMonitor, m_pluginId, path,
+		recursive,
+		[weakSelf = weak_from_this()](int id, const PluginDirectoryWatcher::ChangeBatch &batch) {
+			if (auto self = weakSelf.lock())
+			{
+				self->onChanges(id, batch);
+			}
+		});
+
+	if (!watchId)
+	{
+		return std::nullopt;
+	}
+
+	m_callbacks.emplace(*watchId, callback);
+
+	return watchId;
+}
+
+void Plugins::FileSystemApi::unwatch(int id)
+{
+	auto itr = m_callbacks.find(id);
+
+	if (itr == m_callbacks.end())
+	{
+		return;
+	}
+
+	m_pluginDirectoryWatcher->removeWatch(m_directoryMonitor, id);
+	m_callbacks.erase(itr);
+}
+
+void Plugins::FileSystemApi::onChanges(int watchId,
+	const PluginDirectoryWatcher::ChangeBatch &batch)
+{
+	auto itr = m_callbacks.find(watchId);
+
+	if (itr == m_callbacks.end())
+	{
+		return;
+	}
+
+	// The callback may unwatch the directory, so it's copied before being invoked.
+	sol::protected_function callback = itr->second;
+	sol::state_view state(callback.lua_state());
+
+	int count = static_cast<int>(batch.changes.size());
+	sol::table changesTable = state.create_table(0, 5);
+	sol::table types = state.create_table(count, 0);
+	sol::table names = state.create_table(count, 0);
+	sol::table oldNames = state.create_table();
+
+	for (int i = 0; i < count; i++)
+	{
+		const auto &change = batch.changes[i];
+		types.raw_set(i + 1, changeTypeToString(change.type));
+		names.raw_set(i + 1, change.name);
+
+		if (change.type == PluginDirectoryWatcher::ChangeType::Renamed)
+		{
+			oldNames.raw_set(i + 1, change.oldName);
+		}
+	}
+
+	changesTable["count"] = count;
+	changesTable["type"] = types;
+	changesTable["name"] = names;
+	changesTable["oldName"] = oldNames;
+	changesTable["overflowed"] = batch.overflowed;
+
+	callback(changesTable);
+}
+
+std::string Plugins::FileSystemApi::changeTypeToString(PluginDirectoryWatcher::ChangeType type)
+{
+	switch (type)
+	{
+	case PluginDirectoryWatcher::ChangeType::Added:
+		return "added";
+
+	case PluginDirectoryWatcher::ChangeType::Removed:
+		return "removed";
+
+	case PluginDirectoryWatcher::ChangeType::Modified:
+		return "modified";
+
+	case PluginDirectoryWatcher::ChangeType::Renamed:
+		return "renamed";
+	}
+
+	return "";
+}
\ No newline at end of file
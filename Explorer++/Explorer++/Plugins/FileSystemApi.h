@@ -0,0 +1,55 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "Plugins/PluginDirectoryWatcher.h"
+#include "../ThirdParty/Sol/forward.hpp"
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace Plugins
+{
+	// Allows a plugin to be notified when the contents of a directory change,
+	// e.g.
+	//
+	// local id = fileSystem.watch("C:\\Downloads", {recursive = true}, function(changes)
+	//     for i = 1, changes.count do
+	//         print(changes.type[i], changes.name[i], changes.oldName[i])
+	//     end
+	// end)
+	//
+	// Rather than the callback being invoked for every change, changes are
+	// collected and reduced to the net change for each item, then delivered
+	// in a single batch, in the same columnar format used by
+	// folder.getItems(). Each type is one of "added", "removed", "modified"
+	// or "renamed" and names are relative to the watched directory (oldName
+	// is only set for renamed items). If changes were lost, the batch will
+	// have overflowed set and the directory should be rescanned.
+	class FileSystemApi : public std::enable_shared_from_this<FileSystemApi>
+	{
+	public:
+
+		FileSystemApi(IDirectoryMonitor *directoryMonitor,
+			PluginDirectoryWatcher *pluginDirectoryWatcher, int pluginId);
+		~FileSystemApi();
+
+		std::optional<int> watch(const std::wstring &path, sol::optional<sol::table> options,
+			sol::protected_function callback);
+		void unwatch(int id);
+
+	private:
+
+		void onChanges(int watchId, const PluginDirectoryWatcher::ChangeBatch &batch);
+		static std::string changeTypeToString(PluginDirectoryWatcher::ChangeType type);
+
+		IDirectoryMonitor *const m_directoryMonitor;
+		PluginDirectoryWatcher *const m_pluginDirectoryWatcher;
+		const int m_pluginId;
+
+		std::unordered_map<int, sol::protected_function> m_callbacks;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,220 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "Plugins/FolderApi.h"
+#include "ShellBrowser/ShellBrowser.h"
+#include "SolWrapper.h"
+#include "TabContainer.h"
+
+namespace
+{
+	// The number of 100-nanosecond intervals between 1601-01-01 (the FILETIME
+	// epoch) and 1970-01-01.
+	const ULONGLONG UNIX_EPOCH_AS_FILETIME = 116444736000000000ULL;
+
+	// Returns the time as the number of seconds since the Unix epoch, which is
+	// what os.date() and os.time() work with.
+	long long fileTimeToUnixTime(const FILETIME &fileTime)
+	{
+		ULARGE_INTEGER value;
+		value.LowPart = fileTime.dwLowDateTime;
+		value.HighPart = fileTime.dwHighDateTime;
+
+		if (value.QuadPart < UNIX_EPOCH_AS_FILETIME)
+		{
+			return 0;
+		}
+
+		return static_cast<long long>((value.QuadPart - UNIX_EPOCH_AS_FILETIME) / 10000000ULL);
+	}
+}
+
+const std::vector<std::pair<Plugins::FolderApi::Field, std::string>> Plugins::FolderApi::FIELD_NAMES = {
+	{ Field::Name, "name" },
+	{ Field::DisplayName, "displayName" },
+	{ Field::Path, "path" },
+	{ Field::Size, "size" },
+	{ Field::IsFolder, "isFolder" },
+	{ Field::Attributes, "attributes" },
+	{ Field::DateCreated, "dateCreated" },
+	{ Field::DateModified, "dateModified" }
+};
+
+Plugins::FolderApi::FolderApi(TabContainer *tabContainer) :
+	m_tabContainer(tabContainer)
+{
+
+}
+
+std::optional<sol::table> Plugins::FolderApi::getItems(int tabId, sol::table fields, sol::this_state state)
+{
+	auto tab = m_tabContainer->GetTabOptional(tabId);
+
+	if (!tab)
+	{
+		return std::nullopt;
+	}
+
+	const auto *shellBrowser = tab->GetShellBrowser();
+
+	return buildItemTable(state, *shellBrowser, parseFields(fields), 0, shellBrowser->GetNumItems());
+}
+
+sol::object Plugins::FolderApi::getItemBatches(int tabId, sol::table fields, std::optional<int> batchSize,
+	sol::this_state state)
+{
+	auto tab = m_tabContainer->GetTabOptional(tabId);
+
+	if (!tab)
+	{
+		return sol::make_object(state, sol::lua_nil);
+	}
+
+	// If the tab navigates elsewhere while the items are being iterated, the
+	// iteration simply ends.
+	int uniqueFolderId = tab->GetShellBrowser()->GetUniqueFolderId();
+
+	auto iterator = [tabContainer = m_tabContainer, tabId, parsedFields = parseFields(fields),
+						batchSize = (std::max)(batchSize.value_or(DEFAULT_BATCH_SIZE), 1), uniqueFolderId,
+						nextIndex = 0](sol::variadic_args args, sol::this_state iteratorState) mutable
+		-> std::optional<sol::table> {
+		UNREFERENCED_PARAMETER(args);
+
+		auto currentTab = tabContainer->GetTabOptional(tabId);
+
+		if (!currentTab || currentTab->GetShellBrowser()->GetUniqueFolderId() != uniqueFolderId)
+		{
+			return std::nullopt;
+		}
+
+		const auto *shellBrowser = currentTab->GetShellBrowser();
+		int numItems = shellBrowser->GetNumItems();
+
+		if (nextIndex >= numItems)
+		{
+			return std::nullopt;
+		}
+
+		int count = (std::min)(batchSize, numItems - nextIndex);
+		auto table = buildItemTable(iteratorState, *shellBrowser, parsedFields, nextIndex, count);
+		nextIndex += count;
+
+		return table;
+	};
+
+	return sol::make_object(state, iterator);
+}
+
+std::vector<Plugins::FolderApi::Field> Plugins::FolderApi::parseFields(sol::table fields)
+{
+	std::vector<Field> parsedFields;
+
+	// Unknown fields are ignored, so that a script written against a later
+	// version of the API still works (without the extra fields).
+	for (const auto &[key, value] : fields)
+	{
+		auto fieldName = value.as<sol::optional<std::string>>();
+
+		if (!fieldName)
+		{
+			continue;
+		}
+
+		auto itr = std::find_if(FIELD_NAMES.begin(), FIELD_NAMES.end(), [&fieldName](const auto &entry) {
+			return entry.second == *fieldName;
+		});
+
+		if (itr == FIELD_NAMES.end())
+		{
+			continue;
+		}
+
+		if (std::find(parsedFields.begin(), parsedFields.end(), itr->first) == parsedFields.end())
+		{
+			parsedFields.push_back(itr->first);
+		}
+	}
+
+	return parsedFields;
+}
+
+sol::table Plugins::FolderApi::buildItemTable(sol::state_view state, const ShellBrowser &shellBrowser,
+	const std::vector<Field> &fields, int startIndex, int count)
+{
+	sol::table itemTable = state.create_table(0, static_cast<int>(fields.size()) + 1);
+	itemTable["count"] = count;
+
+	std::vector<sol::table> columns;
+
+	for (auto field : fields)
+	{
+		auto itr = std::find_if(FIELD_NAMES.begin(), FIELD_NAMES.end(), [field](const auto &entry) {
+			return entry.first == field;
+		});
+
+		sol::table column = state.create_table(count, 0);
+		itemTable[itr->second] = column;
+		columns.push_back(column);
+	}
+
+	bool findDataNeeded = std::any_of(fields.begin(), fields.end(), [](Field field) {
+		return field != Field::Name && field != Field::DisplayName && field != Field::Path;
+	});
+
+	for (int i = 0; i < count; i++)
+	{
+		int index = startIndex + i;
+
+		WIN32_FIND_DATA findData = {};
+
+		if (findDataNeeded)
+		{
+			findData = shellBrowser.GetItemFileFindData(index);
+		}
+
+		for (size_t j = 0; j < fields.size(); j++)
+		{
+			auto &column = columns[j];
+
+			switch (fields[j])
+			{
+			case Field::Name:
+				column.raw_set(i + 1, shellBrowser.GetItemName(index));
+				break;
+
+			case Field::DisplayName:
+				column.raw_set(i + 1, shellBrowser.GetItemDisplayName(index));
+				break;
+
+			case Field::Path:
+				column.raw_set(i + 1, shellBrowser.GetItemFullName(index));
+				break;
+
+			case Field::Size:
+				column.raw_set(i + 1,
+					(static_cast<long long>(findData.nFileSizeHigh) << 32) | findData.nFileSizeLow);
+				break;
+
+			case Field::IsFolder:
+				column.raw_set(i + 1, WI_IsFlagSet(findData.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY));
+				break;
+
+			case Field::Attributes:
+				column.raw_set(i + 1, static_cast<long long>(findData.dwFileAttributes));
+				break;
+
+			case Field::DateCreated:
+				column.raw_set(i + 1, fileTimeToUnixTime(findData.ftCreationTime));
+				break;
+
+			case Field::DateModified:
+				column.raw_set(i + 1, fileTimeToUnixTime(findData.ftLastWriteTime));
+				break;
+			}
+		}
+	}
+
+	return itemTable;
+}
\ No newline at end of file
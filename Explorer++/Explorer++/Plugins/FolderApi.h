@@ -0,0 +1,63 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "../ThirdParty/Sol/forward.hpp"
+#include <optional>
+#include <string>
+#include <vector>
+
+class ShellBrowser;
+class TabContainer;
+
+namespace Plugins
+{
+	// Provides access to the items shown in a tab. Items are returned in bulk,
+	// with each requested field stored in its own array, e.g.
+	//
+	// local items = folder.getItems(tabId, {"name", "size"})
+	//
+	// for i = 1, items.count do
+	//     print(items.name[i], items.size[i])
+	// end
+	//
+	// That way, a script can process a large folder without making a call back
+	// into the application for each item. getItemBatches() returns the same
+	// data in fixed-size batches, for use in a generic for loop, so that the
+	// entire folder doesn't need to be held in a single table.
+	class FolderApi
+	{
+	public:
+
+		FolderApi(TabContainer *tabContainer);
+
+		std::optional<sol::table> getItems(int tabId, sol::table fields, sol::this_state state);
+		sol::object getItemBatches(int tabId, sol::table fields, std::optional<int> batchSize,
+			sol::this_state state);
+
+	private:
+
+		enum class Field
+		{
+			Name,
+			DisplayName,
+			Path,
+			Size,
+			IsFolder,
+			Attributes,
+			DateCreated,
+			DateModified
+		};
+
+		static const int DEFAULT_BATCH_SIZE = 1000;
+		static const std::vector<std::pair<Field, std::string>> FIELD_NAMES;
+
+		static std::vector<Field> parseFields(sol::table fields);
+		static sol::table buildItemTable(sol::state_view state, const ShellBrowser &shellBrowser,
+			const std::vector<Field> &fields, int startIndex, int count);
+
+		TabContainer *m_tabContainer;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,159 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "Plugins/LuaBytecodeCache.h"
+#include "SolWrapper.h"
+#include "../Helper/Crc32.h"
+#include <filesystem>
+#include <fstream>
+
+namespace
+{
+	const char CACHE_FILE_MAGIC[4] = { 'E', 'P', 'L', 'C' };
+
+	struct CacheFileHeader
+	{
+		char magic[4];
+		uint32_t luaVersion;
+		uint32_t sourceCrc;
+		uint32_t sourceSize;
+		uint32_t bytecodeSize;
+	};
+
+	std::optional<std::string> readFile(const std::filesystem::path &path)
+	{
+		std::ifstream inputStream(path.wstring(), std::ios::binary);
+
+		if (!inputStream)
+		{
+			return std::nullopt;
+		}
+
+		std::string contents((std::istreambuf_iterator<char>(inputStream)), std::istreambuf_iterator<char>());
+
+		if (inputStream.bad())
+		{
+			return std::nullopt;
+		}
+
+		return contents;
+	}
+
+	int writeBytecode(lua_State *L, const void *data, size_t size, void *userData)
+	{
+		UNREFERENCED_PARAMETER(L);
+
+		static_cast<std::string *>(userData)->append(static_cast<const char *>(data), size);
+		return 0;
+	}
+
+	std::optional<std::string> compileScript(const std::filesystem::path &scriptPath, const std::string &source)
+	{
+		std::unique_ptr<lua_State, decltype(&lua_close)> L(luaL_newstate(), lua_close);
+
+		if (!L)
+		{
+			return std::nullopt;
+		}
+
+		// The chunk name matches the one used when a script file is loaded
+		// directly, so that error messages are the same either way.
+		std::string chunkName = "@" + scriptPath.string();
+
+		if (luaL_loadbuffer(L.get(), source.data(), source.size(), chunkName.c_str()) != LUA_OK)
+		{
+			return std::nullopt;
+		}
+
+		std::string bytecode;
+
+		if (lua_dump(L.get(), writeBytecode, &bytecode, 0) != 0)
+		{
+			return std::nullopt;
+		}
+
+		return bytecode;
+	}
+
+	std::optional<std::string> readCacheFile(const std::filesystem::path &cachePath,
+		uint32_t sourceCrc, uint32_t sourceSize)
+	{
+		auto contents = readFile(cachePath);
+
+		if (!contents || contents->size() < sizeof(CacheFileHeader))
+		{
+			return std::nullopt;
+		}
+
+		CacheFileHeader header;
+		memcpy(&header, contents->data(), sizeof(header));
+
+		// The bytecode size is checked so that a partially written file is
+		// ignored.
+		if (memcmp(header.magic, CACHE_FILE_MAGIC, sizeof(CACHE_FILE_MAGIC)) != 0
+			|| header.luaVersion != LUA_VERSION_NUM
+			|| header.sourceCrc != sourceCrc
+			|| header.sourceSize != sourceSize
+			|| header.bytecodeSize != contents->size() - sizeof(header))
+		{
+			return std::nullopt;
+		}
+
+		return contents->substr(sizeof(header));
+	}
+
+	void writeCacheFile(const std::filesystem::path &cachePath, uint32_t sourceCrc, uint32_t sourceSize,
+		const std::string &bytecode)
+	{
+		CacheFileHeader header;
+		memcpy(header.magic, CACHE_FILE_MAGIC, sizeof(CACHE_FILE_MAGIC));
+		header.luaVersion = LUA_VERSION_NUM;
+		header.sourceCrc = sourceCrc;
+		header.sourceSize = sourceSize;
+		header.bytecodeSize = static_cast<uint32_t>(bytecode.size());
+
+		// The plugin directory may well be read-only (e.g. if it's within
+		// Program Files). In that case, the script will simply be compiled each
+		// time.
+		std::ofstream outputStream(cachePath.wstring(), std::ios::binary | std::ios::trunc);
+		outputStream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		outputStream.write(bytecode.data(), bytecode.size());
+	}
+}
+
+std::optional<std::string> Plugins::loadCompiledScript(const std::filesystem::path &scriptPath)
+{
+	auto source = readFile(scriptPath);
+
+	if (!source)
+	{
+		return std::nullopt;
+	}
+
+	Crc32 crc;
+	crc.Update(source->data(), source->size());
+	uint32_t sourceSize = static_cast<uint32_t>(source->size());
+
+	std::filesystem::path cachePath = scriptPath;
+	cachePath += L"c";
+
+	auto bytecode = readCacheFile(cachePath, crc.GetValue(), sourceSize);
+
+	if (bytecode)
+	{
+		return bytecode;
+	}
+
+	bytecode = compileScript(scriptPath, *source);
+
+	if (!bytecode)
+	{
+		return std::nullopt;
+	}
+
+	writeCacheFile(cachePath, crc.GetValue(), sourceSize, *bytecode);
+
+	return bytecode;
+}
\ No newline at end of file
@@ -0,0 +1,32 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <optional>
+#include <string>
+
+namespace std
+{
+	namespace filesystem
+	{
+		class path;
+	}
+}
+
+namespace Plugins
+{
+	// Returns the precompiled form of the specified Lua script, suitable for
+	// loading in binary mode. The compiled chunk is cached in a file next to
+	// the script (e.g. "plugin.lua" is cached in "plugin.luac") and reused for
+	// as long as the script is unchanged.
+	//
+	// std::nullopt is returned if the script can't be read or doesn't compile,
+	// in which case the script should be loaded from source, so that any error
+	// is reported as normal.
+	//
+	// This doesn't interact with any existing Lua state, so it's safe to call
+	// from a background thread.
+	std::optional<std::string> loadCompiledScript(const std::filesystem::path &scriptPath);
+}
\ No newline at end of file
@@ -5,7 +5,9 @@
 #include "stdafx.h"
 #include "Plugins/LuaPlugin.h"
 #include "Plugins/ApiBinding.h"
+#include "Plugins/PluginEventQueue.h"
 #include "SolWrapper.h"
+#include "../Helper/Logging.h"
 
 int Plugins::LuaPlugin::idCounter = 1;
 
@@ -15,12 +17,24 @@ Plugins::LuaPlugin::LuaPlugin(const std::wstring &directory, const Manifest &man
 	PluginInterface *pluginInterface) :
 	m_directory(directory),
 	m_manifest(manifest),
-	m_lua(onPanic),
+	m_pluginEventQueue(pluginInterface->GetPluginEventQueue()),
+	m_allocator(manifest.memory.softLimit, manifest.memory.hardLimit),
+	m_lua(onPanic, &PluginAllocator::allocate, &m_allocator),
 	m_id(idCounter++)
 {
+	m_pluginEventQueue->registerPlugin(m_id, manifest.name, [this] { CheckMemoryUsage(); });
+
+	ApplyGarbageCollectorSettings();
 	BindAllApiMethods(m_id, m_lua, pluginInterface);
 }
 
+Plugins::LuaPlugin::~LuaPlugin()
+{
+	// Any queued events reference the Lua state, so they need to be dropped
+	// before the state is destroyed.
+	m_pluginEventQueue->discardEvents(m_id);
+}
+
 int Plugins::LuaPlugin::GetId() const
 {
 	return m_id;
@@ -41,6 +55,65 @@ sol::state &Plugins::LuaPlugin::GetLuaState()
 	return m_lua;
 }
 
+Plugins::LuaPlugin::MemoryStats Plugins::LuaPlugin::GetMemoryStats() const
+{
+	return { m_allocator.getStats(), m_allocator.getSoftLimit(), m_allocator.getHardLimit(),
+		m_numSoftLimitCollections };
+}
+
+void Plugins::LuaPlugin::ApplyGarbageCollectorSettings()
+{
+	const auto &memorySettings = m_manifest.memory;
+
+	if (memorySettings.gcPause)
+	{
+		lua_gc(m_lua.lua_state(), LUA_GCSETPAUSE, *memorySettings.gcPause);
+	}
+
+	if (memorySettings.gcStepMultiplier)
+	{
+		lua_gc(m_lua.lua_state(), LUA_GCSETSTEPMUL, *memorySettings.gcStepMultiplier);
+	}
+}
+
+// Called once the plugin has finished handling a batch of events. If the
+// state has grown beyond its soft limit, a full collection is run, to reclaim
+// any garbage the incremental collector hasn't gotten to yet. If the state is
+// still over the limit after that, it's genuinely using that much memory, so
+// another collection is only run once it has grown by a further quarter of
+// the limit.
+void Plugins::LuaPlugin::CheckMemoryUsage()
+{
+	if (!m_allocator.isOverSoftLimit())
+	{
+		m_bytesInUseAfterCollection = 0;
+		return;
+	}
+
+	size_t bytesInUse = m_allocator.getStats().bytesInUse;
+
+	if (m_bytesInUseAfterCollection != 0
+		&& bytesInUse < m_bytesInUseAfterCollection + m_allocator.getSoftLimit() / 4)
+	{
+		return;
+	}
+
+	lua_gc(m_lua.lua_state(), LUA_GCCOLLECT, 0);
+	m_numSoftLimitCollections++;
+
+	if (!m_allocator.isOverSoftLimit())
+	{
+		m_bytesInUseAfterCollection = 0;
+		return;
+	}
+
+	m_bytesInUseAfterCollection = m_allocator.getStats().bytesInUse;
+
+	LOG(warning) << L"Plugin \"" << m_manifest.name << L"\" is using "
+				 << m_bytesInUseAfterCollection / 1024 << L" KB, which is over its soft limit of "
+				 << m_allocator.getSoftLimit() / 1024 << L" KB";
+}
+
 inline int onPanic(lua_State *L)
 {
 	UNREFERENCED_PARAMETER(L);
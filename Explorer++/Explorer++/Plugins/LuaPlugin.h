@@ -6,30 +6,60 @@
 
 #include "PluginInterface.h"
 #include "Plugins/Manifest.h"
+#include "Plugins/PluginAllocator.h"
 #include "../ThirdParty/Sol/forward.hpp"
 
 namespace Plugins
 {
+	class PluginEventQueue;
+
 	// Wraps a Lua state object and binds in all plugin API methods
 	// during construction.
 	class LuaPlugin
 	{
 	public:
 
+		struct MemoryStats
+		{
+			PluginAllocator::Stats allocator;
+			size_t softLimit;
+			size_t hardLimit;
+
+			// The number of full collections run because the state had grown
+			// beyond its soft limit.
+			int numSoftLimitCollections;
+		};
+
 		LuaPlugin(const std::wstring &directory, const Manifest &manifest, PluginInterface *pluginInterface);
+		~LuaPlugin();
 
 		int GetId() const;
 		std::wstring GetDirectory() const;
 		Plugins::Manifest GetManifest() const;
 		sol::state &GetLuaState();
+		MemoryStats GetMemoryStats() const;
 
 	private:
 
 		static int idCounter;
 
+		void ApplyGarbageCollectorSettings();
+		void CheckMemoryUsage();
+
 		std::wstring m_directory;
 		Manifest m_manifest;
 
+		PluginEventQueue *m_pluginEventQueue;
+
+		// Declared before the Lua state, since the state uses it until it's
+		// destroyed.
+		PluginAllocator m_allocator;
+
+		// The memory in use after the last collection triggered by the soft
+		// limit.
+		size_t m_bytesInUseAfterCollection = 0;
+		int m_numSoftLimitCollections = 0;
+
 		sol::state m_lua;
 		const int m_id;
 	};
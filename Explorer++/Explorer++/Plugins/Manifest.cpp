@@ -7,6 +7,7 @@
 #include "AcceleratorMappings.h"
 #include "Plugins/AcceleratorParser.h"
 #include "../Helper/StringHelper.h"
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
 
@@ -52,6 +53,11 @@ void Plugins::from_json(const nlohmann::json &json, Manifest &manifest)
 	{
 		json.at("shortcut_keys").get_to(manifest.shortcutKeys);
 	}
+
+	if (json.count("memory") != 0)
+	{
+		json.at("memory").get_to(manifest.memory);
+	}
 }
 
 void Plugins::from_json(const nlohmann::json &json, Command &command)
@@ -95,6 +101,38 @@ void Plugins::from_json(const nlohmann::json &json, PluginAccelerator &pluginAcc
 	pluginAccelerator.accelerator = parseAccelerator(pluginAccelerator.acceleratorString);
 }
 
+void Plugins::from_json(const nlohmann::json &json, MemorySettings &memorySettings)
+{
+	const size_t BYTES_PER_MB = 1024 * 1024;
+	const size_t MAX_LIMIT_MB = MemorySettings::MAX_HARD_LIMIT / BYTES_PER_MB;
+
+	// The values are clamped before being converted, so that the conversion
+	// can't overflow.
+	if (json.count("hard_limit_mb") != 0)
+	{
+		auto hardLimitMb = json.at("hard_limit_mb").get<size_t>();
+		memorySettings.hardLimit = std::clamp<size_t>(hardLimitMb, 1, MAX_LIMIT_MB) * BYTES_PER_MB;
+	}
+
+	if (json.count("soft_limit_mb") != 0)
+	{
+		auto softLimitMb = json.at("soft_limit_mb").get<size_t>();
+		memorySettings.softLimit = (std::min)(softLimitMb, MAX_LIMIT_MB) * BYTES_PER_MB;
+	}
+
+	memorySettings.softLimit = (std::min)(memorySettings.softLimit, memorySettings.hardLimit);
+
+	if (json.count("gc_pause") != 0)
+	{
+		memorySettings.gcPause = json.at("gc_pause").get<int>();
+	}
+
+	if (json.count("gc_step_multiplier") != 0)
+	{
+		memorySettings.gcStepMultiplier = json.at("gc_step_multiplier").get<int>();
+	}
+}
+
 std::optional<Plugins::Manifest> Plugins::parseManifest(const std::filesystem::path &manifestPath)
 {
 	std::ifstream inputStream(manifestPath.wstring());
@@ -39,6 +39,26 @@ namespace Plugins
 		std::wstring description;
 	};
 
+	// Limits on the memory used by a plugin's Lua state, along with settings
+	// for its garbage collector. These can be set through the "memory" object
+	// in the manifest, with the limits given in megabytes.
+	struct MemorySettings
+	{
+		static constexpr size_t DEFAULT_SOFT_LIMIT = 32 * 1024 * 1024;
+		static constexpr size_t DEFAULT_HARD_LIMIT = 128 * 1024 * 1024;
+
+		// A plugin can't raise its hard limit beyond this.
+		static constexpr size_t MAX_HARD_LIMIT = 1024 * 1024 * 1024;
+
+		size_t softLimit = DEFAULT_SOFT_LIMIT;
+		size_t hardLimit = DEFAULT_HARD_LIMIT;
+
+		// Passed to lua_gc (as LUA_GCSETPAUSE and LUA_GCSETSTEPMUL). Lua's own
+		// defaults are used for any values that aren't set.
+		std::optional<int> gcPause;
+		std::optional<int> gcStepMultiplier;
+	};
+
 	struct Manifest
 	{
 		std::wstring name;
@@ -51,6 +71,7 @@ namespace Plugins
 		std::vector<sol::lib> libraries;
 		std::vector<Command> commands;
 		std::vector<PluginShortcutKey> shortcutKeys;
+		MemorySettings memory;
 	};
 
 	NLOHMANN_JSON_SERIALIZE_ENUM(sol::lib, {
@@ -70,6 +91,7 @@ namespace Plugins
 	void from_json(const nlohmann::json &json, Command &command);
 	void from_json(const nlohmann::json &json, PluginShortcutKey &shortcutKey);
 	void from_json(const nlohmann::json &json, PluginAccelerator &pluginAccelerator);
+	void from_json(const nlohmann::json &json, MemorySettings &memorySettings);
 
 	std::optional<Manifest> parseManifest(const std::filesystem::path &manifestPath);
 }
@@ -0,0 +1,183 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "Plugins/PluginAllocator.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+Plugins::PluginAllocator::PluginAllocator(size_t softLimit, size_t hardLimit) :
+	m_softLimit((std::min)(softLimit, hardLimit)),
+	m_hardLimit(hardLimit)
+{
+
+}
+
+void *Plugins::PluginAllocator::allocate(void *userData, void *ptr, size_t oldSize,
+	size_t newSize)
+{
+	return static_cast<PluginAllocator *>(userData)->reallocate(ptr, oldSize, newSize);
+}
+
+void *Plugins::PluginAllocator::reallocate(void *ptr, size_t oldSize, size_t newSize)
+{
+	// When a new block is being allocated, Lua passes the type of the object
+	// the block is for in oldSize, rather than a size.
+	if (!ptr)
+	{
+		oldSize = 0;
+	}
+
+	if (newSize == 0)
+	{
+		if (ptr)
+		{
+			freeBlock(ptr, oldSize);
+			m_stats.bytesInUse -= oldSize;
+		}
+
+		return nullptr;
+	}
+
+	// Requests that shrink a block are never refused, since Lua doesn't
+	// expect them to fail.
+	if (newSize > oldSize && m_stats.bytesInUse - oldSize + newSize > m_hardLimit)
+	{
+		m_stats.numRefusedAllocations++;
+		return nullptr;
+	}
+
+	void *newPtr;
+
+	if (ptr && oldSize > MAX_POOLED_SIZE && newSize > MAX_POOLED_SIZE)
+	{
+		newPtr = realloc(ptr, newSize);
+
+		if (!newPtr)
+		{
+			return nullptr;
+		}
+
+		m_stats.bytesReserved = m_stats.bytesReserved - oldSize + newSize;
+	}
+	else if (ptr && oldSize <= MAX_POOLED_SIZE && newSize <= MAX_POOLED_SIZE
+		&& getSizeClass(oldSize) == getSizeClass(newSize))
+	{
+		// The existing block is already the right size.
+		newPtr = ptr;
+	}
+	else
+	{
+		newPtr = allocateBlock(newSize);
+
+		if (!newPtr)
+		{
+			return nullptr;
+		}
+
+		if (ptr)
+		{
+			memcpy(newPtr, ptr, (std::min)(oldSize, newSize));
+			freeBlock(ptr, oldSize);
+		}
+	}
+
+	m_stats.bytesInUse = m_stats.bytesInUse - oldSize + newSize;
+	m_stats.peakBytesInUse = (std::max)(m_stats.peakBytesInUse, m_stats.bytesInUse);
+	m_stats.numAllocations++;
+
+	return newPtr;
+}
+
+size_t Plugins::PluginAllocator::getSizeClass(size_t size)
+{
+	return (size - 1) / SIZE_CLASS_GRANULARITY;
+}
+
+void *Plugins::PluginAllocator::allocateBlock(size_t size)
+{
+	if (size > MAX_POOLED_SIZE)
+	{
+		void *block = malloc(size);
+
+		if (block)
+		{
+			m_stats.bytesReserved += size;
+		}
+
+		return block;
+	}
+
+	size_t sizeClass = getSizeClass(size);
+	FreeBlock *&freeList = m_freeLists[sizeClass];
+
+	if (freeList)
+	{
+		FreeBlock *block = freeList;
+		freeList = block->next;
+		return block;
+	}
+
+	size_t blockSize = (sizeClass + 1) * SIZE_CLASS_GRANULARITY;
+
+	// Any space left at the end of the current chunk is simply abandoned.
+	// Since the largest block is much smaller than a chunk, the amount wasted
+	// is small.
+	if (m_chunkRemaining < blockSize)
+	{
+		auto chunk = std::unique_ptr<std::byte[]>(new (std::nothrow) std::byte[CHUNK_SIZE]);
+
+		if (!chunk)
+		{
+			return nullptr;
+		}
+
+		m_chunkPosition = chunk.get();
+		m_chunkRemaining = CHUNK_SIZE;
+		m_chunks.push_back(std::move(chunk));
+		m_stats.bytesReserved += CHUNK_SIZE;
+	}
+
+	void *block = m_chunkPosition;
+	m_chunkPosition += blockSize;
+	m_chunkRemaining -= blockSize;
+	return block;
+}
+
+void Plugins::PluginAllocator::freeBlock(void *ptr, size_t size)
+{
+	if (size > MAX_POOLED_SIZE)
+	{
+		free(ptr);
+		m_stats.bytesReserved -= size;
+		return;
+	}
+
+	auto *block = static_cast<FreeBlock *>(ptr);
+	FreeBlock *&freeList = m_freeLists[getSizeClass(size)];
+	block->next = freeList;
+	freeList = block;
+}
+
+bool Plugins::PluginAllocator::isOverSoftLimit() const
+{
+	return m_stats.bytesInUse > m_softLimit;
+}
+
+size_t Plugins::PluginAllocator::getSoftLimit() const
+{
+	return m_softLimit;
+}
+
+size_t Plugins::PluginAllocator::getHardLimit() const
+{
+	return m_hardLimit;
+}
+
+const Plugins::PluginAllocator::Stats &Plugins::PluginAllocator::getStats() const
+{
+	return m_stats;
+}
\ No newline at end of file
@@ -0,0 +1,100 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "../Helper/Macros.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Plugins
+{
+	// The allocation function (lua_Alloc) for a single plugin's Lua state.
+	//
+	// Most Lua allocations are small (strings, tables, closures, etc.), so
+	// blocks up to MAX_POOLED_SIZE are taken from a free list for their size
+	// class, with new blocks being carved out of larger chunks. Freed blocks
+	// are kept for reuse by the same state, rather than being returned to the
+	// shared heap. Larger blocks are allocated from the heap directly.
+	//
+	// Every byte handed to the state is counted, so the memory used by each
+	// plugin can be reported. Once the hard limit is reached, any request that
+	// would grow the state is refused. Lua responds to that by running an
+	// emergency collection and, if that doesn't free enough memory, by raising
+	// a memory error within the plugin. Exceeding the soft limit only sets a
+	// flag; it's up to the owner to act on it.
+	//
+	// A Lua state is only ever used from a single thread, so this class isn't
+	// thread safe.
+	class PluginAllocator
+	{
+	public:
+
+		struct Stats
+		{
+			// The number of bytes currently allocated by the Lua state.
+			size_t bytesInUse = 0;
+			size_t peakBytesInUse = 0;
+
+			// The amount of memory held on behalf of the state. This includes
+			// pooled blocks that are currently free.
+			size_t bytesReserved = 0;
+
+			uint64_t numAllocations = 0;
+			uint64_t numRefusedAllocations = 0;
+		};
+
+		PluginAllocator(size_t softLimit, size_t hardLimit);
+
+		// Can be passed to lua_newstate (or sol::state), with a pointer to the
+		// allocator as the user data.
+		static void *allocate(void *userData, void *ptr, size_t oldSize, size_t newSize);
+
+		// Behaves like lua_Alloc. Blocks are always freed (or resized) with the
+		// size they were last allocated with.
+		void *reallocate(void *ptr, size_t oldSize, size_t newSize);
+
+		bool isOverSoftLimit() const;
+		size_t getSoftLimit() const;
+		size_t getHardLimit() const;
+		const Stats &getStats() const;
+
+	private:
+
+		DISALLOW_COPY_AND_ASSIGN(PluginAllocator);
+
+		struct FreeBlock
+		{
+			FreeBlock *next;
+		};
+
+		// Both of these are multiples of the alignment guaranteed by operator
+		// new and malloc (which is at least as strict as the alignment Lua
+		// requires), so every pooled block is suitably aligned.
+		static constexpr size_t SIZE_CLASS_GRANULARITY = 16;
+		static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+		static constexpr size_t MAX_POOLED_SIZE = 512;
+		static constexpr size_t NUM_SIZE_CLASSES = MAX_POOLED_SIZE / SIZE_CLASS_GRANULARITY;
+
+		static size_t getSizeClass(size_t size);
+		void *allocateBlock(size_t size);
+		void freeBlock(void *ptr, size_t size);
+
+		const size_t m_softLimit;
+		const size_t m_hardLimit;
+
+		std::array<FreeBlock *, NUM_SIZE_CLASSES> m_freeLists = {};
+		std::vector<std::unique_ptr<std::byte[]>> m_chunks;
+
+		// The unused portion of the most recently allocated chunk.
+		std::byte *m_chunkPosition = nullptr;
+		size_t m_chunkRemaining = 0;
+
+		Stats m_stats;
+	};
+}
\ No newline at end of file
@@ -8,6 +8,8 @@
 #include <optional>
 #include <unordered_map>
 
+class AcceleratorUpdater;
+
 namespace Plugins
 {
 	struct Command;
@@ -18,7 +20,7 @@ namespace Plugins
 
 		typedef boost::signals2::signal<void(int, const std::wstring &)> CommandInvokedSignal;
 
-		PluginCommandManager(HACCEL *acceleratorTable, int startId, int endId);
+		PluginCommandManager(AcceleratorUpdater *acceleratorUpdater, int startId, int endId);
 
 		void addCommands(int pluginId, const std::vector<Command> &commands);
 
@@ -34,7 +36,7 @@ namespace Plugins
 			std::wstring name;
 		};
 
-		HACCEL *m_acceleratorTable;
+		AcceleratorUpdater *m_acceleratorUpdater;
 		const int m_startId;
 		const int m_endId;
 
@@ -0,0 +1,278 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "Plugins/PluginDirectoryWatcher.h"
+#include "Plugins/PluginEventQueue.h"
+
+Plugins::PluginDirectoryWatcher::PluginDirectoryWatcher(PluginEventQueue *pluginEventQueue,
+	ScheduleDeliveryCallback scheduleDelivery) :
+	m_pluginEventQueue(pluginEventQueue),
+	m_scheduleDelivery(std::move(scheduleDelivery)),
+	m_deliveryScheduled(false),
+	m_watchIdCounter(1)
+{
+
+}
+
+std::optional<int> Plugins::PluginDirectoryWatcher::addWatch(IDirectoryMonitor *directoryMonitor,
+	int pluginId, const std::wstring &path, bool recursive, ChangeCallback callback)
+{
+	int watchId;
+
+	{
+		std::scoped_lock lock(m_mutex);
+
+		watchId = m_watchIdCounter++;
+
+		Watch watch;
+		watch.pluginId = pluginId;
+		watch.monitorId = -1;
+		watch.callback = std::move(callback);
+		m_watches.emplace(watchId, std::move(watch));
+	}
+
+	// The directory monitor takes ownership of this and frees it once the watch ends.
+	auto *monitorData = static_cast<MonitorData *>(malloc(sizeof(MonitorData)));
+
+	if (!monitorData)
+	{
+		std::scoped_lock lock(m_mutex);
+		m_watches.erase(watchId);
+		return std::nullopt;
+	}
+
+	monitorData->watcher = this;
+	monitorData->watchId = watchId;
+
+	int monitorId = directoryMonitor->WatchDirectory(path.c_str(),
+		FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_SIZE
+			| FILE_NOTIFY_CHANGE_ATTRIBUTES | FILE_NOTIFY_CHANGE_LAST_WRITE
+			| FILE_NOTIFY_CHANGE_CREATION,
+		onDirectoryAltered, recursive, monitorData);
+
+	std::scoped_lock lock(m_mutex);
+
+	if (monitorId == -1)
+	{
+		m_watches.erase(watchId);
+		return std::nullopt;
+	}
+
+	m_watches.at(watchId).monitorId = monitorId;
+
+	return watchId;
+}
+
+void Plugins::PluginDirectoryWatcher::removeWatch(IDirectoryMonitor *directoryMonitor, int watchId)
+{
+	int monitorId;
+
+	{
+		std::scoped_lock lock(m_mutex);
+
+		auto itr = m_watches.find(watchId);
+
+		if (itr == m_watches.end())
+		{
+			return;
+		}
+
+		monitorId = itr->second.monitorId;
+		m_watches.erase(itr);
+	}
+
+	// Notifications that are already being processed will still arrive once the watch has been
+	// stopped. They'll be ignored, since the watch id is no longer valid.
+	directoryMonitor->StopDirectoryMonitor(monitorId);
+}
+
+void Plugins::PluginDirectoryWatcher::onDirectoryAltered(
+	const std::vector<DirectoryChange> &changes, bool overflowed, void *data)
+{
+	auto *monitorData = static_cast<MonitorData *>(data);
+	monitorData->watcher->onDirectoryAltered(monitorData->watchId, changes, overflowed);
+}
+
+void Plugins::PluginDirectoryWatcher::onDirectoryAltered(int watchId,
+	const std::vector<DirectoryChange> &changes, bool overflowed)
+{
+	bool scheduleDelivery = false;
+
+	{
+		std::scoped_lock lock(m_mutex);
+
+		auto itr = m_watches.find(watchId);
+
+		if (itr == m_watches.end())
+		{
+			return;
+		}
+
+		Watch &watch = itr->second;
+
+		if (overflowed)
+		{
+			// The individual changes that have been collected so far are no longer useful, since
+			// the plugin will need to rescan the directory anyway.
+			watch.coalescer.TakeChanges();
+			watch.pendingRenameOldName.reset();
+			watch.overflowed = true;
+		}
+		else if (!watch.overflowed)
+		{
+			for (const auto &change : changes)
+			{
+				addChangeToWatch(watch, change);
+			}
+		}
+
+		if (!watch.pending)
+		{
+			watch.pending = true;
+			m_pendingWatchIds.push_back(watchId);
+		}
+
+		if (!m_deliveryScheduled)
+		{
+			m_deliveryScheduled = true;
+			scheduleDelivery = true;
+		}
+	}
+
+	if (scheduleDelivery)
+	{
+		m_scheduleDelivery();
+	}
+}
+
+void Plugins::PluginDirectoryWatcher::addChangeToWatch(Watch &watch, const DirectoryChange &change)
+{
+	if (watch.pendingRenameOldName && change.action != FILE_ACTION_RENAMED_NEW_NAME)
+	{
+		// The new name was never reported (e.g. because the item was moved out of the watched
+		// directory), so the item has effectively been removed.
+		watch.coalescer.RemoveItem(*watch.pendingRenameOldName, {});
+		watch.pendingRenameOldName.reset();
+	}
+
+	switch (change.action)
+	{
+	case FILE_ACTION_ADDED:
+		watch.coalescer.AddItem(change.fileName, {});
+		break;
+
+	case FILE_ACTION_REMOVED:
+		watch.coalescer.RemoveItem(change.fileName, {});
+		break;
+
+	case FILE_ACTION_MODIFIED:
+		watch.coalescer.ModifyItem(change.fileName, {});
+		break;
+
+	case FILE_ACTION_RENAMED_OLD_NAME:
+		watch.pendingRenameOldName = change.fileName;
+		break;
+
+	case FILE_ACTION_RENAMED_NEW_NAME:
+		if (watch.pendingRenameOldName)
+		{
+			watch.coalescer.RenameItem(*watch.pendingRenameOldName, {}, change.fileName, {});
+			watch.pendingRenameOldName.reset();
+		}
+		else
+		{
+			// The item was moved into the watched directory from elsewhere.
+			watch.coalescer.AddItem(change.fileName, {});
+		}
+		break;
+	}
+}
+
+void Plugins::PluginDirectoryWatcher::deliverChanges()
+{
+	struct PendingBatch
+	{
+		int pluginId;
+		int watchId;
+		ChangeBatch batch;
+	};
+
+	std::vector<PendingBatch> pendingBatches;
+
+	{
+		std::scoped_lock lock(m_mutex);
+
+		for (int watchId : m_pendingWatchIds)
+		{
+			auto itr = m_watches.find(watchId);
+
+			if (itr == m_watches.end())
+			{
+				continue;
+			}
+
+			Watch &watch = itr->second;
+
+			if (watch.pendingRenameOldName)
+			{
+				watch.coalescer.RemoveItem(*watch.pendingRenameOldName, {});
+				watch.pendingRenameOldName.reset();
+			}
+
+			ChangeBatch batch;
+			batch.overflowed = watch.overflowed;
+
+			for (auto &change : watch.coalescer.TakeChanges())
+			{
+				if (change.type == ChangeType::Renamed)
+				{
+					batch.changes.push_back(
+						{ change.type, std::move(change.key), std::move(change.originalKey) });
+				}
+				else
+				{
+					batch.changes.push_back({ change.type, std::move(change.originalKey) });
+				}
+			}
+
+			watch.overflowed = false;
+			watch.pending = false;
+
+			if (batch.changes.empty() && !batch.overflowed)
+			{
+				continue;
+			}
+
+			pendingBatches.push_back({ watch.pluginId, watchId, std::move(batch) });
+		}
+
+		m_pendingWatchIds.clear();
+		m_deliveryScheduled = false;
+	}
+
+	for (auto &pendingBatch : pendingBatches)
+	{
+		m_pluginEventQueue->queueEvent(pendingBatch.pluginId,
+			[this, watchId = pendingBatch.watchId, batch = std::move(pendingBatch.batch)] {
+				ChangeCallback callback;
+
+				{
+					std::scoped_lock lock(m_mutex);
+
+					auto itr = m_watches.find(watchId);
+
+					// The watch may have been removed while the batch was queued.
+					if (itr == m_watches.end())
+					{
+						return;
+					}
+
+					callback = itr->second.callback;
+				}
+
+				callback(watchId, batch);
+			});
+	}
+}
\ No newline at end of file
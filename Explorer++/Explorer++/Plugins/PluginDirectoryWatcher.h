@@ -0,0 +1,122 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "ShellBrowser/ShellChangeCoalescer.h"
+#include "../Helper/Macros.h"
+#include "../Helper/iDirectoryMonitor.h"
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+namespace Plugins
+{
+	class PluginEventQueue;
+
+	// Watches directories on behalf of plugins, using the shared directory
+	// monitor. Notifications arrive on the monitor's worker threads and are
+	// merged into a single set of net changes for each watch (so that, for
+	// example, a file that's created and then deleted produces no change at
+	// all). The accumulated changes are then handed to the plugin as one
+	// batch, through the plugin event queue, on the UI thread.
+	//
+	// While a batch is waiting to be delivered, any further notifications are
+	// merged into it, so a busy directory results in a small number of large
+	// batches, rather than a call into the plugin for every change.
+	class PluginDirectoryWatcher
+	{
+	public:
+
+		using ChangeType = ShellChangeCoalescer<std::monostate>::ChangeType;
+
+		struct Change
+		{
+			ChangeType type;
+
+			// Both names are relative to the watched directory. The old name is
+			// only set for renamed items.
+			std::wstring name;
+			std::wstring oldName;
+		};
+
+		struct ChangeBatch
+		{
+			std::vector<Change> changes;
+
+			// Set if the system couldn't record all the changes that occurred.
+			// The directory should be rescanned in that case.
+			bool overflowed = false;
+		};
+
+		// Invoked on the UI thread, from the plugin event queue.
+		using ChangeCallback = std::function<void(int watchId, const ChangeBatch &batch)>;
+
+		// Called on a background thread when changes become available. The
+		// callback should arrange for deliverChanges() to be called on the UI
+		// thread.
+		using ScheduleDeliveryCallback = std::function<void()>;
+
+		PluginDirectoryWatcher(PluginEventQueue *pluginEventQueue,
+			ScheduleDeliveryCallback scheduleDelivery);
+
+		// Returns the id of the watch, or std::nullopt if the directory can't be
+		// watched.
+		std::optional<int> addWatch(IDirectoryMonitor *directoryMonitor, int pluginId,
+			const std::wstring &path, bool recursive, ChangeCallback callback);
+
+		// Changes that have already been collected for the watch are dropped,
+		// even if they've been queued for delivery.
+		void removeWatch(IDirectoryMonitor *directoryMonitor, int watchId);
+
+		void deliverChanges();
+
+	private:
+
+		DISALLOW_COPY_AND_ASSIGN(PluginDirectoryWatcher);
+
+		struct Watch
+		{
+			int pluginId;
+			int monitorId;
+			ChangeCallback callback;
+
+			ShellChangeCoalescer<std::monostate> coalescer;
+			bool overflowed = false;
+			bool pending = false;
+
+			// Set when a rename notification has been received for the old name
+			// of an item, but not yet for the new name.
+			std::optional<std::wstring> pendingRenameOldName;
+		};
+
+		// Passed to the directory monitor, which frees it (using free()) once
+		// the watch has ended. Only the watch id is stored, since notifications
+		// can still arrive after the watch has been removed.
+		struct MonitorData
+		{
+			PluginDirectoryWatcher *watcher;
+			int watchId;
+		};
+
+		static void onDirectoryAltered(const std::vector<DirectoryChange> &changes,
+			bool overflowed, void *data);
+		void onDirectoryAltered(int watchId, const std::vector<DirectoryChange> &changes,
+			bool overflowed);
+		static void addChangeToWatch(Watch &watch, const DirectoryChange &change);
+
+		PluginEventQueue *const m_pluginEventQueue;
+		const ScheduleDeliveryCallback m_scheduleDelivery;
+
+		std::mutex m_mutex;
+		std::unordered_map<int, Watch> m_watches;
+		std::vector<int> m_pendingWatchIds;
+		bool m_deliveryScheduled;
+		int m_watchIdCounter;
+	};
+}
\ No newline at end of file
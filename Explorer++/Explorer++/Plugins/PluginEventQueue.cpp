@@ -0,0 +1,173 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "Plugins/PluginEventQueue.h"
+#include "../Helper/Logging.h"
+
+namespace
+{
+	// Used to limit how often a plugin that's persistently slow is logged.
+	bool IsPowerOfTen(int value)
+	{
+		while (value >= 10 && value % 10 == 0)
+		{
+			value /= 10;
+		}
+
+		return value == 1;
+	}
+}
+
+Plugins::PluginEventQueue::PluginEventQueue(ScheduleDeliveryCallback scheduleDelivery,
+	Clock::duration budget, ClockFunction clock) :
+	m_scheduleDelivery(scheduleDelivery),
+	m_budget(budget),
+	m_clock(clock),
+	m_deliveryScheduled(false)
+{
+
+}
+
+void Plugins::PluginEventQueue::registerPlugin(int pluginId, const std::wstring &name,
+	BatchDeliveredCallback batchDelivered)
+{
+	m_pluginNames[pluginId] = name;
+
+	if (batchDelivered)
+	{
+		m_batchDeliveredCallbacks[pluginId] = std::move(batchDelivered);
+	}
+}
+
+void Plugins::PluginEventQueue::queueEvent(int pluginId, std::function<void()> event)
+{
+	m_events.push_back({ pluginId, std::move(event) });
+
+	if (!m_deliveryScheduled)
+	{
+		m_deliveryScheduled = true;
+		m_scheduleDelivery();
+	}
+}
+
+void Plugins::PluginEventQueue::deliverEvents()
+{
+	// Any events raised by the observers themselves will be placed into the
+	// (now empty) queue and delivered in the next batch.
+	m_deliveringEvents = std::move(m_events);
+	m_events.clear();
+	m_deliveryScheduled = false;
+
+	std::unordered_map<int, std::pair<Clock::duration, int>> batchTimes;
+
+	// The events are accessed by index, since discardEvents() may be called
+	// while an observer is running.
+	for (size_t i = 0; i < m_deliveringEvents.size(); i++)
+	{
+		if (!m_deliveringEvents[i].callback)
+		{
+			continue;
+		}
+
+		int pluginId = m_deliveringEvents[i].pluginId;
+		auto callback = std::move(m_deliveringEvents[i].callback);
+
+		auto start = m_clock();
+		callback();
+		auto end = m_clock();
+
+		auto &batchTime = batchTimes[pluginId];
+		batchTime.first += end - start;
+		batchTime.second++;
+	}
+
+	m_deliveringEvents.clear();
+
+	for (const auto &[pluginId, batchTime] : batchTimes)
+	{
+		recordBatchTime(pluginId, batchTime.first, batchTime.second);
+	}
+
+	for (const auto &[pluginId, batchTime] : batchTimes)
+	{
+		// The callback is looked up each time (and copied before being
+		// invoked), since a callback may result in another plugin being
+		// unloaded.
+		auto itr = m_batchDeliveredCallbacks.find(pluginId);
+
+		if (itr != m_batchDeliveredCallbacks.end())
+		{
+			auto batchDelivered = itr->second;
+			batchDelivered();
+		}
+	}
+}
+
+void Plugins::PluginEventQueue::recordBatchTime(int pluginId, Clock::duration batchTime,
+	int numEvents)
+{
+	auto &timing = m_pluginTimings[pluginId];
+	timing.totalTime += batchTime;
+	timing.longestBatchTime = (std::max)(timing.longestBatchTime, batchTime);
+	timing.numEventsDelivered += numEvents;
+
+	if (batchTime <= m_budget)
+	{
+		return;
+	}
+
+	timing.numBatchesOverBudget++;
+
+	if (IsPowerOfTen(timing.numBatchesOverBudget))
+	{
+		LOG(warning) << L"Plugin \"" << getPluginName(pluginId) << L"\" took "
+					 << std::chrono::duration_cast<std::chrono::milliseconds>(batchTime).count()
+					 << L" ms to handle " << numEvents << L" event(s) (budget "
+					 << std::chrono::duration_cast<std::chrono::milliseconds>(m_budget).count()
+					 << L" ms, exceeded " << timing.numBatchesOverBudget << L" time(s))";
+	}
+}
+
+void Plugins::PluginEventQueue::discardEvents(int pluginId)
+{
+	std::erase_if(m_events, [pluginId](const QueuedEvent &event) {
+		return event.pluginId == pluginId;
+	});
+
+	m_batchDeliveredCallbacks.erase(pluginId);
+
+	for (auto &event : m_deliveringEvents)
+	{
+		if (event.pluginId == pluginId)
+		{
+			event.callback = nullptr;
+		}
+	}
+}
+
+Plugins::PluginEventQueue::PluginTiming Plugins::PluginEventQueue::getPluginTiming(
+	int pluginId) const
+{
+	auto itr = m_pluginTimings.find(pluginId);
+
+	if (itr == m_pluginTimings.end())
+	{
+		return {};
+	}
+
+	return itr->second;
+}
+
+std::wstring Plugins::PluginEventQueue::getPluginName(int pluginId) const
+{
+	auto itr = m_pluginNames.find(pluginId);
+
+	if (itr == m_pluginNames.end())
+	{
+		return L"#" + std::to_wstring(pluginId);
+	}
+
+	return itr->second;
+}
\ No newline at end of file
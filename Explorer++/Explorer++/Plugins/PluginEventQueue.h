@@ -0,0 +1,93 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "../Helper/Macros.h"
+#include <chrono>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Plugins
+{
+	// Plugin observers aren't invoked directly from the signals they're
+	// attached to. Instead, each event is queued here and the queue is
+	// delivered in a single batch once the UI operation that raised the events
+	// has finished. That way, a slow observer can't hold up the operation
+	// itself.
+	//
+	// The time spent in each plugin's observers is also measured, so that
+	// plugins that regularly exceed the budget can be identified.
+	class PluginEventQueue
+	{
+	public:
+
+		using Clock = std::chrono::steady_clock;
+		using ClockFunction = std::function<Clock::time_point()>;
+
+		// Called when the first event is queued into an empty queue. The
+		// callback should arrange for deliverEvents() to be called once the
+		// current UI work has completed (e.g. by posting a message).
+		using ScheduleDeliveryCallback = std::function<void()>;
+
+		// Called once a batch of the plugin's events has been delivered. The
+		// plugin's Lua state isn't running any of its own code at that point,
+		// so this can be used for housekeeping (e.g. garbage collection).
+		using BatchDeliveredCallback = std::function<void()>;
+
+		struct PluginTiming
+		{
+			Clock::duration totalTime = Clock::duration::zero();
+			Clock::duration longestBatchTime = Clock::duration::zero();
+			int numEventsDelivered = 0;
+			int numBatchesOverBudget = 0;
+		};
+
+		// Roughly the length of a single frame.
+		static constexpr Clock::duration DEFAULT_BUDGET = std::chrono::milliseconds(16);
+
+		PluginEventQueue(ScheduleDeliveryCallback scheduleDelivery,
+			Clock::duration budget = DEFAULT_BUDGET, ClockFunction clock = Clock::now);
+
+		void registerPlugin(int pluginId, const std::wstring &name,
+			BatchDeliveredCallback batchDelivered = nullptr);
+		void queueEvent(int pluginId, std::function<void()> event);
+		void deliverEvents();
+
+		// Drops any pending events for the plugin and stops invoking its batch
+		// delivered callback. This needs to be called before the plugin's Lua
+		// state is destroyed, since the queued events hold references into
+		// that state.
+		void discardEvents(int pluginId);
+
+		PluginTiming getPluginTiming(int pluginId) const;
+
+	private:
+
+		DISALLOW_COPY_AND_ASSIGN(PluginEventQueue);
+
+		struct QueuedEvent
+		{
+			int pluginId;
+			std::function<void()> callback;
+		};
+
+		void recordBatchTime(int pluginId, Clock::duration batchTime, int numEvents);
+		std::wstring getPluginName(int pluginId) const;
+
+		const ScheduleDeliveryCallback m_scheduleDelivery;
+		const Clock::duration m_budget;
+		const ClockFunction m_clock;
+
+		std::vector<QueuedEvent> m_events;
+		std::vector<QueuedEvent> m_deliveringEvents;
+		bool m_deliveryScheduled;
+
+		std::unordered_map<int, std::wstring> m_pluginNames;
+		std::unordered_map<int, PluginTiming> m_pluginTimings;
+		std::unordered_map<int, BatchDeliveredCallback> m_batchDeliveredCallbacks;
+	};
+}
\ No newline at end of file
@@ -5,10 +5,13 @@
 #include "stdafx.h"
 #include "Plugins/PluginManager.h"
 #include "AcceleratorUpdater.h"
+#include "Plugins/LuaBytecodeCache.h"
 #include "Plugins/Manifest.h"
 #include "Plugins/PluginCommandManager.h"
-#include "../ThirdParty/Sol/forward.hpp"
+#include "SolWrapper.h"
+#include "../ThirdParty/CTPL/cpl_stl.h"
 #include <filesystem>
+#include <future>
 
 const std::wstring Plugins::PluginManager::MANIFEST_NAME = L"plugin.json";
 
@@ -23,6 +26,7 @@ Plugins::PluginManager::PluginManager(PluginInterface *pluginInterface) :
 void Plugins::PluginManager::loadAllPlugins(const std::filesystem::path &pluginDirectory)
 {
 	std::error_code error;
+	std::vector<std::filesystem::path> pluginDirectories;
 
 	/* TODO: Ideally, any error would be logged somewhere. For now, it's
 	ignored. */
@@ -33,29 +37,81 @@ void Plugins::PluginManager::loadAllPlugins(const std::filesystem::path &pluginD
 
 		if (!statusError && std::filesystem::is_directory(status))
 		{
-			/* TODO: This should return an error code, perhaps using
-			something like std::expected or boost::outcome, once either
-			is available. */
-			attemptToLoadPlugin(entry);
+			pluginDirectories.push_back(entry);
 		}
 	}
+
+	if (pluginDirectories.empty())
+	{
+		return;
+	}
+
+	int numThreads = static_cast<int>((std::min)(pluginDirectories.size(),
+		static_cast<size_t>((std::max)(std::thread::hardware_concurrency(), 1u))));
+	ctpl::thread_pool threadPool(numThreads);
+
+	std::vector<std::future<std::optional<PreparedPlugin>>> preparedPlugins;
+
+	for (const auto &directory : pluginDirectories)
+	{
+		preparedPlugins.push_back(threadPool.push([directory] (int id) {
+			UNREFERENCED_PARAMETER(id);
+
+			return preparePlugin(directory);
+		}));
+	}
+
+	// Each plugin adds its shortcuts as it's registered. Batching the
+	// changes means the accelerator table is only rebuilt once, after all
+	// the plugins have been registered.
+	auto *acceleratorUpdater = m_pluginInterface->GetAccleratorUpdater();
+	acceleratorUpdater->beginBatch();
+
+	// Plugins are registered in directory order, regardless of the order in
+	// which the preparation tasks finish, so that the set of command IDs
+	// assigned is the same each time.
+	for (auto &preparedPlugin : preparedPlugins)
+	{
+		auto result = preparedPlugin.get();
+
+		if (!result)
+		{
+			continue;
+		}
+
+		/* TODO: This should return an error code, perhaps using
+		something like std::expected or boost::outcome, once either
+		is available. */
+		registerPlugin(*result);
+	}
+
+	acceleratorUpdater->endBatch();
 }
 
-bool Plugins::PluginManager::attemptToLoadPlugin(const std::filesystem::path &directory)
+std::optional<Plugins::PluginManager::PreparedPlugin> Plugins::PluginManager::preparePlugin(
+	const std::filesystem::path &directory)
 {
 	auto manifestPath = directory / MANIFEST_NAME;
 	auto manifest = parseManifest(manifestPath);
 
 	if (!manifest)
 	{
-		return false;
+		return std::nullopt;
 	}
 
-	return registerPlugin(directory, *manifest);
+	PreparedPlugin preparedPlugin;
+	preparedPlugin.directory = directory;
+	preparedPlugin.manifest = *manifest;
+	preparedPlugin.compiledScript = loadCompiledScript(directory / manifest->file);
+
+	return preparedPlugin;
 }
 
-bool Plugins::PluginManager::registerPlugin(const std::filesystem::path &directory, const Manifest &manifest)
+bool Plugins::PluginManager::registerPlugin(const PreparedPlugin &preparedPlugin)
 {
+	const auto &directory = preparedPlugin.directory;
+	const auto &manifest = preparedPlugin.manifest;
+
 	auto plugin = std::make_unique<LuaPlugin>(directory.wstring(), manifest, m_pluginInterface);
 
 	for (auto library : manifest.libraries)
@@ -83,7 +139,10 @@ bool Plugins::PluginManager::registerPlugin(const std::filesystem::path &directo
 
 	try
 	{
-		plugin->GetLuaState().safe_script_file(pluginFile.string());
+		if (!runCompiledScript(plugin->GetLuaState(), preparedPlugin, pluginFile))
+		{
+			plugin->GetLuaState().safe_script_file(pluginFile.string());
+		}
 	}
 	catch (const sol::error &)
 	{
@@ -116,6 +175,47 @@ bool Plugins::PluginManager::registerPlugin(const std::filesystem::path &directo
 	return true;
 }
 
+std::vector<Plugins::PluginManager::PluginMemoryUsage>
+Plugins::PluginManager::getMemoryUsage() const
+{
+	std::vector<PluginMemoryUsage> memoryUsage;
+
+	for (const auto &plugin : m_plugins)
+	{
+		memoryUsage.push_back({ plugin->GetManifest().name, plugin->GetMemoryStats() });
+	}
+
+	return memoryUsage;
+}
+
+bool Plugins::PluginManager::runCompiledScript(sol::state &state, const PreparedPlugin &preparedPlugin,
+	const std::filesystem::path &pluginFile)
+{
+	if (!preparedPlugin.compiledScript)
+	{
+		return false;
+	}
+
+	const auto &compiledScript = *preparedPlugin.compiledScript;
+	auto loadResult = state.load_buffer(compiledScript.data(), compiledScript.size(),
+		"@" + pluginFile.string(), sol::load_mode::binary);
+
+	// If the cached bytecode can't be loaded for whatever reason, the script
+	// will be loaded from source instead.
+	if (!loadResult.valid())
+	{
+		return false;
+	}
+
+	sol::protected_function script = loadResult;
+
+	// As in registerPlugin(), any error raised by the script itself is
+	// ignored.
+	script();
+
+	return true;
+}
+
 std::vector<ShortcutKey> convertPluginShortcutKeys(const std::vector<Plugins::PluginShortcutKey> &pluginShortcutKeys)
 {
 	std::vector<ShortcutKey> shortcutKeys;
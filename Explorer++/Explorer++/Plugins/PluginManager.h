@@ -6,31 +6,49 @@
 
 #include "Plugins/LuaPlugin.h"
 #include "PluginInterface.h"
-
-namespace std
-{
-	namespace filesystem
-	{
-		class path;
-	}
-}
+#include <filesystem>
+#include <optional>
 
 namespace Plugins
 {
+	// Plugins are loaded in two stages. The first stage (parsing the manifest
+	// and compiling the main script) doesn't depend on any application state,
+	// so it's run on a set of worker threads, one plugin per task. The second
+	// stage, which creates the Lua state, runs the script and registers the
+	// plugin's commands, then runs on the calling (UI) thread.
 	class PluginManager
 	{
 	public:
 
+		struct PluginMemoryUsage
+		{
+			std::wstring name;
+			LuaPlugin::MemoryStats stats;
+		};
+
 		PluginManager(PluginInterface *pluginInterface);
 
 		void loadAllPlugins(const std::filesystem::path &pluginDirectory);
+		std::vector<PluginMemoryUsage> getMemoryUsage() const;
 
 	private:
 
+		struct PreparedPlugin
+		{
+			std::filesystem::path directory;
+			Manifest manifest;
+
+			// Will be empty if the script couldn't be precompiled, in which
+			// case it will be loaded from source instead.
+			std::optional<std::string> compiledScript;
+		};
+
 		static const std::wstring MANIFEST_NAME;
 
-		bool attemptToLoadPlugin(const std::filesystem::path &directory);
-		bool registerPlugin(const std::filesystem::path &directory, const Manifest &manifest);
+		static std::optional<PreparedPlugin> preparePlugin(const std::filesystem::path &directory);
+		bool registerPlugin(const PreparedPlugin &preparedPlugin);
+		static bool runCompiledScript(sol::state &state, const PreparedPlugin &preparedPlugin,
+			const std::filesystem::path &pluginFile);
 
 		PluginInterface *m_pluginInterface;
 
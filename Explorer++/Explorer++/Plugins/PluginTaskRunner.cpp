@@ -0,0 +1,42 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "Plugins/PluginTaskRunner.h"
+#include "Plugins/PluginEventQueue.h"
+
+Plugins::PluginTaskRunner::PluginTaskRunner(PluginEventQueue *pluginEventQueue,
+	ScheduleDeliveryCallback scheduleDelivery) :
+	m_pluginEventQueue(pluginEventQueue),
+	m_completedTasks(std::move(scheduleDelivery)),
+	m_taskScheduler(NUM_THREADS)
+{
+
+}
+
+void Plugins::PluginTaskRunner::runTask(int pluginId, const void *owner, Task task)
+{
+	m_taskScheduler.PostTask(owner, std::nullopt, 0, [this, pluginId, task = std::move(task)] {
+		m_completedTasks.Push({ pluginId, task() });
+	});
+}
+
+void Plugins::PluginTaskRunner::cancelTasks(const void *owner)
+{
+	m_taskScheduler.CancelTasks(owner, true);
+}
+
+void Plugins::PluginTaskRunner::deliverCompletions()
+{
+	// Queuing an event is cheap, so every completion is handed over at once.
+	// The time taken by the plugins themselves is then measured (and limited)
+	// by the event queue.
+	while (m_completedTasks.ProcessResults(PluginEventQueue::DEFAULT_BUDGET,
+		[this](CompletedTask &completedTask) {
+			m_pluginEventQueue->queueEvent(completedTask.pluginId,
+				std::move(completedTask.completion));
+		}))
+	{
+	}
+}
\ No newline at end of file
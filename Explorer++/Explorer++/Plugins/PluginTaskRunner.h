@@ -0,0 +1,69 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "../Helper/Macros.h"
+#include "../Helper/PriorityTaskScheduler.h"
+#include "../Helper/ResultChannel.h"
+#include <functional>
+
+namespace Plugins
+{
+	class PluginEventQueue;
+
+	// Runs work on behalf of plugins on a set of background threads, so that
+	// a plugin waiting on something slow (e.g. enumerating a large folder)
+	// doesn't block the UI thread.
+	//
+	// Each task returns a completion, which is delivered to the plugin
+	// through the plugin event queue, on the UI thread. A completion can be
+	// invoked after the plugin that started the task has been unloaded, so it
+	// shouldn't hold any references into the plugin's Lua state.
+	class PluginTaskRunner
+	{
+	public:
+
+		using Completion = std::function<void()>;
+		using Task = std::function<Completion()>;
+
+		// Called on a background thread when a completion becomes available.
+		// The callback should arrange for deliverCompletions() to be called
+		// on the UI thread.
+		using ScheduleDeliveryCallback = std::function<void()>;
+
+		PluginTaskRunner(PluginEventQueue *pluginEventQueue,
+			ScheduleDeliveryCallback scheduleDelivery);
+
+		void runTask(int pluginId, const void *owner, Task task);
+
+		// Removes any of the owner's tasks that haven't started yet and waits
+		// for any that are running to finish.
+		void cancelTasks(const void *owner);
+
+		void deliverCompletions();
+
+	private:
+
+		DISALLOW_COPY_AND_ASSIGN(PluginTaskRunner);
+
+		struct CompletedTask
+		{
+			int pluginId;
+			Completion completion;
+		};
+
+		// Plugin tasks can run for a long time (e.g. while a file is being
+		// copied), so they're kept separate from the threads used by the
+		// listview.
+		static const int NUM_THREADS = 2;
+
+		PluginEventQueue *m_pluginEventQueue;
+		ResultChannel<CompletedTask> m_completedTasks;
+
+		// Declared last, so that the threads are stopped before anything they
+		// use is destroyed.
+		PriorityTaskScheduler m_taskScheduler;
+	};
+}
\ No newline at end of file
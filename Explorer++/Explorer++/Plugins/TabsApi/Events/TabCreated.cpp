@@ -8,27 +8,35 @@
 #include "SolWrapper.h"
 #include "TabContainer.h"
 
-Plugins::TabCreated::TabCreated(TabContainer *tabContainer) :
+Plugins::TabCreated::TabCreated(TabContainer *tabContainer, PluginEventQueue *pluginEventQueue, int pluginId) :
+	Event(pluginEventQueue, pluginId),
 	m_tabContainer(tabContainer)
 {
 
 }
 
-boost::signals2::connection Plugins::TabCreated::connectObserver(sol::protected_function observer, sol::this_state state)
+boost::signals2::connection Plugins::TabCreated::connectObserver(sol::protected_function observer, sol::this_state state,
+	ObserverDispatcher dispatch)
 {
 	UNREFERENCED_PARAMETER(state);
 
-	return m_tabContainer->tabCreatedSignal.AddObserver([this, observer](int tabId, BOOL switchToNewTab) {
+	return m_tabContainer->tabCreatedSignal.AddObserver([this, observer, dispatch](int tabId, BOOL switchToNewTab) {
 		UNREFERENCED_PARAMETER(switchToNewTab);
 
-		onTabCreated(tabId, observer);
+		onTabCreated(tabId, observer, dispatch);
 	});
 }
 
-void Plugins::TabCreated::onTabCreated(int tabId, sol::protected_function observer)
+void Plugins::TabCreated::onTabCreated(int tabId, sol::protected_function observer,
+	ObserverDispatcher dispatch)
 {
 	const Tab &tabInternal = m_tabContainer->GetTab(tabId);
 
+	// The tab may have changed (or been closed) by the time the observer
+	// runs, so its details are captured now.
 	TabsApi::Tab tab(tabInternal);
-	observer(tab);
+
+	dispatch([observer, tab]() {
+		observer(tab);
+	});
 }
\ No newline at end of file
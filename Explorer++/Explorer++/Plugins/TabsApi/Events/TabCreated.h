@@ -14,15 +14,16 @@ namespace Plugins
 	{
 	public:
 
-		TabCreated(TabContainer *tabContainer);
+		TabCreated(TabContainer *tabContainer, PluginEventQueue *pluginEventQueue, int pluginId);
 
 	protected:
 
-		boost::signals2::connection connectObserver(sol::protected_function observer, sol::this_state state) override;
+		boost::signals2::connection connectObserver(sol::protected_function observer, sol::this_state state,
+			ObserverDispatcher dispatch) override;
 
 	private:
 
-		void onTabCreated(int tabId, sol::protected_function observer);
+		void onTabCreated(int tabId, sol::protected_function observer, ObserverDispatcher dispatch);
 
 		TabContainer *m_tabContainer;
 	};
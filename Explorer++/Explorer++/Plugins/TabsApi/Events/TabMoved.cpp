@@ -7,17 +7,21 @@
 #include "SolWrapper.h"
 #include "TabContainer.h"
 
-Plugins::TabMoved::TabMoved(TabContainer *tabContainer) :
+Plugins::TabMoved::TabMoved(TabContainer *tabContainer, PluginEventQueue *pluginEventQueue, int pluginId) :
+	Event(pluginEventQueue, pluginId),
 	m_tabContainer(tabContainer)
 {
 
 }
 
-boost::signals2::connection Plugins::TabMoved::connectObserver(sol::protected_function observer, sol::this_state state)
+boost::signals2::connection Plugins::TabMoved::connectObserver(sol::protected_function observer, sol::this_state state,
+	ObserverDispatcher dispatch)
 {
 	UNREFERENCED_PARAMETER(state);
 
-	return m_tabContainer->tabMovedSignal.AddObserver([observer] (const Tab &tab, int fromIndex, int toIndex) {
-		observer(tab.GetId(), fromIndex, toIndex);
+	return m_tabContainer->tabMovedSignal.AddObserver([observer, dispatch] (const Tab &tab, int fromIndex, int toIndex) {
+		dispatch([observer, tabId = tab.GetId(), fromIndex, toIndex]() {
+			observer(tabId, fromIndex, toIndex);
+		});
 	});
 }
\ No newline at end of file
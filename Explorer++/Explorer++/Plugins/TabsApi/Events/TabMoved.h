@@ -14,11 +14,12 @@ namespace Plugins
 	{
 	public:
 
-		TabMoved(TabContainer *tabContainer);
+		TabMoved(TabContainer *tabContainer, PluginEventQueue *pluginEventQueue, int pluginId);
 
 	protected:
 
-		boost::signals2::connection connectObserver(sol::protected_function observer, sol::this_state state) override;
+		boost::signals2::connection connectObserver(sol::protected_function observer, sol::this_state state,
+			ObserverDispatcher dispatch) override;
 
 	private:
 
@@ -7,15 +7,21 @@
 #include "SolWrapper.h"
 #include "TabContainer.h"
 
-Plugins::TabRemoved::TabRemoved(TabContainer *tabContainer) :
+Plugins::TabRemoved::TabRemoved(TabContainer *tabContainer, PluginEventQueue *pluginEventQueue, int pluginId) :
+	Event(pluginEventQueue, pluginId),
 	m_tabContainer(tabContainer)
 {
 
 }
 
-boost::signals2::connection Plugins::TabRemoved::connectObserver(sol::protected_function observer, sol::this_state state)
+boost::signals2::connection Plugins::TabRemoved::connectObserver(sol::protected_function observer, sol::this_state state,
+	ObserverDispatcher dispatch)
 {
 	UNREFERENCED_PARAMETER(state);
 
-	return m_tabContainer->tabRemovedSignal.AddObserver(observer);
+	return m_tabContainer->tabRemovedSignal.AddObserver([observer, dispatch] (int tabId) {
+		dispatch([observer, tabId]() {
+			observer(tabId);
+		});
+	});
 }
\ No newline at end of file
@@ -8,38 +8,46 @@
 #include "SolWrapper.h"
 #include "TabContainer.h"
 
-Plugins::TabUpdated::TabUpdated(TabContainer *tabContainer) :
+Plugins::TabUpdated::TabUpdated(TabContainer *tabContainer, PluginEventQueue *pluginEventQueue, int pluginId) :
+	Event(pluginEventQueue, pluginId),
 	m_tabContainer(tabContainer)
 {
 
 }
 
-boost::signals2::connection Plugins::TabUpdated::connectObserver(sol::protected_function observer, sol::this_state state)
+boost::signals2::connection Plugins::TabUpdated::connectObserver(sol::protected_function observer, sol::this_state state,
+	ObserverDispatcher dispatch)
 {
-	return m_tabContainer->tabUpdatedSignal.AddObserver([this, observer, state] (const Tab &tab, Tab::PropertyType propertyType) {
-		onTabUpdated(observer, state, tab, propertyType);
+	return m_tabContainer->tabUpdatedSignal.AddObserver([this, observer, state, dispatch] (const Tab &tab, Tab::PropertyType propertyType) {
+		onTabUpdated(observer, state, dispatch, tab, propertyType);
 	});
 }
 
 void Plugins::TabUpdated::onTabUpdated(sol::protected_function observer, sol::this_state state,
-	const Tab &tab, Tab::PropertyType propertyType)
+	ObserverDispatcher dispatch, const Tab &tab, Tab::PropertyType propertyType)
 {
-	sol::state_view existingState = state;
+	// The changed values are captured now, since the tab may have been
+	// updated again by the time the observer runs.
+	std::wstring name = tab.GetName();
+	Tab::LockState lockState = tab.GetLockState();
+	TabsApi::Tab tabData(tab);
 
-	sol::table changeInfo = existingState.create_table();
+	dispatch([observer, state, tabId = tab.GetId(), propertyType, name, lockState, tabData]() {
+		sol::state_view existingState = state;
 
-	switch (propertyType)
-	{
-	case Tab::PropertyType::Name:
-		changeInfo["name"] = tab.GetName();
-		break;
+		sol::table changeInfo = existingState.create_table();
 
-	case Tab::PropertyType::LockState:
-		changeInfo["lockState"] = tab.GetLockState();
-		break;
-	}
+		switch (propertyType)
+		{
+		case Tab::PropertyType::Name:
+			changeInfo["name"] = name;
+			break;
 
-	TabsApi::Tab tabData(tab);
+		case Tab::PropertyType::LockState:
+			changeInfo["lockState"] = lockState;
+			break;
+		}
 
-	observer(tab.GetId(), changeInfo, tabData);
+		observer(tabId, changeInfo, tabData);
+	});
 }
\ No newline at end of file
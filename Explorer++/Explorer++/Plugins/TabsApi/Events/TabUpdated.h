@@ -15,15 +15,17 @@ namespace Plugins
 	{
 	public:
 
-		TabUpdated(TabContainer *tabContainer);
+		TabUpdated(TabContainer *tabContainer, PluginEventQueue *pluginEventQueue, int pluginId);
 
 	protected:
 
-		boost::signals2::connection connectObserver(sol::protected_function observer, sol::this_state state) override;
+		boost::signals2::connection connectObserver(sol::protected_function observer, sol::this_state state,
+			ObserverDispatcher dispatch) override;
 
 	private:
 
-		void onTabUpdated(sol::protected_function observer, sol::this_state state, const Tab &tab, Tab::PropertyType propertyType);
+		void onTabUpdated(sol::protected_function observer, sol::this_state state, ObserverDispatcher dispatch,
+			const Tab &tab, Tab::PropertyType propertyType);
 
 		TabContainer *m_tabContainer;
 	};
@@ -8,10 +8,12 @@
 #include "ShellBrowser/ShellBrowser.h"
 #include "ShellBrowser/ShellNavigationController.h"
 
-PreservedTab::PreservedTab(const Tab &tab, int index) :
-	id(tab.GetId()),
+int PreservedTab::idCounter = 1;
+
+PreservedTab::PreservedTab(const Tab &tab, int index, SharedPidlStore &pidlStore) :
+	id(idCounter++),
 	index(index),
-	history(CopyHistoryEntries(tab)),
+	history(CopyHistoryEntries(tab, pidlStore)),
 	currentEntry(tab.GetShellBrowser()->GetNavigationController()->GetCurrentIndex()),
 	useCustomName(tab.GetUseCustomName()),
 	customName(tab.GetUseCustomName() ? tab.GetName() : std::wstring()),
@@ -20,9 +22,24 @@ PreservedTab::PreservedTab(const Tab &tab, int index) :
 {
 }
 
+PreservedTab::PreservedTab(int index, std::vector<std::unique_ptr<PreservedHistoryEntry>> history,
+	int currentEntry, bool useCustomName, const std::wstring &customName,
+	Tab::LockState lockState, const FolderSettings &folderSettings) :
+	id(idCounter++),
+	index(index),
+	history(std::move(history)),
+	currentEntry(currentEntry),
+	useCustomName(useCustomName),
+	customName(customName),
+	lockState(lockState),
+	preservedFolderState(folderSettings)
+{
+}
+
 PreservedTab::~PreservedTab() = default;
 
-std::vector<std::unique_ptr<PreservedHistoryEntry>> PreservedTab::CopyHistoryEntries(const Tab &tab)
+std::vector<std::unique_ptr<PreservedHistoryEntry>> PreservedTab::CopyHistoryEntries(
+	const Tab &tab, SharedPidlStore &pidlStore)
 {
 	std::vector<std::unique_ptr<PreservedHistoryEntry>> history;
 
@@ -30,7 +47,7 @@ std::vector<std::unique_ptr<PreservedHistoryEntry>> PreservedTab::CopyHistoryEnt
 		 i++)
 	{
 		auto entry = std::make_unique<PreservedHistoryEntry>(
-			*tab.GetShellBrowser()->GetNavigationController()->GetEntryAtIndex(i));
+			*tab.GetShellBrowser()->GetNavigationController()->GetEntryAtIndex(i), pidlStore);
 		history.push_back(std::move(entry));
 	}
 
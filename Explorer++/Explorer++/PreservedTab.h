@@ -7,14 +7,20 @@
 #include "ShellBrowser/PreservedFolderState.h"
 #include "Tab.h"
 #include "../Helper/Macros.h"
+#include "../Helper/SharedPidlStore.h"
 
 struct PreservedHistoryEntry;
 
 struct PreservedTab
 {
-	PreservedTab(const Tab &tab, int index);
+	PreservedTab(const Tab &tab, int index, SharedPidlStore &pidlStore);
+	PreservedTab(int index, std::vector<std::unique_ptr<PreservedHistoryEntry>> history,
+		int currentEntry, bool useCustomName, const std::wstring &customName,
+		Tab::LockState lockState, const FolderSettings &folderSettings);
 	~PreservedTab();
 
+	// Identifies the preserved tab. This is distinct from the ID of the original tab, since a
+	// preserved tab may have come from a previous session.
 	int id;
 	int index;
 
@@ -30,5 +36,8 @@ struct PreservedTab
 private:
 	DISALLOW_COPY_AND_ASSIGN(PreservedTab);
 
-	static std::vector<std::unique_ptr<PreservedHistoryEntry>> CopyHistoryEntries(const Tab &tab);
+	static std::vector<std::unique_ptr<PreservedHistoryEntry>> CopyHistoryEntries(
+		const Tab &tab, SharedPidlStore &pidlStore);
+
+	static int idCounter;
 };
\ No newline at end of file
@@ -0,0 +1,251 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "QuickFilterBar.h"
+#include "CoreInterface.h"
+#include "MainResource.h"
+#include "ResourceHelper.h"
+#include "ShellBrowser/ShellBrowser.h"
+#include "Tab.h"
+#include "TabContainer.h"
+#include "../Helper/DpiCompatibility.h"
+#include "../Helper/WindowHelper.h"
+
+QuickFilterBar *QuickFilterBar::Create(HWND parent, IExplorerplusplus *expp)
+{
+	return new QuickFilterBar(parent, expp);
+}
+
+QuickFilterBar::QuickFilterBar(HWND parent, IExplorerplusplus *expp) :
+	BaseWindow(CreateQuickFilterBar(parent)),
+	m_expp(expp),
+	m_height(0),
+	m_shown(false)
+{
+	Initialize(parent);
+}
+
+HWND QuickFilterBar::CreateQuickFilterBar(HWND parent)
+{
+	return CreateWindowEx(WS_EX_CLIENTEDGE, WC_EDIT, EMPTY_STRING,
+		WS_CHILD | WS_CLIPSIBLINGS | ES_AUTOHSCROLL, 0, 0, 0, 0, parent, nullptr,
+		GetModuleHandle(nullptr), nullptr);
+}
+
+void QuickFilterBar::Initialize(HWND parent)
+{
+	auto &dpiCompat = DpiCompatibility::GetInstance();
+	UINT dpi = dpiCompat.GetDpiForWindow(m_hwnd);
+
+	NONCLIENTMETRICS ncm;
+	ncm.cbSize = sizeof(ncm);
+	dpiCompat.SystemParametersInfoForDpi(
+		SPI_GETNONCLIENTMETRICS, sizeof(NONCLIENTMETRICS), &ncm, 0, dpi);
+	m_font.reset(CreateFontIndirect(&ncm.lfMessageFont));
+
+	if (m_font)
+	{
+		SendMessage(
+			m_hwnd, WM_SETFONT, reinterpret_cast<WPARAM>(m_font.get()), MAKELPARAM(TRUE, 0));
+	}
+
+	m_height = MulDiv(HEIGHT_96DPI, dpi, USER_DEFAULT_SCREEN_DPI);
+
+	std::wstring cueBanner =
+		ResourceHelper::LoadString(m_expp->GetLanguageModule(), IDS_QUICK_FILTER_CUE_BANNER);
+	Edit_SetCueBannerTextFocused(m_hwnd, cueBanner.c_str(), TRUE);
+
+	m_windowSubclasses.push_back(std::make_unique<WindowSubclassWrapper>(
+		m_hwnd, EditSubclassStub, SUBCLASS_ID, reinterpret_cast<DWORD_PTR>(this)));
+	m_windowSubclasses.push_back(std::make_unique<WindowSubclassWrapper>(
+		parent, ParentWndProcStub, PARENT_SUBCLASS_ID, reinterpret_cast<DWORD_PTR>(this)));
+
+	m_expp->AddTabsInitializedObserver(
+		[this]
+		{
+			m_connections.push_back(m_expp->GetTabContainer()->tabSelectedSignal.AddObserver(
+				std::bind_front(&QuickFilterBar::OnTabSelected, this)));
+		});
+}
+
+LRESULT CALLBACK QuickFilterBar::EditSubclassStub(
+	HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam, UINT_PTR uIdSubclass, DWORD_PTR dwRefData)
+{
+	UNREFERENCED_PARAMETER(uIdSubclass);
+
+	auto *quickFilterBar = reinterpret_cast<QuickFilterBar *>(dwRefData);
+	return quickFilterBar->EditSubclass(hwnd, uMsg, wParam, lParam);
+}
+
+LRESULT CALLBACK QuickFilterBar::EditSubclass(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
+{
+	switch (msg)
+	{
+	case WM_KEYDOWN:
+		switch (wParam)
+		{
+		case VK_ESCAPE:
+			Hide();
+			return 0;
+
+		case VK_RETURN:
+		case VK_DOWN:
+			SetFocus(m_expp->GetActiveListView());
+			return 0;
+		}
+		break;
+
+	// Prevents the edit control from beeping when these keys are pressed.
+	case WM_CHAR:
+		if (wParam == VK_ESCAPE || wParam == VK_RETURN)
+		{
+			return 0;
+		}
+		break;
+	}
+
+	return DefSubclassProc(hwnd, msg, wParam, lParam);
+}
+
+LRESULT CALLBACK QuickFilterBar::ParentWndProcStub(
+	HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam, UINT_PTR uIdSubclass, DWORD_PTR dwRefData)
+{
+	UNREFERENCED_PARAMETER(uIdSubclass);
+
+	auto *quickFilterBar = reinterpret_cast<QuickFilterBar *>(dwRefData);
+	return quickFilterBar->ParentWndProc(hwnd, uMsg, wParam, lParam);
+}
+
+LRESULT CALLBACK QuickFilterBar::ParentWndProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
+{
+	switch (uMsg)
+	{
+	case WM_COMMAND:
+		if (reinterpret_cast<HWND>(lParam) == m_hwnd && HIWORD(wParam) == EN_CHANGE)
+		{
+			OnTextChanged();
+			return 0;
+		}
+		break;
+	}
+
+	return DefSubclassProc(hwnd, uMsg, wParam, lParam);
+}
+
+bool QuickFilterBar::IsShown() const
+{
+	return m_shown;
+}
+
+void QuickFilterBar::Show()
+{
+	if (!m_shown)
+	{
+		m_shown = true;
+		ShowWindow(m_hwnd, SW_SHOW);
+		visibilityChangedSignal.m_signal(true);
+	}
+
+	SetFocus(m_hwnd);
+	Edit_SetSel(m_hwnd, 0, -1);
+}
+
+void QuickFilterBar::Hide()
+{
+	if (!m_shown)
+	{
+		return;
+	}
+
+	// This will restore the filter that was previously set in the tab.
+	SetWindowText(m_hwnd, EMPTY_STRING);
+
+	m_shown = false;
+	ShowWindow(m_hwnd, SW_HIDE);
+	visibilityChangedSignal.m_signal(false);
+
+	SetFocus(m_expp->GetActiveListView());
+}
+
+int QuickFilterBar::GetHeight() const
+{
+	return m_height;
+}
+
+// Each change to the text results in the filter being updated. When characters are appended, the
+// new filter is narrower than the previous one, so only the items that are currently shown need to
+// be tested again.
+void QuickFilterBar::OnTextChanged()
+{
+	std::wstring text = GetWindowString(m_hwnd);
+
+	if (text.empty())
+	{
+		RestoreFilter();
+		return;
+	}
+
+	const Tab &selectedTab = m_expp->GetTabContainer()->GetSelectedTab();
+	ShellBrowser *shellBrowser = selectedTab.GetShellBrowser();
+
+	if (!m_savedFilter)
+	{
+		m_savedFilter = { selectedTab.GetId(), shellBrowser->GetFilter(),
+			shellBrowser->GetFilterStatus() == TRUE };
+	}
+
+	shellBrowser->SetFilter(BuildFilterPattern(text));
+
+	if (!shellBrowser->GetFilterStatus())
+	{
+		shellBrowser->SetFilterStatus(TRUE);
+	}
+}
+
+void QuickFilterBar::RestoreFilter()
+{
+	if (!m_savedFilter)
+	{
+		return;
+	}
+
+	Tab *tab = m_expp->GetTabContainer()->GetTabOptional(m_savedFilter->tabId);
+
+	if (tab)
+	{
+		ShellBrowser *shellBrowser = tab->GetShellBrowser();
+
+		// If the filter is still applied, setting it will result in the items being filtered
+		// again. If not, the filter is removed first, so that the items only have to be updated
+		// once.
+		if (!m_savedFilter->filterApplied)
+		{
+			shellBrowser->SetFilterStatus(FALSE);
+		}
+
+		shellBrowser->SetFilter(m_savedFilter->filter);
+	}
+
+	m_savedFilter.reset();
+}
+
+void QuickFilterBar::OnTabSelected(const Tab &tab)
+{
+	UNREFERENCED_PARAMETER(tab);
+
+	// The quick filter only applies to the tab that was selected when the text was entered.
+	SetWindowText(m_hwnd, EMPTY_STRING);
+}
+
+// Text that doesn't contain any wildcards is matched anywhere within an item's name.
+std::wstring QuickFilterBar::BuildFilterPattern(const std::wstring &text)
+{
+	if (text.find_first_of(L"*?:") != std::wstring::npos)
+	{
+		return text;
+	}
+
+	return L"*" + text + L"*";
+}
\ No newline at end of file
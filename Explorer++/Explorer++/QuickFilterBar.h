@@ -0,0 +1,79 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "SignalWrapper.h"
+#include "../Helper/BaseWindow.h"
+#include "../Helper/WindowSubclassWrapper.h"
+#include <boost/signals2.hpp>
+#include <wil/resource.h>
+#include <optional>
+#include <string>
+#include <vector>
+
+__interface IExplorerplusplus;
+class Tab;
+
+// An edit control, shown above the listview, that filters the items in the selected tab as text is
+// typed into it. The quick filter is applied using the tab's existing filter, which is restored
+// once the text is cleared (or a different tab is selected).
+class QuickFilterBar : public BaseWindow
+{
+public:
+	static QuickFilterBar *Create(HWND parent, IExplorerplusplus *expp);
+
+	bool IsShown() const;
+	void Show();
+	void Hide();
+
+	int GetHeight() const;
+
+	SignalWrapper<QuickFilterBar, void(bool shown)> visibilityChangedSignal;
+
+private:
+	static const UINT_PTR SUBCLASS_ID = 0;
+	static const UINT_PTR PARENT_SUBCLASS_ID = 0;
+
+	static constexpr int HEIGHT_96DPI = 22;
+
+	struct SavedFilter
+	{
+		int tabId;
+		std::wstring filter;
+		bool filterApplied;
+	};
+
+	QuickFilterBar(HWND parent, IExplorerplusplus *expp);
+	~QuickFilterBar() = default;
+
+	static HWND CreateQuickFilterBar(HWND parent);
+
+	void Initialize(HWND parent);
+
+	static LRESULT CALLBACK EditSubclassStub(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam,
+		UINT_PTR uIdSubclass, DWORD_PTR dwRefData);
+	LRESULT CALLBACK EditSubclass(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
+
+	static LRESULT CALLBACK ParentWndProcStub(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam,
+		UINT_PTR uIdSubclass, DWORD_PTR dwRefData);
+	LRESULT CALLBACK ParentWndProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
+
+	void OnTextChanged();
+	void RestoreFilter();
+	void OnTabSelected(const Tab &tab);
+
+	static std::wstring BuildFilterPattern(const std::wstring &text);
+
+	IExplorerplusplus *m_expp;
+	wil::unique_hfont m_font;
+	int m_height;
+	bool m_shown;
+
+	// The filter that the selected tab had before the quick filter was applied to it.
+	std::optional<SavedFilter> m_savedFilter;
+
+	std::vector<std::unique_ptr<WindowSubclassWrapper>> m_windowSubclasses;
+	std::vector<boost::signals2::scoped_connection> m_connections;
+};
\ No newline at end of file
@@ -15,7 +15,10 @@
 #include "TabContainer.h"
 #include "../Helper/Macros.h"
 #include "../Helper/RegistrySettings.h"
+#include "../Helper/RegistryValueCache.h"
+#include "../Helper/ShellHelper.h"
 #include <boost/range/adaptor/map.hpp>
+#include <wil/resource.h>
 
 namespace
 {
@@ -40,7 +43,8 @@ BOOL LoadWindowPositionFromRegistry(WINDOWPLACEMENT *pwndpl)
 	{
 		DWORD dwSize = sizeof(WINDOWPLACEMENT);
 
-		RegQueryValueEx(hSettingsKey, _T("Position"), nullptr, nullptr, (LPBYTE) pwndpl, &dwSize);
+		RegistrySettings::QueryValue(
+			hSettingsKey, _T("Position"), nullptr, (LPBYTE) pwndpl, &dwSize);
 
 		if (dwSize == sizeof(WINDOWPLACEMENT) && pwndpl->length == sizeof(WINDOWPLACEMENT))
 		{
@@ -143,7 +147,7 @@ LONG Explorerplusplus::SaveGenericSettingsToRegistry()
 		RegistrySettings::SaveDword(
 			hSettingsKey, _T("ShowUserNameTitleBar"), m_config->showUserNameInTitleBar.get());
 		RegistrySettings::SaveDword(
-			hSettingsKey, _T("AllowMultipleInstances"), m_config->allowMultipleInstances);
+			hSettingsKey, _T("AllowMultipleInstances"), m_config->allowMultipleInstances.get());
 		RegistrySettings::SaveDword(
 			hSettingsKey, _T("OneClickActivate"), m_config->globalFolderSettings.oneClickActivate);
 		RegistrySettings::SaveDword(hSettingsKey, _T("OneClickActivateHoverTime"),
@@ -189,6 +193,20 @@ LONG Explorerplusplus::SaveGenericSettingsToRegistry()
 			m_config->globalFolderSettings.displayMixedFilesAndFolders);
 		RegistrySettings::SaveDword(hSettingsKey, _T("UseNaturalSortOrder"),
 			m_config->globalFolderSettings.useNaturalSortOrder);
+		RegistrySettings::SaveDword(hSettingsKey, _T("VirtualListViewThreshold"),
+			m_config->virtualListViewThreshold);
+		RegistrySettings::SaveDword(
+			hSettingsKey, _T("UseGridRenderer"), m_config->useGridRenderer);
+		RegistrySettings::SaveDword(hSettingsKey, _T("PersistFolderSizes"),
+			m_config->persistFolderSizes);
+		RegistrySettings::SaveDword(hSettingsKey, _T("UseNativeFileTransfers"),
+			m_config->useNativeFileTransfers);
+		RegistrySettings::SaveDword(hSettingsKey, _T("FileTransferBandwidthLimit"),
+			m_config->fileTransferBandwidthLimit);
+		RegistrySettings::SaveDword(hSettingsKey, _T("PersistIconCache"),
+			m_config->persistIconCache);
+		RegistrySettings::SaveDword(hSettingsKey, _T("PersistClosedTabs"),
+			m_config->persistClosedTabs);
 
 		/* Global settings. */
 		RegistrySettings::SaveDword(
@@ -278,6 +296,10 @@ LONG Explorerplusplus::LoadGenericSettingsFromRegistry()
 
 	if (returnValue == ERROR_SUCCESS)
 	{
+		// There are a large number of settings, many of which won't have been stored, so the key
+		// is read in full once, rather than being queried for each setting.
+		RegistryValueCache settingsValues(hSettingsKey);
+
 		/* User settings. */
 		RegistrySettings::Read32BitValueFromRegistry(
 			hSettingsKey, _T("LastSelectedTab"), m_iLastSelectedTab);
@@ -358,8 +380,8 @@ LONG Explorerplusplus::LoadGenericSettingsFromRegistry()
 		m_config->globalFolderSettings.sizeDisplayFormat =
 			static_cast<SizeDisplayFormat>(numericValue);
 
-		RegistrySettings::Read32BitValueFromRegistry(
-			hSettingsKey, _T("AllowMultipleInstances"), m_config->allowMultipleInstances);
+		RegistrySettings::ReadDword(hSettingsKey, _T("AllowMultipleInstances"), &numericValue);
+		m_config->allowMultipleInstances.set(numericValue);
 		RegistrySettings::Read32BitValueFromRegistry(
 			hSettingsKey, _T("OneClickActivate"), m_config->globalFolderSettings.oneClickActivate);
 		RegistrySettings::Read32BitValueFromRegistry(hSettingsKey, _T("OneClickActivateHoverTime"),
@@ -424,6 +446,20 @@ LONG Explorerplusplus::LoadGenericSettingsFromRegistry()
 			m_config->globalFolderSettings.displayMixedFilesAndFolders);
 		RegistrySettings::Read32BitValueFromRegistry(hSettingsKey, _T("UseNaturalSortOrder"),
 			m_config->globalFolderSettings.useNaturalSortOrder);
+		RegistrySettings::Read32BitValueFromRegistry(hSettingsKey, _T("VirtualListViewThreshold"),
+			m_config->virtualListViewThreshold);
+		RegistrySettings::Read32BitValueFromRegistry(
+			hSettingsKey, _T("UseGridRenderer"), m_config->useGridRenderer);
+		RegistrySettings::Read32BitValueFromRegistry(hSettingsKey, _T("PersistFolderSizes"),
+			m_config->persistFolderSizes);
+		RegistrySettings::Read32BitValueFromRegistry(hSettingsKey, _T("UseNativeFileTransfers"),
+			m_config->useNativeFileTransfers);
+		RegistrySettings::Read32BitValueFromRegistry(hSettingsKey,
+			_T("FileTransferBandwidthLimit"), m_config->fileTransferBandwidthLimit);
+		RegistrySettings::Read32BitValueFromRegistry(hSettingsKey, _T("PersistIconCache"),
+			m_config->persistIconCache);
+		RegistrySettings::Read32BitValueFromRegistry(hSettingsKey, _T("PersistClosedTabs"),
+			m_config->persistClosedTabs);
 
 		/* Global settings. */
 		RegistrySettings::Read32BitValueFromRegistry(
@@ -466,8 +502,8 @@ LONG Explorerplusplus::LoadGenericSettingsFromRegistry()
 		dwType = REG_BINARY;
 		dwSize = sizeof(surroundColor);
 
-		surroundColorStatus = RegQueryValueEx(hSettingsKey, _T("DisplaySurroundColor"), nullptr,
-			&dwType, (LPBYTE) &surroundColor, &dwSize);
+		surroundColorStatus = RegistrySettings::QueryValue(hSettingsKey,
+			_T("DisplaySurroundColor"), &dwType, (LPBYTE) &surroundColor, &dwSize);
 
 		if (surroundColorStatus == ERROR_SUCCESS)
 		{
@@ -477,8 +513,8 @@ LONG Explorerplusplus::LoadGenericSettingsFromRegistry()
 		dwType = REG_BINARY;
 		dwSize = sizeof(centreColor);
 
-		centreColorStatus = RegQueryValueEx(hSettingsKey, _T("DisplayCentreColor"), nullptr,
-			&dwType, (LPBYTE) &centreColor, &dwSize);
+		centreColorStatus = RegistrySettings::QueryValue(
+			hSettingsKey, _T("DisplayCentreColor"), &dwType, (LPBYTE) &centreColor, &dwSize);
 
 		if (centreColorStatus == ERROR_SUCCESS)
 		{
@@ -488,8 +524,8 @@ LONG Explorerplusplus::LoadGenericSettingsFromRegistry()
 		dwType = REG_BINARY;
 		dwSize = sizeof(textColor);
 
-		textColorStatus = RegQueryValueEx(
-			hSettingsKey, _T("DisplayTextColor"), nullptr, &dwType, (LPBYTE) &textColor, &dwSize);
+		textColorStatus = RegistrySettings::QueryValue(
+			hSettingsKey, _T("DisplayTextColor"), &dwType, (LPBYTE) &textColor, &dwSize);
 
 		if (textColorStatus == ERROR_SUCCESS)
 		{
@@ -499,8 +535,8 @@ LONG Explorerplusplus::LoadGenericSettingsFromRegistry()
 		dwType = REG_BINARY;
 		dwSize = sizeof(LOGFONT);
 
-		fontStatus = RegQueryValueEx(
-			hSettingsKey, _T("DisplayFont"), nullptr, &dwType, (LPBYTE) &logFont, &dwSize);
+		fontStatus = RegistrySettings::QueryValue(
+			hSettingsKey, _T("DisplayFont"), &dwType, (LPBYTE) &logFont, &dwSize);
 
 		if (fontStatus == ERROR_SUCCESS)
 		{
@@ -569,7 +605,9 @@ void DeleteKey(HKEY hKey)
 
 void Explorerplusplus::SaveBookmarksToRegistry()
 {
-	BookmarkRegistryStorage::Save(NExplorerplusplus::REG_MAIN_KEY, &m_bookmarkTree);
+	BookmarkRegistryStorage::Save(
+		NExplorerplusplus::REG_MAIN_KEY, &m_bookmarkTree, m_bookmarksSavedToRegistryChange);
+	m_bookmarksSavedToRegistryChange = m_bookmarkTree.GetChangeCounter();
 }
 
 void Explorerplusplus::LoadBookmarksFromRegistry()
@@ -747,13 +785,15 @@ int Explorerplusplus::LoadTabSettingsFromRegistry()
 
 		while (returnValue == ERROR_SUCCESS)
 		{
-			if (RegQueryValueEx(hTabKey, _T("Directory"), nullptr, nullptr, nullptr, &cbData)
+			RegistryValueCache tabValues(hTabKey);
+
+			if (RegistrySettings::QueryValue(hTabKey, _T("Directory"), nullptr, nullptr, &cbData)
 				== ERROR_SUCCESS)
 			{
 				pidlDirectory = (PIDLIST_ABSOLUTE) CoTaskMemAlloc(cbData);
 
-				RegQueryValueEx(
-					hTabKey, _T("Directory"), nullptr, &type, (LPBYTE) pidlDirectory, &cbData);
+				RegistrySettings::QueryValue(
+					hTabKey, _T("Directory"), &type, (LPBYTE) pidlDirectory, &cbData);
 			}
 
 			FolderSettings folderSettings;
@@ -789,6 +829,8 @@ int Explorerplusplus::LoadTabSettingsFromRegistry()
 
 			if (returnValue == ERROR_SUCCESS)
 			{
+				RegistryValueCache columnValues(hColumnsKey);
+
 				initialColumns.controlPanelColumns =
 					LoadColumnFromRegistry(hColumnsKey, _T("ControlPanelColumns"));
 				initialColumns.myComputerColumns =
@@ -837,6 +879,7 @@ int Explorerplusplus::LoadTabSettingsFromRegistry()
 
 			tabSettings.index = i;
 			tabSettings.selected = true;
+			tabSettings.deferNavigation = true;
 
 			RegistrySettings::ReadDword(hTabKey, _T("Locked"), &value);
 
@@ -907,8 +950,8 @@ std::vector<ColumnWidth> Explorerplusplus::LoadColumnWidthsFromRegistry(
 	DWORD dwType = REG_BINARY;
 	DWORD dwSize = sizeof(columnWidthData);
 
-	LONG ret = RegQueryValueEx(
-		hColumnsKey, szKeyName, nullptr, &dwType, (LPBYTE) columnWidthData, &dwSize);
+	LONG ret = RegistrySettings::QueryValue(
+		hColumnsKey, szKeyName, &dwType, (LPBYTE) columnWidthData, &dwSize);
 
 	std::vector<ColumnWidth> columnWidths;
 
@@ -949,6 +992,54 @@ void Explorerplusplus::SaveColumnToRegistry(
 	free(pColumnList);
 }
 
+std::optional<std::wstring> Explorerplusplus::LoadTabDirectoryFromRegistry(int index)
+{
+	std::wstring tabKeyPath = std::wstring(REG_TABS_KEY) + L"\\" + std::to_wstring(index);
+
+	wil::unique_hkey tabKey;
+	LONG returnValue =
+		RegOpenKeyEx(HKEY_CURRENT_USER, tabKeyPath.c_str(), 0, KEY_READ, tabKey.put());
+
+	if (returnValue != ERROR_SUCCESS)
+	{
+		return std::nullopt;
+	}
+
+	DWORD cbData;
+	returnValue =
+		RegistrySettings::QueryValue(tabKey.get(), _T("Directory"), nullptr, nullptr, &cbData);
+
+	if (returnValue != ERROR_SUCCESS)
+	{
+		return std::nullopt;
+	}
+
+	unique_pidl_absolute pidlDirectory(static_cast<PIDLIST_ABSOLUTE>(CoTaskMemAlloc(cbData)));
+
+	if (!pidlDirectory)
+	{
+		return std::nullopt;
+	}
+
+	returnValue = RegistrySettings::QueryValue(tabKey.get(), _T("Directory"), nullptr,
+		reinterpret_cast<LPBYTE>(pidlDirectory.get()), &cbData);
+
+	if (returnValue != ERROR_SUCCESS)
+	{
+		return std::nullopt;
+	}
+
+	std::wstring directory;
+	HRESULT hr = GetDisplayName(pidlDirectory.get(), SHGDN_FORPARSING, directory);
+
+	if (FAILED(hr))
+	{
+		return std::nullopt;
+	}
+
+	return directory;
+}
+
 std::vector<Column_t> Explorerplusplus::LoadColumnFromRegistry(
 	HKEY hColumnsKey, const TCHAR *szKeyName)
 {
@@ -961,7 +1052,7 @@ std::vector<Column_t> Explorerplusplus::LoadColumnFromRegistry(
 	dwType = REG_BINARY;
 	dwSize = sizeof(columnList);
 
-	RegQueryValueEx(hColumnsKey, szKeyName, nullptr, &dwType, (LPBYTE) columnList, &dwSize);
+	RegistrySettings::QueryValue(hColumnsKey, szKeyName, &dwType, (LPBYTE) columnList, &dwSize);
 
 	std::vector<Column_t> columns;
 
@@ -1038,6 +1129,8 @@ void Explorerplusplus::LoadDefaultColumnsFromRegistry()
 
 	if (res == ERROR_SUCCESS)
 	{
+		RegistryValueCache columnValues(hColumnsKey);
+
 		auto &defaultFolderColumns = m_config->globalFolderSettings.folderColumns;
 
 		defaultFolderColumns.controlPanelColumns =
@@ -1149,6 +1242,8 @@ void Explorerplusplus::LoadToolbarInformationFromRegistry()
 
 		while (deturnValue == ERROR_SUCCESS)
 		{
+			RegistryValueCache toolbarValues(hToolbarKey);
+
 			BOOL bUseChevron = FALSE;
 
 			if (m_ToolbarInformation[i].fStyle & RBBS_USECHEVRON)
@@ -16,23 +16,35 @@
 #include "../Helper/ComboBox.h"
 #include "../Helper/Controls.h"
 #include "../Helper/DpiCompatibility.h"
+#include "../Helper/DriveInfo.h"
+#include "../Helper/ExtensionIconCache.h"
 #include "../Helper/FileContextMenuManager.h"
 #include "../Helper/Helper.h"
+#include "../Helper/ListViewHelper.h"
 #include "../Helper/Macros.h"
+#include "../Helper/NtfsIndex.h"
+#include "../Helper/ParsedPathCache.h"
 #include "../Helper/RegistrySettings.h"
 #include "../Helper/ShellHelper.h"
+#include "../Helper/ThreadQos.h"
 #include "../Helper/WindowHelper.h"
 #include "../Helper/XMLSettings.h"
-#include <regex>
+#include <wil/resource.h>
+#include <filesystem>
 
 namespace NSearchDialog
 {
-	const int WM_APP_SEARCHITEMFOUND = WM_APP + 1;
+	const int WM_APP_SEARCHRESULTSFOUND = WM_APP + 1;
 	const int WM_APP_SEARCHFINISHED = WM_APP + 2;
-	const int WM_APP_SEARCHCHANGEDDIRECTORY = WM_APP + 3;
 	const int WM_APP_REGULAREXPRESSIONINVALID = WM_APP + 4;
 
-	int CALLBACK SortResultsStub(LPARAM lParam1, LPARAM lParam2, LPARAM lParamSort);
+	/* Sent (via WM_APP_SEARCHRESULTSFOUND) each time a batch
+	of matches is ready. */
+	struct SearchResults
+	{
+		std::vector<SearchResult> items;
+		std::wstring currentFolder;
+	};
 
 	DWORD WINAPI SearchThread(LPVOID pParam);
 	int CALLBACK BrowseCallbackProc(HWND hwnd, UINT uMsg, LPARAM lParam, LPARAM lpData);
@@ -42,9 +54,12 @@ const TCHAR SearchDialogPersistentSettings::SETTINGS_KEY[] = _T("Search");
 
 const TCHAR SearchDialogPersistentSettings::SETTING_COLUMN_WIDTH_1[] = _T("ColumnWidth1");
 const TCHAR SearchDialogPersistentSettings::SETTING_COLUMN_WIDTH_2[] = _T("ColumnWidth2");
+const TCHAR SearchDialogPersistentSettings::SETTING_COLUMN_WIDTH_3[] = _T("ColumnWidth3");
 const TCHAR SearchDialogPersistentSettings::SETTING_SEARCH_DIRECTORY_TEXT[] =
 	_T("SearchDirectoryText");
+const TCHAR SearchDialogPersistentSettings::SETTING_CONTAINING_TEXT[] = _T("ContainingText");
 const TCHAR SearchDialogPersistentSettings::SETTING_SEARCH_SUB_FOLDERS[] = _T("SearchSubFolders");
+const TCHAR SearchDialogPersistentSettings::SETTING_USE_NTFS_INDEX[] = _T("UseNtfsIndex");
 const TCHAR SearchDialogPersistentSettings::SETTING_USE_REGULAR_EXPRESSIONS[] =
 	_T("UseRegularExpressions");
 const TCHAR SearchDialogPersistentSettings::SETTING_CASE_INSENSITIVE[] = _T("CaseInsensitive");
@@ -65,8 +80,7 @@ SearchDialog::SearchDialog(HINSTANCE hInstance, HWND hParent, std::wstring_view
 	m_tabContainer(tabContainer),
 	m_bSearching(FALSE),
 	m_bStopSearching(FALSE),
-	m_bSetSearchTimer(TRUE),
-	m_iInternalIndex(0),
+	m_bRestartSearch(FALSE),
 	m_iPreviousSelectedColumn(-1),
 	m_pSearch(nullptr)
 {
@@ -119,8 +133,9 @@ INT_PTR SearchDialog::OnInitDialog()
 	RECT rc;
 	GetClientRect(hListView, &rc);
 
-	ListView_SetColumnWidth(hListView, 0, (1.0 / 3.0) * GetRectWidth(&rc));
-	ListView_SetColumnWidth(hListView, 1, (1.80 / 3.0) * GetRectWidth(&rc));
+	ListView_SetColumnWidth(hListView, 0, 0.25 * GetRectWidth(&rc));
+	ListView_SetColumnWidth(hListView, 1, 0.40 * GetRectWidth(&rc));
+	ListView_SetColumnWidth(hListView, 2, 0.30 * GetRectWidth(&rc));
 
 	UpdateListViewHeader();
 
@@ -129,6 +144,7 @@ INT_PTR SearchDialog::OnInitDialog()
 	lCheckDlgButton(m_hDlg, IDC_CHECK_READONLY, m_persistentSettings->m_bReadOnly);
 	lCheckDlgButton(m_hDlg, IDC_CHECK_SYSTEM, m_persistentSettings->m_bSystem);
 	lCheckDlgButton(m_hDlg, IDC_CHECK_SEARCHSUBFOLDERS, m_persistentSettings->m_bSearchSubFolders);
+	lCheckDlgButton(m_hDlg, IDC_CHECK_USENTFSINDEX, m_persistentSettings->m_bUseNtfsIndex);
 	lCheckDlgButton(m_hDlg, IDC_CHECK_CASEINSENSITIVE, m_persistentSettings->m_bCaseInsensitive);
 	lCheckDlgButton(
 		m_hDlg, IDC_CHECK_USEREGULAREXPRESSIONS, m_persistentSettings->m_bUseRegularExpressions);
@@ -146,6 +162,8 @@ INT_PTR SearchDialog::OnInitDialog()
 	}
 
 	SetDlgItemText(m_hDlg, IDC_COMBO_NAME, m_persistentSettings->m_szSearchPattern);
+	SetDlgItemText(
+		m_hDlg, IDC_EDIT_CONTAININGTEXT, m_persistentSettings->m_containingText.c_str());
 	SetDlgItemText(m_hDlg, IDC_COMBO_DIRECTORY, m_searchDirectory.c_str());
 
 	ComboBox::CreateNew(GetDlgItem(m_hDlg, IDC_COMBO_NAME));
@@ -161,6 +179,11 @@ INT_PTR SearchDialog::OnInitDialog()
 			ListView_SetColumnWidth(hListView, 0, m_persistentSettings->m_iColumnWidth1);
 			ListView_SetColumnWidth(hListView, 1, m_persistentSettings->m_iColumnWidth2);
 		}
+
+		if (m_persistentSettings->m_iColumnWidth3 != -1)
+		{
+			ListView_SetColumnWidth(hListView, 2, m_persistentSettings->m_iColumnWidth3);
+		}
 	}
 
 	SetFocus(GetDlgItem(m_hDlg, IDC_COMBO_NAME));
@@ -169,7 +192,7 @@ INT_PTR SearchDialog::OnInitDialog()
 	AllowDarkModeForListView(IDC_LISTVIEW_SEARCHRESULTS);
 	AllowDarkModeForCheckboxes({ IDC_CHECK_ARCHIVE, IDC_CHECK_HIDDEN, IDC_CHECK_READONLY,
 		IDC_CHECK_SYSTEM, IDC_CHECK_CASEINSENSITIVE, IDC_CHECK_USEREGULAREXPRESSIONS,
-		IDC_CHECK_SEARCHSUBFOLDERS });
+		IDC_CHECK_SEARCHSUBFOLDERS, IDC_CHECK_USENTFSINDEX });
 	AllowDarkModeForGroupBoxes({ IDC_GROUP_ATTRIBUTES, IDC_GROUP_SEARCH_TYPE });
 	AllowDarkModeForComboBoxes({ IDC_COMBO_NAME, IDC_COMBO_DIRECTORY });
 
@@ -201,6 +224,11 @@ void SearchDialog::GetResizableControlInformation(
 	control.Constraint = ResizableDialog::ControlConstraint::X;
 	ControlList.push_back(control);
 
+	control.iID = IDC_EDIT_CONTAININGTEXT;
+	control.Type = ResizableDialog::ControlType::Resize;
+	control.Constraint = ResizableDialog::ControlConstraint::X;
+	ControlList.push_back(control);
+
 	control.iID = IDC_BUTTON_DIRECTORY;
 	control.Type = ResizableDialog::ControlType::Move;
 	control.Constraint = ResizableDialog::ControlConstraint::X;
@@ -267,6 +295,13 @@ INT_PTR SearchDialog::OnCommand(WPARAM wParam, LPARAM lParam)
 		OnSearch();
 		break;
 
+	case IDC_COMBO_NAME:
+		if (HIWORD(wParam) == CBN_EDITCHANGE)
+		{
+			OnSearchPatternChanged();
+		}
+		break;
+
 	case IDC_BUTTON_DIRECTORY:
 	{
 		BROWSEINFO bi;
@@ -330,23 +365,59 @@ void SearchDialog::OnSearch()
 {
 	if (!m_bSearching)
 	{
-		StartSearching();
+		StartSearching(true);
 	}
 	else
 	{
+		m_bRestartSearch = FALSE;
+		StopSearching();
+	}
+}
+
+void SearchDialog::OnSearchPatternChanged()
+{
+	if (IsDlgButtonChecked(m_hDlg, IDC_CHECK_USENTFSINDEX) != BST_CHECKED)
+	{
+		return;
+	}
+
+	/* This will reset the timer if it's already running. */
+	SetTimer(m_hDlg, INSTANT_SEARCH_TIMER_ID, INSTANT_SEARCH_TIMER_TIMEOUT, nullptr);
+}
+
+INT_PTR SearchDialog::OnTimer(int iTimerID)
+{
+	if (iTimerID != INSTANT_SEARCH_TIMER_ID)
+	{
+		return 0;
+	}
+
+	KillTimer(m_hDlg, INSTANT_SEARCH_TIMER_ID);
+
+	if (m_bSearching)
+	{
+		/* The search will be restarted once the current search
+		has finished. */
+		m_bRestartSearch = TRUE;
 		StopSearching();
 	}
+	else
+	{
+		/* The pattern is only saved to the history when the
+		search is explicitly started. */
+		StartSearching(false);
+	}
+
+	return 0;
 }
 
-void SearchDialog::StartSearching()
+void SearchDialog::StartSearching(bool saveEntries)
 {
 	ShowWindow(GetDlgItem(m_hDlg, IDC_LINK_STATUS), SW_HIDE);
 	ShowWindow(GetDlgItem(m_hDlg, IDC_STATIC_STATUS), SW_SHOW);
 
-	m_AwaitingSearchItems.clear();
-	m_SearchItemsMapInternal.clear();
-
 	ListView_DeleteAllItems(GetDlgItem(m_hDlg, IDC_LISTVIEW_SEARCHRESULTS));
+	m_results.Clear();
 
 	TCHAR szBaseDirectory[MAX_PATH];
 	TCHAR szSearchPattern[MAX_PATH];
@@ -366,6 +437,10 @@ void SearchDialog::StartSearching()
 
 	BOOL bCaseInsensitive = IsDlgButtonChecked(m_hDlg, IDC_CHECK_CASEINSENSITIVE) == BST_CHECKED;
 
+	BOOL bUseNtfsIndex = IsDlgButtonChecked(m_hDlg, IDC_CHECK_USENTFSINDEX) == BST_CHECKED;
+
+	std::wstring containingText = GetWindowString(GetDlgItem(m_hDlg, IDC_EDIT_CONTAININGTEXT));
+
 	/* Turn search patterns of the form '???' into '*???*', and
 	use this modified string to search. */
 	if (!bUseRegularExpressions && lstrlen(szSearchPattern) > 0)
@@ -401,37 +476,45 @@ void SearchDialog::StartSearching()
 		dwAttributes |= FILE_ATTRIBUTE_SYSTEM;
 	}
 
+	bool allowCloudHydration =
+		m_tabContainer->GetSelectedTab().GetShellBrowser()->GetAllowCloudHydration();
+
 	m_pSearch = new Search(m_hDlg, szBaseDirectory, szSearchPattern, dwAttributes,
-		bUseRegularExpressions, bCaseInsensitive, bSearchSubFolders);
+		bUseRegularExpressions, bCaseInsensitive, bSearchSubFolders, bUseNtfsIndex,
+		containingText, allowCloudHydration);
 	m_pSearch->AddRef();
 
-	/* Save the search directory and search pattern (only if they are not
-	the same as the most recent entry). */
-	BOOL bSaveEntry = FALSE;
-
-	if (m_persistentSettings->m_searchDirectories.empty()
-		|| lstrcmp(szBaseDirectory, m_persistentSettings->m_searchDirectories.begin()->c_str())
-			!= 0)
+	if (saveEntries)
 	{
-		bSaveEntry = TRUE;
-	}
+		/* Save the search directory and search pattern (only if they are not
+		the same as the most recent entry). */
+		BOOL bSaveEntry = FALSE;
 
-	if (bSaveEntry)
-	{
-		SaveEntry(IDC_COMBO_DIRECTORY, m_persistentSettings->m_searchDirectories);
-	}
+		if (m_persistentSettings->m_searchDirectories.empty()
+			|| lstrcmp(szBaseDirectory, m_persistentSettings->m_searchDirectories.begin()->c_str())
+				!= 0)
+		{
+			bSaveEntry = TRUE;
+		}
 
-	bSaveEntry = FALSE;
+		if (bSaveEntry)
+		{
+			SaveEntry(IDC_COMBO_DIRECTORY, m_persistentSettings->m_searchDirectories);
+		}
 
-	if (m_persistentSettings->m_searchPatterns.empty()
-		|| lstrcmp(szSearchPattern, m_persistentSettings->m_searchPatterns.begin()->c_str()) != 0)
-	{
-		bSaveEntry = TRUE;
-	}
+		bSaveEntry = FALSE;
 
-	if (bSaveEntry)
-	{
-		SaveEntry(IDC_COMBO_NAME, m_persistentSettings->m_searchPatterns);
+		if (m_persistentSettings->m_searchPatterns.empty()
+			|| lstrcmp(szSearchPattern, m_persistentSettings->m_searchPatterns.begin()->c_str())
+				!= 0)
+		{
+			bSaveEntry = TRUE;
+		}
+
+		if (bSaveEntry)
+		{
+			SaveEntry(IDC_COMBO_NAME, m_persistentSettings->m_searchPatterns);
+		}
 	}
 
 	GetDlgItemText(m_hDlg, IDSEARCH, m_szSearchButton, SIZEOF_ARRAY(m_szSearchButton));
@@ -553,70 +636,77 @@ void SearchDialog::UpdateListViewHeader()
 	m_iPreviousSelectedColumn = iColumn;
 }
 
-int CALLBACK NSearchDialog::SortResultsStub(LPARAM lParam1, LPARAM lParam2, LPARAM lParamSort)
-{
-	assert(lParamSort != NULL);
-
-	auto *psd = reinterpret_cast<SearchDialog *>(lParamSort);
-
-	return psd->SortResults(lParam1, lParam2);
-}
-
-int CALLBACK SearchDialog::SortResults(LPARAM lParam1, LPARAM lParam2)
+void SearchDialog::SortResults()
 {
-	int iRes = 0;
+	SearchResultStore::SortMode sortMode = SearchResultStore::SortMode::Name;
 
 	switch (m_persistentSettings->m_SortMode)
 	{
 	case SearchDialogPersistentSettings::SortMode::Name:
-		iRes = SortResultsByName(lParam1, lParam2);
+		sortMode = SearchResultStore::SortMode::Name;
 		break;
 
 	case SearchDialogPersistentSettings::SortMode::Path:
-		iRes = SortResultsByPath(lParam1, lParam2);
+		sortMode = SearchResultStore::SortMode::Path;
+		break;
+
+	case SearchDialogPersistentSettings::SortMode::MatchingLine:
+		sortMode = SearchResultStore::SortMode::MatchingLine;
 		break;
 	}
 
-	if (!m_persistentSettings->m_bSortAscending)
+	HWND hListView = GetDlgItem(m_hDlg, IDC_LISTVIEW_SEARCHRESULTS);
+
+	/* The listview only tracks the selection by row, so the
+	selected results need to be found again once the rows have
+	been reordered. */
+	std::unordered_set<size_t> selectedResults;
+	int item = -1;
+
+	while ((item = ListView_GetNextItem(hListView, item, LVNI_SELECTED)) != -1)
 	{
-		iRes = -iRes;
+		selectedResults.insert(m_results.GetResultId(item));
 	}
 
-	return iRes;
-}
+	std::optional<size_t> focusedResult;
+	int focusedItem = ListView_GetNextItem(hListView, -1, LVNI_FOCUSED);
 
-int CALLBACK SearchDialog::SortResultsByName(LPARAM lParam1, LPARAM lParam2)
-{
-	auto itr1 = m_SearchItemsMapInternal.find(static_cast<int>(lParam1));
-	auto itr2 = m_SearchItemsMapInternal.find(static_cast<int>(lParam2));
-
-	TCHAR szFilename1[MAX_PATH];
-	TCHAR szFilename2[MAX_PATH];
+	if (focusedItem != -1)
+	{
+		focusedResult = m_results.GetResultId(focusedItem);
+	}
 
-	StringCchCopy(szFilename1, SIZEOF_ARRAY(szFilename1), itr1->second.c_str());
-	StringCchCopy(szFilename2, SIZEOF_ARRAY(szFilename2), itr2->second.c_str());
+	m_results.Sort(sortMode, m_persistentSettings->m_bSortAscending);
 
-	PathStripPath(szFilename1);
-	PathStripPath(szFilename2);
+	RestoreSelection(selectedResults, focusedResult);
 
-	return StrCmpLogicalW(szFilename1, szFilename2);
+	InvalidateRect(hListView, nullptr, TRUE);
 }
 
-int CALLBACK SearchDialog::SortResultsByPath(LPARAM lParam1, LPARAM lParam2)
+void SearchDialog::RestoreSelection(
+	const std::unordered_set<size_t> &selectedResults, std::optional<size_t> focusedResult)
 {
-	auto itr1 = m_SearchItemsMapInternal.find(static_cast<int>(lParam1));
-	auto itr2 = m_SearchItemsMapInternal.find(static_cast<int>(lParam2));
+	HWND hListView = GetDlgItem(m_hDlg, IDC_LISTVIEW_SEARCHRESULTS);
 
-	TCHAR szPath1[MAX_PATH];
-	TCHAR szPath2[MAX_PATH];
+	if (!selectedResults.empty())
+	{
+		ListViewHelper::SelectAllItems(hListView, FALSE);
+	}
 
-	StringCchCopy(szPath1, SIZEOF_ARRAY(szPath1), itr1->second.c_str());
-	StringCchCopy(szPath2, SIZEOF_ARRAY(szPath2), itr2->second.c_str());
+	for (size_t i = 0; i < m_results.GetCount(); i++)
+	{
+		size_t resultId = m_results.GetResultId(i);
 
-	PathRemoveFileSpec(szPath1);
-	PathRemoveFileSpec(szPath2);
+		if (selectedResults.contains(resultId))
+		{
+			ListViewHelper::SelectItem(hListView, static_cast<int>(i), TRUE);
+		}
 
-	return StrCmpLogicalW(szPath1, szPath2);
+		if (focusedResult && resultId == *focusedResult)
+		{
+			ListViewHelper::FocusItem(hListView, static_cast<int>(i), TRUE);
+		}
+	}
 }
 
 void SearchDialog::UpdateMenuEntries(PCIDLIST_ABSOLUTE pidlParent,
@@ -688,6 +778,22 @@ INT_PTR SearchDialog::OnNotify(NMHDR *pnmhdr)
 {
 	switch (pnmhdr->code)
 	{
+	case LVN_GETDISPINFO:
+		if (pnmhdr->hwndFrom == GetDlgItem(m_hDlg, IDC_LISTVIEW_SEARCHRESULTS))
+		{
+			OnListViewGetDisplayInfo(reinterpret_cast<NMLVDISPINFO *>(pnmhdr));
+		}
+		break;
+
+	case LVN_ODFINDITEM:
+		if (pnmhdr->hwndFrom == GetDlgItem(m_hDlg, IDC_LISTVIEW_SEARCHRESULTS))
+		{
+			int res = OnListViewFindItem(reinterpret_cast<NMLVFINDITEM *>(pnmhdr));
+			SetWindowLongPtr(m_hDlg, DWLP_MSGRESULT, res);
+			return TRUE;
+		}
+		break;
+
 	case NM_DBLCLK:
 		if (pnmhdr->hwndFrom == GetDlgItem(m_hDlg, IDC_LISTVIEW_SEARCHRESULTS))
 		{
@@ -696,29 +802,12 @@ INT_PTR SearchDialog::OnNotify(NMHDR *pnmhdr)
 
 			if (iSelected != -1)
 			{
-				LVITEM lvItem;
-
-				lvItem.mask = LVIF_PARAM;
-				lvItem.iItem = iSelected;
-				lvItem.iSubItem = 0;
-
-				BOOL bRet = ListView_GetItem(hListView, &lvItem);
+				unique_pidl_absolute pidlFull;
+				HRESULT hr = GetSearchResultPidl(iSelected, wil::out_param(pidlFull));
 
-				if (bRet)
+				if (hr == S_OK)
 				{
-					auto itr = m_SearchItemsMapInternal.find(static_cast<int>(lvItem.lParam));
-
-					/* Item should always exist. */
-					assert(itr != m_SearchItemsMapInternal.end());
-
-					unique_pidl_absolute pidlFull;
-					HRESULT hr = SHParseDisplayName(
-						itr->second.c_str(), nullptr, wil::out_param(pidlFull), 0, nullptr);
-
-					if (hr == S_OK)
-					{
-						m_pexpp->OpenItem(pidlFull.get());
-					}
+					m_pexpp->OpenItem(pidlFull.get());
 				}
 			}
 		}
@@ -744,48 +833,34 @@ INT_PTR SearchDialog::OnNotify(NMHDR *pnmhdr)
 
 			if (iSelected != -1)
 			{
-				LVITEM lvItem;
-				lvItem.mask = LVIF_PARAM;
-				lvItem.iItem = iSelected;
-				lvItem.iSubItem = 0;
-				BOOL bRet = ListView_GetItem(hListView, &lvItem);
+				unique_pidl_absolute pidlFull;
+				HRESULT hr = GetSearchResultPidl(iSelected, wil::out_param(pidlFull));
 
-				if (bRet)
+				if (hr == S_OK)
 				{
-					auto itr = m_SearchItemsMapInternal.find(static_cast<int>(lvItem.lParam));
-					assert(itr != m_SearchItemsMapInternal.end());
-
-					unique_pidl_absolute pidlFull;
-					HRESULT hr = SHParseDisplayName(
-						itr->second.c_str(), nullptr, wil::out_param(pidlFull), 0, nullptr);
+					// The only reason this pidl is cloned at all is that ILFindLastID returns an
+					// unaligned pointer. Inserting that into the pidlItems vector then triggers a
+					// warning due to the underlying types having different __unaligned
+					// qualifiers. This only affects Itanium (which isn't supported), but cloning
+					// the pidl here is a simple way of producing an aligned version.
+					unique_pidl_child pidlItem(ILCloneChild(ILFindLastID(pidlFull.get())));
 
-					if (hr == S_OK)
-					{
-						// The only reason this pidl is cloned at all is that ILFindLastID returns
-						// an unaligned pointer. Inserting that into the pidlItems vector then
-						// triggers a warning due to the underlying types having different
-						// __unaligned qualifiers. This only affects Itanium (which isn't
-						// supported), but cloning the pidl here is a simple way of producing an
-						// aligned version.
-						unique_pidl_child pidlItem(ILCloneChild(ILFindLastID(pidlFull.get())));
+					std::vector<PCITEMID_CHILD> pidlItems;
+					pidlItems.push_back(pidlItem.get());
 
-						std::vector<PCITEMID_CHILD> pidlItems;
-						pidlItems.push_back(pidlItem.get());
+					unique_pidl_absolute pidlDirectory(ILCloneFull(pidlFull.get()));
+					ILRemoveLastID(pidlDirectory.get());
 
-						unique_pidl_absolute pidlDirectory(ILCloneFull(pidlFull.get()));
-						ILRemoveLastID(pidlDirectory.get());
+					FileContextMenuManager fcmm(m_hDlg, pidlDirectory.get(), pidlItems);
 
-						FileContextMenuManager fcmm(m_hDlg, pidlDirectory.get(), pidlItems);
+					DWORD dwCursorPos = GetMessagePos();
 
-						DWORD dwCursorPos = GetMessagePos();
+					POINT ptCursor;
+					ptCursor.x = GET_X_LPARAM(dwCursorPos);
+					ptCursor.y = GET_Y_LPARAM(dwCursorPos);
 
-						POINT ptCursor;
-						ptCursor.x = GET_X_LPARAM(dwCursorPos);
-						ptCursor.y = GET_Y_LPARAM(dwCursorPos);
-
-						fcmm.ShowMenu(this, MIN_SHELL_MENU_ID, MAX_SHELL_MENU_ID, &ptCursor,
-							m_pexpp->GetStatusBar(), NULL, FALSE, IsKeyDown(VK_SHIFT));
-					}
+					fcmm.ShowMenu(this, MIN_SHELL_MENU_ID, MAX_SHELL_MENU_ID, &ptCursor,
+						m_pexpp->GetStatusBar(), NULL, FALSE, IsKeyDown(VK_SHIFT));
 				}
 			}
 		}
@@ -813,9 +888,7 @@ INT_PTR SearchDialog::OnNotify(NMHDR *pnmhdr)
 				m_persistentSettings->m_Columns[pnmlv->iSubItem].bSortAscending;
 		}
 
-		ListView_SortItems(GetDlgItem(m_hDlg, IDC_LISTVIEW_SEARCHRESULTS),
-			NSearchDialog::SortResultsStub, reinterpret_cast<LPARAM>(this));
-
+		SortResults();
 		UpdateListViewHeader();
 	}
 	break;
@@ -828,20 +901,21 @@ INT_PTR SearchDialog::OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
 {
 	switch (uMsg)
 	{
-	/* We won't actually process the item here. Instead, we'll
-	add it onto the list of current items, which will be processed
-	in batch. This is done to stop this message from blocking the
-	main GUI (also see http://www.flounder.com/iocompletion.htm). */
-	case NSearchDialog::WM_APP_SEARCHITEMFOUND:
+	case NSearchDialog::WM_APP_SEARCHRESULTSFOUND:
 	{
-		m_AwaitingSearchItems.push_back(reinterpret_cast<PIDLIST_ABSOLUTE>(wParam));
+		std::unique_ptr<NSearchDialog::SearchResults> results(
+			reinterpret_cast<NSearchDialog::SearchResults *>(wParam));
 
-		if (m_bSetSearchTimer)
-		{
-			SetTimer(
-				m_hDlg, SEARCH_PROCESSITEMS_TIMER_ID, SEARCH_PROCESSITEMS_TIMER_ELAPSED, nullptr);
+		AddSearchResults(results->items);
 
-			m_bSetSearchTimer = FALSE;
+		if (!m_bStopSearching && !results->currentFolder.empty())
+		{
+			TCHAR szStatus[512];
+			TCHAR szTemp[64];
+			LoadString(GetInstance(), IDS_SEARCHING, szTemp, SIZEOF_ARRAY(szTemp));
+			StringCchPrintf(
+				szStatus, SIZEOF_ARRAY(szStatus), szTemp, results->currentFolder.c_str());
+			SetDlgItemText(m_hDlg, IDC_STATIC_STATUS, szStatus);
 		}
 	}
 	break;
@@ -852,8 +926,8 @@ INT_PTR SearchDialog::OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
 
 		if (!m_bStopSearching)
 		{
-			int iFoldersFound = LOWORD(lParam);
-			int iFilesFound = HIWORD(lParam);
+			int iFoldersFound = static_cast<int>(wParam);
+			int iFilesFound = static_cast<int>(lParam);
 
 			TCHAR szTemp[128];
 			LoadString(GetInstance(), IDS_SEARCH_FINISHED_MESSAGE, szTemp, SIZEOF_ARRAY(szTemp));
@@ -875,20 +949,12 @@ INT_PTR SearchDialog::OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
 		m_bSearching = FALSE;
 		m_bStopSearching = FALSE;
 		SetDlgItemText(m_hDlg, IDSEARCH, m_szSearchButton);
-	}
-	break;
-
-	case NSearchDialog::WM_APP_SEARCHCHANGEDDIRECTORY:
-	{
-		TCHAR szStatus[512];
-		TCHAR *pszDirectory = nullptr;
 
-		pszDirectory = reinterpret_cast<TCHAR *>(wParam);
-
-		TCHAR szTemp[64];
-		LoadString(GetInstance(), IDS_SEARCHING, szTemp, SIZEOF_ARRAY(szTemp));
-		StringCchPrintf(szStatus, SIZEOF_ARRAY(szStatus), szTemp, pszDirectory);
-		SetDlgItemText(m_hDlg, IDC_STATIC_STATUS, szStatus);
+		if (m_bRestartSearch)
+		{
+			m_bRestartSearch = FALSE;
+			StartSearching(false);
+		}
 	}
 	break;
 
@@ -914,6 +980,7 @@ INT_PTR SearchDialog::OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
 
 		m_bSearching = FALSE;
 		m_bStopSearching = FALSE;
+		m_bRestartSearch = FALSE;
 		SetDlgItemText(m_hDlg, IDSEARCH, m_szSearchButton);
 	}
 	break;
@@ -922,65 +989,127 @@ INT_PTR SearchDialog::OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
 	return 0;
 }
 
-INT_PTR SearchDialog::OnTimer(int iTimerID)
+void SearchDialog::AddSearchResults(const std::vector<SearchResult> &results)
 {
-	if (iTimerID != SEARCH_PROCESSITEMS_TIMER_ID)
+	if (results.empty())
 	{
-		return 1;
+		return;
 	}
 
-	HWND hListView = GetDlgItem(m_hDlg, IDC_LISTVIEW_SEARCHRESULTS);
-	int nListViewItems = ListView_GetItemCount(hListView);
+	for (const auto &result : results)
+	{
+		m_results.Add(result.path, result.matchingLine, result.attributes);
+	}
 
-	int nItems =
-		min(static_cast<int>(m_AwaitingSearchItems.size()), SEARCH_MAX_ITEMS_BATCH_PROCESS);
-	int i = 0;
+	/* New results are always added to the end, so the existing
+	rows don't need to be redrawn. */
+	ListView_SetItemCountEx(GetDlgItem(m_hDlg, IDC_LISTVIEW_SEARCHRESULTS),
+		static_cast<int>(m_results.GetCount()), LVSICF_NOINVALIDATEALL | LVSICF_NOSCROLL);
+}
+
+void SearchDialog::OnListViewGetDisplayInfo(NMLVDISPINFO *dispInfo)
+{
+	if (dispInfo->item.iItem < 0
+		|| dispInfo->item.iItem >= static_cast<int>(m_results.GetCount()))
+	{
+		return;
+	}
 
-	auto itr = m_AwaitingSearchItems.begin();
+	size_t row = dispInfo->item.iItem;
 
-	while (i < nItems)
+	if (WI_IsFlagSet(dispInfo->item.mask, LVIF_IMAGE))
 	{
-		LVITEM lvItem;
-		SHFILEINFO shfi;
-		int iIndex;
+		dispInfo->item.iImage = GetResultIconIndex(row);
+	}
 
-		PIDLIST_ABSOLUTE pidl = *itr;
+	if (WI_IsFlagClear(dispInfo->item.mask, LVIF_TEXT))
+	{
+		return;
+	}
+
+	std::wstring_view text;
+
+	switch (dispInfo->item.iSubItem)
+	{
+	case 0:
+		text = m_results.GetName(row);
+		break;
 
-		std::wstring fullFileName;
-		GetDisplayName(pidl, SHGDN_FORPARSING, fullFileName);
+	case 1:
+		text = m_results.GetFolder(row);
+		break;
+
+	case 2:
+		text = m_results.GetMatchingLine(row);
+		break;
+	}
 
-		TCHAR directory[MAX_PATH];
-		StringCchCopy(directory, SIZEOF_ARRAY(directory), fullFileName.c_str());
-		PathRemoveFileSpec(directory);
+	StringCchCopyN(dispInfo->item.pszText, dispInfo->item.cchTextMax, text.data(), text.size());
+}
 
-		std::wstring fileName;
-		GetDisplayName(pidl, SHGDN_INFOLDER | SHGDN_FORPARSING, fileName);
+int SearchDialog::GetResultIconIndex(size_t row)
+{
+	auto iconIndex = m_results.GetIconIndex(row);
 
-		SHGetFileInfo((LPCWSTR) pidl, 0, &shfi, sizeof(shfi), SHGFI_PIDL | SHGFI_SYSICONINDEX);
+	if (iconIndex)
+	{
+		return *iconIndex;
+	}
 
-		m_SearchItemsMapInternal.insert(
-			std::unordered_map<int, std::wstring>::value_type(m_iInternalIndex, fullFileName));
+	/* Most files share the icon registered for their type, so
+	that only needs to be retrieved once for each extension. */
+	if (WI_IsFlagClear(m_results.GetAttributes(row), FILE_ATTRIBUTE_DIRECTORY))
+	{
+		std::wstring name(m_results.GetName(row));
+		iconIndex = GetExtensionIconCache().GetIconIndex(PathFindExtension(name.c_str()));
+	}
 
-		lvItem.mask = LVIF_IMAGE | LVIF_TEXT | LVIF_PARAM;
-		lvItem.pszText = fileName.data();
-		lvItem.iItem = nListViewItems + i;
-		lvItem.iSubItem = 0;
-		lvItem.iImage = shfi.iIcon;
-		lvItem.lParam = m_iInternalIndex++;
-		iIndex = ListView_InsertItem(hListView, &lvItem);
+	if (!iconIndex)
+	{
+		SHFILEINFO shfi;
+		DWORD_PTR res = SHGetFileInfo(
+			m_results.GetPath(row).c_str(), 0, &shfi, sizeof(shfi), SHGFI_SYSICONINDEX);
+		iconIndex = (res != 0) ? shfi.iIcon : 0;
+	}
 
-		ListView_SetItemText(hListView, iIndex, 1, directory);
+	m_results.SetIconIndex(row, *iconIndex);
 
-		CoTaskMemFree(pidl);
+	return *iconIndex;
+}
 
-		itr = m_AwaitingSearchItems.erase(itr);
+int SearchDialog::OnListViewFindItem(const NMLVFINDITEM *findItem) const
+{
+	const LVFINDINFO &findInfo = findItem->lvfi;
 
-		i++;
+	if (!WI_IsAnyFlagSet(findInfo.flags, LVFI_STRING | LVFI_PARTIAL) || !findInfo.psz)
+	{
+		return -1;
 	}
 
-	m_bSetSearchTimer = TRUE;
+	auto row = m_results.FindByName(findInfo.psz, WI_IsFlagSet(findInfo.flags, LVFI_PARTIAL),
+		(findItem->iStart >= 0) ? findItem->iStart : 0, WI_IsFlagSet(findInfo.flags, LVFI_WRAP));
 
-	return 0;
+	if (!row)
+	{
+		return -1;
+	}
+
+	return static_cast<int>(*row);
+}
+
+// Results tend to be concentrated in a small number of folders, so rather than parsing the full
+// path of each result, the pidl is built from the (cached) pidl of the folder and the attributes
+// found during the search.
+HRESULT SearchDialog::GetSearchResultPidl(size_t row, PIDLIST_ABSOLUTE *pidl) const
+{
+	auto name = m_results.GetName(row);
+
+	WIN32_FIND_DATA wfd = {};
+	RETURN_IF_FAILED(
+		StringCchCopyN(wfd.cFileName, SIZEOF_ARRAY(wfd.cFileName), name.data(), name.size()));
+	wfd.dwFileAttributes = m_results.GetAttributes(row);
+
+	return ParsedPathCache::GetInstance().ParseChildPath(m_results.GetFolder(row), wfd, pidl);
 }
 
 INT_PTR SearchDialog::OnClose()
@@ -1001,6 +1130,8 @@ DWORD WINAPI NSearchDialog::SearchThread(LPVOID pParam)
 {
 	assert(pParam != nullptr);
 
+	SetCurrentThreadTaskClass(TaskClass::Bulk);
+
 	auto *pSearch = reinterpret_cast<Search *>(pParam);
 	pSearch->StartSearching();
 
@@ -1008,24 +1139,20 @@ DWORD WINAPI NSearchDialog::SearchThread(LPVOID pParam)
 }
 
 Search::Search(HWND hDlg, TCHAR *szBaseDirectory, TCHAR *szPattern, DWORD dwAttributes,
-	BOOL bUseRegularExpressions, BOOL bCaseInsensitive, BOOL bSearchSubFolders)
+	BOOL bUseRegularExpressions, BOOL bCaseInsensitive, BOOL bSearchSubFolders,
+	BOOL bUseNtfsIndex, const std::wstring &containingText, bool allowCloudHydration) :
+	m_containingText(containingText),
+	m_allowCloudHydration(allowCloudHydration)
 {
 	m_hDlg = hDlg;
 	m_dwAttributes = dwAttributes;
 	m_bUseRegularExpressions = bUseRegularExpressions;
 	m_bCaseInsensitive = bCaseInsensitive;
 	m_bSearchSubFolders = bSearchSubFolders;
+	m_bUseNtfsIndex = bUseNtfsIndex;
 
 	StringCchCopy(m_szBaseDirectory, SIZEOF_ARRAY(m_szBaseDirectory), szBaseDirectory);
 	StringCchCopy(m_szSearchPattern, SIZEOF_ARRAY(m_szSearchPattern), szPattern);
-
-	InitializeCriticalSection(&m_csStop);
-	m_bStopSearching = FALSE;
-}
-
-Search::~Search()
-{
-	DeleteCriticalSection(&m_csStop);
 }
 
 void Search::StartSearching()
@@ -1035,16 +1162,34 @@ void Search::StartSearching()
 
 	if (lstrcmp(m_szSearchPattern, EMPTY_STRING) != 0 && m_bUseRegularExpressions)
 	{
+		/* Regex matches in linear time, so a pathological pattern
+		can't stall the search threads. Like the wildcard matcher,
+		the compiled pattern is shared (read-only) between them. */
 		try
 		{
-			if (m_bCaseInsensitive)
-			{
-				m_rxPattern.assign(m_szSearchPattern, std::regex_constants::icase);
-			}
-			else
-			{
-				m_rxPattern.assign(m_szSearchPattern);
-			}
+			m_regex.emplace(m_szSearchPattern, m_bCaseInsensitive);
+		}
+		catch (std::exception)
+		{
+			SendMessage(m_hDlg, NSearchDialog::WM_APP_REGULAREXPRESSIONINVALID, 0, 0);
+
+			return;
+		}
+	}
+	else if (lstrcmp(m_szSearchPattern, EMPTY_STRING) != 0)
+	{
+		/* The pattern is parsed once here and then shared
+		(read-only) by each of the search threads. */
+		m_wildcardMatcher.emplace(m_szSearchPattern, !m_bCaseInsensitive);
+	}
+
+	if (!m_containingText.empty())
+	{
+		/* The text is interpreted in the same way as the
+		filename pattern. */
+		try
+		{
+			m_textSearcher.emplace(m_containingText, m_bUseRegularExpressions, m_bCaseInsensitive);
 		}
 		catch (std::exception)
 		{
@@ -1054,159 +1199,286 @@ void Search::StartSearching()
 		}
 	}
 
-	SearchDirectory(m_szBaseDirectory);
+	/* If the folder can't be searched using the index (e.g. because
+	it's not on a local NTFS volume, or because Explorer++ isn't
+	running elevated), it will be searched directly instead. */
+	if (!m_bUseNtfsIndex || !SearchIndex())
+	{
+		Walk({ SearchItem{ m_szBaseDirectory, true } });
+	}
 
-	SendMessage(m_hDlg, NSearchDialog::WM_APP_SEARCHFINISHED, 0,
-		MAKELPARAM(m_iFoldersFound, m_iFilesFound));
+	SendPendingResults();
+
+	/* This is posted (rather than sent), so that it will arrive
+	after the final batch of results. */
+	PostMessage(
+		m_hDlg, NSearchDialog::WM_APP_SEARCHFINISHED, m_iFoldersFound.load(), m_iFilesFound.load());
 
 	Release();
 }
 
-void Search::SearchDirectory(const TCHAR *szDirectory)
+void Search::Walk(std::vector<SearchItem> items)
 {
-	SendMessage(m_hDlg, NSearchDialog::WM_APP_SEARCHCHANGEDDIRECTORY,
-		reinterpret_cast<WPARAM>(szDirectory), 0);
-
-	std::list<std::wstring> subFolderList;
+	// When searching file contents, most of the time is spent reading files, so the number of
+	// files read at once is limited to what suits the device.
+	int maxThreads = 0;
 
-	SearchDirectoryInternal(szDirectory, &subFolderList);
+	if (m_textSearcher)
+	{
+		maxThreads = GetStorageInfo(m_szBaseDirectory).ioSettings.parallelism;
+	}
 
-	bool bStop = false;
+	ParallelWalk<SearchItem>::Run(
+		std::move(items),
+		[this](const SearchItem &item, ParallelWalk<SearchItem>::Worker &worker) {
+			ProcessItem(item, worker);
+		},
+		m_stopSource.get_token(), [this]() { SendPendingResults(); }, RESULTS_BATCH_INTERVAL,
+		maxThreads);
+}
 
-	EnterCriticalSection(&m_csStop);
-	if (m_bStopSearching)
+bool Search::SearchIndex()
+{
 	{
-		bStop = true;
+		std::scoped_lock lock(m_resultsMutex);
+		m_currentFolder = m_szBaseDirectory;
 	}
-	LeaveCriticalSection(&m_csStop);
 
-	if (bStop)
+	auto lastSendTime = std::chrono::steady_clock::now();
+	std::vector<SearchItem> files;
+
+	bool searched = NtfsIndexManager::GetInstance().Search(
+		m_szBaseDirectory, m_bSearchSubFolders,
+		[this](const wchar_t *name, DWORD attributes) { return DoesItemMatch(name, attributes); },
+		m_stopSource.get_token(),
+		[this, &lastSendTime, &files](std::wstring path, DWORD attributes) {
+			if (m_textSearcher)
+			{
+				if (WI_IsFlagClear(attributes, FILE_ATTRIBUTE_DIRECTORY)
+					&& CanSearchFileContents(attributes))
+				{
+					files.push_back({ std::move(path), false });
+				}
+
+				return;
+			}
+
+			AddResult(std::move(path), attributes);
+
+			/* Results are produced on this thread, so batches are
+			sent from here as well. */
+			if (std::chrono::steady_clock::now() - lastSendTime >= RESULTS_BATCH_INTERVAL)
+			{
+				SendPendingResults();
+				lastSendTime = std::chrono::steady_clock::now();
+			}
+		});
+
+	if (!searched)
 	{
-		return;
+		return false;
 	}
 
-	if (m_bSearchSubFolders)
+	/* The index only contains names, so the contents of the
+	matching files are then searched in parallel. */
+	Walk(std::move(files));
+
+	return true;
+}
+
+void Search::ProcessItem(const SearchItem &item, ParallelWalk<SearchItem>::Worker &worker)
+{
+	if (item.isFolder)
 	{
-		for (const auto &strSubFolder : subFolderList)
-		{
-			SearchDirectory(strSubFolder.c_str());
-		}
+		SearchFolder(item.path, worker);
+	}
+	else
+	{
+		SearchFileContents(item.path);
 	}
 }
 
-/* Can't recurse, as it would overflow the stack. */
-void Search::SearchDirectoryInternal(
-	const TCHAR *szSearchDirectory, std::list<std::wstring> *pSubFolderList)
+void Search::SearchFolder(const std::wstring &folder, ParallelWalk<SearchItem>::Worker &worker)
 {
-	assert(szSearchDirectory != nullptr);
-	assert(pSubFolderList != nullptr);
+	{
+		std::scoped_lock lock(m_resultsMutex);
+		m_currentFolder = folder;
+	}
 
 	WIN32_FIND_DATA wfd;
-	TCHAR szSearchTerm[MAX_PATH];
+	wil::unique_hfind findFile(FindFirstFileEx((std::filesystem::path(folder) / L"*").c_str(),
+		FindExInfoBasic, &wfd, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH));
 
-	PathCombine(szSearchTerm, szSearchDirectory, _T("*"));
+	if (!findFile)
+	{
+		return;
+	}
 
-	HANDLE hFindFile = FindFirstFile(szSearchTerm, &wfd);
+	std::vector<SearchResult> matches;
 
-	if (hFindFile != INVALID_HANDLE_VALUE)
+	do
 	{
-		bool bStop = false;
+		if (m_stopSource.stop_requested())
+		{
+			break;
+		}
 
-		while (FindNextFile(hFindFile, &wfd) != 0 && !bStop)
+		if (lstrcmpi(wfd.cFileName, _T(".")) == 0 || lstrcmpi(wfd.cFileName, _T("..")) == 0)
 		{
-			if (lstrcmpi(wfd.cFileName, _T(".")) != 0 && lstrcmpi(wfd.cFileName, _T("..")) != 0)
-			{
-				BOOL bMatchFileName = FALSE;
-				BOOL bMatchAttributes = FALSE;
+			continue;
+		}
 
-				/* Only match against the filename if it's not empty. */
-				if (lstrcmp(m_szSearchPattern, EMPTY_STRING) != 0)
-				{
-					if (m_bUseRegularExpressions)
-					{
-						if (std::regex_match(wfd.cFileName, m_rxPattern))
-						{
-							bMatchFileName = TRUE;
-						}
-					}
-					else
-					{
-						if (CheckWildcardMatch(
-								m_szSearchPattern, wfd.cFileName, !m_bCaseInsensitive))
-						{
-							bMatchFileName = TRUE;
-						}
-					}
-				}
-				else
+		bool isFolder = WI_IsFlagSet(wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY);
+		std::wstring fullFileName = (std::filesystem::path(folder) / wfd.cFileName).wstring();
+
+		if (DoesItemMatch(wfd.cFileName, wfd.dwFileAttributes))
+		{
+			if (m_textSearcher)
+			{
+				/* Each file is queued (rather than searched here),
+				so that the files in a single folder can be
+				searched in parallel. */
+				if (!isFolder && CanSearchFileContents(wfd.dwFileAttributes))
 				{
-					/* No filename constraint, so all filenames match. */
-					bMatchFileName = TRUE;
+					worker.AddItem({ fullFileName, false });
 				}
-
-				if (m_dwAttributes != 0)
+			}
+			else
+			{
+				if (isFolder)
 				{
-					if ((wfd.dwFileAttributes & m_dwAttributes) == m_dwAttributes)
-					{
-						bMatchAttributes = TRUE;
-					}
+					m_iFoldersFound++;
 				}
 				else
 				{
-					bMatchAttributes = TRUE;
+					m_iFilesFound++;
 				}
 
-				BOOL bItemMatch = bMatchFileName && bMatchAttributes;
+				matches.push_back({ fullFileName, {}, wfd.dwFileAttributes });
+			}
+		}
 
-				if (bItemMatch)
-				{
-					if ((wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-						== FILE_ATTRIBUTE_DIRECTORY)
-					{
-						m_iFoldersFound++;
-					}
-					else
-					{
-						m_iFilesFound++;
-					}
-
-					TCHAR szFullFileName[MAX_PATH];
-					PathCombine(szFullFileName, szSearchDirectory, wfd.cFileName);
-
-					unique_pidl_absolute pidl;
-					SHParseDisplayName(szFullFileName, nullptr, wil::out_param(pidl), 0, nullptr);
-
-					PostMessage(m_hDlg, NSearchDialog::WM_APP_SEARCHITEMFOUND,
-						reinterpret_cast<WPARAM>(ILCloneFull(pidl.get())), 0);
-				}
+		/* Reparse points (e.g. junctions) aren't followed, since
+		they can form cycles. */
+		if (isFolder && m_bSearchSubFolders
+			&& WI_IsFlagClear(wfd.dwFileAttributes, FILE_ATTRIBUTE_REPARSE_POINT))
+		{
+			worker.AddItem({ std::move(fullFileName), true });
+		}
+	} while (FindNextFile(findFile.get(), &wfd));
 
-				if ((wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == FILE_ATTRIBUTE_DIRECTORY)
-				{
-					TCHAR szSubFolder[MAX_PATH];
+	if (!matches.empty())
+	{
+		std::scoped_lock lock(m_resultsMutex);
+		m_pendingResults.insert(m_pendingResults.end(), std::make_move_iterator(matches.begin()),
+			std::make_move_iterator(matches.end()));
+	}
+}
 
-					PathCombine(szSubFolder, szSearchDirectory, wfd.cFileName);
+void Search::SearchFileContents(const std::wstring &path)
+{
+	auto match = m_textSearcher->SearchFile(path, m_stopSource.get_token());
 
-					pSubFolderList->push_back(szSubFolder);
-				}
-			}
+	if (!match)
+	{
+		return;
+	}
+
+	m_iFilesFound++;
+
+	std::scoped_lock lock(m_resultsMutex);
+	m_pendingResults.push_back(
+		{ path, std::to_wstring(match->lineNumber) + L": " + match->line });
+}
 
-			EnterCriticalSection(&m_csStop);
-			if (m_bStopSearching)
+bool Search::CanSearchFileContents(DWORD dwFileAttributes) const
+{
+	return m_allowCloudHydration || !IsCloudPlaceholder(dwFileAttributes);
+}
+
+BOOL Search::DoesItemMatch(const TCHAR *szFileName, DWORD dwFileAttributes) const
+{
+	BOOL bMatchFileName = FALSE;
+	BOOL bMatchAttributes = FALSE;
+
+	/* Only match against the filename if it's not empty. */
+	if (lstrcmp(m_szSearchPattern, EMPTY_STRING) != 0)
+	{
+		if (m_bUseRegularExpressions)
+		{
+			if (m_regex->Matches(szFileName))
 			{
-				bStop = true;
+				bMatchFileName = TRUE;
 			}
-			LeaveCriticalSection(&m_csStop);
 		}
+		else
+		{
+			if (m_wildcardMatcher->Matches(szFileName))
+			{
+				bMatchFileName = TRUE;
+			}
+		}
+	}
+	else
+	{
+		/* No filename constraint, so all filenames match. */
+		bMatchFileName = TRUE;
+	}
 
-		FindClose(hFindFile);
+	if (m_dwAttributes != 0)
+	{
+		if ((dwFileAttributes & m_dwAttributes) == m_dwAttributes)
+		{
+			bMatchAttributes = TRUE;
+		}
+	}
+	else
+	{
+		bMatchAttributes = TRUE;
+	}
+
+	return bMatchFileName && bMatchAttributes;
+}
+
+void Search::AddResult(std::wstring fullFileName, DWORD dwFileAttributes)
+{
+	if (WI_IsFlagSet(dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+	{
+		m_iFoldersFound++;
+	}
+	else
+	{
+		m_iFilesFound++;
+	}
+
+	std::scoped_lock lock(m_resultsMutex);
+	m_pendingResults.push_back({ std::move(fullFileName), {}, dwFileAttributes });
+}
+
+void Search::SendPendingResults()
+{
+	auto results = std::make_unique<NSearchDialog::SearchResults>();
+
+	{
+		std::scoped_lock lock(m_resultsMutex);
+		results->items = std::exchange(m_pendingResults, {});
+		results->currentFolder = m_currentFolder;
+	}
+
+	BOOL res = PostMessage(m_hDlg, NSearchDialog::WM_APP_SEARCHRESULTSFOUND,
+		reinterpret_cast<WPARAM>(results.get()), 0);
+
+	/* The dialog takes ownership of the results. If it's been
+	destroyed, the message won't be delivered. */
+	if (res)
+	{
+		results.release();
 	}
 }
 
 void Search::StopSearching()
 {
-	EnterCriticalSection(&m_csStop);
-	m_bStopSearching = TRUE;
-	LeaveCriticalSection(&m_csStop);
+	m_stopSource.request_stop();
 }
 
 void SearchDialog::SaveState()
@@ -1224,6 +1496,9 @@ void SearchDialog::SaveState()
 	m_persistentSettings->m_bSearchSubFolders =
 		IsDlgButtonChecked(m_hDlg, IDC_CHECK_SEARCHSUBFOLDERS) == BST_CHECKED;
 
+	m_persistentSettings->m_bUseNtfsIndex =
+		IsDlgButtonChecked(m_hDlg, IDC_CHECK_USENTFSINDEX) == BST_CHECKED;
+
 	m_persistentSettings->m_bArchive = IsDlgButtonChecked(m_hDlg, IDC_CHECK_ARCHIVE) == BST_CHECKED;
 
 	m_persistentSettings->m_bHidden = IsDlgButtonChecked(m_hDlg, IDC_CHECK_HIDDEN) == BST_CHECKED;
@@ -1237,9 +1512,12 @@ void SearchDialog::SaveState()
 
 	m_persistentSettings->m_iColumnWidth1 = ListView_GetColumnWidth(hListView, 0);
 	m_persistentSettings->m_iColumnWidth2 = ListView_GetColumnWidth(hListView, 1);
+	m_persistentSettings->m_iColumnWidth3 = ListView_GetColumnWidth(hListView, 2);
 
 	GetDlgItemText(m_hDlg, IDC_COMBO_NAME, m_persistentSettings->m_szSearchPattern,
 		SIZEOF_ARRAY(m_persistentSettings->m_szSearchPattern));
+	m_persistentSettings->m_containingText =
+		GetWindowString(GetDlgItem(m_hDlg, IDC_EDIT_CONTAININGTEXT));
 
 	m_persistentSettings->m_bStateSaved = TRUE;
 }
@@ -1250,6 +1528,7 @@ SearchDialogPersistentSettings::SearchDialogPersistentSettings() :
 	m_searchDirectories(DialogConstants::DEFAULT_HISTORY_SIZE)
 {
 	m_bSearchSubFolders = TRUE;
+	m_bUseNtfsIndex = FALSE;
 	m_bUseRegularExpressions = FALSE;
 	m_bCaseInsensitive = FALSE;
 	m_bArchive = FALSE;
@@ -1258,6 +1537,7 @@ SearchDialogPersistentSettings::SearchDialogPersistentSettings() :
 	m_bSystem = FALSE;
 	m_iColumnWidth1 = -1;
 	m_iColumnWidth2 = -1;
+	m_iColumnWidth3 = -1;
 
 	StringCchCopy(m_szSearchPattern, SIZEOF_ARRAY(m_szSearchPattern), EMPTY_STRING);
 
@@ -1272,6 +1552,11 @@ SearchDialogPersistentSettings::SearchDialogPersistentSettings() :
 	ci.bSortAscending = true;
 	m_Columns.push_back(ci);
 
+	ci.sortMode = SortMode::MatchingLine;
+	ci.uStringID = IDS_SEARCH_COLUMN_MATCHING_LINE;
+	ci.bSortAscending = true;
+	m_Columns.push_back(ci);
+
 	m_SortMode = m_Columns.front().sortMode;
 	m_bSortAscending = m_Columns.front().bSortAscending;
 }
@@ -1286,8 +1571,11 @@ void SearchDialogPersistentSettings::SaveExtraRegistrySettings(HKEY hKey)
 {
 	RegistrySettings::SaveDword(hKey, SETTING_COLUMN_WIDTH_1, m_iColumnWidth1);
 	RegistrySettings::SaveDword(hKey, SETTING_COLUMN_WIDTH_2, m_iColumnWidth2);
+	RegistrySettings::SaveDword(hKey, SETTING_COLUMN_WIDTH_3, m_iColumnWidth3);
 	RegistrySettings::SaveString(hKey, SETTING_SEARCH_DIRECTORY_TEXT, m_szSearchPattern);
+	RegistrySettings::SaveString(hKey, SETTING_CONTAINING_TEXT, m_containingText.c_str());
 	RegistrySettings::SaveDword(hKey, SETTING_SEARCH_SUB_FOLDERS, m_bSearchSubFolders);
+	RegistrySettings::SaveDword(hKey, SETTING_USE_NTFS_INDEX, m_bUseNtfsIndex);
 	RegistrySettings::SaveDword(hKey, SETTING_USE_REGULAR_EXPRESSIONS, m_bUseRegularExpressions);
 	RegistrySettings::SaveDword(hKey, SETTING_CASE_INSENSITIVE, m_bCaseInsensitive);
 	RegistrySettings::SaveDword(hKey, SETTING_ARCHIVE, m_bArchive);
@@ -1312,10 +1600,15 @@ void SearchDialogPersistentSettings::LoadExtraRegistrySettings(HKEY hKey)
 		hKey, SETTING_COLUMN_WIDTH_1, reinterpret_cast<LPDWORD>(&m_iColumnWidth1));
 	RegistrySettings::ReadDword(
 		hKey, SETTING_COLUMN_WIDTH_2, reinterpret_cast<LPDWORD>(&m_iColumnWidth2));
+	RegistrySettings::ReadDword(
+		hKey, SETTING_COLUMN_WIDTH_3, reinterpret_cast<LPDWORD>(&m_iColumnWidth3));
 	RegistrySettings::ReadString(
 		hKey, SETTING_SEARCH_DIRECTORY_TEXT, m_szSearchPattern, SIZEOF_ARRAY(m_szSearchPattern));
+	RegistrySettings::ReadString(hKey, SETTING_CONTAINING_TEXT, m_containingText);
 	RegistrySettings::ReadDword(
 		hKey, SETTING_SEARCH_SUB_FOLDERS, reinterpret_cast<LPDWORD>(&m_bSearchSubFolders));
+	RegistrySettings::ReadDword(
+		hKey, SETTING_USE_NTFS_INDEX, reinterpret_cast<LPDWORD>(&m_bUseNtfsIndex));
 	RegistrySettings::ReadDword(hKey, SETTING_USE_REGULAR_EXPRESSIONS,
 		reinterpret_cast<LPDWORD>(&m_bUseRegularExpressions));
 	RegistrySettings::ReadDword(
@@ -1347,10 +1640,16 @@ void SearchDialogPersistentSettings::SaveExtraXMLSettings(
 		NXMLSettings::EncodeIntValue(m_iColumnWidth1));
 	NXMLSettings::AddAttributeToNode(pXMLDom, pParentNode, SETTING_COLUMN_WIDTH_2,
 		NXMLSettings::EncodeIntValue(m_iColumnWidth2));
+	NXMLSettings::AddAttributeToNode(pXMLDom, pParentNode, SETTING_COLUMN_WIDTH_3,
+		NXMLSettings::EncodeIntValue(m_iColumnWidth3));
 	NXMLSettings::AddAttributeToNode(
 		pXMLDom, pParentNode, SETTING_SEARCH_DIRECTORY_TEXT, m_szSearchPattern);
+	NXMLSettings::AddAttributeToNode(
+		pXMLDom, pParentNode, SETTING_CONTAINING_TEXT, m_containingText.c_str());
 	NXMLSettings::AddAttributeToNode(pXMLDom, pParentNode, SETTING_SEARCH_SUB_FOLDERS,
 		NXMLSettings::EncodeBoolValue(m_bSearchSubFolders));
+	NXMLSettings::AddAttributeToNode(pXMLDom, pParentNode, SETTING_USE_NTFS_INDEX,
+		NXMLSettings::EncodeBoolValue(m_bUseNtfsIndex));
 	NXMLSettings::AddAttributeToNode(pXMLDom, pParentNode, SETTING_USE_REGULAR_EXPRESSIONS,
 		NXMLSettings::EncodeBoolValue(m_bUseRegularExpressions));
 	NXMLSettings::AddAttributeToNode(pXMLDom, pParentNode, SETTING_CASE_INSENSITIVE,
@@ -1389,14 +1688,26 @@ void SearchDialogPersistentSettings::LoadExtraXMLSettings(BSTR bstrName, BSTR bs
 	{
 		m_iColumnWidth2 = NXMLSettings::DecodeIntValue(bstrValue);
 	}
+	else if (lstrcmpi(bstrName, SETTING_COLUMN_WIDTH_3) == 0)
+	{
+		m_iColumnWidth3 = NXMLSettings::DecodeIntValue(bstrValue);
+	}
 	else if (lstrcmpi(bstrName, SETTING_SEARCH_DIRECTORY_TEXT) == 0)
 	{
 		StringCchCopy(m_szSearchPattern, SIZEOF_ARRAY(m_szSearchPattern), bstrValue);
 	}
+	else if (lstrcmpi(bstrName, SETTING_CONTAINING_TEXT) == 0)
+	{
+		m_containingText = bstrValue;
+	}
 	else if (lstrcmpi(bstrName, SETTING_SEARCH_SUB_FOLDERS) == 0)
 	{
 		m_bSearchSubFolders = NXMLSettings::DecodeBoolValue(bstrValue);
 	}
+	else if (lstrcmpi(bstrName, SETTING_USE_NTFS_INDEX) == 0)
+	{
+		m_bUseNtfsIndex = NXMLSettings::DecodeBoolValue(bstrValue);
+	}
 	else if (lstrcmpi(bstrName, SETTING_USE_REGULAR_EXPRESSIONS) == 0)
 	{
 		m_bUseRegularExpressions = NXMLSettings::DecodeBoolValue(bstrValue);
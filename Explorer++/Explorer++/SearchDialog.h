@@ -5,16 +5,25 @@
 #pragma once
 
 #include "DarkModeDialogBase.h"
+#include "SearchResultStore.h"
 #include "../Helper/DialogSettings.h"
 #include "../Helper/FileContextMenuManager.h"
+#include "../Helper/ParallelWalk.h"
 #include "../Helper/ReferenceCount.h"
+#include "../Helper/Regex.h"
+#include "../Helper/TextSearcher.h"
+#include "../Helper/WildcardMatcher.h"
 #include <boost/circular_buffer.hpp>
 #include <MsXml2.h>
 #include <objbase.h>
+#include <atomic>
+#include <chrono>
 #include <list>
-#include <regex>
+#include <mutex>
+#include <optional>
+#include <stop_token>
 #include <string>
-#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 __interface IExplorerplusplus;
@@ -34,8 +43,11 @@ private:
 
 	static const TCHAR SETTING_COLUMN_WIDTH_1[];
 	static const TCHAR SETTING_COLUMN_WIDTH_2[];
+	static const TCHAR SETTING_COLUMN_WIDTH_3[];
 	static const TCHAR SETTING_SEARCH_DIRECTORY_TEXT[];
+	static const TCHAR SETTING_CONTAINING_TEXT[];
 	static const TCHAR SETTING_SEARCH_SUB_FOLDERS[];
+	static const TCHAR SETTING_USE_NTFS_INDEX[];
 	static const TCHAR SETTING_USE_REGULAR_EXPRESSIONS[];
 	static const TCHAR SETTING_CASE_INSENSITIVE[];
 	static const TCHAR SETTING_ARCHIVE[];
@@ -50,7 +62,8 @@ private:
 	enum class SortMode
 	{
 		Name = 1,
-		Path = 2
+		Path = 2,
+		MatchingLine = 3
 	};
 
 	struct ColumnInfo
@@ -81,9 +94,11 @@ private:
 	void ListToCircularBuffer(const std::list<T> &list, boost::circular_buffer<T> &cb);
 
 	TCHAR m_szSearchPattern[MAX_PATH];
+	std::wstring m_containingText;
 	boost::circular_buffer<std::wstring> m_searchPatterns;
 	boost::circular_buffer<std::wstring> m_searchDirectories;
 	BOOL m_bSearchSubFolders;
+	BOOL m_bUseNtfsIndex;
 	BOOL m_bUseRegularExpressions;
 	BOOL m_bCaseInsensitive;
 	BOOL m_bArchive;
@@ -97,22 +112,55 @@ private:
 
 	int m_iColumnWidth1;
 	int m_iColumnWidth2;
+	int m_iColumnWidth3;
 };
 
+/* A single match. The matching line is only set when the
+contents of files are being searched. */
+struct SearchResult
+{
+	std::wstring path;
+	std::wstring matchingLine;
+	DWORD attributes = FILE_ATTRIBUTE_NORMAL;
+};
+
+/* Folders are searched in parallel (or, if enabled, using the
+index for the volume). Any matches are collected and sent to
+the dialog in batches, rather than one at a time.
+
+If text has been specified, the contents of each file that
+matches are then searched as well. Those files are
+processed by the same set of worker threads. */
 class Search : public ReferenceCount
 {
 public:
 	Search(HWND hDlg, TCHAR *szBaseDirectory, TCHAR *szPattern, DWORD dwAttributes,
-		BOOL bUseRegularExpressions, BOOL bCaseInsensitive, BOOL bSearchSubFolders);
-	~Search();
+		BOOL bUseRegularExpressions, BOOL bCaseInsensitive, BOOL bSearchSubFolders,
+		BOOL bUseNtfsIndex, const std::wstring &containingText, bool allowCloudHydration);
 
 	void StartSearching();
 	void StopSearching();
 
 private:
-	void SearchDirectory(const TCHAR *szDirectory);
-	void SearchDirectoryInternal(
-		const TCHAR *szSearchDirectory, std::list<std::wstring> *pSubFolderList);
+	static constexpr std::chrono::milliseconds RESULTS_BATCH_INTERVAL{ 100 };
+
+	/* An item processed by the walk. Files are only queued when
+	their contents need to be searched. */
+	struct SearchItem
+	{
+		std::wstring path;
+		bool isFolder;
+	};
+
+	void Walk(std::vector<SearchItem> items);
+	bool SearchIndex();
+	void ProcessItem(const SearchItem &item, ParallelWalk<SearchItem>::Worker &worker);
+	void SearchFolder(const std::wstring &folder, ParallelWalk<SearchItem>::Worker &worker);
+	void SearchFileContents(const std::wstring &path);
+	bool CanSearchFileContents(DWORD dwFileAttributes) const;
+	BOOL DoesItemMatch(const TCHAR *szFileName, DWORD dwFileAttributes) const;
+	void AddResult(std::wstring fullFileName, DWORD dwFileAttributes);
+	void SendPendingResults();
 
 	HWND m_hDlg;
 
@@ -122,14 +170,26 @@ private:
 	BOOL m_bUseRegularExpressions;
 	BOOL m_bCaseInsensitive;
 	BOOL m_bSearchSubFolders;
+	BOOL m_bUseNtfsIndex;
+	std::wstring m_containingText;
 
-	std::wregex m_rxPattern;
+	/* Unless set, the contents of cloud placeholders aren't
+	searched, since that would cause them to be downloaded. */
+	bool m_allowCloudHydration;
 
-	CRITICAL_SECTION m_csStop;
-	BOOL m_bStopSearching;
+	std::optional<Regex> m_regex;
+	std::optional<WildcardMatcher> m_wildcardMatcher;
+	std::optional<TextSearcher> m_textSearcher;
 
-	int m_iFoldersFound;
-	int m_iFilesFound;
+	std::stop_source m_stopSource;
+
+	/* Matches that haven't been sent to the dialog yet. */
+	std::mutex m_resultsMutex;
+	std::vector<SearchResult> m_pendingResults;
+	std::wstring m_currentFolder;
+
+	std::atomic<int> m_iFoldersFound;
+	std::atomic<int> m_iFilesFound;
 };
 
 class SearchDialog : public DarkModeDialogBase, public IFileContextMenuExternal
@@ -148,16 +208,11 @@ public:
 	void HandleCustomMenuItem(PCIDLIST_ABSOLUTE pidlParent,
 		const std::vector<PITEMID_CHILD> &pidlItems, int iCmd) override;
 
-	/* Sorting methods. */
-	int CALLBACK SortResults(LPARAM lParam1, LPARAM lParam2);
-	int CALLBACK SortResultsByName(LPARAM lParam1, LPARAM lParam2);
-	int CALLBACK SortResultsByPath(LPARAM lParam1, LPARAM lParam2);
-
 protected:
 	INT_PTR OnInitDialog() override;
-	INT_PTR OnTimer(int iTimerID) override;
 	INT_PTR OnCommand(WPARAM wParam, LPARAM lParam) override;
 	INT_PTR OnNotify(NMHDR *pnmhdr) override;
+	INT_PTR OnTimer(int iTimerID) override;
 	INT_PTR OnClose() override;
 	INT_PTR OnNcDestroy() override;
 
@@ -166,41 +221,50 @@ protected:
 	virtual wil::unique_hicon GetDialogIcon(int iconWidth, int iconHeight) const override;
 
 private:
-	static const int SEARCH_PROCESSITEMS_TIMER_ID = 0;
-	static const int SEARCH_PROCESSITEMS_TIMER_ELAPSED = 50;
-	static const int SEARCH_MAX_ITEMS_BATCH_PROCESS = 100;
-
 	static const int MIN_SHELL_MENU_ID = 1;
 	static const int MAX_SHELL_MENU_ID = 1000;
 
 	static const int MENU_ID_OPEN_FILE_LOCATION = (MAX_SHELL_MENU_ID + 1);
 
+	/* When searching using the index, the search is rerun each
+	time the user stops typing for this amount of time. */
+	static const UINT_PTR INSTANT_SEARCH_TIMER_ID = 1;
+	static const UINT INSTANT_SEARCH_TIMER_TIMEOUT = 250;
+
 	void GetResizableControlInformation(BaseDialog::DialogSizeConstraint &dsc,
 		std::list<ResizableDialog::Control> &ControlList) override;
 	void SaveState() override;
 
 	void OnSearch();
-	void StartSearching();
+	void OnSearchPatternChanged();
+	void StartSearching(bool saveEntries);
 	void StopSearching();
 	void SaveEntry(int comboBoxId, boost::circular_buffer<std::wstring> &buffer);
 	void UpdateListViewHeader();
+	void SortResults();
+	void RestoreSelection(
+		const std::unordered_set<size_t> &selectedResults, std::optional<size_t> focusedResult);
+	void AddSearchResults(const std::vector<SearchResult> &results);
+	void OnListViewGetDisplayInfo(NMLVDISPINFO *dispInfo);
+	int GetResultIconIndex(size_t row);
+	int OnListViewFindItem(const NMLVFINDITEM *findItem) const;
+	HRESULT GetSearchResultPidl(size_t row, PIDLIST_ABSOLUTE *pidl) const;
 
 	std::wstring m_searchDirectory;
 	wil::unique_hicon m_directoryIcon;
 	BOOL m_bSearching;
 	BOOL m_bStopSearching;
+	BOOL m_bRestartSearch;
 	TCHAR m_szSearchButton[32];
 
 	Search *m_pSearch;
 
-	/* Listview item information. */
-	std::list<PIDLIST_ABSOLUTE> m_AwaitingSearchItems;
-	std::unordered_map<int, std::wstring> m_SearchItemsMapInternal;
-	int m_iInternalIndex;
+	/* The listview is virtual, with each row being shown directly
+	from the results stored here. A pidl is only created for a
+	result when it's acted upon. */
+	SearchResultStore m_results;
 	int m_iPreviousSelectedColumn;
 
-	BOOL m_bSetSearchTimer;
-
 	IExplorerplusplus *m_pexpp;
 	TabContainer *m_tabContainer;
 
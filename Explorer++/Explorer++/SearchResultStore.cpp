@@ -0,0 +1,256 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "SearchResultStore.h"
+#include "ShellBrowser/SortHelper.h"
+#include <algorithm>
+#include <numeric>
+
+void SearchResultStore::Add(
+	const std::wstring &path, const std::wstring &matchingLine, DWORD attributes)
+{
+	const WCHAR *name = PathFindFileName(path.c_str());
+	std::wstring_view nameView(name);
+	std::wstring folder = path.substr(0, path.size() - nameView.size());
+
+	// As with PathRemoveFileSpec(), the trailing backslash is only kept for a root folder.
+	if (folder.size() > 1 && folder.back() == '\\' && !(folder.size() == 3 && folder[1] == ':'))
+	{
+		folder.pop_back();
+	}
+
+	Result result;
+	result.folderIndex = AddFolder(folder);
+	result.nameOffset = AddText(nameView);
+	result.nameLength = static_cast<uint32_t>(nameView.size());
+	result.matchingLineOffset = AddText(matchingLine);
+	result.matchingLineLength = static_cast<uint32_t>(matchingLine.size());
+	result.attributes = attributes;
+
+	m_order.push_back(static_cast<uint32_t>(m_results.size()));
+	m_results.push_back(result);
+}
+
+uint32_t SearchResultStore::AddFolder(const std::wstring &folder)
+{
+	auto itr = m_folderIndexes.find(folder);
+
+	if (itr != m_folderIndexes.end())
+	{
+		return itr->second;
+	}
+
+	auto folderIndex = static_cast<uint32_t>(m_folders.size());
+	m_folders.push_back(folder);
+	m_folderIndexes.insert({ folder, folderIndex });
+
+	return folderIndex;
+}
+
+uint32_t SearchResultStore::AddText(std::wstring_view text)
+{
+	auto offset = static_cast<uint32_t>(m_textBuffer.size());
+	m_textBuffer.append(text);
+	return offset;
+}
+
+void SearchResultStore::Clear()
+{
+	// The buffers are released, rather than simply cleared, since a previous search may have
+	// returned a very large number of results.
+	m_results = {};
+	m_order = {};
+	m_textBuffer = {};
+	m_folders = {};
+	m_folderIndexes = {};
+}
+
+size_t SearchResultStore::GetCount() const
+{
+	return m_order.size();
+}
+
+std::wstring_view SearchResultStore::GetName(size_t row) const
+{
+	const auto &result = GetResult(row);
+	return GetText(result.nameOffset, result.nameLength);
+}
+
+const std::wstring &SearchResultStore::GetFolder(size_t row) const
+{
+	return m_folders[GetResult(row).folderIndex];
+}
+
+std::wstring SearchResultStore::GetPath(size_t row) const
+{
+	std::wstring path = GetFolder(row);
+
+	if (!path.empty() && path.back() != '\\')
+	{
+		path += '\\';
+	}
+
+	path += GetName(row);
+
+	return path;
+}
+
+std::wstring_view SearchResultStore::GetMatchingLine(size_t row) const
+{
+	const auto &result = GetResult(row);
+	return GetText(result.matchingLineOffset, result.matchingLineLength);
+}
+
+DWORD SearchResultStore::GetAttributes(size_t row) const
+{
+	return GetResult(row).attributes;
+}
+
+std::optional<int> SearchResultStore::GetIconIndex(size_t row) const
+{
+	return GetResult(row).iconIndex;
+}
+
+void SearchResultStore::SetIconIndex(size_t row, int iconIndex)
+{
+	m_results[m_order[row]].iconIndex = iconIndex;
+}
+
+size_t SearchResultStore::GetResultId(size_t row) const
+{
+	return m_order[row];
+}
+
+void SearchResultStore::Sort(SortMode sortMode, bool ascending)
+{
+	std::vector<uint32_t> folderRanks;
+	std::vector<BYTE> keyBuffer;
+	std::vector<std::pair<size_t, size_t>> keyRanges;
+
+	if (sortMode == SortMode::Path)
+	{
+		folderRanks = RankFolders();
+	}
+	else
+	{
+		keyRanges.reserve(m_results.size());
+
+		for (const auto &result : m_results)
+		{
+			auto text = (sortMode == SortMode::Name)
+				? GetText(result.nameOffset, result.nameLength)
+				: GetText(result.matchingLineOffset, result.matchingLineLength);
+			auto key = CreateCollationKey(std::wstring(text), true);
+
+			keyRanges.emplace_back(keyBuffer.size(), key.size());
+			keyBuffer.insert(keyBuffer.end(), key.begin(), key.end());
+		}
+	}
+
+	auto compareResults = [&](uint32_t id1, uint32_t id2) {
+		if (sortMode == SortMode::Path)
+		{
+			auto rank1 = folderRanks[m_results[id1].folderIndex];
+			auto rank2 = folderRanks[m_results[id2].folderIndex];
+			return (rank1 == rank2) ? 0 : ((rank1 < rank2) ? -1 : 1);
+		}
+
+		std::span<const BYTE> keys(keyBuffer);
+		return CompareCollationKeys(keys.subspan(keyRanges[id1].first, keyRanges[id1].second),
+			keys.subspan(keyRanges[id2].first, keyRanges[id2].second));
+	};
+
+	// Results that compare equal are left in the order they were found in.
+	std::stable_sort(m_order.begin(), m_order.end(),
+		[&compareResults, ascending](uint32_t id1, uint32_t id2) {
+			int res = compareResults(id1, id2);
+			return ascending ? (res < 0) : (res > 0);
+		});
+}
+
+// Results tend to be concentrated in a small number of folders, so when sorting by path, each
+// folder is ranked once and the results are then sorted by the rank of their folder.
+std::vector<uint32_t> SearchResultStore::RankFolders() const
+{
+	std::vector<std::vector<BYTE>> keys;
+	keys.reserve(m_folders.size());
+
+	for (const auto &folder : m_folders)
+	{
+		keys.push_back(CreateCollationKey(folder, true));
+	}
+
+	std::vector<uint32_t> sortedFolders(m_folders.size());
+	std::iota(sortedFolders.begin(), sortedFolders.end(), 0);
+	std::sort(sortedFolders.begin(), sortedFolders.end(),
+		[&keys](uint32_t folder1, uint32_t folder2) {
+			return CompareCollationKeys(keys[folder1], keys[folder2]) < 0;
+		});
+
+	// Folders that compare equal share a rank, so that their results stay in the order they were
+	// found in.
+	std::vector<uint32_t> ranks(m_folders.size());
+	uint32_t rank = 0;
+
+	for (size_t i = 0; i < sortedFolders.size(); i++)
+	{
+		if (i > 0 && CompareCollationKeys(keys[sortedFolders[i - 1]], keys[sortedFolders[i]]) != 0)
+		{
+			rank++;
+		}
+
+		ranks[sortedFolders[i]] = rank;
+	}
+
+	return ranks;
+}
+
+std::optional<size_t> SearchResultStore::FindByName(
+	std::wstring_view text, bool partial, size_t startRow, bool wrap) const
+{
+	size_t numRows = m_order.size();
+
+	if (numRows == 0)
+	{
+		return std::nullopt;
+	}
+
+	if (startRow >= numRows)
+	{
+		startRow = 0;
+	}
+
+	size_t numRowsToSearch = wrap ? numRows : numRows - startRow;
+
+	for (size_t i = 0; i < numRowsToSearch; i++)
+	{
+		size_t row = (startRow + i) % numRows;
+		auto name = GetName(row);
+
+		if (partial && name.size() > text.size())
+		{
+			name = name.substr(0, text.size());
+		}
+
+		if (CompareStringOrdinal(name.data(), static_cast<int>(name.size()), text.data(),
+				static_cast<int>(text.size()), TRUE)
+			== CSTR_EQUAL)
+		{
+			return row;
+		}
+	}
+
+	return std::nullopt;
+}
+
+std::wstring_view SearchResultStore::GetText(uint32_t offset, uint32_t length) const
+{
+	return std::wstring_view(m_textBuffer).substr(offset, length);
+}
+
+const SearchResultStore::Result &SearchResultStore::GetResult(size_t row) const
+{
+	return m_results[m_order[row]];
+}
\ No newline at end of file
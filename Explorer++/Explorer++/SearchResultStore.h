@@ -0,0 +1,83 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Holds the results of a search. A search can return hundreds of thousands of results, so rather
+// than storing a separate string (or pidl) for each result, the file names and matching lines are
+// packed into a single buffer, and each folder is stored once, no matter how many results it
+// contains.
+//
+// Results are accessed by row, where a row is a position in the current display order. That order
+// only changes when Sort() is called; results added afterwards are appended to the end.
+class SearchResultStore
+{
+public:
+	enum class SortMode
+	{
+		Name,
+		Path,
+		MatchingLine
+	};
+
+	void Add(const std::wstring &path, const std::wstring &matchingLine, DWORD attributes);
+	void Clear();
+	size_t GetCount() const;
+
+	std::wstring_view GetName(size_t row) const;
+
+	// Returns the folder containing the result, in the same format as PathRemoveFileSpec().
+	const std::wstring &GetFolder(size_t row) const;
+
+	std::wstring GetPath(size_t row) const;
+	std::wstring_view GetMatchingLine(size_t row) const;
+	DWORD GetAttributes(size_t row) const;
+
+	// The icon is only retrieved when the result is shown, so is cached here once that's done.
+	std::optional<int> GetIconIndex(size_t row) const;
+	void SetIconIndex(size_t row, int iconIndex);
+
+	// Each result has an id which, unlike its row, isn't affected by sorting.
+	size_t GetResultId(size_t row) const;
+
+	// A collation key is generated once for each result (or, when sorting by path, each folder),
+	// so the sort itself only needs to compare bytes.
+	void Sort(SortMode sortMode, bool ascending);
+
+	// Returns the first row at or after startRow whose name matches the specified text
+	// (case-insensitively). When partial is set, the name only needs to start with the text.
+	std::optional<size_t> FindByName(
+		std::wstring_view text, bool partial, size_t startRow, bool wrap) const;
+
+private:
+	struct Result
+	{
+		uint32_t folderIndex;
+		uint32_t nameOffset;
+		uint32_t nameLength;
+		uint32_t matchingLineOffset;
+		uint32_t matchingLineLength;
+		DWORD attributes;
+		std::optional<int> iconIndex;
+	};
+
+	std::vector<uint32_t> RankFolders() const;
+	uint32_t AddFolder(const std::wstring &folder);
+	uint32_t AddText(std::wstring_view text);
+	std::wstring_view GetText(uint32_t offset, uint32_t length) const;
+	const Result &GetResult(size_t row) const;
+
+	std::vector<Result> m_results;
+	std::vector<uint32_t> m_order;
+	std::wstring m_textBuffer;
+	std::vector<std::wstring> m_folders;
+	std::unordered_map<std::wstring, uint32_t> m_folderIndexes;
+};
\ No newline at end of file
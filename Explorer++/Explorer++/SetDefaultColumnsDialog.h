@@ -11,17 +11,6 @@
 #include <wil/resource.h>
 #include <unordered_map>
 
-enum class FolderType
-{
-	General = 0,
-	Computer = 1,
-	ControlPanel = 2,
-	Network = 3,
-	NetworkPlaces = 4,
-	Printers = 5,
-	RecycleBin = 6
-};
-
 class SetDefaultColumnsDialog;
 
 class SetDefaultColumnsDialogPersistentSettings : public DialogSettings
@@ -6,8 +6,12 @@
 #include "SetFileAttributesDialog.h"
 #include "DarkModeHelper.h"
 #include "MainResource.h"
+#include "ResourceHelper.h"
+#include "../Helper/BulkAttributeUpdate.h"
 #include "../Helper/Helper.h"
 #include "../Helper/TimeHelper.h"
+#include <boost/format.hpp>
+#include <wil/com.h>
 #include <list>
 
 const TCHAR SetFileAttributesDialogPersistentSettings::SETTINGS_KEY[] = _T("SetFileAttributes");
@@ -226,14 +230,8 @@ INT_PTR SetFileAttributesDialog::OnClose()
 
 void SetFileAttributesDialog::OnOk()
 {
-	FILETIME *plw = nullptr;
-	FILETIME *plc = nullptr;
-	FILETIME *pla = nullptr;
-	FILETIME lastWriteTime;
-	FILETIME creationTime;
-	FILETIME accessTime;
+	FileTimestamps timestamps;
 	DWORD allFileAttributes = FILE_ATTRIBUTE_NORMAL;
-	DWORD fileAttributes;
 
 	if (m_bModificationDateEnabled)
 	{
@@ -246,8 +244,9 @@ void SetFileAttributesDialog::OnOk()
 
 		MergeDateTime(&localWrite, &localWriteDate, &localWriteTime);
 
+		FILETIME lastWriteTime;
 		LocalSystemTimeToFileTime(&localWrite, &lastWriteTime);
-		plw = &lastWriteTime;
+		timestamps.lastWriteTime = lastWriteTime;
 	}
 
 	if (m_bCreationDateEnabled)
@@ -261,8 +260,9 @@ void SetFileAttributesDialog::OnOk()
 
 		MergeDateTime(&localCreation, &localCreationDate, &localCreationTime);
 
+		FILETIME creationTime;
 		LocalSystemTimeToFileTime(&localCreation, &creationTime);
-		plc = &creationTime;
+		timestamps.creationTime = creationTime;
 	}
 
 	if (m_bAccessDateEnabled)
@@ -276,8 +276,9 @@ void SetFileAttributesDialog::OnOk()
 
 		MergeDateTime(&localAccess, &localAccessDate, &localAccessTime);
 
+		FILETIME accessTime;
 		LocalSystemTimeToFileTime(&localAccess, &accessTime);
-		pla = &accessTime;
+		timestamps.lastAccessTime = accessTime;
 	}
 
 	/* Build up list of attributes. Add all positive
@@ -296,9 +297,12 @@ void SetFileAttributesDialog::OnOk()
 		}
 	}
 
+	std::vector<FileBasicInfoUpdate> updates;
+	updates.reserve(m_FileList.size());
+
 	for (const auto &file : m_FileList)
 	{
-		fileAttributes = allFileAttributes;
+		DWORD fileAttributes = allFileAttributes;
 
 		for (const auto &attribute : m_AttributeList)
 		{
@@ -314,21 +318,91 @@ void SetFileAttributesDialog::OnOk()
 			}
 		}
 
-		SetFileAttributes(file.szFullFileName, fileAttributes);
+		updates.push_back({ file.szFullFileName, fileAttributes });
+	}
 
-		HANDLE hFile = CreateFile(file.szFullFileName, FILE_WRITE_ATTRIBUTES, 0, nullptr,
-			OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+	auto result = ApplyUpdates(updates, timestamps);
 
-		if (hFile != INVALID_HANDLE_VALUE)
-		{
-			SetFileTime(hFile, plc, pla, plw);
-			CloseHandle(hFile);
-		}
+	if (result.filesFailed > 0)
+	{
+		ShowUpdateErrors(result, static_cast<int>(updates.size()));
 	}
 
 	EndDialog(m_hDlg, 1);
 }
 
+FileBasicInfoUpdateResult SetFileAttributesDialog::ApplyUpdates(
+	const std::vector<FileBasicInfoUpdate> &updates, const FileTimestamps &timestamps)
+{
+	wil::com_ptr_nothrow<IProgressDialog> progressDialog;
+	HRESULT hr = CoCreateInstance(
+		CLSID_ProgressDialog, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&progressDialog));
+
+	if (SUCCEEDED(hr))
+	{
+		std::wstring title =
+			ResourceHelper::LoadString(GetInstance(), IDS_SET_FILE_ATTRIBUTES_PROGRESS);
+		progressDialog->SetTitle(title.c_str());
+		progressDialog->StartProgressDialog(m_hDlg, nullptr,
+			PROGDLG_MODAL | PROGDLG_AUTOTIME | PROGDLG_NOMINIMIZE, nullptr);
+	}
+
+	std::stop_source stopSource;
+
+	auto result = UpdateFileBasicInfo(updates, timestamps, stopSource.get_token(),
+		[&progressDialog, &stopSource](const FileBasicInfoUpdateProgress &progress) {
+			if (progressDialog)
+			{
+				if (progressDialog->HasUserCancelled())
+				{
+					stopSource.request_stop();
+				}
+
+				std::wstring status = std::to_wstring(progress.filesProcessed) + L" / "
+					+ std::to_wstring(progress.totalFiles);
+				progressDialog->SetLine(2, status.c_str(), FALSE, nullptr);
+				progressDialog->SetProgress64(progress.filesProcessed, progress.totalFiles);
+			}
+
+			/* As with native file transfers, this runs on the
+			UI thread, so messages are pumped here to keep the
+			(modal) progress dialog responsive. */
+			MSG msg;
+
+			while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
+			{
+				if (msg.message == WM_QUIT)
+				{
+					stopSource.request_stop();
+					PostQuitMessage(static_cast<int>(msg.wParam));
+					break;
+				}
+
+				TranslateMessage(&msg);
+				DispatchMessage(&msg);
+			}
+		});
+
+	if (progressDialog)
+	{
+		progressDialog->StopProgressDialog();
+	}
+
+	return result;
+}
+
+void SetFileAttributesDialog::ShowUpdateErrors(
+	const FileBasicInfoUpdateResult &result, int totalFiles)
+{
+	std::wstring messageTemplate =
+		ResourceHelper::LoadString(GetInstance(), IDS_SET_FILE_ATTRIBUTES_ERROR);
+	auto errorMessage = GetLastErrorMessage(result.firstError);
+	std::wstring message = (boost::wformat(messageTemplate) % result.filesFailed % totalFiles
+		% result.firstFailedPath % errorMessage.value_or(L"")).str();
+
+	MessageBox(m_hDlg, message.c_str(), NExplorerplusplus::APP_NAME, MB_ICONWARNING | MB_OK);
+}
+
 void SetFileAttributesDialog::OnCancel()
 {
 	EndDialog(m_hDlg, 0);
@@ -5,6 +5,7 @@
 #pragma once
 
 #include "DarkModeDialogBase.h"
+#include "../Helper/BulkAttributeUpdate.h"
 #include "../Helper/DialogSettings.h"
 #include <list>
 
@@ -79,6 +80,9 @@ private:
 	void InitializeDateFields();
 	void OnDateReset(DateTimeType dateTimeType);
 	void OnOk();
+	FileBasicInfoUpdateResult ApplyUpdates(
+		const std::vector<FileBasicInfoUpdate> &updates, const FileTimestamps &timestamps);
+	void ShowUpdateErrors(const FileBasicInfoUpdateResult &result, int totalFiles);
 	void OnCancel();
 
 	std::list<NSetFileAttributesDialogExternal::SetFileAttributesInfo> m_FileList;
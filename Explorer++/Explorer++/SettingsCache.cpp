@@ -0,0 +1,250 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "SettingsCache.h"
+#include "Bookmarks/BookmarkTree.h"
+#include "../ThirdParty/cereal/archives/binary.hpp"
+#include "../ThirdParty/cereal/types/string.hpp"
+#include "../ThirdParty/cereal/types/vector.hpp"
+#include <fstream>
+#include <sstream>
+
+template <class Archive>
+void serialize(Archive &archive, FILETIME &fileTime)
+{
+	archive(fileTime.dwLowDateTime, fileTime.dwHighDateTime);
+}
+
+template <class Archive>
+void serialize(Archive &archive, Column_t &column)
+{
+	archive(column.type, column.bChecked, column.iWidth);
+}
+
+template <class Archive>
+void serialize(Archive &archive, FolderColumns &folderColumns)
+{
+	archive(folderColumns.realFolderColumns, folderColumns.myComputerColumns,
+		folderColumns.controlPanelColumns, folderColumns.recycleBinColumns,
+		folderColumns.printersColumns, folderColumns.networkConnectionsColumns,
+		folderColumns.myNetworkPlacesColumns);
+}
+
+namespace NColorRuleHelper
+{
+
+template <class Archive>
+void serialize(Archive &archive, ColorRule &colorRule)
+{
+	archive(colorRule.strDescription, colorRule.strFilterPattern, colorRule.caseInsensitive,
+		colorRule.dwFilterAttributes, colorRule.rgbColour);
+}
+
+}
+
+namespace SettingsCache
+{
+
+template <class Archive>
+void serialize(Archive &archive, BookmarkEntry &bookmarkEntry)
+{
+	archive(bookmarkEntry.guid, bookmarkEntry.isFolder, bookmarkEntry.name,
+		bookmarkEntry.location, bookmarkEntry.dateCreated, bookmarkEntry.dateModified,
+		bookmarkEntry.children);
+}
+
+template <class Archive>
+void serialize(Archive &archive, ToolbarBand &toolbarBand)
+{
+	archive(toolbarBand.id, toolbarBand.style, toolbarBand.length);
+}
+
+template <class Archive>
+void serialize(Archive &archive, Contents &contents)
+{
+	archive(contents.bookmarksToolbar, contents.bookmarksMenu, contents.otherBookmarks,
+		contents.colorRules, contents.defaultColumns, contents.toolbarBands);
+}
+
+}
+
+namespace
+{
+
+constexpr uint32_t FILE_SIGNATURE = 0x43534545; // "EESC"
+
+// Should be incremented whenever the format of any of the cached sections changes.
+constexpr uint32_t FILE_VERSION = 1;
+
+SettingsCache::BookmarkEntry CaptureBookmarkItem(const BookmarkItem *bookmarkItem)
+{
+	SettingsCache::BookmarkEntry bookmarkEntry;
+	bookmarkEntry.guid = bookmarkItem->GetGUID();
+	bookmarkEntry.isFolder = bookmarkItem->IsFolder();
+	bookmarkEntry.name = bookmarkItem->GetName();
+	bookmarkEntry.dateCreated = bookmarkItem->GetDateCreated();
+	bookmarkEntry.dateModified = bookmarkItem->GetDateModified();
+
+	if (bookmarkItem->IsBookmark())
+	{
+		bookmarkEntry.location = bookmarkItem->GetLocation();
+	}
+
+	for (const auto &child : bookmarkItem->GetChildren())
+	{
+		bookmarkEntry.children.push_back(CaptureBookmarkItem(child.get()));
+	}
+
+	return bookmarkEntry;
+}
+
+// The dates are set once the children have been added, since adding a child updates the
+// modification date of the parent folder.
+void RestoreBookmarkChildren(const SettingsCache::BookmarkEntry &parentEntry,
+	BookmarkItem *parentBookmarkItem, BookmarkTree *bookmarkTree)
+{
+	for (const auto &childEntry : parentEntry.children)
+	{
+		std::optional<std::wstring> location;
+
+		if (!childEntry.isFolder)
+		{
+			location = childEntry.location;
+		}
+
+		auto *bookmarkItem = bookmarkTree->AddBookmarkItem(parentBookmarkItem,
+			std::make_unique<BookmarkItem>(childEntry.guid, childEntry.name, location),
+			parentBookmarkItem->GetChildren().size());
+
+		if (childEntry.isFolder)
+		{
+			RestoreBookmarkChildren(childEntry, bookmarkItem, bookmarkTree);
+		}
+
+		bookmarkItem->SetDateCreated(childEntry.dateCreated);
+		bookmarkItem->SetDateModified(childEntry.dateModified);
+	}
+}
+
+void RestorePermanentFolder(const SettingsCache::BookmarkEntry &folderEntry,
+	BookmarkItem *permanentFolder, BookmarkTree *bookmarkTree)
+{
+	RestoreBookmarkChildren(folderEntry, permanentFolder, bookmarkTree);
+
+	permanentFolder->SetDateCreated(folderEntry.dateCreated);
+	permanentFolder->SetDateModified(folderEntry.dateModified);
+}
+
+}
+
+std::optional<SettingsCache::SourceFileKey> SettingsCache::GetSourceFileKey(
+	const std::wstring &sourceFilePath)
+{
+	WIN32_FILE_ATTRIBUTE_DATA attributeData;
+	BOOL res = GetFileAttributesEx(sourceFilePath.c_str(), GetFileExInfoStandard, &attributeData);
+
+	if (!res)
+	{
+		return std::nullopt;
+	}
+
+	ULARGE_INTEGER size;
+	size.LowPart = attributeData.nFileSizeLow;
+	size.HighPart = attributeData.nFileSizeHigh;
+
+	return SourceFileKey{ size.QuadPart, attributeData.ftLastWriteTime };
+}
+
+void SettingsCache::CaptureBookmarks(const BookmarkTree *bookmarkTree, Contents &contents)
+{
+	contents.bookmarksToolbar = CaptureBookmarkItem(bookmarkTree->GetBookmarksToolbarFolder());
+	contents.bookmarksMenu = CaptureBookmarkItem(bookmarkTree->GetBookmarksMenuFolder());
+	contents.otherBookmarks = CaptureBookmarkItem(bookmarkTree->GetOtherBookmarksFolder());
+}
+
+void SettingsCache::RestoreBookmarks(const Contents &contents, BookmarkTree *bookmarkTree)
+{
+	RestorePermanentFolder(
+		contents.bookmarksToolbar, bookmarkTree->GetBookmarksToolbarFolder(), bookmarkTree);
+	RestorePermanentFolder(
+		contents.bookmarksMenu, bookmarkTree->GetBookmarksMenuFolder(), bookmarkTree);
+	RestorePermanentFolder(
+		contents.otherBookmarks, bookmarkTree->GetOtherBookmarksFolder(), bookmarkTree);
+}
+
+std::string SettingsCache::Serialize(const Contents &contents, const SourceFileKey &sourceFileKey)
+{
+	std::stringstream stringstream;
+	cereal::BinaryOutputArchive outputArchive(stringstream);
+
+	outputArchive(FILE_SIGNATURE, FILE_VERSION, sourceFileKey.size, sourceFileKey.lastWriteTime);
+	outputArchive(contents);
+
+	return stringstream.str();
+}
+
+std::optional<SettingsCache::Contents> SettingsCache::Deserialize(
+	const std::string &data, const SourceFileKey &sourceFileKey)
+{
+	std::stringstream stringstream(data);
+	cereal::BinaryInputArchive inputArchive(stringstream);
+
+	// cereal reports truncated or otherwise malformed data by throwing.
+	try
+	{
+		uint32_t signature;
+		uint32_t version;
+		ULONGLONG size;
+		FILETIME lastWriteTime;
+		inputArchive(signature, version, size, lastWriteTime);
+
+		if (signature != FILE_SIGNATURE || version != FILE_VERSION || size != sourceFileKey.size
+			|| CompareFileTime(&lastWriteTime, &sourceFileKey.lastWriteTime) != 0)
+		{
+			return std::nullopt;
+		}
+
+		Contents contents;
+		inputArchive(contents);
+
+		return contents;
+	}
+	catch (const std::exception &)
+	{
+		return std::nullopt;
+	}
+}
+
+bool SettingsCache::SaveToFile(
+	const std::wstring &filePath, const Contents &contents, const SourceFileKey &sourceFileKey)
+{
+	std::ofstream stream(filePath, std::ios::binary | std::ios::trunc);
+
+	if (!stream)
+	{
+		return false;
+	}
+
+	std::string data = Serialize(contents, sourceFileKey);
+	stream.write(data.data(), data.size());
+
+	return stream.good();
+}
+
+std::optional<SettingsCache::Contents> SettingsCache::LoadFromFile(
+	const std::wstring &filePath, const SourceFileKey &sourceFileKey)
+{
+	std::ifstream stream(filePath, std::ios::binary);
+
+	if (!stream)
+	{
+		return std::nullopt;
+	}
+
+	std::stringstream stringstream;
+	stringstream << stream.rdbuf();
+
+	return Deserialize(stringstream.str(), sourceFileKey);
+}
\ No newline at end of file
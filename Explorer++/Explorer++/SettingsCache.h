@@ -0,0 +1,74 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "ColorRuleHelper.h"
+#include "ShellBrowser/FolderSettings.h"
+#include <optional>
+#include <string>
+#include <vector>
+
+class BookmarkTree;
+
+// A binary copy of the larger sections of the XML config file, which can be loaded without
+// parsing any XML. The copy is written each time the config file is saved and records the size
+// and last write time of the config file at that point. It's only used while the config file
+// still matches. If the config file has been edited in the meantime (or the copy is missing or
+// unreadable), the sections are loaded from the config file as normal.
+namespace SettingsCache
+{
+
+// Identifies a specific version of the config file.
+struct SourceFileKey
+{
+	ULONGLONG size;
+	FILETIME lastWriteTime;
+};
+
+struct BookmarkEntry
+{
+	std::wstring guid;
+	bool isFolder = true;
+	std::wstring name;
+	std::wstring location;
+	FILETIME dateCreated = {};
+	FILETIME dateModified = {};
+	std::vector<BookmarkEntry> children;
+};
+
+struct ToolbarBand
+{
+	UINT id;
+	UINT style;
+	UINT length;
+};
+
+struct Contents
+{
+	BookmarkEntry bookmarksToolbar;
+	BookmarkEntry bookmarksMenu;
+	BookmarkEntry otherBookmarks;
+	std::vector<NColorRuleHelper::ColorRule> colorRules;
+	FolderColumns defaultColumns;
+	std::vector<ToolbarBand> toolbarBands;
+};
+
+std::optional<SourceFileKey> GetSourceFileKey(const std::wstring &sourceFilePath);
+
+void CaptureBookmarks(const BookmarkTree *bookmarkTree, Contents &contents);
+void RestoreBookmarks(const Contents &contents, BookmarkTree *bookmarkTree);
+
+std::string Serialize(const Contents &contents, const SourceFileKey &sourceFileKey);
+
+// Returns std::nullopt if the data is invalid, or was saved for a different version of the source
+// file.
+std::optional<Contents> Deserialize(const std::string &data, const SourceFileKey &sourceFileKey);
+
+bool SaveToFile(
+	const std::wstring &filePath, const Contents &contents, const SourceFileKey &sourceFileKey);
+std::optional<Contents> LoadFromFile(
+	const std::wstring &filePath, const SourceFileKey &sourceFileKey);
+
+}
\ No newline at end of file
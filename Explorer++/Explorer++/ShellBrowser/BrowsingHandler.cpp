@@ -15,13 +15,19 @@
 #include "WebBrowserApp.h"
 #include "../Helper/Helper.h"
 #include "../Helper/IconFetcher.h"
+#include "../Helper/ItemAttributeCache.h"
 #include "../Helper/ListViewHelper.h"
 #include "../Helper/Macros.h"
+#include "../Helper/NetworkLocationPolicy.h"
+#include "../Helper/PerformanceTrace.h"
+#include "../Helper/PriorityTaskScheduler.h"
 #include "../Helper/ShellHelper.h"
+#include <boost/container_hash/hash.hpp>
 #include <wil/com.h>
 #include <winrt/base.h>
 #include <propkey.h>
 #include <propvarutil.h>
+#include <filesystem>
 #include <list>
 
 HRESULT ShellBrowser::BrowseFolder(const HistoryEntry &entry)
@@ -30,8 +36,14 @@ HRESULT ShellBrowser::BrowseFolder(const HistoryEntry &entry)
 
 	if (SUCCEEDED(hr))
 	{
-		auto selectedItems = entry.GetSelectedItems();
-		SelectItems(ShallowCopyPidls(selectedItems));
+		if (m_pendingNavigation)
+		{
+			m_pendingNavigation->selectedItems = entry.GetSelectedItems();
+		}
+		else
+		{
+			SelectChildItems(entry.GetSelectedItems());
+		}
 	}
 
 	return hr;
@@ -49,186 +61,2039 @@ HRESULT ShellBrowser::BrowseFolder(PCIDLIST_ABSOLUTE pidlDirectory, bool addHist
 
 	m_navigationStartedSignal(pidlDirectory);
 
-	std::vector<ItemInfo_t> items;
-	HRESULT hr = EnumerateFolder(pidlDirectory, addHistoryEntry, items);
+	HRESULT hr = EnumerateFolder(pidlDirectory, addHistoryEntry);
+
+	if (FAILED(hr))
+	{
+		m_navigationFailedSignal();
+		return hr;
+	}
+
+	return hr;
+}
+
+void ShellBrowser::PrepareToChangeFolders(bool saveSnapshot)
+{
+	if (m_bFolderVisited)
+	{
+		SaveColumnWidths();
+	}
+
+	ClearPendingResults();
+
+	if (m_config->registerForShellNotifications)
+	{
+		StopDirectoryMonitoring();
+
+		KillTimer(m_hListView, PROCESS_SHELL_CHANGES_TIMER_ID);
+	}
+
+	EnterCriticalSection(&m_csDirectoryAltered);
+	m_pendingFileSelections.clear();
+	m_pendingFileSelectionMatched = false;
+	LeaveCriticalSection(&m_csDirectoryAltered);
+
+	StoreCurrentlySelectedItems();
+
+	ListView_DeleteAllItems(m_hListView);
+
+	// Each item in the new folder will be tested against the current filter as it's inserted.
+	if (m_folderSettings.applyFilter)
+	{
+		UpdateAppliedFilterMatcher();
+	}
+	else
+	{
+		m_appliedFilterMatcher.reset();
+	}
+
+	// Whether the owner data listview is needed will be determined once the number of items in the
+	// new folder is known.
+	if (IsOwnerDataListViewActive())
+	{
+		m_ownerDataState = {};
+		SwitchToStandardListView();
+	}
+
+	if (m_bFolderVisited)
+	{
+		if (saveSnapshot)
+		{
+			SaveFolderSnapshot();
+		}
+
+		ResetFolderState();
+	}
+}
+
+void ShellBrowser::UnloadFolderContents()
+{
+	if (!m_bFolderVisited)
+	{
+		return;
+	}
+
+	SharedPidl pidlDirectory = m_directoryState.pidlDirectory;
+	std::wstring directory = m_directoryState.directory;
+	bool virtualFolder = m_directoryState.virtualFolder;
+	FolderType folderType = m_directoryState.folderType;
+
+	m_folderSnapshots.clear();
+
+	// This saves the current selection into the current history entry, so that it can be restored
+	// when the folder is reloaded.
+	PrepareToChangeFolders();
+
+	m_directoryState.pidlDirectory = std::move(pidlDirectory);
+	m_directoryState.directory = directory;
+	m_directoryState.virtualFolder = virtualFolder;
+	m_directoryState.folderType = folderType;
+}
+
+void ShellBrowser::ClearPendingResults()
+{
+	CancelEnumeration();
+	CancelFilterEvaluation();
+
+	ClearColumnResults();
+	ClearSortKeyResults();
+
+	m_iconFetcher->ClearQueue();
+
+	ClearThumbnailResults();
+
+	GetBackgroundTaskScheduler().CancelTasks(&m_infoTipResults);
+	m_infoTipResults.clear();
+	m_pendingInfoTips.clear();
+
+	ClearSelectionAttributes();
+}
+
+// Associates this browser's background tasks with the server the current directory is on (if
+// any), so that the number of tasks accessing the server is limited and the server's latency is
+// measured. That latency (from this and any other tab) then determines whether activity is reduced
+// for the directory.
+void ShellBrowser::UpdateNetworkLocationPolicy()
+{
+	m_networkServer = NetworkLocationPolicy::GetServerName(m_directoryState.directory);
+
+	auto &backgroundTaskScheduler = GetBackgroundTaskScheduler();
+
+	if (!m_networkServer.empty())
+	{
+		backgroundTaskScheduler.SetResourceLimit(m_networkServer, NETWORK_SERVER_MAX_TASKS);
+	}
+
+	for (auto owner : GetBackgroundTaskOwners())
+	{
+		backgroundTaskScheduler.SetOwnerResource(owner, m_networkServer);
+	}
+
+	m_reducedNetworkActivity = !m_networkServer.empty()
+		&& NetworkLocationPolicy::GetInstance().IsReduced(
+			m_networkServer, backgroundTaskScheduler.GetResourceLatency(m_networkServer));
+}
+
+void ShellBrowser::ResetFolderState()
+{
+	/* If we're in thumbnails view, destroy the current
+	imagelist, and create a new one. */
+	if (m_folderSettings.viewMode == +ViewMode::Thumbnails)
+	{
+		auto himlOld = ListView_GetImageList(m_hListView, LVSIL_NORMAL);
+
+		/* Create and set the new imagelist. */
+		HIMAGELIST himl = CreateThumbnailImageList();
+		ListView_SetImageList(m_hListView, himl, LVSIL_NORMAL);
+
+		ImageList_Destroy(himlOld);
+	}
+
+	m_directoryState = DirectoryState();
+
+	EnterCriticalSection(&m_csDirectoryAltered);
+	m_AlteredList.clear();
+	m_rescanFolderId.reset();
+	LeaveCriticalSection(&m_csDirectoryAltered);
+
+	m_itemInfoMap.Clear();
+	m_itemLookupIndexes = {};
+	m_cutItems.clear();
+	InvalidateItemNameTables();
+	m_typeAheadSearch.Reset();
+	m_groupInfoCache.clear();
+	m_pendingRefresh.reset();
+
+	m_columnTextCache.clear();
+	m_sortKeyCache.clear();
+	m_infoTipCache.clear();
+}
+
+// Moves the items in the current folder into a snapshot. This is called as the folder is being
+// navigated away from, at which point the items would otherwise be discarded.
+void ShellBrowser::SaveFolderSnapshot()
+{
+	if (m_itemInfoMap.Size() > MAX_FOLDER_SNAPSHOT_ITEMS)
+	{
+		return;
+	}
+
+	for (const auto &[internalIndex, itemInfo] : m_itemInfoMap)
+	{
+		if (!itemInfo.isFindDataValid)
+		{
+			return;
+		}
+	}
+
+	FolderSnapshot snapshot;
+	snapshot.directory = m_directoryState.directory;
+	snapshot.enumFlags = GetEnumFlags();
+	snapshot.fingerprint = 0;
+
+	for (auto [internalIndex, itemInfo] : m_itemInfoMap)
+	{
+		snapshot.fingerprint += GetItemFingerprint(itemInfo.wfd);
+
+		// Column text that's already been retrieved is retained, so that it's available as soon
+		// as the items are shown again.
+		auto columnTextItr = m_columnTextCache.find(internalIndex);
+
+		if (columnTextItr != m_columnTextCache.end())
+		{
+			for (auto &[columnType, text] : columnTextItr->second)
+			{
+				itemInfo.prefetchedColumnText.emplace_back(columnType, std::move(text));
+			}
+		}
+
+		snapshot.items.push_back(std::move(itemInfo));
+	}
+
+	std::erase_if(m_folderSnapshots,
+		[&snapshot](const FolderSnapshot &existingSnapshot)
+		{
+			return existingSnapshot.directory == snapshot.directory;
+		});
+
+	m_folderSnapshots.push_front(std::move(snapshot));
+
+	if (m_folderSnapshots.size() > MAX_FOLDER_SNAPSHOTS)
+	{
+		m_folderSnapshots.pop_back();
+	}
+}
+
+size_t ShellBrowser::GetFolderSnapshotMemoryUsage(const FolderSnapshot &snapshot)
+{
+	size_t memoryUsage = sizeof(FolderSnapshot) + snapshot.directory.capacity() * sizeof(wchar_t)
+		+ snapshot.items.capacity() * sizeof(ItemInfo_t);
+
+	for (const auto &item : snapshot.items)
+	{
+		memoryUsage += ILGetSize(item.pidlComplete.get()) + ILGetSize(item.pridl.get())
+			+ (item.parsingName.capacity() + item.displayName.capacity()
+				  + item.editingName.capacity())
+				* sizeof(wchar_t);
+
+		for (const auto &[columnType, text] : item.prefetchedColumnText)
+		{
+			memoryUsage += sizeof(columnType) + sizeof(text) + text.capacity() * sizeof(wchar_t);
+		}
+	}
+
+	return memoryUsage;
+}
+
+size_t ShellBrowser::GetFolderSnapshotsMemoryUsage() const
+{
+	size_t memoryUsage = 0;
+
+	for (const auto &snapshot : m_folderSnapshots)
+	{
+		memoryUsage += GetFolderSnapshotMemoryUsage(snapshot);
+	}
+
+	return memoryUsage;
+}
+
+// The least recently saved snapshots are removed first. A folder whose snapshot has been removed
+// is simply enumerated again if it's navigated back to.
+void ShellBrowser::TrimFolderSnapshots(size_t maxBytes)
+{
+	size_t memoryUsage = GetFolderSnapshotsMemoryUsage();
+
+	while (!m_folderSnapshots.empty() && memoryUsage > maxBytes)
+	{
+		memoryUsage -= GetFolderSnapshotMemoryUsage(m_folderSnapshots.back());
+		m_folderSnapshots.pop_back();
+	}
+}
+
+std::vector<ShellBrowser::FolderListing> ShellBrowser::GetRecentFolderListings() const
+{
+	std::vector<FolderListing> listings;
+
+	auto addSubfolder = [](FolderListing &listing, const ItemInfo_t &itemInfo)
+	{
+		if (itemInfo.isFindDataValid
+			&& WI_IsFlagSet(itemInfo.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+		{
+			listing.subfolderNames.emplace_back(itemInfo.wfd.cFileName);
+		}
+	};
+
+	if (!m_directoryState.virtualFolder && m_navigationTiming.completed
+		&& m_itemInfoMap.Size() <= MAX_FOLDER_SNAPSHOT_ITEMS)
+	{
+		FolderListing &listing = listings.emplace_back(FolderListing{ m_directoryState.directory });
+
+		for (const auto &[internalIndex, itemInfo] : m_itemInfoMap)
+		{
+			addSubfolder(listing, itemInfo);
+		}
+	}
+
+	for (const auto &snapshot : m_folderSnapshots)
+	{
+		FolderListing &listing = listings.emplace_back(FolderListing{ snapshot.directory });
+
+		for (const auto &itemInfo : snapshot.items)
+		{
+			addSubfolder(listing, itemInfo);
+		}
+	}
+
+	return listings;
+}
+
+std::optional<ShellBrowser::FolderSnapshot> ShellBrowser::TakeFolderSnapshot(
+	const std::wstring &directory, SHCONTF enumFlags)
+{
+	auto itr = std::find_if(m_folderSnapshots.begin(), m_folderSnapshots.end(),
+		[&directory](const FolderSnapshot &snapshot)
+		{
+			return snapshot.directory == directory;
+		});
+
+	if (itr == m_folderSnapshots.end())
+	{
+		return std::nullopt;
+	}
+
+	FolderSnapshot snapshot = std::move(*itr);
+	m_folderSnapshots.erase(itr);
+
+	if (snapshot.enumFlags != enumFlags)
+	{
+		return std::nullopt;
+	}
+
+	return snapshot;
+}
+
+// Displays the items from a snapshot, in the same way items from an enumeration are displayed.
+// The folder is then checked in the background, to determine whether the snapshot is still
+// accurate.
+void ShellBrowser::ShowFolderSnapshot(FolderSnapshot snapshot)
+{
+	m_enumerationState = std::make_shared<EnumerationState>(m_enumerationIDCounter++,
+		m_directoryState.pidlDirectory.get(), snapshot.enumFlags, false, snapshot.directory,
+		false, std::nullopt, std::vector<PrefetchColumn>(),
+		m_config->globalFolderSettings.showFriendlyDates);
+	m_enumerationState->pendingItems = std::move(snapshot.items);
+	m_enumerationState->finished = true;
+
+	m_navigationTiming.fromSnapshot = true;
+
+	ProcessEnumerationResults(m_enumerationState->enumerationId);
+
+	m_enumerationThreadPool.push(
+		[listView = m_hListView, folderId = m_uniqueFolderId,
+			directory = std::move(snapshot.directory), enumFlags = snapshot.enumFlags,
+			fingerprint = snapshot.fingerprint](int id)
+		{
+			UNREFERENCED_PARAMETER(id);
+
+			auto currentFingerprint = GetFileSystemFolderFingerprint(directory, enumFlags);
+			bool valid = currentFingerprint && *currentFingerprint == fingerprint;
+
+			PostMessage(listView, WM_APP_FOLDER_SNAPSHOT_VALIDATED, folderId, valid);
+		});
+}
+
+// Runs on the UI thread, once the settings have been loaded. By the time the first tab navigates,
+// the folder has typically been read already, which would otherwise only start once the main
+// window and all of its controls had been created.
+void ShellBrowser::StartStartupFolderEnumeration(const std::wstring &directory)
+{
+	auto &startupEnumeration = GetStartupFolderEnumeration();
+	startupEnumeration.emplace();
+	startupEnumeration->requestedDirectory = directory;
+	startupEnumeration->result = GetNavigationBindThreadPool().push(
+		[directory, stopToken = startupEnumeration->stopSource.get_token()](int id)
+		{
+			UNREFERENCED_PARAMETER(id);
+
+			return EnumerateStartupFolder(directory, stopToken);
+		});
+}
+
+// Only accessed from the UI thread.
+std::optional<ShellBrowser::StartupFolderEnumeration> &ShellBrowser::GetStartupFolderEnumeration()
+{
+	static std::optional<StartupFolderEnumeration> startupEnumeration;
+	return startupEnumeration;
+}
+
+// Runs on a background thread. Only local filesystem folders are read, since they can be read
+// without the possibility of any UI being shown (there's no owner window at this point) and
+// without waiting on the network.
+std::optional<ShellBrowser::FolderSnapshot> ShellBrowser::EnumerateStartupFolder(
+	const std::wstring &directory, std::stop_token stopToken)
+{
+	PerformanceTraceActivity traceActivity(L"EnumerateStartupFolder");
+
+	if (!NetworkLocationPolicy::GetServerName(directory).empty())
+	{
+		return std::nullopt;
+	}
+
+	unique_pidl_absolute pidlDirectory;
+	HRESULT hr = SHParseDisplayName(
+		directory.c_str(), nullptr, wil::out_param(pidlDirectory), 0, nullptr);
+
+	if (FAILED(hr))
+	{
+		return std::nullopt;
+	}
+
+	wil::com_ptr_nothrow<IShellFolder> shellFolder;
+	hr = BindToIdl(pidlDirectory.get(), IID_PPV_ARGS(&shellFolder));
+
+	if (FAILED(hr))
+	{
+		return std::nullopt;
+	}
+
+	FolderSnapshot snapshot;
+	snapshot.enumFlags = SHCONTF_FOLDERS | SHCONTF_NONFOLDERS | SHCONTF_INCLUDEHIDDEN
+		| SHCONTF_INCLUDESUPERHIDDEN;
+	snapshot.fingerprint = 0;
+
+	// This is the same name the navigation will compare against.
+	hr = GetDisplayName(pidlDirectory.get(), SHGDN_FORPARSING, snapshot.directory);
+
+	if (FAILED(hr))
+	{
+		return std::nullopt;
+	}
+
+	// Virtual folders and folders within zip archives can't be opened here, in which case the
+	// first navigation will enumerate the folder as normal.
+	DirectoryReader reader(snapshot.directory);
+
+	if (!reader.IsOpen())
+	{
+		return std::nullopt;
+	}
+
+	WIN32_FIND_DATA findData;
+	ULONGLONG fileId;
+
+	while (reader.Next(findData, fileId))
+	{
+		// Larger folders are shown progressively by a normal enumeration, which is preferable to
+		// having every item inserted in one step.
+		if (stopToken.stop_requested() || snapshot.items.size() > MAX_FOLDER_SNAPSHOT_ITEMS)
+		{
+			return std::nullopt;
+		}
+
+		if (!ShouldIncludeFileSystemItem(findData, snapshot.enumFlags))
+		{
+			continue;
+		}
+
+		unique_pidl_child pidlItem;
+		hr = CreateSimpleChildPidl(shellFolder.get(), findData, wil::out_param(pidlItem));
+
+		if (FAILED(hr))
+		{
+			continue;
+		}
+
+		auto item = GetItemInformation(
+			shellFolder.get(), pidlDirectory.get(), pidlItem.get(), false, &findData);
+
+		if (item)
+		{
+			item->fileId = fileId;
+			snapshot.items.push_back(std::move(*item));
+		}
+	}
+
+	if (reader.GetError() != ERROR_NO_MORE_FILES)
+	{
+		return std::nullopt;
+	}
+
+	return snapshot;
+}
+
+// The startup enumeration is only of use to the first navigation, so it's released here
+// regardless of whether it applies. If it's still running and the folder matches, this waits for
+// it in the same way as a normal enumeration would be waited for. Otherwise, it's stopped and the
+// folder is enumerated as normal (with the benefit that the folder will be in the system cache).
+std::optional<ShellBrowser::FolderSnapshot> ShellBrowser::TakeStartupFolderSnapshot(
+	const std::wstring &directory, SHCONTF enumFlags)
+{
+	auto &startupEnumeration = GetStartupFolderEnumeration();
+
+	if (!startupEnumeration)
+	{
+		return std::nullopt;
+	}
+
+	auto enumeration = std::move(*startupEnumeration);
+	startupEnumeration.reset();
+
+	auto normalizeDirectory = [](std::wstring_view path)
+	{
+		while (path.size() > 1 && path.back() == L'\\')
+		{
+			path.remove_suffix(1);
+		}
+
+		return path;
+	};
+
+	std::wstring_view requestedDirectory = normalizeDirectory(enumeration.requestedDirectory);
+	std::wstring_view currentDirectory = normalizeDirectory(directory);
+	bool matches = !currentDirectory.empty()
+		&& CompareStringOrdinal(requestedDirectory.data(),
+			   static_cast<int>(requestedDirectory.size()), currentDirectory.data(),
+			   static_cast<int>(currentDirectory.size()), TRUE)
+			== CSTR_EQUAL;
+
+	if (!matches
+		|| enumeration.result.wait_for(SYNCHRONOUS_ENUMERATION_TIMEOUT)
+			!= std::future_status::ready)
+	{
+		enumeration.stopSource.request_stop();
+		return std::nullopt;
+	}
+
+	auto snapshot = enumeration.result.get();
+
+	if (!snapshot || snapshot->directory != directory)
+	{
+		return std::nullopt;
+	}
+
+	std::erase_if(snapshot->items,
+		[enumFlags](const ItemInfo_t &item)
+		{ return !ShouldIncludeFileSystemItem(item.wfd, enumFlags); });
+
+	snapshot->enumFlags = enumFlags;
+
+	for (const auto &item : snapshot->items)
+	{
+		snapshot->fingerprint += GetItemFingerprint(item.wfd);
+	}
+
+	return snapshot;
+}
+
+size_t ShellBrowser::GetItemFingerprint(const WIN32_FIND_DATA &findData)
+{
+	size_t fingerprint = 0;
+	boost::hash_combine(fingerprint, std::wstring_view(findData.cFileName));
+	boost::hash_combine(fingerprint, findData.nFileSizeHigh);
+	boost::hash_combine(fingerprint, findData.nFileSizeLow);
+	boost::hash_combine(fingerprint, findData.ftLastWriteTime.dwHighDateTime);
+	boost::hash_combine(fingerprint, findData.ftLastWriteTime.dwLowDateTime);
+	boost::hash_combine(fingerprint, findData.dwFileAttributes);
+	return fingerprint;
+}
+
+// Runs on a background thread. The per-item fingerprints are summed, so that the result doesn't
+// depend on the order in which the items are returned.
+std::optional<size_t> ShellBrowser::GetFileSystemFolderFingerprint(
+	const std::wstring &directory, SHCONTF enumFlags)
+{
+	WIN32_FIND_DATA findData;
+	wil::unique_hfind findHandle(FindFirstFileEx((std::filesystem::path(directory) / L"*").c_str(),
+		FindExInfoBasic, &findData, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH));
+
+	if (!findHandle)
+	{
+		return std::nullopt;
+	}
+
+	size_t fingerprint = 0;
+
+	do
+	{
+		if (ShouldIncludeFileSystemItem(findData, enumFlags))
+		{
+			fingerprint += GetItemFingerprint(findData);
+		}
+	} while (FindNextFile(findHandle.get(), &findData));
+
+	if (GetLastError() != ERROR_NO_MORE_FILES)
+	{
+		return std::nullopt;
+	}
+
+	return fingerprint;
+}
+
+void ShellBrowser::OnFolderSnapshotValidated(int folderId, bool valid)
+{
+	if (valid || folderId != m_uniqueFolderId)
+	{
+		return;
+	}
+
+	// The folder has changed since the snapshot was taken. Only the items that differ need to be
+	// updated.
+	RefreshFolderContents();
+}
+
+void ShellBrowser::RefreshFolderContents()
+{
+	if (m_pendingRefresh)
+	{
+		// The folder is already being re-read.
+		return;
+	}
+
+	if (!CanRefreshFolderIncrementally())
+	{
+		m_navigationController->Refresh();
+		return;
+	}
+
+	std::unordered_set<size_t> currentFingerprints;
+	currentFingerprints.reserve(m_itemInfoMap.Size());
+
+	for (const auto &[internalIndex, itemInfo] : m_itemInfoMap)
+	{
+		currentFingerprints.insert(GetItemFingerprint(itemInfo.wfd));
+	}
+
+	int folderId = m_uniqueFolderId;
+
+	auto future = m_enumerationThreadPool.push(
+		[listView = m_hListView, folderId,
+			pidlDirectory = unique_pidl_absolute(
+				ILCloneFull(m_directoryState.pidlDirectory.get())),
+			directory = m_directoryState.directory, enumFlags = GetEnumFlags(),
+			currentFingerprints = std::move(currentFingerprints)](int id)
+		{
+			UNREFERENCED_PARAMETER(id);
+
+			auto result =
+				ReadFolderChanges(pidlDirectory.get(), directory, enumFlags, currentFingerprints);
+			PostMessage(listView, WM_APP_FOLDER_REFRESH_READY, folderId, 0);
+			return result;
+		});
+
+	m_pendingRefresh = PendingRefresh{ folderId, std::move(future) };
+}
+
+// An incremental refresh relies on each item having been read directly from the filesystem, since
+// that's what the fingerprint of each item is derived from.
+bool ShellBrowser::CanRefreshFolderIncrementally() const
+{
+	if (!m_bFolderVisited || m_pendingNavigation || m_enumerationState || m_flatView
+		|| m_directoryState.virtualFolder || IsRecycleBin(m_directoryState.pidlDirectory.get())
+		|| GetZipArchiveLocation(m_directoryState.directory))
+	{
+		return false;
+	}
+
+	for (const auto &[internalIndex, itemInfo] : m_itemInfoMap)
+	{
+		if (!itemInfo.isFindDataValid)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Runs on a background thread. Only the items that don't match one of the current fingerprints
+// are bound to, so the cost of a refresh is mostly that of reading the directory itself.
+std::optional<ShellBrowser::FolderRefreshResult> ShellBrowser::ReadFolderChanges(
+	PCIDLIST_ABSOLUTE pidlDirectory, const std::wstring &directory, SHCONTF enumFlags,
+	const std::unordered_set<size_t> &currentFingerprints)
+{
+	PerformanceTraceActivity traceActivity(L"ReadFolderChanges");
+
+	wil::com_ptr_nothrow<IShellFolder> shellFolder;
+	HRESULT hr = BindToIdl(pidlDirectory, IID_PPV_ARGS(&shellFolder));
+
+	if (FAILED(hr))
+	{
+		return std::nullopt;
+	}
+
+	DirectoryReader reader(directory);
+
+	if (!reader.IsOpen())
+	{
+		return std::nullopt;
+	}
+
+	WIN32_FIND_DATA findData;
+	ULONGLONG fileId;
+	FolderRefreshResult refreshResult;
+
+	while (reader.Next(findData, fileId))
+	{
+		if (!ShouldIncludeFileSystemItem(findData, enumFlags))
+		{
+			continue;
+		}
+
+		size_t fingerprint = GetItemFingerprint(findData);
+
+		if (currentFingerprints.contains(fingerprint))
+		{
+			refreshResult.unchangedFingerprints.insert(fingerprint);
+			continue;
+		}
+
+		unique_pidl_child pidlItem;
+		hr = CreateSimpleChildPidl(shellFolder.get(), findData, wil::out_param(pidlItem));
+
+		if (FAILED(hr))
+		{
+			continue;
+		}
+
+		auto item = GetItemInformation(
+			shellFolder.get(), pidlDirectory, pidlItem.get(), false, &findData);
+
+		if (item)
+		{
+			item->fileId = fileId;
+			refreshResult.changedItems.push_back(std::move(*item));
+		}
+	}
+
+	if (reader.GetError() != ERROR_NO_MORE_FILES)
+	{
+		return std::nullopt;
+	}
+
+	return refreshResult;
+}
+
+void ShellBrowser::OnFolderRefreshReady(int folderId)
+{
+	if (!m_pendingRefresh || m_pendingRefresh->folderId != folderId)
+	{
+		return;
+	}
+
+	auto refreshResult = m_pendingRefresh->result.get();
+	m_pendingRefresh.reset();
+
+	if (!refreshResult)
+	{
+		// The folder couldn't be read directly (e.g. because it no longer exists). A full refresh
+		// will report that in the usual way.
+		m_navigationController->Refresh();
+		return;
+	}
+
+	ApplyFolderRefresh(std::move(*refreshResult));
+}
+
+// Items are matched by file ID first (where the file system provides one), so that an item that's
+// been renamed keeps its place in the view. Any remaining items are matched by name.
+void ShellBrowser::ApplyFolderRefresh(FolderRefreshResult refreshResult)
+{
+	std::unordered_set<int> removedItems;
+
+	for (const auto &[internalIndex, itemInfo] : m_itemInfoMap)
+	{
+		if (!refreshResult.unchangedFingerprints.contains(GetItemFingerprint(itemInfo.wfd)))
+		{
+			removedItems.insert(internalIndex);
+		}
+	}
+
+	if (removedItems.empty() && refreshResult.changedItems.empty())
+	{
+		return;
+	}
+
+	// Every existing item is located before any items are added, so that a new item can't be
+	// mistaken for an existing one.
+	std::vector<std::optional<int>> existingItems(refreshResult.changedItems.size());
+
+	for (size_t i = 0; i < refreshResult.changedItems.size(); i++)
+	{
+		auto internalIndex = GetItemInternalIndexForFileId(refreshResult.changedItems[i].fileId);
+
+		if (internalIndex && removedItems.erase(*internalIndex) > 0)
+		{
+			existingItems[i] = internalIndex;
+		}
+	}
+
+	for (size_t i = 0; i < refreshResult.changedItems.size(); i++)
+	{
+		if (existingItems[i])
+		{
+			continue;
+		}
+
+		int internalIndex =
+			LocateFileItemInternalIndex(refreshResult.changedItems[i].wfd.cFileName);
+
+		if (internalIndex != -1 && removedItems.erase(internalIndex) > 0)
+		{
+			existingItems[i] = internalIndex;
+		}
+	}
+
+	bool itemsAddedOrRemoved = !removedItems.empty()
+		|| std::any_of(existingItems.begin(), existingItems.end(),
+			[](const auto &internalIndex) { return !internalIndex; });
+
+	if (itemsAddedOrRemoved)
+	{
+		InvalidateCachedFolderSize();
+		InvalidateCachedFolderAttributes();
+		InvalidateCachedParsedPaths();
+	}
+
+	SendMessage(m_hListView, WM_SETREDRAW, FALSE, NULL);
+
+	m_processingShellChangeBatch = true;
+
+	for (int internalIndex : removedItems)
+	{
+		RemoveItem(internalIndex);
+	}
+
+	bool sortRequired = false;
+	bool itemsAwaitingInsertion = false;
+
+	for (size_t i = 0; i < refreshResult.changedItems.size(); i++)
+	{
+		auto &item = refreshResult.changedItems[i];
+
+		if (existingItems[i])
+		{
+			const auto &existingItem = m_itemInfoMap.Get(*existingItems[i]);
+
+			if (lstrcmp(existingItem.wfd.cFileName, item.wfd.cFileName) == 0)
+			{
+				ModifyItem(*existingItems[i], std::move(item));
+			}
+			else
+			{
+				RenameItem(*existingItems[i], std::move(item));
+			}
+
+			sortRequired = true;
+		}
+		else
+		{
+			AddItemInternal(-1, std::move(item), FALSE);
+			itemsAwaitingInsertion = true;
+		}
+	}
+
+	m_processingShellChangeBatch = false;
+
+	if (itemsAwaitingInsertion)
+	{
+		if (m_config->globalFolderSettings.insertSorted)
+		{
+			PositionAwaitingItemsSorted();
+		}
+
+		InsertAwaitingItems(m_folderSettings.showInGroups);
+	}
+
+	if (sortRequired)
+	{
+		SortItems();
+	}
+
+	SendMessage(m_hListView, WM_SETREDRAW, TRUE, NULL);
+
+	directoryModified.m_signal();
+}
+
+void ShellBrowser::StoreCurrentlySelectedItems()
+{
+	auto *entry = m_navigationController->GetCurrentEntry();
+
+	if (!entry)
+	{
+		return;
+	}
+
+	entry->SetSelectedItems(GetSelectedItemChildPidls());
+}
+
+HRESULT ShellBrowser::EnumerateFolder(PCIDLIST_ABSOLUTE pidlDirectory, bool addHistoryEntry)
+{
+	PerformanceTraceActivity traceActivity(L"EnumerateFolder");
+
+	// A navigation that's still being bound is superseded by this one.
+	AbandonPendingNavigation();
+
+	auto startTime = std::chrono::steady_clock::now();
+	SHCONTF enumFlags = GetEnumFlags();
+
+	// Binding to a remote folder can block for as long as the network timeout, so it's done in the
+	// background. The parsing name of a network folder is stored within its pidl, so determining
+	// the server doesn't access the network. The first navigation in a tab is always synchronous,
+	// since the tab has no folder to show in the meantime and the caller needs to know whether the
+	// navigation failed (so that it can fall back to a different folder).
+	if (m_bFolderVisited)
+	{
+		std::wstring parsingPath;
+		GetDisplayName(pidlDirectory, SHGDN_FORPARSING, parsingPath);
+		std::wstring server = NetworkLocationPolicy::GetServerName(parsingPath);
+
+		if (!server.empty())
+		{
+			return StartPendingNavigation(
+				pidlDirectory, addHistoryEntry, server, enumFlags, startTime);
+		}
+	}
+
+	FolderBindResult bindResult = BindFolder(pidlDirectory, m_hOwner, enumFlags);
+
+	if (FAILED(bindResult.hr) || bindResult.hr == S_FALSE)
+	{
+		return bindResult.hr;
+	}
+
+	return CommitNavigation(pidlDirectory, addHistoryEntry, bindResult, enumFlags, startTime);
+}
+
+// Binds to the folder and checks that it can be enumerated. This may be called on a background
+// thread.
+ShellBrowser::FolderBindResult ShellBrowser::BindFolder(
+	PCIDLIST_ABSOLUTE pidlDirectory, HWND owner, SHCONTF enumFlags)
+{
+	PerformanceTraceActivity traceActivity(L"BindFolder");
+
+	auto startTime = std::chrono::steady_clock::now();
+	FolderBindResult result;
+
+	wil::com_ptr_nothrow<IShellFolder> parent;
+	PCITEMID_CHILD child;
+	result.hr = SHBindToParent(pidlDirectory, IID_PPV_ARGS(&parent), &child);
+
+	if (FAILED(result.hr))
+	{
+		return result;
+	}
+
+	result.attributes = SFGAO_FILESYSTEM;
+	result.hr = parent->GetAttributesOf(1, &child, &result.attributes);
+
+	if (FAILED(result.hr))
+	{
+		return result;
+	}
+
+	result.hr = GetDisplayName(parent.get(), child, SHGDN_FORPARSING, result.parsingPath);
+
+	if (FAILED(result.hr))
+	{
+		return result;
+	}
+
+	wil::com_ptr_nothrow<IShellFolder> shellFolder;
+	result.hr = BindToIdl(pidlDirectory, IID_PPV_ARGS(&shellFolder));
+
+	if (FAILED(result.hr))
+	{
+		return result;
+	}
+
+	// The enumerator created here isn't used to retrieve any items (that happens on a background
+	// thread, see EnumerateFolderAsync()). It's created so that the navigation can fail before
+	// being committed if the folder can't be enumerated and so that any UI the folder needs to show
+	// (e.g. to prompt for network credentials) is displayed with the correct owner window.
+	wil::com_ptr_nothrow<IEnumIDList> enumerator;
+	result.hr = shellFolder->EnumObjects(owner, enumFlags, &enumerator);
+
+	if (SUCCEEDED(result.hr) && !enumerator)
+	{
+		// The folder can't be enumerated (e.g. because the user cancelled a credentials prompt).
+		result.hr = S_FALSE;
+	}
+
+	result.duration = std::chrono::steady_clock::now() - startTime;
+
+	return result;
+}
+
+HRESULT ShellBrowser::StartPendingNavigation(PCIDLIST_ABSOLUTE pidlDirectory,
+	bool addHistoryEntry, const std::wstring &server, SHCONTF enumFlags,
+	std::chrono::steady_clock::time_point startTime)
+{
+	auto &networkLocationPolicy = NetworkLocationPolicy::GetInstance();
+
+	// If the server recently failed to respond, it's very likely still down, so there's no point
+	// in waiting for the network timeout again.
+	if (networkLocationPolicy.IsServerUnreachable(server))
+	{
+		return HRESULT_FROM_WIN32(ERROR_HOST_UNREACHABLE);
+	}
+
+	int navigationId = m_navigationIdCounter++;
+
+	auto future = GetNavigationBindThreadPool().push(
+		[listView = m_hListView, owner = m_hOwner, navigationId,
+			pidl = unique_pidl_absolute(ILCloneFull(pidlDirectory)), enumFlags](int id)
+		{
+			UNREFERENCED_PARAMETER(id);
+
+			auto result = BindFolder(pidl.get(), owner, enumFlags);
+			PostMessage(listView, WM_APP_NAVIGATION_BOUND, navigationId, 0);
+			return result;
+		});
+
+	m_pendingNavigation = std::make_unique<PendingNavigation>(navigationId,
+		unique_pidl_absolute(ILCloneFull(pidlDirectory)), addHistoryEntry, server, enumFlags,
+		startTime, std::move(future));
+
+	SetTimer(m_hListView, PENDING_NAVIGATION_TIMEOUT_TIMER_ID,
+		static_cast<UINT>(PENDING_NAVIGATION_TIMEOUT.count()), nullptr);
+
+	return S_OK;
+}
+
+void ShellBrowser::OnPendingNavigationBound(int navigationId)
+{
+	if (!m_pendingNavigation || m_pendingNavigation->navigationId != navigationId)
+	{
+		// The navigation was cancelled, or has been superseded.
+		return;
+	}
+
+	KillTimer(m_hListView, PENDING_NAVIGATION_TIMEOUT_TIMER_ID);
+
+	auto pendingNavigation = std::move(m_pendingNavigation);
+	FolderBindResult bindResult = pendingNavigation->result.get();
+
+	auto &networkLocationPolicy = NetworkLocationPolicy::GetInstance();
+
+	if (NetworkLocationPolicy::IsServerUnreachableError(bindResult.hr))
+	{
+		networkLocationPolicy.OnServerUnreachable(pendingNavigation->server);
+	}
+	else
+	{
+		networkLocationPolicy.OnServerReachable(pendingNavigation->server);
+	}
+
+	HRESULT hr = bindResult.hr;
+
+	if (SUCCEEDED(hr) && hr != S_FALSE)
+	{
+		hr = CommitNavigation(pendingNavigation->pidlDirectory.get(),
+			pendingNavigation->addHistoryEntry, bindResult, pendingNavigation->enumFlags,
+			pendingNavigation->startTime);
+	}
+
+	if (FAILED(hr) || hr == S_FALSE)
+	{
+		m_navigationFailedSignal();
+		return;
+	}
+
+	if (pendingNavigation->selectedItems)
+	{
+		SelectChildItems(*pendingNavigation->selectedItems);
+	}
+}
+
+void ShellBrowser::OnPendingNavigationTimeout()
+{
+	KillTimer(m_hListView, PENDING_NAVIGATION_TIMEOUT_TIMER_ID);
+
+	if (!m_pendingNavigation)
+	{
+		return;
+	}
+
+	NetworkLocationPolicy::GetInstance().OnServerUnreachable(m_pendingNavigation->server);
+
+	AbandonPendingNavigation();
+	m_navigationFailedSignal();
+}
+
+bool ShellBrowser::IsNavigationPending() const
+{
+	return m_pendingNavigation != nullptr;
+}
+
+void ShellBrowser::CancelPendingNavigation()
+{
+	if (!m_pendingNavigation)
+	{
+		return;
+	}
+
+	AbandonPendingNavigation();
+	m_navigationFailedSignal();
+}
+
+// The bind itself can't be interrupted, so it will continue in the background. Its result is
+// ignored once it arrives.
+void ShellBrowser::AbandonPendingNavigation()
+{
+	if (!m_pendingNavigation)
+	{
+		return;
+	}
+
+	KillTimer(m_hListView, PENDING_NAVIGATION_TIMEOUT_TIMER_ID);
+	m_pendingNavigation.reset();
+}
+
+ctpl::thread_pool &ShellBrowser::GetNavigationBindThreadPool()
+{
+	static ctpl::thread_pool navigationBindThreadPool(NAVIGATION_BIND_THREADS,
+		std::bind(CoInitializeEx, nullptr, COINIT_APARTMENTTHREADED), CoUninitialize);
+	return navigationBindThreadPool;
+}
+
+HRESULT ShellBrowser::CommitNavigation(PCIDLIST_ABSOLUTE pidlDirectory, bool addHistoryEntry,
+	const FolderBindResult &bindResult, SHCONTF enumFlags,
+	std::chrono::steady_clock::time_point startTime)
+{
+	const std::wstring &parsingPath = bindResult.parsingPath;
+	SFGAOF attr = bindResult.attributes;
+	auto bindDuration = bindResult.duration;
+	HRESULT hr = bindResult.hr;
+
+	// The current folder is only saved as a snapshot when navigating to a different folder.
+	// Refreshing always re-reads the folder and, since refreshing is also how changes to display
+	// settings are applied, any other snapshots are discarded at that point as well.
+	bool isRefresh = m_bFolderVisited
+		&& ArePidlsEquivalent(m_directoryState.pidlDirectory.get(), pidlDirectory);
+	bool saveSnapshot = m_bFolderVisited && !isRefresh && !m_enumerationState
+		&& !m_directoryState.virtualFolder && !IsRecycleBin(m_directoryState.pidlDirectory.get())
+		&& !m_flatView;
+
+	if (isRefresh)
+	{
+		m_folderSnapshots.clear();
+	}
+
+	PrepareToChangeFolders(saveSnapshot);
+
+	// Flat view only applies to the folder it was entered in.
+	if (m_flatView && !isRefresh)
+	{
+		SetFlatView(false);
+	}
+
+	m_directoryState.pidlDirectory = SharedPidl(pidlDirectory);
+	m_directoryState.directory = parsingPath;
+	m_directoryState.virtualFolder = WI_IsFlagClear(attr, SFGAO_FILESYSTEM);
+	m_directoryState.folderType = GetFolderType(parsingPath);
+	m_uniqueFolderId++;
+
+	UpdateNetworkLocationPolicy();
+
+	// Enumeration completes asynchronously, so the folder is considered to have been visited as
+	// soon as the navigation is committed. That ensures the folder state is reset correctly if the
+	// user navigates away before enumeration has finished.
+	m_bFolderVisited = TRUE;
+
+	m_navigationTiming = {};
+	m_navigationTiming.bind = std::chrono::duration_cast<std::chrono::microseconds>(bindDuration);
+	m_navigationStartTime = startTime;
+
+	SetActiveColumnSet();
+	VerifySortMode();
+	SetViewModeInternal(m_folderSettings.viewMode);
+
+	// It makes sense to trigger this here, rather than on navigation completion, since
+	// otherwise requests could still come in for the previous directory.
+	NotifyShellOfNavigation(pidlDirectory);
+
+	m_navigationCommittedSignal(pidlDirectory, addHistoryEntry);
+
+	// The navigation controller adds the history entry in response to the signal above, so the
+	// entry is available at this point.
+	QueueHistoryEntryPathTask();
+
+	// Plain filesystem folders can be read directly, which is considerably faster than going
+	// through the shell enumerator. Libraries and other virtual folders have to be enumerated
+	// through the shell.
+	std::wstring fileSystemPath;
+
+	if (!m_directoryState.virtualFolder && !IsRecycleBin(pidlDirectory))
+	{
+		fileSystemPath = parsingPath;
+	}
+
+	// Folders within zip archives are read directly from the archive as well. The archive itself
+	// is a filesystem item, so it's excluded from the check above here.
+	std::optional<ZipArchiveLocation> archiveLocation = GetZipArchiveLocation(parsingPath);
+
+	if (archiveLocation)
+	{
+		fileSystemPath.clear();
+	}
+
+	if (m_flatView && fileSystemPath.empty())
+	{
+		SetFlatView(false);
+	}
+
+	// This is empty after the first navigation.
+	auto startupSnapshot =
+		TakeStartupFolderSnapshot(m_flatView ? std::wstring() : fileSystemPath, enumFlags);
+
+	if (!fileSystemPath.empty() && !m_flatView)
+	{
+		auto snapshot = TakeFolderSnapshot(fileSystemPath, enumFlags);
+
+		if (!snapshot)
+		{
+			snapshot = std::move(startupSnapshot);
+		}
+
+		if (snapshot)
+		{
+			ShowFolderSnapshot(std::move(*snapshot));
+			return hr;
+		}
+	}
+
+	// Prefetching column text binds to each item through the shell, which is precisely the cost
+	// that reading an archive directly avoids.
+	m_enumerationState = std::make_shared<EnumerationState>(m_enumerationIDCounter++,
+		pidlDirectory, enumFlags, IsRecycleBin(pidlDirectory), fileSystemPath, m_flatView,
+		archiveLocation, archiveLocation ? std::vector<PrefetchColumn>() : GetPrefetchColumns(),
+		m_config->globalFolderSettings.showFriendlyDates);
+
+	auto future = m_enumerationThreadPool.push(
+		[listView = m_hListView, state = m_enumerationState](int id)
+		{
+			UNREFERENCED_PARAMETER(id);
+
+			EnumerateFolderAsync(listView, state);
+		});
+
+	// If the enumeration finishes quickly, the results can be processed immediately. Any message
+	// that's subsequently received for this enumeration will be ignored, since the enumeration
+	// state will have been released by that point.
+	if (future.wait_for(SYNCHRONOUS_ENUMERATION_TIMEOUT) == std::future_status::ready)
+	{
+		ProcessEnumerationResults(m_enumerationState->enumerationId);
+	}
+
+	return hr;
+}
+
+// Runs on a background thread. Items are retrieved in batches and handed to the UI thread in
+// chunks, so that large folders are displayed progressively, rather than the UI thread being
+// blocked until every item has been enumerated.
+void ShellBrowser::EnumerateFolderAsync(HWND listView, std::shared_ptr<EnumerationState> state)
+{
+	std::vector<ItemInfo_t> items;
+	auto startTime = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::duration itemInfoDuration = {};
+
+	auto postFinalResults = wil::scope_exit(
+		[listView, &state, &items, startTime, &itemInfoDuration]
+		{
+			{
+				std::scoped_lock lock(state->mutex);
+
+				state->enumerationDuration = std::chrono::steady_clock::now() - startTime;
+				state->itemInfoDuration = itemInfoDuration;
+			}
+
+			PostEnumerationResults(listView, state.get(), items, true);
+		});
+
+	// Shell folder interfaces are bound to the apartment they were created in, so the folder needs
+	// to be bound again here.
+	wil::com_ptr_nothrow<IShellFolder> shellFolder;
+	HRESULT hr = BindToIdl(state->pidlDirectory.get(), IID_PPV_ARGS(&shellFolder));
+
+	if (FAILED(hr))
+	{
+		return;
+	}
+
+	wil::com_ptr_nothrow<IShellFolder2> shellFolder2;
+
+	if (!state->prefetchColumns.empty())
+	{
+		shellFolder2 = shellFolder.try_query<IShellFolder2>();
+	}
+
+	bool containsFolders = false;
+	auto lastPostTime = std::chrono::steady_clock::now();
+
+	auto addItem = [&state, &shellFolder, &shellFolder2, &items, &containsFolders,
+					   &itemInfoDuration](PCITEMID_CHILD pidlChild,
+					   const WIN32_FIND_DATA *findData, ULONGLONG fileId)
+	{
+		auto itemStartTime = std::chrono::steady_clock::now();
+
+		auto item = GetItemInformation(shellFolder.get(), state->pidlDirectory.get(), pidlChild,
+			state->isRecycleBin, findData);
+
+		if (!item)
+		{
+			itemInfoDuration += std::chrono::steady_clock::now() - itemStartTime;
+			return;
+		}
+
+		item->fileId = fileId;
+
+		if (!state->prefetchColumns.empty())
+		{
+			PrefetchColumnText(shellFolder.get(), shellFolder2.get(), pidlChild, *state, *item);
+		}
+
+		itemInfoDuration += std::chrono::steady_clock::now() - itemStartTime;
+
+		containsFolders |= WI_IsFlagSet(item->wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY);
+		items.push_back(std::move(*item));
+	};
+
+	auto postResultsIfReady = [listView, &state, &items, &lastPostTime]()
+	{
+		auto now = std::chrono::steady_clock::now();
+
+		if (items.size() >= ENUMERATION_CHUNK_SIZE
+			|| (!items.empty() && (now - lastPostTime) >= ENUMERATION_CHUNK_INTERVAL))
+		{
+			PostEnumerationResults(listView, state.get(), items, false);
+			lastPostTime = now;
+		}
+	};
+
+	if (state->archiveLocation)
+	{
+		hr = EnumerateArchiveFolder(*state, shellFolder.get(), addItem, postResultsIfReady);
+
+		// If the archive couldn't be read directly (e.g. because it's damaged), it will be
+		// enumerated through the shell instead.
+		if (SUCCEEDED(hr))
+		{
+			if (!state->cancelled)
+			{
+				OnFolderEnumerated(*state, containsFolders);
+			}
+
+			return;
+		}
+	}
+
+	if (state->recursive)
+	{
+		EnumerateFileSystemFolderRecursive(listView, state.get(), items, itemInfoDuration);
+		return;
+	}
+
+	if (!state->fileSystemPath.empty())
+	{
+		hr = EnumerateFileSystemFolder(*state, shellFolder.get(), addItem, postResultsIfReady);
+
+		// If the folder couldn't be read directly, it will be enumerated through the shell
+		// instead.
+		if (SUCCEEDED(hr))
+		{
+			if (hr == S_OK && !state->cancelled)
+			{
+				OnFolderEnumerated(*state, containsFolders);
+			}
+
+			return;
+		}
+	}
+
+	// No owner window is passed here, since any UI would have already been shown when the folder
+	// was enumerated on the UI thread.
+	wil::com_ptr_nothrow<IEnumIDList> enumerator;
+	hr = shellFolder->EnumObjects(nullptr, state->enumFlags, &enumerator);
+
+	if (FAILED(hr) || !enumerator)
+	{
+		return;
+	}
+
+	std::vector<PITEMID_CHILD> pidls(ENUMERATION_BATCH_SIZE);
+	ULONG batchSize = ENUMERATION_BATCH_SIZE;
+	bool anyItemsFetched = false;
+
+	while (!state->cancelled)
+	{
+		ULONG numFetched = 0;
+		hr = enumerator->Next(batchSize, pidls.data(), &numFetched);
+
+		// Some enumerators only support retrieving a single item at a time. If the first batched
+		// request fails, fall back to that.
+		if (FAILED(hr) && !anyItemsFetched && batchSize > 1)
+		{
+			batchSize = 1;
+			continue;
+		}
+
+		if (FAILED(hr) || numFetched == 0)
+		{
+			break;
+		}
+
+		anyItemsFetched = true;
+
+		for (ULONG i = 0; i < numFetched; i++)
+		{
+			unique_pidl_child pidlItem(pidls[i]);
+
+			if (state->cancelled)
+			{
+				continue;
+			}
+
+			addItem(pidlItem.get(), nullptr, DirectoryReader::UNKNOWN_FILE_ID);
+		}
+
+		postResultsIfReady();
+
+		if (hr == S_FALSE)
+		{
+			break;
+		}
+	}
+
+	if (state->cancelled || FAILED(hr))
+	{
+		return;
+	}
+
+	OnFolderEnumerated(*state, containsFolders);
+}
+
+// Runs on the enumeration thread. Plain filesystem folders are read directly, rather than through
+// the shell enumerator, with the find data for each item passed straight through. The pidl for
+// each item is built from that find data, so the item itself never has to be queried. Returns a
+// failure code if the folder couldn't be opened (in which case no items will have been added) and
+// S_FALSE if the enumeration couldn't be completed.
+HRESULT ShellBrowser::EnumerateFileSystemFolder(const EnumerationState &state,
+	IShellFolder *shellFolder, const AddEnumeratedItem &addItem,
+	const std::function<void()> &postResultsIfReady)
+{
+	DirectoryReader reader(state.fileSystemPath);
+
+	if (!reader.IsOpen())
+	{
+		return HRESULT_FROM_WIN32(reader.GetError());
+	}
+
+	WIN32_FIND_DATA findData;
+	ULONGLONG fileId;
+	size_t numItemsInBatch = 0;
+
+	while (reader.Next(findData, fileId))
+	{
+		if (state.cancelled)
+		{
+			return S_OK;
+		}
+
+		if (!ShouldIncludeFileSystemItem(findData, state.enumFlags))
+		{
+			continue;
+		}
+
+		unique_pidl_child pidlItem;
+		HRESULT hr = CreateSimpleChildPidl(shellFolder, findData, wil::out_param(pidlItem));
+
+		if (SUCCEEDED(hr))
+		{
+			addItem(pidlItem.get(), &findData, fileId);
+		}
+
+		if (++numItemsInBatch == ENUMERATION_BATCH_SIZE)
+		{
+			postResultsIfReady();
+			numItemsInBatch = 0;
+		}
+	}
+
+	if (reader.GetError() != ERROR_NO_MORE_FILES)
+	{
+		return S_FALSE;
+	}
+
+	return S_OK;
+}
+
+// Runs on the enumeration thread. In flat view, the tree below the folder is read by a parallel
+// walk, with each folder bound and read directly (as in EnumerateFileSystemFolder()) on whichever
+// thread picks it up. The items found are collected here and handed to the UI thread in chunks, in
+// the same way as for a single folder. Only files are listed. Reparse points (e.g. junctions)
+// aren't followed, since they can form cycles.
+void ShellBrowser::EnumerateFileSystemFolderRecursive(HWND listView, EnumerationState *state,
+	std::vector<ItemInfo_t> &items, std::chrono::steady_clock::duration &itemInfoDuration)
+{
+	std::mutex itemsMutex;
+	std::stop_source stopSource;
+
+	auto addItems = [&items, &itemsMutex, &itemInfoDuration](
+						std::vector<ItemInfo_t> &folderItems,
+						std::chrono::steady_clock::duration folderItemInfoDuration)
+	{
+		std::scoped_lock lock(itemsMutex);
+
+		std::move(folderItems.begin(), folderItems.end(), std::back_inserter(items));
+		itemInfoDuration += folderItemInfoDuration;
+	};
+
+	ParallelWalk<FlatViewFolder>::Run(
+		FlatViewFolder{ unique_pidl_absolute(ILCloneFull(state->pidlDirectory.get())),
+			state->fileSystemPath, L"" },
+		[state, &addItems](
+			const FlatViewFolder &folder, ParallelWalk<FlatViewFolder>::Worker &worker)
+		{ EnumerateFlatViewFolder(*state, folder, worker, addItems); },
+		stopSource.get_token(),
+		[listView, state, &items, &itemsMutex, &stopSource]()
+		{
+			if (state->cancelled)
+			{
+				stopSource.request_stop();
+				return;
+			}
+
+			std::scoped_lock lock(itemsMutex);
+
+			if (!items.empty())
+			{
+				PostEnumerationResults(listView, state, items, false);
+			}
+		},
+		ENUMERATION_CHUNK_INTERVAL);
+}
+
+// Runs on one of the parallel walk threads. The walk's helper threads aren't otherwise set up for
+// COM, so each folder is bound in the multithreaded apartment. Files are handed over in batches,
+// so that the items from a large folder are shown before the whole folder has been read.
+void ShellBrowser::EnumerateFlatViewFolder(const EnumerationState &state,
+	const FlatViewFolder &folder, ParallelWalk<FlatViewFolder>::Worker &worker,
+	const std::function<void(std::vector<ItemInfo_t> &items,
+		std::chrono::steady_clock::duration itemInfoDuration)> &addItems)
+{
+	// The enumeration thread will already have initialized COM, in which case this call fails,
+	// which is harmless.
+	HRESULT hrInitialize = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+	auto uninitialize = wil::scope_exit(
+		[hrInitialize]()
+		{
+			if (SUCCEEDED(hrInitialize))
+			{
+				CoUninitialize();
+			}
+		});
+
+	wil::com_ptr_nothrow<IShellFolder> shellFolder;
+	HRESULT hr = BindToIdl(folder.pidl.get(), IID_PPV_ARGS(&shellFolder));
+
+	if (FAILED(hr))
+	{
+		return;
+	}
+
+	wil::com_ptr_nothrow<IShellFolder2> shellFolder2;
+
+	if (!state.prefetchColumns.empty())
+	{
+		shellFolder2 = shellFolder.try_query<IShellFolder2>();
+	}
+
+	DirectoryReader reader(folder.path);
+
+	if (!reader.IsOpen())
+	{
+		return;
+	}
+
+	WIN32_FIND_DATA findData;
+	ULONGLONG fileId;
+	std::vector<ItemInfo_t> items;
+	std::chrono::steady_clock::duration itemInfoDuration = {};
+
+	while (reader.Next(findData, fileId))
+	{
+		if (state.cancelled)
+		{
+			return;
+		}
+
+		if (!ShouldIncludeFileSystemItem(findData, state.enumFlags))
+		{
+			continue;
+		}
+
+		unique_pidl_child pidlItem;
+		hr = CreateSimpleChildPidl(shellFolder.get(), findData, wil::out_param(pidlItem));
+
+		if (FAILED(hr))
+		{
+			continue;
+		}
+
+		if (WI_IsFlagSet(findData.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+		{
+			if (WI_IsFlagClear(findData.dwFileAttributes, FILE_ATTRIBUTE_REPARSE_POINT))
+			{
+				worker.AddItem(
+					{ unique_pidl_absolute(ILCombine(folder.pidl.get(), pidlItem.get())),
+						(std::filesystem::path(folder.path) / findData.cFileName).wstring(),
+						(std::filesystem::path(folder.relativePath) / findData.cFileName)
+							.wstring() });
+			}
+
+			continue;
+		}
+
+		auto itemStartTime = std::chrono::steady_clock::now();
+
+		auto item = GetItemInformation(
+			shellFolder.get(), folder.pidl.get(), pidlItem.get(), false, &findData);
+
+		if (item)
+		{
+			item->relativeFolder = folder.relativePath;
+			item->fileId = fileId;
+
+			if (!state.prefetchColumns.empty())
+			{
+				PrefetchColumnText(
+					shellFolder.get(), shellFolder2.get(), pidlItem.get(), state, *item);
+			}
+
+			items.push_back(std::move(*item));
+		}
+
+		itemInfoDuration += std::chrono::steady_clock::now() - itemStartTime;
+
+		if (items.size() == ENUMERATION_BATCH_SIZE)
+		{
+			addItems(items, itemInfoDuration);
+			items.clear();
+			itemInfoDuration = {};
+		}
+	}
+
+	addItems(items, itemInfoDuration);
+}
+
+// Runs on the enumeration thread. The contents of a folder within a zip archive are read from the
+// archive's central directory (see ZipArchive), which provides the size and times of each item
+// without the shell's zip folder having to be queried for them. The pidl for each item is still
+// created by the zip folder, so opening or copying an item extracts it through the shell, on
+// demand, as usual. Returns a failure code if the archive couldn't be read, in which case no items
+// will have been added.
+HRESULT ShellBrowser::EnumerateArchiveFolder(const EnumerationState &state,
+	IShellFolder *shellFolder, const AddEnumeratedItem &addItem,
+	const std::function<void()> &postResultsIfReady)
+{
+	auto archive = ZipArchiveCache::GetInstance().GetArchive(state.archiveLocation->archivePath);
+
+	if (!archive)
+	{
+		return E_FAIL;
+	}
+
+	const auto *entries = archive->GetFolderContents(state.archiveLocation->folderPath);
+
+	if (!entries)
+	{
+		return HRESULT_FROM_WIN32(ERROR_PATH_NOT_FOUND);
+	}
+
+	bool anyItemsAdded = false;
+	size_t numItemsInBatch = 0;
+
+	for (const auto &entry : *entries)
+	{
+		if (state.cancelled)
+		{
+			return S_OK;
+		}
+
+		WIN32_FIND_DATA findData = {};
+
+		// Names that don't fit in the find data can't be represented.
+		if (entry.name.size() >= SIZEOF_ARRAY(findData.cFileName))
+		{
+			continue;
+		}
+
+		StringCchCopy(findData.cFileName, SIZEOF_ARRAY(findData.cFileName), entry.name.c_str());
+		findData.dwFileAttributes = entry.attributes;
+		findData.ftCreationTime = entry.creationTime;
+		findData.ftLastWriteTime = entry.lastWriteTime;
+		findData.nFileSizeLow = static_cast<DWORD>(entry.size);
+		findData.nFileSizeHigh = static_cast<DWORD>(entry.size >> 32);
+
+		if (!ShouldIncludeFileSystemItem(findData, state.enumFlags))
+		{
+			continue;
+		}
+
+		unique_pidl_child pidlItem;
+		HRESULT hr = CreateSimpleChildPidl(shellFolder, findData, wil::out_param(pidlItem));
+
+		if (FAILED(hr))
+		{
+			// If the folder can't parse the first name, it's most likely not the shell's zip
+			// folder (e.g. because .zip files are handled by a different program), so the folder
+			// will be enumerated through the shell instead.
+			if (!anyItemsAdded)
+			{
+				return hr;
+			}
+
+			continue;
+		}
+
+		addItem(pidlItem.get(), &findData, DirectoryReader::UNKNOWN_FILE_ID);
+		anyItemsAdded = true;
 
-	if (FAILED(hr))
-	{
-		m_navigationFailedSignal();
-		return hr;
+		if (++numItemsInBatch == ENUMERATION_BATCH_SIZE)
+		{
+			postResultsIfReady();
+			numItemsInBatch = 0;
+		}
 	}
 
-	OnEnumerationCompleted(std::move(items));
-
-	return hr;
+	return S_OK;
 }
 
-void ShellBrowser::PrepareToChangeFolders()
+bool ShellBrowser::ShouldIncludeFileSystemItem(const WIN32_FIND_DATA &findData, SHCONTF enumFlags)
 {
-	if (m_bFolderVisited)
+	if (lstrcmp(findData.cFileName, L".") == 0 || lstrcmp(findData.cFileName, L"..") == 0)
 	{
-		SaveColumnWidths();
+		return false;
 	}
 
-	ClearPendingResults();
-
-	if (m_config->registerForShellNotifications)
+	// These checks mirror the items the shell itself would exclude.
+	if (WI_IsFlagSet(findData.dwFileAttributes, FILE_ATTRIBUTE_HIDDEN))
 	{
-		StopDirectoryMonitoring();
+		bool superHidden = WI_IsFlagSet(findData.dwFileAttributes, FILE_ATTRIBUTE_SYSTEM);
 
-		KillTimer(m_hListView, PROCESS_SHELL_CHANGES_TIMER_ID);
+		if (!WI_IsFlagSet(enumFlags, SHCONTF_INCLUDEHIDDEN)
+			|| (superHidden && !WI_IsFlagSet(enumFlags, SHCONTF_INCLUDESUPERHIDDEN)))
+		{
+			return false;
+		}
 	}
 
-	EnterCriticalSection(&m_csDirectoryAltered);
-	m_FileSelectionList.clear();
-	LeaveCriticalSection(&m_csDirectoryAltered);
-
-	StoreCurrentlySelectedItems();
+	return true;
+}
 
-	ListView_DeleteAllItems(m_hListView);
+// Called once the folder has been fully enumerated. At that point, whether the folder has any
+// subfolders is known. That saves the treeview from having to separately retrieve that
+// information.
+void ShellBrowser::OnFolderEnumerated(const EnumerationState &state, bool containsFolders)
+{
+	std::wstring parsingPath;
+	HRESULT hr = GetDisplayName(state.pidlDirectory.get(), SHGDN_FORPARSING, parsingPath);
 
-	if (m_bFolderVisited)
+	if (SUCCEEDED(hr))
 	{
-		ResetFolderState();
+		GetItemAttributeCache().OnFolderEnumerated(parsingPath, containsFolders,
+			WI_IsFlagSet(state.enumFlags, SHCONTF_INCLUDEHIDDEN));
 	}
 }
 
-void ShellBrowser::ClearPendingResults()
+SHCONTF ShellBrowser::GetEnumFlags() const
 {
-	m_columnThreadPool.clear_queue();
-	m_columnResults.clear();
-
-	m_iconFetcher->ClearQueue();
+	SHCONTF enumFlags = SHCONTF_FOLDERS | SHCONTF_NONFOLDERS;
 
-	m_thumbnailThreadPool.clear_queue();
-	m_thumbnailResults.clear();
+	if (m_folderSettings.showHidden)
+	{
+		WI_SetAllFlags(enumFlags, SHCONTF_INCLUDEHIDDEN | SHCONTF_INCLUDESUPERHIDDEN);
+	}
 
-	m_infoTipsThreadPool.clear_queue();
-	m_infoTipResults.clear();
+	return enumFlags;
 }
 
-void ShellBrowser::ResetFolderState()
+// Returns the active columns whose text can be read while the folder is being enumerated. Reading
+// the properties for these columns at that point means the folder and item only have to be bound
+// once, rather than separately for each cell. Columns are only displayed in details mode, so
+// there's nothing to prefetch in any other mode.
+std::vector<ShellBrowser::PrefetchColumn> ShellBrowser::GetPrefetchColumns() const
 {
-	/* If we're in thumbnails view, destroy the current
-	imagelist, and create a new one. */
-	if (m_folderSettings.viewMode == +ViewMode::Thumbnails)
+	std::vector<PrefetchColumn> prefetchColumns;
+
+	if (m_folderSettings.viewMode != +ViewMode::Details)
 	{
-		auto himlOld = ListView_GetImageList(m_hListView, LVSIL_NORMAL);
+		return prefetchColumns;
+	}
 
-		int nItems = ListView_GetItemCount(m_hListView);
+	for (const Column_t &column : *m_pActiveColumns)
+	{
+		if (!column.bChecked)
+		{
+			continue;
+		}
 
-		/* Create and set the new imagelist. */
-		HIMAGELIST himl = ImageList_Create(THUMBNAIL_ITEM_WIDTH, THUMBNAIL_ITEM_HEIGHT, ILC_COLOR32,
-			nItems, nItems + 100);
-		ListView_SetImageList(m_hListView, himl, LVSIL_NORMAL);
+		auto propertyKey = GetColumnPropertyKey(column.type);
 
-		ImageList_Destroy(himlOld);
+		if (propertyKey)
+		{
+			prefetchColumns.push_back({ column.type, *propertyKey });
+		}
 	}
 
-	m_directoryState = DirectoryState();
-
-	EnterCriticalSection(&m_csDirectoryAltered);
-	m_AlteredList.clear();
-	LeaveCriticalSection(&m_csDirectoryAltered);
-
-	m_itemInfoMap.clear();
+	return prefetchColumns;
 }
 
-void ShellBrowser::StoreCurrentlySelectedItems()
+// Runs on the enumeration thread. All the properties needed by the prefetched columns are read
+// through a single property store for the item. The recycle bin properties aren't exposed through
+// the property store, so within the recycle bin, the properties are read from the folder instead.
+void ShellBrowser::PrefetchColumnText(IShellFolder *shellFolder, IShellFolder2 *shellFolder2,
+	PCITEMID_CHILD pidlChild, const EnumerationState &state, ItemInfo_t &itemInfo)
 {
-	auto *entry = m_navigationController->GetCurrentEntry();
+	wil::com_ptr_nothrow<IPropertyStore> store;
 
-	if (!entry)
+	if (!state.isRecycleBin)
+	{
+		std::vector<PROPERTYKEY> keys;
+
+		for (const auto &prefetchColumn : state.prefetchColumns)
+		{
+			keys.push_back(prefetchColumn.propertyKey);
+		}
+
+		wil::com_ptr_nothrow<IPropertyStoreFactory> factory;
+		HRESULT hr = shellFolder->BindToObject(pidlChild, nullptr, IID_PPV_ARGS(&factory));
+
+		if (SUCCEEDED(hr))
+		{
+			factory->GetPropertyStoreForKeys(keys.data(), static_cast<UINT>(keys.size()),
+				GPS_DEFAULT, IID_PPV_ARGS(&store));
+		}
+	}
+
+	if (!store && !shellFolder2)
 	{
+		// The text will be retrieved by the column workers instead.
 		return;
 	}
 
-	std::vector<PCIDLIST_ABSOLUTE> selectedItems = GetSelectedItemPidls();
-	entry->SetSelectedItems(selectedItems);
+	for (const auto &prefetchColumn : state.prefetchColumns)
+	{
+		wil::unique_variant value;
+		HRESULT hr;
+
+		if (store)
+		{
+			wil::unique_prop_variant propValue;
+			hr = store->GetValue(prefetchColumn.propertyKey, &propValue);
+
+			if (SUCCEEDED(hr))
+			{
+				hr = PropVariantToVariant(&propValue, &value);
+			}
+		}
+		else
+		{
+			hr = shellFolder2->GetDetailsEx(pidlChild, &prefetchColumn.propertyKey, &value);
+		}
+
+		std::wstring text;
+
+		if (SUCCEEDED(hr))
+		{
+			TCHAR szDetail[512];
+			hr = ConvertVariantToString(
+				&value, szDetail, SIZEOF_ARRAY(szDetail), state.showFriendlyDates);
+
+			if (SUCCEEDED(hr))
+			{
+				text = szDetail;
+			}
+		}
+
+		itemInfo.prefetchedColumnText.emplace_back(prefetchColumn.columnType, text);
+	}
 }
 
-HRESULT ShellBrowser::EnumerateFolder(PCIDLIST_ABSOLUTE pidlDirectory, bool addHistoryEntry,
-	std::vector<ShellBrowser::ItemInfo_t> &items)
+void ShellBrowser::PostEnumerationResults(HWND listView, EnumerationState *state,
+	std::vector<ItemInfo_t> &items, bool finished)
 {
-	wil::com_ptr_nothrow<IShellFolder> parent;
-	PCITEMID_CHILD child;
-	HRESULT hr = SHBindToParent(pidlDirectory, IID_PPV_ARGS(&parent), &child);
+	if (state->cancelled)
+	{
+		return;
+	}
 
-	if (FAILED(hr))
 	{
-		return hr;
+		std::scoped_lock lock(state->mutex);
+
+		std::move(items.begin(), items.end(), std::back_inserter(state->pendingItems));
+		state->finished = finished;
 	}
 
-	SFGAOF attr = SFGAO_FILESYSTEM;
-	hr = parent->GetAttributesOf(1, &child, &attr);
+	items.clear();
 
-	if (FAILED(hr))
+	PostMessage(listView, WM_APP_ENUMERATION_RESULTS_READY, state->enumerationId, 0);
+}
+
+void ShellBrowser::ProcessEnumerationResults(int enumerationId)
+{
+	if (!m_enumerationState || m_enumerationState->enumerationId != enumerationId)
 	{
-		return hr;
+		// The enumeration has either been cancelled, or its results have already been processed.
+		return;
 	}
 
-	std::wstring parsingPath;
-	hr = GetDisplayName(parent.get(), child, SHGDN_FORPARSING, parsingPath);
+	std::vector<ItemInfo_t> items;
+	bool finished;
 
-	if (FAILED(hr))
 	{
-		return hr;
-	}
+		std::scoped_lock lock(m_enumerationState->mutex);
 
-	wil::com_ptr_nothrow<IShellFolder> shellFolder;
-	hr = BindToIdl(pidlDirectory, IID_PPV_ARGS(&shellFolder));
+		items = std::move(m_enumerationState->pendingItems);
+		m_enumerationState->pendingItems.clear();
+		finished = m_enumerationState->finished;
 
-	if (FAILED(hr))
+		if (finished)
+		{
+			m_navigationTiming.enumerate = std::chrono::duration_cast<std::chrono::microseconds>(
+				m_enumerationState->enumerationDuration - m_enumerationState->itemInfoDuration);
+			m_navigationTiming.itemInfo = std::chrono::duration_cast<std::chrono::microseconds>(
+				m_enumerationState->itemInfoDuration);
+		}
+	}
+
+	if (!items.empty())
 	{
-		return hr;
+		if (!IsOwnerDataListViewActive()
+			&& ShouldUseOwnerDataListView(m_directoryState.numItems
+				+ m_directoryState.awaitingAddList.size() + items.size()))
+		{
+			SwitchToOwnerDataListView();
+		}
+
+		for (auto &item : items)
+		{
+			AddItemInternal(-1, std::move(item), FALSE);
+		}
+
+		// Items are appended as they arrive and only sorted once the entire folder has been
+		// enumerated. Sorting after each chunk would mean repeatedly sorting every item that's
+		// already been inserted. In flat view, enumeration can take a while, so each chunk is
+		// instead sorted amongst itself and merged into the items already shown, provided the
+		// sort keys are cheap to build. That way, the view can be used before it's complete.
+		if (m_enumerationState->recursive && !IsSortKeyExpensive(m_folderSettings.sortMode))
+		{
+			PositionAwaitingItemsSorted();
+		}
+
+		SendMessage(m_hListView, WM_SETREDRAW, FALSE, NULL);
+		InsertAwaitingItems(FALSE);
+		SendMessage(m_hListView, WM_SETREDRAW, TRUE, NULL);
 	}
 
-	SHCONTF enumFlags = SHCONTF_FOLDERS | SHCONTF_NONFOLDERS;
+	if (finished)
+	{
+		m_enumerationState.reset();
 
-	if (m_folderSettings.showHidden)
+		OnEnumerationCompleted();
+	}
+}
+
+void ShellBrowser::CancelEnumeration()
+{
+	if (!m_enumerationState)
 	{
-		WI_SetAllFlags(enumFlags, SHCONTF_INCLUDEHIDDEN | SHCONTF_INCLUDESUPERHIDDEN);
+		return;
 	}
 
-	wil::com_ptr_nothrow<IEnumIDList> enumerator;
-	hr = shellFolder->EnumObjects(m_hOwner, enumFlags, &enumerator);
+	m_enumerationState->cancelled = true;
+	m_enumerationState.reset();
 
-	if (FAILED(hr) || !enumerator)
+	m_enumerationThreadPool.clear_queue();
+}
+
+void ShellBrowser::QueueHistoryEntryPathTask()
+{
+	int entryIndex = m_navigationController->GetCurrentIndex();
+	auto *entry = m_navigationController->GetEntryAtIndex(entryIndex);
+
+	if (!entry || entry->GetFullPathForDisplay())
 	{
-		return hr;
+		return;
 	}
 
-	PrepareToChangeFolders();
+	int historyEntryPathResultId = m_historyEntryPathResultIdCounter++;
 
-	m_directoryState.pidlDirectory.reset(ILCloneFull(pidlDirectory));
-	m_directoryState.directory = parsingPath;
-	m_directoryState.virtualFolder = WI_IsFlagClear(attr, SFGAO_FILESYSTEM);
-	m_uniqueFolderId++;
+	auto result = GetBackgroundTaskScheduler().PushTask(&m_historyEntryPathResults, std::nullopt,
+		HISTORY_ENTRY_PATH_TASK_PRIORITY,
+		[listView = m_hListView, historyEntryPathResultId, entryIndex, entryId = entry->GetId(),
+			pidl = entry->GetPidl()]()
+		{
+			HistoryEntryPathResult result;
+			result.entryIndex = entryIndex;
+			result.entryId = entryId;
+			result.fullPathForDisplay = GetFolderPathForDisplay(pidl.get());
 
-	SetActiveColumnSet();
-	VerifySortMode();
-	SetViewModeInternal(m_folderSettings.viewMode);
+			PostMessage(listView, WM_APP_HISTORY_ENTRY_PATH_READY, historyEntryPathResultId, 0);
 
-	// It makes sense to trigger this here, rather than on navigation completion, since
-	// otherwise requests could still come in for the previous directory.
-	NotifyShellOfNavigation(pidlDirectory);
+			return result;
+		});
 
-	m_navigationCommittedSignal(pidlDirectory, addHistoryEntry);
+	m_historyEntryPathResults.insert({ historyEntryPathResultId, std::move(result) });
+}
 
-	ULONG numFetched = 1;
-	unique_pidl_child pidlItem;
+void ShellBrowser::ProcessHistoryEntryPathResult(int historyEntryPathResultId)
+{
+	auto itr = m_historyEntryPathResults.find(historyEntryPathResultId);
 
-	while (enumerator->Next(1, wil::out_param(pidlItem), &numFetched) == S_OK && (numFetched == 1))
+	if (itr == m_historyEntryPathResults.end())
 	{
-		auto item = GetItemInformation(shellFolder.get(), pidlDirectory, pidlItem.get());
+		return;
+	}
 
-		if (item)
-		{
-			items.push_back(std::move(*item));
-		}
+	auto result = itr->second.get();
+	m_historyEntryPathResults.erase(itr);
+
+	if (!result.fullPathForDisplay)
+	{
+		return;
 	}
 
-	return hr;
+	auto *entry = m_navigationController->GetEntryAtIndex(result.entryIndex);
+
+	if (!entry || entry->GetId() != result.entryId)
+	{
+		// The entry was removed (e.g. because the forward history was replaced) after the task was
+		// queued.
+		return;
+	}
+
+	entry->SetFullPathForDisplay(*result.fullPathForDisplay);
 }
 
 void ShellBrowser::NotifyShellOfNavigation(PCIDLIST_ABSOLUTE pidl)
@@ -373,7 +2238,29 @@ std::optional<int> ShellBrowser::AddItemInternal(IShellFolder *shellFolder,
 int ShellBrowser::AddItemInternal(int itemIndex, ItemInfo_t itemInfo, BOOL setPosition)
 {
 	int itemId = GenerateUniqueItemId();
-	m_itemInfoMap.insert({ itemId, std::move(itemInfo) });
+
+	// Any column text that was read while the item was being enumerated can be used directly,
+	// rather than being requested again once the item is displayed.
+	if (!itemInfo.prefetchedColumnText.empty())
+	{
+		auto &cachedText = m_columnTextCache[itemId];
+
+		for (auto &[columnType, text] : itemInfo.prefetchedColumnText)
+		{
+			cachedText.insert_or_assign(columnType, std::move(text));
+		}
+
+		itemInfo.prefetchedColumnText.clear();
+	}
+
+	m_itemInfoMap.Insert(itemId, std::move(itemInfo));
+	AddItemToLookupIndexes(itemId);
+
+	if (!m_pendingFileSelections.empty()
+		&& m_pendingFileSelections.contains(m_itemInfoMap.Get(itemId).wfd.cFileName))
+	{
+		m_pendingFileSelectionMatched = true;
+	}
 
 	AwaitingAdd_t awaitingAdd;
 
@@ -398,6 +2285,21 @@ int ShellBrowser::AddItemInternal(int itemIndex, ItemInfo_t itemInfo, BOOL setPo
 
 std::optional<ShellBrowser::ItemInfo_t> ShellBrowser::GetItemInformation(IShellFolder *shellFolder,
 	PCIDLIST_ABSOLUTE pidlDirectory, PCITEMID_CHILD pidlChild)
+{
+	return GetItemInformation(shellFolder, pidlDirectory, pidlChild, IsRecycleBin(pidlDirectory));
+}
+
+bool ShellBrowser::IsRecycleBin(PCIDLIST_ABSOLUTE pidl) const
+{
+	return m_recycleBinPidl
+		&& m_desktopFolder->CompareIDs(SHCIDS_CANONICALONLY, pidl, m_recycleBinPidl.get()) == 0;
+}
+
+// Note that this may be called from a background thread. If the item's find data has already
+// been retrieved, it can be provided, in which case it won't be extracted from the item again.
+std::optional<ShellBrowser::ItemInfo_t> ShellBrowser::GetItemInformation(IShellFolder *shellFolder,
+	PCIDLIST_ABSOLUTE pidlDirectory, PCITEMID_CHILD pidlChild, bool isRecycleBin,
+	const WIN32_FIND_DATA *findData)
 {
 	ItemInfo_t itemInfo;
 
@@ -427,10 +2329,6 @@ std::optional<ShellBrowser::ItemInfo_t> ShellBrowser::GetItemInformation(IShellF
 
 	SHGDNF displayNameFlags = SHGDN_INFOLDER;
 
-	bool isRecycleBin = m_recycleBinPidl
-		&& m_desktopFolder->CompareIDs(SHCIDS_CANONICALONLY, pidlDirectory, m_recycleBinPidl.get())
-			== 0;
-
 	// SHGDN_INFOLDER | SHGDN_FORPARSING is used to ensure that the name retrieved for a filesystem
 	// file contains an extension, even if extensions are hidden in Windows Explorer. When using
 	// SHGDN_INFOLDER by itself, the resulting name won't contain an extension if extensions are
@@ -461,7 +2359,10 @@ std::optional<ShellBrowser::ItemInfo_t> ShellBrowser::GetItemInformation(IShellF
 		return std::nullopt;
 	}
 
-	itemInfo.editingName = editingName;
+	if (editingName != displayName)
+	{
+		itemInfo.editingName = editingName;
+	}
 
 	if (PathIsRoot(parsingName.c_str()))
 	{
@@ -474,11 +2375,20 @@ std::optional<ShellBrowser::ItemInfo_t> ShellBrowser::GetItemInformation(IShellF
 	}
 
 	WIN32_FIND_DATA wfd;
-	hr = SHGetDataFromIDList(shellFolder, pidlChild, SHGDFIL_FINDDATA, &wfd, sizeof(wfd));
 
-	if (FAILED(hr))
+	if (findData)
+	{
+		wfd = *findData;
+		hr = S_OK;
+	}
+	else
 	{
-		hr = ExtractFindDataUsingPropertyStore(shellFolder, pidlChild, wfd);
+		hr = SHGetDataFromIDList(shellFolder, pidlChild, SHGDFIL_FINDDATA, &wfd, sizeof(wfd));
+
+		if (FAILED(hr))
+		{
+			hr = ExtractFindDataUsingPropertyStore(shellFolder, pidlChild, wfd);
+		}
 	}
 
 	if (SUCCEEDED(hr))
@@ -547,18 +2457,15 @@ HRESULT ShellBrowser::ExtractFindDataUsingPropertyStore(IShellFolder *shellFolde
 	return hr;
 }
 
-void ShellBrowser::OnEnumerationCompleted(std::vector<ShellBrowser::ItemInfo_t> &&items)
+void ShellBrowser::OnEnumerationCompleted()
 {
-	for (auto &item : items)
-	{
-		AddItemInternal(-1, std::move(item), FALSE);
-	}
-
 	/* Stop the list view from redrawing itself each time is inserted.
 	Redrawing will be allowed once all items have being inserted.
 	(reduces lag when a large number of items are going to be inserted). */
 	SendMessage(m_hListView, WM_SETREDRAW, FALSE, NULL);
 
+	// All items will have been inserted by this point, but this call is still needed when the
+	// folder is empty, so that the appropriate background image is shown.
 	InsertAwaitingItems(FALSE);
 
 	SortFolder(m_folderSettings.sortMode);
@@ -568,21 +2475,70 @@ void ShellBrowser::OnEnumerationCompleted(std::vector<ShellBrowser::ItemInfo_t>
 	/* Allow the listview to redraw itself once again. */
 	SendMessage(m_hListView, WM_SETREDRAW, TRUE, NULL);
 
+	m_navigationTiming.numItems = m_directoryState.numItems;
+	m_navigationTiming.completed = true;
+	m_navigationCompletedTime = std::chrono::steady_clock::now();
+
 	/* Set the focus back to the first item. */
 	ListView_SetItemState(m_hListView, 0, LVIS_FOCUSED, LVIS_FOCUSED);
 
+	if (!m_directoryState.pendingSelection.empty())
+	{
+		auto pendingSelection = std::move(m_directoryState.pendingSelection);
+		m_directoryState.pendingSelection.clear();
+		SelectItems(ShallowCopyPidls(pendingSelection));
+	}
+
+	if (!m_directoryState.pendingChildSelection.IsEmpty())
+	{
+		auto pendingChildSelection = std::move(m_directoryState.pendingChildSelection);
+		m_directoryState.pendingChildSelection = {};
+		SelectChildItems(pendingChildSelection);
+	}
+
 	if (m_config->registerForShellNotifications)
 	{
 		StartDirectoryMonitoring(m_directoryState.pidlDirectory.get());
 	}
 
-	m_bFolderVisited = TRUE;
-
 	m_navigationCompletedSignal(m_directoryState.pidlDirectory.get());
 }
 
+// Called once the listview has been painted for the first time after a navigation completes. Since
+// redrawing is only enabled again at the end of the navigation, this is the point at which the
+// items actually become visible.
+void ShellBrowser::OnListViewPainted()
+{
+	auto now = std::chrono::steady_clock::now();
+
+	m_navigationTiming.firstPaint =
+		std::chrono::duration_cast<std::chrono::microseconds>(now - m_navigationCompletedTime);
+	m_navigationTiming.total =
+		std::chrono::duration_cast<std::chrono::microseconds>(now - m_navigationStartTime);
+	m_navigationTiming.painted = true;
+}
+
 void ShellBrowser::InsertAwaitingItems(BOOL bInsertIntoGroup)
 {
+	PerformanceTraceActivity traceActivity(L"InsertAwaitingItems");
+
+	auto recordTiming = wil::scope_exit(
+		[this, startTime = std::chrono::steady_clock::now()]
+		{
+			if (!m_navigationTiming.completed)
+			{
+				m_navigationTiming.insert += std::chrono::duration_cast<std::chrono::microseconds>(
+					std::chrono::steady_clock::now() - startTime);
+			}
+		});
+
+	// Items inserted while the filter is being evaluated are tested against the new filter. If
+	// that evaluation is then cancelled, the items shown won't reflect any single filter.
+	if (m_filterEvaluation && !m_directoryState.awaitingAddList.empty())
+	{
+		m_appliedFilterMatcher.reset();
+	}
+
 	int nPrevItems = ListView_GetItemCount(m_hListView);
 
 	if (nPrevItems == 0 && m_directoryState.awaitingAddList.empty())
@@ -605,6 +2561,12 @@ void ShellBrowser::InsertAwaitingItems(BOOL bInsertIntoGroup)
 		ApplyFolderEmptyBackgroundImage(false);
 	}
 
+	if (IsOwnerDataListViewActive())
+	{
+		InsertAwaitingItemsIntoOwnerDataListView();
+		return;
+	}
+
 	/* Make the listview allocate space (for internal data structures)
 	for all the items at once, rather than individually.
 	Acts as a speed optimization. */
@@ -615,12 +2577,27 @@ void ShellBrowser::InsertAwaitingItems(BOOL bInsertIntoGroup)
 		ListViewHelper::SetAutoArrange(m_hListView, FALSE);
 	}
 
+	if (bInsertIntoGroup)
+	{
+		std::vector<int> itemsToGroup;
+
+		for (const auto &awaitingItem : m_directoryState.awaitingAddList)
+		{
+			if (!IsFileFiltered(m_itemInfoMap.Get(awaitingItem.iItemInternal)))
+			{
+				itemsToGroup.push_back(awaitingItem.iItemInternal);
+			}
+		}
+
+		PrefetchGroupInfo(itemsToGroup);
+	}
+
 	int nAdded = 0;
 	std::optional<int> itemToRename;
 
 	for (const auto &awaitingItem : m_directoryState.awaitingAddList)
 	{
-		const auto &itemInfo = m_itemInfoMap.at(awaitingItem.iItemInternal);
+		const auto &itemInfo = m_itemInfoMap.Get(awaitingItem.iItemInternal);
 
 		if (IsFileFiltered(itemInfo))
 		{
@@ -628,11 +2605,11 @@ void ShellBrowser::InsertAwaitingItems(BOOL bInsertIntoGroup)
 			continue;
 		}
 
-		BasicItemInfo_t basicItemInfo = getBasicItemInfo(awaitingItem.iItemInternal);
-		std::wstring filename = ProcessItemFileName(basicItemInfo, m_config->globalFolderSettings);
+		std::wstring filename = ProcessItemFileName(
+			*getBasicItemInfo(awaitingItem.iItemInternal), m_config->globalFolderSettings);
 
 		LVITEM lv;
-		lv.mask = LVIF_TEXT | LVIF_IMAGE | LVIF_PARAM;
+		lv.mask = LVIF_TEXT | LVIF_IMAGE | LVIF_PARAM | LVIF_COLUMNS;
 
 		if (bInsertIntoGroup)
 		{
@@ -662,6 +2639,10 @@ void ShellBrowser::InsertAwaitingItems(BOOL bInsertIntoGroup)
 		lv.iImage = I_IMAGECALLBACK;
 		lv.lParam = awaitingItem.iItemInternal;
 
+		// The tile columns are only requested when the item is displayed in tiles view.
+		lv.cColumns = I_COLUMNSCALLBACK;
+		lv.puColumns = nullptr;
+
 		/* Insert the item into the list view control. */
 		int iItemIndex = ListView_InsertItem(m_hListView, &lv);
 
@@ -683,11 +2664,6 @@ void ShellBrowser::InsertAwaitingItems(BOOL bInsertIntoGroup)
 			ListView_SetItemPosition32(m_hListView, iItemIndex, ptItem.x, ptItem.y);
 		}
 
-		if (m_folderSettings.viewMode == +ViewMode::Tiles)
-		{
-			SetTileViewItemInfo(iItemIndex, awaitingItem.iItemInternal);
-		}
-
 		if (m_queuedRenameItem
 			&& ArePidlsEquivalent(itemInfo.pidlComplete.get(), m_queuedRenameItem.get()))
 		{
@@ -750,7 +2726,7 @@ BOOL ShellBrowser::IsFileFiltered(const ItemInfo_t &itemInfo) const
 	if (m_folderSettings.applyFilter
 		&& ((itemInfo.wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != FILE_ATTRIBUTE_DIRECTORY))
 	{
-		bFilenameFiltered = IsFilenameFiltered(itemInfo.displayName.c_str());
+		bFilenameFiltered = !MatchesFilter(itemInfo);
 	}
 
 	if (m_config->globalFolderSettings.hideSystemFiles)
@@ -765,8 +2741,6 @@ BOOL ShellBrowser::IsFileFiltered(const ItemInfo_t &itemInfo) const
 void ShellBrowser::RemoveItem(int iItemInternal)
 {
 	ULARGE_INTEGER ulFileSize;
-	LVFINDINFO lvfi;
-	int iItem;
 	int nItems;
 
 	if (iItemInternal == -1)
@@ -776,8 +2750,8 @@ void ShellBrowser::RemoveItem(int iItemInternal)
 
 	/* Take the file size of the removed file away from the total
 	directory size. */
-	ulFileSize.LowPart = m_itemInfoMap.at(iItemInternal).wfd.nFileSizeLow;
-	ulFileSize.HighPart = m_itemInfoMap.at(iItemInternal).wfd.nFileSizeHigh;
+	ulFileSize.LowPart = m_itemInfoMap.Get(iItemInternal).wfd.nFileSizeLow;
+	ulFileSize.HighPart = m_itemInfoMap.Get(iItemInternal).wfd.nFileSizeHigh;
 
 	m_directoryState.totalDirSize.QuadPart -= ulFileSize.QuadPart;
 
@@ -785,15 +2759,13 @@ void ShellBrowser::RemoveItem(int iItemInternal)
 	Could use filename, providing removed
 	items are always deleted before new
 	items are inserted. */
-	lvfi.flags = LVFI_PARAM;
-	lvfi.lParam = iItemInternal;
-	iItem = ListView_FindItem(m_hListView, -1, &lvfi);
+	auto iItem = LocateItemByInternalIndex(iItemInternal);
 
-	if (iItem != -1)
+	if (iItem)
 	{
 		if (m_folderSettings.showInGroups)
 		{
-			auto groupId = GetItemGroupId(iItem);
+			auto groupId = GetItemGroupId(*iItem);
 
 			if (groupId)
 			{
@@ -801,11 +2773,33 @@ void ShellBrowser::RemoveItem(int iItemInternal)
 			}
 		}
 
+		// Deleting an item doesn't generate a selection change notification, so the change is
+		// reported explicitly (which also invalidates the attributes retrieved for the selection).
+		bool selected =
+			(ListView_GetItemState(m_hListView, *iItem, LVIS_SELECTED) & LVIS_SELECTED) != 0;
+
 		/* Remove the item from the listview. */
-		ListView_DeleteItem(m_hListView, iItem);
+		if (IsOwnerDataListViewActive())
+		{
+			RemoveOwnerDataItem(*iItem);
+		}
+		else
+		{
+			ListView_DeleteItem(m_hListView, *iItem);
+		}
+
+		if (selected)
+		{
+			NotifySelectionChanged();
+		}
 	}
 
-	m_itemInfoMap.erase(iItemInternal);
+	UntrackSelectedFolderSize(iItemInternal);
+	RemoveItemFromLookupIndexes(iItemInternal);
+	m_cutItems.erase(iItemInternal);
+	m_itemInfoMap.Erase(iItemInternal);
+	InvalidateCachedColumnText(iItemInternal);
+	InvalidateThumbnailForItem(iItemInternal);
 
 	nItems = ListView_GetItemCount(m_hListView);
 
@@ -7,19 +7,28 @@
 #include "Columns.h"
 #include "FolderSettings.h"
 #include "ItemData.h"
-#include "../Helper/DriveInfo.h"
+#include "MediaMetadataCache.h"
+#include "ShellExtensionHostPool.h"
+#include "ShortcutTargetCache.h"
+#include "../Helper/AccountNameCache.h"
+#include "../Helper/FileHashCache.h"
 #include "../Helper/FileOperations.h"
-#include "../Helper/FolderSize.h"
+#include "../Helper/FolderSizeCache.h"
 #include "../Helper/Helper.h"
 #include "../Helper/Macros.h"
 #include "../Helper/StringHelper.h"
-#include <boost/date_time/posix_time/posix_time.hpp>
+#include "../Helper/VolumeInfoCache.h"
 #include <wil/com.h>
 #include <IPHlpApi.h>
 #include <propkey.h>
+#include <propvarutil.h>
 #include <filesystem>
 
 BOOL GetPrinterStatusDescription(DWORD dwStatus, TCHAR *szStatus, size_t cchMax);
+const TCHAR *GetVersionInfoName(VersionInfoType versionInfoType);
+std::wstring FormatHardLinkCount(DWORD numHardLinks);
+HRESULT GetFastItemDetailsRawData(
+	const BasicItemInfo_t &itemInfo, const SHCOLUMNID *pscid, VARIANT *vt);
 
 std::wstring GetColumnText(ColumnType columnType, const BasicItemInfo_t &basicItemInfo,
 	const GlobalFolderSettings &globalFolderSettings)
@@ -174,6 +183,12 @@ std::wstring GetColumnText(ColumnType columnType, const BasicItemInfo_t &basicIt
 	case ColumnType::MediaYear:
 		return GetMediaMetadataColumnText(basicItemInfo, MediaMetadataType::Year);
 
+	case ColumnType::Checksum:
+		return GetChecksumColumnText(basicItemInfo);
+
+	case ColumnType::RelativePath:
+		return basicItemInfo.relativeFolder;
+
 	default:
 		assert(false);
 		break;
@@ -182,6 +197,142 @@ std::wstring GetColumnText(ColumnType columnType, const BasicItemInfo_t &basicIt
 	return EMPTY_STRING;
 }
 
+bool IsFileMetadataColumn(ColumnType columnType)
+{
+	switch (columnType)
+	{
+	case ColumnType::Attributes:
+	case ColumnType::ShortName:
+	case ColumnType::HardLinks:
+	case ColumnType::ProductName:
+	case ColumnType::Company:
+	case ColumnType::Description:
+	case ColumnType::FileVersion:
+	case ColumnType::ProductVersion:
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+std::vector<std::pair<ColumnType, std::wstring>> GetFileMetadataColumnText(
+	const std::vector<ColumnType> &columnTypes, const BasicItemInfo_t &itemInfo)
+{
+	std::wstring fullPath = itemInfo.getFullPath();
+
+	auto needsColumn = [&columnTypes](std::initializer_list<ColumnType> types)
+	{
+		return std::any_of(columnTypes.begin(), columnTypes.end(), [types](ColumnType columnType)
+			{ return std::find(types.begin(), types.end(), columnType) != types.end(); });
+	};
+
+	// The attributes and link count are both retrieved from the same handle.
+	std::optional<BY_HANDLE_FILE_INFORMATION> fileInformation;
+
+	if (needsColumn({ ColumnType::Attributes, ColumnType::HardLinks }))
+	{
+		wil::unique_hfile file(CreateFile(fullPath.c_str(), FILE_READ_ATTRIBUTES, FILE_SHARE_READ,
+			nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr));
+
+		BY_HANDLE_FILE_INFORMATION info;
+
+		if (file && GetFileInformationByHandle(file.get(), &info))
+		{
+			fileInformation = info;
+		}
+	}
+
+	std::vector<BYTE> versionInfo;
+
+	if (itemInfo.canReadContents()
+		&& needsColumn({ ColumnType::ProductName, ColumnType::Company, ColumnType::Description,
+			ColumnType::FileVersion, ColumnType::ProductVersion }))
+	{
+		versionInfo = ReadFileVersionInfo(fullPath.c_str());
+	}
+
+	auto getVersionText = [&versionInfo](VersionInfoType versionInfoType) -> std::wstring
+	{
+		TCHAR versionText[512];
+		BOOL res = GetVersionInfoString(versionInfo, GetVersionInfoName(versionInfoType),
+			versionText, SIZEOF_ARRAY(versionText));
+
+		if (!res)
+		{
+			return EMPTY_STRING;
+		}
+
+		return versionText;
+	};
+
+	std::vector<std::pair<ColumnType, std::wstring>> columnText;
+
+	for (ColumnType columnType : columnTypes)
+	{
+		std::wstring text;
+
+		switch (columnType)
+		{
+		case ColumnType::Attributes:
+			if (fileInformation)
+			{
+				TCHAR attributeString[32];
+				HRESULT hr = BuildFileAttributeString(fileInformation->dwFileAttributes,
+					attributeString, SIZEOF_ARRAY(attributeString));
+
+				if (SUCCEEDED(hr))
+				{
+					text = attributeString;
+				}
+			}
+			else
+			{
+				// Some files (e.g. the pagefile) can't be opened, though their attributes can
+				// still be retrieved via FindFirstFile().
+				text = GetAttributeColumnText(itemInfo);
+			}
+			break;
+
+		case ColumnType::ShortName:
+			text = GetShortNameColumnText(itemInfo);
+			break;
+
+		case ColumnType::HardLinks:
+			text = FormatHardLinkCount(fileInformation ? fileInformation->nNumberOfLinks : 0);
+			break;
+
+		case ColumnType::ProductName:
+			text = getVersionText(VersionInfoType::ProductName);
+			break;
+
+		case ColumnType::Company:
+			text = getVersionText(VersionInfoType::Company);
+			break;
+
+		case ColumnType::Description:
+			text = getVersionText(VersionInfoType::Description);
+			break;
+
+		case ColumnType::FileVersion:
+			text = getVersionText(VersionInfoType::FileVersion);
+			break;
+
+		case ColumnType::ProductVersion:
+			text = getVersionText(VersionInfoType::ProductVersion);
+			break;
+
+		default:
+			assert(false);
+			break;
+		}
+
+		columnText.emplace_back(columnType, text);
+	}
+
+	return columnText;
+}
+
 std::wstring GetNameColumnText(
 	const BasicItemInfo_t &itemInfo, const GlobalFolderSettings &globalFolderSettings)
 {
@@ -290,13 +441,10 @@ std::wstring GetSizeColumnText(
 std::wstring GetFolderSizeColumnText(
 	const BasicItemInfo_t &itemInfo, const GlobalFolderSettings &globalFolderSettings)
 {
-	auto folderInfo = GetFolderInfo(itemInfo.getFullPath());
-
-	/* TODO: This should
-	be done some other way.
-	Shouldn't depend on
-	the internal index. */
-	// m_cachedFolderSizes.insert({internalIndex, totalFolderSize.QuadPart});
+	// The result is cached, which allows it to be reused when sorting by size, as well as the next
+	// time the folder is displayed.
+	auto folderInfo = FolderSizeCache::GetInstance().GetFolderInfo(
+		itemInfo.getFullPath(), {}, nullptr, itemInfo.allowCloudHydration);
 
 	ULARGE_INTEGER size;
 	size.QuadPart = folderInfo.size;
@@ -374,18 +522,23 @@ bool GetRealSizeColumnRawData(const BasicItemInfo_t &itemInfo, ULARGE_INTEGER &R
 		return false;
 	}
 
-	TCHAR root[MAX_PATH];
-	StringCchCopy(root, SIZEOF_ARRAY(root), itemInfo.getFullPath().c_str());
-	PathStripToRoot(root);
+	auto root = VolumeInfoCache::GetRoot(itemInfo.getFullPath());
 
-	DWORD dwClusterSize;
-	BOOL bRet = GetClusterSize(root, &dwClusterSize);
+	if (!root)
+	{
+		return false;
+	}
 
-	if (!bRet)
+	// This is called for every item when sorting by real size, so the volume isn't queried
+	// directly.
+	auto clusterSize = VolumeInfoCache::GetInstance().GetClusterSize(*root);
+
+	if (!clusterSize)
 	{
 		return false;
 	}
 
+	DWORD dwClusterSize = *clusterSize;
 	ULARGE_INTEGER realFileSizeTemp = { itemInfo.wfd.nFileSizeLow, itemInfo.wfd.nFileSizeHigh };
 
 	if (realFileSizeTemp.QuadPart != 0 && (realFileSizeTemp.QuadPart % dwClusterSize) != 0)
@@ -436,17 +589,40 @@ std::wstring GetShortNameColumnText(const BasicItemInfo_t &itemInfo)
 	return path.filename();
 }
 
+// If the owner's account name hasn't been resolved yet, the SID string is returned instead. The
+// name is looked up in the background and the cached text is updated once it's available (see
+// ShellBrowser::OnAccountNamesResolved()).
 std::wstring GetOwnerColumnText(const BasicItemInfo_t &itemInfo)
 {
-	TCHAR owner[512];
-	BOOL ret = GetFileOwner(itemInfo.getFullPath().c_str(), owner, SIZEOF_ARRAY(owner));
+	auto ownerSid = GetFileOwnerSid(itemInfo.getFullPath());
 
-	if (!ret)
+	if (!ownerSid)
 	{
 		return EMPTY_STRING;
 	}
 
-	return owner;
+	return AccountNameCache::GetInstance().GetAccountName(*ownerSid);
+}
+
+// The hash is cached, so it's only calculated again once the file has been modified. It's
+// retrieved from the cache when sorting by this column.
+std::wstring GetChecksumColumnText(const BasicItemInfo_t &itemInfo)
+{
+	if (!itemInfo.isFindDataValid
+		|| WI_IsFlagSet(itemInfo.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY)
+		|| !itemInfo.canReadContents())
+	{
+		return EMPTY_STRING;
+	}
+
+	auto hash = FileHashCache::GetInstance().GetFileHash(itemInfo.getFullPath());
+
+	if (!hash)
+	{
+		return EMPTY_STRING;
+	}
+
+	return FormatFileHash(*hash);
 }
 
 std::wstring GetItemDetailsColumnText(const BasicItemInfo_t &itemInfo, const SHCOLUMNID *pscid,
@@ -481,6 +657,20 @@ HRESULT GetItemDetails(const BasicItemInfo_t &itemInfo, const SHCOLUMNID *pscid,
 
 HRESULT GetItemDetailsRawData(const BasicItemInfo_t &itemInfo, const SHCOLUMNID *pscid, VARIANT *vt)
 {
+	// Property handlers will generally read the file, so only those properties that are available
+	// without the handler (e.g. those held by the indexer) are retrieved for cloud placeholders.
+	if (!itemInfo.canReadContents())
+	{
+		return GetFastItemDetailsRawData(itemInfo, pscid, vt);
+	}
+
+	auto &shellExtensionHostPool = ShellExtensionHostPool::GetInstance();
+
+	if (shellExtensionHostPool.IsEnabled())
+	{
+		return shellExtensionHostPool.GetDetailsEx(itemInfo.pidlComplete.get(), pscid, vt);
+	}
+
 	wil::com_ptr_nothrow<IShellFolder2> pShellFolder;
 	HRESULT hr = SHBindToParent(itemInfo.pidlComplete.get(), IID_PPV_ARGS(&pShellFolder), nullptr);
 
@@ -492,40 +682,77 @@ HRESULT GetItemDetailsRawData(const BasicItemInfo_t &itemInfo, const SHCOLUMNID
 	return hr;
 }
 
-std::wstring GetVersionColumnText(const BasicItemInfo_t &itemInfo, VersionInfoType versioninfoType)
+HRESULT GetFastItemDetailsRawData(
+	const BasicItemInfo_t &itemInfo, const SHCOLUMNID *pscid, VARIANT *vt)
 {
-	std::wstring versionInfoName;
+	wil::com_ptr_nothrow<IShellItem2> shellItem;
+	HRESULT hr = SHCreateItemFromIDList(itemInfo.pidlComplete.get(), IID_PPV_ARGS(&shellItem));
 
-	switch (versioninfoType)
+	if (FAILED(hr))
 	{
-	case VersionInfoType::ProductName:
-		versionInfoName = L"ProductName";
-		break;
+		return hr;
+	}
 
-	case VersionInfoType::Company:
-		versionInfoName = L"CompanyName";
-		break;
+	wil::com_ptr_nothrow<IPropertyStore> propertyStore;
+	hr = shellItem->GetPropertyStore(GPS_FASTPROPERTIESONLY, IID_PPV_ARGS(&propertyStore));
 
-	case VersionInfoType::Description:
-		versionInfoName = L"FileDescription";
-		break;
+	if (FAILED(hr))
+	{
+		return hr;
+	}
 
-	case VersionInfoType::FileVersion:
-		versionInfoName = L"FileVersion";
-		break;
+	wil::unique_prop_variant value;
+	hr = propertyStore->GetValue(*pscid, value.reset_and_addressof());
 
-	case VersionInfoType::ProductVersion:
-		versionInfoName = L"ProductVersion";
-		break;
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	if (value.vt == VT_EMPTY)
+	{
+		return E_FAIL;
+	}
+
+	return PropVariantToVariant(&value, vt);
+}
+
+// Returns the property that the text for the specified column is taken from, for those columns
+// whose text is simply the formatted value of a single property (see GetItemDetailsColumnText()).
+std::optional<PROPERTYKEY> GetColumnPropertyKey(ColumnType columnType)
+{
+	switch (columnType)
+	{
+	case ColumnType::Title:
+		return PKEY_Title;
+	case ColumnType::Subject:
+		return PKEY_Subject;
+	case ColumnType::Authors:
+		return PKEY_Author;
+	case ColumnType::Keywords:
+		return PKEY_Keywords;
+	case ColumnType::Comment:
+		return PKEY_Comment;
+	case ColumnType::OriginalLocation:
+		return SCID_ORIGINAL_LOCATION;
+	case ColumnType::DateDeleted:
+		return SCID_DATE_DELETED;
 
 	default:
-		assert(false);
-		break;
+		return std::nullopt;
+	}
+}
+
+std::wstring GetVersionColumnText(const BasicItemInfo_t &itemInfo, VersionInfoType versioninfoType)
+{
+	if (!itemInfo.canReadContents())
+	{
+		return EMPTY_STRING;
 	}
 
 	TCHAR versionInfo[512];
 	BOOL versionInfoObtained = GetVersionInfoString(itemInfo.getFullPath().c_str(),
-		versionInfoName.c_str(), versionInfo, SIZEOF_ARRAY(versionInfo));
+		GetVersionInfoName(versioninfoType), versionInfo, SIZEOF_ARRAY(versionInfo));
 
 	if (!versionInfoObtained)
 	{
@@ -537,22 +764,53 @@ std::wstring GetVersionColumnText(const BasicItemInfo_t &itemInfo, VersionInfoTy
 
 std::wstring GetShortcutToColumnText(const BasicItemInfo_t &itemInfo)
 {
-	TCHAR resolvedLinkPath[MAX_PATH];
-	HRESULT hr = NFileOperations::ResolveLink(nullptr, SLR_NO_UI, itemInfo.getFullPath().c_str(),
-		resolvedLinkPath, SIZEOF_ARRAY(resolvedLinkPath));
-
-	if (FAILED(hr))
+	if (!itemInfo.canReadContents())
 	{
 		return EMPTY_STRING;
 	}
 
-	return resolvedLinkPath;
+	std::optional<FILETIME> lastWriteTime;
+
+	if (itemInfo.isFindDataValid)
+	{
+		lastWriteTime = itemInfo.wfd.ftLastWriteTime;
+	}
+
+	return ShortcutTargetCache::GetInstance().GetTarget(itemInfo.getFullPath(), lastWriteTime);
+}
+
+const TCHAR *GetVersionInfoName(VersionInfoType versionInfoType)
+{
+	switch (versionInfoType)
+	{
+	case VersionInfoType::ProductName:
+		return L"ProductName";
+
+	case VersionInfoType::Company:
+		return L"CompanyName";
+
+	case VersionInfoType::Description:
+		return L"FileDescription";
+
+	case VersionInfoType::FileVersion:
+		return L"FileVersion";
+
+	case VersionInfoType::ProductVersion:
+		return L"ProductVersion";
+
+	default:
+		assert(false);
+		return L"";
+	}
 }
 
 std::wstring GetHardLinksColumnText(const BasicItemInfo_t &itemInfo)
 {
-	DWORD numHardLinks = GetHardLinksColumnRawData(itemInfo);
+	return FormatHardLinkCount(GetHardLinksColumnRawData(itemInfo));
+}
 
+std::wstring FormatHardLinkCount(DWORD numHardLinks)
+{
 	if (numHardLinks == -1)
 	{
 		return EMPTY_STRING;
@@ -588,6 +846,11 @@ std::wstring GetExtensionColumnText(const BasicItemInfo_t &itemInfo)
 
 std::wstring GetImageColumnText(const BasicItemInfo_t &itemInfo, PROPID PropertyID)
 {
+	if (!itemInfo.canReadContents())
+	{
+		return EMPTY_STRING;
+	}
+
 	TCHAR imageProperty[512];
 	BOOL res = ReadImageProperty(
 		itemInfo.getFullPath().c_str(), PropertyID, imageProperty, SIZEOF_ARRAY(imageProperty));
@@ -612,16 +875,14 @@ std::wstring GetFileSystemColumnText(const BasicItemInfo_t &itemInfo)
 		return EMPTY_STRING;
 	}
 
-	TCHAR fileSystemName[MAX_PATH];
-	BOOL res = GetVolumeInformation(fullFileName.c_str(), nullptr, 0, nullptr, nullptr, nullptr,
-		fileSystemName, SIZEOF_ARRAY(fileSystemName));
+	auto fileSystemName = VolumeInfoCache::GetInstance().GetFileSystemName(fullFileName);
 
-	if (!res)
+	if (!fileSystemName)
 	{
 		return EMPTY_STRING;
 	}
 
-	return fileSystemName;
+	return *fileSystemName;
 }
 
 std::wstring GetControlPanelCommentsColumnText(const BasicItemInfo_t &itemInfo)
@@ -813,177 +1074,21 @@ std::wstring GetNetworkAdapterColumnText(const BasicItemInfo_t &itemInfo)
 std::wstring GetMediaMetadataColumnText(
 	const BasicItemInfo_t &itemInfo, MediaMetadataType mediaMetadataType)
 {
-	const TCHAR *attributeName = GetMediaMetadataAttributeName(mediaMetadataType);
-
-	BYTE *tempBuffer = nullptr;
-	HRESULT hr = GetMediaMetadata(itemInfo.getFullPath().c_str(), attributeName, &tempBuffer);
-
-	if (!SUCCEEDED(hr))
-	{
-		return EMPTY_STRING;
-	}
-
-	TCHAR szOutput[512];
-
-	switch (mediaMetadataType)
+	// The metadata retrieved for a cloud placeholder may be incomplete, so it isn't cached.
+	if (!itemInfo.canReadContents())
 	{
-	case MediaMetadataType::Bitrate:
-	{
-		DWORD bitRate = *(reinterpret_cast<DWORD *>(tempBuffer));
-
-		if (bitRate > 1000)
-		{
-			StringCchPrintf(szOutput, SIZEOF_ARRAY(szOutput), _T("%d kbps"), bitRate / 1000);
-		}
-		else
-		{
-			StringCchPrintf(szOutput, SIZEOF_ARRAY(szOutput), _T("%d bps"), bitRate);
-		}
+		return MediaMetadataCache::GetFastMetadataText(itemInfo.getFullPath(), mediaMetadataType);
 	}
-	break;
 
-	case MediaMetadataType::Duration:
-	{
-		auto *facet = new boost::posix_time::wtime_facet();
-		facet->time_duration_format(L"%H:%M:%S");
+	std::optional<FILETIME> lastWriteTime;
 
-		std::wstringstream dateStream;
-		dateStream.imbue(std::locale(dateStream.getloc(), facet));
-
-		/* Note that the duration itself is in 100-nanosecond units
-		(see http://msdn.microsoft.com/en-us/library/windows/desktop/dd798053(v=vs.85).aspx). */
-		boost::posix_time::time_duration duration =
-			boost::posix_time::microseconds(*(reinterpret_cast<QWORD *>(tempBuffer)) / 10);
-		dateStream << duration;
-
-		StringCchCopy(szOutput, SIZEOF_ARRAY(szOutput), dateStream.str().c_str());
-	}
-	break;
-
-	case MediaMetadataType::Protected:
-		if (*(reinterpret_cast<BOOL *>(tempBuffer)))
-		{
-			StringCchCopy(szOutput, SIZEOF_ARRAY(szOutput), L"Yes");
-		}
-		else
-		{
-			StringCchCopy(szOutput, SIZEOF_ARRAY(szOutput), L"No");
-		}
-		break;
-
-	case MediaMetadataType::Copyright:
-	case MediaMetadataType::Rating:
-	case MediaMetadataType::AlbumArtist:
-	case MediaMetadataType::AlbumTitle:
-	case MediaMetadataType::BeatsPerMinute:
-	case MediaMetadataType::Composer:
-	case MediaMetadataType::Conductor:
-	case MediaMetadataType::Director:
-	case MediaMetadataType::Genre:
-	case MediaMetadataType::Language:
-	case MediaMetadataType::BroadcastDate:
-	case MediaMetadataType::Channel:
-	case MediaMetadataType::StationName:
-	case MediaMetadataType::Mood:
-	case MediaMetadataType::ParentalRating:
-	case MediaMetadataType::ParentalRatingReason:
-	case MediaMetadataType::Period:
-	case MediaMetadataType::Producer:
-	case MediaMetadataType::Publisher:
-	case MediaMetadataType::Writer:
-	case MediaMetadataType::Year:
-	default:
-		StringCchCopy(szOutput, SIZEOF_ARRAY(szOutput), reinterpret_cast<TCHAR *>(tempBuffer));
-		break;
-	}
-
-	free(tempBuffer);
-
-	return szOutput;
-}
-
-const TCHAR *GetMediaMetadataAttributeName(MediaMetadataType mediaMetadataType)
-{
-	switch (mediaMetadataType)
+	if (itemInfo.isFindDataValid)
 	{
-	case MediaMetadataType::Bitrate:
-		return g_wszWMBitrate;
-
-	case MediaMetadataType::Copyright:
-		return g_wszWMCopyright;
-
-	case MediaMetadataType::Duration:
-		return g_wszWMDuration;
-
-	case MediaMetadataType::Protected:
-		return g_wszWMProtected;
-
-	case MediaMetadataType::Rating:
-		return g_wszWMRating;
-
-	case MediaMetadataType::AlbumArtist:
-		return g_wszWMAlbumArtist;
-
-	case MediaMetadataType::AlbumTitle:
-		return g_wszWMAlbumTitle;
-
-	case MediaMetadataType::BeatsPerMinute:
-		return g_wszWMBeatsPerMinute;
-
-	case MediaMetadataType::Composer:
-		return g_wszWMComposer;
-
-	case MediaMetadataType::Conductor:
-		return g_wszWMConductor;
-
-	case MediaMetadataType::Director:
-		return g_wszWMDirector;
-
-	case MediaMetadataType::Genre:
-		return g_wszWMGenre;
-
-	case MediaMetadataType::Language:
-		return g_wszWMLanguage;
-
-	case MediaMetadataType::BroadcastDate:
-		return g_wszWMMediaOriginalBroadcastDateTime;
-
-	case MediaMetadataType::Channel:
-		return g_wszWMMediaOriginalChannel;
-
-	case MediaMetadataType::StationName:
-		return g_wszWMMediaStationName;
-
-	case MediaMetadataType::Mood:
-		return g_wszWMMood;
-
-	case MediaMetadataType::ParentalRating:
-		return g_wszWMParentalRating;
-
-	case MediaMetadataType::ParentalRatingReason:
-		return g_wszWMParentalRatingReason;
-
-	case MediaMetadataType::Period:
-		return g_wszWMPeriod;
-
-	case MediaMetadataType::Producer:
-		return g_wszWMProducer;
-
-	case MediaMetadataType::Publisher:
-		return g_wszWMPublisher;
-
-	case MediaMetadataType::Writer:
-		return g_wszWMWriter;
-
-	case MediaMetadataType::Year:
-		return g_wszWMYear;
-
-	default:
-		assert(false);
-		break;
+		lastWriteTime = itemInfo.wfd.ftLastWriteTime;
 	}
 
-	return nullptr;
+	return MediaMetadataCache::GetInstance().GetMetadataText(
+		itemInfo.getFullPath(), lastWriteTime, mediaMetadataType);
 }
 
 std::wstring GetDriveSpaceColumnText(const BasicItemInfo_t &itemInfo, bool TotalSize,
@@ -1017,18 +1122,21 @@ BOOL GetDriveSpaceColumnRawData(
 		return FALSE;
 	}
 
-	ULARGE_INTEGER totalBytes;
-	ULARGE_INTEGER freeBytes;
-	BOOL res = GetDiskFreeSpaceEx(fullFileName.c_str(), nullptr, &totalBytes, &freeBytes);
+	auto spaceInfo = VolumeInfoCache::GetInstance().GetSpaceInfo(fullFileName);
+
+	if (!spaceInfo)
+	{
+		return FALSE;
+	}
 
 	if (TotalSize)
 	{
-		DriveSpace = totalBytes;
+		DriveSpace = spaceInfo->totalBytes;
 	}
 	else
 	{
-		DriveSpace = freeBytes;
+		DriveSpace = spaceInfo->freeBytes;
 	}
 
-	return res;
+	return TRUE;
 }
\ No newline at end of file
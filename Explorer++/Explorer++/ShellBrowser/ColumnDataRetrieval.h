@@ -5,7 +5,10 @@
 #pragma once
 
 #include "Columns.h"
+#include <optional>
 #include <string>
+#include <utility>
+#include <vector>
 
 struct BasicItemInfo_t;
 struct GlobalFolderSettings;
@@ -65,6 +68,13 @@ enum class MediaMetadataType
 
 std::wstring GetColumnText(ColumnType columnType, const BasicItemInfo_t &basicItemInfo,
 	const GlobalFolderSettings &globalFolderSettings);
+
+// Columns whose text is read from the file itself (its attributes, link count, short name or
+// version resource). When several of these columns are shown, their text is retrieved for each
+// item together, so that the file is only opened (and its version resource only read) once.
+bool IsFileMetadataColumn(ColumnType columnType);
+std::vector<std::pair<ColumnType, std::wstring>> GetFileMetadataColumnText(
+	const std::vector<ColumnType> &columnTypes, const BasicItemInfo_t &itemInfo);
 std::wstring GetNameColumnText(
 	const BasicItemInfo_t &itemInfo, const GlobalFolderSettings &globalFolderSettings);
 std::wstring ProcessItemFileName(
@@ -78,12 +88,14 @@ bool GetRealSizeColumnRawData(const BasicItemInfo_t &itemInfo, ULARGE_INTEGER &R
 std::wstring GetAttributeColumnText(const BasicItemInfo_t &itemInfo);
 std::wstring GetShortNameColumnText(const BasicItemInfo_t &itemInfo);
 std::wstring GetOwnerColumnText(const BasicItemInfo_t &itemInfo);
+std::wstring GetChecksumColumnText(const BasicItemInfo_t &itemInfo);
 std::wstring GetItemDetailsColumnText(const BasicItemInfo_t &itemInfo, const SHCOLUMNID *pscid,
 	const GlobalFolderSettings &globalFolderSettings);
 HRESULT GetItemDetails(const BasicItemInfo_t &itemInfo, const SHCOLUMNID *pscid, TCHAR *szDetail,
 	size_t cchMax, const GlobalFolderSettings &globalFolderSettings);
 HRESULT GetItemDetailsRawData(
 	const BasicItemInfo_t &itemInfo, const SHCOLUMNID *pscid, VARIANT *vt);
+std::optional<PROPERTYKEY> GetColumnPropertyKey(ColumnType columnType);
 std::wstring GetVersionColumnText(const BasicItemInfo_t &itemInfo, VersionInfoType versioninfoType);
 std::wstring GetShortcutToColumnText(const BasicItemInfo_t &itemInfo);
 std::wstring GetHardLinksColumnText(const BasicItemInfo_t &itemInfo);
@@ -97,7 +109,6 @@ std::wstring GetPrinterColumnText(
 std::wstring GetNetworkAdapterColumnText(const BasicItemInfo_t &itemInfo);
 std::wstring GetMediaMetadataColumnText(
 	const BasicItemInfo_t &itemInfo, MediaMetadataType mediaMetadataType);
-const TCHAR *GetMediaMetadataAttributeName(MediaMetadataType mediaMetadataType);
 std::wstring GetDriveSpaceColumnText(const BasicItemInfo_t &itemInfo, bool TotalSize,
 	const GlobalFolderSettings &globalFolderSettings);
 BOOL GetDriveSpaceColumnRawData(
@@ -10,71 +10,380 @@
 #include "ItemData.h"
 #include "MainResource.h"
 #include "ResourceHelper.h"
+#include "SortHelper.h"
 #include "SortModes.h"
 #include "ViewModes.h"
+#include "../Helper/AccountNameCache.h"
+#include "../Helper/DpiCompatibility.h"
 #include "../Helper/Macros.h"
+#include "../Helper/PerformanceTrace.h"
+#include "../Helper/PriorityTaskScheduler.h"
+#include <boost/range/adaptor/map.hpp>
+#include <wil/resource.h>
+#include <algorithm>
 #include <cassert>
+#include <execution>
 #include <list>
+#include <numeric>
+#include <thread>
 
 void ShellBrowser::QueueColumnTask(int itemInternalIndex, ColumnType columnType)
 {
+	auto &pendingTasks = m_pendingColumnTasks[itemInternalIndex];
+
+	if (pendingTasks.count(columnType) > 0)
+	{
+		// The listview can request the same cell several times (e.g. while scrolling) before the
+		// first result has arrived.
+		return;
+	}
+
 	int columnResultID = m_columnResultIDCounter++;
 
-	BasicItemInfo_t basicItemInfo = getBasicItemInfo(itemInternalIndex);
-	GlobalFolderSettings globalFolderSettings = m_config->globalFolderSettings;
+	auto basicItemInfo = getBasicItemInfo(itemInternalIndex);
+	std::vector<ColumnType> columnTypes = GetColumnTaskTypes(itemInternalIndex, columnType);
+
+	// Column text is only requested for cells that are being displayed, so the task will start
+	// with the highest priority. The exception is when network activity is reduced, in which case
+	// the columns that need an extra round trip to the server (to look up the owner, or to read
+	// version information from the file) are left until everything else has been retrieved. Those
+	// tasks have no key, so their priority isn't recalculated as the listview is scrolled.
+	bool deferred = m_reducedNetworkActivity
+		&& (columnType == ColumnType::Owner || columnType == ColumnType::FileVersion
+			|| columnType == ColumnType::ProductVersion);
+
+	GetBackgroundTaskScheduler().PostTask(
+		&m_columnResultIds, deferred ? std::nullopt : std::optional<int>(itemInternalIndex),
+		deferred ? DEFERRED_COLUMN_TASK_PRIORITY : 0,
+		[this, columnResultID, columnTypes, itemInternalIndex, basicItemInfo,
+			settings = GetTaskSettings()]() {
+			m_columnResultChannel.Push(GetColumnTextAsync(
+				columnResultID, columnTypes, itemInternalIndex, *basicItemInfo, *settings));
+		},
+		[this, columnResultID, itemInternalIndex, columnTypes]() {
+			OnColumnTaskCancelled(columnResultID, itemInternalIndex, columnTypes);
+		});
+
+	// The task might finish before this line runs, but that doesn't matter, as the results are
+	// only processed on this thread.
+	m_columnResultIds.insert(columnResultID);
+
+	for (ColumnType taskColumnType : columnTypes)
+	{
+		pendingTasks.insert({ taskColumnType, columnResultID });
+	}
+}
+
+// Returns the set of columns that should be retrieved by the task for the specified cell. That's
+// typically just the column itself. However, if the column is a file metadata column, any other
+// file metadata columns that are shown (and haven't already been retrieved) will be retrieved as
+// part of the same task. The listview requests each cell in a row separately, so without this, a
+// file would be opened once for each of those columns.
+std::vector<ColumnType> ShellBrowser::GetColumnTaskTypes(
+	int itemInternalIndex, ColumnType columnType) const
+{
+	std::vector<ColumnType> columnTypes = { columnType };
 
-	auto result = m_columnThreadPool.push([this, columnResultID, columnType, itemInternalIndex,
-											  basicItemInfo, globalFolderSettings](int id) {
-		UNREFERENCED_PARAMETER(id);
+	if (!IsFileMetadataColumn(columnType) || !m_pActiveColumns)
+	{
+		return columnTypes;
+	}
 
-		return GetColumnTextAsync(m_hListView, columnResultID, columnType, itemInternalIndex,
-			basicItemInfo, globalFolderSettings);
-	});
+	auto pendingItr = m_pendingColumnTasks.find(itemInternalIndex);
 
-	// The function call above might finish before this line runs,
-	// but that doesn't matter, as the results won't be processed
-	// until a message posted to the main thread has been handled
-	// (which can only occur after this function has returned).
-	m_columnResults.insert({ columnResultID, std::move(result) });
+	for (const auto &column : *m_pActiveColumns)
+	{
+		if (!column.bChecked || column.type == columnType || !IsFileMetadataColumn(column.type))
+		{
+			continue;
+		}
+
+		if (GetCachedColumnText(itemInternalIndex, column.type))
+		{
+			continue;
+		}
+
+		if (pendingItr != m_pendingColumnTasks.end() && pendingItr->second.contains(column.type))
+		{
+			continue;
+		}
+
+		columnTypes.push_back(column.type);
+	}
+
+	return columnTypes;
 }
 
-ShellBrowser::ColumnResult_t ShellBrowser::GetColumnTextAsync(HWND listView, int columnResultId,
-	ColumnType columnType, int internalIndex, const BasicItemInfo_t &basicItemInfo,
-	const GlobalFolderSettings &globalFolderSettings)
+const std::wstring *ShellBrowser::GetCachedColumnText(
+	int internalIndex, ColumnType columnType) const
 {
-	std::wstring columnText = GetColumnText(columnType, basicItemInfo, globalFolderSettings);
+	auto itemItr = m_columnTextCache.find(internalIndex);
+
+	if (itemItr == m_columnTextCache.end())
+	{
+		return nullptr;
+	}
+
+	auto columnItr = itemItr->second.find(columnType);
+
+	if (columnItr == itemItr->second.end())
+	{
+		return nullptr;
+	}
+
+	return &columnItr->second;
+}
+
+// Removes any cached text (as well as the sort keys and info tip) for the item, along with any
+// pending tasks (whose results would otherwise be out of date).
+void ShellBrowser::InvalidateCachedColumnText(int internalIndex)
+{
+	m_columnTextCache.erase(internalIndex);
+	m_pendingColumnTasks.erase(internalIndex);
+	m_sortKeyCache.erase(internalIndex);
+	m_infoTipCache.erase(internalIndex);
+	m_pendingInfoTips.erase(internalIndex);
+}
+
+size_t ShellBrowser::GetColumnTextMemoryUsage(
+	const std::unordered_map<ColumnType, std::wstring> &columnText)
+{
+	// Each entry in a hash map requires a node (containing the key and value) and a bucket.
+	constexpr size_t nodeOverhead = 2 * sizeof(void *);
+
+	size_t memoryUsage = sizeof(int) + sizeof(columnText) + nodeOverhead;
+
+	for (const auto &[columnType, text] : columnText)
+	{
+		memoryUsage +=
+			sizeof(columnType) + sizeof(text) + nodeOverhead + text.capacity() * sizeof(wchar_t);
+	}
+
+	return memoryUsage;
+}
+
+size_t ShellBrowser::GetColumnTextCacheMemoryUsage() const
+{
+	size_t memoryUsage = 0;
+
+	for (const auto &columnText : m_columnTextCache | boost::adaptors::map_values)
+	{
+		memoryUsage += GetColumnTextMemoryUsage(columnText);
+	}
+
+	return memoryUsage;
+}
+
+// Any text that's removed here will be retrieved again the next time the listview requests it.
+void ShellBrowser::TrimColumnTextCache(size_t maxBytes)
+{
+	size_t memoryUsage = GetColumnTextCacheMemoryUsage();
+
+	for (auto itr = m_columnTextCache.begin();
+		 itr != m_columnTextCache.end() && memoryUsage > maxBytes;)
+	{
+		memoryUsage -= GetColumnTextMemoryUsage(itr->second);
+		itr = m_columnTextCache.erase(itr);
+	}
+}
+
+void ShellBrowser::ClearColumnResults()
+{
+	GetBackgroundTaskScheduler().CancelTasks(&m_columnResultIds);
+	m_columnResultIds.clear();
+	m_columnResultChannel.Clear();
+	m_pendingColumnTasks.clear();
+}
+
+// Called when a column task has been cancelled because the item was scrolled out of view. The
+// cell will be requested again (and a new task queued) if the item is scrolled back into view.
+void ShellBrowser::OnColumnTaskCancelled(
+	int columnResultId, int internalIndex, const std::vector<ColumnType> &columnTypes)
+{
+	m_columnResultIds.erase(columnResultId);
+
+	auto pendingItr = m_pendingColumnTasks.find(internalIndex);
+
+	if (pendingItr == m_pendingColumnTasks.end())
+	{
+		return;
+	}
+
+	for (ColumnType columnType : columnTypes)
+	{
+		auto pendingTaskItr = pendingItr->second.find(columnType);
+
+		if (pendingTaskItr != pendingItr->second.end() && pendingTaskItr->second == columnResultId)
+		{
+			pendingItr->second.erase(pendingTaskItr);
+		}
+	}
+}
+
+ShellBrowser::ColumnResult_t ShellBrowser::GetColumnTextAsync(int columnResultId,
+	const std::vector<ColumnType> &columnTypes, int internalIndex,
+	const BasicItemInfo_t &basicItemInfo, const TaskSettings &settings)
+{
+	PerformanceTraceActivity traceActivity(L"ColumnTask");
+
+	const GlobalFolderSettings &globalFolderSettings = settings.value;
+
+	std::vector<std::pair<ColumnType, std::wstring>> columnText;
+
+	if (IsFileMetadataColumn(columnTypes[0]))
+	{
+		columnText = GetFileMetadataColumnText(columnTypes, basicItemInfo);
+	}
+	else
+	{
+		assert(columnTypes.size() == 1);
+		columnText.emplace_back(
+			columnTypes[0], GetColumnText(columnTypes[0], basicItemInfo, globalFolderSettings));
+	}
+
+	// The data retrieved for a column is typically the same data the corresponding sort mode
+	// compares, so the sort key is built here as well. That means that sorting by the column
+	// won't need to query the item again on the UI thread.
+	std::vector<std::pair<SortMode, SortKey>> sortKeys;
+
+	for (const auto &[columnType, text] : columnText)
+	{
+		SortMode sortMode = DetermineColumnSortMode(columnType);
+
+		if (!IsSortKeyExpensive(sortMode) || !GetSortKeyComparison(sortMode, globalFolderSettings))
+		{
+			continue;
+		}
 
-	// This message may be delivered before this function has returned.
-	// That doesn't actually matter, since the message handler will
-	// simply wait for the result to be returned.
-	PostMessage(listView, WM_APP_COLUMN_RESULT_READY, columnResultId, 0);
+		sortKeys.emplace_back(sortMode,
+			BuildSortKeyFromColumnText(basicItemInfo, sortMode, text, globalFolderSettings));
+	}
 
 	ColumnResult_t result;
+	result.columnResultId = columnResultId;
 	result.itemInternalIndex = internalIndex;
-	result.columnType = columnType;
-	result.columnText = columnText;
+	result.columnText = std::move(columnText);
+	result.sortKeys = std::move(sortKeys);
+	result.settingsVersion = settings.version;
 
 	return result;
 }
 
-void ShellBrowser::ProcessColumnResult(int columnResultId)
+void ShellBrowser::ProcessColumnResults()
 {
-	auto itr = m_columnResults.find(columnResultId);
+	bool ownerDataResultsProcessed = false;
+
+	bool resultsRemaining = m_columnResultChannel.ProcessResults(RESULT_BATCH_TIME_BUDGET,
+		[this, &ownerDataResultsProcessed](ColumnResult_t &result) {
+			if (ProcessColumnResult(result) && IsOwnerDataListViewActive())
+			{
+				ownerDataResultsProcessed = true;
+			}
+		});
 
-	if (itr == m_columnResults.end())
+	if (ownerDataResultsProcessed)
+	{
+		OnOwnerDataColumnResultsProcessed();
+	}
+
+	if (resultsRemaining)
+	{
+		// A timer message is only generated once there's no other input to process, so this
+		// allows the listview to remain responsive while a large number of results is applied.
+		SetTimer(m_hListView, PROCESS_COLUMN_RESULTS_TIMER_ID, USER_TIMER_MINIMUM, nullptr);
+	}
+}
+
+// Returns true if the result was applied.
+bool ShellBrowser::ProcessColumnResult(ColumnResult_t &result)
+{
+	int columnResultId = result.columnResultId;
+
+	if (!m_columnResultIds.contains(columnResultId))
 	{
 		// This result is for a previous folder. It can be ignored.
-		return;
+		return false;
 	}
 
-	if (m_folderSettings.viewMode != +ViewMode::Details)
+	if (m_folderSettings.viewMode != +ViewMode::Details
+		&& m_folderSettings.viewMode != +ViewMode::Tiles)
 	{
-		return;
+		return false;
 	}
 
-	auto result = itr->second.get();
+	m_columnResultIds.erase(columnResultId);
+	m_numColumnResultsProcessed++;
 
-	auto index = LocateItemByInternalIndex(result.itemInternalIndex);
+	auto pendingItr = m_pendingColumnTasks.find(result.itemInternalIndex);
+
+	if (pendingItr == m_pendingColumnTasks.end())
+	{
+		// The item was invalidated (or removed) after this task was queued.
+		return false;
+	}
+
+	if (!m_taskSettings.IsCurrent(result.settingsVersion))
+	{
+		// The settings changed after this task was queued, so the text is out of date. Removing
+		// the pending entries means that the text will be requested again.
+		for (ColumnType columnType : result.columnText | boost::adaptors::map_keys)
+		{
+			auto pendingTaskItr = pendingItr->second.find(columnType);
+
+			if (pendingTaskItr != pendingItr->second.end()
+				&& pendingTaskItr->second == columnResultId)
+			{
+				pendingItr->second.erase(pendingTaskItr);
+			}
+		}
+
+		return false;
+	}
+
+	for (const auto &[columnType, columnText] : result.columnText)
+	{
+		auto pendingTaskItr = pendingItr->second.find(columnType);
+
+		if (pendingTaskItr == pendingItr->second.end()
+			|| pendingTaskItr->second != columnResultId)
+		{
+			continue;
+		}
+
+		pendingItr->second.erase(pendingTaskItr);
+
+		m_columnTextCache[result.itemInternalIndex][columnType] = columnText;
+
+		if (columnType == ColumnType::Type)
+		{
+			CacheFileTypeName(result.itemInternalIndex, columnText);
+		}
+
+		// Calculating the size of a folder for this column also caches the size, which allows it
+		// to be included in the selection totals.
+		if (columnType == ColumnType::Size && ResolveSelectedFolderSize(result.itemInternalIndex))
+		{
+			NotifySelectionChanged();
+		}
+
+		if (!IsOwnerDataListViewActive())
+		{
+			SetColumnTextInListView(result.itemInternalIndex, columnType, columnText);
+		}
+	}
+
+	for (auto &[sortMode, sortKey] : result.sortKeys)
+	{
+		m_sortKeyCache[result.itemInternalIndex][sortMode._to_integral()] = std::move(sortKey);
+	}
+
+	return true;
+}
+
+void ShellBrowser::SetColumnTextInListView(
+	int internalIndex, ColumnType columnType, const std::wstring &text)
+{
+	auto index = LocateItemByInternalIndex(internalIndex);
 
 	if (!index)
 	{
@@ -82,7 +391,16 @@ void ShellBrowser::ProcessColumnResult(int columnResultId)
 		return;
 	}
 
-	auto columnIndex = GetColumnIndexByType(result.columnType);
+	std::optional<int> columnIndex;
+
+	if (m_folderSettings.viewMode == +ViewMode::Tiles)
+	{
+		columnIndex = GetTileColumnIndexByType(columnType);
+	}
+	else
+	{
+		columnIndex = GetColumnIndexByType(columnType);
+	}
 
 	if (!columnIndex)
 	{
@@ -90,11 +408,225 @@ void ShellBrowser::ProcessColumnResult(int columnResultId)
 		return;
 	}
 
-	auto columnText = std::make_unique<TCHAR[]>(result.columnText.size() + 1);
-	StringCchCopy(columnText.get(), result.columnText.size() + 1, result.columnText.c_str());
+	auto columnText = std::make_unique<TCHAR[]>(text.size() + 1);
+	StringCchCopy(columnText.get(), text.size() + 1, text.c_str());
 	ListView_SetItemText(m_hListView, *index, *columnIndex, columnText.get());
+}
+
+void ShellBrowser::AutoSizeColumn(int columnIndex)
+{
+	PerformanceTraceActivity traceActivity(L"AutoSizeColumn");
+
+	if (GetNumItems() <= AUTOSIZE_ESTIMATE_MIN_ITEMS)
+	{
+		ListView_SetColumnWidth(m_hListView, columnIndex, LVSCW_AUTOSIZE);
+		return;
+	}
+
+	auto width = EstimateColumnWidth(columnIndex);
+
+	if (!width)
+	{
+		return;
+	}
+
+	ListView_SetColumnWidth(m_hListView, columnIndex, *width);
+}
 
-	m_columnResults.erase(itr);
+void ShellBrowser::AutoSizeColumns()
+{
+	int numColumns = Header_GetItemCount(ListView_GetHeader(m_hListView));
+
+	for (int i = 0; i < numColumns; i++)
+	{
+		AutoSizeColumn(i);
+	}
+}
+
+// Estimates the width needed to show the text in the specified column, based on the text that has
+// already been retrieved for each item. Items whose text hasn't been retrieved yet are ignored
+// (the column text for those items hasn't been shown either).
+std::optional<int> ShellBrowser::EstimateColumnWidth(int columnIndex) const
+{
+	auto columnType = GetColumnTypeByIndex(columnIndex);
+
+	if (!columnType)
+	{
+		return std::nullopt;
+	}
+
+	std::vector<const std::wstring *> texts;
+
+	for (int internalIndex : GetAllInternalIndexes())
+	{
+		const std::wstring *text = GetCachedColumnText(internalIndex, *columnType);
+
+		if (text && !text->empty())
+		{
+			texts.push_back(text);
+		}
+	}
+
+	if (texts.empty())
+	{
+		return std::nullopt;
+	}
+
+	if (texts.size() > AUTOSIZE_MEASURED_TEXT_LIMIT)
+	{
+		std::nth_element(std::execution::par, texts.begin(),
+			texts.begin() + AUTOSIZE_MEASURED_TEXT_LIMIT, texts.end(),
+			[](const std::wstring *text1, const std::wstring *text2)
+			{ return text1->size() > text2->size(); });
+		texts.resize(AUTOSIZE_MEASURED_TEXT_LIMIT);
+	}
+
+	auto font = reinterpret_cast<HFONT>(SendMessage(m_hListView, WM_GETFONT, 0, 0));
+
+	// The text is measured in parallel. A device context can't be shared between threads, so each
+	// chunk of text is measured using its own memory device context.
+	size_t numChunks = std::clamp(static_cast<size_t>(std::thread::hardware_concurrency()),
+		size_t{ 1 }, texts.size());
+	size_t chunkSize = (texts.size() + numChunks - 1) / numChunks;
+	std::vector<size_t> chunkStarts(numChunks);
+	std::generate(chunkStarts.begin(), chunkStarts.end(),
+		[chunkSize, start = size_t{ 0 }]() mutable
+		{
+			size_t current = start;
+			start += chunkSize;
+			return current;
+		});
+
+	int maxTextWidth = std::transform_reduce(std::execution::par, chunkStarts.begin(),
+		chunkStarts.end(), 0, [](int width1, int width2) { return (std::max)(width1, width2); },
+		[&texts, chunkSize, font](size_t chunkStart)
+		{
+			wil::unique_hdc hdc(CreateCompatibleDC(nullptr));
+
+			if (!hdc)
+			{
+				return 0;
+			}
+
+			auto selectFont = wil::SelectObject(hdc.get(), font);
+			int maxChunkWidth = 0;
+
+			for (size_t i = chunkStart; i < (std::min)(chunkStart + chunkSize, texts.size()); i++)
+			{
+				SIZE size;
+				BOOL res = GetTextExtentPoint32(hdc.get(), texts[i]->c_str(),
+					static_cast<int>(texts[i]->size()), &size);
+
+				if (res)
+				{
+					maxChunkWidth = (std::max)(maxChunkWidth, static_cast<int>(size.cx));
+				}
+			}
+
+			return maxChunkWidth;
+		});
+
+	UINT dpi = DpiCompatibility::GetInstance().GetDpiForWindow(m_hListView);
+	int width = maxTextWidth + MulDiv(AUTOSIZE_TEXT_PADDING, dpi, USER_DEFAULT_SCREEN_DPI);
+
+	// The first column also contains the item's icon.
+	if (columnIndex == 0)
+	{
+		int iconWidth;
+		int iconHeight;
+		HIMAGELIST smallImageList = ListView_GetImageList(m_hListView, LVSIL_SMALL);
+
+		if (smallImageList && ImageList_GetIconSize(smallImageList, &iconWidth, &iconHeight))
+		{
+			width += iconWidth + MulDiv(AUTOSIZE_ICON_PADDING, dpi, USER_DEFAULT_SCREEN_DPI);
+		}
+	}
+
+	return width;
+}
+
+// The owner column initially shows the owner's SID for any account whose name hasn't been resolved
+// yet. Once names have been resolved, each of those SIDs is replaced with the corresponding name,
+// without the items having to be queried again.
+void ShellBrowser::OnAccountNamesResolved()
+{
+	auto &accountNameCache = AccountNameCache::GetInstance();
+	bool textUpdated = false;
+
+	for (auto &[internalIndex, columnText] : m_columnTextCache)
+	{
+		auto itr = columnText.find(ColumnType::Owner);
+
+		if (itr == columnText.end())
+		{
+			continue;
+		}
+
+		auto accountName = accountNameCache.GetResolvedAccountName(itr->second);
+
+		if (!accountName)
+		{
+			continue;
+		}
+
+		itr->second = *accountName;
+		textUpdated = true;
+
+		if (!IsOwnerDataListViewActive())
+		{
+			SetColumnTextInListView(internalIndex, ColumnType::Owner, itr->second);
+		}
+	}
+
+	if (textUpdated && IsOwnerDataListViewActive())
+	{
+		InvalidateRect(m_hListView, nullptr, FALSE);
+	}
+
+	bool sortKeysUpdated = false;
+
+	for (auto &sortKeys : m_sortKeyCache | boost::adaptors::map_values)
+	{
+		auto itr = sortKeys.find((+SortMode::Owner)._to_integral());
+
+		if (itr == sortKeys.end())
+		{
+			continue;
+		}
+
+		auto accountName = accountNameCache.GetResolvedAccountName(itr->second.text);
+
+		if (accountName)
+		{
+			itr->second.text = *accountName;
+			sortKeysUpdated = true;
+		}
+	}
+
+	if (m_folderSettings.sortMode != +SortMode::Owner)
+	{
+		return;
+	}
+
+	bool groupsUpdated = false;
+
+	auto &cachedGroups = m_groupInfoCache[m_folderSettings.sortMode._to_integral()];
+
+	for (auto &groupInfo : cachedGroups | boost::adaptors::map_values)
+	{
+		auto accountName = accountNameCache.GetResolvedAccountName(groupInfo.name);
+
+		if (accountName)
+		{
+			groupInfo.name = *accountName;
+			groupsUpdated = true;
+		}
+	}
+
+	if (textUpdated || sortKeysUpdated || groupsUpdated)
+	{
+		SortFolder(m_folderSettings.sortMode);
+	}
 }
 
 std::optional<int> ShellBrowser::GetColumnIndexByType(ColumnType columnType) const
@@ -139,11 +671,25 @@ std::optional<ColumnType> ShellBrowser::GetColumnTypeByIndex(int index) const
 	return static_cast<ColumnType>(hdItem.lParam);
 }
 
+// Brings the columns in the listview into line with the active column set. Different types of
+// folder (e.g. a regular folder and the recycle bin) typically share many of their columns, so
+// rather than removing every column and inserting the new set, the two sets are compared and only
+// the columns that differ are inserted or removed. Columns that remain are left in place (with
+// their width only being updated if it's changed), so moving between folders of different types
+// doesn't result in the entire header being rebuilt.
 void ShellBrowser::SetUpListViewColumns()
 {
-	m_nActiveColumns = 0;
+	int numHeaderColumns = Header_GetItemCount(ListView_GetHeader(m_hListView));
 
-	int currentIndex = 0;
+	std::vector<std::optional<ColumnType>> currentColumns;
+	currentColumns.reserve(numHeaderColumns);
+
+	for (int i = 0; i < numHeaderColumns; i++)
+	{
+		currentColumns.push_back(GetColumnTypeByIndex(i));
+	}
+
+	m_nActiveColumns = 0;
 
 	for (const Column_t &column : *m_pActiveColumns)
 	{
@@ -152,19 +698,41 @@ void ShellBrowser::SetUpListViewColumns()
 			continue;
 		}
 
-		InsertColumn(column.type, currentIndex, column.iWidth);
+		int index = m_nActiveColumns;
+		auto itr = std::find(currentColumns.begin() + index, currentColumns.end(), column.type);
 
-		/* Do NOT set column widths here. For some reason, this causes list mode to
-		break. (If this code is active, and the listview starts of in details mode
-		and is then switched to list mode, no items will be shown; they appear to
-		be placed off the left edge of the listview). */
-		// ListView_SetColumnWidth(m_hListView,iColumnIndex,LVSCW_AUTOSIZE_USEHEADER);
+		if (itr == currentColumns.begin() + index)
+		{
+			/* Do NOT set column widths to LVSCW_AUTOSIZE_USEHEADER here. For some reason, this
+			causes list mode to break. (If this code is active, and the listview starts of in
+			details mode and is then switched to list mode, no items will be shown; they appear
+			to be placed off the left edge of the listview). */
+			if (ListView_GetColumnWidth(m_hListView, index) != column.iWidth)
+			{
+				ListView_SetColumnWidth(m_hListView, index, column.iWidth);
+			}
+		}
+		else
+		{
+			// Columns can't be moved directly, so a column that appears later on is removed and
+			// inserted again in the correct position. Note that, since the column is found after
+			// the current index, column 0 is never removed here.
+			if (itr != currentColumns.end())
+			{
+				ListView_DeleteColumn(
+					m_hListView, static_cast<int>(std::distance(currentColumns.begin(), itr)));
+				currentColumns.erase(itr);
+			}
+
+			InsertColumn(column.type, index, column.iWidth);
+			currentColumns.insert(currentColumns.begin() + index, column.type);
+		}
 
-		currentIndex++;
 		m_nActiveColumns++;
 	}
 
-	for (int i = m_nCurrentColumns + m_nActiveColumns; i >= m_nActiveColumns; i--)
+	// Anything that remains past the active columns is only used by the previous column set.
+	for (int i = static_cast<int>(currentColumns.size()) - 1; i >= m_nActiveColumns; i--)
 	{
 		ListView_DeleteColumn(m_hListView, i);
 	}
@@ -202,36 +770,7 @@ void ShellBrowser::InsertColumn(ColumnType columnType, int columnIndex, int widt
 
 void ShellBrowser::SetActiveColumnSet()
 {
-	std::vector<Column_t> *pActiveColumns = nullptr;
-
-	if (CompareVirtualFolders(CSIDL_CONTROLS))
-	{
-		pActiveColumns = &m_folderColumns.controlPanelColumns;
-	}
-	else if (CompareVirtualFolders(CSIDL_DRIVES))
-	{
-		pActiveColumns = &m_folderColumns.myComputerColumns;
-	}
-	else if (CompareVirtualFolders(CSIDL_BITBUCKET))
-	{
-		pActiveColumns = &m_folderColumns.recycleBinColumns;
-	}
-	else if (CompareVirtualFolders(CSIDL_PRINTERS))
-	{
-		pActiveColumns = &m_folderColumns.printersColumns;
-	}
-	else if (CompareVirtualFolders(CSIDL_CONNECTIONS))
-	{
-		pActiveColumns = &m_folderColumns.networkConnectionsColumns;
-	}
-	else if (CompareVirtualFolders(CSIDL_NETWORK))
-	{
-		pActiveColumns = &m_folderColumns.myNetworkPlacesColumns;
-	}
-	else
-	{
-		pActiveColumns = &m_folderColumns.realFolderColumns;
-	}
+	std::vector<Column_t> *pActiveColumns = &GetCurrentFolderColumns();
 
 	/* If the current set of columns are different
 	from the previous set of columns (i.e. the
@@ -245,6 +784,31 @@ void ShellBrowser::SetActiveColumnSet()
 	}
 }
 
+// Items with the same name in different folders can't otherwise be told apart in flat view, so
+// the relative path column is shown while the view is active. A column the user has chosen to show
+// is left alone.
+void ShellBrowser::ShowRelativePathColumnForFlatView(bool show)
+{
+	if (show == m_relativePathColumnShownForFlatView)
+	{
+		return;
+	}
+
+	auto columns = GetCurrentColumns();
+	auto itr = std::find_if(columns.begin(), columns.end(),
+		[](const Column_t &column) { return column.type == ColumnType::RelativePath; });
+
+	if (itr == columns.end() || (show && itr->bChecked))
+	{
+		return;
+	}
+
+	itr->bChecked = show;
+	SetCurrentColumns(columns);
+
+	m_relativePathColumnShownForFlatView = show;
+}
+
 SortMode ShellBrowser::DetermineColumnSortMode(ColumnType columnType)
 {
 	switch (columnType)
@@ -435,6 +999,12 @@ SortMode ShellBrowser::DetermineColumnSortMode(ColumnType columnType)
 	case ColumnType::MediaYear:
 		return SortMode::MediaYear;
 
+	case ColumnType::Checksum:
+		return SortMode::Checksum;
+
+	case ColumnType::RelativePath:
+		return SortMode::RelativePath;
+
 	default:
 		assert(false);
 		break;
@@ -636,6 +1206,12 @@ int ShellBrowser::LookupColumnNameStringIndex(ColumnType columnType)
 	case ColumnType::MediaYear:
 		return IDS_COLUMN_NAME_YEAR;
 
+	case ColumnType::Checksum:
+		return IDS_COLUMN_NAME_CHECKSUM;
+
+	case ColumnType::RelativePath:
+		return IDS_COLUMN_NAME_RELATIVEPATH;
+
 	default:
 		assert(false);
 		break;
@@ -756,6 +1332,12 @@ int ShellBrowser::LookupColumnDescriptionStringIndex(ColumnType columnType)
 	case ColumnType::MediaBitrate:
 		return IDS_COLUMN_DESCRIPTION_BITRATE;
 
+	case ColumnType::Checksum:
+		return IDS_COLUMN_DESCRIPTION_CHECKSUM;
+
+	case ColumnType::RelativePath:
+		return IDS_COLUMN_DESCRIPTION_RELATIVEPATH;
+
 	default:
 		assert(false);
 		break;
@@ -896,38 +1478,9 @@ FolderColumns ShellBrowser::ExportAllColumns()
 
 void ShellBrowser::SaveColumnWidths()
 {
-	std::vector<Column_t> *pActiveColumns = nullptr;
+	std::vector<Column_t> *pActiveColumns = &GetCurrentFolderColumns();
 	int iColumn = 0;
 
-	if (CompareVirtualFolders(CSIDL_CONTROLS))
-	{
-		pActiveColumns = &m_folderColumns.controlPanelColumns;
-	}
-	else if (CompareVirtualFolders(CSIDL_DRIVES))
-	{
-		pActiveColumns = &m_folderColumns.myComputerColumns;
-	}
-	else if (CompareVirtualFolders(CSIDL_BITBUCKET))
-	{
-		pActiveColumns = &m_folderColumns.recycleBinColumns;
-	}
-	else if (CompareVirtualFolders(CSIDL_PRINTERS))
-	{
-		pActiveColumns = &m_folderColumns.printersColumns;
-	}
-	else if (CompareVirtualFolders(CSIDL_CONNECTIONS))
-	{
-		pActiveColumns = &m_folderColumns.networkConnectionsColumns;
-	}
-	else if (CompareVirtualFolders(CSIDL_NETWORK))
-	{
-		pActiveColumns = &m_folderColumns.myNetworkPlacesColumns;
-	}
-	else
-	{
-		pActiveColumns = &m_folderColumns.realFolderColumns;
-	}
-
 	/* Only save column widths if the listview is currently in
 	details view. If it's not currently in details view, then
 	column widths have already been saved when the view changed. */
@@ -959,6 +1512,7 @@ void ShellBrowser::SetCurrentColumns(const std::vector<Column_t> &columns)
 {
 	bool sortFolder = false;
 	int columnIndex = 0;
+	std::vector<ColumnType> shownColumns;
 
 	for (auto &column : columns)
 	{
@@ -990,6 +1544,7 @@ void ShellBrowser::SetCurrentColumns(const std::vector<Column_t> &columns)
 		if (column.bChecked && !existingColumn->bChecked)
 		{
 			InsertColumn(column.type, columnIndex, column.iWidth);
+			shownColumns.push_back(column.type);
 		}
 		else if (!column.bChecked && existingColumn->bChecked)
 		{
@@ -1010,6 +1565,13 @@ void ShellBrowser::SetCurrentColumns(const std::vector<Column_t> &columns)
 		SortFolder(m_folderSettings.sortMode);
 	}
 
+	// Clicking the header of a newly shown column will sort by it, so the column's sort keys are
+	// built ahead of time, rather than the sort having to wait on them.
+	for (ColumnType columnType : shownColumns)
+	{
+		PrefetchSortKeys(DetermineColumnSortMode(columnType));
+	}
+
 	m_listViewColumnsSetUp = false;
 
 	columnsChanged.m_signal();
@@ -89,7 +89,12 @@ enum class ColumnType
 	MediaYear = 63,
 
 	/* Printer columns. */
-	PrinterModel = 64
+	PrinterModel = 64,
+
+	Checksum = 65,
+
+	/* Flat view column. */
+	RelativePath = 66
 };
 
 struct Column_t
@@ -97,6 +102,8 @@ struct Column_t
 	ColumnType type;
 	BOOL bChecked;
 	int iWidth;
+
+	bool operator==(const Column_t &) const = default;
 };
 
 struct ColumnOld_t
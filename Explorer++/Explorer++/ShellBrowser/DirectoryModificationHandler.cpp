@@ -8,10 +8,16 @@
 #include "ItemData.h"
 #include "ShellNavigationController.h"
 #include "ViewModes.h"
+#include "../Helper/FolderSizeCache.h"
+#include "../Helper/ItemAttributeCache.h"
 #include "../Helper/ListViewHelper.h"
+#include "../Helper/ParsedPathCache.h"
 #include "../Helper/Logging.h"
 #include "../Helper/Macros.h"
+#include "../Helper/PerformanceTrace.h"
 #include "../Helper/ShellHelper.h"
+#include <algorithm>
+#include <filesystem>
 #include <list>
 
 int g_iRenamedItem = -1;
@@ -20,7 +26,7 @@ void ShellBrowser::StartDirectoryMonitoring(PCIDLIST_ABSOLUTE pidl)
 {
 	SHChangeNotifyEntry shcne;
 	shcne.pidl = pidl;
-	shcne.fRecursive = FALSE;
+	shcne.fRecursive = m_flatView;
 	m_shChangeNotifyId = SHChangeNotifyRegister(m_hListView,
 		SHCNRF_ShellLevel | SHCNRF_InterruptLevel | SHCNRF_NewDelivery,
 		SHCNE_ATTRIBUTES | SHCNE_CREATE | SHCNE_DELETE | SHCNE_MKDIR | SHCNE_RENAMEFOLDER
@@ -34,7 +40,8 @@ void ShellBrowser::StartDirectoryMonitoring(PCIDLIST_ABSOLUTE pidl)
 
 		if (SUCCEEDED(hr))
 		{
-			LOG(warning) << L"Couldn't monitor directory \"" << path << L"\" for changes.";
+			LOG_RATE_LIMITED(warning, std::chrono::seconds(10))
+				<< L"Couldn't monitor directory \"" << path << L"\" for changes.";
 		}
 	}
 }
@@ -59,91 +66,262 @@ void ShellBrowser::OnShellNotify(WPARAM wParam, LPARAM lParam)
 
 	SHChangeNotification_Unlock(lock);
 
-	SetTimer(m_hListView, PROCESS_SHELL_CHANGES_TIMER_ID, PROCESS_SHELL_CHANGES_TIMEOUT, nullptr);
+	// The timer is only started by the first notification in a batch. If it were restarted for
+	// every notification, nothing would be processed while the folder was being continuously
+	// modified.
+	if (m_directoryState.shellChangeNotifications.size() == 1)
+	{
+		SetTimer(
+			m_hListView, PROCESS_SHELL_CHANGES_TIMER_ID, m_shellChangeProcessingDelay, nullptr);
+	}
 }
 
 void ShellBrowser::OnProcessShellChangeNotifications()
 {
-	SendMessage(m_hListView, WM_SETREDRAW, FALSE, NULL);
+	PerformanceTraceActivity traceActivity(L"ProcessShellChangeNotifications");
+
+	KillTimer(m_hListView, PROCESS_SHELL_CHANGES_TIMER_ID);
+
+	auto notifications = std::move(m_directoryState.shellChangeNotifications);
+	m_directoryState.shellChangeNotifications.clear();
+
+	UpdateShellChangeProcessingDelay(notifications.size());
+
+	// A refresh will re-enumerate the entire folder, so there's no need to process any of the
+	// individual changes in that case. In flat view, a folder that's created, renamed or removed
+	// can contain any number of files that would need to be added, updated or removed, so the
+	// view is refreshed in that case as well.
+	bool refreshRequired =
+		std::any_of(notifications.begin(), notifications.end(), [this](const auto &change) {
+			if (m_flatView
+				&& (change.event == SHCNE_MKDIR || change.event == SHCNE_RENAMEFOLDER
+					|| change.event == SHCNE_RMDIR))
+			{
+				return true;
+			}
+
+			return change.event == SHCNE_UPDATEDIR
+				&& ArePidlsEquivalent(m_directoryState.pidlDirectory.get(), change.pidl1.get());
+		});
 
-	for (const auto &change : m_directoryState.shellChangeNotifications)
+	if (refreshRequired)
 	{
-		ProcessShellChangeNotification(change);
+		RefreshFolderContents();
+		return;
 	}
 
-	SendMessage(m_hListView, WM_SETREDRAW, TRUE, NULL);
+	ShellChangeCoalescer<PCIDLIST_ABSOLUTE> coalescer;
 
-	m_directoryState.shellChangeNotifications.clear();
+	for (const auto &change : notifications)
+	{
+		AddShellChangeToCoalescer(change, coalescer);
+	}
 
-	KillTimer(m_hListView, PROCESS_SHELL_CHANGES_TIMER_ID);
+	SendMessage(m_hListView, WM_SETREDRAW, FALSE, NULL);
+
+	ApplyShellChanges(coalescer.TakeChanges());
+
+	SendMessage(m_hListView, WM_SETREDRAW, TRUE, NULL);
 
 	directoryModified.m_signal();
 }
 
-void ShellBrowser::ProcessShellChangeNotification(const ShellChangeNotification &change)
+void ShellBrowser::UpdateShellChangeProcessingDelay(size_t numNotifications)
+{
+	if (numNotifications >= SHELL_CHANGES_HEAVY_CHURN_THRESHOLD)
+	{
+		m_shellChangeProcessingDelay =
+			(std::min)(m_shellChangeProcessingDelay * 2, PROCESS_SHELL_CHANGES_MAX_TIMEOUT);
+	}
+	else
+	{
+		m_shellChangeProcessingDelay =
+			(std::max)(m_shellChangeProcessingDelay / 2, PROCESS_SHELL_CHANGES_TIMEOUT);
+	}
+}
+
+void ShellBrowser::AddShellChangeToCoalescer(
+	const ShellChangeNotification &change, ShellChangeCoalescer<PCIDLIST_ABSOLUTE> &coalescer)
 {
+	// Only the current directory is monitored, so notifications should only arrive for items in
+	// that directory. However, if the user has just changed directories, a notification could
+	// still come in for the previous directory. Therefore, it's important to verify that the item
+	// is actually a child of the current directory. In flat view, the whole subtree is monitored,
+	// so the item can be anywhere below the directory.
+	if (!ILIsParent(m_directoryState.pidlDirectory.get(), change.pidl1.get(), !m_flatView))
+	{
+		return;
+	}
+
+	// Changes are merged based on the parsing name of each item, since the PIDLs provided for the
+	// same item can differ between notifications (e.g. simple vs full PIDLs).
+	std::wstring parsingName;
+	HRESULT hr = GetDisplayName(change.pidl1.get(), SHGDN_FORPARSING, parsingName);
+
+	if (FAILED(hr))
+	{
+		return;
+	}
+
 	switch (change.event)
 	{
 	case SHCNE_MKDIR:
 	case SHCNE_CREATE:
-		if (ILIsParent(m_directoryState.pidlDirectory.get(), change.pidl1.get(), TRUE))
-		{
-			AddItem(change.pidl1.get());
-		}
+		coalescer.AddItem(parsingName, change.pidl1.get());
 		break;
 
 	case SHCNE_RENAMEFOLDER:
 	case SHCNE_RENAMEITEM:
-		if (ILIsParent(m_directoryState.pidlDirectory.get(), change.pidl1.get(), TRUE)
-			&& ILIsParent(m_directoryState.pidlDirectory.get(), change.pidl2.get(), TRUE))
+	{
+		if (!ILIsParent(m_directoryState.pidlDirectory.get(), change.pidl2.get(), !m_flatView))
 		{
-			// The pidls provided to these change notifications are always simple pidls. When an
-			// item is updated, the WIN32_FIND_DATA information cached in the pidl will be
-			// retrieved. As the simple pidl won't contain this information, it's important to
-			// convert the pidl to a full pidl here.
-			// Note that there's no need to convert change.pidl1, as it refers to the original item,
-			// which no longer exists.
-			unique_pidl_absolute pidlNewFull;
-			HRESULT hr = SimplePidlToFullPidl(change.pidl2.get(), wil::out_param(pidlNewFull));
-
-			if (SUCCEEDED(hr))
-			{
-				OnItemRenamed(change.pidl1.get(), pidlNewFull.get());
-			}
+			break;
 		}
-		break;
+
+		std::wstring newParsingName;
+		hr = GetDisplayName(change.pidl2.get(), SHGDN_FORPARSING, newParsingName);
+
+		if (SUCCEEDED(hr))
+		{
+			coalescer.RenameItem(
+				parsingName, change.pidl1.get(), newParsingName, change.pidl2.get());
+		}
+	}
+	break;
 
 	case SHCNE_UPDATEITEM:
-		if (ILIsParent(m_directoryState.pidlDirectory.get(), change.pidl1.get(), TRUE))
+		coalescer.ModifyItem(parsingName, change.pidl1.get());
+		break;
+
+	case SHCNE_RMDIR:
+	case SHCNE_DELETE:
+		coalescer.RemoveItem(parsingName, change.pidl1.get());
+		break;
+	}
+}
+
+void ShellBrowser::ApplyShellChanges(
+	const std::vector<ShellChangeCoalescer<PCIDLIST_ABSOLUTE>::Change> &changes)
+{
+	using ChangeType = ShellChangeCoalescer<PCIDLIST_ABSOLUTE>::ChangeType;
+
+	// Every existing item is located before any changes are made. Otherwise, a set of renames
+	// (e.g. two items swapping names) could result in a later lookup finding an item that was
+	// renamed earlier in the batch.
+	std::vector<std::optional<int>> internalIndexes;
+	internalIndexes.reserve(changes.size());
+
+	for (const auto &change : changes)
+	{
+		if (change.type == ChangeType::Added)
+		{
+			internalIndexes.push_back(std::nullopt);
+		}
+		else
 		{
-			unique_pidl_absolute pidlFull;
-			HRESULT hr = SimplePidlToFullPidl(change.pidl1.get(), wil::out_param(pidlFull));
+			internalIndexes.push_back(GetItemInternalIndexForPidl(*change.originalData));
+		}
+	}
 
-			if (SUCCEEDED(hr))
+	bool itemsAddedOrRemoved = std::any_of(changes.begin(), changes.end(),
+		[](const auto &change) { return change.type != ChangeType::Modified; });
+
+	if (itemsAddedOrRemoved)
+	{
+		InvalidateCachedFolderSize();
+		InvalidateCachedFolderAttributes();
+		InvalidateCachedParsedPaths();
+	}
+
+	// Dropped items are inserted at the drop position, rather than in sorted order, so they need
+	// to go through the standard (single item) path.
+	bool insertItemsIndividually = !m_droppedFileNameList.empty();
+	bool sortRequired = false;
+	bool itemsAwaitingInsertion = false;
+
+	m_processingShellChangeBatch = true;
+
+	for (size_t i = 0; i < changes.size(); i++)
+	{
+		const auto &change = changes[i];
+		const auto &internalIndex = internalIndexes[i];
+
+		// The pidls provided to these change notifications are always simple pidls. When an item
+		// is updated, the WIN32_FIND_DATA information cached in the pidl will be retrieved. As the
+		// simple pidl won't contain this information, it's important to convert the pidl to a full
+		// pidl here.
+		unique_pidl_absolute pidlFull;
+
+		if (change.data)
+		{
+			HRESULT hr = SimplePidlToFullPidl(*change.data, wil::out_param(pidlFull));
+
+			if (FAILED(hr))
 			{
-				ModifyItem(pidlFull.get());
+				continue;
 			}
 		}
-		break;
 
-	case SHCNE_UPDATEDIR:
-		if (ArePidlsEquivalent(m_directoryState.pidlDirectory.get(), change.pidl1.get()))
+		switch (change.type)
 		{
-			m_navigationController->Refresh();
+		case ChangeType::Removed:
+			if (internalIndex)
+			{
+				RemoveItem(*internalIndex);
+			}
+			break;
+
+		case ChangeType::Modified:
+			if (internalIndex)
+			{
+				ModifyItem(*internalIndex, pidlFull.get());
+				sortRequired = true;
+			}
+			break;
+
+		case ChangeType::Renamed:
+			if (internalIndex)
+			{
+				RenameItem(*internalIndex, pidlFull.get());
+				sortRequired = true;
+				break;
+			}
+
+			// This can happen if an item was added, then immediately renamed. In that case,
+			// attempting to add the new item would fail (since it no longer exists). Since the new
+			// name has now been received, the item can be added.
+			[[fallthrough]];
+
+		case ChangeType::Added:
+			if (insertItemsIndividually)
+			{
+				AddItem(pidlFull.get());
+			}
+			else if (AddItemToAwaitingList(pidlFull.get()))
+			{
+				itemsAwaitingInsertion = true;
+			}
+			break;
 		}
-		break;
+	}
 
-	case SHCNE_RMDIR:
-	case SHCNE_DELETE:
-		// Only the current directory is monitored, so notifications should only arrive for items in
-		// that directory. However, if the user has just changed directories, a notification could
-		// still come in for the previous directory. Therefore, it's important to verify that the
-		// item is actually a child of the current directory.
-		if (ILIsParent(m_directoryState.pidlDirectory.get(), change.pidl1.get(), TRUE))
+	m_processingShellChangeBatch = false;
+
+	if (itemsAwaitingInsertion)
+	{
+		// The new items are sorted amongst themselves and merged into the existing (already
+		// sorted) items, rather than re-sorting the entire folder.
+		if (m_config->globalFolderSettings.insertSorted)
 		{
-			OnItemRemoved(change.pidl1.get());
+			PositionAwaitingItemsSorted();
 		}
-		break;
+
+		InsertAwaitingItems(m_folderSettings.showInGroups);
+	}
+
+	if (sortRequired)
+	{
+		SortItems();
 	}
 }
 
@@ -151,11 +329,55 @@ void ShellBrowser::DirectoryAltered()
 {
 	EnterCriticalSection(&m_csDirectoryAltered);
 
+	if (m_rescanFolderId && *m_rescanFolderId == m_uniqueFolderId)
+	{
+		LOG(debug) << _T("ShellBrowser - Too many changes for \"") << m_directoryState.directory
+				   << _T("\", refreshing");
+
+		// Any individual changes are superseded by the refresh.
+		m_AlteredList.clear();
+		m_rescanFolderId.reset();
+
+		LeaveCriticalSection(&m_csDirectoryAltered);
+
+		RefreshFolderContents();
+		return;
+	}
+
+	m_rescanFolderId.reset();
+
+	bool flatViewFolderChanged =
+		std::any_of(m_AlteredList.begin(), m_AlteredList.end(), [this](const auto &af) {
+			return af.iFolderIndex == m_uniqueFolderId && IsFlatViewFolderChange(af);
+		});
+
+	if (flatViewFolderChanged)
+	{
+		m_AlteredList.clear();
+
+		LeaveCriticalSection(&m_csDirectoryAltered);
+
+		m_navigationController->Refresh();
+		return;
+	}
+
 	SendMessage(m_hListView, WM_SETREDRAW, FALSE, NULL);
 
 	LOG(debug) << _T("ShellBrowser - Starting directory change update for \"")
 			   << m_directoryState.directory << _T("\"");
 
+	bool itemsAddedOrRemoved =
+		std::any_of(m_AlteredList.begin(), m_AlteredList.end(), [this](const auto &af) {
+			return af.iFolderIndex == m_uniqueFolderId && af.dwAction != FILE_ACTION_MODIFIED;
+		});
+
+	if (itemsAddedOrRemoved)
+	{
+		InvalidateCachedFolderSize();
+		InvalidateCachedFolderAttributes();
+		InvalidateCachedParsedPaths();
+	}
+
 	/* Potential problem:
 	After a file is created, it may be renamed shortly afterwards.
 	If the rename occurs before the file is added here, the
@@ -173,6 +395,8 @@ void ShellBrowser::DirectoryAltered()
 	other actions for the file will take place before the addition,
 	which will again result in an incorrect state.
 	*/
+	std::unordered_set<ULONGLONG> movedFileIds = GetMovedFileIds();
+
 	for (const auto &af : m_AlteredList)
 	{
 		/* Only undertake the modification if the unique folder
@@ -184,16 +408,31 @@ void ShellBrowser::DirectoryAltered()
 			switch (af.dwAction)
 			{
 			case FILE_ACTION_ADDED:
+				if (af.details && movedFileIds.contains(af.details->fileId))
+				{
+					LOG(debug) << _T("ShellBrowser - Moving item to \"") << af.szFileName
+							   << _T("\"");
+					OnFileMoved(af.szFileName, af.details->fileId);
+					break;
+				}
+
 				LOG(debug) << _T("ShellBrowser - Adding \"") << af.szFileName << _T("\"");
 				OnFileAdded(af.szFileName);
 				break;
 
 			case FILE_ACTION_MODIFIED:
 				LOG(debug) << _T("ShellBrowser - Modifying \"") << af.szFileName << _T("\"");
-				OnFileModified(af.szFileName);
+				OnFileModified(af.szFileName, af.details);
 				break;
 
 			case FILE_ACTION_REMOVED:
+				// The item will be moved to its new location when the corresponding addition is
+				// processed.
+				if (af.details && movedFileIds.contains(af.details->fileId))
+				{
+					break;
+				}
+
 				LOG(debug) << _T("ShellBrowser - Removing \"") << af.szFileName << _T("\"");
 				OnFileRemoved(af.szFileName);
 				break;
@@ -207,7 +446,7 @@ void ShellBrowser::DirectoryAltered()
 			case FILE_ACTION_RENAMED_NEW_NAME:
 				LOG(debug) << _T("ShellBrowser - New name received \"") << af.szFileName
 						   << _T("\"");
-				OnFileRenamedNewName(af.szFileName);
+				OnFileRenamedNewName(af.szFileName, af.details);
 				break;
 			}
 		}
@@ -233,34 +472,11 @@ void ShellBrowser::DirectoryAltered()
 
 	m_AlteredList.clear();
 
-	BOOL bFocusSet = FALSE;
-	int iIndex;
-
-	/* Select the specified items, and place the
-	focus on the first item. */
-	auto itr = m_FileSelectionList.begin();
-	while (itr != m_FileSelectionList.end())
+	// Pasted files are matched as they're added (in AddItemInternal()), so the listview only
+	// needs to be scanned if one of the new items is waiting to be selected.
+	if (m_pendingFileSelectionMatched)
 	{
-		iIndex = LocateFileItemIndex(itr->c_str());
-
-		if (iIndex != -1)
-		{
-			ListViewHelper::SelectItem(m_hListView, iIndex, TRUE);
-
-			if (!bFocusSet)
-			{
-				ListViewHelper::FocusItem(m_hListView, iIndex, TRUE);
-				ListView_EnsureVisible(m_hListView, iIndex, TRUE);
-
-				bFocusSet = TRUE;
-			}
-
-			itr = m_FileSelectionList.erase(itr);
-		}
-		else
-		{
-			++itr;
-		}
+		SelectPendingFileItems();
 	}
 
 	LeaveCriticalSection(&m_csDirectoryAltered);
@@ -276,19 +492,60 @@ void CALLBACK TimerProc(HWND hwnd, UINT uMsg, UINT_PTR idEvent, DWORD dwTime)
 	SendMessage(hwnd, WM_USER_FILESADDED, idEvent, 0);
 }
 
-void ShellBrowser::FilesModified(DWORD Action, const TCHAR *FileName, int EventId, int iFolderIndex)
+// In flat view, a folder that's added (or renamed) can contain any number of files that need to be
+// listed, so the folder is re-enumerated instead.
+bool ShellBrowser::IsFlatViewFolderChange(const AlteredFile_t &alteredFile) const
+{
+	if (!m_flatView
+		|| (alteredFile.dwAction != FILE_ACTION_ADDED
+			&& alteredFile.dwAction != FILE_ACTION_RENAMED_NEW_NAME))
+	{
+		return false;
+	}
+
+	DWORD attributes;
+
+	if (alteredFile.details)
+	{
+		attributes = alteredFile.details->attributes;
+	}
+	else
+	{
+		auto fullPath = std::filesystem::path(m_directoryState.directory) / alteredFile.szFileName;
+		attributes = GetFileAttributes(fullPath.c_str());
+
+		if (attributes == INVALID_FILE_ATTRIBUTES)
+		{
+			return false;
+		}
+	}
+
+	return WI_IsFlagSet(attributes, FILE_ATTRIBUTE_DIRECTORY);
+}
+
+void ShellBrowser::FilesModified(
+	const std::vector<DirectoryChange> &changes, bool overflowed, int EventId, int iFolderIndex)
 {
 	EnterCriticalSection(&m_csDirectoryAltered);
 
 	SetTimer(m_hOwner, EventId, 200, TimerProc);
 
-	AlteredFile_t af;
+	if (overflowed)
+	{
+		m_rescanFolderId = iFolderIndex;
+	}
+
+	for (const auto &change : changes)
+	{
+		AlteredFile_t af;
 
-	StringCchCopy(af.szFileName, SIZEOF_ARRAY(af.szFileName), FileName);
-	af.dwAction = Action;
-	af.iFolderIndex = iFolderIndex;
+		StringCchCopy(af.szFileName, SIZEOF_ARRAY(af.szFileName), change.fileName.c_str());
+		af.dwAction = change.action;
+		af.iFolderIndex = iFolderIndex;
+		af.details = change.details;
 
-	m_AlteredList.push_back(af);
+		m_AlteredList.push_back(af);
+	}
 
 	LeaveCriticalSection(&m_csDirectoryAltered);
 }
@@ -310,33 +567,15 @@ void ShellBrowser::OnFileAdded(const TCHAR *szFileName)
 
 void ShellBrowser::AddItem(PCIDLIST_ABSOLUTE pidl)
 {
-	wil::com_ptr_nothrow<IShellFolder> shellFolder;
-	PCITEMID_CHILD pidlChild = nullptr;
-	HRESULT hr = SHBindToParent(pidl, IID_PPV_ARGS(&shellFolder), &pidlChild);
-
-	if (FAILED(hr))
-	{
-		return;
-	}
-
-	auto itemId = AddItemInternal(
-		shellFolder.get(), m_directoryState.pidlDirectory.get(), pidlChild, -1, FALSE);
+	auto itemId = AddItemToAwaitingList(pidl);
 
 	if (!itemId)
 	{
 		return;
 	}
 
-	const std::wstring displayName = m_itemInfoMap.at(*itemId).displayName;
-	auto droppedFilesItr = std::find_if(m_droppedFileNameList.begin(), m_droppedFileNameList.end(),
-		[&displayName](const DroppedFile_t &droppedFile) {
-			return displayName == droppedFile.szFileName;
-		});
-
-	bool wasDropped = (droppedFilesItr != m_droppedFileNameList.end());
-
 	// Only insert the item in its sorted position if it wasn't dropped in.
-	if (m_config->globalFolderSettings.insertSorted && !wasDropped)
+	if (m_config->globalFolderSettings.insertSorted && !WasItemDropped(*itemId))
 	{
 		// TODO: It would be better to pass the items details to this function directly
 		// instead (before the item is added to the awaiting list).
@@ -359,6 +598,100 @@ void ShellBrowser::AddItem(PCIDLIST_ABSOLUTE pidl)
 	InsertAwaitingItems(m_folderSettings.showInGroups);
 }
 
+// Adds the item to the list of items awaiting insertion, without inserting it into the listview.
+std::optional<int> ShellBrowser::AddItemToAwaitingList(PCIDLIST_ABSOLUTE pidl)
+{
+	auto itemInfo = GetItemInformationForPidl(pidl);
+
+	if (!itemInfo)
+	{
+		return std::nullopt;
+	}
+
+	// Only files are listed in flat view.
+	if (m_flatView && WI_IsFlagSet(itemInfo->wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+	{
+		return std::nullopt;
+	}
+
+	return AddItemInternal(-1, std::move(*itemInfo), FALSE);
+}
+
+// Retrieves the details of an item from its full pidl. Outside of flat view, the item is always a
+// child of the current directory. In flat view, it can be nested anywhere below the directory.
+std::optional<ShellBrowser::ItemInfo_t> ShellBrowser::GetItemInformationForPidl(
+	PCIDLIST_ABSOLUTE pidl)
+{
+	wil::com_ptr_nothrow<IShellFolder> shellFolder;
+	PCITEMID_CHILD pidlChild = nullptr;
+	HRESULT hr = SHBindToParent(pidl, IID_PPV_ARGS(&shellFolder), &pidlChild);
+
+	if (FAILED(hr))
+	{
+		return std::nullopt;
+	}
+
+	if (!m_flatView)
+	{
+		return GetItemInformation(
+			shellFolder.get(), m_directoryState.pidlDirectory.get(), pidlChild);
+	}
+
+	unique_pidl_absolute pidlParent(ILCloneFull(pidl));
+	ILRemoveLastID(pidlParent.get());
+
+	auto itemInfo = GetItemInformation(shellFolder.get(), pidlParent.get(), pidlChild);
+
+	if (!itemInfo)
+	{
+		return std::nullopt;
+	}
+
+	auto relativePath = GetFlatViewRelativePath(itemInfo->parsingName);
+
+	if (!relativePath)
+	{
+		return std::nullopt;
+	}
+
+	itemInfo->relativeFolder = std::filesystem::path(*relativePath).parent_path().wstring();
+
+	return itemInfo;
+}
+
+// Returns the path of an item relative to the current directory, provided the item is somewhere
+// below that directory.
+std::optional<std::wstring> ShellBrowser::GetFlatViewRelativePath(const std::wstring &path) const
+{
+	std::wstring prefix = m_directoryState.directory;
+
+	if (!prefix.empty() && prefix.back() != '\\')
+	{
+		prefix += '\\';
+	}
+
+	if (path.size() <= prefix.size()
+		|| CompareStringOrdinal(path.c_str(), static_cast<int>(prefix.size()), prefix.c_str(),
+			   static_cast<int>(prefix.size()), TRUE)
+			!= CSTR_EQUAL)
+	{
+		return std::nullopt;
+	}
+
+	return path.substr(prefix.size());
+}
+
+bool ShellBrowser::WasItemDropped(int internalIndex) const
+{
+	const std::wstring &displayName = m_itemInfoMap.Get(internalIndex).displayName;
+	auto droppedFilesItr = std::find_if(m_droppedFileNameList.begin(), m_droppedFileNameList.end(),
+		[&displayName](const DroppedFile_t &droppedFile) {
+			return displayName == droppedFile.szFileName;
+		});
+
+	return droppedFilesItr != m_droppedFileNameList.end();
+}
+
 void ShellBrowser::OnItemRemoved(PCIDLIST_ABSOLUTE pidl)
 {
 	auto internalIndex = GetItemInternalIndexForPidl(pidl);
@@ -377,10 +710,56 @@ void ShellBrowser::OnFileRemoved(const TCHAR *szFileName)
 	{
 		RemoveItem(iItemInternal);
 	}
+	else if (m_flatView)
+	{
+		// Folders aren't listed in flat view, so this may be a folder, in which case the files
+		// within it need to be removed.
+		RemoveFlatViewItemsWithin(szFileName);
+	}
 }
 
-void ShellBrowser::OnFileModified(const TCHAR *fileName)
+// Removes every file below the specified folder (given relative to the current directory).
+void ShellBrowser::RemoveFlatViewItemsWithin(const std::wstring &relativeFolder)
 {
+	std::vector<int> internalIndexes;
+
+	for (const auto &[internalIndex, itemInfo] : m_itemInfoMap)
+	{
+		const auto &folder = itemInfo.relativeFolder;
+
+		if (folder.size() >= relativeFolder.size()
+			&& CompareStringOrdinal(folder.c_str(), static_cast<int>(relativeFolder.size()),
+				   relativeFolder.c_str(), static_cast<int>(relativeFolder.size()), TRUE)
+				== CSTR_EQUAL
+			&& (folder.size() == relativeFolder.size() || folder[relativeFolder.size()] == '\\'))
+		{
+			internalIndexes.push_back(internalIndex);
+		}
+	}
+
+	for (int internalIndex : internalIndexes)
+	{
+		RemoveItem(internalIndex);
+	}
+}
+
+void ShellBrowser::OnFileModified(
+	const TCHAR *fileName, const std::optional<DirectoryChangeDetails> &details)
+{
+	// If the notification contains the updated state of the item, the item can be updated
+	// directly, without having to retrieve its details again. That's a significant saving when
+	// a large number of files are being written to.
+	if (details)
+	{
+		int internalIndex = LocateFileItemInternalIndex(fileName);
+
+		if (internalIndex != -1 && m_itemInfoMap.Get(internalIndex).isFindDataValid)
+		{
+			ModifyItem(internalIndex, *details);
+			return;
+		}
+	}
+
 	TCHAR fullFileName[MAX_PATH];
 	StringCchCopy(fullFileName, SIZEOF_ARRAY(fullFileName), m_directoryState.directory.c_str());
 	PathAppend(fullFileName, fileName);
@@ -405,33 +784,91 @@ void ShellBrowser::ModifyItem(PCIDLIST_ABSOLUTE pidl)
 		return;
 	}
 
-	wil::com_ptr_nothrow<IShellFolder> shellFolder;
-	PCITEMID_CHILD pidlChild = nullptr;
-	HRESULT hr = SHBindToParent(pidl, IID_PPV_ARGS(&shellFolder), &pidlChild);
+	ModifyItem(*internalIndex, pidl);
+}
 
-	if (FAILED(hr))
+void ShellBrowser::ModifyItem(int internalIndex, PCIDLIST_ABSOLUTE pidl)
+{
+	auto itemInfo = GetItemInformationForPidl(pidl);
+
+	if (!itemInfo)
 	{
 		return;
 	}
 
-	auto itemInfo =
-		GetItemInformation(shellFolder.get(), m_directoryState.pidlDirectory.get(), pidlChild);
+	ModifyItem(internalIndex, std::move(*itemInfo));
+}
 
-	if (!itemInfo)
+void ShellBrowser::ModifyItem(int internalIndex, ItemInfo_t itemInfo)
+{
+	// A change to an item doesn't change its identity, so an ID that was retrieved previously
+	// still applies.
+	if (itemInfo.fileId == DirectoryReader::UNKNOWN_FILE_ID)
 	{
-		return;
+		itemInfo.fileId = m_itemInfoMap.Get(internalIndex).fileId;
 	}
 
-	ULARGE_INTEGER oldFileSize = { m_itemInfoMap[*internalIndex].wfd.nFileSizeLow,
-		m_itemInfoMap[*internalIndex].wfd.nFileSizeHigh };
-	ULARGE_INTEGER newFileSize = { itemInfo->wfd.nFileSizeLow, itemInfo->wfd.nFileSizeHigh };
+	ULARGE_INTEGER oldFileSize = { m_itemInfoMap.Get(internalIndex).wfd.nFileSizeLow,
+		m_itemInfoMap.Get(internalIndex).wfd.nFileSizeHigh };
 
-	m_directoryState.totalDirSize.QuadPart += newFileSize.QuadPart - oldFileSize.QuadPart;
+	if (m_itemInfoMap.Get(internalIndex).isFindDataValid)
+	{
+		UpdateCachedFolderSize(m_itemInfoMap.Get(internalIndex).wfd, itemInfo);
+	}
+
+	RemoveItemFromLookupIndexes(internalIndex);
+	m_itemInfoMap.Get(internalIndex) = std::move(itemInfo);
+	AddItemToLookupIndexes(internalIndex);
+
+	OnItemModified(internalIndex, oldFileSize);
+}
+
+// Applies the details provided by an extended change notification to the item. Only the find
+// data can change here, so the item doesn't need to be re-indexed.
+void ShellBrowser::ModifyItem(int internalIndex, const DirectoryChangeDetails &details)
+{
+	ItemInfo_t &itemInfo = m_itemInfoMap.Get(internalIndex);
+
+	ULARGE_INTEGER oldFileSize = { itemInfo.wfd.nFileSizeLow, itemInfo.wfd.nFileSizeHigh };
+	WIN32_FIND_DATA previousFindData = itemInfo.wfd;
 
-	m_itemInfoMap[*internalIndex] = std::move(*itemInfo);
-	const ItemInfo_t &updatedItemInfo = m_itemInfoMap[*internalIndex];
+	itemInfo.wfd.dwFileAttributes = details.attributes;
+	itemInfo.wfd.ftCreationTime = details.creationTime;
+	itemInfo.wfd.ftLastWriteTime = details.lastWriteTime;
+	itemInfo.wfd.ftLastAccessTime = details.lastAccessTime;
+	itemInfo.wfd.nFileSizeLow = details.fileSize.LowPart;
+	itemInfo.wfd.nFileSizeHigh = details.fileSize.HighPart;
+	itemInfo.basicItemInfo.reset();
 
-	auto itemIndex = LocateItemByInternalIndex(*internalIndex);
+	UpdateCachedFolderSize(previousFindData, itemInfo);
+
+	// The item's size, dates and attributes can all affect which group it's in.
+	InvalidateCachedGroupInfo(internalIndex);
+
+	// Color rules can match on attributes.
+	itemInfo.cachedColorRule.reset();
+
+	// Filter expressions can match on the item's size and dates.
+	m_filterItemTable.reset();
+
+	if (m_filterEvaluation)
+	{
+		m_filterEvaluation->changedItems.insert(internalIndex);
+	}
+
+	OnItemModified(internalIndex, oldFileSize);
+}
+
+// Updates the listview once the stored information for an item has changed.
+void ShellBrowser::OnItemModified(int internalIndex, ULARGE_INTEGER oldFileSize)
+{
+	const ItemInfo_t &updatedItemInfo = m_itemInfoMap.Get(internalIndex);
+	ULARGE_INTEGER newFileSize = { updatedItemInfo.wfd.nFileSizeLow,
+		updatedItemInfo.wfd.nFileSizeHigh };
+
+	m_directoryState.totalDirSize.QuadPart += newFileSize.QuadPart - oldFileSize.QuadPart;
+
+	auto itemIndex = LocateItemByInternalIndex(internalIndex);
 
 	if (!itemIndex)
 	{
@@ -442,12 +879,22 @@ void ShellBrowser::ModifyItem(PCIDLIST_ABSOLUTE pidl)
 
 	if (WI_IsFlagSet(state, LVIS_SELECTED))
 	{
-		m_directoryState.fileSelectionSize.QuadPart += newFileSize.QuadPart - oldFileSize.QuadPart;
+		if (WI_IsFlagSet(updatedItemInfo.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+		{
+			// The cached size of the folder may no longer be valid.
+			UntrackSelectedFolderSize(internalIndex);
+			TrackSelectedFolderSize(internalIndex);
+		}
+		else
+		{
+			m_directoryState.selectionInfo.filesSize +=
+				newFileSize.QuadPart - oldFileSize.QuadPart;
+		}
 	}
 
 	if (IsFileFiltered(updatedItemInfo))
 	{
-		RemoveFilteredItem(*itemIndex, *internalIndex);
+		RemoveFilteredItem(*itemIndex, internalIndex);
 		return;
 	}
 
@@ -467,15 +914,75 @@ void ShellBrowser::ModifyItem(PCIDLIST_ABSOLUTE pidl)
 		ListView_SetItemState(m_hListView, *itemIndex, 0, LVIS_CUT);
 	}
 
-	ListView_SortItems(m_hListView, SortStub, this);
+	if (!m_processingShellChangeBatch)
+	{
+		SortItems();
+	}
 
 	if (m_folderSettings.showInGroups)
 	{
-		int groupId = DetermineItemGroup(*internalIndex);
+		int groupId = DetermineItemGroup(internalIndex);
 		InsertItemIntoGroup(*itemIndex, groupId);
 	}
 }
 
+// Creating, deleting or renaming an item changes the last write time of the current folder, so
+// any cached size for the folder won't be used again. The parent folders include this folder in
+// their sizes, so their cached sizes need to be discarded as well.
+void ShellBrowser::InvalidateCachedFolderSize()
+{
+	if (InVirtualFolder())
+	{
+		return;
+	}
+
+	FolderSizeCache::GetInstance().InvalidateFolder(m_directoryState.directory);
+}
+
+// The folder will have been recorded as containing (or not containing) subfolders when it was
+// enumerated. Once items are added or removed, that may no longer be true.
+void ShellBrowser::InvalidateCachedFolderAttributes()
+{
+	GetItemAttributeCache().InvalidateItem(m_directoryState.directory);
+}
+
+// A path within the folder may now refer to a different item (e.g. a folder that's been replaced
+// by a file of the same name), so any pidls parsed from those paths are discarded.
+void ShellBrowser::InvalidateCachedParsedPaths()
+{
+	if (InVirtualFolder())
+	{
+		return;
+	}
+
+	ParsedPathCache::GetInstance().InvalidateFolderContents(m_directoryState.directory);
+}
+
+// Modifying a file doesn't change the last write time of the folder that contains it. Rather than
+// discarding the cached size of that folder, the change in size is applied directly.
+void ShellBrowser::UpdateCachedFolderSize(
+	const WIN32_FIND_DATA &previousFindData, const ItemInfo_t &updatedItemInfo)
+{
+	if (InVirtualFolder() || !updatedItemInfo.isFindDataValid)
+	{
+		return;
+	}
+
+	if (WI_IsFlagSet(updatedItemInfo.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+	{
+		// A subfolder is reported as modified when its own contents change.
+		FolderSizeCache::GetInstance().InvalidateFolder(updatedItemInfo.parsingName);
+		return;
+	}
+
+	ULARGE_INTEGER previousSize = { previousFindData.nFileSizeLow, previousFindData.nFileSizeHigh };
+	ULARGE_INTEGER updatedSize = { updatedItemInfo.wfd.nFileSizeLow,
+		updatedItemInfo.wfd.nFileSizeHigh };
+
+	FolderSizeCache::GetInstance().OnFileSizeChanged(
+		m_directoryState.directory, previousSize.QuadPart, updatedSize.QuadPart);
+}
+
 void ShellBrowser::OnItemRenamed(PCIDLIST_ABSOLUTE pidlOld, PCIDLIST_ABSOLUTE pidlNew)
 {
 	auto internalIndex = GetItemInternalIndexForPidl(pidlOld);
@@ -493,6 +1000,49 @@ void ShellBrowser::OnItemRenamed(PCIDLIST_ABSOLUTE pidlOld, PCIDLIST_ABSOLUTE pi
 	}
 }
 
+// A file that's moved between folders within the watched tree (in flat view) is reported as a
+// removal followed by an addition. When the file system reports file IDs, the two can be paired
+// up, so that the existing item is renamed, rather than being removed and then added again.
+std::unordered_set<ULONGLONG> ShellBrowser::GetMovedFileIds() const
+{
+	std::unordered_set<ULONGLONG> removedFileIds;
+	std::unordered_set<ULONGLONG> movedFileIds;
+
+	for (const auto &af : m_AlteredList)
+	{
+		if (af.iFolderIndex != m_uniqueFolderId || !af.details
+			|| af.details->fileId == DirectoryReader::UNKNOWN_FILE_ID)
+		{
+			continue;
+		}
+
+		if (af.dwAction == FILE_ACTION_REMOVED)
+		{
+			removedFileIds.insert(af.details->fileId);
+		}
+		else if (af.dwAction == FILE_ACTION_ADDED && removedFileIds.contains(af.details->fileId)
+			&& GetItemInternalIndexForFileId(af.details->fileId))
+		{
+			movedFileIds.insert(af.details->fileId);
+		}
+	}
+
+	return movedFileIds;
+}
+
+void ShellBrowser::OnFileMoved(const TCHAR *szFileName, ULONGLONG fileId)
+{
+	auto internalIndex = GetItemInternalIndexForFileId(fileId);
+
+	if (!internalIndex)
+	{
+		OnFileAdded(szFileName);
+		return;
+	}
+
+	RenameItem(*internalIndex, szFileName);
+}
+
 void ShellBrowser::OnFileRenamedOldName(const TCHAR *szFileName)
 {
 	g_iRenamedItem = -1;
@@ -525,11 +1075,21 @@ void ShellBrowser::OnFileRenamedOldName(const TCHAR *szFileName)
 	}
 }
 
-void ShellBrowser::OnFileRenamedNewName(const TCHAR *szFileName)
+void ShellBrowser::OnFileRenamedNewName(
+	const TCHAR *szFileName, const std::optional<DirectoryChangeDetails> &details)
 {
-	if (g_iRenamedItem != -1)
+	int internalIndex = g_iRenamedItem;
+
+	// The old name can be missing (e.g. if it was delivered in an earlier batch that overflowed),
+	// in which case the item can still be found by its ID.
+	if (internalIndex == -1 && details)
+	{
+		internalIndex = GetItemInternalIndexForFileId(details->fileId).value_or(-1);
+	}
+
+	if (internalIndex != -1)
 	{
-		RenameItem(g_iRenamedItem, szFileName);
+		RenameItem(internalIndex, szFileName);
 	}
 	else
 	{
@@ -561,25 +1121,27 @@ void ShellBrowser::RenameItem(int internalIndex, const TCHAR *szNewFileName)
 
 void ShellBrowser::RenameItem(int internalIndex, PCIDLIST_ABSOLUTE pidlNew)
 {
-	wil::com_ptr_nothrow<IShellFolder> shellFolder;
-	PCITEMID_CHILD pidlChild = nullptr;
-	HRESULT hr = SHBindToParent(pidlNew, IID_PPV_ARGS(&shellFolder), &pidlChild);
+	auto itemInfo = GetItemInformationForPidl(pidlNew);
 
-	if (FAILED(hr))
+	if (!itemInfo)
 	{
 		return;
 	}
 
-	auto itemInfo =
-		GetItemInformation(shellFolder.get(), m_directoryState.pidlDirectory.get(), pidlChild);
+	RenameItem(internalIndex, std::move(*itemInfo));
+}
 
-	if (!itemInfo)
+void ShellBrowser::RenameItem(int internalIndex, ItemInfo_t itemInfo)
+{
+	if (itemInfo.fileId == DirectoryReader::UNKNOWN_FILE_ID)
 	{
-		return;
+		itemInfo.fileId = m_itemInfoMap.Get(internalIndex).fileId;
 	}
 
-	m_itemInfoMap[internalIndex] = std::move(*itemInfo);
-	const ItemInfo_t &updatedItemInfo = m_itemInfoMap[internalIndex];
+	RemoveItemFromLookupIndexes(internalIndex);
+	m_itemInfoMap.Get(internalIndex) = std::move(itemInfo);
+	AddItemToLookupIndexes(internalIndex);
+	const ItemInfo_t &updatedItemInfo = m_itemInfoMap.Get(internalIndex);
 
 	auto itemIndex = LocateItemByInternalIndex(internalIndex);
 
@@ -612,12 +1174,15 @@ void ShellBrowser::RenameItem(int internalIndex, PCIDLIST_ABSOLUTE pidlNew)
 	}
 	else
 	{
-		BasicItemInfo_t basicItemInfo = getBasicItemInfo(internalIndex);
-		std::wstring filename = ProcessItemFileName(basicItemInfo, m_config->globalFolderSettings);
+		std::wstring filename = ProcessItemFileName(
+			*getBasicItemInfo(internalIndex), m_config->globalFolderSettings);
 		ListView_SetItemText(m_hListView, *itemIndex, 0, filename.data());
 	}
 
-	ListView_SortItems(m_hListView, SortStub, this);
+	if (!m_processingShellChangeBatch)
+	{
+		SortItems();
+	}
 
 	if (m_folderSettings.showInGroups)
 	{
@@ -628,11 +1193,25 @@ void ShellBrowser::RenameItem(int internalIndex, PCIDLIST_ABSOLUTE pidlNew)
 
 void ShellBrowser::InvalidateAllColumnsForItem(int itemIndex)
 {
+	InvalidateCachedColumnText(GetItemInternalIndex(itemIndex));
+
+	if (m_folderSettings.viewMode == +ViewMode::Tiles)
+	{
+		InvalidateTileViewItemText(itemIndex);
+		return;
+	}
+
 	if (m_folderSettings.viewMode != +ViewMode::Details)
 	{
 		return;
 	}
 
+	if (IsOwnerDataListViewActive())
+	{
+		InvalidateOwnerDataItem(GetItemInternalIndex(itemIndex), true, false);
+		return;
+	}
+
 	auto numColumns = std::count_if(
 		m_pActiveColumns->begin(), m_pActiveColumns->end(), [](const Column_t &column) {
 			return column.bChecked;
@@ -646,6 +1225,14 @@ void ShellBrowser::InvalidateAllColumnsForItem(int itemIndex)
 
 void ShellBrowser::InvalidateIconForItem(int itemIndex)
 {
+	InvalidateThumbnailForItem(GetItemInternalIndex(itemIndex));
+
+	if (IsOwnerDataListViewActive())
+	{
+		InvalidateOwnerDataItem(GetItemInternalIndex(itemIndex), false, true);
+		return;
+	}
+
 	LVITEM lvItem;
 	lvItem.mask = LVIF_IMAGE;
 	lvItem.iItem = itemIndex;
@@ -4,9 +4,13 @@
 
 #include "stdafx.h"
 #include "ShellBrowser.h"
+#include "Config.h"
+#include "CoreInterface.h"
 #include "FolderView.h"
 #include "ServiceProvider.h"
 #include "ViewModes.h"
+#include "../Helper/FileOperationQueue.h"
+#include "../Helper/FileOperations.h"
 #include "../Helper/ListViewHelper.h"
 #include "../Helper/ShellHelper.h"
 #include <winrt/base.h>
@@ -95,6 +99,81 @@ bool ShellBrowser::IsTargetSourceOfDrop(int targetItem, IDataObject *dataObject)
 	return false;
 }
 
+// When a large selection is dragged from another tab (or the treeview), the items can be taken
+// straight from the data object and added to the file operation queue. Going through the shell
+// drop target instead would mean waiting for the data object to build its formats, which the drop
+// target would then have to parse again.
+bool ShellBrowser::PerformInternalDrop(int targetItem, IDataObject *dataObject, DWORD keyState,
+	DWORD allowedEffects, DWORD &targetEffect)
+{
+	if (!m_config->useNativeFileTransfers)
+	{
+		return false;
+	}
+
+	auto *fileOperationQueue = m_coreInterface->GetFileOperationQueue();
+
+	if (!fileOperationQueue)
+	{
+		return false;
+	}
+
+	// Drops on files (e.g. executables) are always handled by the shell.
+	if (targetItem != -1
+		&& WI_IsFlagClear(
+			GetItemByIndex(targetItem).wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+	{
+		return false;
+	}
+
+	auto destination = GetPidlForTargetItem(targetItem);
+	auto transfer = GetInternalTransfer(dataObject, destination.get());
+
+	if (!transfer)
+	{
+		return false;
+	}
+
+	// This matches the way the shell determines the effect of a drop. Note that MK_XBUTTON1
+	// corresponds to the ALT key. Links are always created by the shell.
+	bool controlDown = WI_IsFlagSet(keyState, MK_CONTROL);
+	bool shiftDown = WI_IsFlagSet(keyState, MK_SHIFT);
+
+	if (WI_IsFlagSet(keyState, MK_XBUTTON1) || (controlDown && shiftDown))
+	{
+		return false;
+	}
+
+	bool move;
+
+	if (controlDown)
+	{
+		move = false;
+	}
+	else if (shiftDown)
+	{
+		move = true;
+	}
+	else
+	{
+		move = PathIsSameRoot(
+			transfer->sourcePaths[0].c_str(), transfer->destinationFolder.c_str());
+	}
+
+	DWORD effect = move ? DROPEFFECT_MOVE : DROPEFFECT_COPY;
+
+	if (WI_IsFlagClear(allowedEffects, effect))
+	{
+		return false;
+	}
+
+	fileOperationQueue->AddJob(transfer->sourcePaths, transfer->destinationFolder, move);
+
+	targetEffect = effect;
+
+	return true;
+}
+
 void ShellBrowser::UpdateUiForDrop(int targetItem, const POINT &pt)
 {
 	ListView_SetItemState(m_hListView, -1, 0, LVIS_DROPHILITED);
@@ -116,12 +195,18 @@ int CALLBACK SortTemporaryStub(LPARAM lParam1, LPARAM lParam2, LPARAM lParamSort
 
 int CALLBACK ShellBrowser::SortTemporary(LPARAM lParam1, LPARAM lParam2)
 {
-	return m_itemInfoMap.at(static_cast<int>(lParam1)).iRelativeSort
-		- m_itemInfoMap.at(static_cast<int>(lParam2)).iRelativeSort;
+	return m_itemInfoMap.Get(static_cast<int>(lParam1)).iRelativeSort
+		- m_itemInfoMap.Get(static_cast<int>(lParam2)).iRelativeSort;
 }
 
 void ShellBrowser::RepositionLocalFiles(const POINT *ppt)
 {
+	// Items in an owner data listview have no fixed position and can't be reordered manually.
+	if (IsOwnerDataListViewActive())
+	{
+		return;
+	}
+
 	POINT pt;
 	POINT ptOrigin;
 
@@ -190,7 +275,7 @@ void ShellBrowser::RepositionLocalFiles(const POINT *ppt)
 				{
 					if (i == *index)
 					{
-						m_itemInfoMap.at((int) lvItem.lParam).iRelativeSort = iInsert;
+						m_itemInfoMap.Get((int) lvItem.lParam).iRelativeSort = iInsert;
 					}
 					else
 					{
@@ -199,7 +284,7 @@ void ShellBrowser::RepositionLocalFiles(const POINT *ppt)
 							iSort++;
 						}
 
-						m_itemInfoMap.at((int) lvItem.lParam).iRelativeSort = iSort;
+						m_itemInfoMap.Get((int) lvItem.lParam).iRelativeSort = iSort;
 					}
 				}
 
@@ -207,6 +292,7 @@ void ShellBrowser::RepositionLocalFiles(const POINT *ppt)
 			}
 
 			ListView_SortItems(m_hListView, SortTemporaryStub, (LPARAM) this);
+			m_itemPositionIndex.Invalidate();
 		}
 		else
 		{
@@ -4,8 +4,22 @@
 
 #include "stdafx.h"
 #include "ShellBrowser.h"
+#include "Config.h"
 #include "MainResource.h"
 #include "../Helper/ListViewHelper.h"
+#include "../Helper/Logging.h"
+#include "../Helper/PriorityTaskScheduler.h"
+#include <wil/common.h>
+
+namespace
+{
+
+uint64_t FileTimeToInteger(const FILETIME &fileTime)
+{
+	return ULARGE_INTEGER{ fileTime.dwLowDateTime, fileTime.dwHighDateTime }.QuadPart;
+}
+
+}
 
 std::wstring ShellBrowser::GetFilter() const
 {
@@ -15,11 +29,11 @@ std::wstring ShellBrowser::GetFilter() const
 void ShellBrowser::SetFilter(std::wstring_view filter)
 {
 	m_folderSettings.filter = filter;
+	UpdateFilterMatcher();
 
 	if (m_folderSettings.applyFilter)
 	{
-		UnfilterAllItems();
-		UpdateFiltering();
+		StartFilterEvaluation();
 	}
 }
 
@@ -38,6 +52,12 @@ BOOL ShellBrowser::GetFilterStatus() const
 void ShellBrowser::SetFilterCaseSensitive(BOOL filterCaseSensitive)
 {
 	m_folderSettings.filterCaseSensitive = filterCaseSensitive;
+	UpdateFilterMatcher();
+
+	if (m_folderSettings.applyFilter)
+	{
+		StartFilterEvaluation();
+	}
 }
 
 BOOL ShellBrowser::GetFilterCaseSensitive() const
@@ -49,12 +69,15 @@ void ShellBrowser::UpdateFiltering()
 {
 	if (m_folderSettings.applyFilter)
 	{
-		RemoveFilteredItems();
+		StartFilterEvaluation();
 
 		ApplyFilteringBackgroundImage(true);
 	}
 	else
 	{
+		CancelFilterEvaluation();
+		m_appliedFilterMatcher.reset();
+
 		UnfilterAllItems();
 
 		if (m_directoryState.numItems == 0)
@@ -68,44 +91,471 @@ void ShellBrowser::UpdateFiltering()
 	}
 }
 
-void ShellBrowser::RemoveFilteredItems()
+// Tests the items against the current filter in the background. If the new filter is narrower than
+// the one that's currently applied (e.g. because more characters have been added to it), items that
+// are already hidden will remain hidden, so only the items that are shown need to be tested.
+void ShellBrowser::StartFilterEvaluation()
 {
-	if (!m_folderSettings.applyFilter)
+	auto startTime = std::chrono::steady_clock::now();
+
+	CancelFilterEvaluation();
+
+	bool narrowed = !m_filterExpression && m_appliedFilterMatcher
+		&& m_filterMatcher->IsSubsetOf(*m_appliedFilterMatcher);
+
+	std::vector<int> candidates;
+
+	if (IsOwnerDataListViewActive())
+	{
+		candidates = m_ownerDataState.items;
+	}
+	else
 	{
+		int numItems = ListView_GetItemCount(m_hListView);
+		candidates.reserve(numItems);
+
+		for (int i = 0; i < numItems; i++)
+		{
+			candidates.push_back(GetItemInternalIndex(i));
+		}
+	}
+
+	if (!narrowed)
+	{
+		candidates.insert(candidates.end(), m_directoryState.filteredItemsList.begin(),
+			m_directoryState.filteredItemsList.end());
+	}
+
+	// Folders are never filtered and hidden system files remain hidden regardless of the filter.
+	std::erase_if(candidates,
+		[this](int internalIndex)
+		{
+			const ItemInfo_t &itemInfo = m_itemInfoMap.Get(internalIndex);
+
+			return WI_IsFlagSet(itemInfo.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY)
+				|| (m_config->globalFolderSettings.hideSystemFiles
+					&& WI_IsFlagSet(itemInfo.wfd.dwFileAttributes, FILE_ATTRIBUTE_SYSTEM));
+		});
+
+	if (candidates.empty())
+	{
+		UpdateAppliedFilterMatcher();
 		return;
 	}
 
-	int nItems = ListView_GetItemCount(m_hListView);
+	m_filterEvaluation = std::make_shared<FilterEvaluation>(m_filterEvaluationIDCounter++,
+		*m_filterMatcher, m_filterExpression,
+		m_filterExpression ? GetFilterItemTable() : nullptr, GetFilterNameTable(),
+		std::move(candidates), startTime);
+
+	auto future = GetBackgroundTaskScheduler().PushTask(&m_filterEvaluation, std::nullopt,
+		FILTER_TASK_PRIORITY,
+		[listView = m_hListView, evaluation = m_filterEvaluation]()
+		{
+			EvaluateFilterAsync(listView, evaluation);
+		});
 
-	for (int i = nItems - 1; i >= 0; i--)
+	if (future.wait_for(SYNCHRONOUS_FILTER_TIMEOUT) == std::future_status::ready)
 	{
-		int internalIndex = GetItemInternalIndex(i);
+		ProcessFilterResults(m_filterEvaluation->evaluationId);
+	}
+}
+
+void ShellBrowser::EvaluateFilterAsync(HWND listView, std::shared_ptr<FilterEvaluation> evaluation)
+{
+	std::vector<bool> matches;
+	matches.reserve(evaluation->items.size());
 
-		if (!((m_itemInfoMap.at(internalIndex).wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-				== FILE_ATTRIBUTE_DIRECTORY))
+	if (evaluation->expression)
+	{
+		// The expression is run over every item in the table at once, one comparison at a time,
+		// and the results for the candidate items are then picked out.
+		auto results = evaluation->expression->Evaluate(*evaluation->itemTable,
+			[&names = *evaluation->names](size_t index)
+			{ return names.GetName(static_cast<int>(index)); });
+
+		if (evaluation->cancelled)
 		{
-			if (IsFilenameFiltered(m_itemInfoMap.at(internalIndex).displayName.c_str()))
+			return;
+		}
+
+		for (int internalIndex : evaluation->items)
+		{
+			matches.push_back(results[internalIndex] != 0);
+		}
+	}
+	else
+	{
+		for (int internalIndex : evaluation->items)
+		{
+			if (matches.size() % FILTER_CANCELLATION_CHECK_INTERVAL == 0 && evaluation->cancelled)
 			{
-				RemoveFilteredItem(i, internalIndex);
+				return;
 			}
+
+			matches.push_back(
+				evaluation->matcher.MatchesFolded(evaluation->names->GetName(internalIndex)));
+		}
+	}
+
+	{
+		std::scoped_lock lock(evaluation->mutex);
+
+		evaluation->matches = std::move(matches);
+		evaluation->finished = true;
+	}
+
+	PostMessage(listView, WM_APP_FILTER_RESULTS_READY, evaluation->evaluationId, 0);
+}
+
+void ShellBrowser::ProcessFilterResults(int evaluationId)
+{
+	if (!m_filterEvaluation || m_filterEvaluation->evaluationId != evaluationId)
+	{
+		// The evaluation has either been cancelled, or its results have already been processed.
+		return;
+	}
+
+	auto evaluation = std::move(m_filterEvaluation);
+	m_filterEvaluation.reset();
+
+	std::vector<bool> matches;
+
+	{
+		std::scoped_lock lock(evaluation->mutex);
+
+		if (!evaluation->finished)
+		{
+			return;
+		}
+
+		matches = std::move(evaluation->matches);
+	}
+
+	std::unordered_set<int> itemsToHide;
+	std::vector<int> itemsToShow;
+
+	for (size_t i = 0; i < evaluation->items.size(); i++)
+	{
+		int internalIndex = evaluation->items[i];
+		const ItemInfo_t *itemInfo = m_itemInfoMap.Find(internalIndex);
+
+		// The item has been removed since the evaluation started.
+		if (!itemInfo)
+		{
+			continue;
+		}
+
+		bool matched = matches[i];
+
+		// The item has been renamed or modified since the evaluation started, so the result may no
+		// longer apply.
+		if (evaluation->changedItems.contains(internalIndex))
+		{
+			matched = MatchesFilter(*itemInfo);
+		}
+
+		bool currentlyFiltered = m_directoryState.filteredItemsList.contains(internalIndex);
+
+		if (!matched && !currentlyFiltered)
+		{
+			itemsToHide.insert(internalIndex);
+		}
+		else if (matched && currentlyFiltered)
+		{
+			itemsToShow.push_back(internalIndex);
 		}
 	}
 
+	SendMessage(m_hListView, WM_SETREDRAW, FALSE, NULL);
+
+	HideFilteredItems(itemsToHide);
+	ShowUnfilteredItems(itemsToShow);
+
+	SendMessage(m_hListView, WM_SETREDRAW, TRUE, NULL);
+
+	if (evaluation->expression)
+	{
+		m_appliedFilterMatcher.reset();
+	}
+	else
+	{
+		m_appliedFilterMatcher.emplace(evaluation->matcher);
+	}
+
 	SendMessage(m_hOwner, WM_USER_UPDATEWINDOWS, 0, 0);
+
+	auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now() - evaluation->startTime);
+
+	if (duration > FILTER_LATENCY_TARGET)
+	{
+		LOG(warning) << L"ShellBrowser - Filter took " << duration.count() << L" ms to apply to "
+					 << evaluation->items.size() << L" items";
+	}
+	else
+	{
+		LOG(debug) << L"ShellBrowser - Filter took " << duration.count() << L" ms to apply to "
+				   << evaluation->items.size() << L" items";
+	}
+}
+
+std::shared_ptr<const ShellBrowser::ItemNameTable> ShellBrowser::GetFilterNameTable()
+{
+	bool caseSensitive = m_folderSettings.filterCaseSensitive;
+
+	if (m_filterNameTable && m_filterNameTable->caseSensitive == caseSensitive)
+	{
+		return m_filterNameTable;
+	}
+
+	m_filterNameTable = BuildItemNameTable(caseSensitive,
+		[](const ItemInfo_t &itemInfo) -> std::wstring_view { return itemInfo.displayName; });
+
+	return m_filterNameTable;
+}
+
+// Filenames are always matched case-insensitively, so this table is always lowercased.
+std::shared_ptr<const ShellBrowser::ItemNameTable> ShellBrowser::GetFileNameTable()
+{
+	if (!m_fileNameTable)
+	{
+		m_fileNameTable = BuildItemNameTable(false,
+			[](const ItemInfo_t &itemInfo) -> std::wstring_view
+			{ return itemInfo.wfd.cFileName; });
+	}
+
+	return m_fileNameTable;
+}
+
+// Type-ahead always matches case-insensitively, so the filter table can be shared if the filter
+// is also case-insensitive.
+std::shared_ptr<const ShellBrowser::ItemNameTable> ShellBrowser::GetTypeAheadNameTable()
+{
+	if (m_filterNameTable && !m_filterNameTable->caseSensitive)
+	{
+		return m_filterNameTable;
+	}
+
+	if (!m_typeAheadNameTable)
+	{
+		m_typeAheadNameTable = BuildItemNameTable(false,
+			[](const ItemInfo_t &itemInfo) -> std::wstring_view { return itemInfo.displayName; });
+	}
+
+	return m_typeAheadNameTable;
+}
+
+std::shared_ptr<const ShellBrowser::ItemNameTable> ShellBrowser::BuildItemNameTable(
+	bool caseSensitive, std::wstring_view (*getName)(const ItemInfo_t &itemInfo)) const
+{
+	auto table = std::make_shared<ItemNameTable>();
+	table->caseSensitive = caseSensitive;
+	table->ranges.resize(m_directoryState.itemIDCounter);
+
+	for (const auto &[internalIndex, itemInfo] : m_itemInfoMap)
+	{
+		std::wstring_view name = getName(itemInfo);
+		table->ranges[internalIndex] = { table->names.size(), name.size() };
+		table->names += name;
+	}
+
+	if (!caseSensitive)
+	{
+		// Lowercasing is performed character by character, so the names can all be lowercased in
+		// a single call, which is considerably faster than lowercasing each name separately.
+		std::wstring folded = WildcardMatcher::FoldString(table->names);
+
+		if (folded.size() == table->names.size())
+		{
+			table->names = std::move(folded);
+		}
+		else
+		{
+			std::wstring names;
+			names.reserve(table->names.size());
+
+			for (const auto &[internalIndex, itemInfo] : m_itemInfoMap)
+			{
+				std::wstring foldedName = WildcardMatcher::FoldString(getName(itemInfo));
+				table->ranges[internalIndex] = { names.size(), foldedName.size() };
+				names += foldedName;
+			}
+
+			table->names = std::move(names);
+		}
+	}
+
+	return table;
+}
+
+// Called whenever an item is added, removed or renamed. The tables will be rebuilt the next time
+// they're needed.
+void ShellBrowser::InvalidateItemNameTables()
+{
+	m_filterNameTable.reset();
+	m_fileNameTable.reset();
+	m_typeAheadNameTable.reset();
+	m_filterItemTable.reset();
+}
+
+std::shared_ptr<const FilterItemTable> ShellBrowser::GetFilterItemTable()
+{
+	if (m_filterItemTable)
+	{
+		return m_filterItemTable;
+	}
+
+	auto table = std::make_shared<FilterItemTable>();
+	table->Reserve(m_directoryState.itemIDCounter);
+
+	// The table has a row for every internal index, so that the row for an item can be found
+	// directly. Any index that's not in use is given an empty row.
+	for (int internalIndex = 0; internalIndex < m_directoryState.itemIDCounter; internalIndex++)
+	{
+		const ItemInfo_t *itemInfo = m_itemInfoMap.Find(internalIndex);
+		table->AddItem(itemInfo ? GetFilterItem(*itemInfo) : FilterItemTable::Item());
+	}
+
+	m_filterItemTable = std::move(table);
+
+	return m_filterItemTable;
+}
+
+FilterItemTable::Item ShellBrowser::GetFilterItem(const ItemInfo_t &itemInfo)
+{
+	FilterItemTable::Item item;
+	item.size = ULARGE_INTEGER{ itemInfo.wfd.nFileSizeLow, itemInfo.wfd.nFileSizeHigh }.QuadPart;
+	item.modified = FileTimeToInteger(itemInfo.wfd.ftLastWriteTime);
+	item.created = FileTimeToInteger(itemInfo.wfd.ftCreationTime);
+	item.accessed = FileTimeToInteger(itemInfo.wfd.ftLastAccessTime);
+	item.extension = PathFindExtension(itemInfo.wfd.cFileName);
+	return item;
+}
+
+void ShellBrowser::CancelFilterEvaluation()
+{
+	if (!m_filterEvaluation)
+	{
+		return;
+	}
+
+	m_filterEvaluation->cancelled = true;
+	m_filterEvaluation.reset();
+
+	GetBackgroundTaskScheduler().CancelTasks(&m_filterEvaluation);
+}
+
+// Hides the specified items (which should all be currently shown). In owner data mode, the items
+// are removed in a single pass, rather than one at a time.
+void ShellBrowser::HideFilteredItems(const std::unordered_set<int> &internalIndexes)
+{
+	if (internalIndexes.empty())
+	{
+		return;
+	}
+
+	if (!IsOwnerDataListViewActive())
+	{
+		for (int i = ListView_GetItemCount(m_hListView) - 1; i >= 0; i--)
+		{
+			int internalIndex = GetItemInternalIndex(i);
+
+			if (internalIndexes.contains(internalIndex))
+			{
+				RemoveFilteredItem(i, internalIndex);
+			}
+		}
+
+		return;
+	}
+
+	std::unordered_set<int> selectedItems = GetOwnerDataSelection();
+	std::optional<int> focusedItem;
+	int focusedIndex = ListView_GetNextItem(m_hListView, -1, LVNI_FOCUSED);
+
+	if (focusedIndex != -1 && !internalIndexes.contains(GetItemInternalIndex(focusedIndex)))
+	{
+		focusedItem = GetItemInternalIndex(focusedIndex);
+	}
+
+	auto isHidden = [this, &internalIndexes, &selectedItems](int internalIndex) {
+		if (!internalIndexes.contains(internalIndex))
+		{
+			return false;
+		}
+
+		const auto &itemInfo = m_itemInfoMap.Get(internalIndex);
+		ULARGE_INTEGER fileSize = { itemInfo.wfd.nFileSizeLow, itemInfo.wfd.nFileSizeHigh };
+
+		if (selectedItems.erase(internalIndex) > 0)
+		{
+			m_directoryState.selectionInfo.filesSize -= fileSize.QuadPart;
+			UntrackSelectedFolderSize(internalIndex);
+		}
+
+		m_directoryState.totalDirSize.QuadPart -= fileSize.QuadPart;
+		m_directoryState.numItems--;
+
+		m_ownerDataState.itemStates.erase(internalIndex);
+
+		assert(m_directoryState.filteredItemsList.count(internalIndex) == 0);
+		m_directoryState.filteredItemsList.insert(internalIndex);
+
+		return true;
+	};
+
+	std::erase_if(m_ownerDataState.items, isHidden);
+	m_itemPositionIndex.Invalidate();
+
+	// The selection is tracked by index, so it has to be cleared and restored once the remaining
+	// items have moved.
+	ListViewHelper::SelectAllItems(m_hListView, FALSE);
+	ListView_SetItemCountEx(
+		m_hListView, static_cast<int>(m_ownerDataState.items.size()), LVSICF_NOSCROLL);
+	RestoreOwnerDataSelection(selectedItems, focusedItem);
+}
+
+// Shows the specified items (which should all be currently hidden). The items are inserted
+// together and then sorted once, rather than each item being inserted in its sorted position.
+void ShellBrowser::ShowUnfilteredItems(const std::vector<int> &internalIndexes)
+{
+	if (internalIndexes.empty())
+	{
+		return;
+	}
+
+	for (int internalIndex : internalIndexes)
+	{
+		assert(m_directoryState.filteredItemsList.count(internalIndex) == 1);
+		m_directoryState.filteredItemsList.erase(internalIndex);
+
+		AwaitingAdd_t awaitingAdd;
+		awaitingAdd.iItem =
+			m_directoryState.numItems + static_cast<int>(m_directoryState.awaitingAddList.size());
+		awaitingAdd.bPosition = FALSE;
+		awaitingAdd.iAfter = -1;
+		awaitingAdd.iItemInternal = internalIndex;
+		m_directoryState.awaitingAddList.push_back(awaitingAdd);
+	}
+
+	InsertAwaitingItems(m_folderSettings.showInGroups);
+	SortItems();
 }
 
 void ShellBrowser::RemoveFilteredItem(int iItem, int iItemInternal)
 {
 	ULARGE_INTEGER ulFileSize;
 
-	const auto &item = m_itemInfoMap.at(iItemInternal);
+	const auto &item = m_itemInfoMap.Get(iItemInternal);
 
 	if (ListView_GetItemState(m_hListView, iItem, LVIS_SELECTED) == LVIS_SELECTED)
 	{
 		ulFileSize.LowPart = item.wfd.nFileSizeLow;
 		ulFileSize.HighPart = item.wfd.nFileSizeHigh;
 
-		m_directoryState.fileSelectionSize.QuadPart -= ulFileSize.QuadPart;
+		m_directoryState.selectionInfo.filesSize -= ulFileSize.QuadPart;
+		UntrackSelectedFolderSize(iItemInternal);
 	}
 
 	/* Take the file size of the removed file away from the total
@@ -116,7 +566,14 @@ void ShellBrowser::RemoveFilteredItem(int iItem, int iItemInternal)
 	m_directoryState.totalDirSize.QuadPart -= ulFileSize.QuadPart;
 
 	/* Remove the item from the m_hListView. */
-	ListView_DeleteItem(m_hListView, iItem);
+	if (IsOwnerDataListViewActive())
+	{
+		RemoveOwnerDataItem(iItem);
+	}
+	else
+	{
+		ListView_DeleteItem(m_hListView, iItem);
+	}
 
 	m_directoryState.numItems--;
 
@@ -124,25 +581,54 @@ void ShellBrowser::RemoveFilteredItem(int iItem, int iItemInternal)
 	m_directoryState.filteredItemsList.insert(iItemInternal);
 }
 
-BOOL ShellBrowser::IsFilenameFiltered(const TCHAR *FileName) const
+bool ShellBrowser::MatchesFilter(const ItemInfo_t &itemInfo) const
 {
-	if (CheckWildcardMatch(
-			m_folderSettings.filter.c_str(), FileName, m_folderSettings.filterCaseSensitive))
+	if (m_filterExpression)
 	{
-		return FALSE;
+		return m_filterExpression->Matches(GetFilterItem(itemInfo), itemInfo.displayName);
 	}
 
-	return TRUE;
+	return m_filterMatcher->Matches(itemInfo.displayName);
 }
 
-void ShellBrowser::UnfilterAllItems()
+// A filter that can be parsed as an expression is treated as one. Anything else (including any
+// plain wildcard pattern) is matched against the item names, as before.
+void ShellBrowser::UpdateFilterMatcher()
 {
-	for (int internalIndex : m_directoryState.filteredItemsList)
+	m_filterMatcher.emplace(m_folderSettings.filter, m_folderSettings.filterCaseSensitive);
+
+	FILETIME currentTime;
+	GetSystemTimeAsFileTime(&currentTime);
+
+	m_filterExpression = FilterExpression::Parse(m_folderSettings.filter,
+		m_folderSettings.filterCaseSensitive, FileTimeToInteger(currentTime));
+}
+
+// Records the filter that the items shown now reflect. Since an expression is always tested
+// against every item, there's nothing to record in that case.
+void ShellBrowser::UpdateAppliedFilterMatcher()
+{
+	if (m_filterExpression)
+	{
+		m_appliedFilterMatcher.reset();
+	}
+	else
 	{
-		RestoreFilteredItem(internalIndex);
+		m_appliedFilterMatcher.emplace(*m_filterMatcher);
 	}
+}
+
+// Any items that are still hidden for some other reason (e.g. hidden system files) will be added
+// back to the filtered list when they're inserted.
+void ShellBrowser::UnfilterAllItems()
+{
+	std::vector<int> filteredItems(
+		m_directoryState.filteredItemsList.begin(), m_directoryState.filteredItemsList.end());
+
+	SendMessage(m_hListView, WM_SETREDRAW, FALSE, NULL);
+	ShowUnfilteredItems(filteredItems);
+	SendMessage(m_hListView, WM_SETREDRAW, TRUE, NULL);
 
-	m_directoryState.filteredItemsList.clear();
 	SendMessage(m_hOwner, WM_USER_UPDATEWINDOWS, 0, 0);
 }
 
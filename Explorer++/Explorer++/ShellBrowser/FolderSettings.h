@@ -9,6 +9,19 @@
 #include "ViewModes.h"
 #include "../Helper/StringHelper.h"
 
+// Each of the special folders below has its own set of columns. The values here are saved, so
+// shouldn't be changed.
+enum class FolderType
+{
+	General = 0,
+	Computer = 1,
+	ControlPanel = 2,
+	Network = 3,
+	NetworkPlaces = 4,
+	Printers = 5,
+	RecycleBin = 6
+};
+
 struct FolderColumns
 {
 	std::vector<Column_t> realFolderColumns;
@@ -18,6 +31,8 @@ struct FolderColumns
 	std::vector<Column_t> printersColumns;
 	std::vector<Column_t> networkConnectionsColumns;
 	std::vector<Column_t> myNetworkPlacesColumns;
+
+	bool operator==(const FolderColumns &) const = default;
 };
 
 struct GlobalFolderSettings
@@ -38,6 +53,8 @@ struct GlobalFolderSettings
 	BOOL useNaturalSortOrder;
 
 	FolderColumns folderColumns;
+
+	bool operator==(const GlobalFolderSettings &) const = default;
 };
 
 struct FolderSettings
@@ -0,0 +1,336 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+// In details mode, the owner data listview can optionally be drawn by GridRenderer, rather than
+// by the listview itself. The listview still handles everything other than painting (scrolling,
+// selection, keyboard navigation, hit testing, the header, etc.), so nothing else in this class
+// needs to be aware of the difference.
+//
+// When the listview draws a row, it requests the text of every column through a separate
+// LVN_GETDISPINFO notification and measures and draws the text with GDI. Here, the text is read
+// from the column text cache directly and only the rows within the update region are drawn. The
+// layout of each string is cached by the renderer, so scrolling back and forth (or redrawing the
+// same rows as results arrive) doesn't require any text to be laid out again.
+
+#include "stdafx.h"
+#include "ShellBrowser.h"
+#include "Config.h"
+#include "DarkModeHelper.h"
+#include "ItemData.h"
+#include "ViewModes.h"
+#include "../Helper/GridRenderer.h"
+#include <wil/common.h>
+
+bool ShellBrowser::ShouldUseGridRenderer()
+{
+	// The filter background image is drawn by the listview, so the grid renderer isn't used while
+	// a filter is applied. The empty folder image is only shown when there are no items, in which
+	// case there's nothing for the grid renderer to draw.
+	if (!m_config->useGridRenderer || !IsOwnerDataListViewActive()
+		|| m_folderSettings.viewMode != +ViewMode::Details || m_folderSettings.applyFilter
+		|| m_ownerDataState.items.empty())
+	{
+		return false;
+	}
+
+	if (!m_gridRenderer)
+	{
+		m_gridRenderer = std::make_unique<GridRenderer>();
+	}
+
+	return m_gridRenderer->IsAvailable();
+}
+
+void ShellBrowser::OnGridViewPaint()
+{
+	PAINTSTRUCT ps;
+	wil::unique_hdc_paint hdc = wil::BeginPaint(m_hListView, &ps);
+
+	RECT clientRect;
+	GetClientRect(m_hListView, &clientRect);
+
+	// The header is a child of the listview, so only the area beneath it is drawn here.
+	HWND header = ListView_GetHeader(m_hListView);
+
+	if (IsWindowVisible(header))
+	{
+		RECT headerRect;
+		GetWindowRect(header, &headerRect);
+		MapWindowPoints(
+			HWND_DESKTOP, m_hListView, reinterpret_cast<LPPOINT>(&headerRect), 2);
+		clientRect.top = (std::max)(clientRect.top, headerRect.bottom);
+	}
+
+	RECT paintRect;
+
+	if (!IntersectRect(&paintRect, &ps.rcPaint, &clientRect))
+	{
+		return;
+	}
+
+	HFONT font = GetWindowFont(m_hListView);
+
+	if (!m_gridRenderer->BeginDraw(hdc.get(), paintRect, font))
+	{
+		FillRect(hdc.get(), &paintRect, GetSysColorBrush(COLOR_WINDOW));
+		return;
+	}
+
+	DrawGridViewRows(hdc.get(), paintRect);
+
+	m_gridRenderer->EndDraw();
+}
+
+void ShellBrowser::DrawGridViewRows(HDC hdc, const RECT &paintRect)
+{
+	COLORREF backgroundColor = ListView_GetBkColor(m_hListView);
+
+	if (backgroundColor == CLR_NONE)
+	{
+		backgroundColor = GetSysColor(COLOR_WINDOW);
+	}
+
+	m_gridRenderer->FillRectangle(paintRect, backgroundColor);
+
+	// All rows have the same height and horizontal extent, so the geometry of the top row is used
+	// for every row.
+	int numItems = static_cast<int>(m_ownerDataState.items.size());
+	int topIndex = ListView_GetTopIndex(m_hListView);
+	RECT topRowRect;
+
+	if (!ListView_GetItemRect(m_hListView, topIndex, &topRowRect, LVIR_BOUNDS))
+	{
+		return;
+	}
+
+	int rowHeight = topRowRect.bottom - topRowRect.top;
+
+	if (rowHeight <= 0)
+	{
+		return;
+	}
+
+	struct GridColumn
+	{
+		int subItem;
+		RECT labelRect;
+		GridRenderer::TextAlignment alignment;
+	};
+
+	HWND header = ListView_GetHeader(m_hListView);
+	int numColumns = Header_GetItemCount(header);
+	std::vector<int> columnOrder(numColumns);
+	ListView_GetColumnOrderArray(m_hListView, numColumns, columnOrder.data());
+
+	std::vector<GridColumn> columns;
+
+	for (int subItem : columnOrder)
+	{
+		GridColumn column;
+		column.subItem = subItem;
+		ListView_GetSubItemRect(m_hListView, topIndex, subItem, LVIR_LABEL, &column.labelRect);
+
+		LVCOLUMN lvColumn = {};
+		lvColumn.mask = LVCF_FMT;
+		ListView_GetColumn(m_hListView, subItem, &lvColumn);
+		column.alignment = ((lvColumn.fmt & LVCFMT_JUSTIFYMASK) == LVCFMT_RIGHT)
+			? GridRenderer::TextAlignment::Right
+			: GridRenderer::TextAlignment::Left;
+
+		columns.push_back(column);
+	}
+
+	RECT iconRect;
+	ListView_GetSubItemRect(m_hListView, topIndex, 0, LVIR_ICON, &iconRect);
+	HIMAGELIST imageList = ListView_GetImageList(m_hListView, LVSIL_SMALL);
+
+	// This is the same spacing the listview leaves between the edge of a cell and its text.
+	int textPadding = 2 * GetSystemMetrics(SM_CXEDGE);
+
+	bool fullRowSelect = WI_IsFlagSet(
+		ListView_GetExtendedListViewStyle(m_hListView), LVS_EX_FULLROWSELECT);
+	bool focused = (GetFocus() == m_hListView);
+	bool darkMode = DarkModeHelper::GetInstance().IsDarkModeEnabled();
+	COLORREF textColor = ListView_GetTextColor(m_hListView);
+	COLORREF selectedBackgroundColor;
+	COLORREF selectedTextColor;
+
+	if (darkMode)
+	{
+		selectedBackgroundColor = DarkModeHelper::BUTTON_HIGHLIGHT_COLOR;
+		selectedTextColor = DarkModeHelper::TEXT_COLOR;
+	}
+	else if (focused)
+	{
+		selectedBackgroundColor = GetSysColor(COLOR_HIGHLIGHT);
+		selectedTextColor = GetSysColor(COLOR_HIGHLIGHTTEXT);
+	}
+	else
+	{
+		selectedBackgroundColor = GetSysColor(COLOR_BTNFACE);
+		selectedTextColor = textColor;
+	}
+
+	int firstRow =
+		topIndex + (std::max)(0, static_cast<int>(paintRect.top - topRowRect.top) / rowHeight);
+	int lastRow = (std::min)(numItems - 1,
+		topIndex + static_cast<int>(paintRect.bottom - 1 - topRowRect.top) / rowHeight);
+
+	// Color rules are applied by the parent window when it receives a custom draw notification,
+	// so the same notifications the listview would send are sent here.
+	NMLVCUSTOMDRAW customDraw = {};
+	customDraw.nmcd.hdr.hwndFrom = m_hListView;
+	customDraw.nmcd.hdr.idFrom = GetDlgCtrlID(m_hListView);
+	customDraw.nmcd.hdr.code = NM_CUSTOMDRAW;
+	customDraw.nmcd.dwDrawStage = CDDS_PREPAINT;
+	customDraw.nmcd.hdc = hdc;
+	customDraw.nmcd.rc = paintRect;
+
+	HWND parent = GetParent(m_hListView);
+	bool notifyItemDraw = WI_IsFlagSet(SendMessage(parent, WM_NOTIFY,
+		customDraw.nmcd.hdr.idFrom, reinterpret_cast<LPARAM>(&customDraw)), CDRF_NOTIFYITEMDRAW);
+
+	struct RowIcon
+	{
+		POINT position;
+		OwnerDataItemImage image;
+		bool ghosted;
+	};
+
+	std::vector<RowIcon> icons;
+	std::optional<RECT> focusRect;
+
+	for (int row = firstRow; row <= lastRow; row++)
+	{
+		int internalIndex = m_ownerDataState.items[row];
+		const ItemInfo_t &itemInfo = m_itemInfoMap.Get(internalIndex);
+		int offset = (row - topIndex) * rowHeight;
+
+		RECT rowRect = topRowRect;
+		OffsetRect(&rowRect, 0, offset);
+
+		UINT state = ListView_GetItemState(m_hListView, row, LVIS_SELECTED | LVIS_FOCUSED);
+		bool selected = WI_IsFlagSet(state, LVIS_SELECTED);
+		bool ghosted = m_ownerDataState.itemStates[internalIndex].cut
+			|| WI_IsFlagSet(itemInfo.wfd.dwFileAttributes, FILE_ATTRIBUTE_HIDDEN);
+
+		COLORREF rowTextColor = textColor;
+
+		if (notifyItemDraw)
+		{
+			customDraw.nmcd.dwDrawStage = CDDS_ITEMPREPAINT;
+			customDraw.nmcd.dwItemSpec = row;
+			customDraw.nmcd.rc = rowRect;
+			customDraw.clrText = textColor;
+			customDraw.clrTextBk = backgroundColor;
+
+			LRESULT result = SendMessage(parent, WM_NOTIFY, customDraw.nmcd.hdr.idFrom,
+				reinterpret_cast<LPARAM>(&customDraw));
+
+			if (WI_IsFlagSet(result, CDRF_NEWFONT))
+			{
+				rowTextColor = customDraw.clrText;
+			}
+		}
+
+		if (selected)
+		{
+			RECT selectionRect = rowRect;
+
+			if (!fullRowSelect)
+			{
+				selectionRect = columns.empty() ? rowRect : columns[0].labelRect;
+				OffsetRect(&selectionRect, 0, offset);
+			}
+
+			m_gridRenderer->FillRectangle(selectionRect, selectedBackgroundColor);
+		}
+
+		for (const auto &column : columns)
+		{
+			RECT textRect = column.labelRect;
+			OffsetRect(&textRect, 0, offset);
+			InflateRect(&textRect, -textPadding, 0);
+
+			COLORREF color = rowTextColor;
+
+			if (selected && (fullRowSelect || column.subItem == 0))
+			{
+				color = selectedTextColor;
+			}
+			else if (ghosted)
+			{
+				// Ghosted items are drawn with their text halfway between the normal text color
+				// and the background color.
+				color = RGB((GetRValue(color) + GetRValue(backgroundColor)) / 2,
+					(GetGValue(color) + GetGValue(backgroundColor)) / 2,
+					(GetBValue(color) + GetBValue(backgroundColor)) / 2);
+			}
+
+			m_gridRenderer->DrawString(GetOwnerDataItemText(internalIndex, column.subItem),
+				textRect, color, column.alignment);
+		}
+
+		if (imageList)
+		{
+			icons.push_back({ { iconRect.left, iconRect.top + offset },
+				GetOwnerDataItemImage(internalIndex), ghosted });
+		}
+
+		if (WI_IsFlagSet(state, LVIS_FOCUSED) && focused)
+		{
+			focusRect = rowRect;
+		}
+	}
+
+	if (m_config->globalFolderSettings.showGridlines)
+	{
+		COLORREF gridlineColor = GetSysColor(COLOR_BTNFACE);
+
+		for (int row = firstRow; row <= lastRow; row++)
+		{
+			int bottom = topRowRect.bottom + (row - topIndex) * rowHeight;
+			m_gridRenderer->FillRectangle(
+				{ paintRect.left, bottom - 1, paintRect.right, bottom }, gridlineColor);
+		}
+
+		for (const auto &column : columns)
+		{
+			RECT columnRect;
+			ListView_GetSubItemRect(
+				m_hListView, topIndex, column.subItem, LVIR_BOUNDS, &columnRect);
+
+			// The bounds of the first column cover the whole row.
+			if (column.subItem == 0)
+			{
+				columnRect.right = columnRect.left + ListView_GetColumnWidth(m_hListView, 0);
+			}
+
+			m_gridRenderer->FillRectangle(
+				{ columnRect.right - 1, paintRect.top, columnRect.right, paintRect.bottom },
+				gridlineColor);
+		}
+	}
+
+	// Icons and the focus rectangle can only be drawn with GDI.
+	m_gridRenderer->DrawWithGdi([&icons, &focusRect, imageList, backgroundColor](HDC hdc) {
+		for (const auto &icon : icons)
+		{
+			UINT style = ILD_TRANSPARENT | INDEXTOOVERLAYMASK(icon.image.overlayIndex);
+
+			if (icon.ghosted)
+			{
+				WI_SetFlag(style, ILD_BLEND50);
+			}
+
+			ImageList_DrawEx(imageList, icon.image.iconIndex, hdc, icon.position.x,
+				icon.position.y, 0, 0, CLR_NONE, backgroundColor, style);
+		}
+
+		if (focusRect)
+		{
+			DrawFocusRect(hdc, &*focusRect);
+		}
+	});
+}
\ No newline at end of file
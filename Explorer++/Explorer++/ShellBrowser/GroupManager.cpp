@@ -4,21 +4,26 @@
 
 #include "stdafx.h"
 #include "ShellBrowser.h"
+#include "ColumnDataRetrieval.h"
 #include "Config.h"
 #include "ItemData.h"
 #include "MainResource.h"
 #include "ResourceHelper.h"
+#include "SortHelper.h"
 #include "SortModes.h"
 #include "../Helper/Helper.h"
 #include "../Helper/Macros.h"
 #include "../Helper/ShellHelper.h"
 #include "../Helper/TimeHelper.h"
+#include "../Helper/VolumeInfoCache.h"
 #include <boost/date_time/gregorian/gregorian.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/integer_traits.hpp>
+#include <boost/range/adaptor/map.hpp>
 #include <wil/common.h>
 #include <iphlpapi.h>
 #include <propkey.h>
+#include <algorithm>
 #include <cassert>
 #include <list>
 
@@ -53,6 +58,12 @@ void ShellBrowser::SetShowInGroups(BOOL bShowInGroups)
 	}
 	else
 	{
+		// Groups aren't supported in owner data mode.
+		if (IsOwnerDataListViewActive())
+		{
+			SwitchToStandardListView();
+		}
+
 		MoveItemsIntoGroups();
 	}
 }
@@ -63,10 +74,28 @@ int CALLBACK ShellBrowser::GroupComparisonStub(int id1, int id2, void *data)
 	return shellBrowser->GroupComparison(id1, id2);
 }
 
-int ShellBrowser::GroupComparison(int id1, int id2)
+int ShellBrowser::GroupComparison(int id1, int id2) const
+{
+	auto rank1 = m_groupRanks.find(id1);
+	auto rank2 = m_groupRanks.find(id2);
+
+	if (rank1 != m_groupRanks.end() && rank2 != m_groupRanks.end())
+	{
+		if (rank1->second == rank2->second)
+		{
+			return 0;
+		}
+
+		return (rank1->second < rank2->second) ? -1 : 1;
+	}
+
+	return CompareGroups(GetListViewGroupById(id1), GetListViewGroupById(id2));
+}
+
+// The ranks computed by RankGroups() are derived from this comparison, so the two are always
+// consistent, even when a ranked group is compared with one that was created later.
+int ShellBrowser::CompareGroups(const ListViewGroup &group1, const ListViewGroup &group2) const
 {
-	const auto &group1 = GetListViewGroupById(id1);
-	const auto &group2 = GetListViewGroupById(id2);
 	int comparisonResult = 0;
 
 	if (group1.relativeSortPosition == INT_MIN && group2.relativeSortPosition != INT_MIN)
@@ -126,6 +155,15 @@ int ShellBrowser::GroupComparison(int id1, int id2)
 
 int ShellBrowser::GroupNameComparison(const ListViewGroup &group1, const ListViewGroup &group2)
 {
+	int comparisonResult = CompareCollationKeys(group1.nameCollationKey, group2.nameCollationKey);
+
+	if (comparisonResult != 0)
+	{
+		return comparisonResult;
+	}
+
+	// Names that only differ in case have the same collation key. Group names are unique, so
+	// this keeps the order strict.
 	return group1.name.compare(group2.name);
 }
 
@@ -135,7 +173,38 @@ int ShellBrowser::GroupRelativePositionComparison(
 	return group1.relativeSortPosition - group2.relativeSortPosition;
 }
 
-const ShellBrowser::ListViewGroup ShellBrowser::GetListViewGroupById(int groupId)
+// Returns the IDs of the groups, in order.
+std::vector<int> ShellBrowser::RankGroups()
+{
+	std::vector<const ListViewGroup *> groups;
+	groups.reserve(m_listViewGroups.size());
+
+	for (const auto &group : m_listViewGroups)
+	{
+		groups.push_back(&group);
+	}
+
+	std::sort(groups.begin(), groups.end(),
+		[this](const ListViewGroup *group1, const ListViewGroup *group2) {
+			return CompareGroups(*group1, *group2) < 0;
+		});
+
+	std::vector<int> groupIds;
+	groupIds.reserve(groups.size());
+
+	m_groupRanks.clear();
+	m_groupRanks.reserve(groups.size());
+
+	for (size_t i = 0; i < groups.size(); i++)
+	{
+		groupIds.push_back(groups[i]->id);
+		m_groupRanks.emplace(groups[i]->id, static_cast<int>(i));
+	}
+
+	return groupIds;
+}
+
+const ShellBrowser::ListViewGroup &ShellBrowser::GetListViewGroupById(int groupId) const
 {
 	auto itr = m_listViewGroups.get<0>().find(groupId);
 	assert(itr != m_listViewGroups.get<0>().end());
@@ -145,10 +214,129 @@ const ShellBrowser::ListViewGroup ShellBrowser::GetListViewGroupById(int groupId
 
 int ShellBrowser::DetermineItemGroup(int iItemInternal)
 {
-	BasicItemInfo_t basicItemInfo = getBasicItemInfo(iItemInternal);
+	return GetOrCreateListViewGroup(GetItemGroupInfo(iItemInternal));
+}
+
+ShellBrowser::GroupInfo ShellBrowser::GetItemGroupInfo(int internalIndex)
+{
+	auto &cachedGroups = m_groupInfoCache[m_folderSettings.sortMode._to_integral()];
+	auto itr = cachedGroups.find(internalIndex);
+
+	if (itr != cachedGroups.end())
+	{
+		return itr->second;
+	}
+
+	GroupInfo groupInfo = DetermineItemGroupInfo(*getBasicItemInfo(internalIndex),
+		m_folderSettings.sortMode, m_config->globalFolderSettings);
+	cachedGroups.emplace(internalIndex, groupInfo);
+
+	return groupInfo;
+}
+
+// Determines the groups for any of the specified items that haven't been cached yet. If that
+// involves querying the items, the queries are run in parallel on the background task scheduler,
+// rather than one at a time on this thread as the items are grouped.
+void ShellBrowser::PrefetchGroupInfo(const std::vector<int> &internalIndexes)
+{
+	SortMode sortMode = m_folderSettings.sortMode;
+
+	if (!IsGroupDeterminationSlow(sortMode))
+	{
+		return;
+	}
+
+	auto &cachedGroups = m_groupInfoCache[sortMode._to_integral()];
+	auto settings = GetTaskSettings();
+
+	using GroupInfoBatch = std::vector<std::pair<int, GroupInfo>>;
+	std::vector<std::future<GroupInfoBatch>> results;
+	std::vector<std::pair<int, std::shared_ptr<const BasicItemInfo_t>>> batch;
+
+	auto queueBatch = [this, &results, &batch, sortMode, settings]()
+	{
+		results.push_back(GetBackgroundTaskScheduler().PushTask(&m_groupInfoCache, std::nullopt,
+			GROUP_INFO_TASK_PRIORITY,
+			[this, items = std::move(batch), sortMode, settings]()
+			{
+				GroupInfoBatch groupInfoBatch;
+
+				for (const auto &[internalIndex, basicItemInfo] : items)
+				{
+					groupInfoBatch.emplace_back(internalIndex,
+						DetermineItemGroupInfo(*basicItemInfo, sortMode, settings->value));
+				}
+
+				return groupInfoBatch;
+			}));
+
+		batch.clear();
+	};
+
+	for (int internalIndex : internalIndexes)
+	{
+		if (cachedGroups.contains(internalIndex))
+		{
+			continue;
+		}
+
+		batch.emplace_back(internalIndex, getBasicItemInfo(internalIndex));
+
+		if (batch.size() == GROUP_INFO_BATCH_SIZE)
+		{
+			queueBatch();
+		}
+	}
+
+	if (!batch.empty())
+	{
+		queueBatch();
+	}
+
+	for (auto &result : results)
+	{
+		for (auto &[internalIndex, groupInfo] : result.get())
+		{
+			cachedGroups.insert_or_assign(internalIndex, std::move(groupInfo));
+		}
+	}
+}
+
+void ShellBrowser::InvalidateCachedGroupInfo(int internalIndex)
+{
+	for (auto &cachedGroups : m_groupInfoCache | boost::adaptors::map_values)
+	{
+		cachedGroups.erase(internalIndex);
+	}
+}
+
+// Returns true if determining an item's group requires the item to be queried, rather than just
+// using the information that's already held for it.
+bool ShellBrowser::IsGroupDeterminationSlow(SortMode sortMode)
+{
+	switch (sortMode)
+	{
+	case SortMode::Name:
+	case SortMode::ShortName:
+	case SortMode::Size:
+	case SortMode::DateModified:
+	case SortMode::Created:
+	case SortMode::Accessed:
+	case SortMode::Extension:
+		return false;
+
+	default:
+		return true;
+	}
+}
+
+// Note that this can be called from a background thread, so it shouldn't access any mutable state.
+ShellBrowser::GroupInfo ShellBrowser::DetermineItemGroupInfo(const BasicItemInfo_t &basicItemInfo,
+	SortMode sortMode, const GlobalFolderSettings &globalFolderSettings) const
+{
 	std::optional<GroupInfo> groupInfo;
 
-	switch (m_folderSettings.sortMode)
+	switch (sortMode)
 	{
 	case SortMode::Name:
 		groupInfo = DetermineItemNameGroup(basicItemInfo);
@@ -179,7 +367,7 @@ int ShellBrowser::DetermineItemGroup(int iItemInternal)
 
 	case SortMode::OriginalLocation:
 		groupInfo = DetermineItemSummaryGroup(
-			basicItemInfo, &SCID_ORIGINAL_LOCATION, m_config->globalFolderSettings);
+			basicItemInfo, &SCID_ORIGINAL_LOCATION, globalFolderSettings);
 		break;
 
 	case SortMode::Attributes:
@@ -233,28 +421,23 @@ int ShellBrowser::DetermineItemGroup(int iItemInternal)
 		break;
 
 	case SortMode::Title:
-		groupInfo =
-			DetermineItemSummaryGroup(basicItemInfo, &PKEY_Title, m_config->globalFolderSettings);
+		groupInfo = DetermineItemSummaryGroup(basicItemInfo, &PKEY_Title, globalFolderSettings);
 		break;
 
 	case SortMode::Subject:
-		groupInfo =
-			DetermineItemSummaryGroup(basicItemInfo, &PKEY_Subject, m_config->globalFolderSettings);
+		groupInfo = DetermineItemSummaryGroup(basicItemInfo, &PKEY_Subject, globalFolderSettings);
 		break;
 
 	case SortMode::Authors:
-		groupInfo =
-			DetermineItemSummaryGroup(basicItemInfo, &PKEY_Author, m_config->globalFolderSettings);
+		groupInfo = DetermineItemSummaryGroup(basicItemInfo, &PKEY_Author, globalFolderSettings);
 		break;
 
 	case SortMode::Keywords:
-		groupInfo = DetermineItemSummaryGroup(
-			basicItemInfo, &PKEY_Keywords, m_config->globalFolderSettings);
+		groupInfo = DetermineItemSummaryGroup(basicItemInfo, &PKEY_Keywords, globalFolderSettings);
 		break;
 
 	case SortMode::Comments:
-		groupInfo =
-			DetermineItemSummaryGroup(basicItemInfo, &PKEY_Comment, m_config->globalFolderSettings);
+		groupInfo = DetermineItemSummaryGroup(basicItemInfo, &PKEY_Comment, globalFolderSettings);
 		break;
 
 	case SortMode::CameraModel:
@@ -296,6 +479,16 @@ int ShellBrowser::DetermineItemGroup(int iItemInternal)
 		groupInfo = DetermineItemNetworkStatus(basicItemInfo);
 		break;
 
+	case SortMode::Checksum:
+		break;
+
+	case SortMode::RelativePath:
+		if (!basicItemInfo.relativeFolder.empty())
+		{
+			groupInfo = GroupInfo(basicItemInfo.relativeFolder);
+		}
+		break;
+
 	default:
 		assert(false);
 		break;
@@ -303,14 +496,38 @@ int ShellBrowser::DetermineItemGroup(int iItemInternal)
 
 	if (!groupInfo)
 	{
-		groupInfo = GroupInfo(
-			ResourceHelper::LoadString(m_hResourceModule, IDS_GROUPBY_UNSPECIFIED), INT_MIN);
+		groupInfo = GroupInfo(IDS_GROUPBY_UNSPECIFIED, INT_MIN);
 	}
 
-	return GetOrCreateListViewGroup(*groupInfo);
+	return *groupInfo;
 }
 
 int ShellBrowser::GetOrCreateListViewGroup(const GroupInfo &groupInfo)
+{
+	if (!groupInfo.nameResourceId)
+	{
+		return GetOrCreateListViewGroupByName(groupInfo);
+	}
+
+	// Groups with a fixed header are looked up by the header's resource ID. The header is only
+	// loaded when the first item in the group is seen.
+	auto itr = m_resourceGroupIds.find(*groupInfo.nameResourceId);
+
+	if (itr != m_resourceGroupIds.end())
+	{
+		return itr->second;
+	}
+
+	GroupInfo namedGroupInfo(
+		ResourceHelper::LoadString(m_hResourceModule, *groupInfo.nameResourceId),
+		groupInfo.relativeSortPosition);
+	int groupId = GetOrCreateListViewGroupByName(namedGroupInfo);
+	m_resourceGroupIds.emplace(*groupInfo.nameResourceId, groupId);
+
+	return groupId;
+}
+
+int ShellBrowser::GetOrCreateListViewGroupByName(const GroupInfo &groupInfo)
 {
 	auto &groupNameIndex = m_listViewGroups.get<1>();
 	auto itr = groupNameIndex.find(groupInfo.name);
@@ -322,8 +539,9 @@ int ShellBrowser::GetOrCreateListViewGroup(const GroupInfo &groupInfo)
 
 	int groupId = m_groupIdCounter++;
 
-	ListViewGroup listViewGroup(groupId, groupInfo);
-	m_listViewGroups.insert(listViewGroup);
+	ListViewGroup listViewGroup(groupId, groupInfo,
+		CreateCollationKey(groupInfo.name, m_config->globalFolderSettings.useNaturalSortOrder));
+	m_listViewGroups.insert(std::move(listViewGroup));
 
 	return groupId;
 }
@@ -342,8 +560,7 @@ std::optional<ShellBrowser::GroupInfo> ShellBrowser::DetermineItemNameGroup(
 	}
 	else
 	{
-		return GroupInfo(
-			ResourceHelper::LoadString(m_hResourceModule, IDS_GROUPBY_NAME_OTHER), INT_MAX);
+		return GroupInfo(IDS_GROUPBY_NAME_OTHER, INT_MAX);
 	}
 }
 
@@ -352,8 +569,7 @@ std::optional<ShellBrowser::GroupInfo> ShellBrowser::DetermineItemSizeGroup(
 {
 	if ((itemInfo.wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == FILE_ATTRIBUTE_DIRECTORY)
 	{
-		return GroupInfo(
-			ResourceHelper::LoadString(m_hResourceModule, IDS_GROUPBY_SIZE_FOLDERS), 0);
+		return GroupInfo(IDS_GROUPBY_SIZE_FOLDERS, 0);
 	}
 	else if (!itemInfo.isFindDataValid)
 	{
@@ -382,9 +598,7 @@ std::optional<ShellBrowser::GroupInfo> ShellBrowser::DetermineItemSizeGroup(
 		currentIndex++;
 	}
 
-	return GroupInfo(
-		ResourceHelper::LoadString(m_hResourceModule, sizeGroups[currentIndex].nameResourceId),
-		currentIndex + 1);
+	return GroupInfo(sizeGroups[currentIndex].nameResourceId, currentIndex + 1);
 }
 
 /* TODO: These groups have changed as of Windows Vista. */
@@ -396,8 +610,6 @@ std::optional<ShellBrowser::GroupInfo> ShellBrowser::DetermineItemTotalSizeGroup
 	const TCHAR *sizeGroups[] = { _T("Small"), _T("Medium"), _T("Huge"), _T("Gigantic") };
 	TCHAR szItem[MAX_PATH];
 	STRRET str;
-	ULARGE_INTEGER nTotalBytes;
-	ULARGE_INTEGER nFreeBytes;
 	BOOL bRoot;
 	BOOL bRes = FALSE;
 	ULARGE_INTEGER totalSizeGroupLimits[6];
@@ -419,13 +631,20 @@ std::optional<ShellBrowser::GroupInfo> ShellBrowser::DetermineItemTotalSizeGroup
 
 	if (bRoot)
 	{
-		bRes = GetDiskFreeSpaceEx(szItem, nullptr, &nTotalBytes, &nFreeBytes);
+		auto spaceInfo = VolumeInfoCache::GetInstance().GetSpaceInfo(szItem);
 
 		pShellFolder->Release();
 
+		if (!spaceInfo)
+		{
+			return std::nullopt;
+		}
+
+		bRes = TRUE;
+
 		i = SIZEOF_ARRAY(sizeGroups) - 1;
 
-		while (nTotalBytes.QuadPart < totalSizeGroupLimits[i].QuadPart && i > 0)
+		while (spaceInfo->totalBytes.QuadPart < totalSizeGroupLimits[i].QuadPart && i > 0)
 		{
 			i--;
 		}
@@ -509,16 +728,14 @@ std::optional<ShellBrowser::GroupInfo> ShellBrowser::DetermineItemDateGroup(
 
 	if (fileDate > today)
 	{
-		return GroupInfo(ResourceHelper::LoadString(m_hResourceModule, IDS_GROUPBY_DATE_FUTURE),
-			relativeSortPosition);
+		return GroupInfo(IDS_GROUPBY_DATE_FUTURE, relativeSortPosition);
 	}
 
 	relativeSortPosition--;
 
 	if (fileDate == today)
 	{
-		return GroupInfo(ResourceHelper::LoadString(m_hResourceModule, IDS_GROUPBY_DATE_TODAY),
-			relativeSortPosition);
+		return GroupInfo(IDS_GROUPBY_DATE_TODAY, relativeSortPosition);
 	}
 
 	date yesterday = today - days(1);
@@ -527,8 +744,7 @@ std::optional<ShellBrowser::GroupInfo> ShellBrowser::DetermineItemDateGroup(
 
 	if (fileDate == yesterday)
 	{
-		return GroupInfo(ResourceHelper::LoadString(m_hResourceModule, IDS_GROUPBY_DATE_YESTERDAY),
-			relativeSortPosition);
+		return GroupInfo(IDS_GROUPBY_DATE_YESTERDAY, relativeSortPosition);
 	}
 
 	// Note that this assumes that Sunday is the first day of the week.
@@ -539,8 +755,7 @@ std::optional<ShellBrowser::GroupInfo> ShellBrowser::DetermineItemDateGroup(
 
 	if (fileDate >= startOfWeek)
 	{
-		return GroupInfo(ResourceHelper::LoadString(m_hResourceModule, IDS_GROUPBY_DATE_THIS_WEEK),
-			relativeSortPosition);
+		return GroupInfo(IDS_GROUPBY_DATE_THIS_WEEK, relativeSortPosition);
 	}
 
 	date startOfLastWeek = startOfWeek - weeks(1);
@@ -549,8 +764,7 @@ std::optional<ShellBrowser::GroupInfo> ShellBrowser::DetermineItemDateGroup(
 
 	if (fileDate >= startOfLastWeek)
 	{
-		return GroupInfo(ResourceHelper::LoadString(m_hResourceModule, IDS_GROUPBY_DATE_LAST_WEEK),
-			relativeSortPosition);
+		return GroupInfo(IDS_GROUPBY_DATE_LAST_WEEK, relativeSortPosition);
 	}
 
 	date startOfMonth = date(today.year(), today.month(), 1);
@@ -559,8 +773,7 @@ std::optional<ShellBrowser::GroupInfo> ShellBrowser::DetermineItemDateGroup(
 
 	if (fileDate >= startOfMonth)
 	{
-		return GroupInfo(ResourceHelper::LoadString(m_hResourceModule, IDS_GROUPBY_DATE_THIS_MONTH),
-			relativeSortPosition);
+		return GroupInfo(IDS_GROUPBY_DATE_THIS_MONTH, relativeSortPosition);
 	}
 
 	date startOfLastMonth = startOfMonth - months(1);
@@ -569,8 +782,7 @@ std::optional<ShellBrowser::GroupInfo> ShellBrowser::DetermineItemDateGroup(
 
 	if (fileDate >= startOfLastMonth)
 	{
-		return GroupInfo(ResourceHelper::LoadString(m_hResourceModule, IDS_GROUPBY_DATE_LAST_MONTH),
-			relativeSortPosition);
+		return GroupInfo(IDS_GROUPBY_DATE_LAST_MONTH, relativeSortPosition);
 	}
 
 	date startOfYear = date(today.year(), 1, 1);
@@ -579,8 +791,7 @@ std::optional<ShellBrowser::GroupInfo> ShellBrowser::DetermineItemDateGroup(
 
 	if (fileDate >= startOfYear)
 	{
-		return GroupInfo(ResourceHelper::LoadString(m_hResourceModule, IDS_GROUPBY_DATE_THIS_YEAR),
-			relativeSortPosition);
+		return GroupInfo(IDS_GROUPBY_DATE_THIS_YEAR, relativeSortPosition);
 	}
 
 	date startOfLastYear = startOfYear - years(1);
@@ -589,14 +800,12 @@ std::optional<ShellBrowser::GroupInfo> ShellBrowser::DetermineItemDateGroup(
 
 	if (fileDate >= startOfLastYear)
 	{
-		return GroupInfo(ResourceHelper::LoadString(m_hResourceModule, IDS_GROUPBY_DATE_LAST_YEAR),
-			relativeSortPosition);
+		return GroupInfo(IDS_GROUPBY_DATE_LAST_YEAR, relativeSortPosition);
 	}
 
 	relativeSortPosition--;
 
-	return GroupInfo(ResourceHelper::LoadString(m_hResourceModule, IDS_GROUPBY_DATE_LONG_AGO),
-		relativeSortPosition);
+	return GroupInfo(IDS_GROUPBY_DATE_LONG_AGO, relativeSortPosition);
 }
 
 std::optional<ShellBrowser::GroupInfo> ShellBrowser::DetermineItemSummaryGroup(
@@ -642,7 +851,16 @@ std::optional<ShellBrowser::GroupInfo> ShellBrowser::DetermineItemFreeSpaceGroup
 
 	if (bRoot)
 	{
-		bRes = GetDiskFreeSpaceEx(szItem, nullptr, &nTotalBytes, &nFreeBytes);
+		auto spaceInfo = VolumeInfoCache::GetInstance().GetSpaceInfo(szItem);
+
+		if (!spaceInfo)
+		{
+			return std::nullopt;
+		}
+
+		bRes = TRUE;
+		nTotalBytes = spaceInfo->totalBytes;
+		nFreeBytes = spaceInfo->freeBytes;
 
 		LARGE_INTEGER lDiv1;
 		LARGE_INTEGER lDiv2;
@@ -685,17 +903,14 @@ std::optional<ShellBrowser::GroupInfo> ShellBrowser::DetermineItemAttributeGroup
 std::optional<ShellBrowser::GroupInfo> ShellBrowser::DetermineItemOwnerGroup(
 	const BasicItemInfo_t &itemInfo) const
 {
-	std::wstring fullFileName = itemInfo.getFullPath();
-
-	TCHAR szOwner[512];
-	BOOL ret = GetFileOwner(fullFileName.c_str(), szOwner, std::size(szOwner));
+	std::wstring owner = GetOwnerColumnText(itemInfo);
 
-	if (!ret)
+	if (owner.empty())
 	{
 		return std::nullopt;
 	}
 
-	return GroupInfo(szOwner);
+	return GroupInfo(owner);
 }
 
 std::optional<ShellBrowser::GroupInfo> ShellBrowser::DetermineItemVersionGroup(
@@ -762,16 +977,14 @@ std::optional<ShellBrowser::GroupInfo> ShellBrowser::DetermineItemFileSystemGrou
 		return std::nullopt;
 	}
 
-	TCHAR fileSystemName[MAX_PATH];
-	BOOL res = GetVolumeInformation(fullPath.c_str(), nullptr, 0, nullptr, nullptr, nullptr,
-		fileSystemName, SIZEOF_ARRAY(fileSystemName));
+	auto fileSystemName = VolumeInfoCache::GetInstance().GetFileSystemName(fullPath);
 
-	if (!res)
+	if (!fileSystemName)
 	{
 		return std::nullopt;
 	}
 
-	return GroupInfo(fileSystemName);
+	return GroupInfo(*fileSystemName);
 }
 
 /* TODO: Fix. Need to check for each adapter. */
@@ -831,33 +1044,71 @@ std::optional<ShellBrowser::GroupInfo> ShellBrowser::DetermineItemNetworkStatus(
 	return GroupInfo(szStatus);
 }
 
+// Rebuilds all the groups. The group for every item is determined up front, which means that each
+// group can be inserted once, with its final item count, rather than the group header being
+// updated as each item is added to it.
 void ShellBrowser::MoveItemsIntoGroups()
 {
-	LVITEM item;
-	int nItems;
-	int iGroupId;
-	int i = 0;
+	int numItems = ListView_GetItemCount(m_hListView);
 
-	ListView_RemoveAllGroups(m_hListView);
-	ListView_EnableGroupView(m_hListView, TRUE);
+	std::vector<int> internalIndexes;
+	internalIndexes.reserve(numItems);
 
-	nItems = ListView_GetItemCount(m_hListView);
+	for (int i = 0; i < numItems; i++)
+	{
+		internalIndexes.push_back(GetItemInternalIndex(i));
+	}
+
+	PrefetchGroupInfo(internalIndexes);
 
 	SendMessage(m_hListView, WM_SETREDRAW, FALSE, NULL);
 
+	ListView_RemoveAllGroups(m_hListView);
+	ListView_EnableGroupView(m_hListView, TRUE);
+
 	m_listViewGroups.clear();
+	m_resourceGroupIds.clear();
+	m_groupRanks.clear();
 	m_groupIdCounter = 0;
 
-	for (i = 0; i < nItems; i++)
+	std::vector<int> groupIds;
+	groupIds.reserve(numItems);
+
+	std::unordered_map<int, int> groupSizes;
+
+	for (int internalIndex : internalIndexes)
 	{
-		item.mask = LVIF_PARAM;
-		item.iItem = i;
-		item.iSubItem = 0;
-		ListView_GetItem(m_hListView, &item);
+		int groupId = DetermineItemGroup(internalIndex);
+		groupIds.push_back(groupId);
+		groupSizes[groupId]++;
+	}
+
+	auto &groupIdIndex = m_listViewGroups.get<0>();
 
-		iGroupId = DetermineItemGroup((int) item.lParam);
+	for (const auto &[groupId, groupSize] : groupSizes)
+	{
+		auto itr = groupIdIndex.find(groupId);
+		assert(itr != groupIdIndex.end());
+
+		groupIdIndex.modify(
+			itr, [groupSize = groupSize](ListViewGroup &group) { group.numItems = groupSize; });
+	}
 
-		InsertItemIntoGroup(i, iGroupId);
+	// Every group is known at this point, so the order is determined once, up front. The groups
+	// are then inserted in that order, with each insertion only requiring rank comparisons.
+	for (int groupId : RankGroups())
+	{
+		InsertGroupIntoListView(GetListViewGroupById(groupId));
+	}
+
+	for (int i = 0; i < numItems; i++)
+	{
+		LVITEM item;
+		item.mask = LVIF_GROUPID;
+		item.iItem = i;
+		item.iSubItem = 0;
+		item.iGroupId = groupIds[i];
+		ListView_SetItem(m_hListView, &item);
 	}
 
 	SendMessage(m_hListView, WM_SETREDRAW, TRUE, NULL);
@@ -894,7 +1145,7 @@ void ShellBrowser::InsertItemIntoGroup(int index, int groupId)
 
 void ShellBrowser::EnsureGroupExistsInListView(int groupId)
 {
-	ListViewGroup group = GetListViewGroupById(groupId);
+	const ListViewGroup &group = GetListViewGroupById(groupId);
 
 	if (group.numItems == 0)
 	{
@@ -5,8 +5,14 @@
 #include "stdafx.h"
 #include "ShellBrowser.h"
 #include "ItemData.h"
+#include "ShellExtensionHostPool.h"
 #include "ViewModes.h"
+#include "../Helper/DpiCompatibility.h"
+#include "../Helper/ImageHelper.h"
+#include "../Helper/PerformanceTrace.h"
+#include "../Helper/PriorityTaskScheduler.h"
 #include "../Helper/ShellHelper.h"
+#include "../Helper/TieredThumbnailCache.h"
 #include <wil/com.h>
 #include <thumbcache.h>
 #include <list>
@@ -14,9 +20,67 @@
 #define THUMBNAIL_TYPE_ICON 0
 #define THUMBNAIL_TYPE_EXTRACTED 1
 
+namespace
+{
+
+// Creating a thumbnail cache instance is relatively expensive, so each background thread creates a
+// single instance on first use and then reuses it for every thumbnail retrieved on that thread.
+thread_local wil::com_ptr_nothrow<IThumbnailCache> g_threadThumbnailCache;
+
+std::optional<TieredThumbnailCache::Image> GetImageFromBitmap(HBITMAP bitmap)
+{
+	BITMAP bitmapInfo;
+
+	if (GetObject(bitmap, sizeof(bitmapInfo), &bitmapInfo) == 0 || bitmapInfo.bmWidth <= 0
+		|| bitmapInfo.bmHeight <= 0)
+	{
+		return std::nullopt;
+	}
+
+	TieredThumbnailCache::Image image;
+	image.width = bitmapInfo.bmWidth;
+	image.height = bitmapInfo.bmHeight;
+	image.pixels.resize(static_cast<size_t>(image.width) * image.height);
+
+	// A negative height results in a top-down image.
+	BITMAPINFO bmi;
+	ImageHelper::InitBitmapInfo(&bmi, sizeof(bmi), image.width, -image.height, 32);
+
+	wil::unique_hdc_window hdc(GetDC(nullptr));
+	int res = GetDIBits(hdc.get(), bitmap, 0, image.height, image.pixels.data(), &bmi,
+		DIB_RGB_COLORS);
+
+	if (res == 0)
+	{
+		return std::nullopt;
+	}
+
+	return image;
+}
+
+wil::unique_hbitmap CreateBitmapFromImage(const TieredThumbnailCache::Image &image)
+{
+	BITMAPINFO bmi;
+	ImageHelper::InitBitmapInfo(&bmi, sizeof(bmi), image.width, -image.height, 32);
+
+	void *bits;
+	wil::unique_hbitmap bitmap(
+		CreateDIBSection(nullptr, &bmi, DIB_RGB_COLORS, &bits, nullptr, 0));
+
+	if (!bitmap)
+	{
+		return nullptr;
+	}
+
+	memcpy(bits, image.pixels.data(), image.pixels.size() * sizeof(uint32_t));
+
+	return bitmap;
+}
+
+}
+
 void ShellBrowser::SetupThumbnailsView()
 {
-	HIMAGELIST himl;
 	LVITEM lvItem;
 	int nItems;
 	int i = 0;
@@ -34,10 +98,19 @@ void ShellBrowser::SetupThumbnailsView()
 
 	m_hListViewImageList = ListView_GetImageList(m_hListView, LVSIL_NORMAL);
 
-	himl = ImageList_Create(
-		THUMBNAIL_ITEM_WIDTH, THUMBNAIL_ITEM_HEIGHT, ILC_COLOR32, nItems, nItems + 100);
-	ListView_SetImageList(m_hListView, himl, LVSIL_NORMAL);
+	// The image list is kept when leaving thumbnails view, so that any thumbnails that were
+	// retrieved are shown again straight away if the view is re-entered. It only needs to be
+	// recreated if the DPI has changed in the meantime.
+	if (!m_thumbnailImageList || GetThumbnailItemSize() != m_thumbnailItemSize)
+	{
+		ClearThumbnailRequestState();
+		m_thumbnailImageList.reset(CreateThumbnailImageList());
+	}
 
+	ListView_SetImageList(m_hListView, m_thumbnailImageList.get(), LVSIL_NORMAL);
+
+	// The other views store each item's icon index, which needs to be replaced with the
+	// thumbnail slot.
 	for (i = 0; i < nItems; i++)
 	{
 		lvItem.mask = LVIF_IMAGE;
@@ -50,105 +123,325 @@ void ShellBrowser::SetupThumbnailsView()
 	m_bThumbnailsSetup = TRUE;
 }
 
-void ShellBrowser::RemoveThumbnailsView()
+// The image list has a fixed number of images. Each image is a slot that's assigned to a single
+// item at a time and taken back once the item is out of view (see AllocateThumbnailSlot()), so the
+// memory used by thumbnails doesn't depend on the number of items in the folder. Items don't store
+// their slot; it's looked up whenever the listview requests the item's image.
+//
+// The size of the thumbnails is scaled for the current DPI. Any thumbnails that have already been
+// retrieved at a different size are regenerated from the shared TieredThumbnailCache, rather than
+// being requested from the shell again.
+HIMAGELIST ShellBrowser::CreateThumbnailImageList()
 {
-	LVITEM lvItem;
-	HIMAGELIST himl;
-	int nItems;
-	int i = 0;
+	m_thumbnailItemSize = GetThumbnailItemSize();
 
-	nItems = ListView_GetItemCount(m_hListView);
+	m_thumbnailSlots.Reset(GetThumbnailSlotCapacity(m_thumbnailItemSize));
 
-	m_thumbnailThreadPool.clear_queue();
-	m_thumbnailResults.clear();
+	HIMAGELIST himl = ImageList_Create(m_thumbnailItemSize, m_thumbnailItemSize, ILC_COLOR32,
+		m_thumbnailSlots.GetCapacity(), 0);
+	ImageList_SetImageCount(himl, m_thumbnailSlots.GetCapacity());
 
-	for (i = 0; i < nItems; i++)
+	return himl;
+}
+
+int ShellBrowser::GetThumbnailItemSize() const
+{
+	UINT dpi = DpiCompatibility::GetInstance().GetDpiForWindow(m_hListView);
+	return MulDiv(THUMBNAIL_ITEM_SIZE, dpi, USER_DEFAULT_SCREEN_DPI);
+}
+
+// Returns enough slots to cover the thumbnails visible on the screen a few times over, which
+// leaves room for the items near the visible range (e.g. those that have been prefetched).
+int ShellBrowser::GetThumbnailSlotCapacity(int thumbnailItemSize)
+{
+	int columns = GetSystemMetrics(SM_CXSCREEN) / thumbnailItemSize + 1;
+	int rows = GetSystemMetrics(SM_CYSCREEN) / thumbnailItemSize + 1;
+	return columns * rows * THUMBNAIL_SLOT_SCREENS;
+}
+
+std::optional<int> ShellBrowser::AllocateThumbnailSlot(int internalIndex)
+{
+	// Slots are only ever taken from items that aren't currently visible.
+	auto allocation = m_thumbnailSlots.Allocate(internalIndex, [this](int owner) {
+		auto index = LocateItemByInternalIndex(owner);
+		return !index || !ListView_IsItemVisible(m_hListView, *index);
+	});
+
+	if (!allocation)
 	{
-		lvItem.mask = LVIF_IMAGE;
-		lvItem.iItem = i;
-		lvItem.iSubItem = 0;
-		lvItem.iImage = I_IMAGECALLBACK;
-		ListView_SetItem(m_hListView, &lvItem);
+		return std::nullopt;
 	}
 
-	/* Destroy the thumbnails imagelist. */
-	himl = ListView_GetImageList(m_hListView, LVSIL_NORMAL);
+	if (allocation->evictedOwner)
+	{
+		// The item will request its thumbnail again once it's scrolled back into view.
+		m_fetchedThumbnailItems.erase(*allocation->evictedOwner);
+	}
 
-	ImageList_Destroy(himl);
+	return allocation->slot;
+}
+
+// Items in thumbnails view never store an image index (see OnListViewGetDisplayInfo()), so there's
+// nothing to reset here. The thumbnail image list and the slots assigned to each item are kept, so
+// that the thumbnails can be reattached if thumbnails view is re-entered. Only the requests that
+// are still outstanding are canceled.
+void ShellBrowser::RemoveThumbnailsView()
+{
+	CancelThumbnailTasks();
+
+	ListView_SetImageList(m_hListView, m_hListViewImageList, LVSIL_NORMAL);
 
 	m_bThumbnailsSetup = FALSE;
 }
 
-void ShellBrowser::QueueThumbnailTask(int internalIndex)
+// When the DPI changes, the thumbnails image list is recreated at the new size. The thumbnails
+// themselves will generally be regenerated from the TieredThumbnailCache, without having to be
+// extracted again.
+void ShellBrowser::OnThumbnailsDpiChanged()
 {
-	int thumbnailResultID = m_thumbnailResultIDCounter++;
+	if (!m_bThumbnailsSetup)
+	{
+		return;
+	}
+
+	ClearThumbnailResults();
+
+	m_thumbnailImageList.reset(CreateThumbnailImageList());
+	ListView_SetImageList(m_hListView, m_thumbnailImageList.get(), LVSIL_NORMAL);
 
-	BasicItemInfo_t basicItemInfo = getBasicItemInfo(internalIndex);
+	// Each item will request its image (and thumbnail) again when it's redrawn.
+	InvalidateRect(m_hListView, nullptr, TRUE);
+}
+
+void ShellBrowser::QueueThumbnailTask(int internalIndex, int priority)
+{
+	// Generating a thumbnail typically requires the whole file to be read, which is too expensive
+	// on a slow server. The item's icon is shown instead.
+	if (m_reducedNetworkActivity)
+	{
+		return;
+	}
 
-	auto result =
-		m_thumbnailThreadPool.push([this, thumbnailResultID, internalIndex, basicItemInfo](
-									   int id) -> std::optional<ThumbnailResult_t> {
-			UNREFERENCED_PARAMETER(id);
+	auto [itr, inserted] = m_pendingThumbnailItems.insert(internalIndex);
 
-			auto bitmap = GetThumbnail(
-				basicItemInfo.pidlComplete.get(), WTS_EXTRACT | WTS_SCALETOREQUESTEDSIZE);
+	if (!inserted)
+	{
+		// The thumbnail has already been requested (e.g. because the item was prefetched before
+		// being scrolled into view).
+		return;
+	}
 
-			if (!bitmap)
-			{
-				return std::nullopt;
-			}
+	int thumbnailResultID = m_thumbnailResultIDCounter++;
 
-			PostMessage(m_hListView, WM_APP_THUMBNAIL_RESULT_READY, thumbnailResultID, 0);
+	auto basicItemInfo = getBasicItemInfo(internalIndex);
 
+	GetBackgroundTaskScheduler().PostTask(
+		&m_thumbnailResultIds, internalIndex, priority,
+		[this, thumbnailResultID, internalIndex, basicItemInfo,
+			thumbnailSize = m_thumbnailItemSize]() {
 			ThumbnailResult_t result;
+			result.thumbnailResultId = thumbnailResultID;
 			result.itemInternalIndex = internalIndex;
-			result.bitmap = std::move(bitmap);
+			result.bitmap = GetThumbnail(*basicItemInfo, thumbnailSize);
 
-			return result;
+			m_thumbnailResultChannel.Push(std::move(result));
+		},
+		[this, thumbnailResultID, internalIndex]() {
+			OnThumbnailTaskCancelled(thumbnailResultID, internalIndex);
 		});
 
-	m_thumbnailResults.insert({ thumbnailResultID, std::move(result) });
+	m_thumbnailResultIds.insert(thumbnailResultID);
 }
 
-std::optional<int> ShellBrowser::GetCachedThumbnailIndex(const ItemInfo_t &itemInfo)
+void ShellBrowser::OnThumbnailTaskCancelled(int thumbnailResultId, int internalIndex)
 {
-	auto bitmap =
-		GetThumbnail(itemInfo.pidlComplete.get(), WTS_INCACHEONLY | WTS_SCALETOREQUESTEDSIZE);
+	// The item is currently showing its icon. The thumbnail will be requested again once the item
+	// is scrolled back into view.
+	m_thumbnailResultIds.erase(thumbnailResultId);
+	m_pendingThumbnailItems.erase(internalIndex);
+}
 
-	if (!bitmap)
+// Queues thumbnail tasks for the items just beyond the visible range, in the direction the listview
+// was last scrolled, so that their thumbnails are (ideally) ready by the time they're scrolled into
+// view. The tasks are prioritized by distance, in the same way as in
+// UpdateBackgroundTaskPriorities(), so they never delay the thumbnails of visible items.
+void ShellBrowser::PrefetchThumbnails()
+{
+	if (m_folderSettings.viewMode != +ViewMode::Thumbnails || m_folderSettings.showInGroups)
 	{
-		return std::nullopt;
+		return;
 	}
 
-	return GetExtractedThumbnail(bitmap.get());
+	int numItems = ListView_GetItemCount(m_hListView);
+
+	if (numItems == 0)
+	{
+		return;
+	}
+
+	auto [firstVisible, lastVisible] = GetApproximateVisibleItemRange();
+	int numPrefetchItems = (lastVisible - firstVisible + 1) * THUMBNAIL_PREFETCH_PAGES;
+	bool scrolledBackwards = firstVisible < m_thumbnailPrefetchPreviousFirstVisible;
+	m_thumbnailPrefetchPreviousFirstVisible = firstVisible;
+
+	for (int distance = 1; distance <= numPrefetchItems; distance++)
+	{
+		int index = scrolledBackwards ? firstVisible - distance : lastVisible + distance;
+
+		if (index < 0 || index >= numItems)
+		{
+			break;
+		}
+
+		int internalIndex = GetItemInternalIndex(index);
+
+		if (m_fetchedThumbnailItems.contains(internalIndex))
+		{
+			continue;
+		}
+
+		QueueThumbnailTask(internalIndex, distance);
+	}
 }
 
-wil::unique_hbitmap ShellBrowser::GetThumbnail(PIDLIST_ABSOLUTE pidl, WTS_FLAGS flags)
+void ShellBrowser::ClearThumbnailResults()
 {
-	wil::com_ptr_nothrow<IShellItem> shellItem;
-	HRESULT hr = SHCreateItemFromIDList(pidl, IID_PPV_ARGS(&shellItem));
+	CancelThumbnailTasks();
+	ClearThumbnailRequestState();
+}
 
-	if (FAILED(hr))
+// Thumbnails are kept while other views are shown, so this needs to be called whenever an item
+// changes, even if thumbnails view isn't active. The thumbnail will be retrieved again the next
+// time the item is drawn in thumbnails view.
+void ShellBrowser::InvalidateThumbnailForItem(int internalIndex)
+{
+	m_fetchedThumbnailItems.erase(internalIndex);
+	m_pendingThumbnailItems.erase(internalIndex);
+	m_thumbnailSlots.Release(internalIndex);
+}
+
+// Any thumbnails that have already been set are left in place.
+void ShellBrowser::CancelThumbnailTasks()
+{
+	GetBackgroundTaskScheduler().CancelTasks(&m_thumbnailResultIds);
+	m_thumbnailResultIds.clear();
+	m_thumbnailResultChannel.Clear();
+	m_pendingThumbnailItems.clear();
+	m_thumbnailPrefetchPreviousFirstVisible = 0;
+}
+
+// The slots are released as well, since they're assigned by internal index and those indexes are
+// reused once the items are removed.
+void ShellBrowser::ClearThumbnailRequestState()
+{
+	m_fetchedThumbnailItems.clear();
+	m_thumbnailSlots.Clear();
+}
+
+// Returns the item's thumbnail, scaled to fit within the specified size. This is only called on the
+// background threads.
+wil::unique_hbitmap ShellBrowser::GetThumbnail(const BasicItemInfo_t &itemInfo, int size)
+{
+	PerformanceTraceActivity traceActivity(L"ThumbnailTask");
+
+	// Items outside the file system have no modification time that could be used to determine
+	// whether a stored thumbnail is still valid, so they're never stored.
+	std::optional<std::wstring> cacheKey;
+
+	if (itemInfo.isFindDataValid)
+	{
+		std::wstring parsingPath;
+		HRESULT hr = GetDisplayName(itemInfo.pidlComplete.get(), SHGDN_FORPARSING, parsingPath);
+
+		if (SUCCEEDED(hr))
+		{
+			ULARGE_INTEGER lastWriteTime = { itemInfo.wfd.ftLastWriteTime.dwLowDateTime,
+				itemInfo.wfd.ftLastWriteTime.dwHighDateTime };
+			cacheKey = parsingPath + L"|" + std::to_wstring(lastWriteTime.QuadPart);
+		}
+	}
+
+	auto &thumbnailImageCache = GetThumbnailImageCache();
+
+	if (cacheKey)
+	{
+		auto image = thumbnailImageCache.Get(*cacheKey, size);
+
+		if (image)
+		{
+			return CreateBitmapFromImage(*image);
+		}
+	}
+
+	// The thumbnail is always extracted at the largest size, so that the other sizes can be
+	// generated from it later. Thumbnails that are already in the system cache are returned
+	// straight away, without being extracted again. Extracting the thumbnail of a cloud
+	// placeholder would cause the file to be downloaded, so only the system cache is used in that
+	// case.
+	WTS_FLAGS flags = itemInfo.canReadContents() ? WTS_EXTRACT : WTS_INCACHEONLY;
+	auto image = ExtractThumbnail(
+		itemInfo.pidlComplete.get(), THUMBNAIL_EXTRACT_SIZE, flags | WTS_SCALETOREQUESTEDSIZE);
+
+	if (!image)
 	{
 		return nullptr;
 	}
 
-	wil::com_ptr_nothrow<IThumbnailCache> thumbnailCache;
-	hr = CoCreateInstance(
-		CLSID_LocalThumbnailCache, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&thumbnailCache));
+	if (!cacheKey)
+	{
+		return CreateBitmapFromImage(TieredThumbnailCache::ScaleImage(*image, size));
+	}
+
+	thumbnailImageCache.Insert(*cacheKey, std::move(*image));
 
-	if (FAILED(hr))
+	auto scaledImage = thumbnailImageCache.Get(*cacheKey, size);
+
+	if (!scaledImage)
 	{
 		return nullptr;
 	}
 
+	return CreateBitmapFromImage(*scaledImage);
+}
+
+// This uses the thumbnail cache instance belonging to the current thread, unless extensions are
+// being isolated, in which case the thumbnail is extracted by a host process.
+std::optional<TieredThumbnailCache::Image> ShellBrowser::ExtractThumbnail(
+	PIDLIST_ABSOLUTE pidl, UINT size, WTS_FLAGS flags)
+{
+	auto &shellExtensionHostPool = ShellExtensionHostPool::GetInstance();
+
+	if (shellExtensionHostPool.IsEnabled())
+	{
+		return shellExtensionHostPool.ExtractThumbnail(pidl, size, flags);
+	}
+
+	wil::com_ptr_nothrow<IShellItem> shellItem;
+	HRESULT hr = SHCreateItemFromIDList(pidl, IID_PPV_ARGS(&shellItem));
+
+	if (FAILED(hr))
+	{
+		return std::nullopt;
+	}
+
+	if (!g_threadThumbnailCache)
+	{
+		hr = CoCreateInstance(CLSID_LocalThumbnailCache, nullptr, CLSCTX_INPROC_SERVER,
+			IID_PPV_ARGS(&g_threadThumbnailCache));
+
+		if (FAILED(hr))
+		{
+			return std::nullopt;
+		}
+	}
+
 	wil::com_ptr_nothrow<ISharedBitmap> sharedBitmap;
-	hr = thumbnailCache->GetThumbnail(
-		shellItem.get(), THUMBNAIL_ITEM_WIDTH, flags, &sharedBitmap, nullptr, nullptr);
+	hr = g_threadThumbnailCache->GetThumbnail(
+		shellItem.get(), size, flags, &sharedBitmap, nullptr, nullptr);
 
 	if (FAILED(hr))
 	{
-		return nullptr;
+		return std::nullopt;
 	}
 
 	HBITMAP bitmap;
@@ -156,68 +449,80 @@ wil::unique_hbitmap ShellBrowser::GetThumbnail(PIDLIST_ABSOLUTE pidl, WTS_FLAGS
 
 	if (FAILED(hr))
 	{
-		return nullptr;
+		return std::nullopt;
 	}
 
-	// Note that the bitmap is copied here, since it's owned by the ISharedBitmap instance. As soon
-	// as that instance is destroyed, the bitmap will be destroyed.
-	return wil::unique_hbitmap(
-		reinterpret_cast<HBITMAP>(CopyImage(bitmap, IMAGE_BITMAP, 0, 0, LR_DEFAULTCOLOR)));
+	// Note that the pixels are copied here, since the bitmap is owned by the ISharedBitmap
+	// instance. As soon as that instance is destroyed, the bitmap will be destroyed.
+	return GetImageFromBitmap(bitmap);
+}
+
+// The thread's thumbnail cache instance needs to be released before COM is uninitialized on the
+// thread.
+void ShellBrowser::ReleaseThreadThumbnailCache()
+{
+	g_threadThumbnailCache.reset();
 }
 
-void ShellBrowser::ProcessThumbnailResult(int thumbnailResultId)
+void ShellBrowser::ProcessThumbnailResults()
 {
-	auto itr = m_thumbnailResults.find(thumbnailResultId);
+	bool resultsRemaining = m_thumbnailResultChannel.ProcessResults(RESULT_BATCH_TIME_BUDGET,
+		[this](const ThumbnailResult_t &result) { ProcessThumbnailResult(result); });
 
-	if (itr == m_thumbnailResults.end())
+	if (resultsRemaining)
 	{
-		return;
+		// As with column results, the remaining results are processed once any pending input has
+		// been handled.
+		SetTimer(m_hListView, PROCESS_THUMBNAIL_RESULTS_TIMER_ID, USER_TIMER_MINIMUM, nullptr);
 	}
+}
 
-	if (m_folderSettings.viewMode != +ViewMode::Thumbnails)
+void ShellBrowser::ProcessThumbnailResult(const ThumbnailResult_t &result)
+{
+	if (!m_thumbnailResultIds.contains(result.thumbnailResultId))
 	{
 		return;
 	}
 
-	auto result = itr->second.get();
+	m_thumbnailResultIds.erase(result.thumbnailResultId);
+	m_numThumbnailResultsProcessed++;
 
-	if (!result)
+	// If the thumbnail couldn't be retrieved, the item remains pending, so that it isn't
+	// requested again.
+	if (m_folderSettings.viewMode != +ViewMode::Thumbnails || !result.bitmap)
 	{
-		// Thumbnail lookup failed.
 		return;
 	}
 
-	int imageIndex = GetExtractedThumbnail(result->bitmap.get());
+	m_pendingThumbnailItems.erase(result.itemInternalIndex);
+	m_fetchedThumbnailItems.insert(result.itemInternalIndex);
+
+	GetExtractedThumbnail(result.itemInternalIndex, result.bitmap.get());
 
-	auto index = LocateItemByInternalIndex(result->itemInternalIndex);
+	auto index = LocateItemByInternalIndex(result.itemInternalIndex);
 
 	if (!index)
 	{
 		return;
 	}
 
-	LVITEM lvItem;
-	lvItem.mask = LVIF_IMAGE;
-	lvItem.iItem = *index;
-	lvItem.iSubItem = 0;
-	lvItem.iImage = imageIndex;
-	ListView_SetItem(m_hListView, &lvItem);
+	// The thumbnail is drawn into the item's slot, which the item will pick up when it's redrawn.
+	ListView_RedrawItems(m_hListView, *index, *index);
 }
 
 /* Draws a thumbnail based on an items icon. */
-int ShellBrowser::GetIconThumbnail(int iInternalIndex) const
+int ShellBrowser::GetIconThumbnail(int iInternalIndex)
 {
 	return GetThumbnailInternal(THUMBNAIL_TYPE_ICON, iInternalIndex, nullptr);
 }
 
 /* Draws an items extracted thumbnail. */
-int ShellBrowser::GetExtractedThumbnail(HBITMAP hThumbnailBitmap) const
+int ShellBrowser::GetExtractedThumbnail(int iInternalIndex, HBITMAP hThumbnailBitmap)
 {
-	return GetThumbnailInternal(THUMBNAIL_TYPE_EXTRACTED, 0, hThumbnailBitmap);
+	return GetThumbnailInternal(THUMBNAIL_TYPE_EXTRACTED, iInternalIndex, hThumbnailBitmap);
 }
 
-int ShellBrowser::GetThumbnailInternal(
-	int iType, int iInternalIndex, HBITMAP hThumbnailBitmap) const
+int ShellBrowser::GetThumbnailInternal(int iType, int iInternalIndex, HBITMAP hThumbnailBitmap)
 {
 	HDC hdc;
 	HDC hdcBacking;
@@ -225,20 +530,27 @@ int ShellBrowser::GetThumbnailInternal(
 	HBITMAP hBackingBitmapOld;
 	HIMAGELIST himl;
 	HBRUSH hbr;
-	int iImage;
+
+	auto slot = AllocateThumbnailSlot(iInternalIndex);
+
+	if (!slot)
+	{
+		return -1;
+	}
 
 	hdc = GetDC(m_hListView);
 	hdcBacking = CreateCompatibleDC(hdc);
 
 	/* Backing bitmap. */
-	hBackingBitmap = CreateCompatibleBitmap(hdc, THUMBNAIL_ITEM_WIDTH, THUMBNAIL_ITEM_HEIGHT);
+	hBackingBitmap = CreateCompatibleBitmap(hdc, m_thumbnailItemSize, m_thumbnailItemSize);
 	hBackingBitmapOld = (HBITMAP) SelectObject(hdcBacking, hBackingBitmap);
 
 	/* Set the background of the new bitmap to be the same color as the
 	background in the listview. */
 	hbr = CreateSolidBrush(ListView_GetBkColor(m_hListView));
-	RECT rect = { 0, 0, THUMBNAIL_ITEM_WIDTH, THUMBNAIL_ITEM_HEIGHT };
+	RECT rect = { 0, 0, m_thumbnailItemSize, m_thumbnailItemSize };
 	FillRect(hdcBacking, &rect, hbr);
+	DeleteObject(hbr);
 
 	if (iType == THUMBNAIL_TYPE_ICON)
 	{
@@ -257,14 +569,13 @@ int ShellBrowser::GetThumbnailInternal(
 	DeleteDC(hdcBacking);
 	ReleaseDC(m_hListView, hdc);
 
-	/* Add the new bitmap to the imagelist. */
 	himl = ListView_GetImageList(m_hListView, LVSIL_NORMAL);
-	iImage = ImageList_Add(himl, hBackingBitmap, nullptr);
+	ImageList_Replace(himl, *slot, hBackingBitmap, nullptr);
 
 	/* Now delete the backing bitmap. */
 	DeleteObject(hBackingBitmap);
 
-	return iImage;
+	return *slot;
 }
 
 void ShellBrowser::DrawIconThumbnailInternal(HDC hdcBacking, int iInternalIndex) const
@@ -274,15 +585,15 @@ void ShellBrowser::DrawIconThumbnailInternal(HDC hdcBacking, int iInternalIndex)
 	int iIconWidth;
 	int iIconHeight;
 
-	SHGetFileInfo((LPCTSTR) m_itemInfoMap.at(iInternalIndex).pidlComplete.get(), 0, &shfi,
+	SHGetFileInfo((LPCTSTR) m_itemInfoMap.Get(iInternalIndex).pidlComplete.get(), 0, &shfi,
 		sizeof(shfi), SHGFI_PIDL | SHGFI_SYSICONINDEX);
 
 	hIcon = ImageList_GetIcon(m_hListViewImageList, shfi.iIcon, ILD_NORMAL);
 
 	ImageList_GetIconSize(m_hListViewImageList, &iIconWidth, &iIconHeight);
 
-	DrawIconEx(hdcBacking, (THUMBNAIL_ITEM_WIDTH - iIconWidth) / 2,
-		(THUMBNAIL_ITEM_HEIGHT - iIconHeight) / 2, hIcon, 0, 0, 0, nullptr, DI_NORMAL);
+	DrawIconEx(hdcBacking, (m_thumbnailItemSize - iIconWidth) / 2,
+		(m_thumbnailItemSize - iIconHeight) / 2, hIcon, 0, 0, 0, nullptr, DI_NORMAL);
 	DestroyIcon(hIcon);
 }
 
@@ -300,8 +611,8 @@ void ShellBrowser::DrawThumbnailInternal(HDC hdcBacking, HBITMAP hThumbnailBitma
 
 	/* Now, draw the thumbnail bitmap (in its centered position)
 	directly on top of the new bitmap. */
-	BitBlt(hdcBacking, (THUMBNAIL_ITEM_WIDTH - bm.bmWidth) / 2,
-		(THUMBNAIL_ITEM_HEIGHT - bm.bmHeight) / 2, THUMBNAIL_ITEM_WIDTH, THUMBNAIL_ITEM_HEIGHT,
+	BitBlt(hdcBacking, (m_thumbnailItemSize - bm.bmWidth) / 2,
+		(m_thumbnailItemSize - bm.bmHeight) / 2, m_thumbnailItemSize, m_thumbnailItemSize,
 		hdcThumbnail, 0, 0, SRCCOPY);
 
 	SelectObject(hdcThumbnail, hThumbnailBitmapOld);
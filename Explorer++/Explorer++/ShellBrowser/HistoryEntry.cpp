@@ -11,7 +11,7 @@ int HistoryEntry::idCounter = 0;
 HistoryEntry::HistoryEntry(
 	PCIDLIST_ABSOLUTE pidl, std::wstring_view displayName, std::optional<int> systemIconIndex) :
 	m_id(idCounter++),
-	m_pidl(ILCloneFull(pidl)),
+	m_pidl(pidl),
 	m_displayName(displayName),
 	m_systemIconIndex(systemIconIndex)
 {
@@ -19,7 +19,7 @@ HistoryEntry::HistoryEntry(
 
 HistoryEntry::HistoryEntry(const PreservedHistoryEntry &preservedHistoryEntry) :
 	m_id(idCounter++),
-	m_pidl(ILCloneFull(preservedHistoryEntry.pidl.get())),
+	m_pidl(preservedHistoryEntry.GetPidl()),
 	m_displayName(preservedHistoryEntry.displayName),
 	m_systemIconIndex(preservedHistoryEntry.systemIconIndex)
 {
@@ -30,9 +30,9 @@ int HistoryEntry::GetId() const
 	return m_id;
 }
 
-unique_pidl_absolute HistoryEntry::GetPidl() const
+SharedPidl HistoryEntry::GetPidl() const
 {
-	return unique_pidl_absolute(ILCloneFull(m_pidl.get()));
+	return m_pidl;
 }
 
 std::wstring HistoryEntry::GetDisplayName() const
@@ -47,7 +47,14 @@ std::optional<std::wstring> HistoryEntry::GetFullPathForDisplay() const
 
 void HistoryEntry::SetFullPathForDisplay(const std::wstring &fullPathForDisplay)
 {
+	if (fullPathForDisplay == m_fullPathForDisplay)
+	{
+		return;
+	}
+
 	m_fullPathForDisplay = fullPathForDisplay;
+
+	historyEntryUpdatedSignal.m_signal(*this, PropertyType::FullPathForDisplay);
 }
 
 std::optional<int> HistoryEntry::GetSystemIconIndex() const
@@ -67,12 +74,12 @@ void HistoryEntry::SetSystemIconIndex(int iconIndex)
 	historyEntryUpdatedSignal.m_signal(*this, PropertyType::SystemIconIndex);
 }
 
-std::vector<unique_pidl_absolute> HistoryEntry::GetSelectedItems() const
+const PackedChildPidls &HistoryEntry::GetSelectedItems() const
 {
-	return DeepCopyPidls(m_selectedItems);
+	return m_selectedItems;
 }
 
-void HistoryEntry::SetSelectedItems(const std::vector<PCIDLIST_ABSOLUTE> &pidls)
+void HistoryEntry::SetSelectedItems(const std::vector<PCITEMID_CHILD> &pidls)
 {
-	m_selectedItems = DeepCopyPidls(pidls);
+	m_selectedItems = PackedChildPidls(pidls);
 }
\ No newline at end of file
@@ -6,6 +6,8 @@
 
 #include "SignalWrapper.h"
 #include "../Helper/Macros.h"
+#include "../Helper/PackedChildPidls.h"
+#include "../Helper/SharedPidl.h"
 #include "../Helper/ShellHelper.h"
 #include <optional>
 #include <vector>
@@ -17,7 +19,8 @@ class HistoryEntry
 public:
 	enum class PropertyType
 	{
-		SystemIconIndex
+		SystemIconIndex,
+		FullPathForDisplay
 	};
 
 	HistoryEntry(PCIDLIST_ABSOLUTE pidl, std::wstring_view displayName,
@@ -25,14 +28,17 @@ public:
 	HistoryEntry(const PreservedHistoryEntry &preservedHistoryEntry);
 
 	int GetId() const;
-	unique_pidl_absolute GetPidl() const;
+	// The PIDL is shared, rather than copied, so this is cheap to call.
+	SharedPidl GetPidl() const;
 	std::wstring GetDisplayName() const;
 	std::optional<std::wstring> GetFullPathForDisplay() const;
 	void SetFullPathForDisplay(const std::wstring &fullPathForDisplay);
 	std::optional<int> GetSystemIconIndex() const;
 	void SetSystemIconIndex(int iconIndex);
-	std::vector<unique_pidl_absolute> GetSelectedItems() const;
-	void SetSelectedItems(const std::vector<PCIDLIST_ABSOLUTE> &pidls);
+
+	// The selected items are children of the folder the entry refers to.
+	const PackedChildPidls &GetSelectedItems() const;
+	void SetSelectedItems(const std::vector<PCITEMID_CHILD> &pidls);
 
 	SignalWrapper<HistoryEntry, void(const HistoryEntry &entry, PropertyType propertyType)>
 		historyEntryUpdatedSignal;
@@ -43,9 +49,12 @@ private:
 	static int idCounter;
 	const int m_id;
 
-	unique_pidl_absolute m_pidl;
+	const SharedPidl m_pidl;
 	std::wstring m_displayName;
 	std::optional<std::wstring> m_fullPathForDisplay;
 	std::optional<int> m_systemIconIndex;
-	std::vector<unique_pidl_absolute> m_selectedItems;
+
+	// There can be a very large number of selected items, so they're stored in a packed form,
+	// rather than as individual PIDLs.
+	PackedChildPidls m_selectedItems;
 };
\ No newline at end of file
@@ -4,9 +4,11 @@
 
 #pragma once
 
+#include "../Helper/Helper.h"
 #include "../Helper/Macros.h"
 #include "../Helper/ShellHelper.h"
 #include <wil/resource.h>
+#include <memory>
 
 struct BasicItemInfo_t
 {
@@ -26,6 +28,9 @@ struct BasicItemInfo_t
 		isFindDataValid = other.isFindDataValid;
 		StringCchCopy(szDisplayName, SIZEOF_ARRAY(szDisplayName), other.szDisplayName);
 		isRoot = other.isRoot;
+		parsingPath = other.parsingPath;
+		allowCloudHydration = other.allowCloudHydration;
+		relativeFolder = other.relativeFolder;
 	}
 
 	unique_pidl_absolute pidlComplete;
@@ -35,8 +40,33 @@ struct BasicItemInfo_t
 	TCHAR szDisplayName[MAX_PATH];
 	bool isRoot;
 
+	// The parsing path is retrieved once, when the item is enumerated. It's
+	// never modified afterwards, so copies of this structure (including those
+	// handed to background threads) can safely share it.
+	std::shared_ptr<const std::wstring> parsingPath;
+
+	// Copied from the tab the item belongs to. Unless set, the contents of cloud placeholders are
+	// never read, so that they aren't downloaded simply by being displayed.
+	bool allowCloudHydration;
+
+	// In flat view, the folder that contains the item, relative to the folder being viewed. Empty
+	// for items directly within that folder (and for all items outside of flat view).
+	std::wstring relativeFolder;
+
+	// Returns false if reading the item's contents (e.g. to extract a thumbnail, or to retrieve
+	// its version information) would cause it to be downloaded, when that's not allowed.
+	bool canReadContents() const
+	{
+		return allowCloudHydration || !isFindDataValid || !IsCloudPlaceholder(wfd.dwFileAttributes);
+	}
+
 	std::wstring getFullPath() const
 	{
+		if (parsingPath)
+		{
+			return *parsingPath;
+		}
+
 		std::wstring fullPath;
 		GetDisplayName(pidlComplete.get(), SHGDN_FORPARSING, fullPath);
 		return fullPath;
@@ -14,13 +14,18 @@
 #include "ShellNavigationController.h"
 #include "../Helper/CachedIcons.h"
 #include "../Helper/DragDropHelper.h"
+#include "../Helper/ExtensionIconCache.h"
+#include "../Helper/FolderSizeCache.h"
 #include "../Helper/Helper.h"
 #include "../Helper/IconFetcher.h"
 #include "../Helper/ListViewHelper.h"
+#include "../Helper/PriorityTaskScheduler.h"
 #include "../Helper/ShellHelper.h"
+#include "../Helper/WindowHelper.h"
 #include "../Helper/iDropSource.h"
 #include <boost/format.hpp>
 #include <wil/common.h>
+#include <execution>
 
 const std::vector<ColumnType> COMMON_REAL_FOLDER_COLUMNS = { ColumnType::Name, ColumnType::Type,
 	ColumnType::Size, ColumnType::DateModified, ColumnType::Authors, ColumnType::Title };
@@ -46,7 +51,7 @@ const std::vector<ColumnType> COMMON_RECYCLE_BIN_COLUMNS = { ColumnType::Name,
 	ColumnType::OriginalLocation, ColumnType::DateDeleted, ColumnType::Size, ColumnType::Type,
 	ColumnType::DateModified };
 
-std::vector<ColumnType> GetColumnHeaderMenuList(const std::wstring &directory);
+std::vector<ColumnType> GetColumnHeaderMenuList(FolderType folderType);
 
 LRESULT CALLBACK ShellBrowser::ListViewProcStub(
 	HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam, UINT_PTR uIdSubclass, DWORD_PTR dwRefData)
@@ -107,6 +112,24 @@ LRESULT CALLBACK ShellBrowser::ListViewProc(HWND hwnd, UINT uMsg, WPARAM wParam,
 		{
 			OnProcessShellChangeNotifications();
 		}
+		else if (wParam == INFO_TIP_PREFETCH_TIMER_ID)
+		{
+			OnInfoTipPrefetchTimer();
+		}
+		else if (wParam == PROCESS_COLUMN_RESULTS_TIMER_ID)
+		{
+			KillTimer(m_hListView, PROCESS_COLUMN_RESULTS_TIMER_ID);
+			ProcessColumnResults();
+		}
+		else if (wParam == PROCESS_THUMBNAIL_RESULTS_TIMER_ID)
+		{
+			KillTimer(m_hListView, PROCESS_THUMBNAIL_RESULTS_TIMER_ID);
+			ProcessThumbnailResults();
+		}
+		else if (wParam == PENDING_NAVIGATION_TIMEOUT_TIMER_ID)
+		{
+			OnPendingNavigationTimeout();
+		}
 		break;
 
 	case WM_NOTIFY:
@@ -132,16 +155,63 @@ LRESULT CALLBACK ShellBrowser::ListViewProc(HWND hwnd, UINT uMsg, WPARAM wParam,
 				}
 			}
 			break;
+
+			// The listview would otherwise auto-size the column itself, which can take a long time
+			// in a large folder.
+			case HDN_DIVIDERDBLCLICK:
+				AutoSizeColumn(reinterpret_cast<NMHEADER *>(lParam)->iItem);
+				return 0;
 			}
 		}
 		break;
 
-	case WM_APP_COLUMN_RESULT_READY:
-		ProcessColumnResult(static_cast<int>(wParam));
+	case WM_CHAR:
+		if (OnListViewChar(static_cast<wchar_t>(wParam)))
+		{
+			return 0;
+		}
+		break;
+
+	case WM_ERASEBKGND:
+		// The grid renderer draws the entire update region itself.
+		if (ShouldUseGridRenderer())
+		{
+			return TRUE;
+		}
+		break;
+
+	case WM_PAINT:
+	{
+		bool firstPaint = m_navigationTiming.completed && !m_navigationTiming.painted;
+		LRESULT result = 0;
+
+		if (ShouldUseGridRenderer())
+		{
+			OnGridViewPaint();
+		}
+		else
+		{
+			result = DefSubclassProc(hwnd, uMsg, wParam, lParam);
+		}
+
+		if (firstPaint)
+		{
+			OnListViewPainted();
+		}
+
+		return result;
+	}
+
+	case WM_DPICHANGED_AFTERPARENT:
+		OnThumbnailsDpiChanged();
+		break;
+
+	case WM_APP_COLUMN_RESULTS_READY:
+		ProcessColumnResults();
 		break;
 
-	case WM_APP_THUMBNAIL_RESULT_READY:
-		ProcessThumbnailResult(static_cast<int>(wParam));
+	case WM_APP_THUMBNAIL_RESULTS_READY:
+		ProcessThumbnailResults();
 		break;
 
 	case WM_APP_INFO_TIP_READY:
@@ -151,6 +221,46 @@ LRESULT CALLBACK ShellBrowser::ListViewProc(HWND hwnd, UINT uMsg, WPARAM wParam,
 	case WM_APP_SHELL_NOTIFY:
 		OnShellNotify(wParam, lParam);
 		break;
+
+	case WM_APP_ENUMERATION_RESULTS_READY:
+		ProcessEnumerationResults(static_cast<int>(wParam));
+		break;
+
+	case WM_APP_FILTER_RESULTS_READY:
+		ProcessFilterResults(static_cast<int>(wParam));
+		break;
+
+	case WM_APP_FOLDER_SNAPSHOT_VALIDATED:
+		OnFolderSnapshotValidated(static_cast<int>(wParam), lParam != 0);
+		break;
+
+	case WM_APP_SELECTION_CHANGED:
+		OnSelectionChangedNotification();
+		break;
+
+	case WM_APP_ACCOUNT_NAMES_RESOLVED:
+		OnAccountNamesResolved();
+		break;
+
+	case WM_APP_SORT_KEYS_READY:
+		ProcessSortKeyResult(static_cast<int>(wParam));
+		break;
+
+	case WM_APP_HISTORY_ENTRY_PATH_READY:
+		ProcessHistoryEntryPathResult(static_cast<int>(wParam));
+		break;
+
+	case WM_APP_SELECTION_ATTRIBUTES_READY:
+		ProcessSelectionAttributesResult(static_cast<int>(wParam));
+		break;
+
+	case WM_APP_NAVIGATION_BOUND:
+		OnPendingNavigationBound(static_cast<int>(wParam));
+		break;
+
+	case WM_APP_FOLDER_REFRESH_READY:
+		OnFolderRefreshReady(static_cast<int>(wParam));
+		break;
 	}
 
 	return DefSubclassProc(hwnd, uMsg, wParam, lParam);
@@ -190,6 +300,11 @@ LRESULT CALLBACK ShellBrowser::ListViewParentProc(
 				OnListViewItemInserted(reinterpret_cast<NMLISTVIEW *>(lParam));
 				break;
 
+			case LVN_DELETEITEM:
+			case LVN_DELETEALLITEMS:
+				m_itemPositionIndex.Invalidate();
+				break;
+
 			case LVN_ITEMCHANGED:
 				OnListViewItemChanged(reinterpret_cast<NMLISTVIEW *>(lParam));
 				break;
@@ -201,6 +316,21 @@ LRESULT CALLBACK ShellBrowser::ListViewParentProc(
 			case LVN_COLUMNCLICK:
 				ColumnClicked(reinterpret_cast<NMLISTVIEW *>(lParam)->iSubItem);
 				break;
+
+			case LVN_ENDSCROLL:
+				OnListViewEndScroll();
+				break;
+
+			case LVN_ODFINDITEM:
+				return OnOwnerDataFindItem(reinterpret_cast<NMLVFINDITEM *>(lParam));
+
+			case LVN_ODSTATECHANGED:
+				if (!m_bulkSelectionChangeInProgress)
+				{
+					RecalculateSelectionInfo();
+					NotifySelectionChanged();
+				}
+				break;
 			}
 		}
 		else if (reinterpret_cast<LPNMHDR>(lParam)->hwndFrom == ListView_GetHeader(m_hListView))
@@ -318,6 +448,13 @@ void ShellBrowser::OnMouseMove(HWND hwnd, int x, int y, UINT keyFlags)
 	UNREFERENCED_PARAMETER(x);
 	UNREFERENCED_PARAMETER(y);
 
+	if (m_config->showInfoTips)
+	{
+		// The timer is restarted each time the mouse moves, so it only fires once the mouse has
+		// come to rest.
+		SetTimer(m_hListView, INFO_TIP_PREFETCH_TIMER_ID, INFO_TIP_PREFETCH_DELAY, nullptr);
+	}
+
 	if (m_performingDrag || !m_rightClickDragAllowed)
 	{
 		return;
@@ -348,13 +485,20 @@ void ShellBrowser::OnListViewGetDisplayInfo(LPARAM lParam)
 	pnmv = (NMLVDISPINFO *) lParam;
 	plvItem = &pnmv->item;
 
+	if (IsOwnerDataListViewActive())
+	{
+		OnOwnerDataGetDisplayInfo(plvItem);
+		return;
+	}
+
 	int internalIndex = static_cast<int>(plvItem->lParam);
 
-	/* Construct an image here using the items
+	/* If the item doesn't have a thumbnail slot yet,
+	construct an image here using the items
 	actual icon. This image will be shown initially.
 	If the item also has a thumbnail image, this
-	will be found later, and will overwrite any
-	image settings made here.
+	will be found later, and will be drawn over
+	the top of the icon in the same slot.
 	Note that the initial icon image MUST be drawn
 	first, or else it may be possible for the
 	thumbnail to be drawn before the initial
@@ -362,36 +506,65 @@ void ShellBrowser::OnListViewGetDisplayInfo(LPARAM lParam)
 	if (m_folderSettings.viewMode == +ViewMode::Thumbnails
 		&& (plvItem->mask & LVIF_IMAGE) == LVIF_IMAGE)
 	{
-		const ItemInfo_t &itemInfo = m_itemInfoMap.at(internalIndex);
-		auto cachedThumbnailIndex = GetCachedThumbnailIndex(itemInfo);
+		// The slot isn't stored with the item, so that nothing has to be reset when leaving
+		// thumbnails view and so that thumbnails kept from a previous visit to the view are
+		// picked up again.
+		auto existingSlot = m_thumbnailSlots.GetSlot(internalIndex);
 
-		if (cachedThumbnailIndex)
+		if (existingSlot)
 		{
-			plvItem->iImage = *cachedThumbnailIndex;
+			// Marks the slot as the most recently used.
+			AllocateThumbnailSlot(internalIndex);
+			plvItem->iImage = *existingSlot;
 		}
 		else
 		{
 			plvItem->iImage = GetIconThumbnail(internalIndex);
 		}
 
-		plvItem->mask |= LVIF_DI_SETITEM;
-
-		QueueThumbnailTask(internalIndex);
+		if (!m_fetchedThumbnailItems.contains(internalIndex))
+		{
+			// Even looking up a thumbnail that's already cached can take a while, so that's left
+			// to the background task as well.
+			QueueThumbnailTask(internalIndex, 0);
+		}
 
 		return;
 	}
 
+	if (m_folderSettings.viewMode == +ViewMode::Tiles)
+	{
+		if ((plvItem->mask & LVIF_COLUMNS) == LVIF_COLUMNS)
+		{
+			GetTileViewColumns(plvItem);
+		}
+
+		if ((plvItem->mask & LVIF_TEXT) == LVIF_TEXT && plvItem->iSubItem > 0)
+		{
+			GetTileViewItemText(plvItem);
+		}
+	}
+
 	if (m_folderSettings.viewMode == +ViewMode::Details && (plvItem->mask & LVIF_TEXT) == LVIF_TEXT)
 	{
 		auto columnType = GetColumnTypeByIndex(plvItem->iSubItem);
 		assert(columnType);
 
-		QueueColumnTask(internalIndex, *columnType);
+		const std::wstring *cachedText = GetCachedColumnText(internalIndex, *columnType);
+
+		if (cachedText)
+		{
+			StringCchCopy(plvItem->pszText, plvItem->cchTextMax, cachedText->c_str());
+		}
+		else
+		{
+			QueueColumnTask(internalIndex, *columnType);
+		}
 	}
 
 	if ((plvItem->mask & LVIF_IMAGE) == LVIF_IMAGE)
 	{
-		const ItemInfo_t &itemInfo = m_itemInfoMap.at(internalIndex);
+		const ItemInfo_t &itemInfo = m_itemInfoMap.Get(internalIndex);
 		auto cachedIconIndex = GetCachedIconIndex(itemInfo);
 
 		if (cachedIconIndex)
@@ -415,15 +588,7 @@ void ShellBrowser::OnListViewGetDisplayInfo(LPARAM lParam)
 		}
 		else
 		{
-			if ((itemInfo.wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-				== FILE_ATTRIBUTE_DIRECTORY)
-			{
-				plvItem->iImage = m_iFolderIcon;
-			}
-			else
-			{
-				plvItem->iImage = m_iFileIcon;
-			}
+			plvItem->iImage = GetDefaultIconIndex(itemInfo);
 		}
 
 		m_iconFetcher->QueueIconTask(
@@ -437,18 +602,41 @@ void ShellBrowser::OnListViewGetDisplayInfo(LPARAM lParam)
 
 std::optional<int> ShellBrowser::GetCachedIconIndex(const ItemInfo_t &itemInfo)
 {
-	auto cachedItr = m_cachedIcons->findByPath(itemInfo.parsingName);
+	return m_cachedIcons->findByPath(itemInfo.parsingName);
+}
+
+// Returns the icon that's shown until the item's icon has been retrieved.
+int ShellBrowser::GetDefaultIconIndex(const ItemInfo_t &itemInfo)
+{
+	if (WI_IsFlagSet(itemInfo.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+	{
+		return m_iFolderIcon;
+	}
 
-	if (cachedItr == m_cachedIcons->end())
+	// Most files share the icon of their type, in which case the icon is already known and can be
+	// shown straight away.
+	if (!InVirtualFolder())
 	{
-		return std::nullopt;
+		auto iconIndex =
+			GetExtensionIconCache().GetIconIndex(PathFindExtension(itemInfo.wfd.cFileName));
+
+		if (iconIndex)
+		{
+			return *iconIndex;
+		}
 	}
 
-	return cachedItr->iconIndex;
+	return m_iFileIcon;
 }
 
 void ShellBrowser::ProcessIconResult(int internalIndex, int iconIndex)
 {
+	if (IsOwnerDataListViewActive())
+	{
+		ProcessOwnerDataIconResult(internalIndex, iconIndex);
+		return;
+	}
+
 	auto index = LocateItemByInternalIndex(internalIndex);
 
 	if (!index)
@@ -470,8 +658,27 @@ LRESULT ShellBrowser::OnListViewGetInfoTip(NMLVGETINFOTIP *getInfoTip)
 {
 	if (m_config->showInfoTips)
 	{
+		UpdateInfoTipCacheSettings();
+
 		int internalIndex = GetItemInternalIndex(getInfoTip->iItem);
-		QueueInfoTipTask(internalIndex, getInfoTip->pszText);
+
+		// If the item name is truncated in the listview, pszText will contain that value.
+		// Therefore, it's important that the rest of the infotip is concatenated onto that value
+		// if it's there.
+		std::wstring existingInfoTip = getInfoTip->pszText;
+		auto cachedItr = m_infoTipCache.find(internalIndex);
+
+		if (cachedItr != m_infoTipCache.end())
+		{
+			std::wstring infoTip = existingInfoTip.empty()
+				? cachedItr->second
+				: existingInfoTip + L"\n" + cachedItr->second;
+			StringCchCopy(getInfoTip->pszText, getInfoTip->cchTextMax, infoTip.c_str());
+			return 0;
+		}
+
+		QueueInfoTipTask(internalIndex);
+		m_pendingInfoTips[internalIndex] = existingInfoTip;
 	}
 
 	StringCchCopy(getInfoTip->pszText, getInfoTip->cchTextMax, EMPTY_STRING);
@@ -479,57 +686,102 @@ LRESULT ShellBrowser::OnListViewGetInfoTip(NMLVGETINFOTIP *getInfoTip)
 	return 0;
 }
 
-void ShellBrowser::QueueInfoTipTask(int internalIndex, const std::wstring &existingInfoTip)
+// The info tip for an item is retrieved as soon as the mouse comes to rest over it, so that the
+// tip can be shown immediately once the listview requests it.
+void ShellBrowser::OnInfoTipPrefetchTimer()
 {
-	int infoTipResultId = m_infoTipResultIDCounter++;
+	KillTimer(m_hListView, INFO_TIP_PREFETCH_TIMER_ID);
 
-	BasicItemInfo_t basicItemInfo = getBasicItemInfo(internalIndex);
-	Config configCopy = *m_config;
-	bool virtualFolder = InVirtualFolder();
+	if (!m_config->showInfoTips)
+	{
+		return;
+	}
+
+	LVHITTESTINFO hitTestInfo = {};
+	GetCursorPos(&hitTestInfo.pt);
+	ScreenToClient(m_hListView, &hitTestInfo.pt);
+	int item = ListView_HitTest(m_hListView, &hitTestInfo);
+
+	if (item == -1 || WI_IsFlagClear(hitTestInfo.flags, LVHT_ONITEM))
+	{
+		return;
+	}
 
-	auto result =
-		m_infoTipsThreadPool.push([this, infoTipResultId, internalIndex, basicItemInfo, configCopy,
-									  virtualFolder, existingInfoTip](int id) {
-			UNREFERENCED_PARAMETER(id);
+	UpdateInfoTipCacheSettings();
 
-			auto result = GetInfoTipAsync(m_hListView, infoTipResultId, internalIndex,
-				basicItemInfo, configCopy, m_hResourceModule, virtualFolder);
+	int internalIndex = GetItemInternalIndex(item);
 
-			// If the item name is truncated in the listview,
-			// existingInfoTip will contain that value. Therefore, it's
-			// important that the rest of the infotip is concatenated onto
-			// that value if it's there.
-			if (result && !existingInfoTip.empty())
-			{
-				result->infoTip = existingInfoTip + L"\n" + result->infoTip;
-			}
+	if (m_infoTipCache.contains(internalIndex))
+	{
+		return;
+	}
+
+	QueueInfoTipTask(internalIndex);
+}
+
+// Only a single task is queued for an item at a time, regardless of how many times its info tip
+// is requested before the task has finished.
+void ShellBrowser::QueueInfoTipTask(int internalIndex)
+{
+	if (m_pendingInfoTips.contains(internalIndex))
+	{
+		return;
+	}
 
-			return result;
+	int infoTipResultId = m_infoTipResultIDCounter++;
+
+	auto basicItemInfo = getBasicItemInfo(internalIndex);
+	bool virtualFolder = InVirtualFolder();
+
+	auto result = GetBackgroundTaskScheduler().PushTask(&m_infoTipResults, std::nullopt,
+		INFO_TIP_TASK_PRIORITY,
+		[this, infoTipResultId, internalIndex, basicItemInfo, infoTipType = m_config->infoTipType,
+			settings = GetTaskSettings(), virtualFolder]() {
+			return GetInfoTipAsync(m_hListView, infoTipResultId, internalIndex, *basicItemInfo,
+				infoTipType, settings->value, m_hResourceModule, virtualFolder);
 		});
 
 	m_infoTipResults.insert({ infoTipResultId, std::move(result) });
+	m_pendingInfoTips.insert({ internalIndex, std::nullopt });
+}
+
+// If any of the settings the info tips depend on have changed, the cached info tips (and the
+// results of any pending tasks) are out of date.
+void ShellBrowser::UpdateInfoTipCacheSettings()
+{
+	InfoTipCacheSettings currentSettings = { GetTaskSettings()->version, m_config->infoTipType };
+
+	if (m_infoTipCacheSettings
+		&& m_infoTipCacheSettings->settingsVersion == currentSettings.settingsVersion
+		&& m_infoTipCacheSettings->infoTipType == currentSettings.infoTipType)
+	{
+		return;
+	}
+
+	m_infoTipCacheSettings = currentSettings;
+	m_infoTipCache.clear();
+	m_pendingInfoTips.clear();
 }
 
-std::optional<ShellBrowser::InfoTipResult> ShellBrowser::GetInfoTipAsync(HWND listView,
-	int infoTipResultId, int internalIndex, const BasicItemInfo_t &basicItemInfo,
-	const Config &config, HINSTANCE instance, bool virtualFolder)
+ShellBrowser::InfoTipResult ShellBrowser::GetInfoTipAsync(HWND listView, int infoTipResultId,
+	int internalIndex, const BasicItemInfo_t &basicItemInfo, InfoTipType infoTipType,
+	const GlobalFolderSettings &globalFolderSettings, HINSTANCE instance, bool virtualFolder)
 {
-	std::wstring infoTip;
+	InfoTipResult result;
+	result.itemInternalIndex = internalIndex;
 
 	/* Use Explorer infotips if the option is selected, or this is a
 	virtual folder. Otherwise, show the modified date. */
-	if ((config.infoTipType == InfoTipType::System) || virtualFolder)
+	if ((infoTipType == InfoTipType::System) || virtualFolder)
 	{
 		TCHAR infoTipText[256];
 		HRESULT hr = GetItemInfoTip(
 			basicItemInfo.pidlComplete.get(), infoTipText, SIZEOF_ARRAY(infoTipText));
 
-		if (FAILED(hr))
+		if (SUCCEEDED(hr))
 		{
-			return std::nullopt;
+			result.infoTip = infoTipText;
 		}
-
-		infoTip = infoTipText;
 	}
 	else
 	{
@@ -539,22 +791,19 @@ std::optional<ShellBrowser::InfoTipResult> ShellBrowser::GetInfoTipAsync(HWND li
 		TCHAR fileModificationText[256];
 		BOOL fileTimeResult =
 			CreateFileTimeString(&basicItemInfo.wfd.ftLastWriteTime, fileModificationText,
-				SIZEOF_ARRAY(fileModificationText), config.globalFolderSettings.showFriendlyDates);
+				SIZEOF_ARRAY(fileModificationText), globalFolderSettings.showFriendlyDates);
 
-		if (!fileTimeResult)
+		if (fileTimeResult)
 		{
-			return std::nullopt;
+			result.infoTip =
+				str(boost::wformat(_T("%s: %s")) % dateModified % fileModificationText);
 		}
-
-		infoTip = str(boost::wformat(_T("%s: %s")) % dateModified % fileModificationText);
 	}
 
+	// The message is posted even if the info tip couldn't be retrieved, so that the item is no
+	// longer considered pending.
 	PostMessage(listView, WM_APP_INFO_TIP_READY, infoTipResultId, 0);
 
-	InfoTipResult result;
-	result.itemInternalIndex = internalIndex;
-	result.infoTip = infoTip;
-
 	return result;
 }
 
@@ -570,12 +819,38 @@ void ShellBrowser::ProcessInfoTipResult(int infoTipResultId)
 	auto result = itr->second.get();
 	m_infoTipResults.erase(itr);
 
-	if (!result)
+	auto pendingItr = m_pendingInfoTips.find(result.itemInternalIndex);
+
+	if (pendingItr == m_pendingInfoTips.end())
 	{
+		// The item was modified (or the settings changed) after the task was queued, so the
+		// result is out of date.
 		return;
 	}
 
-	auto index = LocateItemByInternalIndex(result->itemInternalIndex);
+	std::optional<std::wstring> existingInfoTip = std::move(pendingItr->second);
+	m_pendingInfoTips.erase(pendingItr);
+
+	if (!result.infoTip)
+	{
+		return;
+	}
+
+	m_infoTipCache[result.itemInternalIndex] = *result.infoTip;
+
+	// If the listview has already requested the info tip, it's shown now. Otherwise, this was a
+	// prefetch and the cached info tip will be returned once the listview requests it.
+	if (existingInfoTip)
+	{
+		SetInfoTipInListView(result.itemInternalIndex,
+			existingInfoTip->empty() ? *result.infoTip
+									 : *existingInfoTip + L"\n" + *result.infoTip);
+	}
+}
+
+void ShellBrowser::SetInfoTipInListView(int internalIndex, const std::wstring &infoTip)
+{
+	auto index = LocateItemByInternalIndex(internalIndex);
 
 	if (!index)
 	{
@@ -583,19 +858,125 @@ void ShellBrowser::ProcessInfoTipResult(int infoTipResultId)
 	}
 
 	TCHAR infoTipText[256];
-	StringCchCopy(infoTipText, SIZEOF_ARRAY(infoTipText), result->infoTip.c_str());
-
-	LVSETINFOTIP infoTip;
-	infoTip.cbSize = sizeof(infoTip);
-	infoTip.dwFlags = 0;
-	infoTip.iItem = *index;
-	infoTip.iSubItem = 0;
-	infoTip.pszText = infoTipText;
-	ListView_SetInfoTip(m_hListView, &infoTip);
+	StringCchCopy(infoTipText, SIZEOF_ARRAY(infoTipText), infoTip.c_str());
+
+	LVSETINFOTIP lvInfoTip;
+	lvInfoTip.cbSize = sizeof(lvInfoTip);
+	lvInfoTip.dwFlags = 0;
+	lvInfoTip.iItem = *index;
+	lvInfoTip.iSubItem = 0;
+	lvInfoTip.pszText = infoTipText;
+	ListView_SetInfoTip(m_hListView, &lvInfoTip);
+}
+
+void ShellBrowser::OnListViewEndScroll()
+{
+	UpdateBackgroundTaskPriorities();
+	PrefetchThumbnails();
+
+	listViewScrolled.m_signal();
+}
+
+// Returns the indexes of the first and last items that are visible. In the icon-based views, this
+// is only an approximation, since it's calculated from the scroll position and item spacing, on
+// the assumption that items are arranged in rows.
+std::pair<int, int> ShellBrowser::GetApproximateVisibleItemRange() const
+{
+	int numItems = ListView_GetItemCount(m_hListView);
+	int countPerPage = (std::max)(ListView_GetCountPerPage(m_hListView), 1);
+	int firstVisible;
+
+	if (m_folderSettings.viewMode == +ViewMode::Details
+		|| m_folderSettings.viewMode == +ViewMode::List)
+	{
+		firstVisible = ListView_GetTopIndex(m_hListView);
+	}
+	else
+	{
+		POINT origin;
+		ListView_GetOrigin(m_hListView, &origin);
+
+		DWORD spacing = ListView_GetItemSpacing(m_hListView, FALSE);
+		int horizontalSpacing = (std::max)(static_cast<int>(LOWORD(spacing)), 1);
+		int verticalSpacing = (std::max)(static_cast<int>(HIWORD(spacing)), 1);
+
+		RECT clientRect;
+		GetClientRect(m_hListView, &clientRect);
+
+		int itemsPerRow = (std::max)(GetRectWidth(&clientRect) / horizontalSpacing, 1);
+		int firstVisibleRow = static_cast<int>((std::max)(origin.y, 0L)) / verticalSpacing;
+		firstVisible = firstVisibleRow * itemsPerRow;
+	}
+
+	firstVisible = std::clamp(firstVisible, 0, (std::max)(numItems - 1, 0));
+	int lastVisible = (std::min)(firstVisible + countPerPage - 1, (std::max)(numItems - 1, 0));
+
+	return { firstVisible, lastVisible };
+}
+
+// Moves column and thumbnail tasks for items in (or near) the visible range to the front of the
+// queue and cancels tasks for items that have been scrolled well out of view.
+void ShellBrowser::UpdateBackgroundTaskPriorities()
+{
+	if (m_folderSettings.showInGroups)
+	{
+		// When items are grouped, item indexes don't correspond to the order in which items are
+		// displayed, so there's no simple way of determining how far an item is from the visible
+		// range. Tasks are left in their original order in that case.
+		return;
+	}
+
+	int numItems = ListView_GetItemCount(m_hListView);
+
+	if (numItems == 0)
+	{
+		return;
+	}
+
+	auto [firstVisible, lastVisible] = GetApproximateVisibleItemRange();
+	int retainedItems = (lastVisible - firstVisible + 1) * BACKGROUND_TASK_RETAIN_PAGES;
+	int firstRetained = (std::max)(firstVisible - retainedItems, 0);
+	int lastRetained = (std::min)(lastVisible + retainedItems, numItems - 1);
+
+	std::unordered_map<int, int> itemPriorities;
+
+	for (int i = firstRetained; i <= lastRetained; i++)
+	{
+		int distance = 0;
+
+		if (i < firstVisible)
+		{
+			distance = firstVisible - i;
+		}
+		else if (i > lastVisible)
+		{
+			distance = i - lastVisible;
+		}
+
+		itemPriorities.insert({ GetItemInternalIndex(i), distance });
+	}
+
+	auto getPriority = [&itemPriorities](int internalIndex) -> std::optional<int> {
+		auto itr = itemPriorities.find(internalIndex);
+
+		if (itr == itemPriorities.end())
+		{
+			return std::nullopt;
+		}
+
+		return itr->second;
+	};
+
+	auto &backgroundTaskScheduler = GetBackgroundTaskScheduler();
+	backgroundTaskScheduler.UpdatePriorities(&m_columnResultIds, getPriority);
+	backgroundTaskScheduler.UpdatePriorities(&m_thumbnailResultIds, getPriority);
 }
 
 void ShellBrowser::OnListViewItemInserted(const NMLISTVIEW *itemData)
 {
+	// Items are usually appended, in which case none of the existing items move.
+	m_itemPositionIndex.OnItemAppended(GetItemInternalIndex(itemData->iItem), itemData->iItem);
+
 	if (m_folderSettings.showInGroups)
 	{
 		auto groupId = GetItemGroupId(itemData->iItem);
@@ -614,6 +995,19 @@ void ShellBrowser::OnListViewItemChanged(const NMLISTVIEW *changeData)
 		return;
 	}
 
+	// In owner data mode, a change to every item (e.g. when all items are selected or deselected)
+	// is reported using a single notification.
+	if (changeData->iItem == -1)
+	{
+		if (!m_bulkSelectionChangeInProgress)
+		{
+			RecalculateSelectionInfo();
+			NotifySelectionChanged();
+		}
+
+		return;
+	}
+
 	if (m_config->checkBoxSelection && (LVIS_STATEIMAGEMASK & changeData->uNewState) != 0)
 	{
 		bool checked = ((changeData->uNewState & LVIS_STATEIMAGEMASK) >> 12) == 2;
@@ -640,58 +1034,350 @@ void ShellBrowser::OnListViewItemChanged(const NMLISTVIEW *changeData)
 		}
 	}
 
-	UpdateFileSelectionInfo(static_cast<int>(changeData->lParam), currentlySelected);
+	if (m_bulkSelectionChangeInProgress)
+	{
+		return;
+	}
+
+	UpdateFileSelectionInfo(GetItemInternalIndex(changeData->iItem), currentlySelected);
+
+	NotifySelectionChanged();
+}
+
+void ShellBrowser::SelectAllItems()
+{
+	PerformBulkSelectionChange([this] {
+		ListViewHelper::SelectAllItems(m_hListView, TRUE);
+	});
+}
+
+void ShellBrowser::DeselectAllItems()
+{
+	PerformBulkSelectionChange([this] {
+		ListViewHelper::SelectAllItems(m_hListView, FALSE);
+	});
+}
+
+void ShellBrowser::InvertSelection()
+{
+	PerformBulkSelectionChange([this] {
+		ListViewHelper::InvertSelection(m_hListView);
+	});
+}
+
+void ShellBrowser::SelectItemsMatchingPattern(const std::wstring &pattern, bool select)
+{
+	WildcardMatcher matcher(pattern, false);
+	auto fileNameTable = GetFileNameTable();
+
+	int numItems = ListView_GetItemCount(m_hListView);
+
+	std::vector<int> internalIndexes(numItems);
+
+	for (int i = 0; i < numItems; i++)
+	{
+		internalIndexes[i] = GetItemInternalIndex(i);
+	}
+
+	// The names are already stored lowercased, so each item can be tested without any copying.
+	// char is used (rather than bool) so that each element can be written independently.
+	std::vector<char> matches(numItems);
+	std::transform(std::execution::par, internalIndexes.begin(), internalIndexes.end(),
+		matches.begin(), [&matcher, &fileNameTable](int internalIndex) -> char {
+			return matcher.MatchesFolded(fileNameTable->GetName(internalIndex));
+		});
+
+	auto numMatches = std::count(matches.begin(), matches.end(), char(1));
+
+	if (numMatches == 0)
+	{
+		return;
+	}
+
+	SendMessage(m_hListView, WM_SETREDRAW, FALSE, 0);
+
+	PerformBulkSelectionChange([this, select, numItems, numMatches, &matches] {
+		if (numMatches == numItems)
+		{
+			ListViewHelper::SelectAllItems(m_hListView, select);
+			return;
+		}
+
+		for (int i = 0; i < numItems; i++)
+		{
+			if (matches[i])
+			{
+				ListViewHelper::SelectItem(m_hListView, i, select);
+			}
+		}
+	});
+
+	SendMessage(m_hListView, WM_SETREDRAW, TRUE, 0);
+}
+
+void ShellBrowser::PerformBulkSelectionChange(std::function<void()> change)
+{
+	// Bulk changes can be nested (e.g. when selecting items involves first deselecting all
+	// items), in which case the outermost change is responsible for the recalculation.
+	if (m_bulkSelectionChangeInProgress)
+	{
+		change();
+		return;
+	}
+
+	m_bulkSelectionChangeInProgress = true;
+	change();
+	m_bulkSelectionChangeInProgress = false;
+
+	RecalculateSelectionInfo();
+	NotifySelectionChanged();
+}
+
+void ShellBrowser::NotifySelectionChanged()
+{
+	// Any attributes retrieved for the previous selection no longer apply.
+	m_selectionVersion++;
+
+	if (m_selectionChangedNotificationPending)
+	{
+		return;
+	}
+
+	m_selectionChangedNotificationPending = true;
+	PostMessage(m_hListView, WM_APP_SELECTION_CHANGED, 0, 0);
+}
+
+void ShellBrowser::OnSelectionChangedNotification()
+{
+	m_selectionChangedNotificationPending = false;
+
+	UpdateSelectionAttributes();
 
 	listViewSelectionChanged.m_signal();
 }
 
+void ShellBrowser::UpdateSelectionAttributes()
+{
+	GetBackgroundTaskScheduler().CancelTasks(&m_selectionAttributesResults);
+	m_selectionAttributesResults.clear();
+
+	auto children = GetSelectedItemChildPidls();
+
+	if (children.size() <= MAX_SYNCHRONOUS_SELECTION_ATTRIBUTES_ITEMS)
+	{
+		SelectionAttributes selectionAttributes;
+		selectionAttributes.selectionVersion = m_selectionVersion;
+		selectionAttributes.attributes = SELECTION_ATTRIBUTES_MASK;
+		selectionAttributes.hr = GetItemAttributes(
+			m_directoryState.pidlDirectory.get(), children, &selectionAttributes.attributes);
+		m_selectionAttributes = selectionAttributes;
+		return;
+	}
+
+	// Retrieving the attributes of a large number of items can take a while (e.g. for items on a
+	// network share), so that's done in the background.
+	std::vector<unique_pidl_child> ownedChildren;
+	ownedChildren.reserve(children.size());
+
+	for (auto child : children)
+	{
+		ownedChildren.emplace_back(ILCloneChild(child));
+	}
+
+	int selectionAttributesResultId = m_selectionAttributesResultIdCounter++;
+
+	auto result = GetBackgroundTaskScheduler().PushTask(&m_selectionAttributesResults, std::nullopt,
+		SELECTION_ATTRIBUTES_TASK_PRIORITY,
+		[listView = m_hListView, selectionAttributesResultId, selectionVersion = m_selectionVersion,
+			pidlDirectory = m_directoryState.pidlDirectory,
+			ownedChildren = std::move(ownedChildren)]()
+		{
+			std::vector<PCITEMID_CHILD> children;
+			children.reserve(ownedChildren.size());
+
+			for (const auto &child : ownedChildren)
+			{
+				children.push_back(child.get());
+			}
+
+			SelectionAttributes selectionAttributes;
+			selectionAttributes.selectionVersion = selectionVersion;
+			selectionAttributes.attributes = SELECTION_ATTRIBUTES_MASK;
+			selectionAttributes.hr =
+				GetItemAttributes(pidlDirectory.get(), children, &selectionAttributes.attributes);
+
+			PostMessage(listView, WM_APP_SELECTION_ATTRIBUTES_READY, selectionAttributesResultId, 0);
+
+			return selectionAttributes;
+		});
+
+	m_selectionAttributesResults.insert({ selectionAttributesResultId, std::move(result) });
+}
+
+void ShellBrowser::ProcessSelectionAttributesResult(int selectionAttributesResultId)
+{
+	auto itr = m_selectionAttributesResults.find(selectionAttributesResultId);
+
+	if (itr == m_selectionAttributesResults.end())
+	{
+		return;
+	}
+
+	auto selectionAttributes = itr->second.get();
+	m_selectionAttributesResults.erase(itr);
+
+	if (selectionAttributes.selectionVersion != m_selectionVersion)
+	{
+		// The selection has changed since the task was queued. The attributes for the new
+		// selection will be retrieved once the selection change notification is processed.
+		return;
+	}
+
+	m_selectionAttributes = selectionAttributes;
+
+	listViewSelectionAttributesChanged.m_signal();
+}
+
+void ShellBrowser::ClearSelectionAttributes()
+{
+	GetBackgroundTaskScheduler().CancelTasks(&m_selectionAttributesResults);
+	m_selectionAttributesResults.clear();
+	m_selectionAttributes.reset();
+}
+
+std::vector<PCITEMID_CHILD> ShellBrowser::GetSelectedItemChildPidls() const
+{
+	std::vector<PCITEMID_CHILD> selectedItemChildPidls;
+	int index = -1;
+
+	while ((index = ListView_GetNextItem(m_hListView, index, LVNI_SELECTED)) != -1)
+	{
+		const auto &item = GetItemByIndex(index);
+		selectedItemChildPidls.push_back(item.pridl.get());
+	}
+
+	return selectedItemChildPidls;
+}
+
 void ShellBrowser::UpdateFileSelectionInfo(int internalIndex, BOOL selected)
 {
 	ULARGE_INTEGER ulFileSize;
 	BOOL isFolder;
 
-	isFolder = (m_itemInfoMap.at(internalIndex).wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+	isFolder = (m_itemInfoMap.Get(internalIndex).wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
 		== FILE_ATTRIBUTE_DIRECTORY;
 
-	ulFileSize.LowPart = m_itemInfoMap.at(internalIndex).wfd.nFileSizeLow;
-	ulFileSize.HighPart = m_itemInfoMap.at(internalIndex).wfd.nFileSizeHigh;
+	ulFileSize.LowPart = m_itemInfoMap.Get(internalIndex).wfd.nFileSizeLow;
+	ulFileSize.HighPart = m_itemInfoMap.Get(internalIndex).wfd.nFileSizeHigh;
+
+	auto &selectionInfo = m_directoryState.selectionInfo;
 
 	if (selected)
 	{
 		if (isFolder)
 		{
-			m_directoryState.numFoldersSelected++;
+			selectionInfo.numFolders++;
+			TrackSelectedFolderSize(internalIndex);
 		}
 		else
 		{
-			m_directoryState.numFilesSelected++;
+			selectionInfo.numFiles++;
 		}
 
-		m_directoryState.fileSelectionSize.QuadPart += ulFileSize.QuadPart;
+		selectionInfo.filesSize += ulFileSize.QuadPart;
 	}
 	else
 	{
 		if (isFolder)
 		{
-			m_directoryState.numFoldersSelected--;
+			selectionInfo.numFolders--;
+			UntrackSelectedFolderSize(internalIndex);
 		}
 		else
 		{
-			m_directoryState.numFilesSelected--;
+			selectionInfo.numFiles--;
 		}
 
-		m_directoryState.fileSelectionSize.QuadPart -= ulFileSize.QuadPart;
+		selectionInfo.filesSize -= ulFileSize.QuadPart;
+	}
+}
+
+void ShellBrowser::ResetSelectionInfo()
+{
+	m_directoryState.selectionInfo = {};
+	m_directoryState.selectedFolderSizes.clear();
+}
+
+void ShellBrowser::TrackSelectedFolderSize(int internalIndex)
+{
+	m_directoryState.selectedFolderSizes.try_emplace(internalIndex);
+	ResolveSelectedFolderSize(internalIndex);
+}
+
+void ShellBrowser::UntrackSelectedFolderSize(int internalIndex)
+{
+	auto itr = m_directoryState.selectedFolderSizes.find(internalIndex);
+
+	if (itr == m_directoryState.selectedFolderSizes.end())
+	{
+		return;
+	}
+
+	if (itr->second)
+	{
+		m_directoryState.selectionInfo.foldersSize -= *itr->second;
+		m_directoryState.selectionInfo.numFoldersSized--;
 	}
+
+	m_directoryState.selectedFolderSizes.erase(itr);
+}
+
+// If the specified item is a selected folder whose size hasn't been determined yet, this checks
+// whether the size is now available in the folder size cache. Only the cache is consulted, so this
+// never accesses the filesystem. Returns true if the selection totals were updated.
+bool ShellBrowser::ResolveSelectedFolderSize(int internalIndex)
+{
+	auto itr = m_directoryState.selectedFolderSizes.find(internalIndex);
+
+	if (itr == m_directoryState.selectedFolderSizes.end() || itr->second)
+	{
+		return false;
+	}
+
+	const auto &itemInfo = m_itemInfoMap.Get(internalIndex);
+
+	if (InVirtualFolder() || !itemInfo.isFindDataValid)
+	{
+		return false;
+	}
+
+	auto folderInfo = FolderSizeCache::GetInstance().GetCachedFolderInfo(
+		itemInfo.parsingName, itemInfo.wfd.ftLastWriteTime);
+
+	if (!folderInfo)
+	{
+		return false;
+	}
+
+	itr->second = folderInfo->size;
+	m_directoryState.selectionInfo.foldersSize += folderInfo->size;
+	m_directoryState.selectionInfo.numFoldersSized++;
+
+	return true;
 }
 
 void ShellBrowser::OnListViewKeyDown(const NMLVKEYDOWN *lvKeyDown)
 {
 	switch (lvKeyDown->wVKey)
 	{
+	case VK_ESCAPE:
+		CancelPendingNavigation();
+		break;
+
 	case 'A':
 		if (IsKeyDown(VK_CONTROL) && !IsKeyDown(VK_SHIFT) && !IsKeyDown(VK_MENU))
 		{
-			ListViewHelper::SelectAllItems(m_hListView, TRUE);
+			SelectAllItems();
 			SetFocus(m_hListView);
 		}
 		break;
@@ -706,7 +1392,7 @@ void ShellBrowser::OnListViewKeyDown(const NMLVKEYDOWN *lvKeyDown)
 	case 'I':
 		if (IsKeyDown(VK_CONTROL) && !IsKeyDown(VK_SHIFT) && !IsKeyDown(VK_MENU))
 		{
-			ListViewHelper::InvertSelection(m_hListView);
+			InvertSelection();
 			SetFocus(m_hListView);
 		}
 		break;
@@ -754,20 +1440,105 @@ void ShellBrowser::OnListViewKeyDown(const NMLVKEYDOWN *lvKeyDown)
 	}
 }
 
+// Typing into the listview jumps to the next item whose name starts with the text typed. The
+// listview's own incremental search would retrieve the text of each item in turn (through
+// LVN_GETDISPINFO, when the first column isn't the name column) until it found a match, which is
+// slow in a large folder. Instead, the prefix is matched against the lowercased name table, which
+// is stored contiguously and is independent of the column layout, and only the items that match
+// are then located within the listview. Returns true if the character was handled.
+bool ShellBrowser::OnListViewChar(wchar_t character)
+{
+	if (IsKeyDown(VK_CONTROL) || IsKeyDown(VK_MENU))
+	{
+		return false;
+	}
+
+	auto query = m_typeAheadSearch.AddCharacter(character, std::chrono::steady_clock::now());
+
+	if (!query)
+	{
+		return false;
+	}
+
+	int numItems = IsOwnerDataListViewActive() ? static_cast<int>(m_ownerDataState.items.size())
+											   : ListView_GetItemCount(m_hListView);
+
+	if (numItems == 0)
+	{
+		return true;
+	}
+
+	std::wstring prefix = WildcardMatcher::FoldString(query->prefix);
+	auto names = GetTypeAheadNameTable();
+
+	std::vector<int> matchingPositions;
+	std::vector<int> matchingInternalIndexes;
+
+	for (int internalIndex = 0; internalIndex < static_cast<int>(names->ranges.size());
+		 internalIndex++)
+	{
+		if (!names->GetName(internalIndex).starts_with(prefix))
+		{
+			continue;
+		}
+
+		// Items that have been filtered out aren't in the listview.
+		auto position = LocateItemByInternalIndex(internalIndex);
+
+		if (!position)
+		{
+			continue;
+		}
+
+		matchingPositions.push_back(*position);
+		matchingInternalIndexes.push_back(internalIndex);
+	}
+
+	int focusedItem = ListView_GetNextItem(m_hListView, -1, LVNI_FOCUSED);
+	int start = 0;
+
+	if (focusedItem != -1)
+	{
+		start = query->startAfterCurrent ? focusedItem + 1 : focusedItem;
+	}
+
+	auto match = TypeAheadSearch::FindNextMatch(matchingPositions, start, numItems);
+
+	if (!match)
+	{
+		MessageBeep(MB_OK);
+		return true;
+	}
+
+	SelectItemsByInternalIndex({ matchingInternalIndexes[*match] });
+
+	return true;
+}
+
 const ShellBrowser::ItemInfo_t &ShellBrowser::GetItemByIndex(int index) const
 {
 	int internalIndex = GetItemInternalIndex(index);
-	return m_itemInfoMap.at(internalIndex);
+	return m_itemInfoMap.Get(internalIndex);
 }
 
 ShellBrowser::ItemInfo_t &ShellBrowser::GetItemByIndex(int index)
 {
 	int internalIndex = GetItemInternalIndex(index);
-	return m_itemInfoMap.at(internalIndex);
+	return m_itemInfoMap.Get(internalIndex);
 }
 
 int ShellBrowser::GetItemInternalIndex(int item) const
 {
+	if (IsOwnerDataListViewActive())
+	{
+		if (item < 0 || item >= static_cast<int>(m_ownerDataState.items.size()))
+		{
+			throw std::runtime_error("Item lookup failed");
+		}
+
+		return m_ownerDataState.items[item];
+	}
+
 	LVITEM lvItem;
 	lvItem.mask = LVIF_PARAM;
 	lvItem.iItem = item;
@@ -792,6 +1563,12 @@ void ShellBrowser::MarkItemAsCut(int item, bool cut)
 		return;
 	}
 
+	if (IsOwnerDataListViewActive())
+	{
+		MarkOwnerDataItemAsCut(item, cut);
+		return;
+	}
+
 	if (cut)
 	{
 		ListView_SetItemState(m_hListView, item, LVIS_CUT, LVIS_CUT);
@@ -827,7 +1604,7 @@ void ShellBrowser::OnListViewHeaderRightClick(const POINTS &cursorPos)
 		LoadMenu(m_hResourceModule, MAKEINTRESOURCE(IDR_HEADER_MENU)));
 	HMENU headerMenu = GetSubMenu(headerPopupMenu.get(), 0);
 
-	auto commonColumns = GetColumnHeaderMenuList(m_directoryState.directory.c_str());
+	auto commonColumns = GetColumnHeaderMenuList(m_directoryState.folderType);
 
 	std::unordered_map<int, ColumnType> menuItemMappings;
 	int totalInserted = 0;
@@ -896,36 +1673,30 @@ void ShellBrowser::OnListViewHeaderRightClick(const POINTS &cursorPos)
 	OnListViewHeaderMenuItemSelected(cmd, menuItemMappings);
 }
 
-std::vector<ColumnType> GetColumnHeaderMenuList(const std::wstring &directory)
+std::vector<ColumnType> GetColumnHeaderMenuList(FolderType folderType)
 {
-	if (CompareVirtualFolders(directory.c_str(), CSIDL_DRIVES))
+	switch (folderType)
 	{
+	case FolderType::Computer:
 		return COMMON_MY_COMPUTER_COLUMNS;
-	}
-	else if (CompareVirtualFolders(directory.c_str(), CSIDL_CONTROLS))
-	{
+
+	case FolderType::ControlPanel:
 		return COMMON_CONTROL_PANEL_COLUMNS;
-	}
-	else if (CompareVirtualFolders(directory.c_str(), CSIDL_BITBUCKET))
-	{
+
+	case FolderType::RecycleBin:
 		return COMMON_RECYCLE_BIN_COLUMNS;
-	}
-	else if (CompareVirtualFolders(directory.c_str(), CSIDL_CONNECTIONS))
-	{
+
+	case FolderType::Network:
 		return COMMON_NETWORK_CONNECTIONS_COLUMNS;
-	}
-	else if (CompareVirtualFolders(directory.c_str(), CSIDL_NETWORK))
-	{
+
+	case FolderType::NetworkPlaces:
 		return COMMON_NETWORK_COLUMNS;
-	}
-	else if (CompareVirtualFolders(directory.c_str(), CSIDL_PRINTERS))
-	{
+
+	case FolderType::Printers:
 		return COMMON_PRINTERS_COLUMNS;
 	}
-	else
-	{
-		return COMMON_REAL_FOLDER_COLUMNS;
-	}
+
+	return COMMON_REAL_FOLDER_COLUMNS;
 }
 
 void ShellBrowser::OnListViewHeaderMenuItemSelected(
@@ -1009,19 +1780,38 @@ bool ShellBrowser::TestListViewItemAttributes(int item, SFGAOF attributes) const
 	return false;
 }
 
+// Returns the attributes common to every selected item. The attributes are retrieved once per
+// selection change, so this is cheap to call repeatedly (e.g. from toolbar and menu enablement
+// code). If the attributes of a large selection are still being retrieved in the background,
+// E_PENDING is returned and listViewSelectionAttributesChanged is triggered once they're
+// available.
 HRESULT ShellBrowser::GetListViewSelectionAttributes(SFGAOF *attributes) const
 {
-	HRESULT hr = E_FAIL;
+	bool requestedAttributesCached = (*attributes & ~SELECTION_ATTRIBUTES_MASK) == 0;
 
-	/* TODO: This should probably check all selected files. */
-	int selectedItem = ListView_GetNextItem(m_hListView, -1, LVNI_SELECTED);
+	if (requestedAttributesCached && m_selectionAttributes
+		&& m_selectionAttributes->selectionVersion == m_selectionVersion)
+	{
+		if (FAILED(m_selectionAttributes->hr))
+		{
+			return m_selectionAttributes->hr;
+		}
+
+		*attributes &= m_selectionAttributes->attributes;
+		return S_OK;
+	}
 
-	if (selectedItem != -1)
+	bool selectionAttributesPending =
+		m_selectionChangedNotificationPending || !m_selectionAttributesResults.empty();
+
+	if (requestedAttributesCached && selectionAttributesPending
+		&& ListView_GetSelectedCount(m_hListView) > MAX_SYNCHRONOUS_SELECTION_ATTRIBUTES_ITEMS)
 	{
-		hr = GetListViewItemAttributes(selectedItem, attributes);
+		return E_PENDING;
 	}
 
-	return hr;
+	return GetItemAttributes(
+		m_directoryState.pidlDirectory.get(), GetSelectedItemChildPidls(), attributes);
 }
 
 HRESULT ShellBrowser::GetListViewItemAttributes(int item, SFGAOF *attributes) const
@@ -1044,6 +1834,39 @@ std::vector<PCIDLIST_ABSOLUTE> ShellBrowser::GetSelectedItemPidls()
 	return selectedItemPidls;
 }
 
+void ShellBrowser::SetDragImageForSelection(IDataObject *dataObject)
+{
+	bool smallIcons = (m_folderSettings.viewMode == +ViewMode::SmallIcons
+		|| m_folderSettings.viewMode == +ViewMode::List
+		|| m_folderSettings.viewMode == +ViewMode::Details);
+	HIMAGELIST imageList =
+		ListView_GetImageList(m_hListView, smallIcons ? LVSIL_SMALL : LVSIL_NORMAL);
+
+	if (!imageList)
+	{
+		return;
+	}
+
+	std::vector<int> iconIndexes;
+	int index = -1;
+
+	while (iconIndexes.size() < MAX_DRAG_IMAGE_ITEMS
+		&& (index = ListView_GetNextItem(m_hListView, index, LVNI_SELECTED)) != -1)
+	{
+		LVITEM item = {};
+		item.mask = LVIF_IMAGE;
+		item.iItem = index;
+
+		if (ListView_GetItem(m_hListView, &item) && item.iImage >= 0)
+		{
+			iconIndexes.push_back(item.iImage);
+		}
+	}
+
+	// If no image can be set here, SHDoDragDrop() will fall back to generating one itself.
+	SetDragImageFromIcons(dataObject, imageList, iconIndexes);
+}
+
 void ShellBrowser::OnListViewBeginDrag(const NMLISTVIEW *info)
 {
 	StartDrag(info->iItem, info->ptAction);
@@ -1059,7 +1882,20 @@ HRESULT ShellBrowser::StartDrag(int draggedItem, const POINT &startPoint)
 	}
 
 	wil::com_ptr_nothrow<IDataObject> dataObject;
-	RETURN_IF_FAILED(CreateDataObjectForShellTransfer(pidls, &dataObject));
+
+	// Both the shell's data object and the drag image it generates cover every selected item,
+	// which means that a drag of a very large selection would stall before it even starts. In that
+	// case, the data is rendered in the background (and only waited for once the drop target asks
+	// for it) and the drag image only shows the first few items.
+	if (pidls.size() >= DELAYED_RENDER_ITEM_THRESHOLD)
+	{
+		RETURN_IF_FAILED(CreateDelayedRenderDataObjectForShellTransfer(pidls, &dataObject));
+		SetDragImageForSelection(dataObject.get());
+	}
+	else
+	{
+		RETURN_IF_FAILED(CreateDataObjectForShellTransfer(pidls, &dataObject));
+	}
 
 	m_performingDrag = true;
 	m_draggedDataObject = dataObject.get();
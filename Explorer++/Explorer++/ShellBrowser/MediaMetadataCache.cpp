@@ -0,0 +1,270 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "MediaMetadataCache.h"
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <wil/com.h>
+#include <wil/resource.h>
+#include <propkey.h>
+#include <propvarutil.h>
+
+namespace
+{
+
+struct MediaProperty
+{
+	MediaMetadataType type;
+	PROPERTYKEY key;
+};
+
+// clang-format off
+const MediaProperty MEDIA_PROPERTIES[] = {
+	{ MediaMetadataType::Bitrate, PKEY_Audio_EncodingBitrate },
+	{ MediaMetadataType::Copyright, PKEY_Copyright },
+	{ MediaMetadataType::Duration, PKEY_Media_Duration },
+	{ MediaMetadataType::Protected, PKEY_DRM_IsProtected },
+	{ MediaMetadataType::Rating, PKEY_Rating },
+	{ MediaMetadataType::AlbumArtist, PKEY_Music_AlbumArtist },
+	{ MediaMetadataType::AlbumTitle, PKEY_Music_AlbumTitle },
+	{ MediaMetadataType::BeatsPerMinute, PKEY_Music_BeatsPerMinute },
+	{ MediaMetadataType::Composer, PKEY_Music_Composer },
+	{ MediaMetadataType::Conductor, PKEY_Music_Conductor },
+	{ MediaMetadataType::Director, PKEY_Video_Director },
+	{ MediaMetadataType::Genre, PKEY_Music_Genre },
+	{ MediaMetadataType::Language, PKEY_Language },
+	{ MediaMetadataType::BroadcastDate, PKEY_RecordedTV_OriginalBroadcastDate },
+	{ MediaMetadataType::Channel, PKEY_RecordedTV_ChannelNumber },
+	{ MediaMetadataType::StationName, PKEY_RecordedTV_StationName },
+	{ MediaMetadataType::Mood, PKEY_Music_Mood },
+	{ MediaMetadataType::ParentalRating, PKEY_ParentalRating },
+	{ MediaMetadataType::ParentalRatingReason, PKEY_ParentalRatingReason },
+	{ MediaMetadataType::Period, PKEY_Music_Period },
+	{ MediaMetadataType::Producer, PKEY_Media_Producer },
+	{ MediaMetadataType::Publisher, PKEY_Media_Publisher },
+	{ MediaMetadataType::Writer, PKEY_Media_Writer },
+	{ MediaMetadataType::Year, PKEY_Media_Year }
+};
+// clang-format on
+
+std::optional<std::wstring> FormatMediaProperty(
+	MediaMetadataType mediaMetadataType, const PROPVARIANT &value)
+{
+	switch (mediaMetadataType)
+	{
+	case MediaMetadataType::Bitrate:
+	{
+		ULONG bitRate;
+
+		if (FAILED(PropVariantToUInt32(value, &bitRate)))
+		{
+			return std::nullopt;
+		}
+
+		TCHAR bitRateText[64];
+
+		if (bitRate > 1000)
+		{
+			StringCchPrintf(bitRateText, std::size(bitRateText), _T("%u kbps"), bitRate / 1000);
+		}
+		else
+		{
+			StringCchPrintf(bitRateText, std::size(bitRateText), _T("%u bps"), bitRate);
+		}
+
+		return bitRateText;
+	}
+
+	case MediaMetadataType::Duration:
+	{
+		ULONGLONG duration;
+
+		if (FAILED(PropVariantToUInt64(value, &duration)))
+		{
+			return std::nullopt;
+		}
+
+		auto *facet = new boost::posix_time::wtime_facet();
+		facet->time_duration_format(L"%H:%M:%S");
+
+		std::wstringstream durationStream;
+		durationStream.imbue(std::locale(durationStream.getloc(), facet));
+
+		// The duration is in 100-nanosecond units.
+		durationStream << boost::posix_time::microseconds(duration / 10);
+
+		return durationStream.str();
+	}
+
+	case MediaMetadataType::Protected:
+	{
+		BOOL isProtected;
+
+		if (FAILED(PropVariantToBoolean(value, &isProtected)))
+		{
+			return std::nullopt;
+		}
+
+		return isProtected ? L"Yes" : L"No";
+	}
+
+	default:
+	{
+		// Multi-valued properties (e.g. the genre) are joined with semicolons.
+		wil::unique_cotaskmem_string text;
+
+		if (FAILED(PropVariantToStringAlloc(value, wil::out_param(text))) || !text || *text.get() == '\0')
+		{
+			return std::nullopt;
+		}
+
+		return text.get();
+	}
+	}
+}
+
+MediaMetadataCache::MediaMetadata ReadMediaMetadataFromStore(IPropertyStore *propertyStore)
+{
+	MediaMetadataCache::MediaMetadata metadata;
+
+	for (const auto &mediaProperty : MEDIA_PROPERTIES)
+	{
+		wil::unique_prop_variant value;
+		HRESULT hr = propertyStore->GetValue(mediaProperty.key, value.reset_and_addressof());
+
+		if (FAILED(hr) || value.vt == VT_EMPTY)
+		{
+			continue;
+		}
+
+		auto text = FormatMediaProperty(mediaProperty.type, value);
+
+		if (text)
+		{
+			metadata.emplace(mediaProperty.type, *text);
+		}
+	}
+
+	return metadata;
+}
+
+MediaMetadataCache::MediaMetadata ReadFastMediaMetadata(const std::wstring &path)
+{
+	wil::com_ptr_nothrow<IPropertyStore> propertyStore;
+	HRESULT hr = SHGetPropertyStoreFromParsingName(
+		path.c_str(), nullptr, GPS_FASTPROPERTIESONLY, IID_PPV_ARGS(&propertyStore));
+
+	if (FAILED(hr))
+	{
+		return {};
+	}
+
+	return ReadMediaMetadataFromStore(propertyStore.get());
+}
+
+}
+
+MediaMetadataCache::MediaMetadataCache(ReadFunction readFunction) : m_readFunction(readFunction)
+{
+}
+
+MediaMetadataCache &MediaMetadataCache::GetInstance()
+{
+	static MediaMetadataCache mediaMetadataCache;
+	return mediaMetadataCache;
+}
+
+std::wstring MediaMetadataCache::GetMetadataText(const std::wstring &path,
+	const std::optional<FILETIME> &lastWriteTime, MediaMetadataType mediaMetadataType)
+{
+	if (!lastWriteTime)
+	{
+		return GetText(m_readFunction(path), mediaMetadataType);
+	}
+
+	auto key = GetKey(path);
+
+	{
+		std::scoped_lock lock(m_mutex);
+
+		auto itr = m_entries.find(key);
+
+		if (itr != m_entries.end()
+			&& CompareFileTime(&itr->second.lastWriteTime, &*lastWriteTime) == 0)
+		{
+			return GetText(itr->second.metadata, mediaMetadataType);
+		}
+	}
+
+	auto metadata = m_readFunction(path);
+	auto text = GetText(metadata, mediaMetadataType);
+
+	std::scoped_lock lock(m_mutex);
+
+	if (m_entries.size() >= MAX_ENTRIES)
+	{
+		m_entries.clear();
+	}
+
+	m_entries.insert_or_assign(key, Entry{ *lastWriteTime, std::move(metadata) });
+
+	return text;
+}
+
+std::wstring MediaMetadataCache::GetFastMetadataText(
+	const std::wstring &path, MediaMetadataType mediaMetadataType)
+{
+	return GetText(ReadFastMediaMetadata(path), mediaMetadataType);
+}
+
+void MediaMetadataCache::Clear()
+{
+	std::scoped_lock lock(m_mutex);
+	m_entries.clear();
+}
+
+// The property handler for a file is only loaded once, with every media property then being
+// retrieved from it. Properties that are available without the handler (e.g. those held by the
+// indexer) are tried first, since that avoids the file having to be opened at all.
+MediaMetadataCache::MediaMetadata MediaMetadataCache::ReadMediaMetadata(const std::wstring &path)
+{
+	auto metadata = ReadFastMediaMetadata(path);
+
+	if (!metadata.empty())
+	{
+		return metadata;
+	}
+
+	wil::com_ptr_nothrow<IPropertyStore> propertyStore;
+	HRESULT hr = SHGetPropertyStoreFromParsingName(
+		path.c_str(), nullptr, GPS_DEFAULT, IID_PPV_ARGS(&propertyStore));
+
+	if (FAILED(hr))
+	{
+		return {};
+	}
+
+	return ReadMediaMetadataFromStore(propertyStore.get());
+}
+
+std::wstring MediaMetadataCache::GetKey(const std::wstring &path)
+{
+	std::wstring key = path;
+	CharLowerBuff(key.data(), static_cast<DWORD>(key.size()));
+
+	return key;
+}
+
+std::wstring MediaMetadataCache::GetText(
+	const MediaMetadata &metadata, MediaMetadataType mediaMetadataType)
+{
+	auto itr = metadata.find(mediaMetadataType);
+
+	if (itr == metadata.end())
+	{
+		return {};
+	}
+
+	return itr->second;
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "ColumnDataRetrieval.h"
+#include <windows.h>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+// Caches the media metadata (e.g. the album, artist and duration) of each file, keyed by the path
+// of the file. All of the metadata for a file is read in a single pass, so showing several media
+// columns (or sorting by one of them) only requires each file to be read once. An entry is only
+// used while the last write time of the file matches the time stored with the entry.
+//
+// Safe to use from multiple threads. Files are read without the lock being held.
+class MediaMetadataCache
+{
+public:
+	using MediaMetadata = std::unordered_map<MediaMetadataType, std::wstring>;
+
+	// Reads every type of metadata the file has. Only replaced in tests.
+	using ReadFunction = std::function<MediaMetadata(const std::wstring &path)>;
+
+	explicit MediaMetadataCache(ReadFunction readFunction = ReadMediaMetadata);
+
+	static MediaMetadataCache &GetInstance();
+
+	// Returns the text for the specified type of metadata, or an empty string if the file doesn't
+	// have that metadata. If no last write time is provided, the file is read without the result
+	// being cached.
+	std::wstring GetMetadataText(const std::wstring &path,
+		const std::optional<FILETIME> &lastWriteTime, MediaMetadataType mediaMetadataType);
+
+	// Returns the metadata only if it's available without the file being opened (e.g. because
+	// it's held by the indexer). The result isn't cached.
+	static std::wstring GetFastMetadataText(
+		const std::wstring &path, MediaMetadataType mediaMetadataType);
+
+	void Clear();
+
+	static MediaMetadata ReadMediaMetadata(const std::wstring &path);
+
+private:
+	// The cache is cleared if it grows beyond this many files, so that memory usage remains bounded
+	// when browsing through large libraries.
+	static const size_t MAX_ENTRIES = 100000;
+
+	struct Entry
+	{
+		FILETIME lastWriteTime;
+		MediaMetadata metadata;
+	};
+
+	static std::wstring GetKey(const std::wstring &path);
+	static std::wstring GetText(const MediaMetadata &metadata, MediaMetadataType mediaMetadataType);
+
+	const ReadFunction m_readFunction;
+
+	std::mutex m_mutex;
+	std::unordered_map<std::wstring, Entry> m_entries;
+};
\ No newline at end of file
@@ -0,0 +1,64 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// How long each stage of a navigation took. The enumerate and item information stages run on the
+// enumeration thread and overlap with the listview insertion on the UI thread, so the stages
+// don't necessarily add up to the total.
+struct NavigationTiming
+{
+	// Binding to the folder and creating the initial enumerator, on the UI thread.
+	std::chrono::microseconds bind = {};
+
+	// Time spent reading items from the folder, excluding the time spent building the information
+	// for each item. Zero if the items came from a snapshot.
+	std::chrono::microseconds enumerate = {};
+
+	// Time spent building the information for each item (including any prefetched column text).
+	std::chrono::microseconds itemInfo = {};
+
+	std::chrono::microseconds insert = {};
+	std::chrono::microseconds sort = {};
+
+	// The time between the navigation completing and the listview first being painted.
+	std::chrono::microseconds firstPaint = {};
+
+	// The time between the navigation starting and the listview first being painted.
+	std::chrono::microseconds total = {};
+
+	size_t numItems = 0;
+	bool fromSnapshot = false;
+	bool completed = false;
+	bool painted = false;
+};
+
+// A snapshot of the background work and memory use of a single browser.
+struct BrowserDiagnostics
+{
+	NavigationTiming lastNavigation;
+
+	// The number of tasks of each type that have been queued, but whose results haven't been
+	// processed yet.
+	size_t pendingColumnTasks = 0;
+	size_t pendingThumbnailTasks = 0;
+	size_t pendingIconTasks = 0;
+
+	// True while the items are being tested against the filter in the background.
+	bool filterEvaluationPending = false;
+
+	// Running totals, which can be sampled periodically to determine the throughput.
+	uint64_t columnResultsProcessed = 0;
+	uint64_t thumbnailResultsProcessed = 0;
+	uint64_t iconResultsProcessed = 0;
+
+	size_t numItems = 0;
+
+	// These are estimates. The image lists may be shared with other browsers.
+	size_t itemInfoBytes = 0;
+	size_t imageListBytes = 0;
+};
\ No newline at end of file
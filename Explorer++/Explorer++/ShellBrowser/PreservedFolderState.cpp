@@ -9,4 +9,9 @@
 PreservedFolderState::PreservedFolderState(const ShellBrowser *shellBrowser) :
 	folderSettings(shellBrowser->GetFolderSettings())
 {
+}
+
+PreservedFolderState::PreservedFolderState(const FolderSettings &initialFolderSettings) :
+	folderSettings(initialFolderSettings)
+{
 }
\ No newline at end of file
@@ -13,6 +13,7 @@ struct PreservedFolderState
 {
 public:
 	PreservedFolderState(const ShellBrowser *shellBrowser);
+	PreservedFolderState(const FolderSettings &initialFolderSettings);
 
 	FolderSettings folderSettings;
 
@@ -6,10 +6,22 @@
 #include "PreservedHistoryEntry.h"
 #include "HistoryEntry.h"
 
-PreservedHistoryEntry::PreservedHistoryEntry(const HistoryEntry &entry) :
-	id(entry.GetId()),
-	pidl(ILCloneFull(entry.GetPidl().get())),
+PreservedHistoryEntry::PreservedHistoryEntry(
+	const HistoryEntry &entry, SharedPidlStore &pidlStore) :
+	pidl(pidlStore.Intern(entry.GetPidl().get())),
 	displayName(entry.GetDisplayName()),
 	systemIconIndex(entry.GetSystemIconIndex())
 {
+}
+
+PreservedHistoryEntry::PreservedHistoryEntry(
+	SharedPidlStore::Handle pidlHandle, const std::wstring &entryDisplayName) :
+	pidl(pidlHandle),
+	displayName(entryDisplayName)
+{
+}
+
+unique_pidl_absolute PreservedHistoryEntry::GetPidl() const
+{
+	return SharedPidlStore::Materialize(pidl);
 }
\ No newline at end of file
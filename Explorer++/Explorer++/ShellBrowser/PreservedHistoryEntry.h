@@ -5,7 +5,7 @@
 #pragma once
 
 #include "../Helper/Macros.h"
-#include "../Helper/ShellHelper.h"
+#include "../Helper/SharedPidlStore.h"
 #include <optional>
 
 class HistoryEntry;
@@ -13,11 +13,15 @@ class HistoryEntry;
 struct PreservedHistoryEntry
 {
 public:
-	PreservedHistoryEntry(const HistoryEntry &entry);
+	PreservedHistoryEntry(const HistoryEntry &entry, SharedPidlStore &pidlStore);
+	PreservedHistoryEntry(
+		SharedPidlStore::Handle pidlHandle, const std::wstring &entryDisplayName);
 
-	const int id;
+	unique_pidl_absolute GetPidl() const;
 
-	unique_pidl_absolute pidl;
+	// Entries are typically kept around for a while (e.g. in the list of closed tabs), so the
+	// directory is stored in a shared form, rather than as a full PIDL.
+	SharedPidlStore::Handle pidl;
 	std::wstring displayName;
 	std::optional<int> systemIconIndex;
 
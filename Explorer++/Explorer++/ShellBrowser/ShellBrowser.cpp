@@ -8,6 +8,7 @@
 #include "CoreInterface.h"
 #include "DarkModeHelper.h"
 #include "FolderView.h"
+#include "HardwareChangeNotifier.h"
 #include "ItemData.h"
 #include "MainResource.h"
 #include "MassRenameDialog.h"
@@ -17,18 +18,72 @@
 #include "SortModes.h"
 #include "ViewModeHelper.h"
 #include "ViewModes.h"
+#include "../Helper/AccountNameCache.h"
 #include "../Helper/Controls.h"
-#include "../Helper/DriveInfo.h"
 #include "../Helper/FileActionHandler.h"
 #include "../Helper/FileOperations.h"
 #include "../Helper/IconFetcher.h"
 #include "../Helper/ListViewHelper.h"
 #include "../Helper/Macros.h"
+#include "../Helper/MemoryBudget.h"
+#include "../Helper/PriorityTaskScheduler.h"
 #include "../Helper/ShellHelper.h"
 #include <wil/com.h>
 #include <winrt/base.h>
+#include <filesystem>
 #include <list>
 
+namespace
+{
+
+std::string GetChildPidlIndexKey(PCUITEMID_CHILD pidlChild)
+{
+	return std::string(reinterpret_cast<const char *>(pidlChild), ILGetSize(pidlChild));
+}
+
+// Item names in the indexes are case-folded, since file system names are (typically)
+// case-insensitive.
+std::wstring GetNameIndexKey(const std::wstring &name)
+{
+	std::wstring key = name;
+	CharUpperBuff(key.data(), static_cast<DWORD>(key.size()));
+	return key;
+}
+
+template <typename Key, typename Predicate>
+std::optional<int> FindIndexedItem(
+	const std::unordered_multimap<Key, int> &index, const Key &key, Predicate predicate)
+{
+	auto [first, last] = index.equal_range(key);
+
+	for (auto itr = first; itr != last; ++itr)
+	{
+		if (predicate(itr->second))
+		{
+			return itr->second;
+		}
+	}
+
+	return std::nullopt;
+}
+
+template <typename Key>
+void RemoveIndexedItem(std::unordered_multimap<Key, int> &index, const Key &key, int internalIndex)
+{
+	auto [first, last] = index.equal_range(key);
+
+	for (auto itr = first; itr != last; ++itr)
+	{
+		if (itr->second == internalIndex)
+		{
+			index.erase(itr);
+			break;
+		}
+	}
+}
+
+}
+
 void CALLBACK TimerProc(HWND hwnd, UINT uMsg, UINT_PTR idEvent, DWORD dwTime);
 
 int ShellBrowser::listViewParentSubclassIdCounter = 0;
@@ -68,37 +123,67 @@ ShellBrowser::ShellBrowser(int id, HWND hOwner, IExplorerplusplus *coreInterface
 	const FolderSettings &folderSettings, std::optional<FolderColumns> initialColumns) :
 	ShellDropTargetWindow(CreateListView(hOwner)),
 	m_hListView(GetHWND()),
+	m_standardListView(GetHWND()),
+	m_ownerDataListView(nullptr),
 	m_ID(id),
 	m_shChangeNotifyId(0),
+	m_shellChangeProcessingDelay(PROCESS_SHELL_CHANGES_TIMEOUT),
+	m_processingShellChangeBatch(false),
+	m_selectionChangedNotificationPending(false),
+	m_bulkSelectionChangeInProgress(false),
 	m_hResourceModule(coreInterface->GetLanguageModule()),
 	m_hOwner(hOwner),
 	m_cachedIcons(coreInterface->GetCachedIcons()),
 	m_iconResourceLoader(coreInterface->GetIconResourceLoader()),
+	m_coreInterface(coreInterface),
 	m_config(coreInterface->GetConfig()),
 	m_tabNavigation(tabNavigation),
 	m_fileActionHandler(fileActionHandler),
 	m_folderSettings(folderSettings),
+	m_allowCloudHydration(false),
+	m_flatView(false),
+	m_relativePathColumnShownForFlatView(false),
+	m_reducedNetworkActivity(false),
 	m_folderColumns(initialColumns
 			? *initialColumns
 			: coreInterface->GetConfig()->globalFolderSettings.folderColumns),
-	m_columnThreadPool(
-		1, std::bind(CoInitializeEx, nullptr, COINIT_APARTMENTTHREADED), CoUninitialize),
+	m_columnResultChannel(
+		[this] { PostMessage(m_hListView, WM_APP_COLUMN_RESULTS_READY, 0, 0); }),
 	m_columnResultIDCounter(0),
-	m_thumbnailThreadPool(
-		1, std::bind(CoInitializeEx, nullptr, COINIT_APARTMENTTHREADED), CoUninitialize),
+	m_thumbnailResultChannel(
+		[this] { PostMessage(m_hListView, WM_APP_THUMBNAIL_RESULTS_READY, 0, 0); }),
 	m_thumbnailResultIDCounter(0),
-	m_infoTipsThreadPool(
-		1, std::bind(CoInitializeEx, nullptr, COINIT_APARTMENTTHREADED), CoUninitialize),
+	m_thumbnailPrefetchPreviousFirstVisible(0),
+	m_thumbnailSlots(GetThumbnailSlotCapacity(THUMBNAIL_ITEM_SIZE)),
+	m_thumbnailItemSize(THUMBNAIL_ITEM_SIZE),
 	m_infoTipResultIDCounter(0),
+	m_enumerationThreadPool(
+		1, std::bind(CoInitializeEx, nullptr, COINIT_APARTMENTTHREADED), CoUninitialize),
+	m_enumerationIDCounter(0),
+	m_navigationIdCounter(0),
+	m_numColumnResultsProcessed(0),
+	m_numThumbnailResultsProcessed(0),
+	m_filterEvaluationIDCounter(0),
 	m_rightClickDragAllowed(false),
 	m_draggedDataObject(nullptr),
 	m_shellWindowRegistered(false)
 {
 	InitializeListView();
-	m_iconFetcher = std::make_unique<IconFetcher>(m_hListView, m_cachedIcons);
+	UpdateFilterMatcher();
+
+	m_windowSubclasses.push_back(
+		std::make_unique<WindowSubclassWrapper>(GetParent(m_hListView), ListViewParentProcStub,
+			listViewParentSubclassIdCounter++, reinterpret_cast<DWORD_PTR>(this)));
+
+	m_iconFetcher =
+		std::make_unique<IconFetcher>(m_hListView, m_cachedIcons, &GetBackgroundTaskScheduler());
 	m_navigationController =
 		std::make_unique<ShellNavigationController>(this, tabNavigation, m_iconFetcher.get());
 
+	// Info tips are prefetched before they're shown. The other tasks are for items (or paths)
+	// that are already visible.
+	GetBackgroundTaskScheduler().SetOwnerTaskClass(&m_infoTipResults, TaskClass::VisiblePrefetch);
+
 	m_getDragImageMessage = RegisterWindowMessage(DI_GETDRAGIMAGE);
 
 	m_bFolderVisited = FALSE;
@@ -130,11 +215,30 @@ ShellBrowser::ShellBrowser(int id, HWND hOwner, IExplorerplusplus *coreInterface
 	m_iFolderIcon = GetDefaultFolderIconIndex();
 	m_iFileIcon = GetDefaultFileIconIndex();
 
-	AddClipboardFormatListener(m_hListView);
+	AddClipboardFormatListener(m_standardListView);
 
 	m_connections.push_back(coreInterface->AddApplicationShuttingDownObserver(
 		std::bind_front(&ShellBrowser::OnApplicationShuttingDown, this)));
 
+	// The observer is invoked on a background thread. The standard listview always exists (even
+	// when the owner data listview is active), so the notification is always posted there.
+	m_connections.push_back(HardwareChangeNotifier::GetInstance().AddDriveChangedObserver(
+		std::bind_front(&ShellBrowser::OnDriveChanged, this)));
+
+	m_connections.push_back(AccountNameCache::GetInstance().AddNamesResolvedObserver(
+		[listView = m_standardListView]() {
+			PostMessage(listView, WM_APP_ACCOUNT_NAMES_RESOLVED, 0, 0);
+		}));
+
+	auto &memoryBudget = MemoryBudget::GetInstance();
+	m_folderSnapshotsMemoryConsumerId =
+		memoryBudget.AddConsumer(MemoryBudget::Priority::FolderSnapshots,
+			std::bind_front(&ShellBrowser::GetFolderSnapshotsMemoryUsage, this),
+			std::bind_front(&ShellBrowser::TrimFolderSnapshots, this));
+	m_columnTextMemoryConsumerId = memoryBudget.AddConsumer(MemoryBudget::Priority::ColumnText,
+		std::bind_front(&ShellBrowser::GetColumnTextCacheMemoryUsage, this),
+		std::bind_front(&ShellBrowser::TrimColumnTextCache, this));
+
 	if (!m_shellWindows)
 	{
 		m_shellWindows = winrt::create_instance<IShellWindows>(CLSID_ShellWindows, CLSCTX_ALL);
@@ -143,34 +247,106 @@ ShellBrowser::ShellBrowser(int id, HWND hOwner, IExplorerplusplus *coreInterface
 
 ShellBrowser::~ShellBrowser()
 {
+	auto &memoryBudget = MemoryBudget::GetInstance();
+	memoryBudget.RemoveConsumer(m_folderSnapshotsMemoryConsumerId);
+	memoryBudget.RemoveConsumer(m_columnTextMemoryConsumerId);
+
 	if (m_config->registerForShellNotifications)
 	{
 		StopDirectoryMonitoring();
 	}
 
-	RemoveClipboardFormatListener(m_hListView);
+	RemoveClipboardFormatListener(m_standardListView);
+
+	DestroyWindow(m_standardListView);
+
+	if (m_ownerDataListView)
+	{
+		DestroyWindow(m_ownerDataListView);
+	}
 
-	DestroyWindow(m_hListView);
+	// The tasks that are currently running reference this instance, so they need to finish before
+	// it can be destroyed.
+	auto &backgroundTaskScheduler = GetBackgroundTaskScheduler();
+	backgroundTaskScheduler.CancelTasks(&m_columnResultIds, true);
+	backgroundTaskScheduler.CancelTasks(&m_thumbnailResultIds, true);
+	backgroundTaskScheduler.CancelTasks(&m_infoTipResults, true);
+	backgroundTaskScheduler.CancelTasks(&m_sortKeyResults, true);
+	backgroundTaskScheduler.CancelTasks(&m_historyEntryPathResults, true);
+	backgroundTaskScheduler.CancelTasks(&m_selectionAttributesResults, true);
+	CancelEnumeration();
+	CancelFilterEvaluation();
 
-	m_columnThreadPool.clear_queue();
-	m_thumbnailThreadPool.clear_queue();
-	m_infoTipsThreadPool.clear_queue();
+	// Owner IDs are addresses, so any association with a server (or a task class) needs to be
+	// removed before they can be reused.
+	for (auto owner : GetBackgroundTaskOwners())
+	{
+		backgroundTaskScheduler.SetOwnerResource(owner, L"");
+		backgroundTaskScheduler.SetOwnerTaskClass(owner, TaskClass::Interactive);
+	}
 
 	DeleteCriticalSection(&m_csDirectoryAltered);
+}
 
-	/* TODO: Also destroy the thumbnails imagelist. */
+void ShellBrowser::PrioritizeBackgroundTasks()
+{
+	GetBackgroundTaskScheduler().SetPreferredOwners(GetBackgroundTaskOwners());
 }
 
-HWND ShellBrowser::CreateListView(HWND parent)
+std::vector<const void *> ShellBrowser::GetBackgroundTaskOwners() const
 {
+	return { &m_columnResultIds, &m_thumbnailResultIds, &m_infoTipResults, &m_groupInfoCache,
+		&m_sortKeyResults, &m_historyEntryPathResults, &m_selectionAttributesResults,
+		&m_filterEvaluation, m_iconFetcher.get() };
+}
+
+PriorityTaskScheduler &ShellBrowser::GetBackgroundTaskScheduler()
+{
+	static PriorityTaskScheduler backgroundTaskScheduler(
+		std::clamp(static_cast<int>(std::thread::hardware_concurrency()), 2,
+			BACKGROUND_TASK_MAX_THREADS),
+		std::bind(CoInitializeEx, nullptr, COINIT_APARTMENTTHREADED), []() {
+			ReleaseThreadThumbnailCache();
+			CoUninitialize();
+		});
+	return backgroundTaskScheduler;
+}
+
+// Returns the settings snapshot that background tasks should use. The snapshot is only replaced if
+// the settings have changed since it was taken.
+std::shared_ptr<const ShellBrowser::TaskSettings> ShellBrowser::GetTaskSettings()
+{
+	return m_taskSettings.Update(m_config->globalFolderSettings);
+}
+
+TieredThumbnailCache &ShellBrowser::GetThumbnailImageCache()
+{
+	static TieredThumbnailCache thumbnailImageCache(THUMBNAIL_IMAGE_CACHE_MAX_BYTES);
+
+	// The cache lasts for the lifetime of the application, so it's never removed from the budget.
+	[[maybe_unused]] static int memoryConsumerId = MemoryBudget::GetInstance().AddConsumer(
+		MemoryBudget::Priority::Thumbnails, [] { return thumbnailImageCache.GetSizeInBytes(); },
+		[](size_t maxBytes) { thumbnailImageCache.TrimToSize(maxBytes); });
+
+	return thumbnailImageCache;
+}
+
+HWND ShellBrowser::CreateListView(HWND parent, bool ownerData)
+{
+	DWORD style = WS_CHILD | WS_VISIBLE | WS_CLIPSIBLINGS | WS_CLIPCHILDREN | LVS_REPORT
+		| LVS_EDITLABELS | LVS_SHOWSELALWAYS | LVS_SHAREIMAGELISTS | LVS_AUTOARRANGE | WS_TABSTOP
+		| LVS_ALIGNTOP;
+
+	if (ownerData)
+	{
+		style |= LVS_OWNERDATA;
+	}
+
 	// Note that the only reason LVS_REPORT is specified here is so that the listview header theme
 	// can be set immediately when in dark mode. Without this style, ListView_GetHeader() will
 	// return NULL. The actual view mode set here doesn't matter, since it will be updated when
 	// navigating to a folder.
-	return ::CreateListView(parent,
-		WS_CHILD | WS_VISIBLE | WS_CLIPSIBLINGS | WS_CLIPCHILDREN | LVS_REPORT | LVS_EDITLABELS
-			| LVS_SHOWSELALWAYS | LVS_SHAREIMAGELISTS | LVS_AUTOARRANGE | WS_TABSTOP
-			| LVS_ALIGNTOP);
+	return ::CreateListView(parent, style);
 }
 
 void ShellBrowser::InitializeListView()
@@ -214,10 +390,6 @@ void ShellBrowser::InitializeListView()
 
 	m_windowSubclasses.push_back(std::make_unique<WindowSubclassWrapper>(
 		m_hListView, ListViewProcStub, LISTVIEW_SUBCLASS_ID, reinterpret_cast<DWORD_PTR>(this)));
-
-	m_windowSubclasses.push_back(
-		std::make_unique<WindowSubclassWrapper>(GetParent(m_hListView), ListViewParentProcStub,
-			listViewParentSubclassIdCounter++, reinterpret_cast<DWORD_PTR>(this)));
 }
 
 BOOL ShellBrowser::GetAutoArrange() const
@@ -254,14 +426,14 @@ void ShellBrowser::SetViewMode(ViewMode viewMode)
 		RemoveThumbnailsView();
 	}
 
-	SetViewModeInternal(viewMode);
-
-	switch (viewMode)
+	// Neither thumbnails nor tiles are supported in owner data mode.
+	if (IsOwnerDataListViewActive()
+		&& (viewMode == +ViewMode::Thumbnails || viewMode == +ViewMode::Tiles))
 	{
-	case ViewMode::Tiles:
-		SetTileViewInfo();
-		break;
+		SwitchToStandardListView();
 	}
+
+	SetViewModeInternal(viewMode);
 }
 
 /* Explicitly sets the view mode within in the listview.
@@ -374,8 +546,7 @@ void ShellBrowser::SetViewModeInternal(ViewMode viewMode)
 
 	if (viewMode != +ViewMode::Details)
 	{
-		m_columnThreadPool.clear_queue();
-		m_columnResults.clear();
+		ClearColumnResults();
 	}
 
 	ViewMode previousViewMode = m_folderSettings.viewMode;
@@ -422,8 +593,8 @@ void ShellBrowser::SetFirstColumnTextToFilename()
 	{
 		int internalIndex = GetItemInternalIndex(i);
 
-		BasicItemInfo_t basicItemInfo = getBasicItemInfo(internalIndex);
-		std::wstring filename = ProcessItemFileName(basicItemInfo, m_config->globalFolderSettings);
+		std::wstring filename =
+			ProcessItemFileName(*getBasicItemInfo(internalIndex), m_config->globalFolderSettings);
 
 		ListView_SetItemText(m_hListView, i, 0, filename.data());
 	}
@@ -481,13 +652,13 @@ std::wstring ShellBrowser::GetItemDisplayName(int index) const
 	// hidden within Explorer++, then the display name will contain the file extension, but the text
 	// displayed to the user won't. Processing the filename here ensures that the extension is
 	// removed, if necessary.
-	BasicItemInfo_t basicItemInfo = getBasicItemInfo(GetItemInternalIndex(index));
-	return ProcessItemFileName(basicItemInfo, m_config->globalFolderSettings);
+	return ProcessItemFileName(
+		*getBasicItemInfo(GetItemInternalIndex(index)), m_config->globalFolderSettings);
 }
 
 std::wstring ShellBrowser::GetItemEditingName(int index) const
 {
-	return GetItemByIndex(index).editingName;
+	return GetItemByIndex(index).GetEditingName();
 }
 
 std::wstring ShellBrowser::GetItemFullName(int index) const
@@ -500,41 +671,104 @@ std::wstring ShellBrowser::GetDirectory() const
 	return m_directoryState.directory;
 }
 
-unique_pidl_absolute ShellBrowser::GetDirectoryIdl() const
+SharedPidl ShellBrowser::GetDirectoryIdl() const
+{
+	return m_directoryState.pidlDirectory;
+}
+
+void ShellBrowser::SetPendingDirectory(const SharedPidl &pidlDirectory)
 {
-	unique_pidl_absolute pidlDirectory(ILCloneFull(m_directoryState.pidlDirectory.get()));
-	return pidlDirectory;
+	assert(!m_bFolderVisited);
+
+	m_directoryState.pidlDirectory = pidlDirectory;
+
+	std::wstring parsingPath;
+	HRESULT hr = GetDisplayName(pidlDirectory.get(), SHGDN_FORPARSING, parsingPath);
+
+	if (SUCCEEDED(hr))
+	{
+		m_directoryState.directory = parsingPath;
+		m_directoryState.folderType = GetFolderType(parsingPath);
+	}
 }
 
 void ShellBrowser::SelectItems(const std::vector<PCIDLIST_ABSOLUTE> &pidls)
 {
-	ListViewHelper::SelectAllItems(m_hListView, FALSE);
+	// The items may not have been added to the listview yet, in which case, they'll be selected
+	// once enumeration has completed.
+	if (m_enumerationState)
+	{
+		m_directoryState.pendingSelection = DeepCopyPidls(pidls);
+		m_directoryState.pendingChildSelection = {};
+		return;
+	}
 
-	int smallestIndex = INT_MAX;
+	std::vector<int> internalIndexes;
 
 	for (auto &pidl : pidls)
 	{
 		auto internalIndex = GetItemInternalIndexForPidl(pidl);
 
-		if (!internalIndex)
+		if (internalIndex)
 		{
-			continue;
+			internalIndexes.push_back(*internalIndex);
 		}
+	}
+
+	SelectItemsByInternalIndex(internalIndexes);
+}
+
+// Selects the specified children of the current folder. This is used to restore the selection
+// when navigating back to a folder, so the items are matched in bulk using their child PIDLs.
+void ShellBrowser::SelectChildItems(const PackedChildPidls &children)
+{
+	if (m_enumerationState)
+	{
+		m_directoryState.pendingChildSelection = children;
+		m_directoryState.pendingSelection.clear();
+		return;
+	}
 
-		auto index = LocateItemByInternalIndex(*internalIndex);
+	std::vector<int> internalIndexes;
+	internalIndexes.reserve(children.GetCount());
+
+	for (auto child : children.GetPidls())
+	{
+		auto internalIndex = GetItemInternalIndexForChildPidl(child);
 
-		if (!index)
+		if (internalIndex)
 		{
-			continue;
+			internalIndexes.push_back(*internalIndex);
 		}
+	}
 
-		ListViewHelper::SelectItem(m_hListView, *index, TRUE);
+	SelectItemsByInternalIndex(internalIndexes);
+}
 
-		if (*index < smallestIndex)
+void ShellBrowser::SelectItemsByInternalIndex(const std::vector<int> &internalIndexes)
+{
+	int smallestIndex = INT_MAX;
+
+	PerformBulkSelectionChange([this, &internalIndexes, &smallestIndex] {
+		ListViewHelper::SelectAllItems(m_hListView, FALSE);
+
+		for (int internalIndex : internalIndexes)
 		{
-			smallestIndex = *index;
+			auto index = LocateItemByInternalIndex(internalIndex);
+
+			if (!index)
+			{
+				continue;
+			}
+
+			ListViewHelper::SelectItem(m_hListView, *index, TRUE);
+
+			if (*index < smallestIndex)
+			{
+				smallestIndex = *index;
+			}
 		}
-	}
+	});
 
 	if (smallestIndex != INT_MAX)
 	{
@@ -545,19 +779,11 @@ void ShellBrowser::SelectItems(const std::vector<PCIDLIST_ABSOLUTE> &pidls)
 
 int ShellBrowser::LocateFileItemIndex(const TCHAR *szFileName) const
 {
-	LV_FINDINFO lvFind;
-	int iItem;
-	int iInternalIndex;
-
-	iInternalIndex = LocateFileItemInternalIndex(szFileName);
+	int iInternalIndex = LocateFileItemInternalIndex(szFileName);
 
 	if (iInternalIndex != -1)
 	{
-		lvFind.flags = LVFI_PARAM;
-		lvFind.lParam = iInternalIndex;
-		iItem = ListView_FindItem(m_hListView, -1, &lvFind);
-
-		return iItem;
+		return LocateItemByInternalIndex(iInternalIndex).value_or(-1);
 	}
 
 	return -1;
@@ -565,17 +791,32 @@ int ShellBrowser::LocateFileItemIndex(const TCHAR *szFileName) const
 
 int ShellBrowser::LocateFileItemInternalIndex(const TCHAR *szFileName) const
 {
-	for (int i = 0; i < m_directoryState.numItems; i++)
+	// In flat view, the name is relative to the current directory and can refer to an item within
+	// any of its subfolders, so the full path is looked up instead.
+	if (m_flatView)
 	{
-		const auto &item = GetItemByIndex(i);
+		auto parsingName =
+			(std::filesystem::path(m_directoryState.directory) / szFileName).wstring();
 
-		if (lstrcmp(item.wfd.cFileName, szFileName) == 0)
-		{
-			return GetItemInternalIndex(i);
-		}
+		auto internalIndex = FindIndexedItem(m_itemLookupIndexes.parsingNames,
+			GetNameIndexKey(parsingName), [this, &parsingName](int internalIndex) {
+				return lstrcmpi(m_itemInfoMap.Get(internalIndex).parsingName.c_str(),
+						   parsingName.c_str())
+					== 0
+					&& m_directoryState.filteredItemsList.count(internalIndex) == 0;
+			});
+
+		return internalIndex.value_or(-1);
 	}
 
-	return -1;
+	// Only items that are currently shown in the listview are considered here.
+	auto internalIndex = FindIndexedItem(m_itemLookupIndexes.fileNames,
+		GetNameIndexKey(szFileName), [this, szFileName](int internalIndex) {
+			return lstrcmp(m_itemInfoMap.Get(internalIndex).wfd.cFileName, szFileName) == 0
+				&& m_directoryState.filteredItemsList.count(internalIndex) == 0;
+		});
+
+	return internalIndex.value_or(-1);
 }
 
 std::optional<int> ShellBrowser::GetItemIndexForPidl(PCIDLIST_ABSOLUTE pidl) const
@@ -592,31 +833,133 @@ std::optional<int> ShellBrowser::GetItemIndexForPidl(PCIDLIST_ABSOLUTE pidl) con
 
 std::optional<int> ShellBrowser::GetItemInternalIndexForPidl(PCIDLIST_ABSOLUTE pidl) const
 {
-	auto itr = std::find_if(m_itemInfoMap.begin(), m_itemInfoMap.end(), [pidl](const auto &pair) {
-		return ArePidlsEquivalent(pidl, pair.second.pidlComplete.get());
-	});
+	auto isSameItem = [this, pidl](int internalIndex) {
+		return ArePidlsEquivalent(pidl, m_itemInfoMap.Get(internalIndex).pidlComplete.get());
+	};
+
+	// The PIDL passed in will often be byte-for-byte identical to the child PIDL that was stored
+	// for the item, so that's checked first. File system PIDLs can also contain data like the
+	// item's size and timestamps, though, so the parsing name is used as a fallback.
+	auto internalIndex = FindIndexedItem(
+		m_itemLookupIndexes.childPidls, GetChildPidlIndexKey(ILFindLastID(pidl)), isSameItem);
 
-	if (itr == m_itemInfoMap.end())
+	if (internalIndex)
+	{
+		return internalIndex;
+	}
+
+	std::wstring parsingName;
+	HRESULT hr = GetDisplayName(pidl, SHGDN_FORPARSING, parsingName);
+
+	if (FAILED(hr))
 	{
 		return std::nullopt;
 	}
 
-	return itr->first;
+	return FindIndexedItem(
+		m_itemLookupIndexes.parsingNames, GetNameIndexKey(parsingName), isSameItem);
 }
 
-std::optional<int> ShellBrowser::LocateItemByInternalIndex(int internalIndex) const
+std::optional<int> ShellBrowser::GetItemInternalIndexForChildPidl(PCITEMID_CHILD pidlChild) const
 {
-	LVFINDINFO lvfi;
-	lvfi.flags = LVFI_PARAM;
-	lvfi.lParam = internalIndex;
-	int item = ListView_FindItem(m_hListView, -1, &lvfi);
+	// The index is keyed on the bytes of the child PIDL, so any item found is an exact match.
+	// That's the typical case when a folder is re-enumerated, so the slower lookup below is only
+	// needed for items whose PIDL has changed.
+	auto internalIndex = FindIndexedItem(m_itemLookupIndexes.childPidls,
+		GetChildPidlIndexKey(pidlChild), [](int internalIndex) {
+			UNREFERENCED_PARAMETER(internalIndex);
+			return true;
+		});
+
+	if (internalIndex)
+	{
+		return internalIndex;
+	}
+
+	unique_pidl_absolute pidlComplete(ILCombine(m_directoryState.pidlDirectory.get(), pidlChild));
+
+	if (!pidlComplete)
+	{
+		return std::nullopt;
+	}
+
+	return GetItemInternalIndexForPidl(pidlComplete.get());
+}
 
-	if (item == -1)
+// Unlike the name lookups, filtered items are included here, since an item that's renamed can
+// move in or out of the filter.
+std::optional<int> ShellBrowser::GetItemInternalIndexForFileId(ULONGLONG fileId) const
+{
+	if (fileId == DirectoryReader::UNKNOWN_FILE_ID)
 	{
 		return std::nullopt;
 	}
 
-	return item;
+	return FindIndexedItem(m_itemLookupIndexes.fileIds, fileId, [](int internalIndex) {
+		UNREFERENCED_PARAMETER(internalIndex);
+		return true;
+	});
+}
+
+void ShellBrowser::AddItemToLookupIndexes(int internalIndex)
+{
+	const auto &itemInfo = m_itemInfoMap.Get(internalIndex);
+
+	m_itemLookupIndexes.childPidls.emplace(
+		GetChildPidlIndexKey(itemInfo.pridl.get()), internalIndex);
+	m_itemLookupIndexes.parsingNames.emplace(
+		GetNameIndexKey(itemInfo.parsingName), internalIndex);
+	m_itemLookupIndexes.fileNames.emplace(
+		GetNameIndexKey(itemInfo.wfd.cFileName), internalIndex);
+
+	if (itemInfo.fileId != DirectoryReader::UNKNOWN_FILE_ID)
+	{
+		m_itemLookupIndexes.fileIds.emplace(itemInfo.fileId, internalIndex);
+	}
+
+	// This is called when an item is added, as well as when an existing item is re-indexed after
+	// it's been updated or renamed.
+	InvalidateItemNameTables();
+
+	if (m_filterEvaluation)
+	{
+		m_filterEvaluation->changedItems.insert(internalIndex);
+	}
+}
+
+// Note that this needs to be called before the item is removed from (or replaced in)
+// m_itemInfoMap.
+void ShellBrowser::RemoveItemFromLookupIndexes(int internalIndex)
+{
+	const auto &itemInfo = m_itemInfoMap.Get(internalIndex);
+
+	RemoveIndexedItem(m_itemLookupIndexes.childPidls, GetChildPidlIndexKey(itemInfo.pridl.get()),
+		internalIndex);
+	RemoveIndexedItem(
+		m_itemLookupIndexes.parsingNames, GetNameIndexKey(itemInfo.parsingName), internalIndex);
+	RemoveIndexedItem(
+		m_itemLookupIndexes.fileNames, GetNameIndexKey(itemInfo.wfd.cFileName), internalIndex);
+
+	if (itemInfo.fileId != DirectoryReader::UNKNOWN_FILE_ID)
+	{
+		RemoveIndexedItem(m_itemLookupIndexes.fileIds, itemInfo.fileId, internalIndex);
+	}
+
+	InvalidateItemNameTables();
+	InvalidateCachedGroupInfo(internalIndex);
+}
+
+std::optional<int> ShellBrowser::LocateItemByInternalIndex(int internalIndex) const
+{
+	if (IsOwnerDataListViewActive())
+	{
+		return m_itemPositionIndex.Find(internalIndex,
+			static_cast<int>(m_ownerDataState.items.size()),
+			[this](int item) { return m_ownerDataState.items[item]; });
+	}
+
+	return m_itemPositionIndex.Find(internalIndex, ListView_GetItemCount(m_hListView),
+		[this](int item) { return GetItemInternalIndex(item); });
 }
 
 WIN32_FIND_DATA ShellBrowser::GetItemFileFindData(int index) const
@@ -624,6 +967,20 @@ WIN32_FIND_DATA ShellBrowser::GetItemFileFindData(int index) const
 	return GetItemByIndex(index).wfd;
 }
 
+std::optional<size_t> ShellBrowser::GetItemColorRule(
+	int index, int colorRuleGeneration, const ColorRuleResolver &resolver)
+{
+	auto &itemInfo = GetItemByIndex(index);
+
+	if (!itemInfo.cachedColorRule || itemInfo.cachedColorRule->generation != colorRuleGeneration)
+	{
+		itemInfo.cachedColorRule = ItemInfo_t::CachedColorRule{ colorRuleGeneration,
+			resolver(itemInfo.parsingName, itemInfo.wfd.dwFileAttributes) };
+	}
+
+	return itemInfo.cachedColorRule->ruleIndex;
+}
+
 unique_pidl_absolute ShellBrowser::GetItemCompleteIdl(int index) const
 {
 	return unique_pidl_absolute(ILCloneFull(GetItemByIndex(index).pidlComplete.get()));
@@ -667,17 +1024,62 @@ int ShellBrowser::GetDirMonitorId() const
 	return m_iDirMonitorId;
 }
 
-BOOL ShellBrowser::CompareVirtualFolders(UINT uFolderCSIDL) const
+// Resolving each of the special folder paths is relatively expensive, so this should only be
+// called when navigating to a folder, with the result stored in the directory state.
+FolderType ShellBrowser::GetFolderType(const std::wstring &directory)
 {
-	std::wstring parsingPath;
-	GetCsidlDisplayName(uFolderCSIDL, SHGDN_FORPARSING, parsingPath);
+	if (CompareVirtualFolders(directory.c_str(), CSIDL_CONTROLS))
+	{
+		return FolderType::ControlPanel;
+	}
+	else if (CompareVirtualFolders(directory.c_str(), CSIDL_DRIVES))
+	{
+		return FolderType::Computer;
+	}
+	else if (CompareVirtualFolders(directory.c_str(), CSIDL_BITBUCKET))
+	{
+		return FolderType::RecycleBin;
+	}
+	else if (CompareVirtualFolders(directory.c_str(), CSIDL_PRINTERS))
+	{
+		return FolderType::Printers;
+	}
+	else if (CompareVirtualFolders(directory.c_str(), CSIDL_CONNECTIONS))
+	{
+		return FolderType::Network;
+	}
+	else if (CompareVirtualFolders(directory.c_str(), CSIDL_NETWORK))
+	{
+		return FolderType::NetworkPlaces;
+	}
 
-	if (parsingPath == m_directoryState.directory)
+	return FolderType::General;
+}
+
+std::vector<Column_t> &ShellBrowser::GetCurrentFolderColumns()
+{
+	switch (m_directoryState.folderType)
 	{
-		return TRUE;
+	case FolderType::Computer:
+		return m_folderColumns.myComputerColumns;
+
+	case FolderType::ControlPanel:
+		return m_folderColumns.controlPanelColumns;
+
+	case FolderType::Network:
+		return m_folderColumns.networkConnectionsColumns;
+
+	case FolderType::NetworkPlaces:
+		return m_folderColumns.myNetworkPlacesColumns;
+
+	case FolderType::Printers:
+		return m_folderColumns.printersColumns;
+
+	case FolderType::RecycleBin:
+		return m_folderColumns.recycleBinColumns;
 	}
 
-	return FALSE;
+	return m_folderColumns.realFolderColumns;
 }
 
 int ShellBrowser::GenerateUniqueItemId()
@@ -872,50 +1274,6 @@ void ShellBrowser::PositionDroppedItems()
 	}
 }
 
-int ShellBrowser::DetermineItemSortedPosition(LPARAM lParam) const
-{
-	LVITEM lvItem;
-	BOOL bItem;
-	int res = 1;
-	int nItems = 0;
-	int i = 0;
-
-	nItems = ListView_GetItemCount(m_hListView);
-
-	while (res > 0 && i < nItems)
-	{
-		lvItem.mask = LVIF_PARAM;
-		lvItem.iItem = i;
-		lvItem.iSubItem = 0;
-		bItem = ListView_GetItem(m_hListView, &lvItem);
-
-		if (bItem)
-		{
-			res = Sort(static_cast<int>(lParam), static_cast<int>(lvItem.lParam));
-		}
-		else
-		{
-			res = 0;
-		}
-
-		i++;
-	}
-
-	/* The item will always be inserted BEFORE
-	the item at position i that we specify here.
-	For example, specifying 0, will place the item
-	at 0 (and push 0 to 1), specifying 1 will place
-	the item at 1 (and push 1 to 2).
-	Therefore, to place in the last position, need
-	to place AFTER last item. */
-	if ((i - 1) == nItems - 1 && res > 0)
-	{
-		i++;
-	}
-
-	return i - 1;
-}
-
 int ShellBrowser::GetNumItems() const
 {
 	return m_directoryState.numItems;
@@ -923,57 +1281,33 @@ int ShellBrowser::GetNumItems() const
 
 int ShellBrowser::GetNumSelectedFiles() const
 {
-	return m_directoryState.numFilesSelected;
+	return m_directoryState.selectionInfo.numFiles;
 }
 
 int ShellBrowser::GetNumSelectedFolders() const
 {
-	return m_directoryState.numFoldersSelected;
+	return m_directoryState.selectionInfo.numFolders;
 }
 
 int ShellBrowser::GetNumSelected() const
 {
-	return m_directoryState.numFilesSelected + m_directoryState.numFoldersSelected;
+	return m_directoryState.selectionInfo.numFiles + m_directoryState.selectionInfo.numFolders;
+}
+
+const SelectionInfo &ShellBrowser::GetSelectionInfo() const
+{
+	return m_directoryState.selectionInfo;
 }
 
 void ShellBrowser::GetFolderInfo(FolderInfo_t *pFolderInfo)
 {
 	pFolderInfo->TotalFolderSize.QuadPart = m_directoryState.totalDirSize.QuadPart;
-	pFolderInfo->TotalSelectionSize.QuadPart = m_directoryState.fileSelectionSize.QuadPart;
+	pFolderInfo->TotalSelectionSize.QuadPart = m_directoryState.selectionInfo.filesSize;
 }
 
 void ShellBrowser::VerifySortMode()
 {
-	const std::vector<Column_t> *columns = nullptr;
-
-	if (CompareVirtualFolders(CSIDL_CONTROLS))
-	{
-		columns = &m_folderColumns.controlPanelColumns;
-	}
-	else if (CompareVirtualFolders(CSIDL_DRIVES))
-	{
-		columns = &m_folderColumns.myComputerColumns;
-	}
-	else if (CompareVirtualFolders(CSIDL_BITBUCKET))
-	{
-		columns = &m_folderColumns.recycleBinColumns;
-	}
-	else if (CompareVirtualFolders(CSIDL_PRINTERS))
-	{
-		columns = &m_folderColumns.printersColumns;
-	}
-	else if (CompareVirtualFolders(CSIDL_CONNECTIONS))
-	{
-		columns = &m_folderColumns.networkConnectionsColumns;
-	}
-	else if (CompareVirtualFolders(CSIDL_NETWORK))
-	{
-		columns = &m_folderColumns.myNetworkPlacesColumns;
-	}
-	else
-	{
-		columns = &m_folderColumns.realFolderColumns;
-	}
+	const std::vector<Column_t> *columns = &GetCurrentFolderColumns();
 
 	auto itr = std::find_if(columns->begin(), columns->end(), [this](const Column_t &column) {
 		return DetermineColumnSortMode(column.type) == m_folderSettings.sortMode;
@@ -1012,6 +1346,45 @@ BOOL ShellBrowser::SetShowHidden(BOOL bShowHidden)
 	return m_folderSettings.showHidden;
 }
 
+bool ShellBrowser::GetAllowCloudHydration() const
+{
+	return m_allowCloudHydration;
+}
+
+// Each item captures this setting when its basic information is built, so the folder needs to be
+// refreshed for the change to take effect.
+void ShellBrowser::SetAllowCloudHydration(bool allowCloudHydration)
+{
+	m_allowCloudHydration = allowCloudHydration;
+}
+
+bool ShellBrowser::GetFlatView() const
+{
+	return m_flatView;
+}
+
+void ShellBrowser::SetFlatView(bool flatView)
+{
+	if (flatView == m_flatView)
+	{
+		return;
+	}
+
+	m_flatView = flatView;
+
+	ShowRelativePathColumnForFlatView(flatView);
+}
+
+const std::wstring &ShellBrowser::GetNetworkServer() const
+{
+	return m_networkServer;
+}
+
+bool ShellBrowser::IsNetworkActivityReduced() const
+{
+	return m_reducedNetworkActivity;
+}
+
 std::vector<SortMode> ShellBrowser::GetAvailableSortModes() const
 {
 	std::vector<SortMode> sortModes;
@@ -1052,139 +1425,105 @@ void ShellBrowser::QueueRename(PCIDLIST_ABSOLUTE pidlItem)
 
 void ShellBrowser::SelectItems(const std::list<std::wstring> &PastedFileList)
 {
-	int i = 0;
+	EnterCriticalSection(&m_csDirectoryAltered);
+
+	// Any files that haven't been added yet will be selected once they are.
+	m_pendingFileSelections.clear();
+	m_pendingFileSelections.insert(PastedFileList.begin(), PastedFileList.end());
+	SelectPendingFileItems();
+
+	LeaveCriticalSection(&m_csDirectoryAltered);
+}
 
-	m_FileSelectionList.clear();
+void ShellBrowser::SelectPendingFileItems()
+{
+	m_pendingFileSelectionMatched = false;
 
-	for (const auto &pastedFile : PastedFileList)
+	if (m_pendingFileSelections.empty())
 	{
-		int iIndex = LocateFileItemIndex(pastedFile.c_str());
+		return;
+	}
+
+	int numItems = ListView_GetItemCount(m_hListView);
+	std::optional<int> firstSelectedIndex;
+
+	SendMessage(m_hListView, WM_SETREDRAW, FALSE, 0);
 
-		if (iIndex != -1)
+	PerformBulkSelectionChange([this, numItems, &firstSelectedIndex] {
+		// Each item is checked against the set of names once, rather than each name being
+		// searched for separately.
+		for (int i = 0; i < numItems && !m_pendingFileSelections.empty(); i++)
 		{
-			ListViewHelper::SelectItem(m_hListView, iIndex, TRUE);
+			const auto &itemInfo = m_itemInfoMap.Get(GetItemInternalIndex(i));
+			auto itr = m_pendingFileSelections.find(itemInfo.wfd.cFileName);
 
-			if (i == 0)
+			if (itr == m_pendingFileSelections.end())
 			{
-				/* Focus on the first item, and ensure it is visible. */
-				ListViewHelper::FocusItem(m_hListView, iIndex, TRUE);
-				ListView_EnsureVisible(m_hListView, iIndex, FALSE);
+				continue;
+			}
+
+			ListViewHelper::SelectItem(m_hListView, i, TRUE);
 
-				i++;
+			if (!firstSelectedIndex)
+			{
+				firstSelectedIndex = i;
 			}
+
+			m_pendingFileSelections.erase(itr);
 		}
-		else
-		{
-			m_FileSelectionList.push_back(pastedFile);
-		}
+	});
+
+	SendMessage(m_hListView, WM_SETREDRAW, TRUE, 0);
+
+	if (firstSelectedIndex)
+	{
+		/* Focus on the first item, and ensure it is visible. */
+		ListViewHelper::FocusItem(m_hListView, *firstSelectedIndex, TRUE);
+		ListView_EnsureVisible(m_hListView, *firstSelectedIndex, FALSE);
 	}
 }
 
-void ShellBrowser::OnDeviceChange(WPARAM wParam, LPARAM lParam)
+void ShellBrowser::OnDriveChanged(const DriveChange &change)
 {
-	/* Note changes made here may have no effect. Since
-	the icon for the cd/dvd/etc. may not have been
-	updated by the time this function is called, it's
-	possible this may not change anything. */
-
 	/* If we are currently not in my computer, this
-	message can be safely ignored (drives are only
+	notification can be safely ignored (drives are only
 	shown in my computer). */
-	if (CompareVirtualFolders(CSIDL_DRIVES))
+	if (m_directoryState.folderType != FolderType::Computer)
 	{
-		switch (wParam)
-		{
-			/* Device has being added/inserted into the system. Update the
-			drives toolbar as necessary. */
-		case DBT_DEVICEARRIVAL:
-		{
-			DEV_BROADCAST_HDR *dbh = nullptr;
-
-			dbh = (DEV_BROADCAST_HDR *) lParam;
-
-			if (dbh->dbch_devicetype == DBT_DEVTYP_VOLUME)
-			{
-				DEV_BROADCAST_VOLUME *pdbv = nullptr;
-				TCHAR chDrive;
-				TCHAR szDrive[4];
-
-				pdbv = (DEV_BROADCAST_VOLUME *) dbh;
-
-				/* Build a string that will form the drive name. */
-				chDrive = GetDriveLetterFromMask(pdbv->dbcv_unitmask);
-				StringCchPrintf(szDrive, SIZEOF_ARRAY(szDrive), _T("%c:\\"), chDrive);
+		return;
+	}
 
-				if (pdbv->dbcv_flags & DBTF_MEDIA)
-				{
-					UpdateDriveIcon(szDrive);
-				}
-				else
-				{
-					OnFileAdded(szDrive);
-				}
-			}
-		}
+	switch (change.type)
+	{
+	case DriveChange::Type::Added:
+		OnFileAdded(change.path.c_str());
 		break;
 
-		case DBT_DEVICEREMOVECOMPLETE:
-		{
-			DEV_BROADCAST_HDR *dbh = nullptr;
-
-			dbh = (DEV_BROADCAST_HDR *) lParam;
+	case DriveChange::Type::Removed:
+		/* At this point, the drive has been completely removed
+		from the system. Therefore, its display name cannot be
+		queried. Need to search for the drive using ONLY its
+		drive letter/name. Once its index in the listview has
+		been determined, it can simply be removed. */
+		RemoveDrive(change.path.c_str());
+		break;
 
-			if (dbh->dbch_devicetype == DBT_DEVTYP_VOLUME)
-			{
-				DEV_BROADCAST_VOLUME *pdbv = nullptr;
-				TCHAR chDrive;
-				TCHAR szDrive[4];
-
-				pdbv = (DEV_BROADCAST_VOLUME *) dbh;
-
-				/* Build a string that will form the drive name. */
-				chDrive = GetDriveLetterFromMask(pdbv->dbcv_unitmask);
-				StringCchPrintf(szDrive, SIZEOF_ARRAY(szDrive), _T("%c:\\"), chDrive);
-
-				/* The device was removed from the system.
-				Remove it from the listview (only if the drive
-				was actually removed - the drive may not have
-				been removed, for example, if a cd/dvd was
-				changed). */
-				if (pdbv->dbcv_flags & DBTF_MEDIA)
-				{
-					UpdateDriveIcon(szDrive);
-				}
-				else
-				{
-					/* At this point, the drive has been completely removed
-					from the system. Therefore, its display name cannot be
-					queried. Need to search for the drive using ONLY its
-					drive letter/name. Once its index in the listview has
-					been determined, it can simply be removed. */
-					RemoveDrive(szDrive);
-				}
-			}
-		}
+	case DriveChange::Type::MediaChanged:
+		UpdateDriveIcon(change);
 		break;
-		}
 	}
 }
 
-void ShellBrowser::UpdateDriveIcon(const TCHAR *szDrive)
+void ShellBrowser::UpdateDriveIcon(const DriveChange &change)
 {
 	LVITEM lvItem;
-	SHFILEINFO shfi;
 	HRESULT hr;
 	int iItem = -1;
 	int iItemInternal = -1;
 	int i = 0;
 
-	/* Look for the item using its display name, NOT
-	its drive letter/name. */
-	std::wstring displayName;
-	GetDisplayName(szDrive, SHGDN_INFOLDER, displayName);
-
 	unique_pidl_absolute pidlDrive;
-	hr = SHParseDisplayName(szDrive, nullptr, wil::out_param(pidlDrive), 0, nullptr);
+	hr = SHParseDisplayName(change.path.c_str(), nullptr, wil::out_param(pidlDrive), 0, nullptr);
 
 	if (SUCCEEDED(hr))
 	{
@@ -1196,7 +1535,7 @@ void ShellBrowser::UpdateDriveIcon(const TCHAR *szDrive)
 			ListView_GetItem(m_hListView, &lvItem);
 
 			if (ArePidlsEquivalent(
-					pidlDrive.get(), m_itemInfoMap.at((int) lvItem.lParam).pidlComplete.get()))
+					pidlDrive.get(), m_itemInfoMap.Get((int) lvItem.lParam).pidlComplete.get()))
 			{
 				iItem = i;
 				iItemInternal = (int) lvItem.lParam;
@@ -1208,13 +1547,15 @@ void ShellBrowser::UpdateDriveIcon(const TCHAR *szDrive)
 
 	if (iItem != -1)
 	{
-		SHGetFileInfo(szDrive, 0, &shfi, sizeof(shfi), SHGFI_SYSICONINDEX);
+		std::wstring displayName = change.displayName;
 
-		m_itemInfoMap.at(iItemInternal).displayName = displayName;
+		auto &itemInfo = m_itemInfoMap.Get(iItemInternal);
+		itemInfo.displayName = displayName;
+		itemInfo.basicItemInfo.reset();
 
 		/* Update the drives icon and display name. */
 		lvItem.mask = LVIF_TEXT | LVIF_IMAGE;
-		lvItem.iImage = shfi.iIcon;
+		lvItem.iImage = change.iconIndex;
 		lvItem.iItem = iItem;
 		lvItem.iSubItem = 0;
 		lvItem.pszText = displayName.data();
@@ -1235,9 +1576,9 @@ void ShellBrowser::RemoveDrive(const TCHAR *szDrive)
 		lvItem.iSubItem = 0;
 		ListView_GetItem(m_hListView, &lvItem);
 
-		if (m_itemInfoMap.at((int) lvItem.lParam).bDrive)
+		if (m_itemInfoMap.Get((int) lvItem.lParam).bDrive)
 		{
-			if (lstrcmp(szDrive, m_itemInfoMap.at((int) lvItem.lParam).szDrive) == 0)
+			if (lstrcmp(szDrive, m_itemInfoMap.Get((int) lvItem.lParam).szDrive) == 0)
 			{
 				iItemInternal = (int) lvItem.lParam;
 				break;
@@ -1256,20 +1597,99 @@ int ShellBrowser::GetUniqueFolderId() const
 	return m_uniqueFolderId;
 }
 
-BasicItemInfo_t ShellBrowser::getBasicItemInfo(int internalIndex) const
+BrowserDiagnostics ShellBrowser::GetDiagnostics() const
+{
+	BrowserDiagnostics diagnostics = GetTaskDiagnostics();
+	diagnostics.itemInfoBytes = EstimateItemInfoMemoryUsage();
+
+	for (int imageListType : { LVSIL_NORMAL, LVSIL_SMALL })
+	{
+		HIMAGELIST imageList = ListView_GetImageList(m_hListView, imageListType);
+
+		if (!imageList)
+		{
+			continue;
+		}
+
+		int width;
+		int height;
+		ImageList_GetIconSize(imageList, &width, &height);
+
+		// Each image is stored as a 32bpp bitmap.
+		diagnostics.imageListBytes +=
+			static_cast<size_t>(ImageList_GetImageCount(imageList)) * width * height * 4;
+	}
+
+	return diagnostics;
+}
+
+BrowserDiagnostics ShellBrowser::GetTaskDiagnostics() const
+{
+	BrowserDiagnostics diagnostics;
+	diagnostics.lastNavigation = m_navigationTiming;
+	diagnostics.pendingColumnTasks = m_columnResultIds.size();
+	diagnostics.pendingThumbnailTasks = m_thumbnailResultIds.size();
+	diagnostics.pendingIconTasks = m_iconFetcher->GetNumPendingTasks();
+	diagnostics.filterEvaluationPending = (m_filterEvaluation != nullptr);
+	diagnostics.columnResultsProcessed = m_numColumnResultsProcessed;
+	diagnostics.thumbnailResultsProcessed = m_numThumbnailResultsProcessed;
+	diagnostics.iconResultsProcessed = m_iconFetcher->GetNumResultsProcessed();
+	diagnostics.numItems = m_itemInfoMap.Size();
+
+	return diagnostics;
+}
+
+// Includes the heap allocations owned by each item, but not any overhead from the allocator
+// itself.
+size_t ShellBrowser::EstimateItemInfoMemoryUsage() const
+{
+	size_t total = 0;
+
+	for (const auto &[internalIndex, itemInfo] : m_itemInfoMap)
+	{
+		total += sizeof(std::unique_ptr<ItemInfo_t>) + sizeof(ItemInfo_t);
+		total += ILGetSize(itemInfo.pidlComplete.get()) + ILGetSize(itemInfo.pridl.get());
+		total += (itemInfo.parsingName.capacity() + itemInfo.displayName.capacity()
+					 + itemInfo.editingName.capacity() + itemInfo.relativeFolder.capacity())
+			* sizeof(wchar_t);
+
+		if (itemInfo.nameCollationKey)
+		{
+			total += itemInfo.nameCollationKey->text.capacity() * sizeof(wchar_t)
+				+ itemInfo.nameCollationKey->key.capacity();
+		}
+	}
+
+	return total;
+}
+
+// Returns a shared, immutable copy of the item's basic information. The copy is only built the
+// first time it's requested (or the first time after the item has changed), so queuing tasks for
+// an item, or comparing it while sorting, doesn't require any allocations.
+std::shared_ptr<const BasicItemInfo_t> ShellBrowser::getBasicItemInfo(int internalIndex) const
 {
-	const ItemInfo_t &itemInfo = m_itemInfoMap.at(internalIndex);
+	const ItemInfo_t &itemInfo = m_itemInfoMap.Get(internalIndex);
+
+	if (itemInfo.basicItemInfo)
+	{
+		return itemInfo.basicItemInfo;
+	}
 
-	BasicItemInfo_t basicItemInfo;
-	basicItemInfo.pidlComplete.reset(ILCloneFull(itemInfo.pidlComplete.get()));
-	basicItemInfo.pridl.reset(ILCloneChild(itemInfo.pridl.get()));
-	basicItemInfo.wfd = itemInfo.wfd;
-	basicItemInfo.isFindDataValid = itemInfo.isFindDataValid;
-	StringCchCopy(basicItemInfo.szDisplayName, SIZEOF_ARRAY(basicItemInfo.szDisplayName),
+	auto basicItemInfo = std::make_shared<BasicItemInfo_t>();
+	basicItemInfo->pidlComplete.reset(ILCloneFull(itemInfo.pidlComplete.get()));
+	basicItemInfo->pridl.reset(ILCloneChild(itemInfo.pridl.get()));
+	basicItemInfo->wfd = itemInfo.wfd;
+	basicItemInfo->isFindDataValid = itemInfo.isFindDataValid;
+	StringCchCopy(basicItemInfo->szDisplayName, SIZEOF_ARRAY(basicItemInfo->szDisplayName),
 		itemInfo.displayName.c_str());
-	basicItemInfo.isRoot = itemInfo.bDrive;
+	basicItemInfo->isRoot = itemInfo.bDrive;
+	basicItemInfo->parsingPath = std::make_shared<const std::wstring>(itemInfo.parsingName);
+	basicItemInfo->allowCloudHydration = m_allowCloudHydration;
+	basicItemInfo->relativeFolder = itemInfo.relativeFolder;
+
+	itemInfo.basicItemInfo = std::move(basicItemInfo);
 
-	return basicItemInfo;
+	return itemInfo.basicItemInfo;
 }
 
 HWND ShellBrowser::GetListView() const
@@ -1390,17 +1810,15 @@ HRESULT ShellBrowser::CopySelectedItemsToClipboard(bool copy)
 
 		if (SUCCEEDED(hr))
 		{
-			UpdateCurrentClipboardObject(clipboardDataObject);
-
+			std::unordered_set<int> cutItems;
 			int item = -1;
 
 			while ((item = ListView_GetNextItem(m_hListView, item, LVNI_SELECTED)) != -1)
 			{
-				std::wstring filename = GetItemName(item);
-				m_cutFileNames.emplace_back(filename);
-
-				MarkItemAsCut(item, true);
+				cutItems.insert(GetItemInternalIndex(item));
 			}
+
+			UpdateCurrentClipboardObject(clipboardDataObject, cutItems);
 		}
 	}
 
@@ -1408,34 +1826,93 @@ HRESULT ShellBrowser::CopySelectedItemsToClipboard(bool copy)
 }
 
 void ShellBrowser::UpdateCurrentClipboardObject(
-	wil::com_ptr_nothrow<IDataObject> clipboardDataObject)
+	wil::com_ptr_nothrow<IDataObject> clipboardDataObject, const std::unordered_set<int> &cutItems)
 {
-	RestoreStateOfCutItems();
+	// Any previously cut items need to have their state restored here, rather than in the
+	// WM_CLIPBOARDUPDATE handler, since that handler will only run once the new data object has
+	// been placed on the clipboard.
+	UpdateCutItems(cutItems);
 
 	m_clipboardDataObject = clipboardDataObject;
 }
 
 void ShellBrowser::OnClipboardUpdate()
 {
-	if (m_clipboardDataObject && OleIsCurrentClipboard(m_clipboardDataObject.get()) == S_FALSE)
+	// Clipboard updates that occur while this instance doesn't own a data object (e.g. those
+	// triggered by other applications) have no effect on the cut state of any items.
+	if (!m_clipboardDataObject)
+	{
+		return;
+	}
+
+	if (OleIsCurrentClipboard(m_clipboardDataObject.get()) == S_FALSE)
 	{
-		RestoreStateOfCutItems();
+		UpdateCutItems({});
 
-		m_cutFileNames.clear();
 		m_clipboardDataObject.reset();
 	}
 }
 
-void ShellBrowser::RestoreStateOfCutItems()
+// Only items whose cut state is actually changing are updated. When only a few items change, each
+// is located individually. Otherwise, a single pass is made over the listview, since locating an
+// item is itself a linear search.
+void ShellBrowser::UpdateCutItems(const std::unordered_set<int> &cutItems)
 {
-	// FIXME: Should base this off something other than the filename (which can change).
-	for (const auto &filename : m_cutFileNames)
+	std::unordered_set<int> changedItems;
+
+	for (int internalIndex : m_cutItems)
+	{
+		if (!cutItems.contains(internalIndex))
+		{
+			changedItems.insert(internalIndex);
+		}
+	}
+
+	for (int internalIndex : cutItems)
+	{
+		if (!m_cutItems.contains(internalIndex))
+		{
+			changedItems.insert(internalIndex);
+		}
+	}
+
+	m_cutItems = cutItems;
+
+	if (changedItems.empty())
+	{
+		return;
+	}
+
+	if (IsOwnerDataListViewActive())
+	{
+		MarkOwnerDataItemsAsCut(changedItems);
+		return;
+	}
+
+	if (changedItems.size() <= MAX_CUT_ITEMS_LOCATED_INDIVIDUALLY)
+	{
+		for (int internalIndex : changedItems)
+		{
+			auto item = LocateItemByInternalIndex(internalIndex);
+
+			if (item)
+			{
+				MarkItemAsCut(*item, m_cutItems.contains(internalIndex));
+			}
+		}
+
+		return;
+	}
+
+	int numItems = ListView_GetItemCount(m_hListView);
+
+	for (int i = 0; i < numItems; i++)
 	{
-		int item = LocateFileItemIndex(filename.c_str());
+		int internalIndex = GetItemInternalIndex(i);
 
-		if (item != -1)
+		if (changedItems.contains(internalIndex))
 		{
-			MarkItemAsCut(item, false);
+			MarkItemAsCut(i, m_cutItems.contains(internalIndex));
 		}
 	}
 }
@@ -7,14 +7,32 @@
 #include "ColumnDataRetrieval.h"
 #include "Columns.h"
 #include "FolderSettings.h"
+#include "NavigationDiagnostics.h"
 #include "NavigatorInterface.h"
 #include "ServiceProvider.h"
+#include "ShellChangeCoalescer.h"
 #include "SignalWrapper.h"
+#include "SortHelper.h"
 #include "SortModes.h"
 #include "ViewModes.h"
+#include "../Helper/DenseIdMap.h"
+#include "../Helper/DirectoryReader.h"
+#include "../Helper/FilterExpression.h"
+#include "../Helper/ItemPositionIndex.h"
+#include "../Helper/LruSlotAllocator.h"
 #include "../Helper/Macros.h"
+#include "../Helper/PackedChildPidls.h"
+#include "../Helper/ParallelWalk.h"
+#include "../Helper/ResultChannel.h"
+#include "../Helper/SharedPidl.h"
 #include "../Helper/ShellDropTargetWindow.h"
 #include "../Helper/ShellHelper.h"
+#include "../Helper/TieredThumbnailCache.h"
+#include "../Helper/TypeAheadSearch.h"
+#include "../Helper/VersionedSnapshot.h"
+#include "../Helper/WildcardMatcher.h"
+#include "../Helper/ZipArchive.h"
+#include "../Helper/iDirectoryMonitor.h"
 #include "../ThirdParty/CTPL/cpl_stl.h"
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/member.hpp>
@@ -24,9 +42,14 @@
 #include <wil/resource.h>
 #include <winrt/base.h>
 #include <thumbcache.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <future>
 #include <list>
+#include <mutex>
 #include <optional>
+#include <stop_token>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -36,12 +59,16 @@
 struct BasicItemInfo_t;
 class CachedIcons;
 struct Config;
+struct DriveChange;
+enum class InfoTipType;
 class FileActionHandler;
+class GridRenderer;
 class IconFetcher;
 class IconResourceLoader;
 __interface IExplorerplusplus;
 struct PreservedFolderState;
 struct PreservedHistoryEntry;
+class PriorityTaskScheduler;
 class ShellNavigationController;
 __interface TabNavigationInterface;
 class WindowSubclassWrapper;
@@ -52,6 +79,29 @@ typedef struct
 	ULARGE_INTEGER TotalSelectionSize;
 } FolderInfo_t;
 
+// Aggregate information about the items that are currently selected. This is updated as the
+// selection changes, so retrieving it doesn't require the selected items to be enumerated.
+struct SelectionInfo
+{
+	int numFiles = 0;
+	int numFolders = 0;
+
+	// The combined size of the selected files.
+	ULONGLONG filesSize = 0;
+
+	// The combined size of the selected folders whose sizes are known. Folder sizes are taken from
+	// the folder size cache, so this grows as the size of each selected folder is calculated.
+	ULONGLONG foldersSize = 0;
+	int numFoldersSized = 0;
+};
+
+// The progress of a sort that's waiting on the sort keys for its items to be built.
+struct PendingSortProgress
+{
+	size_t numKeysBuilt;
+	size_t numKeysTotal;
+};
+
 class ShellBrowser :
 	public ShellDropTargetWindow<int>,
 	public NavigatorInterface,
@@ -89,8 +139,41 @@ public:
 		boost::signals2::connect_position position = boost::signals2::at_back) override;
 
 	/* Get/Set current state. */
-	unique_pidl_absolute GetDirectoryIdl() const;
+	SharedPidl GetDirectoryIdl() const;
 	std::wstring GetDirectory() const;
+
+	// Records the directory this browser is going to show, without navigating to it. This allows
+	// the directory to be queried before the first navigation has taken place.
+	void SetPendingDirectory(const SharedPidl &pidlDirectory);
+
+	struct FolderListing
+	{
+		std::wstring directory;
+		std::vector<std::wstring> subfolderNames;
+	};
+
+	// Returns the subfolders of the current directory (once it's been fully enumerated) and of each
+	// recently visited directory that a snapshot has been kept for. Only filesystem directories are
+	// included.
+	std::vector<FolderListing> GetRecentFolderListings() const;
+
+	// Releases the items loaded from the current directory, along with any state associated with
+	// them. The directory itself is retained, so the items can be reloaded by refreshing.
+	void UnloadFolderContents();
+
+	// Causes the tasks this browser has queued on the background task scheduler to run ahead of
+	// those queued by any other browser. This should be called when the tab that contains this
+	// browser is selected.
+	void PrioritizeBackgroundTasks();
+
+	// The set of threads shared by every browser (and by other components, such as icon fetchers)
+	// for background work.
+	static PriorityTaskScheduler &GetBackgroundTaskScheduler();
+
+	// Starts reading the folder that the first tab will show, before any browser exists. The
+	// results are used by the first navigation, provided that it's to the same folder.
+	static void StartStartupFolderEnumeration(const std::wstring &directory);
+
 	BOOL GetAutoArrange() const;
 	void SetAutoArrange(BOOL autoArrange);
 	ViewMode GetViewMode() const;
@@ -99,25 +182,71 @@ public:
 	SortMode GetSortMode() const;
 	void SetSortMode(SortMode sortMode);
 	void SortFolder(SortMode sortMode);
+
+	// Returns the progress of the current sort, if it's still waiting on sort keys to be built in
+	// the background. The items are only reordered once all of the keys are available.
+	std::optional<PendingSortProgress> GetPendingSortProgress() const;
+
 	BOOL GetSortAscending() const;
 	BOOL SetSortAscending(BOOL bAscending);
 	BOOL GetShowHidden() const;
 	BOOL SetShowHidden(BOOL bShowHidden);
+	bool GetAllowCloudHydration() const;
+	void SetAllowCloudHydration(bool allowCloudHydration);
+
+	// In flat view, every file below the current folder is listed, rather than just the items
+	// within the folder itself. Only plain filesystem folders can be shown this way and the view
+	// is left when navigating to a different folder. As with the setting above, the folder needs
+	// to be refreshed for a change to take effect.
+	bool GetFlatView() const;
+	void SetFlatView(bool flatView);
+
+	// The remote server that the current directory is on, or an empty string if the directory is
+	// local.
+	const std::wstring &GetNetworkServer() const;
+
+	// Whether thumbnails and the more expensive columns are skipped for the current directory,
+	// because it's on a slow server (or the user has chosen to reduce activity for the server).
+	bool IsNetworkActivityReduced() const;
+
+	// Navigations to folders on a remote server are bound in the background, so that the window
+	// remains responsive if the server is slow or unreachable. The folder currently shown remains
+	// in place until the new folder has been bound.
+	bool IsNavigationPending() const;
+
+	// Abandons the pending navigation (if any), leaving the current folder in place.
+	void CancelPendingNavigation();
+
+	// Re-reads the current folder and applies only the differences to the view, so that the icons,
+	// column text and thumbnails already retrieved for unchanged items are kept, as is the scroll
+	// position. Folders that can't be read directly are refreshed in full.
+	void RefreshFolderContents();
+
 	int GetNumItems() const;
 	int GetNumSelectedFiles() const;
 	int GetNumSelectedFolders() const;
 	int GetNumSelected() const;
+	const SelectionInfo &GetSelectionInfo() const;
 
 	/* ID. */
 	int GetId() const;
 
 	/* Directory modification support. */
-	void FilesModified(DWORD Action, const TCHAR *FileName, int EventId, int iFolderIndex);
+	void FilesModified(const std::vector<DirectoryChange> &changes, bool overflowed, int EventId,
+		int iFolderIndex);
 	void DirectoryAltered();
 	void SetDirMonitorId(int iDirMonitorId);
 	int GetDirMonitorId() const;
 	int GetUniqueFolderId() const;
 
+	// Returns the timing of the most recent navigation, along with the state of any background
+	// work and an estimate of the memory used by the items in the current folder.
+	BrowserDiagnostics GetDiagnostics() const;
+
+	// The same as GetDiagnostics(), except that the memory estimates are left unset. Cheap enough
+	// to be called frequently.
+	BrowserDiagnostics GetTaskDiagnostics() const;
+
 	/* Item information. */
 	WIN32_FIND_DATA GetItemFileFindData(int index) const;
 	unique_pidl_absolute GetItemCompleteIdl(int index) const;
@@ -127,12 +256,21 @@ public:
 	std::wstring GetItemEditingName(int index) const;
 	std::wstring GetItemFullName(int index) const;
 
+	/* Color rule support. The resolver is only invoked when the item
+	hasn't been matched against the current generation of rules. */
+	using ColorRuleResolver =
+		std::function<std::optional<size_t>(const std::wstring &fullName, DWORD attributes)>;
+	std::optional<size_t> GetItemColorRule(
+		int index, int colorRuleGeneration, const ColorRuleResolver &resolver);
+
 	void ShowPropertiesForSelectedFiles() const;
 
 	/* Column support. */
 	std::vector<Column_t> GetCurrentColumns();
 	void SetCurrentColumns(const std::vector<Column_t> &columns);
 	static SortMode DetermineColumnSortMode(ColumnType columnType);
+	void AutoSizeColumn(int columnIndex);
+	void AutoSizeColumns();
 	static int LookupColumnNameStringIndex(ColumnType columnType);
 	static int LookupColumnDescriptionStringIndex(ColumnType columnType);
 
@@ -150,6 +288,22 @@ public:
 	void SetFileAttributesForSelection();
 
 	void SelectItems(const std::vector<PCIDLIST_ABSOLUTE> &pidls);
+
+	// These update the selection totals once, after the selection of every item has changed,
+	// rather than once per item.
+	void SelectAllItems();
+	void DeselectAllItems();
+	void InvertSelection();
+
+	// Selects (or deselects) every item whose filename matches the specified wildcard pattern. The
+	// pattern is case-insensitive.
+	void SelectItemsMatchingPattern(const std::wstring &pattern, bool select);
+
+	// Runs a change that may alter the selection of a large number of items. Selection totals are
+	// recalculated once the change is complete and a single selection change notification is
+	// sent.
+	void PerformBulkSelectionChange(std::function<void()> change);
+
 	void GetFolderInfo(FolderInfo_t *pFolderInfo);
 	int LocateFileItemIndex(const TCHAR *szFileName) const;
 	bool InVirtualFolder() const;
@@ -171,14 +325,26 @@ public:
 	FolderColumns ExportAllColumns();
 	void QueueRename(PCIDLIST_ABSOLUTE pidlItem);
 	void SelectItems(const std::list<std::wstring> &PastedFileList);
-	void OnDeviceChange(WPARAM wParam, LPARAM lParam);
 
 	void OnGridlinesSettingChanged();
 
 	// Signals
 	SignalWrapper<ShellBrowser, void()> directoryModified;
 	SignalWrapper<ShellBrowser, void()> listViewSelectionChanged;
+
+	// Triggered when the attributes of a large selection, which are retrieved in the background,
+	// become available. Until then, GetListViewSelectionAttributes() returns E_PENDING.
+	SignalWrapper<ShellBrowser, void()> listViewSelectionAttributesChanged;
 	SignalWrapper<ShellBrowser, void()> columnsChanged;
+	SignalWrapper<ShellBrowser, void()> listViewScrolled;
+
+	// Triggered when the listview window used by this instance is replaced by a different window
+	// (which happens when switching in and out of the owner data mode used for large folders).
+	SignalWrapper<ShellBrowser, void(HWND previousListView, HWND newListView)> listViewChanged;
+
+	// Triggered when a sort that's waiting on sort keys to be built in the background starts,
+	// makes progress or finishes. See GetPendingSortProgress().
+	SignalWrapper<ShellBrowser, void()> pendingSortProgressChanged;
 
 private:
 	DISALLOW_COPY_AND_ASSIGN(ShellBrowser);
@@ -191,6 +357,9 @@ private:
 		bool isFindDataValid;
 		std::wstring parsingName;
 		std::wstring displayName;
+
+		/* Only set if it differs from the display name, which it
+		usually doesn't. Use GetEditingName() to retrieve it. */
 		std::wstring editingName;
 		int iIcon;
 
@@ -205,9 +374,69 @@ private:
 		when items need to be rearranged). */
 		int iRelativeSort;
 
-		ItemInfo_t() : wfd({}), isFindDataValid(false), iIcon(0), bDrive(FALSE)
+		/* The collation key generated from the item's name
+		when sorting by name. Since the whole item is
+		replaced when it's renamed, this will be reset at
+		that point. The source text and flags are stored
+		so that changes to the name display settings can
+		be detected. */
+		struct NameCollationKey
+		{
+			std::wstring text;
+			bool naturalSortOrder;
+			std::vector<BYTE> key;
+		};
+
+		std::optional<NameCollationKey> nameCollationKey;
+
+		/* The color rule that matches this item, resolved against a
+		particular generation of the color rules. Like the collation
+		key above, this is reset when the item is replaced. It's also
+		reset whenever the item's attributes change. */
+		struct CachedColorRule
+		{
+			int generation;
+			std::optional<size_t> ruleIndex;
+		};
+
+		std::optional<CachedColorRule> cachedColorRule;
+
+		/* Text for any property-based columns that was read while
+		the folder was being enumerated. This is moved into the
+		column text cache once the item has been added. */
+		std::vector<std::pair<ColumnType, std::wstring>> prefetchedColumnText;
+
+		/* In flat view, the folder containing the item,
+		relative to the folder being viewed. */
+		std::wstring relativeFolder;
+
+		/* The file system's ID for the item, which stays the
+		same when the item is renamed or moved within the
+		volume. This is only known for items that were read
+		directly from an NTFS or ReFS folder (see
+		DirectoryReader) and is UNKNOWN_FILE_ID otherwise. */
+		ULONGLONG fileId;
+
+		/* An immutable copy of the item's basic information, which
+		is shared by any background tasks that need it (rather than
+		each task taking its own copy). It's created on demand by
+		getBasicItemInfo() and needs to be reset whenever any of the
+		information it contains is changed in place. */
+		mutable std::shared_ptr<const BasicItemInfo_t> basicItemInfo;
+
+		ItemInfo_t() :
+			wfd({}),
+			isFindDataValid(false),
+			iIcon(0),
+			bDrive(FALSE),
+			fileId(DirectoryReader::UNKNOWN_FILE_ID)
 		{
 		}
+
+		const std::wstring &GetEditingName() const
+		{
+			return editingName.empty() ? displayName : editingName;
+		}
 	};
 
 	struct ShellChangeNotification
@@ -229,6 +458,7 @@ private:
 		TCHAR szFileName[MAX_PATH];
 		DWORD dwAction;
 		int iFolderIndex;
+		std::optional<DirectoryChangeDetails> details;
 	};
 
 	struct AwaitingAdd_t
@@ -253,26 +483,297 @@ private:
 
 	struct ColumnResult_t
 	{
+		int columnResultId;
 		int itemInternalIndex;
+
+		// Most tasks retrieve the text for a single column. File metadata columns are retrieved
+		// together, in which case there's an entry for each of the columns that was requested.
+		std::vector<std::pair<ColumnType, std::wstring>> columnText;
+
+		// The sort keys for the sort modes that correspond to the columns above. These are only
+		// built for modes whose keys are expensive to build.
+		std::vector<std::pair<SortMode, SortKey>> sortKeys;
+
+		// The version of the task settings the text was retrieved with.
+		int settingsVersion;
+	};
+
+	struct SortKeyResult_t
+	{
+		std::vector<std::pair<int, SortKey>> sortKeys;
+		int settingsVersion;
+	};
+
+	struct PendingSortKeys
+	{
+		SortMode sortMode;
+		std::vector<int> internalIndexes;
+		std::future<SortKeyResult_t> result;
+	};
+
+	struct HistoryEntryPathResult
+	{
+		int entryIndex;
+		int entryId;
+		std::optional<std::wstring> fullPathForDisplay;
+	};
+
+	// The attributes common to every selected item, as of a particular selection change.
+	struct SelectionAttributes
+	{
+		int selectionVersion;
+		HRESULT hr;
+		SFGAOF attributes;
+	};
+
+	using TaskSettings = VersionedSnapshot<GlobalFolderSettings>::Snapshot;
+
+	// The settings the cached info tips were retrieved with.
+	struct InfoTipCacheSettings
+	{
+		int settingsVersion;
+		InfoTipType infoTipType;
+	};
+
+	// A column whose text is read directly from a property of each item. The text for these
+	// columns can be read while the folder is being enumerated.
+	struct PrefetchColumn
+	{
 		ColumnType columnType;
-		std::wstring columnText;
+		PROPERTYKEY propertyKey;
+	};
+
+	// Shared between the UI thread and the enumeration worker. The worker appends items to
+	// pendingItems in chunks and posts WM_APP_ENUMERATION_RESULTS_READY; the UI thread then drains
+	// the list. Navigating away sets the cancelled flag, after which the worker stops fetching
+	// items and any results it has already posted are ignored.
+	struct EnumerationState
+	{
+		const int enumerationId;
+		const unique_pidl_absolute pidlDirectory;
+		const SHCONTF enumFlags;
+		const bool isRecycleBin;
+
+		// The path of the folder, if it's a plain filesystem folder that can be read directly.
+		// Empty otherwise.
+		const std::wstring fileSystemPath;
+
+		// Set in flat view, in which case every file below fileSystemPath is enumerated.
+		const bool recursive;
+
+		// Set if the folder is within a zip archive, in which case its contents are read directly
+		// from the archive.
+		const std::optional<ZipArchiveLocation> archiveLocation;
+
+		const std::vector<PrefetchColumn> prefetchColumns;
+		const BOOL showFriendlyDates;
+
+		std::atomic<bool> cancelled;
+
+		std::mutex mutex;
+		std::vector<ItemInfo_t> pendingItems;
+		bool finished;
+
+		// Set by the worker once it's finished, before the final results are posted. Guarded by
+		// the mutex above.
+		std::chrono::steady_clock::duration enumerationDuration = {};
+		std::chrono::steady_clock::duration itemInfoDuration = {};
+
+		EnumerationState(int enumerationId, PCIDLIST_ABSOLUTE pidlDirectory, SHCONTF enumFlags,
+			bool isRecycleBin, const std::wstring &fileSystemPath, bool recursive,
+			const std::optional<ZipArchiveLocation> &archiveLocation,
+			const std::vector<PrefetchColumn> &prefetchColumns, BOOL showFriendlyDates) :
+			enumerationId(enumerationId),
+			pidlDirectory(ILCloneFull(pidlDirectory)),
+			enumFlags(enumFlags),
+			isRecycleBin(isRecycleBin),
+			fileSystemPath(fileSystemPath),
+			recursive(recursive),
+			archiveLocation(archiveLocation),
+			prefetchColumns(prefetchColumns),
+			showFriendlyDates(showFriendlyDates),
+			cancelled(false),
+			finished(false)
+		{
+		}
+	};
+
+	// Called for each item found during an enumeration. The find data is only available when the
+	// item was read directly from the filesystem (or an archive) and the file ID is only available
+	// when the filesystem provides one.
+	using AddEnumeratedItem = std::function<void(
+		PCITEMID_CHILD pidlChild, const WIN32_FIND_DATA *findData, ULONGLONG fileId)>;
+
+	// A folder that's read during a flat view enumeration. relativePath is the path of the folder
+	// relative to the folder being viewed and is empty for that folder itself.
+	struct FlatViewFolder
+	{
+		unique_pidl_absolute pidl;
+		std::wstring path;
+		std::wstring relativePath;
+	};
+
+	// The result of binding to a folder and checking that it can be enumerated. This is the part of
+	// a navigation that may have to wait on the network.
+	struct FolderBindResult
+	{
+		HRESULT hr = E_FAIL;
+		SFGAOF attributes = 0;
+		std::wstring parsingPath;
+		std::chrono::steady_clock::duration duration = {};
+	};
+
+	// A navigation to a remote folder that's being bound in the background. The navigation is
+	// committed once the bind has succeeded, unless it's cancelled or superseded before then.
+	struct PendingNavigation
+	{
+		int navigationId;
+		unique_pidl_absolute pidlDirectory;
+		bool addHistoryEntry;
+		std::wstring server;
+		SHCONTF enumFlags;
+		std::chrono::steady_clock::time_point startTime;
+		std::future<FolderBindResult> result;
+
+		// The items to select once the folder has loaded, when navigating to a history entry.
+		std::optional<PackedChildPidls> selectedItems;
+	};
+
+	// The result of re-reading the current folder for an incremental refresh. Items whose
+	// fingerprint matches an existing item are unchanged and only their fingerprint is recorded.
+	// Everything else is either new or has changed.
+	struct FolderRefreshResult
+	{
+		std::unordered_set<size_t> unchangedFingerprints;
+		std::vector<ItemInfo_t> changedItems;
+	};
+
+	struct PendingRefresh
+	{
+		int folderId;
+		std::future<std::optional<FolderRefreshResult>> result;
+	};
+
+	// The items from a filesystem folder that was recently navigated away from. If the folder is
+	// navigated back to, the items are shown straight away, rather than the folder being
+	// enumerated again. The fingerprint summarizes the name, size, timestamp and attributes of
+	// each item. It's recomputed in the background once the snapshot has been shown and if it no
+	// longer matches, the folder is refreshed.
+	struct FolderSnapshot
+	{
+		std::wstring directory;
+		SHCONTF enumFlags;
+		std::vector<ItemInfo_t> items;
+		size_t fingerprint;
+	};
+
+	// A folder that's read in the background while the main window is being created (see
+	// StartStartupFolderEnumeration()). Hidden items are always included, so that the results can
+	// be used regardless of the settings the first tab ends up with.
+	struct StartupFolderEnumeration
+	{
+		std::wstring requestedDirectory;
+		std::stop_source stopSource;
+		std::future<std::optional<FolderSnapshot>> result;
+	};
+
+	// The names of the items in the folder, stored contiguously and (for a case-insensitive match)
+	// already lowercased. The table is built once and then reused each time the filter changes, so
+	// that the names don't have to be copied or lowercased again on each keystroke. It's immutable
+	// once built, which allows it to be shared with the filter worker. Adding, removing or renaming
+	// an item discards the table, and it's rebuilt the next time it's needed.
+	// Three tables are kept: one of display names (used by the filter), one of filenames (used
+	// when selecting items that match a wildcard pattern) and one of lowercased display names
+	// (used by type-ahead, see OnListViewChar()).
+	struct ItemNameTable
+	{
+		bool caseSensitive = false;
+		std::wstring names;
+
+		// Indexed by internal index. Each entry is the offset and length of an item's name within
+		// the buffer above.
+		std::vector<std::pair<size_t, size_t>> ranges;
+
+		std::wstring_view GetName(int internalIndex) const
+		{
+			const auto &[offset, length] = ranges[internalIndex];
+			return { names.data() + offset, length };
+		}
+	};
+
+	// Shared between the UI thread and the filter worker. The UI thread collects the internal index
+	// of each item that needs to be tested, the worker tests each item, then posts
+	// WM_APP_FILTER_RESULTS_READY. Changing the filter again sets the cancelled flag, after which
+	// the worker stops and any results it posts are ignored.
+	struct FilterEvaluation
+	{
+		const int evaluationId;
+		const WildcardMatcher matcher;
+
+		// Set if the filter is an expression, in which case it's used instead of the matcher
+		// above and is evaluated over itemTable.
+		const std::optional<FilterExpression> expression;
+		const std::shared_ptr<const FilterItemTable> itemTable;
+
+		const std::shared_ptr<const ItemNameTable> names;
+		const std::vector<int> items;
+
+		// Used to report how long it took for a change to the filter to be reflected in the
+		// listview.
+		const std::chrono::steady_clock::time_point startTime;
+
+		// Only accessed on the UI thread. Items that have been updated or renamed while the
+		// evaluation was in progress. The names tested for these items may be out of date.
+		std::unordered_set<int> changedItems;
+
+		std::atomic<bool> cancelled;
+
+		std::mutex mutex;
+		std::vector<bool> matches;
+		bool finished;
+
+		FilterEvaluation(int evaluationId, const WildcardMatcher &matcher,
+			const std::optional<FilterExpression> &expression,
+			std::shared_ptr<const FilterItemTable> itemTable,
+			std::shared_ptr<const ItemNameTable> names, std::vector<int> items,
+			std::chrono::steady_clock::time_point startTime) :
+			evaluationId(evaluationId),
+			matcher(matcher),
+			expression(expression),
+			itemTable(std::move(itemTable)),
+			names(std::move(names)),
+			items(std::move(items)),
+			startTime(startTime),
+			cancelled(false),
+			finished(false)
+		{
+		}
 	};
 
 	struct ThumbnailResult_t
 	{
+		int thumbnailResultId;
 		int itemInternalIndex;
+
+		// Null if the thumbnail couldn't be retrieved.
 		wil::unique_hbitmap bitmap;
 	};
 
 	struct InfoTipResult
 	{
 		int itemInternalIndex;
-		std::wstring infoTip;
+
+		// This is empty if the info tip couldn't be retrieved.
+		std::optional<std::wstring> infoTip;
 	};
 
 	struct GroupInfo
 	{
+		// Groups whose header is a fixed string (e.g. the date and size groups) are identified by
+		// the ID of that string instead of the string itself. That way, the string only has to be
+		// loaded once per group, rather than once per item. For these groups, the name is empty.
 		std::wstring name;
+		std::optional<UINT> nameResourceId;
 		int relativeSortPosition;
 
 		explicit GroupInfo(const std::wstring &name) : name(name), relativeSortPosition(0)
@@ -284,6 +785,12 @@ private:
 			relativeSortPosition(relativeSortPosition)
 		{
 		}
+
+		GroupInfo(UINT nameResourceId, int relativeSortPosition) :
+			nameResourceId(nameResourceId),
+			relativeSortPosition(relativeSortPosition)
+		{
+		}
 	};
 
 	struct ListViewGroup
@@ -293,11 +800,16 @@ private:
 		int relativeSortPosition;
 		int numItems;
 
-		ListViewGroup(int id, const GroupInfo &groupInfo) :
+		// Generated once, when the group is created, so that groups can be ordered by name
+		// without a string comparison each time.
+		std::vector<BYTE> nameCollationKey;
+
+		ListViewGroup(int id, const GroupInfo &groupInfo, std::vector<BYTE> nameCollationKey) :
 			id(id),
 			name(groupInfo.name),
 			relativeSortPosition(groupInfo.relativeSortPosition),
-			numItems(0)
+			numItems(0),
+			nameCollationKey(std::move(nameCollationKey))
 		{
 		}
 	};
@@ -311,9 +823,14 @@ private:
 
 	struct DirectoryState
 	{
-		unique_pidl_absolute pidlDirectory;
+		SharedPidl pidlDirectory;
 		std::wstring directory;
 		bool virtualFolder;
+
+		// Classified once, when the folder is navigated to, so that sorting, grouping and column
+		// selection don't have to look up the special folder paths again.
+		FolderType folderType;
+
 		int itemIDCounter;
 
 		/* Stores information on files that have
@@ -324,28 +841,59 @@ private:
 		std::unordered_set<int> filteredItemsList;
 
 		int numItems;
-		int numFilesSelected;
-		int numFoldersSelected;
 		ULARGE_INTEGER totalDirSize;
-		ULARGE_INTEGER fileSelectionSize;
 
-		/* Cached folder size data. */
-		mutable std::unordered_map<int, ULONGLONG> cachedFolderSizes;
+		SelectionInfo selectionInfo;
+
+		// Each selected folder, along with its size (if known). The size of a folder is only
+		// included in the selection totals once it's been calculated.
+		std::unordered_map<int, std::optional<ULONGLONG>> selectedFolderSizes;
 
 		std::vector<ShellChangeNotification> shellChangeNotifications;
 
+		// Items that were requested to be selected while the folder was still being enumerated.
+		// The selection will be applied once enumeration completes.
+		std::vector<unique_pidl_absolute> pendingSelection;
+
+		// As above, but for a selection restored from a history entry.
+		PackedChildPidls pendingChildSelection;
+
 		DirectoryState() :
 			virtualFolder(false),
+			folderType(FolderType::General),
 			itemIDCounter(0),
 			numItems(0),
-			numFilesSelected(0),
-			numFoldersSelected(0),
-			totalDirSize({}),
-			fileSelectionSize({})
+			totalDirSize({})
 		{
 		}
 	};
 
+	// In owner data mode, the listview doesn't store any item data itself. Instead, the display
+	// order of the items is stored here and everything the listview needs is provided on demand
+	// (via LVN_GETDISPINFO).
+	struct OwnerDataItemState
+	{
+		std::optional<int> iconIndex;
+		bool iconRequested = false;
+		bool cut = false;
+	};
+
+	struct OwnerDataState
+	{
+		// The internal index of each item, in display order.
+		std::vector<int> items;
+
+		std::unordered_map<int, OwnerDataItemState> itemStates;
+	};
+
+	struct OwnerDataItemImage
+	{
+		int iconIndex;
+
+		// 0 if the item doesn't have an overlay.
+		int overlayIndex;
+	};
+
 	// clang-format off
 	using ListViewGroupSet = boost::multi_index_container<ListViewGroup,
 		boost::multi_index::indexed_by<
@@ -361,16 +909,191 @@ private:
 
 	static const UINT_PTR LISTVIEW_SUBCLASS_ID = 0;
 
-	static const UINT WM_APP_COLUMN_RESULT_READY = WM_APP + 150;
-	static const UINT WM_APP_THUMBNAIL_RESULT_READY = WM_APP + 151;
+	static const UINT WM_APP_COLUMN_RESULTS_READY = WM_APP + 150;
+	static const UINT WM_APP_THUMBNAIL_RESULTS_READY = WM_APP + 151;
 	static const UINT WM_APP_INFO_TIP_READY = WM_APP + 152;
 	static const UINT WM_APP_SHELL_NOTIFY = WM_APP + 153;
-
-	static const int THUMBNAIL_ITEM_WIDTH = 120;
-	static const int THUMBNAIL_ITEM_HEIGHT = 120;
+	static const UINT WM_APP_ENUMERATION_RESULTS_READY = WM_APP + 154;
+	static const UINT WM_APP_FILTER_RESULTS_READY = WM_APP + 155;
+	static const UINT WM_APP_FOLDER_SNAPSHOT_VALIDATED = WM_APP + 156;
+	static const UINT WM_APP_SELECTION_CHANGED = WM_APP + 157;
+	static const UINT WM_APP_ACCOUNT_NAMES_RESOLVED = WM_APP + 158;
+	static const UINT WM_APP_SORT_KEYS_READY = WM_APP + 159;
+	static const UINT WM_APP_HISTORY_ENTRY_PATH_READY = WM_APP + 160;
+	static const UINT WM_APP_SELECTION_ATTRIBUTES_READY = WM_APP + 161;
+	static const UINT WM_APP_NAVIGATION_BOUND = WM_APP + 162;
+	static const UINT WM_APP_FOLDER_REFRESH_READY = WM_APP + 163;
+
+	static const size_t MAX_FOLDER_SNAPSHOTS = 4;
+	static const size_t MAX_FOLDER_SNAPSHOT_ITEMS = 10000;
+
+	// The size of the thumbnails at 96 DPI. The actual size is scaled for the DPI of the listview.
+	static const int THUMBNAIL_ITEM_SIZE = 120;
+
+	// Thumbnails are extracted once at this size. Smaller sizes (e.g. when the DPI changes) are
+	// generated from the extracted image, rather than being extracted again.
+	static const int THUMBNAIL_EXTRACT_SIZE = 256;
+
+	// The maximum total size of the extracted thumbnail images (and any scaled copies of them)
+	// that are kept in memory. This is shared by every tab.
+	static const size_t THUMBNAIL_IMAGE_CACHE_MAX_BYTES = 128 * 1024 * 1024;
+
+	// Column, thumbnail and info tip tasks from every tab are run on a single, shared set of
+	// worker threads.
+	static const int BACKGROUND_TASK_MAX_THREADS = 4;
+
+	// The number of background tasks that can access a single remote server at once. Tasks for
+	// the same server would otherwise occupy every thread while waiting on the network, holding up
+	// tasks for local folders in other tabs.
+	static const int NETWORK_SERVER_MAX_TASKS = 2;
+
+	// When network activity is reduced, owner and version columns are retrieved only once every
+	// other task has run.
+	static const int DEFERRED_COLUMN_TASK_PRIORITY = 1000;
+
+	// Column and thumbnail tasks are prioritized by the distance (in items) between the item and
+	// the visible range. Once the listview has been scrolled, tasks for items that are more than
+	// this many pages away from the visible range are cancelled.
+	static const int BACKGROUND_TASK_RETAIN_PAGES = 2;
+
+	// When scrolling in thumbnails view, the thumbnails for this many pages of items beyond the
+	// visible range (in the direction of the scroll) are retrieved ahead of time. This needs to be
+	// no more than BACKGROUND_TASK_RETAIN_PAGES, or the tasks would be cancelled straight away.
+	static const int THUMBNAIL_PREFETCH_PAGES = 1;
+
+	// The number of thumbnail images kept, as a multiple of the number of thumbnails that would
+	// fit on the screen.
+	static const int THUMBNAIL_SLOT_SCREENS = 3;
+
+	// When a large selection is dragged, the drag image only shows the icons of this many items.
+	static const size_t MAX_DRAG_IMAGE_ITEMS = 8;
+
+	// When the cut state of more items than this changes, the listview is scanned once, rather
+	// than each item being located individually.
+	static const size_t MAX_CUT_ITEMS_LOCATED_INDIVIDUALLY = 16;
+
+	// Info tips are shown in response to the user hovering over an item, so they're always run
+	// ahead of any other queued tasks.
+	static const int INFO_TIP_TASK_PRIORITY = -1;
+
+	// The UI thread waits for the groups of items to be determined, so those tasks are also run
+	// ahead of column and thumbnail tasks.
+	static const int GROUP_INFO_TASK_PRIORITY = -1;
+
+	// Sorting waits for any missing sort keys to be built, so those tasks are run ahead of column
+	// and thumbnail tasks as well.
+	static const int SORT_KEY_TASK_PRIORITY = -1;
+
+	// When an expensive column is shown, the sort keys for that column are built for every item,
+	// so that they're available if the folder is then sorted by the column. Nothing is waiting on
+	// those keys, so they're only built once the tasks for the visible items have run. If a sort
+	// then needs the keys, the remaining tasks are moved up to SORT_KEY_TASK_PRIORITY.
+	static const int SORT_KEY_PREFETCH_TASK_PRIORITY = 500;
+
+	// The path for the current history entry is shown in the address bar as soon as it's
+	// available, so it's resolved ahead of column and thumbnail tasks.
+	static const int HISTORY_ENTRY_PATH_TASK_PRIORITY = -1;
+
+	// Toolbar buttons and menu items that depend on the attributes of a large selection are
+	// disabled until the attributes are known, so they're retrieved ahead of column and thumbnail
+	// tasks.
+	static const int SELECTION_ATTRIBUTES_TASK_PRIORITY = -1;
+
+	// The attributes of a selection of this many items or fewer are retrieved on the UI thread.
+	static const UINT MAX_SYNCHRONOUS_SELECTION_ATTRIBUTES_ITEMS = 100;
+
+	// The attributes retrieved for each selection. These are the attributes that the toolbar and
+	// menu enablement code checks.
+	static const SFGAOF SELECTION_ATTRIBUTES_MASK =
+		SFGAO_CAPABILITYMASK | SFGAO_FILESYSTEM | SFGAO_FOLDER;
+
+	// The filter is re-evaluated as the user types, so that takes precedence over any other task.
+	static const int FILTER_TASK_PRIORITY = -2;
 
 	static const UINT PROCESS_SHELL_CHANGES_TIMER_ID = 1;
+	static const UINT INFO_TIP_PREFETCH_TIMER_ID = 2;
+	static const UINT PROCESS_COLUMN_RESULTS_TIMER_ID = 3;
+	static const UINT PROCESS_THUMBNAIL_RESULTS_TIMER_ID = 4;
+	static const UINT PENDING_NAVIGATION_TIMEOUT_TIMER_ID = 5;
+
+	// If a remote folder hasn't been bound within this time, the navigation fails and the server
+	// is treated as unreachable for a while (see NetworkLocationPolicy).
+	static constexpr std::chrono::milliseconds PENDING_NAVIGATION_TIMEOUT{ 15000 };
+
+	// Binds that are abandoned (because they timed out or were cancelled) keep running until the
+	// network request returns, so several threads are available for binding.
+	static const int NAVIGATION_BIND_THREADS = 4;
+
+	// Column and thumbnail results are applied in batches. Each batch is limited to roughly this
+	// long, after which any remaining results are left until pending input has been handled.
+	static constexpr std::chrono::milliseconds RESULT_BATCH_TIME_BUDGET{ 8 };
+
+	// Once the mouse has been still over an item for this long (in milliseconds), the item's info
+	// tip is retrieved in the background. This is well below the delay before the tooltip is
+	// shown, so the info tip is typically ready by the time it's requested.
+	static const UINT INFO_TIP_PREFETCH_DELAY = 100;
+
+	// Shell change notifications are collected and then processed as a single batch. The delay
+	// before a batch is processed starts at the minimum timeout and is doubled (up to the maximum)
+	// each time a batch contains at least SHELL_CHANGES_HEAVY_CHURN_THRESHOLD notifications. It
+	// then falls back once the rate of changes drops.
 	static const UINT PROCESS_SHELL_CHANGES_TIMEOUT = 100;
+	static const UINT PROCESS_SHELL_CHANGES_MAX_TIMEOUT = 1600;
+	static const size_t SHELL_CHANGES_HEAVY_CHURN_THRESHOLD = 200;
+
+	// The number of items requested from IEnumIDList::Next() at a time.
+	static const ULONG ENUMERATION_BATCH_SIZE = 256;
+
+	// Enumerated items are handed to the UI thread once this many have been retrieved, or once
+	// ENUMERATION_CHUNK_INTERVAL has elapsed since the last chunk, whichever happens first.
+	static const size_t ENUMERATION_CHUNK_SIZE = 2000;
+	static constexpr std::chrono::milliseconds ENUMERATION_CHUNK_INTERVAL{ 200 };
+
+	// Most folders can be enumerated very quickly. The UI thread will wait up to this long for
+	// enumeration to finish, so that small folders are still shown in a single step, without the
+	// list view being briefly displayed as empty.
+	static constexpr std::chrono::milliseconds SYNCHRONOUS_ENUMERATION_TIMEOUT{ 100 };
+
+	// As with enumeration, the UI thread will wait briefly for the filter to be evaluated, so that
+	// the result is shown immediately in all but the largest folders.
+	static constexpr std::chrono::milliseconds SYNCHRONOUS_FILTER_TIMEOUT{ 50 };
+
+	// Characters typed into the listview are combined into a single search, provided that each is
+	// typed within this long of the previous one.
+	static constexpr std::chrono::milliseconds TYPE_AHEAD_TIMEOUT{ 1000 };
+
+	// The number of items the filter worker tests between checks for cancellation.
+	static const size_t FILTER_CANCELLATION_CHECK_INTERVAL = 1000;
+
+	// Changes to the filter that take longer than this to be reflected in the listview are logged
+	// as warnings. The filter is updated each time a character is typed into the quick filter
+	// bar, so anything longer is noticeable.
+	static constexpr std::chrono::milliseconds FILTER_LATENCY_TARGET{ 100 };
+
+	// When the groups for a set of items need to be determined using slow queries, the items are
+	// split into batches of this size, which are then processed in parallel by the background
+	// task scheduler.
+	static const size_t GROUP_INFO_BATCH_SIZE = 32;
+
+	// Sort keys that are expensive to build are built in the background, in batches of this size.
+	// If no more than a single batch of keys is missing, the keys are simply built on the UI
+	// thread instead.
+	static const size_t SORT_KEY_BATCH_SIZE = 32;
+
+	// When auto-sizing a column, the listview measures the text of every item, which, with
+	// callback text, means requesting the text of every item in turn on the UI thread. Folders with
+	// more items than this have the column width estimated from the cached column text instead.
+	static const int AUTOSIZE_ESTIMATE_MIN_ITEMS = 1000;
+
+	// When estimating a column's width, only this many of the longest strings are measured. Text
+	// width is roughly proportional to the number of characters, so this gives a close upper bound
+	// without having to measure every string.
+	static const size_t AUTOSIZE_MEASURED_TEXT_LIMIT = 1000;
+
+	// The space added to the measured text width, at 96 DPI. This approximates the margins the
+	// listview itself adds when auto-sizing a column.
+	static const int AUTOSIZE_TEXT_PADDING = 12;
+	static const int AUTOSIZE_ICON_PADDING = 4;
 
 	ShellBrowser(int id, HWND hOwner, IExplorerplusplus *coreInterface,
 		TabNavigationInterface *tabNavigation, FileActionHandler *fileActionHandler,
@@ -380,7 +1103,7 @@ private:
 		TabNavigationInterface *tabNavigation, FileActionHandler *fileActionHandler,
 		const FolderSettings &folderSettings, std::optional<FolderColumns> initialColumns);
 
-	static HWND CreateListView(HWND parent);
+	static HWND CreateListView(HWND parent, bool ownerData = false);
 	void InitializeListView();
 	int GenerateUniqueItemId();
 	void MarkItemAsCut(int item, bool cut);
@@ -391,13 +1114,72 @@ private:
 	HRESULT BrowseFolder(PCIDLIST_ABSOLUTE pidlDirectory, bool addHistoryEntry = true) override;
 
 	/* Browsing support. */
-	HRESULT EnumerateFolder(PCIDLIST_ABSOLUTE pidlDirectory, bool addHistoryEntry,
-		std::vector<ItemInfo_t> &items);
-	void PrepareToChangeFolders();
+	HRESULT EnumerateFolder(PCIDLIST_ABSOLUTE pidlDirectory, bool addHistoryEntry);
+	static FolderBindResult BindFolder(
+		PCIDLIST_ABSOLUTE pidlDirectory, HWND owner, SHCONTF enumFlags);
+	HRESULT StartPendingNavigation(PCIDLIST_ABSOLUTE pidlDirectory, bool addHistoryEntry,
+		const std::wstring &server, SHCONTF enumFlags,
+		std::chrono::steady_clock::time_point startTime);
+	void OnPendingNavigationBound(int navigationId);
+	void OnPendingNavigationTimeout();
+	void AbandonPendingNavigation();
+	HRESULT CommitNavigation(PCIDLIST_ABSOLUTE pidlDirectory, bool addHistoryEntry,
+		const FolderBindResult &bindResult, SHCONTF enumFlags,
+		std::chrono::steady_clock::time_point startTime);
+	static ctpl::thread_pool &GetNavigationBindThreadPool();
+	static void EnumerateFolderAsync(HWND listView, std::shared_ptr<EnumerationState> state);
+	static HRESULT EnumerateFileSystemFolder(const EnumerationState &state,
+		IShellFolder *shellFolder, const AddEnumeratedItem &addItem,
+		const std::function<void()> &postResultsIfReady);
+	static HRESULT EnumerateArchiveFolder(const EnumerationState &state, IShellFolder *shellFolder,
+		const AddEnumeratedItem &addItem, const std::function<void()> &postResultsIfReady);
+	static void EnumerateFileSystemFolderRecursive(HWND listView, EnumerationState *state,
+		std::vector<ItemInfo_t> &items, std::chrono::steady_clock::duration &itemInfoDuration);
+	static void EnumerateFlatViewFolder(const EnumerationState &state,
+		const FlatViewFolder &folder, ParallelWalk<FlatViewFolder>::Worker &worker,
+		const std::function<void(std::vector<ItemInfo_t> &items,
+			std::chrono::steady_clock::duration itemInfoDuration)> &addItems);
+	static bool ShouldIncludeFileSystemItem(const WIN32_FIND_DATA &findData, SHCONTF enumFlags);
+	static void OnFolderEnumerated(const EnumerationState &state, bool containsFolders);
+	SHCONTF GetEnumFlags() const;
+	static void PostEnumerationResults(HWND listView, EnumerationState *state,
+		std::vector<ItemInfo_t> &items, bool finished);
+	std::vector<PrefetchColumn> GetPrefetchColumns() const;
+	static void PrefetchColumnText(IShellFolder *shellFolder, IShellFolder2 *shellFolder2,
+		PCITEMID_CHILD pidlChild, const EnumerationState &state, ItemInfo_t &itemInfo);
+	void ProcessEnumerationResults(int enumerationId);
+	void CancelEnumeration();
+	void PrepareToChangeFolders(bool saveSnapshot = false);
+	void UpdateNetworkLocationPolicy();
+	std::vector<const void *> GetBackgroundTaskOwners() const;
 	void ClearPendingResults();
+	void SaveFolderSnapshot();
+	std::optional<FolderSnapshot> TakeFolderSnapshot(
+		const std::wstring &directory, SHCONTF enumFlags);
+	void ShowFolderSnapshot(FolderSnapshot snapshot);
+	static std::optional<StartupFolderEnumeration> &GetStartupFolderEnumeration();
+	static std::optional<FolderSnapshot> EnumerateStartupFolder(
+		const std::wstring &directory, std::stop_token stopToken);
+	static std::optional<FolderSnapshot> TakeStartupFolderSnapshot(
+		const std::wstring &directory, SHCONTF enumFlags);
+	static size_t GetFolderSnapshotMemoryUsage(const FolderSnapshot &snapshot);
+	size_t GetFolderSnapshotsMemoryUsage() const;
+	void TrimFolderSnapshots(size_t maxBytes);
+	static size_t GetItemFingerprint(const WIN32_FIND_DATA &findData);
+	static std::optional<size_t> GetFileSystemFolderFingerprint(
+		const std::wstring &directory, SHCONTF enumFlags);
+	void OnFolderSnapshotValidated(int folderId, bool valid);
+	bool CanRefreshFolderIncrementally() const;
+	static std::optional<FolderRefreshResult> ReadFolderChanges(PCIDLIST_ABSOLUTE pidlDirectory,
+		const std::wstring &directory, SHCONTF enumFlags,
+		const std::unordered_set<size_t> &currentFingerprints);
+	void OnFolderRefreshReady(int folderId);
+	void ApplyFolderRefresh(FolderRefreshResult refreshResult);
 	void ResetFolderState();
 	void StoreCurrentlySelectedItems();
-	void OnEnumerationCompleted(std::vector<ItemInfo_t> &&items);
+	void OnEnumerationCompleted();
+	void OnListViewPainted();
+	size_t EstimateItemInfoMemoryUsage() const;
 	void InsertAwaitingItems(BOOL bInsertIntoGroup);
 	BOOL IsFileFiltered(const ItemInfo_t &itemInfo) const;
 	std::optional<int> AddItemInternal(IShellFolder *shellFolder, PCIDLIST_ABSOLUTE pidlDirectory,
@@ -405,6 +1187,10 @@ private:
 	int AddItemInternal(int itemIndex, ItemInfo_t itemInfo, BOOL setPosition);
 	std::optional<ItemInfo_t> GetItemInformation(IShellFolder *shellFolder,
 		PCIDLIST_ABSOLUTE pidlDirectory, PCITEMID_CHILD pidlChild);
+	static std::optional<ItemInfo_t> GetItemInformation(IShellFolder *shellFolder,
+		PCIDLIST_ABSOLUTE pidlDirectory, PCITEMID_CHILD pidlChild, bool isRecycleBin,
+		const WIN32_FIND_DATA *findData = nullptr);
+	bool IsRecycleBin(PCIDLIST_ABSOLUTE pidl) const;
 	static HRESULT ExtractFindDataUsingPropertyStore(IShellFolder *shellFolder,
 		PCITEMID_CHILD pidlChild, WIN32_FIND_DATA &output);
 	void SetViewModeInternal(ViewMode viewMode);
@@ -425,8 +1211,6 @@ private:
 		LPARAM lParam, UINT_PTR uIdSubclass, DWORD_PTR dwRefData);
 	LRESULT CALLBACK ListViewParentProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
 
-	static int CALLBACK SortStub(LPARAM lParam1, LPARAM lParam2, LPARAM lParamSort);
-
 	/* Message handlers. */
 	void ColumnClicked(int iClickedColumn);
 
@@ -438,18 +1222,37 @@ private:
 	void OnMouseMove(HWND hwnd, int x, int y, UINT keyFlags);
 	void OnListViewGetDisplayInfo(LPARAM lParam);
 	LRESULT OnListViewGetInfoTip(NMLVGETINFOTIP *getInfoTip);
-	void QueueInfoTipTask(int internalIndex, const std::wstring &existingInfoTip);
-	static std::optional<InfoTipResult> GetInfoTipAsync(HWND listView, int infoTipResultId,
-		int internalIndex, const BasicItemInfo_t &basicItemInfo, const Config &config,
-		HINSTANCE instance, bool virtualFolder);
+	void QueueInfoTipTask(int internalIndex);
+	static InfoTipResult GetInfoTipAsync(HWND listView, int infoTipResultId, int internalIndex,
+		const BasicItemInfo_t &basicItemInfo, InfoTipType infoTipType,
+		const GlobalFolderSettings &globalFolderSettings, HINSTANCE instance, bool virtualFolder);
 	void ProcessInfoTipResult(int infoTipResultId);
+	void SetInfoTipInListView(int internalIndex, const std::wstring &infoTip);
+	void UpdateInfoTipCacheSettings();
+	void OnInfoTipPrefetchTimer();
+	void OnListViewEndScroll();
+	std::pair<int, int> GetApproximateVisibleItemRange() const;
+	void UpdateBackgroundTaskPriorities();
+	static TieredThumbnailCache &GetThumbnailImageCache();
 	void OnListViewItemInserted(const NMLISTVIEW *itemData);
 	void OnListViewItemChanged(const NMLISTVIEW *changeData);
 	void UpdateFileSelectionInfo(int internalIndex, BOOL selected);
+	void ResetSelectionInfo();
+	void TrackSelectedFolderSize(int internalIndex);
+	void UntrackSelectedFolderSize(int internalIndex);
+	bool ResolveSelectedFolderSize(int internalIndex);
+	void NotifySelectionChanged();
+	void OnSelectionChangedNotification();
+	void UpdateSelectionAttributes();
+	void ProcessSelectionAttributesResult(int selectionAttributesResultId);
+	void ClearSelectionAttributes();
+	std::vector<PCITEMID_CHILD> GetSelectedItemChildPidls() const;
 	void OnListViewKeyDown(const NMLVKEYDOWN *lvKeyDown);
+	bool OnListViewChar(wchar_t character);
 	std::vector<PCIDLIST_ABSOLUTE> GetSelectedItemPidls();
 	void OnListViewBeginDrag(const NMLISTVIEW *info);
 	HRESULT StartDrag(int draggedItem, const POINT &startPoint);
+	void SetDragImageForSelection(IDataObject *dataObject);
 
 	HRESULT GetListViewItemAttributes(int item, SFGAOF *attributes) const;
 
@@ -468,57 +1271,185 @@ private:
 	ItemInfo_t &GetItemByIndex(int index);
 	int GetItemInternalIndex(int item) const;
 
-	BasicItemInfo_t getBasicItemInfo(int internalIndex) const;
+	std::shared_ptr<const BasicItemInfo_t> getBasicItemInfo(int internalIndex) const;
 
 	/* Sorting. */
+
+	// An item, along with everything needed to compare it against other items in the current sort
+	// mode, so that the comparisons themselves don't need to retrieve any item data.
+	struct SortEntry
+	{
+		int internalIndex;
+		bool isFolder;
+		SortKey key;
+		std::wstring displayName;
+	};
+
+	struct SortEntryComparison
+	{
+		SortKeyComparison keyComparison;
+		bool separateFolders;
+		bool useNaturalSortOrder;
+		bool sortAscending;
+
+		bool operator()(const SortEntry &entry1, const SortEntry &entry2) const;
+	};
+
+	void SortItems();
+	void SortInternalIndexes(std::vector<int> &internalIndexes);
+	SortEntry BuildSortEntry(int internalIndex, SortKeyComparison comparison);
+	SortEntryComparison GetSortEntryComparison(SortKeyComparison comparison) const;
+	int DetermineItemSortedPosition(int internalIndex);
+	void PositionAwaitingItemsSorted();
+	std::vector<int> GetAllInternalIndexes() const;
+	const SortKey *GetCachedSortKey(int internalIndex, SortMode sortMode) const;
+	std::vector<int> GetMissingSortKeys(SortMode sortMode) const;
+	size_t GetNumQueuedSortKeys(SortMode sortMode) const;
+	void QueueSortKeyTasks(SortMode sortMode, const std::vector<int> &internalIndexes,
+		int priority);
+	void PrefetchSortKeys(SortMode sortMode);
+	bool QueueMissingSortKeys(SortMode sortMode);
+	void UpdateSortKeyTaskPriorities();
+	void ProcessSortKeyResult(int sortKeyResultId);
+	void QueueHistoryEntryPathTask();
+	void ProcessHistoryEntryPathResult(int historyEntryPathResultId);
+	void ClearSortKeyResults();
+	const std::vector<BYTE> &GetNameCollationKey(int internalIndex, const std::wstring &text);
 	int CALLBACK Sort(int InternalIndex1, int InternalIndex2) const;
 
+	std::shared_ptr<const TaskSettings> GetTaskSettings();
+
 	/* Listview column support. */
 	void SetUpListViewColumns();
 	void QueueColumnTask(int itemInternalIndex, ColumnType columnType);
-	static ColumnResult_t GetColumnTextAsync(HWND listView, int columnResultId,
-		ColumnType columnType, int internalIndex, const BasicItemInfo_t &basicItemInfo,
-		const GlobalFolderSettings &globalFolderSettings);
+	const std::wstring *GetCachedColumnText(int internalIndex, ColumnType columnType) const;
+	void InvalidateCachedColumnText(int internalIndex);
+	static size_t GetColumnTextMemoryUsage(
+		const std::unordered_map<ColumnType, std::wstring> &columnText);
+	size_t GetColumnTextCacheMemoryUsage() const;
+	void TrimColumnTextCache(size_t maxBytes);
+	void ClearColumnResults();
+	std::vector<ColumnType> GetColumnTaskTypes(int itemInternalIndex, ColumnType columnType) const;
+	void OnColumnTaskCancelled(
+		int columnResultId, int internalIndex, const std::vector<ColumnType> &columnTypes);
+	static ColumnResult_t GetColumnTextAsync(int columnResultId,
+		const std::vector<ColumnType> &columnTypes, int internalIndex,
+		const BasicItemInfo_t &basicItemInfo, const TaskSettings &settings);
+	void SetColumnTextInListView(int internalIndex, ColumnType columnType, const std::wstring &text);
+	std::optional<int> EstimateColumnWidth(int columnIndex) const;
 	void InsertColumn(ColumnType columnType, int columnIndex, int width);
 	void SetActiveColumnSet();
+	void ShowRelativePathColumnForFlatView(bool show);
 	void GetColumnInternal(ColumnType columnType, Column_t *pci) const;
 	Column_t GetFirstCheckedColumn();
 	void SaveColumnWidths();
-	void ProcessColumnResult(int columnResultId);
+	void ProcessColumnResults();
+	bool ProcessColumnResult(ColumnResult_t &result);
+	void OnAccountNamesResolved();
 	std::optional<int> GetColumnIndexByType(ColumnType columnType) const;
 	std::optional<ColumnType> GetColumnTypeByIndex(int index) const;
 
 	/* Device change support. */
-	void UpdateDriveIcon(const TCHAR *szDrive);
+	void OnDriveChanged(const DriveChange &change);
+	void UpdateDriveIcon(const DriveChange &change);
 	void RemoveDrive(const TCHAR *szDrive);
 
+	/* File selection. */
+	void SelectPendingFileItems();
+
 	/* Directory altered support. */
 	void StartDirectoryMonitoring(PCIDLIST_ABSOLUTE pidl);
 	void StopDirectoryMonitoring();
 	void OnShellNotify(WPARAM wParam, LPARAM lParam);
 	void OnProcessShellChangeNotifications();
-	void ProcessShellChangeNotification(const ShellChangeNotification &change);
+	void UpdateShellChangeProcessingDelay(size_t numNotifications);
+	void AddShellChangeToCoalescer(const ShellChangeNotification &change,
+		ShellChangeCoalescer<PCIDLIST_ABSOLUTE> &coalescer);
+	void ApplyShellChanges(
+		const std::vector<ShellChangeCoalescer<PCIDLIST_ABSOLUTE>::Change> &changes);
 	void OnFileAdded(const TCHAR *szFileName);
 	void AddItem(PCIDLIST_ABSOLUTE pidl);
+	std::optional<int> AddItemToAwaitingList(PCIDLIST_ABSOLUTE pidl);
+	std::optional<ItemInfo_t> GetItemInformationForPidl(PCIDLIST_ABSOLUTE pidl);
+	std::optional<std::wstring> GetFlatViewRelativePath(const std::wstring &path) const;
+	bool IsFlatViewFolderChange(const AlteredFile_t &alteredFile) const;
+	void RemoveFlatViewItemsWithin(const std::wstring &relativeFolder);
+	bool WasItemDropped(int internalIndex) const;
 	void RemoveItem(int iItemInternal);
 	void OnItemRemoved(PCIDLIST_ABSOLUTE pidl);
 	void OnFileRemoved(const TCHAR *szFileName);
-	void OnFileModified(const TCHAR *fileName);
+	void OnFileModified(const TCHAR *fileName, const std::optional<DirectoryChangeDetails> &details);
 	void ModifyItem(PCIDLIST_ABSOLUTE pidl);
+	void ModifyItem(int internalIndex, PCIDLIST_ABSOLUTE pidl);
+	void ModifyItem(int internalIndex, ItemInfo_t itemInfo);
+	void ModifyItem(int internalIndex, const DirectoryChangeDetails &details);
+	void OnItemModified(int internalIndex, ULARGE_INTEGER oldFileSize);
 	void OnItemRenamed(PCIDLIST_ABSOLUTE pidlOld, PCIDLIST_ABSOLUTE pidlNew);
+	void InvalidateCachedFolderSize();
+	void InvalidateCachedFolderAttributes();
+	void InvalidateCachedParsedPaths();
+	void UpdateCachedFolderSize(
+		const WIN32_FIND_DATA &previousFindData, const ItemInfo_t &updatedItemInfo);
+	std::unordered_set<ULONGLONG> GetMovedFileIds() const;
+	void OnFileMoved(const TCHAR *szFileName, ULONGLONG fileId);
 	void OnFileRenamedOldName(const TCHAR *szFileName);
-	void OnFileRenamedNewName(const TCHAR *szFileName);
+	void OnFileRenamedNewName(
+		const TCHAR *szFileName, const std::optional<DirectoryChangeDetails> &details);
 	void RenameItem(int internalIndex, const TCHAR *szNewFileName);
 	void RenameItem(int internalIndex, PCIDLIST_ABSOLUTE pidlNew);
+	void RenameItem(int internalIndex, ItemInfo_t itemInfo);
 	void InvalidateAllColumnsForItem(int itemIndex);
 	void InvalidateIconForItem(int itemIndex);
-	int DetermineItemSortedPosition(LPARAM lParam) const;
+
+	/* Owner data listview support. */
+	bool IsOwnerDataListViewActive() const;
+	bool ShouldUseOwnerDataListView(size_t numItems) const;
+	void SwitchToOwnerDataListView();
+	void SwitchToStandardListView();
+	void ActivateListView(HWND listView);
+	void InsertAwaitingItemsIntoOwnerDataListView();
+	void InsertOwnerDataItems(const std::vector<std::pair<int, int>> &insertions);
+	void RemoveOwnerDataItem(int item);
+	void SortOwnerDataItems();
+	std::unordered_set<int> GetOwnerDataSelection() const;
+	void RestoreOwnerDataSelection(
+		const std::unordered_set<int> &selectedItems, std::optional<int> focusedItem);
+	void OnOwnerDataGetDisplayInfo(LVITEM *item);
+	std::wstring GetOwnerDataItemText(int internalIndex, int subItem);
+	OwnerDataItemImage GetOwnerDataItemImage(int internalIndex);
+	int OnOwnerDataFindItem(const NMLVFINDITEM *findItem) const;
+	void RecalculateSelectionInfo();
+	void OnOwnerDataColumnResultsProcessed();
+	void ProcessOwnerDataIconResult(int internalIndex, int iconIndex);
+	void InvalidateOwnerDataItem(int internalIndex, bool columns, bool icon);
+	void MarkOwnerDataItemAsCut(int item, bool cut);
+	void MarkOwnerDataItemsAsCut(const std::unordered_set<int> &internalIndexes);
+
+	/* Grid view support. */
+	bool ShouldUseGridRenderer();
+	void OnGridViewPaint();
+	void DrawGridViewRows(HDC hdc, const RECT &paintRect);
 
 	/* Filtering support. */
 	void UpdateFiltering();
-	void RemoveFilteredItems();
+	void StartFilterEvaluation();
+	std::shared_ptr<const ItemNameTable> GetFilterNameTable();
+	std::shared_ptr<const ItemNameTable> GetFileNameTable();
+	std::shared_ptr<const ItemNameTable> GetTypeAheadNameTable();
+	std::shared_ptr<const ItemNameTable> BuildItemNameTable(bool caseSensitive,
+		std::wstring_view (*getName)(const ItemInfo_t &itemInfo)) const;
+	void InvalidateItemNameTables();
+	std::shared_ptr<const FilterItemTable> GetFilterItemTable();
+	static FilterItemTable::Item GetFilterItem(const ItemInfo_t &itemInfo);
+	static void EvaluateFilterAsync(HWND listView, std::shared_ptr<FilterEvaluation> evaluation);
+	void ProcessFilterResults(int evaluationId);
+	void CancelFilterEvaluation();
+	void HideFilteredItems(const std::unordered_set<int> &internalIndexes);
+	void ShowUnfilteredItems(const std::vector<int> &internalIndexes);
 	void RemoveFilteredItem(int iItem, int iItemInternal);
-	BOOL IsFilenameFiltered(const TCHAR *FileName) const;
+	bool MatchesFilter(const ItemInfo_t &itemInfo) const;
+	void UpdateFilterMatcher();
+	void UpdateAppliedFilterMatcher();
 	void UnfilterAllItems();
 	void UnfilterItem(int internalIndex);
 	void RestoreFilteredItem(int internalIndex);
@@ -526,11 +1457,20 @@ private:
 
 	/* Listview group support. */
 	static int CALLBACK GroupComparisonStub(int id1, int id2, void *data);
-	int GroupComparison(int id1, int id2);
-	int GroupNameComparison(const ListViewGroup &group1, const ListViewGroup &group2);
-	int GroupRelativePositionComparison(const ListViewGroup &group1, const ListViewGroup &group2);
-	const ListViewGroup GetListViewGroupById(int groupId);
+	int GroupComparison(int id1, int id2) const;
+	int CompareGroups(const ListViewGroup &group1, const ListViewGroup &group2) const;
+	static int GroupNameComparison(const ListViewGroup &group1, const ListViewGroup &group2);
+	static int GroupRelativePositionComparison(
+		const ListViewGroup &group1, const ListViewGroup &group2);
+	std::vector<int> RankGroups();
+	const ListViewGroup &GetListViewGroupById(int groupId) const;
 	int DetermineItemGroup(int iItemInternal);
+	GroupInfo GetItemGroupInfo(int internalIndex);
+	void PrefetchGroupInfo(const std::vector<int> &internalIndexes);
+	void InvalidateCachedGroupInfo(int internalIndex);
+	static bool IsGroupDeterminationSlow(SortMode sortMode);
+	GroupInfo DetermineItemGroupInfo(const BasicItemInfo_t &basicItemInfo, SortMode sortMode,
+		const GlobalFolderSettings &globalFolderSettings) const;
 	std::optional<GroupInfo> DetermineItemNameGroup(const BasicItemInfo_t &itemInfo) const;
 	std::optional<GroupInfo> DetermineItemSizeGroup(const BasicItemInfo_t &itemInfo) const;
 	std::optional<GroupInfo> DetermineItemTotalSizeGroup(const BasicItemInfo_t &itemInfo) const;
@@ -552,6 +1492,7 @@ private:
 
 	/* Other grouping support. */
 	int GetOrCreateListViewGroup(const GroupInfo &groupInfo);
+	int GetOrCreateListViewGroupByName(const GroupInfo &groupInfo);
 	void MoveItemsIntoGroups();
 	void InsertItemIntoGroup(int index, int groupId);
 	void EnsureGroupExistsInListView(int groupId);
@@ -566,29 +1507,49 @@ private:
 	/* Listview icons. */
 	void ProcessIconResult(int internalIndex, int iconIndex);
 	std::optional<int> GetCachedIconIndex(const ItemInfo_t &itemInfo);
+	int GetDefaultIconIndex(const ItemInfo_t &itemInfo);
 
 	/* Thumbnails view. */
-	void QueueThumbnailTask(int internalIndex);
-	std::optional<int> GetCachedThumbnailIndex(const ItemInfo_t &itemInfo);
-	static wil::unique_hbitmap GetThumbnail(PIDLIST_ABSOLUTE pidl, WTS_FLAGS flags);
-	void ProcessThumbnailResult(int thumbnailResultId);
+	void QueueThumbnailTask(int internalIndex, int priority);
+	void PrefetchThumbnails();
+	void ClearThumbnailRequestState();
+	static wil::unique_hbitmap GetThumbnail(const BasicItemInfo_t &itemInfo, int size);
+	static std::optional<TieredThumbnailCache::Image> ExtractThumbnail(
+		PIDLIST_ABSOLUTE pidl, UINT size, WTS_FLAGS flags);
+	static void ReleaseThreadThumbnailCache();
+	void ProcessThumbnailResults();
+	void ProcessThumbnailResult(const ThumbnailResult_t &result);
+	void ClearThumbnailResults();
+	void CancelThumbnailTasks();
+	void InvalidateThumbnailForItem(int internalIndex);
+	void OnThumbnailTaskCancelled(int thumbnailResultId, int internalIndex);
 	void SetupThumbnailsView();
 	void RemoveThumbnailsView();
-	int GetIconThumbnail(int iInternalIndex) const;
-	int GetExtractedThumbnail(HBITMAP hThumbnailBitmap) const;
-	int GetThumbnailInternal(int iType, int iInternalIndex, HBITMAP hThumbnailBitmap) const;
+	void OnThumbnailsDpiChanged();
+	HIMAGELIST CreateThumbnailImageList();
+	int GetThumbnailItemSize() const;
+	static int GetThumbnailSlotCapacity(int thumbnailItemSize);
+	std::optional<int> AllocateThumbnailSlot(int internalIndex);
+	int GetIconThumbnail(int iInternalIndex);
+	int GetExtractedThumbnail(int iInternalIndex, HBITMAP hThumbnailBitmap);
+	int GetThumbnailInternal(int iType, int iInternalIndex, HBITMAP hThumbnailBitmap);
 	void DrawIconThumbnailInternal(HDC hdcBacking, int iInternalIndex) const;
 	void DrawThumbnailInternal(HDC hdcBacking, HBITMAP hThumbnailBitmap) const;
 
 	/* Tiles view. */
 	void InsertTileViewColumns();
 	void DeleteTileViewColumns();
-	void SetTileViewInfo();
-	void SetTileViewItemInfo(int iItem, int iItemInternal);
-
-	void UpdateCurrentClipboardObject(wil::com_ptr_nothrow<IDataObject> clipboardDataObject);
+	void GetTileViewColumns(LVITEM *item);
+	void GetTileViewItemText(LVITEM *item);
+	static std::optional<int> GetTileColumnIndexByType(ColumnType columnType);
+	void InvalidateTileViewItemText(int itemIndex);
+	std::optional<std::wstring> GetTypeNameExtension(const ItemInfo_t &itemInfo) const;
+	void CacheFileTypeName(int internalIndex, const std::wstring &typeName);
+
+	void UpdateCurrentClipboardObject(wil::com_ptr_nothrow<IDataObject> clipboardDataObject,
+		const std::unordered_set<int> &cutItems = {});
 	void OnClipboardUpdate();
-	void RestoreStateOfCutItems();
+	void UpdateCutItems(const std::unordered_set<int> &cutItems);
 
 	// ShellDropTargetWindow
 	int GetDropTargetItem(const POINT &pt) override;
@@ -597,6 +1558,8 @@ private:
 	bool IsTargetSourceOfDrop(int targetItem, IDataObject *dataObject) override;
 	void UpdateUiForDrop(int targetItem, const POINT &pt) override;
 	void ResetDropUiState() override;
+	bool PerformInternalDrop(int targetItem, IDataObject *dataObject, DWORD keyState,
+		DWORD allowedEffects, DWORD &targetEffect) override;
 
 	/* Drag and Drop support. */
 	void RepositionLocalFiles(const POINT *ppt);
@@ -606,16 +1569,38 @@ private:
 	void OnApplicationShuttingDown();
 
 	/* Miscellaneous. */
-	BOOL CompareVirtualFolders(UINT uFolderCSIDL) const;
+	static FolderType GetFolderType(const std::wstring &directory);
+	std::vector<Column_t> &GetCurrentFolderColumns();
 	int LocateFileItemInternalIndex(const TCHAR *szFileName) const;
 	std::optional<int> GetItemIndexForPidl(PCIDLIST_ABSOLUTE pidl) const;
 	std::optional<int> GetItemInternalIndexForPidl(PCIDLIST_ABSOLUTE pidl) const;
+	std::optional<int> GetItemInternalIndexForFileId(ULONGLONG fileId) const;
+	std::optional<int> GetItemInternalIndexForChildPidl(PCITEMID_CHILD pidlChild) const;
+	void SelectChildItems(const PackedChildPidls &children);
+	void SelectItemsByInternalIndex(const std::vector<int> &internalIndexes);
 	std::optional<int> LocateItemByInternalIndex(int internalIndex) const;
+	void AddItemToLookupIndexes(int internalIndex);
+	void RemoveItemFromLookupIndexes(int internalIndex);
 	void ApplyHeaderSortArrow();
 
 	HWND m_hListView;
 	HWND m_hOwner;
 
+	// The listview that's created along with this instance and the owner data listview that's
+	// only created (and swapped in) once a sufficiently large folder is loaded. Once created, both
+	// windows live for as long as this instance, so that any messages posted to either window by
+	// background tasks are still processed.
+	const HWND m_standardListView;
+	HWND m_ownerDataListView;
+	OwnerDataState m_ownerDataState;
+
+	// Used to draw the owner data listview in details mode, if enabled. Created on first use.
+	std::unique_ptr<GridRenderer> m_gridRenderer;
+
+	// Maps internal indexes to positions in the active listview, so that the results of background
+	// tasks can be applied to an item without searching the listview for it.
+	mutable ItemPositionIndex m_itemPositionIndex;
+
 	NavigationStartedSignal m_navigationStartedSignal;
 	NavigationCommittedSignal m_navigationCommittedSignal;
 	NavigationCompletedSignal m_navigationCompletedSignal;
@@ -639,26 +1624,135 @@ private:
 	DirectoryState m_directoryState;
 
 	/* Stores various extra information on files, such
-	as display name. */
-	std::unordered_map<int, ItemInfo_t> m_itemInfoMap;
+	as display name. Internal indexes are allocated
+	sequentially, so items are stored densely, indexed
+	directly by their internal index. */
+	DenseIdMap<ItemInfo_t> m_itemInfoMap;
+
+	// Secondary indexes into m_itemInfoMap. These allow an item to be found without scanning every
+	// item, which matters when a large number of change notifications are processed at once. Each
+	// key maps to the internal index of the item.
+	struct ItemLookupIndexes
+	{
+		std::unordered_multimap<std::string, int> childPidls;
+		std::unordered_multimap<std::wstring, int> parsingNames;
+		std::unordered_multimap<std::wstring, int> fileNames;
+
+		// Only items with a known file ID are indexed here. Hard links to the same file share an
+		// ID, so this can contain more than one item for an ID.
+		std::unordered_multimap<ULONGLONG, int> fileIds;
+	};
 
-	ctpl::thread_pool m_columnThreadPool;
-	std::unordered_map<int, std::future<ColumnResult_t>> m_columnResults;
+	ItemLookupIndexes m_itemLookupIndexes;
+
+	// Column, thumbnail and info tip tasks are queued on the shared background task scheduler.
+	// The address of each of the corresponding result containers is used to identify the tasks of
+	// that type (for this browser) within the scheduler.
+	//
+	// Column and thumbnail tasks are queued in large numbers, so rather than each result being
+	// returned through a future and announced with its own message, the results are pushed to a
+	// channel that's drained in batches. The IDs of the tasks that are outstanding for the current
+	// folder are tracked, so that results from tasks that were queued for a previous folder (or
+	// that were otherwise invalidated) can be ignored.
+	std::unordered_set<int> m_columnResultIds;
+	ResultChannel<ColumnResult_t> m_columnResultChannel;
 	int m_columnResultIDCounter;
 
+	// Column text that has already been retrieved for the current folder, keyed by the internal
+	// index of each item. Changing any of the settings that affect column text results in a
+	// refresh, which clears this.
+	std::unordered_map<int, std::unordered_map<ColumnType, std::wstring>> m_columnTextCache;
+
+	// The ID of the column task that's currently queued (or running) for each cell. Only one task
+	// is queued for a cell at a time. Results that arrive for a task that's no longer listed here
+	// were invalidated in the meantime and are discarded.
+	std::unordered_map<int, std::unordered_map<ColumnType, int>> m_pendingColumnTasks;
+
+	// An immutable copy of the global folder settings, shared by all of the background tasks
+	// (column, sort key, group and info tip tasks) that need them. Each task captures a pointer to
+	// the current copy, instead of copying the settings itself.
+	VersionedSnapshot<GlobalFolderSettings> m_taskSettings;
+
+	// Sort keys that are expensive to build (see IsSortKeyExpensive()), keyed by internal index and
+	// then by sort mode. These are filled in by column tasks, as well as whenever the items are
+	// sorted, and are removed along with the item's cached column text.
+	std::unordered_map<int, std::unordered_map<int, SortKey>> m_sortKeyCache;
+
+	// When the folder is sorted by a mode whose keys are expensive and many of the keys are
+	// missing, the keys are built in the background and the sort is only performed once they've
+	// all been built. m_pendingSortMode is the sort mode that's waiting on the keys and
+	// m_pendingSortNumKeys is the number of keys it was waiting on when the sort started. Keys
+	// that are being prefetched (for a mode that no sort is waiting on) are also tracked here.
+	std::unordered_map<int, PendingSortKeys> m_sortKeyResults;
+	int m_sortKeyResultIdCounter = 0;
+	std::optional<SortMode> m_pendingSortMode;
+	size_t m_pendingSortNumKeys = 0;
+
+	// Resolving the full path for a history entry can be slow for some namespaces, so it's done in
+	// the background when the navigation is committed, rather than when the entry is displayed.
+	std::unordered_map<int, std::future<HistoryEntryPathResult>> m_historyEntryPathResults;
+	int m_historyEntryPathResultIdCounter = 0;
+
 	std::unique_ptr<IconFetcher> m_iconFetcher;
 	CachedIcons *m_cachedIcons;
 
 	IconResourceLoader *m_iconResourceLoader;
 
-	ctpl::thread_pool m_thumbnailThreadPool;
-	std::unordered_map<int, std::future<std::optional<ThumbnailResult_t>>> m_thumbnailResults;
+	std::unordered_set<int> m_thumbnailResultIds;
+	ResultChannel<ThumbnailResult_t> m_thumbnailResultChannel;
 	int m_thumbnailResultIDCounter;
 
-	ctpl::thread_pool m_infoTipsThreadPool;
-	std::unordered_map<int, std::future<std::optional<InfoTipResult>>> m_infoTipResults;
+	// The internal indexes of items whose thumbnail has been requested, but not yet processed, and
+	// of items whose thumbnail has been set. These are used to avoid requesting the same thumbnail
+	// more than once.
+	std::unordered_set<int> m_pendingThumbnailItems;
+	std::unordered_set<int> m_fetchedThumbnailItems;
+	int m_thumbnailPrefetchPreviousFirstVisible;
+	LruSlotAllocator m_thumbnailSlots;
+	int m_thumbnailItemSize;
+
+	// Kept (along with the slot assignments) while other views are shown.
+	wil::unique_himagelist m_thumbnailImageList;
+
+	std::unordered_map<int, std::future<InfoTipResult>> m_infoTipResults;
 	int m_infoTipResultIDCounter;
 
+	// Info tips that have already been retrieved, keyed by internal index. An item's info tip is
+	// removed when the item is modified and the whole cache is cleared if any of the settings the
+	// info tips depend on change.
+	std::unordered_map<int, std::wstring> m_infoTipCache;
+
+	// The items whose info tip is currently being retrieved. If the listview requests the info tip
+	// in the meantime, the text that should precede it (the item's name, if that's truncated in
+	// the listview) is stored here and the info tip is shown once it's been retrieved.
+	std::unordered_map<int, std::optional<std::wstring>> m_pendingInfoTips;
+
+	std::optional<InfoTipCacheSettings> m_infoTipCacheSettings;
+
+	ctpl::thread_pool m_enumerationThreadPool;
+	std::shared_ptr<EnumerationState> m_enumerationState;
+	int m_enumerationIDCounter;
+	std::unique_ptr<PendingNavigation> m_pendingNavigation;
+	int m_navigationIdCounter;
+	std::optional<PendingRefresh> m_pendingRefresh;
+
+	// Timing for the most recent navigation. The insert and sort stages are accumulated until the
+	// navigation completes, with the navigation considered finished once the listview has been
+	// painted.
+	NavigationTiming m_navigationTiming;
+	std::chrono::steady_clock::time_point m_navigationStartTime;
+	std::chrono::steady_clock::time_point m_navigationCompletedTime;
+	uint64_t m_numColumnResultsProcessed;
+	uint64_t m_numThumbnailResultsProcessed;
+
+	// Ordered from most to least recently saved.
+	std::list<FolderSnapshot> m_folderSnapshots;
+
+	// The folder snapshots and column text cache are trimmed by the MemoryBudget when memory is
+	// needed elsewhere.
+	int m_folderSnapshotsMemoryConsumerId;
+	int m_columnTextMemoryConsumerId;
+
 	/* Internal state. */
 	const HINSTANCE m_hResourceModule;
 	BOOL m_bFolderVisited;
@@ -673,14 +1767,77 @@ private:
 	modification. */
 	int m_uniqueFolderId;
 
+	IExplorerplusplus *m_coreInterface;
 	const Config *m_config;
 	FolderSettings m_folderSettings;
 
+	// Whether cloud placeholders can be downloaded in order to retrieve their thumbnails, column
+	// text or sizes. This is a per-tab override and isn't saved.
+	bool m_allowCloudHydration;
+
+	// See SetFlatView(). Like the setting above, this applies only to the current tab. The
+	// relative path column is shown automatically on entering flat view (if it isn't already
+	// shown), in which case it's hidden again on leaving.
+	bool m_flatView;
+	bool m_relativePathColumnShownForFlatView;
+
+	// See GetNetworkServer() and IsNetworkActivityReduced(). These are updated whenever a
+	// navigation is committed.
+	std::wstring m_networkServer;
+	bool m_reducedNetworkActivity;
+
+	/* The filter is parsed once (whenever it changes), rather
+	than each time an item is checked against it. */
+	std::optional<WildcardMatcher> m_filterMatcher;
+
+	// Set if the filter is an expression (e.g. "size > 100MB and modified < 7d"), rather than a
+	// wildcard pattern. Ages within the expression are measured from when the filter was set.
+	std::optional<FilterExpression> m_filterExpression;
+
+	// The filter that the items currently shown reflect. If a new filter is a subset of this one,
+	// it can only hide items, so only the items that are currently shown need to be tested. This
+	// is empty if the filter isn't applied, if it's an expression (which is always tested against
+	// every item), or if the shown items may not match any single filter.
+	std::optional<WildcardMatcher> m_appliedFilterMatcher;
+
+	std::shared_ptr<const ItemNameTable> m_filterNameTable;
+	std::shared_ptr<const ItemNameTable> m_fileNameTable;
+	std::shared_ptr<const ItemNameTable> m_typeAheadNameTable;
+	TypeAheadSearch m_typeAheadSearch{ TYPE_AHEAD_TIMEOUT };
+
+	// The properties that filter expressions test, indexed by internal index. Like the name
+	// tables, this is built on demand and discarded whenever an item changes.
+	std::shared_ptr<const FilterItemTable> m_filterItemTable;
+
+	std::shared_ptr<FilterEvaluation> m_filterEvaluation;
+	int m_filterEvaluationIDCounter;
+
 	/* ID. */
 	const int m_ID;
 
 	/* Directory monitoring. */
 	ULONG m_shChangeNotifyId;
+	UINT m_shellChangeProcessingDelay;
+
+	// Set while a batch of shell changes is being applied. Individual updates won't re-sort the
+	// listview while this is set, since the listview is sorted once the batch is complete.
+	bool m_processingShellChangeBatch;
+
+	// Selection changes are reported to observers at most once per message loop iteration, since
+	// selecting a large number of items generates a notification for each item.
+	bool m_selectionChangedNotificationPending;
+
+	// Incremented whenever the selection changes. The attributes of the selected items are
+	// retrieved once per (coalesced) selection change and are only used while this matches the
+	// version they were retrieved for.
+	int m_selectionVersion = 0;
+	std::optional<SelectionAttributes> m_selectionAttributes;
+	std::unordered_map<int, std::future<SelectionAttributes>> m_selectionAttributesResults;
+	int m_selectionAttributesResultIdCounter = 0;
+
+	// Set while a bulk selection change is being made. The selection totals are recalculated once
+	// the change is complete, so individual item notifications don't update them.
+	bool m_bulkSelectionChangeInProgress;
 
 	wil::com_ptr_nothrow<IShellFolder> m_desktopFolder;
 	unique_pidl_absolute m_recycleBinPidl;
@@ -691,6 +1848,10 @@ private:
 	CRITICAL_SECTION m_csDirectoryAltered;
 	std::list<AlteredFile_t> m_AlteredList;
 
+	// Set when the directory monitor was unable to record all of the changes made to the folder
+	// with this ID. The folder will be refreshed in that case.
+	std::optional<int> m_rescanFolderId;
+
 	int m_middleButtonItem;
 
 	// Shell window integration
@@ -701,8 +1862,11 @@ private:
 	/* Shell new. */
 	unique_pidl_absolute m_queuedRenameItem;
 
-	/* File selection. */
-	std::list<std::wstring> m_FileSelectionList;
+	/* File selection. Pasted files that haven't been added to the listview yet are selected as
+	they arrive. The names are hashed, so that checking each added item is a constant time
+	operation, and the listview is only rescanned when one of the added items matched. */
+	std::unordered_set<std::wstring> m_pendingFileSelections;
+	bool m_pendingFileSelectionMatched = false;
 
 	/* Thumbnails. */
 	BOOL m_bThumbnailsSetup;
@@ -717,7 +1881,9 @@ private:
 	ColumnType m_previousSortColumn;
 
 	wil::com_ptr_nothrow<IDataObject> m_clipboardDataObject;
-	std::vector<std::wstring> m_cutFileNames;
+
+	// The internal indexes of the items in the current folder that are marked as cut.
+	std::unordered_set<int> m_cutItems;
 
 	/* Drag and drop related data. */
 	UINT m_getDragImageMessage;
@@ -734,4 +1900,18 @@ private:
 
 	ListViewGroupSet m_listViewGroups;
 	int m_groupIdCounter;
+
+	// Maps the resource ID of each fixed group header to the ID of the corresponding group.
+	std::unordered_map<UINT, int> m_resourceGroupIds;
+
+	// The position of each group, computed when the groups are rebuilt, so that the listview can
+	// order the groups using a simple integer comparison. Groups that are created later (e.g.
+	// when an item is added) aren't ranked and are compared directly.
+	std::unordered_map<int, int> m_groupRanks;
+
+	// The group each item belongs to, keyed by sort mode and then by internal index. Determining
+	// an item's group can involve querying the item (e.g. for its owner or type), so the result is
+	// kept for as long as the item is unchanged. That allows items to be regrouped (e.g. when
+	// "Show in groups" is toggled, or the sort mode is switched back) without any queries.
+	std::unordered_map<int, std::unordered_map<int, GroupInfo>> m_groupInfoCache;
 };
\ No newline at end of file
@@ -0,0 +1,265 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Reduces a sequence of changes to a set of items down to the net change for each item. For
+// example, an item that's created, modified and then deleted results in no change at all, while an
+// item that's renamed several times results in a single rename.
+//
+// Items are identified by a key (e.g. their parsing name). ItemData is any additional data that
+// should be passed through for each item (e.g. the item's PIDL).
+template <typename ItemData>
+class ShellChangeCoalescer
+{
+public:
+	enum class ChangeType
+	{
+		Added,
+		Removed,
+		Modified,
+		Renamed
+	};
+
+	struct Change
+	{
+		ChangeType type;
+
+		// The key the item had before any of the changes were applied. For added items, this is
+		// the key of the new item.
+		std::wstring originalKey;
+
+		// The data that was provided alongside the original key. Not set for added items.
+		std::optional<ItemData> originalData;
+
+		// The key and data of the item once all the changes have been applied. Not set for removed
+		// items.
+		std::wstring key;
+		std::optional<ItemData> data;
+	};
+
+	void AddItem(const std::wstring &key, ItemData data)
+	{
+		auto itr = m_items.find(key);
+
+		if (itr == m_items.end())
+		{
+			ItemState state;
+			state.exists = true;
+			state.data = std::move(data);
+			state.lastChange = m_changeCounter++;
+			m_items.insert({ key, std::move(state) });
+			return;
+		}
+
+		// The item was either removed and then re-created, or a duplicate notification was
+		// received. Either way, the item will need to be updated.
+		itr->second.exists = true;
+		itr->second.modified = true;
+		itr->second.data = std::move(data);
+		itr->second.lastChange = m_changeCounter++;
+	}
+
+	void RemoveItem(const std::wstring &key, ItemData data)
+	{
+		auto itr = m_items.find(key);
+
+		if (itr == m_items.end())
+		{
+			ItemState state;
+			state.originalKey = key;
+			state.originalData = std::move(data);
+			state.exists = false;
+			state.lastChange = m_changeCounter++;
+			m_items.insert({ key, std::move(state) });
+			return;
+		}
+
+		if (!itr->second.originalKey)
+		{
+			// The item was only created as part of this set of changes, so there's nothing to
+			// remove.
+			m_items.erase(itr);
+			return;
+		}
+
+		itr->second.exists = false;
+		itr->second.modified = false;
+		itr->second.data.reset();
+		itr->second.lastChange = m_changeCounter++;
+	}
+
+	void ModifyItem(const std::wstring &key, ItemData data)
+	{
+		auto itr = m_items.find(key);
+
+		if (itr == m_items.end())
+		{
+			ItemState state;
+			state.originalKey = key;
+			state.originalData = data;
+			state.exists = true;
+			state.modified = true;
+			state.data = std::move(data);
+			state.lastChange = m_changeCounter++;
+			m_items.insert({ key, std::move(state) });
+			return;
+		}
+
+		itr->second.exists = true;
+		itr->second.modified = true;
+		itr->second.data = std::move(data);
+		itr->second.lastChange = m_changeCounter++;
+	}
+
+	void RenameItem(const std::wstring &oldKey, ItemData oldData, const std::wstring &newKey,
+		ItemData newData)
+	{
+		ItemState state;
+		auto itr = m_items.find(oldKey);
+
+		if (itr == m_items.end())
+		{
+			state.originalKey = oldKey;
+			state.originalData = std::move(oldData);
+		}
+		else
+		{
+			state = std::move(itr->second);
+			m_items.erase(itr);
+		}
+
+		// If the item didn't exist, this is treated the same as the item being added with its new
+		// name.
+		state.exists = true;
+		state.data = std::move(newData);
+		state.lastChange = m_changeCounter++;
+
+		auto existingItr = m_items.find(newKey);
+
+		if (existingItr != m_items.end())
+		{
+			// The item is being renamed over the top of another item (which will typically have
+			// been removed already). If that item existed originally, it needs to be removed.
+			if (existingItr->second.originalKey)
+			{
+				m_displacedItems.push_back({ *existingItr->second.originalKey,
+					std::move(existingItr->second.originalData), existingItr->second.lastChange });
+			}
+
+			m_items.erase(existingItr);
+		}
+
+		m_items.insert({ newKey, std::move(state) });
+	}
+
+	// Returns the net changes and resets the internal state. Removals are always returned first
+	// (so that an item can't be renamed to a name that's only freed up by a later removal). Other
+	// changes are returned in the order in which each item was last changed.
+	std::vector<Change> TakeChanges()
+	{
+		std::vector<OrderedChange> removals;
+		std::vector<OrderedChange> otherChanges;
+
+		for (auto &displacedItem : m_displacedItems)
+		{
+			removals.push_back({ { ChangeType::Removed, std::move(displacedItem.key),
+									 std::move(displacedItem.data), {}, std::nullopt },
+				displacedItem.lastChange });
+		}
+
+		for (auto &[key, state] : m_items)
+		{
+			if (!state.originalKey)
+			{
+				otherChanges.push_back({ { ChangeType::Added, key, std::nullopt, key,
+											 std::move(state.data) },
+					state.lastChange });
+			}
+			else if (!state.exists)
+			{
+				removals.push_back({ { ChangeType::Removed, *state.originalKey,
+										 std::move(state.originalData), {}, std::nullopt },
+					state.lastChange });
+			}
+			else if (*state.originalKey != key)
+			{
+				otherChanges.push_back({ { ChangeType::Renamed, *state.originalKey,
+											 std::move(state.originalData), key,
+											 std::move(state.data) },
+					state.lastChange });
+			}
+			else if (state.modified)
+			{
+				otherChanges.push_back({ { ChangeType::Modified, key, std::move(state.originalData),
+											 key, std::move(state.data) },
+					state.lastChange });
+			}
+		}
+
+		m_items.clear();
+		m_displacedItems.clear();
+		m_changeCounter = 0;
+
+		auto compareOrder = [](const OrderedChange &change1, const OrderedChange &change2) {
+			return change1.order < change2.order;
+		};
+
+		std::sort(removals.begin(), removals.end(), compareOrder);
+		std::sort(otherChanges.begin(), otherChanges.end(), compareOrder);
+
+		std::vector<Change> changes;
+		changes.reserve(removals.size() + otherChanges.size());
+
+		for (auto &removal : removals)
+		{
+			changes.push_back(std::move(removal.change));
+		}
+
+		for (auto &otherChange : otherChanges)
+		{
+			changes.push_back(std::move(otherChange.change));
+		}
+
+		return changes;
+	}
+
+private:
+	struct ItemState
+	{
+		// The key and data of the item before any changes were applied. This won't be set if the
+		// item was created as part of this set of changes.
+		std::optional<std::wstring> originalKey;
+		std::optional<ItemData> originalData;
+
+		bool exists = false;
+		bool modified = false;
+		std::optional<ItemData> data;
+
+		int lastChange = 0;
+	};
+
+	struct DisplacedItem
+	{
+		std::wstring key;
+		std::optional<ItemData> data;
+		int lastChange;
+	};
+
+	struct OrderedChange
+	{
+		Change change;
+		int order;
+	};
+
+	std::unordered_map<std::wstring, ItemState> m_items;
+	std::vector<DisplacedItem> m_displacedItems;
+	int m_changeCounter = 0;
+};
\ No newline at end of file
@@ -4,6 +4,8 @@
 
 #include "stdafx.h"
 #include "ShellNavigationController.h"
+#include "../Helper/ParsedPathCache.h"
+#include "../Helper/ShellHelper.h"
 
 ShellNavigationController::ShellNavigationController(NavigatorInterface *navigator,
 	TabNavigationInterface *tabNavigation, IconFetcherInterface *iconFetcher) :
@@ -49,6 +51,25 @@ std::vector<std::unique_ptr<HistoryEntry>> ShellNavigationController::CopyPreser
 void ShellNavigationController::OnNavigationCommitted(
 	PCIDLIST_ABSOLUTE pidlDirectory, bool addHistoryEntry)
 {
+	auto pendingEntryId = std::exchange(m_pendingEntryId, std::nullopt);
+
+	// If a different navigation (e.g. a refresh) superseded the one started by GoToOffset(), the
+	// folder being committed won't match the pending entry and the index is left as is.
+	if (pendingEntryId && !addHistoryEntry)
+	{
+		for (int i = 0; i < GetNumHistoryEntries(); i++)
+		{
+			auto *entry = GetEntryAtIndex(i);
+
+			if (entry->GetId() == *pendingEntryId
+				&& ArePidlsEquivalent(entry->GetPidl().get(), pidlDirectory))
+			{
+				SetCurrentIndex(i);
+				break;
+			}
+		}
+	}
+
 	if (addHistoryEntry)
 	{
 		std::wstring displayName;
@@ -82,21 +103,7 @@ HRESULT ShellNavigationController::GoToOffset(int offset)
 		return E_FAIL;
 	}
 
-	auto connection = m_navigator->AddNavigationCommittedObserver(
-		[this, offset](PCIDLIST_ABSOLUTE pidl, bool addHistoryEntry) {
-			UNREFERENCED_PARAMETER(pidl);
-			UNREFERENCED_PARAMETER(addHistoryEntry);
-
-			// The entry retrieval above will fail if the provided offset is invalid, so there's no
-			// need to re-check the offset here.
-			int index = GetCurrentIndex() + offset;
-			SetCurrentIndex(index);
-		},
-		boost::signals2::at_front);
-
-	auto disconnect = wil::scope_exit([&connection] {
-		connection.disconnect();
-	});
+	m_pendingEntryId = entry->GetId();
 
 	return BrowseFolder(entry);
 }
@@ -159,8 +166,7 @@ HRESULT ShellNavigationController::BrowseFolder(const HistoryEntry *entry)
 HRESULT ShellNavigationController::BrowseFolder(const std::wstring &path, bool addHistoryEntry)
 {
 	unique_pidl_absolute pidlDirectory;
-	HRESULT hr =
-		SHParseDisplayName(path.c_str(), nullptr, wil::out_param(pidlDirectory), 0, nullptr);
+	HRESULT hr = ParsedPathCache::GetInstance().ParsePath(path, wil::out_param(pidlDirectory));
 
 	if (SUCCEEDED(hr))
 	{
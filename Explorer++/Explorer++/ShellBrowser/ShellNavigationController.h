@@ -12,6 +12,7 @@
 #include "../Helper/IconFetcher.h"
 #include "../Helper/Macros.h"
 #include <boost/signals2.hpp>
+#include <optional>
 
 class ShellNavigationController : public NavigationController<HistoryEntry, HRESULT>
 {
@@ -61,5 +62,10 @@ private:
 
 	IconFetcherInterface *m_iconFetcher;
 
+	// The ID of the entry that GoToOffset() most recently navigated to. The navigator may commit
+	// the navigation asynchronously (e.g. once a remote folder has been bound), so the current
+	// index is only updated when the navigation is committed.
+	std::optional<int> m_pendingEntryId;
+
 	std::vector<boost::signals2::scoped_connection> m_connections;
 };
\ No newline at end of file
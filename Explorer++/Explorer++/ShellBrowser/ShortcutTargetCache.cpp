@@ -0,0 +1,113 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ShortcutTargetCache.h"
+#include <wil/com.h>
+
+ShortcutTargetCache::ShortcutTargetCache(ReadFunction readFunction) : m_readFunction(readFunction)
+{
+}
+
+ShortcutTargetCache &ShortcutTargetCache::GetInstance()
+{
+	static ShortcutTargetCache shortcutTargetCache;
+	return shortcutTargetCache;
+}
+
+std::wstring ShortcutTargetCache::GetTarget(
+	const std::wstring &path, const std::optional<FILETIME> &lastWriteTime)
+{
+	if (!lastWriteTime)
+	{
+		return m_readFunction(path);
+	}
+
+	auto key = GetKey(path);
+
+	{
+		std::scoped_lock lock(m_mutex);
+
+		auto itr = m_entries.find(key);
+
+		if (itr != m_entries.end()
+			&& CompareFileTime(&itr->second.lastWriteTime, &*lastWriteTime) == 0)
+		{
+			return itr->second.target;
+		}
+	}
+
+	auto target = m_readFunction(path);
+
+	std::scoped_lock lock(m_mutex);
+
+	if (m_entries.size() >= MAX_ENTRIES)
+	{
+		m_entries.clear();
+	}
+
+	m_entries.insert_or_assign(key, Entry{ *lastWriteTime, target });
+
+	return target;
+}
+
+void ShortcutTargetCache::Clear()
+{
+	std::scoped_lock lock(m_mutex);
+	m_entries.clear();
+}
+
+// Only .lnk files are read. Checking whether any other item is a shortcut would require its
+// attributes to be retrieved (and the item to potentially be opened), which is exactly the sort
+// of access this is designed to avoid.
+std::wstring ShortcutTargetCache::ReadShortcutTarget(const std::wstring &path)
+{
+	if (lstrcmpi(PathFindExtension(path.c_str()), L".lnk") != 0)
+	{
+		return {};
+	}
+
+	wil::com_ptr_nothrow<IShellLink> shellLink;
+	HRESULT hr =
+		CoCreateInstance(CLSID_ShellLink, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&shellLink));
+
+	if (FAILED(hr))
+	{
+		return {};
+	}
+
+	auto persistFile = shellLink.try_query<IPersistFile>();
+
+	if (!persistFile)
+	{
+		return {};
+	}
+
+	hr = persistFile->Load(path.c_str(), STGM_READ);
+
+	if (FAILED(hr))
+	{
+		return {};
+	}
+
+	// Unlike IShellLink::Resolve(), this simply returns the path stored in the shortcut.
+	WCHAR target[MAX_PATH];
+	hr = shellLink->GetPath(
+		target, static_cast<int>(std::size(target)), nullptr, SLGP_UNCPRIORITY);
+
+	if (hr != S_OK)
+	{
+		return {};
+	}
+
+	return target;
+}
+
+std::wstring ShortcutTargetCache::GetKey(const std::wstring &path)
+{
+	std::wstring key = path;
+	CharLowerBuff(key.data(), static_cast<DWORD>(key.size()));
+
+	return key;
+}
\ No newline at end of file
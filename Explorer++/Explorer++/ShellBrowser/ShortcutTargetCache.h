@@ -0,0 +1,56 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <windows.h>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+// Caches the target of each shortcut, keyed by the path of the shortcut. The target is read
+// directly from the shortcut, without the shortcut being resolved. Resolving a shortcut whose
+// target is missing can involve link tracking and searches across the network, which can take
+// a long time. Resolution is left to explicit user actions (e.g. opening the shortcut). An entry
+// is only used while the last write time of the shortcut matches the time stored with the entry.
+//
+// Safe to use from multiple threads. Shortcuts are read without the lock being held.
+class ShortcutTargetCache
+{
+public:
+	// Only replaced in tests.
+	using ReadFunction = std::function<std::wstring(const std::wstring &path)>;
+
+	explicit ShortcutTargetCache(ReadFunction readFunction = ReadShortcutTarget);
+
+	static ShortcutTargetCache &GetInstance();
+
+	// Returns the target of the shortcut, or an empty string if the item isn't a shortcut (or its
+	// target isn't a filesystem path). If no last write time is provided, the shortcut is read
+	// without the result being cached.
+	std::wstring GetTarget(const std::wstring &path, const std::optional<FILETIME> &lastWriteTime);
+
+	void Clear();
+
+	static std::wstring ReadShortcutTarget(const std::wstring &path);
+
+private:
+	// The cache is cleared if it grows beyond this many shortcuts.
+	static const size_t MAX_ENTRIES = 100000;
+
+	struct Entry
+	{
+		FILETIME lastWriteTime;
+		std::wstring target;
+	};
+
+	static std::wstring GetKey(const std::wstring &path);
+
+	const ReadFunction m_readFunction;
+
+	std::mutex m_mutex;
+	std::unordered_map<std::wstring, Entry> m_entries;
+};
\ No newline at end of file
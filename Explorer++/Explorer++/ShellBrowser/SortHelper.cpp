@@ -4,8 +4,41 @@
 
 #include "stdafx.h"
 #include "SortHelper.h"
+#include "../Helper/FolderSizeCache.h"
 #include <wil/common.h>
 #include <propvarutil.h>
+#include <algorithm>
+
+namespace
+{
+
+// The size of a folder is only known once it's been calculated (e.g. to be shown in the size
+// column). Until then, the folder is treated as having a size of 0.
+ULONGLONG GetSortableItemSize(
+	const BasicItemInfo_t &itemInfo, const GlobalFolderSettings &globalFolderSettings)
+{
+	if (WI_IsFlagClear(itemInfo.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+	{
+		return ULARGE_INTEGER{ itemInfo.wfd.nFileSizeLow, itemInfo.wfd.nFileSizeHigh }.QuadPart;
+	}
+
+	if (!globalFolderSettings.showFolderSizes)
+	{
+		return 0;
+	}
+
+	auto folderInfo = FolderSizeCache::GetInstance().GetCachedFolderInfo(
+		itemInfo.getFullPath(), itemInfo.wfd.ftLastWriteTime);
+
+	if (!folderInfo)
+	{
+		return 0;
+	}
+
+	return folderInfo->size;
+}
+
+}
 
 int SortByName(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
 	const GlobalFolderSettings &globalFolderSettings)
@@ -45,7 +78,8 @@ int SortByName(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo
 	}
 }
 
-int SortBySize(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2)
+int SortBySize(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
+	const GlobalFolderSettings &globalFolderSettings)
 {
 	if (!itemInfo1.isFindDataValid && itemInfo2.isFindDataValid)
 	{
@@ -60,46 +94,8 @@ int SortBySize(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo
 		return 0;
 	}
 
-	bool isFolder1 = WI_IsFlagSet(itemInfo1.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY);
-	bool isFolder2 = WI_IsFlagSet(itemInfo2.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY);
-
-	ULONGLONG size1;
-	ULONGLONG size2;
-
-	if (isFolder1 && isFolder2)
-	{
-		// Temporarily disabled.
-		/*auto itr1 = m_cachedFolderSizes.find(InternalIndex1);
-		auto itr2 = m_cachedFolderSizes.find(InternalIndex2);
-
-		if (itr1 == m_cachedFolderSizes.end() && itr2 == m_cachedFolderSizes.end())
-		{
-			return 0;
-		}
-		else if (itr1 != m_cachedFolderSizes.end() && itr2 == m_cachedFolderSizes.end())
-		{
-			return 1;
-		}
-		else if (itr1 == m_cachedFolderSizes.end() && itr2 != m_cachedFolderSizes.end())
-		{
-			return -1;
-		}
-
-		size1 = itr1->second;
-		size2 = itr2->second;*/
-
-		size1 = 0;
-		size2 = 0;
-	}
-	else
-	{
-		// Both items are files (as opposed to folders).
-		ULARGE_INTEGER fileSize1 = { itemInfo1.wfd.nFileSizeLow, itemInfo1.wfd.nFileSizeHigh };
-		ULARGE_INTEGER fileSize2 = { itemInfo2.wfd.nFileSizeLow, itemInfo2.wfd.nFileSizeHigh };
-
-		size1 = fileSize1.QuadPart;
-		size2 = fileSize2.QuadPart;
-	}
+	ULONGLONG size1 = GetSortableItemSize(itemInfo1, globalFolderSettings);
+	ULONGLONG size2 = GetSortableItemSize(itemInfo2, globalFolderSettings);
 
 	if (size1 > size2)
 	{
@@ -256,6 +252,19 @@ int SortByOwner(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInf
 	return StrCmpLogicalW(owner1.c_str(), owner2.c_str());
 }
 
+int SortByChecksum(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2)
+{
+	std::wstring checksum1 = GetChecksumColumnText(itemInfo1);
+	std::wstring checksum2 = GetChecksumColumnText(itemInfo2);
+
+	return StrCmpLogicalW(checksum1.c_str(), checksum2.c_str());
+}
+
+int SortByRelativePath(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2)
+{
+	return StrCmpLogicalW(itemInfo1.relativeFolder.c_str(), itemInfo2.relativeFolder.c_str());
+}
+
 int SortByVersionInfo(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
 	VersionInfoType versionInfoType)
 {
@@ -367,4 +376,433 @@ int SortByMediaMetadata(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t
 	std::wstring mediaMetadata2 = GetMediaMetadataColumnText(itemInfo2, mediaMetadataType);
 
 	return StrCmpLogicalW(mediaMetadata1.c_str(), mediaMetadata2.c_str());
+}
+
+std::optional<SortKeyComparison> GetSortKeyComparison(
+	SortMode sortMode, const GlobalFolderSettings &globalFolderSettings)
+{
+	switch (sortMode)
+	{
+	case SortMode::Name:
+		return SortKeyComparison::Collation;
+
+	case SortMode::Size:
+	case SortMode::DateModified:
+	case SortMode::Created:
+	case SortMode::Accessed:
+	case SortMode::TotalSize:
+	case SortMode::FreeSpace:
+	case SortMode::RealSize:
+	case SortMode::HardLinks:
+		return SortKeyComparison::Number;
+
+	// These modes compare the raw property values (via VariantCompare()), which can't be
+	// represented by a single key.
+	case SortMode::DateDeleted:
+	case SortMode::OriginalLocation:
+	case SortMode::Title:
+	case SortMode::Subject:
+	case SortMode::Authors:
+	case SortMode::Keywords:
+	case SortMode::Comments:
+		return std::nullopt;
+
+	default:
+		return SortKeyComparison::LogicalText;
+	}
+}
+
+// Returns true if building a key for the sort mode involves more than reading the item's find data
+// (e.g. the file has to be opened, or one of its properties has to be read). The keys for these
+// modes are worth keeping once they've been built.
+bool IsSortKeyExpensive(SortMode sortMode)
+{
+	switch (sortMode)
+	{
+	case SortMode::Name:
+	case SortMode::Type:
+	case SortMode::Size:
+	case SortMode::DateModified:
+	case SortMode::Created:
+	case SortMode::Accessed:
+	case SortMode::Extension:
+	case SortMode::RelativePath:
+		return false;
+
+	default:
+		return true;
+	}
+}
+
+// The ordering produced by comparing the keys returned here matches the ordering produced by the
+// corresponding SortBy*() function above.
+SortKey BuildSortKey(const BasicItemInfo_t &itemInfo, SortMode sortMode,
+	const GlobalFolderSettings &globalFolderSettings)
+{
+	SortKey key;
+
+	switch (sortMode)
+	{
+	case SortMode::Name:
+		if (itemInfo.isRoot)
+		{
+			key.text = itemInfo.getFullPath();
+		}
+		else
+		{
+			key.rank = 1;
+			key.text = GetNameColumnText(itemInfo, globalFolderSettings);
+		}
+		break;
+
+	case SortMode::Type:
+		key.rank = itemInfo.isRoot ? 0 : 1;
+		key.text = GetTypeColumnText(itemInfo);
+		break;
+
+	case SortMode::Size:
+		if (itemInfo.isFindDataValid)
+		{
+			key.rank = 1;
+			key.number = GetSortableItemSize(itemInfo, globalFolderSettings);
+		}
+		break;
+
+	case SortMode::DateModified:
+	case SortMode::Created:
+	case SortMode::Accessed:
+		if (itemInfo.isFindDataValid)
+		{
+			const FILETIME &fileTime = (sortMode == +SortMode::DateModified)
+				? itemInfo.wfd.ftLastWriteTime
+				: ((sortMode == +SortMode::Created) ? itemInfo.wfd.ftCreationTime
+													: itemInfo.wfd.ftLastAccessTime);
+
+			key.rank = 1;
+			key.number = ULARGE_INTEGER{ fileTime.dwLowDateTime, fileTime.dwHighDateTime }.QuadPart;
+		}
+		break;
+
+	case SortMode::TotalSize:
+	case SortMode::FreeSpace:
+	{
+		ULARGE_INTEGER driveSpace;
+		BOOL res = GetDriveSpaceColumnRawData(
+			itemInfo, sortMode == +SortMode::TotalSize, driveSpace);
+
+		if (res)
+		{
+			key.rank = 1;
+			key.number = driveSpace.QuadPart;
+		}
+	}
+	break;
+
+	case SortMode::RealSize:
+	{
+		ULARGE_INTEGER realFileSize;
+		bool res = GetRealSizeColumnRawData(itemInfo, realFileSize);
+
+		if (res)
+		{
+			key.rank = 1;
+			key.number = realFileSize.QuadPart;
+		}
+	}
+	break;
+
+	case SortMode::HardLinks:
+		key.number = GetHardLinksColumnRawData(itemInfo);
+		break;
+
+	case SortMode::Attributes:
+		key.text = GetAttributeColumnText(itemInfo);
+		break;
+
+	case SortMode::ShortName:
+		key.text = GetShortNameColumnText(itemInfo);
+		break;
+
+	case SortMode::Owner:
+		key.text = GetOwnerColumnText(itemInfo);
+		break;
+
+	case SortMode::ProductName:
+		key.text = GetVersionColumnText(itemInfo, VersionInfoType::ProductName);
+		break;
+
+	case SortMode::Company:
+		key.text = GetVersionColumnText(itemInfo, VersionInfoType::Company);
+		break;
+
+	case SortMode::Description:
+		key.text = GetVersionColumnText(itemInfo, VersionInfoType::Description);
+		break;
+
+	case SortMode::FileVersion:
+		key.text = GetVersionColumnText(itemInfo, VersionInfoType::FileVersion);
+		break;
+
+	case SortMode::ProductVersion:
+		key.text = GetVersionColumnText(itemInfo, VersionInfoType::ProductVersion);
+		break;
+
+	case SortMode::ShortcutTo:
+		key.text = GetShortcutToColumnText(itemInfo);
+		break;
+
+	case SortMode::Extension:
+		key.text = GetExtensionColumnText(itemInfo);
+		break;
+
+	case SortMode::CameraModel:
+		key.text = GetImageColumnText(itemInfo, PropertyTagEquipModel);
+		break;
+
+	case SortMode::DateTaken:
+		key.text = GetImageColumnText(itemInfo, PropertyTagDateTime);
+		break;
+
+	case SortMode::Width:
+		key.text = GetImageColumnText(itemInfo, PropertyTagImageWidth);
+		break;
+
+	case SortMode::Height:
+		key.text = GetImageColumnText(itemInfo, PropertyTagImageHeight);
+		break;
+
+	case SortMode::VirtualComments:
+		key.text = GetControlPanelCommentsColumnText(itemInfo);
+		break;
+
+	case SortMode::FileSystem:
+		key.text = GetFileSystemColumnText(itemInfo);
+		break;
+
+	case SortMode::NumPrinterDocuments:
+		key.text = GetPrinterColumnText(itemInfo, PrinterInformationType::NumJobs);
+		break;
+
+	case SortMode::PrinterStatus:
+		key.text = GetPrinterColumnText(itemInfo, PrinterInformationType::Status);
+		break;
+
+	case SortMode::PrinterComments:
+		key.text = GetPrinterColumnText(itemInfo, PrinterInformationType::Comments);
+		break;
+
+	case SortMode::PrinterLocation:
+		key.text = GetPrinterColumnText(itemInfo, PrinterInformationType::Location);
+		break;
+
+	case SortMode::NetworkAdapterStatus:
+		key.text = GetNetworkAdapterColumnText(itemInfo);
+		break;
+
+	case SortMode::MediaBitrate:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Bitrate);
+		break;
+
+	case SortMode::MediaCopyright:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Copyright);
+		break;
+
+	case SortMode::MediaDuration:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Duration);
+		break;
+
+	case SortMode::MediaProtected:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Protected);
+		break;
+
+	case SortMode::MediaRating:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Rating);
+		break;
+
+	case SortMode::MediaAlbumArtist:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::AlbumArtist);
+		break;
+
+	case SortMode::MediaAlbum:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::AlbumTitle);
+		break;
+
+	case SortMode::MediaBeatsPerMinute:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::BeatsPerMinute);
+		break;
+
+	case SortMode::MediaComposer:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Composer);
+		break;
+
+	case SortMode::MediaConductor:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Conductor);
+		break;
+
+	case SortMode::MediaDirector:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Director);
+		break;
+
+	case SortMode::MediaGenre:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Genre);
+		break;
+
+	case SortMode::MediaLanguage:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Language);
+		break;
+
+	case SortMode::MediaBroadcastDate:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::BroadcastDate);
+		break;
+
+	case SortMode::MediaChannel:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Channel);
+		break;
+
+	case SortMode::MediaStationName:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::StationName);
+		break;
+
+	case SortMode::MediaMood:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Mood);
+		break;
+
+	case SortMode::MediaParentalRating:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::ParentalRating);
+		break;
+
+	case SortMode::MediaParentalRatingReason:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::ParentalRatingReason);
+		break;
+
+	case SortMode::MediaPeriod:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Period);
+		break;
+
+	case SortMode::MediaProducer:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Producer);
+		break;
+
+	case SortMode::MediaPublisher:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Publisher);
+		break;
+
+	case SortMode::MediaWriter:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Writer);
+		break;
+
+	case SortMode::MediaYear:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Year);
+		break;
+
+	case SortMode::Checksum:
+		key.text = GetChecksumColumnText(itemInfo);
+		break;
+
+	case SortMode::RelativePath:
+		key.text = itemInfo.relativeFolder;
+		break;
+
+	default:
+		assert(false);
+		break;
+	}
+
+	return key;
+}
+
+// Builds the key for a sort mode from the text of the corresponding column. Modes that are compared
+// as text use that text directly, so the item doesn't have to be queried a second time.
+SortKey BuildSortKeyFromColumnText(const BasicItemInfo_t &itemInfo, SortMode sortMode,
+	const std::wstring &columnText, const GlobalFolderSettings &globalFolderSettings)
+{
+	if (GetSortKeyComparison(sortMode, globalFolderSettings) != SortKeyComparison::LogicalText
+		|| sortMode == +SortMode::Type)
+	{
+		return BuildSortKey(itemInfo, sortMode, globalFolderSettings);
+	}
+
+	SortKey key;
+	key.text = columnText;
+	return key;
+}
+
+int CompareSortKeys(const SortKey &key1, const SortKey &key2, SortKeyComparison comparison)
+{
+	if (key1.rank != key2.rank)
+	{
+		return (key1.rank < key2.rank) ? -1 : 1;
+	}
+
+	switch (comparison)
+	{
+	case SortKeyComparison::Number:
+		if (key1.number == key2.number)
+		{
+			return 0;
+		}
+
+		return (key1.number < key2.number) ? -1 : 1;
+
+	case SortKeyComparison::LogicalText:
+		return StrCmpLogicalW(key1.text.c_str(), key2.text.c_str());
+
+	case SortKeyComparison::Collation:
+		return CompareCollationKeys(key1.collationKey, key2.collationKey);
+	}
+
+	return 0;
+}
+
+// Sort keys can be compared with a simple byte comparison, which is significantly cheaper than
+// performing a locale-aware string comparison. When natural sort order is enabled, digits are
+// treated as numbers, matching the behavior of StrCmpLogicalW.
+std::vector<BYTE> CreateCollationKey(const std::wstring &text, bool naturalSortOrder)
+{
+	DWORD flags = LCMAP_SORTKEY | NORM_IGNORECASE;
+
+	if (naturalSortOrder)
+	{
+		WI_SetFlag(flags, SORT_DIGITSASNUMBERS);
+	}
+
+	int size = LCMapStringEx(LOCALE_NAME_USER_DEFAULT, flags, text.c_str(),
+		static_cast<int>(text.size()), nullptr, 0, nullptr, nullptr, 0);
+
+	if (size == 0)
+	{
+		return {};
+	}
+
+	// Note that when generating a sort key, the destination size is specified in bytes.
+	std::vector<BYTE> collationKey(size);
+	size = LCMapStringEx(LOCALE_NAME_USER_DEFAULT, flags, text.c_str(),
+		static_cast<int>(text.size()), reinterpret_cast<LPWSTR>(collationKey.data()), size, nullptr,
+		nullptr, 0);
+
+	if (size == 0)
+	{
+		return {};
+	}
+
+	collationKey.resize(size);
+
+	return collationKey;
+}
+
+int CompareCollationKeys(std::span<const BYTE> key1, std::span<const BYTE> key2)
+{
+	int res = memcmp(key1.data(), key2.data(), (std::min)(key1.size(), key2.size()));
+
+	if (res != 0)
+	{
+		return (res < 0) ? -1 : 1;
+	}
+
+	if (key1.size() == key2.size())
+	{
+		return 0;
+	}
+
+	return (key1.size() < key2.size()) ? -1 : 1;
 }
\ No newline at end of file
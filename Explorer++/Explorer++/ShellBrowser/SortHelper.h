@@ -7,6 +7,10 @@
 #include "ColumnDataRetrieval.h"
 #include "FolderSettings.h"
 #include "ItemData.h"
+#include "SortModes.h"
+#include <optional>
+#include <span>
+#include <vector>
 
 enum class DateType
 {
@@ -15,9 +19,45 @@ enum class DateType
 	Accessed
 };
 
+enum class SortKeyComparison
+{
+	Number,
+	LogicalText,
+
+	// The keys are compared using their collationKey member, which should be generated (via
+	// CreateCollationKey()) from the key text.
+	Collation
+};
+
+// Contains the data that an item is sorted on, for a particular sort mode. Building a key for
+// each item before sorting means that the item data only has to be retrieved once per item,
+// rather than twice per comparison.
+struct SortKey
+{
+	// Keys are ordered by this value first. This is used to place items that have no value (e.g.
+	// items without valid find data) before all other items.
+	int rank = 0;
+
+	std::wstring text;
+	ULONGLONG number = 0;
+	std::vector<BYTE> collationKey;
+};
+
+std::optional<SortKeyComparison> GetSortKeyComparison(
+	SortMode sortMode, const GlobalFolderSettings &globalFolderSettings);
+bool IsSortKeyExpensive(SortMode sortMode);
+SortKey BuildSortKey(const BasicItemInfo_t &itemInfo, SortMode sortMode,
+	const GlobalFolderSettings &globalFolderSettings);
+SortKey BuildSortKeyFromColumnText(const BasicItemInfo_t &itemInfo, SortMode sortMode,
+	const std::wstring &columnText, const GlobalFolderSettings &globalFolderSettings);
+int CompareSortKeys(const SortKey &key1, const SortKey &key2, SortKeyComparison comparison);
+std::vector<BYTE> CreateCollationKey(const std::wstring &text, bool naturalSortOrder);
+int CompareCollationKeys(std::span<const BYTE> key1, std::span<const BYTE> key2);
+
 int SortByName(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
 	const GlobalFolderSettings &globalFolderSettings);
-int SortBySize(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
+int SortBySize(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
+	const GlobalFolderSettings &globalFolderSettings);
 int SortByType(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
 int SortByDate(
 	const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2, DateType dateType);
@@ -27,6 +67,8 @@ int SortByAttributes(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &it
 int SortByRealSize(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
 int SortByShortName(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
 int SortByOwner(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
+int SortByChecksum(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
+int SortByRelativePath(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
 int SortByVersionInfo(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
 	VersionInfoType versionInfoType);
 int SortByShortcutTo(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
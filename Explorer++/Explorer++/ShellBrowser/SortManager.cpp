@@ -8,24 +8,75 @@
 #include "SortHelper.h"
 #include "SortModes.h"
 #include "ViewModes.h"
+#include "../Helper/PerformanceTrace.h"
+#include "../Helper/PriorityTaskScheduler.h"
+#include <wil/common.h>
 #include <propkey.h>
+#include <algorithm>
 #include <cassert>
+#include <execution>
+#include <unordered_set>
+
+namespace
+{
+
+// Returns the first position (between 0 and numItems) for which isBefore() returns false. The
+// items are assumed to be sorted, so that isBefore() returns true for all of the positions before
+// that point.
+template <typename IsBefore>
+int FindSortedPosition(int numItems, IsBefore isBefore)
+{
+	int first = 0;
+	int last = numItems;
+
+	while (first < last)
+	{
+		int middle = first + (last - first) / 2;
+
+		if (isBefore(middle))
+		{
+			first = middle + 1;
+		}
+		else
+		{
+			last = middle;
+		}
+	}
+
+	return first;
+}
+
+int CALLBACK SortByRankStub(LPARAM lParam1, LPARAM lParam2, LPARAM lParamSort)
+{
+	const auto *ranks = reinterpret_cast<const std::vector<int> *>(lParamSort);
+	return (*ranks)[lParam1] - (*ranks)[lParam2];
+}
+
+}
 
 void ShellBrowser::SortFolder(SortMode sortMode)
 {
+	PerformanceTraceActivity traceActivity(L"SortFolder");
+
+	auto startTime = std::chrono::steady_clock::now();
+
 	m_folderSettings.sortMode = sortMode;
 
+	// The groups depend on the sort mode, so they're rebuilt. The group for each item is cached,
+	// so this won't require the items to be queried again if they've been grouped by this sort
+	// mode before.
 	if (m_folderSettings.showInGroups)
 	{
-		ListView_EnableGroupView(m_hListView, FALSE);
-		ListView_RemoveAllGroups(m_hListView);
-		ListView_EnableGroupView(m_hListView, TRUE);
-
 		SetShowInGroups(TRUE);
 	}
 
-	SendMessage(m_hListView, LVM_SORTITEMS, reinterpret_cast<WPARAM>(this),
-		reinterpret_cast<LPARAM>(SortStub));
+	// If the keys for this sort mode still need to be built for a large number of items, they're
+	// built in the background and the items are sorted once that's done, rather than the UI
+	// thread being blocked in the meantime.
+	if (!QueueMissingSortKeys(sortMode))
+	{
+		SortItems();
+	}
 
 	/* If in details view, the column sort
 	arrow will need to be changed to reflect
@@ -34,21 +85,536 @@ void ShellBrowser::SortFolder(SortMode sortMode)
 	{
 		ApplyHeaderSortArrow();
 	}
+
+	if (!m_navigationTiming.completed)
+	{
+		m_navigationTiming.sort += std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now() - startTime);
+	}
 }
 
-int CALLBACK ShellBrowser::SortStub(LPARAM lParam1, LPARAM lParam2, LPARAM lParamSort)
+void ShellBrowser::SortItems()
 {
-	auto *pShellBrowser = reinterpret_cast<ShellBrowser *>(lParamSort);
-	return pShellBrowser->Sort(static_cast<int>(lParam1), static_cast<int>(lParam2));
+	if (m_pendingSortMode)
+	{
+		// The items will be sorted once the remaining sort keys have been built.
+		return;
+	}
+
+	if (IsOwnerDataListViewActive())
+	{
+		SortOwnerDataItems();
+		return;
+	}
+
+	std::vector<int> internalIndexes = GetAllInternalIndexes();
+	int numItems = static_cast<int>(internalIndexes.size());
+
+	SortInternalIndexes(internalIndexes);
+
+	// The listview can only be reordered through a comparison callback, so each item's final
+	// position is passed through and the callback simply compares those positions.
+	std::vector<int> ranks(m_directoryState.itemIDCounter, 0);
+
+	for (int i = 0; i < numItems; i++)
+	{
+		ranks[internalIndexes[i]] = i;
+	}
+
+	ListView_SortItems(m_hListView, SortByRankStub, reinterpret_cast<LPARAM>(&ranks));
+	m_itemPositionIndex.Invalidate();
+}
+
+std::vector<int> ShellBrowser::GetAllInternalIndexes() const
+{
+	if (IsOwnerDataListViewActive())
+	{
+		return m_ownerDataState.items;
+	}
+
+	int numItems = ListView_GetItemCount(m_hListView);
+
+	std::vector<int> internalIndexes;
+	internalIndexes.reserve(numItems);
+
+	for (int i = 0; i < numItems; i++)
+	{
+		internalIndexes.push_back(GetItemInternalIndex(i));
+	}
+
+	return internalIndexes;
+}
+
+// Sorts the specified items using the current sort mode. Where possible, a single key is built for
+// each item up front, so that the comparisons themselves don't need to retrieve any item data.
+void ShellBrowser::SortInternalIndexes(std::vector<int> &internalIndexes)
+{
+	auto comparison =
+		GetSortKeyComparison(m_folderSettings.sortMode, m_config->globalFolderSettings);
+
+	if (!comparison)
+	{
+		std::stable_sort(internalIndexes.begin(), internalIndexes.end(),
+			[this](int internalIndex1, int internalIndex2) {
+				return Sort(internalIndex1, internalIndex2) < 0;
+			});
+		return;
+	}
+
+	std::vector<SortEntry> entries;
+	entries.reserve(internalIndexes.size());
+
+	for (int internalIndex : internalIndexes)
+	{
+		entries.push_back(BuildSortEntry(internalIndex, *comparison));
+	}
+
+	// The comparison only depends on the data captured in each entry, so the sort can safely be
+	// spread across multiple threads.
+	std::sort(std::execution::par, entries.begin(), entries.end(),
+		GetSortEntryComparison(*comparison));
+
+	std::transform(entries.begin(), entries.end(), internalIndexes.begin(),
+		[](const SortEntry &entry) { return entry.internalIndex; });
+}
+
+ShellBrowser::SortEntry ShellBrowser::BuildSortEntry(int internalIndex,
+	SortKeyComparison comparison)
+{
+	SortMode sortMode = m_folderSettings.sortMode;
+	bool cacheKeys = IsSortKeyExpensive(sortMode);
+
+	auto basicItemInfo = getBasicItemInfo(internalIndex);
+	SortKey key;
+
+	// Keys that are expensive to build may already have been built by a column task (or a previous
+	// sort), in which case the item doesn't need to be queried at all.
+	const SortKey *cachedKey = cacheKeys ? GetCachedSortKey(internalIndex, sortMode) : nullptr;
+
+	if (cachedKey)
+	{
+		key = *cachedKey;
+	}
+	else
+	{
+		key = BuildSortKey(*basicItemInfo, sortMode, m_config->globalFolderSettings);
+
+		if (cacheKeys)
+		{
+			m_sortKeyCache[internalIndex][sortMode._to_integral()] = key;
+		}
+	}
+
+	if (comparison == SortKeyComparison::Collation)
+	{
+		key.collationKey = GetNameCollationKey(internalIndex, key.text);
+	}
+
+	return { internalIndex,
+		WI_IsFlagSet(basicItemInfo->wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY),
+		std::move(key), basicItemInfo->szDisplayName };
+}
+
+ShellBrowser::SortEntryComparison ShellBrowser::GetSortEntryComparison(
+	SortKeyComparison comparison) const
+{
+	/* Folders will by default be sorted separately from files,
+	except in the recycle bin. */
+	bool separateFolders = !m_config->globalFolderSettings.displayMixedFilesAndFolders
+		&& m_directoryState.folderType != FolderType::RecycleBin;
+
+	return { comparison, separateFolders, m_config->globalFolderSettings.useNaturalSortOrder,
+		static_cast<bool>(m_folderSettings.sortAscending) };
+}
+
+bool ShellBrowser::SortEntryComparison::operator()(
+	const SortEntry &entry1, const SortEntry &entry2) const
+{
+	int comparisonResult;
+
+	if (separateFolders && entry1.isFolder != entry2.isFolder)
+	{
+		comparisonResult = entry1.isFolder ? -1 : 1;
+	}
+	else
+	{
+		comparisonResult = CompareSortKeys(entry1.key, entry2.key, keyComparison);
+	}
+
+	if (comparisonResult == 0)
+	{
+		if (useNaturalSortOrder)
+		{
+			comparisonResult =
+				StrCmpLogicalW(entry1.displayName.c_str(), entry2.displayName.c_str());
+		}
+		else
+		{
+			comparisonResult = StrCmpIW(entry1.displayName.c_str(), entry2.displayName.c_str());
+		}
+	}
+
+	if (comparisonResult == 0)
+	{
+		// Ensures the resulting order is deterministic.
+		return entry1.internalIndex < entry2.internalIndex;
+	}
+
+	return sortAscending ? (comparisonResult < 0) : (comparisonResult > 0);
+}
+
+// Returns the position at which the item should be inserted, so that the items remain sorted. The
+// existing items are assumed to already be sorted, so the position is found with a binary search
+// and the item only needs to be compared against a handful of the existing items.
+int ShellBrowser::DetermineItemSortedPosition(int internalIndex)
+{
+	int numItems = ListView_GetItemCount(m_hListView);
+	auto comparison =
+		GetSortKeyComparison(m_folderSettings.sortMode, m_config->globalFolderSettings);
+
+	if (!comparison)
+	{
+		return FindSortedPosition(numItems, [this, internalIndex](int index) {
+			return Sort(internalIndex, GetItemInternalIndex(index)) > 0;
+		});
+	}
+
+	SortEntry entry = BuildSortEntry(internalIndex, *comparison);
+	auto entryComparison = GetSortEntryComparison(*comparison);
+
+	return FindSortedPosition(numItems, [&](int index) {
+		return entryComparison(BuildSortEntry(GetItemInternalIndex(index), *comparison), entry);
+	});
+}
+
+// Sets the position of each of the items awaiting insertion, so that they'll be inserted in sorted
+// order. The new items are sorted amongst themselves and then merged into the existing items,
+// which avoids having to re-sort the entire folder when a batch of items is added.
+void ShellBrowser::PositionAwaitingItemsSorted()
+{
+	auto &awaitingAddList = m_directoryState.awaitingAddList;
+
+	std::vector<int> internalIndexes;
+	internalIndexes.reserve(awaitingAddList.size());
+
+	for (const auto &awaitingItem : awaitingAddList)
+	{
+		internalIndexes.push_back(awaitingItem.iItemInternal);
+	}
+
+	SortInternalIndexes(internalIndexes);
+
+	std::vector<AwaitingAdd_t> sortedAwaitingAddList;
+	sortedAwaitingAddList.reserve(internalIndexes.size());
+
+	// Each position is relative to the items present at the time the item is inserted, so it
+	// needs to take into account the new items that will have been inserted before it. Filtered
+	// items are never inserted, so they don't affect the positions of the other items.
+	int numInserted = 0;
+
+	for (int internalIndex : internalIndexes)
+	{
+		AwaitingAdd_t awaitingAdd;
+		awaitingAdd.iItemInternal = internalIndex;
+		awaitingAdd.bPosition = FALSE;
+		awaitingAdd.iAfter = -1;
+		awaitingAdd.iItem = 0;
+
+		if (!IsFileFiltered(m_itemInfoMap.Get(internalIndex)))
+		{
+			awaitingAdd.iItem = DetermineItemSortedPosition(internalIndex) + numInserted;
+			awaitingAdd.bPosition = TRUE;
+			awaitingAdd.iAfter = awaitingAdd.iItem - 1;
+			numInserted++;
+		}
+
+		sortedAwaitingAddList.push_back(awaitingAdd);
+	}
+
+	awaitingAddList = std::move(sortedAwaitingAddList);
+}
+
+const SortKey *ShellBrowser::GetCachedSortKey(int internalIndex, SortMode sortMode) const
+{
+	auto itemItr = m_sortKeyCache.find(internalIndex);
+
+	if (itemItr == m_sortKeyCache.end())
+	{
+		return nullptr;
+	}
+
+	auto keyItr = itemItr->second.find(sortMode._to_integral());
+
+	if (keyItr == itemItr->second.end())
+	{
+		return nullptr;
+	}
+
+	return &keyItr->second;
+}
+
+// Returns the items that don't have a key for the specified sort mode yet and aren't already
+// waiting on a task to build one. Keys are only cached (and built in the background) for modes
+// whose keys are expensive to build, so no items are returned for other modes.
+std::vector<int> ShellBrowser::GetMissingSortKeys(SortMode sortMode) const
+{
+	if (!IsSortKeyExpensive(sortMode)
+		|| !GetSortKeyComparison(sortMode, m_config->globalFolderSettings))
+	{
+		return {};
+	}
+
+	std::unordered_set<int> queuedKeys;
+
+	for (const auto &[sortKeyResultId, pendingSortKeys] : m_sortKeyResults)
+	{
+		if (pendingSortKeys.sortMode == sortMode)
+		{
+			queuedKeys.insert(pendingSortKeys.internalIndexes.begin(),
+				pendingSortKeys.internalIndexes.end());
+		}
+	}
+
+	std::vector<int> missingKeys;
+
+	for (int internalIndex : GetAllInternalIndexes())
+	{
+		if (!GetCachedSortKey(internalIndex, sortMode) && !queuedKeys.contains(internalIndex))
+		{
+			missingKeys.push_back(internalIndex);
+		}
+	}
+
+	return missingKeys;
+}
+
+size_t ShellBrowser::GetNumQueuedSortKeys(SortMode sortMode) const
+{
+	size_t numQueuedKeys = 0;
+
+	for (const auto &[sortKeyResultId, pendingSortKeys] : m_sortKeyResults)
+	{
+		if (pendingSortKeys.sortMode == sortMode)
+		{
+			numQueuedKeys += pendingSortKeys.internalIndexes.size();
+		}
+	}
+
+	return numQueuedKeys;
+}
+
+void ShellBrowser::QueueSortKeyTasks(SortMode sortMode, const std::vector<int> &internalIndexes,
+	int priority)
+{
+	auto settings = GetTaskSettings();
+
+	for (size_t i = 0; i < internalIndexes.size(); i += SORT_KEY_BATCH_SIZE)
+	{
+		std::vector<int> batchInternalIndexes(internalIndexes.begin() + i,
+			internalIndexes.begin() + (std::min)(i + SORT_KEY_BATCH_SIZE, internalIndexes.size()));
+		std::vector<std::pair<int, std::shared_ptr<const BasicItemInfo_t>>> items;
+
+		for (int internalIndex : batchInternalIndexes)
+		{
+			items.emplace_back(internalIndex, getBasicItemInfo(internalIndex));
+		}
+
+		int sortKeyResultId = m_sortKeyResultIdCounter++;
+
+		// The task is keyed by its result ID, so that its priority can be raised if a sort starts
+		// waiting on it. See UpdateSortKeyTaskPriorities().
+		auto result = GetBackgroundTaskScheduler().PushTask(&m_sortKeyResults, sortKeyResultId,
+			priority,
+			[listView = m_hListView, sortKeyResultId, items = std::move(items), sortMode,
+				settings]()
+			{
+				SortKeyResult_t result;
+				result.settingsVersion = settings->version;
+
+				for (const auto &[internalIndex, basicItemInfo] : items)
+				{
+					result.sortKeys.emplace_back(internalIndex,
+						BuildSortKey(*basicItemInfo, sortMode, settings->value));
+				}
+
+				// As with column results, the message handler will wait for the result to be
+				// returned if this message is delivered first.
+				PostMessage(listView, WM_APP_SORT_KEYS_READY, sortKeyResultId, 0);
+
+				return result;
+			});
+
+		m_sortKeyResults.insert({ sortKeyResultId,
+			{ sortMode, std::move(batchInternalIndexes), std::move(result) } });
+	}
+}
+
+// Builds the keys for the specified sort mode in the background, once the tasks for the visible
+// items have run, so that the keys are already available if the folder is then sorted by that
+// mode. This is used when a column is shown, since the column's keys would otherwise only be built
+// for the items that are displayed.
+void ShellBrowser::PrefetchSortKeys(SortMode sortMode)
+{
+	// Building the key for every item would mean accessing every item on the server, which is
+	// what reducing network activity is meant to avoid. The keys will be built if and when the
+	// folder is sorted instead.
+	if (m_reducedNetworkActivity)
+	{
+		return;
+	}
+
+	QueueSortKeyTasks(sortMode, GetMissingSortKeys(sortMode), SORT_KEY_PREFETCH_TASK_PRIORITY);
+}
+
+// Queues tasks to build any sort keys for the specified sort mode that haven't been built yet.
+// Returns true if the sort has to wait on background tasks (because tasks were queued, or were
+// already queued by a previous sort or a prefetch), in which case the items will be sorted once
+// all of the keys have been built. If only a few keys are missing, the sort doesn't wait and the
+// keys will simply be built as the items are sorted.
+bool ShellBrowser::QueueMissingSortKeys(SortMode sortMode)
+{
+	if (m_pendingSortMode == sortMode)
+	{
+		return true;
+	}
+
+	// Any previous sort is superseded by this one. Tasks queued for the previous sort are left in
+	// place, since the keys they build will still be cached, but they're moved back behind the
+	// tasks for this sort below.
+	bool sortWasPending = m_pendingSortMode.has_value();
+	m_pendingSortMode.reset();
+
+	std::vector<int> missingKeys = GetMissingSortKeys(sortMode);
+	size_t numKeysRemaining = missingKeys.size() + GetNumQueuedSortKeys(sortMode);
+
+	if (numKeysRemaining > SORT_KEY_BATCH_SIZE)
+	{
+		QueueSortKeyTasks(sortMode, missingKeys, SORT_KEY_TASK_PRIORITY);
+
+		m_pendingSortMode = sortMode;
+		m_pendingSortNumKeys = numKeysRemaining;
+	}
+
+	UpdateSortKeyTaskPriorities();
+
+	if (sortWasPending || m_pendingSortMode)
+	{
+		pendingSortProgressChanged.m_signal();
+	}
+
+	return m_pendingSortMode.has_value();
+}
+
+// The tasks for the sort mode a sort is waiting on are run ahead of column and thumbnail tasks,
+// while the tasks for any other mode are left until those tasks have run.
+void ShellBrowser::UpdateSortKeyTaskPriorities()
+{
+	GetBackgroundTaskScheduler().UpdatePriorities(&m_sortKeyResults,
+		[this](int sortKeyResultId) -> std::optional<int>
+		{
+			auto itr = m_sortKeyResults.find(sortKeyResultId);
+
+			if (itr != m_sortKeyResults.end() && m_pendingSortMode == itr->second.sortMode)
+			{
+				return SORT_KEY_TASK_PRIORITY;
+			}
+
+			return SORT_KEY_PREFETCH_TASK_PRIORITY;
+		});
+}
+
+void ShellBrowser::ProcessSortKeyResult(int sortKeyResultId)
+{
+	auto itr = m_sortKeyResults.find(sortKeyResultId);
+
+	if (itr == m_sortKeyResults.end())
+	{
+		// This result is for a previous folder. It can be ignored.
+		return;
+	}
+
+	SortMode sortMode = itr->second.sortMode;
+	auto result = itr->second.result.get();
+	m_sortKeyResults.erase(itr);
+
+	// If the settings changed in the meantime, the keys are discarded. Any keys that are still
+	// missing once all the results have arrived will be built as the items are sorted.
+	bool settingsCurrent = m_taskSettings.IsCurrent(result.settingsVersion);
+
+	for (auto &[internalIndex, sortKey] : result.sortKeys)
+	{
+		if (!settingsCurrent || !m_itemInfoMap.Contains(internalIndex))
+		{
+			// The item was removed after this task was queued.
+			continue;
+		}
+
+		m_sortKeyCache[internalIndex][sortMode._to_integral()] = std::move(sortKey);
+	}
+
+	if (m_pendingSortMode != sortMode)
+	{
+		// These keys were prefetched and no sort is waiting on them.
+		return;
+	}
+
+	if (GetNumQueuedSortKeys(sortMode) == 0)
+	{
+		m_pendingSortMode.reset();
+		SortItems();
+	}
+
+	pendingSortProgressChanged.m_signal();
+}
+
+std::optional<PendingSortProgress> ShellBrowser::GetPendingSortProgress() const
+{
+	if (!m_pendingSortMode)
+	{
+		return std::nullopt;
+	}
+
+	size_t numKeysRemaining = GetNumQueuedSortKeys(*m_pendingSortMode);
+
+	// Keys that were already queued when the sort started are included in the total, so the
+	// number remaining can't exceed it.
+	assert(numKeysRemaining <= m_pendingSortNumKeys);
+
+	return PendingSortProgress{ m_pendingSortNumKeys - numKeysRemaining, m_pendingSortNumKeys };
+}
+
+void ShellBrowser::ClearSortKeyResults()
+{
+	GetBackgroundTaskScheduler().CancelTasks(&m_sortKeyResults);
+	m_sortKeyResults.clear();
+	m_pendingSortMode.reset();
 }
 
 /* Also see NBookmarkHelper::Sort. */
+const std::vector<BYTE> &ShellBrowser::GetNameCollationKey(
+	int internalIndex, const std::wstring &text)
+{
+	auto &itemInfo = m_itemInfoMap.Get(internalIndex);
+	bool naturalSortOrder = m_config->globalFolderSettings.useNaturalSortOrder;
+
+	if (!itemInfo.nameCollationKey || itemInfo.nameCollationKey->text != text
+		|| itemInfo.nameCollationKey->naturalSortOrder != naturalSortOrder)
+	{
+		itemInfo.nameCollationKey = { text, naturalSortOrder,
+			CreateCollationKey(text, naturalSortOrder) };
+	}
+
+	return itemInfo.nameCollationKey->key;
+}
+
 int CALLBACK ShellBrowser::Sort(int InternalIndex1, int InternalIndex2) const
 {
 	int comparisonResult = 0;
 
-	BasicItemInfo_t basicItemInfo1 = getBasicItemInfo(InternalIndex1);
-	BasicItemInfo_t basicItemInfo2 = getBasicItemInfo(InternalIndex2);
+	auto itemSnapshot1 = getBasicItemInfo(InternalIndex1);
+	auto itemSnapshot2 = getBasicItemInfo(InternalIndex2);
+	const BasicItemInfo_t &basicItemInfo1 = *itemSnapshot1;
+	const BasicItemInfo_t &basicItemInfo2 = *itemSnapshot2;
 
 	bool isFolder1 = ((basicItemInfo1.wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
 						 == FILE_ATTRIBUTE_DIRECTORY)
@@ -62,12 +628,12 @@ int CALLBACK ShellBrowser::Sort(int InternalIndex1, int InternalIndex2) const
 	/* Folders will by default be sorted separately from files,
 	except in the recycle bin. */
 	if (!m_config->globalFolderSettings.displayMixedFilesAndFolders && isFolder1 && !isFolder2
-		&& !CompareVirtualFolders(CSIDL_BITBUCKET))
+		&& m_directoryState.folderType != FolderType::RecycleBin)
 	{
 		comparisonResult = -1;
 	}
 	else if (!m_config->globalFolderSettings.displayMixedFilesAndFolders && !isFolder1 && isFolder2
-		&& !CompareVirtualFolders(CSIDL_BITBUCKET))
+		&& m_directoryState.folderType != FolderType::RecycleBin)
 	{
 		comparisonResult = 1;
 	}
@@ -85,7 +651,8 @@ int CALLBACK ShellBrowser::Sort(int InternalIndex1, int InternalIndex2) const
 			break;
 
 		case SortMode::Size:
-			comparisonResult = SortBySize(basicItemInfo1, basicItemInfo2);
+			comparisonResult =
+				SortBySize(basicItemInfo1, basicItemInfo2, m_config->globalFolderSettings);
 			break;
 
 		case SortMode::DateModified:
@@ -363,6 +930,14 @@ int CALLBACK ShellBrowser::Sort(int InternalIndex1, int InternalIndex2) const
 				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Year);
 			break;
 
+		case SortMode::Checksum:
+			comparisonResult = SortByChecksum(basicItemInfo1, basicItemInfo2);
+			break;
+
+		case SortMode::RelativePath:
+			comparisonResult = SortByRelativePath(basicItemInfo1, basicItemInfo2);
+			break;
+
 		default:
 			assert(false);
 			break;
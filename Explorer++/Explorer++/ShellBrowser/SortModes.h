@@ -78,6 +78,9 @@ BETTER_ENUM(SortMode, int,
 	MediaProducer = 61,
 	MediaPublisher = 62,
 	MediaWriter = 63,
-	MediaYear = 64
+	MediaYear = 64,
+
+	Checksum = 65,
+	RelativePath = 66
 )
 // clang-format on
\ No newline at end of file
@@ -5,6 +5,18 @@
 #include "stdafx.h"
 #include "ShellBrowser.h"
 #include "Config.h"
+#include "../Helper/FileTypeNameCache.h"
+#include <algorithm>
+
+namespace
+{
+
+// The subitems shown (below the name) for each tile.
+const UINT TILE_COLUMN_TYPE = 1;
+const UINT TILE_COLUMN_SIZE = 2;
+const UINT TILE_COLUMNS[] = { TILE_COLUMN_TYPE, TILE_COLUMN_SIZE };
+
+}
 
 void ShellBrowser::InsertTileViewColumns()
 {
@@ -35,63 +47,119 @@ void ShellBrowser::DeleteTileViewColumns()
 	ListView_DeleteColumn(m_hListView, 1);
 }
 
-void ShellBrowser::SetTileViewInfo()
+// Items are inserted with I_COLUMNSCALLBACK, so the set of tile columns is only requested for
+// tiles that are actually displayed. The listview supplies arrays large enough to hold the
+// maximum number of tile columns.
+void ShellBrowser::GetTileViewColumns(LVITEM *item)
+{
+	item->cColumns = static_cast<UINT>(std::size(TILE_COLUMNS));
+	std::copy(std::begin(TILE_COLUMNS), std::end(TILE_COLUMNS), item->puColumns);
+
+	if ((item->mask & LVIF_COLFMT) == LVIF_COLFMT)
+	{
+		std::fill_n(item->piColFmt, std::size(TILE_COLUMNS), LVCFMT_LEFT);
+	}
+}
+
+// Like the columns in details view, the text for each tile is only retrieved when the tile is
+// displayed. The size comes straight from the item's find data. The type is taken from the shared
+// extension cache where possible. Anything else is retrieved in the background by a column task,
+// with the text being set once the result arrives.
+void ShellBrowser::GetTileViewItemText(LVITEM *item)
 {
-	LVITEM lvItem;
-	BOOL bRes;
-	int nItems;
-	int i = 0;
+	int internalIndex = static_cast<int>(item->lParam);
+	const ItemInfo_t &itemInfo = m_itemInfoMap.Get(internalIndex);
+
+	if (item->iSubItem == TILE_COLUMN_SIZE)
+	{
+		if (!itemInfo.isFindDataValid
+			|| WI_IsFlagSet(itemInfo.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+		{
+			return;
+		}
+
+		ULARGE_INTEGER fileSize;
+		fileSize.LowPart = itemInfo.wfd.nFileSizeLow;
+		fileSize.HighPart = itemInfo.wfd.nFileSizeHigh;
+
+		FormatSizeString(fileSize, item->pszText, item->cchTextMax,
+			m_config->globalFolderSettings.forceSize,
+			m_config->globalFolderSettings.sizeDisplayFormat);
+		return;
+	}
+
+	if (item->iSubItem != TILE_COLUMN_TYPE)
+	{
+		return;
+	}
 
-	nItems = ListView_GetItemCount(m_hListView);
+	auto extension = GetTypeNameExtension(itemInfo);
 
-	for (i = 0; i < nItems; i++)
+	if (extension)
 	{
-		lvItem.mask = LVIF_PARAM;
-		lvItem.iItem = i;
-		lvItem.iSubItem = 0;
-		bRes = ListView_GetItem(m_hListView, &lvItem);
+		auto typeName = GetFileTypeNameCache().GetTypeName(*extension);
 
-		if (bRes)
+		if (typeName)
 		{
-			SetTileViewItemInfo(i, (int) lvItem.lParam);
+			StringCchCopy(item->pszText, item->cchTextMax, typeName->c_str());
+			return;
 		}
 	}
-}
 
-/* TODO: Make this function configurable. */
-void ShellBrowser::SetTileViewItemInfo(int iItem, int iItemInternal)
-{
-	SHFILEINFO shfi;
-	LVTILEINFO lvti;
-	UINT uColumns[2] = { 1, 2 };
-	int columnFormats[2] = { LVCFMT_LEFT, LVCFMT_LEFT };
+	const std::wstring *cachedText = GetCachedColumnText(internalIndex, ColumnType::Type);
 
-	lvti.cbSize = sizeof(lvti);
-	lvti.iItem = iItem;
-	lvti.cColumns = 2;
-	lvti.puColumns = uColumns;
-	lvti.piColFmt = columnFormats;
-	ListView_SetTileInfo(m_hListView, &lvti);
+	if (cachedText)
+	{
+		StringCchCopy(item->pszText, item->cchTextMax, cachedText->c_str());
+	}
+	else
+	{
+		QueueColumnTask(internalIndex, ColumnType::Type);
+	}
+}
 
-	std::wstring fullFileName = GetItemFullName(iItem);
+std::optional<int> ShellBrowser::GetTileColumnIndexByType(ColumnType columnType)
+{
+	switch (columnType)
+	{
+	case ColumnType::Type:
+		return TILE_COLUMN_TYPE;
 
-	SHGetFileInfo(fullFileName.c_str(), 0, &shfi, sizeof(SHFILEINFO), SHGFI_TYPENAME);
+	default:
+		return std::nullopt;
+	}
+}
 
-	ListView_SetItemText(m_hListView, iItem, 1, shfi.szTypeName);
+void ShellBrowser::InvalidateTileViewItemText(int itemIndex)
+{
+	for (UINT column : TILE_COLUMNS)
+	{
+		ListView_SetItemText(m_hListView, itemIndex, column, LPSTR_TEXTCALLBACK);
+	}
+}
 
-	if ((m_itemInfoMap.at(iItemInternal).wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-		!= FILE_ATTRIBUTE_DIRECTORY)
+// Returns the extension that the item's type name can be cached under. Folders can have a custom
+// type, and items outside the filesystem don't necessarily have a type that's determined by their
+// extension, so names for those items are always retrieved individually.
+std::optional<std::wstring> ShellBrowser::GetTypeNameExtension(const ItemInfo_t &itemInfo) const
+{
+	if (InVirtualFolder() || !itemInfo.isFindDataValid
+		|| WI_IsFlagSet(itemInfo.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
 	{
-		TCHAR lpszFileSize[32];
-		ULARGE_INTEGER lFileSize;
+		return std::nullopt;
+	}
 
-		lFileSize.LowPart = m_itemInfoMap.at(iItemInternal).wfd.nFileSizeLow;
-		lFileSize.HighPart = m_itemInfoMap.at(iItemInternal).wfd.nFileSizeHigh;
+	return PathFindExtension(itemInfo.wfd.cFileName);
+}
 
-		FormatSizeString(lFileSize, lpszFileSize, SIZEOF_ARRAY(lpszFileSize),
-			m_config->globalFolderSettings.forceSize,
-			m_config->globalFolderSettings.sizeDisplayFormat);
+// Called when the type name of an item has been retrieved in the background. Every other file with
+// the same extension shares the name, so there's no need to retrieve it for them.
+void ShellBrowser::CacheFileTypeName(int internalIndex, const std::wstring &typeName)
+{
+	auto extension = GetTypeNameExtension(m_itemInfoMap.Get(internalIndex));
 
-		ListView_SetItemText(m_hListView, iItem, 2, lpszFileSize);
+	if (extension)
+	{
+		GetFileTypeNameCache().SetTypeName(*extension, typeName);
 	}
 }
\ No newline at end of file
@@ -0,0 +1,697 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+// Very large folders are displayed using a listview with the LVS_OWNERDATA style. Such a listview
+// doesn't store any items itself; it only stores the number of items and their selection/focus
+// state. This means that inserting an item is trivial, regardless of how many items there are.
+// The LVS_OWNERDATA style can't be added to (or removed from) an existing listview, so a second
+// listview is created the first time it's needed and swapped in place of the standard listview.
+
+#include "stdafx.h"
+#include "ShellBrowser.h"
+#include "Config.h"
+#include "ItemData.h"
+#include "MainResource.h"
+#include "ViewModes.h"
+#include "../Helper/IconFetcher.h"
+#include "../Helper/ListViewHelper.h"
+#include "../Helper/ShellHelper.h"
+#include <wil/common.h>
+#include <algorithm>
+
+bool ShellBrowser::IsOwnerDataListViewActive() const
+{
+	return m_hListView == m_ownerDataListView;
+}
+
+bool ShellBrowser::ShouldUseOwnerDataListView(size_t numItems) const
+{
+	if (m_config->virtualListViewThreshold == 0 || numItems < m_config->virtualListViewThreshold)
+	{
+		return false;
+	}
+
+	// Groups, tiles, thumbnails and checkboxes all depend on per-item data that's stored by the
+	// listview itself, so none of them can be used in owner data mode.
+	return !m_folderSettings.showInGroups && m_folderSettings.viewMode != +ViewMode::Thumbnails
+		&& m_folderSettings.viewMode != +ViewMode::Tiles && !m_config->checkBoxSelection;
+}
+
+void ShellBrowser::SwitchToOwnerDataListView()
+{
+	assert(!IsOwnerDataListViewActive());
+
+	OwnerDataState ownerDataState;
+	std::unordered_set<int> selectedItems;
+	std::optional<int> focusedItem;
+
+	int numItems = ListView_GetItemCount(m_hListView);
+	ownerDataState.items.reserve(numItems + m_directoryState.awaitingAddList.size());
+
+	for (int i = 0; i < numItems; i++)
+	{
+		int internalIndex = GetItemInternalIndex(i);
+		ownerDataState.items.push_back(internalIndex);
+
+		UINT state = ListView_GetItemState(m_hListView, i, LVIS_SELECTED | LVIS_FOCUSED | LVIS_CUT);
+
+		if (WI_IsFlagSet(state, LVIS_SELECTED))
+		{
+			selectedItems.insert(internalIndex);
+		}
+
+		if (WI_IsFlagSet(state, LVIS_FOCUSED))
+		{
+			focusedItem = internalIndex;
+		}
+
+		// Hidden items are always ghosted, so the cut state only needs to be tracked for other
+		// items.
+		if (WI_IsFlagSet(state, LVIS_CUT)
+			&& WI_IsFlagClear(
+				m_itemInfoMap.Get(internalIndex).wfd.dwFileAttributes, FILE_ATTRIBUTE_HIDDEN))
+		{
+			ownerDataState.itemStates[internalIndex].cut = true;
+		}
+	}
+
+	if (!m_ownerDataListView)
+	{
+		m_ownerDataListView = CreateListView(GetParent(m_standardListView), true);
+		ListView_SetCallbackMask(m_ownerDataListView, LVIS_CUT | LVIS_OVERLAYMASK);
+	}
+
+	ActivateListView(m_ownerDataListView);
+
+	m_ownerDataState = std::move(ownerDataState);
+	m_itemPositionIndex.Invalidate();
+	ListView_SetItemCountEx(
+		m_hListView, static_cast<int>(m_ownerDataState.items.size()), LVSICF_NOSCROLL);
+	RestoreOwnerDataSelection(selectedItems, focusedItem);
+	RecalculateSelectionInfo();
+}
+
+void ShellBrowser::SwitchToStandardListView()
+{
+	assert(IsOwnerDataListViewActive());
+
+	std::unordered_set<int> selectedItems = GetOwnerDataSelection();
+	std::optional<int> focusedItem;
+	int focusedIndex = ListView_GetNextItem(m_hListView, -1, LVNI_FOCUSED);
+
+	if (focusedIndex != -1)
+	{
+		focusedItem = GetItemInternalIndex(focusedIndex);
+	}
+
+	ActivateListView(m_standardListView);
+
+	OwnerDataState ownerDataState = std::move(m_ownerDataState);
+	m_ownerDataState = {};
+
+	if (ownerDataState.items.empty())
+	{
+		return;
+	}
+
+	// The items will be inserted into the standard listview in their current order. The running
+	// totals are reset here, since they'll be recalculated as the items are inserted and
+	// reselected.
+	m_directoryState.numItems = 0;
+	m_directoryState.totalDirSize = {};
+	ResetSelectionInfo();
+
+	for (int internalIndex : ownerDataState.items)
+	{
+		AwaitingAdd_t awaitingAdd;
+		awaitingAdd.iItem =
+			m_directoryState.numItems + static_cast<int>(m_directoryState.awaitingAddList.size());
+		awaitingAdd.iItemInternal = internalIndex;
+		awaitingAdd.bPosition = FALSE;
+		awaitingAdd.iAfter = -1;
+		m_directoryState.awaitingAddList.push_back(awaitingAdd);
+	}
+
+	SendMessage(m_hListView, WM_SETREDRAW, FALSE, NULL);
+
+	InsertAwaitingItems(m_folderSettings.showInGroups);
+
+	for (const auto &[internalIndex, itemState] : ownerDataState.itemStates)
+	{
+		if (!itemState.cut)
+		{
+			continue;
+		}
+
+		auto index = LocateItemByInternalIndex(internalIndex);
+
+		if (index)
+		{
+			ListView_SetItemState(m_hListView, *index, LVIS_CUT, LVIS_CUT);
+		}
+	}
+
+	RestoreOwnerDataSelection(selectedItems, focusedItem);
+
+	SendMessage(m_hListView, WM_SETREDRAW, TRUE, NULL);
+}
+
+// Swaps the specified listview in place of the current one. The new listview takes over the
+// position, visibility and appearance of the current listview, while the current listview is
+// emptied and hidden.
+void ShellBrowser::ActivateListView(HWND listView)
+{
+	HWND previousListView = m_hListView;
+
+	if (listView == previousListView)
+	{
+		return;
+	}
+
+	RECT rc;
+	GetWindowRect(previousListView, &rc);
+	MapWindowPoints(HWND_DESKTOP, GetParent(previousListView), reinterpret_cast<LPPOINT>(&rc), 2);
+
+	bool visible = IsWindowVisible(previousListView);
+	bool focused = (GetFocus() == previousListView);
+
+	if (m_listViewColumnsSetUp)
+	{
+		SaveColumnWidths();
+	}
+
+	// Columns belong to the header of each listview, so they'll be set up again in the new
+	// listview.
+	while (ListView_DeleteColumn(previousListView, 0))
+	{
+	}
+
+	m_listViewColumnsSetUp = false;
+	m_nCurrentColumns = 0;
+
+	ListView_DeleteAllItems(previousListView);
+
+	// The redraw state may have been turned off by the caller.
+	SendMessage(previousListView, WM_SETREDRAW, TRUE, NULL);
+
+	m_hListView = listView;
+	m_itemPositionIndex.Invalidate();
+	ResetWindow(listView);
+
+	if (!GetWindowSubclass(listView, ListViewProcStub, LISTVIEW_SUBCLASS_ID, nullptr))
+	{
+		InitializeListView();
+	}
+	else
+	{
+		// Any of these settings may have changed while the listview was inactive.
+		ListViewHelper::SetAutoArrange(m_hListView, m_folderSettings.autoArrange);
+		ListViewHelper::SetGridlines(m_hListView, m_config->globalFolderSettings.showGridlines);
+		ListViewHelper::ActivateOneClickSelect(m_hListView,
+			m_config->globalFolderSettings.oneClickActivate,
+			m_config->globalFolderSettings.oneClickActivateHoverTime);
+	}
+
+	ListView_SetExtendedListViewStyle(
+		m_hListView, ListView_GetExtendedListViewStyle(previousListView));
+	ListView_SetBkColor(m_hListView, ListView_GetBkColor(previousListView));
+	ListView_SetTextBkColor(m_hListView, ListView_GetTextBkColor(previousListView));
+	ListView_SetTextColor(m_hListView, ListView_GetTextColor(previousListView));
+	SendMessage(m_hListView, WM_SETFONT, SendMessage(previousListView, WM_GETFONT, 0, 0), FALSE);
+	ListViewHelper::SetBackgroundImage(
+		m_hListView, m_folderSettings.applyFilter ? IDB_FILTERINGAPPLIED : NULL);
+
+	SetViewModeInternal(m_folderSettings.viewMode);
+
+	if (m_folderSettings.viewMode == +ViewMode::Details)
+	{
+		ApplyHeaderSortArrow();
+	}
+
+	SetWindowPos(m_hListView, previousListView, rc.left, rc.top, rc.right - rc.left,
+		rc.bottom - rc.top, visible ? SWP_SHOWWINDOW : SWP_HIDEWINDOW);
+	ShowWindow(previousListView, SW_HIDE);
+
+	if (focused)
+	{
+		SetFocus(m_hListView);
+	}
+
+	listViewChanged.m_signal(previousListView, m_hListView);
+}
+
+void ShellBrowser::InsertAwaitingItemsIntoOwnerDataListView()
+{
+	auto &items = m_ownerDataState.items;
+
+	// Items are typically appended. If any are inserted between existing items, the selection
+	// (which the listview tracks by index) needs to be moved along with the items.
+	bool preserveSelection = std::any_of(m_directoryState.awaitingAddList.begin(),
+		m_directoryState.awaitingAddList.end(), [&items](const AwaitingAdd_t &awaitingItem) {
+			return awaitingItem.iItem < static_cast<int>(items.size());
+		});
+
+	std::unordered_set<int> selectedItems;
+	std::optional<int> focusedItem;
+
+	if (preserveSelection)
+	{
+		selectedItems = GetOwnerDataSelection();
+
+		int focusedIndex = ListView_GetNextItem(m_hListView, -1, LVNI_FOCUSED);
+
+		if (focusedIndex != -1)
+		{
+			focusedItem = GetItemInternalIndex(focusedIndex);
+		}
+	}
+
+	std::vector<std::pair<int, int>> insertions;
+	insertions.reserve(m_directoryState.awaitingAddList.size());
+
+	std::optional<int> itemToRename;
+
+	for (const auto &awaitingItem : m_directoryState.awaitingAddList)
+	{
+		const auto &itemInfo = m_itemInfoMap.Get(awaitingItem.iItemInternal);
+
+		if (IsFileFiltered(itemInfo))
+		{
+			m_directoryState.filteredItemsList.insert(awaitingItem.iItemInternal);
+			continue;
+		}
+
+		insertions.emplace_back(awaitingItem.iItem, awaitingItem.iItemInternal);
+
+		if (m_queuedRenameItem
+			&& ArePidlsEquivalent(itemInfo.pidlComplete.get(), m_queuedRenameItem.get()))
+		{
+			itemToRename = awaitingItem.iItemInternal;
+		}
+
+		ULARGE_INTEGER ulFileSize;
+		ulFileSize.LowPart = itemInfo.wfd.nFileSizeLow;
+		ulFileSize.HighPart = itemInfo.wfd.nFileSizeHigh;
+
+		m_directoryState.totalDirSize.QuadPart += ulFileSize.QuadPart;
+	}
+
+	InsertOwnerDataItems(insertions);
+
+	m_directoryState.numItems = static_cast<int>(items.size());
+	m_directoryState.awaitingAddList.clear();
+
+	DWORD flags = LVSICF_NOSCROLL;
+
+	if (!preserveSelection)
+	{
+		WI_SetFlag(flags, LVSICF_NOINVALIDATEALL);
+	}
+
+	ListView_SetItemCountEx(m_hListView, m_directoryState.numItems, flags);
+
+	if (preserveSelection)
+	{
+		RestoreOwnerDataSelection(selectedItems, focusedItem);
+	}
+
+	if (itemToRename)
+	{
+		m_queuedRenameItem.reset();
+
+		auto index = LocateItemByInternalIndex(*itemToRename);
+
+		if (index)
+		{
+			ListView_EditLabel(m_hListView, *index);
+		}
+	}
+}
+
+// Each insertion is a (position, internal index) pair, where the position is relative to the items
+// present once the previous insertions have been made.
+void ShellBrowser::InsertOwnerDataItems(const std::vector<std::pair<int, int>> &insertions)
+{
+	auto &items = m_ownerDataState.items;
+
+	m_itemPositionIndex.Invalidate();
+
+	bool positionsAscending = std::adjacent_find(insertions.begin(), insertions.end(),
+									[](const auto &insertion1, const auto &insertion2) {
+										return insertion2.first <= insertion1.first;
+									})
+		== insertions.end();
+
+	if (!positionsAscending)
+	{
+		items.reserve(items.size() + insertions.size());
+
+		for (const auto &[position, internalIndex] : insertions)
+		{
+			int clampedPosition = std::clamp(position, 0, static_cast<int>(items.size()));
+			items.insert(items.begin() + clampedPosition, internalIndex);
+		}
+
+		return;
+	}
+
+	// When the positions are strictly ascending (as they are when a batch of items has been placed
+	// in sorted order), the new items can be merged in with a single pass over the existing items,
+	// rather than shifting the existing items once for every new item.
+	std::vector<int> mergedItems;
+	mergedItems.reserve(items.size() + insertions.size());
+
+	auto itr = items.begin();
+
+	for (const auto &[position, internalIndex] : insertions)
+	{
+		while (static_cast<int>(mergedItems.size()) < position && itr != items.end())
+		{
+			mergedItems.push_back(*itr++);
+		}
+
+		mergedItems.push_back(internalIndex);
+	}
+
+	mergedItems.insert(mergedItems.end(), itr, items.end());
+	items = std::move(mergedItems);
+}
+
+void ShellBrowser::RemoveOwnerDataItem(int item)
+{
+	int internalIndex = m_ownerDataState.items[item];
+
+	m_ownerDataState.items.erase(m_ownerDataState.items.begin() + item);
+	m_ownerDataState.itemStates.erase(internalIndex);
+	m_itemPositionIndex.Invalidate();
+
+	// The listview will update its item count and shift the selection of the items that follow.
+	ListView_DeleteItem(m_hListView, item);
+}
+
+void ShellBrowser::SortOwnerDataItems()
+{
+	std::unordered_set<int> selectedItems = GetOwnerDataSelection();
+	std::optional<int> focusedItem;
+	int focusedIndex = ListView_GetNextItem(m_hListView, -1, LVNI_FOCUSED);
+
+	if (focusedIndex != -1)
+	{
+		focusedItem = GetItemInternalIndex(focusedIndex);
+	}
+
+	SortInternalIndexes(m_ownerDataState.items);
+	m_itemPositionIndex.Invalidate();
+
+	RestoreOwnerDataSelection(selectedItems, focusedItem);
+
+	InvalidateRect(m_hListView, nullptr, TRUE);
+}
+
+std::unordered_set<int> ShellBrowser::GetOwnerDataSelection() const
+{
+	std::unordered_set<int> selectedItems;
+	int item = -1;
+
+	while ((item = ListView_GetNextItem(m_hListView, item, LVNI_SELECTED)) != -1)
+	{
+		selectedItems.insert(GetItemInternalIndex(item));
+	}
+
+	return selectedItems;
+}
+
+// Note that this is also used when switching back to the standard listview, so it works in either
+// mode.
+void ShellBrowser::RestoreOwnerDataSelection(
+	const std::unordered_set<int> &selectedItems, std::optional<int> focusedItem)
+{
+	if (!selectedItems.empty())
+	{
+		ListViewHelper::SelectAllItems(m_hListView, FALSE);
+
+		int numItems = ListView_GetItemCount(m_hListView);
+
+		for (int i = 0; i < numItems; i++)
+		{
+			if (selectedItems.count(GetItemInternalIndex(i)) > 0)
+			{
+				ListViewHelper::SelectItem(m_hListView, i, TRUE);
+			}
+		}
+	}
+
+	if (focusedItem)
+	{
+		auto index = LocateItemByInternalIndex(*focusedItem);
+
+		if (index)
+		{
+			ListViewHelper::FocusItem(m_hListView, *index, TRUE);
+		}
+	}
+}
+
+void ShellBrowser::OnOwnerDataGetDisplayInfo(LVITEM *item)
+{
+	if (item->iItem < 0 || item->iItem >= static_cast<int>(m_ownerDataState.items.size()))
+	{
+		return;
+	}
+
+	int internalIndex = m_ownerDataState.items[item->iItem];
+	const ItemInfo_t &itemInfo = m_itemInfoMap.Get(internalIndex);
+	const OwnerDataItemState &itemState = m_ownerDataState.itemStates[internalIndex];
+
+	if (WI_IsFlagSet(item->mask, LVIF_TEXT))
+	{
+		std::wstring text = GetOwnerDataItemText(internalIndex, item->iSubItem);
+		StringCchCopy(item->pszText, item->cchTextMax, text.c_str());
+	}
+
+	if (WI_IsAnyFlagSet(item->mask, LVIF_IMAGE | LVIF_STATE))
+	{
+		OwnerDataItemImage image = GetOwnerDataItemImage(internalIndex);
+
+		if (WI_IsFlagSet(item->mask, LVIF_IMAGE))
+		{
+			item->iImage = image.iconIndex;
+		}
+
+		if (WI_IsFlagSet(item->mask, LVIF_STATE))
+		{
+			WI_ClearAllFlags(item->state, LVIS_CUT | LVIS_OVERLAYMASK);
+
+			if (itemState.cut
+				|| WI_IsFlagSet(itemInfo.wfd.dwFileAttributes, FILE_ATTRIBUTE_HIDDEN))
+			{
+				WI_SetFlag(item->state, LVIS_CUT);
+			}
+
+			WI_SetAllFlags(item->state, INDEXTOOVERLAYMASK(image.overlayIndex));
+		}
+	}
+}
+
+// Returns the text for the specified column, queuing a task to retrieve it if it isn't cached yet.
+std::wstring ShellBrowser::GetOwnerDataItemText(int internalIndex, int subItem)
+{
+	std::optional<ColumnType> columnType = ColumnType::Name;
+
+	if (m_folderSettings.viewMode == +ViewMode::Details)
+	{
+		columnType = GetColumnTypeByIndex(subItem);
+	}
+
+	if (!columnType)
+	{
+		// The column may have just been removed.
+		return {};
+	}
+
+	if (*columnType == ColumnType::Name)
+	{
+		return ProcessItemFileName(
+			*getBasicItemInfo(internalIndex), m_config->globalFolderSettings);
+	}
+
+	const std::wstring *cachedText = GetCachedColumnText(internalIndex, *columnType);
+
+	if (!cachedText)
+	{
+		QueueColumnTask(internalIndex, *columnType);
+		return {};
+	}
+
+	return *cachedText;
+}
+
+ShellBrowser::OwnerDataItemImage ShellBrowser::GetOwnerDataItemImage(int internalIndex)
+{
+	const ItemInfo_t &itemInfo = m_itemInfoMap.Get(internalIndex);
+	OwnerDataItemState &itemState = m_ownerDataState.itemStates[internalIndex];
+
+	// The image is requested every time the item is drawn, so the icon only needs to be retrieved
+	// once.
+	if (!itemState.iconRequested)
+	{
+		itemState.iconRequested = true;
+
+		m_iconFetcher->QueueIconTask(
+			itemInfo.pidlComplete.get(), [this, internalIndex](int iconIndex) {
+				ProcessIconResult(internalIndex, iconIndex);
+			});
+	}
+
+	std::optional<int> iconIndex = itemState.iconIndex;
+
+	if (!iconIndex)
+	{
+		iconIndex = GetCachedIconIndex(itemInfo);
+	}
+
+	OwnerDataItemImage image;
+	image.overlayIndex = iconIndex ? (*iconIndex >> 24) : 0;
+
+	if (itemState.iconIndex)
+	{
+		image.iconIndex = *itemState.iconIndex;
+	}
+	else if (iconIndex)
+	{
+		// See the comment in OnListViewGetDisplayInfo() for why the upper bits are masked out.
+		image.iconIndex = (*iconIndex & 0x0FFF);
+	}
+	else
+	{
+		image.iconIndex = GetDefaultIconIndex(itemInfo);
+	}
+
+	return image;
+}
+
+int ShellBrowser::OnOwnerDataFindItem(const NMLVFINDITEM *findItem) const
+{
+	const LVFINDINFO &findInfo = findItem->lvfi;
+
+	if (WI_IsFlagSet(findInfo.flags, LVFI_PARAM))
+	{
+		return LocateItemByInternalIndex(static_cast<int>(findInfo.lParam)).value_or(-1);
+	}
+
+	if (!WI_IsAnyFlagSet(findInfo.flags, LVFI_STRING | LVFI_PARTIAL) || !findInfo.psz)
+	{
+		return -1;
+	}
+
+	int numItems = static_cast<int>(m_ownerDataState.items.size());
+
+	if (numItems == 0)
+	{
+		return -1;
+	}
+
+	int start = (findItem->iStart >= 0 && findItem->iStart < numItems) ? findItem->iStart : 0;
+	int numItemsToSearch = WI_IsFlagSet(findInfo.flags, LVFI_WRAP) ? numItems : numItems - start;
+	bool partial = WI_IsFlagSet(findInfo.flags, LVFI_PARTIAL);
+	int searchLength = lstrlen(findInfo.psz);
+
+	for (int i = 0; i < numItemsToSearch; i++)
+	{
+		int index = (start + i) % numItems;
+		const auto &displayName = m_itemInfoMap.Get(m_ownerDataState.items[index]).displayName;
+
+		int res = partial ? StrCmpNIW(displayName.c_str(), findInfo.psz, searchLength)
+						  : StrCmpIW(displayName.c_str(), findInfo.psz);
+
+		if (res == 0)
+		{
+			return index;
+		}
+	}
+
+	return -1;
+}
+
+void ShellBrowser::RecalculateSelectionInfo()
+{
+	ResetSelectionInfo();
+
+	int item = -1;
+
+	while ((item = ListView_GetNextItem(m_hListView, item, LVNI_SELECTED)) != -1)
+	{
+		UpdateFileSelectionInfo(GetItemInternalIndex(item), TRUE);
+	}
+}
+
+void ShellBrowser::OnOwnerDataColumnResultsProcessed()
+{
+	// The text itself has already been cached by ProcessColumnResult().
+	//
+	// Results are generally only requested for items that are currently visible. Rather than
+	// locating each item (which requires a linear search in owner data mode), the listview is
+	// simply invalidated once for the whole batch.
+	InvalidateRect(m_hListView, nullptr, FALSE);
+}
+
+void ShellBrowser::ProcessOwnerDataIconResult(int internalIndex, int iconIndex)
+{
+	if (!m_itemInfoMap.Contains(internalIndex))
+	{
+		return;
+	}
+
+	m_ownerDataState.itemStates[internalIndex].iconIndex = iconIndex;
+
+	InvalidateRect(m_hListView, nullptr, FALSE);
+}
+
+void ShellBrowser::InvalidateOwnerDataItem(int internalIndex, bool columns, bool icon)
+{
+	if (columns)
+	{
+		InvalidateCachedColumnText(internalIndex);
+	}
+
+	auto itr = m_ownerDataState.itemStates.find(internalIndex);
+
+	if (itr != m_ownerDataState.itemStates.end())
+	{
+		if (icon)
+		{
+			itr->second.iconIndex.reset();
+			itr->second.iconRequested = false;
+		}
+	}
+
+	InvalidateRect(m_hListView, nullptr, FALSE);
+}
+
+void ShellBrowser::MarkOwnerDataItemAsCut(int item, bool cut)
+{
+	m_ownerDataState.itemStates[GetItemInternalIndex(item)].cut = cut;
+
+	ListView_RedrawItems(m_hListView, item, item);
+}
+
+// The cut state of owner data items is keyed by internal index, so the items don't need to be
+// located in the listview. A single repaint is performed once all the states have been updated.
+void ShellBrowser::MarkOwnerDataItemsAsCut(const std::unordered_set<int> &internalIndexes)
+{
+	for (int internalIndex : internalIndexes)
+	{
+		const auto &itemInfo = m_itemInfoMap.Get(internalIndex);
+
+		// As in MarkItemAsCut(), hidden items are always shown as cut.
+		if (WI_IsFlagSet(itemInfo.wfd.dwFileAttributes, FILE_ATTRIBUTE_HIDDEN))
+		{
+			continue;
+		}
+
+		m_ownerDataState.itemStates[internalIndex].cut = m_cutItems.contains(internalIndex);
+	}
+
+	InvalidateRect(m_hListView, nullptr, FALSE);
+}
\ No newline at end of file
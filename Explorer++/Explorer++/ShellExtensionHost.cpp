@@ -0,0 +1,246 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ShellExtensionHost.h"
+#include "../Helper/ImageHelper.h"
+#include "../Helper/Macros.h"
+#include <wil/com.h>
+#include <wil/resource.h>
+#include <propvarutil.h>
+
+namespace ShellExtensionHost
+{
+
+namespace
+{
+
+const wchar_t OBJECT_NAME_PREFIX[] = L"Local\\Explorer++ShellExtensionHost-";
+
+std::byte *GetPayload(SharedHeader *header)
+{
+	return reinterpret_cast<std::byte *>(header + 1);
+}
+
+// The pidl is copied out of the shared memory, so that it can't be changed while it's in use. It's
+// only returned if it's properly terminated within the payload.
+std::optional<std::vector<std::byte>> ReadPidl(SharedHeader *header)
+{
+	if (header->payloadSize > MAX_PAYLOAD_SIZE)
+	{
+		return std::nullopt;
+	}
+
+	std::vector<std::byte> pidl(GetPayload(header), GetPayload(header) + header->payloadSize);
+	size_t offset = 0;
+
+	while (offset + sizeof(USHORT) <= pidl.size())
+	{
+		USHORT cb;
+		memcpy(&cb, pidl.data() + offset, sizeof(cb));
+
+		if (cb == 0)
+		{
+			return pidl;
+		}
+
+		offset += cb;
+	}
+
+	return std::nullopt;
+}
+
+HRESULT ExtractThumbnail(SharedHeader *header, PCIDLIST_ABSOLUTE pidl,
+	wil::com_ptr_nothrow<IThumbnailCache> &thumbnailCache)
+{
+	wil::com_ptr_nothrow<IShellItem> shellItem;
+	RETURN_IF_FAILED(SHCreateItemFromIDList(pidl, IID_PPV_ARGS(&shellItem)));
+
+	if (!thumbnailCache)
+	{
+		RETURN_IF_FAILED(CoCreateInstance(CLSID_LocalThumbnailCache, nullptr,
+			CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&thumbnailCache)));
+	}
+
+	wil::com_ptr_nothrow<ISharedBitmap> sharedBitmap;
+	RETURN_IF_FAILED(thumbnailCache->GetThumbnail(shellItem.get(), header->thumbnailSize,
+		header->thumbnailFlags, &sharedBitmap, nullptr, nullptr));
+
+	HBITMAP bitmap;
+	RETURN_IF_FAILED(sharedBitmap->GetSharedBitmap(&bitmap));
+
+	BITMAP bitmapInfo;
+
+	if (GetObject(bitmap, sizeof(bitmapInfo), &bitmapInfo) == 0 || bitmapInfo.bmWidth <= 0
+		|| bitmapInfo.bmHeight <= 0)
+	{
+		return E_FAIL;
+	}
+
+	size_t pixelsSize = static_cast<size_t>(bitmapInfo.bmWidth) * bitmapInfo.bmHeight
+		* sizeof(uint32_t);
+
+	if (pixelsSize > MAX_PAYLOAD_SIZE)
+	{
+		return E_OUTOFMEMORY;
+	}
+
+	// The pixels are written directly into the shared memory. A negative height results in a
+	// top-down image.
+	BITMAPINFO bmi;
+	ImageHelper::InitBitmapInfo(
+		&bmi, sizeof(bmi), bitmapInfo.bmWidth, -bitmapInfo.bmHeight, 32);
+
+	wil::unique_hdc_window hdc(GetDC(nullptr));
+	int res = GetDIBits(hdc.get(), bitmap, 0, bitmapInfo.bmHeight, GetPayload(header), &bmi,
+		DIB_RGB_COLORS);
+
+	if (res == 0)
+	{
+		return E_FAIL;
+	}
+
+	header->thumbnailWidth = bitmapInfo.bmWidth;
+	header->thumbnailHeight = bitmapInfo.bmHeight;
+	header->payloadSize = static_cast<uint32_t>(pixelsSize);
+
+	return S_OK;
+}
+
+HRESULT GetDetails(SharedHeader *header, PCIDLIST_ABSOLUTE pidl)
+{
+	wil::com_ptr_nothrow<IShellFolder2> parent;
+	PCITEMID_CHILD child;
+	RETURN_IF_FAILED(SHBindToParent(pidl, IID_PPV_ARGS(&parent), &child));
+
+	wil::unique_variant value;
+	RETURN_IF_FAILED(
+		parent->GetDetailsEx(child, &header->propertyKey, value.reset_and_addressof()));
+
+	wil::unique_prop_variant propValue;
+	RETURN_IF_FAILED(VariantToPropVariant(&value, propValue.reset_and_addressof()));
+
+	wil::unique_cotaskmem_ptr<SERIALIZEDPROPERTYVALUE> serializedValue;
+	ULONG serializedSize;
+	RETURN_IF_FAILED(
+		StgSerializePropVariant(&propValue, wil::out_param(serializedValue), &serializedSize));
+
+	if (serializedSize > MAX_PAYLOAD_SIZE)
+	{
+		return E_OUTOFMEMORY;
+	}
+
+	memcpy(GetPayload(header), serializedValue.get(), serializedSize);
+	header->payloadSize = serializedSize;
+
+	return S_OK;
+}
+
+void ProcessRequest(SharedHeader *header, wil::com_ptr_nothrow<IThumbnailCache> &thumbnailCache)
+{
+	auto pidl = ReadPidl(header);
+
+	header->payloadSize = 0;
+
+	if (!pidl)
+	{
+		header->result = E_INVALIDARG;
+		return;
+	}
+
+	auto pidlAbsolute = reinterpret_cast<PCIDLIST_ABSOLUTE>(pidl->data());
+
+	switch (header->type)
+	{
+	case RequestType::ExtractThumbnail:
+		header->result = ExtractThumbnail(header, pidlAbsolute, thumbnailCache);
+		break;
+
+	case RequestType::GetDetails:
+		header->result = GetDetails(header, pidlAbsolute);
+		break;
+
+	default:
+		header->result = E_INVALIDARG;
+		break;
+	}
+
+	if (FAILED(header->result))
+	{
+		header->payloadSize = 0;
+	}
+}
+
+}
+
+std::wstring GetSharedMemoryName(const std::wstring &channel)
+{
+	return OBJECT_NAME_PREFIX + channel + L"-Memory";
+}
+
+std::wstring GetRequestEventName(const std::wstring &channel)
+{
+	return OBJECT_NAME_PREFIX + channel + L"-Request";
+}
+
+std::wstring GetResponseEventName(const std::wstring &channel)
+{
+	return OBJECT_NAME_PREFIX + channel + L"-Response";
+}
+
+int Run(const std::vector<std::wstring> &args)
+{
+	if (args.size() != 2)
+	{
+		return EXIT_FAILURE;
+	}
+
+	const std::wstring &channel = args[0];
+	auto parentProcessId = static_cast<DWORD>(wcstoul(args[1].c_str(), nullptr, 10));
+
+	// An extension that crashes shouldn't result in an error dialog being shown. The parent
+	// process will notice that the host has exited and start another one when needed.
+	SetErrorMode(SEM_FAILCRITICALERRORS | SEM_NOGPFAULTERRORBOX);
+
+	wil::unique_handle parentProcess(OpenProcess(SYNCHRONIZE, FALSE, parentProcessId));
+	wil::unique_handle mapping(OpenFileMapping(
+		FILE_MAP_READ | FILE_MAP_WRITE, FALSE, GetSharedMemoryName(channel).c_str()));
+	wil::unique_event_nothrow requestEvent;
+	wil::unique_event_nothrow responseEvent;
+
+	if (!parentProcess || !mapping
+		|| !requestEvent.try_open(GetRequestEventName(channel).c_str())
+		|| !responseEvent.try_open(GetResponseEventName(channel).c_str()))
+	{
+		return EXIT_FAILURE;
+	}
+
+	wil::unique_mapview_ptr<SharedHeader> header(static_cast<SharedHeader *>(
+		MapViewOfFile(mapping.get(), FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, SHARED_MEMORY_SIZE)));
+
+	if (!header)
+	{
+		return EXIT_FAILURE;
+	}
+
+	// As with the thumbnail cache instances used in the parent process, this is created on first
+	// use and then reused for each subsequent thumbnail.
+	wil::com_ptr_nothrow<IThumbnailCache> thumbnailCache;
+
+	HANDLE handles[] = { requestEvent.get(), parentProcess.get() };
+
+	while (WaitForMultipleObjects(SIZEOF_ARRAY(handles), handles, FALSE, INFINITE)
+		== WAIT_OBJECT_0)
+	{
+		ProcessRequest(header.get(), thumbnailCache);
+		responseEvent.SetEvent();
+	}
+
+	// The thumbnail cache needs to be released before COM is uninitialized.
+	thumbnailCache.reset();
+
+	return EXIT_SUCCESS;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <thumbcache.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A host process runs the third-party shell extensions (thumbnail providers and property
+// handlers) that would otherwise be loaded into the main process. It's started by
+// ShellExtensionHostPool, e.g.
+//
+// Explorer++.exe --shell-extension-host <channel> <parent process id>
+//
+// Each request is written into a section of shared memory that's named after the channel. The
+// host processes one request at a time and exits once the parent process does.
+namespace ShellExtensionHost
+{
+	inline const wchar_t ARGUMENT[] = L"--shell-extension-host";
+
+	enum class RequestType : uint32_t
+	{
+		ExtractThumbnail,
+		GetDetails
+	};
+
+	// This appears at the start of the shared memory and is followed by the payload. The request
+	// fields are written by the parent process before the request event is signaled. The host
+	// then writes the response fields before signaling the response event.
+	struct SharedHeader
+	{
+		RequestType type;
+		uint32_t thumbnailSize;
+		WTS_FLAGS thumbnailFlags;
+		PROPERTYKEY propertyKey;
+
+		HRESULT result;
+		int32_t thumbnailWidth;
+		int32_t thumbnailHeight;
+
+		// For a request, the payload contains the item's absolute pidl. For a response, it
+		// contains either the thumbnail's 32-bit top-down pixels, or a serialized PROPVARIANT.
+		uint32_t payloadSize;
+	};
+
+	// This is large enough to hold the pixels for a thumbnail at the size it's extracted at.
+	constexpr size_t SHARED_MEMORY_SIZE = 4 * 1024 * 1024;
+	constexpr size_t MAX_PAYLOAD_SIZE = SHARED_MEMORY_SIZE - sizeof(SharedHeader);
+
+	std::wstring GetSharedMemoryName(const std::wstring &channel);
+	std::wstring GetRequestEventName(const std::wstring &channel);
+	std::wstring GetResponseEventName(const std::wstring &channel);
+
+	// The arguments are those that follow ARGUMENT (the channel and the parent process id).
+	// Returns the exit code for the process.
+	int Run(const std::vector<std::wstring> &args);
+}
\ No newline at end of file
@@ -0,0 +1,248 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ShellExtensionHostPool.h"
+#include "../Helper/Helper.h"
+#include "../Helper/Macros.h"
+#include "../Helper/ProcessHelper.h"
+#include <boost/format.hpp>
+#include <propvarutil.h>
+
+using namespace ShellExtensionHost;
+
+ShellExtensionHostPool &ShellExtensionHostPool::GetInstance()
+{
+	static ShellExtensionHostPool shellExtensionHostPool;
+	return shellExtensionHostPool;
+}
+
+void ShellExtensionHostPool::SetEnabled(bool enabled)
+{
+	m_enabled = enabled;
+}
+
+bool ShellExtensionHostPool::IsEnabled() const
+{
+	return m_enabled;
+}
+
+std::optional<TieredThumbnailCache::Image> ShellExtensionHostPool::ExtractThumbnail(
+	PCIDLIST_ABSOLUTE pidl, UINT size, WTS_FLAGS flags)
+{
+	std::optional<TieredThumbnailCache::Image> image;
+
+	SendRequest(
+		[pidl, size, flags](SharedHeader *header) {
+			header->type = RequestType::ExtractThumbnail;
+			header->thumbnailSize = size;
+			header->thumbnailFlags = flags;
+			return WritePidl(header, pidl);
+		},
+		THUMBNAIL_TIMEOUT,
+		[&image](const SharedHeader *header) {
+			if (FAILED(header->result) || header->thumbnailWidth <= 0
+				|| header->thumbnailHeight <= 0)
+			{
+				return;
+			}
+
+			size_t numPixels =
+				static_cast<size_t>(header->thumbnailWidth) * header->thumbnailHeight;
+
+			if (header->payloadSize != numPixels * sizeof(uint32_t))
+			{
+				return;
+			}
+
+			auto pixels = reinterpret_cast<const uint32_t *>(header + 1);
+			image = TieredThumbnailCache::Image{ header->thumbnailWidth,
+				header->thumbnailHeight, { pixels, pixels + numPixels } };
+		});
+
+	return image;
+}
+
+HRESULT ShellExtensionHostPool::GetDetailsEx(
+	PCIDLIST_ABSOLUTE pidl, const SHCOLUMNID *pscid, VARIANT *vt)
+{
+	HRESULT hr = E_FAIL;
+
+	SendRequest(
+		[pidl, pscid](SharedHeader *header) {
+			header->type = RequestType::GetDetails;
+			header->propertyKey = *pscid;
+			return WritePidl(header, pidl);
+		},
+		DETAILS_TIMEOUT,
+		[&hr, vt](const SharedHeader *header) {
+			hr = header->result;
+
+			if (FAILED(hr))
+			{
+				return;
+			}
+
+			wil::unique_prop_variant value;
+			hr = StgDeserializePropVariant(
+				reinterpret_cast<const SERIALIZEDPROPERTYVALUE *>(header + 1),
+				header->payloadSize, value.reset_and_addressof());
+
+			if (SUCCEEDED(hr))
+			{
+				hr = PropVariantToVariant(&value, vt);
+			}
+		});
+
+	return hr;
+}
+
+// Returns false if the request couldn't be sent, or the host didn't respond within the timeout.
+bool ShellExtensionHostPool::SendRequest(const WriteRequestCallback &writeRequest,
+	DWORD timeout, const ReadResponseCallback &readResponse)
+{
+	auto host = AcquireHost();
+
+	if (!host)
+	{
+		return false;
+	}
+
+	if (!writeRequest(host->header.get()))
+	{
+		ReleaseHost(std::move(host));
+		return false;
+	}
+
+	host->requestEvent.SetEvent();
+
+	HANDLE handles[] = { host->responseEvent.get(), host->process.hProcess };
+	DWORD waitResult = WaitForMultipleObjects(SIZEOF_ARRAY(handles), handles, FALSE, timeout);
+
+	if (waitResult != WAIT_OBJECT_0)
+	{
+		// The host has either crashed or is stuck inside an extension. In both cases, it can't be
+		// used again.
+		TerminateProcess(host->process.hProcess, EXIT_FAILURE);
+		DiscardHost(std::move(host));
+		return false;
+	}
+
+	readResponse(host->header.get());
+	ReleaseHost(std::move(host));
+
+	return true;
+}
+
+bool ShellExtensionHostPool::WritePidl(SharedHeader *header, PCIDLIST_ABSOLUTE pidl)
+{
+	UINT size = ILGetSize(pidl);
+
+	if (size > MAX_PAYLOAD_SIZE)
+	{
+		return false;
+	}
+
+	memcpy(header + 1, pidl, size);
+	header->payloadSize = size;
+
+	return true;
+}
+
+// Returns an idle host, starting a new one if fewer than MAX_HOSTS are running. Otherwise, this
+// waits until a host becomes available.
+std::unique_ptr<ShellExtensionHostPool::Host> ShellExtensionHostPool::AcquireHost()
+{
+	{
+		std::unique_lock lock(m_mutex);
+		m_hostAvailableCondition.wait(
+			lock, [this] { return !m_idleHosts.empty() || m_numHosts < MAX_HOSTS; });
+
+		if (!m_idleHosts.empty())
+		{
+			auto host = std::move(m_idleHosts.back());
+			m_idleHosts.pop_back();
+			return host;
+		}
+
+		m_numHosts++;
+	}
+
+	auto host = StartHost();
+
+	if (!host)
+	{
+		DiscardHost(nullptr);
+	}
+
+	return host;
+}
+
+void ShellExtensionHostPool::ReleaseHost(std::unique_ptr<Host> host)
+{
+	{
+		std::scoped_lock lock(m_mutex);
+		m_idleHosts.push_back(std::move(host));
+	}
+
+	m_hostAvailableCondition.notify_one();
+}
+
+void ShellExtensionHostPool::DiscardHost(std::unique_ptr<Host> host)
+{
+	host.reset();
+
+	{
+		std::scoped_lock lock(m_mutex);
+		m_numHosts--;
+	}
+
+	m_hostAvailableCondition.notify_one();
+}
+
+std::unique_ptr<ShellExtensionHostPool::Host> ShellExtensionHostPool::StartHost()
+{
+	// The names of the shared objects are unique to each host.
+	std::wstring channel = CreateGUID();
+
+	auto host = std::make_unique<Host>();
+	host->mapping.reset(CreateFileMapping(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0,
+		static_cast<DWORD>(SHARED_MEMORY_SIZE), GetSharedMemoryName(channel).c_str()));
+
+	if (!host->mapping)
+	{
+		return nullptr;
+	}
+
+	host->header.reset(static_cast<SharedHeader *>(MapViewOfFile(
+		host->mapping.get(), FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, SHARED_MEMORY_SIZE)));
+
+	if (!host->header
+		|| !host->requestEvent.try_create(
+			wil::EventOptions::None, GetRequestEventName(channel).c_str())
+		|| !host->responseEvent.try_create(
+			wil::EventOptions::None, GetResponseEventName(channel).c_str()))
+	{
+		return nullptr;
+	}
+
+	TCHAR currentProcess[MAX_PATH];
+	GetProcessImageName(GetCurrentProcessId(), currentProcess, SIZEOF_ARRAY(currentProcess));
+
+	std::wstring arguments = (boost::wformat(L"\"%s\" %s %s %lu") % currentProcess
+		% ShellExtensionHost::ARGUMENT % channel % GetCurrentProcessId())
+								 .str();
+
+	STARTUPINFO startupInfo = {};
+	startupInfo.cb = sizeof(startupInfo);
+	BOOL res = CreateProcess(currentProcess, arguments.data(), nullptr, nullptr, false,
+		NORMAL_PRIORITY_CLASS, nullptr, nullptr, &startupInfo, &host->process);
+
+	if (!res)
+	{
+		return nullptr;
+	}
+
+	return host;
+}
\ No newline at end of file
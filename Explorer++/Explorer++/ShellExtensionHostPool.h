@@ -0,0 +1,77 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "ShellExtensionHost.h"
+#include "../Helper/TieredThumbnailCache.h"
+#include <wil/resource.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+// Runs thumbnail and property extraction in a set of host processes (see ShellExtensionHost), so
+// that a third-party extension that hangs or crashes can't take down the main process. Each call
+// has a timeout. A host that doesn't respond in time is terminated and a new host is started the
+// next time one is needed.
+//
+// Context menu handlers aren't run in the hosts. The menu items they add are tied to the process
+// that shows the menu (they can be owner-drawn and can display UI when invoked).
+//
+// The pool is disabled by default, in which case extensions are loaded directly into the calling
+// process. All methods can be called from any thread.
+class ShellExtensionHostPool
+{
+public:
+	static ShellExtensionHostPool &GetInstance();
+
+	void SetEnabled(bool enabled);
+	bool IsEnabled() const;
+
+	std::optional<TieredThumbnailCache::Image> ExtractThumbnail(
+		PCIDLIST_ABSOLUTE pidl, UINT size, WTS_FLAGS flags);
+	HRESULT GetDetailsEx(PCIDLIST_ABSOLUTE pidl, const SHCOLUMNID *pscid, VARIANT *vt);
+
+private:
+	struct Host
+	{
+		wil::unique_process_information process;
+		wil::unique_handle mapping;
+		wil::unique_mapview_ptr<ShellExtensionHost::SharedHeader> header;
+		wil::unique_event_nothrow requestEvent;
+		wil::unique_event_nothrow responseEvent;
+	};
+
+	using WriteRequestCallback = std::function<bool(ShellExtensionHost::SharedHeader *header)>;
+	using ReadResponseCallback =
+		std::function<void(const ShellExtensionHost::SharedHeader *header)>;
+
+	// Each host processes a single request at a time, so this is the number of requests that can
+	// be in progress at once.
+	static constexpr int MAX_HOSTS = 4;
+
+	static constexpr DWORD THUMBNAIL_TIMEOUT = 10000;
+	static constexpr DWORD DETAILS_TIMEOUT = 5000;
+
+	ShellExtensionHostPool() = default;
+
+	bool SendRequest(const WriteRequestCallback &writeRequest, DWORD timeout,
+		const ReadResponseCallback &readResponse);
+	static bool WritePidl(ShellExtensionHost::SharedHeader *header, PCIDLIST_ABSOLUTE pidl);
+	std::unique_ptr<Host> AcquireHost();
+	void ReleaseHost(std::unique_ptr<Host> host);
+	void DiscardHost(std::unique_ptr<Host> host);
+	static std::unique_ptr<Host> StartHost();
+
+	std::atomic<bool> m_enabled = false;
+
+	std::mutex m_mutex;
+	std::condition_variable m_hostAvailableCondition;
+	std::vector<std::unique_ptr<Host>> m_idleHosts;
+	int m_numHosts = 0;
+};
\ No newline at end of file
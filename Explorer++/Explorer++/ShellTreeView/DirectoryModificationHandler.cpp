@@ -4,6 +4,7 @@
 
 #include "stdafx.h"
 #include "ShellTreeView.h"
+#include "../Helper/ItemAttributeCache.h"
 #include "../Helper/Macros.h"
 #include "../Helper/ShellHelper.h"
 
@@ -11,7 +12,14 @@ void ShellTreeView::DirectoryAltered()
 {
 	EnterCriticalSection(&m_cs);
 
-	KillTimer(m_hTreeView,0);
+	KillTimer(m_hTreeView,DIRECTORY_MODIFIED_TIMER_ID);
+	m_directoryModifiedTimerPending = false;
+
+	if(m_AlteredList.empty() && m_rescanPaths.empty())
+	{
+		LeaveCriticalSection(&m_cs);
+		return;
+	}
 
 	/* Three basic situations to watch out for:
 	 - File is created, then renamed. Both notifications
@@ -30,13 +38,30 @@ void ShellTreeView::DirectoryAltered()
 	Renamed
 	Renamed
 	In this case, need to remember that the first two
-	notifications referred to files that didn't exist. */
+	notifications referred to files that didn't exist.
+
+	During large operations (e.g. extracting an archive),
+	there can be thousands of notifications in a single
+	batch. Added items are collected and inserted together,
+	once per parent. Any other change causes the pending
+	additions to be applied first, so that the changes are
+	still applied in the order they occurred. The treeview
+	is only redrawn once the whole batch has been applied. */
+	DirectoryModificationBatch batch;
+
+	SendMessage(m_hTreeView,WM_SETREDRAW,FALSE,0);
+
 	for(const auto &af : m_AlteredList)
 	{
+		if(af.dwAction != FILE_ACTION_ADDED && af.dwAction != FILE_ACTION_MODIFIED)
+		{
+			ApplyAddedItems(batch);
+		}
+
 		switch(af.dwAction)
 		{
 			case FILE_ACTION_ADDED:
-				DirectoryAlteredAddFile(af.szFileName);
+				DirectoryAlteredAddFile(af.szFileName,batch);
 				break;
 
 			/* The modified notification does not need
@@ -46,7 +71,7 @@ void ShellTreeView::DirectoryAltered()
 				break;
 
 			case FILE_ACTION_REMOVED:
-				DirectoryAlteredRemoveFile(af.szFileName);
+				DirectoryAlteredRemoveFile(af.szFileName,batch);
 				break;
 
 			case FILE_ACTION_RENAMED_OLD_NAME:
@@ -65,50 +90,84 @@ void ShellTreeView::DirectoryAltered()
 		}
 	}
 
+	ApplyAddedItems(batch);
+	ApplyParentUpdates(batch);
+
+	/* If the directory monitor was unable to record
+	all of the changes made to a drive, there's no way
+	to tell which items are affected, so everything
+	shown for the drive is rescanned. */
+	for(const auto &rescanPath : m_rescanPaths)
+	{
+		HTREEITEM hItem = LocateExistingItem(rescanPath.c_str());
+
+		if(hItem != nullptr)
+		{
+			RescanItem(hItem);
+		}
+	}
+
+	SendMessage(m_hTreeView,WM_SETREDRAW,TRUE,0);
+
 	m_AlteredList.clear();
+	m_rescanPaths.clear();
 
 	LeaveCriticalSection(&m_cs);
 }
 
-/* TODO: Will have to change this. If AddItem() fails for some
-reason, then add the item to the tracking list. */
-void ShellTreeView::DirectoryAlteredAddFile(const TCHAR *szFullFileName)
+void ShellTreeView::DirectoryAlteredAddFile(const TCHAR *szFullFileName,
+	DirectoryModificationBatch &batch)
 {
-	/* We'll use this as a litmus test to check whether or not
-	the file actually exists. */
-	PIDLIST_ABSOLUTE pidlComplete = nullptr;
-	HRESULT hr = SHParseDisplayName(szFullFileName, nullptr, &pidlComplete, 0, nullptr);
-
-	if(SUCCEEDED(hr))
+	/* Drives are handled separately (see AddDrive()),
+	so they're added straight away. */
+	if(PathIsRoot(szFullFileName))
 	{
 		AddItem(szFullFileName);
-		CoTaskMemFree(pidlComplete);
+		return;
 	}
-	else
+
+	TCHAR szParent[MAX_PATH];
+	StringCchCopy(szParent,SIZEOF_ARRAY(szParent),szFullFileName);
+	PathRemoveFileSpec(szParent);
+
+	batch.addedItems[szParent].push_back(szFullFileName);
+}
+
+void ShellTreeView::ApplyAddedItems(DirectoryModificationBatch &batch)
+{
+	for(const auto &[parentPath, itemPaths] : batch.addedItems)
 	{
-		/* The file doesn't exist, so keep a record of it. */
-		AlteredFile_t af;
+		AddItems(parentPath,itemPaths);
+	}
 
-		StringCchCopy(af.szFileName,SIZEOF_ARRAY(af.szFileName),szFullFileName);
-		af.dwAction = FILE_ACTION_ADDED;
+	batch.addedItems.clear();
+}
 
-		m_AlteredTrackingList.push_back(af);
+/* The child count of each parent is only updated once,
+regardless of how many of its children were removed. */
+void ShellTreeView::ApplyParentUpdates(DirectoryModificationBatch &batch)
+{
+	for(const auto &parentPath : batch.updatedParents)
+	{
+		UpdateParent(LocateItemOnDesktopTree(parentPath.c_str()));
+		UpdateParent(parentPath.c_str());
 	}
+
+	batch.updatedParents.clear();
 }
 
-void ShellTreeView::DirectoryAlteredRemoveFile(const TCHAR *szFullFileName)
+void ShellTreeView::DirectoryAlteredRemoveFile(const TCHAR *szFullFileName,
+	DirectoryModificationBatch &batch)
 {
 	TCHAR szParent[MAX_PATH];
 	HTREEITEM hItem;
 	HTREEITEM hDeskItem;
-	HTREEITEM hDeskParent;
 
 	StringCchCopy(szParent,SIZEOF_ARRAY(szParent),szFullFileName);
 	PathRemoveFileSpec(szParent);
 
 	/* If the item is on the desktop, we need to remove the item 
 	   from the desktop tree branch as well. */
-	hDeskParent = LocateItemOnDesktopTree(szParent);  
 	hDeskItem	= LocateItemOnDesktopTree(szFullFileName); 
 
 	if(hDeskItem != nullptr)
@@ -124,9 +183,9 @@ void ShellTreeView::DirectoryAlteredRemoveFile(const TCHAR *szFullFileName)
 
 	/* The parent item should be updated (if it is in the tree), regardless of whether the
 	   actual item was found. For example, the number of children may need to be set to 0
-	   to remove the "+" sign from the tree. The update should be done after the removal. */
-	UpdateParent(hDeskParent);
-	UpdateParent(szParent);
+	   to remove the "+" sign from the tree. The update is done once the rest of the batch
+	   has been applied. */
+	batch.updatedParents.insert(szParent);
 
 	if(hDeskItem == nullptr && hItem == nullptr)
 	{
@@ -263,38 +322,61 @@ void ShellTreeView::DirectoryAlteredRenameFile(const TCHAR *szFullFileName)
 	}
 }
 
-void ShellTreeView::DirectoryAlteredCallback(const TCHAR *szFileName, DWORD dwAction, void *pData)
+void ShellTreeView::DirectoryAlteredCallback(const std::vector<DirectoryChange> &changes,
+	bool overflowed, void *pData)
 {
 	DirectoryAltered_t	*pDirectoryAltered = nullptr;
 	ShellTreeView		*shellTreeView = nullptr;
-	TCHAR				szFullFileName[MAX_PATH];
 
 	pDirectoryAltered = (DirectoryAltered_t *)pData;
 
 	shellTreeView = pDirectoryAltered->shellTreeView;
 
-	StringCchCopy(szFullFileName, SIZEOF_ARRAY(szFullFileName), pDirectoryAltered->szPath);
-	if(!PathAppend(szFullFileName, szFileName))
-	{
-		return;
-	}
-
-	shellTreeView->DirectoryModified(dwAction,szFullFileName);
+	shellTreeView->DirectoryModified(pDirectoryAltered->szPath,changes,overflowed);
 }
 
-void ShellTreeView::DirectoryModified(DWORD dwAction, const TCHAR *szFullFileName)
+void ShellTreeView::DirectoryModified(const std::wstring &directory,
+	const std::vector<DirectoryChange> &changes, bool overflowed)
 {
-	EnterCriticalSection(&m_cs);
+	std::vector<AlteredFile_t> alteredFiles;
+	alteredFiles.reserve(changes.size());
+
+	for(const auto &change : changes)
+	{
+		AlteredFile_t af;
+
+		StringCchCopy(af.szFileName,SIZEOF_ARRAY(af.szFileName),directory.c_str());
 
-	SetTimer(m_hTreeView,DIRECTORY_MODIFIED_TIMER_ID,
-		DIRECTORY_MODIFIED_TIMER_ELAPSE, nullptr);
+		if(!PathAppend(af.szFileName,change.fileName.c_str()))
+		{
+			continue;
+		}
+
+		af.dwAction = change.action;
 
-	AlteredFile_t af;
+		/* The cached attributes are invalidated straight away (rather
+		than when the change is processed), so that any attributes
+		retrieved in the meantime reflect the change. */
+		GetItemAttributeCache().InvalidateItem(af.szFileName);
+
+		alteredFiles.push_back(af);
+	}
 
-	StringCchCopy(af.szFileName,SIZEOF_ARRAY(af.szFileName),szFullFileName);
-	af.dwAction = dwAction;
+	EnterCriticalSection(&m_cs);
+
+	if(!m_directoryModifiedTimerPending)
+	{
+		SetTimer(m_hTreeView,DIRECTORY_MODIFIED_TIMER_ID,
+			DIRECTORY_MODIFIED_TIMER_ELAPSE, nullptr);
+		m_directoryModifiedTimerPending = true;
+	}
 
-	m_AlteredList.push_back(af);
+	m_AlteredList.insert(m_AlteredList.end(),alteredFiles.begin(),alteredFiles.end());
+
+	if(overflowed)
+	{
+		m_rescanPaths.push_back(directory);
+	}
 
 	LeaveCriticalSection(&m_cs);
 }
@@ -361,6 +443,106 @@ void ShellTreeView::AddItem(const TCHAR *szFullFileName)
 	}
 }
 
+void ShellTreeView::AddItems(const std::wstring &parentPath,
+	const std::vector<std::wstring> &itemPaths)
+{
+	std::vector<AddedItem> items;
+
+	for(const auto &itemPath : itemPaths)
+	{
+		/* We'll use this as a litmus test to check whether or not
+		the file actually exists. */
+		unique_pidl_absolute pidl;
+		HRESULT hr = SHParseDisplayName(itemPath.c_str(), nullptr, wil::out_param(pidl), 0,
+			nullptr);
+
+		if(FAILED(hr))
+		{
+			/* The file doesn't exist, so keep a record of it. */
+			AlteredFile_t af;
+
+			StringCchCopy(af.szFileName,SIZEOF_ARRAY(af.szFileName),itemPath.c_str());
+			af.dwAction = FILE_ACTION_ADDED;
+
+			m_AlteredTrackingList.push_back(af);
+
+			continue;
+		}
+
+		items.push_back({ itemPath, std::move(pidl) });
+	}
+
+	if(items.empty())
+	{
+		return;
+	}
+
+	// Check if it is a desktop (sub)child
+	HTREEITEM hDeskParent = LocateItemOnDesktopTree(parentPath.c_str());
+
+	HTREEITEM hParent = LocateExistingItem(parentPath.c_str());
+
+	if(hParent != nullptr)
+	{
+		AddItemsInternal(hParent,items);
+	}
+
+	if(hDeskParent != nullptr && hDeskParent != hParent)
+	{
+		/* If the items are on the desktop, they also need
+		to be added to the desktop branch of the tree. */
+		AddItemsInternal(hDeskParent,items);
+	}
+}
+
+void ShellTreeView::AddItemsInternal(HTREEITEM hParent,const std::vector<AddedItem> &items)
+{
+	TVITEMEX tvItem;
+	tvItem.mask			= TVIF_CHILDREN | TVIF_STATE;
+	tvItem.hItem		= hParent;
+	tvItem.stateMask	= TVIS_EXPANDED;
+	BOOL res = TreeView_GetItem(m_hTreeView,&tvItem);
+
+	if(!res)
+	{
+		return;
+	}
+
+	/* If the parent node is currently collapsed,
+	simply indicate that it has children (i.e. a
+	plus sign will be shown next to the parent node). */
+	if((tvItem.cChildren == 0) ||
+		((tvItem.state & TVIS_EXPANDED) != TVIS_EXPANDED))
+	{
+		tvItem.mask			= TVIF_CHILDREN;
+		tvItem.hItem		= hParent;
+		tvItem.cChildren	= 1;
+		TreeView_SetItem(m_hTreeView,&tvItem);
+		return;
+	}
+
+	std::vector<EnumeratedChild> children;
+
+	for(const auto &item : items)
+	{
+		/* The item may already be shown (e.g. if it was created
+		while the parent was being expanded). */
+		if(HasChildWithPath(hParent,item.path))
+		{
+			continue;
+		}
+
+		EnumeratedChild child;
+		child.pidl.reset(ILCloneChild(ILFindLastID(item.pidl.get())));
+		GetDisplayName(item.pidl.get(), SHGDN_NORMAL, child.displayName);
+		child.parsingPath = item.path;
+		child.sortKey = GetChildSortKey(item.pidl.get(), item.path);
+		children.push_back(std::move(child));
+	}
+
+	InsertChildrenSorted(hParent,std::move(children));
+}
+
 void ShellTreeView::AddItemInternal(HTREEITEM hParent,const TCHAR *szFullFileName)
 {
 	IShellFolder	*pShellFolder = nullptr;
@@ -445,7 +627,12 @@ void ShellTreeView::AddItemInternal(HTREEITEM hParent,const TCHAR *szFullFileNam
 						tvis.hInsertAfter		= DetermineItemSortedPosition(hParent,szFullFileName);
 						tvis.itemex				= tvItem;
 
-						TreeView_InsertItem(m_hTreeView,&tvis);
+						HTREEITEM hItem = TreeView_InsertItem(m_hTreeView,&tvis);
+
+						if(hItem != nullptr)
+						{
+							AddToPathIndex(hItem,szFullFileName);
+						}
 					}
 				}
 
@@ -500,6 +687,8 @@ void ShellTreeView::RenameItem(HTREEITEM hItem, const TCHAR *szFullFileName)
 			tvItem.iSelectedImage	= shfi.iIcon;
 			TreeView_SetItem(m_hTreeView,&tvItem);
 
+			AddToPathIndex(hItem,szFullFileName);
+
 			/* Now recursively go through each of this items children and
 			update their pidl's. */
 			UpdateChildren(hItem,pidlParent);
@@ -525,6 +714,7 @@ void ShellTreeView::UpdateChildren(HTREEITEM hParent, PCIDLIST_ABSOLUTE pidlPare
 		if(bRes)
 		{
 			pidl = UpdateItemInfo(pidlParent,(int)tvItem.lParam);
+			AddToPathIndex(hChild,pidl);
 
 			UpdateChildren(hChild,pidl);
 
@@ -537,6 +727,7 @@ void ShellTreeView::UpdateChildren(HTREEITEM hParent, PCIDLIST_ABSOLUTE pidlPare
 				if(bRes)
 				{
 					pidl = UpdateItemInfo(pidlParent,(int)tvItem.lParam);
+					AddToPathIndex(hChild,pidl);
 
 					UpdateChildren(hChild,pidl);
 				}
@@ -545,6 +736,83 @@ void ShellTreeView::UpdateChildren(HTREEITEM hParent, PCIDLIST_ABSOLUTE pidlPare
 	}
 }
 
+/* Brings the children of the specified item (and of
+any of its descendants that have been expanded) back in
+line with the filesystem. Items that no longer exist
+are removed and new items are inserted in their sorted
+positions. */
+void ShellTreeView::RescanItem(HTREEITEM hItem)
+{
+	HTREEITEM hChild = TreeView_GetChild(m_hTreeView,hItem);
+
+	/* Items that have never been expanded have no children
+	to update. An item that's currently being expanded
+	will pick up the changes itself. */
+	if(hChild == nullptr || IsExpansionPending(hItem))
+	{
+		return;
+	}
+
+	auto pidl = GetItemPidl(hItem);
+
+	std::unordered_set<std::wstring> currentPaths;
+	std::vector<EnumeratedChild> newChildren;
+	HRESULT hr = EnumerateChildren(pidl.get(),GetChildEnumerationFlags(),
+		m_config->checkPinnedToNamespaceTreeProperty,
+		[this,hItem,&currentPaths,&newChildren](EnumeratedChild child) {
+			currentPaths.insert(GetPathIndexKey(child.parsingPath));
+
+			if(!HasChildWithPath(hItem,child.parsingPath))
+			{
+				newChildren.push_back(std::move(child));
+			}
+
+			return true;
+		});
+
+	if(FAILED(hr))
+	{
+		return;
+	}
+
+	bool itemsRemoved = false;
+
+	while(hChild != nullptr)
+	{
+		HTREEITEM hNext = TreeView_GetNextSibling(m_hTreeView,hChild);
+		auto itr = m_parsingPathsByItem.find(hChild);
+
+		if(itr != m_parsingPathsByItem.end() && !currentPaths.contains(itr->second))
+		{
+			RemoveItem(hChild);
+			itemsRemoved = true;
+		}
+
+		hChild = hNext;
+	}
+
+	InsertChildrenSorted(hItem,std::move(newChildren));
+
+	if(itemsRemoved)
+	{
+		std::wstring parsingPath;
+		hr = GetDisplayName(pidl.get(),SHGDN_FORPARSING,parsingPath);
+
+		if(SUCCEEDED(hr))
+		{
+			GetItemAttributeCache().InvalidateItem(parsingPath);
+		}
+
+		UpdateParent(hItem);
+	}
+
+	for(hChild = TreeView_GetChild(m_hTreeView,hItem);hChild != nullptr;
+		hChild = TreeView_GetNextSibling(m_hTreeView,hChild))
+	{
+		RescanItem(hChild);
+	}
+}
+
 PCIDLIST_ABSOLUTE ShellTreeView::UpdateItemInfo(PCIDLIST_ABSOLUTE pidlParent, int iItemId)
 {
 	ItemInfo_t &itemInfo = m_itemInfoMap.at(iItemId);
@@ -595,8 +863,8 @@ void ShellTreeView::UpdateParent(HTREEITEM hParent)
 
 		if(bRes)
 		{
-			hr = GetItemAttributes(m_itemInfoMap.at(static_cast<int>(tvItem.lParam)).pidl.get(),
-				&attributes);
+			hr = GetItemAttributeCache().GetItemAttributes(
+				m_itemInfoMap.at(static_cast<int>(tvItem.lParam)).pidl.get(), &attributes);
 
 			if(SUCCEEDED(hr))
 			{
@@ -19,22 +19,24 @@
 #include "Config.h"
 #include "CoreInterface.h"
 #include "DarkModeHelper.h"
+#include "HardwareChangeNotifier.h"
+#include "MainResource.h"
+#include "ResourceHelper.h"
 #include "TabContainer.h"
 #include "../Helper/CachedIcons.h"
 #include "../Helper/ClipboardHelper.h"
 #include "../Helper/Controls.h"
 #include "../Helper/DragDropHelper.h"
-#include "../Helper/DriveInfo.h"
+#include "../Helper/ExtensionIconCache.h"
 #include "../Helper/FileActionHandler.h"
 #include "../Helper/FileOperations.h"
 #include "../Helper/Helper.h"
+#include "../Helper/ItemAttributeCache.h"
 #include "../Helper/Macros.h"
 #include "../Helper/ShellHelper.h"
 #include <wil/common.h>
 #include <propkey.h>
-
-int CALLBACK CompareItemsStub(LPARAM lParam1, LPARAM lParam2, LPARAM lParamSort);
-DWORD WINAPI Thread_MonitorAllDrives(LPVOID pParam);
+#include <algorithm>
 
 ShellTreeView::ShellTreeView(HWND hParent, IExplorerplusplus *coreInterface,
 	IDirectoryMonitor *pDirMon, TabContainer *tabContainer, FileActionHandler *fileActionHandler,
@@ -42,6 +44,7 @@ ShellTreeView::ShellTreeView(HWND hParent, IExplorerplusplus *coreInterface,
 	ShellDropTargetWindow(CreateTreeView(hParent)),
 	m_hTreeView(GetHWND()),
 	m_config(coreInterface->GetConfig()),
+	m_hResourceModule(coreInterface->GetLanguageModule()),
 	m_pDirMon(pDirMon),
 	m_tabContainer(tabContainer),
 	m_fileActionHandler(fileActionHandler),
@@ -53,8 +56,14 @@ ShellTreeView::ShellTreeView(HWND hParent, IExplorerplusplus *coreInterface,
 	m_subfoldersThreadPool(
 		1, std::bind(CoInitializeEx, nullptr, COINIT_APARTMENTTHREADED), CoUninitialize),
 	m_subfoldersResultIDCounter(0),
+	m_expansionThreadPool(
+		1, std::bind(CoInitializeEx, nullptr, COINIT_APARTMENTTHREADED), CoUninitialize),
+	m_expansionIDCounter(0),
+	m_expandSynchronously(false),
 	m_cutItem(nullptr),
-	m_dropExpandItem(nullptr)
+	m_dropExpandItem(nullptr),
+	m_driveOpenThreadPool(DRIVE_OPEN_THREADS),
+	m_driveOpenResultIDCounter(0)
 {
 	auto &darkModeHelper = DarkModeHelper::GetInstance();
 
@@ -80,6 +89,7 @@ ShellTreeView::ShellTreeView(HWND hParent, IExplorerplusplus *coreInterface,
 		hParent, ParentWndProcStub, PARENT_SUBCLASS_ID, reinterpret_cast<DWORD_PTR>(this)));
 
 	InitializeCriticalSection(&m_cs);
+	m_directoryModifiedTimerPending = false;
 
 	m_iFolderIcon = GetDefaultFolderIconIndex();
 
@@ -92,13 +102,14 @@ ShellTreeView::ShellTreeView(HWND hParent, IExplorerplusplus *coreInterface,
 	m_getDragImageMessage = RegisterWindowMessage(DI_GETDRAGIMAGE);
 
 	m_bQueryRemoveCompleted = FALSE;
-	HANDLE hThread = CreateThread(nullptr, 0, Thread_MonitorAllDrives, this, 0, nullptr);
-	CloseHandle(hThread);
+	MonitorAllDrives();
 
 	AddClipboardFormatListener(m_hTreeView);
 
 	m_connections.push_back(coreInterface->AddApplicationShuttingDownObserver(
 		std::bind_front(&ShellTreeView::OnApplicationShuttingDown, this)));
+	m_connections.push_back(HardwareChangeNotifier::GetInstance().AddDriveChangedObserver(
+		std::bind_front(&ShellTreeView::OnDriveChanged, this)));
 }
 
 HWND ShellTreeView::CreateTreeView(HWND parent)
@@ -113,6 +124,15 @@ ShellTreeView::~ShellTreeView()
 	DeleteCriticalSection(&m_cs);
 
 	m_iconThreadPool.clear_queue();
+
+	for (auto &[item, pendingExpansion] : m_pendingExpansions)
+	{
+		pendingExpansion.stopSource.request_stop();
+	}
+
+	m_expansionThreadPool.clear_queue();
+
+	m_driveOpenThreadPool.clear_queue();
 }
 
 void ShellTreeView::OnApplicationShuttingDown()
@@ -151,6 +171,10 @@ LRESULT CALLBACK ShellTreeView::TreeViewProc(HWND hwnd, UINT msg, WPARAM wParam,
 		{
 			OnDropExpandTimer();
 		}
+		else if (wParam == ICON_REFRESH_TIMER_ID)
+		{
+			OnIconRefreshTimer();
+		}
 		break;
 
 	case WM_DEVICECHANGE:
@@ -253,6 +277,15 @@ LRESULT CALLBACK ShellTreeView::TreeViewProc(HWND hwnd, UINT msg, WPARAM wParam,
 		ProcessSubfoldersResult(static_cast<int>(wParam));
 		break;
 
+	case WM_APP_EXPANSION_RESULTS_READY:
+		ProcessExpansionResults(
+			std::unique_ptr<ExpansionResults>(reinterpret_cast<ExpansionResults *>(wParam)));
+		break;
+
+	case WM_APP_DRIVE_OPEN_RESULT_READY:
+		ProcessDriveOpenResult(static_cast<int>(wParam));
+		break;
+
 	case WM_DESTROY:
 		RemoveClipboardFormatListener(m_hTreeView);
 		break;
@@ -294,6 +327,20 @@ LRESULT CALLBACK ShellTreeView::ParentWndProc(HWND hwnd, UINT uMsg, WPARAM wPara
 				OnItemExpanding(reinterpret_cast<NMTREEVIEW *>(lParam));
 				break;
 
+			case TVN_SELCHANGING:
+				// The placeholder shown while a folder is being expanded can't be selected.
+				return IsLoadingPlaceholder(reinterpret_cast<NMTREEVIEW *>(lParam)->itemNew.hItem);
+
+			case TVN_DELETEITEM:
+				CancelExpansion(reinterpret_cast<NMTREEVIEW *>(lParam)->itemOld.hItem);
+				RemoveFromPathIndex(reinterpret_cast<NMTREEVIEW *>(lParam)->itemOld.hItem);
+
+				if (!m_iconRefreshStack.empty())
+				{
+					m_restartIconRefreshWalk = true;
+				}
+				break;
+
 			case TVN_KEYDOWN:
 				return OnKeyDown(reinterpret_cast<NMTVKEYDOWN *>(lParam));
 
@@ -347,7 +394,8 @@ HTREEITEM ShellTreeView::AddRoot()
 
 	if (hDesktop != nullptr)
 	{
-		SendMessage(m_hTreeView, TVM_EXPAND, TVE_EXPAND, reinterpret_cast<LPARAM>(hDesktop));
+		AddToPathIndex(hDesktop, pidl.get());
+		ExpandItemSynchronously(hDesktop);
 	}
 
 	return hDesktop;
@@ -378,9 +426,20 @@ void ShellTreeView::OnGetDisplayInfo(NMTVDISPINFO *pnmtvdi)
 
 	if (WI_IsFlagSet(ptvItem->mask, TVIF_CHILDREN))
 	{
-		ptvItem->cChildren = 1;
+		const ItemInfo_t &itemInfo = m_itemInfoMap.at(static_cast<int>(ptvItem->lParam));
+		auto cachedAttributes =
+			GetItemAttributeCache().GetCachedAttributes(itemInfo.pidl.get(), SFGAO_HASSUBFOLDER);
+
+		if (cachedAttributes)
+		{
+			ptvItem->cChildren = WI_IsFlagSet(*cachedAttributes, SFGAO_HASSUBFOLDER) ? 1 : 0;
+		}
+		else
+		{
+			ptvItem->cChildren = 1;
 
-		QueueSubfoldersTask(ptvItem->hItem);
+			QueueSubfoldersTask(ptvItem->hItem);
+		}
 	}
 
 	ptvItem->mask |= TVIF_DI_SETITEM;
@@ -396,14 +455,7 @@ std::optional<int> ShellTreeView::GetCachedIconIndex(const ItemInfo_t &itemInfo)
 		return std::nullopt;
 	}
 
-	auto cachedItr = m_cachedIcons->findByPath(filePath);
-
-	if (cachedItr == m_cachedIcons->end())
-	{
-		return std::nullopt;
-	}
-
-	return cachedItr->iconIndex;
+	return m_cachedIcons->findByPath(filePath);
 }
 
 void ShellTreeView::QueueIconTask(HTREEITEM item, int internalIndex)
@@ -419,33 +471,40 @@ void ShellTreeView::QueueIconTask(HTREEITEM item, int internalIndex)
 		m_iconThreadPool.push([this, iconResultID, item, internalIndex, basicItemInfo](int id) {
 			UNREFERENCED_PARAMETER(id);
 
-			return FindIconAsync(
-				m_hTreeView, iconResultID, item, internalIndex, basicItemInfo.pidl.get());
+			return FindIconAsync(m_hTreeView, iconResultID, item, internalIndex,
+				basicItemInfo.pidl.get(), m_cachedIcons);
 		});
 
 	m_iconResults.insert({ iconResultID, std::move(result) });
 }
 
-std::optional<ShellTreeView::IconResult> ShellTreeView::FindIconAsync(
-	HWND treeView, int iconResultId, HTREEITEM item, int internalIndex, PCIDLIST_ABSOLUTE pidl)
+std::optional<ShellTreeView::IconResult> ShellTreeView::FindIconAsync(HWND treeView,
+	int iconResultId, HTREEITEM item, int internalIndex, PCIDLIST_ABSOLUTE pidl,
+	CachedIcons *cachedIcons)
 {
-	SHFILEINFO shfi;
-	DWORD_PTR res = SHGetFileInfo(reinterpret_cast<LPCTSTR>(pidl), 0, &shfi, sizeof(SHFILEINFO),
-		SHGFI_PIDL | SHGFI_ICON | SHGFI_OVERLAYINDEX);
+	auto iconIndex = GetItemIconIndex(pidl);
 
-	if (res == 0)
+	if (!iconIndex)
 	{
 		return std::nullopt;
 	}
 
-	DestroyIcon(shfi.hIcon);
+	// As with IconFetcher, the cache is filled in on the worker thread.
+	std::wstring filePath;
+	HRESULT hr = GetDisplayName(pidl, SHGDN_FORPARSING, filePath);
+
+	if (SUCCEEDED(hr))
+	{
+		cachedIcons->addOrUpdateFileIcon(filePath, *iconIndex);
+		GetIconLocationCache().RecordItem(pidl, filePath);
+	}
 
 	PostMessage(treeView, WM_APP_ICON_RESULT_READY, iconResultId, 0);
 
 	IconResult result;
 	result.item = item;
 	result.internalIndex = internalIndex;
-	result.iconIndex = shfi.iIcon;
+	result.iconIndex = *iconIndex;
 
 	return result;
 }
@@ -470,16 +529,6 @@ void ShellTreeView::ProcessIconResult(int iconResultId)
 		return;
 	}
 
-	const ItemInfo_t &itemInfo = m_itemInfoMap.at(result->internalIndex);
-
-	std::wstring filePath;
-	HRESULT hr = GetDisplayName(itemInfo.pidl.get(), SHGDN_FORPARSING, filePath);
-
-	if (SUCCEEDED(hr))
-	{
-		m_cachedIcons->addOrUpdateFileIcon(filePath, result->iconIndex);
-	}
-
 	TVITEM tvItem;
 	tvItem.mask = TVIF_HANDLE | TVIF_IMAGE | TVIF_SELECTEDIMAGE | TVIF_STATE;
 	tvItem.hItem = result->item;
@@ -511,17 +560,8 @@ void ShellTreeView::QueueSubfoldersTask(HTREEITEM item)
 std::optional<ShellTreeView::SubfoldersResult> ShellTreeView::CheckSubfoldersAsync(
 	HWND treeView, int subfoldersResultId, HTREEITEM item, PCIDLIST_ABSOLUTE pidl)
 {
-	wil::com_ptr_nothrow<IShellFolder> pShellFolder;
-	PCITEMID_CHILD pidlRelative;
-	HRESULT hr = SHBindToParent(pidl, IID_PPV_ARGS(&pShellFolder), &pidlRelative);
-
-	if (FAILED(hr))
-	{
-		return std::nullopt;
-	}
-
-	ULONG attributes = SFGAO_HASSUBFOLDER;
-	hr = pShellFolder->GetAttributesOf(1, &pidlRelative, &attributes);
+	SFGAOF attributes = SFGAO_HASSUBFOLDER;
+	HRESULT hr = GetItemAttributeCache().GetItemAttributes(pidl, &attributes);
 
 	if (FAILED(hr))
 	{
@@ -577,10 +617,23 @@ void ShellTreeView::OnItemExpanding(const NMTREEVIEW *nmtv)
 
 	if (nmtv->action == TVE_EXPAND)
 	{
-		ExpandDirectory(parentItem);
+		if (m_expandSynchronously)
+		{
+			ExpandDirectory(parentItem);
+		}
+		else
+		{
+			StartExpansion(parentItem);
+		}
 	}
 	else
 	{
+		CancelExpansion(parentItem);
+
+		// The item may be one of the parents of an item that's being located. Since it's been
+		// collapsed, it shouldn't be expanded again to reveal that item.
+		CancelLocateItemAsync();
+
 		auto hSelection = TreeView_GetSelection(m_hTreeView);
 
 		if (hSelection != nullptr)
@@ -654,96 +707,87 @@ LRESULT ShellTreeView::OnKeyDown(const NMTVKEYDOWN *keyDown)
 	return 0;
 }
 
-/* Sorts items in the following order:
- - Drives
- - Virtual Items
- - Real Items
-
-Each set is ordered alphabetically. */
-int CALLBACK CompareItemsStub(LPARAM lParam1, LPARAM lParam2, LPARAM lParamSort)
+HRESULT ShellTreeView::ExpandDirectory(HTREEITEM hParent)
 {
-	ShellTreeView *shellTreeView = nullptr;
-
-	shellTreeView = (ShellTreeView *) lParamSort;
+	auto pidlDirectory = GetItemPidl(hParent);
+	SHCONTF enumFlags = GetChildEnumerationFlags();
 
-	return shellTreeView->CompareItems(lParam1, lParam2);
-}
+	std::vector<EnumeratedChild> children;
+	HRESULT hr = EnumerateChildren(pidlDirectory.get(), enumFlags,
+		m_config->checkPinnedToNamespaceTreeProperty, [&children](EnumeratedChild child) {
+			children.push_back(std::move(child));
+			return true;
+		});
 
-int CALLBACK ShellTreeView::CompareItems(LPARAM lParam1, LPARAM lParam2)
-{
-	TCHAR szTemp[MAX_PATH];
-	int iItemId1 = (int) lParam1;
-	int iItemId2 = (int) lParam2;
+	if (FAILED(hr))
+	{
+		return hr;
+	}
 
-	const ItemInfo_t &itemInfo1 = m_itemInfoMap.at(iItemId1);
-	const ItemInfo_t &itemInfo2 = m_itemInfoMap.at(iItemId2);
+	CacheSubfolderState(pidlDirectory.get(), enumFlags,
+		m_config->checkPinnedToNamespaceTreeProperty, !children.empty());
 
-	std::wstring displayName1;
-	GetDisplayName(itemInfo1.pidl.get(), SHGDN_FORPARSING, displayName1);
+	bool useNaturalSortOrder = m_config->globalFolderSettings.useNaturalSortOrder;
+	std::sort(children.begin(), children.end(),
+		[useNaturalSortOrder](const EnumeratedChild &child1, const EnumeratedChild &child2) {
+			return IsChildSortedBefore(child1.sortKey, child2.sortKey, useNaturalSortOrder);
+		});
 
-	std::wstring displayName2;
-	GetDisplayName(itemInfo2.pidl.get(), SHGDN_FORPARSING, displayName2);
+	SendMessage(m_hTreeView, WM_SETREDRAW, FALSE, 0);
 
-	if (PathIsRoot(displayName1.c_str()) && !PathIsRoot(displayName2.c_str()))
+	for (auto &child : children)
 	{
-		return -1;
+		InsertChild(hParent, TVI_LAST, child);
 	}
-	else if (!PathIsRoot(displayName1.c_str()) && PathIsRoot(displayName2.c_str()))
+
+	SendMessage(m_hTreeView, WM_SETREDRAW, TRUE, 0);
+
+	return hr;
+}
+
+// Used when the children of an item are needed straight away (e.g. when locating an item). If the
+// item is already being expanded in the background, that expansion is discarded.
+void ShellTreeView::ExpandItemSynchronously(HTREEITEM item)
+{
+	if (IsExpansionPending(item))
 	{
-		return 1;
+		CancelExpansion(item);
+		EraseItems(item);
+		SendMessage(m_hTreeView, TVM_EXPAND, TVE_COLLAPSE | TVE_COLLAPSERESET,
+			reinterpret_cast<LPARAM>(item));
 	}
-	else if (PathIsRoot(displayName1.c_str()) && PathIsRoot(displayName2.c_str()))
+
+	m_expandSynchronously = true;
+	SendMessage(m_hTreeView, TVM_EXPAND, TVE_EXPAND, reinterpret_cast<LPARAM>(item));
+	m_expandSynchronously = false;
+}
+
+SHCONTF ShellTreeView::GetChildEnumerationFlags() const
+{
+	SHCONTF enumFlags = SHCONTF_FOLDERS;
+
+	if (m_bShowHidden)
 	{
-		return lstrcmpi(displayName1.c_str(), displayName2.c_str());
+		enumFlags |= SHCONTF_INCLUDEHIDDEN | SHCONTF_INCLUDESUPERHIDDEN;
 	}
-	else
-	{
-		if (!SHGetPathFromIDList(itemInfo1.pidl.get(), szTemp)
-			&& SHGetPathFromIDList(itemInfo2.pidl.get(), szTemp))
-		{
-			return -1;
-		}
-		else if (SHGetPathFromIDList(itemInfo1.pidl.get(), szTemp)
-			&& !SHGetPathFromIDList(itemInfo2.pidl.get(), szTemp))
-		{
-			return 1;
-		}
-		else
-		{
-			GetDisplayName(itemInfo1.pidl.get(), SHGDN_INFOLDER, displayName1);
-			GetDisplayName(itemInfo2.pidl.get(), SHGDN_INFOLDER, displayName2);
 
-			if (m_config->globalFolderSettings.useNaturalSortOrder)
-			{
-				return StrCmpLogicalW(displayName1.c_str(), displayName2.c_str());
-			}
-			else
-			{
-				return StrCmpIW(displayName1.c_str(), displayName2.c_str());
-			}
-		}
-	}
+	return enumFlags;
 }
 
-HRESULT ShellTreeView::ExpandDirectory(HTREEITEM hParent)
+// Enumerates the child folders of the specified directory, passing each one to the callback. The
+// enumeration stops early if the callback returns false. This doesn't access any of the treeview
+// state, so it can be called from a background thread.
+HRESULT ShellTreeView::EnumerateChildren(PCIDLIST_ABSOLUTE pidlDirectory, SHCONTF enumFlags,
+	bool checkPinnedToNamespaceTree, std::function<bool(EnumeratedChild child)> callback)
 {
-	auto pidlDirectory = GetItemPidl(hParent);
-
 	wil::com_ptr_nothrow<IShellFolder2> shellFolder2;
-	HRESULT hr = BindToIdl(pidlDirectory.get(), IID_PPV_ARGS(&shellFolder2));
+	HRESULT hr = BindToIdl(pidlDirectory, IID_PPV_ARGS(&shellFolder2));
 
 	if (FAILED(hr))
 	{
 		return hr;
 	}
 
-	SHCONTF enumFlags = SHCONTF_FOLDERS;
-
-	if (m_bShowHidden)
-	{
-		enumFlags |= SHCONTF_INCLUDEHIDDEN | SHCONTF_INCLUDESUPERHIDDEN;
-	}
-
 	wil::com_ptr_nothrow<IEnumIDList> pEnumIDList;
 	hr = shellFolder2->EnumObjects(nullptr, enumFlags, &pEnumIDList);
 
@@ -752,16 +796,12 @@ HRESULT ShellTreeView::ExpandDirectory(HTREEITEM hParent)
 		return hr;
 	}
 
-	SendMessage(m_hTreeView, WM_SETREDRAW, FALSE, 0);
-
-	std::vector<EnumeratedItem> items;
-
 	unique_pidl_child pidlItem;
 	ULONG uFetched = 1;
 
 	while (pEnumIDList->Next(1, wil::out_param(pidlItem), &uFetched) == S_OK && (uFetched == 1))
 	{
-		if (m_config->checkPinnedToNamespaceTreeProperty)
+		if (checkPinnedToNamespaceTree)
 		{
 			BOOL showItem = GetBooleanVariant(
 				shellFolder2.get(), pidlItem.get(), &PKEY_IsPinnedToNameSpaceTree, TRUE);
@@ -775,165 +815,567 @@ HRESULT ShellTreeView::ExpandDirectory(HTREEITEM hParent)
 		STRRET str;
 		hr = shellFolder2->GetDisplayNameOf(pidlItem.get(), SHGDN_NORMAL, &str);
 
-		if (SUCCEEDED(hr))
+		if (FAILED(hr))
 		{
-			TCHAR itemName[MAX_PATH];
-			hr = StrRetToBuf(&str, pidlItem.get(), itemName, SIZEOF_ARRAY(itemName));
-
-			if (SUCCEEDED(hr))
-			{
-				int itemId = GenerateUniqueItemId();
-				m_itemInfoMap[itemId].pidl.reset(ILCombine(pidlDirectory.get(), pidlItem.get()));
-				m_itemInfoMap[itemId].pridl.reset(ILCloneChild(pidlItem.get()));
-
-				EnumeratedItem item;
-				item.internalIndex = itemId;
-				item.name = itemName;
-				items.push_back(item);
-			}
+			continue;
 		}
-	}
 
-	for (auto &item : items)
-	{
-		TVITEMEX tvItem;
-		tvItem.mask = TVIF_TEXT | TVIF_IMAGE | TVIF_SELECTEDIMAGE | TVIF_PARAM | TVIF_CHILDREN;
-		tvItem.pszText = item.name.data();
-		tvItem.iImage = I_IMAGECALLBACK;
-		tvItem.iSelectedImage = I_IMAGECALLBACK;
-		tvItem.lParam = item.internalIndex;
-		tvItem.cChildren = I_CHILDRENCALLBACK;
+		TCHAR itemName[MAX_PATH];
+		hr = StrRetToBuf(&str, pidlItem.get(), itemName, SIZEOF_ARRAY(itemName));
 
-		TVINSERTSTRUCT tvis;
-		tvis.hInsertAfter = TVI_LAST;
-		tvis.hParent = hParent;
-		tvis.itemex = tvItem;
+		if (FAILED(hr))
+		{
+			continue;
+		}
 
-		TreeView_InsertItem(m_hTreeView, &tvis);
-	}
+		unique_pidl_absolute pidlComplete(ILCombine(pidlDirectory, pidlItem.get()));
 
-	TVSORTCB tvscb;
-	tvscb.hParent = hParent;
-	tvscb.lpfnCompare = CompareItemsStub;
-	tvscb.lParam = reinterpret_cast<LPARAM>(this);
-	TreeView_SortChildrenCB(m_hTreeView, &tvscb, 0);
+		std::wstring parsingName;
+		GetDisplayName(pidlComplete.get(), SHGDN_FORPARSING, parsingName);
 
-	SendMessage(m_hTreeView, WM_SETREDRAW, TRUE, 0);
+		EnumeratedChild child;
+		child.displayName = itemName;
+		child.sortKey = GetChildSortKey(pidlComplete.get(), parsingName);
+		child.parsingPath = std::move(parsingName);
+		child.pidl = std::move(pidlItem);
 
-	return hr;
-}
+		if (!callback(std::move(child)))
+		{
+			break;
+		}
+	}
 
-int ShellTreeView::GenerateUniqueItemId()
-{
-	return m_itemIDCounter++;
+	return S_OK;
 }
 
-HTREEITEM ShellTreeView::DetermineItemSortedPosition(HTREEITEM hParent, const TCHAR *szItem)
+ShellTreeView::ChildSortKey ShellTreeView::GetChildSortKey(
+	PCIDLIST_ABSOLUTE pidlComplete, const std::wstring &parsingName)
 {
-	HTREEITEM htInsertAfter = nullptr;
+	ChildSortKey sortKey;
 
-	if (PathIsRoot(szItem))
+	if (PathIsRoot(parsingName.c_str()))
 	{
-		return DetermineDriveSortedPosition(hParent, szItem);
+		sortKey.category = ChildCategory::Drive;
+		sortKey.name = parsingName;
 	}
 	else
 	{
-		HTREEITEM htItem;
-		HTREEITEM hPreviousItem;
-		TVITEMEX item;
-		SFGAOF attributes;
-
-		/* Insert the item in its sorted position, skipping
-		past any drives or any non-filesystem items (i.e.
-		'My Computer', 'Recycle Bin', etc). */
-		htItem = TreeView_GetChild(m_hTreeView, hParent);
-
-		/* If the parent has no children, this item will
-		be the first that appears. */
-		if (htItem == nullptr)
-			return TVI_FIRST;
-
-		hPreviousItem = TVI_FIRST;
-
-		while (htInsertAfter == nullptr)
-		{
-			item.mask = TVIF_PARAM | TVIF_HANDLE;
-			item.hItem = htItem;
-			TreeView_GetItem(m_hTreeView, &item);
+		TCHAR path[MAX_PATH];
+		BOOL isFileSystemItem = SHGetPathFromIDList(pidlComplete, path);
+		sortKey.category = isFileSystemItem ? ChildCategory::FileSystem : ChildCategory::Virtual;
+		GetDisplayName(pidlComplete, SHGDN_INFOLDER, sortKey.name);
+	}
 
-			std::wstring fullItemPath;
-			GetDisplayName(m_itemInfoMap.at(static_cast<int>(item.lParam)).pidl.get(),
-				SHGDN_FORPARSING, fullItemPath);
+	return sortKey;
+}
 
-			attributes = GetFileAttributes(fullItemPath.c_str());
+/* Sorts items in the following order:
+ - Drives
+ - Virtual Items
+ - Real Items
 
-			/* Only perform the comparison if the current item is a real
-			file or folder. */
-			if (!PathIsRoot(fullItemPath.c_str())
-				&& ((attributes & SFGAO_FILESYSTEM) != SFGAO_FILESYSTEM))
-			{
-				if (lstrcmpi(szItem, fullItemPath.c_str()) < 0)
-				{
-					htInsertAfter = hPreviousItem;
-				}
-			}
+Each set is ordered alphabetically. */
+bool ShellTreeView::IsChildSortedBefore(
+	const ChildSortKey &key1, const ChildSortKey &key2, bool useNaturalSortOrder)
+{
+	if (key1.category != key2.category)
+	{
+		return key1.category < key2.category;
+	}
 
-			hPreviousItem = htItem;
-			htItem = TreeView_GetNextSibling(m_hTreeView, htItem);
+	if (key1.category == ChildCategory::Drive)
+	{
+		return lstrcmpi(key1.name.c_str(), key2.name.c_str()) < 0;
+	}
 
-			if ((htItem == nullptr) && !htInsertAfter)
-			{
-				htInsertAfter = TVI_LAST;
-			}
-		}
+	if (useNaturalSortOrder)
+	{
+		return StrCmpLogicalW(key1.name.c_str(), key2.name.c_str()) < 0;
 	}
 
-	return htInsertAfter;
+	return StrCmpIW(key1.name.c_str(), key2.name.c_str()) < 0;
 }
 
-HTREEITEM ShellTreeView::DetermineDriveSortedPosition(HTREEITEM hParent, const TCHAR *szItemName)
+HTREEITEM ShellTreeView::InsertChild(
+	HTREEITEM parentItem, HTREEITEM insertAfter, EnumeratedChild &child)
 {
-	HTREEITEM htItem;
-	HTREEITEM hPreviousItem;
-	TVITEMEX item;
+	const ItemInfo_t &parentInfo = GetItemByHandle(parentItem);
 
-	/* Drives will always be the first children of the specified
-	item (usually 'My Computer'). Therefore, keep looping while
-	there are more child items and the current item comes
-	afterwards, or if there are no child items, place the item
-	as the first child. */
-	htItem = TreeView_GetChild(m_hTreeView, hParent);
+	int itemId = GenerateUniqueItemId();
+	m_itemInfoMap[itemId].pidl.reset(ILCombine(parentInfo.pidl.get(), child.pidl.get()));
+	m_itemInfoMap[itemId].pridl = std::move(child.pidl);
 
-	if (htItem == nullptr)
-		return TVI_FIRST;
+	TVITEMEX tvItem;
+	tvItem.mask = TVIF_TEXT | TVIF_IMAGE | TVIF_SELECTEDIMAGE | TVIF_PARAM | TVIF_CHILDREN;
+	tvItem.pszText = child.displayName.data();
+	tvItem.iImage = I_IMAGECALLBACK;
+	tvItem.iSelectedImage = I_IMAGECALLBACK;
+	tvItem.lParam = itemId;
+	tvItem.cChildren = I_CHILDRENCALLBACK;
 
-	hPreviousItem = TVI_FIRST;
+	TVINSERTSTRUCT tvis;
+	tvis.hInsertAfter = insertAfter;
+	tvis.hParent = parentItem;
+	tvis.itemex = tvItem;
 
-	while (htItem != nullptr)
+	HTREEITEM item = TreeView_InsertItem(m_hTreeView, &tvis);
+
+	if (!item)
 	{
-		item.mask = TVIF_PARAM | TVIF_HANDLE;
-		item.hItem = htItem;
-		TreeView_GetItem(m_hTreeView, &item);
+		m_itemInfoMap.erase(itemId);
+		return nullptr;
+	}
 
-		std::wstring fullItemPath;
-		GetDisplayName(m_itemInfoMap.at(static_cast<int>(item.lParam)).pidl.get(), SHGDN_FORPARSING,
-			fullItemPath);
+	AddToPathIndex(item, child.parsingPath);
 
-		if (PathIsRoot(fullItemPath.c_str()))
+	return item;
+}
+
+// Merges the children into the existing (sorted) children of the parent, in a single pass over the
+// existing children.
+void ShellTreeView::InsertChildrenSorted(
+	HTREEITEM parentItem, std::vector<EnumeratedChild> children)
+{
+	bool useNaturalSortOrder = m_config->globalFolderSettings.useNaturalSortOrder;
+	std::sort(children.begin(), children.end(),
+		[useNaturalSortOrder](const EnumeratedChild &child1, const EnumeratedChild &child2) {
+			return IsChildSortedBefore(child1.sortKey, child2.sortKey, useNaturalSortOrder);
+		});
+
+	auto childItr = children.begin();
+	HTREEITEM insertAfter = TVI_FIRST;
+
+	for (HTREEITEM existingItem = TreeView_GetChild(m_hTreeView, parentItem);
+		 existingItem != nullptr && childItr != children.end();
+		 existingItem = TreeView_GetNextSibling(m_hTreeView, existingItem))
+	{
+		// The placeholder shown during an expansion is always the last child.
+		if (IsLoadingPlaceholder(existingItem))
 		{
-			if (lstrcmp(szItemName, fullItemPath.c_str()) < 0)
-				return hPreviousItem;
+			break;
 		}
-		else
+
+		PCIDLIST_ABSOLUTE pidlExisting = GetItemByHandle(existingItem).pidl.get();
+
+		std::wstring existingParsingName;
+		GetDisplayName(pidlExisting, SHGDN_FORPARSING, existingParsingName);
+		ChildSortKey existingSortKey = GetChildSortKey(pidlExisting, existingParsingName);
+
+		for (; childItr != children.end()
+			 && IsChildSortedBefore(childItr->sortKey, existingSortKey, useNaturalSortOrder);
+			 ++childItr)
 		{
-			return hPreviousItem;
+			HTREEITEM item = InsertChild(parentItem, insertAfter, *childItr);
+
+			if (item)
+			{
+				insertAfter = item;
+			}
 		}
 
-		hPreviousItem = htItem;
-		htItem = TreeView_GetNextSibling(m_hTreeView, htItem);
+		insertAfter = existingItem;
 	}
 
-	return htItem;
+	for (; childItr != children.end(); ++childItr)
+	{
+		HTREEITEM item = InsertChild(parentItem, insertAfter, *childItr);
+
+		if (item)
+		{
+			insertAfter = item;
+		}
+	}
+}
+
+// Expands the item in the background. A placeholder child is shown until the enumeration has
+// finished, with the children being inserted in their sorted positions as they're found, so that
+// expanding a folder with a large number of subfolders (e.g. on a network share) never blocks the
+// UI. Collapsing the item cancels the expansion.
+void ShellTreeView::StartExpansion(HTREEITEM parentItem)
+{
+	if (IsExpansionPending(parentItem))
+	{
+		return;
+	}
+
+	// The placeholder refers to the parent folder, so that anything that looks up the placeholder
+	// (e.g. a drop onto it) will act on the parent.
+	int placeholderId = GenerateUniqueItemId();
+	m_itemInfoMap[placeholderId].pidl = GetItemPidl(parentItem);
+
+	std::wstring loadingText = ResourceHelper::LoadString(m_hResourceModule, IDS_TREEVIEW_LOADING);
+
+	TVITEMEX tvItem;
+	tvItem.mask = TVIF_TEXT | TVIF_IMAGE | TVIF_SELECTEDIMAGE | TVIF_PARAM | TVIF_CHILDREN;
+	tvItem.pszText = loadingText.data();
+	tvItem.iImage = I_IMAGENONE;
+	tvItem.iSelectedImage = I_IMAGENONE;
+	tvItem.lParam = placeholderId;
+	tvItem.cChildren = 0;
+
+	TVINSERTSTRUCT tvis;
+	tvis.hInsertAfter = TVI_LAST;
+	tvis.hParent = parentItem;
+	tvis.itemex = tvItem;
+
+	HTREEITEM placeholderItem = TreeView_InsertItem(m_hTreeView, &tvis);
+
+	if (!placeholderItem)
+	{
+		m_itemInfoMap.erase(placeholderId);
+		ExpandDirectory(parentItem);
+		return;
+	}
+
+	int expansionId = m_expansionIDCounter++;
+
+	auto [itr, inserted] = m_pendingExpansions.try_emplace(parentItem);
+	PendingExpansion &pendingExpansion = itr->second;
+	pendingExpansion.expansionId = expansionId;
+	pendingExpansion.placeholderItem = placeholderItem;
+
+	BasicItemInfo basicItemInfo;
+	basicItemInfo.pidl = GetItemPidl(parentItem);
+
+	m_expansionThreadPool.push(
+		[treeView = m_hTreeView, expansionId, parentItem, basicItemInfo,
+			enumFlags = GetChildEnumerationFlags(),
+			checkPinnedToNamespaceTree = m_config->checkPinnedToNamespaceTreeProperty,
+			useNaturalSortOrder = m_config->globalFolderSettings.useNaturalSortOrder,
+			stopToken = pendingExpansion.stopSource.get_token()](int id) {
+			UNREFERENCED_PARAMETER(id);
+
+			EnumerateChildrenAsync(treeView, expansionId, parentItem, basicItemInfo.pidl.get(),
+				enumFlags, checkPinnedToNamespaceTree, useNaturalSortOrder, stopToken);
+		});
+}
+
+void ShellTreeView::EnumerateChildrenAsync(HWND treeView, int expansionId, HTREEITEM parentItem,
+	PCIDLIST_ABSOLUTE pidlDirectory, SHCONTF enumFlags, bool checkPinnedToNamespaceTree,
+	bool useNaturalSortOrder, std::stop_token stopToken)
+{
+	std::vector<EnumeratedChild> batch;
+	auto lastBatchTime = std::chrono::steady_clock::now();
+
+	auto sortBatch = [&batch, useNaturalSortOrder]() {
+		std::sort(batch.begin(), batch.end(),
+			[useNaturalSortOrder](const EnumeratedChild &child1, const EnumeratedChild &child2) {
+				return IsChildSortedBefore(child1.sortKey, child2.sortKey, useNaturalSortOrder);
+			});
+	};
+
+	bool anyChildren = false;
+
+	HRESULT hr = EnumerateChildren(pidlDirectory, enumFlags, checkPinnedToNamespaceTree,
+		[&](EnumeratedChild child) {
+			if (stopToken.stop_requested())
+			{
+				return false;
+			}
+
+			batch.push_back(std::move(child));
+			anyChildren = true;
+
+			auto now = std::chrono::steady_clock::now();
+
+			if (batch.size() >= EXPANSION_BATCH_SIZE
+				|| (now - lastBatchTime) >= EXPANSION_BATCH_INTERVAL)
+			{
+				sortBatch();
+				PostExpansionResults(treeView, expansionId, parentItem, std::move(batch), false);
+
+				batch.clear();
+				lastBatchTime = now;
+			}
+
+			return true;
+		});
+
+	if (stopToken.stop_requested())
+	{
+		return;
+	}
+
+	if (SUCCEEDED(hr))
+	{
+		CacheSubfolderState(pidlDirectory, enumFlags, checkPinnedToNamespaceTree, anyChildren);
+	}
+
+	// The last batch is always sent, even if it's empty, so that the placeholder can be removed.
+	sortBatch();
+	PostExpansionResults(treeView, expansionId, parentItem, std::move(batch), true);
+}
+
+// Once a folder has been fully enumerated, whether or not it has any subfolders is known, so
+// there's no need to separately retrieve SFGAO_HASSUBFOLDER for it.
+void ShellTreeView::CacheSubfolderState(PCIDLIST_ABSOLUTE pidlDirectory, SHCONTF enumFlags,
+	bool checkPinnedToNamespaceTree, bool anyChildren)
+{
+	// When only pinned items are shown, a folder with no visible children may still have
+	// subfolders.
+	if (!anyChildren && checkPinnedToNamespaceTree)
+	{
+		return;
+	}
+
+	std::wstring path;
+	HRESULT hr = GetDisplayName(pidlDirectory, SHGDN_FORPARSING, path);
+
+	if (FAILED(hr))
+	{
+		return;
+	}
+
+	GetItemAttributeCache().OnFolderEnumerated(
+		path, anyChildren, WI_IsFlagSet(enumFlags, SHCONTF_INCLUDEHIDDEN));
+}
+
+void ShellTreeView::PostExpansionResults(HWND treeView, int expansionId, HTREEITEM parentItem,
+	std::vector<EnumeratedChild> children, bool finished)
+{
+	auto results = std::make_unique<ExpansionResults>();
+	results->expansionId = expansionId;
+	results->parentItem = parentItem;
+	results->children = std::move(children);
+	results->finished = finished;
+
+	BOOL res = PostMessage(treeView, WM_APP_EXPANSION_RESULTS_READY,
+		reinterpret_cast<WPARAM>(results.get()), 0);
+
+	if (res)
+	{
+		results.release();
+	}
+}
+
+void ShellTreeView::ProcessExpansionResults(std::unique_ptr<ExpansionResults> results)
+{
+	auto itr = m_pendingExpansions.find(results->parentItem);
+
+	// The expansion may have been cancelled since the results were sent (in which case, the item
+	// handle may even have been reused).
+	if (itr == m_pendingExpansions.end() || itr->second.expansionId != results->expansionId)
+	{
+		return;
+	}
+
+	auto &insertedChildren = itr->second.insertedChildren;
+	bool useNaturalSortOrder = m_config->globalFolderSettings.useNaturalSortOrder;
+
+	if (!results->children.empty())
+	{
+		SendMessage(m_hTreeView, WM_SETREDRAW, FALSE, 0);
+
+		for (auto &child : results->children)
+		{
+			// The child may have already been added in response to a directory modification
+			// notification.
+			if (HasChildWithPath(results->parentItem, child.parsingPath))
+			{
+				continue;
+			}
+
+			// Each child is inserted directly into its sorted position, so the children never
+			// need to be sorted once they're in the treeview.
+			auto position = std::upper_bound(insertedChildren.begin(), insertedChildren.end(),
+				child.sortKey,
+				[useNaturalSortOrder](const ChildSortKey &sortKey, const InsertedChild &inserted) {
+					return IsChildSortedBefore(sortKey, inserted.sortKey, useNaturalSortOrder);
+				});
+
+			HTREEITEM insertAfter =
+				(position == insertedChildren.begin()) ? TVI_FIRST : std::prev(position)->item;
+			HTREEITEM item = InsertChild(results->parentItem, insertAfter, child);
+
+			if (!item)
+			{
+				continue;
+			}
+
+			insertedChildren.insert(position, { std::move(child.sortKey), item });
+		}
+
+		SendMessage(m_hTreeView, WM_SETREDRAW, TRUE, 0);
+	}
+
+	if (results->finished)
+	{
+		FinishExpansion(results->parentItem);
+	}
+
+	ContinueLocatingItem();
+}
+
+void ShellTreeView::FinishExpansion(HTREEITEM parentItem)
+{
+	auto itr = m_pendingExpansions.find(parentItem);
+
+	if (itr == m_pendingExpansions.end())
+	{
+		return;
+	}
+
+	HTREEITEM placeholderItem = itr->second.placeholderItem;
+	bool hasChildren = !itr->second.insertedChildren.empty();
+	m_pendingExpansions.erase(itr);
+
+	m_itemInfoMap.erase(GetItemInternalIndex(placeholderItem));
+	TreeView_DeleteItem(m_hTreeView, placeholderItem);
+
+	if (!hasChildren)
+	{
+		TVITEM tvItem;
+		tvItem.mask = TVIF_HANDLE | TVIF_CHILDREN;
+		tvItem.hItem = parentItem;
+		tvItem.cChildren = 0;
+		TreeView_SetItem(m_hTreeView, &tvItem);
+	}
+}
+
+// Note that this doesn't remove any of the items that have been inserted. That's left to the
+// caller (e.g. when the item is collapsed, all of its children are removed).
+void ShellTreeView::CancelExpansion(HTREEITEM parentItem)
+{
+	auto itr = m_pendingExpansions.find(parentItem);
+
+	if (itr == m_pendingExpansions.end())
+	{
+		return;
+	}
+
+	itr->second.stopSource.request_stop();
+	m_pendingExpansions.erase(itr);
+}
+
+bool ShellTreeView::IsExpansionPending(HTREEITEM item) const
+{
+	return m_pendingExpansions.contains(item);
+}
+
+bool ShellTreeView::IsLoadingPlaceholder(HTREEITEM item) const
+{
+	if (!item)
+	{
+		return false;
+	}
+
+	HTREEITEM parentItem = TreeView_GetParent(m_hTreeView, item);
+	auto itr = m_pendingExpansions.find(parentItem);
+
+	return itr != m_pendingExpansions.end() && itr->second.placeholderItem == item;
+}
+
+int ShellTreeView::GenerateUniqueItemId()
+{
+	return m_itemIDCounter++;
+}
+
+HTREEITEM ShellTreeView::DetermineItemSortedPosition(HTREEITEM hParent, const TCHAR *szItem)
+{
+	HTREEITEM htInsertAfter = nullptr;
+
+	if (PathIsRoot(szItem))
+	{
+		return DetermineDriveSortedPosition(hParent, szItem);
+	}
+	else
+	{
+		HTREEITEM htItem;
+		HTREEITEM hPreviousItem;
+		TVITEMEX item;
+		SFGAOF attributes;
+
+		/* Insert the item in its sorted position, skipping
+		past any drives or any non-filesystem items (i.e.
+		'My Computer', 'Recycle Bin', etc). */
+		htItem = TreeView_GetChild(m_hTreeView, hParent);
+
+		/* If the parent has no children, this item will
+		be the first that appears. */
+		if (htItem == nullptr)
+			return TVI_FIRST;
+
+		hPreviousItem = TVI_FIRST;
+
+		while (htInsertAfter == nullptr)
+		{
+			item.mask = TVIF_PARAM | TVIF_HANDLE;
+			item.hItem = htItem;
+			TreeView_GetItem(m_hTreeView, &item);
+
+			std::wstring fullItemPath;
+			GetDisplayName(m_itemInfoMap.at(static_cast<int>(item.lParam)).pidl.get(),
+				SHGDN_FORPARSING, fullItemPath);
+
+			attributes = GetFileAttributes(fullItemPath.c_str());
+
+			/* Only perform the comparison if the current item is a real
+			file or folder. */
+			if (!PathIsRoot(fullItemPath.c_str())
+				&& ((attributes & SFGAO_FILESYSTEM) != SFGAO_FILESYSTEM))
+			{
+				if (lstrcmpi(szItem, fullItemPath.c_str()) < 0)
+				{
+					htInsertAfter = hPreviousItem;
+				}
+			}
+
+			hPreviousItem = htItem;
+			htItem = TreeView_GetNextSibling(m_hTreeView, htItem);
+
+			if ((htItem == nullptr) && !htInsertAfter)
+			{
+				htInsertAfter = TVI_LAST;
+			}
+		}
+	}
+
+	return htInsertAfter;
+}
+
+HTREEITEM ShellTreeView::DetermineDriveSortedPosition(HTREEITEM hParent, const TCHAR *szItemName)
+{
+	HTREEITEM htItem;
+	HTREEITEM hPreviousItem;
+	TVITEMEX item;
+
+	/* Drives will always be the first children of the specified
+	item (usually 'My Computer'). Therefore, keep looping while
+	there are more child items and the current item comes
+	afterwards, or if there are no child items, place the item
+	as the first child. */
+	htItem = TreeView_GetChild(m_hTreeView, hParent);
+
+	if (htItem == nullptr)
+		return TVI_FIRST;
+
+	hPreviousItem = TVI_FIRST;
+
+	while (htItem != nullptr)
+	{
+		item.mask = TVIF_PARAM | TVIF_HANDLE;
+		item.hItem = htItem;
+		TreeView_GetItem(m_hTreeView, &item);
+
+		std::wstring fullItemPath;
+		GetDisplayName(m_itemInfoMap.at(static_cast<int>(item.lParam)).pidl.get(), SHGDN_FORPARSING,
+			fullItemPath);
+
+		if (PathIsRoot(fullItemPath.c_str()))
+		{
+			if (lstrcmp(szItemName, fullItemPath.c_str()) < 0)
+				return hPreviousItem;
+		}
+		else
+		{
+			return hPreviousItem;
+		}
+
+		hPreviousItem = htItem;
+		htItem = TreeView_GetNextSibling(m_hTreeView, htItem);
+	}
+
+	return htItem;
 }
 
 unique_pidl_absolute ShellTreeView::GetSelectedItemPidl() const
@@ -980,72 +1422,23 @@ HTREEITEM ShellTreeView::LocateItem(PCIDLIST_ABSOLUTE pidlDirectory)
 /* Finds items that have been deleted or renamed
 (meaning that their pidl's are no longer valid).
 
-Use two basic strategies to find the item:
-1. Find the parent item through its pidl, the child
-through it's name.
-2. Find the item simply by its name.
-The first method would not normally be needed, but
-real folders can have a display name that differs
-from their parsing name.
-For example, the C:\Users\Username\Documents
-folder in Windows 7 has a display name of
-"My Documents". This is an issue, since a
-direct path lookup will fail. */
-/* TODO: Store parsing name with each item, and
-match against that. */
+Items are indexed on the parsing path they had when
+they were inserted, so the lookup works even though the
+item no longer exists. Matching against the parsing path
+(rather than the item text) also means that folders with
+a display name that differs from their parsing name (e.g.
+C:\Users\Username\Documents, which was shown as "My
+Documents" in Windows 7) can be found. */
 HTREEITEM ShellTreeView::LocateDeletedItem(const TCHAR *szFullFileName)
 {
-	HTREEITEM hItem = nullptr;
-	PIDLIST_ABSOLUTE pidl = nullptr;
-	TCHAR szParent[MAX_PATH];
-	BOOL bFound = FALSE;
-	HRESULT hr;
-
-	StringCchCopy(szParent, SIZEOF_ARRAY(szParent), szFullFileName);
-	PathRemoveFileSpec(szParent);
-	hr = SHParseDisplayName(szParent, nullptr, &pidl, 0, nullptr);
-
-	if (SUCCEEDED(hr))
-	{
-		hItem = LocateExistingItem(pidl);
-
-		if (hItem != nullptr)
-		{
-			HTREEITEM hChild;
-			TVITEM tvItem;
-			TCHAR szFileName[MAX_PATH];
-
-			hChild = TreeView_GetChild(m_hTreeView, hItem);
-
-			StringCchCopy(szFileName, SIZEOF_ARRAY(szFileName), szFullFileName);
-			PathStripPath(szFileName);
-
-			/* Now try to find the child folder. */
-			while (hChild != nullptr)
-			{
-				TCHAR szItem[MAX_PATH];
-
-				tvItem.mask = TVIF_TEXT | TVIF_HANDLE;
-				tvItem.hItem = hChild;
-				tvItem.pszText = szItem;
-				tvItem.cchTextMax = SIZEOF_ARRAY(szItem);
-				TreeView_GetItem(m_hTreeView, &tvItem);
-
-				if (lstrcmp(szFileName, szItem) == 0)
-				{
-					hItem = hChild;
-					bFound = TRUE;
-					break;
-				}
-
-				hChild = TreeView_GetNextSibling(m_hTreeView, hChild);
-			}
-		}
-	}
+	/* Items in their file system location are preferred
+	over any copies shown elsewhere (e.g. directly under
+	the desktop). */
+	HTREEITEM hItem = FindIndexedItemByPath(szFullFileName, LocateMyComputerItem());
 
-	if (!bFound)
+	if (hItem == nullptr)
 	{
-		hItem = LocateItemByPath(szFullFileName, FALSE);
+		hItem = FindIndexedItemByPath(szFullFileName);
 	}
 
 	return hItem;
@@ -1072,152 +1465,231 @@ HTREEITEM ShellTreeView::LocateExistingItem(PCIDLIST_ABSOLUTE pidlDirectory)
 HTREEITEM ShellTreeView::LocateItemInternal(
 	PCIDLIST_ABSOLUTE pidlDirectory, BOOL bOnlyLocateExistingItem)
 {
-	HTREEITEM hRoot;
-	HTREEITEM hItem;
-	TVITEMEX item;
-	BOOL bFound = FALSE;
-
-	/* Get the root of the tree (root of namespace). */
-	hRoot = TreeView_GetRoot(m_hTreeView);
-	hItem = hRoot;
-
-	item.mask = TVIF_PARAM | TVIF_HANDLE;
-	item.hItem = hItem;
-	TreeView_GetItem(m_hTreeView, &item);
-
-	/* Keep searching until the specified item
-	is found or it is found the item does not
-	exist in the treeview.
-	Look through each item, once an ancestor is
-	found, look through it's children, expanding
-	the parent node if necessary. */
-	while (!bFound && hItem != nullptr)
-	{
-		if (ArePidlsEquivalent(
-				m_itemInfoMap.at(static_cast<int>(item.lParam)).pidl.get(), pidlDirectory))
-		{
-			bFound = TRUE;
+	HTREEITEM hItem = FindIndexedItem(pidlDirectory);
+
+	if (hItem != nullptr)
+	{
+		return hItem;
+	}
+
+	/* The item isn't in the treeview yet. Starting at the
+	root of the tree (root of namespace), each ancestor
+	is located in turn, expanding it if necessary. */
+	hItem = TreeView_GetRoot(m_hTreeView);
 
+	while (hItem != nullptr)
+	{
+		PCIDLIST_ABSOLUTE pidlItem = GetItemByHandle(hItem).pidl.get();
+
+		if (ArePidlsEquivalent(pidlItem, pidlDirectory))
+		{
 			break;
 		}
 
-		if (ILIsParent(
-				m_itemInfoMap.at(static_cast<int>(item.lParam)).pidl.get(), pidlDirectory, FALSE))
+		if (ILIsParent(pidlItem, pidlDirectory, FALSE))
 		{
-			if ((TreeView_GetChild(m_hTreeView, hItem)) == nullptr)
+			// An item that's still being expanded in the background is expanded synchronously
+			// here. If only existing items can be located, the children that have been inserted
+			// so far are searched instead.
+			if ((TreeView_GetChild(m_hTreeView, hItem)) == nullptr || IsExpansionPending(hItem))
 			{
-				if (bOnlyLocateExistingItem)
+				if (!bOnlyLocateExistingItem)
 				{
-					return nullptr;
+					ExpandItemSynchronously(hItem);
 				}
-				else
+				else if ((TreeView_GetChild(m_hTreeView, hItem)) == nullptr)
 				{
-					SendMessage(m_hTreeView, TVM_EXPAND, TVE_EXPAND, (LPARAM) hItem);
+					return nullptr;
 				}
 			}
 
-			hItem = TreeView_GetChild(m_hTreeView, hItem);
+			hItem = LocateChildItem(hItem, pidlDirectory);
 		}
 		else
 		{
 			hItem = TreeView_GetNextSibling(m_hTreeView, hItem);
 		}
-
-		item.mask = TVIF_PARAM | TVIF_HANDLE;
-		item.hItem = hItem;
-		TreeView_GetItem(m_hTreeView, &item);
 	}
 
 	return hItem;
 }
 
-HTREEITEM ShellTreeView::LocateItemByPath(const TCHAR *szItemPath, BOOL bExpand)
+/* Returns the child of the parent item that's an ancestor
+of (or equal to) the specified item. If the child can't be
+found in the index, the first child is returned, so that
+the caller can check each of the children in turn. */
+HTREEITEM ShellTreeView::LocateChildItem(HTREEITEM parentItem, PCIDLIST_ABSOLUTE pidlDescendant)
 {
-	HTREEITEM hMyComputer;
-	HTREEITEM hItem;
-	HTREEITEM hNextItem;
-	TVITEMEX item;
-	TCHAR *ptr = nullptr;
-	TCHAR itemText[MAX_PATH];
-	TCHAR fullItemPathCopy[MAX_PATH];
-	TCHAR *nextToken = nullptr;
+	HTREEITEM childItem = FindIndexedChildItem(parentItem, pidlDescendant);
 
-	StringCchCopy(fullItemPathCopy, SIZEOF_ARRAY(fullItemPathCopy), szItemPath);
+	if (childItem != nullptr)
+	{
+		return childItem;
+	}
 
-	PathRemoveBackslash(fullItemPathCopy);
+	return TreeView_GetChild(m_hTreeView, parentItem);
+}
 
-	unique_pidl_absolute pidlMyComputer;
-	SHGetFolderLocation(nullptr, CSIDL_DRIVES, nullptr, 0, wil::out_param(pidlMyComputer));
+HTREEITEM ShellTreeView::FindIndexedChildItem(
+	HTREEITEM parentItem, PCIDLIST_ABSOLUTE pidlDescendant)
+{
+	UINT childDepth = ILGetCount(GetItemByHandle(parentItem).pidl.get()) + 1;
+
+	unique_pidl_absolute pidlChild(ILCloneFull(pidlDescendant));
+
+	while (ILGetCount(pidlChild.get()) > childDepth)
+	{
+		ILRemoveLastID(pidlChild.get());
+	}
 
-	hMyComputer = LocateItem(pidlMyComputer.get());
+	return FindIndexedItem(pidlChild.get(), parentItem);
+}
+
+// Locates the item without blocking the UI. Rather than being expanded synchronously, each parent
+// of the item is expanded in the background, with the search continuing each time a batch of
+// children is inserted. Locating another item (or cancelling) abandons the search, so that when
+// items are located in quick succession, only the last one results in any further expansion.
+void ShellTreeView::LocateItemAsync(
+	PCIDLIST_ABSOLUTE pidlDirectory, std::function<void(HTREEITEM item)> callback)
+{
+	m_pendingLocate =
+		PendingLocate{ unique_pidl_absolute(ILCloneFull(pidlDirectory)), std::move(callback) };
+	ContinueLocatingItem();
+}
+
+void ShellTreeView::CancelLocateItemAsync()
+{
+	m_pendingLocate.reset();
+}
+
+void ShellTreeView::ContinueLocatingItem()
+{
+	if (!m_pendingLocate)
+	{
+		return;
+	}
 
-	/* First of drives in system. */
-	hItem = TreeView_GetChild(m_hTreeView, hMyComputer);
+	PCIDLIST_ABSOLUTE pidlDirectory = m_pendingLocate->pidl.get();
+	HTREEITEM hItem = FindIndexedItem(pidlDirectory);
 
-	/* My Computer node may not be expanded. */
 	if (hItem == nullptr)
+	{
+		hItem = TreeView_GetRoot(m_hTreeView);
+	}
+
+	while (hItem != nullptr)
+	{
+		PCIDLIST_ABSOLUTE pidlItem = GetItemByHandle(hItem).pidl.get();
+
+		if (ArePidlsEquivalent(pidlItem, pidlDirectory))
+		{
+			break;
+		}
+
+		if (!ILIsParent(pidlItem, pidlDirectory, FALSE))
+		{
+			hItem = TreeView_GetNextSibling(m_hTreeView, hItem);
+			continue;
+		}
+
+		if (!IsExpansionPending(hItem) && TreeView_GetChild(m_hTreeView, hItem) == nullptr)
+		{
+			SendMessage(m_hTreeView, TVM_EXPAND, TVE_EXPAND, reinterpret_cast<LPARAM>(hItem));
+		}
+
+		if (IsExpansionPending(hItem))
+		{
+			HTREEITEM childItem = FindIndexedChildItem(hItem, pidlDirectory);
+
+			if (childItem == nullptr)
+			{
+				// The search will continue once the next batch of children has been inserted.
+				return;
+			}
+
+			hItem = childItem;
+			continue;
+		}
+
+		hItem = LocateChildItem(hItem, pidlDirectory);
+	}
+
+	auto pendingLocate = std::move(*m_pendingLocate);
+	m_pendingLocate.reset();
+
+	if (hItem != nullptr)
+	{
+		pendingLocate.callback(hItem);
+	}
+}
+
+HTREEITEM ShellTreeView::LocateMyComputerItem()
+{
+	unique_pidl_absolute pidlMyComputer;
+	HRESULT hr =
+		SHGetFolderLocation(nullptr, CSIDL_DRIVES, nullptr, 0, wil::out_param(pidlMyComputer));
+
+	if (FAILED(hr))
+	{
+		return nullptr;
+	}
+
+	return LocateItem(pidlMyComputer.get());
+}
+
+/* Locates an item within the file system hierarchy
+under My Computer. */
+HTREEITEM ShellTreeView::LocateItemByPath(const TCHAR *szItemPath, BOOL bExpand)
+{
+	HTREEITEM hMyComputer = LocateMyComputerItem();
+
+	if (hMyComputer == nullptr)
+	{
 		return nullptr;
+	}
 
-	ptr = wcstok_s(fullItemPathCopy, _T("\\"), &nextToken);
-
-	StringCchCopy(itemText, SIZEOF_ARRAY(itemText), ptr);
-	StringCchCat(itemText, SIZEOF_ARRAY(itemText), _T("\\"));
-	ptr = itemText;
+	HTREEITEM hItem = FindIndexedItemByPath(szItemPath, hMyComputer);
 
-	item.mask = TVIF_HANDLE | TVIF_PARAM;
-	item.hItem = hItem;
-	TreeView_GetItem(m_hTreeView, &item);
+	if (hItem != nullptr || !bExpand)
+	{
+		return hItem;
+	}
 
-	std::wstring itemName;
-	GetDisplayName(
-		m_itemInfoMap.at(static_cast<int>(item.lParam)).pidl.get(), SHGDN_FORPARSING, itemName);
+	/* Find the deepest ancestor that's already in the
+	treeview, then expand down from there, one path
+	component at a time. */
+	std::wstring itemPath = szItemPath;
+	std::vector<std::wstring> remainingPaths;
 
-	while (StrCmpI(ptr, itemName.c_str()) != 0)
+	while (hItem == nullptr)
 	{
-		hItem = TreeView_GetNextSibling(m_hTreeView, hItem);
+		remainingPaths.push_back(itemPath);
 
-		if (hItem == nullptr)
-			return nullptr;
+		TCHAR parentPath[MAX_PATH];
+		StringCchCopy(parentPath, SIZEOF_ARRAY(parentPath), itemPath.c_str());
 
-		item.mask = TVIF_PARAM;
-		item.hItem = hItem;
-		TreeView_GetItem(m_hTreeView, &item);
+		if (!PathRemoveFileSpec(parentPath))
+		{
+			return nullptr;
+		}
 
-		GetDisplayName(
-			m_itemInfoMap.at(static_cast<int>(item.lParam)).pidl.get(), SHGDN_FORPARSING, itemName);
+		itemPath = parentPath;
+		hItem = FindIndexedItemByPath(itemPath, hMyComputer);
 	}
 
-	item.mask = TVIF_TEXT;
-
-	while ((ptr = wcstok_s(nullptr, _T("\\"), &nextToken)) != nullptr)
+	for (auto itr = remainingPaths.rbegin(); itr != remainingPaths.rend(); ++itr)
 	{
-		if (TreeView_GetChild(m_hTreeView, hItem) == nullptr)
+		if (TreeView_GetChild(m_hTreeView, hItem) == nullptr || IsExpansionPending(hItem))
 		{
-			if (bExpand)
-				SendMessage(m_hTreeView, TVM_EXPAND, TVE_EXPAND, (LPARAM) hItem);
-			else
-				return nullptr;
+			ExpandItemSynchronously(hItem);
 		}
 
-		hNextItem = TreeView_GetChild(m_hTreeView, hItem);
-		hItem = hNextItem;
+		HTREEITEM hParent = hItem;
+		hItem = FindIndexedItemByPath(*itr, hParent);
 
-		item.pszText = itemText;
-		item.cchTextMax = SIZEOF_ARRAY(itemText);
-		item.hItem = hItem;
-		TreeView_GetItem(m_hTreeView, &item);
-
-		while (StrCmpI(ptr, itemText) != 0)
+		if (hItem == nullptr || TreeView_GetParent(m_hTreeView, hItem) != hParent)
 		{
-			hItem = TreeView_GetNextSibling(m_hTreeView, hItem);
-
-			if (hItem == nullptr)
-				return nullptr;
-
-			item.pszText = itemText;
-			item.cchTextMax = SIZEOF_ARRAY(itemText);
-			item.hItem = hItem;
-			TreeView_GetItem(m_hTreeView, &item);
+			return nullptr;
 		}
 	}
 
@@ -1296,6 +1768,150 @@ HTREEITEM ShellTreeView::LocateItemOnDesktopTree(const TCHAR *szFullFileName)
 	return hItem;
 }
 
+void ShellTreeView::AddToPathIndex(HTREEITEM item, const std::wstring &parsingPath)
+{
+	if (parsingPath.empty())
+	{
+		return;
+	}
+
+	RemoveFromPathIndex(item);
+
+	std::wstring key = GetPathIndexKey(parsingPath);
+	m_itemsByParsingPath.emplace(key, item);
+	m_parsingPathsByItem.emplace(item, std::move(key));
+}
+
+void ShellTreeView::AddToPathIndex(HTREEITEM item, PCIDLIST_ABSOLUTE pidl)
+{
+	std::wstring parsingPath;
+	HRESULT hr = GetDisplayName(pidl, SHGDN_FORPARSING, parsingPath);
+
+	if (FAILED(hr))
+	{
+		RemoveFromPathIndex(item);
+		return;
+	}
+
+	AddToPathIndex(item, parsingPath);
+}
+
+void ShellTreeView::RemoveFromPathIndex(HTREEITEM item)
+{
+	auto itr = m_parsingPathsByItem.find(item);
+
+	if (itr == m_parsingPathsByItem.end())
+	{
+		return;
+	}
+
+	auto [first, last] = m_itemsByParsingPath.equal_range(itr->second);
+
+	for (auto indexItr = first; indexItr != last; ++indexItr)
+	{
+		if (indexItr->second == item)
+		{
+			m_itemsByParsingPath.erase(indexItr);
+			break;
+		}
+	}
+
+	m_parsingPathsByItem.erase(itr);
+}
+
+// Returns the item with the specified pidl. If a parent item is provided, only its direct children
+// are considered.
+HTREEITEM ShellTreeView::FindIndexedItem(PCIDLIST_ABSOLUTE pidl, HTREEITEM parentItem)
+{
+	std::wstring parsingPath;
+	HRESULT hr = GetDisplayName(pidl, SHGDN_FORPARSING, parsingPath);
+
+	if (FAILED(hr))
+	{
+		return nullptr;
+	}
+
+	// Different items can share the same parsing path (e.g. virtual folders that don't have a
+	// unique parsing name), so the pidl of each candidate is checked as well.
+	auto [first, last] = m_itemsByParsingPath.equal_range(GetPathIndexKey(parsingPath));
+
+	for (auto itr = first; itr != last; ++itr)
+	{
+		if (parentItem && TreeView_GetParent(m_hTreeView, itr->second) != parentItem)
+		{
+			continue;
+		}
+
+		if (ArePidlsEquivalent(GetItemByHandle(itr->second).pidl.get(), pidl))
+		{
+			return itr->second;
+		}
+	}
+
+	return nullptr;
+}
+
+// Returns the item with the specified parsing path. If an ancestor item is provided, only items
+// beneath it are considered. Since this doesn't use the pidl of each item, it can be used to look
+// up an item that no longer exists.
+HTREEITEM ShellTreeView::FindIndexedItemByPath(
+	const std::wstring &parsingPath, HTREEITEM ancestorItem)
+{
+	auto [first, last] = m_itemsByParsingPath.equal_range(GetPathIndexKey(parsingPath));
+
+	for (auto itr = first; itr != last; ++itr)
+	{
+		if (!ancestorItem || IsAncestor(ancestorItem, itr->second))
+		{
+			return itr->second;
+		}
+	}
+
+	return nullptr;
+}
+
+bool ShellTreeView::HasChildWithPath(HTREEITEM parentItem, const std::wstring &parsingPath) const
+{
+	auto [first, last] = m_itemsByParsingPath.equal_range(GetPathIndexKey(parsingPath));
+
+	return std::any_of(first, last, [this, parentItem](const auto &entry) {
+		return TreeView_GetParent(m_hTreeView, entry.second) == parentItem;
+	});
+}
+
+bool ShellTreeView::IsAncestor(HTREEITEM ancestorItem, HTREEITEM item) const
+{
+	HTREEITEM currentItem = TreeView_GetParent(m_hTreeView, item);
+
+	while (currentItem != nullptr)
+	{
+		if (currentItem == ancestorItem)
+		{
+			return true;
+		}
+
+		currentItem = TreeView_GetParent(m_hTreeView, currentItem);
+	}
+
+	return false;
+}
+
+// Paths are compared case-insensitively and without any trailing backslash (other than on a root,
+// such as C:\).
+std::wstring ShellTreeView::GetPathIndexKey(const std::wstring &path)
+{
+	std::wstring key = path;
+
+	if (key.size() > 1 && key.back() == '\\' && !PathIsRoot(key.c_str()))
+	{
+		key.pop_back();
+	}
+
+	CharUpperBuff(key.data(), static_cast<DWORD>(key.size()));
+
+	return key;
+}
+
 void ShellTreeView::EraseItems(HTREEITEM hParent)
 {
 	auto hItem = TreeView_GetChild(m_hTreeView, hParent);
@@ -1320,62 +1936,10 @@ void ShellTreeView::EraseItems(HTREEITEM hParent)
 
 LRESULT CALLBACK ShellTreeView::OnDeviceChange(WPARAM wParam, LPARAM lParam)
 {
+	// Volumes being added and removed are handled in OnDriveChanged(). The notifications handled
+	// here are those for the drive handles registered in ProcessDriveOpenResult().
 	switch (wParam)
 	{
-	/* Device has being added/inserted into the system. Update the
-	treeview as neccessary. */
-	case DBT_DEVICEARRIVAL:
-	{
-		DEV_BROADCAST_HDR *dbh;
-
-		dbh = (DEV_BROADCAST_HDR *) lParam;
-
-		if (dbh->dbch_devicetype == DBT_DEVTYP_VOLUME)
-		{
-			DEV_BROADCAST_VOLUME *pdbv = nullptr;
-			SHFILEINFO shfi;
-			HTREEITEM hItem;
-			TVITEM tvItem;
-			TCHAR driveLetter;
-			TCHAR driveName[4];
-
-			pdbv = (DEV_BROADCAST_VOLUME *) dbh;
-
-			/* Build a string that will form the drive name. */
-			driveLetter = GetDriveLetterFromMask(pdbv->dbcv_unitmask);
-			StringCchPrintf(driveName, SIZEOF_ARRAY(driveName), _T("%c:\\"), driveLetter);
-
-			if (pdbv->dbcv_flags & DBTF_MEDIA)
-			{
-				hItem = LocateItemByPath(driveName, FALSE);
-
-				if (hItem != nullptr)
-				{
-					SHGetFileInfo(driveName, 0, &shfi, sizeof(shfi), SHGFI_SYSICONINDEX);
-
-					std::wstring displayName;
-					GetDisplayName(driveName, SHGDN_INFOLDER, displayName);
-
-					/* Update the drives icon and display name. */
-					tvItem.mask = TVIF_HANDLE | TVIF_TEXT | TVIF_IMAGE | TVIF_SELECTEDIMAGE;
-					tvItem.hItem = hItem;
-					tvItem.iImage = shfi.iIcon;
-					tvItem.iSelectedImage = shfi.iIcon;
-					tvItem.pszText = displayName.data();
-					TreeView_SetItem(m_hTreeView, &tvItem);
-				}
-			}
-			else
-			{
-				/* Add the drive to the treeview. */
-				AddItem(driveName);
-
-				MonitorDrive(driveName);
-			}
-		}
-	}
-	break;
-
 	case DBT_DEVICEQUERYREMOVE:
 	{
 		/* The system is looking for permission to remove
@@ -1459,49 +2023,6 @@ LRESULT CALLBACK ShellTreeView::OnDeviceChange(WPARAM wParam, LPARAM lParam)
 			UnregisterDeviceNotification(pdbHandle->dbch_hdevnotify);
 		}
 		break;
-
-		case DBT_DEVTYP_VOLUME:
-		{
-			DEV_BROADCAST_VOLUME *pdbv = nullptr;
-			SHFILEINFO shfi;
-			HTREEITEM hItem;
-			TVITEM tvItem;
-			TCHAR driveLetter;
-			TCHAR driveName[4];
-
-			pdbv = (DEV_BROADCAST_VOLUME *) dbh;
-
-			/* Build a string that will form the drive name. */
-			driveLetter = GetDriveLetterFromMask(pdbv->dbcv_unitmask);
-			StringCchPrintf(driveName, SIZEOF_ARRAY(driveName), _T("%c:\\"), driveLetter);
-
-			if (pdbv->dbcv_flags & DBTF_MEDIA)
-			{
-				hItem = LocateItemByPath(driveName, FALSE);
-
-				if (hItem != nullptr)
-				{
-					SHGetFileInfo(driveName, 0, &shfi, sizeof(shfi), SHGFI_SYSICONINDEX);
-
-					std::wstring displayName;
-					GetDisplayName(driveName, SHGDN_INFOLDER, displayName);
-
-					/* Update the drives icon and display name. */
-					tvItem.mask = TVIF_HANDLE | TVIF_TEXT | TVIF_IMAGE | TVIF_SELECTEDIMAGE;
-					tvItem.hItem = hItem;
-					tvItem.iImage = shfi.iIcon;
-					tvItem.iSelectedImage = shfi.iIcon;
-					tvItem.pszText = displayName.data();
-					TreeView_SetItem(m_hTreeView, &tvItem);
-				}
-			}
-			else
-			{
-				/* Remove the drive from the treeview. */
-				RemoveItem(driveName);
-			}
-		}
-		break;
 		}
 
 		return TRUE;
@@ -1511,92 +2032,174 @@ LRESULT CALLBACK ShellTreeView::OnDeviceChange(WPARAM wParam, LPARAM lParam)
 	return FALSE;
 }
 
-DWORD WINAPI Thread_MonitorAllDrives(LPVOID pParam)
+void ShellTreeView::OnDriveChanged(const DriveChange &change)
 {
-	ShellTreeView *shellTreeView = nullptr;
-	TCHAR *pszDriveStrings = nullptr;
-	TCHAR *ptrDrive = nullptr;
-	DWORD dwSize;
+	switch (change.type)
+	{
+	case DriveChange::Type::Added:
+		AddItem(change.path.c_str());
+		MonitorDrive(change.path.c_str());
+		break;
 
-	shellTreeView = (ShellTreeView *) pParam;
+	case DriveChange::Type::Removed:
+		RemoveItem(change.path.c_str());
+		break;
 
-	dwSize = GetLogicalDriveStrings(0, nullptr);
+	case DriveChange::Type::MediaChanged:
+	{
+		HTREEITEM hItem = LocateItemByPath(change.path.c_str(), FALSE);
 
-	pszDriveStrings = (TCHAR *) malloc((dwSize + 1) * sizeof(TCHAR));
+		if (hItem != nullptr)
+		{
+			std::wstring displayName = change.displayName;
 
-	if (pszDriveStrings == nullptr)
-		return 0;
+			/* Update the drives icon and display name. */
+			TVITEM tvItem;
+			tvItem.mask = TVIF_HANDLE | TVIF_TEXT | TVIF_IMAGE | TVIF_SELECTEDIMAGE;
+			tvItem.hItem = hItem;
+			tvItem.iImage = change.iconIndex;
+			tvItem.iSelectedImage = change.iconIndex;
+			tvItem.pszText = displayName.data();
+			TreeView_SetItem(m_hTreeView, &tvItem);
+		}
+	}
+	break;
+	}
+}
 
-	dwSize = GetLogicalDriveStrings(dwSize, pszDriveStrings);
+void ShellTreeView::MonitorAllDrives()
+{
+	DWORD dwSize = GetLogicalDriveStrings(0, nullptr);
 
-	if (dwSize != 0)
+	if (dwSize == 0)
 	{
-		ptrDrive = pszDriveStrings;
+		return;
+	}
 
-		while (*ptrDrive != '\0')
-		{
-			shellTreeView->MonitorDrivePublic(ptrDrive);
+	std::vector<TCHAR> driveStrings(dwSize + 1);
+	dwSize = GetLogicalDriveStrings(static_cast<DWORD>(driveStrings.size()), driveStrings.data());
 
-			ptrDrive += lstrlen(ptrDrive) + 1;
-		}
+	if (dwSize == 0)
+	{
+		return;
 	}
 
-	free(pszDriveStrings);
+	TCHAR *ptrDrive = driveStrings.data();
+
+	while (*ptrDrive != '\0')
+	{
+		MonitorDrive(ptrDrive);
 
-	return 1;
+		ptrDrive += lstrlen(ptrDrive) + 1;
+	}
 }
 
-void ShellTreeView::MonitorDrivePublic(const TCHAR *szDrive)
+bool ShellTreeView::IsOpeningDrives() const
 {
-	MonitorDrive(szDrive);
+	return !m_driveOpenResults.empty();
 }
 
 void ShellTreeView::MonitorDrive(const TCHAR *szDrive)
 {
-	DirectoryAltered_t *pDirectoryAltered = nullptr;
-	DEV_BROADCAST_HANDLE dbv;
-	HANDLE hDrive;
-	HDEVNOTIFY hDevNotify;
-	DriveEvent_t de;
-	int iMonitorId;
+	int driveOpenResultID = m_driveOpenResultIDCounter++;
+
+	auto result = m_driveOpenThreadPool.push(
+		[treeView = m_hTreeView, driveOpenResultID, drive = std::wstring(szDrive)](int id)
+		{
+			UNREFERENCED_PARAMETER(id);
+
+			return OpenDriveAsync(treeView, driveOpenResultID, drive);
+		});
+
+	m_driveOpenResults.insert({ driveOpenResultID, std::move(result) });
+}
+
+std::optional<ShellTreeView::DriveOpenResult> ShellTreeView::OpenDriveAsync(
+	HWND treeView, int driveOpenResultId, const std::wstring &drive)
+{
+	auto postResult = wil::scope_exit([treeView, driveOpenResultId]() {
+		PostMessage(treeView, WM_APP_DRIVE_OPEN_RESULT_READY, driveOpenResultId, 0);
+	});
 
 	/* Remote (i.e. network) drives will NOT be monitored. */
-	if (GetDriveType(szDrive) != DRIVE_REMOTE)
+	if (GetDriveType(drive.c_str()) == DRIVE_REMOTE)
 	{
-		hDrive = CreateFile(szDrive, FILE_LIST_DIRECTORY,
-			FILE_SHARE_READ | FILE_SHARE_DELETE | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING,
-			FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+		return std::nullopt;
+	}
 
-		if (hDrive != INVALID_HANDLE_VALUE)
-		{
-			pDirectoryAltered = (DirectoryAltered_t *) malloc(sizeof(DirectoryAltered_t));
+	// Suppresses the error dialog that would otherwise be shown for a drive with no media.
+	SetThreadErrorMode(SEM_FAILCRITICALERRORS, nullptr);
+
+	wil::unique_hfile hDrive(CreateFile(drive.c_str(), FILE_LIST_DIRECTORY,
+		FILE_SHARE_READ | FILE_SHARE_DELETE | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING,
+		FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr));
 
-			StringCchCopy(
-				pDirectoryAltered->szPath, SIZEOF_ARRAY(pDirectoryAltered->szPath), szDrive);
-			pDirectoryAltered->shellTreeView = this;
+	if (!hDrive)
+	{
+		return std::nullopt;
+	}
 
-			iMonitorId = m_pDirMon->WatchDirectory(hDrive, szDrive, FILE_NOTIFY_CHANGE_DIR_NAME,
-				ShellTreeView::DirectoryAlteredCallback, TRUE, (void *) pDirectoryAltered);
+	DriveOpenResult result;
+	result.drive = drive;
+	result.handle = std::move(hDrive);
 
-			dbv.dbch_size = sizeof(dbv);
-			dbv.dbch_devicetype = DBT_DEVTYP_HANDLE;
-			dbv.dbch_handle = hDrive;
+	return result;
+}
 
-			/* Register to receive hardware events (i.e. insertion,
-			removal, etc) for the specified drive. */
-			hDevNotify = RegisterDeviceNotification(m_hTreeView, &dbv, DEVICE_NOTIFY_WINDOW_HANDLE);
+void ShellTreeView::ProcessDriveOpenResult(int driveOpenResultId)
+{
+	auto itr = m_driveOpenResults.find(driveOpenResultId);
 
-			/* If the handle was successfully registered, log the
-			drive path, handle and monitoring id. */
-			if (hDevNotify != nullptr)
-			{
-				StringCchCopy(de.szDrive, SIZEOF_ARRAY(de.szDrive), szDrive);
-				de.hDrive = hDrive;
-				de.iMonitorId = iMonitorId;
+	if (itr == m_driveOpenResults.end())
+	{
+		return;
+	}
 
-				m_pDriveList.push_back(de);
-			}
-		}
+	auto cleanup = wil::scope_exit([this, itr]() {
+		m_driveOpenResults.erase(itr);
+	});
+
+	auto result = itr->second.get();
+
+	if (!result)
+	{
+		return;
+	}
+
+	// The directory monitor takes ownership of the handle, though it's still used below to
+	// register for device notifications.
+	HANDLE hDrive = result->handle.release();
+
+	auto *pDirectoryAltered = (DirectoryAltered_t *) malloc(sizeof(DirectoryAltered_t));
+
+	StringCchCopy(
+		pDirectoryAltered->szPath, SIZEOF_ARRAY(pDirectoryAltered->szPath), result->drive.c_str());
+	pDirectoryAltered->shellTreeView = this;
+
+	int iMonitorId = m_pDirMon->WatchDirectory(hDrive, result->drive.c_str(),
+		FILE_NOTIFY_CHANGE_DIR_NAME, ShellTreeView::DirectoryAlteredCallback, TRUE,
+		(void *) pDirectoryAltered);
+
+	DEV_BROADCAST_HANDLE dbv;
+	dbv.dbch_size = sizeof(dbv);
+	dbv.dbch_devicetype = DBT_DEVTYP_HANDLE;
+	dbv.dbch_handle = hDrive;
+
+	/* Register to receive hardware events (i.e. insertion,
+	removal, etc) for the specified drive. */
+	HDEVNOTIFY hDevNotify =
+		RegisterDeviceNotification(m_hTreeView, &dbv, DEVICE_NOTIFY_WINDOW_HANDLE);
+
+	/* If the handle was successfully registered, log the
+	drive path, handle and monitoring id. */
+	if (hDevNotify != nullptr)
+	{
+		DriveEvent_t de;
+		StringCchCopy(de.szDrive, SIZEOF_ARRAY(de.szDrive), result->drive.c_str());
+		de.hDrive = hDrive;
+		de.iMonitorId = iMonitorId;
+
+		m_pDriveList.push_back(de);
 	}
 }
 
@@ -1654,79 +2257,104 @@ void ShellTreeView::SetShowHidden(BOOL bShowHidden)
 
 void ShellTreeView::RefreshAllIcons()
 {
-	auto hRoot = TreeView_GetRoot(m_hTreeView);
+	m_iconRefreshRequested = true;
+	SetTimer(m_hTreeView, ICON_REFRESH_TIMER_ID, ICON_REFRESH_TIMER_ELAPSE, nullptr);
+}
 
-	TVITEMEX tvItemEx;
-	tvItemEx.mask = TVIF_HANDLE | TVIF_PARAM;
-	tvItemEx.hItem = hRoot;
-	TreeView_GetItem(m_hTreeView, &tvItemEx);
+void ShellTreeView::OnIconRefreshTimer()
+{
+	if (m_iconRefreshRequested)
+	{
+		m_iconRefreshRequested = false;
+		StartIconRefresh();
+	}
 
-	const ItemInfo_t &itemInfo = m_itemInfoMap.at(static_cast<int>(tvItemEx.lParam));
+	if (m_restartIconRefreshWalk)
+	{
+		m_restartIconRefreshWalk = false;
+		m_iconRefreshStack.clear();
 
-	SHFILEINFO shfi;
-	SHGetFileInfo(reinterpret_cast<LPCTSTR>(itemInfo.pidl.get()), 0, &shfi, sizeof(shfi),
-		SHGFI_PIDL | SHGFI_SYSICONINDEX);
+		HTREEITEM root = TreeView_GetRoot(m_hTreeView);
 
-	tvItemEx.mask = TVIF_HANDLE | TVIF_IMAGE | TVIF_SELECTEDIMAGE;
-	tvItemEx.hItem = hRoot;
-	tvItemEx.iImage = shfi.iIcon;
-	tvItemEx.iSelectedImage = shfi.iIcon;
-	TreeView_SetItem(m_hTreeView, &tvItemEx);
+		if (root != nullptr)
+		{
+			m_iconRefreshStack.push_back(root);
+		}
+	}
 
-	RefreshAllIconsInternal(TreeView_GetChild(m_hTreeView, hRoot));
-}
+	auto sliceEnd = std::chrono::steady_clock::now() + ICON_REFRESH_SLICE_DURATION;
 
-void ShellTreeView::RefreshAllIconsInternal(HTREEITEM hFirstSibling)
-{
-	HTREEITEM hNextSibling;
-	HTREEITEM hChild;
-	TVITEM tvItem;
-	SHFILEINFO shfi;
+	while (!m_iconRefreshStack.empty() && m_iconResults.size() < ICON_REFRESH_MAX_PENDING_TASKS)
+	{
+		HTREEITEM item = m_iconRefreshStack.back();
+		m_iconRefreshStack.pop_back();
 
-	hNextSibling = TreeView_GetNextSibling(m_hTreeView, hFirstSibling);
+		for (HTREEITEM child = TreeView_GetChild(m_hTreeView, item); child != nullptr;
+			 child = TreeView_GetNextSibling(m_hTreeView, child))
+		{
+			m_iconRefreshStack.push_back(child);
+		}
 
-	tvItem.mask = TVIF_HANDLE | TVIF_PARAM;
-	tvItem.hItem = hFirstSibling;
-	TreeView_GetItem(m_hTreeView, &tvItem);
+		if (!m_iconRefreshedItems.contains(item))
+		{
+			RefreshItemIcon(item);
+		}
+
+		if (std::chrono::steady_clock::now() >= sliceEnd || IsInputWaiting())
+		{
+			break;
+		}
+	}
 
-	const ItemInfo_t &itemInfo = m_itemInfoMap[static_cast<int>(tvItem.lParam)];
-	SHGetFileInfo(reinterpret_cast<LPCTSTR>(itemInfo.pidl.get()), 0, &shfi, sizeof(shfi),
-		SHGFI_PIDL | SHGFI_SYSICONINDEX);
+	if (m_iconRefreshStack.empty())
+	{
+		KillTimer(m_hTreeView, ICON_REFRESH_TIMER_ID);
+		m_iconRefreshedItems.clear();
+	}
+}
 
-	tvItem.mask = TVIF_HANDLE | TVIF_IMAGE | TVIF_SELECTEDIMAGE;
-	tvItem.hItem = hFirstSibling;
-	tvItem.iImage = shfi.iIcon;
-	tvItem.iSelectedImage = shfi.iIcon;
-	TreeView_SetItem(m_hTreeView, &tvItem);
+// Any refresh that's already in progress is abandoned, since the icons it has retrieved may no
+// longer be valid. The items that are currently visible are queued straight away; the rest of the
+// tree is then walked in idle time.
+void ShellTreeView::StartIconRefresh()
+{
+	m_iconRefreshedItems.clear();
 
-	hChild = TreeView_GetChild(m_hTreeView, hFirstSibling);
+	HTREEITEM item = TreeView_GetFirstVisible(m_hTreeView);
 
-	if (hChild != nullptr)
-		RefreshAllIconsInternal(hChild);
+	// The count only includes items that are fully visible, so the item after those is included
+	// as well.
+	UINT numVisible = TreeView_GetVisibleCount(m_hTreeView) + 1;
 
-	while (hNextSibling != nullptr)
+	for (UINT i = 0; item != nullptr && i < numVisible; i++)
 	{
-		tvItem.mask = TVIF_HANDLE | TVIF_PARAM;
-		tvItem.hItem = hNextSibling;
-		TreeView_GetItem(m_hTreeView, &tvItem);
+		RefreshItemIcon(item);
+		item = TreeView_GetNextVisible(m_hTreeView, item);
+	}
 
-		const ItemInfo_t &itemInfoNext = m_itemInfoMap[static_cast<int>(tvItem.lParam)];
-		SHGetFileInfo(reinterpret_cast<LPCTSTR>(itemInfoNext.pidl.get()), 0, &shfi, sizeof(shfi),
-			SHGFI_PIDL | SHGFI_SYSICONINDEX);
+	m_restartIconRefreshWalk = true;
+}
 
-		tvItem.mask = TVIF_HANDLE | TVIF_IMAGE | TVIF_SELECTEDIMAGE;
-		tvItem.hItem = hNextSibling;
-		tvItem.iImage = shfi.iIcon;
-		tvItem.iSelectedImage = shfi.iIcon;
-		TreeView_SetItem(m_hTreeView, &tvItem);
+void ShellTreeView::RefreshItemIcon(HTREEITEM item)
+{
+	m_iconRefreshedItems.insert(item);
+
+	if (IsLoadingPlaceholder(item))
+	{
+		return;
+	}
 
-		hChild = TreeView_GetChild(m_hTreeView, hNextSibling);
+	TVITEM tvItem;
+	tvItem.mask = TVIF_HANDLE | TVIF_PARAM;
+	tvItem.hItem = item;
+	TreeView_GetItem(m_hTreeView, &tvItem);
 
-		if (hChild != nullptr)
-			RefreshAllIconsInternal(hChild);
+	QueueIconTask(item, static_cast<int>(tvItem.lParam));
+}
 
-		hNextSibling = TreeView_GetNextSibling(m_hTreeView, hNextSibling);
-	}
+bool ShellTreeView::IsInputWaiting()
+{
+	return HIWORD(GetQueueStatus(QS_INPUT)) != 0;
 }
 
 HRESULT ShellTreeView::OnBeginDrag(int iItemId)
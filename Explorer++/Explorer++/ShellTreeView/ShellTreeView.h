@@ -12,10 +12,16 @@
 #include "../ThirdParty/CTPL/cpl_stl.h"
 #include <boost/signals2.hpp>
 #include <wil/com.h>
+#include <wil/resource.h>
+#include <chrono>
+#include <functional>
 #include <optional>
+#include <stop_token>
+#include <unordered_set>
 
 class CachedIcons;
 struct Config;
+struct DriveChange;
 class FileActionHandler;
 __interface IExplorerplusplus;
 class TabContainer;
@@ -30,13 +36,20 @@ public:
 	/* User functions. */
 	unique_pidl_absolute GetItemPidl(HTREEITEM hTreeItem) const;
 	HTREEITEM LocateItem(PCIDLIST_ABSOLUTE pidlDirectory);
+	void LocateItemAsync(
+		PCIDLIST_ABSOLUTE pidlDirectory, std::function<void(HTREEITEM item)> callback);
+	void CancelLocateItemAsync();
 	void SetShowHidden(BOOL bShowHidden);
-	void RefreshAllIcons();
 
-	/* Sorting. */
-	int CALLBACK CompareItems(LPARAM lParam1, LPARAM lParam2);
+	// Retrieves the icon for every item again (e.g. after the system image list has been rebuilt).
+	// The refresh is performed incrementally, once control has returned to the message loop, so
+	// several calls in quick succession only result in a single refresh.
+	void RefreshAllIcons();
+	bool IsLoadingPlaceholder(HTREEITEM item) const;
 
-	void MonitorDrivePublic(const TCHAR *szDrive);
+	// Drives are opened (and then monitored) in the background, so changes made before this
+	// returns false may not be reflected in the tree.
+	bool IsOpeningDrives() const;
 
 	void StartRenamingSelectedItem();
 	void ShowPropertiesOfSelectedItem() const;
@@ -51,6 +64,19 @@ private:
 
 	static const UINT WM_APP_ICON_RESULT_READY = WM_APP + 1;
 	static const UINT WM_APP_SUBFOLDERS_RESULT_READY = WM_APP + 2;
+	static const UINT WM_APP_EXPANSION_RESULTS_READY = WM_APP + 3;
+	static const UINT WM_APP_DRIVE_OPEN_RESULT_READY = WM_APP + 4;
+
+	// Drives are opened for monitoring in the background, since a removable or sleeping drive can
+	// take several seconds to respond. Each drive is opened by its own task, so that a drive that's
+	// slow to respond only delays the monitoring of that drive.
+	static const int DRIVE_OPEN_THREADS = 4;
+
+	// When a folder is expanded, its children are enumerated in the background and inserted in
+	// batches. A batch is sent once it contains this many items, or once this much time has passed
+	// since the last batch was sent.
+	static const size_t EXPANSION_BATCH_SIZE = 200;
+	static constexpr auto EXPANSION_BATCH_INTERVAL = std::chrono::milliseconds(100);
 
 	// This is the same background color as used in the Explorer treeview.
 	static inline constexpr COLORREF TREE_VIEW_DARK_MODE_BACKGROUND_COLOR = RGB(25, 25, 25);
@@ -61,6 +87,14 @@ private:
 	static const UINT DROP_EXPAND_TIMER_ID = 2;
 	static const UINT DROP_EXPAND_TIMER_ELAPSE = 800;
 
+	// When refreshing icons, the items that aren't visible are walked on this timer, for at most
+	// the slice duration at a time. No further items are queued while the icon thread pool has
+	// this many tasks outstanding, so that icons for newly visible items aren't held up.
+	static const UINT ICON_REFRESH_TIMER_ID = 3;
+	static const UINT ICON_REFRESH_TIMER_ELAPSE = USER_TIMER_MINIMUM;
+	static constexpr auto ICON_REFRESH_SLICE_DURATION = std::chrono::milliseconds(8);
+	static const size_t ICON_REFRESH_MAX_PENDING_TASKS = 64;
+
 	static const LONG DROP_SCROLL_MARGIN_X_96DPI = 10;
 	static const LONG DROP_SCROLL_MARGIN_Y_96DPI = 10;
 
@@ -70,11 +104,61 @@ private:
 		unique_pidl_child pridl;
 	} ItemInfo_t;
 
-	typedef struct
+	// Children are shown in this order, with the items in each category sorted by name.
+	enum class ChildCategory
 	{
-		int internalIndex;
+		Drive,
+		Virtual,
+		FileSystem
+	};
+
+	struct ChildSortKey
+	{
+		ChildCategory category;
+
+		// For drives, this is the parsing name; for other items, it's the in-folder name.
 		std::wstring name;
-	} EnumeratedItem;
+	};
+
+	struct EnumeratedChild
+	{
+		unique_pidl_child pidl;
+		std::wstring displayName;
+		std::wstring parsingPath;
+		ChildSortKey sortKey;
+	};
+
+	struct ExpansionResults
+	{
+		int expansionId;
+		HTREEITEM parentItem;
+		std::vector<EnumeratedChild> children;
+		bool finished;
+	};
+
+	struct InsertedChild
+	{
+		ChildSortKey sortKey;
+		HTREEITEM item;
+	};
+
+	// An item being located by LocateItemAsync(). The callback is only invoked if the item is
+	// found.
+	struct PendingLocate
+	{
+		unique_pidl_absolute pidl;
+		std::function<void(HTREEITEM item)> callback;
+	};
+
+	struct PendingExpansion
+	{
+		int expansionId;
+		HTREEITEM placeholderItem;
+		std::stop_source stopSource;
+
+		// The children that have been inserted so far, in the order they appear in the treeview.
+		std::vector<InsertedChild> insertedChildren;
+	};
 
 	typedef struct
 	{
@@ -82,6 +166,23 @@ private:
 		DWORD dwAction;
 	} AlteredFile_t;
 
+	// Changes are collected as each batch of directory modification notifications is processed, so
+	// that they can be applied once per parent folder.
+	struct DirectoryModificationBatch
+	{
+		// Folders that have been created, grouped by the path of their parent folder.
+		std::unordered_map<std::wstring, std::vector<std::wstring>> addedItems;
+
+		// Folders that have had children removed, whose child count may need to be updated.
+		std::unordered_set<std::wstring> updatedParents;
+	};
+
+	struct AddedItem
+	{
+		std::wstring path;
+		unique_pidl_absolute pidl;
+	};
+
 	struct BasicItemInfo
 	{
 		BasicItemInfo() = default;
@@ -120,6 +221,12 @@ private:
 		int iMonitorId;
 	} DriveEvent_t;
 
+	struct DriveOpenResult
+	{
+		std::wstring drive;
+		wil::unique_hfile handle;
+	};
+
 	static HWND CreateTreeView(HWND parent);
 
 	static LRESULT CALLBACK TreeViewProcStub(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam,
@@ -131,11 +238,24 @@ private:
 	LRESULT CALLBACK ParentWndProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
 
 	HRESULT ExpandDirectory(HTREEITEM hParent);
-	void DirectoryModified(DWORD dwAction, const TCHAR *szFullFileName);
+	void ExpandItemSynchronously(HTREEITEM item);
+	SHCONTF GetChildEnumerationFlags() const;
+	static HRESULT EnumerateChildren(PCIDLIST_ABSOLUTE pidlDirectory, SHCONTF enumFlags,
+		bool checkPinnedToNamespaceTree, std::function<bool(EnumeratedChild child)> callback);
+	static ChildSortKey GetChildSortKey(
+		PCIDLIST_ABSOLUTE pidlComplete, const std::wstring &parsingName);
+	static bool IsChildSortedBefore(
+		const ChildSortKey &key1, const ChildSortKey &key2, bool useNaturalSortOrder);
+	HTREEITEM InsertChild(HTREEITEM parentItem, HTREEITEM insertAfter, EnumeratedChild &child);
+	void InsertChildrenSorted(HTREEITEM parentItem, std::vector<EnumeratedChild> children);
+	void DirectoryModified(const std::wstring &directory,
+		const std::vector<DirectoryChange> &changes, bool overflowed);
 	void DirectoryAltered();
 	HTREEITEM AddRoot();
 	void AddItem(const TCHAR *szFullFileName);
 	void AddItemInternal(HTREEITEM hParent, const TCHAR *szFullFileName);
+	void AddItems(const std::wstring &parentPath, const std::vector<std::wstring> &itemPaths);
+	void AddItemsInternal(HTREEITEM hParent, const std::vector<AddedItem> &items);
 	void AddDrive(const TCHAR *szDrive);
 	void RenameItem(HTREEITEM hItem, const TCHAR *szFullFileName);
 	void RemoveItem(const TCHAR *szFullFileName);
@@ -144,6 +264,7 @@ private:
 	void UpdateParent(const TCHAR *szParent);
 	void UpdateParent(HTREEITEM hParent);
 	LRESULT CALLBACK OnDeviceChange(WPARAM wParam, LPARAM lParam);
+	void OnDriveChanged(const DriveChange &change);
 	void OnGetDisplayInfo(NMTVDISPINFO *pnmtvdi);
 	void OnItemExpanding(const NMTREEVIEW *nmtv);
 	LRESULT OnKeyDown(const NMTVKEYDOWN *keyDown);
@@ -159,19 +280,23 @@ private:
 	void UpdateCurrentClipboardObject(wil::com_ptr_nothrow<IDataObject> clipboardDataObject);
 	void OnClipboardUpdate();
 
-	static void DirectoryAlteredCallback(const TCHAR *szFileName, DWORD dwAction, void *pData);
+	static void DirectoryAlteredCallback(
+		const std::vector<DirectoryChange> &changes, bool overflowed, void *pData);
 
 	unique_pidl_absolute GetSelectedItemPidl() const;
 
 	/* Directory modification. */
-	void DirectoryAlteredAddFile(const TCHAR *szFullFileName);
-	void DirectoryAlteredRemoveFile(const TCHAR *szFullFileName);
+	void DirectoryAlteredAddFile(const TCHAR *szFullFileName, DirectoryModificationBatch &batch);
+	void DirectoryAlteredRemoveFile(const TCHAR *szFullFileName, DirectoryModificationBatch &batch);
+	void ApplyAddedItems(DirectoryModificationBatch &batch);
+	void ApplyParentUpdates(DirectoryModificationBatch &batch);
 	void DirectoryAlteredRenameFile(const TCHAR *szFullFileName);
+	void RescanItem(HTREEITEM item);
 
 	/* Icons. */
 	void QueueIconTask(HTREEITEM item, int internalIndex);
-	static std::optional<IconResult> FindIconAsync(
-		HWND treeView, int iconResultId, HTREEITEM item, int internalIndex, PCIDLIST_ABSOLUTE pidl);
+	static std::optional<IconResult> FindIconAsync(HWND treeView, int iconResultId,
+		HTREEITEM item, int internalIndex, PCIDLIST_ABSOLUTE pidl, CachedIcons *cachedIcons);
 	void ProcessIconResult(int iconResultId);
 	std::optional<int> GetCachedIconIndex(const ItemInfo_t &itemInfo);
 
@@ -180,6 +305,20 @@ private:
 		HWND treeView, int subfoldersResultId, HTREEITEM item, PCIDLIST_ABSOLUTE pidl);
 	void ProcessSubfoldersResult(int subfoldersResultId);
 
+	/* Asynchronous expansion. */
+	void StartExpansion(HTREEITEM parentItem);
+	static void EnumerateChildrenAsync(HWND treeView, int expansionId, HTREEITEM parentItem,
+		PCIDLIST_ABSOLUTE pidlDirectory, SHCONTF enumFlags, bool checkPinnedToNamespaceTree,
+		bool useNaturalSortOrder, std::stop_token stopToken);
+	static void CacheSubfolderState(PCIDLIST_ABSOLUTE pidlDirectory, SHCONTF enumFlags,
+		bool checkPinnedToNamespaceTree, bool anyChildren);
+	static void PostExpansionResults(HWND treeView, int expansionId, HTREEITEM parentItem,
+		std::vector<EnumeratedChild> children, bool finished);
+	void ProcessExpansionResults(std::unique_ptr<ExpansionResults> results);
+	void FinishExpansion(HTREEITEM parentItem);
+	void CancelExpansion(HTREEITEM parentItem);
+	bool IsExpansionPending(HTREEITEM item) const;
+
 	/* Item id's. */
 	int GenerateUniqueItemId();
 
@@ -202,12 +341,34 @@ private:
 	HRESULT OnBeginDrag(int iItemId);
 
 	/* Icon refresh. */
-	void RefreshAllIconsInternal(HTREEITEM hFirstSibling);
+	void OnIconRefreshTimer();
+	void StartIconRefresh();
+	void RefreshItemIcon(HTREEITEM item);
+	static bool IsInputWaiting();
 
 	HTREEITEM LocateExistingItem(const TCHAR *szParsingPath);
 	HTREEITEM LocateExistingItem(PCIDLIST_ABSOLUTE pidlDirectory);
 	HTREEITEM LocateItemInternal(PCIDLIST_ABSOLUTE pidlDirectory, BOOL bOnlyLocateExistingItem);
+	HTREEITEM LocateChildItem(HTREEITEM parentItem, PCIDLIST_ABSOLUTE pidlDescendant);
+	HTREEITEM FindIndexedChildItem(HTREEITEM parentItem, PCIDLIST_ABSOLUTE pidlDescendant);
+	void ContinueLocatingItem();
+	HTREEITEM LocateMyComputerItem();
+
+	/* Path index. */
+	void AddToPathIndex(HTREEITEM item, const std::wstring &parsingPath);
+	void AddToPathIndex(HTREEITEM item, PCIDLIST_ABSOLUTE pidl);
+	void RemoveFromPathIndex(HTREEITEM item);
+	HTREEITEM FindIndexedItem(PCIDLIST_ABSOLUTE pidl, HTREEITEM parentItem = nullptr);
+	HTREEITEM FindIndexedItemByPath(
+		const std::wstring &parsingPath, HTREEITEM ancestorItem = nullptr);
+	bool HasChildWithPath(HTREEITEM parentItem, const std::wstring &parsingPath) const;
+	bool IsAncestor(HTREEITEM ancestorItem, HTREEITEM item) const;
+	static std::wstring GetPathIndexKey(const std::wstring &path);
+	void MonitorAllDrives();
 	void MonitorDrive(const TCHAR *szDrive);
+	static std::optional<DriveOpenResult> OpenDriveAsync(
+		HWND treeView, int driveOpenResultId, const std::wstring &drive);
+	void ProcessDriveOpenResult(int driveOpenResultId);
 	HTREEITEM DetermineDriveSortedPosition(HTREEITEM hParent, const TCHAR *szItemName);
 	HTREEITEM DetermineItemSortedPosition(HTREEITEM hParent, const TCHAR *szItem);
 	BOOL IsDesktop(const TCHAR *szPath);
@@ -222,6 +383,7 @@ private:
 	std::vector<std::unique_ptr<WindowSubclassWrapper>> m_windowSubclasses;
 	std::vector<boost::signals2::scoped_connection> m_connections;
 	const Config *m_config;
+	const HINSTANCE m_hResourceModule;
 	TabContainer *m_tabContainer;
 	FileActionHandler *m_fileActionHandler;
 
@@ -229,13 +391,39 @@ private:
 	std::unordered_map<int, std::future<std::optional<IconResult>>> m_iconResults;
 	int m_iconResultIDCounter;
 
+	// The state of the icon refresh in progress. Items still to be walked are held on the stack;
+	// if any item is deleted while the refresh is in progress, the walk restarts from the root,
+	// skipping items that have already been refreshed.
+	bool m_iconRefreshRequested = false;
+	bool m_restartIconRefreshWalk = false;
+	std::vector<HTREEITEM> m_iconRefreshStack;
+	std::unordered_set<HTREEITEM> m_iconRefreshedItems;
+
 	ctpl::thread_pool m_subfoldersThreadPool;
 	std::unordered_map<int, std::future<std::optional<SubfoldersResult>>> m_subfoldersResults;
 	int m_subfoldersResultIDCounter;
 
+	ctpl::thread_pool m_expansionThreadPool;
+	std::unordered_map<HTREEITEM, PendingExpansion> m_pendingExpansions;
+	int m_expansionIDCounter;
+
+	// Set while an item is being expanded by ExpandItemSynchronously(). Other expansions (e.g.
+	// those initiated by the user) are run in the background.
+	bool m_expandSynchronously;
+
+	// Only a single item is located asynchronously at a time. Locating another item replaces this.
+	std::optional<PendingLocate> m_pendingLocate;
+
 	/* Item id's and info. */
 	std::unordered_map<int, ItemInfo_t> m_itemInfoMap;
 	int m_itemIDCounter;
+
+	// Maps the parsing path of each item to the item, so that items can be located without walking
+	// the tree. A path can be shown more than once (e.g. a folder on the desktop appears both
+	// directly under the desktop and under its file system location).
+	std::unordered_multimap<std::wstring, HTREEITEM> m_itemsByParsingPath;
+	std::unordered_map<HTREEITEM, std::wstring> m_parsingPathsByItem;
+
 	CachedIcons *m_cachedIcons;
 
 	int m_iFolderIcon;
@@ -254,10 +442,21 @@ private:
 	/* Directory modification. */
 	std::list<AlteredFile_t> m_AlteredList;
 	std::list<AlteredFile_t> m_AlteredTrackingList;
+
+	// Directories for which more changes occurred than could be recorded. Any items shown for
+	// these directories will be rescanned.
+	std::vector<std::wstring> m_rescanPaths;
 	CRITICAL_SECTION m_cs;
+
+	// Set while the directory modified timer is running. The timer isn't restarted by each
+	// notification, so that a steady stream of changes can't postpone the update indefinitely.
+	bool m_directoryModifiedTimerPending;
 	TCHAR m_szAlteredOldFileName[MAX_PATH];
 
 	/* Hardware events. */
+	ctpl::thread_pool m_driveOpenThreadPool;
+	std::unordered_map<int, std::future<std::optional<DriveOpenResult>>> m_driveOpenResults;
+	int m_driveOpenResultIDCounter;
 	std::list<DriveEvent_t> m_pDriveList;
 	BOOL m_bQueryRemoveCompleted;
 	TCHAR m_szQueryRemove[MAX_PATH];
@@ -308,6 +308,12 @@ UINT SortMenuBuilder::GetSortMenuItemStringIndex(UINT uItemId)
 	case IDM_SORTBY_MEDIA_YEAR:
 		return IDS_COLUMN_NAME_YEAR;
 
+	case IDM_SORTBY_CHECKSUM:
+		return IDS_COLUMN_NAME_CHECKSUM;
+
+	case IDM_SORTBY_RELATIVEPATH:
+		return IDS_COLUMN_NAME_RELATIVEPATH;
+
 	default:
 		assert(false);
 		break;
@@ -506,6 +512,12 @@ int SortMenuBuilder::DetermineSortModeMenuId(SortMode sortMode)
 	case SortMode::MediaYear:
 		return IDM_SORTBY_MEDIA_YEAR;
 
+	case SortMode::Checksum:
+		return IDM_SORTBY_CHECKSUM;
+
+	case SortMode::RelativePath:
+		return IDM_SORTBY_RELATIVEPATH;
+
 	default:
 		assert(false);
 		break;
@@ -704,6 +716,12 @@ int SortMenuBuilder::DetermineGroupModeMenuId(SortMode sortMode)
 	case SortMode::MediaYear:
 		return IDM_GROUPBY_MEDIA_YEAR;
 
+	case SortMode::Checksum:
+		return IDM_GROUPBY_CHECKSUM;
+
+	case SortMode::RelativePath:
+		return IDM_GROUPBY_RELATIVEPATH;
+
 	default:
 		assert(false);
 		break;
@@ -9,16 +9,23 @@
 #include "IconResourceLoader.h"
 #include "MainResource.h"
 #include "ResourceHelper.h"
+#include "../Helper/Controls.h"
+#include "../Helper/Crc32.h"
+#include "../Helper/DriveInfo.h"
 #include "../Helper/FileOperations.h"
 #include "../Helper/Helper.h"
 #include "../Helper/Macros.h"
 #include "../Helper/RegistrySettings.h"
 #include "../Helper/ShellHelper.h"
 #include "../Helper/StringHelper.h"
+#include "../Helper/ThreadQos.h"
+#include "../Helper/UnbufferedIo.h"
 #include "../Helper/WindowHelper.h"
 #include "../Helper/XMLSettings.h"
 #include <wil/resource.h>
 #include <comdef.h>
+#include <deque>
+#include <iomanip>
 #include <unordered_map>
 
 namespace NSplitFileDialog
@@ -29,6 +36,7 @@ namespace NSplitFileDialog
 	const int WM_APP_INPUTFILEINVALID = WM_APP + 4;
 
 	const TCHAR COUNTER_PATTERN[] = _T("/N");
+	const TCHAR CHECKSUM_FILE_EXTENSION[] = _T(".sfv");
 
 	DWORD WINAPI SplitFileThreadProcStub(LPVOID pParam);
 }
@@ -37,6 +45,8 @@ const TCHAR SplitFileDialogPersistentSettings::SETTINGS_KEY[] = _T("SplitFile");
 
 const TCHAR SplitFileDialogPersistentSettings::SETTING_SIZE[] = _T("Size");
 const TCHAR SplitFileDialogPersistentSettings::SETTING_SIZE_GROUP[] = _T("SizeGroup");
+const TCHAR SplitFileDialogPersistentSettings::SETTING_CREATE_CHECKSUM_FILE[] =
+	_T("CreateChecksumFile");
 
 SplitFileDialog::SplitFileDialog(HINSTANCE hInstance, HWND hParent, IExplorerplusplus *expp,
 	const std::wstring &strFullFilename) :
@@ -46,7 +56,8 @@ SplitFileDialog::SplitFileDialog(HINSTANCE hInstance, HWND hParent, IExplorerplu
 	m_bSplittingFile(false),
 	m_bStopSplitting(false),
 	m_CurrentError(ErrorType::None),
-	m_pSplitFile(nullptr)
+	m_pSplitFile(nullptr),
+	m_lastBytesProcessed(0)
 {
 	m_persistentSettings = &SplitFileDialogPersistentSettings::GetInstance();
 }
@@ -151,9 +162,13 @@ INT_PTR SplitFileDialog::OnInitDialog()
 	SendDlgItemMessage(m_hDlg, IDC_SPLIT_STATIC_FILENAMEHELPER, WM_SETFONT,
 		reinterpret_cast<WPARAM>(m_hHelperTextFont), MAKEWORD(TRUE, 0));
 
+	lCheckDlgButton(
+		m_hDlg, IDC_SPLIT_CHECK_CHECKSUM, m_persistentSettings->m_bCreateChecksumFile);
+
 	SetDlgItemText(m_hDlg, IDC_SPLIT_STATIC_ELAPSEDTIME, _T("00:00:00"));
 
 	AllowDarkModeForControls({ IDC_SPLIT_BUTTON_OUTPUT });
+	AllowDarkModeForCheckboxes({ IDC_SPLIT_CHECK_CHECKSUM });
 	AllowDarkModeForGroupBoxes({ IDC_GROUP_FILE_INFORMATION, IDC_GROUP_SPLIT_INFORMATION });
 	AllowDarkModeForComboBoxes({ IDC_SPLIT_COMBOBOX_SIZES });
 
@@ -179,6 +194,22 @@ INT_PTR SplitFileDialog::OnTimer(int iTimerID)
 		StringCchPrintf(szElapsedTime, SIZEOF_ARRAY(szElapsedTime), _T("%02d:%02d:%02d"),
 			m_uElapsedTime / 3600, (m_uElapsedTime / 60) % 60, m_uElapsedTime % 60);
 		SetDlgItemText(m_hDlg, IDC_SPLIT_STATIC_ELAPSEDTIME, szElapsedTime);
+
+		/* The timer fires once a second, so the amount of data
+		processed since the last tick gives the current speed. */
+		if (m_pSplitFile != nullptr)
+		{
+			ULONGLONG bytesProcessed = m_pSplitFile->GetBytesProcessed();
+
+			ULARGE_INTEGER speed;
+			speed.QuadPart = bytesProcessed - m_lastBytesProcessed;
+			m_lastBytesProcessed = bytesProcessed;
+
+			TCHAR szSpeed[32];
+			FormatSizeString(speed, szSpeed, SIZEOF_ARRAY(szSpeed));
+			StringCchCat(szSpeed, SIZEOF_ARRAY(szSpeed), _T("/s"));
+			SetDlgItemText(m_hDlg, IDC_SPLIT_STATIC_SPEED, szSpeed);
+		}
 	}
 
 	return 0;
@@ -282,6 +313,8 @@ void SplitFileDialog::SaveState()
 	m_persistentSettings->m_strSplitSize = GetWindowString(GetDlgItem(m_hDlg, IDC_SPLIT_EDIT_SIZE));
 	m_persistentSettings->m_strSplitGroup =
 		GetWindowString(GetDlgItem(m_hDlg, IDC_SPLIT_COMBOBOX_SIZES));
+	m_persistentSettings->m_bCreateChecksumFile =
+		IsDlgButtonChecked(m_hDlg, IDC_SPLIT_CHECK_CHECKSUM) == BST_CHECKED;
 
 	m_persistentSettings->m_bStateSaved = TRUE;
 }
@@ -434,8 +467,11 @@ void SplitFileDialog::OnOk()
 			}
 		}
 
-		m_pSplitFile = new SplitFile(
-			m_hDlg, m_strFullFilename, strOutputFilename, strOutputDirectory, uSplitSize);
+		bool createChecksumFile =
+			(IsDlgButtonChecked(m_hDlg, IDC_SPLIT_CHECK_CHECKSUM) == BST_CHECKED);
+
+		m_pSplitFile = new SplitFile(m_hDlg, m_strFullFilename, strOutputFilename,
+			strOutputDirectory, uSplitSize, createChecksumFile);
 
 		GetDlgItemText(m_hDlg, IDOK, m_szOk, SIZEOF_ARRAY(m_szOk));
 
@@ -446,6 +482,8 @@ void SplitFileDialog::OnOk()
 		m_bSplittingFile = true;
 
 		m_uElapsedTime = 0;
+		m_lastBytesProcessed = 0;
+		SetDlgItemText(m_hDlg, IDC_SPLIT_STATIC_SPEED, EMPTY_STRING);
 		SetTimer(m_hDlg, ELPASED_TIMER_ID, ELPASED_TIMER_TIMEOUT, nullptr);
 
 		LoadString(GetInstance(), IDS_SPLITFILEDIALOG_SPLITTING, szTemp, SIZEOF_ARRAY(szTemp));
@@ -453,7 +491,6 @@ void SplitFileDialog::OnOk()
 
 		HANDLE hThread = CreateThread(nullptr, 0, NSplitFileDialog::SplitFileThreadProcStub,
 			reinterpret_cast<LPVOID>(m_pSplitFile), 0, nullptr);
-		SetThreadPriority(hThread, THREAD_PRIORITY_LOWEST);
 		CloseHandle(hThread);
 	}
 	else
@@ -539,20 +576,45 @@ DWORD WINAPI NSplitFileDialog::SplitFileThreadProcStub(LPVOID pParam)
 {
 	assert(pParam != nullptr);
 
+	// Unlike a lower thread priority, this also lowers the priority of the thread's I/O.
+	SetCurrentThreadTaskClass(TaskClass::Bulk);
+
 	auto *pSplitFile = reinterpret_cast<SplitFile *>(pParam);
 	pSplitFile->Split();
 
 	return 0;
 }
 
+struct SplitFile::ReadBuffer
+{
+	wil::unique_virtualalloc_ptr<std::byte> data;
+	OverlappedOperation operation;
+};
+
+struct SplitFile::OutputPart
+{
+	int partNumber;
+	std::wstring filename;
+	wil::unique_hfile file;
+	std::unique_ptr<UnbufferedFileWriter> writer;
+
+	/* The amount of data still to be written to this part. */
+	ULONGLONG remaining;
+
+	Crc32 checksum;
+};
+
 SplitFile::SplitFile(HWND hDlg, const std::wstring &strFullFilename,
-	const std::wstring &strOutputFilename, const std::wstring &strOutputDirectory, UINT uSplitSize)
+	const std::wstring &strOutputFilename, const std::wstring &strOutputDirectory, UINT uSplitSize,
+	bool createChecksumFile) :
+	m_bytesProcessed(0)
 {
 	m_hDlg = hDlg;
 	m_strFullFilename = strFullFilename;
 	m_strOutputFilename = strOutputFilename;
 	m_strOutputDirectory = strOutputDirectory;
 	m_uSplitSize = uSplitSize;
+	m_createChecksumFile = createChecksumFile;
 
 	m_bStopSplitting = false;
 
@@ -566,17 +628,18 @@ SplitFile::~SplitFile()
 
 void SplitFile::Split()
 {
-	HANDLE hInputFile = CreateFile(m_strFullFilename.c_str(), GENERIC_READ, FILE_SHARE_READ,
-		nullptr, OPEN_EXISTING, 0, nullptr);
+	wil::unique_hfile inputFile(CreateFile(m_strFullFilename.c_str(), GENERIC_READ,
+		FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_FLAG_NO_BUFFERING | FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
 
-	if (hInputFile == INVALID_HANDLE_VALUE)
+	if (!inputFile)
 	{
 		PostMessage(m_hDlg, NSplitFileDialog::WM_APP_INPUTFILEINVALID, 0, 0);
 		return;
 	}
 
 	LARGE_INTEGER lFileSize;
-	GetFileSizeEx(hInputFile, &lFileSize);
+	GetFileSizeEx(inputFile.get(), &lFileSize);
 
 	LONGLONG nSplits = lFileSize.QuadPart / m_uSplitSize;
 
@@ -588,58 +651,242 @@ void SplitFile::Split()
 	PostMessage(
 		m_hDlg, NSplitFileDialog::WM_APP_SETTOTALSPLITCOUNT, static_cast<WPARAM>(nSplits), 0);
 
-	SplitInternal(hInputFile, lFileSize);
+	SplitInternal(inputFile.get(), lFileSize);
 
-	CloseHandle(hInputFile);
+	inputFile.reset();
+
+	if (m_createChecksumFile && !ShouldStopSplitting())
+	{
+		WriteChecksumFile();
+	}
 
 	SendMessage(m_hDlg, NSplitFileDialog::WM_APP_SPLITFINISHED, 0, 0);
 }
 
+/* The input file is read once, through a ring of buffers. Several
+reads are kept in flight, so that the device is never idle while
+data is being handed off to the output files. Each output part
+has its own set of buffers, with writes issued in the background.
+Once all the data for a part has been queued, the part remains
+open (with its writes still in progress) while later parts are
+being written, up to a limit. */
 void SplitFile::SplitInternal(HANDLE hInputFile, const LARGE_INTEGER &lFileSize)
 {
-	LARGE_INTEGER lRunningSplitSize = { 0 };
+	ULONGLONG fileSize = lFileSize.QuadPart;
+	size_t readBufferSize = GetStorageInfo(m_strFullFilename).ioSettings.bufferSize;
 
-	char *pBuffer = new char[m_uSplitSize];
-	bool bStop = false;
-	int nSplitsMade = 1;
+	std::vector<std::unique_ptr<ReadBuffer>> readBuffers;
 
-	while (lRunningSplitSize.QuadPart < lFileSize.QuadPart && !bStop)
+	for (int i = 0; i < NUM_READ_BUFFERS; i++)
 	{
-		DWORD dwNumberOfBytesRead;
-		ReadFile(hInputFile, reinterpret_cast<LPVOID>(pBuffer), m_uSplitSize, &dwNumberOfBytesRead,
-			nullptr);
+		auto readBuffer = std::make_unique<ReadBuffer>();
+		readBuffer->data = AllocateUnbufferedIoBuffer(readBufferSize);
 
-		std::wstring strOutputFullFilename;
-		ProcessFilename(nSplitsMade, strOutputFullFilename);
+		if (!readBuffer->data)
+		{
+			return;
+		}
 
-		HANDLE hOutputFile = CreateFile(strOutputFullFilename.c_str(), GENERIC_WRITE, 0, nullptr,
-			CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
+		readBuffers.push_back(std::move(readBuffer));
+	}
 
-		if (hOutputFile != INVALID_HANDLE_VALUE)
+	ULONGLONG nextReadOffset = 0;
+
+	auto startNextRead =
+		[hInputFile, fileSize, readBufferSize, &nextReadOffset](ReadBuffer &readBuffer)
+	{
+		if (nextReadOffset >= fileSize)
 		{
-			DWORD dwNumberOfBytesWritten;
-			WriteFile(hOutputFile, reinterpret_cast<LPCVOID>(pBuffer), dwNumberOfBytesRead,
-				&dwNumberOfBytesWritten, nullptr);
+			return true;
+		}
+
+		bool res = readBuffer.operation.StartRead(hInputFile, readBuffer.data.get(),
+			static_cast<DWORD>(readBufferSize), nextReadOffset);
+		nextReadOffset += readBufferSize;
 
-			CloseHandle(hOutputFile);
+		return res;
+	};
+
+	for (auto &readBuffer : readBuffers)
+	{
+		if (!startNextRead(*readBuffer))
+		{
+			return;
 		}
+	}
 
-		/* TODO: Wait for a set period of time before sending message
-		(so as not to block the GUI). */
-		PostMessage(m_hDlg, NSplitFileDialog::WM_APP_SETCURRENTSPLITCOUNT, nSplitsMade, 0);
+	std::unique_ptr<OutputPart> currentPart;
+	std::deque<std::unique_ptr<OutputPart>> pendingParts;
+	int nSplitsMade = 1;
+	ULONGLONG bytesProcessed = 0;
+	size_t currentReadBuffer = 0;
 
-		lRunningSplitSize.QuadPart += dwNumberOfBytesRead;
-		nSplitsMade++;
+	while (bytesProcessed < fileSize && !ShouldStopSplitting())
+	{
+		auto &readBuffer = *readBuffers[currentReadBuffer];
+		auto numBytesRead = readBuffer.operation.Wait();
 
-		EnterCriticalSection(&m_csStop);
-		if (m_bStopSplitting)
+		if (!numBytesRead || *numBytesRead == 0)
 		{
-			bStop = true;
+			break;
 		}
-		LeaveCriticalSection(&m_csStop);
+
+		std::span<const std::byte> data(readBuffer.data.get(), *numBytesRead);
+
+		while (!data.empty())
+		{
+			if (!currentPart)
+			{
+				currentPart = CreateOutputPart(nSplitsMade,
+					(std::min)(static_cast<ULONGLONG>(m_uSplitSize), fileSize - bytesProcessed));
+				nSplitsMade++;
+			}
+
+			auto amount = static_cast<size_t>(
+				(std::min)(static_cast<ULONGLONG>(data.size()), currentPart->remaining));
+			auto partData = data.first(amount);
+
+			if (currentPart->writer)
+			{
+				currentPart->writer->Write(partData);
+			}
+
+			if (m_createChecksumFile)
+			{
+				currentPart->checksum.Update(partData.data(), partData.size());
+			}
+
+			currentPart->remaining -= amount;
+			bytesProcessed += amount;
+			data = data.subspan(amount);
+
+			if (currentPart->remaining == 0)
+			{
+				pendingParts.push_back(std::move(currentPart));
+
+				if (pendingParts.size() > MAX_PENDING_PARTS)
+				{
+					FinishOutputPart(*pendingParts.front());
+					pendingParts.pop_front();
+				}
+			}
+		}
+
+		m_bytesProcessed = bytesProcessed;
+
+		if (!startNextRead(readBuffer))
+		{
+			break;
+		}
+
+		currentReadBuffer = (currentReadBuffer + 1) % readBuffers.size();
 	}
 
-	delete[] pBuffer;
+	/* If splitting was stopped, or the file couldn't be read in its
+	entirety, the last part will be incomplete. As before, whatever
+	data was read is kept. */
+	if (currentPart)
+	{
+		pendingParts.push_back(std::move(currentPart));
+	}
+
+	for (auto &part : pendingParts)
+	{
+		FinishOutputPart(*part);
+	}
+}
+
+std::unique_ptr<SplitFile::OutputPart> SplitFile::CreateOutputPart(
+	int partNumber, ULONGLONG size)
+{
+	auto part = std::make_unique<OutputPart>();
+	part->partNumber = partNumber;
+	part->remaining = size;
+
+	std::wstring strOutputFullFilename;
+	ProcessFilename(partNumber, strOutputFullFilename);
+	part->filename = PathFindFileName(strOutputFullFilename.c_str());
+
+	part->file.reset(CreateFile(strOutputFullFilename.c_str(), GENERIC_WRITE, 0, nullptr,
+		CREATE_NEW, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_NO_BUFFERING | FILE_FLAG_OVERLAPPED,
+		nullptr));
+
+	if (!part->file)
+	{
+		return part;
+	}
+
+	PreallocateFileSpace(part->file.get(), size);
+
+	/* Small parts only need a single, small buffer. */
+	size_t maxBufferSize = GetStorageInfo(m_strOutputDirectory).ioSettings.bufferSize;
+	auto bufferSize = static_cast<size_t>(AlignUp(
+		(std::min)(size, static_cast<ULONGLONG>(maxBufferSize)), UNBUFFERED_IO_ALIGNMENT));
+	int numBuffers = (size > bufferSize) ? NUM_WRITE_BUFFERS : 1;
+
+	part->writer =
+		std::make_unique<UnbufferedFileWriter>(part->file.get(), bufferSize, numBuffers);
+
+	if (!part->writer->IsValid())
+	{
+		part->writer.reset();
+	}
+
+	return part;
+}
+
+void SplitFile::FinishOutputPart(OutputPart &part)
+{
+	bool bSuccess = false;
+
+	if (part.writer)
+	{
+		bSuccess = part.writer->Finish();
+		part.writer.reset();
+	}
+
+	part.file.reset();
+
+	if (bSuccess && part.remaining == 0)
+	{
+		m_checksums.push_back({ part.filename, part.checksum.GetValue() });
+	}
+
+	/* TODO: Wait for a set period of time before sending message
+	(so as not to block the GUI). */
+	PostMessage(m_hDlg, NSplitFileDialog::WM_APP_SETCURRENTSPLITCOUNT, part.partNumber, 0);
+}
+
+/* Writes the checksum of each part in the SFV format (one line per
+file, consisting of the filename, followed by the CRC-32 in hex).
+That allows the parts to be verified without having to read the
+original file again. */
+void SplitFile::WriteChecksumFile()
+{
+	std::wstring checksumFilename = m_strOutputDirectory + _T("\\")
+		+ PathFindFileName(m_strFullFilename.c_str()) + NSplitFileDialog::CHECKSUM_FILE_EXTENSION;
+
+	wil::unique_hfile checksumFile(CreateFile(checksumFilename.c_str(), GENERIC_WRITE, 0, nullptr,
+		CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr));
+
+	if (!checksumFile)
+	{
+		return;
+	}
+
+	std::wstringstream ss;
+
+	for (const auto &partChecksum : m_checksums)
+	{
+		ss << partChecksum.filename << _T(" ") << std::hex << std::uppercase << std::setw(8)
+		   << std::setfill(_T('0')) << partChecksum.checksum << _T("\r\n");
+	}
+
+	std::string contents = wstrToUtf8Str(ss.str());
+
+	DWORD dwNumberOfBytesWritten;
+	WriteFile(checksumFile.get(), contents.data(), static_cast<DWORD>(contents.size()),
+		&dwNumberOfBytesWritten, nullptr);
 }
 
 void SplitFile::ProcessFilename(int nSplitsMade, std::wstring &strOutputFullFilename)
@@ -654,7 +901,22 @@ void SplitFile::ProcessFilename(int nSplitsMade, std::wstring &strOutputFullFile
 	strOutputFullFilename = m_strOutputDirectory + _T("\\") + strOutputFilename;
 }
 
+ULONGLONG SplitFile::GetBytesProcessed() const
+{
+	return m_bytesProcessed;
+}
+
+bool SplitFile::ShouldStopSplitting()
+{
+	EnterCriticalSection(&m_csStop);
+	bool bStop = m_bStopSplitting;
+	LeaveCriticalSection(&m_csStop);
+
+	return bStop;
+}
+
 void SplitFile::StopSplitting()
+
 {
 	EnterCriticalSection(&m_csStop);
 	m_bStopSplitting = true;
@@ -666,6 +928,7 @@ SplitFileDialogPersistentSettings::SplitFileDialogPersistentSettings() :
 {
 	m_strSplitSize = _T("10");
 	m_strSplitGroup = _T("KB");
+	m_bCreateChecksumFile = FALSE;
 }
 
 SplitFileDialogPersistentSettings &SplitFileDialogPersistentSettings::GetInstance()
@@ -678,12 +941,15 @@ void SplitFileDialogPersistentSettings::SaveExtraRegistrySettings(HKEY hKey)
 {
 	RegistrySettings::SaveString(hKey, SETTING_SIZE, m_strSplitSize.c_str());
 	RegistrySettings::SaveString(hKey, SETTING_SIZE_GROUP, m_strSplitGroup.c_str());
+	RegistrySettings::SaveDword(hKey, SETTING_CREATE_CHECKSUM_FILE, m_bCreateChecksumFile);
 }
 
 void SplitFileDialogPersistentSettings::LoadExtraRegistrySettings(HKEY hKey)
 {
 	RegistrySettings::ReadString(hKey, SETTING_SIZE, m_strSplitSize);
 	RegistrySettings::ReadString(hKey, SETTING_SIZE_GROUP, m_strSplitGroup);
+	RegistrySettings::ReadDword(
+		hKey, SETTING_CREATE_CHECKSUM_FILE, reinterpret_cast<LPDWORD>(&m_bCreateChecksumFile));
 }
 
 void SplitFileDialogPersistentSettings::SaveExtraXMLSettings(
@@ -692,6 +958,8 @@ void SplitFileDialogPersistentSettings::SaveExtraXMLSettings(
 	NXMLSettings::AddAttributeToNode(pXMLDom, pParentNode, SETTING_SIZE, m_strSplitSize.c_str());
 	NXMLSettings::AddAttributeToNode(
 		pXMLDom, pParentNode, SETTING_SIZE_GROUP, m_strSplitGroup.c_str());
+	NXMLSettings::AddAttributeToNode(pXMLDom, pParentNode, SETTING_CREATE_CHECKSUM_FILE,
+		NXMLSettings::EncodeBoolValue(m_bCreateChecksumFile));
 }
 
 void SplitFileDialogPersistentSettings::LoadExtraXMLSettings(BSTR bstrName, BSTR bstrValue)
@@ -704,4 +972,8 @@ void SplitFileDialogPersistentSettings::LoadExtraXMLSettings(BSTR bstrName, BSTR
 	{
 		m_strSplitGroup = _bstr_t(bstrValue);
 	}
+	else if (lstrcmpi(bstrName, SETTING_CREATE_CHECKSUM_FILE) == 0)
+	{
+		m_bCreateChecksumFile = NXMLSettings::DecodeBoolValue(bstrValue);
+	}
 }
\ No newline at end of file
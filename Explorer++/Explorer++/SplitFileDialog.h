@@ -7,8 +7,12 @@
 #include "DarkModeDialogBase.h"
 #include "../Helper/DialogSettings.h"
 #include "../Helper/ReferenceCount.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 __interface IExplorerplusplus;
 class SplitFileDialog;
@@ -25,6 +29,7 @@ private:
 
 	static const TCHAR SETTING_SIZE[];
 	static const TCHAR SETTING_SIZE_GROUP[];
+	static const TCHAR SETTING_CREATE_CHECKSUM_FILE[];
 
 	SplitFileDialogPersistentSettings();
 
@@ -39,21 +44,48 @@ private:
 
 	std::wstring m_strSplitSize;
 	std::wstring m_strSplitGroup;
+	BOOL m_bCreateChecksumFile;
 };
 
 class SplitFile : public ReferenceCount
 {
 public:
 	SplitFile(HWND hDlg, const std::wstring &strFullFilename, const std::wstring &strOutputFilename,
-		const std::wstring &strOutputDirectory, UINT uSplitSize);
+		const std::wstring &strOutputDirectory, UINT uSplitSize, bool createChecksumFile);
 	~SplitFile();
 
 	void Split();
 	void StopSplitting();
 
+	/* Returns the amount of the input file processed so far. Can be
+	called from any thread. */
+	ULONGLONG GetBytesProcessed() const;
+
 private:
+	struct ReadBuffer;
+	struct OutputPart;
+
+	struct PartChecksum
+	{
+		std::wstring filename;
+		uint32_t checksum;
+	};
+
+	/* The buffers are sized according to the devices the input
+	and output files are on (see GetStorageInfo). */
+	static constexpr int NUM_READ_BUFFERS = 4;
+	static constexpr int NUM_WRITE_BUFFERS = 2;
+
+	/* The number of completely queued parts whose writes can still
+	be in progress. */
+	static constexpr size_t MAX_PENDING_PARTS = 4;
+
 	void SplitInternal(HANDLE hInputFile, const LARGE_INTEGER &lFileSize);
+	std::unique_ptr<OutputPart> CreateOutputPart(int partNumber, ULONGLONG size);
+	void FinishOutputPart(OutputPart &part);
+	void WriteChecksumFile();
 	void ProcessFilename(int nSplitsMade, std::wstring &strOutputFullFilename);
+	bool ShouldStopSplitting();
 
 	HWND m_hDlg;
 
@@ -61,6 +93,10 @@ private:
 	std::wstring m_strOutputFilename;
 	std::wstring m_strOutputDirectory;
 	UINT m_uSplitSize;
+	bool m_createChecksumFile;
+
+	std::vector<PartChecksum> m_checksums;
+	std::atomic<ULONGLONG> m_bytesProcessed;
 
 	CRITICAL_SECTION m_csStop;
 	bool m_bStopSplitting;
@@ -132,6 +168,7 @@ private:
 
 	TCHAR m_szOk[32];
 	UINT m_uElapsedTime;
+	ULONGLONG m_lastBytesProcessed;
 
 	ErrorType m_CurrentError;
 
@@ -6,11 +6,17 @@
 #include "Explorer++.h"
 #include "Config.h"
 #include "DarkModeHelper.h"
+#include "HardwareChangeNotifier.h"
 #include "MainResource.h"
 #include "ShellBrowser/ShellBrowser.h"
+#include "ResourceHelper.h"
 #include "TabContainer.h"
 #include "../Helper/Controls.h"
+#include "../Helper/FileOperationQueue.h"
+#include "../Helper/StringHelper.h"
+#include "../Helper/VolumeInfoCache.h"
 #include "../Helper/WindowHelper.h"
+#include <boost/format.hpp>
 
 void Explorerplusplus::CreateStatusBar()
 {
@@ -47,6 +53,21 @@ void Explorerplusplus::CreateStatusBar()
 
 void Explorerplusplus::SetStatusBarParts(int width)
 {
+	// While background file transfers are pending, their progress is shown in an extra part at
+	// the end.
+	if (m_statusBarFileTransferPartShown)
+	{
+		int parts[4];
+
+		parts[0] = (int) (0.35 * width);
+		parts[1] = (int) (0.50 * width);
+		parts[2] = (int) (0.65 * width);
+		parts[3] = width;
+
+		SendMessage(m_hStatusBar, SB_SETPARTS, 4, (LPARAM) parts);
+		return;
+	}
+
 	int parts[3];
 
 	parts[0] = (int) (0.50 * width);
@@ -123,6 +144,56 @@ void Explorerplusplus::OnNavigationFailedStatusBar(const Tab &tab)
 	}
 }
 
+void Explorerplusplus::OnPendingSortProgressChangedStatusBar(const Tab &tab)
+{
+	if (!m_tabContainer->IsTabSelected(tab))
+	{
+		return;
+	}
+
+	auto progress = tab.GetShellBrowser()->GetPendingSortProgress();
+
+	// Only the first part of the status bar changes while the sort is in progress. Once it's
+	// finished, the item counts are shown again.
+	if (progress)
+	{
+		SetStatusBarSortingText(*progress);
+	}
+	else
+	{
+		UpdateStatusBarText(tab);
+	}
+}
+
+// Shows the progress of a sort that's waiting on its sort keys to be built in the background, in
+// place of the item count.
+void Explorerplusplus::SetStatusBarSortingText(const PendingSortProgress &progress)
+{
+	size_t percentage = (progress.numKeysTotal == 0)
+		? 100
+		: (progress.numKeysBuilt * 100) / progress.numKeysTotal;
+
+	std::wstring text =
+		(boost::wformat(ResourceHelper::LoadString(m_hLanguageModule, IDS_STATUS_SORTING))
+			% percentage)
+			.str();
+
+	SendMessage(m_hStatusBar, SB_SETTEXT, 0 | 0, (LPARAM) text.c_str());
+}
+
+void Explorerplusplus::OnDriveChangedStatusBar(const DriveChange &change)
+{
+	const Tab &selectedTab = m_tabContainer->GetSelectedTab();
+	std::wstring directory = selectedTab.GetShellBrowser()->GetDirectory();
+	auto root = VolumeInfoCache::GetRoot(directory);
+
+	// The free space only needs to be refreshed if it's being shown for the drive that changed.
+	if (root && lstrcmpi(root->c_str(), change.path.c_str()) == 0)
+	{
+		RequestStatusBarFreeSpace(directory);
+	}
+}
+
 HRESULT Explorerplusplus::UpdateStatusBarText(const Tab &tab)
 {
 	FolderInfo_t folderInfo;
@@ -131,14 +202,14 @@ HRESULT Explorerplusplus::UpdateStatusBarText(const Tab &tab)
 	int nFoldersSelected;
 	TCHAR szItemsSelected[64];
 	TCHAR lpszSizeBuffer[32];
-	TCHAR szBuffer[64];
 	TCHAR szTemp[64];
 	TCHAR *szNumSelected = nullptr;
-	int res;
 
 	nTotal = tab.GetShellBrowser()->GetNumItems();
-	nFilesSelected = tab.GetShellBrowser()->GetNumSelectedFiles();
-	nFoldersSelected = tab.GetShellBrowser()->GetNumSelectedFolders();
+
+	const SelectionInfo &selectionInfo = tab.GetShellBrowser()->GetSelectionInfo();
+	nFilesSelected = selectionInfo.numFiles;
+	nFoldersSelected = selectionInfo.numFolders;
 
 	if ((nFilesSelected + nFoldersSelected) != 0)
 	{
@@ -187,7 +258,14 @@ HRESULT Explorerplusplus::UpdateStatusBarText(const Tab &tab)
 		}
 	}
 
-	SendMessage(m_hStatusBar, SB_SETTEXT, 0 | 0, (LPARAM) szItemsSelected);
+	if (auto sortProgress = tab.GetShellBrowser()->GetPendingSortProgress())
+	{
+		SetStatusBarSortingText(*sortProgress);
+	}
+	else
+	{
+		SendMessage(m_hStatusBar, SB_SETTEXT, 0 | 0, (LPARAM) szItemsSelected);
+	}
 
 	tab.GetShellBrowser()->GetFolderInfo(&folderInfo);
 
@@ -200,68 +278,160 @@ HRESULT Explorerplusplus::UpdateStatusBarText(const Tab &tab)
 	}
 	else
 	{
-		if (nFilesSelected == 0)
+		// The sizes of the selected folders are only included once they're all known, so that a
+		// partial total isn't shown.
+		bool folderSizesKnown = (selectionInfo.numFoldersSized == nFoldersSelected);
+
+		if (nFilesSelected == 0 && !folderSizesKnown)
 		{
 			/* Only folders selected. Don't show any size in the status bar. */
 			StringCchCopy(lpszSizeBuffer, SIZEOF_ARRAY(lpszSizeBuffer), EMPTY_STRING);
 		}
 		else
 		{
-			/* Mixture of files and folders selected. Show size of currently
-			selected files. */
-			FormatSizeString(folderInfo.TotalSelectionSize, lpszSizeBuffer,
-				SIZEOF_ARRAY(lpszSizeBuffer), m_config->globalFolderSettings.forceSize,
+			ULARGE_INTEGER selectionSize;
+			selectionSize.QuadPart =
+				selectionInfo.filesSize + (folderSizesKnown ? selectionInfo.foldersSize : 0);
+
+			FormatSizeString(selectionSize, lpszSizeBuffer, SIZEOF_ARRAY(lpszSizeBuffer),
+				m_config->globalFolderSettings.forceSize,
 				m_config->globalFolderSettings.sizeDisplayFormat);
 		}
 	}
 
 	SendMessage(m_hStatusBar, SB_SETTEXT, 1 | 0, (LPARAM) lpszSizeBuffer);
 
-	res = CreateDriveFreeSpaceString(
-		tab.GetShellBrowser()->GetDirectory().c_str(), szBuffer, SIZEOF_ARRAY(szBuffer));
+	RequestStatusBarFreeSpace(tab.GetShellBrowser()->GetDirectory());
+
+	return S_OK;
+}
+
+void Explorerplusplus::RequestStatusBarFreeSpace(const std::wstring &directory)
+{
+	CancelStatusBarFreeSpace();
 
-	if (res == -1)
+	// The free space shown for the previous directory doesn't apply here, so it's cleared rather
+	// than left in place until the new value arrives.
+	if (directory != m_statusBarFreeSpaceDirectory)
 	{
-		StringCchCopy(szBuffer, SIZEOF_ARRAY(szBuffer), EMPTY_STRING);
+		SendMessage(m_hStatusBar, SB_SETTEXT, 2 | 0, (LPARAM) EMPTY_STRING);
+		m_statusBarFreeSpaceDirectory = directory;
 	}
 
-	SendMessage(m_hStatusBar, SB_SETTEXT, 2 | 0, (LPARAM) szBuffer);
+	m_statusBarFreeSpaceResult = m_statusBarThreadPool.push(
+		[hwnd = m_hContainer, requestId = m_statusBarFreeSpaceRequestId, directory](int id)
+		{
+			UNREFERENCED_PARAMETER(id);
+
+			std::optional<VolumeInfoCache::SpaceInfo> spaceInfo;
 
-	return S_OK;
+			// The directory may be a mounted folder, so its root can't be determined from the
+			// path alone.
+			TCHAR volumeRoot[MAX_PATH];
+
+			if (GetVolumePathName(directory.c_str(), volumeRoot, SIZEOF_ARRAY(volumeRoot)))
+			{
+				spaceInfo = VolumeInfoCache::GetInstance().GetSpaceInfo(volumeRoot);
+			}
+
+			PostMessage(hwnd, WM_APP_STATUSBARFREESPACEREADY, requestId, 0);
+
+			return spaceInfo;
+		});
 }
 
-int Explorerplusplus::CreateDriveFreeSpaceString(const TCHAR *szPath, TCHAR *szBuffer, int nBuffer)
+void Explorerplusplus::OnStatusBarFreeSpaceReady(int requestId)
 {
-	ULARGE_INTEGER totalNumberOfBytes;
-	ULARGE_INTEGER totalNumberOfFreeBytes;
-	ULARGE_INTEGER bytesAvailableToCaller;
-	TCHAR szFreeSpace[32];
-	TCHAR szFree[16];
-	TCHAR szFreeSpaceString[512];
+	// A result for a request that's since been replaced is ignored.
+	if (requestId != m_statusBarFreeSpaceRequestId || !m_statusBarFreeSpaceResult.valid())
+	{
+		return;
+	}
 
-	if (GetDiskFreeSpaceEx(
-			szPath, &bytesAvailableToCaller, &totalNumberOfBytes, &totalNumberOfFreeBytes)
-		== 0)
+	auto spaceInfo = m_statusBarFreeSpaceResult.get();
+	std::wstring freeSpaceText;
+
+	if (spaceInfo && spaceInfo->totalBytes.QuadPart != 0)
 	{
-		szBuffer = nullptr;
-		return -1;
+		freeSpaceText = CreateDriveFreeSpaceString(*spaceInfo);
 	}
 
-	FormatSizeString(totalNumberOfFreeBytes, szFreeSpace, SIZEOF_ARRAY(szFreeSpace));
+	SendMessage(m_hStatusBar, SB_SETTEXT, 2 | 0, (LPARAM) freeSpaceText.c_str());
+}
+
+void Explorerplusplus::CancelStatusBarFreeSpace()
+{
+	// As with the display window details, a query that's already running can't be interrupted, but
+	// its result will be ignored.
+	m_statusBarThreadPool.clear_queue();
+	m_statusBarFreeSpaceResult = {};
+	m_statusBarFreeSpaceRequestId++;
+}
 
-	LoadString(m_hLanguageModule, IDS_GENERAL_FREE, szFree, SIZEOF_ARRAY(szFree));
+void Explorerplusplus::UpdateStatusBarFileTransferText()
+{
+	auto status = m_fileOperationQueue->GetStatus();
+	bool showPart = (status.numPendingJobs > 0);
 
-	StringCchPrintf(szFreeSpaceString, SIZEOF_ARRAY(szFreeSpace), _T("%s %s (%.0f%%)"), szFreeSpace,
-		szFree, totalNumberOfFreeBytes.QuadPart * 100.0 / totalNumberOfBytes.QuadPart);
+	if (showPart != m_statusBarFileTransferPartShown)
+	{
+		m_statusBarFileTransferPartShown = showPart;
+
+		RECT rc;
+		GetClientRect(m_hContainer, &rc);
+		SetStatusBarParts(GetRectWidth(&rc));
+	}
 
-	if (nBuffer > lstrlen(szFreeSpaceString))
+	if (!showPart)
 	{
-		StringCchCopy(szBuffer, nBuffer, szFreeSpaceString);
+		return;
+	}
+
+	std::wstring text;
+
+	if (m_fileOperationQueue->IsPaused())
+	{
+		text = (boost::wformat(
+					ResourceHelper::LoadString(m_hLanguageModule, IDS_FILE_TRANSFER_STATUS_PAUSED))
+			% status.numPendingJobs)
+				   .str();
 	}
 	else
 	{
-		szBuffer = nullptr;
+		auto formatSize = [](ULONGLONG size)
+		{
+			ULARGE_INTEGER largeSize;
+			largeSize.QuadPart = size;
+
+			TCHAR sizeString[32];
+			FormatSizeString(largeSize, sizeString, SIZEOF_ARRAY(sizeString));
+			return std::wstring(sizeString);
+		};
+
+		text = (boost::wformat(
+					ResourceHelper::LoadString(m_hLanguageModule, IDS_FILE_TRANSFER_STATUS))
+			% status.numPendingJobs % formatSize(status.bytesTransferred)
+			% formatSize(status.totalBytes) % formatSize(status.bytesPerSecond))
+				   .str();
 	}
 
-	return lstrlen(szFreeSpaceString);
-}
\ No newline at end of file
+	SendMessage(m_hStatusBar, SB_SETTEXT, 3 | 0, (LPARAM) text.c_str());
+}
+
+std::wstring Explorerplusplus::CreateDriveFreeSpaceString(
+	const VolumeInfoCache::SpaceInfo &spaceInfo)
+{
+	TCHAR szFreeSpace[32];
+	TCHAR szFree[16];
+	TCHAR szFreeSpaceString[512];
+
+	FormatSizeString(spaceInfo.freeBytes, szFreeSpace, SIZEOF_ARRAY(szFreeSpace));
+
+	LoadString(m_hLanguageModule, IDS_GENERAL_FREE, szFree, SIZEOF_ARRAY(szFree));
+
+	StringCchPrintf(szFreeSpaceString, SIZEOF_ARRAY(szFreeSpaceString), _T("%s %s (%.0f%%)"),
+		szFreeSpace, szFree,
+		spaceInfo.freeBytes.QuadPart * 100.0 / spaceInfo.totalBytes.QuadPart);
+
+	return szFreeSpaceString;
+}
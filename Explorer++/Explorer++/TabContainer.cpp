@@ -8,6 +8,7 @@
 #include "Config.h"
 #include "CoreInterface.h"
 #include "DarkModeHelper.h"
+#include "Explorer++_internal.h"
 #include "Icon.h"
 #include "IconResourceLoader.h"
 #include "MainResource.h"
@@ -21,15 +22,21 @@
 #include "../Helper/CachedIcons.h"
 #include "../Helper/Controls.h"
 #include "../Helper/DpiCompatibility.h"
+#include "../Helper/FileOperations.h"
+#include "../Helper/Helper.h"
 #include "../Helper/IconFetcher.h"
 #include "../Helper/ImageHelper.h"
 #include "../Helper/MenuHelper.h"
+#include "../Helper/ParsedPathCache.h"
+#include "../Helper/PerformanceTrace.h"
 #include "../Helper/ShellHelper.h"
 #include "../Helper/TabHelper.h"
 #include "../Helper/WindowHelper.h"
 #include "../Helper/iDirectoryMonitor.h"
 #include <boost/algorithm/string.hpp>
+#include <boost/format.hpp>
 #include <boost/range/adaptor/map.hpp>
+#include <comdef.h>
 
 const UINT TAB_CONTROL_STYLES = WS_VISIBLE | WS_CHILD | TCS_FOCUSNEVER | TCS_SINGLELINE
 	| TCS_TOOLTIPS | WS_CLIPSIBLINGS | WS_CLIPCHILDREN;
@@ -65,7 +72,9 @@ TabContainer::TabContainer(HWND parent, TabNavigationInterface *tabNavigation,
 	m_iPreviousTabSelectionId(-1),
 	m_iconFetcher(m_hwnd, cachedIcons),
 	m_defaultFolderIconSystemImageListIndex(GetDefaultFolderIconIndex()),
-	m_dropTargetIndex(-1)
+	m_dropTargetIndex(-1),
+	m_selectionUpdateQueue(std::bind_front(&TabContainer::OnSelectionUpdatesScheduled, this),
+		&TabContainer::IsInputWaiting)
 {
 	Initialize(parent);
 }
@@ -135,6 +144,8 @@ void TabContainer::Initialize(HWND parent)
 		std::bind_front(&TabContainer::OnAlwaysShowTabBarUpdated, this)));
 	m_connections.push_back(m_config->forceSameTabWidth.addObserver(
 		std::bind_front(&TabContainer::OnForceSameTabWidthUpdated, this)));
+
+	SetTimer(m_hwnd, HIBERNATION_TIMER_ID, HIBERNATION_TIMER_ELAPSE, nullptr);
 }
 
 void TabContainer::AddDefaultTabIcons(HIMAGELIST himlTab)
@@ -232,6 +243,14 @@ LRESULT CALLBACK TabContainer::WndProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPAR
 		{
 			OnDropScrollTimer();
 		}
+		else if (wParam == HIBERNATION_TIMER_ID)
+		{
+			OnHibernationTimer();
+		}
+		else if (wParam == SELECTION_UPDATE_TIMER_ID)
+		{
+			OnSelectionUpdateTimer();
+		}
 		break;
 
 	case WM_MENUSELECT:
@@ -251,6 +270,10 @@ LRESULT CALLBACK TabContainer::WndProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPAR
 	}
 	break;
 
+	case WM_APP_PERFORM_DEFERRED_NAVIGATION:
+		PerformDeferredNavigation(static_cast<int>(wParam));
+		break;
+
 	case WM_NCDESTROY:
 		delete this;
 		return 0;
@@ -441,6 +464,7 @@ void TabContainer::CreateTabContextMenu(Tab &tab, const POINT &pt)
 	MenuHelper::CheckItem(
 		menu, IDM_TAB_LOCKTABANDADDRESS, tab.GetLockState() == Tab::LockState::AddressLocked);
 	MenuHelper::EnableItem(menu, IDM_TAB_CLOSETAB, tab.GetLockState() == Tab::LockState::NotLocked);
+	MenuHelper::EnableItem(menu, IDM_TAB_COPYCHANGESFROMSELECTEDTAB, !IsTabSelected(tab));
 
 	UINT command =
 		TrackPopupMenu(menu, TPM_LEFTALIGN | TPM_RIGHTBUTTON | TPM_VERTICAL | TPM_RETURNCMD, pt.x,
@@ -498,6 +522,10 @@ void TabContainer::ProcessTabCommand(UINT uMenuID, Tab &tab)
 		OnLockTabAndAddress(tab);
 		break;
 
+	case IDM_TAB_COPYCHANGESFROMSELECTEDTAB:
+		OnCopyChangesFromSelectedTab(tab);
+		break;
+
 	case IDM_TAB_CLOSETAB:
 		CloseTab(tab);
 		break;
@@ -569,6 +597,75 @@ void TabContainer::OnLockTabAndAddress(Tab &tab)
 	}
 }
 
+// Brings the folder shown in the specified tab up to date with the folder shown in the selected tab.
+// Files are normally compared by size and modification time. If shift is held down when the
+// command is chosen, files of the same size are compared by content instead.
+void TabContainer::OnCopyChangesFromSelectedTab(const Tab &tab)
+{
+	std::wstring sourceFolder = GetSelectedTab().GetShellBrowser()->GetDirectory();
+	std::wstring destinationFolder = tab.GetShellBrowser()->GetDirectory();
+
+	if (!PathIsDirectory(sourceFolder.c_str()) || !PathIsDirectory(destinationFolder.c_str()))
+	{
+		std::wstring message =
+			ResourceHelper::LoadString(m_instance, IDS_COPY_CHANGES_NOT_FILE_SYSTEM);
+		MessageBox(m_hwnd, message.c_str(), NExplorerplusplus::APP_NAME, MB_ICONWARNING | MB_OK);
+		return;
+	}
+
+	FolderComparisonOptions options;
+	options.compareContents = IsKeyDown(VK_SHIFT);
+
+	std::vector<FolderDifference> differences;
+	HRESULT hr = NFileOperations::CompareFolders(
+		m_hwnd, sourceFolder, destinationFolder, options, differences);
+
+	if (SUCCEEDED(hr))
+	{
+		auto numChanges = std::count_if(differences.begin(), differences.end(),
+			[](const FolderDifference &difference) {
+				return difference.type == FolderDifferenceType::SourceOnly
+					|| difference.type == FolderDifferenceType::Modified;
+			});
+
+		if (numChanges == 0)
+		{
+			std::wstring message = (boost::wformat(ResourceHelper::LoadString(
+										m_instance, IDS_COPY_CHANGES_UP_TO_DATE))
+				% destinationFolder % sourceFolder)
+									   .str();
+			MessageBox(m_hwnd, message.c_str(), NExplorerplusplus::APP_NAME,
+				MB_ICONINFORMATION | MB_OK);
+			return;
+		}
+
+		std::wstring message = (boost::wformat(ResourceHelper::LoadString(
+									m_instance, IDS_COPY_CHANGES_CONFIRMATION))
+			% numChanges % sourceFolder % destinationFolder)
+								   .str();
+		int response = MessageBox(m_hwnd, message.c_str(), NExplorerplusplus::APP_NAME,
+			MB_ICONINFORMATION | MB_YESNO);
+
+		if (response != IDYES)
+		{
+			return;
+		}
+
+		hr = NFileOperations::CopyFolderDifferences(
+			m_hwnd, sourceFolder, destinationFolder, differences);
+	}
+
+	if (FAILED(hr) && hr != HRESULT_FROM_WIN32(ERROR_CANCELLED))
+	{
+		_com_error error(hr);
+		std::wstring message =
+			(boost::wformat(ResourceHelper::LoadString(m_instance, IDS_COPY_CHANGES_ERROR))
+				% error.ErrorMessage())
+				.str();
+		MessageBox(m_hwnd, message.c_str(), NExplorerplusplus::APP_NAME, MB_ICONWARNING | MB_OK);
+	}
+}
+
 void TabContainer::OnCloseOtherTabs(int index)
 {
 	const int nTabs = GetNumTabs();
@@ -737,7 +834,9 @@ void TabContainer::OnTabCreated(int tabId, BOOL switchToNewTab)
 
 void TabContainer::OnTabRemoved(int tabId)
 {
-	UNREFERENCED_PARAMETER(tabId);
+	m_deferredNavigations.erase(tabId);
+	m_tabDeselectionTimes.erase(tabId);
+	m_hibernatedTabs.erase(tabId);
 
 	if (!m_config->alwaysShowTabBar.get() && (GetNumTabs() == 1))
 	{
@@ -750,9 +849,118 @@ void TabContainer::OnTabSelected(const Tab &tab)
 	if (m_iPreviousTabSelectionId != -1)
 	{
 		m_tabSelectionHistory.push_back(m_iPreviousTabSelectionId);
+		m_tabDeselectionTimes[m_iPreviousTabSelectionId] = std::chrono::steady_clock::now();
 	}
 
 	m_iPreviousTabSelectionId = tab.GetId();
+	m_tabDeselectionTimes.erase(tab.GetId());
+
+	// The timer is always started here (rather than only when an update is scheduled), so that
+	// the time taken to paint the tab is recorded even if there are no updates to run.
+	m_tabSelectionTime = std::chrono::steady_clock::now();
+	SetTimer(m_hwnd, SELECTION_UPDATE_TIMER_ID, SELECTION_UPDATE_TIMER_ELAPSE, nullptr);
+
+	tab.GetShellBrowser()->PrioritizeBackgroundTasks();
+
+	if (m_hibernatedTabs.erase(tab.GetId()) > 0)
+	{
+		// The selection and folder were saved when the tab was hibernated, so refreshing will
+		// restore both.
+		tab.GetShellBrowser()->GetNavigationController()->Refresh();
+	}
+
+	if (m_deferredNavigations.contains(tab.GetId()))
+	{
+		// A tab can be selected several times in quick succession (e.g. when restoring tabs, each
+		// tab is selected as it's created), so the navigation is only performed once control
+		// returns to the message loop, if the tab is still selected at that point.
+		PostMessage(m_hwnd, WM_APP_PERFORM_DEFERRED_NAVIGATION, tab.GetId(), 0);
+	}
+}
+
+void TabContainer::ScheduleSelectionUpdate(const void *owner, SelectionUpdatePriority priority,
+	std::function<void(const Tab &tab)> update)
+{
+	m_selectionUpdateQueue.ScheduleTask(owner, static_cast<int>(priority),
+		[this, update = std::move(update)] { update(GetSelectedTab()); });
+}
+
+void TabContainer::OnSelectionUpdatesScheduled()
+{
+	SetTimer(m_hwnd, SELECTION_UPDATE_TIMER_ID, SELECTION_UPDATE_TIMER_ELAPSE, nullptr);
+}
+
+void TabContainer::OnSelectionUpdateTimer()
+{
+	KillTimer(m_hwnd, SELECTION_UPDATE_TIMER_ID);
+
+	if (m_tabSelectionTime)
+	{
+		TracePerformanceTabSwitchPaint(GetSelectedTab().GetId(),
+			std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::steady_clock::now() - *m_tabSelectionTime));
+		m_tabSelectionTime.reset();
+	}
+
+	PerformanceTraceActivity activity(L"TabSelectionUpdates");
+
+	if (m_selectionUpdateQueue.RunTasks())
+	{
+		// Input arrived while the updates were running. The remaining updates will be run once
+		// that's been processed.
+		SetTimer(m_hwnd, SELECTION_UPDATE_TIMER_ID, SELECTION_UPDATE_TIMER_ELAPSE, nullptr);
+	}
+}
+
+bool TabContainer::IsInputWaiting()
+{
+	return HIWORD(GetQueueStatus(QS_INPUT)) != 0;
+}
+
+void TabContainer::OnHibernationTimer()
+{
+	auto now = std::chrono::steady_clock::now();
+
+	for (const auto &[tabId, deselectionTime] : m_tabDeselectionTimes)
+	{
+		if (now - deselectionTime < TAB_HIBERNATION_TIMEOUT || m_hibernatedTabs.contains(tabId)
+			|| m_deferredNavigations.contains(tabId))
+		{
+			continue;
+		}
+
+		Tab *tab = GetTabOptional(tabId);
+
+		if (!tab || IsTabSelected(*tab))
+		{
+			continue;
+		}
+
+		tab->GetShellBrowser()->UnloadFolderContents();
+		m_hibernatedTabs.insert(tabId);
+	}
+}
+
+void TabContainer::PerformDeferredNavigation(int tabId)
+{
+	auto itr = m_deferredNavigations.find(tabId);
+
+	if (itr == m_deferredNavigations.end())
+	{
+		return;
+	}
+
+	Tab *tab = GetTabOptional(tabId);
+
+	if (!tab || !IsTabSelected(*tab))
+	{
+		return;
+	}
+
+	auto pidlDirectory = std::move(itr->second);
+	m_deferredNavigations.erase(itr);
+
+	BrowseInitialFolder(*tab, pidlDirectory.get(), true);
 }
 
 void TabContainer::OnAlwaysShowTabBarUpdated(BOOL newValue)
@@ -824,11 +1032,11 @@ void TabContainer::SetTabIcon(const Tab &tab)
 	}
 	else
 	{
-		auto itr = m_cachedIcons->findByPath(tab.GetShellBrowser()->GetDirectory());
+		auto cachedIconIndex = m_cachedIcons->findByPath(tab.GetShellBrowser()->GetDirectory());
 
-		if (itr != m_cachedIcons->end())
+		if (cachedIconIndex)
 		{
-			SetTabIconFromSystemImageList(tab, itr->iconIndex);
+			SetTabIconFromSystemImageList(tab, *cachedIconIndex);
 		}
 		else
 		{
@@ -853,6 +1061,7 @@ void TabContainer::SetTabIcon(const Tab &tab)
 				}
 
 				SetTabIconFromSystemImageList(*tab, iconIndex);
+				tabIconFetchedSignal.m_signal(*tab, iconIndex);
 			});
 	}
 }
@@ -925,7 +1134,7 @@ void TabContainer::CreateNewTab(const TCHAR *TabDirectory, const TabSettings &ta
 	}
 
 	unique_pidl_absolute pidl;
-	HRESULT hr = SHParseDisplayName(szExpandedPath, nullptr, wil::out_param(pidl), 0, nullptr);
+	HRESULT hr = ParsedPathCache::GetInstance().ParsePath(szExpandedPath, wil::out_param(pidl));
 
 	if (FAILED(hr))
 	{
@@ -954,7 +1163,7 @@ void TabContainer::CreateNewTab(const PreservedTab &preservedTab, int *newTabId)
 
 	TabSettings tabSettings(_index = preservedTab.index, _selected = true);
 
-	SetUpNewTab(tab, entry->pidl.get(), tabSettings, false, newTabId);
+	SetUpNewTab(tab, entry->GetPidl().get(), tabSettings, false, newTabId);
 }
 
 void TabContainer::CreateNewTab(PCIDLIST_ABSOLUTE pidlDirectory, const TabSettings &tabSettings,
@@ -1024,6 +1233,13 @@ void TabContainer::SetUpNewTab(Tab &tab, PCIDLIST_ABSOLUTE pidlDirectory,
 	}
 
 	tab.GetShellBrowser()->AddNavigationStartedObserver([this, &tab](PCIDLIST_ABSOLUTE pidl) {
+		// If a deferred tab is navigated some other way before it's selected, the original
+		// navigation no longer needs to happen.
+		m_deferredNavigations.erase(tab.GetId());
+
+		// Similarly, any navigation will reload a hibernated tab.
+		m_hibernatedTabs.erase(tab.GetId());
+
 		tabNavigationStartedSignal.m_signal(tab, pidl);
 	});
 
@@ -1056,24 +1272,33 @@ void TabContainer::SetUpNewTab(Tab &tab, PCIDLIST_ABSOLUTE pidlDirectory,
 		tabListViewSelectionChangedSignal.m_signal(tab);
 	});
 
+	tab.GetShellBrowser()->listViewSelectionAttributesChanged.AddObserver([this, &tab]() {
+		tabListViewSelectionAttributesChangedSignal.m_signal(tab);
+	});
+
 	tab.GetShellBrowser()->columnsChanged.AddObserver([this, &tab]() {
 		tabColumnsChangedSignal.m_signal(tab);
 	});
 
-	HRESULT hr = tab.GetShellBrowser()->GetNavigationController()->BrowseFolder(
-		pidlDirectory, addHistoryEntry);
+	tab.GetShellBrowser()->listViewScrolled.AddObserver([this, &tab]() {
+		tabListViewScrolledSignal.m_signal(tab);
+	});
 
-	if (FAILED(hr))
-	{
-		hr = tab.GetShellBrowser()->GetNavigationController()->BrowseFolder(
-			m_config->defaultTabDirectory, addHistoryEntry);
+	tab.GetShellBrowser()->pendingSortProgressChanged.AddObserver([this, &tab]() {
+		tabPendingSortProgressChangedSignal.m_signal(tab);
+	});
 
-		if (FAILED(hr))
-		{
-			// The computer folder should always exist, so this call shouldn't fail.
-			tab.GetShellBrowser()->GetNavigationController()->BrowseFolder(
-				m_config->defaultTabDirectoryStatic, addHistoryEntry);
-		}
+	if (tabSettings.deferNavigation && *tabSettings.deferNavigation)
+	{
+		// The folder will be navigated to once the tab is first selected. Until then, the tab
+		// still reports the folder as its current directory.
+		SharedPidl pendingDirectory(pidlDirectory);
+		tab.GetShellBrowser()->SetPendingDirectory(pendingDirectory);
+		m_deferredNavigations.insert({ tab.GetId(), pendingDirectory });
+	}
+	else
+	{
+		BrowseInitialFolder(tab, pidlDirectory, addHistoryEntry);
 	}
 
 	if (selected)
@@ -1100,6 +1325,26 @@ void TabContainer::SetUpNewTab(Tab &tab, PCIDLIST_ABSOLUTE pidlDirectory,
 	tabCreatedSignal.m_signal(tab.GetId(), selected);
 }
 
+void TabContainer::BrowseInitialFolder(
+	Tab &tab, PCIDLIST_ABSOLUTE pidlDirectory, bool addHistoryEntry)
+{
+	HRESULT hr = tab.GetShellBrowser()->GetNavigationController()->BrowseFolder(
+		pidlDirectory, addHistoryEntry);
+
+	if (FAILED(hr))
+	{
+		hr = tab.GetShellBrowser()->GetNavigationController()->BrowseFolder(
+			m_config->defaultTabDirectory, addHistoryEntry);
+
+		if (FAILED(hr))
+		{
+			// The computer folder should always exist, so this call shouldn't fail.
+			tab.GetShellBrowser()->GetNavigationController()->BrowseFolder(
+				m_config->defaultTabDirectoryStatic, addHistoryEntry);
+		}
+	}
+}
+
 void TabContainer::InsertNewTab(
 	int index, int tabId, PCIDLIST_ABSOLUTE pidlDirectory, std::optional<std::wstring> customName)
 {
@@ -1379,6 +1624,25 @@ int TabContainer::MoveTab(const Tab &tab, int newIndex)
 	return TabCtrl_MoveItem(m_hwnd, index, newIndex);
 }
 
+// Changes the folder that a tab created with the deferNavigation setting will navigate to once
+// it's first selected. If the tab has already navigated, it's navigated to the folder immediately.
+void TabContainer::SetDeferredDirectory(Tab &tab, PCIDLIST_ABSOLUTE pidlDirectory)
+{
+	auto itr = m_deferredNavigations.find(tab.GetId());
+
+	if (itr == m_deferredNavigations.end())
+	{
+		BrowseInitialFolder(tab, pidlDirectory, true);
+		return;
+	}
+
+	itr->second = SharedPidl(pidlDirectory);
+	tab.GetShellBrowser()->SetPendingDirectory(itr->second);
+
+	UpdateTabNameInWindow(tab);
+	SetTabIcon(tab);
+}
+
 std::unordered_map<int, std::unique_ptr<Tab>> &TabContainer::GetTabs()
 {
 	return m_tabs;
@@ -1446,7 +1710,7 @@ unique_pidl_absolute TabContainer::GetPidlForTargetItem(int targetItem)
 	}
 
 	const auto &tab = GetTabByIndex(targetItem);
-	return tab.GetShellBrowser()->GetDirectoryIdl();
+	return tab.GetShellBrowser()->GetDirectoryIdl().Clone();
 }
 
 IUnknown *TabContainer::GetSiteForTargetItem(PCIDLIST_ABSOLUTE targetItemPidl)
@@ -9,15 +9,19 @@
 #include "Tab.h"
 #include "TabNavigationInterface.h"
 #include "../Helper/IconFetcher.h"
+#include "../Helper/IdleTaskQueue.h"
+#include "../Helper/SharedPidl.h"
 #include "../Helper/ShellDropTargetWindow.h"
 #include "../Helper/WindowSubclassWrapper.h"
 #include <boost/parameter.hpp>
 #include <boost/signals2.hpp>
 #include <wil/com.h>
 #include <wil/resource.h>
+#include <chrono>
 #include <functional>
 #include <optional>
 #include <unordered_map>
+#include <unordered_set>
 
 class BookmarkTree;
 class CachedIcons;
@@ -31,6 +35,7 @@ BOOST_PARAMETER_NAME(name)
 BOOST_PARAMETER_NAME(index)
 BOOST_PARAMETER_NAME(selected)
 BOOST_PARAMETER_NAME(lockState)
+BOOST_PARAMETER_NAME(deferNavigation)
 
 // The use of Boost Parameter here allows values to be set by name
 // during construction. It would be better (and simpler) for this to be
@@ -45,12 +50,18 @@ struct TabSettingsImpl
 		lockState = args[_lockState | std::nullopt];
 		index = args[_index | std::nullopt];
 		selected = args[_selected | std::nullopt];
+		deferNavigation = args[_deferNavigation | std::nullopt];
 	}
 
 	std::optional<std::wstring> name;
 	std::optional<Tab::LockState> lockState;
 	std::optional<int> index;
 	std::optional<bool> selected;
+
+	// If set, the tab won't navigate to its folder until it's first selected. That allows
+	// background tabs (e.g. those restored from a previous session) to be created without having
+	// to enumerate their folders up front.
+	std::optional<bool> deferNavigation;
 };
 
 // Used when creating a tab.
@@ -66,6 +77,7 @@ struct TabSettings : TabSettingsImpl
 			(lockState, (Tab::LockState))
 			(index, (int))
 			(selected, (bool))
+			(deferNavigation, (bool))
 		)
 	)
 	// clang-format on
@@ -100,6 +112,7 @@ public:
 	int GetTabIndex(const Tab &tab) const;
 	int GetNumTabs() const;
 	int MoveTab(const Tab &tab, int newIndex);
+	void SetDeferredDirectory(Tab &tab, PCIDLIST_ABSOLUTE pidlDirectory);
 	void DuplicateTab(const Tab &tab);
 	bool CloseTab(const Tab &tab);
 
@@ -111,6 +124,27 @@ public:
 	const std::unordered_map<int, std::unique_ptr<Tab>> &GetAllTabs() const;
 	std::vector<std::reference_wrapper<const Tab>> GetAllTabsInOrder() const;
 
+	// Updates that are scheduled with a higher priority (i.e. earlier in this list) run first.
+	enum class SelectionUpdatePriority
+	{
+		// Controls that show the location of the selected tab (e.g. the address bar).
+		Navigation,
+
+		// Text that describes the selected tab (e.g. the status bar and window title).
+		Status,
+
+		// Anything that isn't directly visible in the main window.
+		Background
+	};
+
+	// When a tab is selected, its listview is shown first. Updates to other parts of the UI that
+	// reflect the selected tab can be scheduled here, so that they run once the listview has been
+	// painted (and are skipped while input is waiting). Each owner can only have one update
+	// queued, so switching through several tabs quickly will only update the UI for the final
+	// tab. The update is passed whichever tab is selected at the time it runs.
+	void ScheduleSelectionUpdate(const void *owner, SelectionUpdatePriority priority,
+		std::function<void(const Tab &tab)> update);
+
 	// Signals
 	SignalWrapper<TabContainer, void(int tabId, BOOL switchToNewTab)> tabCreatedSignal;
 	SignalWrapper<TabContainer, void(const Tab &tab, PCIDLIST_ABSOLUTE pidl)>
@@ -128,7 +162,14 @@ public:
 
 	SignalWrapper<TabContainer, void(const Tab &tab)> tabDirectoryModifiedSignal;
 	SignalWrapper<TabContainer, void(const Tab &tab)> tabListViewSelectionChangedSignal;
+	SignalWrapper<TabContainer, void(const Tab &tab)> tabListViewSelectionAttributesChangedSignal;
 	SignalWrapper<TabContainer, void(const Tab &tab)> tabColumnsChangedSignal;
+	SignalWrapper<TabContainer, void(const Tab &tab)> tabListViewScrolledSignal;
+	SignalWrapper<TabContainer, void(const Tab &tab)> tabPendingSortProgressChangedSignal;
+
+	// Raised once the icon for the folder shown in a tab has been retrieved in the background (at
+	// which point, it will also be present in the shared icon cache).
+	SignalWrapper<TabContainer, void(const Tab &tab, int systemIconIndex)> tabIconFetchedSignal;
 
 private:
 	enum class ScrollDirection
@@ -140,6 +181,8 @@ private:
 	static const UINT_PTR SUBCLASS_ID = 0;
 	static const UINT_PTR PARENT_SUBCLASS_ID = 0;
 
+	static const UINT WM_APP_PERFORM_DEFERRED_NAVIGATION = WM_APP + 1;
+
 	static const int ICON_SIZE_96DPI = 16;
 
 	static const UINT DROP_SWITCH_TAB_TIMER_ID = 1;
@@ -148,6 +191,18 @@ private:
 	static const UINT DROP_SCROLL_TIMER_ID = 2;
 	static const UINT DROP_SCROLL_TIMER_ELAPSE = 1000;
 
+	static const UINT HIBERNATION_TIMER_ID = 3;
+	static const UINT HIBERNATION_TIMER_ELAPSE = 60 * 1000;
+
+	// WM_TIMER messages are only retrieved once there's no input or painting waiting, so the
+	// selection updates run after the selected listview has been painted.
+	static const UINT SELECTION_UPDATE_TIMER_ID = 4;
+	static const UINT SELECTION_UPDATE_TIMER_ELAPSE = USER_TIMER_MINIMUM;
+
+	// Background tabs that haven't been selected in this period of time will have their folder
+	// contents released. The contents are reloaded when the tab is next selected.
+	static constexpr std::chrono::minutes TAB_HIBERNATION_TIMEOUT{ 30 };
+
 	static const LONG DROP_SCROLL_MARGIN_X_96DPI = 40;
 
 	TabContainer(HWND parent, TabNavigationInterface *tabNavigation, IExplorerplusplus *expp,
@@ -171,6 +226,9 @@ private:
 
 	void SetUpNewTab(Tab &tab, PCIDLIST_ABSOLUTE pidlDirectory, const TabSettings &tabSettings,
 		bool addHistoryEntry, int *newTabId);
+	void BrowseInitialFolder(Tab &tab, PCIDLIST_ABSOLUTE pidlDirectory, bool addHistoryEntry);
+	void PerformDeferredNavigation(int tabId);
+	void OnHibernationTimer();
 
 	void OnTabCtrlLButtonDown(POINT *pt);
 	void OnTabCtrlLButtonUp();
@@ -191,6 +249,7 @@ private:
 	void OnRenameTab(const Tab &tab);
 	void OnLockTab(Tab &tab);
 	void OnLockTabAndAddress(Tab &tab);
+	void OnCopyChangesFromSelectedTab(const Tab &tab);
 	void OnCloseOtherTabs(int index);
 	void OnCloseTabsToRight(int index);
 
@@ -202,6 +261,9 @@ private:
 	void OnTabRemoved(int tabId);
 
 	void OnTabSelected(const Tab &tab);
+	void OnSelectionUpdatesScheduled();
+	void OnSelectionUpdateTimer();
+	static bool IsInputWaiting();
 
 	void OnAlwaysShowTabBarUpdated(BOOL newValue);
 	void OnForceSameTabWidthUpdated(BOOL newValue);
@@ -237,6 +299,22 @@ private:
 
 	std::unordered_map<int, std::unique_ptr<Tab>> m_tabs;
 
+	// Tabs that haven't yet navigated to their initial folder, mapped to that folder.
+	std::unordered_map<int, SharedPidl> m_deferredNavigations;
+
+	// The time at which each background tab was last deselected.
+	std::unordered_map<int, std::chrono::steady_clock::time_point> m_tabDeselectionTimes;
+
+	// Tabs whose folder contents have been released. Selecting one of these tabs will reload its
+	// contents.
+	std::unordered_set<int> m_hibernatedTabs;
+
+	IdleTaskQueue m_selectionUpdateQueue;
+
+	// The time at which the current tab was selected. This is reset once the updates for the
+	// selection start running.
+	std::optional<std::chrono::steady_clock::time_point> m_tabSelectionTime;
+
 	IconFetcher m_iconFetcher;
 	CachedIcons *m_cachedIcons;
 	wil::com_ptr_nothrow<IImageList> m_systemImageList;
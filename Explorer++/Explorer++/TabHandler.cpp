@@ -11,14 +11,57 @@
 #include "ShellBrowser/ShellBrowser.h"
 #include "TabContainer.h"
 #include "TabRestorerUI.h"
+#include "TabSessionJournal.h"
 #include "../Helper/DpiCompatibility.h"
+#include "../Helper/Logging.h"
 #include "../Helper/Macros.h"
 #include <list>
+#include <unordered_map>
 
 static const UINT TAB_WINDOW_HEIGHT_96DPI = 24;
 
 extern std::vector<std::wstring> g_commandLineDirectories;
 
+namespace
+{
+
+TabSessionJournal::TabState CaptureTabSessionState(const Tab &tab)
+{
+	TabSessionJournal::TabState tabState;
+	tabState.tabId = tab.GetId();
+	tabState.directory =
+		TabSessionJournal::SerializePidl(tab.GetShellBrowser()->GetDirectoryIdl().get());
+	tabState.lockState = tab.GetLockState();
+
+	if (tab.GetUseCustomName())
+	{
+		tabState.customName = tab.GetName();
+	}
+
+	return tabState;
+}
+
+// "." and ".." are relative to the current directory.
+std::wstring ResolveCommandLineDirectory(const std::wstring &directory)
+{
+	if (directory != _T("..") && directory != _T("."))
+	{
+		return directory;
+	}
+
+	TCHAR szDirectory[MAX_PATH];
+	GetCurrentDirectory(SIZEOF_ARRAY(szDirectory), szDirectory);
+
+	if (directory == _T(".."))
+	{
+		PathRemoveFileSpec(szDirectory);
+	}
+
+	return szDirectory;
+}
+
+}
+
 void Explorerplusplus::InitializeTabs()
 {
 	/* The tab backing will hold the tab window. */
@@ -47,6 +90,12 @@ void Explorerplusplus::InitializeTabs()
 	m_tabContainer->tabListViewSelectionChangedSignal.AddObserver(
 		std::bind_front(&Explorerplusplus::OnTabListViewSelectionChanged, this),
 		boost::signals2::at_front);
+	m_tabContainer->tabListViewSelectionAttributesChangedSignal.AddObserver(
+		std::bind_front(&Explorerplusplus::OnTabListViewSelectionAttributesChanged, this),
+		boost::signals2::at_front);
+	m_tabContainer->tabPendingSortProgressChangedSignal.AddObserver(
+		std::bind_front(&Explorerplusplus::OnPendingSortProgressChangedStatusBar, this),
+		boost::signals2::at_front);
 
 	UINT dpi = DpiCompatibility::GetInstance().GetDpiForWindow(m_tabContainer->GetHWND());
 	int tabWindowHeight = MulDiv(TAB_WINDOW_HEIGHT_96DPI, dpi, USER_DEFAULT_SCREEN_DPI);
@@ -69,6 +118,19 @@ void Explorerplusplus::OnTabCreated(int tabId, BOOL switchToNewTab)
 	/* TODO: This subclass needs to be removed. */
 	SetWindowSubclass(tab.GetShellBrowser()->GetListView(), ListViewProcStub, 0,
 		reinterpret_cast<DWORD_PTR>(this));
+
+	tab.GetShellBrowser()->listViewChanged.AddObserver(
+		std::bind_front(&Explorerplusplus::OnTabListViewChanged, this));
+}
+
+void Explorerplusplus::OnTabListViewChanged(HWND previousListView, HWND newListView)
+{
+	SetWindowSubclass(newListView, ListViewProcStub, 0, reinterpret_cast<DWORD_PTR>(this));
+
+	if (m_hActiveListView == previousListView)
+	{
+		m_hActiveListView = newListView;
+	}
 }
 
 boost::signals2::connection Explorerplusplus::AddTabsInitializedObserver(
@@ -127,28 +189,15 @@ void Explorerplusplus::OnNewTab()
 
 HRESULT Explorerplusplus::RestoreTabs(ILoadSave *pLoadSave)
 {
-	TCHAR szDirectory[MAX_PATH];
 	int nTabsCreated = 0;
+	bool restoredPreviousTabs = false;
 
 	if (!g_commandLineDirectories.empty())
 	{
 		for (const auto &strDirectory : g_commandLineDirectories)
 		{
-			StringCchCopy(szDirectory, SIZEOF_ARRAY(szDirectory), strDirectory.c_str());
-
-			if (lstrcmp(strDirectory.c_str(), _T("..")) == 0)
-			{
-				/* Get the parent of the current directory,
-				and browse to it. */
-				GetCurrentDirectory(SIZEOF_ARRAY(szDirectory), szDirectory);
-				PathRemoveFileSpec(szDirectory);
-			}
-			else if (lstrcmp(strDirectory.c_str(), _T(".")) == 0)
-			{
-				GetCurrentDirectory(SIZEOF_ARRAY(szDirectory), szDirectory);
-			}
-
-			m_tabContainer->CreateNewTab(szDirectory, TabSettings(_selected = true));
+			m_tabContainer->CreateNewTab(
+				ResolveCommandLineDirectory(strDirectory).c_str(), TabSettings(_selected = true));
 			nTabsCreated++;
 		}
 	}
@@ -157,6 +206,7 @@ HRESULT Explorerplusplus::RestoreTabs(ILoadSave *pLoadSave)
 		if (m_config->startupMode == StartupMode::PreviousTabs)
 		{
 			nTabsCreated = pLoadSave->LoadPreviousTabs();
+			restoredPreviousTabs = true;
 		}
 	}
 
@@ -165,6 +215,8 @@ HRESULT Explorerplusplus::RestoreTabs(ILoadSave *pLoadSave)
 		m_tabContainer->CreateNewTabInDefaultDirectory(TabSettings(_selected = true));
 	}
 
+	InitializeTabSessionJournal(restoredPreviousTabs && nTabsCreated > 0);
+
 	if (!m_config->alwaysShowTabBar.get())
 	{
 		if (nTabsCreated == 1)
@@ -187,6 +239,209 @@ HRESULT Explorerplusplus::RestoreTabs(ILoadSave *pLoadSave)
 	return S_OK;
 }
 
+// Determines the folder that the first navigation will be to, in the same way as RestoreTabs(), so
+// that the folder can be read while the main window is being created. Restored tabs only navigate
+// once they're selected, so in that case, it's the tab that was last selected that's read.
+void Explorerplusplus::StartStartupFolderEnumeration(ILoadSave *pLoadSave)
+{
+	std::optional<std::wstring> directory;
+
+	if (!g_commandLineDirectories.empty())
+	{
+		directory = ResolveCommandLineDirectory(g_commandLineDirectories[0]);
+	}
+	else if (m_config->startupMode == StartupMode::PreviousTabs)
+	{
+		directory = pLoadSave->LoadPreviousTabDirectory(m_iLastSelectedTab);
+
+		if (!directory)
+		{
+			directory = pLoadSave->LoadPreviousTabDirectory(0);
+		}
+	}
+
+	if (!directory)
+	{
+		directory = m_config->defaultTabDirectory;
+	}
+
+	ShellBrowser::StartStartupFolderEnumeration(*directory);
+}
+
+// The records in the journal describe changes made to the tabs that were last saved. If those are
+// the tabs that have just been restored, any changes that weren't saved (e.g. because the
+// application exited unexpectedly) are recovered from the journal and recording continues from
+// there. Otherwise, recording starts once the current tabs have been saved in full.
+void Explorerplusplus::InitializeTabSessionJournal(bool tabsMatchSavedSession)
+{
+	auto tabSessionJournal = std::make_unique<TabSessionJournal>(
+		GetCacheFilePath(NExplorerplusplus::TAB_SESSION_JOURNAL_FILENAME));
+
+	if (!tabSessionJournal->IsOpen())
+	{
+		return;
+	}
+
+	m_tabSessionJournal = std::move(tabSessionJournal);
+
+	if (!tabsMatchSavedSession)
+	{
+		return;
+	}
+
+	ReplayTabSessionJournal();
+	StartTabSessionJournal();
+}
+
+void Explorerplusplus::ReplayTabSessionJournal()
+{
+	std::vector<TabSessionJournal::TabState> tabStates;
+	std::unordered_map<int, std::vector<BYTE>> restoredDirectories;
+
+	for (auto tabRef : m_tabContainer->GetAllTabsInOrder())
+	{
+		auto tabState = CaptureTabSessionState(tabRef.get());
+		restoredDirectories[tabState.tabId] = tabState.directory;
+		tabStates.push_back(std::move(tabState));
+	}
+
+	size_t numRecordsApplied = m_tabSessionJournal->Replay(tabStates);
+
+	if (numRecordsApplied == 0)
+	{
+		return;
+	}
+
+	LOG(info) << L"Replayed " << numRecordsApplied << L" tab session journal records";
+
+	// Tabs are opened before any are closed, so that there's always a tab left open.
+	std::unordered_set<int> remainingTabIds;
+
+	for (auto &tabState : tabStates)
+	{
+		if (tabState.tabId != -1)
+		{
+			remainingTabIds.insert(tabState.tabId);
+			continue;
+		}
+
+		m_tabContainer->CreateNewTab(
+			reinterpret_cast<PCIDLIST_ABSOLUTE>(tabState.directory.data()),
+			TabSettings(_name = tabState.customName, _lockState = tabState.lockState,
+				_deferNavigation = true),
+			nullptr, std::nullopt, &tabState.tabId);
+	}
+
+	for (const auto &[tabId, directory] : restoredDirectories)
+	{
+		if (remainingTabIds.contains(tabId))
+		{
+			continue;
+		}
+
+		Tab &tab = m_tabContainer->GetTab(tabId);
+		tab.SetLockState(Tab::LockState::NotLocked);
+		m_tabContainer->CloseTab(tab);
+	}
+
+	int index = 0;
+
+	for (const auto &tabState : tabStates)
+	{
+		Tab *tab = m_tabContainer->GetTabOptional(tabState.tabId);
+
+		if (!tab)
+		{
+			continue;
+		}
+
+		m_tabContainer->MoveTab(*tab, index++);
+
+		auto itr = restoredDirectories.find(tabState.tabId);
+
+		if (itr == restoredDirectories.end())
+		{
+			continue;
+		}
+
+		if (itr->second != tabState.directory)
+		{
+			m_tabContainer->SetDeferredDirectory(
+				*tab, reinterpret_cast<PCIDLIST_ABSOLUTE>(tabState.directory.data()));
+		}
+
+		if (!tabState.customName.empty())
+		{
+			tab->SetCustomName(tabState.customName);
+		}
+		else if (tab->GetUseCustomName())
+		{
+			tab->ClearCustomName();
+		}
+
+		tab->SetLockState(tabState.lockState);
+	}
+}
+
+// Tabs are only journaled once their creation has been recorded. A new tab navigates to its
+// initial folder before it's announced, so that navigation is captured by the creation record.
+void Explorerplusplus::StartTabSessionJournal()
+{
+	for (auto tabRef : m_tabContainer->GetAllTabsInOrder())
+	{
+		m_tabSessionTabIds.insert(tabRef.get().GetId());
+	}
+
+	m_tabSessionConnections.push_back(m_tabContainer->tabCreatedSignal.AddObserver(
+		[this](int tabId, BOOL switchToNewTab) {
+			UNREFERENCED_PARAMETER(switchToNewTab);
+
+			const Tab &tab = m_tabContainer->GetTab(tabId);
+			m_tabSessionJournal->RecordTabCreated(
+				m_tabContainer->GetTabIndex(tab), CaptureTabSessionState(tab));
+			m_tabSessionTabIds.insert(tabId);
+		}));
+
+	m_tabSessionConnections.push_back(m_tabContainer->tabNavigationCommittedSignal.AddObserver(
+		[this](const Tab &tab, PCIDLIST_ABSOLUTE pidl, bool addHistoryEntry) {
+			UNREFERENCED_PARAMETER(addHistoryEntry);
+
+			if (m_tabSessionTabIds.contains(tab.GetId()))
+			{
+				m_tabSessionJournal->RecordTabNavigated(
+					m_tabContainer->GetTabIndex(tab), TabSessionJournal::SerializePidl(pidl));
+			}
+		}));
+
+	m_tabSessionConnections.push_back(m_tabContainer->tabUpdatedSignal.AddObserver(
+		[this](const Tab &tab, Tab::PropertyType propertyType) {
+			UNREFERENCED_PARAMETER(propertyType);
+
+			if (m_tabSessionTabIds.contains(tab.GetId()))
+			{
+				auto tabState = CaptureTabSessionState(tab);
+				m_tabSessionJournal->RecordTabUpdated(
+					m_tabContainer->GetTabIndex(tab), tabState.customName, tabState.lockState);
+			}
+		}));
+
+	m_tabSessionConnections.push_back(m_tabContainer->tabMovedSignal.AddObserver(
+		[this](const Tab &tab, int fromIndex, int toIndex) {
+			if (m_tabSessionTabIds.contains(tab.GetId()))
+			{
+				m_tabSessionJournal->RecordTabMoved(fromIndex, toIndex);
+			}
+		}));
+
+	m_tabSessionConnections.push_back(
+		m_tabContainer->tabPreRemovalSignal.AddObserver([this](const Tab &tab) {
+			if (m_tabSessionTabIds.erase(tab.GetId()) > 0)
+			{
+				m_tabSessionJournal->RecordTabClosed(m_tabContainer->GetTabIndex(tab));
+			}
+		}));
+}
+
 void Explorerplusplus::OnTabSelected(const Tab &tab)
 {
 	/* Hide the old listview. */
@@ -202,7 +457,9 @@ void Explorerplusplus::OnTabSelected(const Tab &tab)
 	std::wstring directory = tab.GetShellBrowser()->GetDirectory();
 	SetCurrentDirectory(directory.c_str());
 
-	UpdateWindowStates(tab);
+	// The status bar and display window are updated once the listview has been shown.
+	m_tabContainer->ScheduleSelectionUpdate(this, TabContainer::SelectionUpdatePriority::Status,
+		std::bind_front(&Explorerplusplus::UpdateWindowStates, this));
 
 	/* Show the new listview. */
 	ShowWindow(m_hActiveListView, SW_SHOW);
@@ -262,6 +519,7 @@ void Explorerplusplus::OnTabListViewSelectionChanged(const Tab &tab)
 		if (item.iTabId == tab.GetId())
 		{
 			item.bValid = FALSE;
+			item.stopSource.request_stop();
 		}
 	}
 
@@ -272,6 +530,16 @@ void Explorerplusplus::OnTabListViewSelectionChanged(const Tab &tab)
 	}
 }
 
+void Explorerplusplus::OnTabListViewSelectionAttributesChanged(const Tab &tab)
+{
+	// The attributes of a large selection are retrieved in the background. Until they're
+	// available, the toolbar buttons that depend on them are disabled.
+	if (m_tabContainer->IsTabSelected(tab))
+	{
+		m_mainToolbar->UpdateToolbarButtonStates();
+	}
+}
+
 // TabNavigationInterface
 void Explorerplusplus::CreateNewTab(PCIDLIST_ABSOLUTE pidlDirectory, bool selected)
 {
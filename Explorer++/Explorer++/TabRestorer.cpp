@@ -4,7 +4,76 @@
 
 #include "stdafx.h"
 #include "TabRestorer.h"
+#include "ShellBrowser/PreservedHistoryEntry.h"
+#include "ShellBrowser/ShellBrowser.h"
+#include "ShellBrowser/ShellNavigationController.h"
 #include "TabContainer.h"
+#include <fstream>
+#include <unordered_map>
+
+namespace
+{
+
+// Limits used when loading, so that a corrupt file can't result in excessive allocations.
+const uint32_t MAX_LOADED_NODES = 100000;
+const uint32_t MAX_LOADED_HISTORY_ENTRIES = 10000;
+const uint32_t MAX_LOADED_STRING_SIZE = 32 * 1024;
+
+template <typename T>
+void WriteValue(std::ofstream &stream, const T &value)
+{
+	stream.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+void WriteString(std::ofstream &stream, const std::wstring &value)
+{
+	WriteValue(stream, static_cast<uint32_t>(value.size()));
+	stream.write(reinterpret_cast<const char *>(value.data()), value.size() * sizeof(wchar_t));
+}
+
+void WriteBytes(std::ofstream &stream, const std::vector<BYTE> &value)
+{
+	WriteValue(stream, static_cast<uint32_t>(value.size()));
+	stream.write(reinterpret_cast<const char *>(value.data()), value.size());
+}
+
+template <typename T>
+bool ReadValue(std::ifstream &stream, T &value)
+{
+	stream.read(reinterpret_cast<char *>(&value), sizeof(value));
+	return stream.good();
+}
+
+bool ReadString(std::ifstream &stream, std::wstring &value)
+{
+	uint32_t size;
+
+	if (!ReadValue(stream, size) || size > MAX_LOADED_STRING_SIZE)
+	{
+		return false;
+	}
+
+	value.resize(size);
+	stream.read(reinterpret_cast<char *>(value.data()), size * sizeof(wchar_t));
+	return stream.good();
+}
+
+bool ReadBytes(std::ifstream &stream, std::vector<BYTE> &value)
+{
+	uint32_t size;
+
+	// Item IDs are limited in size by the USHORT size field they start with.
+	if (!ReadValue(stream, size) || size > USHRT_MAX)
+	{
+		return false;
+	}
+
+	value.resize(size);
+	stream.read(reinterpret_cast<char *>(value.data()), size);
+	return stream.good();
+}
+
+}
 
 TabRestorer::TabRestorer(TabContainer *tabContainer) : m_tabContainer(tabContainer)
 {
@@ -14,8 +83,54 @@ TabRestorer::TabRestorer(TabContainer *tabContainer) : m_tabContainer(tabContain
 
 void TabRestorer::OnTabPreRemoval(const Tab &tab)
 {
-	auto closedTab = std::make_unique<PreservedTab>(tab, m_tabContainer->GetTabIndex(tab));
+	// A tab whose navigation was deferred and that was never selected has no history, so there's
+	// nothing that could be restored.
+	if (tab.GetShellBrowser()->GetNavigationController()->GetNumHistoryEntries() == 0)
+	{
+		return;
+	}
+
+	auto closedTab =
+		std::make_unique<PreservedTab>(tab, m_tabContainer->GetTabIndex(tab), m_pidlStore);
 	m_closedTabs.insert(m_closedTabs.begin(), std::move(closedTab));
+
+	EnforceLimits();
+}
+
+void TabRestorer::EnforceLimits()
+{
+	if (m_closedTabs.size() > MAX_CLOSED_TABS)
+	{
+		m_closedTabs.resize(MAX_CLOSED_TABS);
+	}
+
+	// The most recently closed tab is always retained, even if it exceeds the memory limit by
+	// itself.
+	while (m_closedTabs.size() > 1 && CalculateMemoryUsage() > MAX_MEMORY_USAGE)
+	{
+		m_closedTabs.pop_back();
+	}
+}
+
+size_t TabRestorer::CalculateMemoryUsage() const
+{
+	std::vector<SharedPidlStore::Handle> pidls;
+	size_t memoryUsage = 0;
+
+	for (const auto &closedTab : m_closedTabs)
+	{
+		memoryUsage += sizeof(PreservedTab) + (closedTab->customName.capacity() * sizeof(wchar_t))
+			+ (closedTab->preservedFolderState.folderSettings.filter.capacity() * sizeof(wchar_t));
+
+		for (const auto &entry : closedTab->history)
+		{
+			memoryUsage += sizeof(PreservedHistoryEntry)
+				+ (entry->displayName.capacity() * sizeof(wchar_t));
+			pidls.push_back(entry->pidl);
+		}
+	}
+
+	return memoryUsage + SharedPidlStore::CalculateMemoryUsage(pidls);
 }
 
 const std::vector<std::unique_ptr<PreservedTab>> &TabRestorer::GetClosedTabs() const
@@ -52,4 +167,214 @@ void TabRestorer::RestoreTabById(int id)
 	auto closedTab = itr->get();
 	m_tabContainer->CreateNewTab(*closedTab);
 	m_closedTabs.erase(itr);
+}
+
+bool TabRestorer::LoadFromFile(const std::wstring &filePath)
+{
+	std::ifstream stream(filePath, std::ios::binary);
+
+	if (!stream)
+	{
+		return false;
+	}
+
+	uint32_t signature;
+	uint32_t version;
+	uint32_t numNodes;
+
+	if (!ReadValue(stream, signature) || signature != FILE_SIGNATURE
+		|| !ReadValue(stream, version) || version != FILE_VERSION
+		|| !ReadValue(stream, numNodes) || numNodes > MAX_LOADED_NODES)
+	{
+		return false;
+	}
+
+	// Node 0 is the desktop. Each subsequent node refers to a parent that appears before it.
+	std::vector<SharedPidlStore::Handle> nodes = { m_pidlStore.GetRoot() };
+
+	for (uint32_t i = 0; i < numNodes; i++)
+	{
+		uint32_t parentIndex;
+		std::vector<BYTE> itemId;
+
+		if (!ReadValue(stream, parentIndex) || parentIndex >= nodes.size()
+			|| !ReadBytes(stream, itemId))
+		{
+			return false;
+		}
+
+		auto node = m_pidlStore.GetOrCreateChild(nodes[parentIndex], itemId);
+
+		if (!node)
+		{
+			return false;
+		}
+
+		nodes.push_back(node);
+	}
+
+	uint32_t numTabs;
+
+	if (!ReadValue(stream, numTabs) || numTabs > MAX_CLOSED_TABS)
+	{
+		return false;
+	}
+
+	std::vector<std::unique_ptr<PreservedTab>> loadedTabs;
+
+	for (uint32_t i = 0; i < numTabs; i++)
+	{
+		int index;
+		int currentEntry;
+		bool useCustomName;
+		std::wstring customName;
+		int lockState;
+		int sortMode;
+		int viewMode;
+		BOOL autoArrange;
+		BOOL sortAscending;
+		BOOL showInGroups;
+		BOOL showHidden;
+		BOOL applyFilter;
+		BOOL filterCaseSensitive;
+		std::wstring filter;
+		uint32_t numEntries;
+
+		if (!ReadValue(stream, index) || !ReadValue(stream, currentEntry)
+			|| !ReadValue(stream, useCustomName) || !ReadString(stream, customName)
+			|| !ReadValue(stream, lockState) || !ReadValue(stream, sortMode)
+			|| !ReadValue(stream, viewMode) || !ReadValue(stream, autoArrange)
+			|| !ReadValue(stream, sortAscending) || !ReadValue(stream, showInGroups)
+			|| !ReadValue(stream, showHidden) || !ReadValue(stream, applyFilter)
+			|| !ReadValue(stream, filterCaseSensitive) || !ReadString(stream, filter)
+			|| !ReadValue(stream, numEntries) || numEntries == 0
+			|| numEntries > MAX_LOADED_HISTORY_ENTRIES)
+		{
+			return false;
+		}
+
+		if (currentEntry < 0 || static_cast<uint32_t>(currentEntry) >= numEntries
+			|| lockState < static_cast<int>(Tab::LockState::NotLocked)
+			|| lockState > static_cast<int>(Tab::LockState::AddressLocked)
+			|| !SortMode::_is_valid(sortMode) || !ViewMode::_is_valid(viewMode))
+		{
+			return false;
+		}
+
+		std::vector<std::unique_ptr<PreservedHistoryEntry>> history;
+
+		for (uint32_t j = 0; j < numEntries; j++)
+		{
+			uint32_t nodeIndex;
+			std::wstring displayName;
+
+			if (!ReadValue(stream, nodeIndex) || nodeIndex >= nodes.size()
+				|| !ReadString(stream, displayName))
+			{
+				return false;
+			}
+
+			history.push_back(std::make_unique<PreservedHistoryEntry>(nodes[nodeIndex], displayName));
+		}
+
+		FolderSettings folderSettings = { SortMode::_from_integral(sortMode),
+			ViewMode::_from_integral(viewMode), autoArrange, sortAscending, showInGroups,
+			showHidden, applyFilter, filterCaseSensitive, filter };
+
+		loadedTabs.push_back(std::make_unique<PreservedTab>(index, std::move(history),
+			currentEntry, useCustomName, customName, static_cast<Tab::LockState>(lockState),
+			folderSettings));
+	}
+
+	m_closedTabs.insert(m_closedTabs.end(), std::make_move_iterator(loadedTabs.begin()),
+		std::make_move_iterator(loadedTabs.end()));
+	EnforceLimits();
+
+	return true;
+}
+
+bool TabRestorer::SaveToFile(const std::wstring &filePath) const
+{
+	std::ofstream stream(filePath, std::ios::binary | std::ios::trunc);
+
+	if (!stream)
+	{
+		return false;
+	}
+
+	// Each node is only written once, so that the prefixes shared in memory are also shared within
+	// the file. Since nodes are added after their parents, a node can refer to its parent by index.
+	std::unordered_map<const SharedPidlStore::Node *, uint32_t> nodeIndexes;
+	std::vector<const SharedPidlStore::Node *> nodes;
+
+	auto addNode = [&nodeIndexes, &nodes](const SharedPidlStore::Node *node, auto &addNodeRef) {
+		if (!node->parent)
+		{
+			return 0U;
+		}
+
+		auto itr = nodeIndexes.find(node);
+
+		if (itr != nodeIndexes.end())
+		{
+			return itr->second;
+		}
+
+		addNodeRef(node->parent.get(), addNodeRef);
+
+		auto index = static_cast<uint32_t>(nodes.size() + 1);
+		nodeIndexes.insert({ node, index });
+		nodes.push_back(node);
+
+		return index;
+	};
+
+	for (const auto &closedTab : m_closedTabs)
+	{
+		for (const auto &entry : closedTab->history)
+		{
+			addNode(entry->pidl.get(), addNode);
+		}
+	}
+
+	WriteValue(stream, FILE_SIGNATURE);
+	WriteValue(stream, FILE_VERSION);
+	WriteValue(stream, static_cast<uint32_t>(nodes.size()));
+
+	for (const auto *node : nodes)
+	{
+		WriteValue(stream, node->parent->parent ? nodeIndexes.at(node->parent.get()) : 0U);
+		WriteBytes(stream, node->itemId);
+	}
+
+	WriteValue(stream, static_cast<uint32_t>(m_closedTabs.size()));
+
+	for (const auto &closedTab : m_closedTabs)
+	{
+		const auto &folderSettings = closedTab->preservedFolderState.folderSettings;
+
+		WriteValue(stream, closedTab->index);
+		WriteValue(stream, closedTab->currentEntry);
+		WriteValue(stream, closedTab->useCustomName);
+		WriteString(stream, closedTab->customName);
+		WriteValue(stream, static_cast<int>(closedTab->lockState));
+		WriteValue(stream, folderSettings.sortMode._to_integral());
+		WriteValue(stream, folderSettings.viewMode._to_integral());
+		WriteValue(stream, folderSettings.autoArrange);
+		WriteValue(stream, folderSettings.sortAscending);
+		WriteValue(stream, folderSettings.showInGroups);
+		WriteValue(stream, folderSettings.showHidden);
+		WriteValue(stream, folderSettings.applyFilter);
+		WriteValue(stream, folderSettings.filterCaseSensitive);
+		WriteString(stream, folderSettings.filter);
+		WriteValue(stream, static_cast<uint32_t>(closedTab->history.size()));
+
+		for (const auto &entry : closedTab->history)
+		{
+			WriteValue(stream, entry->pidl->parent ? nodeIndexes.at(entry->pidl.get()) : 0U);
+			WriteString(stream, entry->displayName);
+		}
+	}
+
+	return stream.good();
 }
\ No newline at end of file
@@ -6,10 +6,14 @@
 
 #include "PreservedTab.h"
 #include "../Helper/Macros.h"
+#include "../Helper/SharedPidlStore.h"
 #include <boost/signals2.hpp>
 
 class TabContainer;
 
+// Keeps track of recently closed tabs, so that they can be reopened. The list of closed tabs is
+// bounded, both in the number of tabs and in the (approximate) amount of memory used. Once either
+// limit is exceeded, the oldest tabs are discarded.
 class TabRestorer
 {
 public:
@@ -19,13 +23,27 @@ public:
 	void RestoreLastTab();
 	void RestoreTabById(int id);
 
+	// Used to retain the list of closed tabs across sessions. Any tabs loaded are placed after the
+	// tabs that have been closed in the current session.
+	bool LoadFromFile(const std::wstring &filePath);
+	bool SaveToFile(const std::wstring &filePath) const;
+
 private:
 	DISALLOW_COPY_AND_ASSIGN(TabRestorer);
 
+	static const size_t MAX_CLOSED_TABS = 50;
+	static const size_t MAX_MEMORY_USAGE = 2 * 1024 * 1024;
+
+	static constexpr uint32_t FILE_SIGNATURE = 0x54435845; // "EXCT"
+	static constexpr uint32_t FILE_VERSION = 1;
+
 	void OnTabPreRemoval(const Tab &tab);
+	void EnforceLimits();
+	size_t CalculateMemoryUsage() const;
 
 	TabContainer *m_tabContainer;
 	std::vector<boost::signals2::scoped_connection> m_connections;
 
+	SharedPidlStore m_pidlStore;
 	std::vector<std::unique_ptr<PreservedTab>> m_closedTabs;
 };
\ No newline at end of file
@@ -0,0 +1,452 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "TabSessionJournal.h"
+#include "../ThirdParty/cereal/archives/binary.hpp"
+#include "../ThirdParty/cereal/types/string.hpp"
+#include "../ThirdParty/cereal/types/vector.hpp"
+#include <algorithm>
+#include <sstream>
+
+namespace
+{
+
+// Each record is stored as its size, followed by the serialized record. A record that was only
+// partially written (e.g. because the application exited while it was being written) is detected
+// by its size and ignored, along with anything that follows it.
+using RecordSize = uint32_t;
+
+// The data read from the journal file can't be trusted, so a directory is only used if it's a
+// complete pidl (i.e. a sequence of item IDs, followed by a terminator).
+bool IsCompletePidl(const std::vector<BYTE> &data)
+{
+	size_t offset = 0;
+
+	while (data.size() - offset >= sizeof(USHORT))
+	{
+		USHORT size;
+		memcpy(&size, data.data() + offset, sizeof(size));
+
+		if (size == 0)
+		{
+			return offset + sizeof(size) == data.size();
+		}
+
+		if (size < sizeof(size) || size > data.size() - offset)
+		{
+			return false;
+		}
+
+		offset += size;
+	}
+
+	return false;
+}
+
+bool IsValidLockState(Tab::LockState lockState)
+{
+	return lockState == Tab::LockState::NotLocked || lockState == Tab::LockState::Locked
+		|| lockState == Tab::LockState::AddressLocked;
+}
+
+}
+
+template <class Archive>
+void TabSessionJournal::Record::serialize(Archive &archive)
+{
+	archive(sequenceNumber, type, index, toIndex, directory, customName, lockState);
+}
+
+TabSessionJournal::TabSessionJournal(const std::wstring &filePath) :
+	m_file(CreateFile(filePath.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_ALWAYS,
+		FILE_ATTRIBUTE_NORMAL, nullptr))
+{
+	if (!m_file)
+	{
+		return;
+	}
+
+	size_t validLength;
+	auto records = ReadRecords(ReadFileContents(), &validLength);
+
+	if (!records.empty())
+	{
+		m_lastSequenceNumber = records.back().sequenceNumber;
+	}
+
+	// Any partially written record is removed, so that it doesn't hide the records that are
+	// appended after it.
+	LARGE_INTEGER offset;
+	offset.QuadPart = validLength;
+
+	if (SetFilePointerEx(m_file.get(), offset, nullptr, FILE_BEGIN))
+	{
+		SetEndOfFile(m_file.get());
+	}
+}
+
+bool TabSessionJournal::IsOpen() const
+{
+	return static_cast<bool>(m_file);
+}
+
+size_t TabSessionJournal::Replay(std::vector<TabState> &tabs) const
+{
+	std::vector<Record> records;
+
+	{
+		std::scoped_lock lock(m_mutex);
+
+		if (!m_file)
+		{
+			return 0;
+		}
+
+		records = ReadRecords(ReadFileContents());
+	}
+
+	for (const auto &record : records)
+	{
+		ApplyRecord(record, tabs);
+	}
+
+	return records.size();
+}
+
+void TabSessionJournal::RecordTabCreated(int index, const TabState &tabState)
+{
+	Record record;
+	record.type = RecordType::Created;
+	record.index = index;
+	record.directory = tabState.directory;
+	record.customName = tabState.customName;
+	record.lockState = tabState.lockState;
+	AppendRecord(record);
+}
+
+void TabSessionJournal::RecordTabNavigated(int index, const std::vector<BYTE> &directory)
+{
+	Record record;
+	record.type = RecordType::Navigated;
+	record.index = index;
+	record.directory = directory;
+	AppendRecord(record);
+}
+
+void TabSessionJournal::RecordTabUpdated(
+	int index, const std::wstring &customName, Tab::LockState lockState)
+{
+	Record record;
+	record.type = RecordType::Updated;
+	record.index = index;
+	record.customName = customName;
+	record.lockState = lockState;
+	AppendRecord(record);
+}
+
+void TabSessionJournal::RecordTabMoved(int fromIndex, int toIndex)
+{
+	Record record;
+	record.type = RecordType::Moved;
+	record.index = fromIndex;
+	record.toIndex = toIndex;
+	AppendRecord(record);
+}
+
+void TabSessionJournal::RecordTabClosed(int index)
+{
+	Record record;
+	record.type = RecordType::Closed;
+	record.index = index;
+	AppendRecord(record);
+}
+
+uint64_t TabSessionJournal::GetLastSequenceNumber() const
+{
+	std::scoped_lock lock(m_mutex);
+	return m_lastSequenceNumber;
+}
+
+std::optional<std::chrono::steady_clock::time_point> TabSessionJournal::GetLastRecordTime() const
+{
+	std::scoped_lock lock(m_mutex);
+	return m_lastRecordTime;
+}
+
+// Since the journal file is held open, it can't be replaced. Instead, the remaining records are
+// rewritten at the start of the file and the file is then truncated.
+bool TabSessionJournal::Compact(uint64_t sequenceNumber)
+{
+	std::scoped_lock lock(m_mutex);
+
+	if (!m_file)
+	{
+		return false;
+	}
+
+	auto records = ReadRecords(ReadFileContents());
+
+	if (records.empty() || records.front().sequenceNumber > sequenceNumber)
+	{
+		return true;
+	}
+
+	std::string data;
+
+	for (const auto &record : records)
+	{
+		if (record.sequenceNumber > sequenceNumber)
+		{
+			data += SerializeRecord(record);
+		}
+	}
+
+	LARGE_INTEGER start = {};
+
+	if (!SetFilePointerEx(m_file.get(), start, nullptr, FILE_BEGIN))
+	{
+		return false;
+	}
+
+	if (!data.empty())
+	{
+		DWORD numBytesWritten;
+		BOOL res = WriteFile(m_file.get(), data.data(), static_cast<DWORD>(data.size()),
+			&numBytesWritten, nullptr);
+
+		if (!res || numBytesWritten != data.size())
+		{
+			return false;
+		}
+	}
+
+	return SetEndOfFile(m_file.get());
+}
+
+std::vector<BYTE> TabSessionJournal::SerializePidl(PCIDLIST_ABSOLUTE pidl)
+{
+	if (!pidl)
+	{
+		return {};
+	}
+
+	auto *data = reinterpret_cast<const BYTE *>(pidl);
+	return { data, data + ILGetSize(pidl) };
+}
+
+std::string TabSessionJournal::SerializeRecord(const Record &record)
+{
+	std::stringstream recordStream;
+
+	{
+		cereal::BinaryOutputArchive outputArchive(recordStream);
+		outputArchive(record);
+	}
+
+	std::string recordData = recordStream.str();
+	auto size = static_cast<RecordSize>(recordData.size());
+
+	std::string data(reinterpret_cast<const char *>(&size), sizeof(size));
+	data += recordData;
+
+	return data;
+}
+
+// Records are also expected to be numbered consecutively. That means that, if the application
+// exits while the journal is being compacted, the remains of the records that were being replaced
+// won't be mistaken for records that follow the rewritten ones.
+std::vector<TabSessionJournal::Record> TabSessionJournal::ReadRecords(
+	const std::string &data, size_t *validLength)
+{
+	std::vector<Record> records;
+	size_t offset = 0;
+
+	if (validLength)
+	{
+		*validLength = 0;
+	}
+
+	while (data.size() - offset >= sizeof(RecordSize))
+	{
+		RecordSize size;
+		memcpy(&size, data.data() + offset, sizeof(size));
+
+		if (data.size() - offset - sizeof(size) < size)
+		{
+			break;
+		}
+
+		std::stringstream recordStream(data.substr(offset + sizeof(size), size));
+		Record record;
+
+		// cereal reports malformed data by throwing.
+		try
+		{
+			cereal::BinaryInputArchive inputArchive(recordStream);
+			inputArchive(record);
+		}
+		catch (const std::exception &)
+		{
+			break;
+		}
+
+		if (!records.empty() && record.sequenceNumber != records.back().sequenceNumber + 1)
+		{
+			break;
+		}
+
+		records.push_back(std::move(record));
+
+		offset += sizeof(size) + size;
+
+		if (validLength)
+		{
+			*validLength = offset;
+		}
+	}
+
+	return records;
+}
+
+// Records that don't fit the tabs they're being applied to (e.g. because the tabs didn't load as
+// expected) are ignored.
+void TabSessionJournal::ApplyRecord(const Record &record, std::vector<TabState> &tabs)
+{
+	auto isValidIndex = [&tabs](int32_t index) {
+		return index >= 0 && static_cast<size_t>(index) < tabs.size();
+	};
+
+	switch (record.type)
+	{
+	case RecordType::Created:
+	{
+		if (!IsCompletePidl(record.directory) || !IsValidLockState(record.lockState))
+		{
+			return;
+		}
+
+		TabState tabState;
+		tabState.directory = record.directory;
+		tabState.customName = record.customName;
+		tabState.lockState = record.lockState;
+
+		auto index = std::clamp(record.index, 0, static_cast<int32_t>(tabs.size()));
+		tabs.insert(tabs.begin() + index, std::move(tabState));
+	}
+	break;
+
+	case RecordType::Navigated:
+		if (!isValidIndex(record.index) || !IsCompletePidl(record.directory))
+		{
+			return;
+		}
+
+		tabs[record.index].directory = record.directory;
+		break;
+
+	case RecordType::Updated:
+		if (!isValidIndex(record.index) || !IsValidLockState(record.lockState))
+		{
+			return;
+		}
+
+		tabs[record.index].customName = record.customName;
+		tabs[record.index].lockState = record.lockState;
+		break;
+
+	case RecordType::Moved:
+	{
+		if (!isValidIndex(record.index) || !isValidIndex(record.toIndex))
+		{
+			return;
+		}
+
+		auto tabState = std::move(tabs[record.index]);
+		tabs.erase(tabs.begin() + record.index);
+		tabs.insert(tabs.begin() + record.toIndex, std::move(tabState));
+	}
+	break;
+
+	case RecordType::Closed:
+		if (!isValidIndex(record.index))
+		{
+			return;
+		}
+
+		tabs.erase(tabs.begin() + record.index);
+		break;
+	}
+}
+
+// Must be called with the mutex held (or from the constructor).
+std::string TabSessionJournal::ReadFileContents() const
+{
+	LARGE_INTEGER fileSize;
+
+	if (!GetFileSizeEx(m_file.get(), &fileSize) || fileSize.QuadPart > MAX_FILE_SIZE)
+	{
+		return {};
+	}
+
+	LARGE_INTEGER start = {};
+
+	if (!SetFilePointerEx(m_file.get(), start, nullptr, FILE_BEGIN))
+	{
+		return {};
+	}
+
+	std::string data(static_cast<size_t>(fileSize.QuadPart), '\0');
+	DWORD numBytesRead;
+
+	if (!ReadFile(m_file.get(), data.data(), static_cast<DWORD>(data.size()), &numBytesRead,
+			nullptr))
+	{
+		return {};
+	}
+
+	data.resize(numBytesRead);
+
+	return data;
+}
+
+void TabSessionJournal::AppendRecord(Record &record)
+{
+	std::scoped_lock lock(m_mutex);
+
+	if (!m_file)
+	{
+		return;
+	}
+
+	LARGE_INTEGER end;
+	LARGE_INTEGER distance = {};
+
+	if (!SetFilePointerEx(m_file.get(), distance, &end, FILE_END))
+	{
+		return;
+	}
+
+	record.sequenceNumber = m_lastSequenceNumber + 1;
+	std::string data = SerializeRecord(record);
+
+	DWORD numBytesWritten;
+	BOOL res = WriteFile(
+		m_file.get(), data.data(), static_cast<DWORD>(data.size()), &numBytesWritten, nullptr);
+
+	if (!res || numBytesWritten != data.size())
+	{
+		// Any part of the record that was written is removed, so that it doesn't hide the records
+		// that are appended after it.
+		if (SetFilePointerEx(m_file.get(), end, nullptr, FILE_BEGIN))
+		{
+			SetEndOfFile(m_file.get());
+		}
+
+		return;
+	}
+
+	m_lastSequenceNumber = record.sequenceNumber;
+	m_lastRecordTime = std::chrono::steady_clock::now();
+}
\ No newline at end of file
@@ -0,0 +1,118 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "Tab.h"
+#include <wil/resource.h>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+// An append-only log of the changes made to the set of open tabs. A small record is appended to the
+// journal file each time a tab is opened, closed, moved, navigated, renamed or locked, which is
+// much cheaper than saving every tab in full. If the application exits before the tabs are next saved,
+// the tabs can be brought up to date by replaying the journal once the saved tabs have been
+// restored.
+//
+// Tabs are identified by their index, so the records only make sense when applied to the tabs as
+// they were saved. Once the tabs have been saved in full, the records up to that point are
+// redundant, and compacting the journal removes them.
+//
+// The journal file is held open, without sharing, for as long as the journal exists. That prevents
+// a second instance of the application from interleaving its own records with this instance's.
+class TabSessionJournal
+{
+public:
+	// The state of a single tab, as far as the journal is concerned.
+	struct TabState
+	{
+		// The ID of the tab this state was captured from, or -1 if the tab was opened by a replayed
+		// record.
+		int tabId = -1;
+
+		// The tab's folder, stored as the bytes of an absolute pidl.
+		std::vector<BYTE> directory;
+
+		// Empty if the tab doesn't have a custom name.
+		std::wstring customName;
+
+		Tab::LockState lockState = Tab::LockState::NotLocked;
+	};
+
+	explicit TabSessionJournal(const std::wstring &filePath);
+
+	// Returns false if the journal file couldn't be opened (e.g. because another instance has it
+	// open), in which case nothing will be recorded.
+	bool IsOpen() const;
+
+	// Applies the records in the journal to the specified tabs. Returns the number of records
+	// applied.
+	size_t Replay(std::vector<TabState> &tabs) const;
+
+	void RecordTabCreated(int index, const TabState &tabState);
+	void RecordTabNavigated(int index, const std::vector<BYTE> &directory);
+	void RecordTabUpdated(int index, const std::wstring &customName, Tab::LockState lockState);
+	void RecordTabMoved(int fromIndex, int toIndex);
+	void RecordTabClosed(int index);
+
+	// Records are numbered consecutively. The numbering continues from the records already in the
+	// journal file when this instance was created.
+	uint64_t GetLastSequenceNumber() const;
+
+	// The time at which this instance last appended a record, if it's appended any.
+	std::optional<std::chrono::steady_clock::time_point> GetLastRecordTime() const;
+
+	// Removes the records up to and including the specified sequence number from the journal file.
+	// Can be called from a background thread.
+	bool Compact(uint64_t sequenceNumber);
+
+	static std::vector<BYTE> SerializePidl(PCIDLIST_ABSOLUTE pidl);
+
+private:
+	enum class RecordType : uint8_t
+	{
+		Created = 0,
+		Navigated = 1,
+		Updated = 2,
+		Moved = 3,
+		Closed = 4
+	};
+
+	struct Record
+	{
+		uint64_t sequenceNumber = 0;
+		RecordType type = RecordType::Created;
+		int32_t index = 0;
+		int32_t toIndex = 0;
+		std::vector<BYTE> directory;
+		std::wstring customName;
+		Tab::LockState lockState = Tab::LockState::NotLocked;
+
+		template <class Archive>
+		void serialize(Archive &archive);
+	};
+
+	// The journal is compacted every time the tabs are saved, so it should never get close to this
+	// size. Anything larger is treated as being corrupt.
+	static constexpr LONGLONG MAX_FILE_SIZE = 64 * 1024 * 1024;
+
+	static std::string SerializeRecord(const Record &record);
+	static std::vector<Record> ReadRecords(
+		const std::string &data, size_t *validLength = nullptr);
+	static void ApplyRecord(const Record &record, std::vector<TabState> &tabs);
+
+	std::string ReadFileContents() const;
+	void AppendRecord(Record &record);
+
+	// Guards the journal file, which is appended to on the main thread and may be compacted on a
+	// background thread.
+	mutable std::mutex m_mutex;
+	wil::unique_hfile m_file;
+	uint64_t m_lastSequenceNumber = 0;
+	std::optional<std::chrono::steady_clock::time_point> m_lastRecordTime;
+};
\ No newline at end of file
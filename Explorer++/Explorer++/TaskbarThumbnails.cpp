@@ -4,7 +4,8 @@
 
 /*
  * The methods in this file manage the tab proxy windows. A tab
- * proxy is created when a taskbar thumbnail needs to be shown.
+ * proxy is created (in idle time) for each tab, once the taskbar
+ * button for the main window has been created.
  */
 
 #include "stdafx.h"
@@ -16,7 +17,10 @@
 #include "ResourceHelper.h"
 #include "ShellBrowser/ShellBrowser.h"
 #include "TabContainer.h"
+#include "../Helper/CachedIcons.h"
+#include "../Helper/ImageScaler.h"
 #include "../Helper/Macros.h"
+#include "../Helper/PriorityTaskScheduler.h"
 #include "../Helper/ProcessHelper.h"
 #include "../Helper/ShellHelper.h"
 #include "../Helper/WindowHelper.h"
@@ -29,6 +33,58 @@ namespace
 		TaskbarThumbnails *taskbarThumbnails;
 		int iTabId;
 	};
+
+	bool AreSizesEqual(const SIZE &size1, const SIZE &size2)
+	{
+		return size1.cx == size2.cx && size1.cy == size2.cy;
+	}
+
+	// Returns the largest size that fits within the maximum size, while maintaining the aspect
+	// ratio of the source.
+	std::pair<int, int> GetThumbnailSize(const SIZE &sourceSize, int maxWidth, int maxHeight)
+	{
+		int finalWidth;
+		int finalHeight;
+
+		/* If the current height of the main window
+		is less than the width, we'll create a thumbnail
+		of maximum width; else maximum height. */
+		if (((double) sourceSize.cx / (double) maxWidth)
+			> ((double) sourceSize.cy / (double) maxHeight))
+		{
+			finalWidth = maxWidth;
+			finalHeight =
+				(int) ceil(maxWidth * ((double) sourceSize.cy / (double) sourceSize.cx));
+		}
+		else
+		{
+			finalHeight = maxHeight;
+			finalWidth =
+				(int) ceil(maxHeight * ((double) sourceSize.cx / (double) sourceSize.cy));
+		}
+
+		return { std::clamp(finalWidth, 1, maxWidth), std::clamp(finalHeight, 1, maxHeight) };
+	}
+
+	// Creates a 32-bit top-down DIB section. Rows in a 32-bit DIB never need padding, so the
+	// returned pixels are stored contiguously, row by row.
+	wil::unique_hbitmap CreateCaptureBitmap(int width, int height, uint32_t **pixels)
+	{
+		BITMAPINFO bitmapInfo = {};
+		bitmapInfo.bmiHeader.biSize = sizeof(bitmapInfo.bmiHeader);
+		bitmapInfo.bmiHeader.biWidth = width;
+		bitmapInfo.bmiHeader.biHeight = -height;
+		bitmapInfo.bmiHeader.biPlanes = 1;
+		bitmapInfo.bmiHeader.biBitCount = 32;
+		bitmapInfo.bmiHeader.biCompression = BI_RGB;
+
+		void *bits = nullptr;
+		wil::unique_hbitmap bitmap(
+			CreateDIBSection(nullptr, &bitmapInfo, DIB_RGB_COLORS, &bits, nullptr, 0));
+		*pixels = static_cast<uint32_t *>(bits);
+
+		return bitmap;
+	}
 }
 
 TaskbarThumbnails *TaskbarThumbnails::Create(IExplorerplusplus *expp, TabContainer *tabContainer,
@@ -62,12 +118,15 @@ void TaskbarThumbnails::Initialize()
 	ChangeWindowMessageFilter(WM_DWMSENDICONICTHUMBNAIL, MSGFLT_ADD);
 	ChangeWindowMessageFilter(WM_DWMSENDICONICLIVEPREVIEWBITMAP, MSGFLT_ADD);
 
+	SHGetImageList(SHIL_SYSSMALL, IID_PPV_ARGS(&m_systemImageList));
+	m_defaultFolderIconIndex = GetDefaultFolderIconIndex();
+
 	/* Subclass the main window until the above message (TaskbarButtonCreated) is caught. */
 	SetWindowSubclass(
 		m_expp->GetMainWindow(), MainWndProcStub, 0, reinterpret_cast<DWORD_PTR>(this));
 
 	m_tabContainer->tabCreatedSignal.AddObserver(
-		std::bind_front(&TaskbarThumbnails::CreateTabProxy, this));
+		std::bind_front(&TaskbarThumbnails::OnTabCreated, this));
 	m_tabContainer->tabNavigationCommittedSignal.AddObserver(
 		std::bind_front(&TaskbarThumbnails::OnNavigationCommitted, this));
 	m_tabContainer->tabNavigationCompletedSignal.AddObserver(
@@ -76,6 +135,19 @@ void TaskbarThumbnails::Initialize()
 		std::bind_front(&TaskbarThumbnails::OnTabSelectionChanged, this));
 	m_tabContainer->tabRemovedSignal.AddObserver(
 		std::bind_front(&TaskbarThumbnails::RemoveTabProxy, this));
+	m_tabContainer->tabIconFetchedSignal.AddObserver(
+		std::bind_front(&TaskbarThumbnails::SetTabProxyIconFromSystemImageList, this));
+
+	// Thumbnails are cached, so any change to the contents of a tab needs to invalidate its
+	// thumbnail.
+	m_tabContainer->tabDirectoryModifiedSignal.AddObserver(
+		std::bind_front(&TaskbarThumbnails::InvalidateTaskbarThumbnailBitmap, this));
+	m_tabContainer->tabListViewSelectionChangedSignal.AddObserver(
+		std::bind_front(&TaskbarThumbnails::InvalidateTaskbarThumbnailBitmap, this));
+	m_tabContainer->tabColumnsChangedSignal.AddObserver(
+		std::bind_front(&TaskbarThumbnails::InvalidateTaskbarThumbnailBitmap, this));
+	m_tabContainer->tabListViewScrolledSignal.AddObserver(
+		std::bind_front(&TaskbarThumbnails::InvalidateTaskbarThumbnailBitmap, this));
 
 	m_connections.push_back(m_expp->AddApplicationShuttingDownObserver(
 		std::bind_front(&TaskbarThumbnails::OnApplicationShuttingDown, this)));
@@ -109,18 +181,8 @@ LRESULT CALLBACK TaskbarThumbnails::MainWndProc(HWND hwnd, UINT uMsg, WPARAM wPa
 		/* Add each of the jump list tasks. */
 		SetupJumplistTasks();
 
-		/* Register each of the tabs. */
-		for (auto itr = m_TabProxyList.begin(); itr != m_TabProxyList.end(); itr++)
-		{
-			const Tab &tab = m_tabContainer->GetTab(itr->iTabId);
-
-			BOOL bActive = m_tabContainer->IsTabSelected(tab);
-
-			RegisterTab(itr->hProxy, EMPTY_STRING, bActive);
-
-			UpdateTaskbarThumbnailTitle(tab);
-			SetTabProxyIcon(tab);
-		}
+		/* Create a proxy for each of the tabs. */
+		SchedulePendingTabProxies();
 
 		RemoveWindowSubclass(hwnd, MainWndProcStub, 0);
 
@@ -137,18 +199,26 @@ void TaskbarThumbnails::SetupJumplistTasks()
 
 	std::wstring name = ResourceHelper::LoadString(m_instance, IDS_TASKS_NEWTAB);
 
-	/* New tab task. */
-	JumpListTaskInformation jlti;
-	jlti.pszName = name.c_str();
-	jlti.pszPath = szCurrentProcess;
-	jlti.pszArguments = NExplorerplusplus::JUMPLIST_TASK_NEWTAB_ARGUMENT;
-	jlti.pszIconPath = szCurrentProcess;
-	jlti.iIcon = 1;
-
-	std::list<JumpListTaskInformation> taskList;
-	taskList.push_back(jlti);
-
-	AddJumpListTasks(taskList);
+	// Updating the jump list involves writing to the user's profile and can take a while, so it's
+	// done on a background thread, rather than on the UI thread during startup.
+	auto &backgroundTaskScheduler = ShellBrowser::GetBackgroundTaskScheduler();
+	backgroundTaskScheduler.SetOwnerTaskClass(this, TaskClass::Background);
+	backgroundTaskScheduler.PushTask(this, std::nullopt,
+		JUMPLIST_TASK_PRIORITY,
+		[name, currentProcess = std::wstring(szCurrentProcess)]() {
+			/* New tab task. */
+			JumpListTaskInformation jlti;
+			jlti.pszName = name.c_str();
+			jlti.pszPath = currentProcess.c_str();
+			jlti.pszArguments = NExplorerplusplus::JUMPLIST_TASK_NEWTAB_ARGUMENT;
+			jlti.pszIconPath = currentProcess.c_str();
+			jlti.iIcon = 1;
+
+			std::list<JumpListTaskInformation> taskList;
+			taskList.push_back(jlti);
+
+			AddJumpListTasks(taskList);
+		});
 }
 
 ATOM TaskbarThumbnails::RegisterTabProxyClass(const TCHAR *szClassName)
@@ -178,19 +248,81 @@ References:
 http://dotnet.dzone.com/news/windows-7-taskbar-tabbed
 http://channel9.msdn.com/learn/courses/Windows7/Taskbar/Win7TaskbarNative/Exercise-Experiment-with-the-New-Windows-7-Taskbar-Features/
 */
-void TaskbarThumbnails::CreateTabProxy(int iTabId, BOOL bSwitchToNewTab)
+void TaskbarThumbnails::OnTabCreated(int tabId, BOOL switchToNewTab)
 {
-	HWND hTabProxy;
-	TabProxyInfo tpi;
-	TCHAR szClassName[512];
-	ATOM aRet;
-	BOOL bValue = TRUE;
+	UNREFERENCED_PARAMETER(switchToNewTab);
 
 	if (!m_enabled)
 	{
 		return;
 	}
 
+	m_pendingTabProxies.push_back(tabId);
+	SchedulePendingTabProxies();
+}
+
+void TaskbarThumbnails::SchedulePendingTabProxies()
+{
+	// The proxies can't be registered until the taskbar button has been created, so there's no
+	// point creating them before then.
+	if (!m_bTaskbarInitialised || m_pendingTabProxies.empty())
+	{
+		return;
+	}
+
+	// A single proxy is created each time this runs, so that any input that arrives in the
+	// meantime can be processed before the next proxy is created.
+	m_tabContainer->ScheduleSelectionUpdate(&m_pendingTabProxies,
+		TabContainer::SelectionUpdatePriority::Background,
+		std::bind_front(&TaskbarThumbnails::CreateNextPendingTabProxy, this));
+}
+
+void TaskbarThumbnails::CreateNextPendingTabProxy(const Tab &selectedTab)
+{
+	auto isPending = [this](const Tab &tab) {
+		return std::ranges::find(m_pendingTabProxies, tab.GetId()) != m_pendingTabProxies.end();
+	};
+
+	// The selected tab is the one that's most likely to be looked at in the taskbar, so its proxy
+	// is created first. The rest are then created in tab order.
+	const Tab *nextTab = nullptr;
+
+	if (isPending(selectedTab))
+	{
+		nextTab = &selectedTab;
+	}
+	else
+	{
+		for (const Tab &tab : m_tabContainer->GetAllTabsInOrder())
+		{
+			if (isPending(tab))
+			{
+				nextTab = &tab;
+				break;
+			}
+		}
+	}
+
+	if (!nextTab)
+	{
+		m_pendingTabProxies.clear();
+		return;
+	}
+
+	std::erase(m_pendingTabProxies, nextTab->GetId());
+	CreateTabProxy(*nextTab);
+
+	SchedulePendingTabProxies();
+}
+
+void TaskbarThumbnails::CreateTabProxy(const Tab &tab)
+{
+	HWND hTabProxy;
+	TabProxyInfo tpi;
+	TCHAR szClassName[512];
+	ATOM aRet;
+	BOOL bValue = TRUE;
+
 	static int iCount = 0;
 
 	StringCchPrintf(szClassName, SIZEOF_ARRAY(szClassName), _T("Explorer++TabProxy%d"), iCount++);
@@ -201,7 +333,7 @@ void TaskbarThumbnails::CreateTabProxy(int iTabId, BOOL bSwitchToNewTab)
 	{
 		TabProxy *ptp = new TabProxy();
 		ptp->taskbarThumbnails = this;
-		ptp->iTabId = iTabId;
+		ptp->iTabId = tab.GetId();
 
 		hTabProxy = CreateWindow(szClassName, EMPTY_STRING, WS_OVERLAPPEDWINDOW, 0, 0, 0, 0,
 			nullptr, nullptr, GetModuleHandle(nullptr), (LPVOID) ptp);
@@ -213,18 +345,18 @@ void TaskbarThumbnails::CreateTabProxy(int iTabId, BOOL bSwitchToNewTab)
 
 			DwmSetWindowAttribute(hTabProxy, DWMWA_HAS_ICONIC_BITMAP, &bValue, sizeof(BOOL));
 
-			if (m_bTaskbarInitialised)
-			{
-				RegisterTab(hTabProxy, EMPTY_STRING, bSwitchToNewTab);
-			}
+			RegisterTab(hTabProxy, EMPTY_STRING, m_tabContainer->IsTabSelected(tab));
 
 			tpi.hProxy = hTabProxy;
-			tpi.iTabId = iTabId;
+			tpi.iTabId = tab.GetId();
 			tpi.atomClass = aRet;
 
 			m_TabProxyList.push_back(std::move(tpi));
 
-			const Tab &tab = m_tabContainer->GetTab(iTabId);
+			// Proxies aren't necessarily created in tab order, so this proxy needs to be placed
+			// before the proxies for any tabs that follow it.
+			UpdateTabProxyOrder(tab, hTabProxy);
+
 			SetTabProxyIcon(tab);
 			UpdateTaskbarThumbnailTitle(tab);
 		}
@@ -233,6 +365,8 @@ void TaskbarThumbnails::CreateTabProxy(int iTabId, BOOL bSwitchToNewTab)
 
 void TaskbarThumbnails::RemoveTabProxy(int iTabId)
 {
+	std::erase(m_pendingTabProxies, iTabId);
+
 	if (!m_bTaskbarInitialised)
 	{
 		return;
@@ -243,9 +377,9 @@ void TaskbarThumbnails::RemoveTabProxy(int iTabId)
 			return currentTabProxy.iTabId == iTabId;
 		});
 
+	// The tab may have been removed before its proxy was created.
 	if (tabProxy == m_TabProxyList.end())
 	{
-		assert(false);
 		return;
 	}
 
@@ -272,6 +406,7 @@ void TaskbarThumbnails::InvalidateTaskbarThumbnailBitmap(const Tab &tab)
 	{
 		if (itr->iTabId == tab.GetId())
 		{
+			itr->thumbnail.reset();
 			DwmInvalidateIconicBitmaps(itr->hProxy);
 			break;
 		}
@@ -293,6 +428,42 @@ void TaskbarThumbnails::RegisterTab(HWND hTabProxy, const TCHAR *szDisplayName,
 	}
 }
 
+void TaskbarThumbnails::UpdateTabProxyOrder(const Tab &tab, HWND tabProxy)
+{
+	int index = m_tabContainer->GetTabIndex(tab);
+	int nTabs = m_tabContainer->GetNumTabs();
+
+	// The proxy is placed before the proxy for the next tab that has one. If there's no such tab,
+	// the proxy is moved to the end.
+	HWND insertBefore = nullptr;
+
+	for (int i = index + 1; i < nTabs; i++)
+	{
+		const auto *nextTabProxy = GetTabProxy(m_tabContainer->GetTabByIndex(i).GetId());
+
+		if (nextTabProxy)
+		{
+			insertBefore = nextTabProxy->hProxy;
+			break;
+		}
+	}
+
+	m_pTaskbarList->SetTabOrder(tabProxy, insertBefore);
+}
+
+TaskbarThumbnails::TabProxyInfo *TaskbarThumbnails::GetTabProxy(int tabId)
+{
+	auto itr = std::find_if(m_TabProxyList.begin(), m_TabProxyList.end(),
+		[tabId](const TabProxyInfo &tabProxy) { return tabProxy.iTabId == tabId; });
+
+	if (itr == m_TabProxyList.end())
+	{
+		return nullptr;
+	}
+
+	return &*itr;
+}
+
 LRESULT CALLBACK TaskbarThumbnails::TabProxyWndProcStub(
 	HWND hwnd, UINT Msg, WPARAM wParam, LPARAM lParam)
 {
@@ -425,25 +596,68 @@ LRESULT CALLBACK TaskbarThumbnails::TabProxyWndProc(
 void TaskbarThumbnails::OnDwmSendIconicThumbnail(
 	HWND tabProxy, const Tab &tab, int maxWidth, int maxHeight)
 {
-	wil::unique_hbitmap hbmTab;
+	auto tabProxyInfo = std::find_if(m_TabProxyList.begin(), m_TabProxyList.end(),
+		[&tab](const TabProxyInfo &currentTabProxy) {
+			return currentTabProxy.iTabId == tab.GetId();
+		});
+
+	if (tabProxyInfo == m_TabProxyList.end())
+	{
+		assert(false);
+		return;
+	}
+
+	SIZE maxSize = { maxWidth, maxHeight };
 
 	/* If the main window is minimized, it won't be possible
 	to generate a thumbnail for any of the tabs. In that
-	case, use a static 'No Preview Available' bitmap. */
+	case, use the last thumbnail generated for the tab or,
+	if there isn't one, a static 'No Preview Available' bitmap. */
 	if (IsIconic(m_expp->GetMainWindow()))
 	{
-		hbmTab.reset(static_cast<HBITMAP>(LoadImage(GetModuleHandle(nullptr),
-			MAKEINTRESOURCE(IDB_NOPREVIEWAVAILABLE), IMAGE_BITMAP, 0, 0, 0)));
+		if (tabProxyInfo->thumbnail && AreSizesEqual(tabProxyInfo->thumbnailMaxSize, maxSize))
+		{
+			DwmSetIconicThumbnail(tabProxy, tabProxyInfo->thumbnail.get(), 0);
+		}
+		else
+		{
+			SendNoPreviewAvailableThumbnail(tabProxy, maxWidth, maxHeight);
+		}
 
-		SetBitmapDimensionEx(hbmTab.get(), 223, 130, nullptr);
+		return;
 	}
-	else
+
+	RECT rcMain;
+	GetClientRect(m_expp->GetMainWindow(), &rcMain);
+	SIZE sourceSize = { GetRectWidth(&rcMain), GetRectHeight(&rcMain) };
+
+	// DWM will ask for the thumbnail every time the taskbar button is hovered over, so the
+	// thumbnail for a background tab is only regenerated if the tab has changed since it was last
+	// captured. The selected tab is always regenerated, since it can be captured directly from the
+	// main window (which can change in ways that aren't tracked here).
+	if (!tabProxyInfo->thumbnail || m_tabContainer->IsTabSelected(tab)
+		|| !AreSizesEqual(tabProxyInfo->thumbnailMaxSize, maxSize)
+		|| !AreSizesEqual(tabProxyInfo->thumbnailSourceSize, sourceSize))
 	{
-		hbmTab = CaptureTabScreenshot(tab);
+		tabProxyInfo->thumbnail = CreateTabThumbnail(tab, maxWidth, maxHeight);
+		tabProxyInfo->thumbnailMaxSize = maxSize;
+		tabProxyInfo->thumbnailSourceSize = sourceSize;
 	}
 
-	SIZE currentSize;
-	GetBitmapDimensionEx(hbmTab.get(), &currentSize);
+	if (!tabProxyInfo->thumbnail)
+	{
+		return;
+	}
+
+	DwmSetIconicThumbnail(tabProxy, tabProxyInfo->thumbnail.get(), 0);
+}
+
+void TaskbarThumbnails::SendNoPreviewAvailableThumbnail(HWND tabProxy, int maxWidth, int maxHeight)
+{
+	wil::unique_hbitmap hbmTab(static_cast<HBITMAP>(LoadImage(GetModuleHandle(nullptr),
+		MAKEINTRESOURCE(IDB_NOPREVIEWAVAILABLE), IMAGE_BITMAP, 0, 0, 0)));
+
+	SIZE currentSize = { 223, 130 };
 
 	/* Shrink the bitmap. */
 	wil::unique_hdc_window hdc = wil::GetDC(m_expp->GetMainWindow());
@@ -453,23 +667,7 @@ void TaskbarThumbnails::OnDwmSendIconicThumbnail(
 
 	wil::unique_hdc hdcThumbnailSrc(CreateCompatibleDC(hdc.get()));
 
-	int finalWidth;
-	int finalHeight;
-
-	/* If the current height of the main window
-	is less than the width, we'll create a thumbnail
-	of maximum width; else maximum height. */
-	if (((double) currentSize.cx / (double) maxWidth)
-		> ((double) currentSize.cy / (double) maxHeight))
-	{
-		finalWidth = maxWidth;
-		finalHeight = (int) ceil(maxWidth * ((double) currentSize.cy / (double) currentSize.cx));
-	}
-	else
-	{
-		finalHeight = maxHeight;
-		finalWidth = (int) ceil(maxHeight * ((double) currentSize.cx / (double) currentSize.cy));
-	}
+	auto [finalWidth, finalHeight] = GetThumbnailSize(currentSize, maxWidth, maxHeight);
 
 	wil::unique_hbitmap hbmThumbnail;
 	Gdiplus::Color color(0, 0, 0);
@@ -488,77 +686,124 @@ void TaskbarThumbnails::OnDwmSendIconicThumbnail(
 	DwmSetIconicThumbnail(tabProxy, hbmThumbnail.get(), 0);
 }
 
-wil::unique_hbitmap TaskbarThumbnails::CaptureTabScreenshot(const Tab &tab)
+wil::unique_hbitmap TaskbarThumbnails::CreateTabThumbnail(
+	const Tab &tab, int maxWidth, int maxHeight)
 {
-	wil::unique_hdc_window hdc = wil::GetDC(m_expp->GetMainWindow());
-	wil::unique_hdc hdcSrc(CreateCompatibleDC(hdc.get()));
+	if (!CaptureTab(tab))
+	{
+		return nullptr;
+	}
 
-	RECT rcMain;
-	GetClientRect(m_expp->GetMainWindow(), &rcMain);
+	SIZE sourceSize = { m_windowCapture.width, m_windowCapture.height };
+	auto [finalWidth, finalHeight] = GetThumbnailSize(sourceSize, maxWidth, maxHeight);
 
-	/* Any bitmap sent back to the operating system will need to be in 32-bit
-	ARGB format. */
-	wil::unique_hbitmap hBitmap;
-	Gdiplus::Color color(0, 0, 0);
-	Gdiplus::Bitmap bi(GetRectWidth(&rcMain), GetRectHeight(&rcMain), PixelFormat32bppARGB);
-	bi.GetHBITMAP(color, &hBitmap);
+	// DownscaleImage() can only reduce the size of an image.
+	finalWidth = std::min(finalWidth, m_windowCapture.width);
+	finalHeight = std::min(finalHeight, m_windowCapture.height);
 
-	/* Draw the main window into the bitmap. */
-	auto mainWindowPreviousBitmap = wil::SelectObject(hdcSrc.get(), hBitmap.get());
-	BitBlt(hdcSrc.get(), 0, 0, GetRectWidth(&rcMain), GetRectHeight(&rcMain), hdc.get(), 0, 0,
-		SRCCOPY);
+	uint32_t *thumbnailPixels;
+	wil::unique_hbitmap thumbnail = CreateCaptureBitmap(finalWidth, finalHeight, &thumbnailPixels);
 
-	/* Now draw the tab onto the main window. */
-	RECT rcTab;
-	GetClientRect(tab.GetShellBrowser()->GetListView(), &rcTab);
+	if (!thumbnail)
+	{
+		return nullptr;
+	}
 
-	wil::unique_hdc_window hdcTab = wil::GetDC(tab.GetShellBrowser()->GetListView());
-	wil::unique_hdc hdcTabSrc(CreateCompatibleDC(hdcTab.get()));
-	wil::unique_hbitmap hbmTab(
-		CreateCompatibleBitmap(hdcTab.get(), GetRectWidth(&rcTab), GetRectHeight(&rcTab)));
+	DownscaleImage(m_windowCapture.pixels, m_windowCapture.width, m_windowCapture.height,
+		thumbnailPixels, finalWidth, finalHeight);
 
-	auto tabPreviousBitmap = wil::SelectObject(hdcTabSrc.get(), hbmTab.get());
+	// The alpha channel of pixels drawn by GDI is undefined, while DWM treats the thumbnail as
+	// ARGB, so every pixel is made fully opaque.
+	for (int i = 0; i < finalWidth * finalHeight; i++)
+	{
+		thumbnailPixels[i] |= 0xFF000000;
+	}
 
-	BOOL bVisible = IsWindowVisible(tab.GetShellBrowser()->GetListView());
+	return thumbnail;
+}
 
-	if (!bVisible)
+// Draws the main window, with the specified tab overlaid on top of it, into m_windowCapture.
+bool TaskbarThumbnails::CaptureTab(const Tab &tab)
+{
+	HWND mainWindow = m_expp->GetMainWindow();
+
+	RECT rcMain;
+	GetClientRect(mainWindow, &rcMain);
+
+	if (!EnsureCaptureBuffer(m_windowCapture, GetRectWidth(&rcMain), GetRectHeight(&rcMain)))
 	{
-		ShowWindow(tab.GetShellBrowser()->GetListView(), SW_SHOW);
+		return false;
 	}
 
-	PrintWindow(tab.GetShellBrowser()->GetListView(), hdcTabSrc.get(), PW_CLIENTONLY);
+	wil::unique_hdc_window hdc = wil::GetDC(mainWindow);
+	wil::unique_hdc hdcWindowCapture(CreateCompatibleDC(hdc.get()));
 
-	if (!bVisible)
+	/* Draw the main window into the bitmap. */
+	auto windowPreviousBitmap =
+		wil::SelectObject(hdcWindowCapture.get(), m_windowCapture.bitmap.get());
+	BitBlt(hdcWindowCapture.get(), 0, 0, m_windowCapture.width, m_windowCapture.height, hdc.get(),
+		0, 0, SRCCOPY);
+
+	HWND listView = tab.GetShellBrowser()->GetListView();
+
+	// The listview for the selected tab is visible and has been drawn as part of the main window
+	// above. The listviews for all other tabs are hidden, so they need to be drawn separately.
+	if (!IsWindowVisible(listView))
 	{
-		ShowWindow(tab.GetShellBrowser()->GetListView(), SW_HIDE);
+		RECT rcTab;
+		GetClientRect(listView, &rcTab);
+
+		if (!EnsureCaptureBuffer(m_tabCapture, GetRectWidth(&rcTab), GetRectHeight(&rcTab)))
+		{
+			return false;
+		}
+
+		wil::unique_hdc hdcTabCapture(CreateCompatibleDC(hdc.get()));
+		auto tabPreviousBitmap = wil::SelectObject(hdcTabCapture.get(), m_tabCapture.bitmap.get());
+
+		ShowWindow(listView, SW_SHOW);
+		PrintWindow(listView, hdcTabCapture.get(), PW_CLIENTONLY);
+		ShowWindow(listView, SW_HIDE);
+
+		/* Now draw the tab onto the main window. */
+		MapWindowPoints(listView, mainWindow, reinterpret_cast<LPPOINT>(&rcTab), 2);
+		BitBlt(hdcWindowCapture.get(), rcTab.left, rcTab.top, m_tabCapture.width,
+			m_tabCapture.height, hdcTabCapture.get(), 0, 0, SRCCOPY);
 	}
 
-	MapWindowPoints(tab.GetShellBrowser()->GetListView(), m_expp->GetMainWindow(),
-		reinterpret_cast<LPPOINT>(&rcTab), 2);
-	BitBlt(hdcSrc.get(), rcTab.left, rcTab.top, GetRectWidth(&rcTab), GetRectHeight(&rcTab),
-		hdcTabSrc.get(), 0, 0, SRCCOPY);
+	// GDI can batch drawing operations, so any pending operations need to be completed before the
+	// pixels are read directly.
+	GdiFlush();
 
-	/* Shrink the bitmap. */
-	wil::unique_hdc hdcThumbnailSrc(CreateCompatibleDC(hdc.get()));
+	return true;
+}
 
-	wil::unique_hbitmap hbmThumbnail;
-	Gdiplus::Bitmap bmpThumbnail(
-		GetRectWidth(&rcMain), GetRectHeight(&rcMain), PixelFormat32bppARGB);
-	bmpThumbnail.GetHBITMAP(color, &hbmThumbnail);
+bool TaskbarThumbnails::EnsureCaptureBuffer(CaptureBuffer &buffer, int width, int height)
+{
+	if (buffer.bitmap && buffer.width == width && buffer.height == height)
+	{
+		return true;
+	}
 
-	auto thumbnailPreviousBitmap = wil::SelectObject(hdcThumbnailSrc.get(), hbmThumbnail.get());
+	buffer = {};
 
-	/* Finally, shrink the full-scale bitmap down into a thumbnail. */
-	POINT pt;
-	SetStretchBltMode(hdcThumbnailSrc.get(), HALFTONE);
-	SetBrushOrgEx(hdcThumbnailSrc.get(), 0, 0, &pt);
-	BitBlt(hdcThumbnailSrc.get(), 0, 0, GetRectWidth(&rcMain), GetRectHeight(&rcMain), hdcSrc.get(),
-		0, 0, SRCCOPY);
+	if (width <= 0 || height <= 0)
+	{
+		return false;
+	}
 
-	SetBitmapDimensionEx(
-		hbmThumbnail.get(), GetRectWidth(&rcMain), GetRectHeight(&rcMain), nullptr);
+	buffer.bitmap = CreateCaptureBitmap(width, height, &buffer.pixels);
 
-	return hbmThumbnail;
+	if (!buffer.bitmap)
+	{
+		buffer.pixels = nullptr;
+		return false;
+	}
+
+	buffer.width = width;
+	buffer.height = height;
+
+	return true;
 }
 
 wil::unique_hbitmap TaskbarThumbnails::GetTabLivePreviewBitmap(const Tab &tab)
@@ -600,43 +845,42 @@ wil::unique_hbitmap TaskbarThumbnails::GetTabLivePreviewBitmap(const Tab &tab)
 
 void TaskbarThumbnails::OnTabSelectionChanged(const Tab &tab)
 {
-	if (!m_bTaskbarInitialised)
+	UNREFERENCED_PARAMETER(tab);
+
+	// Each thumbnail includes the main window, which shows the newly selected tab, so all of the
+	// cached thumbnails are now out of date.
+	for (TabProxyInfo &tabProxyInfo : m_TabProxyList)
 	{
-		return;
+		tabProxyInfo.thumbnail.reset();
 	}
 
-	for (const TabProxyInfo &tabProxyInfo : m_TabProxyList)
+	if (!m_bTaskbarInitialised)
 	{
-		if (tabProxyInfo.iTabId == tab.GetId())
-		{
-			int index = m_tabContainer->GetTabIndex(tab);
+		return;
+	}
 
-			int nTabs = m_tabContainer->GetNumTabs();
+	// The taskbar isn't part of the main window, so updating it can wait until everything else
+	// has been updated.
+	m_tabContainer->ScheduleSelectionUpdate(this,
+		TabContainer::SelectionUpdatePriority::Background,
+		std::bind_front(&TaskbarThumbnails::ActivateTabProxy, this));
+}
 
-			/* Potentially the tab may have swapped position, so
-			tell the taskbar to reposition it. */
-			if (index == (nTabs - 1))
-			{
-				m_pTaskbarList->SetTabOrder(tabProxyInfo.hProxy, nullptr);
-			}
-			else
-			{
-				const Tab &nextTab = m_tabContainer->GetTabByIndex(index + 1);
-
-				for (const TabProxyInfo &tabProxyInfoNext : m_TabProxyList)
-				{
-					if (tabProxyInfoNext.iTabId == nextTab.GetId())
-					{
-						m_pTaskbarList->SetTabOrder(tabProxyInfo.hProxy, tabProxyInfoNext.hProxy);
-						break;
-					}
-				}
-			}
+void TaskbarThumbnails::ActivateTabProxy(const Tab &tab)
+{
+	// If the tab doesn't have a proxy yet, it will be activated when the proxy is created.
+	const auto *tabProxyInfo = GetTabProxy(tab.GetId());
 
-			m_pTaskbarList->SetTabActive(tabProxyInfo.hProxy, m_expp->GetMainWindow(), 0);
-			break;
-		}
+	if (!tabProxyInfo)
+	{
+		return;
 	}
+
+	/* Potentially the tab may have swapped position, so
+	tell the taskbar to reposition it. */
+	UpdateTabProxyOrder(tab, tabProxyInfo->hProxy);
+
+	m_pTaskbarList->SetTabActive(tabProxyInfo->hProxy, m_expp->GetMainWindow(), 0);
 }
 
 void TaskbarThumbnails::OnNavigationCommitted(
@@ -675,29 +919,30 @@ void TaskbarThumbnails::UpdateTaskbarThumbnailTitle(const Tab &tab)
 
 void TaskbarThumbnails::SetTabProxyIcon(const Tab &tab)
 {
-	for (TabProxyInfo &tabProxyInfo : m_TabProxyList)
-	{
-		if (tabProxyInfo.iTabId == tab.GetId())
-		{
-			auto pidlDirectory = tab.GetShellBrowser()->GetDirectoryIdl();
+	/* TODO: The proxy icon may also be the lock icon, if
+	the tab is locked. */
+
+	// Retrieving the icon for a folder can be slow, so the icon is only taken from the shared
+	// cache here. If it isn't cached, the default folder icon is used until the tab container has
+	// fetched the icon in the background.
+	auto cachedIconIndex =
+		m_expp->GetCachedIcons()->findByPath(tab.GetShellBrowser()->GetDirectory());
+	SetTabProxyIconFromSystemImageList(tab, cachedIconIndex.value_or(m_defaultFolderIconIndex));
+}
 
-			/* TODO: The proxy icon may also be the lock icon, if
-			the tab is locked. */
-			SHFILEINFO shfi;
-			DWORD_PTR res = SHGetFileInfo((LPCTSTR) pidlDirectory.get(), 0, &shfi, sizeof(shfi),
-				SHGFI_PIDL | SHGFI_ICON | SHGFI_SMALLICON);
+void TaskbarThumbnails::SetTabProxyIconFromSystemImageList(const Tab &tab, int systemIconIndex)
+{
+	auto *tabProxyInfo = GetTabProxy(tab.GetId());
 
-			if (!res)
-			{
-				return;
-			}
+	if (!tabProxyInfo)
+	{
+		return;
+	}
 
-			tabProxyInfo.icon.reset(shfi.hIcon);
+	tabProxyInfo->icon.reset(ImageList_GetIcon(
+		reinterpret_cast<HIMAGELIST>(m_systemImageList.get()), systemIconIndex, ILD_NORMAL));
 
-			SetClassLongPtr(tabProxyInfo.hProxy, GCLP_HICONSM, (LONG_PTR) tabProxyInfo.icon.get());
-			break;
-		}
-	}
+	SetClassLongPtr(tabProxyInfo->hProxy, GCLP_HICONSM, (LONG_PTR) tabProxyInfo->icon.get());
 }
 
 void TaskbarThumbnails::OnApplicationShuttingDown()
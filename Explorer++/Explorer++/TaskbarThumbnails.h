@@ -7,7 +7,10 @@
 #include "Tab.h"
 #include "../Helper/Macros.h"
 #include <boost/signals2.hpp>
+#include <wil/com.h>
 #include <wil/resource.h>
+#include <cstdint>
+#include <vector>
 
 struct Config;
 __interface IExplorerplusplus;
@@ -28,8 +31,27 @@ private:
 		HWND hProxy;
 		int iTabId;
 		wil::unique_hicon icon;
+
+		// The last thumbnail generated for the tab. It's reused until the tab's contents change, or
+		// DWM requests a thumbnail for a different size (or a differently sized main window).
+		wil::unique_hbitmap thumbnail;
+		SIZE thumbnailMaxSize = {};
+		SIZE thumbnailSourceSize = {};
+	};
+
+	// A 32-bit top-down DIB section that windows are captured into. The pixels can be read directly,
+	// so the capture can be downscaled without any intermediate copies.
+	struct CaptureBuffer
+	{
+		wil::unique_hbitmap bitmap;
+		uint32_t *pixels = nullptr;
+		int width = 0;
+		int height = 0;
 	};
 
+	// The jump list isn't needed immediately, so it's set up behind any work that's visible.
+	static const int JUMPLIST_TASK_PRIORITY = 100;
+
 	TaskbarThumbnails(IExplorerplusplus *expp, TabContainer *tabContainer, HINSTANCE instance,
 		std::shared_ptr<Config> config);
 	~TaskbarThumbnails() = default;
@@ -44,17 +66,27 @@ private:
 	void Initialize();
 	void SetupJumplistTasks();
 	ATOM RegisterTabProxyClass(const TCHAR *szClassName);
-	void CreateTabProxy(int iTabId, BOOL bSwitchToNewTab);
+	void OnTabCreated(int tabId, BOOL switchToNewTab);
+	void SchedulePendingTabProxies();
+	void CreateNextPendingTabProxy(const Tab &selectedTab);
+	void CreateTabProxy(const Tab &tab);
 	void RegisterTab(HWND hTabProxy, const TCHAR *szDisplayName, BOOL bTabActive);
+	void UpdateTabProxyOrder(const Tab &tab, HWND tabProxy);
+	TabProxyInfo *GetTabProxy(int tabId);
 	void RemoveTabProxy(int iTabId);
 	void DestroyTabProxy(TabProxyInfo &tabProxy);
 	void OnDwmSendIconicThumbnail(HWND tabProxy, const Tab &tab, int maxWidth, int maxHeight);
-	wil::unique_hbitmap CaptureTabScreenshot(const Tab &tab);
+	void SendNoPreviewAvailableThumbnail(HWND tabProxy, int maxWidth, int maxHeight);
+	wil::unique_hbitmap CreateTabThumbnail(const Tab &tab, int maxWidth, int maxHeight);
+	bool CaptureTab(const Tab &tab);
+	static bool EnsureCaptureBuffer(CaptureBuffer &buffer, int width, int height);
 	wil::unique_hbitmap GetTabLivePreviewBitmap(const Tab &tab);
 	void OnTabSelectionChanged(const Tab &tab);
+	void ActivateTabProxy(const Tab &tab);
 	void OnNavigationCommitted(const Tab &tab, PCIDLIST_ABSOLUTE pidl, bool addHistoryEntry);
 	void OnNavigationCompleted(const Tab &tab);
 	void SetTabProxyIcon(const Tab &tab);
+	void SetTabProxyIconFromSystemImageList(const Tab &tab, int systemIconIndex);
 	void InvalidateTaskbarThumbnailBitmap(const Tab &tab);
 	void UpdateTaskbarThumbnailTitle(const Tab &tab);
 	void OnApplicationShuttingDown();
@@ -66,6 +98,21 @@ private:
 
 	ITaskbarList4 *m_pTaskbarList;
 	std::list<TabProxyInfo> m_TabProxyList;
+
+	// Creating a proxy involves registering a window class, creating a window and registering it
+	// with the taskbar. Doing that for every tab as it's created would add a significant amount of
+	// work to startup when a large number of tabs are restored, so the proxies are instead created
+	// one at a time, once the UI thread is idle. This contains the IDs of the tabs that don't have
+	// a proxy yet.
+	std::vector<int> m_pendingTabProxies;
+
+	wil::com_ptr_nothrow<IImageList> m_systemImageList;
+	int m_defaultFolderIconIndex = 0;
+
+	// These are reused between captures and only reallocated when the size of the main window (or
+	// listview) changes.
+	CaptureBuffer m_windowCapture;
+	CaptureBuffer m_tabCapture;
 	UINT m_uTaskbarButtonCreatedMessage;
 	BOOL m_bTaskbarInitialised;
 	BOOL m_enabled;
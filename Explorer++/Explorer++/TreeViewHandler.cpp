@@ -23,8 +23,15 @@
 #include "../Helper/Helper.h"
 #include "../Helper/Macros.h"
 #include "../Helper/ShellHelper.h"
+#include "../Helper/UniversalPathCache.h"
 
 #define TREEVIEW_FOLDER_OPEN_DELAY 500
+
+/* The treeview is only synchronized once navigation has
+settled, so that intermediate folders (e.g. when holding
+down backspace) aren't located. */
+#define TREEVIEW_SYNC_TIMER_ID 1
+#define TREEVIEW_SYNC_DELAY 150
 #define FOLDERS_TOOLBAR_CLOSE 6000
 
 LRESULT CALLBACK TreeViewHolderProcStub(
@@ -92,7 +99,7 @@ void Explorerplusplus::CreateFolderControls()
 		UNREFERENCED_PARAMETER(tabId);
 		UNREFERENCED_PARAMETER(switchToNewTab);
 
-		UpdateTreeViewSelection();
+		ScheduleTreeViewSelectionUpdate();
 	});
 
 	m_tabContainer->tabNavigationCommittedSignal.AddObserver(
@@ -101,19 +108,19 @@ void Explorerplusplus::CreateFolderControls()
 			UNREFERENCED_PARAMETER(pidl);
 			UNREFERENCED_PARAMETER(addHistoryEntry);
 
-			UpdateTreeViewSelection();
+			ScheduleTreeViewSelectionUpdate();
 		});
 
 	m_tabContainer->tabSelectedSignal.AddObserver([this](const Tab &tab) {
 		UNREFERENCED_PARAMETER(tab);
 
-		UpdateTreeViewSelection();
+		ScheduleTreeViewSelectionUpdate();
 	});
 
 	m_tabContainer->tabRemovedSignal.AddObserver([this](int tabId) {
 		UNREFERENCED_PARAMETER(tabId);
 
-		UpdateTreeViewSelection();
+		ScheduleTreeViewSelectionUpdate();
 	});
 }
 
@@ -255,12 +262,7 @@ void Explorerplusplus::OnTreeViewCopyItemPath() const
 
 void Explorerplusplus::OnTreeViewCopyUniversalPaths() const
 {
-	HTREEITEM hItem;
-	UNIVERSAL_NAME_INFO uni;
-	DWORD dwBufferSize;
-	DWORD dwRet;
-
-	hItem = TreeView_GetSelection(m_shellTreeView->GetHWND());
+	HTREEITEM hItem = TreeView_GetSelection(m_shellTreeView->GetHWND());
 
 	if (hItem != nullptr)
 	{
@@ -269,20 +271,11 @@ void Explorerplusplus::OnTreeViewCopyUniversalPaths() const
 		std::wstring fullFileName;
 		GetDisplayName(pidl.get(), SHGDN_FORPARSING, fullFileName);
 
-		dwBufferSize = sizeof(uni);
-		dwRet = WNetGetUniversalName(
-			fullFileName.c_str(), UNIVERSAL_NAME_INFO_LEVEL, (void **) &uni, &dwBufferSize);
+		std::wstring universalPath =
+			UniversalPathCache::GetInstance().GetUniversalPath(fullFileName);
 
 		BulkClipboardWriter clipboardWriter;
-
-		if (dwRet == NO_ERROR)
-		{
-			clipboardWriter.WriteText(uni.lpUniversalName);
-		}
-		else
-		{
-			clipboardWriter.WriteText(fullFileName);
-		}
+		clipboardWriter.WriteText(universalPath);
 	}
 }
 
@@ -323,6 +316,12 @@ void Explorerplusplus::OnTreeViewSelChanged(LPARAM lParam)
 
 		g_newSelectionItem = tvItem->hItem;
 
+		/* The user has chosen a folder, so any pending
+		synchronization (which would select a different
+		folder) is dropped. */
+		KillTimer(m_hHolder, TREEVIEW_SYNC_TIMER_ID);
+		m_shellTreeView->CancelLocateItemAsync();
+
 		if (m_config->treeViewDelayEnabled)
 		{
 			/* Schedule a folder change. This adds enough
@@ -370,7 +369,15 @@ LRESULT CALLBACK Explorerplusplus::TreeViewHolderProc(
 		return TreeViewHolderWindowNotifyHandler(hwnd, msg, wParam, lParam);
 
 	case WM_TIMER:
-		OnTreeViewHolderWindowTimer();
+		if (wParam == TREEVIEW_SYNC_TIMER_ID)
+		{
+			KillTimer(m_hHolder, TREEVIEW_SYNC_TIMER_ID);
+			UpdateTreeViewSelection();
+		}
+		else
+		{
+			OnTreeViewHolderWindowTimer();
+		}
 		break;
 	}
 
@@ -407,7 +414,8 @@ LRESULT CALLBACK Explorerplusplus::TreeViewHolderWindowNotifyHandler(
 
 			TreeView_HitTest(m_shellTreeView->GetHWND(), &tvht);
 
-			if ((tvht.flags & TVHT_NOWHERE) == 0)
+			if ((tvht.flags & TVHT_NOWHERE) == 0
+				&& !m_shellTreeView->IsLoadingPlaceholder(tvht.hItem))
 			{
 				OnTreeViewRightClick((WPARAM) tvht.hItem, (LPARAM) &ptCursor);
 			}
@@ -484,20 +492,20 @@ void Explorerplusplus::UpdateTreeViewSelection()
 	// When locating a folder in the treeview, each of the parent folders has to be enumerated. UNC
 	// paths are contained within the Network folder and that folder can take a significant amount
 	// of time to enumerate (e.g. 30 seconds).
-	// Therefore, locating a UNC path can take a non-trivial amount of time, as the Network folder
-	// will have to be enumerated first. As that work is all done on the main thread, the
-	// application will hang while the enumeration completes, something that's especially noticeable
-	// on startup.
+	// Although the enumeration happens in the background, the treeview would be left showing the
+	// Network folder loading for that time, so UNC paths aren't located at all.
 	// Note that mapped drives don't have that specific issue, as they're contained within the This
-	// PC folder. However, there is still the general problem that each parent folder has to be
-	// enumerated and all the work is done on the main thread.
-	if (!PathIsUNC(m_pActiveShellBrowser->GetDirectory().c_str()))
+	// PC folder.
+	if (PathIsUNC(m_pActiveShellBrowser->GetDirectory().c_str()))
 	{
-		HTREEITEM hItem =
-			m_shellTreeView->LocateItem(m_pActiveShellBrowser->GetDirectoryIdl().get());
+		m_shellTreeView->CancelLocateItemAsync();
+		return;
+	}
 
-		if (hItem != nullptr)
-		{
+	// The parent folders are expanded in the background, so the selection is only updated once
+	// the folder has been inserted.
+	m_shellTreeView->LocateItemAsync(
+		m_pActiveShellBrowser->GetDirectoryIdl().get(), [this](HTREEITEM hItem) {
 			/* TVN_SELCHANGED is NOT sent when the new selected
 			item is the same as the old selected item. It is only
 			sent when the two are different.
@@ -509,6 +517,18 @@ void Explorerplusplus::UpdateTreeViewSelection()
 			}
 
 			SendMessage(m_shellTreeView->GetHWND(), TVM_SELECTITEM, TVGN_CARET, (LPARAM) hItem);
-		}
+		});
+}
+
+// Navigations can happen in quick succession, so the treeview is only synchronized once the
+// current folder has stopped changing. Nothing is scheduled while the treeview is hidden; it's
+// synchronized when it's shown again.
+void Explorerplusplus::ScheduleTreeViewSelectionUpdate()
+{
+	if (!m_InitializationFinished.get() || !m_config->synchronizeTreeview || !m_config->showFolders)
+	{
+		return;
 	}
+
+	SetTimer(m_hHolder, TREEVIEW_SYNC_TIMER_ID, TREEVIEW_SYNC_DELAY, nullptr);
 }
\ No newline at end of file
@@ -8,6 +8,7 @@
 #include "ShellBrowser/ShellBrowser.h"
 #include "Tab.h"
 #include "TabContainer.h"
+#include "../Helper/ThemeResourceCache.h"
 
 UiTheming::UiTheming(IExplorerplusplus *expp, TabContainer *tabContainer) :
 	m_expp(expp),
@@ -18,6 +19,17 @@ UiTheming::UiTheming(IExplorerplusplus *expp, TabContainer *tabContainer) :
 		std::bind_front(&UiTheming::OnTabCreated, this)));
 }
 
+ThemeResourceCache &UiTheming::GetThemeResourceCache()
+{
+	static ThemeResourceCache themeResourceCache;
+	return themeResourceCache;
+}
+
+void UiTheming::OnThemeChanged()
+{
+	GetThemeResourceCache().Clear();
+}
+
 void UiTheming::OnTabCreated(int tabId, BOOL switchToNewTab)
 {
 	UNREFERENCED_PARAMETER(switchToNewTab);
@@ -9,12 +9,20 @@
 __interface IExplorerplusplus;
 class Tab;
 class TabContainer;
+class ThemeResourceCache;
 
 class UiTheming
 {
 public:
 	UiTheming(IExplorerplusplus *expp, TabContainer *tabContainer);
 
+	// The brushes, fonts and theme handles used to custom draw controls (in both the main window
+	// and dialogs) are shared through this cache.
+	static ThemeResourceCache &GetThemeResourceCache();
+
+	// Should be called when the system theme, or system metrics, change.
+	void OnThemeChanged();
+
 	bool SetListViewColors(COLORREF backgroundColor, COLORREF textColor);
 	void SetTreeViewColors(COLORREF backgroundColor, COLORREF textColor);
 
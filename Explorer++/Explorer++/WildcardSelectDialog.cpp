@@ -9,7 +9,6 @@
 #include "ResourceHelper.h"
 #include "ShellBrowser/ShellBrowser.h"
 #include "../Helper/BaseDialog.h"
-#include "../Helper/ListViewHelper.h"
 #include "../Helper/Macros.h"
 #include "../Helper/RegistrySettings.h"
 #include "../Helper/XMLSettings.h"
@@ -136,19 +135,7 @@ void WildcardSelectDialog::OnOk()
 
 void WildcardSelectDialog::SelectItems(TCHAR *szPattern)
 {
-	HWND hListView = m_pexpp->GetActiveListView();
-
-	int nItems = ListView_GetItemCount(hListView);
-
-	for (int i = 0; i < nItems; i++)
-	{
-		std::wstring filename = m_pexpp->GetActiveShellBrowser()->GetItemName(i);
-
-		if (CheckWildcardMatch(szPattern, filename.c_str(), FALSE) == 1)
-		{
-			ListViewHelper::SelectItem(hListView, i, m_bSelect);
-		}
-	}
+	m_pexpp->GetActiveShellBrowser()->SelectItemsMatchingPattern(szPattern, m_bSelect);
 }
 
 void WildcardSelectDialog::OnCancel()
@@ -11,6 +11,7 @@
 #include "CommandLine.h"
 #include "Console.h"
 #include "Explorer++_internal.h"
+#include "InstanceHandoff.h"
 #include "Logging.h"
 #include "MainResource.h"
 #include "ModelessDialogs.h"
@@ -18,6 +19,7 @@
 #include "XMLSettings.h"
 #include "../Helper/Logging.h"
 #include "../Helper/Macros.h"
+#include "../Helper/PerformanceTrace.h"
 #include "../Helper/ProcessHelper.h"
 #include "../ThirdParty/CLI11/CLI11.hpp"
 #include <boost/format.hpp>
@@ -47,6 +49,9 @@ HWND g_hwndSearch;
 HWND g_hwndRunScript;
 HWND g_hwndOptions;
 HWND g_hwndManageBookmarks;
+HWND g_hwndDiagnostics;
+HWND g_hwndDuplicateFiles;
+HWND g_hwndDiskUsage;
 
 TCHAR g_szLang[32];
 BOOL g_bForceLanguageLoad = FALSE;
@@ -132,6 +137,13 @@ int WINAPI WinMain(HINSTANCE hInstance,HINSTANCE hPrevInstance,
 
 	boost::log::core::get()->set_logging_enabled(enableLogging);
 
+	// If there's already an instance running that's willing to take the command line, there's no
+	// need to perform any of the initialization below.
+	if (InstanceHandoff::TryHandOffCommandLine())
+	{
+		return 0;
+	}
+
 	/* Initialize OLE, as well as the various window classes that
 	will be needed (listview, TreeView, comboboxex, etc.). */
 	INITCOMMONCONTROLSEX	ccEx;
@@ -172,6 +184,16 @@ int WINAPI WinMain(HINSTANCE hInstance,HINSTANCE hPrevInstance,
 
 	InitializeLogging(NExplorerplusplus::LOG_FILENAME);
 
+	auto loggingCleanup = wil::scope_exit([] {
+		ShutdownLogging();
+	});
+
+	RegisterPerformanceTraceProvider();
+
+	auto traceProviderCleanup = wil::scope_exit([] {
+		UnregisterPerformanceTraceProvider();
+	});
+
 	bool shouldExit = false;
 
 	/* Can't open folders that are children of the
@@ -180,77 +202,11 @@ int WINAPI WinMain(HINSTANCE hInstance,HINSTANCE hPrevInstance,
 	pass those folders to Windows Explorer, then exit. */
 	if(!g_commandLineDirectories.empty())
 	{
-		unique_pidl_absolute pidlControlPanel;
-		HRESULT hr = SHGetFolderLocation(nullptr,
-			CSIDL_CONTROLS, nullptr,0,wil::out_param(pidlControlPanel));
+		CommandLine::OpenControlPanelChildrenInExplorer(g_commandLineDirectories);
 
-		if(SUCCEEDED(hr))
+		if(g_commandLineDirectories.empty())
 		{
-			auto itr = g_commandLineDirectories.begin();
-
-			BOOL bControlPanelChild = FALSE;
-
-			while(itr != g_commandLineDirectories.end())
-			{
-				/* This could fail on a 64-bit version of Windows if the
-				executable is 32-bit, and the folder is 64-bit specific (as is
-				the case with some of the folders under the control panel). */
-				unique_pidl_absolute pidl;
-				hr = SHParseDisplayName(itr->c_str(), nullptr, wil::out_param(pidl), 0, nullptr);
-
-				bControlPanelChild = FALSE;
-
-				if(SUCCEEDED(hr))
-				{
-					if(ILIsParent(pidlControlPanel.get(),pidl.get(),FALSE) &&
-						!ArePidlsEquivalent(pidlControlPanel.get(),pidl.get()))
-					{
-						bControlPanelChild = TRUE;
-					}
-					else
-					{
-						unique_pidl_absolute pidlControlPanelCategory;
-						hr = SHParseDisplayName(CONTROL_PANEL_CATEGORY_VIEW, nullptr,
-							wil::out_param(pidlControlPanelCategory), 0, nullptr);
-
-						if (SUCCEEDED(hr))
-						{
-							if (ILIsParent(pidlControlPanelCategory.get(), pidl.get(), FALSE) &&
-								!ArePidlsEquivalent(pidlControlPanelCategory.get(), pidl.get()))
-							{
-								bControlPanelChild = TRUE;
-							}
-						}
-					}
-
-					if(bControlPanelChild)
-					{
-						TCHAR szExplorerPath[MAX_PATH];
-
-						MyExpandEnvironmentStrings(_T("%windir%\\explorer.exe"),
-							szExplorerPath,SIZEOF_ARRAY(szExplorerPath));
-
-						/* This is a child of the control panel,
-						so send it to Windows Explorer to open
-						directly. */
-						ShellExecute(nullptr,_T("open"),szExplorerPath,
-							itr->c_str(), nullptr,SW_SHOWNORMAL);
-
-						itr = g_commandLineDirectories.erase(itr);
-					}
-				}
-
-
-				if(!bControlPanelChild)
-				{
-					itr++;
-				}
-			}
-
-			if(g_commandLineDirectories.empty())
-			{
-				shouldExit = true;
-			}
+			shouldExit = true;
 		}
 	}
 
@@ -416,6 +372,9 @@ int WINAPI WinMain(HINSTANCE hInstance,HINSTANCE hPrevInstance,
 	g_hwndRunScript = nullptr;
 	g_hwndOptions = nullptr;
 	g_hwndManageBookmarks = nullptr;
+	g_hwndDiagnostics = nullptr;
+	g_hwndDuplicateFiles = nullptr;
+	g_hwndDiskUsage = nullptr;
 
 	MSG msg;
 
@@ -428,6 +387,9 @@ int WINAPI WinMain(HINSTANCE hInstance,HINSTANCE hPrevInstance,
 		if(!IsDialogMessage(g_hwndSearch,&msg) &&
 			!IsDialogMessage(g_hwndManageBookmarks,&msg) &&
 			!IsDialogMessage(g_hwndRunScript, &msg) &&
+			!IsDialogMessage(g_hwndDiagnostics, &msg) &&
+			!IsDialogMessage(g_hwndDuplicateFiles, &msg) &&
+			!IsDialogMessage(g_hwndDiskUsage, &msg) &&
 			!PropSheet_IsDialogMessage(g_hwndOptions,&msg))
 		{
 			if(!TranslateAccelerator(hwnd, g_hAccl,&msg))
@@ -10,6 +10,7 @@
 #include "DarkModeHelper.h"
 #include "IconResourceLoader.h"
 #include "MainToolbar.h"
+#include "QuickFilterBar.h"
 #include "ShellTreeView/ShellTreeView.h"
 #include "TabContainer.h"
 #include "ToolbarButtons.h"
@@ -131,6 +132,11 @@ void Explorerplusplus::SetListViewInitialPosition(HWND hListView)
 		}
 	}
 
+	if (m_quickFilterBar->IsShown())
+	{
+		indentTop += m_quickFilterBar->GetHeight();
+	}
+
 	int width = mainWindowWidth - indentLeft - indentRight;
 	int height = mainWindowHeight - indentTop - indentBottom;
 
@@ -160,6 +166,31 @@ void Explorerplusplus::ToggleFolders()
 	ResizeWindows();
 }
 
+void Explorerplusplus::CreateQuickFilterBar()
+{
+	m_quickFilterBar = QuickFilterBar::Create(m_hContainer, this);
+
+	m_connections.push_back(m_quickFilterBar->visibilityChangedSignal.AddObserver(
+		[this](bool shown)
+		{
+			UNREFERENCED_PARAMETER(shown);
+
+			ResizeWindows();
+		}));
+}
+
+void Explorerplusplus::ToggleQuickFilterBar()
+{
+	if (m_quickFilterBar->IsShown())
+	{
+		m_quickFilterBar->Hide();
+	}
+	else
+	{
+		m_quickFilterBar->Show();
+	}
+}
+
 void Explorerplusplus::UpdateLayout()
 {
 	RECT rc;
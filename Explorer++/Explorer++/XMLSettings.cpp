@@ -116,6 +116,13 @@ will need to be changed correspondingly. */
 #define HASH_DISPLAY_MIXED_FILES_AND_FOLDERS 1168704423
 #define HASH_USE_NATURAL_SORT_ORDER 528323501
 #define HASH_OPEN_TABS_IN_FOREGROUND 2957281235
+#define HASH_VIRTUAL_LISTVIEW_THRESHOLD 3010096
+#define HASH_PERSIST_FOLDER_SIZES 3061680153
+#define HASH_USE_GRID_RENDERER 4053865199
+#define HASH_USE_NATIVE_FILE_TRANSFERS 3829894577
+#define HASH_PERSIST_ICON_CACHE 3491607468
+#define HASH_PERSIST_CLOSED_TABS 2757051059
+#define HASH_FILE_TRANSFER_BANDWIDTH_LIMIT 1703375710
 
 struct ColumnXMLSaveData
 {
@@ -188,7 +195,9 @@ static ColumnXMLSaveData ColumnData[] = {
 	{ _T("MediaPublisher"), ColumnType::MediaPublisher },
 	{ _T("MediaWriter"), ColumnType::MediaWriter },
 	{ _T("MediaYear"), ColumnType::MediaYear },
-	{ _T("PrinterModel"), ColumnType::PrinterModel }
+	{ _T("PrinterModel"), ColumnType::PrinterModel },
+	{ _T("Checksum"), ColumnType::Checksum },
+	{ _T("RelativePath"), ColumnType::RelativePath }
 };
 // clang-format on
 
@@ -437,7 +446,7 @@ void Explorerplusplus::SaveGenericSettingsToXML(IXMLDOMDocument *pXMLDom, IXMLDO
 	NXMLSettings::AddWhiteSpaceToNode(pXMLDom, bstr_wsntt.get(), pe.get());
 	NXMLSettings::WriteStandardSetting(pXMLDom, pe.get(), _T("Setting"),
 		_T("AllowMultipleInstances"),
-		NXMLSettings::EncodeBoolValue(m_config->allowMultipleInstances));
+		NXMLSettings::EncodeBoolValue(m_config->allowMultipleInstances.get()));
 
 	NXMLSettings::AddWhiteSpaceToNode(pXMLDom, bstr_wsntt.get(), pe.get());
 	NXMLSettings::WriteStandardSetting(pXMLDom, pe.get(), _T("Setting"), _T("AlwaysOpenInNewTab"),
@@ -738,6 +747,37 @@ void Explorerplusplus::SaveGenericSettingsToXML(IXMLDOMDocument *pXMLDom, IXMLDO
 	NXMLSettings::WriteStandardSetting(pXMLDom, pe.get(), _T("Setting"), _T("OpenTabsInForeground"),
 		NXMLSettings::EncodeBoolValue(m_config->openTabsInForeground));
 
+	NXMLSettings::AddWhiteSpaceToNode(pXMLDom, bstr_wsntt.get(), pe.get());
+	NXMLSettings::WriteStandardSetting(pXMLDom, pe.get(), _T("Setting"),
+		_T("VirtualListViewThreshold"),
+		NXMLSettings::EncodeIntValue(m_config->virtualListViewThreshold));
+
+	NXMLSettings::AddWhiteSpaceToNode(pXMLDom, bstr_wsntt.get(), pe.get());
+	NXMLSettings::WriteStandardSetting(pXMLDom, pe.get(), _T("Setting"), _T("UseGridRenderer"),
+		NXMLSettings::EncodeBoolValue(m_config->useGridRenderer));
+
+	NXMLSettings::AddWhiteSpaceToNode(pXMLDom, bstr_wsntt.get(), pe.get());
+	NXMLSettings::WriteStandardSetting(pXMLDom, pe.get(), _T("Setting"), _T("PersistFolderSizes"),
+		NXMLSettings::EncodeBoolValue(m_config->persistFolderSizes));
+
+	NXMLSettings::AddWhiteSpaceToNode(pXMLDom, bstr_wsntt.get(), pe.get());
+	NXMLSettings::WriteStandardSetting(pXMLDom, pe.get(), _T("Setting"),
+		_T("UseNativeFileTransfers"),
+		NXMLSettings::EncodeBoolValue(m_config->useNativeFileTransfers));
+
+	NXMLSettings::AddWhiteSpaceToNode(pXMLDom, bstr_wsntt.get(), pe.get());
+	NXMLSettings::WriteStandardSetting(pXMLDom, pe.get(), _T("Setting"),
+		_T("FileTransferBandwidthLimit"),
+		NXMLSettings::EncodeIntValue(m_config->fileTransferBandwidthLimit));
+
+	NXMLSettings::AddWhiteSpaceToNode(pXMLDom, bstr_wsntt.get(), pe.get());
+	NXMLSettings::WriteStandardSetting(pXMLDom, pe.get(), _T("Setting"), _T("PersistIconCache"),
+		NXMLSettings::EncodeBoolValue(m_config->persistIconCache));
+
+	NXMLSettings::AddWhiteSpaceToNode(pXMLDom, bstr_wsntt.get(), pe.get());
+	NXMLSettings::WriteStandardSetting(pXMLDom, pe.get(), _T("Setting"), _T("PersistClosedTabs"),
+		NXMLSettings::EncodeBoolValue(m_config->persistClosedTabs));
+
 	auto bstr_wsnt = wil::make_bstr_nothrow(L"\n\t");
 	NXMLSettings::AddWhiteSpaceToNode(pXMLDom, bstr_wsnt.get(), pe.get());
 
@@ -789,6 +829,7 @@ int Explorerplusplus::LoadTabSettingsFromXML(IXMLDOMDocument *pXMLDom)
 			{
 				tabSettings.index = i;
 				tabSettings.selected = true;
+				tabSettings.deferNavigation = true;
 
 				long lChildNodes;
 				am->get_length(&lChildNodes);
@@ -906,6 +947,50 @@ int Explorerplusplus::LoadTabSettingsFromXML(IXMLDOMDocument *pXMLDom)
 	return nTabsCreated;
 }
 
+std::optional<std::wstring> Explorerplusplus::LoadTabDirectoryFromXML(
+	IXMLDOMDocument *pXMLDom, int index)
+{
+	if (!pXMLDom)
+	{
+		return std::nullopt;
+	}
+
+	wil::com_ptr_nothrow<IXMLDOMNodeList> pNodes;
+	auto bstr = wil::make_bstr_nothrow(L"//Tabs/*");
+	pXMLDom->selectNodes(bstr.get(), &pNodes);
+
+	if (!pNodes)
+	{
+		return std::nullopt;
+	}
+
+	wil::com_ptr_nothrow<IXMLDOMNode> pNode;
+	HRESULT hr = pNodes->get_item(index, &pNode);
+
+	if (hr != S_OK || !pNode)
+	{
+		return std::nullopt;
+	}
+
+	wil::com_ptr_nothrow<IXMLDOMNamedNodeMap> am;
+	hr = pNode->get_attributes(&am);
+
+	if (FAILED(hr) || !am)
+	{
+		return std::nullopt;
+	}
+
+	std::wstring directory;
+	hr = NXMLSettings::GetStringFromMap(am.get(), L"Directory", directory);
+
+	if (FAILED(hr))
+	{
+		return std::nullopt;
+	}
+
+	return directory;
+}
+
 void Explorerplusplus::SaveTabSettingsToXML(IXMLDOMDocument *pXMLDom, IXMLDOMElement *pRoot)
 {
 	auto bstr_wsnt = wil::make_bstr_nothrow(L"\n\t");
@@ -1101,11 +1186,6 @@ int Explorerplusplus::LoadColumnFromXML(IXMLDOMNode *pNode, std::vector<Column_t
 	return iColumnType;
 }
 
-void Explorerplusplus::LoadBookmarksFromXML(IXMLDOMDocument *pXMLDom)
-{
-	BookmarkXmlStorage::Load(pXMLDom, &m_bookmarkTree);
-}
-
 void Explorerplusplus::SaveBookmarksToXML(IXMLDOMDocument *pXMLDom, IXMLDOMElement *pRoot)
 {
 	BookmarkXmlStorage::Save(pXMLDom, pRoot, &m_bookmarkTree, 1);
@@ -1484,7 +1564,7 @@ void Explorerplusplus::MapAttributeToValue(IXMLDOMNode *pNode, WCHAR *wszName, W
 	switch (uNameHash)
 	{
 	case HASH_ALLOWMULTIPLEINSTANCES:
-		m_config->allowMultipleInstances = NXMLSettings::DecodeBoolValue(wszValue);
+		m_config->allowMultipleInstances.set(NXMLSettings::DecodeBoolValue(wszValue));
 		break;
 
 	case HASH_ALWAYSOPENINNEWTAB:
@@ -1830,6 +1910,34 @@ void Explorerplusplus::MapAttributeToValue(IXMLDOMNode *pNode, WCHAR *wszName, W
 	case HASH_OPEN_TABS_IN_FOREGROUND:
 		m_config->openTabsInForeground = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
+
+	case HASH_VIRTUAL_LISTVIEW_THRESHOLD:
+		m_config->virtualListViewThreshold = NXMLSettings::DecodeIntValue(wszValue);
+		break;
+
+	case HASH_USE_GRID_RENDERER:
+		m_config->useGridRenderer = NXMLSettings::DecodeBoolValue(wszValue);
+		break;
+
+	case HASH_PERSIST_FOLDER_SIZES:
+		m_config->persistFolderSizes = NXMLSettings::DecodeBoolValue(wszValue);
+		break;
+
+	case HASH_USE_NATIVE_FILE_TRANSFERS:
+		m_config->useNativeFileTransfers = NXMLSettings::DecodeBoolValue(wszValue);
+		break;
+
+	case HASH_PERSIST_ICON_CACHE:
+		m_config->persistIconCache = NXMLSettings::DecodeBoolValue(wszValue);
+		break;
+
+	case HASH_PERSIST_CLOSED_TABS:
+		m_config->persistClosedTabs = NXMLSettings::DecodeBoolValue(wszValue);
+		break;
+
+	case HASH_FILE_TRANSFER_BANDWIDTH_LIMIT:
+		m_config->fileTransferBandwidthLimit = NXMLSettings::DecodeIntValue(wszValue);
+		break;
 	}
 }
 
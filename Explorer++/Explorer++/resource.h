@@ -144,8 +144,11 @@
 #define IDD_OPTIONS_ADVANCED            327
 #define IDS_BOOKMARKS_OTHER_BOOKMARKS   328
 #define IDS_ADD_BOOKMARK_TITLE_EDIT_FOLDER 329
+#define IDD_DIAGNOSTICS                 329
 #define IDS_ADD_BOOKMARK_TITLE_ADD_BOOKMARK 330
+#define IDD_DUPLICATE_FILES             330
 #define IDS_ADD_BOOKMARK_TITLE_ADD_FOLDER 331
+#define IDD_DISK_USAGE                  331
 #define IDS_MENU_BOOKMARK_ALL_TABS      332
 #define IDS_ADD_BOOKMARK_TITLE_BOOKMARK_ALL_TABS 333
 #define IDS_ABOUT_VERSION               334
@@ -387,6 +390,19 @@
 #define IDC_ADVANCED_OPTION_DESCRIPTION 1346
 #define IDC_DISPLAY_MIXED_FILES_AND_FOLDERS 1347
 #define IDC_USE_NATURAL_SORT_ORDER      1348
+#define IDC_CHECK_USENTFSINDEX          1349
+#define IDC_EDIT_CONTAININGTEXT         1350
+#define IDC_SPLIT_CHECK_CHECKSUM        1351
+#define IDC_SPLIT_STATIC_SPEED          1352
+#define IDC_DESTROYFILES_PROGRESS       1353
+#define IDC_MANAGEBOOKMARKS_SEARCH      1354
+#define IDC_DIAGNOSTICS_TEXT            1355
+#define IDC_DUPLICATES_LISTVIEW         1356
+#define IDC_DUPLICATES_STATUS           1357
+#define IDC_DUPLICATES_STOP             1358
+#define IDC_DISK_USAGE_TREEMAP          1359
+#define IDC_DISK_USAGE_STATUS           1360
+#define IDC_DISK_USAGE_UP               1361
 #define IDS_COLUMN_DESCRIPTION_NAME     2000
 #define IDS_COLUMN_DESCRIPTION_TYPE     2001
 #define IDS_COLUMN_DESCRIPTION_SIZE     2002
@@ -529,6 +545,7 @@
 #define IDS_MERGE_FILES_COLUMN_DATE_MODIFIED 2148
 #define IDS_ABOUT_64BIT_BUILD           2149
 #define IDS_ABOUT_32BIT_BUILD           2150
+#define IDS_SEARCH_COLUMN_MATCHING_LINE 2151
 #define IDS_SEARCH_OPEN_FILE_LOCATION   2152
 #define IDS_SEARCH_OPEN_FOLDER_LOCATION 2153
 #define IDS_GENERAL_COPY_TO_FOLDER_TITLE 2154
@@ -540,6 +557,49 @@
 #define IDS_SPLIT_FILE_SIZE_MB          2160
 #define IDS_SPLIT_FILE_SIZE_GB          2161
 #define IDS_GENERAL_TRANSLATION_DLL_VERSION_MISMATCH 2162
+#define IDS_DIRECTORY_LISTING_TYPE_TEXT 2163
+#define IDS_DIRECTORY_LISTING_TYPE_CSV  2164
+#define IDS_DIRECTORY_LISTING_TYPE_JSON 2165
+#define IDS_DIRECTORY_LISTING_INCLUDE_SUBFOLDERS 2166
+#define IDS_TREEVIEW_LOADING            2167
+#define IDS_QUICK_FILTER_CUE_BANNER     2168
+#define IDS_MANAGE_BOOKMARKS_SEARCH_CUE_BANNER 2169
+#define IDS_SET_FILE_ATTRIBUTES_PROGRESS 2170
+#define IDS_SET_FILE_ATTRIBUTES_ERROR   2171
+#define IDS_DIAGNOSTICS_REPORT          2172
+#define IDS_DIAGNOSTICS_PENDING         2173
+#define IDS_DIAGNOSTICS_FROM_SNAPSHOT   2174
+#define IDS_DIAGNOSTICS_MILLISECONDS    2175
+#define IDS_COPY_CHANGES_NOT_FILE_SYSTEM 2176
+#define IDS_COPY_CHANGES_UP_TO_DATE     2177
+#define IDS_COPY_CHANGES_CONFIRMATION   2178
+#define IDS_COPY_CHANGES_ERROR          2179
+#define IDS_COLUMN_NAME_CHECKSUM        2180
+#define IDS_COLUMN_DESCRIPTION_CHECKSUM 2181
+#define IDS_COMPUTE_HASHES_COPIED       2182
+#define IDS_COMPUTE_HASHES_PARTIALLY_FAILED 2183
+#define IDS_FILE_TRANSFER_STATUS        2184
+#define IDS_FILE_TRANSFER_STATUS_PAUSED 2185
+#define IDS_FILE_TRANSFER_ERROR         2186
+#define IDS_DUPLICATES_COLUMN_NAME      2187
+#define IDS_DUPLICATES_COLUMN_FOLDER    2188
+#define IDS_DUPLICATES_COLUMN_SIZE      2189
+#define IDS_DUPLICATES_COLUMN_GROUP     2190
+#define IDS_DUPLICATES_SEARCHING        2191
+#define IDS_DUPLICATES_FINISHED         2192
+#define IDS_DUPLICATES_CANCELLED        2193
+#define IDS_DUPLICATES_ERROR            2194
+#define IDS_DISK_USAGE_TITLE            2195
+#define IDS_DISK_USAGE_SCANNING         2196
+#define IDS_DISK_USAGE_FINISHED         2197
+#define IDS_DISK_USAGE_FOLDER           2198
+#define IDS_DISK_USAGE_FILES            2199
+#define IDS_DISK_USAGE_OTHER            2200
+#define IDS_COLUMN_NAME_RELATIVEPATH    2201
+#define IDS_COLUMN_DESCRIPTION_RELATIVEPATH 2202
+#define IDS_DIAGNOSTICS_PLUGINS         2203
+#define IDS_DIAGNOSTICS_PLUGIN_MEMORY   2204
+#define IDS_STATUS_SORTING              2205
 #define IDM_FILE_SAVEDIRECTORYLISTING   8002
 #define IDS_MERGE_FILES_COLUMN_FILE     8003
 #define IDS_OK                          8004
@@ -816,6 +876,19 @@
 #define IDM_MB_ORGANIZE_PASTE           40541
 #define IDM_DISPLAYWINDOW_VERTICAL      40542
 #define IDM_POPUP_SHOW_COLUMNS          40543
+#define IDM_FILTER_QUICKFILTER          40544
+#define IDM_TOOLS_DIAGNOSTICS           40545
+#define IDM_TAB_COPYCHANGESFROMSELECTEDTAB 40546
+#define IDM_ACTIONS_COMPUTEHASHES       40547
+#define IDM_ACTIONS_PAUSEFILETRANSFERS  40548
+#define IDM_VIEW_ALLOWCLOUDDOWNLOADS    40549
+#define IDM_NETWORKLOCATION_AUTOMATIC   40550
+#define IDM_NETWORKLOCATION_FULL        40551
+#define IDM_NETWORKLOCATION_REDUCED     40552
+#define IDM_GO_STOP                     40553
+#define IDM_TOOLS_FINDDUPLICATES        40554
+#define IDM_TOOLS_DISKUSAGE             40555
+#define IDM_VIEW_FLATVIEW               40556
 #define IDM_SORTBY_NAME                 50000
 #define IDM_SORTBY_SIZE                 50001
 #define IDM_SORTBY_TYPE                 50002
@@ -878,6 +951,8 @@
 #define IDM_SORTBY_MEDIA_PUBLISHER      50061
 #define IDM_SORTBY_MEDIA_WRITER         50062
 #define IDM_SORTBY_MEDIA_YEAR           50063
+#define IDM_SORTBY_CHECKSUM             50064
+#define IDM_SORTBY_RELATIVEPATH         50065
 #define IDM_GROUPBY_NAME                50100
 #define IDM_GROUPBY_SIZE                50101
 #define IDM_GROUPBY_TYPE                50102
@@ -940,6 +1015,8 @@
 #define IDM_GROUPBY_MEDIA_PUBLISHER     50161
 #define IDM_GROUPBY_MEDIA_WRITER        50162
 #define IDM_GROUPBY_MEDIA_YEAR          50163
+#define IDM_GROUPBY_CHECKSUM            50164
+#define IDM_GROUPBY_RELATIVEPATH        50165
 #define IDM_VIEW_THUMBNAILS             60000
 #define IDM_VIEW_TILES                  60001
 #define IDM_VIEW_ICONS                  60002
@@ -953,9 +1030,9 @@
 // 
 #ifdef APSTUDIO_INVOKED
 #ifndef APSTUDIO_READONLY_SYMBOLS
-#define _APS_NEXT_RESOURCE_VALUE        329
-#define _APS_NEXT_COMMAND_VALUE         40544
-#define _APS_NEXT_CONTROL_VALUE         1349
+#define _APS_NEXT_RESOURCE_VALUE        332
+#define _APS_NEXT_COMMAND_VALUE         40557
+#define _APS_NEXT_CONTROL_VALUE         1362
 #define _APS_NEXT_SYMED_VALUE           101
 #endif
 #endif
@@ -0,0 +1,162 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "AccountNameCache.h"
+#include <wil/resource.h>
+#include <sddl.h>
+
+AccountNameCache::AccountNameCache(LookupFunction lookupFunction) :
+	m_lookupFunction(lookupFunction)
+{
+}
+
+AccountNameCache::~AccountNameCache()
+{
+	{
+		std::scoped_lock lock(m_mutex);
+		m_stopping = true;
+	}
+
+	m_lookupQueuedCondition.notify_all();
+
+	if (m_resolverThread.joinable())
+	{
+		m_resolverThread.join();
+	}
+}
+
+AccountNameCache &AccountNameCache::GetInstance()
+{
+	static AccountNameCache accountNameCache;
+	return accountNameCache;
+}
+
+std::wstring AccountNameCache::GetAccountName(const std::wstring &sid)
+{
+	std::unique_lock lock(m_mutex);
+
+	auto [itr, inserted] = m_entries.try_emplace(sid);
+
+	if (itr->second.resolved)
+	{
+		return itr->second.name ? *itr->second.name : sid;
+	}
+
+	if (inserted)
+	{
+		m_pendingLookups.push_back(sid);
+
+		if (!m_resolverThread.joinable())
+		{
+			m_resolverThread = std::thread(&AccountNameCache::ResolverThreadMain, this);
+		}
+
+		lock.unlock();
+		m_lookupQueuedCondition.notify_one();
+	}
+
+	return sid;
+}
+
+std::optional<std::wstring> AccountNameCache::GetResolvedAccountName(const std::wstring &sid)
+{
+	std::scoped_lock lock(m_mutex);
+
+	auto itr = m_entries.find(sid);
+
+	if (itr == m_entries.end() || !itr->second.resolved)
+	{
+		return std::nullopt;
+	}
+
+	return itr->second.name;
+}
+
+boost::signals2::connection AccountNameCache::AddNamesResolvedObserver(
+	const NamesResolvedSignal::slot_type &observer)
+{
+	return m_namesResolvedSignal.connect(observer);
+}
+
+void AccountNameCache::WaitForPendingLookups()
+{
+	std::unique_lock lock(m_mutex);
+	m_lookupsFinishedCondition.wait(
+		lock, [this] { return m_pendingLookups.empty() && !m_lookupInProgress; });
+}
+
+void AccountNameCache::Clear()
+{
+	std::scoped_lock lock(m_mutex);
+
+	// Entries whose lookups are still queued are kept, so that the SID isn't queued a second time.
+	std::erase_if(m_entries, [](const auto &entry) { return entry.second.resolved; });
+}
+
+void AccountNameCache::ResolverThreadMain()
+{
+	std::unique_lock lock(m_mutex);
+
+	while (true)
+	{
+		m_lookupQueuedCondition.wait(
+			lock, [this] { return m_stopping || !m_pendingLookups.empty(); });
+
+		if (m_stopping)
+		{
+			break;
+		}
+
+		while (!m_pendingLookups.empty() && !m_stopping)
+		{
+			std::wstring sid = std::move(m_pendingLookups.front());
+			m_pendingLookups.pop_front();
+			m_lookupInProgress = true;
+
+			lock.unlock();
+			auto name = m_lookupFunction(sid);
+			lock.lock();
+
+			m_lookupInProgress = false;
+
+			auto &entry = m_entries[sid];
+			entry.resolved = true;
+			entry.name = name;
+		}
+
+		// Observers are notified without the lock held, since they may call back into this class.
+		lock.unlock();
+		m_namesResolvedSignal();
+		lock.lock();
+
+		m_lookupsFinishedCondition.notify_all();
+	}
+}
+
+std::optional<std::wstring> AccountNameCache::LookupAccountNameForSid(const std::wstring &sid)
+{
+	wil::unique_hlocal_ptr<void> sidData;
+	BOOL res = ConvertStringSidToSid(sid.c_str(), wil::out_param(sidData));
+
+	if (!res)
+	{
+		return std::nullopt;
+	}
+
+	TCHAR accountName[512];
+	DWORD accountNameLength = static_cast<DWORD>(std::size(accountName));
+	TCHAR domainName[512];
+	DWORD domainNameLength = static_cast<DWORD>(std::size(domainName));
+	SID_NAME_USE use;
+	res = LookupAccountSid(nullptr, sidData.get(), accountName, &accountNameLength, domainName,
+		&domainNameLength, &use);
+
+	if (!res)
+	{
+		return std::nullopt;
+	}
+
+	return std::wstring(domainName) + L"\\" + accountName;
+}
\ No newline at end of file
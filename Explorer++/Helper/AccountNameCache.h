@@ -0,0 +1,87 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <boost/signals2.hpp>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+// Caches the account name associated with each SID, keyed by the string form of the SID (e.g.
+// S-1-5-32-544). Looking up an account can require a domain controller to be contacted, so the
+// lookups are made on a dedicated background thread, rather than by the caller. Until the name for
+// a SID is known, the SID string itself is returned.
+//
+// Failed lookups are cached as well (an account may have been deleted, or the domain may be
+// unreachable), so each SID is only ever looked up once.
+//
+// Safe to use from multiple threads.
+class AccountNameCache
+{
+public:
+	// Returns the account name (in DOMAIN\user form), or std::nullopt if the SID couldn't be
+	// resolved. Only replaced in tests.
+	using LookupFunction = std::function<std::optional<std::wstring>(const std::wstring &sid)>;
+
+	using NamesResolvedSignal = boost::signals2::signal<void()>;
+
+	explicit AccountNameCache(LookupFunction lookupFunction = LookupAccountNameForSid);
+	~AccountNameCache();
+
+	AccountNameCache(const AccountNameCache &) = delete;
+	AccountNameCache &operator=(const AccountNameCache &) = delete;
+
+	static AccountNameCache &GetInstance();
+
+	// Returns the account name for the SID if it has been resolved. Otherwise, returns the SID
+	// string and, if the SID hasn't been seen before, queues a lookup. This never blocks on the
+	// lookup itself.
+	std::wstring GetAccountName(const std::wstring &sid);
+
+	// Returns the account name for the SID, but only if a previous lookup has already resolved it.
+	// No lookup is queued.
+	std::optional<std::wstring> GetResolvedAccountName(const std::wstring &sid);
+
+	// The observer is invoked on the background thread, once the queue of pending lookups has been
+	// drained. Lookups are made in batches, so a single notification can cover many SIDs.
+	boost::signals2::connection AddNamesResolvedObserver(
+		const NamesResolvedSignal::slot_type &observer);
+
+	// Blocks until every queued lookup has completed.
+	void WaitForPendingLookups();
+
+	void Clear();
+
+private:
+	struct Entry
+	{
+		bool resolved = false;
+		std::optional<std::wstring> name;
+	};
+
+	static std::optional<std::wstring> LookupAccountNameForSid(const std::wstring &sid);
+
+	void ResolverThreadMain();
+
+	const LookupFunction m_lookupFunction;
+
+	std::mutex m_mutex;
+	std::condition_variable m_lookupQueuedCondition;
+	std::condition_variable m_lookupsFinishedCondition;
+	std::unordered_map<std::wstring, Entry> m_entries;
+	std::deque<std::wstring> m_pendingLookups;
+	bool m_lookupInProgress = false;
+	bool m_stopping = false;
+
+	// Only started once a lookup is first needed, since most sessions never display an owner.
+	std::thread m_resolverThread;
+
+	NamesResolvedSignal m_namesResolvedSignal;
+};
\ No newline at end of file
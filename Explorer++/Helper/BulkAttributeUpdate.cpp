@@ -0,0 +1,135 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "BulkAttributeUpdate.h"
+#include "ParallelWalk.h"
+#include <wil/resource.h>
+#include <atomic>
+#include <mutex>
+
+namespace
+{
+
+struct UpdateState
+{
+	std::atomic<int> filesUpdated = 0;
+	std::atomic<int> filesFailed = 0;
+
+	std::mutex errorMutex;
+	DWORD firstError = ERROR_SUCCESS;
+	std::wstring firstFailedPath;
+};
+
+LARGE_INTEGER FileTimeToLargeInteger(const std::optional<FILETIME> &fileTime)
+{
+	// A value of 0 in FILE_BASIC_INFO indicates that the corresponding time shouldn't be changed.
+	LARGE_INTEGER value = {};
+
+	if (fileTime)
+	{
+		value.LowPart = fileTime->dwLowDateTime;
+		value.HighPart = fileTime->dwHighDateTime;
+	}
+
+	return value;
+}
+
+DWORD UpdateFile(const FileBasicInfoUpdate &update, const FileTimestamps &timestamps)
+{
+	// FILE_FLAG_BACKUP_SEMANTICS is required to open a folder.
+	wil::unique_hfile file(CreateFile(update.path.c_str(), FILE_WRITE_ATTRIBUTES,
+		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+		FILE_FLAG_BACKUP_SEMANTICS, nullptr));
+
+	if (!file)
+	{
+		return GetLastError();
+	}
+
+	FILE_BASIC_INFO basicInfo = {};
+	basicInfo.CreationTime = FileTimeToLargeInteger(timestamps.creationTime);
+	basicInfo.LastAccessTime = FileTimeToLargeInteger(timestamps.lastAccessTime);
+	basicInfo.LastWriteTime = FileTimeToLargeInteger(timestamps.lastWriteTime);
+
+	if (update.attributes)
+	{
+		// FILE_ATTRIBUTE_NORMAL is only valid on its own. An attributes value of 0 would leave
+		// the attributes unchanged.
+		DWORD attributes = *update.attributes & ~FILE_ATTRIBUTE_NORMAL;
+		basicInfo.FileAttributes = (attributes == 0) ? FILE_ATTRIBUTE_NORMAL : attributes;
+	}
+
+	if (!SetFileInformationByHandle(file.get(), FileBasicInfo, &basicInfo, sizeof(basicInfo)))
+	{
+		return GetLastError();
+	}
+
+	return ERROR_SUCCESS;
+}
+
+}
+
+FileBasicInfoUpdateResult UpdateFileBasicInfo(const std::vector<FileBasicInfoUpdate> &updates,
+	const FileTimestamps &timestamps, std::stop_token stopToken,
+	const FileBasicInfoUpdateProgressCallback &progressCallback)
+{
+	UpdateState state;
+
+	std::vector<const FileBasicInfoUpdate *> items;
+	items.reserve(updates.size());
+
+	for (const auto &update : updates)
+	{
+		items.push_back(&update);
+	}
+
+	auto reportProgress = [&state, &updates, &progressCallback]() {
+		if (!progressCallback)
+		{
+			return;
+		}
+
+		FileBasicInfoUpdateProgress progress;
+		progress.filesFailed = state.filesFailed;
+		progress.filesProcessed = state.filesUpdated + progress.filesFailed;
+		progress.totalFiles = static_cast<int>(updates.size());
+		progressCallback(progress);
+	};
+
+	ParallelWalk<const FileBasicInfoUpdate *>::Run(
+		std::move(items),
+		[&state, &timestamps](const FileBasicInfoUpdate *update,
+			ParallelWalk<const FileBasicInfoUpdate *>::Worker &worker) {
+			UNREFERENCED_PARAMETER(worker);
+
+			DWORD error = UpdateFile(*update, timestamps);
+
+			if (error == ERROR_SUCCESS)
+			{
+				state.filesUpdated++;
+				return;
+			}
+
+			state.filesFailed++;
+
+			std::scoped_lock lock(state.errorMutex);
+
+			if (state.firstError == ERROR_SUCCESS)
+			{
+				state.firstError = error;
+				state.firstFailedPath = update->path;
+			}
+		},
+		stopToken, reportProgress);
+
+	reportProgress();
+
+	FileBasicInfoUpdateResult result;
+	result.filesUpdated = state.filesUpdated;
+	result.filesFailed = state.filesFailed;
+	result.firstError = state.firstError;
+	result.firstFailedPath = state.firstFailedPath;
+	return result;
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <vector>
+
+struct FileBasicInfoUpdate
+{
+	std::wstring path;
+
+	// The complete set of attributes the item should have. If not set, the attributes are left
+	// unchanged.
+	std::optional<DWORD> attributes;
+};
+
+// Any timestamps that aren't set are left unchanged.
+struct FileTimestamps
+{
+	std::optional<FILETIME> creationTime;
+	std::optional<FILETIME> lastAccessTime;
+	std::optional<FILETIME> lastWriteTime;
+};
+
+struct FileBasicInfoUpdateProgress
+{
+	int filesProcessed;
+	int totalFiles;
+	int filesFailed;
+};
+
+struct FileBasicInfoUpdateResult
+{
+	int filesUpdated = 0;
+	int filesFailed = 0;
+
+	// Details of the first failure, if there were any. Only the first is kept, since the errors
+	// are reported in aggregate.
+	DWORD firstError = ERROR_SUCCESS;
+	std::wstring firstFailedPath;
+};
+
+// Invoked periodically on the calling thread while the update is in progress.
+using FileBasicInfoUpdateProgressCallback =
+	std::function<void(const FileBasicInfoUpdateProgress &progress)>;
+
+// Applies the attributes and timestamps to each of the specified items. Each item is opened once,
+// with the attributes and timestamps then being set together, via a single call to
+// SetFileInformationByHandle(). Several items are processed in parallel, using the threads shared
+// with ParallelWalk, so the number of items in flight remains bounded.
+//
+// If a stop is requested, items that haven't been processed yet are left unchanged.
+FileBasicInfoUpdateResult UpdateFileBasicInfo(const std::vector<FileBasicInfoUpdate> &updates,
+	const FileTimestamps &timestamps, std::stop_token stopToken = {},
+	const FileBasicInfoUpdateProgressCallback &progressCallback = nullptr);
\ No newline at end of file
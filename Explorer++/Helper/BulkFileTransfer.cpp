@@ -0,0 +1,678 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "BulkFileTransfer.h"
+#include "DriveInfo.h"
+#include "ParallelWalk.h"
+#include <wil/resource.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+namespace
+{
+
+// Files at least this large are copied using unbuffered I/O.
+const ULONGLONG LARGE_FILE_THRESHOLD = 16 * 1024 * 1024;
+
+// Determines what happens when a file being copied already exists in the destination.
+enum class ExistingFilePolicy
+{
+	// The copy fails. Conflicts are detected before anything is copied, so this only happens if
+	// the file was created in the meantime.
+	Fail,
+
+	Replace,
+
+	// The file is skipped if it matches the source file, and replaced otherwise.
+	SkipIfIdentical
+};
+
+struct PendingFolder
+{
+	std::wstring source;
+	std::wstring destination;
+	int depth;
+};
+
+struct PendingFile
+{
+	std::wstring source;
+	std::wstring destination;
+	ULONGLONG size;
+};
+
+// The complete set of folders and files to be transferred.
+struct TransferPlan
+{
+	std::mutex mutex;
+	std::vector<PendingFolder> folders;
+	std::vector<PendingFile> files;
+	std::atomic<ULONGLONG> totalBytes = 0;
+	std::atomic<int> totalFiles = 0;
+	std::atomic<bool> supported = true;
+	std::atomic<HRESULT> result = S_OK;
+};
+
+struct TransferState
+{
+	ExistingFilePolicy existingFilePolicy = ExistingFilePolicy::Fail;
+	FileTransferThrottle *throttle = nullptr;
+	std::atomic<ULONGLONG> bytesTransferred = 0;
+	std::atomic<int> filesTransferred = 0;
+	std::atomic<HRESULT> result = S_OK;
+	std::stop_token stopToken;
+
+	// Only a single large file is copied at a time.
+	std::mutex largeFileMutex;
+};
+
+struct CopyProgressContext
+{
+	TransferState *state;
+	ULONGLONG lastBytesTransferred;
+};
+
+std::wstring CombinePath(const std::wstring &folder, const std::wstring &name)
+{
+	if (!folder.empty() && folder.back() == '\\')
+	{
+		return folder + name;
+	}
+
+	return folder + L"\\" + name;
+}
+
+std::wstring GetFileName(const std::wstring &path)
+{
+	auto position = path.find_last_of('\\');
+
+	if (position == std::wstring::npos)
+	{
+		return path;
+	}
+
+	return path.substr(position + 1);
+}
+
+bool IsOnSameVolume(const std::wstring &path1, const std::wstring &path2)
+{
+	TCHAR volume1[MAX_PATH];
+	TCHAR volume2[MAX_PATH];
+
+	if (!GetVolumePathName(path1.c_str(), volume1, SIZEOF_ARRAY(volume1))
+		|| !GetVolumePathName(path2.c_str(), volume2, SIZEOF_ARRAY(volume2)))
+	{
+		return false;
+	}
+
+	return lstrcmpi(volume1, volume2) == 0;
+}
+
+// Returns true if the path is the same as, or is within, the folder.
+bool IsPathWithinFolder(const std::wstring &path, const std::wstring &folder)
+{
+	if (path.size() < folder.size()
+		|| CompareStringOrdinal(path.c_str(), static_cast<int>(folder.size()), folder.c_str(),
+			   static_cast<int>(folder.size()), TRUE)
+			!= CSTR_EQUAL)
+	{
+		return false;
+	}
+
+	return path.size() == folder.size() || folder.back() == '\\' || path[folder.size()] == '\\';
+}
+
+void AddFile(TransferPlan &plan, std::vector<PendingFile> &files, const std::wstring &source,
+	const std::wstring &destination, ULONGLONG size)
+{
+	files.push_back({ source, destination, size });
+	plan.totalBytes += size;
+	plan.totalFiles++;
+}
+
+void EnumerateFolder(const PendingFolder &folder, TransferPlan &plan,
+	ParallelWalk<PendingFolder>::Worker &worker)
+{
+	WIN32_FIND_DATA findData;
+	wil::unique_hfind findHandle(FindFirstFileEx(CombinePath(folder.source, L"*").c_str(),
+		FindExInfoBasic, &findData, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH));
+
+	if (!findHandle)
+	{
+		plan.result = HRESULT_FROM_WIN32(GetLastError());
+		return;
+	}
+
+	// The results are gathered locally first, so that the shared lists only need to be locked
+	// once per folder.
+	std::vector<PendingFolder> subfolders;
+	std::vector<PendingFile> files;
+
+	do
+	{
+		if (WI_IsFlagSet(findData.dwFileAttributes, FILE_ATTRIBUTE_REPARSE_POINT))
+		{
+			// Whether a link should be copied as a link or have its target copied is a decision
+			// that's left to the shell.
+			plan.supported = false;
+			return;
+		}
+
+		std::wstring source = CombinePath(folder.source, findData.cFileName);
+		std::wstring destination = CombinePath(folder.destination, findData.cFileName);
+
+		if (WI_IsFlagSet(findData.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+		{
+			if (lstrcmp(findData.cFileName, _T(".")) == 0
+				|| lstrcmp(findData.cFileName, _T("..")) == 0)
+			{
+				continue;
+			}
+
+			subfolders.push_back({ source, destination, folder.depth + 1 });
+		}
+		else
+		{
+			ULARGE_INTEGER fileSize;
+			fileSize.LowPart = findData.nFileSizeLow;
+			fileSize.HighPart = findData.nFileSizeHigh;
+
+			AddFile(plan, files, source, destination, fileSize.QuadPart);
+		}
+	} while (FindNextFile(findHandle.get(), &findData));
+
+	{
+		std::scoped_lock lock(plan.mutex);
+		plan.folders.insert(plan.folders.end(), subfolders.begin(), subfolders.end());
+		plan.files.insert(plan.files.end(), std::make_move_iterator(files.begin()),
+			std::make_move_iterator(files.end()));
+	}
+
+	for (auto &subfolder : subfolders)
+	{
+		worker.AddItem(std::move(subfolder));
+	}
+}
+
+DWORD CALLBACK CopyProgressRoutine(LARGE_INTEGER totalFileSize,
+	LARGE_INTEGER totalBytesTransferred, LARGE_INTEGER streamSize,
+	LARGE_INTEGER streamBytesTransferred, DWORD streamNumber, DWORD callbackReason,
+	HANDLE sourceFile, HANDLE destinationFile, LPVOID data)
+{
+	UNREFERENCED_PARAMETER(totalFileSize);
+	UNREFERENCED_PARAMETER(streamSize);
+	UNREFERENCED_PARAMETER(streamBytesTransferred);
+	UNREFERENCED_PARAMETER(streamNumber);
+	UNREFERENCED_PARAMETER(callbackReason);
+	UNREFERENCED_PARAMETER(sourceFile);
+	UNREFERENCED_PARAMETER(destinationFile);
+
+	auto *context = reinterpret_cast<CopyProgressContext *>(data);
+
+	// The total here includes alternate data streams, so it can exceed the size of the file
+	// reported during enumeration.
+	auto bytesTransferred = static_cast<ULONGLONG>(totalBytesTransferred.QuadPart);
+	ULONGLONG numNewBytes = bytesTransferred - context->lastBytesTransferred;
+	context->state->bytesTransferred += numNewBytes;
+	context->lastBytesTransferred = bytesTransferred;
+
+	if (context->state->throttle
+		&& !context->state->throttle->OnBytesTransferred(numNewBytes, context->state->stopToken))
+	{
+		return PROGRESS_CANCEL;
+	}
+
+	if (context->state->stopToken.stop_requested())
+	{
+		return PROGRESS_CANCEL;
+	}
+
+	return PROGRESS_CONTINUE;
+}
+
+// Returns true if the destination file has the same size and last write time as the source file.
+// CopyFileEx copies the last write time, so this will be the case for any file that was copied in
+// full.
+bool IsFileAlreadyCopied(const PendingFile &file)
+{
+	WIN32_FILE_ATTRIBUTE_DATA sourceData;
+	WIN32_FILE_ATTRIBUTE_DATA destinationData;
+
+	if (!GetFileAttributesEx(file.source.c_str(), GetFileExInfoStandard, &sourceData)
+		|| !GetFileAttributesEx(file.destination.c_str(), GetFileExInfoStandard, &destinationData)
+		|| WI_IsFlagSet(destinationData.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+	{
+		return false;
+	}
+
+	return sourceData.nFileSizeLow == destinationData.nFileSizeLow
+		&& sourceData.nFileSizeHigh == destinationData.nFileSizeHigh
+		&& CompareFileTime(&sourceData.ftLastWriteTime, &destinationData.ftLastWriteTime) == 0;
+}
+
+void DeleteSourceFile(const PendingFile &file, TransferState &state)
+{
+	// Read-only files can't be deleted directly.
+	SetFileAttributes(file.source.c_str(), FILE_ATTRIBUTE_NORMAL);
+
+	if (!DeleteFile(file.source.c_str()))
+	{
+		HRESULT expected = S_OK;
+		state.result.compare_exchange_strong(expected, HRESULT_FROM_WIN32(GetLastError()));
+	}
+}
+
+void TransferFile(const PendingFile &file, bool move, TransferState &state)
+{
+	// If the transfer is paused, no new files are started until it's resumed.
+	if (state.throttle && !state.throttle->OnBytesTransferred(0, state.stopToken))
+	{
+		return;
+	}
+
+	if (state.existingFilePolicy == ExistingFilePolicy::SkipIfIdentical
+		&& IsFileAlreadyCopied(file))
+	{
+		state.bytesTransferred += file.size;
+
+		if (move)
+		{
+			DeleteSourceFile(file, state);
+		}
+
+		state.filesTransferred++;
+		return;
+	}
+
+	DWORD flags = COPY_FILE_FAIL_IF_EXISTS;
+	std::unique_lock<std::mutex> largeFileLock;
+
+	if (state.existingFilePolicy != ExistingFilePolicy::Fail)
+	{
+		// An existing read-only or hidden file can't be overwritten. The copy will take on the
+		// attributes of the source file anyway.
+		if (GetFileAttributes(file.destination.c_str()) != INVALID_FILE_ATTRIBUTES)
+		{
+			SetFileAttributes(file.destination.c_str(), FILE_ATTRIBUTE_NORMAL);
+		}
+
+		flags = 0;
+	}
+
+	if (file.size >= LARGE_FILE_THRESHOLD)
+	{
+		flags |= COPY_FILE_NO_BUFFERING;
+		largeFileLock = std::unique_lock(state.largeFileMutex);
+	}
+
+	CopyProgressContext context = { &state, 0 };
+	BOOL res = CopyFileEx(file.source.c_str(), file.destination.c_str(), CopyProgressRoutine,
+		&context, nullptr, flags);
+
+	// The file may have changed size since it was enumerated, so the total is adjusted to account
+	// for the size initially expected.
+	state.bytesTransferred += file.size - (std::min)(file.size, context.lastBytesTransferred);
+
+	if (!res)
+	{
+		DWORD error = GetLastError();
+
+		if (error != ERROR_REQUEST_ABORTED)
+		{
+			HRESULT expected = S_OK;
+			state.result.compare_exchange_strong(expected, HRESULT_FROM_WIN32(error));
+		}
+
+		return;
+	}
+
+	if (move)
+	{
+		DeleteSourceFile(file, state);
+	}
+
+	state.filesTransferred++;
+}
+
+// Enumerates the root folders, then creates the destination folders and copies the files. Any
+// files that were added to the plan directly are copied along with the files found during
+// enumeration.
+HRESULT PerformTransfer(TransferPlan &plan, const std::vector<PendingFolder> &rootFolders,
+	bool move, ExistingFilePolicy existingFilePolicy, std::stop_token stopToken,
+	const FileTransferProgressCallback &progressCallback, FileTransferThrottle *throttle)
+{
+	plan.folders = rootFolders;
+
+	auto reportProgress = [&progressCallback](bool enumerating, ULONGLONG bytesTransferred,
+							  ULONGLONG totalBytes, int filesTransferred, int totalFiles,
+							  ULONGLONG bytesPerSecond) {
+		if (progressCallback)
+		{
+			progressCallback({ enumerating, bytesTransferred, totalBytes, filesTransferred,
+				totalFiles, bytesPerSecond });
+		}
+	};
+
+	ParallelWalk<PendingFolder>::Run(
+		rootFolders,
+		[&plan](const PendingFolder &folder, ParallelWalk<PendingFolder>::Worker &worker) {
+			if (!plan.supported || FAILED(plan.result))
+			{
+				return;
+			}
+
+			EnumerateFolder(folder, plan, worker);
+		},
+		stopToken,
+		[&plan, &reportProgress]() {
+			reportProgress(true, 0, plan.totalBytes, 0, plan.totalFiles, 0);
+		});
+
+	if (stopToken.stop_requested())
+	{
+		return HRESULT_FROM_WIN32(ERROR_CANCELLED);
+	}
+
+	if (!plan.supported)
+	{
+		return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+	}
+
+	if (FAILED(plan.result))
+	{
+		return plan.result;
+	}
+
+	// Parent folders have to be created before their children. Creating the folders only takes a
+	// small fraction of the total time, so it's done on this thread.
+	std::stable_sort(plan.folders.begin(), plan.folders.end(),
+		[](const PendingFolder &folder1, const PendingFolder &folder2) {
+			return folder1.depth < folder2.depth;
+		});
+
+	for (const auto &folder : plan.folders)
+	{
+		// Using the source folder as a template means its attributes are copied as well.
+		if (!CreateDirectoryEx(folder.source.c_str(), folder.destination.c_str(), nullptr)
+			&& GetLastError() != ERROR_ALREADY_EXISTS)
+		{
+			return HRESULT_FROM_WIN32(GetLastError());
+		}
+	}
+
+	TransferState state;
+	state.existingFilePolicy = existingFilePolicy;
+	state.throttle = throttle;
+	state.stopToken = stopToken;
+
+	std::vector<const PendingFile *> files;
+	files.reserve(plan.files.size());
+
+	for (const auto &file : plan.files)
+	{
+		files.push_back(&file);
+	}
+
+	// The number of files copied at once is limited to what suits the slower of the source and
+	// destination devices. The files will almost always all be on the same pair of volumes, so
+	// only the first file is checked.
+	int maxThreads = 0;
+
+	if (!plan.files.empty())
+	{
+		maxThreads = (std::min)(
+			GetStorageInfo(plan.files.front().source).ioSettings.parallelism,
+			GetStorageInfo(plan.files.front().destination).ioSettings.parallelism);
+	}
+
+	auto lastProgressTime = std::chrono::steady_clock::now();
+	ULONGLONG lastBytesTransferred = 0;
+
+	ParallelWalk<const PendingFile *>::Run(
+		std::move(files),
+		[move, &state](const PendingFile *file, ParallelWalk<const PendingFile *>::Worker &worker) {
+			UNREFERENCED_PARAMETER(worker);
+
+			TransferFile(*file, move, state);
+		},
+		stopToken,
+		[&plan, &state, &reportProgress, &lastProgressTime, &lastBytesTransferred]() {
+			auto now = std::chrono::steady_clock::now();
+			auto elapsed =
+				std::chrono::duration_cast<std::chrono::milliseconds>(now - lastProgressTime);
+			ULONGLONG bytesTransferred = state.bytesTransferred;
+			ULONGLONG bytesPerSecond = 0;
+
+			if (elapsed.count() > 0)
+			{
+				bytesPerSecond = (bytesTransferred - lastBytesTransferred) * 1000 / elapsed.count();
+			}
+
+			reportProgress(false, bytesTransferred, plan.totalBytes, state.filesTransferred,
+				plan.totalFiles, bytesPerSecond);
+
+			lastProgressTime = now;
+			lastBytesTransferred = bytesTransferred;
+		},
+		ParallelWalk<const PendingFile *>::DEFAULT_PERIODIC_INTERVAL, maxThreads);
+
+	if (move && !stopToken.stop_requested() && SUCCEEDED(state.result))
+	{
+		// Children come after their parents, so walking the list in reverse removes each folder
+		// once it's empty. Folders that still contain anything are left in place.
+		for (auto itr = plan.folders.rbegin(); itr != plan.folders.rend(); ++itr)
+		{
+			RemoveDirectory(itr->source.c_str());
+		}
+	}
+
+	if (stopToken.stop_requested())
+	{
+		return HRESULT_FROM_WIN32(ERROR_CANCELLED);
+	}
+
+	return state.result;
+}
+
+// Adds the top-level items of a transfer to the plan. When resuming, items that already exist in
+// the destination are expected (and, when moving, items missing from the source are as well).
+HRESULT AddRootItems(TransferPlan &plan, std::vector<PendingFolder> &rootFolders,
+	const std::vector<std::wstring> &sourcePaths, const std::wstring &destinationFolder, bool move,
+	bool resume)
+{
+	for (const auto &sourcePath : sourcePaths)
+	{
+		if (move && IsOnSameVolume(sourcePath, destinationFolder))
+		{
+			return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+		}
+
+		WIN32_FILE_ATTRIBUTE_DATA attributeData;
+
+		if (!GetFileAttributesEx(sourcePath.c_str(), GetFileExInfoStandard, &attributeData))
+		{
+			DWORD error = GetLastError();
+
+			if (resume && move && (error == ERROR_FILE_NOT_FOUND || error == ERROR_PATH_NOT_FOUND))
+			{
+				continue;
+			}
+
+			return HRESULT_FROM_WIN32(error);
+		}
+
+		std::wstring destination = CombinePath(destinationFolder, GetFileName(sourcePath));
+
+		// Conflicts are left to the shell to resolve. Checking the top-level items is enough,
+		// since anything below them will be newly created.
+		if ((!resume && GetFileAttributes(destination.c_str()) != INVALID_FILE_ATTRIBUTES)
+			|| WI_IsFlagSet(attributeData.dwFileAttributes, FILE_ATTRIBUTE_REPARSE_POINT))
+		{
+			return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+		}
+
+		if (WI_IsFlagSet(attributeData.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+		{
+			// A folder can't be copied into itself.
+			if (IsPathWithinFolder(destinationFolder, sourcePath))
+			{
+				return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+			}
+
+			rootFolders.push_back({ sourcePath, destination, 0 });
+		}
+		else
+		{
+			ULARGE_INTEGER fileSize;
+			fileSize.LowPart = attributeData.nFileSizeLow;
+			fileSize.HighPart = attributeData.nFileSizeHigh;
+
+			AddFile(plan, plan.files, sourcePath, destination, fileSize.QuadPart);
+		}
+	}
+
+	return S_OK;
+}
+
+}
+
+void FileTransferThrottle::SetPaused(bool paused)
+{
+	{
+		std::scoped_lock lock(m_mutex);
+		m_paused = paused;
+	}
+
+	m_stateChanged.notify_all();
+}
+
+bool FileTransferThrottle::IsPaused() const
+{
+	std::scoped_lock lock(m_mutex);
+	return m_paused;
+}
+
+void FileTransferThrottle::SetBytesPerSecondLimit(ULONGLONG limit)
+{
+	std::scoped_lock lock(m_mutex);
+	m_bytesPerSecondLimit = limit;
+	m_nextTransferTime = {};
+}
+
+ULONGLONG FileTransferThrottle::GetBytesPerSecondLimit() const
+{
+	std::scoped_lock lock(m_mutex);
+	return m_bytesPerSecondLimit;
+}
+
+bool FileTransferThrottle::OnBytesTransferred(ULONGLONG numBytes, std::stop_token stopToken)
+{
+	std::unique_lock lock(m_mutex);
+
+	if (!m_stateChanged.wait(lock, stopToken, [this] { return !m_paused; }))
+	{
+		return false;
+	}
+
+	if (m_bytesPerSecondLimit == 0 || numBytes == 0)
+	{
+		return true;
+	}
+
+	// Each caller reserves the time its data would take to transfer at the limit, so concurrent
+	// transfers are spaced out one after another. Time spent idle isn't carried forward, which
+	// means a transfer can never burst above the limit.
+	auto now = std::chrono::steady_clock::now();
+	auto duration = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+		std::chrono::duration<double>(
+			static_cast<double>(numBytes) / static_cast<double>(m_bytesPerSecondLimit)));
+	m_nextTransferTime = (std::max)(m_nextTransferTime, now) + duration;
+
+	// Other callers will advance m_nextTransferTime while this one is waiting, so the deadline
+	// needs to be copied.
+	auto deadline = m_nextTransferTime;
+	m_stateChanged.wait_until(lock, stopToken, deadline, [] { return false; });
+
+	return !stopToken.stop_requested();
+}
+
+HRESULT TransferFiles(const std::vector<std::wstring> &sourcePaths,
+	const std::wstring &destinationFolder, bool move, std::stop_token stopToken,
+	const FileTransferProgressCallback &progressCallback, FileTransferThrottle *throttle)
+{
+	TransferPlan plan;
+	std::vector<PendingFolder> rootFolders;
+	HRESULT hr = AddRootItems(plan, rootFolders, sourcePaths, destinationFolder, move, false);
+
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	return PerformTransfer(plan, rootFolders, move, ExistingFilePolicy::Fail, stopToken,
+		progressCallback, throttle);
+}
+
+HRESULT ResumeTransferFiles(const std::vector<std::wstring> &sourcePaths,
+	const std::wstring &destinationFolder, bool move, std::stop_token stopToken,
+	const FileTransferProgressCallback &progressCallback, FileTransferThrottle *throttle)
+{
+	TransferPlan plan;
+	std::vector<PendingFolder> rootFolders;
+	HRESULT hr = AddRootItems(plan, rootFolders, sourcePaths, destinationFolder, move, true);
+
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	return PerformTransfer(plan, rootFolders, move, ExistingFilePolicy::SkipIfIdentical,
+		stopToken, progressCallback, throttle);
+}
+
+HRESULT CopyItemsReplacingExisting(const std::vector<FileTransferItem> &items,
+	std::stop_token stopToken, const FileTransferProgressCallback &progressCallback)
+{
+	TransferPlan plan;
+	std::vector<PendingFolder> rootFolders;
+
+	for (const auto &item : items)
+	{
+		WIN32_FILE_ATTRIBUTE_DATA attributeData;
+
+		if (!GetFileAttributesEx(item.source.c_str(), GetFileExInfoStandard, &attributeData))
+		{
+			return HRESULT_FROM_WIN32(GetLastError());
+		}
+
+		if (WI_IsFlagSet(attributeData.dwFileAttributes, FILE_ATTRIBUTE_REPARSE_POINT))
+		{
+			return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+		}
+
+		if (WI_IsFlagSet(attributeData.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+		{
+			if (IsPathWithinFolder(item.destination, item.source))
+			{
+				return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+			}
+
+			rootFolders.push_back({ item.source, item.destination, 0 });
+		}
+		else
+		{
+			ULARGE_INTEGER fileSize;
+			fileSize.LowPart = attributeData.nFileSizeLow;
+			fileSize.HighPart = attributeData.nFileSizeHigh;
+
+			AddFile(plan, plan.files, item.source, item.destination, fileSize.QuadPart);
+		}
+	}
+
+	return PerformTransfer(
+		plan, rootFolders, false, ExistingFilePolicy::Replace, stopToken, progressCallback, nullptr);
+}
\ No newline at end of file
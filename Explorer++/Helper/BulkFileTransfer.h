@@ -0,0 +1,106 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <vector>
+
+struct FileTransferProgress
+{
+	// While the items are still being enumerated, the totals will continue to grow and nothing
+	// will have been transferred yet.
+	bool enumerating;
+
+	ULONGLONG bytesTransferred;
+	ULONGLONG totalBytes;
+	int filesTransferred;
+	int totalFiles;
+
+	// Measured over the interval since the last progress update.
+	ULONGLONG bytesPerSecond;
+};
+
+// Invoked periodically on the calling thread while a transfer is in progress.
+using FileTransferProgressCallback = std::function<void(const FileTransferProgress &progress)>;
+
+// Allows transfers to be paused, or limited to a maximum rate, while they're in progress. A single
+// instance can be shared between several transfers, in which case the rate limit applies to their
+// combined rate. All methods can be called from any thread.
+class FileTransferThrottle
+{
+public:
+	void SetPaused(bool paused);
+	bool IsPaused() const;
+
+	// A limit of 0 means the rate is unlimited.
+	void SetBytesPerSecondLimit(ULONGLONG limit);
+	ULONGLONG GetBytesPerSecondLimit() const;
+
+	// Called as data is transferred. Blocks while the throttle is paused, or for as long as is
+	// needed to keep the transfer rate within the limit. Returns false if a stop was requested
+	// while waiting.
+	bool OnBytesTransferred(ULONGLONG numBytes, std::stop_token stopToken);
+
+private:
+	mutable std::mutex m_mutex;
+	std::condition_variable_any m_stateChanged;
+	bool m_paused = false;
+	ULONGLONG m_bytesPerSecondLimit = 0;
+
+	// The time at which all the data reported so far would have been transferred, had it been
+	// transferred at exactly the limit.
+	std::chrono::steady_clock::time_point m_nextTransferTime;
+};
+
+struct FileTransferItem
+{
+	std::wstring source;
+
+	// The full path the item should be copied to (rather than the folder it should be copied into).
+	std::wstring destination;
+};
+
+// Copies (or moves) the specified files and folders into the destination folder, without going
+// through the shell. Small files are copied in parallel (as far as the devices involved allow),
+// using the threads shared with ParallelWalk. Large files are copied one at a time, with unbuffered
+// I/O, so that they don't compete with each other for disk bandwidth or fill the system cache.
+//
+// The items are enumerated in full before anything is written. If, at that point, it turns out
+// the transfer is one that the shell should handle (because an item already exists in the
+// destination, or a folder contains a junction or symbolic link), HRESULT_FROM_WIN32(
+// ERROR_NOT_SUPPORTED) is returned, so that the caller can fall back to IFileOperation.
+//
+// Moves are implemented as a copy, followed by the deletion of the source items. Moves within a
+// single volume are always reported as unsupported, since the shell can perform them as a
+// rename. If a stop is requested, files already copied are left in place.
+//
+// If a throttle is provided, the transfer can be paused and rate limited through it.
+HRESULT TransferFiles(const std::vector<std::wstring> &sourcePaths,
+	const std::wstring &destinationFolder, bool move, std::stop_token stopToken = {},
+	const FileTransferProgressCallback &progressCallback = nullptr,
+	FileTransferThrottle *throttle = nullptr);
+
+// Continues a transfer started by TransferFiles that didn't finish (for example, because it was
+// stopped when the application exited). Files that already exist in the destination, with the same
+// size and last write time as the source, are assumed to have been copied in full and are skipped.
+// Any other existing files are replaced. When moving, source items that no longer exist are
+// assumed to have been moved already.
+HRESULT ResumeTransferFiles(const std::vector<std::wstring> &sourcePaths,
+	const std::wstring &destinationFolder, bool move, std::stop_token stopToken = {},
+	const FileTransferProgressCallback &progressCallback = nullptr,
+	FileTransferThrottle *throttle = nullptr);
+
+// Copies each item to its destination path, in the same way as TransferFiles. Unlike
+// TransferFiles, items that already exist in the destination aren't treated as conflicts: existing
+// files are replaced and the contents of existing folders are merged. Nothing in the destination is
+// ever deleted. This is intended for bringing one folder up to date with another, once the items
+// that differ are known.
+HRESULT CopyItemsReplacingExisting(const std::vector<FileTransferItem> &items,
+	std::stop_token stopToken = {}, const FileTransferProgressCallback &progressCallback = nullptr);
\ No newline at end of file
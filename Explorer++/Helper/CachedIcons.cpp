@@ -4,62 +4,134 @@
 
 #include "stdafx.h"
 #include "CachedIcons.h"
-#include "ShellHelper.h"
+#include <algorithm>
+#include <mutex>
 
-CachedIcons::CachedIcons(std::size_t maxItems) : m_maxItems(maxItems)
+CachedIcons::Entry::Entry(std::wstring_view filePath, int iconIndex) :
+	filePath(filePath),
+	iconIndex(iconIndex),
+	referenced(false)
 {
 }
 
-CachedIcons::iterator CachedIcons::end()
+CachedIcons::CachedIcons(std::size_t maxBytes, std::size_t numShards) :
+	m_maxBytesPerShard(maxBytes / (std::max)(numShards, std::size_t { 1 })),
+	m_shards((std::max)(numShards, std::size_t { 1 }))
 {
-	CachedIconSetByPath &pathIndex = m_cachedIconSet.get<1>();
-	return pathIndex.end();
 }
 
-void CachedIcons::addOrUpdateFileIcon(const std::wstring &filePath, int iconIndex)
+std::optional<int> CachedIcons::findByPath(std::wstring_view filePath) const
 {
-	auto cachedItr = findByPath(filePath);
+	const Shard &shard = getShard(filePath);
+	std::shared_lock lock(shard.mutex);
 
-	if (cachedItr != end())
+	auto itr = shard.entriesByPath.find(filePath);
+
+	if (itr == shard.entriesByPath.end())
 	{
-		CachedIcon existingCachedIcon = *cachedItr;
-		existingCachedIcon.iconIndex = iconIndex;
-		replace(cachedItr, existingCachedIcon);
+		return std::nullopt;
 	}
-	else
+
+	const Entry &entry = *itr->second;
+	entry.referenced.store(true, std::memory_order_relaxed);
+
+	return entry.iconIndex.load(std::memory_order_relaxed);
+}
+
+void CachedIcons::addOrUpdateFileIcon(std::wstring_view filePath, int iconIndex)
+{
+	Shard &shard = getShard(filePath);
+	std::unique_lock lock(shard.mutex);
+
+	auto itr = shard.entriesByPath.find(filePath);
+
+	if (itr != shard.entriesByPath.end())
 	{
-		CachedIcon cachedIcon;
-		cachedIcon.filePath = filePath;
-		cachedIcon.iconIndex = iconIndex;
-		insert(cachedIcon);
+		Entry &entry = *itr->second;
+		entry.iconIndex.store(iconIndex, std::memory_order_relaxed);
+		entry.referenced.store(true, std::memory_order_relaxed);
+		return;
 	}
+
+	shard.entries.emplace_front(filePath, iconIndex);
+
+	// The key refers to the string stored in the entry, so the path is only stored once.
+	shard.entriesByPath.insert({ shard.entries.front().filePath, shard.entries.begin() });
+	shard.sizeInBytes += getEntrySize(filePath);
+
+	evictEntries(shard, m_maxBytesPerShard);
 }
 
-void CachedIcons::insert(const CachedIcon &cachedIcon)
+void CachedIcons::trimToSize(std::size_t maxBytes)
 {
-	m_cachedIconSet.push_front(cachedIcon);
+	std::size_t maxBytesPerShard = maxBytes / m_shards.size();
 
-	if (m_cachedIconSet.size() > m_maxItems)
+	for (auto &shard : m_shards)
 	{
-		m_cachedIconSet.pop_back();
+		std::unique_lock lock(shard.mutex);
+		evictEntries(shard, maxBytesPerShard);
 	}
 }
 
-// Replaces an existing cached icon. The icon will also be moved to the
-// front of the list, which will stop it from being removed if the list
-// grows over the maximum allowed size (the first icons to be removed
-// are those at the back of the list).
-void CachedIcons::replace(CachedIconSetByPath::iterator itr, const CachedIcon &cachedIcon)
+void CachedIcons::evictEntries(Shard &shard, std::size_t maxBytes)
 {
-	CachedIconSetByPath &pathIndex = m_cachedIconSet.get<1>();
-	pathIndex.replace(itr, cachedIcon);
+	while (shard.sizeInBytes > maxBytes && !shard.entries.empty())
+	{
+		auto oldest = std::prev(shard.entries.end());
+
+		// Since the exclusive lock is held, no other thread can set this flag in the meantime,
+		// so each entry is moved at most once here.
+		if (oldest->referenced.exchange(false, std::memory_order_relaxed))
+		{
+			shard.entries.splice(shard.entries.begin(), shard.entries, oldest);
+			continue;
+		}
+
+		shard.sizeInBytes -= getEntrySize(oldest->filePath);
+		shard.entriesByPath.erase(oldest->filePath);
+		shard.entries.erase(oldest);
+	}
+}
 
-	auto sequenceItr = m_cachedIconSet.iterator_to(*itr);
-	m_cachedIconSet.relocate(m_cachedIconSet.begin(), sequenceItr);
+std::size_t CachedIcons::getSizeInBytes() const
+{
+	std::size_t sizeInBytes = 0;
+
+	for (const auto &shard : m_shards)
+	{
+		std::shared_lock lock(shard.mutex);
+		sizeInBytes += shard.sizeInBytes;
+	}
+
+	return sizeInBytes;
+}
+
+std::size_t CachedIcons::getEntrySize(std::wstring_view filePath)
+{
+	// This includes the list node and the index entry. The index is a node-based hash table, so
+	// each entry requires a node (containing the key and value) and a bucket.
+	constexpr std::size_t listNodeOverhead = 2 * sizeof(void *);
+	constexpr std::size_t indexEntrySize = sizeof(std::wstring_view)
+		+ sizeof(EntryList::iterator) + 2 * sizeof(void *) + sizeof(std::size_t);
+
+	return sizeof(Entry) + listNodeOverhead + indexEntrySize
+		+ (filePath.size() + 1) * sizeof(wchar_t);
+}
+
+CachedIcons::Shard &CachedIcons::getShard(std::wstring_view filePath)
+{
+	return m_shards[getShardIndex(filePath)];
+}
+
+const CachedIcons::Shard &CachedIcons::getShard(std::wstring_view filePath) const
+{
+	return m_shards[getShardIndex(filePath)];
 }
 
-CachedIcons::iterator CachedIcons::findByPath(const std::wstring &filePath)
+std::size_t CachedIcons::getShardIndex(std::wstring_view filePath) const
 {
-	CachedIconSetByPath &pathIndex = m_cachedIconSet.get<1>();
-	return pathIndex.find(filePath);
+	// The hash is mixed before being used here, since the low bits also select the bucket within
+	// the shard's index. Without this, all the paths in a shard would use the same few buckets.
+	auto hash = static_cast<unsigned long long>(std::hash<std::wstring_view>()(filePath));
+	return static_cast<std::size_t>((hash * 0x9E3779B97F4A7C15ULL) >> 32) % m_shards.size();
 }
\ No newline at end of file
@@ -4,39 +4,75 @@
 
 #pragma once
 
-#include <boost/multi_index/hashed_index.hpp>
-#include <boost/multi_index/member.hpp>
-#include <boost/multi_index/sequenced_index.hpp>
-#include <boost/multi_index_container.hpp>
-
-struct CachedIcon
-{
-	std::wstring filePath;
-	int iconIndex;
-};
+#include <atomic>
+#include <list>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
+// Maps file paths to system image list icon indexes. This class is safe to use from multiple
+// threads, so that the icon threads can add their results directly.
+//
+// The cache is split into shards, chosen by hashing the path. Each shard has its own lock, so
+// threads working with different paths rarely contend. A lookup takes only a shared lock and
+// doesn't change the structure of the shard. That means lookups (e.g. from the UI thread) never
+// wait on each other, and only wait briefly on a concurrent update to the same shard.
+//
+// Each path is stored once, in its shard's entry list; the shard's index refers to it through a
+// string view. Eviction approximates LRU with the CLOCK algorithm. A lookup marks its entry as
+// recently used. Once a shard exceeds its share of the capacity, entries are checked from oldest
+// to newest, and recently used ones get a second chance.
 class CachedIcons
 {
 public:
-	typedef boost::multi_index_container<CachedIcon,
-		boost::multi_index::indexed_by<boost::multi_index::sequenced<>,
-			boost::multi_index::hashed_unique<
-				boost::multi_index::member<CachedIcon, std::wstring, &CachedIcon::filePath>>>>
-		CachedIconSet;
+	static constexpr std::size_t DEFAULT_NUM_SHARDS = 16;
+
+	// The capacity is the approximate maximum amount of memory the cache will use, in bytes.
+	explicit CachedIcons(std::size_t maxBytes, std::size_t numShards = DEFAULT_NUM_SHARDS);
 
-	using CachedIconSetByPath = CachedIconSet::nth_index<1>::type;
-	using iterator = CachedIconSetByPath::iterator;
+	std::optional<int> findByPath(std::wstring_view filePath) const;
+	void addOrUpdateFileIcon(std::wstring_view filePath, int iconIndex);
 
-	CachedIcons(std::size_t maxItems);
+	std::size_t getSizeInBytes() const;
 
-	iterator end();
+	// Evicts entries until the cache uses at most (approximately) the specified amount of memory.
+	// The capacity of the cache is unchanged, so it can grow again afterwards.
+	void trimToSize(std::size_t maxBytes);
 
-	void addOrUpdateFileIcon(const std::wstring &filePath, int iconIndex);
-	void insert(const CachedIcon &cachedIcon);
-	void replace(CachedIconSetByPath::iterator itr, const CachedIcon &cachedIcon);
-	iterator findByPath(const std::wstring &filePath);
+	// The approximate amount of memory used to store an icon for the specified path.
+	static std::size_t getEntrySize(std::wstring_view filePath);
 
 private:
-	CachedIconSet m_cachedIconSet;
-	std::size_t m_maxItems;
+	struct Entry
+	{
+		Entry(std::wstring_view filePath, int iconIndex);
+
+		const std::wstring filePath;
+		std::atomic<int> iconIndex;
+		mutable std::atomic<bool> referenced;
+	};
+
+	using EntryList = std::list<Entry>;
+
+	struct Shard
+	{
+		mutable std::shared_mutex mutex;
+
+		// Ordered from newest to oldest.
+		EntryList entries;
+
+		std::unordered_map<std::wstring_view, EntryList::iterator> entriesByPath;
+		std::size_t sizeInBytes = 0;
+	};
+
+	Shard &getShard(std::wstring_view filePath);
+	const Shard &getShard(std::wstring_view filePath) const;
+	std::size_t getShardIndex(std::wstring_view filePath) const;
+	void evictEntries(Shard &shard, std::size_t maxBytes);
+
+	const std::size_t m_maxBytesPerShard;
+	std::vector<Shard> m_shards;
 };
\ No newline at end of file
@@ -0,0 +1,94 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ContextMenuPrewarmer.h"
+#include "ThreadQos.h"
+#include <wil/com.h>
+#include <wil/resource.h>
+
+ContextMenuPrewarmer::ContextMenuPrewarmer() :
+	m_threadPool(1, std::bind(CoInitializeEx, nullptr, COINIT_APARTMENTTHREADED), CoUninitialize)
+{
+}
+
+ContextMenuPrewarmer::~ContextMenuPrewarmer()
+{
+	m_threadPool.clear_queue();
+}
+
+void ContextMenuPrewarmer::Prewarm(PCIDLIST_ABSOLUTE pidlParent,
+	const std::vector<PCITEMID_CHILD> &pidlItems, const std::wstring &signature)
+{
+	if (m_prewarmedSignatures.contains(signature))
+	{
+		return;
+	}
+
+	// The set of signatures is small in practice. If it does grow large, it's simply reset, which
+	// at worst results in some menus being built again.
+	if (m_prewarmedSignatures.size() >= MAX_SIGNATURES)
+	{
+		m_prewarmedSignatures.clear();
+	}
+
+	m_prewarmedSignatures.insert(signature);
+
+	m_threadPool.clear_queue();
+
+	std::vector<unique_pidl_child> pidlItemsCopy;
+
+	for (auto pidl : pidlItems)
+	{
+		pidlItemsCopy.emplace_back(ILCloneChild(pidl));
+	}
+
+	m_threadPool.push([pidlParentCopy = unique_pidl_absolute(ILCloneFull(pidlParent)),
+						  pidlItemsCopy = std::move(pidlItemsCopy)](int id) {
+		UNREFERENCED_PARAMETER(id);
+
+		SetCurrentThreadTaskClass(TaskClass::Background);
+
+		std::vector<PCITEMID_CHILD> rawPidlItems;
+
+		for (const auto &pidl : pidlItemsCopy)
+		{
+			rawPidlItems.push_back(pidl.get());
+		}
+
+		BuildContextMenu(pidlParentCopy.get(), rawPidlItems);
+	});
+}
+
+// The menu that's built here is discarded. Only the side effect (of the shell extensions being
+// loaded and initialized) is of interest. None of the items are invoked.
+void ContextMenuPrewarmer::BuildContextMenu(
+	PCIDLIST_ABSOLUTE pidlParent, const std::vector<PCITEMID_CHILD> &pidlItems)
+{
+	wil::com_ptr_nothrow<IShellFolder> shellFolder;
+	HRESULT hr = BindToIdl(pidlParent, IID_PPV_ARGS(&shellFolder));
+
+	if (FAILED(hr))
+	{
+		return;
+	}
+
+	wil::com_ptr_nothrow<IContextMenu> contextMenu;
+	hr = GetUIObjectOf(shellFolder.get(), nullptr, static_cast<UINT>(pidlItems.size()),
+		pidlItems.data(), IID_PPV_ARGS(&contextMenu));
+
+	if (FAILED(hr))
+	{
+		return;
+	}
+
+	wil::unique_hmenu menu(CreatePopupMenu());
+
+	if (!menu)
+	{
+		return;
+	}
+
+	contextMenu->QueryContextMenu(menu.get(), 0, 1, 0x7FFF, CMF_NORMAL);
+}
\ No newline at end of file
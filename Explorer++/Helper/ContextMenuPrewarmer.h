@@ -0,0 +1,41 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "ShellHelper.h"
+#include "../ThirdParty/CTPL/cpl_stl.h"
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// Some shell extensions take a significant amount of time to load the first time they're asked to
+// add items to a context menu. This builds the context menu for a selection in the background, so
+// that the extensions involved have already been loaded (and the menu can be shown quickly) by the
+// time the user right-clicks.
+//
+// The caller supplies a signature for the selection (e.g. the set of file types selected). Since
+// the same extensions will be loaded for any selection with the same signature, the menu is only
+// built once per signature.
+class ContextMenuPrewarmer
+{
+public:
+	ContextMenuPrewarmer();
+	~ContextMenuPrewarmer();
+
+	void Prewarm(PCIDLIST_ABSOLUTE pidlParent, const std::vector<PCITEMID_CHILD> &pidlItems,
+		const std::wstring &signature);
+
+private:
+	static const size_t MAX_SIGNATURES = 256;
+
+	static void BuildContextMenu(
+		PCIDLIST_ABSOLUTE pidlParent, const std::vector<PCITEMID_CHILD> &pidlItems);
+
+	std::unordered_set<std::wstring> m_prewarmedSignatures;
+
+	// Only the most recent selection is relevant, so any earlier request that hasn't started yet is
+	// dropped when a new one is queued.
+	ctpl::thread_pool m_threadPool;
+};
\ No newline at end of file
@@ -0,0 +1,84 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "Crc32.h"
+#include <array>
+
+namespace
+{
+
+constexpr uint32_t POLYNOMIAL = 0xEDB88320;
+
+using CrcTables = std::array<std::array<uint32_t, 256>, 8>;
+
+// The data is processed 8 bytes at a time ("slicing-by-8"). Table 0 is the standard byte-wise
+// table. Table n gives the effect of a byte followed by n zero bytes, which allows the
+// contribution of each of the 8 bytes to be looked up independently.
+constexpr CrcTables BuildTables()
+{
+	CrcTables tables = {};
+
+	for (uint32_t i = 0; i < 256; i++)
+	{
+		uint32_t crc = i;
+
+		for (int bit = 0; bit < 8; bit++)
+		{
+			crc = (crc & 1) ? ((crc >> 1) ^ POLYNOMIAL) : (crc >> 1);
+		}
+
+		tables[0][i] = crc;
+	}
+
+	for (uint32_t i = 0; i < 256; i++)
+	{
+		for (size_t table = 1; table < tables.size(); table++)
+		{
+			uint32_t previous = tables[table - 1][i];
+			tables[table][i] = (previous >> 8) ^ tables[0][previous & 0xFF];
+		}
+	}
+
+	return tables;
+}
+
+constexpr CrcTables TABLES = BuildTables();
+
+}
+
+void Crc32::Update(const void *data, size_t size)
+{
+	auto *bytes = static_cast<const uint8_t *>(data);
+	uint32_t crc = m_crc;
+
+	while (size >= 8)
+	{
+		uint32_t low = crc
+			^ (static_cast<uint32_t>(bytes[0]) | (static_cast<uint32_t>(bytes[1]) << 8)
+				| (static_cast<uint32_t>(bytes[2]) << 16) | (static_cast<uint32_t>(bytes[3]) << 24));
+
+		crc = TABLES[7][low & 0xFF] ^ TABLES[6][(low >> 8) & 0xFF]
+			^ TABLES[5][(low >> 16) & 0xFF] ^ TABLES[4][low >> 24] ^ TABLES[3][bytes[4]]
+			^ TABLES[2][bytes[5]] ^ TABLES[1][bytes[6]] ^ TABLES[0][bytes[7]];
+
+		bytes += 8;
+		size -= 8;
+	}
+
+	while (size > 0)
+	{
+		crc = (crc >> 8) ^ TABLES[0][(crc ^ *bytes) & 0xFF];
+
+		bytes++;
+		size--;
+	}
+
+	m_crc = crc;
+}
+
+uint32_t Crc32::GetValue() const
+{
+	return ~m_crc;
+}
\ No newline at end of file
@@ -0,0 +1,20 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Computes the CRC-32 (as used by zip, PNG and SFV files) of a stream of data. The data can be
+// supplied incrementally, in blocks of any size.
+class Crc32
+{
+public:
+	void Update(const void *data, size_t size);
+	uint32_t GetValue() const;
+
+private:
+	uint32_t m_crc = 0xFFFFFFFF;
+};
\ No newline at end of file
@@ -130,6 +130,9 @@ std::vector<std::wstring> ExtractDroppedFilesList(IDataObject *dataObject)
 			continue;
 		}
 
+		// The buffer includes space for the terminating null, which shouldn't be part of the
+		// path.
+		fullFileName.resize(charactersCopied);
 		droppedFiles.push_back(fullFileName);
 	}
 
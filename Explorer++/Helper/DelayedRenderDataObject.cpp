@@ -0,0 +1,360 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "DelayedRenderDataObject.h"
+#include "DataExchangeHelper.h"
+#include "DragDropHelper.h"
+#include "iDataObject.h"
+#include "iEnumFormatEtc.h"
+#include <algorithm>
+#include <list>
+
+// Large enough to hold any path, including long paths.
+constexpr size_t MAX_PATH_LENGTH = 32768;
+
+namespace
+{
+
+// The items need to be copied, since the caller's items may be freed as soon as the data object
+// has been created.
+std::shared_ptr<const std::vector<unique_pidl_absolute>> CopyItems(
+	const std::vector<PCIDLIST_ABSOLUTE> &items)
+{
+	auto ownedItems = std::make_shared<std::vector<unique_pidl_absolute>>();
+	ownedItems->reserve(items.size());
+
+	for (auto pidl : items)
+	{
+		ownedItems->emplace_back(ILCloneFull(pidl));
+	}
+
+	return ownedItems;
+}
+
+}
+
+DelayedRenderDataObject::DelayedRenderDataObject(const std::vector<PCIDLIST_ABSOLUTE> &items) :
+	m_shellIdListFormat(static_cast<CLIPFORMAT>(RegisterClipboardFormat(CFSTR_SHELLIDLIST))),
+	m_items(CopyItems(items)),
+	m_cancelled(std::make_shared<std::atomic<bool>>(false)),
+	m_extraData(CreateDataObject(nullptr, nullptr, 0)),
+	m_inOperation(FALSE),
+	m_isOpAsync(FALSE)
+{
+	m_renderFuture = std::async(std::launch::async,
+		[items = m_items, cancelled = m_cancelled]() {
+			return RenderFormats(*items, *cancelled);
+		});
+}
+
+DelayedRenderDataObject::~DelayedRenderDataObject()
+{
+	// The future's destructor will wait for the background work to finish, so it's worth stopping
+	// that work early if the formats were never requested.
+	*m_cancelled = true;
+}
+
+DelayedRenderDataObject::RenderedFormats DelayedRenderDataObject::RenderFormats(
+	const std::vector<unique_pidl_absolute> &items, const std::atomic<bool> &cancelled)
+{
+	RenderedFormats renderedFormats;
+
+	if (items.empty())
+	{
+		return renderedFormats;
+	}
+
+	renderedFormats.hdrop = BuildHdrop(items, cancelled);
+
+	if (cancelled)
+	{
+		return renderedFormats;
+	}
+
+	renderedFormats.shellIdList = BuildShellIdList(items);
+
+	return renderedFormats;
+}
+
+std::optional<std::string> DelayedRenderDataObject::BuildHdrop(
+	const std::vector<unique_pidl_absolute> &items, const std::atomic<bool> &cancelled)
+{
+	// Each path is followed by a NULL character and the list is terminated by an additional NULL
+	// character.
+	std::wstring paths;
+	auto path = std::make_unique<wchar_t[]>(MAX_PATH_LENGTH);
+
+	for (const auto &item : items)
+	{
+		if (cancelled)
+		{
+			return std::nullopt;
+		}
+
+		if (!SHGetPathFromIDListEx(item.get(), path.get(), MAX_PATH_LENGTH, GPFIDL_DEFAULT))
+		{
+			continue;
+		}
+
+		paths.append(path.get());
+		paths.push_back('\0');
+	}
+
+	if (paths.empty())
+	{
+		return std::nullopt;
+	}
+
+	paths.push_back('\0');
+
+	DROPFILES dropFiles = {};
+	dropFiles.pFiles = sizeof(DROPFILES);
+	dropFiles.fWide = TRUE;
+
+	std::string data;
+	data.reserve(sizeof(dropFiles) + paths.size() * sizeof(wchar_t));
+	data.append(reinterpret_cast<const char *>(&dropFiles), sizeof(dropFiles));
+	data.append(reinterpret_cast<const char *>(paths.data()), paths.size() * sizeof(wchar_t));
+
+	return data;
+}
+
+// Builds a CIDA structure. If all the items share the same parent (which is the case when they're
+// selected in a single folder), the parent is stored once and each item is stored relative to it.
+// Otherwise, the desktop is used as the parent and each item is stored in full.
+std::string DelayedRenderDataObject::BuildShellIdList(
+	const std::vector<unique_pidl_absolute> &items)
+{
+	unique_pidl_absolute parent(ILCloneFull(items[0].get()));
+	ILRemoveLastID(parent.get());
+
+	bool commonParent = std::all_of(items.begin(), items.end(),
+		[&parent](const auto &item) {
+			return ILIsParent(parent.get(), item.get(), TRUE);
+		});
+
+	if (!commonParent)
+	{
+		// An empty IDList represents the desktop.
+		while (!ILIsEmpty(parent.get()))
+		{
+			ILRemoveLastID(parent.get());
+		}
+	}
+
+	size_t numItems = items.size();
+	size_t offsetTableSize = sizeof(UINT) * (numItems + 2);
+
+	std::string data(offsetTableSize, '\0');
+	auto appendIdList = [&data](PCUIDLIST_RELATIVE idList, size_t index) {
+		UINT offset = static_cast<UINT>(data.size());
+		memcpy(data.data() + sizeof(UINT) * (index + 1), &offset, sizeof(offset));
+		data.append(reinterpret_cast<const char *>(idList), ILGetSize(idList));
+	};
+
+	UINT count = static_cast<UINT>(numItems);
+	memcpy(data.data(), &count, sizeof(count));
+
+	appendIdList(parent.get(), 0);
+
+	for (size_t i = 0; i < numItems; i++)
+	{
+		appendIdList(commonParent ? ILFindLastID(items[i].get()) : items[i].get(), i + 1);
+	}
+
+	return data;
+}
+
+bool DelayedRenderDataObject::IsRenderedFormat(const FORMATETC *formatEtc) const
+{
+	return (formatEtc->cfFormat == CF_HDROP || formatEtc->cfFormat == m_shellIdListFormat)
+		&& formatEtc->dwAspect == DVASPECT_CONTENT && WI_IsFlagSet(formatEtc->tymed, TYMED_HGLOBAL);
+}
+
+const DelayedRenderDataObject::RenderedFormats &DelayedRenderDataObject::GetRenderedFormats()
+{
+	if (!m_renderedFormats)
+	{
+		m_renderedFormats = m_renderFuture.get();
+	}
+
+	return *m_renderedFormats;
+}
+
+// IDataObject
+IFACEMETHODIMP DelayedRenderDataObject::GetData(FORMATETC *formatEtc, STGMEDIUM *medium)
+{
+	if (!formatEtc || !medium)
+	{
+		return E_INVALIDARG;
+	}
+
+	if (!IsRenderedFormat(formatEtc))
+	{
+		return m_extraData->GetData(formatEtc, medium);
+	}
+
+	const auto &renderedFormats = GetRenderedFormats();
+	const std::string *data = &renderedFormats.shellIdList;
+
+	if (formatEtc->cfFormat == CF_HDROP)
+	{
+		if (!renderedFormats.hdrop)
+		{
+			return DV_E_FORMATETC;
+		}
+
+		data = &*renderedFormats.hdrop;
+	}
+
+	auto global = WriteDataToGlobal(data->data(), data->size());
+
+	if (!global)
+	{
+		return E_OUTOFMEMORY;
+	}
+
+	*medium = GetStgMediumForGlobal(global.release());
+
+	return S_OK;
+}
+
+IFACEMETHODIMP DelayedRenderDataObject::GetDataHere(FORMATETC *formatEtc, STGMEDIUM *medium)
+{
+	return m_extraData->GetDataHere(formatEtc, medium);
+}
+
+IFACEMETHODIMP DelayedRenderDataObject::QueryGetData(FORMATETC *formatEtc)
+{
+	if (!formatEtc)
+	{
+		return E_INVALIDARG;
+	}
+
+	// Whether CF_HDROP will actually be available isn't known until the formats have been
+	// rendered. Waiting for that here would defeat the purpose of this class, so the format is
+	// always reported as being available.
+	if (IsRenderedFormat(formatEtc))
+	{
+		return S_OK;
+	}
+
+	return m_extraData->QueryGetData(formatEtc);
+}
+
+IFACEMETHODIMP DelayedRenderDataObject::GetCanonicalFormatEtc(
+	FORMATETC *formatEtc, FORMATETC *formatEtcResult)
+{
+	return m_extraData->GetCanonicalFormatEtc(formatEtc, formatEtcResult);
+}
+
+IFACEMETHODIMP DelayedRenderDataObject::SetData(
+	FORMATETC *formatEtc, STGMEDIUM *medium, BOOL shouldRelease)
+{
+	return m_extraData->SetData(formatEtc, medium, shouldRelease);
+}
+
+IFACEMETHODIMP DelayedRenderDataObject::EnumFormatEtc(DWORD direction, IEnumFORMATETC **enumerator)
+{
+	if (!enumerator)
+	{
+		return E_INVALIDARG;
+	}
+
+	if (direction != DATADIR_GET)
+	{
+		return E_NOTIMPL;
+	}
+
+	std::list<FORMATETC> formats = {
+		{ CF_HDROP, nullptr, DVASPECT_CONTENT, -1, TYMED_HGLOBAL },
+		{ m_shellIdListFormat, nullptr, DVASPECT_CONTENT, -1, TYMED_HGLOBAL }
+	};
+
+	wil::com_ptr_nothrow<IEnumFORMATETC> extraFormats;
+	RETURN_IF_FAILED(m_extraData->EnumFormatEtc(DATADIR_GET, &extraFormats));
+
+	FORMATETC format;
+
+	while (extraFormats->Next(1, &format, nullptr) == S_OK)
+	{
+		formats.push_back(format);
+	}
+
+	return CreateEnumFormatEtc(formats, enumerator);
+}
+
+IFACEMETHODIMP DelayedRenderDataObject::DAdvise(
+	FORMATETC *formatEtc, DWORD advf, IAdviseSink *sink, DWORD *connection)
+{
+	UNREFERENCED_PARAMETER(formatEtc);
+	UNREFERENCED_PARAMETER(advf);
+	UNREFERENCED_PARAMETER(sink);
+	UNREFERENCED_PARAMETER(connection);
+
+	return OLE_E_ADVISENOTSUPPORTED;
+}
+
+IFACEMETHODIMP DelayedRenderDataObject::DUnadvise(DWORD connection)
+{
+	UNREFERENCED_PARAMETER(connection);
+
+	return OLE_E_ADVISENOTSUPPORTED;
+}
+
+IFACEMETHODIMP DelayedRenderDataObject::EnumDAdvise(IEnumSTATDATA **enumerator)
+{
+	UNREFERENCED_PARAMETER(enumerator);
+
+	return OLE_E_ADVISENOTSUPPORTED;
+}
+
+// IDataObjectAsyncCapability
+IFACEMETHODIMP DelayedRenderDataObject::GetAsyncMode(BOOL *isOpAsync)
+{
+	*isOpAsync = m_isOpAsync;
+
+	return S_OK;
+}
+
+IFACEMETHODIMP DelayedRenderDataObject::SetAsyncMode(BOOL doOpAsync)
+{
+	m_isOpAsync = doOpAsync;
+
+	return S_OK;
+}
+
+IFACEMETHODIMP DelayedRenderDataObject::InOperation(BOOL *inAsyncOp)
+{
+	*inAsyncOp = m_inOperation;
+
+	return S_OK;
+}
+
+IFACEMETHODIMP DelayedRenderDataObject::StartOperation(IBindCtx *reserved)
+{
+	UNREFERENCED_PARAMETER(reserved);
+
+	m_inOperation = TRUE;
+
+	return S_OK;
+}
+
+IFACEMETHODIMP DelayedRenderDataObject::EndOperation(
+	HRESULT result, IBindCtx *reserved, DWORD effects)
+{
+	UNREFERENCED_PARAMETER(result);
+	UNREFERENCED_PARAMETER(reserved);
+	UNREFERENCED_PARAMETER(effects);
+
+	m_inOperation = FALSE;
+	return S_OK;
+}
+
+// ITransferItemsSource
+const std::vector<unique_pidl_absolute> &DelayedRenderDataObject::GetTransferItems()
+{
+	return *m_items;
+}
\ No newline at end of file
@@ -0,0 +1,97 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "ShellHelper.h"
+#include "TransferItemsSource.h"
+#include <wil/com.h>
+#include <winrt/base.h>
+#include <objidl.h>
+#include <shldisp.h>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+// A data object for a set of shell items that offers the CF_HDROP and CFSTR_SHELLIDLIST formats,
+// without building either format up front.
+//
+// Building those formats (or the shell's own data object) for hundreds of thousands of items takes
+// long enough that a copy appears to stall. Here, both formats are built on a background thread
+// that's started when the object is created. A call to GetData() only has to wait if that work
+// hasn't finished yet.
+//
+// Unlike the shell's data object, only those two formats (plus anything added via SetData()) are
+// offered. Items that have no file system path are therefore only available through
+// CFSTR_SHELLIDLIST.
+//
+// The original items are also available through ITransferItemsSource, so that a transfer within
+// the process doesn't have to wait for the formats to be built at all.
+//
+// See DataObjectWrapper for why winrt::non_agile is used.
+class DelayedRenderDataObject :
+	public winrt::implements<DelayedRenderDataObject, IDataObject, IDataObjectAsyncCapability,
+		ITransferItemsSource, winrt::non_agile>
+{
+public:
+	DelayedRenderDataObject(const std::vector<PCIDLIST_ABSOLUTE> &items);
+	~DelayedRenderDataObject();
+
+	// IDataObject
+	IFACEMETHODIMP GetData(FORMATETC *formatEtc, STGMEDIUM *medium);
+	IFACEMETHODIMP GetDataHere(FORMATETC *formatEtc, STGMEDIUM *medium);
+	IFACEMETHODIMP QueryGetData(FORMATETC *formatEtc);
+	IFACEMETHODIMP GetCanonicalFormatEtc(FORMATETC *formatEtc, FORMATETC *formatEtcResult);
+	IFACEMETHODIMP SetData(FORMATETC *formatEtc, STGMEDIUM *medium, BOOL shouldRelease);
+	IFACEMETHODIMP EnumFormatEtc(DWORD direction, IEnumFORMATETC **enumerator);
+	IFACEMETHODIMP DAdvise(FORMATETC *formatEtc, DWORD advf, IAdviseSink *sink, DWORD *connection);
+	IFACEMETHODIMP DUnadvise(DWORD connection);
+	IFACEMETHODIMP EnumDAdvise(IEnumSTATDATA **enumerator);
+
+	// IDataObjectAsyncCapability
+	IFACEMETHODIMP GetAsyncMode(BOOL *isOpAsync);
+	IFACEMETHODIMP SetAsyncMode(BOOL doOpAsync);
+	IFACEMETHODIMP InOperation(BOOL *inAsyncOp);
+	IFACEMETHODIMP StartOperation(IBindCtx *reserved);
+	IFACEMETHODIMP EndOperation(HRESULT result, IBindCtx *reserved, DWORD effects);
+
+	// ITransferItemsSource
+	const std::vector<unique_pidl_absolute> &GetTransferItems() override;
+
+private:
+	struct RenderedFormats
+	{
+		// Empty if none of the items has a file system path.
+		std::optional<std::string> hdrop;
+
+		std::string shellIdList;
+	};
+
+	static RenderedFormats RenderFormats(
+		const std::vector<unique_pidl_absolute> &items, const std::atomic<bool> &cancelled);
+	static std::optional<std::string> BuildHdrop(
+		const std::vector<unique_pidl_absolute> &items, const std::atomic<bool> &cancelled);
+	static std::string BuildShellIdList(const std::vector<unique_pidl_absolute> &items);
+
+	bool IsRenderedFormat(const FORMATETC *formatEtc) const;
+	const RenderedFormats &GetRenderedFormats();
+
+	const CLIPFORMAT m_shellIdListFormat;
+
+	// Shared with the background thread that builds the formats.
+	const std::shared_ptr<const std::vector<unique_pidl_absolute>> m_items;
+
+	std::shared_ptr<std::atomic<bool>> m_cancelled;
+	std::future<RenderedFormats> m_renderFuture;
+	std::optional<RenderedFormats> m_renderedFormats;
+
+	// Holds any additional formats set on this object (e.g. the preferred drop effect).
+	wil::com_ptr_nothrow<IDataObject> m_extraData;
+
+	BOOL m_inOperation;
+	BOOL m_isOpAsync;
+};
\ No newline at end of file
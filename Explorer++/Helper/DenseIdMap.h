@@ -0,0 +1,183 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <cassert>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Maps integer IDs to values, where the IDs are allocated sequentially, starting from 0. Values are
+// found by indexing directly into a vector, rather than by hashing the ID. Each value is allocated
+// separately, so references remain valid as other values are added, and an ID that's not in use
+// costs only one pointer. When most of the allocated IDs are in use, that's considerably more
+// compact than an unordered_map.
+template <typename T>
+class DenseIdMap
+{
+private:
+	using Slots = std::vector<std::unique_ptr<T>>;
+
+public:
+	// Iterates over the values in ID order. Dereferencing produces an (id, value) pair, so that the
+	// map can be iterated in the same way as a standard map.
+	template <bool IsConst>
+	class IteratorBase
+	{
+	public:
+		using SlotIterator =
+			std::conditional_t<IsConst, typename Slots::const_iterator, typename Slots::iterator>;
+		using Reference = std::conditional_t<IsConst, const T &, T &>;
+
+		IteratorBase(SlotIterator current, SlotIterator begin, SlotIterator end) :
+			m_current(current),
+			m_begin(begin),
+			m_end(end)
+		{
+			SkipEmptySlots();
+		}
+
+		std::pair<int, Reference> operator*() const
+		{
+			return { static_cast<int>(m_current - m_begin), **m_current };
+		}
+
+		IteratorBase &operator++()
+		{
+			++m_current;
+			SkipEmptySlots();
+			return *this;
+		}
+
+		bool operator==(const IteratorBase &other) const
+		{
+			return m_current == other.m_current;
+		}
+
+	private:
+		void SkipEmptySlots()
+		{
+			while (m_current != m_end && !*m_current)
+			{
+				++m_current;
+			}
+		}
+
+		SlotIterator m_current;
+		SlotIterator m_begin;
+		SlotIterator m_end;
+	};
+
+	using Iterator = IteratorBase<false>;
+	using ConstIterator = IteratorBase<true>;
+
+	// The ID shouldn't already be in use.
+	T &Insert(int id, T value)
+	{
+		assert(id >= 0);
+
+		if (static_cast<size_t>(id) >= m_slots.size())
+		{
+			m_slots.resize(id + 1);
+		}
+
+		auto &slot = m_slots[id];
+		assert(!slot);
+
+		if (!slot)
+		{
+			m_size++;
+		}
+
+		slot = std::make_unique<T>(std::move(value));
+		return *slot;
+	}
+
+	// Throws std::out_of_range if the ID isn't in use.
+	T &Get(int id)
+	{
+		T *value = Find(id);
+
+		if (!value)
+		{
+			throw std::out_of_range("Invalid ID");
+		}
+
+		return *value;
+	}
+
+	const T &Get(int id) const
+	{
+		return const_cast<DenseIdMap *>(this)->Get(id);
+	}
+
+	T *Find(int id)
+	{
+		if (id < 0 || static_cast<size_t>(id) >= m_slots.size())
+		{
+			return nullptr;
+		}
+
+		return m_slots[id].get();
+	}
+
+	const T *Find(int id) const
+	{
+		return const_cast<DenseIdMap *>(this)->Find(id);
+	}
+
+	bool Contains(int id) const
+	{
+		return Find(id) != nullptr;
+	}
+
+	void Erase(int id)
+	{
+		if (!Contains(id))
+		{
+			return;
+		}
+
+		m_slots[id].reset();
+		m_size--;
+	}
+
+	void Clear()
+	{
+		m_slots.clear();
+		m_size = 0;
+	}
+
+	size_t Size() const
+	{
+		return m_size;
+	}
+
+	Iterator begin()
+	{
+		return Iterator(m_slots.begin(), m_slots.begin(), m_slots.end());
+	}
+
+	Iterator end()
+	{
+		return Iterator(m_slots.end(), m_slots.begin(), m_slots.end());
+	}
+
+	ConstIterator begin() const
+	{
+		return ConstIterator(m_slots.cbegin(), m_slots.cbegin(), m_slots.cend());
+	}
+
+	ConstIterator end() const
+	{
+		return ConstIterator(m_slots.cend(), m_slots.cbegin(), m_slots.cend());
+	}
+
+private:
+	Slots m_slots;
+	size_t m_size = 0;
+};
\ No newline at end of file
@@ -13,6 +13,7 @@
 #include "Helper.h"
 #include "Macros.h"
 #include "RegistrySettings.h"
+#include "RegistryValueCache.h"
 #include "WindowHelper.h"
 #include "XMLSettings.h"
 #include <wil/com.h>
@@ -70,11 +71,13 @@ void DialogSettings::LoadRegistrySettings(HKEY hParentKey)
 
 	if (lRes == ERROR_SUCCESS)
 	{
+		RegistryValueCache dialogValues(hKey);
+
 		if (m_bSavePosition)
 		{
 			DWORD dwSize = sizeof(POINT);
-			RegQueryValueEx(
-				hKey, SETTING_POSITION, nullptr, nullptr, (LPBYTE) &m_ptDialog, &dwSize);
+			RegistrySettings::QueryValue(
+				hKey, SETTING_POSITION, nullptr, (LPBYTE) &m_ptDialog, &dwSize);
 
 			RegistrySettings::ReadDword(hKey, SETTING_WIDTH, reinterpret_cast<DWORD *>(&m_iWidth));
 			RegistrySettings::ReadDword(
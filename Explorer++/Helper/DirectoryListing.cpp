@@ -0,0 +1,247 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "DirectoryListing.h"
+#include "StringHelper.h"
+#include <locale>
+#include <sstream>
+
+namespace
+{
+
+std::wstring FormatCount(uint64_t count)
+{
+	std::wstringstream ss;
+	ss.imbue(std::locale(""));
+	ss << count;
+	return ss.str();
+}
+
+}
+
+DirectoryListingFormatter::DirectoryListingFormatter(Format format, OutputCallback output) :
+	m_format(format),
+	m_output(std::move(output))
+{
+}
+
+bool DirectoryListingFormatter::UsesSections(Format format)
+{
+	return format == Format::Text;
+}
+
+void DirectoryListingFormatter::Begin(std::wstring_view directory, std::wstring_view date)
+{
+	switch (m_format)
+	{
+	case Format::Text:
+		WriteTextHeading(L"Directory");
+		m_output(directory);
+		m_output(L"\r\n\r\n");
+
+		WriteTextHeading(L"Date");
+		m_output(date);
+		m_output(L"\r\n");
+		break;
+
+	case Format::Csv:
+		WriteCsvRow({ L"Path", L"Type", L"Size", L"Date Modified" });
+		break;
+
+	case Format::Json:
+		m_output(L"{\r\n\t\"directory\": \"");
+		m_output(EscapeJsonString(directory));
+		m_output(L"\",\r\n\t\"date\": \"");
+		m_output(EscapeJsonString(date));
+		m_output(L"\",\r\n\t\"items\": [");
+		break;
+	}
+}
+
+void DirectoryListingFormatter::BeginSection(Section section)
+{
+	if (m_format != Format::Text)
+	{
+		return;
+	}
+
+	m_output(L"\r\n");
+	WriteTextHeading((section == Section::Folders) ? L"Folders" : L"Files");
+}
+
+void DirectoryListingFormatter::AddEntry(const Entry &entry)
+{
+	if (entry.isFolder)
+	{
+		m_numFolders++;
+	}
+	else
+	{
+		m_numFiles++;
+		m_totalSize += entry.size;
+	}
+
+	std::wstring_view type = entry.isFolder ? L"folder" : L"file";
+	std::wstring size = std::to_wstring(entry.isFolder ? 0 : entry.size);
+
+	switch (m_format)
+	{
+	case Format::Text:
+		m_output(entry.path);
+		m_output(L"\r\n");
+		break;
+
+	case Format::Csv:
+		WriteCsvRow({ entry.path, type, size, entry.dateModified });
+		break;
+
+	case Format::Json:
+		m_output(m_firstEntry ? L"\r\n" : L",\r\n");
+		m_output(L"\t\t{ \"path\": \"");
+		m_output(EscapeJsonString(entry.path));
+		m_output(L"\", \"type\": \"");
+		m_output(type);
+		m_output(L"\", \"size\": ");
+		m_output(size);
+		m_output(L", \"dateModified\": \"");
+		m_output(EscapeJsonString(entry.dateModified));
+		m_output(L"\" }");
+		break;
+	}
+
+	m_firstEntry = false;
+}
+
+void DirectoryListingFormatter::End()
+{
+	switch (m_format)
+	{
+	case Format::Text:
+	{
+		m_output(L"\r\n");
+		WriteTextHeading(L"Statistics");
+		m_output(L"Number of folders: " + FormatCount(m_numFolders) + L"\r\n");
+		m_output(L"Number of files: " + FormatCount(m_numFiles) + L"\r\n");
+
+		ULARGE_INTEGER totalSize;
+		totalSize.QuadPart = m_totalSize;
+
+		TCHAR szTotalSize[32];
+		FormatSizeString(totalSize, szTotalSize, SIZEOF_ARRAY(szTotalSize));
+		m_output(L"Total size of files: " + std::wstring(szTotalSize) + L"\r\n");
+	}
+	break;
+
+	case Format::Csv:
+		// The statistics can be derived from the rows themselves, so aren't included.
+		break;
+
+	case Format::Json:
+		m_output(m_firstEntry ? L"]," : L"\r\n\t],");
+		m_output(L"\r\n\t\"statistics\": { \"folders\": " + std::to_wstring(m_numFolders)
+			+ L", \"files\": " + std::to_wstring(m_numFiles) + L", \"totalSize\": "
+			+ std::to_wstring(m_totalSize) + L" }\r\n}\r\n");
+		break;
+	}
+}
+
+void DirectoryListingFormatter::WriteTextHeading(std::wstring_view heading)
+{
+	m_output(heading);
+	m_output(L"\r\n");
+	m_output(std::wstring(heading.size(), '-'));
+	m_output(L"\r\n");
+}
+
+void DirectoryListingFormatter::WriteCsvRow(std::initializer_list<std::wstring_view> fields)
+{
+	bool first = true;
+
+	for (auto field : fields)
+	{
+		if (!first)
+		{
+			m_output(L",");
+		}
+
+		m_output(EscapeCsvField(field));
+		first = false;
+	}
+
+	m_output(L"\r\n");
+}
+
+// As per RFC 4180, fields containing a separator, quote or line break are quoted, with any quotes
+// within them doubled.
+std::wstring DirectoryListingFormatter::EscapeCsvField(std::wstring_view field)
+{
+	if (field.find_first_of(L",\"\r\n") == std::wstring_view::npos)
+	{
+		return std::wstring(field);
+	}
+
+	std::wstring escaped = L"\"";
+
+	for (wchar_t ch : field)
+	{
+		if (ch == '"')
+		{
+			escaped += '"';
+		}
+
+		escaped += ch;
+	}
+
+	escaped += '"';
+
+	return escaped;
+}
+
+std::wstring DirectoryListingFormatter::EscapeJsonString(std::wstring_view str)
+{
+	std::wstring escaped;
+	escaped.reserve(str.size());
+
+	for (wchar_t ch : str)
+	{
+		switch (ch)
+		{
+		case '"':
+			escaped += L"\\\"";
+			break;
+
+		case '\\':
+			escaped += L"\\\\";
+			break;
+
+		case '\n':
+			escaped += L"\\n";
+			break;
+
+		case '\r':
+			escaped += L"\\r";
+			break;
+
+		case '\t':
+			escaped += L"\\t";
+			break;
+
+		default:
+			if (ch < 0x20)
+			{
+				wchar_t unicodeEscape[8];
+				swprintf_s(unicodeEscape, L"\\u%04x", static_cast<unsigned int>(ch));
+				escaped += unicodeEscape;
+			}
+			else
+			{
+				escaped += ch;
+			}
+			break;
+		}
+	}
+
+	return escaped;
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+
+// Formats a listing of the contents of a directory as plain text, CSV or JSON. Output is produced
+// as each entry is added, rather than being accumulated, so the amount of memory used doesn't
+// depend on the number of entries.
+class DirectoryListingFormatter
+{
+public:
+	enum class Format
+	{
+		Text,
+		Csv,
+		Json
+	};
+
+	enum class Section
+	{
+		Folders,
+		Files
+	};
+
+	struct Entry
+	{
+		// Relative to the directory being listed.
+		std::wstring_view path;
+
+		bool isFolder;
+		uint64_t size;
+
+		// In ISO 8601 format. Only used by the CSV and JSON formats.
+		std::wstring_view dateModified;
+	};
+
+	using OutputCallback = std::function<void(std::wstring_view text)>;
+
+	DirectoryListingFormatter(Format format, OutputCallback output);
+
+	// In the text format, folders and files are listed separately. Entries then need to be added
+	// in two groups, each preceded by a call to BeginSection(). The other formats list entries in
+	// the order they're added and ignore sections.
+	static bool UsesSections(Format format);
+
+	void Begin(std::wstring_view directory, std::wstring_view date);
+	void BeginSection(Section section);
+	void AddEntry(const Entry &entry);
+
+	// Writes out the number of files and folders, as well as the total size of the files.
+	void End();
+
+	static std::wstring EscapeCsvField(std::wstring_view field);
+	static std::wstring EscapeJsonString(std::wstring_view str);
+
+private:
+	void WriteTextHeading(std::wstring_view heading);
+	void WriteCsvRow(std::initializer_list<std::wstring_view> fields);
+
+	const Format m_format;
+	const OutputCallback m_output;
+
+	bool m_firstEntry = true;
+	uint64_t m_numFolders = 0;
+	uint64_t m_numFiles = 0;
+	uint64_t m_totalSize = 0;
+};
\ No newline at end of file
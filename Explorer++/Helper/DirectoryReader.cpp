@@ -0,0 +1,194 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "DirectoryReader.h"
+#include <algorithm>
+#include <climits>
+#include <filesystem>
+
+DirectoryReader::DirectoryReader(const std::wstring &directory)
+{
+	if (OpenDirectoryHandle(directory))
+	{
+		return;
+	}
+
+	OpenFindHandle(directory);
+}
+
+bool DirectoryReader::OpenDirectoryHandle(const std::wstring &directory)
+{
+	m_directory.reset(CreateFile(directory.c_str(), FILE_LIST_DIRECTORY,
+		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+		FILE_FLAG_BACKUP_SEMANTICS, nullptr));
+
+	if (!m_directory)
+	{
+		return false;
+	}
+
+	m_buffer.resize(BUFFER_SIZE / sizeof(ULONGLONG));
+
+	// A directory with no entries at all (which is only possible for the root of a volume) fails
+	// the initial query with ERROR_NO_MORE_FILES. Any other failure is treated as the query not
+	// being supported, in which case the directory is read the standard way.
+	if (!QueryNextEntries(FileIdBothDirectoryRestartInfo) && m_error != ERROR_NO_MORE_FILES)
+	{
+		m_directory.reset();
+		m_buffer.clear();
+		return false;
+	}
+
+	m_stableFileIds = HasStableFileIds(m_directory.get());
+	m_open = true;
+
+	return true;
+}
+
+void DirectoryReader::OpenFindHandle(const std::wstring &directory)
+{
+	WIN32_FIND_DATA findData;
+	m_find.reset(FindFirstFileEx((std::filesystem::path(directory) / L"*").c_str(),
+		FindExInfoBasic, &findData, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH));
+
+	if (!m_find)
+	{
+		m_error = GetLastError();
+		return;
+	}
+
+	m_firstFindData = findData;
+	m_open = true;
+}
+
+bool DirectoryReader::QueryNextEntries(FILE_INFO_BY_HANDLE_CLASS infoClass)
+{
+	if (!GetFileInformationByHandleEx(m_directory.get(), infoClass, m_buffer.data(),
+			static_cast<DWORD>(m_buffer.size() * sizeof(ULONGLONG))))
+	{
+		m_error = GetLastError();
+		m_nextEntry = nullptr;
+		return false;
+	}
+
+	m_nextEntry = reinterpret_cast<const BYTE *>(m_buffer.data());
+	return true;
+}
+
+bool DirectoryReader::HasStableFileIds(HANDLE directory)
+{
+	WCHAR fileSystemName[MAX_PATH + 1];
+	BOOL res = GetVolumeInformationByHandleW(directory, nullptr, 0, nullptr, nullptr, nullptr,
+		fileSystemName, static_cast<DWORD>(std::size(fileSystemName)));
+
+	if (!res)
+	{
+		return false;
+	}
+
+	return lstrcmpi(fileSystemName, L"NTFS") == 0 || lstrcmpi(fileSystemName, L"ReFS") == 0;
+}
+
+bool DirectoryReader::IsOpen() const
+{
+	return m_open;
+}
+
+bool DirectoryReader::Next(WIN32_FIND_DATA &findData, ULONGLONG &fileId)
+{
+	if (!m_open)
+	{
+		return false;
+	}
+
+	if (m_find)
+	{
+		fileId = UNKNOWN_FILE_ID;
+
+		if (m_firstFindData)
+		{
+			findData = *m_firstFindData;
+			m_firstFindData.reset();
+			return true;
+		}
+
+		if (!FindNextFile(m_find.get(), &findData))
+		{
+			m_error = GetLastError();
+			return false;
+		}
+
+		return true;
+	}
+
+	if (!m_nextEntry)
+	{
+		if (m_error == ERROR_NO_MORE_FILES || !QueryNextEntries(FileIdBothDirectoryInfo))
+		{
+			return false;
+		}
+	}
+
+	const auto *entry = reinterpret_cast<const FILE_ID_BOTH_DIR_INFO *>(m_nextEntry);
+	ConvertEntry(*entry, findData);
+	fileId = m_stableFileIds ? GetFileIdFromLargeInteger(entry->FileId) : UNKNOWN_FILE_ID;
+
+	if (entry->NextEntryOffset == 0)
+	{
+		m_nextEntry = nullptr;
+	}
+	else
+	{
+		m_nextEntry += entry->NextEntryOffset;
+	}
+
+	return true;
+}
+
+DWORD DirectoryReader::GetError() const
+{
+	return m_error;
+}
+
+// ReFS reports an ID that can't be represented in 64 bits as -1, which (like 0) can't be used to
+// identify the file.
+ULONGLONG DirectoryReader::GetFileIdFromLargeInteger(const LARGE_INTEGER &fileId)
+{
+	auto id = static_cast<ULONGLONG>(fileId.QuadPart);
+
+	if (id == ULLONG_MAX)
+	{
+		return UNKNOWN_FILE_ID;
+	}
+
+	return id;
+}
+
+// This mirrors the information FindFirstFileEx() returns when FindExInfoBasic is used. In
+// particular, the short name isn't filled in and, for a reparse point, the reparse tag is returned
+// in dwReserved0 (the query returns it in place of the extended attribute size).
+void DirectoryReader::ConvertEntry(const FILE_ID_BOTH_DIR_INFO &entry, WIN32_FIND_DATA &findData)
+{
+	findData = {};
+	findData.dwFileAttributes = entry.FileAttributes;
+	findData.ftCreationTime = { entry.CreationTime.LowPart,
+		static_cast<DWORD>(entry.CreationTime.HighPart) };
+	findData.ftLastAccessTime = { entry.LastAccessTime.LowPart,
+		static_cast<DWORD>(entry.LastAccessTime.HighPart) };
+	findData.ftLastWriteTime = { entry.LastWriteTime.LowPart,
+		static_cast<DWORD>(entry.LastWriteTime.HighPart) };
+	findData.nFileSizeHigh = static_cast<DWORD>(entry.EndOfFile.HighPart);
+	findData.nFileSizeLow = entry.EndOfFile.LowPart;
+
+	if (WI_IsFlagSet(entry.FileAttributes, FILE_ATTRIBUTE_REPARSE_POINT))
+	{
+		findData.dwReserved0 = entry.EaSize;
+	}
+
+	size_t nameLength = std::min<size_t>(
+		entry.FileNameLength / sizeof(WCHAR), std::size(findData.cFileName) - 1);
+	std::copy_n(entry.FileName, nameLength, findData.cFileName);
+	findData.cFileName[nameLength] = '\0';
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "Macros.h"
+#include <wil/resource.h>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Reads the entries in a directory, in the same form as FindFirstFile() and FindNextFile(), along
+// with the file ID of each entry. The IDs are returned by the same query that returns the rest of
+// the entry, so they don't cost anything extra. They're only reported on file systems where an ID
+// remains the same when a file is renamed or moved within the volume (NTFS and ReFS). Elsewhere,
+// the ID of each entry is UNKNOWN_FILE_ID. If the directory can't be queried in this way (e.g.
+// because the network redirector doesn't support it), it's read with FindFirstFileEx() instead.
+class DirectoryReader
+{
+public:
+	static constexpr ULONGLONG UNKNOWN_FILE_ID = 0;
+
+	explicit DirectoryReader(const std::wstring &directory);
+
+	// Returns false if the directory couldn't be opened, in which case GetError() returns the
+	// reason.
+	bool IsOpen() const;
+
+	// Returns false once there are no more entries, or if an error occurs. GetError() will return
+	// ERROR_NO_MORE_FILES in the first case.
+	bool Next(WIN32_FIND_DATA &findData, ULONGLONG &fileId);
+
+	DWORD GetError() const;
+
+	static ULONGLONG GetFileIdFromLargeInteger(const LARGE_INTEGER &fileId);
+
+private:
+	DISALLOW_COPY_AND_ASSIGN(DirectoryReader);
+
+	static constexpr DWORD BUFFER_SIZE = 64 * 1024;
+
+	bool OpenDirectoryHandle(const std::wstring &directory);
+	void OpenFindHandle(const std::wstring &directory);
+	bool QueryNextEntries(FILE_INFO_BY_HANDLE_CLASS infoClass);
+	static bool HasStableFileIds(HANDLE directory);
+	static void ConvertEntry(const FILE_ID_BOTH_DIR_INFO &entry, WIN32_FIND_DATA &findData);
+
+	wil::unique_hfile m_directory;
+	bool m_stableFileIds = false;
+
+	// FILE_ID_BOTH_DIR_INFO contains 64-bit fields, so the buffer is kept QWORD-aligned.
+	std::vector<ULONGLONG> m_buffer;
+	const BYTE *m_nextEntry = nullptr;
+
+	wil::unique_hfind m_find;
+	std::optional<WIN32_FIND_DATA> m_firstFindData;
+
+	bool m_open = false;
+	DWORD m_error = ERROR_SUCCESS;
+};
\ No newline at end of file
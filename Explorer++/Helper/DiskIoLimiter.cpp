@@ -0,0 +1,56 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "DiskIoLimiter.h"
+#include "DriveInfo.h"
+#include <utility>
+
+DiskIoLimiter::Slot::Slot(std::counting_semaphore<> *semaphore) : m_semaphore(semaphore)
+{
+}
+
+DiskIoLimiter::Slot::~Slot()
+{
+	if (m_semaphore)
+	{
+		m_semaphore->release();
+	}
+}
+
+DiskIoLimiter::Slot::Slot(Slot &&other) noexcept :
+	m_semaphore(std::exchange(other.m_semaphore, nullptr))
+{
+}
+
+DiskIoLimiter::Slot DiskIoLimiter::Acquire(const std::wstring &path)
+{
+	// The storage information is cached, so this only queries the disk the first time a volume is
+	// seen.
+	StorageInfo storageInfo = GetStorageInfo(path);
+	std::counting_semaphore<> *semaphore;
+
+	{
+		std::scoped_lock lock(m_mutex);
+
+		auto &diskSemaphore = m_disks[storageInfo.diskId];
+
+		if (!diskSemaphore)
+		{
+			diskSemaphore =
+				std::make_unique<std::counting_semaphore<>>(storageInfo.ioSettings.parallelism);
+		}
+
+		semaphore = diskSemaphore.get();
+	}
+
+	semaphore->acquire();
+
+	return Slot(semaphore);
+}
+
+std::wstring DiskIoLimiter::GetDiskId(const std::wstring &path)
+{
+	return GetStorageInfo(path).diskId;
+}
\ No newline at end of file
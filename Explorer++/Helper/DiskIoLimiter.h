@@ -0,0 +1,50 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <semaphore>
+#include <string>
+#include <unordered_map>
+
+// Limits the number of large sequential reads that can be in progress on each physical disk at
+// once. Reading several files at the same time from a rotational disk is much slower than reading
+// them one after another, since the disk has to keep seeking between them. Solid state disks, on
+// the other hand, are only fully utilized when several reads are in flight. The limit for each
+// disk is the parallelism recommended by GetStorageInfo.
+//
+// Volumes are mapped to the physical disk they reside on, so that (for example) two partitions on
+// the same rotational disk share a single limit.
+class DiskIoLimiter
+{
+public:
+	// Releases the slot it holds when destroyed.
+	class Slot
+	{
+	public:
+		explicit Slot(std::counting_semaphore<> *semaphore);
+		~Slot();
+
+		Slot(Slot &&other) noexcept;
+		Slot(const Slot &) = delete;
+		Slot &operator=(const Slot &) = delete;
+
+	private:
+		std::counting_semaphore<> *m_semaphore;
+	};
+
+	// Blocks until a read can be started on the disk that contains the specified path.
+	[[nodiscard]] Slot Acquire(const std::wstring &path);
+
+	// Returns an identifier for the physical disk that contains the specified path. Paths on
+	// different volumes of the same disk return the same identifier. The first call for each
+	// volume queries the disk (see GetStorageInfo).
+	static std::wstring GetDiskId(const std::wstring &path);
+
+private:
+	std::mutex m_mutex;
+	std::unordered_map<std::wstring, std::unique_ptr<std::counting_semaphore<>>> m_disks;
+};
\ No newline at end of file
@@ -0,0 +1,114 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "DiskUsageTree.h"
+#include "FolderSizeCache.h"
+
+DiskUsageTree::DiskUsageTree(const std::wstring &rootPath) : m_rootPath(rootPath)
+{
+	m_root.name = rootPath;
+	m_pendingNodes.insert({ rootPath, &m_root });
+}
+
+void DiskUsageTree::Build(std::stop_token stopToken,
+	const std::function<void()> &periodicCallback, FolderSizeCache *cache)
+{
+	auto visitCallback = [this](const FolderVisit &visit) { OnFolderVisited(visit); };
+
+	if (cache)
+	{
+		cache->WalkFolder(m_rootPath, visitCallback, stopToken, periodicCallback, false);
+	}
+	else
+	{
+		WalkFolder(m_rootPath, visitCallback, stopToken, periodicCallback, nullptr, false);
+	}
+
+	{
+		std::scoped_lock lock(m_mutex);
+		m_pendingNodes.clear();
+	}
+
+	m_complete = !stopToken.stop_requested();
+	m_version++;
+}
+
+void DiskUsageTree::OnFolderVisited(const FolderVisit &visit)
+{
+	std::scoped_lock lock(m_mutex);
+
+	auto itr = m_pendingNodes.find(visit.path);
+
+	if (itr == m_pendingNodes.end())
+	{
+		return;
+	}
+
+	DiskUsageNode *node = itr->second;
+	m_pendingNodes.erase(itr);
+
+	node->visited = true;
+	node->unpopulated = visit.unpopulated;
+	node->filesSize = visit.contents.filesSize;
+	node->numFiles = visit.contents.numFiles;
+
+	node->children.reserve(visit.subfolderPaths.size());
+
+	for (size_t i = 0; i < visit.subfolderPaths.size(); i++)
+	{
+		auto child = std::make_unique<DiskUsageNode>();
+		child->name = visit.contents.subfolders[i];
+		child->parent = node;
+		m_pendingNodes.insert({ visit.subfolderPaths[i], child.get() });
+		node->children.push_back(std::move(child));
+	}
+
+	for (DiskUsageNode *current = node; current; current = current->parent)
+	{
+		current->totalSize += node->filesSize;
+	}
+
+	m_version++;
+}
+
+void DiskUsageTree::Read(const std::function<void(const DiskUsageNode &root)> &callback) const
+{
+	std::scoped_lock lock(m_mutex);
+	callback(m_root);
+}
+
+int DiskUsageTree::GetVersion() const
+{
+	return m_version;
+}
+
+bool DiskUsageTree::IsComplete() const
+{
+	return m_complete;
+}
+
+std::wstring DiskUsageTree::GetPath(const DiskUsageNode &node) const
+{
+	std::vector<const std::wstring *> names;
+
+	for (const DiskUsageNode *current = &node; current->parent; current = current->parent)
+	{
+		names.push_back(&current->name);
+	}
+
+	std::wstring path = m_rootPath;
+
+	for (auto itr = names.rbegin(); itr != names.rend(); ++itr)
+	{
+		if (!path.empty() && path.back() != '\\')
+		{
+			path += '\\';
+		}
+
+		path += **itr;
+	}
+
+	return path;
+}
\ No newline at end of file
@@ -0,0 +1,86 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "FolderSize.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class FolderSizeCache;
+
+// A single folder within a DiskUsageTree. Files aren't represented individually. Instead, each
+// folder records the combined size of the files directly within it.
+struct DiskUsageNode
+{
+	std::wstring name;
+	DiskUsageNode *parent = nullptr;
+
+	ULONGLONG filesSize = 0;
+	int numFiles = 0;
+
+	// The size of this folder, including everything found within it so far.
+	ULONGLONG totalSize = 0;
+
+	// Set once the folder itself has been processed. Until then, only the name is known.
+	bool visited = false;
+
+	// Set if the folder is a cloud placeholder that wasn't enumerated.
+	bool unpopulated = false;
+
+	std::vector<std::unique_ptr<DiskUsageNode>> children;
+};
+
+// Builds a tree of folder sizes, which can be read while it's still being built. The tree is built
+// by walking the root folder in parallel (see WalkFolder()), with the size of each folder being
+// added to each of its ancestors as soon as the folder is processed. That means that a partially
+// built tree is always consistent: the total size of each folder is the sum of the sizes found
+// within it so far.
+//
+// Cloud placeholder folders are never populated, since building the tree shouldn't result in
+// files being downloaded.
+class DiskUsageTree
+{
+public:
+	explicit DiskUsageTree(const std::wstring &rootPath);
+
+	// Walks the root folder and fills in the tree. If a cache is provided, folders that haven't
+	// changed since they were last cached won't be enumerated again. This should only be called
+	// once.
+	void Build(std::stop_token stopToken = {},
+		const std::function<void()> &periodicCallback = nullptr, FolderSizeCache *cache = nullptr);
+
+	// Invokes the callback with the root of the tree, while the tree is prevented from changing.
+	// The callback should return quickly, since it blocks the threads building the tree.
+	void Read(const std::function<void(const DiskUsageNode &root)> &callback) const;
+
+	// Returns a value that changes each time a folder is added to the tree, so that callers can
+	// skip re-reading a tree that hasn't changed.
+	int GetVersion() const;
+
+	bool IsComplete() const;
+
+	std::wstring GetPath(const DiskUsageNode &node) const;
+
+private:
+	void OnFolderVisited(const FolderVisit &visit);
+
+	const std::wstring m_rootPath;
+
+	mutable std::mutex m_mutex;
+	DiskUsageNode m_root;
+
+	// Nodes that have been created (as children of a visited folder), but haven't been visited
+	// themselves yet. Keyed by path.
+	std::unordered_map<std::wstring, DiskUsageNode *> m_pendingNodes;
+
+	std::atomic<int> m_version = 0;
+	std::atomic<bool> m_complete = false;
+};
\ No newline at end of file
@@ -0,0 +1,817 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "DisplayFormatter.h"
+#include <algorithm>
+#include <mutex>
+
+namespace
+{
+
+const ULONGLONG TICKS_PER_MILLISECOND = 10'000;
+const LONGLONG TICKS_PER_MINUTE = 60LL * 1000 * TICKS_PER_MILLISECOND;
+const ULONGLONG TICKS_PER_DAY = 24ULL * 60 * TICKS_PER_MINUTE;
+
+const WCHAR *const SIZE_UNITS[] = { L"bytes", L"KB", L"MB", L"GB", L"TB", L"PB" };
+
+ULONGLONG FileTimeToTicks(const FILETIME &fileTime)
+{
+	ULARGE_INTEGER ticks;
+	ticks.LowPart = fileTime.dwLowDateTime;
+	ticks.HighPart = fileTime.dwHighDateTime;
+	return ticks.QuadPart;
+}
+
+FILETIME TicksToFileTime(ULONGLONG ticks)
+{
+	ULARGE_INTEGER value;
+	value.QuadPart = ticks;
+	return { value.LowPart, value.HighPart };
+}
+
+std::optional<ULONGLONG> SystemTimeToTicks(const SYSTEMTIME &systemTime)
+{
+	FILETIME fileTime;
+
+	if (!SystemTimeToFileTime(&systemTime, &fileTime))
+	{
+		return std::nullopt;
+	}
+
+	return FileTimeToTicks(fileTime);
+}
+
+// Returns the number of days between 1 January 1601 and the date of the specified time.
+std::optional<ULONGLONG> GetDayNumber(const SYSTEMTIME &systemTime)
+{
+	SYSTEMTIME date = {};
+	date.wYear = systemTime.wYear;
+	date.wMonth = systemTime.wMonth;
+	date.wDay = systemTime.wDay;
+
+	auto ticks = SystemTimeToTicks(date);
+
+	if (!ticks)
+	{
+		return std::nullopt;
+	}
+
+	return *ticks / TICKS_PER_DAY;
+}
+
+int GetDaysInMonth(int year, int month)
+{
+	static const int DAYS_IN_MONTH[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+	if (month == 2 && ((year % 4 == 0 && year % 100 != 0) || year % 400 == 0))
+	{
+		return 29;
+	}
+
+	return DAYS_IN_MONTH[month - 1];
+}
+
+// Returns the time (in UTC) of a transition specified in a TIME_ZONE_INFORMATION structure. The
+// transition is given in local time, with the bias being the one in effect before the transition.
+std::optional<ULONGLONG> GetTransitionTime(WORD year, const SYSTEMTIME &transition, LONG bias)
+{
+	SYSTEMTIME localTime = transition;
+
+	if (transition.wYear == 0)
+	{
+		// The transition is in "day-in-month" format. wDay is the occurrence of the day within
+		// the month, with 5 representing the last occurrence.
+		if (transition.wMonth < 1 || transition.wMonth > 12)
+		{
+			return std::nullopt;
+		}
+
+		SYSTEMTIME firstDay = {};
+		firstDay.wYear = year;
+		firstDay.wMonth = transition.wMonth;
+		firstDay.wDay = 1;
+
+		auto firstDayTicks = SystemTimeToTicks(firstDay);
+
+		if (!firstDayTicks)
+		{
+			return std::nullopt;
+		}
+
+		// 1 January 1601 was a Monday.
+		int firstDayOfWeek = static_cast<int>((*firstDayTicks / TICKS_PER_DAY + 1) % 7);
+		int day = 1 + (transition.wDayOfWeek - firstDayOfWeek + 7) % 7 + (transition.wDay - 1) * 7;
+
+		while (day > GetDaysInMonth(year, transition.wMonth))
+		{
+			day -= 7;
+		}
+
+		localTime.wYear = year;
+		localTime.wDay = static_cast<WORD>(day);
+		localTime.wDayOfWeek = 0;
+	}
+	else if (transition.wYear != year)
+	{
+		return std::nullopt;
+	}
+
+	auto localTicks = SystemTimeToTicks(localTime);
+
+	if (!localTicks)
+	{
+		return std::nullopt;
+	}
+
+	return *localTicks + bias * TICKS_PER_MINUTE;
+}
+
+std::wstring GetLocaleString(LCTYPE type)
+{
+	WCHAR value[128];
+	int res = GetLocaleInfoEx(
+		LOCALE_NAME_USER_DEFAULT, type, value, static_cast<int>(std::size(value)));
+
+	if (res == 0)
+	{
+		return {};
+	}
+
+	return value;
+}
+
+}
+
+DisplayFormatter::DisplayFormatter() : DisplayFormatter(GetUserLocaleFormat())
+{
+}
+
+DisplayFormatter::DisplayFormatter(const LocaleFormat &localeFormat) :
+	m_localeFormat(localeFormat),
+	m_timeElements(ParseTimeFormat(localeFormat.timeFormat))
+{
+}
+
+DisplayFormatter::LocaleFormat DisplayFormatter::GetUserLocaleFormat()
+{
+	LocaleFormat localeFormat;
+	localeFormat.timeFormat = GetLocaleString(LOCALE_STIMEFORMAT);
+	localeFormat.amDesignator = GetLocaleString(LOCALE_S1159);
+	localeFormat.pmDesignator = GetLocaleString(LOCALE_S2359);
+	localeFormat.decimalSeparator = GetLocaleString(LOCALE_SDECIMAL);
+	localeFormat.thousandSeparator = GetLocaleString(LOCALE_STHOUSAND);
+	localeFormat.repeatLastGroup = false;
+
+	if (localeFormat.decimalSeparator.empty())
+	{
+		localeFormat.decimalSeparator = L".";
+	}
+
+	// The grouping is given as a list of sizes, separated by semicolons (e.g. "3;0" or "3;2;0"). A
+	// trailing 0 indicates that the last size is repeated.
+	std::wstring grouping = GetLocaleString(LOCALE_SGROUPING);
+	size_t position = 0;
+
+	while (position < grouping.size())
+	{
+		size_t separator = grouping.find(L';', position);
+
+		if (separator == std::wstring::npos)
+		{
+			separator = grouping.size();
+		}
+
+		std::wstring groupSize = grouping.substr(position, separator - position);
+		localeFormat.grouping.push_back(_wtoi(groupSize.c_str()));
+		position = separator + 1;
+	}
+
+	if (!localeFormat.grouping.empty() && localeFormat.grouping.back() == 0)
+	{
+		localeFormat.grouping.pop_back();
+		localeFormat.repeatLastGroup = true;
+	}
+
+	return localeFormat;
+}
+
+std::vector<DisplayFormatter::TimeElement> DisplayFormatter::ParseTimeFormat(
+	const std::wstring &timeFormat)
+{
+	std::vector<TimeElement> elements;
+
+	auto appendLiteral = [&elements](wchar_t character) {
+		if (elements.empty() || elements.back().type != TimeElementType::Literal)
+		{
+			elements.push_back({ TimeElementType::Literal, false, L"" });
+		}
+
+		elements.back().literal += character;
+	};
+
+	size_t i = 0;
+
+	while (i < timeFormat.size())
+	{
+		wchar_t character = timeFormat[i];
+
+		// Text within single quotes is copied as-is, with two consecutive quotes representing a
+		// single quote.
+		if (character == L'\'')
+		{
+			if (i + 1 < timeFormat.size() && timeFormat[i + 1] == L'\'')
+			{
+				appendLiteral(L'\'');
+				i += 2;
+				continue;
+			}
+
+			i++;
+
+			while (i < timeFormat.size())
+			{
+				if (timeFormat[i] == L'\'')
+				{
+					if (i + 1 < timeFormat.size() && timeFormat[i + 1] == L'\'')
+					{
+						appendLiteral(L'\'');
+						i += 2;
+						continue;
+					}
+
+					i++;
+					break;
+				}
+
+				appendLiteral(timeFormat[i]);
+				i++;
+			}
+
+			continue;
+		}
+
+		size_t count = 1;
+
+		while (i + count < timeFormat.size() && timeFormat[i + count] == character)
+		{
+			count++;
+		}
+
+		std::optional<TimeElementType> type;
+
+		switch (character)
+		{
+		case L'h':
+			type = TimeElementType::Hour12;
+			break;
+
+		case L'H':
+			type = TimeElementType::Hour24;
+			break;
+
+		case L'm':
+			type = TimeElementType::Minute;
+			break;
+
+		case L's':
+			type = TimeElementType::Second;
+			break;
+
+		case L't':
+			type = TimeElementType::Designator;
+			break;
+		}
+
+		if (type)
+		{
+			elements.push_back({ *type, count > 1, L"" });
+		}
+		else
+		{
+			for (size_t j = 0; j < count; j++)
+			{
+				appendLiteral(character);
+			}
+		}
+
+		i += count;
+	}
+
+	return elements;
+}
+
+std::optional<SYSTEMTIME> DisplayFormatter::ConvertToLocalTime(const FILETIME &utcTime)
+{
+	ULONGLONG utcTicks = FileTimeToTicks(utcTime);
+	std::optional<LONGLONG> offset;
+
+	{
+		std::shared_lock lock(m_mutex);
+
+		for (const auto &period : m_timeZonePeriods)
+		{
+			if (utcTicks >= period.start && utcTicks < period.end)
+			{
+				offset = period.offset;
+				break;
+			}
+		}
+	}
+
+	if (!offset)
+	{
+		auto period = FindTimeZonePeriod(utcTicks);
+
+		if (period)
+		{
+			std::unique_lock lock(m_mutex);
+
+			if (m_timeZonePeriods.size() >= MAX_CACHED_TIME_ZONE_PERIODS)
+			{
+				m_timeZonePeriods.clear();
+			}
+
+			m_timeZonePeriods.push_back(*period);
+			offset = period->offset;
+		}
+	}
+
+	SYSTEMTIME localTime;
+
+	if (!offset)
+	{
+		SYSTEMTIME systemTime;
+
+		if (!FileTimeToSystemTime(&utcTime, &systemTime)
+			|| !SystemTimeToTzSpecificLocalTime(nullptr, &systemTime, &localTime))
+		{
+			return std::nullopt;
+		}
+
+		return localTime;
+	}
+
+	FILETIME localFileTime = TicksToFileTime(utcTicks + *offset);
+
+	if (!FileTimeToSystemTime(&localFileTime, &localTime))
+	{
+		return std::nullopt;
+	}
+
+	return localTime;
+}
+
+// Returns the period (within the year containing the specified time) between daylight saving
+// transitions that contains the time. The transitions are calculated from the time zone rules for
+// the year. The offset at either end of the period is then checked against the system's own
+// conversion, so a period is only returned if its offset really is constant throughout.
+std::optional<DisplayFormatter::TimeZonePeriod> DisplayFormatter::FindTimeZonePeriod(
+	ULONGLONG utcTime) const
+{
+	SYSTEMTIME systemTime;
+	FILETIME fileTime = TicksToFileTime(utcTime);
+
+	if (!FileTimeToSystemTime(&fileTime, &systemTime))
+	{
+		return std::nullopt;
+	}
+
+	SYSTEMTIME yearStart = {};
+	yearStart.wYear = systemTime.wYear;
+	yearStart.wMonth = 1;
+	yearStart.wDay = 1;
+
+	SYSTEMTIME nextYearStart = yearStart;
+	nextYearStart.wYear++;
+
+	auto start = SystemTimeToTicks(yearStart);
+	auto end = SystemTimeToTicks(nextYearStart);
+
+	if (!start || !end)
+	{
+		return std::nullopt;
+	}
+
+	std::vector<ULONGLONG> boundaries = { *start, *end };
+
+	for (ULONGLONG transition : GetTimeZoneTransitions(systemTime.wYear))
+	{
+		if (transition > *start && transition < *end)
+		{
+			boundaries.push_back(transition);
+		}
+	}
+
+	std::sort(boundaries.begin(), boundaries.end());
+
+	auto itr = std::upper_bound(boundaries.begin(), boundaries.end(), utcTime);
+
+	if (itr == boundaries.begin() || itr == boundaries.end())
+	{
+		return std::nullopt;
+	}
+
+	TimeZonePeriod period = { *(itr - 1), *itr, 0 };
+
+	auto offset = RetrieveUtcOffset(utcTime);
+
+	if (!offset || RetrieveUtcOffset(period.start) != offset
+		|| RetrieveUtcOffset(period.end - 1) != offset)
+	{
+		return std::nullopt;
+	}
+
+	period.offset = *offset;
+
+	return period;
+}
+
+std::optional<LONGLONG> DisplayFormatter::RetrieveUtcOffset(ULONGLONG utcTime)
+{
+	// SYSTEMTIME only has millisecond precision.
+	utcTime -= utcTime % TICKS_PER_MILLISECOND;
+
+	SYSTEMTIME systemTime;
+	SYSTEMTIME localTime;
+	FILETIME fileTime = TicksToFileTime(utcTime);
+
+	if (!FileTimeToSystemTime(&fileTime, &systemTime)
+		|| !SystemTimeToTzSpecificLocalTime(nullptr, &systemTime, &localTime))
+	{
+		return std::nullopt;
+	}
+
+	auto localTicks = SystemTimeToTicks(localTime);
+
+	if (!localTicks)
+	{
+		return std::nullopt;
+	}
+
+	return static_cast<LONGLONG>(*localTicks - utcTime);
+}
+
+std::vector<ULONGLONG> DisplayFormatter::GetTimeZoneTransitions(WORD year)
+{
+	TIME_ZONE_INFORMATION timeZoneInfo;
+
+	if (!GetTimeZoneInformationForYear(year, nullptr, &timeZoneInfo)
+		|| timeZoneInfo.StandardDate.wMonth == 0 || timeZoneInfo.DaylightDate.wMonth == 0)
+	{
+		return {};
+	}
+
+	std::vector<ULONGLONG> transitions;
+
+	// Daylight saving time starts at the specified standard time and ends at the specified
+	// daylight time.
+	auto daylightStart = GetTransitionTime(
+		year, timeZoneInfo.DaylightDate, timeZoneInfo.Bias + timeZoneInfo.StandardBias);
+	auto daylightEnd = GetTransitionTime(
+		year, timeZoneInfo.StandardDate, timeZoneInfo.Bias + timeZoneInfo.DaylightBias);
+
+	if (daylightStart)
+	{
+		transitions.push_back(*daylightStart);
+	}
+
+	if (daylightEnd)
+	{
+		transitions.push_back(*daylightEnd);
+	}
+
+	return transitions;
+}
+
+std::optional<std::wstring> DisplayFormatter::FormatFileTime(
+	const FILETIME &utcTime, bool friendlyDate)
+{
+	auto localTime = ConvertToLocalTime(utcTime);
+
+	if (!localTime)
+	{
+		return std::nullopt;
+	}
+
+	return FormatSystemTime(*localTime, friendlyDate);
+}
+
+std::optional<std::wstring> DisplayFormatter::FormatSystemTime(
+	const SYSTEMTIME &localTime, bool friendlyDate)
+{
+	if (friendlyDate)
+	{
+		SYSTEMTIME currentTime;
+		GetLocalTime(&currentTime);
+
+		auto day = GetDayNumber(localTime);
+		auto today = GetDayNumber(currentTime);
+
+		if (day && today && *day == *today)
+		{
+			return L"Today, " + FormatTime(localTime);
+		}
+		else if (day && today && *day + 1 == *today)
+		{
+			return L"Yesterday, " + FormatTime(localTime);
+		}
+	}
+
+	auto date = FormatDate(localTime);
+
+	if (!date)
+	{
+		return std::nullopt;
+	}
+
+	return *date + L" " + FormatTime(localTime);
+}
+
+std::optional<std::wstring> DisplayFormatter::FormatDate(const SYSTEMTIME &localTime)
+{
+	uint32_t key = (localTime.wYear << 16) | (localTime.wMonth << 8) | localTime.wDay;
+
+	{
+		std::shared_lock lock(m_mutex);
+
+		auto itr = m_dates.find(key);
+
+		if (itr != m_dates.end())
+		{
+			return itr->second;
+		}
+	}
+
+	SYSTEMTIME date = {};
+	date.wYear = localTime.wYear;
+	date.wMonth = localTime.wMonth;
+	date.wDayOfWeek = localTime.wDayOfWeek;
+	date.wDay = localTime.wDay;
+
+	WCHAR formattedDate[256];
+	int res = GetDateFormat(LOCALE_USER_DEFAULT, LOCALE_USE_CP_ACP, &date, nullptr, formattedDate,
+		static_cast<int>(std::size(formattedDate)));
+
+	if (res == 0)
+	{
+		return std::nullopt;
+	}
+
+	std::unique_lock lock(m_mutex);
+
+	if (m_dates.size() >= MAX_CACHED_DATES)
+	{
+		m_dates.clear();
+	}
+
+	m_dates.insert({ key, formattedDate });
+
+	return formattedDate;
+}
+
+std::wstring DisplayFormatter::FormatTime(const SYSTEMTIME &localTime) const
+{
+	std::shared_lock lock(m_mutex);
+
+	if (m_timeElements.empty())
+	{
+		WCHAR formattedTime[256];
+		int res = GetTimeFormat(LOCALE_USER_DEFAULT, LOCALE_USE_CP_ACP, &localTime, nullptr,
+			formattedTime, static_cast<int>(std::size(formattedTime)));
+
+		if (res == 0)
+		{
+			return {};
+		}
+
+		return formattedTime;
+	}
+
+	std::wstring formattedTime;
+
+	for (const auto &element : m_timeElements)
+	{
+		switch (element.type)
+		{
+		case TimeElementType::Literal:
+			formattedTime += element.literal;
+			break;
+
+		case TimeElementType::Hour12:
+		{
+			int hour = localTime.wHour % 12;
+			AppendTwoDigits(formattedTime, hour == 0 ? 12 : hour, element.longForm);
+		}
+		break;
+
+		case TimeElementType::Hour24:
+			AppendTwoDigits(formattedTime, localTime.wHour, element.longForm);
+			break;
+
+		case TimeElementType::Minute:
+			AppendTwoDigits(formattedTime, localTime.wMinute, element.longForm);
+			break;
+
+		case TimeElementType::Second:
+			AppendTwoDigits(formattedTime, localTime.wSecond, element.longForm);
+			break;
+
+		case TimeElementType::Designator:
+		{
+			const std::wstring &designator = localTime.wHour < 12 ? m_localeFormat.amDesignator
+																   : m_localeFormat.pmDesignator;
+
+			if (element.longForm)
+			{
+				formattedTime += designator;
+			}
+			else if (!designator.empty())
+			{
+				formattedTime += designator[0];
+			}
+		}
+		break;
+		}
+	}
+
+	return formattedTime;
+}
+
+void DisplayFormatter::AppendTwoDigits(std::wstring &output, int value, bool pad)
+{
+	if (value >= 10 || pad)
+	{
+		output += static_cast<wchar_t>(L'0' + value / 10);
+	}
+
+	output += static_cast<wchar_t>(L'0' + value % 10);
+}
+
+std::wstring DisplayFormatter::FormatSize(
+	ULONGLONG size, bool forceSize, SizeDisplayFormat sizeDisplayFormat) const
+{
+	size_t unitIndex = 0;
+
+	if (forceSize)
+	{
+		switch (sizeDisplayFormat)
+		{
+		case SizeDisplayFormat::KB:
+			unitIndex = 1;
+			break;
+
+		case SizeDisplayFormat::MB:
+			unitIndex = 2;
+			break;
+
+		case SizeDisplayFormat::GB:
+			unitIndex = 3;
+			break;
+
+		case SizeDisplayFormat::TB:
+			unitIndex = 4;
+			break;
+
+		case SizeDisplayFormat::PB:
+			unitIndex = 5;
+			break;
+
+		default:
+			unitIndex = 0;
+			break;
+		}
+	}
+	else
+	{
+		ULONGLONG remaining = size;
+
+		while (remaining >= 1024)
+		{
+			remaining /= 1024;
+			unitIndex++;
+		}
+
+		if (unitIndex >= std::size(SIZE_UNITS))
+		{
+			return {};
+		}
+	}
+
+	int shift = static_cast<int>(unitIndex) * 10;
+	ULONGLONG wholePart = size >> shift;
+	ULONGLONG remainder = size - (wholePart << shift);
+
+	int precision = 0;
+
+	if (unitIndex > 0)
+	{
+		if (wholePart < 10)
+		{
+			precision = 2;
+		}
+		else if (wholePart < 100)
+		{
+			precision = 1;
+		}
+	}
+
+	std::shared_lock lock(m_mutex);
+
+	std::wstring formattedSize = GroupDigits(wholePart, m_localeFormat);
+
+	if (precision > 0)
+	{
+		// The fraction is truncated, rather than rounded, so that a size is never shown as being
+		// larger than it is. Since the remainder is less than 2^50, this can't overflow.
+		ULONGLONG scale = (precision == 2) ? 100 : 10;
+		std::wstring fraction = std::to_wstring((remainder * scale) >> shift);
+
+		formattedSize += m_localeFormat.decimalSeparator;
+		formattedSize.append(static_cast<size_t>(precision) - fraction.size(), L'0');
+		formattedSize += fraction;
+	}
+
+	formattedSize += L" ";
+	formattedSize += SIZE_UNITS[unitIndex];
+
+	return formattedSize;
+}
+
+std::wstring DisplayFormatter::FormatNumber(ULONGLONG number) const
+{
+	std::shared_lock lock(m_mutex);
+	return GroupDigits(number, m_localeFormat);
+}
+
+std::wstring DisplayFormatter::GroupDigits(ULONGLONG number, const LocaleFormat &localeFormat)
+{
+	std::wstring digits = std::to_wstring(number);
+
+	// The group sizes are applied from the right.
+	std::vector<size_t> groupLengths;
+	size_t remaining = digits.size();
+
+	while (remaining > 0)
+	{
+		size_t index = groupLengths.size();
+		size_t length = remaining;
+
+		if (index < localeFormat.grouping.size())
+		{
+			length = localeFormat.grouping[index];
+		}
+		else if (localeFormat.repeatLastGroup && !localeFormat.grouping.empty())
+		{
+			length = localeFormat.grouping.back();
+		}
+
+		if (length == 0 || length > remaining)
+		{
+			length = remaining;
+		}
+
+		groupLengths.push_back(length);
+		remaining -= length;
+	}
+
+	std::wstring formattedNumber;
+	size_t position = 0;
+
+	for (auto itr = groupLengths.rbegin(); itr != groupLengths.rend(); ++itr)
+	{
+		if (position > 0)
+		{
+			formattedNumber += localeFormat.thousandSeparator;
+		}
+
+		formattedNumber.append(digits, position, *itr);
+		position += *itr;
+	}
+
+	return formattedNumber;
+}
+
+void DisplayFormatter::OnLocaleChanged()
+{
+	auto localeFormat = GetUserLocaleFormat();
+	auto timeElements = ParseTimeFormat(localeFormat.timeFormat);
+
+	std::unique_lock lock(m_mutex);
+	m_localeFormat = localeFormat;
+	m_timeElements = timeElements;
+	m_dates.clear();
+}
+
+void DisplayFormatter::OnTimeZoneChanged()
+{
+	std::unique_lock lock(m_mutex);
+	m_timeZonePeriods.clear();
+}
+
+DisplayFormatter &GetDisplayFormatter()
+{
+	static DisplayFormatter displayFormatter;
+	return displayFormatter;
+}
\ No newline at end of file
@@ -0,0 +1,120 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "StringHelper.h"
+#include <windows.h>
+#include <cstdint>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Formats the dates, times and sizes shown in the listview (and elsewhere). Thousands of these
+// values can be displayed at once, and formatting each one from scratch (converting it to local
+// time, then calling GetDateFormat() and GetTimeFormat()) is comparatively slow. Instead:
+//
+// - The offset from UTC is cached for each period between daylight saving transitions, so
+//   converting a time to local time only involves an addition.
+// - The formatted date is cached for each day.
+// - The user's time format is parsed once and then applied directly.
+// - Sizes are formatted using integer arithmetic, with the separators read from the locale once.
+//
+// The formatter can be used concurrently from multiple threads.
+class DisplayFormatter
+{
+public:
+	// The parts of the locale that are applied directly, rather than through the Windows API.
+	struct LocaleFormat
+	{
+		// In the format used by LOCALE_STIMEFORMAT.
+		std::wstring timeFormat;
+		std::wstring amDesignator;
+		std::wstring pmDesignator;
+
+		std::wstring decimalSeparator;
+		std::wstring thousandSeparator;
+
+		// The size of each group of digits, starting from the right. If repeatLastGroup is set,
+		// the last size applies to all remaining digits. Otherwise, the remaining digits aren't
+		// grouped.
+		std::vector<int> grouping;
+		bool repeatLastGroup;
+	};
+
+	// Uses the user's locale.
+	DisplayFormatter();
+	explicit DisplayFormatter(const LocaleFormat &localeFormat);
+
+	std::optional<SYSTEMTIME> ConvertToLocalTime(const FILETIME &utcTime);
+
+	std::optional<std::wstring> FormatFileTime(const FILETIME &utcTime, bool friendlyDate);
+	std::optional<std::wstring> FormatSystemTime(const SYSTEMTIME &localTime, bool friendlyDate);
+	std::wstring FormatTime(const SYSTEMTIME &localTime) const;
+	std::wstring FormatSize(ULONGLONG size, bool forceSize = false,
+		SizeDisplayFormat sizeDisplayFormat = SizeDisplayFormat::None) const;
+	std::wstring FormatNumber(ULONGLONG number) const;
+
+	// Should be called when the user's locale settings have changed.
+	void OnLocaleChanged();
+
+	// Should be called when the time zone has changed.
+	void OnTimeZoneChanged();
+
+	static LocaleFormat GetUserLocaleFormat();
+
+private:
+	// Both caches are simply cleared if they grow beyond these sizes.
+	static const size_t MAX_CACHED_DATES = 4096;
+	static const size_t MAX_CACHED_TIME_ZONE_PERIODS = 64;
+
+	enum class TimeElementType
+	{
+		Literal,
+		Hour12,
+		Hour24,
+		Minute,
+		Second,
+		Designator
+	};
+
+	struct TimeElement
+	{
+		TimeElementType type;
+
+		// For numeric elements, whether the value is padded to two digits. For designators,
+		// whether the full designator (rather than just the first character) is shown.
+		bool longForm;
+
+		std::wstring literal;
+	};
+
+	// A period of time over which the offset from UTC is constant. The times are in UTC.
+	struct TimeZonePeriod
+	{
+		ULONGLONG start;
+		ULONGLONG end;
+		LONGLONG offset;
+	};
+
+	static std::vector<TimeElement> ParseTimeFormat(const std::wstring &timeFormat);
+	static void AppendTwoDigits(std::wstring &output, int value, bool pad);
+	static std::wstring GroupDigits(ULONGLONG number, const LocaleFormat &localeFormat);
+
+	std::optional<std::wstring> FormatDate(const SYSTEMTIME &localTime);
+	std::optional<TimeZonePeriod> FindTimeZonePeriod(ULONGLONG utcTime) const;
+	static std::optional<LONGLONG> RetrieveUtcOffset(ULONGLONG utcTime);
+	static std::vector<ULONGLONG> GetTimeZoneTransitions(WORD year);
+
+	mutable std::shared_mutex m_mutex;
+	LocaleFormat m_localeFormat;
+	std::vector<TimeElement> m_timeElements;
+	std::unordered_map<uint32_t, std::wstring> m_dates;
+	std::vector<TimeZonePeriod> m_timeZonePeriods;
+};
+
+// The formatter shared by all column, group and dialog code.
+DisplayFormatter &GetDisplayFormatter();
\ No newline at end of file
@@ -15,7 +15,8 @@ DpiCompatibility &DpiCompatibility::GetInstance()
 DpiCompatibility::DpiCompatibility() :
 	m_SystemParametersInfoForDpi(nullptr),
 	m_GetSystemMetricsForDpi(nullptr),
-	m_GetDpiForWindow(nullptr)
+	m_GetDpiForWindow(nullptr),
+	m_OpenThemeDataForDpi(nullptr)
 {
 	m_user32.reset(LoadLibrary(L"user32.dll"));
 
@@ -27,6 +28,14 @@ DpiCompatibility::DpiCompatibility() :
 			GetProcAddressByFunctionDeclaration(m_user32.get(), GetSystemMetricsForDpi);
 		m_GetDpiForWindow = GetProcAddressByFunctionDeclaration(m_user32.get(), GetDpiForWindow);
 	}
+
+	m_uxtheme.reset(LoadLibrary(L"uxtheme.dll"));
+
+	if (m_uxtheme)
+	{
+		m_OpenThemeDataForDpi =
+			GetProcAddressByFunctionDeclaration(m_uxtheme.get(), OpenThemeDataForDpi);
+	}
 }
 
 BOOL DpiCompatibility::SystemParametersInfoForDpi(
@@ -65,4 +74,14 @@ UINT DpiCompatibility::GetDpiForWindow(HWND hwnd)
 	}
 
 	return USER_DEFAULT_SCREEN_DPI;
+}
+
+HTHEME DpiCompatibility::OpenThemeDataForDpi(HWND hwnd, LPCWSTR pszClassList, UINT dpi)
+{
+	if (m_OpenThemeDataForDpi)
+	{
+		return m_OpenThemeDataForDpi(hwnd, pszClassList, dpi);
+	}
+
+	return OpenThemeData(hwnd, pszClassList);
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include "UxThemeBackwardsCompatibility.h"
 #include "WinUserBackwardsCompatibility.h"
 #include <wil/resource.h>
 
@@ -16,13 +17,16 @@ public:
 		UINT uiAction, UINT uiParam, PVOID pvParam, UINT fWinIni, UINT dpi);
 	int WINAPI GetSystemMetricsForDpi(int nIndex, UINT dpi);
 	UINT WINAPI GetDpiForWindow(HWND hwnd);
+	HTHEME WINAPI OpenThemeDataForDpi(HWND hwnd, LPCWSTR pszClassList, UINT dpi);
 
 private:
 	DpiCompatibility();
 
 	wil::unique_hmodule m_user32;
+	wil::unique_hmodule m_uxtheme;
 
 	decltype(&::SystemParametersInfoForDpi) m_SystemParametersInfoForDpi;
 	decltype(&::GetSystemMetricsForDpi) m_GetSystemMetricsForDpi;
 	decltype(&::GetDpiForWindow) m_GetDpiForWindow;
+	decltype(&::OpenThemeDataForDpi) m_OpenThemeDataForDpi;
 };
\ No newline at end of file
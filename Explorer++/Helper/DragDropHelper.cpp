@@ -5,9 +5,19 @@
 #include "stdafx.h"
 #include "DragDropHelper.h"
 #include "DataObjectWrapper.h"
+#include "DelayedRenderDataObject.h"
 #include "Macros.h"
 #include <wil/com.h>
+#include <wil/resource.h>
 #include <winrt/base.h>
+#include <algorithm>
+
+namespace
+{
+
+const int MAX_DRAG_IMAGE_COLUMNS = 4;
+
+}
 
 STGMEDIUM GetStgMediumForGlobal(HGLOBAL global)
 {
@@ -33,6 +43,12 @@ HRESULT SetPreferredDropEffect(IDataObject *dataObject, DWORD effect)
 		static_cast<CLIPFORMAT>(RegisterClipboardFormat(CFSTR_PREFERREDDROPEFFECT)), effect);
 }
 
+HRESULT GetPreferredDropEffect(IDataObject *dataObject, DWORD &effect)
+{
+	return GetBlobData(dataObject,
+		static_cast<CLIPFORMAT>(RegisterClipboardFormat(CFSTR_PREFERREDDROPEFFECT)), effect);
+}
+
 HRESULT SetDropDescription(IDataObject *dataObject, DROPIMAGETYPE type, const std::wstring &message,
 	const std::wstring &insert)
 {
@@ -46,6 +62,73 @@ HRESULT SetDropDescription(IDataObject *dataObject, DROPIMAGETYPE type, const st
 		static_cast<CLIPFORMAT>(RegisterClipboardFormat(CFSTR_DROPDESCRIPTION)), dropDescription);
 }
 
+// Sets a drag image that shows the specified icons in a small grid. Having the shell generate a
+// drag image requires it to process every item being dragged, so this is considerably cheaper when
+// there are a large number of items. The caller is expected to only pass the icons for the first
+// few items.
+HRESULT SetDragImageFromIcons(
+	IDataObject *dataObject, HIMAGELIST imageList, const std::vector<int> &iconIndexes)
+{
+	if (iconIndexes.empty())
+	{
+		return E_INVALIDARG;
+	}
+
+	int iconWidth;
+	int iconHeight;
+	RETURN_IF_WIN32_BOOL_FALSE(ImageList_GetIconSize(imageList, &iconWidth, &iconHeight));
+
+	int numIcons = static_cast<int>(iconIndexes.size());
+	int numColumns = (std::min)(numIcons, MAX_DRAG_IMAGE_COLUMNS);
+	int numRows = (numIcons + numColumns - 1) / numColumns;
+
+	SIZE imageSize = { numColumns * iconWidth, numRows * iconHeight };
+
+	BITMAPINFO bitmapInfo = {};
+	bitmapInfo.bmiHeader.biSize = sizeof(bitmapInfo.bmiHeader);
+	bitmapInfo.bmiHeader.biWidth = imageSize.cx;
+	bitmapInfo.bmiHeader.biHeight = -imageSize.cy;
+	bitmapInfo.bmiHeader.biPlanes = 1;
+	bitmapInfo.bmiHeader.biBitCount = 32;
+	bitmapInfo.bmiHeader.biCompression = BI_RGB;
+
+	wil::unique_hdc memDC(CreateCompatibleDC(nullptr));
+	RETURN_LAST_ERROR_IF_NULL(memDC);
+
+	// The bitmap starts out fully transparent. Since the icons don't overlap, each one can be
+	// drawn with its alpha channel copied directly into the bitmap.
+	void *bits;
+	wil::unique_hbitmap bitmap(
+		CreateDIBSection(memDC.get(), &bitmapInfo, DIB_RGB_COLORS, &bits, nullptr, 0));
+	RETURN_LAST_ERROR_IF_NULL(bitmap);
+
+	{
+		auto previousBitmap = wil::SelectObject(memDC.get(), bitmap.get());
+
+		for (int i = 0; i < numIcons; i++)
+		{
+			ImageList_Draw(imageList, iconIndexes[i], memDC.get(), (i % numColumns) * iconWidth,
+				(i / numColumns) * iconHeight, ILD_PRESERVEALPHA);
+		}
+	}
+
+	wil::com_ptr_nothrow<IDragSourceHelper> dragSourceHelper;
+	RETURN_IF_FAILED(CoCreateInstance(
+		CLSID_DragDropHelper, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&dragSourceHelper)));
+
+	SHDRAGIMAGE dragImage = {};
+	dragImage.sizeDragImage = imageSize;
+	dragImage.ptOffset = { iconWidth / 2, iconHeight / 2 };
+	dragImage.hbmpDragImage = bitmap.get();
+	dragImage.crColorKey = CLR_NONE;
+	RETURN_IF_FAILED(dragSourceHelper->InitializeFromBitmap(&dragImage, dataObject));
+
+	// The drag source helper takes ownership of the bitmap.
+	bitmap.release();
+
+	return S_OK;
+}
+
 // Returns an IDataObject instance that can be used for clipboard operations and drag and drop.
 HRESULT CreateDataObjectForShellTransfer(
 	const std::vector<PCIDLIST_ABSOLUTE> &items, IDataObject **dataObjectOut)
@@ -69,5 +152,21 @@ HRESULT CreateDataObjectForShellTransfer(
 
 	*dataObjectOut = dataObject.detach();
 
+	return S_OK;
+}
+
+// As above, except that the returned IDataObject instance only builds the data it offers once it's
+// needed (see DelayedRenderDataObject). That's useful when there are a very large number of items.
+HRESULT CreateDelayedRenderDataObjectForShellTransfer(
+	const std::vector<PCIDLIST_ABSOLUTE> &items, IDataObject **dataObjectOut)
+{
+	auto dataObject = winrt::make<DelayedRenderDataObject>(items);
+
+	wil::com_ptr_nothrow<IDataObjectAsyncCapability> asyncCapability;
+	RETURN_IF_FAILED(dataObject->QueryInterface(IID_PPV_ARGS(&asyncCapability)));
+	RETURN_IF_FAILED(asyncCapability->SetAsyncMode(TRUE));
+
+	*dataObjectOut = dataObject.detach();
+
 	return S_OK;
 }
\ No newline at end of file
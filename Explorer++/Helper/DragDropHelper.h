@@ -5,17 +5,28 @@
 #pragma once
 
 #include "DataExchangeHelper.h"
+#include <wil/resource.h>
 #include <wil/result.h>
 #include <ShlObj.h>
 #include <shtypes.h>
+#include <vector>
+
+// Transfers (clipboard copies and drags) of at least this many items use a data object that builds
+// its data in the background (see CreateDelayedRenderDataObjectForShellTransfer()).
+constexpr size_t DELAYED_RENDER_ITEM_THRESHOLD = 1000;
 
 STGMEDIUM GetStgMediumForGlobal(HGLOBAL global);
 STGMEDIUM GetStgMediumForStream(IStream *stream);
 HRESULT SetPreferredDropEffect(IDataObject *dataObject, DWORD effect);
+HRESULT GetPreferredDropEffect(IDataObject *dataObject, DWORD &effect);
 HRESULT CreateDataObjectForShellTransfer(
 	const std::vector<PCIDLIST_ABSOLUTE> &items, IDataObject **dataObjectOut);
+HRESULT CreateDelayedRenderDataObjectForShellTransfer(
+	const std::vector<PCIDLIST_ABSOLUTE> &items, IDataObject **dataObjectOut);
 HRESULT SetDropDescription(IDataObject *dataObject, DROPIMAGETYPE type, const std::wstring &message,
 	const std::wstring &insert);
+HRESULT SetDragImageFromIcons(
+	IDataObject *dataObject, HIMAGELIST imageList, const std::vector<int> &iconIndexes);
 
 template <typename T>
 HRESULT SetBlobData(IDataObject *dataObject, CLIPFORMAT format, const T &data)
@@ -36,5 +47,25 @@ HRESULT SetBlobData(IDataObject *dataObject, CLIPFORMAT format, const T &data)
 	// freeing the data.
 	global.release();
 
+	return S_OK;
+}
+
+template <typename T>
+HRESULT GetBlobData(IDataObject *dataObject, CLIPFORMAT format, T &dataOut)
+{
+	FORMATETC ftc = { format, nullptr, DVASPECT_CONTENT, -1, TYMED_HGLOBAL };
+
+	wil::unique_stg_medium stgMedium;
+	RETURN_IF_FAILED(dataObject->GetData(&ftc, &stgMedium));
+
+	auto data = ReadBinaryDataFromGlobal(stgMedium.hGlobal);
+
+	if (!data || data->size() < sizeof(dataOut))
+	{
+		return E_FAIL;
+	}
+
+	memcpy(&dataOut, data->data(), sizeof(dataOut));
+
 	return S_OK;
 }
\ No newline at end of file
@@ -6,6 +6,186 @@
 #include "FileOperations.h"
 #include "Helper.h"
 #include "Macros.h"
+#include "UnbufferedIo.h"
+#include <boost/format.hpp>
+#include <wil/resource.h>
+#include <mutex>
+#include <unordered_map>
+
+namespace
+{
+
+// Below this, a network volume is assumed to be on the local network.
+constexpr std::chrono::microseconds HIGH_REMOTE_LATENCY_THRESHOLD = std::chrono::milliseconds(2);
+
+const int NUM_REMOTE_LATENCY_SAMPLES = 3;
+
+constexpr size_t SMALL_IO_BUFFER_SIZE = 1024 * 1024;
+constexpr size_t DEFAULT_IO_BUFFER_SIZE = 4 * 1024 * 1024;
+constexpr size_t LARGE_IO_BUFFER_SIZE = 8 * 1024 * 1024;
+
+static_assert(SMALL_IO_BUFFER_SIZE % UNBUFFERED_IO_ALIGNMENT == 0);
+static_assert(DEFAULT_IO_BUFFER_SIZE % UNBUFFERED_IO_ALIGNMENT == 0);
+static_assert(LARGE_IO_BUFFER_SIZE % UNBUFFERED_IO_ALIGNMENT == 0);
+
+bool IsExternalBus(STORAGE_BUS_TYPE busType)
+{
+	return busType == BusTypeUsb || busType == BusType1394 || busType == BusTypeSd
+		|| busType == BusTypeMmc;
+}
+
+// Returns the upper-cased path of the volume that contains the specified path, or an empty string
+// if the volume can't be determined.
+std::wstring GetVolumePath(const std::wstring &path)
+{
+	std::wstring volumePath;
+	wchar_t volumePathBuffer[MAX_PATH];
+
+	BOOL res = GetVolumePathName(
+		path.c_str(), volumePathBuffer, static_cast<DWORD>(std::size(volumePathBuffer)));
+
+	if (res)
+	{
+		volumePath = volumePathBuffer;
+		CharUpperBuff(volumePath.data(), static_cast<DWORD>(volumePath.size()));
+	}
+
+	return volumePath;
+}
+
+// Free space queries are answered by the server, rather than from the redirector's cache, so each
+// one involves a round trip. The fastest of several samples is used, since the first request may
+// include the time taken to establish a connection.
+std::optional<std::chrono::microseconds> MeasureRemoteLatency(const std::wstring &volumePath)
+{
+	std::optional<std::chrono::microseconds> latency;
+
+	for (int i = 0; i < NUM_REMOTE_LATENCY_SAMPLES; i++)
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		ULARGE_INTEGER freeBytes;
+
+		if (!GetDiskFreeSpaceEx(volumePath.c_str(), &freeBytes, nullptr, nullptr))
+		{
+			break;
+		}
+
+		auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now() - start);
+
+		if (!latency || elapsed < *latency)
+		{
+			latency = elapsed;
+		}
+	}
+
+	return latency;
+}
+
+void QueryDevice(HANDLE disk, StorageInfo &storageInfo)
+{
+	STORAGE_PROPERTY_QUERY query = {};
+	query.PropertyId = StorageDeviceProperty;
+	query.QueryType = PropertyStandardQuery;
+
+	// Only the fixed portion of the descriptor is needed. The device returns as much of the
+	// (variable length) descriptor as fits.
+	STORAGE_DEVICE_DESCRIPTOR deviceDescriptor = {};
+	DWORD numBytesReturned;
+	BOOL res = DeviceIoControl(disk, IOCTL_STORAGE_QUERY_PROPERTY, &query, sizeof(query),
+		&deviceDescriptor, sizeof(deviceDescriptor), &numBytesReturned, nullptr);
+
+	if (res
+		&& numBytesReturned
+			>= offsetof(STORAGE_DEVICE_DESCRIPTOR, BusType) + sizeof(STORAGE_BUS_TYPE))
+	{
+		storageInfo.busType = deviceDescriptor.BusType;
+	}
+
+	query.PropertyId = StorageDeviceSeekPenaltyProperty;
+
+	DEVICE_SEEK_PENALTY_DESCRIPTOR seekPenalty = {};
+	res = DeviceIoControl(disk, IOCTL_STORAGE_QUERY_PROPERTY, &query, sizeof(query),
+		&seekPenalty, sizeof(seekPenalty), &numBytesReturned, nullptr);
+
+	if (res && numBytesReturned >= sizeof(seekPenalty))
+	{
+		storageInfo.kind =
+			seekPenalty.IncursSeekPenalty ? StorageKind::Rotational : StorageKind::SolidState;
+	}
+}
+
+StorageInfo QueryStorage(const std::wstring &volumePath)
+{
+	StorageInfo storageInfo;
+	storageInfo.diskId = volumePath;
+
+	if (volumePath.empty())
+	{
+		return storageInfo;
+	}
+
+	if (GetDriveType(volumePath.c_str()) == DRIVE_REMOTE)
+	{
+		storageInfo.kind = StorageKind::Remote;
+		storageInfo.remoteLatency = MeasureRemoteLatency(volumePath);
+		return storageInfo;
+	}
+
+	wchar_t volumeName[MAX_PATH];
+	BOOL res = GetVolumeNameForVolumeMountPoint(
+		volumePath.c_str(), volumeName, static_cast<DWORD>(std::size(volumeName)));
+
+	if (!res)
+	{
+		return storageInfo;
+	}
+
+	// The volume name has a trailing backslash, which has to be removed in order to open the
+	// volume itself (rather than its root directory).
+	std::wstring volumeDevice = volumeName;
+
+	if (!volumeDevice.empty() && volumeDevice.back() == '\\')
+	{
+		volumeDevice.pop_back();
+	}
+
+	wil::unique_hfile volume(CreateFile(volumeDevice.c_str(), 0,
+		FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, 0, nullptr));
+
+	if (!volume)
+	{
+		return storageInfo;
+	}
+
+	// This fails (with ERROR_MORE_DATA) for volumes that span multiple disks. Those volumes are
+	// simply treated as a unit.
+	VOLUME_DISK_EXTENTS extents;
+	DWORD numBytesReturned;
+	res = DeviceIoControl(volume.get(), IOCTL_VOLUME_GET_VOLUME_DISK_EXTENTS, nullptr, 0,
+		&extents, sizeof(extents), &numBytesReturned, nullptr);
+
+	if (!res || extents.NumberOfDiskExtents != 1)
+	{
+		return storageInfo;
+	}
+
+	storageInfo.diskId =
+		(boost::wformat(L"\\\\.\\PhysicalDrive%u") % extents.Extents[0].DiskNumber).str();
+
+	wil::unique_hfile disk(CreateFile(storageInfo.diskId.c_str(), 0,
+		FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, 0, nullptr));
+
+	if (disk)
+	{
+		QueryDevice(disk.get(), storageInfo);
+	}
+
+	return storageInfo;
+}
+
+}
 
 BOOL GetClusterSize(const TCHAR *drive, DWORD *pdwClusterSize)
 {
@@ -44,4 +224,78 @@ TCHAR GetDriveLetterFromMask(ULONG unitmask)
 	}
 
 	return (TCHAR) bitNum + 'A';
+}
+
+StorageIoSettings GetRecommendedIoSettings(StorageKind kind, STORAGE_BUS_TYPE busType,
+	std::optional<std::chrono::microseconds> remoteLatency)
+{
+	switch (kind)
+	{
+	case StorageKind::Rotational:
+		// Larger reads mean fewer seeks when other I/O is interleaved with the reads.
+		return { 1, LARGE_IO_BUFFER_SIZE };
+
+	case StorageKind::SolidState:
+		if (busType == BusTypeNvme)
+		{
+			return { 8, DEFAULT_IO_BUFFER_SIZE };
+		}
+		else if (IsExternalBus(busType))
+		{
+			// Flash drives and memory cards generally have a single channel and gain little from
+			// concurrent reads.
+			return { 2, DEFAULT_IO_BUFFER_SIZE };
+		}
+
+		return { 4, DEFAULT_IO_BUFFER_SIZE };
+
+	case StorageKind::Remote:
+		if (remoteLatency && *remoteLatency >= HIGH_REMOTE_LATENCY_THRESHOLD)
+		{
+			return { 8, LARGE_IO_BUFFER_SIZE };
+		}
+
+		return { 4, SMALL_IO_BUFFER_SIZE };
+
+	case StorageKind::Unknown:
+	default:
+		// An external disk that doesn't report a seek penalty is as likely to be a rotational
+		// disk as anything else, and concurrent reads are far more costly on a rotational disk
+		// than a single reader is on a flash drive.
+		if (IsExternalBus(busType))
+		{
+			return { 1, DEFAULT_IO_BUFFER_SIZE };
+		}
+
+		return { 2, DEFAULT_IO_BUFFER_SIZE };
+	}
+}
+
+StorageInfo GetStorageInfo(const std::wstring &path)
+{
+	static std::mutex mutex;
+	static std::unordered_map<std::wstring, StorageInfo> volumes;
+
+	std::wstring volumePath = GetVolumePath(path);
+
+	{
+		std::scoped_lock lock(mutex);
+
+		auto itr = volumes.find(volumePath);
+
+		if (itr != volumes.end())
+		{
+			return itr->second;
+		}
+	}
+
+	// Querying the volume can take a while (particularly for a network volume), so it's done
+	// without holding the lock. If two threads query the same volume at once, the first result is
+	// kept.
+	StorageInfo storageInfo = QueryStorage(volumePath);
+	storageInfo.ioSettings =
+		GetRecommendedIoSettings(storageInfo.kind, storageInfo.busType, storageInfo.remoteLatency);
+
+	std::scoped_lock lock(mutex);
+	return volumes.try_emplace(volumePath, std::move(storageInfo)).first->second;
 }
\ No newline at end of file
@@ -5,6 +5,60 @@
 #pragma once
 
 #include <Windows.h>
+#include <winioctl.h>
+#include <chrono>
+#include <optional>
+#include <string>
 
 BOOL GetClusterSize(const TCHAR *drive, DWORD *pdwClusterSize);
-TCHAR GetDriveLetterFromMask(ULONG unitmask);
\ No newline at end of file
+TCHAR GetDriveLetterFromMask(ULONG unitmask);
+
+enum class StorageKind
+{
+	// The device couldn't be queried, or didn't report whether it incurs a seek penalty.
+	Unknown,
+
+	Rotational,
+	SolidState,
+	Remote
+};
+
+// The I/O settings that suit a particular type of storage. Reading several files at once from a
+// rotational disk is much slower than reading them one after another, since the disk has to keep
+// seeking between them, whereas an NVMe disk is only fully utilized when many reads are in
+// flight. Network volumes are limited by latency, rather than by the device, so more (and larger)
+// requests are kept in flight as the latency increases.
+struct StorageIoSettings
+{
+	// The number of large reads (or files being processed) that should be in progress on the
+	// device at once.
+	int parallelism;
+
+	// The size of each read. This is always a multiple of UNBUFFERED_IO_ALIGNMENT, so it can be
+	// used with unbuffered I/O.
+	size_t bufferSize;
+};
+
+StorageIoSettings GetRecommendedIoSettings(StorageKind kind, STORAGE_BUS_TYPE busType,
+	std::optional<std::chrono::microseconds> remoteLatency);
+
+struct StorageInfo
+{
+	// Identifies the physical disk that contains the volume. Volumes on the same disk have the
+	// same identifier. Network volumes (and volumes that span several disks) are identified by
+	// their volume path.
+	std::wstring diskId;
+
+	StorageKind kind = StorageKind::Unknown;
+	STORAGE_BUS_TYPE busType = BusTypeUnknown;
+
+	// The round trip time to the server. Only set for network volumes.
+	std::optional<std::chrono::microseconds> remoteLatency;
+
+	StorageIoSettings ioSettings;
+};
+
+// Returns information about the storage that contains the specified path. The device is queried
+// (and, for a network volume, the latency to the server measured) the first time each volume is
+// seen, which can block. The result is then cached for the lifetime of the process.
+StorageInfo GetStorageInfo(const std::wstring &path);
\ No newline at end of file
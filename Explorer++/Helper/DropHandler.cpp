@@ -7,11 +7,15 @@
 #include "Helper.h"
 #include "Logging.h"
 #include "Macros.h"
+#include "VirtualFileExtraction.h"
+#include <wil/com.h>
+#include <stop_token>
 
 /* Drop formats supported. */
 FORMATETC	DropHandler::m_ftcText = {CF_TEXT,nullptr,DVASPECT_CONTENT,-1,TYMED_HGLOBAL};
 FORMATETC	DropHandler::m_ftcUnicodeText = {CF_UNICODETEXT,nullptr,DVASPECT_CONTENT,-1,TYMED_HGLOBAL};
 FORMATETC	DropHandler::m_ftcDIBV5 = {CF_DIBV5,nullptr,DVASPECT_CONTENT,-1,TYMED_HGLOBAL};
+FORMATETC	DropHandler::m_ftcFileDescriptor = {(CLIPFORMAT)RegisterClipboardFormat(CFSTR_FILEDESCRIPTORW),nullptr,DVASPECT_CONTENT,-1,TYMED_HGLOBAL};
 
 DropHandler *DropHandler::CreateNew()
 {
@@ -23,6 +27,7 @@ HRESULT DropHandler::GetDropFormats(std::list<FORMATETC> &ftcList)
 	ftcList.push_back(m_ftcText);
 	ftcList.push_back(m_ftcUnicodeText);
 	ftcList.push_back(m_ftcDIBV5);
+	ftcList.push_back(m_ftcFileDescriptor);
 
 	return S_OK;
 }
@@ -77,7 +82,15 @@ void DropHandler::HandleLeftClickDrop(IDataObject *pDataObject,POINT *pt)
 	HRESULT hrCopy = E_FAIL;
 	std::list<std::wstring> pastedFileList;
 
-	if(CheckDropFormatSupported(pDataObject,&m_ftcUnicodeText))
+	/* Virtual files (e.g. email attachments) are checked
+	for first, since the source may also offer a textual
+	description of the files. */
+	if(CheckDropFormatSupported(pDataObject,&m_ftcFileDescriptor))
+	{
+		LOG(debug) << _T("Helper - Copying virtual file data");
+		hrCopy = CopyVirtualFiles(pDataObject,pastedFileList);
+	}
+	else if(CheckDropFormatSupported(pDataObject,&m_ftcUnicodeText))
 	{
 		LOG(debug) << _T("Helper - Copying CF_UNICODETEXT data");
 		hrCopy = CopyUnicodeTextData(pDataObject,pastedFileList);
@@ -141,6 +154,80 @@ BOOL DropHandler::CheckDropFormatSupported(IDataObject *pDataObject,FORMATETC *p
 	return TRUE;
 }
 
+/* The files are extracted by worker threads. As with
+native file transfers, messages are pumped from the
+progress callback, so the window remains responsive (and
+any calls the workers make back into this thread can be
+serviced). */
+HRESULT DropHandler::CopyVirtualFiles(IDataObject *pDataObject,
+	std::list<std::wstring> &PastedFileList)
+{
+	wil::com_ptr_nothrow<IProgressDialog> progressDialog;
+	HRESULT hr = CoCreateInstance(CLSID_ProgressDialog, nullptr, CLSCTX_INPROC_SERVER,
+		IID_PPV_ARGS(&progressDialog));
+
+	if(SUCCEEDED(hr))
+	{
+		progressDialog->SetLine(1, m_destDirectory.c_str(), TRUE, nullptr);
+		progressDialog->StartProgressDialog(m_hwndDrop, nullptr,
+			PROGDLG_MODAL | PROGDLG_AUTOTIME | PROGDLG_NOMINIMIZE, nullptr);
+	}
+
+	std::stop_source stopSource;
+
+	auto result = ExtractVirtualFiles(pDataObject, m_destDirectory, stopSource.get_token(),
+		[&progressDialog, &stopSource](const VirtualFileExtractionProgress &progress) {
+			if(progressDialog)
+			{
+				if(progressDialog->HasUserCancelled())
+				{
+					stopSource.request_stop();
+				}
+
+				std::wstring status = std::to_wstring(progress.filesExtracted) + L" / "
+					+ std::to_wstring(progress.totalFiles);
+				progressDialog->SetLine(2, status.c_str(), FALSE, nullptr);
+				progressDialog->SetProgress64(progress.bytesWritten, progress.totalBytes);
+			}
+
+			MSG msg;
+
+			while(PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
+			{
+				if(msg.message == WM_QUIT)
+				{
+					stopSource.request_stop();
+					PostQuitMessage(static_cast<int>(msg.wParam));
+					break;
+				}
+
+				TranslateMessage(&msg);
+				DispatchMessage(&msg);
+			}
+		});
+
+	if(progressDialog)
+	{
+		progressDialog->StopProgressDialog();
+	}
+
+	if(result.filesFailed > 0)
+	{
+		LOG(warning) << _T("Helper - ") << result.filesFailed
+			<< _T(" virtual file(s) could not be extracted");
+	}
+
+	PastedFileList.insert(PastedFileList.end(), result.createdItems.begin(),
+		result.createdItems.end());
+
+	if(result.createdItems.empty())
+	{
+		return FAILED(result.firstError) ? result.firstError : E_FAIL;
+	}
+
+	return S_OK;
+}
+
 HRESULT DropHandler::CopyUnicodeTextData(IDataObject *pDataObject,
 	std::list<std::wstring> &PastedFileList)
 {
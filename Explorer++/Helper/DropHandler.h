@@ -36,6 +36,7 @@ private:
 
 	BOOL	CheckDropFormatSupported(IDataObject *pDataObject,FORMATETC *pftc);
 
+	HRESULT	CopyVirtualFiles(IDataObject *pDataObject,std::list<std::wstring> &PastedFileList);
 	HRESULT	CopyUnicodeTextData(IDataObject *pDataObject,std::list<std::wstring> &PastedFileList);
 	HRESULT	CopyAnsiTextData(IDataObject *pDataObject,std::list<std::wstring> &PastedFileList);
 	HRESULT	CopyDIBV5Data(IDataObject *pDataObject,std::list<std::wstring> &PastedFileList);
@@ -46,6 +47,7 @@ private:
 	static FORMATETC	m_ftcText;
 	static FORMATETC	m_ftcUnicodeText;
 	static FORMATETC	m_ftcDIBV5;
+	static FORMATETC	m_ftcFileDescriptor;
 
 	IDataObject			*m_pDataObject;
 	IDropFilesCallback	*m_pDropFilesCallback;
@@ -0,0 +1,439 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "DuplicateFinder.h"
+#include "ParallelWalk.h"
+#include <wil/resource.h>
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+namespace
+{
+
+// The amount of each file that's hashed initially. Files of the same size that differ usually do
+// so near the start (e.g. in a header), so most collisions are resolved without reading much of
+// either file.
+const ULONGLONG PREFIX_HASH_SIZE = 4 * 1024;
+
+// Several files are hashed at once, so this is kept small enough that the views won't exhaust the
+// address space of a 32-bit process.
+const ULONGLONG HASH_VIEW_SIZE = 16 * 1024 * 1024;
+
+// Reading the contents of these files would cause them to be downloaded (or recalled from
+// offline storage).
+const DWORD REMOTE_CONTENT_ATTRIBUTES = FILE_ATTRIBUTE_OFFLINE | FILE_ATTRIBUTE_RECALL_ON_OPEN
+	| FILE_ATTRIBUTE_RECALL_ON_DATA_ACCESS;
+
+struct FoundFile
+{
+	std::wstring path;
+	ULONGLONG size;
+};
+
+// A set of files of the same size whose contents (or prefixes) hash to the same value.
+struct HashGroup
+{
+	FileHash hash;
+	std::vector<const FoundFile *> files;
+};
+
+struct HashedFile
+{
+	const FoundFile *file;
+	size_t candidateIndex;
+	std::optional<FileHash> hash;
+};
+
+struct SearchState
+{
+	std::mutex mutex;
+	std::vector<FoundFile> files;
+	std::atomic<int> filesFound = 0;
+	std::atomic<int> filesHashed = 0;
+};
+
+std::wstring CombinePath(const std::wstring &folder, const std::wstring &name)
+{
+	if (folder.back() == '\\')
+	{
+		return folder + name;
+	}
+
+	return folder + L"\\" + name;
+}
+
+ULONGLONG CombineParts(DWORD low, DWORD high)
+{
+	ULARGE_INTEGER value;
+	value.LowPart = low;
+	value.HighPart = high;
+	return value.QuadPart;
+}
+
+void EnumerateFolder(
+	const std::wstring &folder, SearchState &state, ParallelWalk<std::wstring>::Worker &worker)
+{
+	WIN32_FIND_DATA findData;
+	wil::unique_hfind findHandle(FindFirstFileEx(CombinePath(folder, L"*").c_str(),
+		FindExInfoBasic, &findData, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH));
+
+	if (!findHandle)
+	{
+		return;
+	}
+
+	// The files are gathered locally, so that the shared state only needs to be locked once per
+	// folder.
+	std::vector<FoundFile> files;
+	std::vector<std::wstring> subfolders;
+
+	do
+	{
+		if (lstrcmp(findData.cFileName, _T(".")) == 0 || lstrcmp(findData.cFileName, _T("..")) == 0)
+		{
+			continue;
+		}
+
+		if (WI_IsAnyFlagSet(findData.dwFileAttributes,
+				FILE_ATTRIBUTE_REPARSE_POINT | REMOTE_CONTENT_ATTRIBUTES))
+		{
+			continue;
+		}
+
+		std::wstring path = CombinePath(folder, findData.cFileName);
+
+		if (WI_IsFlagSet(findData.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+		{
+			subfolders.push_back(std::move(path));
+			continue;
+		}
+
+		ULONGLONG size = CombineParts(findData.nFileSizeLow, findData.nFileSizeHigh);
+
+		if (size == 0)
+		{
+			continue;
+		}
+
+		files.push_back({ std::move(path), size });
+	} while (FindNextFile(findHandle.get(), &findData));
+
+	state.filesFound += static_cast<int>(files.size());
+
+	{
+		std::scoped_lock lock(state.mutex);
+		state.files.insert(state.files.end(), std::make_move_iterator(files.begin()),
+			std::make_move_iterator(files.end()));
+	}
+
+	for (auto &subfolder : subfolders)
+	{
+		worker.AddItem(std::move(subfolder));
+	}
+}
+
+// Reading from a mapped view raises an exception (rather than returning an error) if the
+// underlying read fails. As in FolderComparison, this is kept separate, since structured exception
+// handling can't be used in a function that has objects requiring unwinding.
+bool HashView(FileHashCalculator &calculator, const void *view, size_t size, bool &hashed)
+{
+	__try
+	{
+		hashed = calculator.Update({ static_cast<const std::byte *>(view), size });
+		return true;
+	}
+	__except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER
+															: EXCEPTION_CONTINUE_SEARCH)
+	{
+		return false;
+	}
+}
+
+// Hashes the first hashSize bytes of the file (or the entire file, if it's smaller than that).
+std::optional<FileHash> HashFile(
+	const FoundFile &file, ULONGLONG hashSize, std::stop_token stopToken)
+{
+	FileHashCalculator calculator;
+
+	if (!calculator.IsValid())
+	{
+		return std::nullopt;
+	}
+
+	wil::unique_hfile handle(CreateFile(file.path.c_str(), GENERIC_READ,
+		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+		FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+
+	if (!handle)
+	{
+		return std::nullopt;
+	}
+
+	// If the file has changed since it was enumerated, it's no longer known to be the same size as
+	// the other files it's being compared against.
+	LARGE_INTEGER size;
+
+	if (!GetFileSizeEx(handle.get(), &size) || static_cast<ULONGLONG>(size.QuadPart) != file.size)
+	{
+		return std::nullopt;
+	}
+
+	wil::unique_handle mapping(
+		CreateFileMapping(handle.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+
+	if (!mapping)
+	{
+		return std::nullopt;
+	}
+
+	ULONGLONG length = (std::min)(hashSize, file.size);
+
+	for (ULONGLONG offset = 0; offset < length; offset += HASH_VIEW_SIZE)
+	{
+		if (stopToken.stop_requested())
+		{
+			return std::nullopt;
+		}
+
+		auto viewSize = static_cast<SIZE_T>((std::min)(HASH_VIEW_SIZE, length - offset));
+		ULARGE_INTEGER viewOffset;
+		viewOffset.QuadPart = offset;
+
+		wil::unique_mapview_ptr<void> view(MapViewOfFile(mapping.get(), FILE_MAP_READ,
+			viewOffset.HighPart, viewOffset.LowPart, viewSize));
+
+		if (!view)
+		{
+			return std::nullopt;
+		}
+
+		bool hashed = false;
+
+		if (!HashView(calculator, view.get(), viewSize, hashed) || !hashed)
+		{
+			return std::nullopt;
+		}
+	}
+
+	return calculator.Finish();
+}
+
+// Hashes (up to hashSize bytes of) each file in the candidate sets, in parallel, then splits each
+// set by hash. Any file that ends up on its own (or that couldn't be read) is discarded.
+std::vector<HashGroup> HashAndGroup(const std::vector<std::vector<const FoundFile *>> &candidates,
+	ULONGLONG hashSize, SearchState &state, std::stop_token stopToken,
+	const std::function<void()> &reportProgress)
+{
+	std::vector<HashedFile> hashedFiles;
+
+	for (size_t i = 0; i < candidates.size(); i++)
+	{
+		for (const FoundFile *file : candidates[i])
+		{
+			hashedFiles.push_back({ file, i, std::nullopt });
+		}
+	}
+
+	std::vector<HashedFile *> items;
+	items.reserve(hashedFiles.size());
+
+	for (auto &hashedFile : hashedFiles)
+	{
+		items.push_back(&hashedFile);
+	}
+
+	ParallelWalk<HashedFile *>::Run(
+		std::move(items),
+		[hashSize, &state, stopToken](
+			HashedFile *hashedFile, ParallelWalk<HashedFile *>::Worker &worker) {
+			UNREFERENCED_PARAMETER(worker);
+
+			hashedFile->hash = HashFile(*hashedFile->file, hashSize, stopToken);
+			state.filesHashed++;
+		},
+		stopToken, reportProgress);
+
+	// The files for each candidate set are contiguous.
+	std::vector<HashGroup> groups;
+	auto itr = hashedFiles.begin();
+
+	while (itr != hashedFiles.end())
+	{
+		size_t candidateIndex = itr->candidateIndex;
+		std::map<FileHash, std::vector<const FoundFile *>> filesByHash;
+
+		for (; itr != hashedFiles.end() && itr->candidateIndex == candidateIndex; ++itr)
+		{
+			if (itr->hash)
+			{
+				filesByHash[*itr->hash].push_back(itr->file);
+			}
+		}
+
+		for (auto &[hash, files] : filesByHash)
+		{
+			if (files.size() > 1)
+			{
+				groups.push_back({ hash, std::move(files) });
+			}
+		}
+	}
+
+	return groups;
+}
+
+}
+
+HRESULT FindDuplicateFiles(const std::vector<std::wstring> &folders,
+	std::vector<DuplicateFileGroup> &groups, std::stop_token stopToken,
+	const DuplicateSearchProgressCallback &progressCallback)
+{
+	for (const auto &folder : folders)
+	{
+		DWORD attributes = GetFileAttributes(folder.c_str());
+
+		if (attributes == INVALID_FILE_ATTRIBUTES)
+		{
+			return HRESULT_FROM_WIN32(GetLastError());
+		}
+
+		if (WI_IsFlagClear(attributes, FILE_ATTRIBUTE_DIRECTORY))
+		{
+			return HRESULT_FROM_WIN32(ERROR_DIRECTORY);
+		}
+	}
+
+	SearchState state;
+
+	auto reportProgress = [&state, &progressCallback]() {
+		if (progressCallback)
+		{
+			progressCallback(state.filesFound, state.filesHashed);
+		}
+	};
+
+	ParallelWalk<std::wstring>::Run(
+		folders,
+		[&state](const std::wstring &folder, ParallelWalk<std::wstring>::Worker &worker) {
+			EnumerateFolder(folder, state, worker);
+		},
+		stopToken, reportProgress);
+
+	if (stopToken.stop_requested())
+	{
+		return HRESULT_FROM_WIN32(ERROR_CANCELLED);
+	}
+
+	// If one of the folders is within another, the files within it will have been found twice.
+	// Those files would otherwise be reported as duplicates of themselves.
+	auto isLess = [](const FoundFile &file1, const FoundFile &file2) {
+		return CompareStringOrdinal(file1.path.c_str(), static_cast<int>(file1.path.size()),
+				   file2.path.c_str(), static_cast<int>(file2.path.size()), TRUE)
+			== CSTR_LESS_THAN;
+	};
+	auto isEqual = [&isLess](const FoundFile &file1, const FoundFile &file2) {
+		return !isLess(file1, file2) && !isLess(file2, file1);
+	};
+	std::sort(state.files.begin(), state.files.end(), isLess);
+	state.files.erase(
+		std::unique(state.files.begin(), state.files.end(), isEqual), state.files.end());
+
+	// Only files that share their size with at least one other file can have a duplicate.
+	std::unordered_map<ULONGLONG, std::vector<const FoundFile *>> filesBySize;
+
+	for (const auto &file : state.files)
+	{
+		filesBySize[file.size].push_back(&file);
+	}
+
+	std::vector<std::vector<const FoundFile *>> prefixCandidates;
+
+	for (auto &[size, files] : filesBySize)
+	{
+		if (files.size() > 1)
+		{
+			prefixCandidates.push_back(std::move(files));
+		}
+	}
+
+	auto prefixGroups =
+		HashAndGroup(prefixCandidates, PREFIX_HASH_SIZE, state, stopToken, reportProgress);
+
+	if (stopToken.stop_requested())
+	{
+		return HRESULT_FROM_WIN32(ERROR_CANCELLED);
+	}
+
+	// For files no larger than the prefix, the prefix hash already covers the entire file.
+	std::vector<HashGroup> duplicateGroups;
+	std::vector<std::vector<const FoundFile *>> fullCandidates;
+
+	for (auto &prefixGroup : prefixGroups)
+	{
+		if (prefixGroup.files.front()->size <= PREFIX_HASH_SIZE)
+		{
+			duplicateGroups.push_back(std::move(prefixGroup));
+		}
+		else
+		{
+			fullCandidates.push_back(std::move(prefixGroup.files));
+		}
+	}
+
+	auto fullGroups = HashAndGroup(
+		fullCandidates, (std::numeric_limits<ULONGLONG>::max)(), state, stopToken, reportProgress);
+
+	if (stopToken.stop_requested())
+	{
+		return HRESULT_FROM_WIN32(ERROR_CANCELLED);
+	}
+
+	duplicateGroups.insert(duplicateGroups.end(), std::make_move_iterator(fullGroups.begin()),
+		std::make_move_iterator(fullGroups.end()));
+
+	std::vector<DuplicateFileGroup> results;
+	results.reserve(duplicateGroups.size());
+
+	for (const auto &duplicateGroup : duplicateGroups)
+	{
+		DuplicateFileGroup group;
+		group.size = duplicateGroup.files.front()->size;
+		group.hash = duplicateGroup.hash;
+
+		// The files were sorted by path above and each group preserves that order.
+		for (const FoundFile *file : duplicateGroup.files)
+		{
+			group.paths.push_back(file->path);
+		}
+
+		results.push_back(std::move(group));
+	}
+
+	// The groups that waste the most space are listed first.
+	auto getWastedSpace = [](const DuplicateFileGroup &group) {
+		return group.size * (group.paths.size() - 1);
+	};
+	std::sort(results.begin(), results.end(),
+		[&getWastedSpace](const DuplicateFileGroup &group1, const DuplicateFileGroup &group2) {
+			ULONGLONG wastedSpace1 = getWastedSpace(group1);
+			ULONGLONG wastedSpace2 = getWastedSpace(group2);
+
+			if (wastedSpace1 != wastedSpace2)
+			{
+				return wastedSpace1 > wastedSpace2;
+			}
+
+			return group1.paths.front() < group2.paths.front();
+		});
+
+	groups = std::move(results);
+
+	return S_OK;
+}
\ No newline at end of file
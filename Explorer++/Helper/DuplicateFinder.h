@@ -0,0 +1,40 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "FileHash.h"
+#include <functional>
+#include <stop_token>
+#include <string>
+#include <vector>
+
+// A set of files with identical contents.
+struct DuplicateFileGroup
+{
+	ULONGLONG size;
+	FileHash hash;
+
+	// Sorted, so that the files in each group are listed in a stable order.
+	std::vector<std::wstring> paths;
+};
+
+// Invoked periodically on the calling thread while a search is in progress. The number of files
+// hashed includes both partial and full hashes.
+using DuplicateSearchProgressCallback = std::function<void(int filesFound, int filesHashed)>;
+
+// Finds files with identical contents anywhere within the specified folders. The folders are
+// walked in parallel (using the threads shared with ParallelWalk) and the files found are bucketed
+// by size. Only files that share a size with another file are read at all. Those files first have
+// their initial 4 KB hashed and only the files whose prefixes also collide are hashed in full.
+// Files are read through memory-mapped views, with the hashing spread across the same threads.
+//
+// Empty files are ignored, as are reparse points (which aren't followed) and files whose contents
+// would have to be downloaded first (e.g. cloud placeholders). Folders that can't be enumerated
+// and files that can't be read are skipped, so that a single inaccessible item doesn't prevent the
+// rest of the folders from being searched. The groups that waste the most space are returned
+// first.
+HRESULT FindDuplicateFiles(const std::vector<std::wstring> &folders,
+	std::vector<DuplicateFileGroup> &groups, std::stop_token stopToken = {},
+	const DuplicateSearchProgressCallback &progressCallback = nullptr);
\ No newline at end of file
@@ -0,0 +1,178 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ExtensionIconCache.h"
+#include <wil/com.h>
+#include <wil/resource.h>
+#include <Shlwapi.h>
+#include <mutex>
+
+namespace
+{
+
+// These types are always treated as having per-file icons, regardless of how they're registered.
+const WCHAR *const PER_INSTANCE_ICON_EXTENSIONS[] = { L".exe", L".lnk", L".ico", L".cur", L".ani",
+	L".url", L".scr", L".appref-ms" };
+
+}
+
+std::optional<int> ExtensionIconCache::GetIconIndex(const std::wstring &extension)
+{
+	std::wstring key = extension;
+	CharLowerBuff(key.data(), static_cast<DWORD>(key.size()));
+
+	{
+		std::shared_lock lock(m_mutex);
+
+		auto itr = m_iconIndexes.find(key);
+
+		if (itr != m_iconIndexes.end())
+		{
+			return itr->second;
+		}
+	}
+
+	// This is done without holding the lock, since it involves reading from the registry. If two
+	// threads look up the same extension at once, they'll both find the same result.
+	auto iconIndex = LookUpIconIndex(key);
+
+	std::unique_lock lock(m_mutex);
+	m_iconIndexes.insert({ key, iconIndex });
+
+	return iconIndex;
+}
+
+void ExtensionIconCache::Clear()
+{
+	std::unique_lock lock(m_mutex);
+	m_iconIndexes.clear();
+}
+
+std::optional<int> ExtensionIconCache::LookUpIconIndex(const std::wstring &extension)
+{
+	if (HasPerInstanceIcons(extension))
+	{
+		return std::nullopt;
+	}
+
+	// With SHGFI_USEFILEATTRIBUTES, the file doesn't need to exist, so this only queries the
+	// registered icon for the type.
+	std::wstring fileName = L"file" + extension;
+	SHFILEINFO shfi;
+	DWORD_PTR res = SHGetFileInfo(fileName.c_str(), FILE_ATTRIBUTE_NORMAL, &shfi, sizeof(shfi),
+		SHGFI_USEFILEATTRIBUTES | SHGFI_SYSICONINDEX);
+
+	if (res == 0)
+	{
+		return std::nullopt;
+	}
+
+	return shfi.iIcon;
+}
+
+bool ExtensionIconCache::HasPerInstanceIcons(const std::wstring &extension)
+{
+	for (auto perInstanceExtension : PER_INSTANCE_ICON_EXTENSIONS)
+	{
+		if (extension == perInstanceExtension)
+		{
+			return true;
+		}
+	}
+
+	// Files without an extension aren't associated with any type, so always share the generic
+	// file icon.
+	if (extension.empty())
+	{
+		return false;
+	}
+
+	// A default icon of "%1" means that the icon is taken from the file itself.
+	WCHAR defaultIcon[MAX_PATH];
+	DWORD size = SIZEOF_ARRAY(defaultIcon);
+	HRESULT hr = AssocQueryString(ASSOCF_INIT_IGNOREUNKNOWN, ASSOCSTR_DEFAULTICON,
+		extension.c_str(), nullptr, defaultIcon, &size);
+
+	if (SUCCEEDED(hr) && StrStr(defaultIcon, L"%1") != nullptr)
+	{
+		return true;
+	}
+
+	// An icon handler can return a different icon for each file.
+	wil::unique_hkey classKey;
+	hr = AssocQueryKey(ASSOCF_INIT_IGNOREUNKNOWN, ASSOCKEY_CLASS, extension.c_str(), nullptr,
+		&classKey);
+
+	if (SUCCEEDED(hr))
+	{
+		wil::unique_hkey iconHandlerKey;
+		LSTATUS status =
+			RegOpenKeyEx(classKey.get(), L"shellex\\IconHandler", 0, KEY_READ, &iconHandlerKey);
+
+		if (status == ERROR_SUCCESS)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+ExtensionIconCache &GetExtensionIconCache()
+{
+	static ExtensionIconCache extensionIconCache;
+	return extensionIconCache;
+}
+
+std::optional<int> GetItemIconIndex(PCIDLIST_ABSOLUTE pidl)
+{
+	wil::com_ptr_nothrow<IShellFolder> parent;
+	PCITEMID_CHILD child;
+	HRESULT hr = SHBindToParent(pidl, IID_PPV_ARGS(&parent), &child);
+
+	if (SUCCEEDED(hr))
+	{
+		// For file system items, the find data is stored within the pidl, so this doesn't require
+		// the file to be accessed.
+		WIN32_FIND_DATA findData;
+		hr = SHGetDataFromIDList(
+			parent.get(), child, SHGDFIL_FINDDATA, &findData, sizeof(findData));
+
+		if (SUCCEEDED(hr) && WI_IsFlagClear(findData.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+		{
+			auto iconIndex =
+				GetExtensionIconCache().GetIconIndex(PathFindExtension(findData.cFileName));
+
+			if (iconIndex)
+			{
+				// Overlays (e.g. a sync status) are specific to each file.
+				int overlayIndex = 0;
+				auto iconOverlay = parent.try_query<IShellIconOverlay>();
+
+				if (iconOverlay && iconOverlay->GetOverlayIndex(child, &overlayIndex) == S_OK)
+				{
+					return *iconIndex | (overlayIndex << 24);
+				}
+
+				return *iconIndex;
+			}
+		}
+	}
+
+	// Must use SHGFI_ICON here, rather than SHGFO_SYSICONINDEX, or else
+	// icon overlays won't be applied.
+	SHFILEINFO shfi;
+	DWORD_PTR res = SHGetFileInfo(reinterpret_cast<LPCTSTR>(pidl), 0, &shfi, sizeof(shfi),
+		SHGFI_PIDL | SHGFI_ICON | SHGFI_OVERLAYINDEX);
+
+	if (res == 0)
+	{
+		return std::nullopt;
+	}
+
+	DestroyIcon(shfi.hIcon);
+
+	return shfi.iIcon;
+}
\ No newline at end of file
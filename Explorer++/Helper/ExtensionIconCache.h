@@ -0,0 +1,47 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+// Most file types have a single, static icon, which every file of that type shares. For those
+// types, there's no need to query each file individually to find its icon. This class maps each
+// file extension to the system image list index of the type's icon, so that index only needs to
+// be looked up once. Types whose files can each have a different icon (e.g. .exe, .ico and .lnk
+// files) are recorded as well, so that callers know to fall back to querying the file directly.
+//
+// The cache can be used concurrently from multiple threads.
+class ExtensionIconCache
+{
+public:
+	// Returns the icon index shared by files with the specified extension (which should include
+	// the leading period), or std::nullopt if each file of this type needs to be queried
+	// individually.
+	std::optional<int> GetIconIndex(const std::wstring &extension);
+
+	// Should be called when file associations have changed.
+	void Clear();
+
+private:
+	static std::optional<int> LookUpIconIndex(const std::wstring &extension);
+	static bool HasPerInstanceIcons(const std::wstring &extension);
+
+	std::shared_mutex m_mutex;
+	std::unordered_map<std::wstring, std::optional<int>> m_iconIndexes;
+};
+
+// The cache shared by all the windows that display file icons (the listview, treeview and
+// bookmark UI).
+ExtensionIconCache &GetExtensionIconCache();
+
+// Returns the icon index for the item, in the same format as SHGetFileInfo() with
+// SHGFI_OVERLAYINDEX (i.e. with any overlay index stored in the upper 8 bits). For files with a
+// static icon type, the icon comes from the shared extension cache and only the overlay is queried
+// for the individual file. Everything else is queried in full. This can be called from any thread
+// on which COM has been initialized.
+std::optional<int> GetItemIconIndex(PCIDLIST_ABSOLUTE pidl);
\ No newline at end of file
@@ -0,0 +1,73 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "FastRandom.h"
+#include <cstring>
+
+namespace
+{
+
+// Used to expand the seed into the generator state, as recommended by the xoshiro authors.
+uint64_t SplitMix64(uint64_t &state)
+{
+	uint64_t z = (state += 0x9E3779B97F4A7C15);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+	return z ^ (z >> 31);
+}
+
+}
+
+FastRandom::FastRandom(uint64_t seed)
+{
+	for (size_t lane = 0; lane < NUM_LANES; lane++)
+	{
+		for (auto &word : m_state)
+		{
+			word[lane] = SplitMix64(seed);
+		}
+	}
+}
+
+void FastRandom::Fill(std::span<std::byte> buffer)
+{
+	uint64_t block[NUM_LANES];
+
+	while (buffer.size() >= BLOCK_SIZE)
+	{
+		NextBlock(block);
+		std::memcpy(buffer.data(), block, BLOCK_SIZE);
+		buffer = buffer.subspan(BLOCK_SIZE);
+	}
+
+	if (!buffer.empty())
+	{
+		NextBlock(block);
+		std::memcpy(buffer.data(), block, buffer.size());
+	}
+}
+
+void FastRandom::NextBlock(uint64_t (&output)[NUM_LANES])
+{
+	auto &s0 = m_state[0];
+	auto &s1 = m_state[1];
+	auto &s2 = m_state[2];
+	auto &s3 = m_state[3];
+
+	for (size_t lane = 0; lane < NUM_LANES; lane++)
+	{
+		output[lane] = s0[lane] + s3[lane];
+
+		uint64_t t = s1[lane] << 17;
+
+		s2[lane] ^= s0[lane];
+		s3[lane] ^= s1[lane];
+		s1[lane] ^= s2[lane];
+		s0[lane] ^= s3[lane];
+
+		s2[lane] ^= t;
+		s3[lane] = (s3[lane] << 45) | (s3[lane] >> 19);
+	}
+}
\ No newline at end of file
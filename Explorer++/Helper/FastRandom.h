@@ -0,0 +1,33 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+// A fast (non-cryptographic) pseudorandom generator, intended for producing large amounts of
+// random data, such as when overwriting a file. It's based on xoshiro256+, with several
+// independent streams run side by side. Each step only uses additions, shifts and xors, so the
+// compiler can vectorize the generation of all the streams at once.
+class FastRandom
+{
+public:
+	explicit FastRandom(uint64_t seed);
+
+	// Fills the buffer with random bytes. Any part of a block left over at the end of the buffer
+	// is discarded, so filling a buffer in pieces won't produce the same output as filling it all
+	// at once.
+	void Fill(std::span<std::byte> buffer);
+
+private:
+	static constexpr size_t NUM_LANES = 4;
+	static constexpr size_t BLOCK_SIZE = NUM_LANES * sizeof(uint64_t);
+
+	void NextBlock(uint64_t (&output)[NUM_LANES]);
+
+	// Stored as m_state[word][lane], so that each step operates on adjacent values.
+	uint64_t m_state[4][NUM_LANES];
+};
\ No newline at end of file
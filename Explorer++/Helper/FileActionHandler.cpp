@@ -14,32 +14,24 @@
 
 BOOL FileActionHandler::RenameFiles(const RenamedItems_t &itemList)
 {
-	RenamedItems_t renamedItems;
+	std::vector<const RenamedItem_t *> items;
+	std::vector<NFileOperations::FileRename> renames;
 
 	for (const auto &item : itemList)
 	{
-		/* TODO: This should actually be done by the caller. */
-		IShellItem *shellItem = nullptr;
-		HRESULT hr = SHCreateItemFromParsingName(
-			item.strOldFilename.c_str(), nullptr, IID_PPV_ARGS(&shellItem));
-
-		if (SUCCEEDED(hr))
-		{
-			TCHAR newFilename[MAX_PATH];
-			StringCchCopy(newFilename, SIZEOF_ARRAY(newFilename), item.strNewFilename.c_str());
-			PathStripPath(newFilename);
+		items.push_back(&item);
+		renames.push_back({ item.strOldFilename, PathFindFileName(item.strNewFilename.c_str()) });
+	}
 
-			/* TODO: Could rename all files in the list in a single
-			operation, rather than one by one.*/
-			hr = NFileOperations::RenameFile(shellItem, newFilename);
+	/* All the items are renamed together, rather than one by
+	one. */
+	auto renamedIndexes = NFileOperations::RenameFiles(renames);
 
-			if (SUCCEEDED(hr))
-			{
-				renamedItems.push_back(item);
-			}
+	RenamedItems_t renamedItems;
 
-			shellItem->Release();
-		}
+	for (size_t index : renamedIndexes)
+	{
+		renamedItems.push_back(*items[index]);
 	}
 
 	/* Only store an undo operation if at least one
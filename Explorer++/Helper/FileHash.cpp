@@ -0,0 +1,177 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "FileHash.h"
+#include "DriveInfo.h"
+#include "UnbufferedIo.h"
+
+namespace
+{
+
+const int HASH_NUM_BUFFERS = 2;
+
+BCRYPT_ALG_HANDLE GetSha256Algorithm()
+{
+	// Algorithm handles can be used from multiple threads, so a single handle is opened and kept
+	// for the lifetime of the process.
+	static BCRYPT_ALG_HANDLE algorithm = []() -> BCRYPT_ALG_HANDLE
+	{
+		BCRYPT_ALG_HANDLE handle;
+		NTSTATUS status =
+			BCryptOpenAlgorithmProvider(&handle, BCRYPT_SHA256_ALGORITHM, nullptr, 0);
+		return BCRYPT_SUCCESS(status) ? handle : nullptr;
+	}();
+
+	return algorithm;
+}
+
+struct ReadBuffer
+{
+	wil::unique_virtualalloc_ptr<std::byte> data;
+	OverlappedOperation operation;
+};
+
+}
+
+FileHashCalculator::FileHashCalculator()
+{
+	BCRYPT_ALG_HANDLE algorithm = GetSha256Algorithm();
+
+	if (algorithm
+		&& !BCRYPT_SUCCESS(BCryptCreateHash(algorithm, &m_hash, nullptr, 0, nullptr, 0, 0)))
+	{
+		m_hash = nullptr;
+	}
+}
+
+FileHashCalculator::~FileHashCalculator()
+{
+	if (m_hash)
+	{
+		BCryptDestroyHash(m_hash);
+	}
+}
+
+bool FileHashCalculator::IsValid() const
+{
+	return m_hash != nullptr;
+}
+
+bool FileHashCalculator::Update(std::span<const std::byte> data)
+{
+	NTSTATUS status = BCryptHashData(m_hash,
+		reinterpret_cast<PUCHAR>(const_cast<std::byte *>(data.data())),
+		static_cast<ULONG>(data.size()), 0);
+	return BCRYPT_SUCCESS(status);
+}
+
+std::optional<FileHash> FileHashCalculator::Finish()
+{
+	FileHash hash;
+	NTSTATUS status = BCryptFinishHash(
+		m_hash, reinterpret_cast<PUCHAR>(hash.data()), static_cast<ULONG>(hash.size()), 0);
+
+	if (!BCRYPT_SUCCESS(status))
+	{
+		return std::nullopt;
+	}
+
+	return hash;
+}
+
+std::optional<FileHash> CalculateFileHash(const std::wstring &path, std::stop_token stopToken)
+{
+	FileHashCalculator calculator;
+
+	if (!calculator.IsValid())
+	{
+		return std::nullopt;
+	}
+
+	wil::unique_hfile file(CreateFile(path.c_str(), GENERIC_READ,
+		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+		FILE_FLAG_NO_BUFFERING | FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+
+	if (!file)
+	{
+		return std::nullopt;
+	}
+
+	size_t bufferSize = GetStorageInfo(path).ioSettings.bufferSize;
+	std::array<ReadBuffer, HASH_NUM_BUFFERS> buffers;
+	ULONGLONG nextOffset = 0;
+
+	for (auto &buffer : buffers)
+	{
+		buffer.data = AllocateUnbufferedIoBuffer(bufferSize);
+
+		if (!buffer.data
+			|| !buffer.operation.StartRead(
+				file.get(), buffer.data.get(), static_cast<DWORD>(bufferSize), nextOffset))
+		{
+			return std::nullopt;
+		}
+
+		nextOffset += bufferSize;
+	}
+
+	// Each buffer is hashed in the order in which it was read. Once a buffer has been hashed, it's
+	// immediately reused for the next block of the file.
+	for (size_t index = 0;; index = (index + 1) % buffers.size())
+	{
+		auto &buffer = buffers[index];
+		auto numBytesRead = buffer.operation.Wait();
+
+		if (!numBytesRead)
+		{
+			return std::nullopt;
+		}
+
+		if (!calculator.Update({ buffer.data.get(), *numBytesRead }))
+		{
+			return std::nullopt;
+		}
+
+		// A short read means that the end of the file has been reached. Any reads that are still
+		// outstanding start beyond that point and will be cancelled when the buffers are
+		// destroyed.
+		if (*numBytesRead < bufferSize)
+		{
+			break;
+		}
+
+		if (stopToken.stop_requested())
+		{
+			return std::nullopt;
+		}
+
+		if (!buffer.operation.StartRead(
+				file.get(), buffer.data.get(), static_cast<DWORD>(bufferSize), nextOffset))
+		{
+			return std::nullopt;
+		}
+
+		nextOffset += bufferSize;
+	}
+
+	return calculator.Finish();
+}
+
+std::wstring FormatFileHash(const FileHash &hash)
+{
+	static const wchar_t HEX_DIGITS[] = L"0123456789abcdef";
+
+	std::wstring text;
+	text.reserve(hash.size() * 2);
+
+	for (auto byte : hash)
+	{
+		auto value = std::to_integer<unsigned int>(byte);
+		text.push_back(HEX_DIGITS[value >> 4]);
+		text.push_back(HEX_DIGITS[value & 0xf]);
+	}
+
+	return text;
+}
\ No newline at end of file
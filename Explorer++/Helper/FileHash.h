@@ -0,0 +1,46 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <bcrypt.h>
+#include <array>
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <stop_token>
+#include <string>
+
+// A SHA-256 hash.
+using FileHash = std::array<std::byte, 32>;
+
+// Calculates a SHA-256 hash incrementally, for callers that read the data themselves.
+class FileHashCalculator
+{
+public:
+	FileHashCalculator();
+	~FileHashCalculator();
+
+	FileHashCalculator(const FileHashCalculator &) = delete;
+	FileHashCalculator &operator=(const FileHashCalculator &) = delete;
+
+	bool IsValid() const;
+	bool Update(std::span<const std::byte> data);
+	std::optional<FileHash> Finish();
+
+private:
+	BCRYPT_HASH_HANDLE m_hash = nullptr;
+};
+
+// Calculates the SHA-256 hash of a file. The file is read sequentially, in large blocks (sized for
+// the device the file is on), using unbuffered I/O. That avoids copying the data through the
+// system file cache (and means that hashing a large set of files won't evict everything else from
+// the cache). The next block is read while the current one is being hashed.
+//
+// Returns nullopt if the file couldn't be read, or the calculation was stopped.
+std::optional<FileHash> CalculateFileHash(const std::wstring &path, std::stop_token stopToken = {});
+
+// Returns the hash as a lowercase hexadecimal string, which is the format used by tools like
+// sha256sum.
+std::wstring FormatFileHash(const FileHash &hash);
\ No newline at end of file
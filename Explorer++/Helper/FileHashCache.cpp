@@ -0,0 +1,182 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "FileHashCache.h"
+#include "ThreadQos.h"
+#include <future>
+
+namespace
+{
+
+ULONGLONG GetFileSize(const WIN32_FILE_ATTRIBUTE_DATA &attributeData)
+{
+	ULARGE_INTEGER size;
+	size.LowPart = attributeData.nFileSizeLow;
+	size.HighPart = attributeData.nFileSizeHigh;
+	return size.QuadPart;
+}
+
+bool AreFileTimesEqual(const FILETIME &fileTime1, const FILETIME &fileTime2)
+{
+	return CompareFileTime(&fileTime1, &fileTime2) == 0;
+}
+
+}
+
+FileHashCache &FileHashCache::GetInstance()
+{
+	static FileHashCache fileHashCache;
+	return fileHashCache;
+}
+
+FileHashCache::FileHashCache() : m_threadPool(NUM_IO_THREADS)
+{
+}
+
+std::optional<FileHash> FileHashCache::GetFileHash(
+	const std::wstring &path, std::stop_token stopToken)
+{
+	WIN32_FILE_ATTRIBUTE_DATA attributeData;
+	BOOL res = GetFileAttributesEx(path.c_str(), GetFileExInfoStandard, &attributeData);
+
+	if (!res || WI_IsFlagSet(attributeData.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+	{
+		return std::nullopt;
+	}
+
+	ULONGLONG size = GetFileSize(attributeData);
+	auto cachedHash = GetCachedFileHash(path, size, attributeData.ftLastWriteTime);
+
+	if (cachedHash)
+	{
+		return cachedHash;
+	}
+
+	std::optional<FileHash> hash;
+
+	{
+		auto slot = m_diskIoLimiter.Acquire(path);
+
+		if (stopToken.stop_requested())
+		{
+			return std::nullopt;
+		}
+
+		hash = CalculateFileHash(path, stopToken);
+	}
+
+	if (!hash)
+	{
+		return std::nullopt;
+	}
+
+	// If the file was modified while it was being read, the hash may not correspond to any
+	// version of the file, so it's not cached.
+	WIN32_FILE_ATTRIBUTE_DATA updatedAttributeData;
+	res = GetFileAttributesEx(path.c_str(), GetFileExInfoStandard, &updatedAttributeData);
+
+	if (!res || GetFileSize(updatedAttributeData) != size
+		|| !AreFileTimesEqual(
+			updatedAttributeData.ftLastWriteTime, attributeData.ftLastWriteTime))
+	{
+		return hash;
+	}
+
+	FileEntry entry;
+	entry.size = size;
+	entry.lastWriteTime = attributeData.ftLastWriteTime;
+	entry.hash = *hash;
+
+	std::scoped_lock lock(m_mutex);
+
+	if (m_entries.size() >= MAX_ENTRIES)
+	{
+		m_entries.clear();
+	}
+
+	m_entries.insert_or_assign(GetKey(path), entry);
+
+	return hash;
+}
+
+std::optional<FileHash> FileHashCache::GetCachedFileHash(
+	const std::wstring &path, ULONGLONG size, const FILETIME &lastWriteTime)
+{
+	std::scoped_lock lock(m_mutex);
+
+	auto itr = m_entries.find(GetKey(path));
+
+	if (itr == m_entries.end() || itr->second.size != size
+		|| !AreFileTimesEqual(itr->second.lastWriteTime, lastWriteTime))
+	{
+		return std::nullopt;
+	}
+
+	return itr->second.hash;
+}
+
+std::vector<std::optional<FileHash>> FileHashCache::GetFileHashes(
+	const std::vector<std::wstring> &paths, std::stop_token stopToken,
+	const ProgressCallback &progressCallback)
+{
+	std::vector<std::future<std::optional<FileHash>>> futures;
+	futures.reserve(paths.size());
+
+	for (const auto &path : paths)
+	{
+		futures.push_back(m_threadPool.push(
+			[this, path, stopToken](int id)
+			{
+				UNREFERENCED_PARAMETER(id);
+
+				// Hashing reads every byte of each file, so it shouldn't compete with the I/O
+				// needed for browsing.
+				SetCurrentThreadTaskClass(TaskClass::Bulk);
+
+				if (stopToken.stop_requested())
+				{
+					return std::optional<FileHash>();
+				}
+
+				return GetFileHash(path, stopToken);
+			}));
+	}
+
+	std::vector<std::optional<FileHash>> hashes;
+	hashes.reserve(paths.size());
+
+	for (auto &future : futures)
+	{
+		while (future.wait_for(PROGRESS_INTERVAL) != std::future_status::ready)
+		{
+			if (progressCallback)
+			{
+				progressCallback(static_cast<int>(hashes.size()));
+			}
+		}
+
+		hashes.push_back(future.get());
+	}
+
+	if (progressCallback)
+	{
+		progressCallback(static_cast<int>(hashes.size()));
+	}
+
+	return hashes;
+}
+
+void FileHashCache::Clear()
+{
+	std::scoped_lock lock(m_mutex);
+	m_entries.clear();
+}
+
+std::wstring FileHashCache::GetKey(const std::wstring &path)
+{
+	std::wstring key = path;
+	CharUpperBuff(key.data(), static_cast<DWORD>(key.size()));
+	return key;
+}
\ No newline at end of file
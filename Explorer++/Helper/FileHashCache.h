@@ -0,0 +1,78 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "DiskIoLimiter.h"
+#include "FileHash.h"
+#include "../ThirdParty/CTPL/cpl_stl.h"
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Caches file hashes, so that a file only has to be read again once it's been modified. Each hash
+// is stored along with the size and last write time the file had when it was hashed, and is only
+// used while both still match.
+//
+// Hashes are calculated with the number of concurrent reads limited per physical disk (see
+// DiskIoLimiter), regardless of which thread requests them.
+class FileHashCache
+{
+public:
+	// Called with the number of files that have been hashed so far.
+	using ProgressCallback = std::function<void(int numFilesHashed)>;
+
+	static FileHashCache &GetInstance();
+
+	// Returns the hash of the file, calculating it if there's no valid cached hash. This blocks
+	// until the hash is available.
+	std::optional<FileHash> GetFileHash(const std::wstring &path, std::stop_token stopToken = {});
+
+	// Returns the cached hash of the file, provided the cached hash was calculated when the file
+	// had the specified size and last write time. This doesn't access the filesystem, so it's
+	// cheap enough to be called when sorting.
+	std::optional<FileHash> GetCachedFileHash(
+		const std::wstring &path, ULONGLONG size, const FILETIME &lastWriteTime);
+
+	// Hashes a set of files in parallel, on a dedicated pool of I/O threads. The results are
+	// returned in the same order as the paths. The progress callback is invoked periodically on
+	// the calling thread.
+	std::vector<std::optional<FileHash>> GetFileHashes(const std::vector<std::wstring> &paths,
+		std::stop_token stopToken = {}, const ProgressCallback &progressCallback = nullptr);
+
+	void Clear();
+
+private:
+	// The cache is cleared if it grows beyond this many files, so that memory usage remains
+	// bounded.
+	static const size_t MAX_ENTRIES = 100000;
+
+	// Most of these threads will be waiting on a disk limit at any one time. There are enough of
+	// them that files on several disks can be read simultaneously.
+	static const int NUM_IO_THREADS = 8;
+
+	static constexpr std::chrono::milliseconds PROGRESS_INTERVAL = std::chrono::milliseconds(100);
+
+	struct FileEntry
+	{
+		ULONGLONG size;
+		FILETIME lastWriteTime;
+		FileHash hash;
+	};
+
+	FileHashCache();
+
+	static std::wstring GetKey(const std::wstring &path);
+
+	std::mutex m_mutex;
+	std::unordered_map<std::wstring, FileEntry> m_entries;
+
+	DiskIoLimiter m_diskIoLimiter;
+	ctpl::thread_pool m_threadPool;
+};
\ No newline at end of file
@@ -0,0 +1,479 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "FileOperationQueue.h"
+#include "DiskIoLimiter.h"
+#include <algorithm>
+#include <fstream>
+#include <unordered_set>
+#include <utility>
+
+namespace
+{
+
+// Limits used when loading, so that a corrupt file can't result in excessive allocations.
+const uint32_t MAX_LOADED_JOBS = 10000;
+const uint32_t MAX_LOADED_SOURCE_PATHS = 1000000;
+const uint32_t MAX_LOADED_STRING_SIZE = 32 * 1024;
+
+template <typename T>
+void WriteValue(std::ofstream &stream, const T &value)
+{
+	stream.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+void WriteString(std::ofstream &stream, const std::wstring &value)
+{
+	WriteValue(stream, static_cast<uint32_t>(value.size()));
+	stream.write(reinterpret_cast<const char *>(value.data()), value.size() * sizeof(wchar_t));
+}
+
+template <typename T>
+bool ReadValue(std::ifstream &stream, T &value)
+{
+	stream.read(reinterpret_cast<char *>(&value), sizeof(value));
+	return stream.good();
+}
+
+bool ReadString(std::ifstream &stream, std::wstring &value)
+{
+	uint32_t size;
+
+	if (!ReadValue(stream, size) || size > MAX_LOADED_STRING_SIZE)
+	{
+		return false;
+	}
+
+	value.resize(size);
+	stream.read(reinterpret_cast<char *>(value.data()), size * sizeof(wchar_t));
+	return stream.good();
+}
+
+std::wstring GetParentPath(const std::wstring &path)
+{
+	auto position = path.find_last_of('\\');
+
+	if (position == std::wstring::npos)
+	{
+		return path;
+	}
+
+	return path.substr(0, position + 1);
+}
+
+}
+
+FileOperationQueue::FileOperationQueue(
+	const std::wstring &stateFilePath, UpdateCallback updateCallback) :
+	m_stateFilePath(stateFilePath),
+	m_updateCallback(updateCallback),
+	m_threadPool(MAX_CONCURRENT_JOBS)
+{
+}
+
+FileOperationQueue::~FileOperationQueue()
+{
+	{
+		std::scoped_lock lock(m_mutex);
+
+		m_destroying = true;
+
+		for (auto &jobState : m_jobs)
+		{
+			jobState->stopSource.request_stop();
+		}
+	}
+
+	// Running jobs exit as soon as they notice the stop request (even if the throttle is paused).
+	m_threadPool.stop(true);
+}
+
+size_t FileOperationQueue::RestorePendingJobs()
+{
+	auto jobStates = LoadState();
+
+	for (auto &jobState : jobStates)
+	{
+		jobState->diskIds = GetDiskIds(jobState->job);
+	}
+
+	std::scoped_lock lock(m_mutex);
+
+	for (auto &jobState : jobStates)
+	{
+		jobState->job.id = m_nextJobId++;
+		m_jobs.push_back(jobState);
+	}
+
+	StartJobs();
+
+	return jobStates.size();
+}
+
+int FileOperationQueue::AddJob(
+	const std::vector<std::wstring> &sourcePaths, const std::wstring &destinationFolder, bool move)
+{
+	auto jobState = std::make_shared<JobState>();
+	jobState->job.move = move;
+	jobState->job.sourcePaths = sourcePaths;
+	jobState->job.destinationFolder = destinationFolder;
+
+	// Determining the disks may involve querying the devices, so it's done before the lock is
+	// taken.
+	jobState->diskIds = GetDiskIds(jobState->job);
+
+	int id;
+
+	{
+		std::scoped_lock lock(m_mutex);
+
+		id = m_nextJobId++;
+		jobState->job.id = id;
+		m_jobs.push_back(jobState);
+
+		StartJobs();
+		SaveState();
+	}
+
+	NotifyUpdate();
+
+	return id;
+}
+
+void FileOperationQueue::CancelJob(int id)
+{
+	{
+		std::scoped_lock lock(m_mutex);
+
+		auto itr = std::find_if(m_jobs.begin(), m_jobs.end(),
+			[id](const auto &jobState) { return jobState->job.id == id; });
+
+		if (itr == m_jobs.end())
+		{
+			return;
+		}
+
+		auto jobState = *itr;
+
+		if (jobState->running)
+		{
+			// The job will be removed once it's stopped.
+			jobState->cancelled = true;
+			jobState->stopSource.request_stop();
+			return;
+		}
+
+		m_jobs.erase(itr);
+
+		// Jobs that were waiting on the same disks may now be able to run.
+		StartJobs();
+		SaveState();
+	}
+
+	NotifyUpdate();
+}
+
+void FileOperationQueue::SetPaused(bool paused)
+{
+	m_throttle.SetPaused(paused);
+	NotifyUpdate();
+}
+
+bool FileOperationQueue::IsPaused() const
+{
+	return m_throttle.IsPaused();
+}
+
+void FileOperationQueue::SetBytesPerSecondLimit(ULONGLONG limit)
+{
+	m_throttle.SetBytesPerSecondLimit(limit);
+}
+
+FileOperationQueue::Status FileOperationQueue::GetStatus()
+{
+	m_updatePending = false;
+
+	std::scoped_lock lock(m_mutex);
+
+	Status status = {};
+
+	for (const auto &jobState : m_jobs)
+	{
+		status.numPendingJobs++;
+
+		if (!jobState->running)
+		{
+			continue;
+		}
+
+		status.numRunningJobs++;
+		status.bytesTransferred += jobState->progress.bytesTransferred;
+		status.totalBytes += jobState->progress.totalBytes;
+		status.bytesPerSecond += jobState->progress.bytesPerSecond;
+	}
+
+	return status;
+}
+
+std::vector<FileOperationQueue::FinishedJob> FileOperationQueue::TakeFinishedJobs()
+{
+	std::scoped_lock lock(m_mutex);
+	return std::exchange(m_finishedJobs, {});
+}
+
+std::vector<std::wstring> FileOperationQueue::GetDiskIds(const Job &job)
+{
+	// The source items will generally all be in the same folder, so the disk is only queried once
+	// for each distinct parent folder.
+	std::unordered_set<std::wstring> parentPaths;
+
+	for (const auto &sourcePath : job.sourcePaths)
+	{
+		parentPaths.insert(GetParentPath(sourcePath));
+	}
+
+	parentPaths.insert(job.destinationFolder);
+
+	std::vector<std::wstring> diskIds;
+
+	for (const auto &parentPath : parentPaths)
+	{
+		auto diskId = DiskIoLimiter::GetDiskId(parentPath);
+
+		if (std::find(diskIds.begin(), diskIds.end(), diskId) == diskIds.end())
+		{
+			diskIds.push_back(diskId);
+		}
+	}
+
+	return diskIds;
+}
+
+// Starts each waiting job whose disks aren't in use. A job is also held back if any of its disks are
+// needed by a job earlier in the queue, so that the jobs on a given disk run in the order they were
+// added. Must be called with the mutex held.
+void FileOperationQueue::StartJobs()
+{
+	if (m_destroying)
+	{
+		return;
+	}
+
+	std::unordered_set<std::wstring> claimedDisks;
+
+	for (const auto &jobState : m_jobs)
+	{
+		if (jobState->running)
+		{
+			claimedDisks.insert(jobState->diskIds.begin(), jobState->diskIds.end());
+		}
+	}
+
+	for (auto &jobState : m_jobs)
+	{
+		if (jobState->running)
+		{
+			continue;
+		}
+
+		bool disksAvailable = std::none_of(jobState->diskIds.begin(), jobState->diskIds.end(),
+			[&claimedDisks](const std::wstring &diskId) { return claimedDisks.contains(diskId); });
+
+		claimedDisks.insert(jobState->diskIds.begin(), jobState->diskIds.end());
+
+		if (!disksAvailable)
+		{
+			continue;
+		}
+
+		jobState->running = true;
+
+		m_threadPool.push(
+			[this, jobState](int id)
+			{
+				UNREFERENCED_PARAMETER(id);
+
+				RunJob(jobState);
+			});
+	}
+}
+
+void FileOperationQueue::RunJob(std::shared_ptr<JobState> jobState)
+{
+	bool resume;
+
+	{
+		std::scoped_lock lock(m_mutex);
+
+		// The job may have been cancelled (or the queue destroyed) before it had a chance to
+		// start.
+		if (jobState->stopSource.stop_requested())
+		{
+			OnJobFinished(jobState, HRESULT_FROM_WIN32(ERROR_CANCELLED));
+			return;
+		}
+
+		resume = jobState->started;
+
+		if (!jobState->started)
+		{
+			jobState->started = true;
+			SaveState();
+		}
+	}
+
+	auto progressCallback = [this, jobState](const FileTransferProgress &progress)
+	{
+		{
+			std::scoped_lock lock(m_mutex);
+			jobState->progress = progress;
+		}
+
+		NotifyUpdate();
+	};
+
+	const auto &job = jobState->job;
+	auto stopToken = jobState->stopSource.get_token();
+	HRESULT hr;
+
+	if (resume)
+	{
+		hr = ResumeTransferFiles(job.sourcePaths, job.destinationFolder, job.move, stopToken,
+			progressCallback, &m_throttle);
+	}
+	else
+	{
+		hr = TransferFiles(job.sourcePaths, job.destinationFolder, job.move, stopToken,
+			progressCallback, &m_throttle);
+	}
+
+	std::scoped_lock lock(m_mutex);
+	OnJobFinished(jobState, hr);
+}
+
+// Must be called with the mutex held.
+void FileOperationQueue::OnJobFinished(std::shared_ptr<JobState> jobState, HRESULT result)
+{
+	// Jobs stopped because the queue is being destroyed are left in the state file, so that they
+	// can be resumed later. Cancelled jobs are always removed.
+	if (m_destroying && !jobState->cancelled)
+	{
+		return;
+	}
+
+	m_jobs.remove(jobState);
+
+	if (!jobState->cancelled)
+	{
+		m_finishedJobs.push_back({ jobState->job, result });
+	}
+
+	StartJobs();
+	SaveState();
+
+	if (!m_destroying)
+	{
+		NotifyUpdate();
+	}
+}
+
+void FileOperationQueue::NotifyUpdate()
+{
+	if (!m_updatePending.exchange(true))
+	{
+		m_updateCallback();
+	}
+}
+
+// Must be called with the mutex held.
+void FileOperationQueue::SaveState() const
+{
+	if (m_jobs.empty())
+	{
+		DeleteFile(m_stateFilePath.c_str());
+		return;
+	}
+
+	std::ofstream stream(m_stateFilePath, std::ios::binary | std::ios::trunc);
+
+	if (!stream)
+	{
+		return;
+	}
+
+	WriteValue(stream, FILE_SIGNATURE);
+	WriteValue(stream, FILE_VERSION);
+	WriteValue(stream, static_cast<uint32_t>(m_jobs.size()));
+
+	for (const auto &jobState : m_jobs)
+	{
+		WriteValue(stream, static_cast<uint8_t>(jobState->job.move));
+		WriteValue(stream, static_cast<uint8_t>(jobState->started));
+		WriteString(stream, jobState->job.destinationFolder);
+		WriteValue(stream, static_cast<uint32_t>(jobState->job.sourcePaths.size()));
+
+		for (const auto &sourcePath : jobState->job.sourcePaths)
+		{
+			WriteString(stream, sourcePath);
+		}
+	}
+}
+
+std::vector<std::shared_ptr<FileOperationQueue::JobState>> FileOperationQueue::LoadState() const
+{
+	std::ifstream stream(m_stateFilePath, std::ios::binary);
+
+	if (!stream)
+	{
+		return {};
+	}
+
+	uint32_t signature;
+	uint32_t version;
+	uint32_t numJobs;
+
+	if (!ReadValue(stream, signature) || signature != FILE_SIGNATURE
+		|| !ReadValue(stream, version) || version != FILE_VERSION
+		|| !ReadValue(stream, numJobs) || numJobs > MAX_LOADED_JOBS)
+	{
+		return {};
+	}
+
+	std::vector<std::shared_ptr<JobState>> jobStates;
+
+	for (uint32_t i = 0; i < numJobs; i++)
+	{
+		auto jobState = std::make_shared<JobState>();
+		uint8_t move;
+		uint8_t started;
+		uint32_t numSourcePaths;
+
+		if (!ReadValue(stream, move) || !ReadValue(stream, started)
+			|| !ReadString(stream, jobState->job.destinationFolder)
+			|| !ReadValue(stream, numSourcePaths) || numSourcePaths > MAX_LOADED_SOURCE_PATHS)
+		{
+			return {};
+		}
+
+		jobState->job.move = (move != 0);
+		jobState->started = (started != 0);
+
+		for (uint32_t j = 0; j < numSourcePaths; j++)
+		{
+			std::wstring sourcePath;
+
+			if (!ReadString(stream, sourcePath))
+			{
+				return {};
+			}
+
+			jobState->job.sourcePaths.push_back(std::move(sourcePath));
+		}
+
+		jobStates.push_back(jobState);
+	}
+
+	return jobStates;
+}
\ No newline at end of file
@@ -0,0 +1,138 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "BulkFileTransfer.h"
+#include "../ThirdParty/CTPL/cpl_stl.h"
+#include <atomic>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <vector>
+
+// Runs copy and move operations in the background. Operations that involve the same physical disk
+// are run one at a time, in the order they were added, so that large transfers don't compete with
+// each other for the disk. Operations on separate disks run in parallel.
+//
+// All operations share a single throttle, through which they can be paused and limited to a
+// maximum combined rate. Operations that haven't finished are saved to a file, so that they can be
+// resumed the next time the queue is created.
+class FileOperationQueue
+{
+public:
+	struct Job
+	{
+		int id;
+		bool move;
+		std::vector<std::wstring> sourcePaths;
+		std::wstring destinationFolder;
+	};
+
+	struct FinishedJob
+	{
+		Job job;
+
+		// As with TransferFiles, HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED) indicates that the
+		// operation should be performed by the shell instead.
+		HRESULT result;
+	};
+
+	struct Status
+	{
+		// Includes both the jobs that are running and those that are waiting to run.
+		int numPendingJobs;
+		int numRunningJobs;
+
+		// These cover the running jobs only.
+		ULONGLONG bytesTransferred;
+		ULONGLONG totalBytes;
+		ULONGLONG bytesPerSecond;
+	};
+
+	// Invoked on a background thread when the status of the queue changes, or a job finishes.
+	// Updates are coalesced, so this won't be invoked again until GetStatus() has been called.
+	using UpdateCallback = std::function<void()>;
+
+	FileOperationQueue(const std::wstring &stateFilePath, UpdateCallback updateCallback);
+
+	// Any running jobs are stopped. They remain in the state file, so will be resumed the next
+	// time the queue is created and RestorePendingJobs() is called.
+	~FileOperationQueue();
+
+	// Queues any jobs that were still pending when the queue was last destroyed. Returns the
+	// number of jobs restored.
+	size_t RestorePendingJobs();
+
+	int AddJob(const std::vector<std::wstring> &sourcePaths, const std::wstring &destinationFolder,
+		bool move);
+
+	// If the job is running, it's stopped, with any files copied so far left in place.
+	void CancelJob(int id);
+
+	void SetPaused(bool paused);
+	bool IsPaused() const;
+
+	// A limit of 0 means the rate is unlimited.
+	void SetBytesPerSecondLimit(ULONGLONG limit);
+
+	Status GetStatus();
+
+	// Returns the jobs that have finished (other than those that were cancelled) since this was
+	// last called.
+	std::vector<FinishedJob> TakeFinishedJobs();
+
+private:
+	static constexpr uint32_t FILE_SIGNATURE = 0x51465845; // "EXFQ"
+	static constexpr uint32_t FILE_VERSION = 1;
+
+	// Jobs only run concurrently when they're on different disks, so this is rarely reached.
+	static const int MAX_CONCURRENT_JOBS = 4;
+
+	struct JobState
+	{
+		Job job;
+
+		// The disks containing the source items and the destination folder.
+		std::vector<std::wstring> diskIds;
+
+		// Whether the job had been started at the point the state file was last written. Such a
+		// job may have been partially completed, so needs to be resumed, rather than started
+		// again.
+		bool started = false;
+
+		bool running = false;
+		bool cancelled = false;
+		std::stop_source stopSource;
+		FileTransferProgress progress = {};
+	};
+
+	static std::vector<std::wstring> GetDiskIds(const Job &job);
+
+	void QueueJob(std::shared_ptr<JobState> jobState);
+	void StartJobs();
+	void RunJob(std::shared_ptr<JobState> jobState);
+	void OnJobFinished(std::shared_ptr<JobState> jobState, HRESULT result);
+	void NotifyUpdate();
+
+	void SaveState() const;
+	std::vector<std::shared_ptr<JobState>> LoadState() const;
+
+	const std::wstring m_stateFilePath;
+	const UpdateCallback m_updateCallback;
+	std::atomic<bool> m_updatePending = false;
+
+	FileTransferThrottle m_throttle;
+
+	mutable std::mutex m_mutex;
+	std::list<std::shared_ptr<JobState>> m_jobs;
+	std::vector<FinishedJob> m_finishedJobs;
+	int m_nextJobId = 1;
+	bool m_destroying = false;
+
+	ctpl::thread_pool m_threadPool;
+};
\ No newline at end of file
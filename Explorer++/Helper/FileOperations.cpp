@@ -4,25 +4,194 @@
 
 #include "stdafx.h"
 #include "FileOperations.h"
+#include "BulkFileTransfer.h"
+#include "DataExchangeHelper.h"
 #include "DragDropHelper.h"
 #include "DriveInfo.h"
+#include "FastRandom.h"
+#include "FileHashCache.h"
+#include "FolderComparison.h"
 #include "Helper.h"
 #include "Macros.h"
 #include "ShellHelper.h"
 #include "StringHelper.h"
+#include "TransferItemsSource.h"
+#include "UnbufferedIo.h"
+#include "Utf8FileWriter.h"
 #include "iDataObject.h"
 #include <wil/com.h>
+#include <wil/resource.h>
+#include <winrt/base.h>
+#include <algorithm>
 #include <list>
-#include <sstream>
+#include <optional>
+#include <unordered_map>
 
-enum class PasteType
+enum class DirectoryListingFilter
 {
-	HardLink
+	All,
+	Folders,
+	Files
 };
 
-int PasteFilesFromClipboardSpecial(const TCHAR *szDestination, PasteType pasteType);
 BOOL GetFileClusterSize(const std::wstring &strFilename, PLARGE_INTEGER lpRealFileSize);
 
+namespace
+{
+
+// Not owned. The clipboard holds a reference to this object for as long as it's on the clipboard,
+// so it's only used once OleIsCurrentClipboard() has confirmed that's still the case.
+IDataObject *g_internalClipboardDataObject = nullptr;
+
+}
+uint64_t GenerateRandomSeed();
+HRESULT TransferFilesNatively(HWND hwnd, IShellItem *destinationFolder,
+	const std::vector<PCIDLIST_ABSOLUTE> &pidls, bool move,
+	IFileOperationProgressSink *progressSink);
+wil::com_ptr_nothrow<IProgressDialog> StartModalProgressDialog(
+	HWND hwnd, const std::wstring &title, DWORD flags);
+void UpdateTransferProgressDialog(IProgressDialog *progressDialog,
+	const FileTransferProgress &progress, std::stop_source &stopSource);
+void PumpPendingMessages(std::stop_source &stopSource);
+void EnumerateDirectoryListing(const std::wstring &directory, bool recursive,
+	DirectoryListingFormatter &formatter, DirectoryListingFilter filter);
+std::wstring FormatIso8601DateTime(const FILETIME &fileTime);
+bool RenameFileNatively(const NFileOperations::FileRename &rename);
+std::vector<size_t> RenameFilesUsingFileOperation(
+	const std::vector<NFileOperations::FileRename> &renames, const std::vector<size_t> &indexes);
+
+/* Records which of the items in a rename operation were
+actually renamed. Items are identified by their parsing
+names. */
+class RenameProgressSink :
+	public winrt::implements<RenameProgressSink, IFileOperationProgressSink, winrt::non_agile>
+{
+public:
+	RenameProgressSink(std::unordered_map<std::wstring, size_t> itemIndexes) :
+		m_itemIndexes(std::move(itemIndexes))
+	{
+	}
+
+	const std::vector<size_t> &GetRenamedItems() const
+	{
+		return m_renamedItems;
+	}
+
+	IFACEMETHODIMP PostRenameItem(DWORD flags, IShellItem *item, LPCWSTR newName,
+		HRESULT renameResult, IShellItem *newlyCreated)
+	{
+		UNREFERENCED_PARAMETER(flags);
+		UNREFERENCED_PARAMETER(newName);
+		UNREFERENCED_PARAMETER(newlyCreated);
+
+		if (renameResult != S_OK)
+		{
+			return S_OK;
+		}
+
+		wil::unique_cotaskmem_string parsingName;
+		HRESULT hr = item->GetDisplayName(SIGDN_DESKTOPABSOLUTEPARSING, &parsingName);
+
+		if (FAILED(hr))
+		{
+			return S_OK;
+		}
+
+		auto itr = m_itemIndexes.find(parsingName.get());
+
+		if (itr != m_itemIndexes.end())
+		{
+			m_renamedItems.push_back(itr->second);
+		}
+
+		return S_OK;
+	}
+
+	// The remaining notifications aren't needed.
+	IFACEMETHODIMP StartOperations()
+	{
+		return S_OK;
+	}
+
+	IFACEMETHODIMP FinishOperations(HRESULT)
+	{
+		return S_OK;
+	}
+
+	IFACEMETHODIMP PreRenameItem(DWORD, IShellItem *, LPCWSTR)
+	{
+		return S_OK;
+	}
+
+	IFACEMETHODIMP PreMoveItem(DWORD, IShellItem *, IShellItem *, LPCWSTR)
+	{
+		return S_OK;
+	}
+
+	IFACEMETHODIMP PostMoveItem(DWORD, IShellItem *, IShellItem *, LPCWSTR, HRESULT, IShellItem *)
+	{
+		return S_OK;
+	}
+
+	IFACEMETHODIMP PreCopyItem(DWORD, IShellItem *, IShellItem *, LPCWSTR)
+	{
+		return S_OK;
+	}
+
+	IFACEMETHODIMP PostCopyItem(DWORD, IShellItem *, IShellItem *, LPCWSTR, HRESULT, IShellItem *)
+	{
+		return S_OK;
+	}
+
+	IFACEMETHODIMP PreDeleteItem(DWORD, IShellItem *)
+	{
+		return S_OK;
+	}
+
+	IFACEMETHODIMP PostDeleteItem(DWORD, IShellItem *, HRESULT, IShellItem *)
+	{
+		return S_OK;
+	}
+
+	IFACEMETHODIMP PreNewItem(DWORD, IShellItem *, LPCWSTR)
+	{
+		return S_OK;
+	}
+
+	IFACEMETHODIMP PostNewItem(DWORD, IShellItem *, LPCWSTR, LPCWSTR, DWORD, HRESULT, IShellItem *)
+	{
+		return S_OK;
+	}
+
+	IFACEMETHODIMP UpdateProgress(UINT, UINT)
+	{
+		return S_OK;
+	}
+
+	IFACEMETHODIMP ResetTimer()
+	{
+		return S_OK;
+	}
+
+	IFACEMETHODIMP PauseTimer()
+	{
+		return S_OK;
+	}
+
+	IFACEMETHODIMP ResumeTimer()
+	{
+		return S_OK;
+	}
+
+private:
+	const std::unordered_map<std::wstring, size_t> m_itemIndexes;
+	std::vector<size_t> m_renamedItems;
+};
+
+/* Secure deletion overwrites files in blocks of this size. */
+const size_t SECURE_DELETE_BUFFER_SIZE = 4 * 1024 * 1024;
+const int SECURE_DELETE_NUM_BUFFERS = 2;
+
 HRESULT NFileOperations::RenameFile(IShellItem *item, const std::wstring &newName)
 {
 	wil::com_ptr_nothrow<IFileOperation> fo;
@@ -52,6 +221,133 @@ HRESULT NFileOperations::RenameFile(IShellItem *item, const std::wstring &newNam
 	return hr;
 }
 
+std::vector<size_t> NFileOperations::RenameFiles(const std::vector<FileRename> &renames)
+{
+	std::vector<size_t> renamedItems;
+	std::vector<size_t> remainingItems;
+
+	for (size_t i = 0; i < renames.size(); i++)
+	{
+		if (RenameFileNatively(renames[i]))
+		{
+			renamedItems.push_back(i);
+		}
+		else
+		{
+			remainingItems.push_back(i);
+		}
+	}
+
+	if (!remainingItems.empty())
+	{
+		auto otherRenamedItems = RenameFilesUsingFileOperation(renames, remainingItems);
+		renamedItems.insert(renamedItems.end(), otherRenamedItems.begin(), otherRenamedItems.end());
+		std::sort(renamedItems.begin(), renamedItems.end());
+	}
+
+	return renamedItems;
+}
+
+/* Renames a file system item directly, which is much faster
+than going through IFileOperation when there are a large
+number of items. Returns false if the item isn't in the
+file system, or couldn't be renamed directly. */
+bool RenameFileNatively(const NFileOperations::FileRename &rename)
+{
+	DWORD attributes = GetFileAttributes(rename.path.c_str());
+
+	if (attributes == INVALID_FILE_ATTRIBUTES)
+	{
+		return false;
+	}
+
+	std::wstring newPath(rename.path.c_str(), PathFindFileName(rename.path.c_str()));
+	newPath += rename.newName;
+
+	if (!MoveFileEx(rename.path.c_str(), newPath.c_str(), 0))
+	{
+		return false;
+	}
+
+	LONG eventId =
+		WI_IsFlagSet(attributes, FILE_ATTRIBUTE_DIRECTORY) ? SHCNE_RENAMEFOLDER : SHCNE_RENAMEITEM;
+	SHChangeNotify(eventId, SHCNF_PATH, rename.path.c_str(), newPath.c_str());
+
+	return true;
+}
+
+/* Renames the specified items in a single operation, rather
+than performing a separate operation for each item. */
+std::vector<size_t> RenameFilesUsingFileOperation(
+	const std::vector<NFileOperations::FileRename> &renames, const std::vector<size_t> &indexes)
+{
+	wil::com_ptr_nothrow<IFileOperation> fo;
+	HRESULT hr = CoCreateInstance(CLSID_FileOperation, nullptr, CLSCTX_ALL, IID_PPV_ARGS(&fo));
+
+	if (FAILED(hr))
+	{
+		return {};
+	}
+
+	hr = fo->SetOperationFlags(FOF_ALLOWUNDO | FOF_SILENT);
+
+	if (FAILED(hr))
+	{
+		return {};
+	}
+
+	std::unordered_map<std::wstring, size_t> itemIndexes;
+
+	for (size_t index : indexes)
+	{
+		wil::com_ptr_nothrow<IShellItem> shellItem;
+		hr = SHCreateItemFromParsingName(
+			renames[index].path.c_str(), nullptr, IID_PPV_ARGS(&shellItem));
+
+		if (FAILED(hr))
+		{
+			continue;
+		}
+
+		wil::unique_cotaskmem_string parsingName;
+		hr = shellItem->GetDisplayName(SIGDN_DESKTOPABSOLUTEPARSING, &parsingName);
+
+		if (FAILED(hr))
+		{
+			continue;
+		}
+
+		hr = fo->RenameItem(shellItem.get(), renames[index].newName.c_str(), nullptr);
+
+		if (FAILED(hr))
+		{
+			continue;
+		}
+
+		itemIndexes.emplace(parsingName.get(), index);
+	}
+
+	if (itemIndexes.empty())
+	{
+		return {};
+	}
+
+	auto progressSink = winrt::make_self<RenameProgressSink>(std::move(itemIndexes));
+
+	DWORD cookie;
+	hr = fo->Advise(progressSink.get(), &cookie);
+
+	if (FAILED(hr))
+	{
+		return {};
+	}
+
+	fo->PerformOperations();
+	fo->Unadvise(cookie);
+
+	return progressSink->GetRenamedItems();
+}
+
 HRESULT NFileOperations::DeleteFiles(
 	HWND hwnd, std::vector<PCIDLIST_ABSOLUTE> &pidls, bool permanent, bool silent)
 {
@@ -125,8 +421,9 @@ HRESULT NFileOperations::DeleteFiles(
 	return hr;
 }
 
-HRESULT NFileOperations::CopyFilesToFolder(
-	HWND hOwner, const std::wstring &strTitle, std::vector<PCIDLIST_ABSOLUTE> &pidls, bool move)
+HRESULT NFileOperations::CopyFilesToFolder(HWND hOwner, const std::wstring &strTitle,
+	std::vector<PCIDLIST_ABSOLUTE> &pidls, bool move, bool useNativeTransfer,
+	IFileOperationProgressSink *progressSink)
 {
 	unique_pidl_absolute pidl;
 	BOOL bRes = NFileOperations::CreateBrowseDialog(hOwner, strTitle, wil::out_param(pidl));
@@ -144,22 +441,47 @@ HRESULT NFileOperations::CopyFilesToFolder(
 		return E_FAIL;
 	}
 
-	hr = CopyFiles(hOwner, destinationFolder.get(), pidls, move);
+	hr = CopyFiles(hOwner, destinationFolder.get(), pidls, move, useNativeTransfer, progressSink);
 
 	return hr;
 }
 
-HRESULT NFileOperations::CopyFiles(
-	HWND hwnd, IShellItem *destinationFolder, std::vector<PCIDLIST_ABSOLUTE> &pidls, bool move)
+HRESULT NFileOperations::CopyFiles(HWND hwnd, IShellItem *destinationFolder,
+	std::vector<PCIDLIST_ABSOLUTE> &pidls, bool move, bool useNativeTransfer,
+	IFileOperationProgressSink *progressSink)
 {
+	HRESULT hr;
+
+	if (useNativeTransfer)
+	{
+		hr = TransferFilesNatively(hwnd, destinationFolder, pidls, move, progressSink);
+
+		if (hr != HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED))
+		{
+			return hr;
+		}
+	}
+
 	wil::com_ptr_nothrow<IFileOperation> fo;
-	HRESULT hr = CoCreateInstance(CLSID_FileOperation, nullptr, CLSCTX_ALL, IID_PPV_ARGS(&fo));
+	hr = CoCreateInstance(CLSID_FileOperation, nullptr, CLSCTX_ALL, IID_PPV_ARGS(&fo));
 
 	if (FAILED(hr))
 	{
 		return hr;
 	}
 
+	DWORD cookie = 0;
+
+	if (progressSink)
+	{
+		hr = fo->Advise(progressSink, &cookie);
+
+		if (FAILED(hr))
+		{
+			return hr;
+		}
+	}
+
 	hr = fo->SetOwnerWindow(hwnd);
 
 	if (FAILED(hr))
@@ -207,27 +529,280 @@ HRESULT NFileOperations::CopyFiles(
 
 	hr = fo->PerformOperations();
 
+	if (progressSink)
+	{
+		fo->Unadvise(cookie);
+	}
+
 	return hr;
 }
 
+/* Returns HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED) if the
+transfer should instead be performed by IFileOperation. */
+HRESULT TransferFilesNatively(HWND hwnd, IShellItem *destinationFolder,
+	const std::vector<PCIDLIST_ABSOLUTE> &pidls, bool move,
+	IFileOperationProgressSink *progressSink)
+{
+	wil::unique_cotaskmem_string destinationPath;
+	HRESULT hr = destinationFolder->GetDisplayName(SIGDN_FILESYSPATH, &destinationPath);
+
+	if (FAILED(hr))
+	{
+		return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+	}
+
+	std::vector<std::wstring> sourcePaths;
+
+	for (auto pidl : pidls)
+	{
+		TCHAR sourcePath[MAX_PATH];
+
+		if (!SHGetPathFromIDList(pidl, sourcePath))
+		{
+			return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+		}
+
+		sourcePaths.emplace_back(sourcePath);
+	}
+
+	auto progressDialog = StartModalProgressDialog(hwnd, destinationPath.get(), 0);
+
+	if (progressSink)
+	{
+		progressSink->StartOperations();
+	}
+
+	std::stop_source stopSource;
+
+	hr = TransferFiles(sourcePaths, destinationPath.get(), move, stopSource.get_token(),
+		[&progressDialog, progressSink, &stopSource](const FileTransferProgress &progress) {
+			UpdateTransferProgressDialog(progressDialog.get(), progress, stopSource);
+
+			if (progressSink && !progress.enumerating && progress.totalBytes > 0)
+			{
+				/* The work values are only 32 bits wide, so the
+				progress is reported in fractional units. */
+				const UINT workTotal = 10000;
+				progressSink->UpdateProgress(workTotal,
+					static_cast<UINT>(progress.bytesTransferred * workTotal / progress.totalBytes));
+			}
+
+			PumpPendingMessages(stopSource);
+		});
+
+	if (progressSink)
+	{
+		progressSink->FinishOperations(hr);
+	}
+
+	if (progressDialog)
+	{
+		progressDialog->StopProgressDialog();
+	}
+
+	return hr;
+}
+
+HRESULT NFileOperations::CompareFolders(HWND hwnd, const std::wstring &sourceFolder,
+	const std::wstring &destinationFolder, const FolderComparisonOptions &options,
+	std::vector<FolderDifference> &differences)
+{
+	/* The number of items that remain to be compared isn't
+	known in advance, so there's no meaningful way to show
+	how far through the comparison is. */
+	auto progressDialog =
+		StartModalProgressDialog(hwnd, destinationFolder, PROGDLG_MARQUEEPROGRESS);
+
+	std::stop_source stopSource;
+
+	HRESULT hr = ::CompareFolders(sourceFolder, destinationFolder, options, differences,
+		stopSource.get_token(), [&progressDialog, &stopSource](int itemsCompared) {
+			if (progressDialog)
+			{
+				if (progressDialog->HasUserCancelled())
+				{
+					stopSource.request_stop();
+				}
+
+				progressDialog->SetLine(
+					2, std::to_wstring(itemsCompared).c_str(), FALSE, nullptr);
+			}
+
+			PumpPendingMessages(stopSource);
+		});
+
+	if (progressDialog)
+	{
+		progressDialog->StopProgressDialog();
+	}
+
+	return hr;
+}
+
+HRESULT NFileOperations::CopyFolderDifferences(HWND hwnd, const std::wstring &sourceFolder,
+	const std::wstring &destinationFolder, const std::vector<FolderDifference> &differences)
+{
+	auto progressDialog = StartModalProgressDialog(hwnd, destinationFolder, 0);
+
+	std::stop_source stopSource;
+
+	HRESULT hr = ::CopyFolderDifferences(sourceFolder, destinationFolder, differences,
+		stopSource.get_token(),
+		[&progressDialog, &stopSource](const FileTransferProgress &progress) {
+			UpdateTransferProgressDialog(progressDialog.get(), progress, stopSource);
+			PumpPendingMessages(stopSource);
+		});
+
+	if (progressDialog)
+	{
+		progressDialog->StopProgressDialog();
+	}
+
+	return hr;
+}
+
+HRESULT NFileOperations::CalculateFileHashes(HWND hwnd, const std::wstring &title,
+	const std::vector<std::wstring> &paths, std::vector<std::optional<FileHash>> &hashes)
+{
+	auto progressDialog = StartModalProgressDialog(hwnd, title, 0);
+
+	std::stop_source stopSource;
+
+	hashes = FileHashCache::GetInstance().GetFileHashes(paths, stopSource.get_token(),
+		[&progressDialog, &stopSource, &paths](int numFilesHashed) {
+			if (progressDialog)
+			{
+				if (progressDialog->HasUserCancelled())
+				{
+					stopSource.request_stop();
+				}
+
+				std::wstring status =
+					std::to_wstring(numFilesHashed) + L" / " + std::to_wstring(paths.size());
+				progressDialog->SetLine(2, status.c_str(), FALSE, nullptr);
+				progressDialog->SetProgress64(numFilesHashed, paths.size());
+			}
+
+			PumpPendingMessages(stopSource);
+		});
+
+	if (progressDialog)
+	{
+		progressDialog->StopProgressDialog();
+	}
+
+	if (stopSource.stop_requested())
+	{
+		return HRESULT_FROM_WIN32(ERROR_CANCELLED);
+	}
+
+	return S_OK;
+}
+
+/* The progress dialog runs on its own thread, so it remains
+responsive while the operation is in progress. */
+wil::com_ptr_nothrow<IProgressDialog> StartModalProgressDialog(
+	HWND hwnd, const std::wstring &title, DWORD flags)
+{
+	wil::com_ptr_nothrow<IProgressDialog> progressDialog;
+	HRESULT hr = CoCreateInstance(
+		CLSID_ProgressDialog, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&progressDialog));
+
+	if (FAILED(hr))
+	{
+		return nullptr;
+	}
+
+	progressDialog->SetLine(1, title.c_str(), TRUE, nullptr);
+	progressDialog->StartProgressDialog(hwnd, nullptr,
+		PROGDLG_MODAL | PROGDLG_AUTOTIME | PROGDLG_NOMINIMIZE | flags, nullptr);
+
+	return progressDialog;
+}
+
+void UpdateTransferProgressDialog(IProgressDialog *progressDialog,
+	const FileTransferProgress &progress, std::stop_source &stopSource)
+{
+	if (!progressDialog)
+	{
+		return;
+	}
+
+	if (progressDialog->HasUserCancelled())
+	{
+		stopSource.request_stop();
+	}
+
+	ULARGE_INTEGER bytesPerSecond;
+	bytesPerSecond.QuadPart = progress.bytesPerSecond;
+
+	TCHAR speed[32];
+	FormatSizeString(bytesPerSecond, speed, SIZEOF_ARRAY(speed));
+
+	std::wstring status = std::to_wstring(progress.filesTransferred) + L" / "
+		+ std::to_wstring(progress.totalFiles);
+
+	if (!progress.enumerating)
+	{
+		status += L" (" + std::wstring(speed) + L"/s)";
+	}
+
+	progressDialog->SetLine(2, status.c_str(), FALSE, nullptr);
+	progressDialog->SetProgress64(progress.bytesTransferred, progress.totalBytes);
+}
+
+/* Long-running operations report progress on the UI thread,
+which would otherwise stop responding until the operation is
+complete. Since the progress dialog is modal, the only input
+that can be received is directed at the dialog itself. */
+void PumpPendingMessages(std::stop_source &stopSource)
+{
+	MSG msg;
+
+	while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
+	{
+		if (msg.message == WM_QUIT)
+		{
+			stopSource.request_stop();
+			PostQuitMessage(static_cast<int>(msg.wParam));
+			break;
+		}
+
+		TranslateMessage(&msg);
+		DispatchMessage(&msg);
+	}
+}
+
 TCHAR *NFileOperations::BuildFilenameList(const std::list<std::wstring> &FilenameList)
 {
-	TCHAR *pszFilenames = nullptr;
-	int iTotalSize = 0;
+	/* The buffer is sized up front, rather than being grown
+	for each filename, since growing it would result in the
+	existing contents being copied repeatedly. */
+	size_t totalSize = 0;
 
 	for (const auto &filename : FilenameList)
 	{
-		pszFilenames = reinterpret_cast<TCHAR *>(
-			realloc(pszFilenames, (iTotalSize + filename.size() + 1) * sizeof(TCHAR)));
-		memcpy(pszFilenames + iTotalSize, filename.c_str(), (filename.size() + 1) * sizeof(TCHAR));
-		iTotalSize += static_cast<int>(filename.size() + 1);
+		totalSize += filename.size() + 1;
 	}
 
 	/* The list of strings must end with a second
-	terminating NULL character, so add it now. */
-	pszFilenames =
-		reinterpret_cast<TCHAR *>(realloc(pszFilenames, (iTotalSize + 1) * sizeof(TCHAR)));
-	pszFilenames[iTotalSize] = '\0';
+	terminating NULL character. */
+	TCHAR *pszFilenames = reinterpret_cast<TCHAR *>(malloc((totalSize + 1) * sizeof(TCHAR)));
+
+	if (!pszFilenames)
+	{
+		return nullptr;
+	}
+
+	size_t offset = 0;
+
+	for (const auto &filename : FilenameList)
+	{
+		memcpy(pszFilenames + offset, filename.c_str(), (filename.size() + 1) * sizeof(TCHAR));
+		offset += filename.size() + 1;
+	}
+
+	pszFilenames[offset] = '\0';
 
 	/* Note that it is up to the caller to free this. */
 	return pszFilenames;
@@ -266,10 +841,29 @@ HRESULT NFileOperations::CreateNewFolder(IShellItem *destinationFolder,
 	return hr;
 }
 
-BOOL NFileOperations::SaveDirectoryListing(
-	const std::wstring &strDirectory, const std::wstring &strFilename)
+BOOL NFileOperations::SaveDirectoryListing(const std::wstring &strDirectory,
+	const std::wstring &strFilename, DirectoryListingFormatter::Format format, bool recursive)
 {
-	std::wstring strContents = _T("Directory\r\n---------\r\n") + strDirectory + _T("\r\n\r\n");
+	wil::unique_hfile file(CreateFile(strFilename.c_str(), FILE_WRITE_DATA, 0, nullptr,
+		CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+
+	if (!file)
+	{
+		return FALSE;
+	}
+
+	Utf8FileWriter writer(file.get());
+
+	/* JSON text shouldn't start with a BOM (RFC 8259), whereas
+	some applications (e.g. Excel) need one to correctly identify
+	the encoding of a CSV file. */
+	if (format != DirectoryListingFormatter::Format::Json)
+	{
+		writer.WriteByteOrderMark();
+	}
+
+	DirectoryListingFormatter formatter(
+		format, [&writer](std::wstring_view text) { writer.Write(text); });
 
 	SYSTEMTIME st;
 	FILETIME ft;
@@ -280,121 +874,169 @@ BOOL NFileOperations::SaveDirectoryListing(
 
 	TCHAR szTime[128];
 	CreateFileTimeString(&lft, szTime, SIZEOF_ARRAY(szTime), FALSE);
-	strContents += _T("Date\r\n----\r\n") + std::wstring(szTime) + _T("\r\n\r\n");
 
-	std::wstring strSearch = strDirectory + _T("\\*");
+	formatter.Begin(strDirectory, szTime);
 
-	WIN32_FIND_DATA wfd;
-	HANDLE hFirstFile = FindFirstFile(strSearch.c_str(), &wfd);
+	if (DirectoryListingFormatter::UsesSections(format))
+	{
+		formatter.BeginSection(DirectoryListingFormatter::Section::Folders);
+		EnumerateDirectoryListing(
+			strDirectory, recursive, formatter, DirectoryListingFilter::Folders);
+
+		formatter.BeginSection(DirectoryListingFormatter::Section::Files);
+		EnumerateDirectoryListing(
+			strDirectory, recursive, formatter, DirectoryListingFilter::Files);
+	}
+	else
+	{
+		EnumerateDirectoryListing(strDirectory, recursive, formatter, DirectoryListingFilter::All);
+	}
 
-	std::list<std::wstring> folderList;
-	std::list<std::wstring> fileList;
-	ULARGE_INTEGER ulTotalSize;
+	formatter.End();
 
-	ulTotalSize.QuadPart = 0;
+	return writer.Flush();
+}
+
+BOOL NFileOperations::SaveTextFileAtomically(
+	const std::wstring &strFilename, std::wstring_view text)
+{
+	std::wstring tempFilename = strFilename + L".tmp";
 
-	if (hFirstFile != INVALID_HANDLE_VALUE)
 	{
-		ULARGE_INTEGER ulFileSize;
+		wil::unique_hfile file(CreateFile(tempFilename.c_str(), FILE_WRITE_DATA, 0, nullptr,
+			CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
 
-		if (lstrcmpi(wfd.cFileName, _T(".")) != 0 && lstrcmpi(wfd.cFileName, _T("..")) != 0)
+		if (!file)
 		{
-			if ((wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == FILE_ATTRIBUTE_DIRECTORY)
-			{
-				folderList.emplace_back(wfd.cFileName);
-			}
-			else
-			{
-				fileList.emplace_back(wfd.cFileName);
+			return FALSE;
+		}
 
-				ulFileSize.LowPart = wfd.nFileSizeLow;
-				ulFileSize.HighPart = wfd.nFileSizeHigh;
+		Utf8FileWriter writer(file.get());
+		writer.Write(text);
 
-				ulTotalSize.QuadPart += ulFileSize.QuadPart;
-			}
+		if (!writer.Flush() || !FlushFileBuffers(file.get()))
+		{
+			file.reset();
+			DeleteFile(tempFilename.c_str());
+			return FALSE;
 		}
+	}
 
-		while (FindNextFile(hFirstFile, &wfd) != 0)
-		{
-			if (lstrcmpi(wfd.cFileName, _T(".")) != 0 && lstrcmpi(wfd.cFileName, _T("..")) != 0)
-			{
-				if ((wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == FILE_ATTRIBUTE_DIRECTORY)
-				{
-					folderList.emplace_back(wfd.cFileName);
-				}
-				else
-				{
-					fileList.emplace_back(wfd.cFileName);
+	BOOL res = MoveFileEx(tempFilename.c_str(), strFilename.c_str(),
+		MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
 
-					ulFileSize.LowPart = wfd.nFileSizeLow;
-					ulFileSize.HighPart = wfd.nFileSizeHigh;
+	if (!res)
+	{
+		DeleteFile(tempFilename.c_str());
+	}
 
-					ulTotalSize.QuadPart += ulFileSize.QuadPart;
-				}
-			}
-		}
+	return res;
+}
 
-		FindClose(hFirstFile);
-	}
+/* Passes each item within the directory to the formatter as it's
+found, rather than building up a list first. Subfolders are walked
+using an explicit stack, so that the depth of the hierarchy doesn't
+affect the depth of the call stack. */
+void EnumerateDirectoryListing(const std::wstring &directory, bool recursive,
+	DirectoryListingFormatter &formatter, DirectoryListingFilter filter)
+{
+	struct Frame
+	{
+		wil::unique_hfind find;
+		std::wstring relativePath;
+	};
 
-	std::wstringstream ss;
-	ss.imbue(std::locale(""));
-	ss.precision(0);
+	std::vector<Frame> stack;
+	stack.push_back({ wil::unique_hfind(), L"" });
 
-	strContents += _T("Statistics\r\n----------\r\n");
+	bool openFrame = true;
+	WIN32_FIND_DATA wfd;
+	std::wstring path;
 
-	ss << std::fixed << folderList.size();
-	strContents += _T("Number of folders: ") + ss.str() + std::wstring(_T("\r\n"));
+	while (!stack.empty())
+	{
+		Frame &frame = stack.back();
+		BOOL found;
 
-	ss.str(_T(""));
-	ss << std::fixed << fileList.size();
-	strContents += _T("Number of files: ") + ss.str() + std::wstring(_T("\r\n"));
+		if (openFrame)
+		{
+			std::wstring search = directory;
 
-	TCHAR szTotalSize[32];
-	FormatSizeString(ulTotalSize, szTotalSize, SIZEOF_ARRAY(szTotalSize));
-	strContents += _T("Total size (not including subfolders): ") + std::wstring(szTotalSize)
-		+ std::wstring(_T("\r\n"));
+			if (!frame.relativePath.empty())
+			{
+				search += L"\\" + frame.relativePath;
+			}
 
-	strContents += _T("\r\nFolders\r\n-------\r\n");
+			search += L"\\*";
 
-	for (const auto &folder : folderList)
-	{
-		strContents += folder + _T("\r\n");
-	}
+			/* FindExInfoBasic skips retrieving the short name of each
+			item and FIND_FIRST_EX_LARGE_FETCH uses a larger buffer
+			for each directory query. Neither is supported prior
+			to Windows 7. */
+			frame.find.reset(FindFirstFileEx(search.c_str(), FindExInfoBasic, &wfd,
+				FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH));
+			found = static_cast<bool>(frame.find);
+			openFrame = false;
+		}
+		else
+		{
+			found = FindNextFile(frame.find.get(), &wfd);
+		}
 
-	strContents += _T("\r\nFiles\r\n-----\r\n");
+		if (!found)
+		{
+			stack.pop_back();
+			continue;
+		}
 
-	for (const auto &file : fileList)
-	{
-		strContents += file + _T("\r\n");
-	}
+		if (lstrcmp(wfd.cFileName, _T(".")) == 0 || lstrcmp(wfd.cFileName, _T("..")) == 0)
+		{
+			continue;
+		}
 
-	/* Remove the trailing newline. */
-	strContents = strContents.substr(0, strContents.size() - 2);
+		bool isFolder = (wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
 
-	HANDLE hFile = CreateFile(strFilename.c_str(), FILE_WRITE_DATA, 0, nullptr, CREATE_ALWAYS,
-		FILE_ATTRIBUTE_NORMAL, nullptr);
+		path = frame.relativePath.empty() ? wfd.cFileName
+										  : frame.relativePath + L"\\" + wfd.cFileName;
 
-	if (hFile != INVALID_HANDLE_VALUE)
-	{
-		DWORD nBytesWritten;
+		if (filter == DirectoryListingFilter::All
+			|| (filter == DirectoryListingFilter::Folders) == isFolder)
+		{
+			ULARGE_INTEGER fileSize;
+			fileSize.LowPart = wfd.nFileSizeLow;
+			fileSize.HighPart = wfd.nFileSizeHigh;
 
-		/* Write out the BOM for UTF-16 LE data.
-		See http://en.wikipedia.org/wiki/Byte-order_mark */
-		WriteFile(hFile, reinterpret_cast<LPCVOID>("\xFF\xFE"), 2, &nBytesWritten, nullptr);
+			std::wstring dateModified = FormatIso8601DateTime(wfd.ftLastWriteTime);
 
-		WriteFile(hFile, reinterpret_cast<LPCVOID>(strContents.c_str()),
-			static_cast<DWORD>(strContents.size() * sizeof(WCHAR)), &nBytesWritten, nullptr);
+			formatter.AddEntry({ path, isFolder, fileSize.QuadPart, dateModified });
+		}
 
-		if (nBytesWritten == strContents.size())
+		/* Junctions and symbolic links aren't followed, since they
+		can form cycles. */
+		if (recursive && isFolder
+			&& (wfd.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) == 0)
 		{
-			return TRUE;
+			/* Note that this invalidates the frame reference. */
+			stack.push_back({ wil::unique_hfind(), path });
+			openFrame = true;
 		}
+	}
+}
+
+std::wstring FormatIso8601DateTime(const FILETIME &fileTime)
+{
+	SYSTEMTIME st;
 
-		CloseHandle(hFile);
+	if (!FileTimeToSystemTime(&fileTime, &st))
+	{
+		return {};
 	}
 
-	return FALSE;
+	TCHAR dateTime[32];
+	StringCchPrintf(dateTime, SIZEOF_ARRAY(dateTime), _T("%04u-%02u-%02uT%02u:%02u:%02uZ"),
+		st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute, st.wSecond);
+
+	return dateTime;
 }
 
 HRESULT CopyFiles(const std::vector<PCIDLIST_ABSOLUTE> &items, IDataObject **dataObjectOut)
@@ -411,7 +1053,18 @@ HRESULT CopyFilesToClipboard(
 	const std::vector<PCIDLIST_ABSOLUTE> &items, bool move, IDataObject **dataObjectOut)
 {
 	wil::com_ptr_nothrow<IDataObject> dataObject;
-	RETURN_IF_FAILED(CreateDataObjectForShellTransfer(items, &dataObject));
+
+	// The shell's data object builds all of its formats when it's created, which takes a
+	// noticeable amount of time once there are a large number of items. In that case, the data is
+	// built in the background instead.
+	if (items.size() >= DELAYED_RENDER_ITEM_THRESHOLD)
+	{
+		RETURN_IF_FAILED(CreateDelayedRenderDataObjectForShellTransfer(items, &dataObject));
+	}
+	else
+	{
+		RETURN_IF_FAILED(CreateDataObjectForShellTransfer(items, &dataObject));
+	}
 
 	DWORD effect = move ? DROPEFFECT_MOVE : DROPEFFECT_COPY;
 
@@ -424,78 +1077,152 @@ HRESULT CopyFilesToClipboard(
 
 	RETURN_IF_FAILED(OleSetClipboard(dataObject.get()));
 
+	g_internalClipboardDataObject = dataObject.get();
+
 	*dataObjectOut = dataObject.detach();
 
 	return S_OK;
 }
 
-int PasteHardLinks(const TCHAR *szDestination)
+IDataObject *GetInternalClipboardDataObject()
 {
-	return PasteFilesFromClipboardSpecial(szDestination, PasteType::HardLink);
+	if (!g_internalClipboardDataObject
+		|| OleIsCurrentClipboard(g_internalClipboardDataObject) != S_OK)
+	{
+		return nullptr;
+	}
+
+	return g_internalClipboardDataObject;
 }
 
-/* TODO: Use CDropHandler. */
-int PasteFilesFromClipboardSpecial(const TCHAR *szDestination, PasteType pasteType)
+std::optional<InternalTransfer> GetInternalTransfer(
+	IDataObject *dataObject, PCIDLIST_ABSOLUTE destination)
 {
-	IDataObject *clipboardObject = nullptr;
-	DROPFILES *pdf = nullptr;
-	FORMATETC ftc;
-	STGMEDIUM stg;
-	HRESULT hr;
-	TCHAR szFileName[MAX_PATH];
-	TCHAR szLinkFileName[MAX_PATH];
-	TCHAR szOldFileName[MAX_PATH];
-	int nFilesCopied = -1;
-	int i = 0;
+	wil::com_ptr_nothrow<ITransferItemsSource> transferItemsSource;
+	HRESULT hr = dataObject->QueryInterface(IID_PPV_ARGS(&transferItemsSource));
 
-	hr = OleGetClipboard(&clipboardObject);
+	if (FAILED(hr))
+	{
+		return std::nullopt;
+	}
 
-	if (SUCCEEDED(hr))
+	const auto &items = transferItemsSource->GetTransferItems();
+
+	if (items.empty())
 	{
-		ftc.cfFormat = CF_HDROP;
-		ftc.ptd = nullptr;
-		ftc.dwAspect = DVASPECT_CONTENT;
-		ftc.lindex = -1;
-		ftc.tymed = TYMED_HGLOBAL;
+		return std::nullopt;
+	}
 
-		hr = clipboardObject->GetData(&ftc, &stg);
+	TCHAR destinationFolder[MAX_PATH];
 
-		if (SUCCEEDED(hr))
+	if (!SHGetPathFromIDList(destination, destinationFolder))
+	{
+		return std::nullopt;
+	}
+
+	InternalTransfer transfer;
+	transfer.destinationFolder = destinationFolder;
+	transfer.sourcePaths.reserve(items.size());
+
+	for (const auto &item : items)
+	{
+		// Transferring a folder into itself (or one of its subfolders), or an item into the folder
+		// it's already in, is left to the shell, which will either reject the transfer or
+		// generate new names for the copies.
+		if (ILIsParent(item.get(), destination, FALSE)
+			|| ILIsParent(destination, item.get(), TRUE))
 		{
-			pdf = (DROPFILES *) GlobalLock(stg.hGlobal);
+			return std::nullopt;
+		}
 
-			if (pdf != nullptr)
-			{
-				nFilesCopied = DragQueryFile((HDROP) pdf, 0xFFFFFFFF, nullptr, 0);
+		TCHAR sourcePath[MAX_PATH];
 
-				for (i = 0; i < nFilesCopied; i++)
-				{
-					DragQueryFile((HDROP) pdf, i, szOldFileName, SIZEOF_ARRAY(szOldFileName));
+		if (!SHGetPathFromIDList(item.get(), sourcePath))
+		{
+			return std::nullopt;
+		}
+
+		transfer.sourcePaths.emplace_back(sourcePath);
+	}
 
-					StringCchCopy(szLinkFileName, SIZEOF_ARRAY(szLinkFileName), szDestination);
+	return transfer;
+}
 
-					StringCchCopy(szFileName, SIZEOF_ARRAY(szFileName), szOldFileName);
-					PathStripPath(szFileName);
+HRESULT PasteHardLinks(HWND hwnd, const std::wstring &destination)
+{
+	return PasteLinks(hwnd, destination, LinkType::HardLink);
+}
 
-					PathAppend(szLinkFileName, szFileName);
+HRESULT PasteLinks(HWND hwnd, const std::wstring &destination, LinkType linkType)
+{
+	wil::com_ptr_nothrow<IDataObject> clipboardObject;
+	RETURN_IF_FAILED(OleGetClipboard(&clipboardObject));
+
+	auto targetPaths = ExtractDroppedFilesList(clipboardObject.get());
 
-					switch (pasteType)
-					{
-					case PasteType::HardLink:
-						CreateHardLink(szLinkFileName, szOldFileName, nullptr);
-						break;
-					}
+	if (targetPaths.empty())
+	{
+		return S_FALSE;
+	}
+
+	/* As with native transfers, the links are created on
+	this thread (with help from the shared worker threads),
+	while messages are pumped from the progress callback. */
+	wil::com_ptr_nothrow<IProgressDialog> progressDialog;
+	HRESULT hr = CoCreateInstance(
+		CLSID_ProgressDialog, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&progressDialog));
+
+	if (SUCCEEDED(hr))
+	{
+		progressDialog->SetLine(1, destination.c_str(), TRUE, nullptr);
+		progressDialog->StartProgressDialog(
+			hwnd, nullptr, PROGDLG_MODAL | PROGDLG_AUTOTIME | PROGDLG_NOMINIMIZE, nullptr);
+	}
+
+	std::stop_source stopSource;
+
+	auto result = CreateLinks(targetPaths, destination, linkType, stopSource.get_token(),
+		[&progressDialog, &stopSource](const LinkCreationProgress &progress) {
+			if (progressDialog)
+			{
+				if (progressDialog->HasUserCancelled())
+				{
+					stopSource.request_stop();
 				}
 
-				GlobalUnlock(stg.hGlobal);
+				std::wstring status = std::to_wstring(progress.itemsProcessed) + L" / "
+					+ std::to_wstring(progress.totalItems);
+				progressDialog->SetLine(2, status.c_str(), FALSE, nullptr);
+				progressDialog->SetProgress64(progress.itemsProcessed, progress.totalItems);
 			}
 
-			ReleaseStgMedium(&stg);
-		}
-		clipboardObject->Release();
+			MSG msg;
+
+			while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
+			{
+				if (msg.message == WM_QUIT)
+				{
+					stopSource.request_stop();
+					PostQuitMessage(static_cast<int>(msg.wParam));
+					break;
+				}
+
+				TranslateMessage(&msg);
+				DispatchMessage(&msg);
+			}
+		});
+
+	if (progressDialog)
+	{
+		progressDialog->StopProgressDialog();
+	}
+
+	if (result.itemsFailed > 0)
+	{
+		return HRESULT_FROM_WIN32(result.firstError);
 	}
 
-	return nFilesCopied;
+	return S_OK;
 }
 
 HRESULT NFileOperations::CreateLinkToFile(const std::wstring &strTargetFilename,
@@ -634,20 +1361,13 @@ BOOL GetFileClusterSize(const std::wstring &strFilename, PLARGE_INTEGER lpRealFi
 	return TRUE;
 }
 
-void NFileOperations::DeleteFileSecurely(
-	const std::wstring &strFilename, OverwriteMethod overwriteMethod)
+void NFileOperations::DeleteFileSecurely(const std::wstring &strFilename,
+	OverwriteMethod overwriteMethod, SecureDeleteProgressCallback progressCallback)
 {
-	HANDLE hFile;
 	WIN32_FIND_DATA wfd;
 	HANDLE hFindFile;
-	HCRYPTPROV hProv;
 	LARGE_INTEGER lRealFileSize;
-	BYTE pass1Data;
-	BYTE pass2Data;
-	BYTE pass3Data;
-	DWORD nBytesWritten;
 	BOOL bFolder;
-	int i = 0;
 
 	hFindFile = FindFirstFile(strFilename.c_str(), &wfd);
 
@@ -667,62 +1387,116 @@ void NFileOperations::DeleteFileSecurely(
 
 	/* Determine the actual size of the file on disk
 	(i.e. how many clusters it is allocated). */
-	GetFileClusterSize(strFilename, &lRealFileSize);
+	if (!GetFileClusterSize(strFilename, &lRealFileSize))
+	{
+		return;
+	}
+
+	/* The file is written using unbuffered I/O, so that the data
+	goes straight to the device, rather than sitting in the file
+	cache. That also means that writes have to be a multiple of the
+	sector size. */
+	ULONGLONG overwriteSize = AlignUp(lRealFileSize.QuadPart, UNBUFFERED_IO_ALIGNMENT);
 
 	/* Open the file, block any sharing mode, to stop the file
 	been opened while it is overwritten. */
-	hFile =
-		CreateFile(strFilename.c_str(), FILE_WRITE_DATA, 0, nullptr, OPEN_EXISTING, NULL, nullptr);
+	wil::unique_hfile file(CreateFile(strFilename.c_str(), GENERIC_WRITE, 0, nullptr,
+		OPEN_EXISTING, FILE_FLAG_NO_BUFFERING | FILE_FLAG_OVERLAPPED, nullptr));
 
-	if (hFile == INVALID_HANDLE_VALUE)
+	if (!file)
 	{
 		return;
 	}
 
-	/* Extend the file out to the end of its last sector. */
-	SetFilePointerEx(hFile, lRealFileSize, nullptr, FILE_BEGIN);
-	SetEndOfFile(hFile);
+	/* Extend the file out to the end of its last cluster. */
+	SetFileSize(file.get(), overwriteSize);
 
-	/* Start at the beginning of the file, and
-	write in the first-pass data, 0x00 over
-	the length of the whole file. */
-	SetFilePointer(hFile, 0, nullptr, FILE_BEGIN);
-	pass1Data = 0x00;
+	/* The first pass writes 0x00 over the length of the whole file.
+	The three-pass method follows that with 0xFF and then random
+	data. */
+	std::vector<std::optional<std::byte>> passes = { std::byte { 0x00 } };
 
-	for (i = 0; i < lRealFileSize.QuadPart; i++)
+	if (overwriteMethod == OverwriteMethod::ThreePass)
 	{
-		WriteFile(hFile, (LPVOID) &pass1Data, 1, &nBytesWritten, nullptr);
+		passes.push_back(std::byte { 0xFF });
+		passes.push_back(std::nullopt);
 	}
 
-	if (overwriteMethod == OverwriteMethod::ThreePass)
+	FastRandom random(GenerateRandomSeed());
+	ULONGLONG totalBytes = overwriteSize * passes.size();
+	ULONGLONG bytesWritten = 0;
+
+	for (const auto &pattern : passes)
 	{
-		/* Start at the beginning of the file, and
-		write in the second-pass data, 0xFF over
-		the length of the whole file. */
-		SetFilePointer(hFile, 0, nullptr, FILE_BEGIN);
-		pass2Data = 0xFF;
+		UnbufferedFileWriter writer(file.get(), SECURE_DELETE_BUFFER_SIZE,
+			SECURE_DELETE_NUM_BUFFERS);
 
-		for (i = 0; i < lRealFileSize.QuadPart; i++)
+		if (!writer.IsValid())
 		{
-			WriteFile(hFile, (LPVOID) &pass2Data, 1, &nBytesWritten, nullptr);
+			return;
 		}
 
-		SetFilePointer(hFile, 0, nullptr, FILE_BEGIN);
+		while (writer.GetPosition() < overwriteSize)
+		{
+			auto space = writer.GetWritableSpace();
+			ULONGLONG remaining = overwriteSize - writer.GetPosition();
+			auto amount = static_cast<size_t>(
+				(std::min)(static_cast<ULONGLONG>(space.size()), remaining));
+			auto block = space.first(amount);
+
+			if (pattern)
+			{
+				std::fill(block.begin(), block.end(), *pattern);
+			}
+			else
+			{
+				random.Fill(block);
+			}
+
+			if (!writer.Commit(amount))
+			{
+				break;
+			}
 
-		CryptAcquireContext(&hProv, _T("SecureDelete"), nullptr, PROV_RSA_AES, CRYPT_NEWKEYSET);
+			bytesWritten += amount;
 
-		for (i = 0; i < lRealFileSize.QuadPart; i++)
-		{
-			CryptGenRandom(hProv, 1, (LPBYTE) &pass3Data);
-			WriteFile(hFile, (LPVOID) &pass3Data, 1, &nBytesWritten, nullptr);
+			if (progressCallback && !progressCallback(bytesWritten, totalBytes))
+			{
+				/* The file has been partially overwritten at this
+				point, but it's left in place, since the operation
+				was cancelled. */
+				return;
+			}
 		}
 
-		CryptAcquireContext(&hProv, _T("SecureDelete"), nullptr, PROV_RSA_AES, CRYPT_DELETEKEYSET);
-	}
+		writer.Finish();
 
-	FlushFileBuffers(hFile);
+		/* Each pass is flushed to disk before the next one begins, so
+		that the data for each pass actually reaches the device. */
+		FlushFileBuffers(file.get());
+	}
 
-	CloseHandle(hFile);
+	file.reset();
 
 	DeleteFile(strFilename.c_str());
+}
+
+/* Seeds the generator used for the random pass. The random data
+doesn't need to be cryptographically strong, but it shouldn't be
+predictable either. */
+uint64_t GenerateRandomSeed()
+{
+	uint64_t seed = 0;
+	HCRYPTPROV hProv;
+
+	if (CryptAcquireContext(&hProv, nullptr, nullptr, PROV_RSA_AES, CRYPT_VERIFYCONTEXT))
+	{
+		CryptGenRandom(hProv, sizeof(seed), reinterpret_cast<BYTE *>(&seed));
+		CryptReleaseContext(hProv, 0);
+	}
+
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+
+	return seed ^ static_cast<uint64_t>(counter.QuadPart);
 }
\ No newline at end of file
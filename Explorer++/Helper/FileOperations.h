@@ -4,7 +4,14 @@
 
 #pragma once
 
+#include "DirectoryListing.h"
+#include "FileHash.h"
+#include "FolderComparison.h"
+#include "LinkCreation.h"
+#include <functional>
 #include <list>
+#include <optional>
+#include <string_view>
 #include <vector>
 
 namespace NFileOperations
@@ -15,21 +22,77 @@ namespace NFileOperations
 		ThreePass = 2
 	};
 
+	/* Called periodically while a file is being overwritten. Returning
+	false cancels the operation, in which case the file isn't deleted. */
+	using SecureDeleteProgressCallback =
+		std::function<bool(ULONGLONG bytesWritten, ULONGLONG totalBytes)>;
+
+	struct FileRename
+	{
+		std::wstring path;
+		std::wstring newName;
+	};
+
 	HRESULT RenameFile(IShellItem *item, const std::wstring &newName);
+
+	/* Renames each of the specified items. Items in the file
+	system are renamed directly. Any remaining items (or items
+	that couldn't be renamed directly) are all renamed using a
+	single IFileOperation. Returns the indexes of the items
+	that were renamed. */
+	std::vector<size_t> RenameFiles(const std::vector<FileRename> &renames);
 	HRESULT DeleteFiles(
 		HWND hwnd, std::vector<PCIDLIST_ABSOLUTE> &pidls, bool permanent, bool silent);
-	void DeleteFileSecurely(const std::wstring &strFilename, OverwriteMethod overwriteMethod);
+	void DeleteFileSecurely(const std::wstring &strFilename, OverwriteMethod overwriteMethod,
+		SecureDeleteProgressCallback progressCallback = nullptr);
 	HRESULT CopyFilesToFolder(HWND hOwner, const std::wstring &strTitle,
-		std::vector<PCIDLIST_ABSOLUTE> &pidls, bool move);
-	HRESULT CopyFiles(
-		HWND hwnd, IShellItem *destinationFolder, std::vector<PCIDLIST_ABSOLUTE> &pidls, bool move);
+		std::vector<PCIDLIST_ABSOLUTE> &pidls, bool move, bool useNativeTransfer = false,
+		IFileOperationProgressSink *progressSink = nullptr);
+
+	/* If useNativeTransfer is set and all the items are
+	file system items, the transfer is performed directly
+	(see TransferFiles()), with IFileOperation only being
+	used for the transfers that can't be handled that way.
+	In both cases, progress is reported to the sink. */
+	HRESULT CopyFiles(HWND hwnd, IShellItem *destinationFolder,
+		std::vector<PCIDLIST_ABSOLUTE> &pidls, bool move, bool useNativeTransfer = false,
+		IFileOperationProgressSink *progressSink = nullptr);
+
+	/* Compares the two file system folders (see
+	CompareFolders()), showing progress in a modal dialog. */
+	HRESULT CompareFolders(HWND hwnd, const std::wstring &sourceFolder,
+		const std::wstring &destinationFolder, const FolderComparisonOptions &options,
+		std::vector<FolderDifference> &differences);
+
+	/* Copies the items that differ between the folders, as
+	found by CompareFolders(), into the destination folder,
+	showing progress in a modal dialog. */
+	HRESULT CopyFolderDifferences(HWND hwnd, const std::wstring &sourceFolder,
+		const std::wstring &destinationFolder, const std::vector<FolderDifference> &differences);
+
+	/* Calculates the SHA-256 hash of each of the files (see
+	FileHashCache::GetFileHashes()), showing progress in a
+	modal dialog. The hashes are returned in the same order
+	as the paths. */
+	HRESULT CalculateFileHashes(HWND hwnd, const std::wstring &title,
+		const std::vector<std::wstring> &paths, std::vector<std::optional<FileHash>> &hashes);
 
 	HRESULT CreateNewFolder(IShellItem *destinationFolder, const std::wstring &newFolderName,
 		IFileOperationProgressSink *progressSink);
 
 	TCHAR *BuildFilenameList(const std::list<std::wstring> &FilenameList);
 
-	BOOL SaveDirectoryListing(const std::wstring &strDirectory, const std::wstring &strFilename);
+	/* Writes out a listing of the items within the directory
+	(and optionally, all its subfolders) in the specified format. */
+	BOOL SaveDirectoryListing(const std::wstring &strDirectory, const std::wstring &strFilename,
+		DirectoryListingFormatter::Format format = DirectoryListingFormatter::Format::Text,
+		bool recursive = false);
+
+	/* Writes the text out to the file as UTF-8. The text is
+	written to a temporary file first, which then replaces the
+	original file, so that the original is left intact if the
+	write fails part of the way through. */
+	BOOL SaveTextFileAtomically(const std::wstring &strFilename, std::wstring_view text);
 
 	HRESULT CreateLinkToFile(const std::wstring &strTargetFilename,
 		const std::wstring &strLinkFilename, const std::wstring &strLinkDescription);
@@ -44,4 +107,31 @@ HRESULT CutFiles(const std::vector<PCIDLIST_ABSOLUTE> &items, IDataObject **data
 HRESULT CopyFilesToClipboard(
 	const std::vector<PCIDLIST_ABSOLUTE> &items, bool move, IDataObject **dataObjectOut);
 
-int PasteHardLinks(const TCHAR *szDestination);
\ No newline at end of file
+/* Returns the data object that was placed on the clipboard by
+CopyFilesToClipboard(), provided it's still on the clipboard.
+OleGetClipboard() always returns a wrapper object, so this is
+the only way of retrieving the original object. */
+IDataObject *GetInternalClipboardDataObject();
+
+struct InternalTransfer
+{
+	std::vector<std::wstring> sourcePaths;
+	std::wstring destinationFolder;
+};
+
+/* If the data object was created by this process (see
+ITransferItemsSource), returns the paths of the items it
+contains, so that they can be transferred directly, without
+the formats the data object offers being extracted. Transfers
+that involve items outside the file system, or that the shell
+treats specially (e.g. items being transferred into the folder
+they're already in), aren't returned. */
+std::optional<InternalTransfer> GetInternalTransfer(
+	IDataObject *dataObject, PCIDLIST_ABSOLUTE destination);
+
+HRESULT PasteHardLinks(HWND hwnd, const std::wstring &destination);
+
+/* Creates a link in the destination folder to each of the
+files on the clipboard. Progress is shown while the links
+are being created. */
+HRESULT PasteLinks(HWND hwnd, const std::wstring &destination, LinkType linkType);
\ No newline at end of file
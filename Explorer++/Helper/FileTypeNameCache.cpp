@@ -0,0 +1,41 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "FileTypeNameCache.h"
+
+std::optional<std::wstring> FileTypeNameCache::GetTypeName(const std::wstring &extension) const
+{
+	auto itr = m_typeNames.find(GetKey(extension));
+
+	if (itr == m_typeNames.end())
+	{
+		return std::nullopt;
+	}
+
+	return itr->second;
+}
+
+void FileTypeNameCache::SetTypeName(const std::wstring &extension, const std::wstring &typeName)
+{
+	m_typeNames[GetKey(extension)] = typeName;
+}
+
+void FileTypeNameCache::Clear()
+{
+	m_typeNames.clear();
+}
+
+std::wstring FileTypeNameCache::GetKey(const std::wstring &extension)
+{
+	std::wstring key = extension;
+	CharLowerBuff(key.data(), static_cast<DWORD>(key.size()));
+	return key;
+}
+
+FileTypeNameCache &GetFileTypeNameCache()
+{
+	static FileTypeNameCache fileTypeNameCache;
+	return fileTypeNameCache;
+}
\ No newline at end of file
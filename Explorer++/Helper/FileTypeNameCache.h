@@ -0,0 +1,33 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+// Every file with a particular extension shares the same type name, so the name only needs to be
+// retrieved for the first file of each type that's displayed. This class doesn't retrieve names
+// itself (doing that involves reading from the registry, which is left to background threads).
+// Instead, names are added as they're retrieved, so that later lookups can be answered straight
+// away.
+class FileTypeNameCache
+{
+public:
+	// The extension should include the leading period. Extensions are compared case-insensitively.
+	std::optional<std::wstring> GetTypeName(const std::wstring &extension) const;
+	void SetTypeName(const std::wstring &extension, const std::wstring &typeName);
+
+	// Should be called when file associations have changed.
+	void Clear();
+
+private:
+	static std::wstring GetKey(const std::wstring &extension);
+
+	std::unordered_map<std::wstring, std::wstring> m_typeNames;
+};
+
+// The cache shared by all tabs. It should only be used from the main thread.
+FileTypeNameCache &GetFileTypeNameCache();
\ No newline at end of file
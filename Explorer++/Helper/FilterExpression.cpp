@@ -0,0 +1,840 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "FilterExpression.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cwctype>
+
+namespace
+{
+
+// FILETIME values are measured in 100 nanosecond intervals.
+constexpr uint64_t TICKS_PER_SECOND = 10'000'000;
+
+// Prevents a deeply nested expression from exhausting the stack while it's being parsed.
+constexpr int MAX_NESTING_DEPTH = 64;
+
+bool EqualsIgnoringCase(std::wstring_view str1, std::wstring_view str2)
+{
+	return CompareStringOrdinal(str1.data(), static_cast<int>(str1.size()), str2.data(),
+			   static_cast<int>(str2.size()), TRUE)
+		== CSTR_EQUAL;
+}
+
+std::wstring NormalizeExtension(std::wstring_view extension)
+{
+	if (!extension.empty() && extension[0] == '.')
+	{
+		extension.remove_prefix(1);
+	}
+
+	return WildcardMatcher::FoldString(extension);
+}
+
+// Splits a value like "100MB" into its number and unit. Fails if the value doesn't start with a
+// non-negative number.
+std::optional<std::pair<double, std::wstring>> ParseQuantity(const std::wstring &value)
+{
+	if (value.empty() || !(std::iswdigit(value[0]) || value[0] == '.'))
+	{
+		return std::nullopt;
+	}
+
+	wchar_t *end;
+	double number = wcstod(value.c_str(), &end);
+
+	if (end == value.c_str())
+	{
+		return std::nullopt;
+	}
+
+	std::wstring unit(end);
+	std::transform(unit.begin(), unit.end(), unit.begin(),
+		[](wchar_t c) { return static_cast<wchar_t>(std::towlower(c)); });
+
+	return std::make_pair(number, unit);
+}
+
+std::optional<uint64_t> ScaleQuantity(double number, uint64_t multiplier)
+{
+	double scaled = number * static_cast<double>(multiplier);
+
+	// The largest double that's less than 2^64.
+	if (scaled >= 18446744073709549568.0)
+	{
+		return std::nullopt;
+	}
+
+	return static_cast<uint64_t>(scaled);
+}
+
+std::optional<uint64_t> ParseSize(const std::wstring &value)
+{
+	auto quantity = ParseQuantity(value);
+
+	if (!quantity)
+	{
+		return std::nullopt;
+	}
+
+	const auto &[number, unit] = *quantity;
+
+	static const std::pair<std::wstring_view, uint64_t> units[] = { { L"", 1 }, { L"b", 1 },
+		{ L"k", 1ULL << 10 }, { L"kb", 1ULL << 10 }, { L"m", 1ULL << 20 }, { L"mb", 1ULL << 20 },
+		{ L"g", 1ULL << 30 }, { L"gb", 1ULL << 30 }, { L"t", 1ULL << 40 }, { L"tb", 1ULL << 40 } };
+
+	for (const auto &[name, multiplier] : units)
+	{
+		if (unit == name)
+		{
+			return ScaleQuantity(number, multiplier);
+		}
+	}
+
+	return std::nullopt;
+}
+
+// Returns the age in 100 nanosecond intervals. A unit is required, since there's no obvious
+// default.
+std::optional<uint64_t> ParseAge(const std::wstring &value)
+{
+	auto quantity = ParseQuantity(value);
+
+	if (!quantity)
+	{
+		return std::nullopt;
+	}
+
+	const auto &[number, unit] = *quantity;
+
+	static const std::pair<std::wstring_view, uint64_t> units[] = { { L"s", TICKS_PER_SECOND },
+		{ L"m", 60 * TICKS_PER_SECOND }, { L"min", 60 * TICKS_PER_SECOND },
+		{ L"h", 60 * 60 * TICKS_PER_SECOND }, { L"d", 24 * 60 * 60 * TICKS_PER_SECOND },
+		{ L"w", 7 * 24 * 60 * 60 * TICKS_PER_SECOND } };
+
+	for (const auto &[name, multiplier] : units)
+	{
+		if (unit == name)
+		{
+			return ScaleQuantity(number, multiplier);
+		}
+	}
+
+	return std::nullopt;
+}
+
+template <typename Predicate>
+void CompareColumn(const std::vector<uint64_t> &column, uint64_t value, Predicate predicate,
+	std::vector<uint8_t> &results)
+{
+	// This is deliberately a simple loop over two contiguous arrays, so that the compiler can
+	// vectorize it.
+	for (size_t i = 0; i < column.size(); i++)
+	{
+		results[i] = predicate(column[i], value);
+	}
+}
+
+}
+
+void FilterItemTable::Reserve(size_t numItems)
+{
+	m_sizes.reserve(numItems);
+	m_modifiedTimes.reserve(numItems);
+	m_createdTimes.reserve(numItems);
+	m_accessedTimes.reserve(numItems);
+	m_extensionIds.reserve(numItems);
+}
+
+void FilterItemTable::AddItem(const Item &item)
+{
+	m_sizes.push_back(item.size);
+	m_modifiedTimes.push_back(item.modified);
+	m_createdTimes.push_back(item.created);
+	m_accessedTimes.push_back(item.accessed);
+	m_extensionIds.push_back(GetExtensionId(item.extension));
+}
+
+size_t FilterItemTable::GetNumItems() const
+{
+	return m_sizes.size();
+}
+
+uint32_t FilterItemTable::GetExtensionId(std::wstring_view extension)
+{
+	std::wstring originalExtension(extension);
+	auto itr = m_extensionIdsByOriginalName.find(originalExtension);
+
+	if (itr != m_extensionIdsByOriginalName.end())
+	{
+		return itr->second;
+	}
+
+	auto [normalizedItr, inserted] = m_extensionIdsByName.try_emplace(
+		NormalizeExtension(extension), static_cast<uint32_t>(m_extensions.size()));
+
+	if (inserted)
+	{
+		m_extensions.push_back(normalizedItr->first);
+	}
+
+	m_extensionIdsByOriginalName.emplace(std::move(originalExtension), normalizedItr->second);
+
+	return normalizedItr->second;
+}
+
+// A recursive descent parser that emits the instructions for each part of the expression as it's
+// parsed. Since the operands of each operator are parsed before the operator is emitted, the
+// instructions are naturally produced in postfix order.
+class FilterExpression::Parser
+{
+public:
+	Parser(FilterExpression &expression, uint64_t currentTime) :
+		m_expression(expression),
+		m_currentTime(currentTime)
+	{
+	}
+
+	bool Parse(std::wstring_view text)
+	{
+		if (!Tokenize(text))
+		{
+			return false;
+		}
+
+		return ParseOr() && Peek().type == TokenType::End;
+	}
+
+private:
+	enum class TokenType
+	{
+		Word,
+		Operator,
+		OpenParen,
+		CloseParen,
+		Comma,
+		End
+	};
+
+	struct Token
+	{
+		TokenType type;
+		std::wstring text;
+
+		// Quoted words are always treated as values, never as keywords.
+		bool quoted = false;
+	};
+
+	bool Tokenize(std::wstring_view text)
+	{
+		size_t i = 0;
+
+		while (i < text.size())
+		{
+			wchar_t c = text[i];
+
+			if (std::iswspace(c))
+			{
+				i++;
+			}
+			else if (c == '(')
+			{
+				m_tokens.push_back({ TokenType::OpenParen, L"(" });
+				i++;
+			}
+			else if (c == ')')
+			{
+				m_tokens.push_back({ TokenType::CloseParen, L")" });
+				i++;
+			}
+			else if (c == ',')
+			{
+				m_tokens.push_back({ TokenType::Comma, L"," });
+				i++;
+			}
+			else if (c == '<' || c == '>' || c == '=' || c == '!')
+			{
+				std::wstring op(1, c);
+				i++;
+
+				if (i < text.size() && (text[i] == '=' || (c == '<' && text[i] == '>')))
+				{
+					op += text[i];
+					i++;
+				}
+
+				if (op == L"!")
+				{
+					return false;
+				}
+
+				m_tokens.push_back({ TokenType::Operator, op });
+			}
+			else if (c == '"')
+			{
+				size_t end = text.find('"', i + 1);
+
+				if (end == std::wstring_view::npos)
+				{
+					return false;
+				}
+
+				m_tokens.push_back(
+					{ TokenType::Word, std::wstring(text.substr(i + 1, end - i - 1)), true });
+				i = end + 1;
+			}
+			else
+			{
+				size_t end = i;
+
+				while (end < text.size() && !std::iswspace(text[end])
+					&& std::wstring_view(L"()<>=!,\"").find(text[end]) == std::wstring_view::npos)
+				{
+					end++;
+				}
+
+				m_tokens.push_back({ TokenType::Word, std::wstring(text.substr(i, end - i)) });
+				i = end;
+			}
+		}
+
+		m_tokens.push_back({ TokenType::End, L"" });
+
+		return true;
+	}
+
+	const Token &Peek() const
+	{
+		return m_tokens[m_position];
+	}
+
+	const Token &Next()
+	{
+		const Token &token = m_tokens[m_position];
+
+		// The final token is always End and is never consumed.
+		if (token.type != TokenType::End)
+		{
+			m_position++;
+		}
+
+		return token;
+	}
+
+	static bool IsKeyword(const Token &token, std::wstring_view keyword)
+	{
+		return token.type == TokenType::Word && !token.quoted
+			&& EqualsIgnoringCase(token.text, keyword);
+	}
+
+	bool ParseOr()
+	{
+		if (!ParseAnd())
+		{
+			return false;
+		}
+
+		while (IsKeyword(Peek(), L"or"))
+		{
+			Next();
+
+			if (!ParseAnd())
+			{
+				return false;
+			}
+
+			Emit({ Opcode::Or });
+		}
+
+		return true;
+	}
+
+	bool ParseAnd()
+	{
+		if (!ParseUnary())
+		{
+			return false;
+		}
+
+		while (IsKeyword(Peek(), L"and"))
+		{
+			Next();
+
+			if (!ParseUnary())
+			{
+				return false;
+			}
+
+			Emit({ Opcode::And });
+		}
+
+		return true;
+	}
+
+	bool ParseUnary()
+	{
+		if (m_depth >= MAX_NESTING_DEPTH)
+		{
+			return false;
+		}
+
+		m_depth++;
+		bool result = ParseUnaryInternal();
+		m_depth--;
+
+		return result;
+	}
+
+	bool ParseUnaryInternal()
+	{
+		if (IsKeyword(Peek(), L"not"))
+		{
+			Next();
+
+			if (!ParseUnary())
+			{
+				return false;
+			}
+
+			Emit({ Opcode::Not });
+			return true;
+		}
+
+		if (Peek().type == TokenType::OpenParen)
+		{
+			Next();
+			return ParseOr() && Next().type == TokenType::CloseParen;
+		}
+
+		return ParseComparison();
+	}
+
+	bool ParseComparison()
+	{
+		const Token &property = Next();
+
+		if (property.type != TokenType::Word || property.quoted)
+		{
+			return false;
+		}
+
+		if (EqualsIgnoringCase(property.text, L"ext")
+			|| EqualsIgnoringCase(property.text, L"extension"))
+		{
+			return ParseExtensionComparison();
+		}
+
+		auto comparison = ParseOperator();
+
+		if (!comparison)
+		{
+			return false;
+		}
+
+		const Token &value = Next();
+
+		if (value.type != TokenType::Word)
+		{
+			return false;
+		}
+
+		if (EqualsIgnoringCase(property.text, L"name"))
+		{
+			return EmitNameComparison(*comparison, value.text);
+		}
+
+		if (EqualsIgnoringCase(property.text, L"size"))
+		{
+			auto size = ParseSize(value.text);
+
+			if (!size)
+			{
+				return false;
+			}
+
+			Emit({ Opcode::CompareSize, *comparison, TimeProperty::Modified, *size });
+			return true;
+		}
+
+		std::optional<TimeProperty> timeProperty;
+
+		if (EqualsIgnoringCase(property.text, L"modified"))
+		{
+			timeProperty = TimeProperty::Modified;
+		}
+		else if (EqualsIgnoringCase(property.text, L"created"))
+		{
+			timeProperty = TimeProperty::Created;
+		}
+		else if (EqualsIgnoringCase(property.text, L"accessed"))
+		{
+			timeProperty = TimeProperty::Accessed;
+		}
+		else
+		{
+			return false;
+		}
+
+		return EmitAgeComparison(*timeProperty, *comparison, value.text);
+	}
+
+	bool ParseExtensionComparison()
+	{
+		std::vector<std::wstring> extensions;
+		bool negate = false;
+
+		if (IsKeyword(Peek(), L"in"))
+		{
+			Next();
+
+			if (Next().type != TokenType::OpenParen)
+			{
+				return false;
+			}
+
+			while (true)
+			{
+				const Token &extension = Next();
+
+				if (extension.type != TokenType::Word)
+				{
+					return false;
+				}
+
+				extensions.push_back(NormalizeExtension(extension.text));
+
+				const Token &separator = Next();
+
+				if (separator.type == TokenType::CloseParen)
+				{
+					break;
+				}
+
+				if (separator.type != TokenType::Comma)
+				{
+					return false;
+				}
+			}
+		}
+		else
+		{
+			auto comparison = ParseOperator();
+
+			if (comparison != Comparison::Equal && comparison != Comparison::NotEqual)
+			{
+				return false;
+			}
+
+			const Token &extension = Next();
+
+			if (extension.type != TokenType::Word)
+			{
+				return false;
+			}
+
+			extensions.push_back(NormalizeExtension(extension.text));
+			negate = (comparison == Comparison::NotEqual);
+		}
+
+		m_expression.m_extensionSets.push_back(std::move(extensions));
+
+		Instruction instruction = { Opcode::ExtensionIn };
+		instruction.operand = m_expression.m_extensionSets.size() - 1;
+		Emit(instruction);
+
+		if (negate)
+		{
+			Emit({ Opcode::Not });
+		}
+
+		return true;
+	}
+
+	bool EmitNameComparison(Comparison comparison, const std::wstring &pattern)
+	{
+		if (comparison != Comparison::Equal && comparison != Comparison::NotEqual)
+		{
+			return false;
+		}
+
+		m_expression.m_nameMatchers.emplace_back(pattern, m_expression.m_caseSensitive);
+
+		Instruction instruction = { Opcode::NameMatches };
+		instruction.operand = m_expression.m_nameMatchers.size() - 1;
+		Emit(instruction);
+
+		if (comparison == Comparison::NotEqual)
+		{
+			Emit({ Opcode::Not });
+		}
+
+		return true;
+	}
+
+	// An age comparison is converted into a comparison against the time itself. For example,
+	// "modified < 7d" becomes a check that the modification time is later than 7 days ago.
+	bool EmitAgeComparison(
+		TimeProperty timeProperty, Comparison comparison, const std::wstring &value)
+	{
+		auto age = ParseAge(value);
+
+		if (!age)
+		{
+			return false;
+		}
+
+		Comparison timeComparison;
+
+		switch (comparison)
+		{
+		case Comparison::Less:
+			timeComparison = Comparison::Greater;
+			break;
+
+		case Comparison::LessOrEqual:
+			timeComparison = Comparison::GreaterOrEqual;
+			break;
+
+		case Comparison::Greater:
+			timeComparison = Comparison::Less;
+			break;
+
+		case Comparison::GreaterOrEqual:
+			timeComparison = Comparison::LessOrEqual;
+			break;
+
+		// Times are rarely identical, so an equality check on an age wouldn't be useful.
+		default:
+			return false;
+		}
+
+		uint64_t time = m_currentTime > *age ? m_currentTime - *age : 0;
+
+		Emit({ Opcode::CompareTime, timeComparison, timeProperty, time });
+
+		return true;
+	}
+
+	std::optional<Comparison> ParseOperator()
+	{
+		const Token &token = Next();
+
+		if (token.type != TokenType::Operator)
+		{
+			return std::nullopt;
+		}
+
+		static const std::pair<std::wstring_view, Comparison> operators[] = {
+			{ L"<", Comparison::Less }, { L"<=", Comparison::LessOrEqual },
+			{ L">", Comparison::Greater }, { L">=", Comparison::GreaterOrEqual },
+			{ L"=", Comparison::Equal }, { L"==", Comparison::Equal },
+			{ L"!=", Comparison::NotEqual }, { L"<>", Comparison::NotEqual }
+		};
+
+		for (const auto &[text, comparison] : operators)
+		{
+			if (token.text == text)
+			{
+				return comparison;
+			}
+		}
+
+		return std::nullopt;
+	}
+
+	void Emit(const Instruction &instruction)
+	{
+		m_expression.m_instructions.push_back(instruction);
+	}
+
+	FilterExpression &m_expression;
+	const uint64_t m_currentTime;
+	std::vector<Token> m_tokens;
+	size_t m_position = 0;
+	int m_depth = 0;
+};
+
+FilterExpression::FilterExpression(bool caseSensitive) : m_caseSensitive(caseSensitive)
+{
+}
+
+std::optional<FilterExpression> FilterExpression::Parse(
+	std::wstring_view text, bool caseSensitive, uint64_t currentTime)
+{
+	FilterExpression expression(caseSensitive);
+	Parser parser(expression, currentTime);
+
+	if (!parser.Parse(text))
+	{
+		return std::nullopt;
+	}
+
+	return expression;
+}
+
+std::vector<uint8_t> FilterExpression::Evaluate(const FilterItemTable &table,
+	const std::function<std::wstring_view(size_t index)> &getName) const
+{
+	size_t numItems = table.GetNumItems();
+	std::vector<std::vector<uint8_t>> stack;
+
+	for (const auto &instruction : m_instructions)
+	{
+		switch (instruction.opcode)
+		{
+		case Opcode::CompareSize:
+			Compare(table.m_sizes, instruction.comparison, instruction.value,
+				stack.emplace_back(numItems));
+			break;
+
+		case Opcode::CompareTime:
+			Compare(GetTimeColumn(table, instruction.timeProperty), instruction.comparison,
+				instruction.value, stack.emplace_back(numItems));
+			break;
+
+		case Opcode::ExtensionIn:
+		{
+			// Each distinct extension is only checked once. The result for each item can then be
+			// looked up from its extension ID.
+			const auto &extensions = m_extensionSets[instruction.operand];
+			std::vector<uint8_t> extensionMatches(table.m_extensions.size());
+
+			for (size_t i = 0; i < table.m_extensions.size(); i++)
+			{
+				extensionMatches[i] =
+					std::find(extensions.begin(), extensions.end(), table.m_extensions[i])
+					!= extensions.end();
+			}
+
+			auto &results = stack.emplace_back(numItems);
+
+			for (size_t i = 0; i < numItems; i++)
+			{
+				results[i] = extensionMatches[table.m_extensionIds[i]];
+			}
+		}
+		break;
+
+		case Opcode::NameMatches:
+		{
+			const auto &matcher = m_nameMatchers[instruction.operand];
+			auto &results = stack.emplace_back(numItems);
+
+			for (size_t i = 0; i < numItems; i++)
+			{
+				results[i] = matcher.MatchesFolded(getName(i));
+			}
+		}
+		break;
+
+		case Opcode::And:
+		case Opcode::Or:
+		{
+			auto operand = std::move(stack.back());
+			stack.pop_back();
+			auto &results = stack.back();
+
+			if (instruction.opcode == Opcode::And)
+			{
+				for (size_t i = 0; i < numItems; i++)
+				{
+					results[i] &= operand[i];
+				}
+			}
+			else
+			{
+				for (size_t i = 0; i < numItems; i++)
+				{
+					results[i] |= operand[i];
+				}
+			}
+		}
+		break;
+
+		case Opcode::Not:
+		{
+			auto &results = stack.back();
+
+			for (size_t i = 0; i < numItems; i++)
+			{
+				results[i] ^= 1;
+			}
+		}
+		break;
+		}
+	}
+
+	assert(stack.size() == 1);
+
+	return std::move(stack.back());
+}
+
+bool FilterExpression::Matches(const FilterItemTable::Item &item, std::wstring_view name) const
+{
+	FilterItemTable table;
+	table.AddItem(item);
+
+	std::wstring foldedName;
+
+	if (!m_nameMatchers.empty())
+	{
+		foldedName = m_caseSensitive ? std::wstring(name) : WildcardMatcher::FoldString(name);
+	}
+
+	auto results =
+		Evaluate(table, [&foldedName](size_t) -> std::wstring_view { return foldedName; });
+
+	return results[0] != 0;
+}
+
+void FilterExpression::Compare(const std::vector<uint64_t> &column, Comparison comparison,
+	uint64_t value, std::vector<uint8_t> &results)
+{
+	switch (comparison)
+	{
+	case Comparison::Less:
+		CompareColumn(column, value, std::less<uint64_t>(), results);
+		break;
+
+	case Comparison::LessOrEqual:
+		CompareColumn(column, value, std::less_equal<uint64_t>(), results);
+		break;
+
+	case Comparison::Greater:
+		CompareColumn(column, value, std::greater<uint64_t>(), results);
+		break;
+
+	case Comparison::GreaterOrEqual:
+		CompareColumn(column, value, std::greater_equal<uint64_t>(), results);
+		break;
+
+	case Comparison::Equal:
+		CompareColumn(column, value, std::equal_to<uint64_t>(), results);
+		break;
+
+	case Comparison::NotEqual:
+		CompareColumn(column, value, std::not_equal_to<uint64_t>(), results);
+		break;
+	}
+}
+
+const std::vector<uint64_t> &FilterExpression::GetTimeColumn(
+	const FilterItemTable &table, TimeProperty timeProperty)
+{
+	switch (timeProperty)
+	{
+	case TimeProperty::Created:
+		return table.m_createdTimes;
+
+	case TimeProperty::Accessed:
+		return table.m_accessedTimes;
+
+	case TimeProperty::Modified:
+	default:
+		return table.m_modifiedTimes;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,155 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "WildcardMatcher.h"
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// The properties of a set of items that a FilterExpression can test, stored column by column (i.e.
+// as a structure of arrays). Each comparison in an expression then runs over a single contiguous
+// array, which allows the comparison to be vectorized.
+class FilterItemTable
+{
+public:
+	struct Item
+	{
+		uint64_t size = 0;
+
+		// FILETIME values, stored as 64-bit integers.
+		uint64_t modified = 0;
+		uint64_t created = 0;
+		uint64_t accessed = 0;
+
+		// With or without the leading period.
+		std::wstring_view extension;
+	};
+
+	void Reserve(size_t numItems);
+
+	// Items are numbered in the order they're added.
+	void AddItem(const Item &item);
+
+	size_t GetNumItems() const;
+
+private:
+	friend class FilterExpression;
+
+	uint32_t GetExtensionId(std::wstring_view extension);
+
+	std::vector<uint64_t> m_sizes;
+	std::vector<uint64_t> m_modifiedTimes;
+	std::vector<uint64_t> m_createdTimes;
+	std::vector<uint64_t> m_accessedTimes;
+
+	// Each item's extension is stored as an index into m_extensions, which contains each distinct
+	// extension (lowercased and without the leading period) once.
+	std::vector<uint32_t> m_extensionIds;
+	std::vector<std::wstring> m_extensions;
+	std::unordered_map<std::wstring, uint32_t> m_extensionIdsByName;
+
+	// Extensions as they appeared on the items added, which allows the extension for most items
+	// to be found without having to be lowercased.
+	std::unordered_map<std::wstring, uint32_t> m_extensionIdsByOriginalName;
+};
+
+// A filter such as "size > 100MB and modified < 7d and ext in (log, tmp)". The expression is parsed
+// once and compiled to a sequence of instructions, which are then run over an entire
+// FilterItemTable at a time.
+//
+// The supported properties are:
+//
+// - size, which is compared against a number with an optional unit (B, KB, MB, GB or TB).
+// - modified, created and accessed, which are compared against an age, given as a number followed
+//   by s, m, h, d or w (e.g. "modified < 7d" matches items modified within the last week).
+// - ext, which is compared against an extension, or a list of extensions using "in".
+// - name, which is compared against a wildcard pattern (as accepted by WildcardMatcher).
+//
+// Comparisons can be combined using "and", "or", "not" and parentheses. Keywords and property
+// names are case-insensitive. Values that contain spaces can be quoted.
+class FilterExpression
+{
+public:
+	// Returns an empty value if the text isn't a valid expression. Ages are measured from
+	// currentTime (a FILETIME value), so an expression containing them should be parsed again if
+	// it needs to be re-evaluated at a later time.
+	static std::optional<FilterExpression> Parse(std::wstring_view text, bool caseSensitive,
+		uint64_t currentTime);
+
+	// Returns a value for each item in the table, which is non-zero if the item matches. getName
+	// is only called if the expression tests the item name and should return the name of the
+	// specified item, already folded using WildcardMatcher::FoldString() if the expression isn't
+	// case-sensitive.
+	std::vector<uint8_t> Evaluate(const FilterItemTable &table,
+		const std::function<std::wstring_view(size_t index)> &getName) const;
+
+	// Tests a single item. Unlike Evaluate(), the name is folded here, if necessary.
+	bool Matches(const FilterItemTable::Item &item, std::wstring_view name) const;
+
+private:
+	enum class Opcode
+	{
+		CompareSize,
+		CompareTime,
+		ExtensionIn,
+		NameMatches,
+		And,
+		Or,
+		Not
+	};
+
+	enum class Comparison
+	{
+		Less,
+		LessOrEqual,
+		Greater,
+		GreaterOrEqual,
+		Equal,
+		NotEqual
+	};
+
+	enum class TimeProperty
+	{
+		Modified,
+		Created,
+		Accessed
+	};
+
+	// Instructions are stored in postfix order. Each comparison pushes a result for every item
+	// and each logical operator pops its operands and pushes the combined result.
+	struct Instruction
+	{
+		Opcode opcode;
+		Comparison comparison = Comparison::Equal;
+		TimeProperty timeProperty = TimeProperty::Modified;
+		uint64_t value = 0;
+
+		// For ExtensionIn, an index into m_extensionSets. For NameMatches, an index into
+		// m_nameMatchers.
+		size_t operand = 0;
+	};
+
+	class Parser;
+
+	explicit FilterExpression(bool caseSensitive);
+
+	static void Compare(const std::vector<uint64_t> &column, Comparison comparison, uint64_t value,
+		std::vector<uint8_t> &results);
+	static const std::vector<uint64_t> &GetTimeColumn(
+		const FilterItemTable &table, TimeProperty timeProperty);
+
+	bool m_caseSensitive;
+	std::vector<Instruction> m_instructions;
+
+	// Lowercased and without the leading period.
+	std::vector<std::vector<std::wstring>> m_extensionSets;
+
+	std::vector<WildcardMatcher> m_nameMatchers;
+};
\ No newline at end of file
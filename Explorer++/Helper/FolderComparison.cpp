@@ -0,0 +1,452 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "FolderComparison.h"
+#include "ParallelWalk.h"
+#include <wil/resource.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+namespace
+{
+
+// The size of the views used when comparing file contents. Several files are compared at once, so
+// this is kept small enough that the views won't exhaust the address space of a 32-bit process.
+const ULONGLONG COMPARISON_VIEW_SIZE = 16 * 1024 * 1024;
+
+// FAT volumes only record modification times to within 2 seconds. Times are in 100ns units.
+const ULONGLONG MODIFICATION_TIME_TOLERANCE = 2 * 10'000'000;
+
+struct FolderEntry
+{
+	std::wstring name;
+	bool isFolder;
+	bool isReparsePoint;
+	ULONGLONG size;
+	ULONGLONG modificationTime;
+};
+
+// Entries are keyed by their upper-cased name, since names in the file system are
+// case-insensitive.
+using FolderIndex = std::unordered_map<std::wstring, FolderEntry>;
+
+struct ContentComparison
+{
+	std::wstring relativePath;
+	ULONGLONG size;
+};
+
+struct ComparisonState
+{
+	std::mutex mutex;
+	std::vector<FolderDifference> differences;
+	std::vector<ContentComparison> contentComparisons;
+	std::atomic<int> itemsCompared = 0;
+	std::atomic<HRESULT> result = S_OK;
+};
+
+std::wstring CombinePath(const std::wstring &folder, const std::wstring &name)
+{
+	if (folder.empty())
+	{
+		return name;
+	}
+
+	if (folder.back() == '\\')
+	{
+		return folder + name;
+	}
+
+	return folder + L"\\" + name;
+}
+
+std::wstring GetNameKey(const std::wstring &name)
+{
+	std::wstring key = name;
+	CharUpperBuff(key.data(), static_cast<DWORD>(key.size()));
+	return key;
+}
+
+ULONGLONG CombineParts(DWORD low, DWORD high)
+{
+	ULARGE_INTEGER value;
+	value.LowPart = low;
+	value.HighPart = high;
+	return value.QuadPart;
+}
+
+HRESULT IndexFolder(const std::wstring &folder, FolderIndex &index)
+{
+	WIN32_FIND_DATA findData;
+	wil::unique_hfind findHandle(FindFirstFileEx(CombinePath(folder, L"*").c_str(),
+		FindExInfoBasic, &findData, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH));
+
+	if (!findHandle)
+	{
+		return HRESULT_FROM_WIN32(GetLastError());
+	}
+
+	do
+	{
+		if (lstrcmp(findData.cFileName, _T(".")) == 0 || lstrcmp(findData.cFileName, _T("..")) == 0)
+		{
+			continue;
+		}
+
+		FolderEntry entry;
+		entry.name = findData.cFileName;
+		entry.isFolder = WI_IsFlagSet(findData.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY);
+		entry.isReparsePoint = WI_IsFlagSet(findData.dwFileAttributes, FILE_ATTRIBUTE_REPARSE_POINT);
+		entry.size = entry.isFolder ? 0 : CombineParts(findData.nFileSizeLow, findData.nFileSizeHigh);
+		entry.modificationTime = CombineParts(
+			findData.ftLastWriteTime.dwLowDateTime, findData.ftLastWriteTime.dwHighDateTime);
+
+		index.emplace(GetNameKey(entry.name), std::move(entry));
+	} while (FindNextFile(findHandle.get(), &findData));
+
+	return S_OK;
+}
+
+void CompareFolderPair(const std::wstring &sourceFolder, const std::wstring &destinationFolder,
+	const std::wstring &relativePath, const FolderComparisonOptions &options,
+	ComparisonState &state, ParallelWalk<std::wstring>::Worker &worker)
+{
+	FolderIndex sourceIndex;
+	HRESULT hr = IndexFolder(CombinePath(sourceFolder, relativePath), sourceIndex);
+
+	FolderIndex destinationIndex;
+
+	if (SUCCEEDED(hr))
+	{
+		hr = IndexFolder(CombinePath(destinationFolder, relativePath), destinationIndex);
+	}
+
+	if (FAILED(hr))
+	{
+		HRESULT expected = S_OK;
+		state.result.compare_exchange_strong(expected, hr);
+		return;
+	}
+
+	// As with enumeration, the results are gathered locally, so that the shared state only needs
+	// to be locked once per folder.
+	std::vector<FolderDifference> differences;
+	std::vector<ContentComparison> contentComparisons;
+	std::vector<std::wstring> subfolders;
+	int itemsCompared = static_cast<int>(sourceIndex.size());
+
+	for (const auto &[key, sourceEntry] : sourceIndex)
+	{
+		std::wstring itemPath = CombinePath(relativePath, sourceEntry.name);
+		auto itr = destinationIndex.find(key);
+
+		if (itr == destinationIndex.end())
+		{
+			differences.push_back({ FolderDifferenceType::SourceOnly, itemPath,
+				sourceEntry.isFolder, sourceEntry.size });
+			continue;
+		}
+
+		const FolderEntry &destinationEntry = itr->second;
+
+		if (sourceEntry.isFolder != destinationEntry.isFolder)
+		{
+			differences.push_back({ FolderDifferenceType::KindMismatch, itemPath,
+				sourceEntry.isFolder, sourceEntry.size });
+		}
+		else if (sourceEntry.isFolder)
+		{
+			if (!sourceEntry.isReparsePoint && !destinationEntry.isReparsePoint)
+			{
+				subfolders.push_back(itemPath);
+			}
+		}
+		else if (sourceEntry.size != destinationEntry.size)
+		{
+			differences.push_back(
+				{ FolderDifferenceType::Modified, itemPath, false, sourceEntry.size });
+		}
+		else if (options.compareContents)
+		{
+			// Empty files are always identical.
+			if (sourceEntry.size > 0)
+			{
+				contentComparisons.push_back({ itemPath, sourceEntry.size });
+			}
+		}
+		else
+		{
+			ULONGLONG timeDifference = (std::max)(sourceEntry.modificationTime,
+										   destinationEntry.modificationTime)
+				- (std::min)(sourceEntry.modificationTime, destinationEntry.modificationTime);
+
+			if (timeDifference > MODIFICATION_TIME_TOLERANCE)
+			{
+				differences.push_back(
+					{ FolderDifferenceType::Modified, itemPath, false, sourceEntry.size });
+			}
+		}
+
+		destinationIndex.erase(itr);
+	}
+
+	// Anything left in the destination index has no counterpart in the source folder.
+	for (const auto &[key, destinationEntry] : destinationIndex)
+	{
+		differences.push_back({ FolderDifferenceType::DestinationOnly,
+			CombinePath(relativePath, destinationEntry.name), destinationEntry.isFolder,
+			destinationEntry.size });
+		itemsCompared++;
+	}
+
+	{
+		std::scoped_lock lock(state.mutex);
+		state.differences.insert(state.differences.end(),
+			std::make_move_iterator(differences.begin()),
+			std::make_move_iterator(differences.end()));
+		state.contentComparisons.insert(state.contentComparisons.end(),
+			std::make_move_iterator(contentComparisons.begin()),
+			std::make_move_iterator(contentComparisons.end()));
+	}
+
+	state.itemsCompared += itemsCompared;
+
+	for (auto &subfolder : subfolders)
+	{
+		worker.AddItem(std::move(subfolder));
+	}
+}
+
+// Reading from a mapped view raises an exception (rather than returning an error) if the
+// underlying read fails, which can happen if, for example, a network connection is lost. This is
+// kept separate, since structured exception handling can't be used in a function that has objects
+// requiring unwinding.
+bool CompareViews(const void *view1, const void *view2, size_t size, bool &equal)
+{
+	__try
+	{
+		equal = (memcmp(view1, view2, size) == 0);
+		return true;
+	}
+	__except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER
+															: EXCEPTION_CONTINUE_SEARCH)
+	{
+		return false;
+	}
+}
+
+HRESULT CompareFileContents(const std::wstring &path1, const std::wstring &path2,
+	std::stop_token stopToken, bool &equal)
+{
+	wil::unique_hfile file1(CreateFile(path1.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+	wil::unique_hfile file2(CreateFile(path2.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+
+	if (!file1 || !file2)
+	{
+		return HRESULT_FROM_WIN32(GetLastError());
+	}
+
+	// The files may have changed since they were enumerated.
+	LARGE_INTEGER size1;
+	LARGE_INTEGER size2;
+
+	if (!GetFileSizeEx(file1.get(), &size1) || !GetFileSizeEx(file2.get(), &size2))
+	{
+		return HRESULT_FROM_WIN32(GetLastError());
+	}
+
+	if (size1.QuadPart != size2.QuadPart)
+	{
+		equal = false;
+		return S_OK;
+	}
+
+	auto size = static_cast<ULONGLONG>(size1.QuadPart);
+
+	if (size == 0)
+	{
+		equal = true;
+		return S_OK;
+	}
+
+	wil::unique_handle mapping1(
+		CreateFileMapping(file1.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+	wil::unique_handle mapping2(
+		CreateFileMapping(file2.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+
+	if (!mapping1 || !mapping2)
+	{
+		return HRESULT_FROM_WIN32(GetLastError());
+	}
+
+	for (ULONGLONG offset = 0; offset < size; offset += COMPARISON_VIEW_SIZE)
+	{
+		if (stopToken.stop_requested())
+		{
+			return HRESULT_FROM_WIN32(ERROR_CANCELLED);
+		}
+
+		auto viewSize = static_cast<SIZE_T>((std::min)(COMPARISON_VIEW_SIZE, size - offset));
+		ULARGE_INTEGER viewOffset;
+		viewOffset.QuadPart = offset;
+
+		wil::unique_mapview_ptr<void> view1(MapViewOfFile(mapping1.get(), FILE_MAP_READ,
+			viewOffset.HighPart, viewOffset.LowPart, viewSize));
+		wil::unique_mapview_ptr<void> view2(MapViewOfFile(mapping2.get(), FILE_MAP_READ,
+			viewOffset.HighPart, viewOffset.LowPart, viewSize));
+
+		if (!view1 || !view2)
+		{
+			return HRESULT_FROM_WIN32(GetLastError());
+		}
+
+		if (!CompareViews(view1.get(), view2.get(), viewSize, equal))
+		{
+			return HRESULT_FROM_WIN32(ERROR_READ_FAULT);
+		}
+
+		if (!equal)
+		{
+			return S_OK;
+		}
+	}
+
+	return S_OK;
+}
+
+}
+
+HRESULT CompareFolders(const std::wstring &sourceFolder, const std::wstring &destinationFolder,
+	const FolderComparisonOptions &options, std::vector<FolderDifference> &differences,
+	std::stop_token stopToken, const FolderComparisonProgressCallback &progressCallback)
+{
+	ComparisonState state;
+
+	auto reportProgress = [&state, &progressCallback]() {
+		if (progressCallback)
+		{
+			progressCallback(state.itemsCompared);
+		}
+	};
+
+	ParallelWalk<std::wstring>::Run(
+		std::wstring(),
+		[&sourceFolder, &destinationFolder, &options, &state](const std::wstring &relativePath,
+			ParallelWalk<std::wstring>::Worker &worker) {
+			if (FAILED(state.result))
+			{
+				return;
+			}
+
+			CompareFolderPair(
+				sourceFolder, destinationFolder, relativePath, options, state, worker);
+		},
+		stopToken, reportProgress);
+
+	if (stopToken.stop_requested())
+	{
+		return HRESULT_FROM_WIN32(ERROR_CANCELLED);
+	}
+
+	if (FAILED(state.result))
+	{
+		return state.result;
+	}
+
+	std::vector<const ContentComparison *> contentComparisons;
+	contentComparisons.reserve(state.contentComparisons.size());
+
+	for (const auto &contentComparison : state.contentComparisons)
+	{
+		contentComparisons.push_back(&contentComparison);
+	}
+
+	ParallelWalk<const ContentComparison *>::Run(
+		std::move(contentComparisons),
+		[&sourceFolder, &destinationFolder, &state, stopToken](
+			const ContentComparison *contentComparison,
+			ParallelWalk<const ContentComparison *>::Worker &worker) {
+			UNREFERENCED_PARAMETER(worker);
+
+			if (FAILED(state.result))
+			{
+				return;
+			}
+
+			bool equal = true;
+			HRESULT hr = CompareFileContents(
+				CombinePath(sourceFolder, contentComparison->relativePath),
+				CombinePath(destinationFolder, contentComparison->relativePath), stopToken, equal);
+
+			if (FAILED(hr))
+			{
+				if (hr != HRESULT_FROM_WIN32(ERROR_CANCELLED))
+				{
+					HRESULT expected = S_OK;
+					state.result.compare_exchange_strong(expected, hr);
+				}
+
+				return;
+			}
+
+			if (!equal)
+			{
+				std::scoped_lock lock(state.mutex);
+				state.differences.push_back({ FolderDifferenceType::Modified,
+					contentComparison->relativePath, false, contentComparison->size });
+			}
+		},
+		stopToken, reportProgress);
+
+	if (stopToken.stop_requested())
+	{
+		return HRESULT_FROM_WIN32(ERROR_CANCELLED);
+	}
+
+	if (FAILED(state.result))
+	{
+		return state.result;
+	}
+
+	// The order in which folders are walked isn't deterministic.
+	std::sort(state.differences.begin(), state.differences.end(),
+		[](const FolderDifference &difference1, const FolderDifference &difference2) {
+			return difference1.relativePath < difference2.relativePath;
+		});
+
+	differences = std::move(state.differences);
+
+	return S_OK;
+}
+
+HRESULT CopyFolderDifferences(const std::wstring &sourceFolder,
+	const std::wstring &destinationFolder, const std::vector<FolderDifference> &differences,
+	std::stop_token stopToken, const FileTransferProgressCallback &progressCallback)
+{
+	std::vector<FileTransferItem> items;
+
+	for (const auto &difference : differences)
+	{
+		if (difference.type != FolderDifferenceType::SourceOnly
+			&& difference.type != FolderDifferenceType::Modified)
+		{
+			continue;
+		}
+
+		items.push_back({ CombinePath(sourceFolder, difference.relativePath),
+			CombinePath(destinationFolder, difference.relativePath) });
+	}
+
+	if (items.empty())
+	{
+		return S_OK;
+	}
+
+	return CopyItemsReplacingExisting(items, stopToken, progressCallback);
+}
\ No newline at end of file
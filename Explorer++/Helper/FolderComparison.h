@@ -0,0 +1,70 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "BulkFileTransfer.h"
+#include <functional>
+#include <stop_token>
+#include <string>
+#include <vector>
+
+enum class FolderDifferenceType
+{
+	// The item only exists in the source folder.
+	SourceOnly,
+
+	// The item only exists in the destination folder.
+	DestinationOnly,
+
+	// A file exists in both folders, but the two copies differ.
+	Modified,
+
+	// The item is a file in one folder and a folder in the other.
+	KindMismatch
+};
+
+struct FolderDifference
+{
+	FolderDifferenceType type;
+
+	// The path of the item, relative to the two folders being compared.
+	std::wstring relativePath;
+
+	// These describe the source item, unless the item only exists in the destination folder.
+	bool isFolder;
+	ULONGLONG size;
+};
+
+struct FolderComparisonOptions
+{
+	// By default, two files are considered to be the same if their sizes and modification times
+	// match. If this is set, files that are the same size are instead compared byte-for-byte and
+	// their modification times are ignored.
+	bool compareContents = false;
+};
+
+// Invoked periodically on the calling thread while a comparison is in progress.
+using FolderComparisonProgressCallback = std::function<void(int itemsCompared)>;
+
+// Recursively compares the contents of the two folders. The folders are walked in parallel, using
+// the threads shared with ParallelWalk, with each pair of subfolders being enumerated and matched
+// up by name on a single thread. When contents are compared, the files are then read through
+// memory-mapped views, again in parallel.
+//
+// A folder that only exists on one side is reported as a single difference; its contents aren't
+// listed. Reparse points are compared like any other item, but aren't followed. The differences
+// are returned sorted by path.
+HRESULT CompareFolders(const std::wstring &sourceFolder, const std::wstring &destinationFolder,
+	const FolderComparisonOptions &options, std::vector<FolderDifference> &differences,
+	std::stop_token stopToken = {},
+	const FolderComparisonProgressCallback &progressCallback = nullptr);
+
+// Brings the destination folder up to date with the source folder, by copying over each item that
+// only exists in the source folder, as well as each modified file (see
+// CopyItemsReplacingExisting()). Nothing is deleted from the destination folder and items that
+// are a file on one side and a folder on the other are left alone.
+HRESULT CopyFolderDifferences(const std::wstring &sourceFolder,
+	const std::wstring &destinationFolder, const std::vector<FolderDifference> &differences,
+	std::stop_token stopToken = {}, const FileTransferProgressCallback &progressCallback = nullptr);
\ No newline at end of file
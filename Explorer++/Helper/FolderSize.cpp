@@ -4,55 +4,248 @@
 
 #include "stdafx.h"
 #include "FolderSize.h"
-#include <filesystem>
+#include "ParallelWalk.h"
+#include <wil/resource.h>
+#include <atomic>
 
-FolderInfo GetFolderInfo(const std::wstring &path)
+namespace
 {
-	FolderInfo folderInfo = {};
-	std::error_code error;
 
-	for (const auto &entry : std::filesystem::directory_iterator(path, error))
+struct PendingFolder
+{
+	std::wstring path;
+
+	// Set when the folder was found by enumerating its parent, which avoids having to query the
+	// folder again. The attributes are only valid when this is set.
+	std::optional<FILETIME> lastWriteTime;
+	DWORD attributes = 0;
+};
+
+struct SubfolderDetails
+{
+	FILETIME lastWriteTime;
+	DWORD attributes;
+};
+
+std::wstring CombinePath(const std::wstring &folder, const std::wstring &name)
+{
+	if (!folder.empty() && folder.back() == '\\')
+	{
+		return folder + name;
+	}
+
+	return folder + L"\\" + name;
+}
+
+// Enumerates the items directly within the folder. The last write time and attributes of each of
+// the subfolders are also returned. Returns false if the enumeration was stopped before it could be
+// completed.
+bool EnumerateFolder(const std::wstring &path, const std::stop_token &stopToken,
+	FolderContents &contents, std::vector<SubfolderDetails> &subfolderDetails)
+{
+	WIN32_FIND_DATA findData;
+	wil::unique_hfind findHandle(FindFirstFileEx(CombinePath(path, L"*").c_str(),
+		FindExInfoBasic, &findData, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH));
+
+	// The folder may have been removed, or may not be accessible. Either way, it's treated as
+	// being empty.
+	if (!findHandle)
+	{
+		return true;
+	}
+
+	do
 	{
-		if (std::filesystem::is_directory(entry.status()))
+		if (stopToken.stop_requested())
 		{
-			folderInfo.numFolders++;
+			return false;
+		}
 
-			FolderInfo subFolderInfo = GetFolderInfo(entry.path());
+		if (WI_IsFlagSet(findData.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+		{
+			if (lstrcmp(findData.cFileName, _T(".")) == 0
+				|| lstrcmp(findData.cFileName, _T("..")) == 0
+				|| WI_IsFlagSet(findData.dwFileAttributes, FILE_ATTRIBUTE_REPARSE_POINT))
+			{
+				continue;
+			}
 
-			folderInfo.size += subFolderInfo.size;
-			folderInfo.numFolders += subFolderInfo.numFolders;
-			folderInfo.numFiles += subFolderInfo.numFiles;
+			contents.subfolders.emplace_back(findData.cFileName);
+			subfolderDetails.push_back({ findData.ftLastWriteTime, findData.dwFileAttributes });
 		}
 		else
 		{
-			std::error_code sizeErrorCode;
-			const auto size = std::filesystem::file_size(entry.path(), sizeErrorCode);
+			ULARGE_INTEGER fileSize;
+			fileSize.LowPart = findData.nFileSizeLow;
+			fileSize.HighPart = findData.nFileSizeHigh;
 
-			// If the size can't be retrieved, the error will be ignored and the current file will
-			// effectively be skipped over.
-			if (!sizeErrorCode)
-			{
-				folderInfo.size += size;
-				folderInfo.numFiles++;
-			}
+			contents.filesSize += fileSize.QuadPart;
+			contents.numFiles++;
+		}
+	} while (FindNextFile(findHandle.get(), &findData));
+
+	return true;
+}
+
+// Returns false if the folder couldn't be processed. Unpopulated placeholder folders are reported
+// via the unpopulated parameter, rather than being enumerated, when populateCloudFolders is false.
+bool ProcessFolder(const PendingFolder &folder, const std::stop_token &stopToken,
+	FolderContentsCache *cache, bool populateCloudFolders, FolderContents &contents,
+	std::vector<PendingFolder> &subfolders, bool &unpopulated)
+{
+	FILETIME lastWriteTime;
+	DWORD attributes;
+
+	unpopulated = false;
+
+	if (folder.lastWriteTime)
+	{
+		lastWriteTime = *folder.lastWriteTime;
+		attributes = folder.attributes;
+	}
+	else
+	{
+		WIN32_FILE_ATTRIBUTE_DATA attributeData;
+		BOOL res = GetFileAttributesEx(folder.path.c_str(), GetFileExInfoStandard, &attributeData);
+
+		// The folder may have been removed since its parent was enumerated.
+		if (!res)
+		{
+			return false;
+		}
+
+		lastWriteTime = attributeData.ftLastWriteTime;
+		attributes = attributeData.dwFileAttributes;
+	}
+
+	if (!populateCloudFolders && WI_IsFlagSet(attributes, FILE_ATTRIBUTE_RECALL_ON_OPEN))
+	{
+		unpopulated = true;
+		return true;
+	}
+
+	std::optional<FolderContents> cachedContents;
+
+	if (cache)
+	{
+		cachedContents = cache->GetFolderContents(folder.path, lastWriteTime);
+	}
+
+	std::vector<SubfolderDetails> subfolderDetails;
+
+	if (cachedContents)
+	{
+		contents = std::move(*cachedContents);
+	}
+	else
+	{
+		bool completed = EnumerateFolder(folder.path, stopToken, contents, subfolderDetails);
+
+		if (!completed)
+		{
+			return false;
+		}
+
+		if (cache)
+		{
+			cache->SetFolderContents(folder.path, lastWriteTime, contents);
+		}
+	}
+
+	for (size_t i = 0; i < contents.subfolders.size(); i++)
+	{
+		PendingFolder subfolder;
+		subfolder.path = CombinePath(folder.path, contents.subfolders[i]);
+
+		if (i < subfolderDetails.size())
+		{
+			subfolder.lastWriteTime = subfolderDetails[i].lastWriteTime;
+			subfolder.attributes = subfolderDetails[i].attributes;
 		}
+
+		subfolders.push_back(std::move(subfolder));
 	}
 
-	return folderInfo;
+	return true;
+}
+
 }
 
-DWORD WINAPI Thread_CalculateFolderSize(LPVOID lpParameter)
+void WalkFolder(const std::wstring &path, const FolderVisitCallback &visitCallback,
+	std::stop_token stopToken, const std::function<void()> &periodicCallback,
+	FolderContentsCache *cache, bool populateCloudFolders)
 {
-	FolderSize_t *pFolderSize = reinterpret_cast<FolderSize_t *>(lpParameter);
+	ParallelWalk<PendingFolder>::Run(
+		{ path, std::nullopt },
+		[&visitCallback, &stopToken, cache, populateCloudFolders](
+			const PendingFolder &folder, ParallelWalk<PendingFolder>::Worker &worker) {
+			FolderVisit visit;
+			std::vector<PendingFolder> subfolders;
+
+			if (!ProcessFolder(folder, stopToken, cache, populateCloudFolders, visit.contents,
+					subfolders, visit.unpopulated))
+			{
+				return;
+			}
+
+			visit.path = folder.path;
+
+			for (const auto &subfolder : subfolders)
+			{
+				visit.subfolderPaths.push_back(subfolder.path);
+			}
 
-	auto folderInfo = GetFolderInfo(pFolderSize->szPath);
+			// The callback is invoked before any of the subfolders are queued, so it will always
+			// see a folder before it sees any of that folder's subfolders.
+			visitCallback(visit);
 
-	ULARGE_INTEGER size;
-	size.QuadPart = folderInfo.size;
+			for (auto &subfolder : subfolders)
+			{
+				worker.AddItem(std::move(subfolder));
+			}
+		},
+		stopToken, periodicCallback);
+}
+
+FolderInfo GetFolderInfo(const std::wstring &path, std::stop_token stopToken,
+	const FolderInfoProgressCallback &progressCallback, FolderContentsCache *cache,
+	bool populateCloudFolders)
+{
+	std::atomic<std::uintmax_t> size = 0;
+	std::atomic<int> numFolders = 0;
+	std::atomic<int> numFiles = 0;
+	std::atomic<int> numUnpopulatedFolders = 0;
 
-	pFolderSize->pfnCallback(folderInfo.numFolders, folderInfo.numFiles, &size, pFolderSize->pData);
+	auto getFolderInfo = [&size, &numFolders, &numFiles, &numUnpopulatedFolders]() {
+		FolderInfo folderInfo;
+		folderInfo.size = size;
+		folderInfo.numFolders = numFolders;
+		folderInfo.numFiles = numFiles;
+		folderInfo.numUnpopulatedFolders = numUnpopulatedFolders;
+		return folderInfo;
+	};
 
-	free(pFolderSize);
+	WalkFolder(
+		path,
+		[&size, &numFolders, &numFiles, &numUnpopulatedFolders](const FolderVisit &visit) {
+			if (visit.unpopulated)
+			{
+				numUnpopulatedFolders++;
+				return;
+			}
+
+			size += visit.contents.filesSize;
+			numFiles += visit.contents.numFiles;
+			numFolders += static_cast<int>(visit.subfolderPaths.size());
+		},
+		stopToken,
+		[&progressCallback, &getFolderInfo]() {
+			if (progressCallback)
+			{
+				progressCallback(getFolderInfo());
+			}
+		},
+		cache, populateCloudFolders);
 
-	return 1;
+	return getFolderInfo();
 }
\ No newline at end of file
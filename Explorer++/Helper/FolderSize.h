@@ -4,20 +4,84 @@
 
 #pragma once
 
+#include <functional>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <vector>
+
 struct FolderInfo
 {
 	std::uintmax_t size;
 	int numFolders;
 	int numFiles;
+
+	// The number of cloud placeholder folders that weren't enumerated (see GetFolderInfo()). When
+	// this is non-zero, the size doesn't include the contents of those folders.
+	int numUnpopulatedFolders;
+};
+
+// The items that are located directly within a single folder.
+struct FolderContents
+{
+	ULONGLONG filesSize = 0;
+	int numFiles = 0;
+	std::vector<std::wstring> subfolders;
+};
+
+// Allows the contents of individual folders to be retrieved from (and saved to) a cache while a
+// folder is being walked. Both methods may be called concurrently from each of the threads taking
+// part in the walk.
+class FolderContentsCache
+{
+public:
+	virtual ~FolderContentsCache() = default;
+
+	// Returns std::nullopt if the folder will need to be enumerated.
+	virtual std::optional<FolderContents> GetFolderContents(
+		const std::wstring &path, const FILETIME &lastWriteTime) = 0;
+	virtual void SetFolderContents(const std::wstring &path, const FILETIME &lastWriteTime,
+		const FolderContents &contents) = 0;
 };
 
-FolderInfo GetFolderInfo(const std::wstring &path);
+// Invoked periodically during a walk, with the totals found so far.
+using FolderInfoProgressCallback = std::function<void(const FolderInfo &partialFolderInfo)>;
 
-typedef struct
+// A single folder processed during a walk.
+struct FolderVisit
 {
-	TCHAR szPath[MAX_PATH];
-	LPVOID pData;
-	void (*pfnCallback)(int nFolders, int nFiles, PULARGE_INTEGER lTotalFolderSize, LPVOID pData);
-} FolderSize_t;
+	std::wstring path;
+	FolderContents contents;
+
+	// The full path of each of the subfolders listed in the contents.
+	std::vector<std::wstring> subfolderPaths;
+
+	// Set if the folder is a cloud placeholder that wasn't enumerated (see GetFolderInfo()), in
+	// which case the contents are empty.
+	bool unpopulated = false;
+};
+
+// Invoked concurrently from each of the threads taking part in a walk.
+using FolderVisitCallback = std::function<void(const FolderVisit &visit)>;
+
+// Walks the folder in the same way as GetFolderInfo() (see below), but reports the contents of
+// each folder, rather than just the overall totals. A folder is always reported before any of its
+// subfolders. The periodic callback is only invoked on the calling thread.
+void WalkFolder(const std::wstring &path, const FolderVisitCallback &visitCallback,
+	std::stop_token stopToken = {}, const std::function<void()> &periodicCallback = nullptr,
+	FolderContentsCache *cache = nullptr, bool populateCloudFolders = true);
 
-DWORD WINAPI Thread_CalculateFolderSize(LPVOID lpParameter);
\ No newline at end of file
+// Calculates the total size of the folder. Subfolders are distributed between the calling thread
+// and a small, shared set of worker threads, with idle threads taking queued subfolders from busy
+// ones. The progress callback is only invoked on the calling thread.
+//
+// If a stop is requested, the walk ends early and the returned information will be incomplete.
+// Folders that are reparse points (e.g. junctions) are skipped, so that no part of the tree is
+// counted twice.
+//
+// Enumerating a cloud placeholder folder whose contents haven't been retrieved yet causes them to
+// be downloaded. If populateCloudFolders is false, those folders are counted, but their contents
+// aren't.
+FolderInfo GetFolderInfo(const std::wstring &path, std::stop_token stopToken = {},
+	const FolderInfoProgressCallback &progressCallback = nullptr,
+	FolderContentsCache *cache = nullptr, bool populateCloudFolders = true);
\ No newline at end of file
@@ -0,0 +1,364 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "FolderSizeCache.h"
+#include <fstream>
+
+namespace
+{
+
+template <typename T>
+void WriteValue(std::ofstream &stream, const T &value)
+{
+	stream.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+void WriteString(std::ofstream &stream, const std::wstring &value)
+{
+	WriteValue(stream, static_cast<uint32_t>(value.size()));
+	stream.write(reinterpret_cast<const char *>(value.data()), value.size() * sizeof(wchar_t));
+}
+
+template <typename T>
+bool ReadValue(std::ifstream &stream, T &value)
+{
+	stream.read(reinterpret_cast<char *>(&value), sizeof(value));
+	return stream.good();
+}
+
+bool ReadString(std::ifstream &stream, std::wstring &value)
+{
+	uint32_t size;
+
+	if (!ReadValue(stream, size) || size > MAX_PATH * 128)
+	{
+		return false;
+	}
+
+	value.resize(size);
+	stream.read(reinterpret_cast<char *>(value.data()), size * sizeof(wchar_t));
+	return stream.good();
+}
+
+bool AreFileTimesEqual(const FILETIME &fileTime1, const FILETIME &fileTime2)
+{
+	return CompareFileTime(&fileTime1, &fileTime2) == 0;
+}
+
+}
+
+FolderSizeCache &FolderSizeCache::GetInstance()
+{
+	static FolderSizeCache folderSizeCache;
+	return folderSizeCache;
+}
+
+FolderInfo FolderSizeCache::GetFolderInfo(const std::wstring &path, std::stop_token stopToken,
+	const FolderInfoProgressCallback &progressCallback, bool populateCloudFolders)
+{
+	WIN32_FILE_ATTRIBUTE_DATA attributeData;
+	BOOL res = GetFileAttributesEx(path.c_str(), GetFileExInfoStandard, &attributeData);
+
+	if (!res)
+	{
+		return {};
+	}
+
+	FolderInfo folderInfo =
+		::GetFolderInfo(path, stopToken, progressCallback, this, populateCloudFolders);
+
+	// A partial total would otherwise be returned by GetCachedFolderInfo(), including when sorting
+	// a tab that does allow placeholders to be populated.
+	if (stopToken.stop_requested() || folderInfo.numUnpopulatedFolders > 0)
+	{
+		return folderInfo;
+	}
+
+	std::scoped_lock lock(m_mutex);
+
+	auto itr = m_entries.find(GetKey(path));
+
+	if (itr != m_entries.end()
+		&& AreFileTimesEqual(itr->second.lastWriteTime, attributeData.ftLastWriteTime))
+	{
+		itr->second.totalInfo = folderInfo;
+	}
+
+	return folderInfo;
+}
+
+void FolderSizeCache::WalkFolder(const std::wstring &path,
+	const FolderVisitCallback &visitCallback, std::stop_token stopToken,
+	const std::function<void()> &periodicCallback, bool populateCloudFolders)
+{
+	::WalkFolder(path, visitCallback, stopToken, periodicCallback, this, populateCloudFolders);
+}
+
+std::optional<FolderContents> FolderSizeCache::GetFolderContents(
+	const std::wstring &path, const FILETIME &lastWriteTime)
+{
+	std::scoped_lock lock(m_mutex);
+
+	auto itr = m_entries.find(GetKey(path));
+
+	if (itr == m_entries.end() || !AreFileTimesEqual(itr->second.lastWriteTime, lastWriteTime))
+	{
+		return std::nullopt;
+	}
+
+	FolderContents contents;
+	contents.filesSize = itr->second.filesSize;
+	contents.numFiles = itr->second.numFiles;
+	contents.subfolders = itr->second.subfolders;
+	return contents;
+}
+
+void FolderSizeCache::SetFolderContents(
+	const std::wstring &path, const FILETIME &lastWriteTime, const FolderContents &contents)
+{
+	std::wstring key = GetKey(path);
+
+	FolderEntry entry = {};
+	entry.lastWriteTime = lastWriteTime;
+	entry.filesSize = contents.filesSize;
+	entry.numFiles = contents.numFiles;
+	entry.subfolders = contents.subfolders;
+
+	std::scoped_lock lock(m_mutex);
+
+	if (m_entries.size() >= MAX_ENTRIES)
+	{
+		m_entries.clear();
+	}
+
+	m_entries.insert_or_assign(key, std::move(entry));
+
+	// The folder was enumerated because it had changed (or hadn't been seen before), so any totals
+	// that included its previous contents are out of date.
+	ClearParentTotals(key);
+}
+
+std::optional<FolderInfo> FolderSizeCache::GetCachedFolderInfo(
+	const std::wstring &path, const FILETIME &lastWriteTime)
+{
+	std::scoped_lock lock(m_mutex);
+
+	auto itr = m_entries.find(GetKey(path));
+
+	if (itr == m_entries.end() || !AreFileTimesEqual(itr->second.lastWriteTime, lastWriteTime))
+	{
+		return std::nullopt;
+	}
+
+	return itr->second.totalInfo;
+}
+
+void FolderSizeCache::InvalidateFolder(const std::wstring &path)
+{
+	std::wstring key = GetKey(path);
+
+	std::scoped_lock lock(m_mutex);
+
+	m_entries.erase(key);
+	ClearParentTotals(key);
+}
+
+void FolderSizeCache::OnFileSizeChanged(
+	const std::wstring &folderPath, ULONGLONG previousSize, ULONGLONG updatedSize)
+{
+	if (previousSize == updatedSize)
+	{
+		return;
+	}
+
+	std::scoped_lock lock(m_mutex);
+
+	std::wstring key = GetKey(folderPath);
+	auto itr = m_entries.find(key);
+
+	if (itr == m_entries.end())
+	{
+		// The folder size hasn't been calculated, so there's nothing to update.
+		return;
+	}
+
+	itr->second.filesSize += updatedSize - previousSize;
+
+	// Each of the parent folders includes this folder in its total, so the same adjustment can be
+	// applied to each one.
+	while (!key.empty())
+	{
+		itr = m_entries.find(key);
+
+		if (itr != m_entries.end() && itr->second.totalInfo)
+		{
+			itr->second.totalInfo->size += updatedSize - previousSize;
+		}
+
+		key = GetParentKey(key);
+	}
+}
+
+// The totals for each parent folder are based on the previous state of the folder, so they can no
+// longer be used. Those totals will be recalculated (without enumerating any folders that haven't
+// changed) the next time they're requested.
+void FolderSizeCache::ClearParentTotals(const std::wstring &key)
+{
+	for (std::wstring parentKey = GetParentKey(key); !parentKey.empty();
+		 parentKey = GetParentKey(parentKey))
+	{
+		auto itr = m_entries.find(parentKey);
+
+		if (itr != m_entries.end())
+		{
+			itr->second.totalInfo.reset();
+		}
+	}
+}
+
+bool FolderSizeCache::LoadFromFile(const std::wstring &filePath)
+{
+	std::ifstream stream(filePath, std::ios::binary);
+
+	if (!stream)
+	{
+		return false;
+	}
+
+	uint32_t signature;
+	uint32_t version;
+	uint32_t numEntries;
+
+	if (!ReadValue(stream, signature) || signature != FILE_SIGNATURE
+		|| !ReadValue(stream, version) || version != FILE_VERSION
+		|| !ReadValue(stream, numEntries) || numEntries > MAX_ENTRIES)
+	{
+		return false;
+	}
+
+	std::unordered_map<std::wstring, FolderEntry> entries;
+
+	for (uint32_t i = 0; i < numEntries; i++)
+	{
+		std::wstring key;
+		FolderEntry entry = {};
+		uint32_t numSubfolders;
+		bool hasTotal;
+
+		if (!ReadString(stream, key) || !ReadValue(stream, entry.lastWriteTime)
+			|| !ReadValue(stream, entry.filesSize) || !ReadValue(stream, entry.numFiles)
+			|| !ReadValue(stream, numSubfolders))
+		{
+			return false;
+		}
+
+		for (uint32_t j = 0; j < numSubfolders; j++)
+		{
+			std::wstring subfolder;
+
+			if (!ReadString(stream, subfolder))
+			{
+				return false;
+			}
+
+			entry.subfolders.push_back(std::move(subfolder));
+		}
+
+		if (!ReadValue(stream, hasTotal))
+		{
+			return false;
+		}
+
+		if (hasTotal)
+		{
+			FolderInfo totalInfo;
+
+			if (!ReadValue(stream, totalInfo))
+			{
+				return false;
+			}
+
+			entry.totalInfo = totalInfo;
+		}
+
+		entries.insert({ std::move(key), std::move(entry) });
+	}
+
+	std::scoped_lock lock(m_mutex);
+	m_entries = std::move(entries);
+
+	return true;
+}
+
+bool FolderSizeCache::SaveToFile(const std::wstring &filePath)
+{
+	std::ofstream stream(filePath, std::ios::binary | std::ios::trunc);
+
+	if (!stream)
+	{
+		return false;
+	}
+
+	std::scoped_lock lock(m_mutex);
+
+	WriteValue(stream, FILE_SIGNATURE);
+	WriteValue(stream, FILE_VERSION);
+	WriteValue(stream, static_cast<uint32_t>(m_entries.size()));
+
+	for (const auto &[key, entry] : m_entries)
+	{
+		WriteString(stream, key);
+		WriteValue(stream, entry.lastWriteTime);
+		WriteValue(stream, entry.filesSize);
+		WriteValue(stream, entry.numFiles);
+		WriteValue(stream, static_cast<uint32_t>(entry.subfolders.size()));
+
+		for (const auto &subfolder : entry.subfolders)
+		{
+			WriteString(stream, subfolder);
+		}
+
+		WriteValue(stream, entry.totalInfo.has_value());
+
+		if (entry.totalInfo)
+		{
+			WriteValue(stream, *entry.totalInfo);
+		}
+	}
+
+	return stream.good();
+}
+
+void FolderSizeCache::Clear()
+{
+	std::scoped_lock lock(m_mutex);
+	m_entries.clear();
+}
+
+std::wstring FolderSizeCache::GetKey(const std::wstring &path)
+{
+	std::wstring key = path;
+
+	while (key.size() > 1 && key.back() == '\\')
+	{
+		key.pop_back();
+	}
+
+	CharUpperBuff(key.data(), static_cast<DWORD>(key.size()));
+
+	return key;
+}
+
+std::wstring FolderSizeCache::GetParentKey(const std::wstring &key)
+{
+	auto position = key.find_last_of('\\');
+
+	if (position == std::wstring::npos)
+	{
+		return {};
+	}
+
+	return key.substr(0, position);
+}
\ No newline at end of file
@@ -0,0 +1,104 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "FolderSize.h"
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Caches the information needed to calculate the size of a folder, so that the folder doesn't have
+// to be walked again each time its size is displayed.
+//
+// Each folder has its own entry, which stores the total size of the files directly within the
+// folder, along with the names of its subfolders. An entry is only used while the last write time
+// of the folder matches the time stored with the entry. That time changes whenever an item is
+// created, deleted or renamed within the folder, so recalculating the size of a folder whose
+// structure hasn't changed only requires the last write time of each subfolder to be checked. Only
+// those folders that have changed are enumerated again.
+//
+// Changes to the size of an existing file don't affect the last write time of the parent folder.
+// Those changes are instead applied incrementally, via OnFileSizeChanged().
+class FolderSizeCache : private FolderContentsCache
+{
+public:
+	static FolderSizeCache &GetInstance();
+
+	// Calculates the size of the folder, reusing any valid cached information. The cache is
+	// updated with the result, unless the calculation is stopped. Totals that exclude unpopulated
+	// cloud folders (see ::GetFolderInfo()) aren't retained.
+	FolderInfo GetFolderInfo(const std::wstring &path, std::stop_token stopToken = {},
+		const FolderInfoProgressCallback &progressCallback = nullptr,
+		bool populateCloudFolders = true);
+
+	// Walks the folder (see ::WalkFolder()), reusing the cached contents of any folder that hasn't
+	// changed and caching the contents of any folder that has to be enumerated.
+	void WalkFolder(const std::wstring &path, const FolderVisitCallback &visitCallback,
+		std::stop_token stopToken = {}, const std::function<void()> &periodicCallback = nullptr,
+		bool populateCloudFolders = true);
+
+	// Returns the most recently calculated size of the folder, provided the folder hasn't been
+	// changed since (as determined by its last write time and any changes reported to this
+	// class). This doesn't access the filesystem, so it's cheap enough to be called when sorting.
+	std::optional<FolderInfo> GetCachedFolderInfo(
+		const std::wstring &path, const FILETIME &lastWriteTime);
+
+	// Should be called when an item is created, deleted or renamed within the specified folder.
+	// The folder will be enumerated again the next time its size is calculated. The sizes of its
+	// subfolders remain cached.
+	void InvalidateFolder(const std::wstring &path);
+
+	// Should be called when the size of a file directly within the specified folder changes. The
+	// cached size of the folder (and of each of its parent folders) is adjusted accordingly.
+	void OnFileSizeChanged(
+		const std::wstring &folderPath, ULONGLONG previousSize, ULONGLONG updatedSize);
+
+	bool LoadFromFile(const std::wstring &filePath);
+	bool SaveToFile(const std::wstring &filePath);
+
+	void Clear();
+
+private:
+	// The cache is cleared if it grows beyond this many folders, so that memory usage remains
+	// bounded when very large trees are walked.
+	static const size_t MAX_ENTRIES = 250000;
+
+	static constexpr uint32_t FILE_SIGNATURE = 0x43534645; // "EFSC"
+	static constexpr uint32_t FILE_VERSION = 3;
+
+	struct FolderEntry
+	{
+		FILETIME lastWriteTime;
+
+		// The files that are directly within the folder.
+		ULONGLONG filesSize;
+		int numFiles;
+
+		std::vector<std::wstring> subfolders;
+
+		// The total size of the folder, including all subfolders, as of the last time the size of
+		// this specific folder was requested.
+		std::optional<FolderInfo> totalInfo;
+	};
+
+	FolderSizeCache() = default;
+
+	static std::wstring GetKey(const std::wstring &path);
+	static std::wstring GetParentKey(const std::wstring &key);
+
+	// FolderContentsCache
+	std::optional<FolderContents> GetFolderContents(
+		const std::wstring &path, const FILETIME &lastWriteTime) override;
+	void SetFolderContents(const std::wstring &path, const FILETIME &lastWriteTime,
+		const FolderContents &contents) override;
+
+	void ClearParentTotals(const std::wstring &key);
+
+	std::mutex m_mutex;
+	std::unordered_map<std::wstring, FolderEntry> m_entries;
+};
\ No newline at end of file
@@ -0,0 +1,271 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "GridRenderer.h"
+#include <boost/functional/hash.hpp>
+
+GridRenderer::GridRenderer()
+{
+	HRESULT hr = D2D1CreateFactory(D2D1_FACTORY_TYPE_SINGLE_THREADED, &m_d2dFactory);
+
+	if (FAILED(hr))
+	{
+		return;
+	}
+
+	hr = DWriteCreateFactory(DWRITE_FACTORY_TYPE_SHARED, __uuidof(IDWriteFactory),
+		reinterpret_cast<IUnknown **>(&m_dwriteFactory));
+
+	if (FAILED(hr))
+	{
+		m_d2dFactory.reset();
+	}
+}
+
+bool GridRenderer::IsAvailable() const
+{
+	return m_d2dFactory && m_dwriteFactory;
+}
+
+bool GridRenderer::BeginDraw(HDC hdc, const RECT &rect, HFONT font)
+{
+	if (!IsAvailable() || !UpdateTextFormat(font))
+	{
+		return false;
+	}
+
+	if (!m_renderTarget)
+	{
+		// The DPI is fixed at 96, so that a device-independent pixel is always a single pixel.
+		// The GDI compatible usage is what allows DrawWithGdi() to work.
+		auto properties = D2D1::RenderTargetProperties(D2D1_RENDER_TARGET_TYPE_DEFAULT,
+			D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_IGNORE), 96.0f, 96.0f,
+			D2D1_RENDER_TARGET_USAGE_GDI_COMPATIBLE);
+		HRESULT hr = m_d2dFactory->CreateDCRenderTarget(&properties, &m_renderTarget);
+
+		if (FAILED(hr))
+		{
+			return false;
+		}
+
+		hr = m_renderTarget->CreateSolidColorBrush(ConvertColor(0), &m_brush);
+
+		if (FAILED(hr))
+		{
+			m_renderTarget.reset();
+			return false;
+		}
+	}
+
+	HRESULT hr = m_renderTarget->BindDC(hdc, &rect);
+
+	if (FAILED(hr))
+	{
+		return false;
+	}
+
+	m_drawRect = rect;
+
+	m_renderTarget->BeginDraw();
+
+	// The bound rect becomes the origin of the render target, so this translation allows the
+	// drawing methods to use client coordinates.
+	m_renderTarget->SetTransform(D2D1::Matrix3x2F::Translation(
+		static_cast<float>(-rect.left), static_cast<float>(-rect.top)));
+
+	return true;
+}
+
+void GridRenderer::FillRectangle(const RECT &rect, COLORREF color)
+{
+	m_brush->SetColor(ConvertColor(color));
+	m_renderTarget->FillRectangle(
+		D2D1::RectF(static_cast<float>(rect.left), static_cast<float>(rect.top),
+			static_cast<float>(rect.right), static_cast<float>(rect.bottom)),
+		m_brush.get());
+}
+
+void GridRenderer::DrawString(
+	const std::wstring &text, const RECT &rect, COLORREF color, TextAlignment alignment)
+{
+	if (text.empty() || rect.right <= rect.left || rect.bottom <= rect.top)
+	{
+		return;
+	}
+
+	IDWriteTextLayout *layout =
+		GetTextLayout(text, rect.right - rect.left, rect.bottom - rect.top, alignment);
+
+	if (!layout)
+	{
+		return;
+	}
+
+	m_brush->SetColor(ConvertColor(color));
+	m_renderTarget->DrawTextLayout(
+		D2D1::Point2F(static_cast<float>(rect.left), static_cast<float>(rect.top)), layout,
+		m_brush.get(), D2D1_DRAW_TEXT_OPTIONS_CLIP);
+}
+
+void GridRenderer::DrawWithGdi(const std::function<void(HDC hdc)> &draw)
+{
+	wil::com_ptr_nothrow<ID2D1GdiInteropRenderTarget> interopTarget;
+	HRESULT hr = m_renderTarget->QueryInterface(IID_PPV_ARGS(&interopTarget));
+
+	if (FAILED(hr))
+	{
+		return;
+	}
+
+	HDC hdc;
+	hr = interopTarget->GetDC(D2D1_DC_INITIALIZE_MODE_COPY, &hdc);
+
+	if (FAILED(hr))
+	{
+		return;
+	}
+
+	// As with the transform set in BeginDraw(), this allows client coordinates to be used.
+	POINT previousOrigin;
+	SetViewportOrgEx(hdc, -m_drawRect.left, -m_drawRect.top, &previousOrigin);
+
+	draw(hdc);
+
+	SetViewportOrgEx(hdc, previousOrigin.x, previousOrigin.y, nullptr);
+	interopTarget->ReleaseDC(nullptr);
+}
+
+void GridRenderer::EndDraw()
+{
+	HRESULT hr = m_renderTarget->EndDraw();
+
+	// The render target and any resources created from it need to be created again in this case.
+	if (hr == D2DERR_RECREATE_TARGET)
+	{
+		m_brush.reset();
+		m_renderTarget.reset();
+	}
+}
+
+bool GridRenderer::UpdateTextFormat(HFONT font)
+{
+	LOGFONT logFont;
+
+	if (GetObject(font, sizeof(logFont), &logFont) == 0)
+	{
+		return false;
+	}
+
+	if (m_textFormat && memcmp(&logFont, &m_logFont, sizeof(logFont)) == 0)
+	{
+		return true;
+	}
+
+	// DirectWrite sizes fonts by their em height, which is the cell height without the internal
+	// leading.
+	wil::unique_hdc_window screenDC(GetDC(nullptr));
+	auto selectFont = wil::SelectObject(screenDC.get(), font);
+
+	TEXTMETRIC textMetrics;
+
+	if (!GetTextMetrics(screenDC.get(), &textMetrics))
+	{
+		return false;
+	}
+
+	float fontSize = static_cast<float>(textMetrics.tmHeight - textMetrics.tmInternalLeading);
+	auto weight = static_cast<DWRITE_FONT_WEIGHT>(
+		logFont.lfWeight == FW_DONTCARE ? FW_NORMAL : logFont.lfWeight);
+
+	wil::com_ptr_nothrow<IDWriteTextFormat> textFormat;
+	HRESULT hr = m_dwriteFactory->CreateTextFormat(logFont.lfFaceName, nullptr, weight,
+		logFont.lfItalic ? DWRITE_FONT_STYLE_ITALIC : DWRITE_FONT_STYLE_NORMAL,
+		DWRITE_FONT_STRETCH_NORMAL, fontSize, L"", &textFormat);
+
+	if (FAILED(hr))
+	{
+		return false;
+	}
+
+	// Text that doesn't fit within its cell is truncated with an ellipsis, as it is in a listview.
+	wil::com_ptr_nothrow<IDWriteInlineObject> ellipsis;
+	hr = m_dwriteFactory->CreateEllipsisTrimmingSign(textFormat.get(), &ellipsis);
+
+	if (FAILED(hr))
+	{
+		return false;
+	}
+
+	DWRITE_TRIMMING trimming = { DWRITE_TRIMMING_GRANULARITY_CHARACTER, 0, 0 };
+	textFormat->SetTrimming(&trimming, ellipsis.get());
+	textFormat->SetWordWrapping(DWRITE_WORD_WRAPPING_NO_WRAP);
+	textFormat->SetParagraphAlignment(DWRITE_PARAGRAPH_ALIGNMENT_CENTER);
+
+	m_textFormat = std::move(textFormat);
+	m_ellipsis = std::move(ellipsis);
+	m_logFont = logFont;
+
+	// Existing layouts all refer to the previous font.
+	m_cachedLayoutIndex.clear();
+	m_cachedLayouts.clear();
+
+	return true;
+}
+
+IDWriteTextLayout *GridRenderer::GetTextLayout(
+	const std::wstring &text, int width, int height, TextAlignment alignment)
+{
+	auto itr = m_cachedLayoutIndex.find({ text, width, height, alignment });
+
+	if (itr != m_cachedLayoutIndex.end())
+	{
+		m_cachedLayouts.splice(m_cachedLayouts.begin(), m_cachedLayouts, itr->second);
+		return itr->second->layout.get();
+	}
+
+	wil::com_ptr_nothrow<IDWriteTextLayout> layout;
+	HRESULT hr = m_dwriteFactory->CreateTextLayout(text.c_str(),
+		static_cast<UINT32>(text.size()), m_textFormat.get(), static_cast<float>(width),
+		static_cast<float>(height), &layout);
+
+	if (FAILED(hr))
+	{
+		return nullptr;
+	}
+
+	layout->SetTextAlignment(alignment == TextAlignment::Right ? DWRITE_TEXT_ALIGNMENT_TRAILING
+															   : DWRITE_TEXT_ALIGNMENT_LEADING);
+
+	if (m_cachedLayouts.size() >= MAX_CACHED_LAYOUTS)
+	{
+		m_cachedLayoutIndex.erase(m_cachedLayouts.back().GetKey());
+		m_cachedLayouts.pop_back();
+	}
+
+	m_cachedLayouts.push_front({ text, width, height, alignment, std::move(layout) });
+	m_cachedLayoutIndex.emplace(m_cachedLayouts.front().GetKey(), m_cachedLayouts.begin());
+
+	return m_cachedLayouts.front().layout.get();
+}
+
+GridRenderer::LayoutKey GridRenderer::CachedLayout::GetKey() const
+{
+	return { text, width, height, alignment };
+}
+
+size_t GridRenderer::LayoutKeyHash::operator()(const LayoutKey &key) const
+{
+	size_t seed = std::hash<std::wstring_view>{}(key.text);
+	boost::hash_combine(seed, key.width);
+	boost::hash_combine(seed, key.height);
+	boost::hash_combine(seed, static_cast<int>(key.alignment));
+	return seed;
+}
+
+D2D1_COLOR_F GridRenderer::ConvertColor(COLORREF color)
+{
+	return D2D1::ColorF(GetRValue(color) / 255.0f, GetGValue(color) / 255.0f,
+		GetBValue(color) / 255.0f);
+}
\ No newline at end of file
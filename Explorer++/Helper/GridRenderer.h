@@ -0,0 +1,103 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <wil/com.h>
+#include <d2d1.h>
+#include <dwrite.h>
+#include <functional>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Draws rows of text into a window's device context using Direct2D and DirectWrite. Everything is
+// drawn into an offscreen bitmap, which is copied to the device context once drawing has finished,
+// so there's no flicker.
+//
+// Laying out a string (which includes shaping it into glyph runs) is the most expensive part of
+// drawing text. The layout for each string is cached, so a string that's redrawn (e.g. because the
+// view was scrolled, or because it appears in many rows) only has to be laid out once. Strings
+// that haven't been drawn recently are evicted once the cache is full.
+//
+// All methods must be called on the same thread.
+class GridRenderer
+{
+public:
+	enum class TextAlignment
+	{
+		Left,
+		Right
+	};
+
+	GridRenderer();
+
+	// Returns false if Direct2D or DirectWrite isn't available.
+	bool IsAvailable() const;
+
+	// The rect is in client coordinates. All subsequent drawing uses the same coordinates and is
+	// clipped to the rect.
+	bool BeginDraw(HDC hdc, const RECT &rect, HFONT font);
+	void FillRectangle(const RECT &rect, COLORREF color);
+	void DrawString(
+		const std::wstring &text, const RECT &rect, COLORREF color, TextAlignment alignment);
+
+	// Allows content that can only be drawn with GDI (such as image list icons) to be drawn into
+	// the same bitmap. The device context passed to the callback uses client coordinates as well.
+	void DrawWithGdi(const std::function<void(HDC hdc)> &draw);
+
+	void EndDraw();
+
+private:
+	struct LayoutKey
+	{
+		std::wstring_view text;
+		int width;
+		int height;
+		TextAlignment alignment;
+
+		bool operator==(const LayoutKey &) const = default;
+	};
+
+	struct LayoutKeyHash
+	{
+		size_t operator()(const LayoutKey &key) const;
+	};
+
+	struct CachedLayout
+	{
+		std::wstring text;
+		int width;
+		int height;
+		TextAlignment alignment;
+		wil::com_ptr_nothrow<IDWriteTextLayout> layout;
+
+		// The key refers to the copy of the text held by this entry.
+		LayoutKey GetKey() const;
+	};
+
+	using CachedLayoutList = std::list<CachedLayout>;
+
+	static constexpr size_t MAX_CACHED_LAYOUTS = 8192;
+
+	bool UpdateTextFormat(HFONT font);
+	IDWriteTextLayout *GetTextLayout(
+		const std::wstring &text, int width, int height, TextAlignment alignment);
+	static D2D1_COLOR_F ConvertColor(COLORREF color);
+
+	wil::com_ptr_nothrow<ID2D1Factory> m_d2dFactory;
+	wil::com_ptr_nothrow<IDWriteFactory> m_dwriteFactory;
+	wil::com_ptr_nothrow<ID2D1DCRenderTarget> m_renderTarget;
+	wil::com_ptr_nothrow<ID2D1SolidColorBrush> m_brush;
+	RECT m_drawRect = {};
+
+	wil::com_ptr_nothrow<IDWriteTextFormat> m_textFormat;
+	wil::com_ptr_nothrow<IDWriteInlineObject> m_ellipsis;
+	LOGFONT m_logFont = {};
+
+	// Ordered from most to least recently used.
+	CachedLayoutList m_cachedLayouts;
+	std::unordered_map<LayoutKey, CachedLayoutList::iterator, LayoutKeyHash> m_cachedLayoutIndex;
+};
\ No newline at end of file
@@ -0,0 +1,67 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "HangDetector.h"
+
+HangDetector::HangDetector(Clock::duration threshold) : m_threshold(threshold)
+{
+}
+
+HangDetector::Action HangDetector::Check(Clock::time_point now, uint64_t lastAcknowledgedPingId)
+{
+	// If the watchdog itself hasn't run for longer than the threshold (e.g. because the computer
+	// was asleep), the time the outstanding ping has been waiting says nothing about the monitored
+	// thread, so the wait starts over.
+	if (m_checked && m_pingPending && !m_hangReported && (now - m_lastCheckTime) > m_threshold)
+	{
+		m_pingSentTime = now;
+	}
+
+	m_lastCheckTime = now;
+	m_checked = true;
+
+	if (m_pingPending && lastAcknowledgedPingId >= m_pendingPingId)
+	{
+		m_pingPending = false;
+
+		if (m_hangReported)
+		{
+			m_hangReported = false;
+			m_lastHangDuration = now - m_pingSentTime;
+			return Action::HangEnded;
+		}
+	}
+
+	if (!m_pingPending)
+	{
+		m_pendingPingId++;
+		m_pingPending = true;
+		m_pingSentTime = now;
+		return Action::SendPing;
+	}
+
+	if (!m_hangReported && (now - m_pingSentTime) >= m_threshold)
+	{
+		m_hangReported = true;
+		return Action::ReportHang;
+	}
+
+	return Action::None;
+}
+
+uint64_t HangDetector::GetPendingPingId() const
+{
+	return m_pendingPingId;
+}
+
+HangDetector::Clock::duration HangDetector::GetHangDuration(Clock::time_point now) const
+{
+	if (!m_pingPending)
+	{
+		return m_lastHangDuration;
+	}
+
+	return now - m_pingSentTime;
+}
\ No newline at end of file
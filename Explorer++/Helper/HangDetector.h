@@ -0,0 +1,61 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// Decides when a thread with a message loop should be considered hung. A watchdog periodically
+// sends a ping to the thread and the thread acknowledges each ping once it's processed it. If a
+// ping isn't acknowledged within the threshold, the thread is hung. An idle thread will acknowledge
+// pings immediately, so only a thread that's actually busy can be reported.
+//
+// Only a single report is generated for each hang. Should only be used from a single thread (i.e.
+// the watchdog thread).
+class HangDetector
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	enum class Action
+	{
+		None,
+
+		// A new ping (with the id returned by GetPendingPingId()) should be sent.
+		SendPing,
+
+		// The thread has just been found to be hung.
+		ReportHang,
+
+		// A thread that was previously reported as hung has become responsive again.
+		HangEnded
+	};
+
+	explicit HangDetector(Clock::duration threshold);
+
+	// Should be called periodically. lastAcknowledgedPingId is the id of the most recent ping that
+	// the monitored thread has processed.
+	Action Check(Clock::time_point now, uint64_t lastAcknowledgedPingId);
+
+	uint64_t GetPendingPingId() const;
+
+	// Returns how long the outstanding ping has been waiting. For a hang that's just ended, this is
+	// the total length of the hang.
+	Clock::duration GetHangDuration(Clock::time_point now) const;
+
+private:
+	const Clock::duration m_threshold;
+
+	uint64_t m_pendingPingId = 0;
+	bool m_pingPending = false;
+	Clock::time_point m_pingSentTime;
+	bool m_hangReported = false;
+
+	// The duration of the most recent hang, set once the hang has ended.
+	Clock::duration m_lastHangDuration = {};
+
+	Clock::time_point m_lastCheckTime;
+	bool m_checked = false;
+};
\ No newline at end of file
@@ -4,10 +4,8 @@
 
 #include "stdafx.h"
 #include "Helper.h"
+#include "DisplayFormatter.h"
 #include "Macros.h"
-#include "TimeHelper.h"
-#include <boost/date_time/gregorian/gregorian.hpp>
-#include <boost/date_time/posix_time/posix_time.hpp>
 
 enum class VersionSubBlockType
 {
@@ -26,103 +24,29 @@ BOOL GetStringTableValue(void *pBlock, LangAndCodePage *plcp, UINT nItems,
 BOOL CreateFileTimeString(
 	const FILETIME *utcFileTime, TCHAR *szBuffer, size_t cchMax, BOOL bFriendlyDate)
 {
-	SYSTEMTIME localSystemTime;
-	BOOL ret = FileTimeToLocalSystemTime(utcFileTime, &localSystemTime);
+	auto formattedTime = GetDisplayFormatter().FormatFileTime(*utcFileTime, bFriendlyDate);
 
-	if (!ret)
+	if (!formattedTime)
 	{
 		return FALSE;
 	}
 
-	return CreateSystemTimeString(&localSystemTime, szBuffer, cchMax, bFriendlyDate);
+	StringCchCopy(szBuffer, cchMax, formattedTime->c_str());
+	return TRUE;
 }
 
 BOOL CreateSystemTimeString(
 	const SYSTEMTIME *localSystemTime, TCHAR *szBuffer, size_t cchMax, BOOL bFriendlyDate)
 {
-	if (bFriendlyDate)
-	{
-		BOOL ret = CreateFriendlySystemTimeString(localSystemTime, szBuffer, cchMax);
-
-		if (ret)
-		{
-			return TRUE;
-		}
-	}
-
-	TCHAR dateBuffer[512];
-	int iReturn1 = GetDateFormat(LOCALE_USER_DEFAULT, LOCALE_USE_CP_ACP, localSystemTime, nullptr,
-		dateBuffer, SIZEOF_ARRAY(dateBuffer));
-
-	TCHAR timeBuffer[512];
-	int iReturn2 = GetTimeFormat(LOCALE_USER_DEFAULT, LOCALE_USE_CP_ACP, localSystemTime, nullptr,
-		timeBuffer, SIZEOF_ARRAY(timeBuffer));
-
-	if ((iReturn1 != 0) && (iReturn2 != 0))
-	{
-		StringCchPrintf(szBuffer, cchMax, _T("%s %s"), dateBuffer, timeBuffer);
-		return TRUE;
-	}
-
-	return FALSE;
-}
-
-BOOL CreateFriendlySystemTimeString(
-	const SYSTEMTIME *localSystemTime, TCHAR *szBuffer, size_t cchMax)
-{
-	using namespace boost::gregorian;
-	using namespace boost::posix_time;
-
-	FILETIME localFileTime;
-	BOOL ret = SystemTimeToFileTime(localSystemTime, &localFileTime);
-
-	if (!ret)
-	{
-		return FALSE;
-	}
-
-	TCHAR dateComponent[512];
-	bool dateComponentSet = false;
-
-	auto inputPosixTime = from_ftime<ptime>(localFileTime);
-	date inputDate = inputPosixTime.date();
-
-	date today = day_clock::local_day();
-	date yesterday = today - days(1);
-
-	if (inputDate == today)
-	{
-		StringCchCopy(dateComponent, SIZEOF_ARRAY(dateComponent), _T("Today"));
-		dateComponentSet = true;
-	}
-	else if (inputDate == yesterday)
-	{
-		StringCchCopy(dateComponent, SIZEOF_ARRAY(dateComponent), _T("Yesterday"));
-		dateComponentSet = true;
-	}
+	auto formattedTime = GetDisplayFormatter().FormatSystemTime(*localSystemTime, bFriendlyDate);
 
-	if (!dateComponentSet)
+	if (!formattedTime)
 	{
 		return FALSE;
 	}
 
-	TCHAR timeComponent[512];
-	int timeFormatted = GetTimeFormat(LOCALE_USER_DEFAULT, LOCALE_USE_CP_ACP, localSystemTime,
-		nullptr, timeComponent, SIZEOF_ARRAY(timeComponent));
-
-	if (timeFormatted == 0)
-	{
-		return FALSE;
-	}
-
-	HRESULT hr = StringCchPrintf(szBuffer, cchMax, _T("%s, %s"), dateComponent, timeComponent);
-
-	if (SUCCEEDED(hr))
-	{
-		return TRUE;
-	}
-
-	return FALSE;
+	StringCchCopy(szBuffer, cchMax, formattedTime->c_str());
+	return TRUE;
 }
 
 HINSTANCE StartCommandPrompt(const std::wstring &directory, bool elevated)
@@ -242,28 +166,35 @@ void EnterAttributeIntoString(BOOL bEnter, TCHAR *string, int pos, TCHAR chAttri
 	}
 }
 
-BOOL GetFileOwner(const TCHAR *szFile, TCHAR *szOwner, size_t cchMax)
+std::optional<std::wstring> GetFileOwnerSid(const std::wstring &path)
 {
-	BOOL success = FALSE;
+	wil::unique_hfile file(CreateFile(path.c_str(), READ_CONTROL, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr));
 
-	wil::unique_hfile file(CreateFile(szFile, READ_CONTROL, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
-		FILE_FLAG_BACKUP_SEMANTICS, nullptr));
+	if (!file)
+	{
+		return std::nullopt;
+	}
 
-	if (file)
+	PSID pSidOwner = nullptr;
+	wil::unique_hlocal_security_descriptor securityDescriptor;
+	DWORD dwRet = GetSecurityInfo(file.get(), SE_FILE_OBJECT, OWNER_SECURITY_INFORMATION,
+		&pSidOwner, nullptr, nullptr, nullptr, wil::out_param(securityDescriptor));
+
+	if (dwRet != ERROR_SUCCESS)
 	{
-		PSID pSidOwner = nullptr;
-		PSECURITY_DESCRIPTOR pSD = nullptr;
-		DWORD dwRet = GetSecurityInfo(file.get(), SE_FILE_OBJECT, OWNER_SECURITY_INFORMATION,
-			&pSidOwner, nullptr, nullptr, nullptr, &pSD);
+		return std::nullopt;
+	}
 
-		if (dwRet == ERROR_SUCCESS)
-		{
-			success = FormatUserName(pSidOwner, szOwner, cchMax);
-			LocalFree(pSD);
-		}
+	wil::unique_hlocal_string stringSid;
+	BOOL res = ConvertSidToStringSid(pSidOwner, wil::out_param(stringSid));
+
+	if (!res)
+	{
+		return std::nullopt;
 	}
 
-	return success;
+	return stringSid.get();
 }
 
 BOOL FormatUserName(PSID sid, TCHAR *userName, size_t cchMax)
@@ -345,7 +276,7 @@ DWORD GetNumFileHardLinks(const TCHAR *lpszFileName)
 	DWORD nLinks = 0;
 
 	wil::unique_hfile file(CreateFile(lpszFileName, FILE_READ_ATTRIBUTES, FILE_SHARE_READ, nullptr,
-		OPEN_EXISTING, NULL, nullptr));
+		OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr));
 
 	if (file)
 	{
@@ -435,43 +366,6 @@ BOOL ReadImageProperty(const TCHAR *lpszImage, PROPID propId, TCHAR *szProperty,
 	return bSuccess;
 }
 
-BOOL GetFileNameFromUser(HWND hwnd, TCHAR *fullFileName, UINT cchMax, const TCHAR *initialDirectory)
-{
-	/* As per the documentation for
-	the OPENFILENAME structure, the
-	length of the filename buffer
-	should be at least 256. */
-	assert(cchMax >= 256);
-
-	const TCHAR *filter = _T("Text Document (*.txt)\0*.txt\0All Files\0*.*\0\0");
-	OPENFILENAME ofn;
-	BOOL bRet;
-
-	ofn.lStructSize = sizeof(ofn);
-	ofn.hwndOwner = hwnd;
-	ofn.lpstrFilter = filter;
-	ofn.lpstrCustomFilter = nullptr;
-	ofn.nMaxCustFilter = 0;
-	ofn.nFilterIndex = 0;
-	ofn.lpstrFile = fullFileName;
-	ofn.nMaxFile = cchMax;
-	ofn.lpstrFileTitle = nullptr;
-	ofn.nMaxFileTitle = 0;
-	ofn.lpstrInitialDir = initialDirectory;
-	ofn.lpstrTitle = nullptr;
-	ofn.Flags = OFN_ENABLESIZING | OFN_OVERWRITEPROMPT | OFN_EXPLORER;
-	ofn.lpstrDefExt = _T("txt");
-	ofn.lCustData = NULL;
-	ofn.lpfnHook = nullptr;
-	ofn.pvReserved = nullptr;
-	ofn.dwReserved = NULL;
-	ofn.FlagsEx = NULL;
-
-	bRet = GetSaveFileName(&ofn);
-
-	return bRet;
-}
-
 BOOL IsImage(const TCHAR *szFileName)
 {
 	static const TCHAR *IMAGE_EXTS[] = { _T("bmp"), _T("ico"), _T("gif"), _T("jpg"), _T("exf"),
@@ -519,6 +413,54 @@ BOOL GetVersionInfoString(
 		nullptr, nullptr, szVersionInfo, szVersionBuffer, cchMax);
 }
 
+std::vector<BYTE> ReadFileVersionInfo(const TCHAR *szFullFileName)
+{
+	DWORD dwLen = GetFileVersionInfoSize(szFullFileName, nullptr);
+
+	if (dwLen == 0)
+	{
+		return {};
+	}
+
+	std::vector<BYTE> versionInfo(dwLen);
+	BOOL bRet = GetFileVersionInfo(szFullFileName, NULL, dwLen, versionInfo.data());
+
+	if (!bRet)
+	{
+		return {};
+	}
+
+	return versionInfo;
+}
+
+BOOL GetVersionInfoString(std::vector<BYTE> &versionInfo, const TCHAR *szVersionInfo,
+	TCHAR *szVersionBuffer, UINT cchMax)
+{
+	if (versionInfo.empty())
+	{
+		return FALSE;
+	}
+
+	LangAndCodePage *plcp = nullptr;
+	UINT uLen;
+	BOOL bRet = VerQueryValue(versionInfo.data(), _T("\\VarFileInfo\\Translation"),
+		reinterpret_cast<LPVOID *>(&plcp), &uLen);
+
+	if (!bRet || (uLen < sizeof(LangAndCodePage)))
+	{
+		return FALSE;
+	}
+
+	return GetStringTableValue(versionInfo.data(), plcp, uLen / sizeof(LangAndCodePage),
+		szVersionInfo, szVersionBuffer, cchMax);
+}
+
+bool IsCloudPlaceholder(DWORD fileAttributes)
+{
+	return WI_IsAnyFlagSet(
+		fileAttributes, FILE_ATTRIBUTE_RECALL_ON_DATA_ACCESS | FILE_ATTRIBUTE_RECALL_ON_OPEN);
+}
+
 BOOL GetFileVersionValue(const TCHAR *szFullFileName, VersionSubBlockType subBlockType,
 	WORD *pwLanguage, DWORD *pdwProductVersionLS, DWORD *pdwProductVersionMS,
 	const TCHAR *szVersionInfo, TCHAR *szVersionBuffer, UINT cchMax)
@@ -642,70 +584,6 @@ void GetCPUBrandString(char *pszCPUBrand, UINT cchBuf)
 	StringCchCopyA(pszCPUBrand, cchBuf, szCPUBrand);
 }
 
-HRESULT GetMediaMetadata(const TCHAR *szFileName, const TCHAR *szAttribute, BYTE **pszOutput)
-{
-	typedef HRESULT(WINAPI * WMCREATEEDITOR_PROC)(IWMMetadataEditor **);
-	WMCREATEEDITOR_PROC pWMCreateEditor = nullptr;
-	HMODULE hWMVCore;
-	IWMMetadataEditor *pEditor = nullptr;
-	IWMHeaderInfo *pWMHeaderInfo = nullptr;
-	HRESULT hr = E_FAIL;
-
-	hWMVCore = LoadLibrary(_T("wmvcore.dll"));
-
-	if (hWMVCore != nullptr)
-	{
-		pWMCreateEditor = (WMCREATEEDITOR_PROC) GetProcAddress(hWMVCore, "WMCreateEditor");
-
-		if (pWMCreateEditor != nullptr)
-		{
-			hr = pWMCreateEditor(&pEditor);
-
-			if (SUCCEEDED(hr))
-			{
-				hr = pEditor->Open(szFileName);
-
-				if (SUCCEEDED(hr))
-				{
-					hr = pEditor->QueryInterface(IID_PPV_ARGS(&pWMHeaderInfo));
-
-					if (SUCCEEDED(hr))
-					{
-						WORD wStreamNum;
-						WMT_ATTR_DATATYPE type;
-						WORD cbLength;
-
-						/* Any stream. Should be zero for MP3 files. */
-						wStreamNum = 0;
-
-						hr = pWMHeaderInfo->GetAttributeByName(
-							&wStreamNum, szAttribute, &type, nullptr, &cbLength);
-
-						if (SUCCEEDED(hr))
-						{
-							*pszOutput = (BYTE *) malloc(cbLength);
-
-							if (*pszOutput != nullptr)
-							{
-								hr = pWMHeaderInfo->GetAttributeByName(
-									&wStreamNum, szAttribute, &type, *pszOutput, &cbLength);
-							}
-						}
-
-						pWMHeaderInfo->Release();
-					}
-				}
-
-				pEditor->Release();
-			}
-		}
-
-		FreeLibrary(hWMVCore);
-	}
-
-	return hr;
-}
-
 void SetFORMATETC(FORMATETC *pftc, CLIPFORMAT cfFormat, DVTARGETDEVICE *ptd, DWORD dwAspect,
 	LONG lindex, DWORD tymed)
 {
@@ -12,6 +12,7 @@
 #include <list>
 #include <optional>
 #include <string>
+#include <vector>
 
 struct LangAndCodePage
 {
@@ -32,16 +33,12 @@ BOOL CreateFileTimeString(
 	const FILETIME *utcFileTime, TCHAR *szBuffer, size_t cchMax, BOOL bFriendlyDate);
 BOOL CreateSystemTimeString(
 	const SYSTEMTIME *localSystemTime, TCHAR *szBuffer, size_t cchMax, BOOL bFriendlyDate);
-BOOL CreateFriendlySystemTimeString(
-	const SYSTEMTIME *localSystemTime, TCHAR *szBuffer, size_t cchMax);
 BOOL GetFileSizeEx(const TCHAR *szFileName, PLARGE_INTEGER lpFileSize);
 BOOL CompareFileTypes(const TCHAR *pszFile1, const TCHAR *pszFile2);
 HRESULT BuildFileAttributeString(const TCHAR *lpszFileName, TCHAR *szOutput, size_t cchMax);
 HRESULT BuildFileAttributeString(DWORD dwFileAttributes, TCHAR *szOutput, size_t cchMax);
-BOOL GetFileOwner(const TCHAR *szFile, TCHAR *szOwner, size_t cchMax);
 DWORD GetNumFileHardLinks(const TCHAR *lpszFileName);
 BOOL ReadImageProperty(const TCHAR *lpszImage, PROPID propId, TCHAR *szProperty, int cchMax);
-HRESULT GetMediaMetadata(const TCHAR *szFileName, const TCHAR *szAttribute, BYTE **pszOutput);
 BOOL IsImage(const TCHAR *fileName);
 BOOL GetFileProductVersion(
 	const TCHAR *szFullFileName, DWORD *pdwProductVersionLS, DWORD *pdwProductVersionMS);
@@ -49,13 +46,24 @@ BOOL GetFileLanguage(const TCHAR *szFullFileName, WORD *pwLanguage);
 BOOL GetVersionInfoString(
 	const TCHAR *szFullFileName, const TCHAR *szVersionInfo, TCHAR *szVersionBuffer, UINT cchMax);
 
+// Reads the version resource of a file, so that several values can be retrieved from it without
+// the file being read each time. The returned buffer is empty if the file has no version resource.
+std::vector<BYTE> ReadFileVersionInfo(const TCHAR *szFullFileName);
+BOOL GetVersionInfoString(std::vector<BYTE> &versionInfo, const TCHAR *szVersionInfo,
+	TCHAR *szVersionBuffer, UINT cchMax);
+
+// Returns true if the attributes belong to a cloud placeholder (e.g. a OneDrive file that's only
+// available online). Reading the contents of a placeholder file, or enumerating a placeholder
+// folder, causes the data to be downloaded.
+bool IsCloudPlaceholder(DWORD fileAttributes);
+
 /* Ownership and access. */
 BOOL CheckGroupMembership(GroupType groupType);
 BOOL FormatUserName(PSID sid, TCHAR *userName, size_t cchMax);
 
-/* User interaction. */
-BOOL GetFileNameFromUser(
-	HWND hwnd, TCHAR *fullFileName, UINT cchMax, const TCHAR *initialDirectory);
+// Returns the string form of the SID that owns the file (e.g. S-1-5-32-544). The SID can be mapped
+// to an account name via AccountNameCache.
+std::optional<std::wstring> GetFileOwnerSid(const std::wstring &path);
 
 /* General helper functions. */
 HINSTANCE StartCommandPrompt(const std::wstring &directory, bool elevated);
@@ -5,14 +5,19 @@
 #include "stdafx.h"
 #include "IconFetcher.h"
 #include "CachedIcons.h"
+#include "ExtensionIconCache.h"
+#include "IconLocationCache.h"
+#include "PerformanceTrace.h"
 #include "WindowSubclassWrapper.h"
 
-IconFetcher::IconFetcher(HWND hwnd, CachedIcons *cachedIcons) :
+IconFetcher::IconFetcher(
+	HWND hwnd, CachedIcons *cachedIcons, PriorityTaskScheduler *taskScheduler) :
 	m_hwnd(hwnd),
 	m_cachedIcons(cachedIcons),
-	m_iconThreadPool(
-		1, std::bind(CoInitializeEx, nullptr, COINIT_APARTMENTTHREADED), CoUninitialize),
-	m_iconResultIDCounter(0)
+	m_taskScheduler(taskScheduler),
+	m_lookupThrottle(LOOKUP_TIMEOUT, FAILED_LOOKUP_COOL_DOWN),
+	m_iconResultIDCounter(0),
+	m_numResultsProcessed(0)
 {
 	m_windowSubclasses.push_back(std::make_unique<WindowSubclassWrapper>(
 		hwnd, WindowSubclassStub, SUBCLASS_ID, reinterpret_cast<DWORD_PTR>(this)));
@@ -20,7 +25,9 @@ IconFetcher::IconFetcher(HWND hwnd, CachedIcons *cachedIcons) :
 
 IconFetcher::~IconFetcher()
 {
-	m_iconThreadPool.clear_queue();
+	// Any task that's currently running references this instance, so it needs to finish before the
+	// instance can be destroyed.
+	m_taskScheduler->CancelTasks(this, true);
 }
 
 LRESULT CALLBACK IconFetcher::WindowSubclassStub(
@@ -48,37 +55,30 @@ LRESULT CALLBACK IconFetcher::WindowSubclass(HWND hwnd, UINT msg, WPARAM wParam,
 
 void IconFetcher::QueueIconTask(std::wstring_view path, Callback callback)
 {
-	int iconResultID = m_iconResultIDCounter++;
+	std::wstring pathString(path);
 
-	auto iconResult = m_iconThreadPool.push(
-		[this, iconResultID, copiedPath = std::wstring(path)](int id) -> std::optional<IconResult> {
-			UNREFERENCED_PARAMETER(id);
-
-			// SHGetFileInfo will fail for non-filesystem paths that are passed in
-			// as strings. For example, attempting to retrieve the icon for the
-			// recycle bin will fail if you pass the parsing path (i.e.
-			// ::{645FF040-5081-101B-9F08-00AA002F954E}). If, however, you pass the
-			// pidl, the function will succeed. Therefore, paths will always be
-			// converted to pidls first here.
-			unique_pidl_absolute pidl;
-			HRESULT hr =
-				SHParseDisplayName(copiedPath.c_str(), nullptr, wil::out_param(pidl), 0, nullptr);
-
-			if (FAILED(hr))
-			{
-				return std::nullopt;
-			}
+	switch (m_lookupThrottle.OnRequest(pathString))
+	{
+	case IconLookupThrottle::Decision::Reject:
+		return;
+
+	case IconLookupThrottle::Decision::JoinLookup:
+		m_iconResults.at(m_pathLookups.at(pathString)).callbacks.push_back(callback);
+		return;
 
-			auto iconIndex = FindIconAsync(pidl.get());
+	case IconLookupThrottle::Decision::StartLookup:
+		break;
+	}
 
-			if (!iconIndex)
-			{
-				return std::nullopt;
-			}
+	int iconResultID = m_iconResultIDCounter++;
+
+	auto iconResult = m_taskScheduler->PushTask(this, std::nullopt, ICON_TASK_PRIORITY,
+		[this, iconResultID, copiedPath = pathString]() {
+			auto startTime = std::chrono::steady_clock::now();
 
 			IconResult result;
-			result.iconIndex = *iconIndex;
-			result.path = copiedPath;
+			result.iconIndex = FindIconForPathAsync(copiedPath);
+			result.duration = std::chrono::steady_clock::now() - startTime;
 
 			PostMessage(m_hwnd, WM_APP_ICON_RESULT_READY, iconResultID, 0);
 
@@ -86,9 +86,44 @@ void IconFetcher::QueueIconTask(std::wstring_view path, Callback callback)
 		});
 
 	FutureResult futureResult;
-	futureResult.callback = callback;
+	futureResult.callbacks.push_back(callback);
+	futureResult.path = pathString;
 	futureResult.iconResult = std::move(iconResult);
 	m_iconResults.insert({ iconResultID, std::move(futureResult) });
+	m_pathLookups.insert({ pathString, iconResultID });
+}
+
+std::optional<int> IconFetcher::FindIconForPathAsync(const std::wstring &path)
+{
+	PerformanceTraceActivity traceActivity(L"IconTask");
+
+	// SHGetFileInfo will fail for non-filesystem paths that are passed in
+	// as strings. For example, attempting to retrieve the icon for the
+	// recycle bin will fail if you pass the parsing path (i.e.
+	// ::{645FF040-5081-101B-9F08-00AA002F954E}). If, however, you pass the
+	// pidl, the function will succeed. Therefore, paths will always be
+	// converted to pidls first here.
+	unique_pidl_absolute pidl;
+	HRESULT hr = SHParseDisplayName(path.c_str(), nullptr, wil::out_param(pidl), 0, nullptr);
+
+	if (FAILED(hr))
+	{
+		return std::nullopt;
+	}
+
+	auto iconIndex = FindIconAsync(pidl.get());
+
+	if (!iconIndex)
+	{
+		return std::nullopt;
+	}
+
+	// The cache is filled in here, rather than on the UI thread, so that the icon is
+	// available to other lookups as soon as it's been found.
+	m_cachedIcons->addOrUpdateFileIcon(path, *iconIndex);
+	GetIconLocationCache().RecordItem(pidl.get(), path);
+
+	return iconIndex;
 }
 
 void IconFetcher::QueueIconTask(PCIDLIST_ABSOLUTE pidl, Callback callback)
@@ -98,26 +133,25 @@ void IconFetcher::QueueIconTask(PCIDLIST_ABSOLUTE pidl, Callback callback)
 	BasicItemInfo basicItemInfo;
 	basicItemInfo.pidl.reset(ILCloneFull(pidl));
 
-	auto iconResult = m_iconThreadPool.push(
-		[this, iconResultID, basicItemInfo](int id) -> std::optional<IconResult> {
-			UNREFERENCED_PARAMETER(id);
-
-			auto iconIndex = FindIconAsync(basicItemInfo.pidl.get());
-
-			if (!iconIndex)
-			{
-				return std::nullopt;
-			}
+	auto iconResult = m_taskScheduler->PushTask(this, std::nullopt, ICON_TASK_PRIORITY,
+		[this, iconResultID, basicItemInfo]() {
+			auto startTime = std::chrono::steady_clock::now();
 
 			IconResult result;
-			result.iconIndex = *iconIndex;
+			result.iconIndex = FindIconAsync(basicItemInfo.pidl.get());
+			result.duration = std::chrono::steady_clock::now() - startTime;
 
-			std::wstring filePath;
-			HRESULT hr = GetDisplayName(basicItemInfo.pidl.get(), SHGDN_FORPARSING, filePath);
-
-			if (SUCCEEDED(hr))
+			if (result.iconIndex)
 			{
-				result.path = filePath;
+				std::wstring filePath;
+				HRESULT hr =
+					GetDisplayName(basicItemInfo.pidl.get(), SHGDN_FORPARSING, filePath);
+
+				if (SUCCEEDED(hr))
+				{
+					m_cachedIcons->addOrUpdateFileIcon(filePath, *result.iconIndex);
+					GetIconLocationCache().RecordItem(basicItemInfo.pidl.get(), filePath);
+				}
 			}
 
 			PostMessage(m_hwnd, WM_APP_ICON_RESULT_READY, iconResultID, 0);
@@ -126,27 +160,16 @@ void IconFetcher::QueueIconTask(PCIDLIST_ABSOLUTE pidl, Callback callback)
 		});
 
 	FutureResult futureResult;
-	futureResult.callback = callback;
+	futureResult.callbacks.push_back(callback);
 	futureResult.iconResult = std::move(iconResult);
 	m_iconResults.insert({ iconResultID, std::move(futureResult) });
 }
 
 std::optional<int> IconFetcher::FindIconAsync(PCIDLIST_ABSOLUTE pidl)
 {
-	// Must use SHGFI_ICON here, rather than SHGFO_SYSICONINDEX, or else
-	// icon overlays won't be applied.
-	SHFILEINFO shfi;
-	DWORD_PTR res = SHGetFileInfo(reinterpret_cast<LPCTSTR>(pidl), 0, &shfi, sizeof(shfi),
-		SHGFI_PIDL | SHGFI_ICON | SHGFI_OVERLAYINDEX);
-
-	if (res == 0)
-	{
-		return std::nullopt;
-	}
-
-	DestroyIcon(shfi.hIcon);
+	PerformanceTraceActivity traceActivity(L"IconTask");
 
-	return shfi.iIcon;
+	return GetItemIconIndex(pidl);
 }
 
 void IconFetcher::ProcessIconResult(int iconResultId)
@@ -158,25 +181,47 @@ void IconFetcher::ProcessIconResult(int iconResultId)
 		return;
 	}
 
-	auto &futureResult = itr->second;
+	// The entry is removed before any of the callbacks are invoked, since a callback may queue
+	// another request.
+	auto futureResult = std::move(itr->second);
+	m_iconResults.erase(itr);
+	m_numResultsProcessed++;
+
 	auto result = futureResult.iconResult.get();
 
-	if (!result)
+	if (futureResult.path)
+	{
+		m_pathLookups.erase(*futureResult.path);
+		m_lookupThrottle.OnLookupFinished(
+			*futureResult.path, result.iconIndex.has_value(), result.duration);
+	}
+
+	if (!result.iconIndex)
 	{
 		// Icon lookup failed.
 		return;
 	}
 
-	if (!result->path.empty())
+	for (auto &callback : futureResult.callbacks)
 	{
-		m_cachedIcons->addOrUpdateFileIcon(result->path, result->iconIndex);
+		callback(*result.iconIndex);
 	}
-
-	futureResult.callback(result->iconIndex);
 }
 
 void IconFetcher::ClearQueue()
 {
-	m_iconThreadPool.clear_queue();
+	m_taskScheduler->CancelTasks(this);
 	m_iconResults.clear();
+	m_pathLookups.clear();
+	m_lookupThrottle.ForgetRunningLookups();
+}
+
+size_t IconFetcher::GetNumPendingTasks() const
+{
+	return m_iconResults.size();
+}
+
+uint64_t IconFetcher::GetNumResultsProcessed() const
+{
+	return m_numResultsProcessed;
 }
\ No newline at end of file
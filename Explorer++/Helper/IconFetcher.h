@@ -4,13 +4,16 @@
 
 #pragma once
 
+#include "IconLookupThrottle.h"
+#include "PriorityTaskScheduler.h"
 #include "ShellHelper.h"
-#include "../ThirdParty/CTPL/cpl_stl.h"
 #include <ShlObj.h>
+#include <chrono>
 #include <functional>
 #include <future>
 #include <optional>
 #include <unordered_map>
+#include <vector>
 
 class CachedIcons;
 class WindowSubclassWrapper;
@@ -25,19 +28,33 @@ public:
 	virtual void ClearQueue() = 0;
 };
 
+// Requests for icons by path go through an IconLookupThrottle, so that repeated requests for the
+// same path share a single lookup and paths on slow or unreachable network shares don't tie up the
+// background threads. A request that's rejected (or whose lookup fails) never has its callback
+// invoked, so the caller simply continues to use whatever default icon it's showing.
 class IconFetcher : public IconFetcherInterface
 {
 public:
-	IconFetcher(HWND hwnd, CachedIcons *cachedIcons);
+	IconFetcher(HWND hwnd, CachedIcons *cachedIcons, PriorityTaskScheduler *taskScheduler);
 	virtual ~IconFetcher();
 
 	void QueueIconTask(std::wstring_view path, Callback callback) override;
 	void QueueIconTask(PCIDLIST_ABSOLUTE pidl, Callback callback) override;
 	void ClearQueue() override;
 
+	// The number of lookups that have been queued, but whose results haven't been processed yet.
+	size_t GetNumPendingTasks() const;
+
+	uint64_t GetNumResultsProcessed() const;
+
 private:
 	static const UINT_PTR SUBCLASS_ID = 0;
 
+	static const int ICON_TASK_PRIORITY = 0;
+
+	static constexpr std::chrono::seconds LOOKUP_TIMEOUT = std::chrono::seconds(5);
+	static constexpr std::chrono::seconds FAILED_LOOKUP_COOL_DOWN = std::chrono::seconds(60);
+
 	// This is the end of the range that starts at WM_APP. This class subclasses the window that's
 	// passed to the constructor, so it's not possible to tell what other WM_APP messages are in
 	// use. To try to avoid clashes with other messages sent throughout the application, the last
@@ -56,31 +73,40 @@ private:
 		unique_pidl_absolute pidl;
 	};
 
+	// A result is always returned (and a message always posted), even when the lookup fails, so
+	// that the lookup can be accounted for.
 	struct IconResult
 	{
-		int iconIndex;
-		std::wstring path;
+		std::optional<int> iconIndex;
+		std::chrono::steady_clock::duration duration;
 	};
 
 	struct FutureResult
 	{
-		Callback callback;
-		std::future<std::optional<IconResult>> iconResult;
+		std::vector<Callback> callbacks;
+		std::optional<std::wstring> path;
+		std::future<IconResult> iconResult;
 	};
 
 	static LRESULT CALLBACK WindowSubclassStub(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam,
 		UINT_PTR uIdSubclass, DWORD_PTR dwRefData);
 	LRESULT CALLBACK WindowSubclass(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
 
+	std::optional<int> FindIconForPathAsync(const std::wstring &path);
 	static std::optional<int> FindIconAsync(PCIDLIST_ABSOLUTE pidl);
 	void ProcessIconResult(int iconResultId);
 
 	const HWND m_hwnd;
 	std::vector<std::unique_ptr<WindowSubclassWrapper>> m_windowSubclasses;
 
-	ctpl::thread_pool m_iconThreadPool;
+	PriorityTaskScheduler *const m_taskScheduler;
 	std::unordered_map<int, FutureResult> m_iconResults;
+	IconLookupThrottle m_lookupThrottle;
+
+	// Maps the path of each lookup that's currently running to its result ID.
+	std::unordered_map<std::wstring, int> m_pathLookups;
 	int m_iconResultIDCounter;
+	uint64_t m_numResultsProcessed;
 	CachedIcons *m_cachedIcons;
 	std::function<void(int data)> m_callback;
 };
\ No newline at end of file
@@ -0,0 +1,398 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "IconLocationCache.h"
+#include "CachedIcons.h"
+#include "ShellHelper.h"
+#include <wil/com.h>
+#include <wil/resource.h>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <vector>
+
+namespace
+{
+
+// Reads values sequentially from a block of memory, failing (rather than reading past the end)
+// if the data is truncated.
+class DataReader
+{
+public:
+	DataReader(const std::byte *data, size_t size) : m_current(data), m_end(data + size)
+	{
+	}
+
+	template <typename T>
+	bool ReadValue(T &value)
+	{
+		if (static_cast<size_t>(m_end - m_current) < sizeof(value))
+		{
+			return false;
+		}
+
+		std::memcpy(&value, m_current, sizeof(value));
+		m_current += sizeof(value);
+		return true;
+	}
+
+	bool ReadString(std::wstring &value)
+	{
+		uint16_t length;
+
+		if (!ReadValue(length) || static_cast<size_t>(m_end - m_current) < length * sizeof(wchar_t))
+		{
+			return false;
+		}
+
+		value.resize(length);
+		std::memcpy(value.data(), m_current, length * sizeof(wchar_t));
+		m_current += length * sizeof(wchar_t);
+		return true;
+	}
+
+	bool AtEnd() const
+	{
+		return m_current == m_end;
+	}
+
+private:
+	const std::byte *m_current;
+	const std::byte *const m_end;
+};
+
+template <typename T>
+void WriteValue(std::ofstream &stream, const T &value)
+{
+	stream.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+void WriteString(std::ofstream &stream, const std::wstring &value)
+{
+	WriteValue(stream, static_cast<uint16_t>(value.size()));
+	stream.write(reinterpret_cast<const char *>(value.data()), value.size() * sizeof(wchar_t));
+}
+
+bool AreFileTimesEqual(const FILETIME &fileTime1, const FILETIME &fileTime2)
+{
+	return CompareFileTime(&fileTime1, &fileTime2) == 0;
+}
+
+}
+
+void IconLocationCache::SetEnabled(bool enabled)
+{
+	m_enabled = enabled;
+}
+
+void IconLocationCache::RecordItem(PCIDLIST_ABSOLUTE pidl, const std::wstring &path)
+{
+	if (!m_enabled || path.size() > (std::numeric_limits<uint16_t>::max)()
+		|| PathIsNetworkPath(path.c_str()))
+	{
+		return;
+	}
+
+	wil::com_ptr_nothrow<IShellFolder> parent;
+	PCITEMID_CHILD child;
+	HRESULT hr = SHBindToParent(pidl, IID_PPV_ARGS(&parent), &child);
+
+	if (FAILED(hr))
+	{
+		return;
+	}
+
+	// This will fail for items that aren't in the file system. The find data is stored in the
+	// pidl, so this doesn't access the file.
+	WIN32_FIND_DATA findData;
+	hr = SHGetDataFromIDList(parent.get(), child, SHGDFIL_FINDDATA, &findData, sizeof(findData));
+
+	if (FAILED(hr))
+	{
+		return;
+	}
+
+	auto location = RetrieveIconLocation(pidl);
+
+	if (!location)
+	{
+		return;
+	}
+
+	SetIconLocation(path, findData.ftLastWriteTime, *location);
+}
+
+std::optional<IconLocationCache::IconLocation> IconLocationCache::RetrieveIconLocation(
+	PCIDLIST_ABSOLUTE pidl)
+{
+	wil::com_ptr_nothrow<IShellFolder> parent;
+	PCITEMID_CHILD child;
+	HRESULT hr = SHBindToParent(pidl, IID_PPV_ARGS(&parent), &child);
+
+	if (FAILED(hr))
+	{
+		return std::nullopt;
+	}
+
+	wil::com_ptr_nothrow<IExtractIconW> extractIcon;
+	hr = GetUIObjectOf(parent.get(), nullptr, 1, &child, IID_PPV_ARGS(&extractIcon));
+
+	if (FAILED(hr))
+	{
+		return std::nullopt;
+	}
+
+	WCHAR iconFile[MAX_PATH];
+	int iconIndex;
+	UINT flags;
+	hr = extractIcon->GetIconLocation(
+		GIL_FORSHELL, iconFile, static_cast<UINT>(std::size(iconFile)), &iconIndex, &flags);
+
+	// Icons that don't come from a file can only be extracted through the IExtractIcon interface,
+	// so there's nothing that can be saved for them.
+	if (hr != S_OK || WI_IsAnyFlagSet(flags, GIL_NOTFILENAME | GIL_DONTCACHE))
+	{
+		return std::nullopt;
+	}
+
+	return IconLocation{ iconFile, iconIndex, flags };
+}
+
+std::optional<IconLocationCache::IconLocation> IconLocationCache::GetIconLocation(
+	const std::wstring &path, const FILETIME &lastWriteTime)
+{
+	std::scoped_lock lock(m_mutex);
+
+	auto itr = m_entries.find(GetKey(path));
+
+	if (itr == m_entries.end() || !AreFileTimesEqual(itr->second.lastWriteTime, lastWriteTime))
+	{
+		return std::nullopt;
+	}
+
+	return itr->second.location;
+}
+
+void IconLocationCache::SetIconLocation(
+	const std::wstring &path, const FILETIME &lastWriteTime, const IconLocation &location)
+{
+	std::wstring key = GetKey(path);
+
+	std::scoped_lock lock(m_mutex);
+
+	if (m_entries.size() >= MAX_ENTRIES)
+	{
+		m_entries.clear();
+	}
+
+	m_entries.insert_or_assign(std::move(key), Entry{ path, lastWriteTime, location });
+}
+
+void IconLocationCache::PrimeCachedIcons(CachedIcons &cachedIcons)
+{
+	std::scoped_lock lock(m_mutex);
+
+	for (auto itr = m_entries.begin(); itr != m_entries.end();)
+	{
+		const Entry &entry = itr->second;
+
+		WIN32_FILE_ATTRIBUTE_DATA attributeData;
+		BOOL res = GetFileAttributesEx(entry.path.c_str(), GetFileExInfoStandard, &attributeData);
+
+		if (!res || !AreFileTimesEqual(attributeData.ftLastWriteTime, entry.lastWriteTime))
+		{
+			itr = m_entries.erase(itr);
+			continue;
+		}
+
+		// This adds the icon to the system image list, if it's not already present.
+		int iconIndex = Shell_GetCachedImageIndex(
+			entry.location.file.c_str(), entry.location.index, entry.location.flags);
+
+		if (iconIndex == -1)
+		{
+			itr = m_entries.erase(itr);
+			continue;
+		}
+
+		cachedIcons.addOrUpdateFileIcon(entry.path, iconIndex);
+
+		++itr;
+	}
+}
+
+bool IconLocationCache::LoadFromFile(const std::wstring &filePath)
+{
+	wil::unique_hfile file(CreateFile(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+
+	if (!file)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	BOOL res = GetFileSizeEx(file.get(), &fileSize);
+
+	// An empty file can't be mapped. A valid file is never anywhere near this large.
+	if (!res || fileSize.QuadPart == 0 || fileSize.QuadPart > 256 * 1024 * 1024)
+	{
+		return false;
+	}
+
+	wil::unique_handle mapping(
+		CreateFileMapping(file.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+
+	if (!mapping)
+	{
+		return false;
+	}
+
+	wil::unique_mapview_ptr<void> view(MapViewOfFile(mapping.get(), FILE_MAP_READ, 0, 0, 0));
+
+	if (!view)
+	{
+		return false;
+	}
+
+	return ParseFileData(
+		static_cast<const std::byte *>(view.get()), static_cast<size_t>(fileSize.QuadPart));
+}
+
+// The file consists of a header, followed by a table of the icon files referenced by the entries
+// (since most entries share a small number of files), followed by the entries themselves.
+bool IconLocationCache::ParseFileData(const std::byte *data, size_t size)
+{
+	DataReader reader(data, size);
+
+	uint32_t signature;
+	uint32_t version;
+	uint32_t numIconFiles;
+
+	if (!reader.ReadValue(signature) || signature != FILE_SIGNATURE || !reader.ReadValue(version)
+		|| version != FILE_VERSION || !reader.ReadValue(numIconFiles)
+		|| numIconFiles > MAX_ENTRIES)
+	{
+		return false;
+	}
+
+	std::vector<std::wstring> iconFiles;
+
+	for (uint32_t i = 0; i < numIconFiles; i++)
+	{
+		std::wstring iconFile;
+
+		if (!reader.ReadString(iconFile))
+		{
+			return false;
+		}
+
+		iconFiles.push_back(std::move(iconFile));
+	}
+
+	uint32_t numEntries;
+
+	if (!reader.ReadValue(numEntries) || numEntries > MAX_ENTRIES)
+	{
+		return false;
+	}
+
+	std::unordered_map<std::wstring, Entry> entries;
+
+	for (uint32_t i = 0; i < numEntries; i++)
+	{
+		Entry entry = {};
+		uint32_t iconFileIndex;
+
+		if (!reader.ReadString(entry.path) || !reader.ReadValue(entry.lastWriteTime)
+			|| !reader.ReadValue(iconFileIndex) || iconFileIndex >= iconFiles.size()
+			|| !reader.ReadValue(entry.location.index) || !reader.ReadValue(entry.location.flags))
+		{
+			return false;
+		}
+
+		entry.location.file = iconFiles[iconFileIndex];
+
+		std::wstring key = GetKey(entry.path);
+		entries.insert_or_assign(std::move(key), std::move(entry));
+	}
+
+	if (!reader.AtEnd())
+	{
+		return false;
+	}
+
+	std::scoped_lock lock(m_mutex);
+	m_entries = std::move(entries);
+
+	return true;
+}
+
+bool IconLocationCache::SaveToFile(const std::wstring &filePath)
+{
+	std::ofstream stream(filePath, std::ios::binary | std::ios::trunc);
+
+	if (!stream)
+	{
+		return false;
+	}
+
+	std::scoped_lock lock(m_mutex);
+
+	std::vector<const std::wstring *> iconFiles;
+	std::unordered_map<std::wstring, uint32_t> iconFileIndexes;
+
+	for (const auto &[key, entry] : m_entries)
+	{
+		auto [itr, inserted] = iconFileIndexes.try_emplace(
+			entry.location.file, static_cast<uint32_t>(iconFiles.size()));
+
+		if (inserted)
+		{
+			iconFiles.push_back(&itr->first);
+		}
+	}
+
+	WriteValue(stream, FILE_SIGNATURE);
+	WriteValue(stream, FILE_VERSION);
+	WriteValue(stream, static_cast<uint32_t>(iconFiles.size()));
+
+	for (const auto *iconFile : iconFiles)
+	{
+		WriteString(stream, *iconFile);
+	}
+
+	WriteValue(stream, static_cast<uint32_t>(m_entries.size()));
+
+	for (const auto &[key, entry] : m_entries)
+	{
+		WriteString(stream, entry.path);
+		WriteValue(stream, entry.lastWriteTime);
+		WriteValue(stream, iconFileIndexes.at(entry.location.file));
+		WriteValue(stream, entry.location.index);
+		WriteValue(stream, entry.location.flags);
+	}
+
+	return stream.good();
+}
+
+void IconLocationCache::Clear()
+{
+	std::scoped_lock lock(m_mutex);
+	m_entries.clear();
+}
+
+std::wstring IconLocationCache::GetKey(const std::wstring &path)
+{
+	std::wstring key = path;
+	CharUpperBuff(key.data(), static_cast<DWORD>(key.size()));
+	return key;
+}
+
+IconLocationCache &GetIconLocationCache()
+{
+	static IconLocationCache iconLocationCache;
+	return iconLocationCache;
+}
\ No newline at end of file
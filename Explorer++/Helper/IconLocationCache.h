@@ -0,0 +1,91 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+class CachedIcons;
+
+// Indexes within the system image list are only valid for the lifetime of the process, so they
+// can't be saved between sessions. The location of an icon (i.e. the file containing it and the
+// index of the icon within that file), however, can be. This class records the icon location of
+// each item whose icon is retrieved, so that the locations can be saved on exit and used to fill
+// in CachedIcons on startup. That way, restored tabs can be shown with the correct icons straight
+// away, rather than the default icons being shown until each icon has been retrieved.
+//
+// Each location is stored along with the last write time of the item. A location is only used
+// while the time still matches.
+//
+// The cache can be used concurrently from multiple threads.
+class IconLocationCache
+{
+public:
+	struct IconLocation
+	{
+		std::wstring file;
+		int index;
+
+		// The GIL_* flags returned by IExtractIcon::GetIconLocation().
+		UINT flags;
+
+		bool operator==(const IconLocation &) const = default;
+	};
+
+	// Recording is disabled by default.
+	void SetEnabled(bool enabled);
+
+	// Records the icon location of the item, if recording is enabled. Only items within the local
+	// file system are recorded. Retrieving the location can be slow, so this should be called from
+	// a background thread.
+	void RecordItem(PCIDLIST_ABSOLUTE pidl, const std::wstring &path);
+
+	std::optional<IconLocation> GetIconLocation(
+		const std::wstring &path, const FILETIME &lastWriteTime);
+	void SetIconLocation(
+		const std::wstring &path, const FILETIME &lastWriteTime, const IconLocation &location);
+
+	// Adds the icon for each item that hasn't changed since it was recorded to the specified
+	// cache. Entries for items that have changed (or no longer exist) are discarded.
+	void PrimeCachedIcons(CachedIcons &cachedIcons);
+
+	// The file is mapped into memory and parsed directly from the view.
+	bool LoadFromFile(const std::wstring &filePath);
+	bool SaveToFile(const std::wstring &filePath);
+
+	// Should be called when file associations have changed.
+	void Clear();
+
+private:
+	// The cache is cleared if it grows beyond this many items. This also bounds the amount of work
+	// done on startup, when each item is checked.
+	static const size_t MAX_ENTRIES = 20000;
+
+	static constexpr uint32_t FILE_SIGNATURE = 0x43434945; // "EICC"
+	static constexpr uint32_t FILE_VERSION = 1;
+
+	struct Entry
+	{
+		// Keys are stored in upper case, so the original path is retained here.
+		std::wstring path;
+		FILETIME lastWriteTime;
+		IconLocation location;
+	};
+
+	static std::wstring GetKey(const std::wstring &path);
+	static std::optional<IconLocation> RetrieveIconLocation(PCIDLIST_ABSOLUTE pidl);
+	bool ParseFileData(const std::byte *data, size_t size);
+
+	std::atomic<bool> m_enabled = false;
+
+	std::mutex m_mutex;
+	std::unordered_map<std::wstring, Entry> m_entries;
+};
+
+IconLocationCache &GetIconLocationCache();
\ No newline at end of file
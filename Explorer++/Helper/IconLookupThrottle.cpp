@@ -0,0 +1,135 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "IconLookupThrottle.h"
+#include <Shlwapi.h>
+
+IconLookupThrottle::IconLookupThrottle(
+	Clock::duration timeout, Clock::duration coolDown, NowFunction nowFunction) :
+	m_timeout(timeout),
+	m_coolDown(coolDown),
+	m_nowFunction(nowFunction)
+{
+}
+
+IconLookupThrottle::Decision IconLookupThrottle::OnRequest(const std::wstring &path)
+{
+	auto now = m_nowFunction();
+
+	if (IsCoolingDown(m_failedPaths, path, now))
+	{
+		return Decision::Reject;
+	}
+
+	std::wstring root = GetRoot(path);
+
+	if (IsCoolingDown(m_unreachableRoots, root, now))
+	{
+		return Decision::Reject;
+	}
+
+	if (m_runningLookups.contains(path))
+	{
+		return Decision::JoinLookup;
+	}
+
+	auto itr = m_runningLookupsByRoot.find(root);
+
+	if (itr != m_runningLookupsByRoot.end() && !itr->second.empty()
+		&& now - *itr->second.begin() > m_timeout)
+	{
+		// The oldest lookup within this root is still running, well after it should have finished,
+		// so starting another lookup within the root would likely only tie up another thread.
+		m_unreachableRoots[root] = now + m_coolDown;
+		return Decision::Reject;
+	}
+
+	m_runningLookups.insert({ path, { root, now } });
+	m_runningLookupsByRoot[root].insert(now);
+
+	return Decision::StartLookup;
+}
+
+void IconLookupThrottle::OnLookupFinished(
+	const std::wstring &path, bool succeeded, Clock::duration duration)
+{
+	auto itr = m_runningLookups.find(path);
+
+	if (itr == m_runningLookups.end())
+	{
+		return;
+	}
+
+	std::wstring root = itr->second.root;
+	auto &rootStartTimes = m_runningLookupsByRoot[root];
+	rootStartTimes.erase(rootStartTimes.find(itr->second.startTime));
+
+	if (rootStartTimes.empty())
+	{
+		m_runningLookupsByRoot.erase(root);
+	}
+
+	m_runningLookups.erase(itr);
+
+	auto now = m_nowFunction();
+
+	if (succeeded)
+	{
+		// The root is evidently reachable.
+		m_unreachableRoots.erase(root);
+		return;
+	}
+
+	m_failedPaths[path] = now + m_coolDown;
+
+	if (duration > m_timeout)
+	{
+		m_unreachableRoots[root] = now + m_coolDown;
+	}
+}
+
+void IconLookupThrottle::ForgetRunningLookups()
+{
+	m_runningLookups.clear();
+	m_runningLookupsByRoot.clear();
+}
+
+// For a UNC path, the root is the share (e.g. \\server\share). For a path on a drive, it's the
+// drive (e.g. C:\). Any other path (e.g. a shell folder parsing path) is treated as its own root.
+std::wstring IconLookupThrottle::GetRoot(const std::wstring &path)
+{
+	std::wstring root = path;
+
+	if (!PathStripToRoot(root.data()))
+	{
+		return path;
+	}
+
+	root.resize(wcslen(root.c_str()));
+	CharLowerBuff(root.data(), static_cast<DWORD>(root.size()));
+
+	return root;
+}
+
+bool IconLookupThrottle::IsCoolingDown(
+	std::unordered_map<std::wstring, Clock::time_point> &expiryTimes, const std::wstring &key,
+	Clock::time_point now)
+{
+	auto itr = expiryTimes.find(key);
+
+	if (itr == expiryTimes.end())
+	{
+		return false;
+	}
+
+	if (now < itr->second)
+	{
+		return true;
+	}
+
+	expiryTimes.erase(itr);
+
+	return false;
+}
\ No newline at end of file
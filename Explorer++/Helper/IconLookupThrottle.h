@@ -0,0 +1,80 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <set>
+#include <string>
+#include <unordered_map>
+
+// Decides which icon lookups (by path) should actually be performed. Looking up the icon for a path
+// on a network share that's slow or unreachable can take a long time, and each lookup ties up a
+// background thread while it runs. Therefore:
+//
+// - Concurrent requests for the same path share a single lookup.
+// - A path whose lookup failed isn't looked up again until a cool-down period has passed.
+// - If a lookup within a particular root (e.g. \\server\share) has been running for longer than the
+//   timeout, or failed after taking longer than that, the entire root is treated as unreachable for
+//   the cool-down period.
+//
+// Should only be used from a single thread.
+class IconLookupThrottle
+{
+public:
+	using Clock = std::chrono::steady_clock;
+	using NowFunction = std::function<Clock::time_point()>;
+
+	enum class Decision
+	{
+		// A new lookup should be started.
+		StartLookup,
+
+		// A lookup for the path is already running and its result should be shared.
+		JoinLookup,
+
+		// The path shouldn't be looked up at the moment.
+		Reject
+	};
+
+	IconLookupThrottle(Clock::duration timeout, Clock::duration coolDown,
+		NowFunction nowFunction = Clock::now);
+
+	Decision OnRequest(const std::wstring &path);
+
+	// Should be called once a lookup that was started has finished. The duration is the time taken
+	// by the lookup itself.
+	void OnLookupFinished(const std::wstring &path, bool succeeded, Clock::duration duration);
+
+	// Forgets about any lookups that are currently running (e.g. because their results are no
+	// longer wanted). Paths and roots that have failed remain in the cool-down period.
+	void ForgetRunningLookups();
+
+	static std::wstring GetRoot(const std::wstring &path);
+
+private:
+	struct RunningLookup
+	{
+		std::wstring root;
+		Clock::time_point startTime;
+	};
+
+	static bool IsCoolingDown(
+		std::unordered_map<std::wstring, Clock::time_point> &expiryTimes, const std::wstring &key,
+		Clock::time_point now);
+
+	const Clock::duration m_timeout;
+	const Clock::duration m_coolDown;
+	const NowFunction m_nowFunction;
+
+	std::unordered_map<std::wstring, RunningLookup> m_runningLookups;
+
+	// The start times of the lookups currently running within each root.
+	std::unordered_map<std::wstring, std::multiset<Clock::time_point>> m_runningLookupsByRoot;
+
+	// Maps each path or root to the time at which its cool-down period expires.
+	std::unordered_map<std::wstring, Clock::time_point> m_failedPaths;
+	std::unordered_map<std::wstring, Clock::time_point> m_unreachableRoots;
+};
\ No newline at end of file
@@ -0,0 +1,62 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "IdleTaskQueue.h"
+#include <algorithm>
+#include <tuple>
+
+IdleTaskQueue::IdleTaskQueue(
+	ScheduleCallback scheduleCallback, InterruptFunction interruptFunction) :
+	m_scheduleCallback(std::move(scheduleCallback)),
+	m_interruptFunction(std::move(interruptFunction))
+{
+}
+
+void IdleTaskQueue::ScheduleTask(const void *owner, int priority, Task task)
+{
+	bool wasEmpty = m_tasks.empty();
+
+	CancelTask(owner);
+	m_tasks.push_back({ owner, priority, m_sequence++, std::move(task) });
+
+	if (wasEmpty)
+	{
+		m_scheduleCallback();
+	}
+}
+
+void IdleTaskQueue::CancelTask(const void *owner)
+{
+	std::erase_if(m_tasks, [owner](const QueuedTask &task) { return task.owner == owner; });
+}
+
+bool IdleTaskQueue::RunTasks()
+{
+	while (!m_tasks.empty())
+	{
+		auto itr = std::min_element(m_tasks.begin(), m_tasks.end(),
+			[](const QueuedTask &task1, const QueuedTask &task2) {
+				return std::tie(task1.priority, task1.sequence)
+					< std::tie(task2.priority, task2.sequence);
+			});
+
+		// The task is removed before it's run, since it may schedule further tasks.
+		Task task = std::move(itr->task);
+		m_tasks.erase(itr);
+		task();
+
+		if (!m_tasks.empty() && m_interruptFunction())
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool IdleTaskQueue::HasTasks() const
+{
+	return !m_tasks.empty();
+}
\ No newline at end of file
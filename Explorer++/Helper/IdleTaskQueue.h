@@ -0,0 +1,61 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Holds work for the UI thread that can wait until more important work (e.g. painting) has been
+// done. Each task belongs to an owner, which can only have a single task queued at once. Scheduling
+// another task for the same owner replaces the queued one, so when an update is requested
+// repeatedly (e.g. as the user switches through tabs), only the final request is acted on.
+//
+// The schedule callback is invoked when the queue goes from empty to having tasks. The consumer is
+// then responsible for calling RunTasks() once the thread is otherwise idle (e.g. from a timer,
+// since WM_TIMER is only retrieved once there's no input or painting waiting). Tasks run in
+// priority order (lowest value first), then in the order they were scheduled. The interrupt
+// function is checked after each task and, if it returns true (e.g. because input is waiting),
+// RunTasks() stops early, leaving the remaining tasks queued.
+//
+// This class isn't thread-safe; it's designed to be used from a single (UI) thread.
+class IdleTaskQueue
+{
+public:
+	using Task = std::function<void()>;
+	using ScheduleCallback = std::function<void()>;
+	using InterruptFunction = std::function<bool()>;
+
+	IdleTaskQueue(ScheduleCallback scheduleCallback, InterruptFunction interruptFunction);
+
+	IdleTaskQueue(const IdleTaskQueue &) = delete;
+	IdleTaskQueue &operator=(const IdleTaskQueue &) = delete;
+
+	void ScheduleTask(const void *owner, int priority, Task task);
+	void CancelTask(const void *owner);
+
+	// Returns true if there are tasks remaining (in which case, the schedule callback won't be
+	// invoked again until they've all run).
+	bool RunTasks();
+
+	bool HasTasks() const;
+
+private:
+	struct QueuedTask
+	{
+		const void *owner;
+		int priority;
+		uint64_t sequence;
+		Task task;
+	};
+
+	const ScheduleCallback m_scheduleCallback;
+	const InterruptFunction m_interruptFunction;
+
+	// There are only ever a handful of tasks queued, so they're simply stored in the order they
+	// were scheduled.
+	std::vector<QueuedTask> m_tasks;
+	uint64_t m_sequence = 0;
+};
\ No newline at end of file
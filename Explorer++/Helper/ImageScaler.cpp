@@ -0,0 +1,118 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ImageScaler.h"
+#include <cassert>
+#include <cstddef>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define IMAGE_SCALER_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+
+#ifdef IMAGE_SCALER_USE_SSE2
+
+// Each channel is widened to 32 bits, so that all four channels of a pixel can be summed in a
+// single register. Pixels are loaded two at a time where possible.
+uint32_t AverageBlock(const uint32_t *source, int sourceWidth, int left, int top, int right,
+	int bottom)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i sum = _mm_setzero_si128();
+
+	for (int y = top; y < bottom; y++)
+	{
+		const uint32_t *row = source + static_cast<size_t>(y) * sourceWidth;
+		int x = left;
+
+		for (; x + 1 < right; x += 2)
+		{
+			__m128i pixels = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(row + x));
+			__m128i channels = _mm_unpacklo_epi8(pixels, zero);
+			sum = _mm_add_epi32(sum, _mm_unpacklo_epi16(channels, zero));
+			sum = _mm_add_epi32(sum, _mm_unpackhi_epi16(channels, zero));
+		}
+
+		if (x < right)
+		{
+			__m128i pixel = _mm_cvtsi32_si128(static_cast<int>(row[x]));
+			__m128i channels = _mm_unpacklo_epi8(pixel, zero);
+			sum = _mm_add_epi32(sum, _mm_unpacklo_epi16(channels, zero));
+		}
+	}
+
+	int count = (right - left) * (bottom - top);
+	__m128 average = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(sum), _mm_set1_ps(1.0f / count)),
+		_mm_set1_ps(0.5f));
+	__m128i result = _mm_cvttps_epi32(average);
+	result = _mm_packs_epi32(result, result);
+	result = _mm_packus_epi16(result, result);
+
+	return static_cast<uint32_t>(_mm_cvtsi128_si32(result));
+}
+
+#else
+
+uint32_t AverageBlock(const uint32_t *source, int sourceWidth, int left, int top, int right,
+	int bottom)
+{
+	uint32_t sums[4] = {};
+
+	for (int y = top; y < bottom; y++)
+	{
+		const uint32_t *row = source + static_cast<size_t>(y) * sourceWidth;
+
+		for (int x = left; x < right; x++)
+		{
+			for (int channel = 0; channel < 4; channel++)
+			{
+				sums[channel] += (row[x] >> (channel * 8)) & 0xFF;
+			}
+		}
+	}
+
+	uint32_t count = static_cast<uint32_t>((right - left) * (bottom - top));
+	uint32_t result = 0;
+
+	for (int channel = 0; channel < 4; channel++)
+	{
+		result |= ((sums[channel] + count / 2) / count) << (channel * 8);
+	}
+
+	return result;
+}
+
+#endif
+
+}
+
+void DownscaleImage(const uint32_t *source, int sourceWidth, int sourceHeight,
+	uint32_t *destination, int destinationWidth, int destinationHeight)
+{
+	assert(destinationWidth > 0 && destinationWidth <= sourceWidth);
+	assert(destinationHeight > 0 && destinationHeight <= sourceHeight);
+
+	// Each source pixel is assigned to exactly one destination pixel. When the sizes don't divide
+	// evenly, some destination pixels cover one more row or column than others.
+	for (int y = 0; y < destinationHeight; y++)
+	{
+		int top = static_cast<int>(static_cast<int64_t>(y) * sourceHeight / destinationHeight);
+		int bottom =
+			static_cast<int>(static_cast<int64_t>(y + 1) * sourceHeight / destinationHeight);
+
+		for (int x = 0; x < destinationWidth; x++)
+		{
+			int left = static_cast<int>(static_cast<int64_t>(x) * sourceWidth / destinationWidth);
+			int right =
+				static_cast<int>(static_cast<int64_t>(x + 1) * sourceWidth / destinationWidth);
+
+			destination[static_cast<size_t>(y) * destinationWidth + x] =
+				AverageBlock(source, sourceWidth, left, top, right, bottom);
+		}
+	}
+}
\ No newline at end of file
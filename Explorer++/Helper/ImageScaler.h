@@ -0,0 +1,14 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <cstdint>
+
+// Reduces the size of a 32-bit image (e.g. BGRA), by averaging the pixels of the source image that
+// each destination pixel covers. Each of the four channels is averaged independently. Images are
+// stored row by row, with no padding between rows. The destination can't be larger than the source
+// in either dimension.
+void DownscaleImage(const uint32_t *source, int sourceWidth, int sourceHeight,
+	uint32_t *destination, int destinationWidth, int destinationHeight);
\ No newline at end of file
@@ -0,0 +1,167 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ItemAttributeCache.h"
+#include "ShellHelper.h"
+
+ItemAttributeCache::ItemAttributeCache(
+	std::chrono::steady_clock::duration timeToLive, Clock clock) :
+	m_timeToLive(timeToLive),
+	m_clock(std::move(clock))
+{
+}
+
+std::optional<SFGAOF> ItemAttributeCache::GetCachedAttributes(
+	const std::wstring &path, SFGAOF requested)
+{
+	std::wstring key = GetKey(path);
+
+	std::scoped_lock lock(m_mutex);
+
+	auto itr = m_entries.find(key);
+
+	if (itr == m_entries.end())
+	{
+		return std::nullopt;
+	}
+
+	if (m_clock() >= itr->second.expiryTime)
+	{
+		m_entries.erase(itr);
+		return std::nullopt;
+	}
+
+	if ((itr->second.knownAttributes & requested) != requested)
+	{
+		return std::nullopt;
+	}
+
+	return itr->second.attributes & requested;
+}
+
+std::optional<SFGAOF> ItemAttributeCache::GetCachedAttributes(
+	PCIDLIST_ABSOLUTE pidl, SFGAOF requested)
+{
+	std::wstring path;
+	HRESULT hr = GetDisplayName(pidl, SHGDN_FORPARSING, path);
+
+	if (FAILED(hr))
+	{
+		return std::nullopt;
+	}
+
+	return GetCachedAttributes(path, requested);
+}
+
+HRESULT ItemAttributeCache::GetItemAttributes(PCIDLIST_ABSOLUTE pidl, SFGAOF *attributes)
+{
+	if (pidl == nullptr || attributes == nullptr)
+	{
+		return E_FAIL;
+	}
+
+	std::wstring path;
+	HRESULT pathResult = GetDisplayName(pidl, SHGDN_FORPARSING, path);
+
+	if (SUCCEEDED(pathResult))
+	{
+		auto cachedAttributes = GetCachedAttributes(path, *attributes);
+
+		if (cachedAttributes)
+		{
+			*attributes = *cachedAttributes;
+			return S_OK;
+		}
+	}
+
+	SFGAOF requested = *attributes;
+	HRESULT hr = ::GetItemAttributes(pidl, attributes);
+
+	if (SUCCEEDED(hr) && SUCCEEDED(pathResult))
+	{
+		SetAttributes(path, requested, *attributes);
+	}
+
+	return hr;
+}
+
+void ItemAttributeCache::SetAttributes(const std::wstring &path, SFGAOF mask, SFGAOF attributes)
+{
+	std::wstring key = GetKey(path);
+	auto now = m_clock();
+
+	std::scoped_lock lock(m_mutex);
+
+	auto itr = m_entries.find(key);
+
+	// Attributes that are added to an existing entry don't extend its expiry time, so that none of
+	// the cached attributes are used for longer than the time to live.
+	if (itr != m_entries.end() && now < itr->second.expiryTime)
+	{
+		Entry &entry = itr->second;
+		entry.knownAttributes |= mask;
+		entry.attributes = (entry.attributes & ~mask) | (attributes & mask);
+		return;
+	}
+
+	if (itr == m_entries.end() && m_entries.size() >= MAX_ENTRIES)
+	{
+		m_entries.clear();
+	}
+
+	m_entries.insert_or_assign(std::move(key), Entry{ mask, attributes & mask, now + m_timeToLive });
+}
+
+void ItemAttributeCache::OnFolderEnumerated(
+	const std::wstring &path, bool containsSubfolders, bool includedHiddenItems)
+{
+	if (containsSubfolders)
+	{
+		SetAttributes(path, SFGAO_HASSUBFOLDER, SFGAO_HASSUBFOLDER);
+	}
+	else if (includedHiddenItems)
+	{
+		SetAttributes(path, SFGAO_HASSUBFOLDER, 0);
+	}
+}
+
+void ItemAttributeCache::InvalidateItem(const std::wstring &path)
+{
+	std::wstring key = GetKey(path);
+
+	// PathRemoveFileSpec() leaves the trailing backslash on a root (e.g. C:\), which matches the
+	// parsing name of a drive.
+	std::wstring parentKey = key;
+	BOOL res = PathRemoveFileSpec(parentKey.data());
+	parentKey.resize(wcslen(parentKey.c_str()));
+
+	std::scoped_lock lock(m_mutex);
+
+	m_entries.erase(key);
+
+	if (res)
+	{
+		m_entries.erase(parentKey);
+	}
+}
+
+void ItemAttributeCache::Clear()
+{
+	std::scoped_lock lock(m_mutex);
+	m_entries.clear();
+}
+
+std::wstring ItemAttributeCache::GetKey(const std::wstring &path)
+{
+	std::wstring key = path;
+	CharUpperBuff(key.data(), static_cast<DWORD>(key.size()));
+	return key;
+}
+
+ItemAttributeCache &GetItemAttributeCache()
+{
+	static ItemAttributeCache itemAttributeCache;
+	return itemAttributeCache;
+}
\ No newline at end of file
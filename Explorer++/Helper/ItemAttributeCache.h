@@ -0,0 +1,90 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+// Retrieving the attributes of an item (in particular, SFGAO_HASSUBFOLDER) can require the item
+// to be opened, which is slow on network drives. This class caches the attributes that have been
+// retrieved for each item, so that the treeview and listview don't repeatedly retrieve the same
+// attributes for the same items.
+//
+// Items are keyed on their parsing name, rather than the raw bytes of their pidl, since the pidls
+// for a single item can differ (e.g. depending on whether the item was enumerated or parsed).
+//
+// Entries expire after a fixed amount of time. Changes reported by a directory monitor should be
+// passed to InvalidateItem(), but not every folder is monitored (e.g. those on network drives),
+// so the expiry bounds the amount of time that outdated attributes for those folders can be used.
+//
+// The cache can be used concurrently from multiple threads.
+class ItemAttributeCache
+{
+public:
+	using Clock = std::function<std::chrono::steady_clock::time_point()>;
+
+	static constexpr auto DEFAULT_TIME_TO_LIVE = std::chrono::seconds(30);
+
+	explicit ItemAttributeCache(
+		std::chrono::steady_clock::duration timeToLive = DEFAULT_TIME_TO_LIVE,
+		Clock clock = std::chrono::steady_clock::now);
+
+	// Returns the requested attributes, if all of them are cached. The pidl version only converts
+	// the pidl to a parsing name and doesn't access the item itself, so it can be called from the
+	// UI thread.
+	std::optional<SFGAOF> GetCachedAttributes(const std::wstring &path, SFGAOF requested);
+	std::optional<SFGAOF> GetCachedAttributes(PCIDLIST_ABSOLUTE pidl, SFGAOF requested);
+
+	// Works in the same way as the GetItemAttributes() function in ShellHelper, except that any
+	// cached attributes are used. Attributes that have to be retrieved are added to the cache.
+	// Since retrieving attributes can be slow, this should generally be called from a background
+	// thread.
+	HRESULT GetItemAttributes(PCIDLIST_ABSOLUTE pidl, SFGAOF *attributes);
+
+	// Stores the attributes in the mask, retaining any other attributes that have been cached for
+	// the item.
+	void SetAttributes(const std::wstring &path, SFGAOF mask, SFGAOF attributes);
+
+	// Should be called once every item in the folder has been enumerated. Whether or not the
+	// folder contains subfolders is then known without having to ask the folder again. If hidden
+	// items weren't enumerated, the folder may still contain hidden subfolders, so the absence of
+	// any subfolders is only cached if hidden items were included.
+	void OnFolderEnumerated(
+		const std::wstring &path, bool containsSubfolders, bool includedHiddenItems);
+
+	// Should be called when the item is created, deleted, renamed or modified. Both the item and
+	// its parent folder (the subfolders of which may have changed) are removed from the cache.
+	void InvalidateItem(const std::wstring &path);
+
+	void Clear();
+
+private:
+	// The cache is cleared if it grows beyond this many items.
+	static const size_t MAX_ENTRIES = 50000;
+
+	struct Entry
+	{
+		// The attributes that have been retrieved, along with their values.
+		SFGAOF knownAttributes;
+		SFGAOF attributes;
+
+		std::chrono::steady_clock::time_point expiryTime;
+	};
+
+	static std::wstring GetKey(const std::wstring &path);
+
+	const std::chrono::steady_clock::duration m_timeToLive;
+	const Clock m_clock;
+
+	std::mutex m_mutex;
+	std::unordered_map<std::wstring, Entry> m_entries;
+};
+
+ItemAttributeCache &GetItemAttributeCache();
\ No newline at end of file
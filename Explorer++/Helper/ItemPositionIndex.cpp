@@ -0,0 +1,49 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ItemPositionIndex.h"
+
+void ItemPositionIndex::Invalidate()
+{
+	m_valid = false;
+}
+
+void ItemPositionIndex::OnItemAppended(int id, int position)
+{
+	if (!m_valid || position != m_numItems)
+	{
+		m_valid = false;
+		return;
+	}
+
+	SetPosition(id, position);
+	m_numItems++;
+}
+
+std::optional<int> ItemPositionIndex::Lookup(int id) const
+{
+	if (id < 0 || static_cast<size_t>(id) >= m_positions.size()
+		|| m_positions[id] == NOT_PRESENT)
+	{
+		return std::nullopt;
+	}
+
+	return m_positions[id];
+}
+
+void ItemPositionIndex::SetPosition(int id, int position)
+{
+	if (id < 0)
+	{
+		return;
+	}
+
+	if (static_cast<size_t>(id) >= m_positions.size())
+	{
+		m_positions.resize(id + 1, NOT_PRESENT);
+	}
+
+	m_positions[id] = position;
+}
\ No newline at end of file
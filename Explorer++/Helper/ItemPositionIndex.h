@@ -0,0 +1,72 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <optional>
+#include <vector>
+
+// Maps the ID of each item in a list to the item's position in the list. The IDs are expected to
+// be small, non-negative integers (e.g. those allocated by DenseIdMap), so the positions are stored
+// in a vector indexed by ID.
+//
+// The index doesn't track changes to the list itself. Instead, it's rebuilt from the list the
+// next time it's used, once it's been invalidated. That means any number of changes can be made
+// to the list for the cost of a single rebuild. Each position that's returned is checked against
+// the list, so a change that wasn't reported (and which left the number of items unchanged) will
+// still be picked up.
+class ItemPositionIndex
+{
+public:
+	// Should be called whenever items are inserted, removed or reordered.
+	void Invalidate();
+
+	// Appending an item doesn't change the position of any other item, so the index can be updated
+	// in place, rather than rebuilt.
+	void OnItemAppended(int id, int position);
+
+	// getItemId should return the ID of the item at the specified position.
+	template <typename GetItemId>
+	std::optional<int> Find(int id, int numItems, GetItemId getItemId)
+	{
+		if (!m_valid || numItems != m_numItems)
+		{
+			Rebuild(numItems, getItemId);
+		}
+
+		auto position = Lookup(id);
+
+		if (position && (*position >= numItems || getItemId(*position) != id))
+		{
+			Rebuild(numItems, getItemId);
+			position = Lookup(id);
+		}
+
+		return position;
+	}
+
+private:
+	static constexpr int NOT_PRESENT = -1;
+
+	template <typename GetItemId>
+	void Rebuild(int numItems, GetItemId getItemId)
+	{
+		m_positions.assign(m_positions.size(), NOT_PRESENT);
+
+		for (int i = 0; i < numItems; i++)
+		{
+			SetPosition(getItemId(i), i);
+		}
+
+		m_numItems = numItems;
+		m_valid = true;
+	}
+
+	std::optional<int> Lookup(int id) const;
+	void SetPosition(int id, int position);
+
+	std::vector<int> m_positions;
+	int m_numItems = 0;
+	bool m_valid = false;
+};
\ No newline at end of file
@@ -0,0 +1,328 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "LinkCreation.h"
+#include "ParallelWalk.h"
+#include <wil/resource.h>
+#include <winioctl.h>
+#include <atomic>
+#include <mutex>
+
+namespace
+{
+
+struct PendingLink
+{
+	std::wstring target;
+	std::wstring link;
+	DWORD attributes;
+};
+
+struct LinkCreationState
+{
+	std::atomic<int> itemsCreated = 0;
+	std::atomic<int> itemsFailed = 0;
+	std::atomic<int> totalItems = 0;
+
+	std::mutex errorMutex;
+	DWORD firstError = ERROR_SUCCESS;
+	std::wstring firstFailedPath;
+};
+
+// This is the mount point variant of REPARSE_DATA_BUFFER, which is only declared in the driver
+// headers.
+struct MountPointReparseBuffer
+{
+	DWORD ReparseTag;
+	WORD ReparseDataLength;
+	WORD Reserved;
+	WORD SubstituteNameOffset;
+	WORD SubstituteNameLength;
+	WORD PrintNameOffset;
+	WORD PrintNameLength;
+	WCHAR PathBuffer[1];
+};
+
+const std::wstring EXTENDED_LENGTH_PREFIX = L"\\\\?\\";
+const std::wstring EXTENDED_LENGTH_UNC_PREFIX = L"\\\\?\\UNC\\";
+
+std::wstring CombinePath(const std::wstring &folder, const std::wstring &name)
+{
+	if (!folder.empty() && folder.back() == '\\')
+	{
+		return folder + name;
+	}
+
+	return folder + L"\\" + name;
+}
+
+std::wstring GetFileName(const std::wstring &path)
+{
+	auto position = path.find_last_of('\\');
+
+	if (position == std::wstring::npos)
+	{
+		return path;
+	}
+
+	return path.substr(position + 1);
+}
+
+// Paths within a mirrored folder can easily exceed MAX_PATH, so all paths are converted to the
+// extended-length form, which isn't subject to that limit.
+std::wstring GetExtendedLengthPath(const std::wstring &path)
+{
+	if (path.starts_with(EXTENDED_LENGTH_PREFIX))
+	{
+		return path;
+	}
+
+	if (path.starts_with(L"\\\\"))
+	{
+		return EXTENDED_LENGTH_UNC_PREFIX + path.substr(2);
+	}
+
+	return EXTENDED_LENGTH_PREFIX + path;
+}
+
+DWORD CreateJunction(const std::wstring &target, const std::wstring &link)
+{
+	// Junctions can only refer to local volumes.
+	if (target.starts_with(EXTENDED_LENGTH_UNC_PREFIX))
+	{
+		return ERROR_NOT_SUPPORTED;
+	}
+
+	// The target of a junction is stored as an NT path, though the path presented to the user
+	// omits the prefix.
+	std::wstring printName = target.substr(EXTENDED_LENGTH_PREFIX.size());
+	std::wstring substituteName = L"\\??\\" + printName;
+
+	size_t substituteNameSize = substituteName.size() * sizeof(WCHAR);
+	size_t printNameSize = printName.size() * sizeof(WCHAR);
+
+	// Both names are null-terminated within the buffer.
+	size_t bufferSize = FIELD_OFFSET(MountPointReparseBuffer, PathBuffer) + substituteNameSize
+		+ sizeof(WCHAR) + printNameSize + sizeof(WCHAR);
+
+	if (bufferSize > MAXIMUM_REPARSE_DATA_BUFFER_SIZE)
+	{
+		return ERROR_FILENAME_EXCED_RANGE;
+	}
+
+	std::vector<BYTE> buffer(bufferSize);
+
+	auto *reparseBuffer = reinterpret_cast<MountPointReparseBuffer *>(buffer.data());
+	reparseBuffer->ReparseTag = IO_REPARSE_TAG_MOUNT_POINT;
+	reparseBuffer->ReparseDataLength = static_cast<WORD>(
+		buffer.size() - FIELD_OFFSET(MountPointReparseBuffer, SubstituteNameOffset));
+	reparseBuffer->SubstituteNameOffset = 0;
+	reparseBuffer->SubstituteNameLength = static_cast<WORD>(substituteNameSize);
+	reparseBuffer->PrintNameOffset = static_cast<WORD>(substituteNameSize + sizeof(WCHAR));
+	reparseBuffer->PrintNameLength = static_cast<WORD>(printNameSize);
+	memcpy(reparseBuffer->PathBuffer, substituteName.c_str(), substituteNameSize + sizeof(WCHAR));
+	memcpy(reinterpret_cast<BYTE *>(reparseBuffer->PathBuffer) + reparseBuffer->PrintNameOffset,
+		printName.c_str(), printNameSize + sizeof(WCHAR));
+
+	if (!CreateDirectory(link.c_str(), nullptr))
+	{
+		return GetLastError();
+	}
+
+	wil::unique_hfile folder(CreateFile(link.c_str(), GENERIC_WRITE, 0, nullptr, OPEN_EXISTING,
+		FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OPEN_REPARSE_POINT, nullptr));
+	DWORD bytesReturned;
+
+	if (!folder
+		|| !DeviceIoControl(folder.get(), FSCTL_SET_REPARSE_POINT, buffer.data(),
+			static_cast<DWORD>(buffer.size()), nullptr, 0, &bytesReturned, nullptr))
+	{
+		DWORD error = GetLastError();
+		folder.reset();
+		RemoveDirectory(link.c_str());
+		return error;
+	}
+
+	return ERROR_SUCCESS;
+}
+
+DWORD CreateSymbolicLinkToItem(const PendingLink &pendingLink)
+{
+	const auto &link = pendingLink.link;
+	const auto &target = pendingLink.target;
+	DWORD flags = WI_IsFlagSet(pendingLink.attributes, FILE_ATTRIBUTE_DIRECTORY)
+		? SYMBOLIC_LINK_FLAG_DIRECTORY
+		: 0;
+
+	// Unprivileged creation is only possible when developer mode is enabled, and the flag is
+	// rejected outright by versions of Windows that predate it.
+	if (CreateSymbolicLink(link.c_str(), target.c_str(),
+			flags | SYMBOLIC_LINK_FLAG_ALLOW_UNPRIVILEGED_CREATE))
+	{
+		return ERROR_SUCCESS;
+	}
+
+	if (GetLastError() == ERROR_INVALID_PARAMETER
+		&& CreateSymbolicLink(link.c_str(), target.c_str(), flags))
+	{
+		return ERROR_SUCCESS;
+	}
+
+	return GetLastError();
+}
+
+// Recreates the folder in the destination, then queues up each of its children.
+DWORD MirrorFolder(const PendingLink &pendingLink, LinkCreationState &state,
+	ParallelWalk<PendingLink>::Worker &worker)
+{
+	if (!CreateDirectory(pendingLink.link.c_str(), nullptr)
+		&& GetLastError() != ERROR_ALREADY_EXISTS)
+	{
+		return GetLastError();
+	}
+
+	WIN32_FIND_DATA findData;
+	wil::unique_hfind findHandle(FindFirstFileEx(CombinePath(pendingLink.target, L"*").c_str(),
+		FindExInfoBasic, &findData, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH));
+
+	if (!findHandle)
+	{
+		return GetLastError();
+	}
+
+	do
+	{
+		if (WI_IsFlagSet(findData.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY)
+			&& (lstrcmp(findData.cFileName, _T(".")) == 0
+				|| lstrcmp(findData.cFileName, _T("..")) == 0))
+		{
+			continue;
+		}
+
+		state.totalItems++;
+		worker.AddItem({ CombinePath(pendingLink.target, findData.cFileName),
+			CombinePath(pendingLink.link, findData.cFileName), findData.dwFileAttributes });
+	} while (FindNextFile(findHandle.get(), &findData));
+
+	return ERROR_SUCCESS;
+}
+
+DWORD CreateLink(const PendingLink &pendingLink, LinkType linkType, LinkCreationState &state,
+	ParallelWalk<PendingLink>::Worker &worker)
+{
+	bool isFolder = WI_IsFlagSet(pendingLink.attributes, FILE_ATTRIBUTE_DIRECTORY);
+
+	switch (linkType)
+	{
+	case LinkType::HardLink:
+		if (isFolder)
+		{
+			// Following a junction or symbolic link could lead outside the folder, or back into
+			// it.
+			if (WI_IsFlagSet(pendingLink.attributes, FILE_ATTRIBUTE_REPARSE_POINT))
+			{
+				return ERROR_NOT_SUPPORTED;
+			}
+
+			return MirrorFolder(pendingLink, state, worker);
+		}
+
+		if (!CreateHardLink(pendingLink.link.c_str(), pendingLink.target.c_str(), nullptr))
+		{
+			return GetLastError();
+		}
+
+		return ERROR_SUCCESS;
+
+	case LinkType::SymbolicLink:
+		return CreateSymbolicLinkToItem(pendingLink);
+
+	case LinkType::Junction:
+		if (!isFolder)
+		{
+			return ERROR_DIRECTORY;
+		}
+
+		return CreateJunction(pendingLink.target, pendingLink.link);
+	}
+
+	return ERROR_INVALID_PARAMETER;
+}
+
+}
+
+LinkCreationResult CreateLinks(const std::vector<std::wstring> &targetPaths,
+	const std::wstring &destinationFolder, LinkType linkType, std::stop_token stopToken,
+	const LinkCreationProgressCallback &progressCallback)
+{
+	LinkCreationState state;
+	std::wstring destination = GetExtendedLengthPath(destinationFolder);
+
+	std::vector<PendingLink> roots;
+	roots.reserve(targetPaths.size());
+
+	for (const auto &targetPath : targetPaths)
+	{
+		std::wstring target = GetExtendedLengthPath(targetPath);
+		DWORD attributes = GetFileAttributes(target.c_str());
+
+		if (attributes == INVALID_FILE_ATTRIBUTES)
+		{
+			// The item will be treated as a file, with the error then being reported when the
+			// link is created.
+			attributes = 0;
+		}
+
+		roots.push_back({ target, CombinePath(destination, GetFileName(targetPath)), attributes });
+	}
+
+	state.totalItems = static_cast<int>(roots.size());
+
+	auto reportProgress = [&state, &progressCallback]() {
+		if (!progressCallback)
+		{
+			return;
+		}
+
+		LinkCreationProgress progress;
+		progress.itemsFailed = state.itemsFailed;
+		progress.itemsProcessed = state.itemsCreated + progress.itemsFailed;
+		progress.totalItems = state.totalItems;
+		progressCallback(progress);
+	};
+
+	ParallelWalk<PendingLink>::Run(
+		std::move(roots),
+		[&state, linkType](const PendingLink &pendingLink,
+			ParallelWalk<PendingLink>::Worker &worker) {
+			DWORD error = CreateLink(pendingLink, linkType, state, worker);
+
+			if (error == ERROR_SUCCESS)
+			{
+				state.itemsCreated++;
+				return;
+			}
+
+			state.itemsFailed++;
+
+			std::scoped_lock lock(state.errorMutex);
+
+			if (state.firstError == ERROR_SUCCESS)
+			{
+				state.firstError = error;
+				state.firstFailedPath = pendingLink.target;
+			}
+		},
+		stopToken, reportProgress);
+
+	reportProgress();
+
+	LinkCreationResult result;
+	result.itemsCreated = state.itemsCreated;
+	result.itemsFailed = state.itemsFailed;
+	result.firstError = state.firstError;
+	result.firstFailedPath = state.firstFailedPath;
+	return result;
+}
\ No newline at end of file
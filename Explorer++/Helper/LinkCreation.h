@@ -0,0 +1,56 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <functional>
+#include <stop_token>
+#include <string>
+#include <vector>
+
+enum class LinkType
+{
+	HardLink,
+	SymbolicLink,
+
+	// Only valid for folders on a local volume.
+	Junction
+};
+
+struct LinkCreationProgress
+{
+	int itemsProcessed;
+
+	// When hard links are created for a folder, its contents are enumerated as the operation
+	// proceeds, so this will continue to grow until everything has been found.
+	int totalItems;
+
+	int itemsFailed;
+};
+
+struct LinkCreationResult
+{
+	int itemsCreated = 0;
+	int itemsFailed = 0;
+
+	// Details of the first failure, if there were any.
+	DWORD firstError = ERROR_SUCCESS;
+	std::wstring firstFailedPath;
+};
+
+// Invoked periodically on the calling thread while links are being created.
+using LinkCreationProgressCallback = std::function<void(const LinkCreationProgress &progress)>;
+
+// Creates a link to each of the target items within the destination folder. Each link has the same
+// name as its target. Paths of any length are supported.
+//
+// Since a hard link can't refer to a folder, hard linking a folder mirrors it instead: the folder
+// structure is recreated in the destination, with each file within it being hard linked. Junctions
+// and symbolic links within such a folder aren't followed and are reported as failures.
+//
+// Links are created in parallel, using the threads shared with ParallelWalk. If a stop is
+// requested, any links already created are left in place.
+LinkCreationResult CreateLinks(const std::vector<std::wstring> &targetPaths,
+	const std::wstring &destinationFolder, LinkType linkType, std::stop_token stopToken = {},
+	const LinkCreationProgressCallback &progressCallback = nullptr);
\ No newline at end of file
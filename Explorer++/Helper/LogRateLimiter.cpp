@@ -0,0 +1,35 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "LogRateLimiter.h"
+
+LogRateLimiter::LogRateLimiter(Clock::duration interval) :
+	m_interval(interval),
+	m_nextAllowedTime(Clock::time_point::min().time_since_epoch().count())
+{
+}
+
+bool LogRateLimiter::ShouldLog(Clock::time_point now)
+{
+	Clock::rep nextAllowedTime = m_nextAllowedTime.load(std::memory_order_relaxed);
+	Clock::rep currentTime = now.time_since_epoch().count();
+
+	// If several threads reach this point at the same time, only the thread that manages to update
+	// the next allowed time will log its message.
+	if (currentTime < nextAllowedTime
+		|| !m_nextAllowedTime.compare_exchange_strong(nextAllowedTime,
+			(now + m_interval).time_since_epoch().count(), std::memory_order_relaxed))
+	{
+		m_suppressedCount.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	return true;
+}
+
+uint64_t LogRateLimiter::TakeSuppressedCount()
+{
+	return m_suppressedCount.exchange(0, std::memory_order_relaxed);
+}
\ No newline at end of file
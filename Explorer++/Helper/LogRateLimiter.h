@@ -0,0 +1,38 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Limits how often a single logging statement can write to the log. A message that's logged from a
+// hot path (e.g. once for every folder that's opened) would otherwise be able to flood the log.
+// Messages that are dropped are counted, so that the next message that's let through can report
+// how many were skipped.
+//
+// Can be used from multiple threads.
+class LogRateLimiter
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	explicit LogRateLimiter(Clock::duration interval);
+
+	// Returns true if a message should be logged at the specified time. At most one message will be
+	// let through within each interval.
+	bool ShouldLog(Clock::time_point now = Clock::now());
+
+	// Returns the number of messages that have been dropped since this was last called.
+	uint64_t TakeSuppressedCount();
+
+private:
+	const Clock::duration m_interval;
+
+	// The time (as a count of clock ticks) at which the next message can be logged.
+	std::atomic<Clock::rep> m_nextAllowedTime;
+
+	std::atomic<uint64_t> m_suppressedCount = 0;
+};
\ No newline at end of file
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include "LogRateLimiter.h"
 #include <boost\log\common.hpp>
 #include <boost\log\sources\global_logger_storage.hpp>
 #include <boost\log\sources\severity_logger.hpp>
@@ -35,6 +36,45 @@ inline std::basic_ostream<CharT, TraitsT> &operator<<(
 	return stream;
 }
 
+// Written at the start of a rate-limited message, if any earlier messages from the same statement
+// were dropped.
+struct SuppressedMessageCount
+{
+	uint64_t count;
+};
+
+template <typename CharT, typename TraitsT>
+inline std::basic_ostream<CharT, TraitsT> &operator<<(
+	std::basic_ostream<CharT, TraitsT> &stream, SuppressedMessageCount suppressed)
+{
+	if (suppressed.count > 0)
+	{
+		stream << "(" << suppressed.count << " similar messages suppressed) ";
+	}
+
+	return stream;
+}
+
 BOOST_LOG_GLOBAL_LOGGER(logger, boost::log::sources::wseverity_logger_mt<SeverityLevel>)
 
-#define LOG(severity) BOOST_LOG_SEV(logger::get(), severity)
\ No newline at end of file
+// Log statements below this severity are compiled out entirely, so that debug logging has no cost
+// in release builds.
+#ifndef LOG_MINIMUM_SEVERITY
+#ifdef _DEBUG
+#define LOG_MINIMUM_SEVERITY debug
+#else
+#define LOG_MINIMUM_SEVERITY info
+#endif
+#endif
+
+#define LOG(severity) \
+	if constexpr ((severity) < LOG_MINIMUM_SEVERITY) {} \
+	else \
+		BOOST_LOG_SEV(logger::get(), severity)
+
+// Logs at most one message from this statement within each interval. Should be used for messages
+// that can be written from code that runs frequently.
+#define LOG_RATE_LIMITED(severity, interval) \
+	if (static LogRateLimiter logRateLimiter(interval); !logRateLimiter.ShouldLog()) {} \
+	else \
+		LOG(severity) << SuppressedMessageCount{ logRateLimiter.TakeSuppressedCount() }
\ No newline at end of file
@@ -0,0 +1,111 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "LruSlotAllocator.h"
+
+LruSlotAllocator::LruSlotAllocator(int capacity) : m_capacity(capacity)
+{
+	Clear();
+}
+
+std::optional<LruSlotAllocator::Allocation> LruSlotAllocator::Allocate(
+	int owner, const CanEvictCallback &canEvict)
+{
+	auto existingItr = m_ownerSlots.find(owner);
+
+	if (existingItr != m_ownerSlots.end())
+	{
+		m_usedSlots.splice(m_usedSlots.begin(), m_usedSlots, existingItr->second);
+		return Allocation{ existingItr->second->slot, std::nullopt };
+	}
+
+	Allocation allocation;
+
+	if (!m_freeSlots.empty())
+	{
+		allocation.slot = m_freeSlots.back();
+		m_freeSlots.pop_back();
+	}
+	else
+	{
+		auto evictItr = m_usedSlots.end();
+
+		for (auto itr = m_usedSlots.rbegin(); itr != m_usedSlots.rend(); ++itr)
+		{
+			if (!canEvict || canEvict(itr->owner))
+			{
+				evictItr = std::prev(itr.base());
+				break;
+			}
+		}
+
+		if (evictItr == m_usedSlots.end())
+		{
+			return std::nullopt;
+		}
+
+		allocation.slot = evictItr->slot;
+		allocation.evictedOwner = evictItr->owner;
+
+		m_ownerSlots.erase(evictItr->owner);
+		m_usedSlots.erase(evictItr);
+	}
+
+	m_usedSlots.push_front({ allocation.slot, owner });
+	m_ownerSlots.insert({ owner, m_usedSlots.begin() });
+
+	return allocation;
+}
+
+std::optional<int> LruSlotAllocator::GetSlot(int owner) const
+{
+	auto itr = m_ownerSlots.find(owner);
+
+	if (itr == m_ownerSlots.end())
+	{
+		return std::nullopt;
+	}
+
+	return itr->second->slot;
+}
+
+void LruSlotAllocator::Release(int owner)
+{
+	auto itr = m_ownerSlots.find(owner);
+
+	if (itr == m_ownerSlots.end())
+	{
+		return;
+	}
+
+	m_freeSlots.push_back(itr->second->slot);
+	m_usedSlots.erase(itr->second);
+	m_ownerSlots.erase(itr);
+}
+
+void LruSlotAllocator::Clear()
+{
+	m_usedSlots.clear();
+	m_ownerSlots.clear();
+
+	// Slots are taken from the back, so they're handed out in ascending order.
+	m_freeSlots.clear();
+
+	for (int slot = m_capacity - 1; slot >= 0; slot--)
+	{
+		m_freeSlots.push_back(slot);
+	}
+}
+
+void LruSlotAllocator::Reset(int capacity)
+{
+	m_capacity = capacity;
+	Clear();
+}
+
+int LruSlotAllocator::GetCapacity() const
+{
+	return m_capacity;
+}
\ No newline at end of file
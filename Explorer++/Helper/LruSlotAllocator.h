@@ -0,0 +1,60 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <functional>
+#include <list>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+// Hands out a fixed number of slots (numbered from 0 to capacity - 1) to owners, each of which is
+// identified by an integer. Once every slot is in use, the least recently used slot is taken from
+// its owner and reassigned. This allows a fixed-size resource (e.g. an image list) to be shared
+// between an unbounded number of owners.
+class LruSlotAllocator
+{
+public:
+	struct Allocation
+	{
+		int slot;
+
+		// The owner that previously held the slot, if it had to be taken from another owner.
+		std::optional<int> evictedOwner;
+	};
+
+	// Returns whether the slot can be taken from the specified owner.
+	using CanEvictCallback = std::function<bool(int owner)>;
+
+	explicit LruSlotAllocator(int capacity);
+
+	// Returns the slot held by the owner (marking it as the most recently used), or assigns a new
+	// one. If there are no free slots, the least recently used slot that the callback allows to be
+	// evicted is reassigned. Returns std::nullopt if no slot could be assigned.
+	std::optional<Allocation> Allocate(int owner, const CanEvictCallback &canEvict = nullptr);
+
+	std::optional<int> GetSlot(int owner) const;
+	void Release(int owner);
+	void Clear();
+
+	// Releases every slot and changes the number of slots available.
+	void Reset(int capacity);
+
+	int GetCapacity() const;
+
+private:
+	struct SlotEntry
+	{
+		int slot;
+		int owner;
+	};
+
+	int m_capacity;
+	std::vector<int> m_freeSlots;
+
+	// Ordered from most to least recently used.
+	std::list<SlotEntry> m_usedSlots;
+	std::unordered_map<int, std::list<SlotEntry>::iterator> m_ownerSlots;
+};
\ No newline at end of file
@@ -0,0 +1,140 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "MemoryBudget.h"
+#include <algorithm>
+
+MemoryBudget &MemoryBudget::GetInstance()
+{
+	static MemoryBudget memoryBudget;
+	return memoryBudget;
+}
+
+MemoryBudget::MemoryBudget(size_t maxWorkingSetBytes) : m_maxWorkingSetBytes(maxWorkingSetBytes)
+{
+}
+
+int MemoryBudget::AddConsumer(
+	Priority priority, UsageCallback usageCallback, TrimCallback trimCallback)
+{
+	std::scoped_lock lock(m_mutex);
+
+	int id = m_consumerIdCounter++;
+
+	auto itr = std::upper_bound(m_consumers.begin(), m_consumers.end(), priority,
+		[](Priority priority, const Consumer &consumer) { return priority < consumer.priority; });
+	m_consumers.insert(
+		itr, { id, priority, std::move(usageCallback), std::move(trimCallback) });
+
+	return id;
+}
+
+void MemoryBudget::RemoveConsumer(int id)
+{
+	std::scoped_lock lock(m_mutex);
+	std::erase_if(m_consumers, [id](const Consumer &consumer) { return consumer.id == id; });
+}
+
+size_t MemoryBudget::GetUsage() const
+{
+	size_t usage = 0;
+
+	for (const auto &consumer : GetConsumers())
+	{
+		usage += consumer.usageCallback();
+	}
+
+	return usage;
+}
+
+size_t MemoryBudget::GetUsage(Priority priority) const
+{
+	size_t usage = 0;
+
+	for (const auto &consumer : GetConsumers())
+	{
+		if (consumer.priority == priority)
+		{
+			usage += consumer.usageCallback();
+		}
+	}
+
+	return usage;
+}
+
+size_t MemoryBudget::GetMaxWorkingSetBytes() const
+{
+	std::scoped_lock lock(m_mutex);
+	return m_maxWorkingSetBytes;
+}
+
+void MemoryBudget::SetMaxWorkingSetBytes(size_t maxWorkingSetBytes)
+{
+	std::scoped_lock lock(m_mutex);
+	m_maxWorkingSetBytes = maxWorkingSetBytes;
+}
+
+size_t MemoryBudget::OnMemoryPressure(size_t workingSetBytes, bool lowMemory)
+{
+	size_t maxWorkingSetBytes = GetMaxWorkingSetBytes();
+	size_t excessBytes =
+		(workingSetBytes > maxWorkingSetBytes) ? workingSetBytes - maxWorkingSetBytes : 0;
+	size_t usage = GetUsage();
+
+	if (lowMemory)
+	{
+		excessBytes = (std::max)(excessBytes, usage - (usage / 2));
+	}
+
+	if (excessBytes == 0 || usage == 0)
+	{
+		return 0;
+	}
+
+	return TrimToSize(usage - (std::min)(excessBytes, usage));
+}
+
+size_t MemoryBudget::TrimToSize(size_t maxBytes)
+{
+	// The callbacks are invoked without the lock held, so that a consumer can be added or removed
+	// on another thread while the consumers are being trimmed.
+	auto consumers = GetConsumers();
+
+	std::vector<size_t> usages;
+	usages.reserve(consumers.size());
+
+	size_t totalUsage = 0;
+
+	for (const auto &consumer : consumers)
+	{
+		usages.push_back(consumer.usageCallback());
+		totalUsage += usages.back();
+	}
+
+	size_t bytesReleased = 0;
+
+	for (size_t i = 0; i < consumers.size() && totalUsage > maxBytes; i++)
+	{
+		if (usages[i] == 0)
+		{
+			continue;
+		}
+
+		size_t excessBytes = totalUsage - maxBytes;
+		consumers[i].trimCallback((usages[i] > excessBytes) ? usages[i] - excessBytes : 0);
+
+		size_t updatedUsage = (std::min)(consumers[i].usageCallback(), usages[i]);
+		totalUsage -= usages[i] - updatedUsage;
+		bytesReleased += usages[i] - updatedUsage;
+	}
+
+	return bytesReleased;
+}
+
+std::vector<MemoryBudget::Consumer> MemoryBudget::GetConsumers() const
+{
+	std::scoped_lock lock(m_mutex);
+	return m_consumers;
+}
\ No newline at end of file
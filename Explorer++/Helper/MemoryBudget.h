@@ -0,0 +1,91 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "Macros.h"
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// Tracks the memory used by the application's caches and trims them when the process is over its
+// memory budget, or the system is running low on memory.
+//
+// Each cache registers itself as a consumer, along with a priority. When memory needs to be
+// released, consumers are trimmed in priority order and trimming stops as soon as enough memory
+// has been released. That way, the caches that are cheapest to rebuild are trimmed first and the
+// others are only trimmed if that isn't sufficient.
+class MemoryBudget
+{
+public:
+	// Consumers are trimmed in this order.
+	enum class Priority
+	{
+		// The items from folders that were navigated away from, which are only used if the folder
+		// is navigated back to.
+		FolderSnapshots,
+
+		Thumbnails,
+		Icons,
+
+		// The column text retrieved for the folder that's currently shown in each tab. Text that's
+		// removed will be retrieved again if it's needed.
+		ColumnText
+	};
+
+	// Returns the approximate number of bytes used by the consumer.
+	using UsageCallback = std::function<size_t()>;
+
+	// Asks the consumer to reduce its usage to (approximately) the specified number of bytes.
+	using TrimCallback = std::function<void(size_t maxBytes)>;
+
+	static constexpr size_t DEFAULT_MAX_WORKING_SET_BYTES = 512 * 1024 * 1024;
+
+	static MemoryBudget &GetInstance();
+
+	explicit MemoryBudget(size_t maxWorkingSetBytes = DEFAULT_MAX_WORKING_SET_BYTES);
+
+	// Consumers can be added from any thread. A consumer's callbacks are only invoked from the
+	// thread that trims the budget (the main thread) and consumers should only be removed from that
+	// thread, since the callbacks could otherwise still be running.
+	int AddConsumer(Priority priority, UsageCallback usageCallback, TrimCallback trimCallback);
+	void RemoveConsumer(int id);
+
+	size_t GetUsage() const;
+	size_t GetUsage(Priority priority) const;
+
+	size_t GetMaxWorkingSetBytes() const;
+	void SetMaxWorkingSetBytes(size_t maxWorkingSetBytes);
+
+	// Called with the current size of the process working set, once it's over the budget, or when
+	// the system is low on memory. In the first case, the consumers release enough memory to bring
+	// the working set back under budget (as far as that's possible). In the second case, at least
+	// half of the memory used by the consumers is released. Returns the number of bytes released.
+	size_t OnMemoryPressure(size_t workingSetBytes, bool lowMemory);
+
+	// Trims consumers, in priority order, until their combined usage is at most maxBytes. Returns
+	// the number of bytes released.
+	size_t TrimToSize(size_t maxBytes);
+
+private:
+	DISALLOW_COPY_AND_ASSIGN(MemoryBudget);
+
+	struct Consumer
+	{
+		int id;
+		Priority priority;
+		UsageCallback usageCallback;
+		TrimCallback trimCallback;
+	};
+
+	std::vector<Consumer> GetConsumers() const;
+
+	mutable std::mutex m_mutex;
+
+	// Ordered by priority and then by the order in which consumers were added.
+	std::vector<Consumer> m_consumers;
+
+	int m_consumerIdCounter = 0;
+	size_t m_maxWorkingSetBytes;
+};
\ No newline at end of file
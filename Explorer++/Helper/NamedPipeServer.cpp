@@ -0,0 +1,238 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "NamedPipeServer.h"
+
+namespace
+{
+
+// If all instances of the pipe are busy, a client will wait this long for the pipe to become
+// available.
+const DWORD CLIENT_CONNECT_TIMEOUT = 2000;
+
+}
+
+std::unique_ptr<NamedPipeServer> NamedPipeServer::Create(
+	const std::wstring &pipeName, MessageHandler messageHandler)
+{
+	// FILE_FLAG_FIRST_PIPE_INSTANCE ensures that the server doesn't share the pipe with (and
+	// receive messages intended for) another server that's already listening.
+	wil::unique_hfile pipe(CreateNamedPipe(pipeName.c_str(),
+		PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+		PIPE_TYPE_MESSAGE | PIPE_READMODE_MESSAGE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS, 1,
+		sizeof(BYTE), MAX_MESSAGE_SIZE, 0, nullptr));
+
+	if (!pipe)
+	{
+		return nullptr;
+	}
+
+	return std::unique_ptr<NamedPipeServer>(
+		new NamedPipeServer(std::move(pipe), std::move(messageHandler)));
+}
+
+NamedPipeServer::NamedPipeServer(wil::unique_hfile pipe, MessageHandler messageHandler) :
+	m_pipe(std::move(pipe)),
+	m_messageHandler(std::move(messageHandler))
+{
+	m_ioEvent.create(wil::EventOptions::ManualReset);
+	m_stopEvent.create(wil::EventOptions::ManualReset);
+
+	m_thread = std::thread(&NamedPipeServer::Run, this);
+}
+
+NamedPipeServer::~NamedPipeServer()
+{
+	m_stopEvent.SetEvent();
+	m_thread.join();
+}
+
+void NamedPipeServer::Run()
+{
+	while (true)
+	{
+		OVERLAPPED overlapped = {};
+		overlapped.hEvent = m_ioEvent.get();
+
+		BOOL res = ConnectNamedPipe(m_pipe.get(), &overlapped);
+		DWORD error = GetLastError();
+
+		if (!res && error == ERROR_IO_PENDING)
+		{
+			DWORD numBytesTransferred;
+
+			if (!WaitForIo(overlapped, INFINITE, numBytesTransferred))
+			{
+				if (m_stopEvent.is_signaled())
+				{
+					return;
+				}
+
+				continue;
+			}
+		}
+		else if (!res && error != ERROR_PIPE_CONNECTED)
+		{
+			// The client may have connected and then disconnected straight away.
+			DisconnectNamedPipe(m_pipe.get());
+
+			if (m_stopEvent.is_signaled())
+			{
+				return;
+			}
+
+			continue;
+		}
+
+		HandleClient();
+		DisconnectNamedPipe(m_pipe.get());
+
+		if (m_stopEvent.is_signaled())
+		{
+			return;
+		}
+	}
+}
+
+void NamedPipeServer::HandleClient()
+{
+	std::wstring message(MAX_MESSAGE_SIZE / sizeof(wchar_t), '\0');
+
+	OVERLAPPED overlapped = {};
+	overlapped.hEvent = m_ioEvent.get();
+	DWORD numBytesRead = 0;
+	BOOL res = ReadFile(m_pipe.get(), message.data(), MAX_MESSAGE_SIZE, &numBytesRead, &overlapped);
+
+	if (!res)
+	{
+		// ERROR_MORE_DATA indicates that the message was too large, in which case it's ignored.
+		if (GetLastError() != ERROR_IO_PENDING
+			|| !WaitForIo(overlapped, CLIENT_TIMEOUT, numBytesRead))
+		{
+			return;
+		}
+	}
+
+	if (numBytesRead % sizeof(wchar_t) != 0)
+	{
+		return;
+	}
+
+	message.resize(numBytesRead / sizeof(wchar_t));
+
+	BYTE reply = m_messageHandler(message) ? 1 : 0;
+
+	overlapped = {};
+	overlapped.hEvent = m_ioEvent.get();
+	DWORD numBytesWritten;
+	res = WriteFile(m_pipe.get(), &reply, sizeof(reply), &numBytesWritten, &overlapped);
+
+	if (!res
+		&& (GetLastError() != ERROR_IO_PENDING
+			|| !WaitForIo(overlapped, CLIENT_TIMEOUT, numBytesWritten)))
+	{
+		return;
+	}
+
+	// Disconnecting the pipe discards any data that hasn't been read yet, so the client is given
+	// the chance to read the reply and close its end of the pipe first. The read here will complete
+	// once that happens.
+	BYTE unused;
+	overlapped = {};
+	overlapped.hEvent = m_ioEvent.get();
+	res = ReadFile(m_pipe.get(), &unused, sizeof(unused), &numBytesRead, &overlapped);
+
+	if (!res && GetLastError() == ERROR_IO_PENDING)
+	{
+		WaitForIo(overlapped, CLIENT_TIMEOUT, numBytesRead);
+	}
+}
+
+// Returns true if the operation completed successfully. If the operation is still pending once the
+// timeout has elapsed, or the server is stopped in the meantime, the operation is cancelled.
+bool NamedPipeServer::WaitForIo(OVERLAPPED &overlapped, DWORD timeout, DWORD &numBytesTransferred)
+{
+	HANDLE events[] = { m_stopEvent.get(), m_ioEvent.get() };
+	DWORD waitResult = WaitForMultipleObjects(ARRAYSIZE(events), events, FALSE, timeout);
+
+	if (waitResult != WAIT_OBJECT_0 + 1)
+	{
+		CancelIoEx(m_pipe.get(), &overlapped);
+		GetOverlappedResult(m_pipe.get(), &overlapped, &numBytesTransferred, TRUE);
+		return false;
+	}
+
+	return GetOverlappedResult(m_pipe.get(), &overlapped, &numBytesTransferred, FALSE);
+}
+
+std::optional<bool> SendNamedPipeMessage(const std::wstring &pipeName, const std::wstring &message,
+	const std::function<void(DWORD serverProcessId)> &connectedCallback)
+{
+	if (message.size() * sizeof(wchar_t) > NamedPipeServer::MAX_MESSAGE_SIZE)
+	{
+		return std::nullopt;
+	}
+
+	wil::unique_hfile pipe(CreateFile(pipeName.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+		OPEN_EXISTING, 0, nullptr));
+
+	if (!pipe)
+	{
+		// The server only handles a single client at a time, so if another client is currently
+		// connected, this client will have to wait.
+		if (GetLastError() != ERROR_PIPE_BUSY
+			|| !WaitNamedPipe(pipeName.c_str(), CLIENT_CONNECT_TIMEOUT))
+		{
+			return std::nullopt;
+		}
+
+		pipe.reset(CreateFile(pipeName.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+			OPEN_EXISTING, 0, nullptr));
+
+		if (!pipe)
+		{
+			return std::nullopt;
+		}
+	}
+
+	DWORD mode = PIPE_READMODE_MESSAGE;
+	BOOL res = SetNamedPipeHandleState(pipe.get(), &mode, nullptr, nullptr);
+
+	if (!res)
+	{
+		return std::nullopt;
+	}
+
+	if (connectedCallback)
+	{
+		ULONG serverProcessId;
+		res = GetNamedPipeServerProcessId(pipe.get(), &serverProcessId);
+
+		if (res)
+		{
+			connectedCallback(serverProcessId);
+		}
+	}
+
+	DWORD numBytesWritten;
+	res = WriteFile(pipe.get(), message.data(), static_cast<DWORD>(message.size() * sizeof(wchar_t)),
+		&numBytesWritten, nullptr);
+
+	if (!res)
+	{
+		return std::nullopt;
+	}
+
+	BYTE reply;
+	DWORD numBytesRead;
+	res = ReadFile(pipe.get(), &reply, sizeof(reply), &numBytesRead, nullptr);
+
+	if (!res || numBytesRead != sizeof(reply))
+	{
+		return std::nullopt;
+	}
+
+	return reply != 0;
+}
\ No newline at end of file
@@ -0,0 +1,57 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <wil/resource.h>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+
+// Listens on a named pipe for messages from other processes belonging to the same user. Clients
+// are handled one at a time, on a dedicated thread. Each client sends a single message and receives
+// a reply indicating whether the message was accepted. Clients on other machines are rejected.
+class NamedPipeServer
+{
+public:
+	// Called on the server thread. The return value is sent back to the client, so this should
+	// return quickly (e.g. by queuing the message for processing elsewhere).
+	using MessageHandler = std::function<bool(const std::wstring &message)>;
+
+	// Messages larger than this are rejected.
+	static const DWORD MAX_MESSAGE_SIZE = 64 * 1024;
+
+	// Returns null if the pipe couldn't be created (e.g. because another server is already
+	// listening on it).
+	static std::unique_ptr<NamedPipeServer> Create(
+		const std::wstring &pipeName, MessageHandler messageHandler);
+
+	~NamedPipeServer();
+
+private:
+	// The amount of time a connected client has to send its message (or to read the reply), before
+	// it's disconnected.
+	static const DWORD CLIENT_TIMEOUT = 5000;
+
+	NamedPipeServer(wil::unique_hfile pipe, MessageHandler messageHandler);
+
+	void Run();
+	void HandleClient();
+	bool WaitForIo(OVERLAPPED &overlapped, DWORD timeout, DWORD &numBytesTransferred);
+
+	wil::unique_hfile m_pipe;
+	const MessageHandler m_messageHandler;
+	wil::unique_event_nothrow m_ioEvent;
+	wil::unique_event_nothrow m_stopEvent;
+	std::thread m_thread;
+};
+
+// Sends the message to the server listening on the specified pipe. Returns std::nullopt if there's
+// no server, or if the message couldn't be delivered. Otherwise, returns whether the server accepted
+// the message. If provided, connectedCallback is invoked with the process ID of the server before
+// the message is sent.
+std::optional<bool> SendNamedPipeMessage(const std::wstring &pipeName, const std::wstring &message,
+	const std::function<void(DWORD serverProcessId)> &connectedCallback = nullptr);
\ No newline at end of file
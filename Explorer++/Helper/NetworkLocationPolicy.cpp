@@ -0,0 +1,263 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "NetworkLocationPolicy.h"
+#include <boost/algorithm/string/predicate.hpp>
+#include <fstream>
+
+namespace
+{
+
+template <typename T>
+void WriteValue(std::ofstream &stream, const T &value)
+{
+	stream.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+void WriteString(std::ofstream &stream, const std::wstring &value)
+{
+	WriteValue(stream, static_cast<uint32_t>(value.size()));
+	stream.write(reinterpret_cast<const char *>(value.data()), value.size() * sizeof(wchar_t));
+}
+
+template <typename T>
+bool ReadValue(std::ifstream &stream, T &value)
+{
+	stream.read(reinterpret_cast<char *>(&value), sizeof(value));
+	return stream.good();
+}
+
+bool ReadString(std::ifstream &stream, std::wstring &value)
+{
+	uint32_t size;
+
+	if (!ReadValue(stream, size) || size > MAX_PATH)
+	{
+		return false;
+	}
+
+	value.resize(size);
+	stream.read(reinterpret_cast<char *>(value.data()), size * sizeof(wchar_t));
+	return stream.good();
+}
+
+}
+
+NetworkLocationPolicy &NetworkLocationPolicy::GetInstance()
+{
+	static NetworkLocationPolicy networkLocationPolicy;
+	return networkLocationPolicy;
+}
+
+std::wstring NetworkLocationPolicy::GetServerName(const std::wstring &path)
+{
+	std::wstring server = GetServerNameFromUncPath(path);
+
+	if (!server.empty())
+	{
+		return server;
+	}
+
+	if (path.size() < 2 || !iswalpha(path[0]) || path[1] != ':')
+	{
+		return {};
+	}
+
+	std::wstring drive = path.substr(0, 2);
+
+	if (GetDriveType((drive + L"\\").c_str()) != DRIVE_REMOTE)
+	{
+		return {};
+	}
+
+	wchar_t remoteName[MAX_PATH];
+	DWORD size = static_cast<DWORD>(std::size(remoteName));
+
+	if (WNetGetConnection(drive.c_str(), remoteName, &size) != NO_ERROR)
+	{
+		return {};
+	}
+
+	return GetServerNameFromUncPath(remoteName);
+}
+
+std::wstring NetworkLocationPolicy::GetServerNameFromUncPath(const std::wstring &path)
+{
+	std::wstring_view remaining = path;
+
+	if (boost::istarts_with(remaining, L"\\\\?\\UNC\\"))
+	{
+		remaining.remove_prefix(8);
+	}
+	else if (remaining.starts_with(L"\\\\") && !remaining.starts_with(L"\\\\?\\")
+		&& !remaining.starts_with(L"\\\\.\\"))
+	{
+		remaining.remove_prefix(2);
+	}
+	else
+	{
+		return {};
+	}
+
+	std::wstring server(remaining.substr(0, remaining.find(L'\\')));
+	CharUpperBuff(server.data(), static_cast<DWORD>(server.size()));
+
+	return server;
+}
+
+NetworkLocationMode NetworkLocationPolicy::GetMode(const std::wstring &server) const
+{
+	std::scoped_lock lock(m_mutex);
+
+	auto itr = m_modes.find(server);
+
+	if (itr == m_modes.end())
+	{
+		return NetworkLocationMode::Automatic;
+	}
+
+	return itr->second;
+}
+
+void NetworkLocationPolicy::SetMode(const std::wstring &server, NetworkLocationMode mode)
+{
+	std::scoped_lock lock(m_mutex);
+
+	if (mode == NetworkLocationMode::Automatic)
+	{
+		m_modes.erase(server);
+	}
+	else
+	{
+		m_modes[server] = mode;
+	}
+}
+
+bool NetworkLocationPolicy::IsReduced(
+	const std::wstring &server, std::optional<std::chrono::microseconds> latency) const
+{
+	switch (GetMode(server))
+	{
+	case NetworkLocationMode::Full:
+		return false;
+
+	case NetworkLocationMode::Reduced:
+		return true;
+
+	case NetworkLocationMode::Automatic:
+	default:
+		return latency && *latency > HIGH_LATENCY_THRESHOLD;
+	}
+}
+
+bool NetworkLocationPolicy::IsServerUnreachableError(HRESULT hr)
+{
+	switch (hr)
+	{
+	case HRESULT_FROM_WIN32(ERROR_BAD_NETPATH):
+	case HRESULT_FROM_WIN32(ERROR_NETWORK_UNREACHABLE):
+	case HRESULT_FROM_WIN32(ERROR_HOST_UNREACHABLE):
+	case HRESULT_FROM_WIN32(ERROR_HOST_DOWN):
+	case HRESULT_FROM_WIN32(ERROR_SEM_TIMEOUT):
+	case HRESULT_FROM_WIN32(ERROR_NETNAME_DELETED):
+	case HRESULT_FROM_WIN32(ERROR_UNEXP_NET_ERR):
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+void NetworkLocationPolicy::OnServerUnreachable(const std::wstring &server)
+{
+	std::scoped_lock lock(m_mutex);
+	m_unreachableServers[server] = std::chrono::steady_clock::now();
+}
+
+void NetworkLocationPolicy::OnServerReachable(const std::wstring &server)
+{
+	std::scoped_lock lock(m_mutex);
+	m_unreachableServers.erase(server);
+}
+
+bool NetworkLocationPolicy::IsServerUnreachable(const std::wstring &server) const
+{
+	std::scoped_lock lock(m_mutex);
+
+	auto itr = m_unreachableServers.find(server);
+
+	if (itr == m_unreachableServers.end())
+	{
+		return false;
+	}
+
+	return std::chrono::steady_clock::now() - itr->second < UNREACHABLE_RETRY_INTERVAL;
+}
+
+bool NetworkLocationPolicy::LoadFromFile(const std::wstring &filePath)
+{
+	std::ifstream stream(filePath, std::ios::binary);
+
+	if (!stream)
+	{
+		return false;
+	}
+
+	uint32_t signature;
+	uint32_t version;
+	uint32_t numEntries;
+
+	if (!ReadValue(stream, signature) || signature != FILE_SIGNATURE
+		|| !ReadValue(stream, version) || version != FILE_VERSION
+		|| !ReadValue(stream, numEntries) || numEntries > MAX_ENTRIES)
+	{
+		return false;
+	}
+
+	std::unordered_map<std::wstring, NetworkLocationMode> modes;
+
+	for (uint32_t i = 0; i < numEntries; i++)
+	{
+		std::wstring server;
+		NetworkLocationMode mode;
+
+		if (!ReadString(stream, server) || !ReadValue(stream, mode)
+			|| (mode != NetworkLocationMode::Full && mode != NetworkLocationMode::Reduced))
+		{
+			return false;
+		}
+
+		modes.insert({ std::move(server), mode });
+	}
+
+	std::scoped_lock lock(m_mutex);
+	m_modes = std::move(modes);
+
+	return true;
+}
+
+bool NetworkLocationPolicy::SaveToFile(const std::wstring &filePath) const
+{
+	std::ofstream stream(filePath, std::ios::binary | std::ios::trunc);
+
+	if (!stream)
+	{
+		return false;
+	}
+
+	std::scoped_lock lock(m_mutex);
+
+	WriteValue(stream, FILE_SIGNATURE);
+	WriteValue(stream, FILE_VERSION);
+	WriteValue(stream, static_cast<uint32_t>(m_modes.size()));
+
+	for (const auto &[server, mode] : m_modes)
+	{
+		WriteString(stream, server);
+		WriteValue(stream, mode);
+	}
+
+	return stream.good();
+}
\ No newline at end of file
@@ -0,0 +1,82 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+// Determines how much background work is performed for items on a remote server. Most background
+// tasks (thumbnails, columns, etc.) need at least one round trip to the server for each item, which
+// can make browsing a high-latency location slow, both for the user and for anyone else using the
+// server.
+enum class NetworkLocationMode
+{
+	// The reduced policy is used if the server is observed to be slow.
+	Automatic = 0,
+
+	Full = 1,
+	Reduced = 2
+};
+
+// Tracks the mode the user has chosen for each remote server, along with the servers that have
+// recently failed to respond. Servers are identified by the name returned by GetServerName().
+class NetworkLocationPolicy
+{
+public:
+	// A server is considered slow if its tasks take longer than this, on average.
+	static constexpr std::chrono::milliseconds HIGH_LATENCY_THRESHOLD{ 100 };
+
+	// Once a server has failed to respond, it's treated as unreachable for this long. Navigations
+	// to it during that time fail straight away, rather than waiting for the network timeout again.
+	static constexpr std::chrono::seconds UNREACHABLE_RETRY_INTERVAL{ 30 };
+
+	static NetworkLocationPolicy &GetInstance();
+
+	// Returns the name of the server that the path is on (including for paths on a mapped drive),
+	// or an empty string if the path is local.
+	static std::wstring GetServerName(const std::wstring &path);
+
+	// Returns the (upper case) server name from a UNC path, e.g. "\\server\share\folder" or
+	// "\\?\UNC\server\share\folder", or an empty string if the path isn't a UNC path.
+	static std::wstring GetServerNameFromUncPath(const std::wstring &path);
+
+	NetworkLocationMode GetMode(const std::wstring &server) const;
+	void SetMode(const std::wstring &server, NetworkLocationMode mode);
+
+	// Returns whether background work should be reduced for the server, given its current average
+	// latency (if known).
+	bool IsReduced(
+		const std::wstring &server, std::optional<std::chrono::microseconds> latency) const;
+
+	// Returns whether the error indicates that the server itself couldn't be contacted, as opposed
+	// to (for example) the share not existing or access being denied.
+	static bool IsServerUnreachableError(HRESULT hr);
+
+	void OnServerUnreachable(const std::wstring &server);
+	void OnServerReachable(const std::wstring &server);
+	bool IsServerUnreachable(const std::wstring &server) const;
+
+	bool LoadFromFile(const std::wstring &filePath);
+	bool SaveToFile(const std::wstring &filePath) const;
+
+private:
+	static constexpr uint32_t FILE_SIGNATURE = 0x4C4E4645; // "EFNL"
+	static constexpr uint32_t FILE_VERSION = 1;
+	static constexpr uint32_t MAX_ENTRIES = 10000;
+
+	NetworkLocationPolicy() = default;
+
+	mutable std::mutex m_mutex;
+
+	// Only servers that have been explicitly set to something other than automatic are stored.
+	std::unordered_map<std::wstring, NetworkLocationMode> m_modes;
+
+	// The time at which each server was last found to be unreachable. This isn't saved.
+	std::unordered_map<std::wstring, std::chrono::steady_clock::time_point> m_unreachableServers;
+};
\ No newline at end of file
@@ -0,0 +1,126 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "NewMenuPrewarmer.h"
+#include "ShellHelper.h"
+#include "ThreadQos.h"
+#include <wil/com.h>
+#include <wil/resource.h>
+
+NewMenuPrewarmer::NewMenuPrewarmer() :
+	m_threadPool(1, std::bind(CoInitializeEx, nullptr, COINIT_APARTMENTTHREADED), CoUninitialize)
+{
+}
+
+NewMenuPrewarmer::~NewMenuPrewarmer()
+{
+	m_registryWatcher.reset();
+	m_threadPool.clear_queue();
+}
+
+void NewMenuPrewarmer::Start()
+{
+	if (m_registryWatcher)
+	{
+		return;
+	}
+
+	m_registryWatcher = wil::make_registry_watcher_nothrow(HKEY_CLASSES_ROOT, L"", true,
+		[this](wil::RegistryChangeKind changeKind) {
+			UNREFERENCED_PARAMETER(changeKind);
+
+			QueueBuildMenu();
+		});
+
+	QueueBuildMenu();
+}
+
+void NewMenuPrewarmer::QueueBuildMenu()
+{
+	m_threadPool.clear_queue();
+
+	m_threadPool.push([](int id) {
+		UNREFERENCED_PARAMETER(id);
+
+		SetCurrentThreadTaskClass(TaskClass::Background);
+
+		BuildMenu();
+	});
+}
+
+// As with ContextMenuPrewarmer, the menu that's built here is discarded. Only the side effect (of
+// the handler caching the items it finds) is of interest.
+void NewMenuPrewarmer::BuildMenu()
+{
+	wil::com_ptr_nothrow<IContextMenu> contextMenu;
+	HRESULT hr = CoCreateInstance(
+		CLSID_NewMenu, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&contextMenu));
+
+	if (FAILED(hr))
+	{
+		return;
+	}
+
+	wil::com_ptr_nothrow<IShellExtInit> shellExtInit;
+	hr = contextMenu->QueryInterface(IID_PPV_ARGS(&shellExtInit));
+
+	if (FAILED(hr))
+	{
+		return;
+	}
+
+	// The same set of items is shown for any file system folder.
+	unique_pidl_absolute pidlDesktop;
+	hr = SHGetKnownFolderIDList(
+		FOLDERID_Desktop, KF_FLAG_DEFAULT, nullptr, wil::out_param(pidlDesktop));
+
+	if (FAILED(hr))
+	{
+		return;
+	}
+
+	hr = shellExtInit->Initialize(pidlDesktop.get(), nullptr, nullptr);
+
+	if (FAILED(hr))
+	{
+		return;
+	}
+
+	wil::unique_hmenu menu(CreatePopupMenu());
+
+	if (!menu)
+	{
+		return;
+	}
+
+	hr = contextMenu->QueryContextMenu(menu.get(), 0, 1, 0x7FFF, CMF_NORMAL);
+
+	if (FAILED(hr))
+	{
+		return;
+	}
+
+	// The items are only enumerated once the submenu is about to be shown.
+	wil::com_ptr_nothrow<IContextMenu2> contextMenu2;
+	hr = contextMenu->QueryInterface(IID_PPV_ARGS(&contextMenu2));
+
+	if (FAILED(hr))
+	{
+		return;
+	}
+
+	int numItems = GetMenuItemCount(menu.get());
+
+	for (int i = 0; i < numItems; i++)
+	{
+		HMENU subMenu = GetSubMenu(menu.get(), i);
+
+		if (subMenu)
+		{
+			contextMenu2->HandleMenuMsg(
+				WM_INITMENUPOPUP, reinterpret_cast<WPARAM>(subMenu), MAKELPARAM(i, FALSE));
+		}
+	}
+}
\ No newline at end of file
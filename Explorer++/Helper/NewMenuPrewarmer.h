@@ -0,0 +1,37 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "../ThirdParty/CTPL/cpl_stl.h"
+#include <wil/registry.h>
+
+// The "New" submenu in the background context menu is built by the shell's ShellNew handler. The
+// first time that handler is used in a process, it enumerates the ShellNew registrations of every
+// file type (and loads an icon for each one), which can take a noticeable amount of time on systems
+// with many registrations. After that, the menu is built from the items the handler has cached.
+//
+// This builds the menu in the background shortly after startup, so that the handler's cache is
+// already populated by the time the user first opens the menu. The registrations live under
+// HKEY_CLASSES_ROOT, which is watched (via RegNotifyChangeKeyValue), so that when they change, the
+// menu is rebuilt in the background, rather than the next time it's opened.
+class NewMenuPrewarmer
+{
+public:
+	NewMenuPrewarmer();
+	~NewMenuPrewarmer();
+
+	// Subsequent calls have no effect.
+	void Start();
+
+private:
+	void QueueBuildMenu();
+	static void BuildMenu();
+
+	// Registry changes tend to arrive in bursts (e.g. while an application is being installed), so
+	// any rebuild that hasn't started yet is dropped when another one is queued.
+	ctpl::thread_pool m_threadPool;
+
+	wil::unique_registry_watcher_nothrow m_registryWatcher;
+};
\ No newline at end of file
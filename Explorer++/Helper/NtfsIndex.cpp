@@ -0,0 +1,509 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "NtfsIndex.h"
+#include "Macros.h"
+#include <optional>
+
+namespace
+{
+
+const DWORD BUFFER_SIZE = 1024 * 1024;
+
+// Guards against walking an inconsistent parent chain forever.
+const size_t MAX_PATH_DEPTH = 1024;
+
+// Stop requests are only checked after this many entries have been examined.
+const size_t STOP_CHECK_INTERVAL = 4096;
+
+// The output of both FSCTL_ENUM_USN_DATA and FSCTL_READ_USN_JOURNAL consists of a USN (or file
+// reference number), followed by a set of records.
+template <typename Callback>
+void ForEachRecord(const std::vector<BYTE> &buffer, DWORD size, Callback callback)
+{
+	DWORD offset = sizeof(USN);
+
+	while (offset + sizeof(USN_RECORD_COMMON_HEADER) <= size)
+	{
+		auto *header = reinterpret_cast<const USN_RECORD_COMMON_HEADER *>(buffer.data() + offset);
+
+		if (header->RecordLength == 0 || offset + header->RecordLength > size)
+		{
+			break;
+		}
+
+		// NTFS only produces version 2 records, unless range tracking has been enabled.
+		if (header->MajorVersion == 2)
+		{
+			callback(reinterpret_cast<const USN_RECORD_V2 *>(header));
+		}
+
+		offset += header->RecordLength;
+	}
+}
+
+std::optional<ULONGLONG> GetFileReference(const std::wstring &path)
+{
+	wil::unique_hfile file(CreateFile(path.c_str(), FILE_READ_ATTRIBUTES,
+		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+		FILE_FLAG_BACKUP_SEMANTICS, nullptr));
+
+	if (!file)
+	{
+		return std::nullopt;
+	}
+
+	BY_HANDLE_FILE_INFORMATION fileInformation;
+	BOOL res = GetFileInformationByHandle(file.get(), &fileInformation);
+
+	if (!res)
+	{
+		return std::nullopt;
+	}
+
+	ULARGE_INTEGER reference;
+	reference.LowPart = fileInformation.nFileIndexLow;
+	reference.HighPart = fileInformation.nFileIndexHigh;
+	return reference.QuadPart;
+}
+
+}
+
+std::unique_ptr<NtfsIndex> NtfsIndex::Create(
+	const std::wstring &volumeName, const std::wstring &volumeRoot)
+{
+	TCHAR fileSystemName[MAX_PATH + 1];
+	BOOL res = GetVolumeInformation(volumeRoot.c_str(), nullptr, 0, nullptr, nullptr, nullptr,
+		fileSystemName, SIZEOF_ARRAY(fileSystemName));
+
+	if (!res || lstrcmpi(fileSystemName, _T("NTFS")) != 0)
+	{
+		return nullptr;
+	}
+
+	// The volume itself is opened by removing the trailing backslash from the volume name.
+	std::wstring volumePath = volumeName;
+
+	if (!volumePath.empty() && volumePath.back() == '\\')
+	{
+		volumePath.pop_back();
+	}
+
+	wil::unique_hfile volume(CreateFile(volumePath.c_str(), GENERIC_READ,
+		FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, 0, nullptr));
+
+	if (!volume)
+	{
+		return nullptr;
+	}
+
+	auto index = std::unique_ptr<NtfsIndex>(new NtfsIndex(std::move(volume), volumeRoot));
+
+	if (!index->Build())
+	{
+		return nullptr;
+	}
+
+	return index;
+}
+
+NtfsIndex::NtfsIndex(wil::unique_hfile volume, const std::wstring &volumeRoot) :
+	m_volume(std::move(volume)),
+	m_volumeRoot(volumeRoot)
+{
+}
+
+bool NtfsIndex::Build()
+{
+	USN_JOURNAL_DATA_V0 journalData;
+	DWORD bytesReturned;
+	BOOL res = DeviceIoControl(m_volume.get(), FSCTL_QUERY_USN_JOURNAL, nullptr, 0, &journalData,
+		sizeof(journalData), &bytesReturned, nullptr);
+
+	if (!res)
+	{
+		return false;
+	}
+
+	m_entries.clear();
+	m_names.clear();
+	m_numUnusedNameChars = 0;
+
+	MFT_ENUM_DATA_V0 enumData;
+	enumData.StartFileReferenceNumber = 0;
+	enumData.LowUsn = 0;
+	enumData.HighUsn = journalData.NextUsn;
+
+	std::vector<BYTE> buffer(BUFFER_SIZE);
+
+	while (true)
+	{
+		res = DeviceIoControl(m_volume.get(), FSCTL_ENUM_USN_DATA, &enumData, sizeof(enumData),
+			buffer.data(), static_cast<DWORD>(buffer.size()), &bytesReturned, nullptr);
+
+		if (!res)
+		{
+			if (GetLastError() == ERROR_HANDLE_EOF)
+			{
+				break;
+			}
+
+			return false;
+		}
+
+		if (bytesReturned <= sizeof(USN))
+		{
+			break;
+		}
+
+		ForEachRecord(buffer, bytesReturned,
+			[this](const USN_RECORD_V2 *record) { ProcessRecord(record, false); });
+
+		enumData.StartFileReferenceNumber = *reinterpret_cast<const DWORDLONG *>(buffer.data());
+	}
+
+	m_journalId = journalData.UsnJournalID;
+	m_nextUsn = journalData.NextUsn;
+
+	// Any changes made while the MFT was being enumerated will be applied here.
+	return ReadJournal();
+}
+
+bool NtfsIndex::Update()
+{
+	return ReadJournal();
+}
+
+bool NtfsIndex::ReadJournal()
+{
+	READ_USN_JOURNAL_DATA_V0 readData = {};
+	readData.StartUsn = m_nextUsn;
+	readData.ReasonMask = 0xFFFFFFFF;
+	readData.ReturnOnlyOnClose = FALSE;
+	readData.UsnJournalID = m_journalId;
+
+	std::vector<BYTE> buffer(BUFFER_SIZE);
+
+	while (true)
+	{
+		DWORD bytesReturned;
+		BOOL res = DeviceIoControl(m_volume.get(), FSCTL_READ_USN_JOURNAL, &readData,
+			sizeof(readData), buffer.data(), static_cast<DWORD>(buffer.size()), &bytesReturned,
+			nullptr);
+
+		// This will fail if the journal has been deleted or recreated, or if the records that
+		// haven't been read yet have been discarded.
+		if (!res || bytesReturned < sizeof(USN))
+		{
+			return false;
+		}
+
+		USN nextUsn = *reinterpret_cast<const USN *>(buffer.data());
+
+		ForEachRecord(buffer, bytesReturned,
+			[this](const USN_RECORD_V2 *record) { ProcessRecord(record, true); });
+
+		if (bytesReturned == sizeof(USN) || nextUsn == readData.StartUsn)
+		{
+			m_nextUsn = nextUsn;
+			break;
+		}
+
+		readData.StartUsn = nextUsn;
+	}
+
+	if (m_numUnusedNameChars > m_names.size() / 2)
+	{
+		CompactNames();
+	}
+
+	return true;
+}
+
+void NtfsIndex::ProcessRecord(const USN_RECORD_V2 *record, bool journalRecord)
+{
+	if (journalRecord)
+	{
+		if (WI_IsFlagSet(record->Reason, USN_REASON_FILE_DELETE))
+		{
+			RemoveEntry(record->FileReferenceNumber);
+			return;
+		}
+
+		// A rename generates a record containing the old name, followed by a record containing
+		// the new name. Only the second record is of interest.
+		if (WI_IsFlagSet(record->Reason, USN_REASON_RENAME_OLD_NAME))
+		{
+			return;
+		}
+	}
+
+	auto *name = reinterpret_cast<const wchar_t *>(
+		reinterpret_cast<const BYTE *>(record) + record->FileNameOffset);
+
+	SetEntry(record->FileReferenceNumber, record->ParentFileReferenceNumber,
+		record->FileAttributes, name, record->FileNameLength / sizeof(wchar_t));
+}
+
+void NtfsIndex::SetEntry(ULONGLONG reference, ULONGLONG parentReference, DWORD attributes,
+	const wchar_t *name, size_t nameLength)
+{
+	// The root folder is its own parent. There's no need to store it, since paths are built
+	// relative to the volume root.
+	if (reference == parentReference)
+	{
+		return;
+	}
+
+	auto itr = m_entries.find(reference);
+
+	if (itr != m_entries.end())
+	{
+		const wchar_t *existingName = &m_names[itr->second.nameOffset];
+
+		itr->second.parentReference = parentReference;
+		itr->second.attributes = attributes;
+
+		// Most changes recorded in the journal don't affect the name of the item.
+		if (wcsncmp(existingName, name, nameLength) == 0 && existingName[nameLength] == '\0')
+		{
+			return;
+		}
+
+		m_numUnusedNameChars += wcslen(existingName) + 1;
+	}
+
+	auto nameOffset = static_cast<uint32_t>(m_names.size());
+	m_names.insert(m_names.end(), name, name + nameLength);
+	m_names.push_back('\0');
+
+	m_entries.insert_or_assign(reference, Entry{ parentReference, attributes, nameOffset });
+}
+
+void NtfsIndex::RemoveEntry(ULONGLONG reference)
+{
+	auto itr = m_entries.find(reference);
+
+	if (itr == m_entries.end())
+	{
+		return;
+	}
+
+	m_numUnusedNameChars += wcslen(&m_names[itr->second.nameOffset]) + 1;
+	m_entries.erase(itr);
+}
+
+void NtfsIndex::CompactNames()
+{
+	std::vector<wchar_t> names;
+	names.reserve(m_names.size() - m_numUnusedNameChars);
+
+	for (auto &[reference, entry] : m_entries)
+	{
+		const wchar_t *name = &m_names[entry.nameOffset];
+
+		entry.nameOffset = static_cast<uint32_t>(names.size());
+		names.insert(names.end(), name, name + wcslen(name) + 1);
+	}
+
+	m_names = std::move(names);
+	m_numUnusedNameChars = 0;
+}
+
+void NtfsIndex::Find(ULONGLONG folderReference, bool recursive,
+	const MatchCallback &matchCallback, std::stop_token stopToken,
+	const ResultCallback &resultCallback) const
+{
+	// Most matching items share their ancestors with other matching items, so the result of each
+	// ancestor check is remembered.
+	std::unordered_map<ULONGLONG, bool> cachedResults;
+	size_t numChecked = 0;
+
+	for (const auto &[reference, entry] : m_entries)
+	{
+		if (++numChecked % STOP_CHECK_INTERVAL == 0 && stopToken.stop_requested())
+		{
+			return;
+		}
+
+		if (!matchCallback(&m_names[entry.nameOffset], entry.attributes))
+		{
+			continue;
+		}
+
+		bool withinFolder;
+
+		if (recursive)
+		{
+			withinFolder = IsWithinFolder(entry.parentReference, folderReference, cachedResults);
+		}
+		else
+		{
+			withinFolder = (entry.parentReference == folderReference);
+		}
+
+		if (withinFolder)
+		{
+			resultCallback(BuildPath(reference), entry.attributes);
+		}
+	}
+}
+
+bool NtfsIndex::IsWithinFolder(ULONGLONG reference, ULONGLONG folderReference,
+	std::unordered_map<ULONGLONG, bool> &cachedResults) const
+{
+	std::vector<ULONGLONG> visited;
+	ULONGLONG currentReference = reference;
+	bool result;
+
+	while (true)
+	{
+		if (currentReference == folderReference)
+		{
+			result = true;
+			break;
+		}
+
+		auto cachedItr = cachedResults.find(currentReference);
+
+		if (cachedItr != cachedResults.end())
+		{
+			result = cachedItr->second;
+			break;
+		}
+
+		auto itr = m_entries.find(currentReference);
+
+		if (itr == m_entries.end() || visited.size() >= MAX_PATH_DEPTH)
+		{
+			result = false;
+			break;
+		}
+
+		visited.push_back(currentReference);
+		currentReference = itr->second.parentReference;
+	}
+
+	for (auto visitedReference : visited)
+	{
+		cachedResults[visitedReference] = result;
+	}
+
+	return result;
+}
+
+std::wstring NtfsIndex::BuildPath(ULONGLONG reference) const
+{
+	std::vector<const wchar_t *> names;
+	ULONGLONG currentReference = reference;
+
+	while (names.size() < MAX_PATH_DEPTH)
+	{
+		auto itr = m_entries.find(currentReference);
+
+		if (itr == m_entries.end())
+		{
+			break;
+		}
+
+		names.push_back(&m_names[itr->second.nameOffset]);
+		currentReference = itr->second.parentReference;
+	}
+
+	std::wstring path = m_volumeRoot;
+
+	for (auto itr = names.rbegin(); itr != names.rend(); ++itr)
+	{
+		if (!path.empty() && path.back() != '\\')
+		{
+			path += '\\';
+		}
+
+		path += *itr;
+	}
+
+	return path;
+}
+
+NtfsIndexManager &NtfsIndexManager::GetInstance()
+{
+	static NtfsIndexManager ntfsIndexManager;
+	return ntfsIndexManager;
+}
+
+bool NtfsIndexManager::Search(const std::wstring &folder, bool recursive,
+	const NtfsIndex::MatchCallback &matchCallback, std::stop_token stopToken,
+	const NtfsIndex::ResultCallback &resultCallback)
+{
+	TCHAR volumeRoot[MAX_PATH];
+	BOOL res = GetVolumePathName(folder.c_str(), volumeRoot, SIZEOF_ARRAY(volumeRoot));
+
+	if (!res)
+	{
+		return false;
+	}
+
+	UINT driveType = GetDriveType(volumeRoot);
+
+	if (driveType != DRIVE_FIXED && driveType != DRIVE_REMOVABLE)
+	{
+		return false;
+	}
+
+	TCHAR volumeName[MAX_PATH];
+	res = GetVolumeNameForVolumeMountPoint(volumeRoot, volumeName, SIZEOF_ARRAY(volumeName));
+
+	if (!res)
+	{
+		return false;
+	}
+
+	auto folderReference = GetFileReference(folder);
+
+	if (!folderReference)
+	{
+		return false;
+	}
+
+	std::scoped_lock lock(m_mutex);
+
+	NtfsIndex *index = GetIndex(volumeName, volumeRoot);
+
+	if (!index)
+	{
+		return false;
+	}
+
+	index->Find(*folderReference, recursive, matchCallback, stopToken, resultCallback);
+
+	return true;
+}
+
+NtfsIndex *NtfsIndexManager::GetIndex(
+	const std::wstring &volumeName, const std::wstring &volumeRoot)
+{
+	auto itr = m_indexes.find(volumeName);
+
+	if (itr != m_indexes.end())
+	{
+		if (itr->second->Update())
+		{
+			return itr->second.get();
+		}
+
+		// The journal couldn't be read, so the index has to be built again from scratch.
+		m_indexes.erase(itr);
+	}
+
+	auto index = NtfsIndex::Create(volumeName, volumeRoot);
+
+	if (!index)
+	{
+		return nullptr;
+	}
+
+	auto [insertedItr, inserted] = m_indexes.emplace(volumeName, std::move(index));
+	return insertedItr->second.get();
+}
\ No newline at end of file
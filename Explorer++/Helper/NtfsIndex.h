@@ -0,0 +1,101 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <wil/resource.h>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// An in-memory index of the name of every file and folder on a single NTFS volume. The index is
+// built by enumerating the volume's MFT (via FSCTL_ENUM_USN_DATA) and is subsequently kept up to
+// date by reading the changes that have been recorded in the volume's USN journal.
+//
+// Only the name, attributes and parent of each item are stored, which is enough to both match an
+// item and build its full path.
+class NtfsIndex
+{
+public:
+	using MatchCallback = std::function<bool(const wchar_t *name, DWORD attributes)>;
+	using ResultCallback = std::function<void(std::wstring path, DWORD attributes)>;
+
+	// Opening the volume requires administrative privileges. Returns nullptr if the volume can't
+	// be opened, isn't an NTFS volume, or has no active USN journal.
+	static std::unique_ptr<NtfsIndex> Create(
+		const std::wstring &volumeName, const std::wstring &volumeRoot);
+
+	// Applies any changes recorded in the journal since the index was built or last updated.
+	// Returns false if those changes are no longer available (e.g. because the journal has been
+	// deleted or has wrapped around), in which case the index needs to be rebuilt.
+	bool Update();
+
+	// Finds the items that are located within the specified folder (either directly, or in any
+	// subfolder, when recursive is true) and that satisfy the match callback.
+	void Find(ULONGLONG folderReference, bool recursive, const MatchCallback &matchCallback,
+		std::stop_token stopToken, const ResultCallback &resultCallback) const;
+
+private:
+	struct Entry
+	{
+		ULONGLONG parentReference;
+		DWORD attributes;
+
+		// The offset of the (null-terminated) name within m_names.
+		uint32_t nameOffset;
+	};
+
+	NtfsIndex(wil::unique_hfile volume, const std::wstring &volumeRoot);
+
+	bool Build();
+	bool ReadJournal();
+	void ProcessRecord(const USN_RECORD_V2 *record, bool journalRecord);
+	void SetEntry(ULONGLONG reference, ULONGLONG parentReference, DWORD attributes,
+		const wchar_t *name, size_t nameLength);
+	void RemoveEntry(ULONGLONG reference);
+	void CompactNames();
+
+	bool IsWithinFolder(ULONGLONG reference, ULONGLONG folderReference,
+		std::unordered_map<ULONGLONG, bool> &cachedResults) const;
+	std::wstring BuildPath(ULONGLONG reference) const;
+
+	const wil::unique_hfile m_volume;
+	const std::wstring m_volumeRoot;
+
+	DWORDLONG m_journalId = 0;
+	USN m_nextUsn = 0;
+
+	std::unordered_map<ULONGLONG, Entry> m_entries;
+	std::vector<wchar_t> m_names;
+
+	// The number of characters in m_names that belong to names that have since been replaced or
+	// removed.
+	size_t m_numUnusedNameChars = 0;
+};
+
+// Maintains an index for each local NTFS volume that has been searched.
+class NtfsIndexManager
+{
+public:
+	static NtfsIndexManager &GetInstance();
+
+	// Searches the specified folder using the index for the volume it's on. The index is built
+	// the first time a volume is searched, which can take some time. Returns false if the folder
+	// can't be searched this way, in which case it will need to be searched directly instead.
+	bool Search(const std::wstring &folder, bool recursive,
+		const NtfsIndex::MatchCallback &matchCallback, std::stop_token stopToken,
+		const NtfsIndex::ResultCallback &resultCallback);
+
+private:
+	NtfsIndexManager() = default;
+
+	NtfsIndex *GetIndex(const std::wstring &volumeName, const std::wstring &volumeRoot);
+
+	std::mutex m_mutex;
+	std::unordered_map<std::wstring, std::unique_ptr<NtfsIndex>> m_indexes;
+};
\ No newline at end of file
@@ -0,0 +1,57 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "PackedChildPidls.h"
+
+PackedChildPidls::PackedChildPidls(const std::vector<PCITEMID_CHILD> &pidls)
+{
+	size_t totalSize = 0;
+
+	for (auto pidl : pidls)
+	{
+		totalSize += ILGetSize(pidl);
+	}
+
+	m_data.resize(totalSize);
+
+	BYTE *current = m_data.data();
+
+	for (auto pidl : pidls)
+	{
+		// ILGetSize() includes the terminator, so the copy below includes it as well.
+		UINT size = ILGetSize(pidl);
+		memcpy(current, pidl, size);
+		current += size;
+	}
+
+	m_count = pidls.size();
+}
+
+std::vector<PCITEMID_CHILD> PackedChildPidls::GetPidls() const
+{
+	std::vector<PCITEMID_CHILD> pidls;
+	pidls.reserve(m_count);
+
+	const BYTE *current = m_data.data();
+
+	for (size_t i = 0; i < m_count; i++)
+	{
+		auto pidl = reinterpret_cast<PCITEMID_CHILD>(current);
+		pidls.push_back(pidl);
+		current += ILGetSize(pidl);
+	}
+
+	return pidls;
+}
+
+size_t PackedChildPidls::GetCount() const
+{
+	return m_count;
+}
+
+bool PackedChildPidls::IsEmpty() const
+{
+	return m_count == 0;
+}
\ No newline at end of file
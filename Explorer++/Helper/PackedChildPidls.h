@@ -0,0 +1,30 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "ShellHelper.h"
+#include <vector>
+
+// Stores a list of child PIDLs back-to-back in a single buffer. Compared to storing each PIDL in
+// its own allocation, this uses considerably less memory when there are a large number of PIDLs
+// (e.g. the selection in a large folder) and copying the list only requires a single allocation.
+class PackedChildPidls
+{
+public:
+	PackedChildPidls() = default;
+	explicit PackedChildPidls(const std::vector<PCITEMID_CHILD> &pidls);
+
+	// The returned PIDLs point into this object and are only valid for as long as it is.
+	std::vector<PCITEMID_CHILD> GetPidls() const;
+
+	size_t GetCount() const;
+	bool IsEmpty() const;
+
+private:
+	// Each PIDL is stored as a single item ID, followed by a terminating (zero-sized) item ID, so
+	// that each one can be used directly, without having to be copied.
+	std::vector<BYTE> m_data;
+	size_t m_count = 0;
+};
\ No newline at end of file
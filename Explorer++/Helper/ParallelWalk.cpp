@@ -0,0 +1,22 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ParallelWalk.h"
+#include <algorithm>
+#include <thread>
+
+namespace
+{
+
+const int MAX_WORKER_THREADS = 8;
+
+}
+
+ctpl::thread_pool &GetParallelWalkThreadPool()
+{
+	static ctpl::thread_pool threadPool(std::clamp(
+		static_cast<int>(std::thread::hardware_concurrency()), 2, MAX_WORKER_THREADS));
+	return threadPool;
+}
\ No newline at end of file
@@ -0,0 +1,315 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "ThreadQos.h"
+#include "../ThirdParty/CTPL/cpl_stl.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <vector>
+
+// The worker threads that help with each walk. These are shared between all walks, so that the
+// number of threads remains bounded, no matter how many walks are running at once.
+ctpl::thread_pool &GetParallelWalkThreadPool();
+
+// Processes a tree of items (typically folders) in parallel. The walk is run on the calling
+// thread, with help from the shared worker threads.
+//
+// Each participating thread owns a queue. Items found while processing an item are added to the
+// back of the thread's own queue and taken from there again, so that each thread works through
+// the tree depth-first (which keeps the queues short). A thread that runs out of work takes items
+// from the front of another thread's queue instead; those items are the closest to the root and are
+// therefore likely to represent the largest amount of remaining work.
+//
+// The helper threads run with the same TaskClass as the calling thread, so a walk that's part of a
+// background job doesn't compete with interactive work on any of its threads.
+template <typename Item>
+class ParallelWalk : public std::enable_shared_from_this<ParallelWalk<Item>>
+{
+public:
+	class Worker
+	{
+	public:
+		// Queues an item found while processing the current item.
+		void AddItem(Item item)
+		{
+			m_walk->AddItem(m_queueIndex, std::move(item));
+		}
+
+	private:
+		friend ParallelWalk;
+
+		Worker(ParallelWalk *walk, int queueIndex) : m_walk(walk), m_queueIndex(queueIndex)
+		{
+		}
+
+		ParallelWalk *m_walk;
+		int m_queueIndex;
+	};
+
+	using ProcessCallback = std::function<void(const Item &item, Worker &worker)>;
+	using PeriodicCallback = std::function<void()>;
+
+	static constexpr std::chrono::milliseconds DEFAULT_PERIODIC_INTERVAL{ 200 };
+
+	// Processes the root item, along with every item subsequently added. This returns once all
+	// items have been processed, or once a stop has been requested and no item is still being
+	// processed. The process callback is invoked concurrently from several threads and is never
+	// invoked after this method returns. The periodic callback (if any) is only invoked on the
+	// calling thread.
+	//
+	// If maxThreads is non-zero, at most that many threads (including the calling thread) will
+	// process items at once. That's useful when processing an item involves reading from a device
+	// that performs poorly with concurrent reads (see GetStorageInfo).
+	static void Run(Item root, ProcessCallback processCallback, std::stop_token stopToken = {},
+		PeriodicCallback periodicCallback = nullptr,
+		std::chrono::milliseconds periodicInterval = DEFAULT_PERIODIC_INTERVAL, int maxThreads = 0)
+	{
+		std::vector<Item> roots;
+		roots.push_back(std::move(root));
+		Run(std::move(roots), std::move(processCallback), stopToken, std::move(periodicCallback),
+			periodicInterval, maxThreads);
+	}
+
+	// As above, but starts with several independent items (e.g. a list of files to process). If
+	// the list is empty, this returns immediately.
+	static void Run(std::vector<Item> roots, ProcessCallback processCallback,
+		std::stop_token stopToken = {}, PeriodicCallback periodicCallback = nullptr,
+		std::chrono::milliseconds periodicInterval = DEFAULT_PERIODIC_INTERVAL, int maxThreads = 0)
+	{
+		if (roots.empty())
+		{
+			return;
+		}
+
+		int maxHelpers = GetParallelWalkThreadPool().size();
+
+		if (maxThreads > 0)
+		{
+			maxHelpers = (std::min)(maxHelpers, maxThreads - 1);
+		}
+
+		auto walk = std::shared_ptr<ParallelWalk>(
+			new ParallelWalk(maxHelpers, std::move(processCallback), stopToken));
+
+		for (auto &root : roots)
+		{
+			walk->AddItem(0, std::move(root));
+		}
+
+		// The calling thread uses the first queue.
+		walk->Work(0, periodicCallback, periodicInterval);
+	}
+
+private:
+	struct ItemQueue
+	{
+		std::mutex mutex;
+		std::deque<Item> items;
+	};
+
+	ParallelWalk(int maxHelpers, ProcessCallback processCallback, std::stop_token stopToken) :
+		m_maxHelpers(maxHelpers),
+		m_processCallback(std::move(processCallback)),
+		m_stopToken(stopToken),
+		m_taskClass(GetCurrentThreadTaskClass()),
+		m_stopCallback(m_stopToken, [this]() { NotifyStateChanged(true); })
+	{
+		for (int i = 0; i < maxHelpers + 1; i++)
+		{
+			m_queues.push_back(std::make_unique<ItemQueue>());
+		}
+	}
+
+	void AddItem(int queueIndex, Item item)
+	{
+		m_numPendingItems++;
+
+		{
+			std::scoped_lock lock(m_queues[queueIndex]->mutex);
+			m_queues[queueIndex]->items.push_back(std::move(item));
+		}
+
+		// A helper is only requested once there's work that another thread can take.
+		if (++m_numQueuedItems > 1)
+		{
+			RequestHelper();
+		}
+
+		NotifyStateChanged(false);
+	}
+
+	void Work(int queueIndex, const PeriodicCallback &periodicCallback,
+		std::chrono::milliseconds periodicInterval)
+	{
+		Worker worker(this, queueIndex);
+		auto lastPeriodicCallbackTime = std::chrono::steady_clock::now();
+
+		while (true)
+		{
+			if (periodicCallback
+				&& std::chrono::steady_clock::now() - lastPeriodicCallbackTime >= periodicInterval)
+			{
+				periodicCallback();
+				lastPeriodicCallbackTime = std::chrono::steady_clock::now();
+			}
+
+			auto item = TakeItem(queueIndex);
+
+			if (item)
+			{
+				m_processCallback(*item, worker);
+
+				bool noActiveItems = (--m_numActiveItems == 0);
+				bool noPendingItems = (--m_numPendingItems == 0);
+
+				if (noActiveItems || noPendingItems)
+				{
+					NotifyStateChanged(true);
+				}
+
+				continue;
+			}
+
+			std::unique_lock lock(m_mutex);
+
+			// The timeout allows the periodic callback to continue to be invoked while other
+			// threads are processing the remaining items.
+			m_stateChangedCondition.wait_for(lock, periodicInterval,
+				[this]() { return m_numQueuedItems > 0 || IsFinished(); });
+
+			if (IsFinished())
+			{
+				break;
+			}
+		}
+	}
+
+	void RequestHelper()
+	{
+		int helperIndex = m_numHelpers.fetch_add(1);
+
+		if (helperIndex >= m_maxHelpers)
+		{
+			m_numHelpers--;
+			return;
+		}
+
+		// The helper may not start until after the walk has finished (if all of the worker threads
+		// are busy with other walks), in which case it will simply exit.
+		GetParallelWalkThreadPool().push([walk = this->shared_from_this(), helperIndex](int) {
+			SetCurrentThreadTaskClass(walk->m_taskClass);
+			walk->Work(helperIndex + 1, nullptr, DEFAULT_PERIODIC_INTERVAL);
+		});
+	}
+
+	std::optional<Item> TakeItem(int queueIndex)
+	{
+		// This is incremented before the stop token is checked, so that a thread that's stopping
+		// the walk won't finish while another thread is about to process an item.
+		m_numActiveItems++;
+
+		if (!m_stopToken.stop_requested())
+		{
+			auto item = TakeItemFromQueue(queueIndex, true);
+			int numQueues = static_cast<int>(m_queues.size());
+
+			for (int i = 1; !item && i < numQueues; i++)
+			{
+				item = TakeItemFromQueue((queueIndex + i) % numQueues, false);
+			}
+
+			if (item)
+			{
+				m_numQueuedItems--;
+				return item;
+			}
+		}
+
+		if (--m_numActiveItems == 0)
+		{
+			NotifyStateChanged(true);
+		}
+
+		return std::nullopt;
+	}
+
+	std::optional<Item> TakeItemFromQueue(int queueIndex, bool back)
+	{
+		auto &queue = *m_queues[queueIndex];
+		std::scoped_lock lock(queue.mutex);
+
+		if (queue.items.empty())
+		{
+			return std::nullopt;
+		}
+
+		std::optional<Item> item;
+
+		if (back)
+		{
+			item = std::move(queue.items.back());
+			queue.items.pop_back();
+		}
+		else
+		{
+			item = std::move(queue.items.front());
+			queue.items.pop_front();
+		}
+
+		return item;
+	}
+
+	bool IsFinished() const
+	{
+		return m_numPendingItems == 0 || (m_stopToken.stop_requested() && m_numActiveItems == 0);
+	}
+
+	void NotifyStateChanged(bool notifyAll)
+	{
+		// Acquiring the mutex here ensures that a thread can't miss the notification between
+		// checking its wait condition and starting to wait.
+		{
+			std::scoped_lock lock(m_mutex);
+		}
+
+		if (notifyAll)
+		{
+			m_stateChangedCondition.notify_all();
+		}
+		else
+		{
+			m_stateChangedCondition.notify_one();
+		}
+	}
+
+	const int m_maxHelpers;
+	const ProcessCallback m_processCallback;
+	const std::stop_token m_stopToken;
+	const TaskClass m_taskClass;
+
+	std::vector<std::unique_ptr<ItemQueue>> m_queues;
+	std::atomic<int> m_numHelpers = 0;
+
+	// The number of items that have been added, but not yet fully processed. This includes items
+	// that are currently being processed.
+	std::atomic<int> m_numPendingItems = 0;
+	std::atomic<int> m_numQueuedItems = 0;
+	std::atomic<int> m_numActiveItems = 0;
+
+	std::mutex m_mutex;
+	std::condition_variable m_stateChangedCondition;
+
+	// This is declared last, since the callback may be invoked immediately on construction.
+	std::stop_callback<std::function<void()>> m_stopCallback;
+};
\ No newline at end of file
@@ -0,0 +1,149 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ParsedPathCache.h"
+#include <wil/com.h>
+
+ParsedPathCache::ParsedPathCache(size_t maxEntries, ParseFunction parse) :
+	m_maxEntries(maxEntries),
+	m_parse(parse)
+{
+}
+
+ParsedPathCache &ParsedPathCache::GetInstance()
+{
+	static ParsedPathCache parsedPathCache;
+	return parsedPathCache;
+}
+
+HRESULT ParsedPathCache::ParseDisplayName(const std::wstring &path, PIDLIST_ABSOLUTE *pidl)
+{
+	return SHParseDisplayName(path.c_str(), nullptr, pidl, 0, nullptr);
+}
+
+HRESULT ParsedPathCache::ParsePath(const std::wstring &path, PIDLIST_ABSOLUTE *pidl)
+{
+	std::wstring key = GetKey(path);
+
+	{
+		std::scoped_lock lock(m_mutex);
+
+		auto itr = m_entriesByKey.find(key);
+
+		if (itr != m_entriesByKey.end())
+		{
+			m_entries.splice(m_entries.begin(), m_entries, itr->second);
+
+			*pidl = ILCloneFull(itr->second->pidl.get());
+			return *pidl ? S_OK : E_OUTOFMEMORY;
+		}
+	}
+
+	// Parsing can be slow (e.g. within a network location), so the lock isn't held while the path
+	// is parsed. If the same path is parsed concurrently, the last result is the one retained.
+	unique_pidl_absolute parsedPidl;
+	RETURN_IF_FAILED(m_parse(path, wil::out_param(parsedPidl)));
+
+	AddEntry(std::move(key), parsedPidl.get());
+
+	*pidl = parsedPidl.release();
+
+	return S_OK;
+}
+
+HRESULT ParsedPathCache::ParseChildPath(
+	const std::wstring &parentPath, const WIN32_FIND_DATA &wfd, PIDLIST_ABSOLUTE *pidl)
+{
+	unique_pidl_absolute pidlParent;
+	RETURN_IF_FAILED(ParsePath(parentPath, wil::out_param(pidlParent)));
+
+	wil::com_ptr_nothrow<IShellFolder> parent;
+	RETURN_IF_FAILED(SHBindToObject(nullptr, pidlParent.get(), nullptr, IID_PPV_ARGS(&parent)));
+
+	unique_pidl_child pidlChild;
+	RETURN_IF_FAILED(CreateSimpleChildPidl(parent.get(), wfd, wil::out_param(pidlChild)));
+
+	*pidl = ILCombine(pidlParent.get(), pidlChild.get());
+
+	return *pidl ? S_OK : E_OUTOFMEMORY;
+}
+
+void ParsedPathCache::AddEntry(std::wstring key, PCIDLIST_ABSOLUTE pidl)
+{
+	unique_pidl_absolute pidlCopy(ILCloneFull(pidl));
+
+	if (!pidlCopy)
+	{
+		return;
+	}
+
+	std::scoped_lock lock(m_mutex);
+
+	auto itr = m_entriesByKey.find(key);
+
+	if (itr != m_entriesByKey.end())
+	{
+		m_entries.erase(itr->second);
+		m_entriesByKey.erase(itr);
+	}
+
+	m_entries.push_front({ key, std::move(pidlCopy) });
+	m_entriesByKey.emplace(std::move(key), m_entries.begin());
+
+	while (m_entries.size() > m_maxEntries)
+	{
+		m_entriesByKey.erase(m_entries.back().key);
+		m_entries.pop_back();
+	}
+}
+
+void ParsedPathCache::InvalidateFolderContents(const std::wstring &path)
+{
+	std::wstring prefix = GetKey(path) + L"\\";
+
+	std::scoped_lock lock(m_mutex);
+
+	for (auto itr = m_entries.begin(); itr != m_entries.end();)
+	{
+		if (itr->key.starts_with(prefix))
+		{
+			m_entriesByKey.erase(itr->key);
+			itr = m_entries.erase(itr);
+		}
+		else
+		{
+			++itr;
+		}
+	}
+}
+
+void ParsedPathCache::Clear()
+{
+	std::scoped_lock lock(m_mutex);
+	m_entries.clear();
+	m_entriesByKey.clear();
+}
+
+size_t ParsedPathCache::GetSize()
+{
+	std::scoped_lock lock(m_mutex);
+	return m_entries.size();
+}
+
+// Paths are compared case-insensitively and any trailing backslash is ignored, so that (for
+// example) C:\Windows and c:\windows\ share an entry.
+std::wstring ParsedPathCache::GetKey(const std::wstring &path)
+{
+	std::wstring key = path;
+
+	while (key.size() > 1 && key.back() == '\\')
+	{
+		key.pop_back();
+	}
+
+	CharUpperBuff(key.data(), static_cast<DWORD>(key.size()));
+
+	return key;
+}
\ No newline at end of file
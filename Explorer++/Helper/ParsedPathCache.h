@@ -0,0 +1,76 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "ShellHelper.h"
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Caches the pidls that parsing paths (via SHParseDisplayName()) produces. The same locations tend
+// to be parsed repeatedly (e.g. when opening search results, bookmarks or application toolbar
+// buttons) and, within a network location, each parse is a round trip to the server.
+//
+// Items within a folder whose find data is already known (e.g. search results) can be built from
+// the cached pidl of the folder and a simple child pidl, so only the folder is ever parsed.
+//
+// The cache holds a fixed number of entries, with the least recently used entry being evicted
+// first. Entries within a folder should be invalidated whenever items in the folder are created,
+// deleted or renamed. Safe to use from multiple threads.
+class ParsedPathCache
+{
+public:
+	// Only replaced in tests.
+	using ParseFunction = std::function<HRESULT(const std::wstring &path, PIDLIST_ABSOLUTE *pidl)>;
+
+	static constexpr size_t DEFAULT_MAX_ENTRIES = 256;
+
+	explicit ParsedPathCache(
+		size_t maxEntries = DEFAULT_MAX_ENTRIES, ParseFunction parse = ParseDisplayName);
+
+	static ParsedPathCache &GetInstance();
+
+	// Returns a copy of the cached pidl for the path, parsing the path if necessary. Failures
+	// aren't cached.
+	HRESULT ParsePath(const std::wstring &path, PIDLIST_ABSOLUTE *pidl);
+
+	// Returns the pidl for an item within a filesystem folder, using the find data for the item
+	// (only the name and attributes are required). The folder is parsed through the cache, while
+	// the item itself isn't accessed.
+	HRESULT ParseChildPath(
+		const std::wstring &parentPath, const WIN32_FIND_DATA &wfd, PIDLIST_ABSOLUTE *pidl);
+
+	// Removes the cached entries for any items within the folder (including items within
+	// subfolders). The entry for the folder itself is retained.
+	void InvalidateFolderContents(const std::wstring &path);
+
+	void Clear();
+	size_t GetSize();
+
+private:
+	struct Entry
+	{
+		std::wstring key;
+		unique_pidl_absolute pidl;
+	};
+
+	using EntryList = std::list<Entry>;
+
+	static HRESULT ParseDisplayName(const std::wstring &path, PIDLIST_ABSOLUTE *pidl);
+	static std::wstring GetKey(const std::wstring &path);
+
+	void AddEntry(std::wstring key, PCIDLIST_ABSOLUTE pidl);
+
+	const size_t m_maxEntries;
+	const ParseFunction m_parse;
+
+	std::mutex m_mutex;
+
+	// Ordered from most to least recently used.
+	EntryList m_entries;
+	std::unordered_map<std::wstring, EntryList::iterator> m_entriesByKey;
+};
\ No newline at end of file
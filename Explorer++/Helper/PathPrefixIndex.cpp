@@ -0,0 +1,105 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "PathPrefixIndex.h"
+#include <unordered_set>
+
+void PathPrefixIndex::AddPath(std::wstring_view path)
+{
+	std::wstring normalizedPath = NormalizePath(path);
+
+	if (normalizedPath.empty())
+	{
+		return;
+	}
+
+	m_paths.try_emplace(ToLower(normalizedPath), normalizedPath);
+}
+
+void PathPrefixIndex::AddListedDirectory(std::wstring_view directory)
+{
+	std::wstring normalizedDirectory = NormalizePath(directory);
+
+	if (normalizedDirectory.empty())
+	{
+		return;
+	}
+
+	AddPath(normalizedDirectory);
+	m_listedDirectories.insert(ToLower(normalizedDirectory));
+}
+
+std::vector<std::wstring> PathPrefixIndex::GetChildren(
+	std::wstring_view directory, size_t maxResults) const
+{
+	std::wstring normalizedDirectory = NormalizePath(directory);
+
+	if (normalizedDirectory.empty())
+	{
+		return {};
+	}
+
+	std::wstring prefix = ToLower(normalizedDirectory) + L'\\';
+
+	std::vector<std::wstring> children;
+	std::unordered_set<std::wstring_view> childKeys;
+	auto itr = m_paths.lower_bound(prefix);
+
+	while (itr != m_paths.end() && itr->first.starts_with(prefix) && children.size() < maxResults)
+	{
+		size_t separator = itr->first.find(L'\\', prefix.size());
+		size_t childLength = (separator == std::wstring::npos) ? itr->first.size() : separator;
+		std::wstring_view childKey(itr->first.data(), childLength);
+
+		if (childLength > prefix.size() && childKeys.insert(childKey).second)
+		{
+			children.push_back(itr->second.substr(0, childLength));
+		}
+
+		if (separator == std::wstring::npos)
+		{
+			++itr;
+		}
+		else
+		{
+			// Every other path within this child sorts before the child followed by the character
+			// after the separator, so they can all be skipped at once.
+			itr = m_paths.lower_bound(std::wstring(childKey) + static_cast<wchar_t>(L'\\' + 1));
+		}
+	}
+
+	return children;
+}
+
+bool PathPrefixIndex::IsDirectoryListed(std::wstring_view directory) const
+{
+	return m_listedDirectories.contains(ToLower(NormalizePath(directory)));
+}
+
+size_t PathPrefixIndex::GetNumPaths() const
+{
+	return m_paths.size();
+}
+
+// Removes any trailing separators, so that C:\Windows and C:\Windows\ (and C:\ and C:) are treated
+// as the same path.
+std::wstring PathPrefixIndex::NormalizePath(std::wstring_view path)
+{
+	size_t end = path.find_last_not_of(L'\\');
+
+	if (end == std::wstring_view::npos)
+	{
+		return {};
+	}
+
+	return std::wstring(path.substr(0, end + 1));
+}
+
+std::wstring PathPrefixIndex::ToLower(std::wstring_view text)
+{
+	std::wstring lowercaseText(text);
+	CharLowerBuff(lowercaseText.data(), static_cast<DWORD>(lowercaseText.size()));
+	return lowercaseText;
+}
\ No newline at end of file
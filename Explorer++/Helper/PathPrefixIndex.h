@@ -0,0 +1,46 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A case-insensitive index of paths (e.g. those taken from the history, bookmarks and recently
+// viewed folders), used to suggest completions as a path is typed. Paths are kept sorted by their
+// lowercased form, so the items within a particular directory form a contiguous range that can be
+// found with a single lookup.
+//
+// This class isn't thread-safe. Once built, however, an instance can be shared between threads,
+// provided it's no longer modified.
+class PathPrefixIndex
+{
+public:
+	void AddPath(std::wstring_view path);
+
+	// Records that every item within the directory has been added to the index, so that there's no
+	// need to enumerate the directory to find its contents.
+	void AddListedDirectory(std::wstring_view directory);
+
+	// Returns the paths of the items directly within the directory that are known to the index.
+	// That includes items that only appear as part of a longer path (e.g. C:\Users will be returned
+	// for C:\ if only C:\Users\Public has been added).
+	std::vector<std::wstring> GetChildren(std::wstring_view directory, size_t maxResults) const;
+
+	bool IsDirectoryListed(std::wstring_view directory) const;
+
+	size_t GetNumPaths() const;
+
+private:
+	static std::wstring NormalizePath(std::wstring_view path);
+	static std::wstring ToLower(std::wstring_view text);
+
+	// Maps the lowercased form of each path to the path itself.
+	std::map<std::wstring, std::wstring> m_paths;
+
+	std::set<std::wstring> m_listedDirectories;
+};
\ No newline at end of file
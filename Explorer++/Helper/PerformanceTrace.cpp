@@ -0,0 +1,74 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "PerformanceTrace.h"
+#include <TraceLoggingProvider.h>
+#include <winmeta.h>
+
+// {95f5eed2-12a0-4b0a-908f-60291e387b8e}
+TRACELOGGING_DEFINE_PROVIDER(g_performanceTraceProvider, "ExplorerPlusPlus",
+	(0x95f5eed2, 0x12a0, 0x4b0a, 0x90, 0x8f, 0x60, 0x29, 0x1e, 0x38, 0x7b, 0x8e));
+
+void RegisterPerformanceTraceProvider()
+{
+	TraceLoggingRegister(g_performanceTraceProvider);
+}
+
+void UnregisterPerformanceTraceProvider()
+{
+	TraceLoggingUnregister(g_performanceTraceProvider);
+}
+
+PerformanceTraceActivity::PerformanceTraceActivity(const wchar_t *name) : m_name(name)
+{
+	if (!TraceLoggingProviderEnabled(g_performanceTraceProvider, WINEVENT_LEVEL_INFO, 0))
+	{
+		return;
+	}
+
+	EventActivityIdControl(EVENT_ACTIVITY_CTRL_CREATE_ID, &m_activityId);
+
+	// This sets the new activity as the thread's current activity and returns the previous one.
+	m_previousActivityId = m_activityId;
+	EventActivityIdControl(EVENT_ACTIVITY_CTRL_GET_SET_ID, &m_previousActivityId);
+
+	TraceLoggingWriteActivity(g_performanceTraceProvider, "Activity", &m_activityId,
+		IsEqualGUID(m_previousActivityId, GUID_NULL) ? nullptr : &m_previousActivityId,
+		TraceLoggingOpcode(WINEVENT_OPCODE_START), TraceLoggingLevel(WINEVENT_LEVEL_INFO),
+		TraceLoggingWideString(m_name, "Name"));
+
+	m_started = true;
+}
+
+PerformanceTraceActivity::~PerformanceTraceActivity()
+{
+	// If the provider wasn't enabled when the activity started, the stop event is skipped as well,
+	// even if a session has been started in the meantime, so that every stop event has a
+	// corresponding start event.
+	if (!m_started)
+	{
+		return;
+	}
+
+	TraceLoggingWriteActivity(g_performanceTraceProvider, "Activity", &m_activityId, nullptr,
+		TraceLoggingOpcode(WINEVENT_OPCODE_STOP), TraceLoggingLevel(WINEVENT_LEVEL_INFO),
+		TraceLoggingWideString(m_name, "Name"));
+
+	EventActivityIdControl(EVENT_ACTIVITY_CTRL_SET_ID, &m_previousActivityId);
+}
+
+void TracePerformanceTaskQueueWait(const void *owner, std::chrono::microseconds waitTime)
+{
+	TraceLoggingWrite(g_performanceTraceProvider, "TaskQueueWait",
+		TraceLoggingLevel(WINEVENT_LEVEL_INFO), TraceLoggingPointer(owner, "Owner"),
+		TraceLoggingInt64(waitTime.count(), "WaitTimeMicroseconds"));
+}
+
+void TracePerformanceTabSwitchPaint(int tabId, std::chrono::microseconds latency)
+{
+	TraceLoggingWrite(g_performanceTraceProvider, "TabSwitchPaint",
+		TraceLoggingLevel(WINEVENT_LEVEL_INFO), TraceLoggingInt32(tabId, "TabId"),
+		TraceLoggingInt64(latency.count(), "LatencyMicroseconds"));
+}
@@ -0,0 +1,42 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "Macros.h"
+#include <chrono>
+
+// Events are written through a TraceLogging provider, so that they can be captured with WPR (using
+// the profile in Scripts\Explorer++.wprp) and analyzed in WPA. The provider is named
+// "ExplorerPlusPlus" and has the ID {95f5eed2-12a0-4b0a-908f-60291e387b8e}.
+//
+// When no trace session has enabled the provider, each of the functions below does little more
+// than check a flag.
+void RegisterPerformanceTraceProvider();
+void UnregisterPerformanceTraceProvider();
+
+// Writes a start event on construction and a matching stop event on destruction. The activity
+// becomes the current activity for the thread while it's in scope, so activities started within it
+// are linked to it as children. The name must remain valid for the lifetime of the object.
+class PerformanceTraceActivity
+{
+public:
+	explicit PerformanceTraceActivity(const wchar_t *name);
+	~PerformanceTraceActivity();
+
+private:
+	DISALLOW_COPY_AND_ASSIGN(PerformanceTraceActivity);
+
+	const wchar_t *const m_name;
+	bool m_started = false;
+	GUID m_activityId = {};
+	GUID m_previousActivityId = {};
+};
+
+// Records the amount of time a background task spent queued before it started running.
+void TracePerformanceTaskQueueWait(const void *owner, std::chrono::microseconds waitTime);
+
+// Records the amount of time between a tab being selected and the deferred updates for the
+// selection starting, by which point the tab's listview has been painted.
+void TracePerformanceTabSwitchPaint(int tabId, std::chrono::microseconds latency);
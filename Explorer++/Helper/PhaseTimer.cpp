@@ -0,0 +1,31 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "PhaseTimer.h"
+
+PhaseTimer::PhaseTimer(NowFunction now) :
+	m_now(std::move(now)),
+	m_startTime(m_now()),
+	m_phaseStartTime(m_startTime)
+{
+}
+
+void PhaseTimer::EndPhase(const std::wstring &name)
+{
+	auto now = m_now();
+	m_phases.push_back(
+		{ name, std::chrono::duration_cast<std::chrono::milliseconds>(now - m_phaseStartTime) });
+	m_phaseStartTime = now;
+}
+
+const std::vector<PhaseTimer::Phase> &PhaseTimer::GetPhases() const
+{
+	return m_phases;
+}
+
+std::chrono::milliseconds PhaseTimer::GetTotalDuration() const
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(m_phaseStartTime - m_startTime);
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Measures the time taken by each of a series of consecutive phases (e.g. the steps involved in
+// starting the application). Each phase starts where the previous one ended.
+class PhaseTimer
+{
+public:
+	using Clock = std::chrono::steady_clock;
+	using NowFunction = std::function<Clock::time_point()>;
+
+	struct Phase
+	{
+		std::wstring name;
+		std::chrono::milliseconds duration;
+	};
+
+	explicit PhaseTimer(NowFunction now = Clock::now);
+
+	// Ends the current phase, recording it under the specified name, and starts the next one.
+	void EndPhase(const std::wstring &name);
+
+	const std::vector<Phase> &GetPhases() const;
+
+	// Returns the time from the point the timer was created to the end of the last phase.
+	std::chrono::milliseconds GetTotalDuration() const;
+
+private:
+	const NowFunction m_now;
+	const Clock::time_point m_startTime;
+	Clock::time_point m_phaseStartTime;
+	std::vector<Phase> m_phases;
+};
\ No newline at end of file
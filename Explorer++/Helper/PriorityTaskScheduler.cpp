@@ -0,0 +1,426 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "PriorityTaskScheduler.h"
+#include "PerformanceTrace.h"
+
+PriorityTaskScheduler::PriorityTaskScheduler(
+	int numThreads, ThreadCallback threadStartCallback, ThreadCallback threadExitCallback)
+{
+	for (int i = 0; i < numThreads; i++)
+	{
+		m_threads.emplace_back(&PriorityTaskScheduler::WorkerThreadMain, this,
+			threadStartCallback, threadExitCallback);
+	}
+}
+
+PriorityTaskScheduler::~PriorityTaskScheduler()
+{
+	{
+		std::scoped_lock lock(m_mutex);
+		m_taskQueues.clear();
+		m_stopping = true;
+	}
+
+	m_taskQueuedCondition.notify_all();
+
+	for (auto &thread : m_threads)
+	{
+		thread.join();
+	}
+}
+
+void PriorityTaskScheduler::QueueTask(OwnerId owner, std::optional<int> key, int priority,
+	std::function<void()> function, std::function<void()> cancelledCallback)
+{
+	{
+		std::scoped_lock lock(m_mutex);
+
+		std::wstring resource;
+		auto itr = m_ownerResources.find(owner);
+
+		if (itr != m_ownerResources.end())
+		{
+			resource = itr->second;
+		}
+
+		TaskClass taskClass = TaskClass::Interactive;
+		auto taskClassItr = m_ownerTaskClasses.find(owner);
+
+		if (taskClassItr != m_ownerTaskClasses.end())
+		{
+			taskClass = taskClassItr->second;
+		}
+
+		auto &queue = m_taskQueues[resource];
+		queue.insert({ { taskClass, GetOwnerRank(owner), priority, m_taskCounter++ },
+			{ owner, std::move(resource), taskClass, key, std::move(function),
+				std::move(cancelledCallback), std::chrono::steady_clock::now() } });
+	}
+
+	m_taskQueuedCondition.notify_one();
+}
+
+void PriorityTaskScheduler::UpdatePriorities(
+	OwnerId owner, const PriorityCallback &priorityCallback)
+{
+	struct OwnerTask
+	{
+		std::wstring resource;
+		TaskOrder order;
+		int key;
+	};
+
+	std::vector<OwnerTask> ownerTasks;
+
+	{
+		std::scoped_lock lock(m_mutex);
+
+		for (const auto &[resource, queue] : m_taskQueues)
+		{
+			for (const auto &[order, task] : queue)
+			{
+				if (task.owner == owner && task.key)
+				{
+					ownerTasks.emplace_back(resource, order, *task.key);
+				}
+			}
+		}
+	}
+
+	if (ownerTasks.empty())
+	{
+		return;
+	}
+
+	std::vector<std::optional<int>> updatedPriorities;
+	updatedPriorities.reserve(ownerTasks.size());
+
+	for (const auto &ownerTask : ownerTasks)
+	{
+		updatedPriorities.push_back(priorityCallback(ownerTask.key));
+	}
+
+	std::vector<std::function<void()>> cancelledCallbacks;
+
+	{
+		std::scoped_lock lock(m_mutex);
+
+		for (size_t i = 0; i < ownerTasks.size(); i++)
+		{
+			const auto &[resource, order, key] = ownerTasks[i];
+			const auto &updatedPriority = updatedPriorities[i];
+
+			if (updatedPriority && *updatedPriority == std::get<2>(order))
+			{
+				continue;
+			}
+
+			auto queueItr = m_taskQueues.find(resource);
+
+			if (queueItr == m_taskQueues.end())
+			{
+				continue;
+			}
+
+			// The task may have started running since the list above was built, in which case
+			// there's nothing to update.
+			auto node = queueItr->second.extract(order);
+
+			if (node.empty())
+			{
+				continue;
+			}
+
+			if (updatedPriority)
+			{
+				// The original sequence number is retained, so that tasks given the same priority
+				// are still run in the order in which they were queued.
+				node.key() = { std::get<0>(order), std::get<1>(order), *updatedPriority,
+					std::get<3>(order) };
+				queueItr->second.insert(std::move(node));
+			}
+			else
+			{
+				if (node.mapped().cancelledCallback)
+				{
+					cancelledCallbacks.push_back(std::move(node.mapped().cancelledCallback));
+				}
+
+				if (queueItr->second.empty())
+				{
+					m_taskQueues.erase(queueItr);
+				}
+			}
+		}
+	}
+
+	for (const auto &cancelledCallback : cancelledCallbacks)
+	{
+		cancelledCallback();
+	}
+}
+
+void PriorityTaskScheduler::CancelTasks(OwnerId owner, bool waitForRunningTasks)
+{
+	std::unique_lock lock(m_mutex);
+
+	std::erase_if(m_taskQueues, [owner](auto &item) {
+		std::erase_if(item.second,
+			[owner](const auto &queuedTask) { return queuedTask.second.owner == owner; });
+		return item.second.empty();
+	});
+
+	if (waitForRunningTasks)
+	{
+		m_taskFinishedCondition.wait(lock, [this, owner]() {
+			auto itr = m_runningTaskCounts.find(owner);
+			return itr == m_runningTaskCounts.end();
+		});
+	}
+}
+
+void PriorityTaskScheduler::SetPreferredOwners(const std::vector<OwnerId> &owners)
+{
+	std::scoped_lock lock(m_mutex);
+
+	m_preferredOwners = { owners.begin(), owners.end() };
+
+	for (auto &[resource, queue] : m_taskQueues)
+	{
+		TaskQueue reorderedTasks;
+
+		while (!queue.empty())
+		{
+			auto node = queue.extract(queue.begin());
+			std::get<1>(node.key()) = GetOwnerRank(node.mapped().owner);
+			reorderedTasks.insert(std::move(node));
+		}
+
+		queue = std::move(reorderedTasks);
+	}
+}
+
+void PriorityTaskScheduler::SetOwnerResource(OwnerId owner, const std::wstring &resource)
+{
+	std::scoped_lock lock(m_mutex);
+
+	if (resource.empty())
+	{
+		m_ownerResources.erase(owner);
+	}
+	else
+	{
+		m_ownerResources[owner] = resource;
+	}
+}
+
+void PriorityTaskScheduler::SetOwnerTaskClass(OwnerId owner, TaskClass taskClass)
+{
+	std::scoped_lock lock(m_mutex);
+
+	if (taskClass == TaskClass::Interactive)
+	{
+		m_ownerTaskClasses.erase(owner);
+	}
+	else
+	{
+		m_ownerTaskClasses[owner] = taskClass;
+	}
+}
+
+void PriorityTaskScheduler::SetResourceLimit(const std::wstring &resource, int maxRunningTasks)
+{
+	{
+		std::scoped_lock lock(m_mutex);
+
+		if (maxRunningTasks > 0)
+		{
+			m_resourceLimits[resource] = maxRunningTasks;
+		}
+		else
+		{
+			m_resourceLimits.erase(resource);
+		}
+	}
+
+	// Raising or removing a limit may allow queued tasks to run.
+	m_taskQueuedCondition.notify_all();
+}
+
+std::optional<std::chrono::microseconds> PriorityTaskScheduler::GetResourceLatency(
+	const std::wstring &resource) const
+{
+	std::scoped_lock lock(m_mutex);
+
+	auto itr = m_resourceLatencies.find(resource);
+
+	if (itr == m_resourceLatencies.end())
+	{
+		return std::nullopt;
+	}
+
+	return itr->second;
+}
+
+// Must be called with the lock held.
+int PriorityTaskScheduler::GetOwnerRank(OwnerId owner) const
+{
+	return m_preferredOwners.contains(owner) ? 0 : 1;
+}
+
+// Must be called with the lock held. Returns the queue containing the highest priority task that
+// can be run without exceeding a resource limit, or nullptr if there's no such task.
+PriorityTaskScheduler::TaskQueue *PriorityTaskScheduler::GetNextRunnableQueue()
+{
+	TaskQueue *nextQueue = nullptr;
+
+	for (auto &[resource, queue] : m_taskQueues)
+	{
+		auto limitItr = m_resourceLimits.find(resource);
+
+		if (limitItr != m_resourceLimits.end())
+		{
+			auto runningItr = m_runningResourceTaskCounts.find(resource);
+
+			if (runningItr != m_runningResourceTaskCounts.end()
+				&& runningItr->second >= limitItr->second)
+			{
+				continue;
+			}
+		}
+
+		if (!nextQueue || queue.begin()->first < nextQueue->begin()->first)
+		{
+			nextQueue = &queue;
+		}
+	}
+
+	return nextQueue;
+}
+
+// Must be called with the lock held.
+void PriorityTaskScheduler::OnTaskFinished(
+	const Task &task, std::chrono::steady_clock::duration duration)
+{
+	auto itr = m_runningTaskCounts.find(task.owner);
+
+	if (--itr->second == 0)
+	{
+		m_runningTaskCounts.erase(itr);
+	}
+
+	if (task.resource.empty())
+	{
+		return;
+	}
+
+	auto resourceItr = m_runningResourceTaskCounts.find(task.resource);
+
+	if (--resourceItr->second == 0)
+	{
+		m_runningResourceTaskCounts.erase(resourceItr);
+	}
+
+	auto durationMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>(duration);
+	auto [latencyItr, inserted] =
+		m_resourceLatencies.try_emplace(task.resource, durationMicroseconds);
+
+	if (!inserted)
+	{
+		latencyItr->second = std::chrono::microseconds(
+			static_cast<std::chrono::microseconds::rep>(LATENCY_SMOOTHING_FACTOR
+					* static_cast<double>(durationMicroseconds.count())
+				+ (1.0 - LATENCY_SMOOTHING_FACTOR) * static_cast<double>(latencyItr->second.count())));
+	}
+}
+
+int PriorityTaskScheduler::GetNumThreads() const
+{
+	return static_cast<int>(m_threads.size());
+}
+
+void PriorityTaskScheduler::WorkerThreadMain(
+	const ThreadCallback &threadStartCallback, const ThreadCallback &threadExitCallback)
+{
+	if (threadStartCallback)
+	{
+		threadStartCallback();
+	}
+
+	while (true)
+	{
+		Task task;
+
+		{
+			std::unique_lock lock(m_mutex);
+
+			TaskQueue *queue = nullptr;
+			m_taskQueuedCondition.wait(lock, [this, &queue]() {
+				if (m_stopping)
+				{
+					return true;
+				}
+
+				queue = GetNextRunnableQueue();
+				return queue != nullptr;
+			});
+
+			if (m_stopping)
+			{
+				break;
+			}
+
+			auto node = queue->extract(queue->begin());
+			task = std::move(node.mapped());
+
+			if (queue->empty())
+			{
+				m_taskQueues.erase(task.resource);
+			}
+
+			m_runningTaskCounts[task.owner]++;
+
+			if (!task.resource.empty())
+			{
+				m_runningResourceTaskCounts[task.resource]++;
+			}
+		}
+
+		TracePerformanceTaskQueueWait(task.owner,
+			std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::steady_clock::now() - task.queuedTime));
+
+		SetCurrentThreadTaskClass(task.taskClass);
+
+		auto startTime = std::chrono::steady_clock::now();
+
+		{
+			PerformanceTraceActivity traceActivity(L"BackgroundTask");
+			task.function();
+		}
+
+		auto duration = std::chrono::steady_clock::now() - startTime;
+
+		{
+			std::scoped_lock lock(m_mutex);
+			OnTaskFinished(task, duration);
+		}
+
+		m_taskFinishedCondition.notify_all();
+
+		// Finishing a task for a resource that's limited may allow another of the resource's
+		// queued tasks to run.
+		if (!task.resource.empty())
+		{
+			m_taskQueuedCondition.notify_one();
+		}
+	}
+
+	if (threadExitCallback)
+	{
+		threadExitCallback();
+	}
+}
\ No newline at end of file
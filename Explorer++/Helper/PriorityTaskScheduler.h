@@ -0,0 +1,169 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "ThreadQos.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// A fixed set of worker threads that run queued tasks in priority order. Tasks with a lower
+// priority value are run first and tasks with the same priority are run in the order in which they
+// were queued.
+//
+// Each task is queued on behalf of an owner. An owner can re-prioritize or cancel its own queued
+// tasks without affecting the tasks of any other owner, which allows a single set of threads to be
+// shared between many clients. A set of owners can also be marked as preferred, in which case their
+// tasks are run ahead of the tasks of every other owner, regardless of priority.
+//
+// An owner can also be associated with a resource (e.g. the remote server its tasks access). The
+// number of tasks for a resource that run at once can be limited, so that the threads aren't all
+// stuck waiting on a single slow resource, and the time taken by each resource's tasks is tracked.
+//
+// Finally, each owner's tasks belong to a TaskClass (Interactive, unless specified otherwise).
+// Tasks in a more urgent class are always run first and each task runs with its class's thread
+// priorities, so that background work doesn't slow down the work the user is waiting on.
+class PriorityTaskScheduler
+{
+public:
+	using OwnerId = const void *;
+	using ThreadCallback = std::function<void()>;
+
+	// Returns the new priority for the task queued with the specified key, or std::nullopt if the
+	// task should be cancelled.
+	using PriorityCallback = std::function<std::optional<int>(int key)>;
+
+	PriorityTaskScheduler(int numThreads, ThreadCallback threadStartCallback = nullptr,
+		ThreadCallback threadExitCallback = nullptr);
+	~PriorityTaskScheduler();
+
+	PriorityTaskScheduler(const PriorityTaskScheduler &) = delete;
+	PriorityTaskScheduler &operator=(const PriorityTaskScheduler &) = delete;
+
+	// Queues a task. The key is passed back to the owner when the priorities of its tasks are
+	// updated. Tasks that have no key keep their initial priority and are never cancelled by
+	// UpdatePriorities().
+	//
+	// If the task is cancelled by UpdatePriorities(), the cancelled callback (if any) will be
+	// invoked and the returned future will never be made ready.
+	template <typename Function>
+	auto PushTask(OwnerId owner, std::optional<int> key, int priority, Function &&function,
+		std::function<void()> cancelledCallback = nullptr)
+		-> std::future<std::invoke_result_t<Function>>
+	{
+		using ResultType = std::invoke_result_t<Function>;
+
+		auto task =
+			std::make_shared<std::packaged_task<ResultType()>>(std::forward<Function>(function));
+		auto future = task->get_future();
+
+		QueueTask(
+			owner, key, priority, [task]() { (*task)(); }, std::move(cancelledCallback));
+
+		return future;
+	}
+
+	// Queues a task that has no result to return (e.g. because it delivers its result through a
+	// ResultChannel). Unlike PushTask(), this doesn't create a future for the task.
+	void PostTask(OwnerId owner, std::optional<int> key, int priority, std::function<void()> function,
+		std::function<void()> cancelledCallback = nullptr)
+	{
+		QueueTask(owner, key, priority, std::move(function), std::move(cancelledCallback));
+	}
+
+	// Recalculates the priority of each of the owner's queued tasks. Tasks that the callback
+	// returns no priority for are removed from the queue. Both the priority callback and any
+	// cancelled callbacks are invoked on the calling thread, without the internal lock held.
+	void UpdatePriorities(OwnerId owner, const PriorityCallback &priorityCallback);
+
+	// Removes all of the owner's queued tasks. Cancelled callbacks aren't invoked in this case. If
+	// waitForRunningTasks is true, this will also wait for any of the owner's tasks that are
+	// currently running to finish, after which it's safe for the owner to be destroyed.
+	void CancelTasks(OwnerId owner, bool waitForRunningTasks = false);
+
+	// Replaces the set of preferred owners. Tasks that are already queued are reordered
+	// accordingly.
+	void SetPreferredOwners(const std::vector<OwnerId> &owners);
+
+	// Associates the owner's subsequently queued tasks with the specified resource. An empty
+	// resource removes the association. Tasks that have already been queued are unaffected.
+	void SetOwnerResource(OwnerId owner, const std::wstring &resource);
+
+	// Sets the class of the owner's subsequently queued tasks. As with the resource above, tasks
+	// that have already been queued are unaffected.
+	void SetOwnerTaskClass(OwnerId owner, TaskClass taskClass);
+
+	// Limits the number of tasks associated with the resource that can run at the same time. A
+	// limit of 0 removes any existing limit.
+	void SetResourceLimit(const std::wstring &resource, int maxRunningTasks);
+
+	// Returns a moving average of the time taken to run the tasks associated with the resource, or
+	// std::nullopt if no tasks for the resource have run yet.
+	std::optional<std::chrono::microseconds> GetResourceLatency(const std::wstring &resource) const;
+
+	int GetNumThreads() const;
+
+private:
+	struct Task
+	{
+		OwnerId owner;
+		std::wstring resource;
+		TaskClass taskClass;
+		std::optional<int> key;
+		std::function<void()> function;
+		std::function<void()> cancelledCallback;
+		std::chrono::steady_clock::time_point queuedTime;
+	};
+
+	// Tasks are ordered by their class, then by whether their owner is preferred, then by priority
+	// and then by the order in which they were queued.
+	using TaskOrder = std::tuple<TaskClass, int, int, uint64_t>;
+	using TaskQueue = std::map<TaskOrder, Task>;
+
+	// The weight given to the most recent task duration when updating a resource's latency.
+	static constexpr double LATENCY_SMOOTHING_FACTOR = 0.2;
+
+	void QueueTask(OwnerId owner, std::optional<int> key, int priority,
+		std::function<void()> function, std::function<void()> cancelledCallback);
+	int GetOwnerRank(OwnerId owner) const;
+	TaskQueue *GetNextRunnableQueue();
+	void OnTaskFinished(const Task &task, std::chrono::steady_clock::duration duration);
+	void WorkerThreadMain(const ThreadCallback &threadStartCallback,
+		const ThreadCallback &threadExitCallback);
+
+	std::vector<std::thread> m_threads;
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_taskQueuedCondition;
+	std::condition_variable m_taskFinishedCondition;
+
+	// Tasks are queued separately for each resource, so that the queued tasks for a resource that's
+	// at its limit can be skipped over without having to examine each one. Tasks that aren't
+	// associated with a resource are queued under the empty resource, which has no limit.
+	std::unordered_map<std::wstring, TaskQueue> m_taskQueues;
+	std::unordered_map<OwnerId, int> m_runningTaskCounts;
+	std::unordered_map<OwnerId, std::wstring> m_ownerResources;
+	std::unordered_map<OwnerId, TaskClass> m_ownerTaskClasses;
+	std::unordered_map<std::wstring, int> m_resourceLimits;
+	std::unordered_map<std::wstring, int> m_runningResourceTaskCounts;
+	std::unordered_map<std::wstring, std::chrono::microseconds> m_resourceLatencies;
+	std::unordered_set<OwnerId> m_preferredOwners;
+	uint64_t m_taskCounter = 0;
+	bool m_stopping = false;
+};
\ No newline at end of file
@@ -0,0 +1,1114 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+// The pattern is compiled into a program for a Pike VM. All possible matches are tracked at once
+// (as a list of threads, at most one per instruction), while the input is read a single character
+// at a time. Threads are kept in priority order, which is what provides the same leftmost-first
+// results as a backtracking implementation.
+
+#include "stdafx.h"
+#include "Regex.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace
+{
+
+// These limits keep both the recursion used while parsing and the size of the compiled program
+// bounded, regardless of the pattern.
+const int MAX_NESTING_DEPTH = 256;
+const int MAX_REPEAT_COUNT = 1000;
+const size_t MAX_PROGRAM_SIZE = 100000;
+
+const int REPEAT_UNBOUNDED = -1;
+
+struct Node
+{
+	enum class Type
+	{
+		Empty,
+		Char,
+		Any,
+		Class,
+		Begin,
+		End,
+		WordBoundary,
+		NotWordBoundary,
+		Concatenation,
+		Alternation,
+		Repetition
+	};
+
+	Type type;
+	wchar_t ch = 0;
+	size_t classIndex = 0;
+	std::vector<size_t> children;
+	int min = 0;
+	int max = 0;
+	bool greedy = true;
+};
+
+wchar_t MapChar(wchar_t ch, DWORD flags)
+{
+	wchar_t mapped;
+	int res = LCMapString(LOCALE_USER_DEFAULT, flags, &ch, 1, &mapped, 1);
+
+	if (res != 1)
+	{
+		return ch;
+	}
+
+	return mapped;
+}
+
+bool IsWordChar(wchar_t ch)
+{
+	return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9')
+		|| ch == '_';
+}
+
+bool IsLineTerminator(wchar_t ch)
+{
+	return ch == '\n' || ch == '\r' || ch == 0x2028 || ch == 0x2029;
+}
+
+int HexDigitValue(wchar_t ch)
+{
+	if (ch >= '0' && ch <= '9')
+	{
+		return ch - '0';
+	}
+	else if (ch >= 'a' && ch <= 'f')
+	{
+		return ch - 'a' + 10;
+	}
+	else if (ch >= 'A' && ch <= 'F')
+	{
+		return ch - 'A' + 10;
+	}
+
+	return -1;
+}
+
+}
+
+class Regex::Parser
+{
+public:
+	Parser(Regex &regex, std::wstring_view pattern) : m_regex(regex), m_pattern(pattern)
+	{
+	}
+
+	void Parse()
+	{
+		size_t root = ParseAlternation(0);
+
+		if (m_position != m_pattern.size())
+		{
+			throw std::invalid_argument("Unmatched ')' in regular expression");
+		}
+
+		Compile(root);
+		Emit(Opcode::Match);
+	}
+
+private:
+	size_t AddNode(Node node)
+	{
+		m_nodes.push_back(std::move(node));
+		return m_nodes.size() - 1;
+	}
+
+	size_t AddNode(Node::Type type)
+	{
+		Node node;
+		node.type = type;
+		return AddNode(std::move(node));
+	}
+
+	bool AtEnd() const
+	{
+		return m_position >= m_pattern.size();
+	}
+
+	bool Peek(wchar_t ch) const
+	{
+		return !AtEnd() && m_pattern[m_position] == ch;
+	}
+
+	size_t ParseAlternation(int depth)
+	{
+		if (depth > MAX_NESTING_DEPTH)
+		{
+			throw std::invalid_argument("Regular expression is nested too deeply");
+		}
+
+		std::vector<size_t> alternatives = { ParseConcatenation(depth) };
+
+		while (Peek('|'))
+		{
+			m_position++;
+			alternatives.push_back(ParseConcatenation(depth));
+		}
+
+		if (alternatives.size() == 1)
+		{
+			return alternatives[0];
+		}
+
+		Node node;
+		node.type = Node::Type::Alternation;
+		node.children = std::move(alternatives);
+		return AddNode(std::move(node));
+	}
+
+	size_t ParseConcatenation(int depth)
+	{
+		std::vector<size_t> items;
+
+		while (!AtEnd() && !Peek('|') && !Peek(')'))
+		{
+			items.push_back(ParseRepetition(depth));
+		}
+
+		if (items.empty())
+		{
+			return AddNode(Node::Type::Empty);
+		}
+		else if (items.size() == 1)
+		{
+			return items[0];
+		}
+
+		Node node;
+		node.type = Node::Type::Concatenation;
+		node.children = std::move(items);
+		return AddNode(std::move(node));
+	}
+
+	size_t ParseRepetition(int depth)
+	{
+		size_t atom = ParseAtom(depth);
+
+		int min;
+		int max;
+
+		if (!ParseQuantifier(min, max))
+		{
+			return atom;
+		}
+
+		bool greedy = true;
+
+		if (Peek('?'))
+		{
+			m_position++;
+			greedy = false;
+		}
+
+		int nextMin;
+		int nextMax;
+		size_t savedPosition = m_position;
+
+		if (ParseQuantifier(nextMin, nextMax))
+		{
+			m_position = savedPosition;
+			throw std::invalid_argument("Nothing to repeat in regular expression");
+		}
+
+		Node node;
+		node.type = Node::Type::Repetition;
+		node.children = { atom };
+		node.min = min;
+		node.max = max;
+		node.greedy = greedy;
+		return AddNode(std::move(node));
+	}
+
+	bool ParseQuantifier(int &min, int &max)
+	{
+		if (AtEnd())
+		{
+			return false;
+		}
+
+		switch (m_pattern[m_position])
+		{
+		case '*':
+			m_position++;
+			min = 0;
+			max = REPEAT_UNBOUNDED;
+			return true;
+
+		case '+':
+			m_position++;
+			min = 1;
+			max = REPEAT_UNBOUNDED;
+			return true;
+
+		case '?':
+			m_position++;
+			min = 0;
+			max = 1;
+			return true;
+
+		case '{':
+			return ParseBraceQuantifier(min, max);
+		}
+
+		return false;
+	}
+
+	// Parses {n}, {n,} or {n,m}. Anything else is treated as a literal '{', as ECMAScript allows.
+	bool ParseBraceQuantifier(int &min, int &max)
+	{
+		size_t savedPosition = m_position;
+		m_position++;
+
+		auto parsedMin = ParseNumber();
+
+		if (!parsedMin)
+		{
+			m_position = savedPosition;
+			return false;
+		}
+
+		std::optional<int> parsedMax = parsedMin;
+
+		if (Peek(','))
+		{
+			m_position++;
+			parsedMax = ParseNumber();
+
+			if (!parsedMax)
+			{
+				parsedMax = REPEAT_UNBOUNDED;
+			}
+		}
+
+		if (!Peek('}'))
+		{
+			m_position = savedPosition;
+			return false;
+		}
+
+		m_position++;
+
+		if (*parsedMax != REPEAT_UNBOUNDED && *parsedMax < *parsedMin)
+		{
+			throw std::invalid_argument("Invalid repeat range in regular expression");
+		}
+
+		min = *parsedMin;
+		max = *parsedMax;
+		return true;
+	}
+
+	std::optional<int> ParseNumber()
+	{
+		int value = 0;
+		bool found = false;
+
+		while (!AtEnd() && m_pattern[m_position] >= '0' && m_pattern[m_position] <= '9')
+		{
+			value = value * 10 + (m_pattern[m_position] - '0');
+			m_position++;
+			found = true;
+
+			if (value > MAX_REPEAT_COUNT)
+			{
+				throw std::invalid_argument("Repeat count too large in regular expression");
+			}
+		}
+
+		if (!found)
+		{
+			return std::nullopt;
+		}
+
+		return value;
+	}
+
+	size_t ParseAtom(int depth)
+	{
+		wchar_t ch = m_pattern[m_position++];
+
+		switch (ch)
+		{
+		case '(':
+		{
+			if (Peek('?'))
+			{
+				if (m_position + 1 < m_pattern.size() && m_pattern[m_position + 1] == ':')
+				{
+					m_position += 2;
+				}
+				else
+				{
+					throw std::invalid_argument("Unsupported group type in regular expression");
+				}
+			}
+
+			size_t child = ParseAlternation(depth + 1);
+
+			if (!Peek(')'))
+			{
+				throw std::invalid_argument("Missing ')' in regular expression");
+			}
+
+			m_position++;
+			return child;
+		}
+
+		case '[':
+			return ParseClass();
+
+		case '.':
+			return AddNode(Node::Type::Any);
+
+		case '^':
+			return AddNode(Node::Type::Begin);
+
+		case '$':
+			return AddNode(Node::Type::End);
+
+		case '\\':
+			return ParseEscape();
+
+		case '*':
+		case '+':
+		case '?':
+			throw std::invalid_argument("Nothing to repeat in regular expression");
+		}
+
+		return AddCharNode(ch);
+	}
+
+	size_t AddCharNode(wchar_t ch)
+	{
+		Node node;
+		node.type = Node::Type::Char;
+		node.ch = m_regex.m_caseInsensitive ? MapChar(ch, LCMAP_LOWERCASE) : ch;
+		return AddNode(std::move(node));
+	}
+
+	size_t ParseEscape()
+	{
+		if (AtEnd())
+		{
+			throw std::invalid_argument("Trailing '\\' in regular expression");
+		}
+
+		wchar_t ch = m_pattern[m_position];
+		std::vector<CharRange> ranges;
+
+		if (GetClassEscapeRanges(ch, ranges))
+		{
+			m_position++;
+			return AddClassNode(std::move(ranges), false);
+		}
+
+		switch (ch)
+		{
+		case 'b':
+			m_position++;
+			return AddNode(Node::Type::WordBoundary);
+
+		case 'B':
+			m_position++;
+			return AddNode(Node::Type::NotWordBoundary);
+		}
+
+		if (ch >= '1' && ch <= '9')
+		{
+			throw std::invalid_argument("Backreferences aren't supported in regular expressions");
+		}
+
+		return AddCharNode(ParseEscapedChar(false));
+	}
+
+	// Handles the escapes that are valid both inside and outside of a character class. The
+	// current position is just after the '\'.
+	wchar_t ParseEscapedChar(bool inClass)
+	{
+		wchar_t ch = m_pattern[m_position++];
+
+		switch (ch)
+		{
+		case 't':
+			return '\t';
+
+		case 'n':
+			return '\n';
+
+		case 'r':
+			return '\r';
+
+		case 'f':
+			return '\f';
+
+		case 'v':
+			return '\v';
+
+		case '0':
+			return '\0';
+
+		case 'b':
+			// Within a class, \b is a backspace.
+			if (inClass)
+			{
+				return '\b';
+			}
+			break;
+
+		case 'x':
+			return ParseHexEscape(2);
+
+		case 'u':
+			return ParseHexEscape(4);
+		}
+
+		return ch;
+	}
+
+	wchar_t ParseHexEscape(int numDigits)
+	{
+		int value = 0;
+
+		for (int i = 0; i < numDigits; i++)
+		{
+			int digit = AtEnd() ? -1 : HexDigitValue(m_pattern[m_position]);
+
+			if (digit == -1)
+			{
+				throw std::invalid_argument("Invalid hex escape in regular expression");
+			}
+
+			value = value * 16 + digit;
+			m_position++;
+		}
+
+		return static_cast<wchar_t>(value);
+	}
+
+	static bool GetClassEscapeRanges(wchar_t ch, std::vector<CharRange> &ranges)
+	{
+		static const std::vector<CharRange> DIGIT_RANGES = { { '0', '9' } };
+		static const std::vector<CharRange> WORD_RANGES = { { '0', '9' }, { 'A', 'Z' },
+			{ '_', '_' }, { 'a', 'z' } };
+		static const std::vector<CharRange> SPACE_RANGES = { { '\t', '\r' }, { ' ', ' ' },
+			{ 0xA0, 0xA0 }, { 0x1680, 0x1680 }, { 0x2000, 0x200A }, { 0x2028, 0x2029 },
+			{ 0x202F, 0x202F }, { 0x205F, 0x205F }, { 0x3000, 0x3000 }, { 0xFEFF, 0xFEFF } };
+
+		switch (ch)
+		{
+		case 'd':
+			ranges = DIGIT_RANGES;
+			return true;
+
+		case 'D':
+			ranges = Complement(DIGIT_RANGES);
+			return true;
+
+		case 'w':
+			ranges = WORD_RANGES;
+			return true;
+
+		case 'W':
+			ranges = Complement(WORD_RANGES);
+			return true;
+
+		case 's':
+			ranges = SPACE_RANGES;
+			return true;
+
+		case 'S':
+			ranges = Complement(SPACE_RANGES);
+			return true;
+		}
+
+		return false;
+	}
+
+	static std::vector<CharRange> Complement(const std::vector<CharRange> &ranges)
+	{
+		std::vector<CharRange> complement;
+		wchar_t next = 0;
+		bool reachedEnd = false;
+
+		for (const auto &range : ranges)
+		{
+			if (range.first > next)
+			{
+				complement.push_back({ next, static_cast<wchar_t>(range.first - 1) });
+			}
+
+			if (range.last == (std::numeric_limits<wchar_t>::max)())
+			{
+				reachedEnd = true;
+				break;
+			}
+
+			next = range.last + 1;
+		}
+
+		if (!reachedEnd)
+		{
+			complement.push_back({ next, (std::numeric_limits<wchar_t>::max)() });
+		}
+
+		return complement;
+	}
+
+	static void Normalize(std::vector<CharRange> &ranges)
+	{
+		std::sort(ranges.begin(), ranges.end(),
+			[](const CharRange &first, const CharRange &second) {
+				return first.first < second.first;
+			});
+
+		std::vector<CharRange> merged;
+
+		for (const auto &range : ranges)
+		{
+			if (!merged.empty()
+				&& static_cast<unsigned long>(range.first)
+					<= static_cast<unsigned long>(merged.back().last) + 1)
+			{
+				merged.back().last = (std::max)(merged.back().last, range.last);
+			}
+			else
+			{
+				merged.push_back(range);
+			}
+		}
+
+		ranges = std::move(merged);
+	}
+
+	size_t ParseClass()
+	{
+		bool negated = false;
+
+		if (Peek('^'))
+		{
+			m_position++;
+			negated = true;
+		}
+
+		std::vector<CharRange> ranges;
+
+		while (true)
+		{
+			if (AtEnd())
+			{
+				throw std::invalid_argument("Missing ']' in regular expression");
+			}
+
+			if (Peek(']'))
+			{
+				m_position++;
+				break;
+			}
+
+			if (Peek('\\') && m_position + 1 < m_pattern.size())
+			{
+				std::vector<CharRange> escapeRanges;
+
+				if (GetClassEscapeRanges(m_pattern[m_position + 1], escapeRanges))
+				{
+					m_position += 2;
+					ranges.insert(ranges.end(), escapeRanges.begin(), escapeRanges.end());
+					continue;
+				}
+			}
+
+			wchar_t first = ParseClassChar();
+			wchar_t last = first;
+
+			if (Peek('-') && m_position + 1 < m_pattern.size()
+				&& m_pattern[m_position + 1] != ']')
+			{
+				m_position++;
+				last = ParseClassChar();
+
+				if (last < first)
+				{
+					throw std::invalid_argument("Invalid range in regular expression");
+				}
+			}
+
+			ranges.push_back({ first, last });
+		}
+
+		return AddClassNode(std::move(ranges), negated);
+	}
+
+	wchar_t ParseClassChar()
+	{
+		wchar_t ch = m_pattern[m_position++];
+
+		if (ch != '\\')
+		{
+			return ch;
+		}
+
+		if (AtEnd())
+		{
+			throw std::invalid_argument("Trailing '\\' in regular expression");
+		}
+
+		if (m_pattern[m_position] >= '1' && m_pattern[m_position] <= '9')
+		{
+			throw std::invalid_argument("Backreferences aren't supported in regular expressions");
+		}
+
+		std::vector<CharRange> escapeRanges;
+
+		if (GetClassEscapeRanges(m_pattern[m_position], escapeRanges))
+		{
+			throw std::invalid_argument("Invalid range in regular expression");
+		}
+
+		return ParseEscapedChar(true);
+	}
+
+	size_t AddClassNode(std::vector<CharRange> ranges, bool negated)
+	{
+		Normalize(ranges);
+
+		CharClass charClass;
+		charClass.ranges = std::move(ranges);
+		charClass.negated = negated;
+		m_regex.m_classes.push_back(std::move(charClass));
+
+		Node node;
+		node.type = Node::Type::Class;
+		node.classIndex = m_regex.m_classes.size() - 1;
+		return AddNode(std::move(node));
+	}
+
+	size_t Emit(Opcode opcode)
+	{
+		if (m_regex.m_program.size() >= MAX_PROGRAM_SIZE)
+		{
+			throw std::invalid_argument("Regular expression is too large");
+		}
+
+		Instruction instruction;
+		instruction.opcode = opcode;
+		m_regex.m_program.push_back(instruction);
+		return m_regex.m_program.size() - 1;
+	}
+
+	void Compile(size_t nodeIndex)
+	{
+		// The node is copied, since compiling a child can add to m_nodes.
+		const Node node = m_nodes[nodeIndex];
+		auto &program = m_regex.m_program;
+
+		switch (node.type)
+		{
+		case Node::Type::Empty:
+			break;
+
+		case Node::Type::Char:
+		{
+			size_t index = Emit(Opcode::Char);
+			program[index].ch = node.ch;
+		}
+		break;
+
+		case Node::Type::Any:
+			Emit(Opcode::Any);
+			break;
+
+		case Node::Type::Class:
+		{
+			size_t index = Emit(Opcode::Class);
+			program[index].x = node.classIndex;
+		}
+		break;
+
+		case Node::Type::Begin:
+			Emit(Opcode::AssertBegin);
+			break;
+
+		case Node::Type::End:
+			Emit(Opcode::AssertEnd);
+			break;
+
+		case Node::Type::WordBoundary:
+			Emit(Opcode::AssertWordBoundary);
+			break;
+
+		case Node::Type::NotWordBoundary:
+			Emit(Opcode::AssertNotWordBoundary);
+			break;
+
+		case Node::Type::Concatenation:
+			for (size_t child : node.children)
+			{
+				Compile(child);
+			}
+			break;
+
+		case Node::Type::Alternation:
+			CompileAlternation(node);
+			break;
+
+		case Node::Type::Repetition:
+			CompileRepetition(node);
+			break;
+		}
+	}
+
+	void CompileAlternation(const Node &node)
+	{
+		auto &program = m_regex.m_program;
+		std::vector<size_t> jumps;
+
+		for (size_t i = 0; i < node.children.size(); i++)
+		{
+			if (i == node.children.size() - 1)
+			{
+				Compile(node.children[i]);
+				break;
+			}
+
+			size_t split = Emit(Opcode::Split);
+			program[split].x = split + 1;
+			Compile(node.children[i]);
+			jumps.push_back(Emit(Opcode::Jump));
+			program[split].y = program.size();
+		}
+
+		for (size_t jump : jumps)
+		{
+			program[jump].x = program.size();
+		}
+	}
+
+	void CompileRepetition(const Node &node)
+	{
+		auto &program = m_regex.m_program;
+		size_t child = node.children[0];
+
+		for (int i = 0; i < node.min; i++)
+		{
+			Compile(child);
+		}
+
+		if (node.max == REPEAT_UNBOUNDED)
+		{
+			size_t split = Emit(Opcode::Split);
+			Compile(child);
+			size_t jump = Emit(Opcode::Jump);
+			program[jump].x = split;
+			SetSplitTargets(split, split + 1, program.size(), node.greedy);
+			return;
+		}
+
+		// Each optional repetition is nested within the previous one, so that a failure to match
+		// one repetition skips all of the remaining repetitions.
+		std::vector<size_t> splits;
+
+		for (int i = node.min; i < node.max; i++)
+		{
+			splits.push_back(Emit(Opcode::Split));
+			Compile(child);
+		}
+
+		for (size_t split : splits)
+		{
+			SetSplitTargets(split, split + 1, program.size(), node.greedy);
+		}
+	}
+
+	void SetSplitTargets(size_t split, size_t body, size_t out, bool greedy)
+	{
+		auto &instruction = m_regex.m_program[split];
+		instruction.x = greedy ? body : out;
+		instruction.y = greedy ? out : body;
+	}
+
+	Regex &m_regex;
+	const std::wstring_view m_pattern;
+	size_t m_position = 0;
+	std::vector<Node> m_nodes;
+};
+
+Regex::Regex(std::wstring_view pattern, bool caseInsensitive) : m_caseInsensitive(caseInsensitive)
+{
+	Parser parser(*this, pattern);
+	parser.Parse();
+}
+
+bool Regex::Matches(std::wstring_view str) const
+{
+	std::wstring buffer;
+	return Run(FoldCase(str, buffer), 0, true).has_value();
+}
+
+std::optional<Regex::Match> Regex::Search(std::wstring_view str, size_t start) const
+{
+	std::wstring buffer;
+	return Run(FoldCase(str, buffer), start, false);
+}
+
+std::wstring Regex::ReplaceAll(std::wstring_view str, std::wstring_view replacement) const
+{
+	std::wstring buffer;
+	std::wstring_view foldedStr = FoldCase(str, buffer);
+
+	std::wstring result;
+	size_t position = 0;
+
+	while (position <= str.size())
+	{
+		auto match = Run(foldedStr, position, false);
+
+		if (!match)
+		{
+			break;
+		}
+
+		result.append(str.substr(position, match->position - position));
+		result.append(replacement);
+		position = match->position + match->length;
+
+		// An empty match would otherwise be found again at the same position.
+		if (match->length == 0)
+		{
+			if (position < str.size())
+			{
+				result.push_back(str[position]);
+			}
+
+			position++;
+		}
+	}
+
+	if (position < str.size())
+	{
+		result.append(str.substr(position));
+	}
+
+	return result;
+}
+
+std::wstring_view Regex::FoldCase(std::wstring_view str, std::wstring &buffer) const
+{
+	if (!m_caseInsensitive || str.empty())
+	{
+		return str;
+	}
+
+	// LCMAP_LOWERCASE maps each character individually, so positions within the folded string
+	// correspond to positions within the original string.
+	buffer.resize(str.size());
+	int res = LCMapString(LOCALE_USER_DEFAULT, LCMAP_LOWERCASE, str.data(),
+		static_cast<int>(str.size()), buffer.data(), static_cast<int>(buffer.size()));
+
+	if (res != static_cast<int>(str.size()))
+	{
+		return str;
+	}
+
+	return buffer;
+}
+
+std::optional<Regex::Match> Regex::Run(std::wstring_view str, size_t start, bool fullMatch) const
+{
+	std::vector<Thread> currentThreads;
+	std::vector<Thread> nextThreads;
+	currentThreads.reserve(m_program.size());
+	nextThreads.reserve(m_program.size());
+
+	std::vector<size_t> marks(m_program.size(), 0);
+	std::vector<size_t> stack;
+
+	std::optional<Match> match;
+
+	for (size_t position = start;; position++)
+	{
+		// Until a match has been found, a new thread is started at each position. It has a lower
+		// priority than any existing thread, since those threads started earlier.
+		if (!match && (!fullMatch || position == start))
+		{
+			AddThread(currentThreads, marks, stack, 0, position, str, position);
+		}
+
+		if (currentThreads.empty())
+		{
+			if (match || fullMatch || position >= str.size())
+			{
+				break;
+			}
+
+			continue;
+		}
+
+		for (const auto &thread : currentThreads)
+		{
+			const auto &instruction = m_program[thread.pc];
+			bool advance = false;
+
+			if (instruction.opcode == Opcode::Match)
+			{
+				if (fullMatch)
+				{
+					if (position == str.size())
+					{
+						return Match{ thread.start, position - thread.start };
+					}
+
+					continue;
+				}
+
+				// Any remaining threads have a lower priority than this one, so can be
+				// discarded.
+				match = Match{ thread.start, position - thread.start };
+				break;
+			}
+
+			if (position < str.size())
+			{
+				wchar_t ch = str[position];
+
+				switch (instruction.opcode)
+				{
+				case Opcode::Char:
+					advance = (ch == instruction.ch);
+					break;
+
+				case Opcode::Any:
+					advance = !IsLineTerminator(ch);
+					break;
+
+				case Opcode::Class:
+					advance = ClassMatches(m_classes[instruction.x], ch);
+					break;
+
+				default:
+					break;
+				}
+			}
+
+			if (advance)
+			{
+				AddThread(
+					nextThreads, marks, stack, thread.pc + 1, thread.start, str, position + 1);
+			}
+		}
+
+		std::swap(currentThreads, nextThreads);
+		nextThreads.clear();
+
+		if (position >= str.size())
+		{
+			break;
+		}
+	}
+
+	if (fullMatch)
+	{
+		return std::nullopt;
+	}
+
+	return match;
+}
+
+// Adds the thread, following any jumps, splits and assertions, so that only instructions that
+// consume a character (or indicate a match) end up in the list. Each instruction is only added
+// once per position, which is what bounds the amount of work done at each position.
+void Regex::AddThread(std::vector<Thread> &threads, std::vector<size_t> &marks,
+	std::vector<size_t> &stack, size_t pc, size_t threadStart, std::wstring_view str,
+	size_t position) const
+{
+	size_t generation = position + 1;
+	stack.push_back(pc);
+
+	while (!stack.empty())
+	{
+		size_t currentPc = stack.back();
+		stack.pop_back();
+
+		if (marks[currentPc] == generation)
+		{
+			continue;
+		}
+
+		marks[currentPc] = generation;
+
+		const auto &instruction = m_program[currentPc];
+
+		switch (instruction.opcode)
+		{
+		case Opcode::Jump:
+			stack.push_back(instruction.x);
+			break;
+
+		case Opcode::Split:
+			// The preferred target is pushed last, so that it's processed first.
+			stack.push_back(instruction.y);
+			stack.push_back(instruction.x);
+			break;
+
+		case Opcode::AssertBegin:
+			if (position == 0)
+			{
+				stack.push_back(currentPc + 1);
+			}
+			break;
+
+		case Opcode::AssertEnd:
+			if (position == str.size())
+			{
+				stack.push_back(currentPc + 1);
+			}
+			break;
+
+		case Opcode::AssertWordBoundary:
+		case Opcode::AssertNotWordBoundary:
+		{
+			bool wordBefore = position > 0 && IsWordChar(str[position - 1]);
+			bool wordAfter = position < str.size() && IsWordChar(str[position]);
+			bool boundary = (wordBefore != wordAfter);
+
+			if (boundary == (instruction.opcode == Opcode::AssertWordBoundary))
+			{
+				stack.push_back(currentPc + 1);
+			}
+		}
+		break;
+
+		default:
+			threads.push_back({ currentPc, threadStart });
+			break;
+		}
+	}
+}
+
+bool Regex::ClassMatches(const CharClass &charClass, wchar_t ch) const
+{
+	auto inRanges = [&charClass](wchar_t value) {
+		auto itr = std::upper_bound(charClass.ranges.begin(), charClass.ranges.end(), value,
+			[](wchar_t c, const CharRange &range) { return c < range.first; });
+
+		return itr != charClass.ranges.begin() && value <= std::prev(itr)->last;
+	};
+
+	bool matches = inRanges(ch);
+
+	// The input has been lowercased, but the class may only contain the uppercase form (e.g.
+	// [A-Z]).
+	if (!matches && m_caseInsensitive)
+	{
+		matches = inRanges(MapChar(ch, LCMAP_UPPERCASE));
+	}
+
+	return matches != charClass.negated;
+}
\ No newline at end of file
@@ -0,0 +1,103 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A regular expression that's matched in time linear in the length of the input (and the size of
+// the pattern). That's unlike std::regex, which backtracks, so can take exponential time and can
+// overflow the stack on long strings.
+//
+// The syntax is the commonly used subset of ECMAScript (the std::regex default): literals, '.',
+// character classes (including \d, \w and \s), '^', '$', \b, alternation, groups and the *, +, ?
+// and {m,n} quantifiers (greedy and lazy). Backreferences and lookaheads can't be matched in linear
+// time and aren't supported.
+//
+// Once constructed, an instance is immutable, so it can be shared between threads.
+class Regex
+{
+public:
+	struct Match
+	{
+		size_t position;
+		size_t length;
+	};
+
+	// Throws std::invalid_argument if the pattern is invalid or uses unsupported syntax.
+	Regex(std::wstring_view pattern, bool caseInsensitive = false);
+
+	// Returns true if the entire string matches.
+	bool Matches(std::wstring_view str) const;
+
+	// Finds the leftmost match that starts at or after the specified position. As with
+	// std::regex_search, alternatives and quantifiers are preferred in the order they appear.
+	std::optional<Match> Search(std::wstring_view str, size_t start = 0) const;
+
+	// Replaces each non-overlapping match.
+	std::wstring ReplaceAll(std::wstring_view str, std::wstring_view replacement) const;
+
+private:
+	struct CharRange
+	{
+		wchar_t first;
+		wchar_t last;
+	};
+
+	struct CharClass
+	{
+		// Sorted and non-overlapping.
+		std::vector<CharRange> ranges;
+		bool negated = false;
+	};
+
+	enum class Opcode
+	{
+		Char,
+		Any,
+		Class,
+		Split,
+		Jump,
+		AssertBegin,
+		AssertEnd,
+		AssertWordBoundary,
+		AssertNotWordBoundary,
+		Match
+	};
+
+	struct Instruction
+	{
+		Opcode opcode;
+		wchar_t ch = 0;
+
+		// For Class, the index of the class. For Jump, the target. For Split, the preferred target.
+		size_t x = 0;
+
+		// For Split, the other target.
+		size_t y = 0;
+	};
+
+	struct Thread
+	{
+		size_t pc;
+		size_t start;
+	};
+
+	class Parser;
+	friend Parser;
+
+	std::wstring_view FoldCase(std::wstring_view str, std::wstring &buffer) const;
+	std::optional<Match> Run(std::wstring_view str, size_t start, bool fullMatch) const;
+	void AddThread(std::vector<Thread> &threads, std::vector<size_t> &marks,
+		std::vector<size_t> &stack, size_t pc, size_t threadStart, std::wstring_view str,
+		size_t position) const;
+	bool ClassMatches(const CharClass &charClass, wchar_t ch) const;
+
+	bool m_caseInsensitive;
+	std::vector<Instruction> m_program;
+	std::vector<CharClass> m_classes;
+};
\ No newline at end of file
@@ -5,9 +5,21 @@
 #include "stdafx.h"
 #include "RegistrySettings.h"
 #include "Macros.h"
+#include "RegistryValueCache.h"
 #include <list>
 #include <string>
 
+LONG RegistrySettings::QueryValue(
+	HKEY hKey, const TCHAR *valueName, DWORD *type, BYTE *data, DWORD *dataSize)
+{
+	if (const auto *cache = RegistryValueCache::FindForKey(hKey))
+	{
+		return cache->QueryValue(valueName, type, data, dataSize);
+	}
+
+	return RegQueryValueEx(hKey, valueName, nullptr, type, data, dataSize);
+}
+
 LONG RegistrySettings::SaveDword(HKEY hKey, const TCHAR *valueName, DWORD dwValue)
 {
 	return RegSetValueEx(
@@ -18,8 +30,7 @@ LONG RegistrySettings::ReadDword(HKEY hKey, const TCHAR *valueName, DWORD *pRetu
 {
 	DWORD dwSize = sizeof(DWORD);
 
-	return RegQueryValueEx(
-		hKey, valueName, nullptr, nullptr, reinterpret_cast<LPBYTE>(pReturnValue), &dwSize);
+	return QueryValue(hKey, valueName, nullptr, reinterpret_cast<LPBYTE>(pReturnValue), &dwSize);
 }
 
 LONG RegistrySettings::SaveString(HKEY hKey, const TCHAR *valueName, const TCHAR *szValue)
@@ -36,8 +47,8 @@ LONG RegistrySettings::ReadString(HKEY hKey, const TCHAR *valueName, TCHAR *szOu
 	DWORD dwBufChSize;
 
 	dwBufByteSize = cchMax * sizeof(TCHAR);
-	lRes = RegQueryValueEx(
-		hKey, valueName, nullptr, &dwType, reinterpret_cast<LPBYTE>(szOutput), &dwBufByteSize);
+	lRes = QueryValue(
+		hKey, valueName, &dwType, reinterpret_cast<LPBYTE>(szOutput), &dwBufByteSize);
 	dwBufChSize = dwBufByteSize / sizeof(TCHAR);
 
 	/* The returned buffer size includes any terminating
@@ -10,6 +10,10 @@
 
 namespace RegistrySettings
 {
+	// Equivalent to RegQueryValueEx(), except that the value will be read from memory if a
+	// RegistryValueCache exists for the key. All of the read functions below go through this.
+	LONG QueryValue(HKEY hKey, const TCHAR *valueName, DWORD *type, BYTE *data, DWORD *dataSize);
+
 	LONG SaveDword(HKEY hKey, const TCHAR *valueName, DWORD dwValue);
 	LONG ReadDword(HKEY hKey, const TCHAR *valueName, DWORD *pReturnValue);
 	LONG SaveString(HKEY hKey, const TCHAR *valueName, const TCHAR *szValue);
@@ -0,0 +1,136 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "RegistryValueCache.h"
+#include <algorithm>
+
+namespace
+{
+
+// The caches that currently exist on this thread. Settings are loaded a key at a time, so there
+// will typically only be one or two of these at any point.
+thread_local std::vector<const RegistryValueCache *> g_activeCaches;
+
+}
+
+RegistryValueCache::RegistryValueCache(HKEY key) : m_key(key)
+{
+	// If the key can't be read in full, the cache isn't registered, so that reads go directly to
+	// the registry instead.
+	if (ReadValues())
+	{
+		g_activeCaches.push_back(this);
+	}
+}
+
+RegistryValueCache::~RegistryValueCache()
+{
+	std::erase(g_activeCaches, this);
+}
+
+const RegistryValueCache *RegistryValueCache::FindForKey(HKEY key)
+{
+	auto itr = std::find_if(g_activeCaches.rbegin(), g_activeCaches.rend(),
+		[key](const RegistryValueCache *cache) { return cache->m_key == key; });
+
+	if (itr == g_activeCaches.rend())
+	{
+		return nullptr;
+	}
+
+	return *itr;
+}
+
+bool RegistryValueCache::ReadValues()
+{
+	DWORD numValues;
+	DWORD maxValueNameLength;
+	DWORD maxValueSize;
+	LONG res = RegQueryInfoKey(m_key, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+		&numValues, &maxValueNameLength, &maxValueSize, nullptr, nullptr);
+
+	if (res != ERROR_SUCCESS)
+	{
+		return false;
+	}
+
+	m_values.reserve(numValues);
+
+	std::vector<TCHAR> valueName(maxValueNameLength + 1);
+	std::vector<BYTE> data(maxValueSize);
+
+	for (DWORD i = 0; i < numValues; i++)
+	{
+		auto valueNameLength = static_cast<DWORD>(valueName.size());
+		auto dataSize = static_cast<DWORD>(data.size());
+		DWORD type;
+		res = RegEnumValue(
+			m_key, i, valueName.data(), &valueNameLength, nullptr, &type, data.data(), &dataSize);
+
+		// The key may have been modified since it was queried above, in which case the cache can't
+		// be relied on.
+		if (res != ERROR_SUCCESS)
+		{
+			return false;
+		}
+
+		m_values[GetLookupName(std::wstring(valueName.data(), valueNameLength))] = { type,
+			std::vector<BYTE>(data.begin(), data.begin() + dataSize) };
+	}
+
+	return true;
+}
+
+LONG RegistryValueCache::QueryValue(
+	const TCHAR *valueName, DWORD *type, BYTE *data, DWORD *dataSize) const
+{
+	auto itr = m_values.find(GetLookupName(valueName ? valueName : L""));
+
+	if (itr == m_values.end())
+	{
+		return ERROR_FILE_NOT_FOUND;
+	}
+
+	const Value &value = itr->second;
+	auto valueSize = static_cast<DWORD>(value.data.size());
+
+	if (type)
+	{
+		*type = value.type;
+	}
+
+	if (!dataSize)
+	{
+		return data ? ERROR_INVALID_PARAMETER : ERROR_SUCCESS;
+	}
+
+	if (data && *dataSize < valueSize)
+	{
+		*dataSize = valueSize;
+		return ERROR_MORE_DATA;
+	}
+
+	if (data)
+	{
+		std::copy(value.data.begin(), value.data.end(), data);
+	}
+
+	*dataSize = valueSize;
+
+	return ERROR_SUCCESS;
+}
+
+size_t RegistryValueCache::GetNumValues() const
+{
+	return m_values.size();
+}
+
+std::wstring RegistryValueCache::GetLookupName(const std::wstring &valueName)
+{
+	std::wstring lookupName = valueName;
+	CharLowerBuff(lookupName.data(), static_cast<DWORD>(lookupName.size()));
+
+	return lookupName;
+}
\ No newline at end of file
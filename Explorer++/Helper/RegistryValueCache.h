@@ -0,0 +1,53 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "Macros.h"
+#include <windows.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Reads every value stored directly within a registry key, by enumerating the key once. While an
+// instance exists, the RegistrySettings read functions serve values from the key out of memory,
+// rather than querying the registry separately for each value. In particular, values that don't
+// exist (which is the case for most settings that have never been changed) no longer require a
+// registry call at all.
+//
+// Caches are looked up by key handle and are only visible on the thread that created them, so an
+// instance should be created on the stack while the key is open and destroyed before the key is
+// closed. Values written while a cache exists aren't reflected in the cache, so it should only be
+// used when loading settings.
+class RegistryValueCache
+{
+public:
+	explicit RegistryValueCache(HKEY key);
+	~RegistryValueCache();
+
+	// Returns the cache for the key, if one exists on the current thread.
+	static const RegistryValueCache *FindForKey(HKEY key);
+
+	// Behaves in the same way as RegQueryValueEx().
+	LONG QueryValue(const TCHAR *valueName, DWORD *type, BYTE *data, DWORD *dataSize) const;
+
+	size_t GetNumValues() const;
+
+private:
+	DISALLOW_COPY_AND_ASSIGN(RegistryValueCache);
+
+	struct Value
+	{
+		DWORD type;
+		std::vector<BYTE> data;
+	};
+
+	bool ReadValues();
+	static std::wstring GetLookupName(const std::wstring &valueName);
+
+	const HKEY m_key;
+
+	// Keyed by the lowercased value name, since value names aren't case sensitive.
+	std::unordered_map<std::wstring, Value> m_values;
+};
\ No newline at end of file
@@ -0,0 +1,121 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <mutex>
+
+// A queue that any number of background threads push results to and a single (UI) thread
+// processes them from. Rather than each result being delivered with its own window message, the
+// notification callback is only invoked when the channel goes from idle to having results
+// available. The consumer then processes every result that's available in one go, which keeps the
+// message queue from filling up when many results arrive at once and allows the consumer to apply
+// the results as a batch.
+//
+// Processing is limited by a time budget. If results remain once the budget has been used,
+// ProcessResults() returns true and the channel stays in the notified state (so the callback isn't
+// invoked again); the consumer is responsible for calling ProcessResults() again later (e.g. from a
+// timer, so that any pending input is handled first).
+template <typename T>
+class ResultChannel
+{
+public:
+	using NotificationCallback = std::function<void()>;
+
+	explicit ResultChannel(NotificationCallback notificationCallback) :
+		m_notificationCallback(std::move(notificationCallback))
+	{
+	}
+
+	ResultChannel(const ResultChannel &) = delete;
+	ResultChannel &operator=(const ResultChannel &) = delete;
+
+	// Can be called from any thread. The notification callback is invoked on the calling thread.
+	void Push(T result)
+	{
+		bool notify = false;
+
+		{
+			std::scoped_lock lock(m_mutex);
+
+			m_results.push_back(std::move(result));
+
+			if (!m_notified)
+			{
+				m_notified = true;
+				notify = true;
+			}
+		}
+
+		if (notify)
+		{
+			m_notificationCallback();
+		}
+	}
+
+	// Processes results, in the order in which they were pushed, until either there are none left
+	// or the time budget has been used. At least one result is always processed, if one is
+	// available. Returns true if there are results remaining.
+	template <typename Function>
+	bool ProcessResults(std::chrono::steady_clock::duration timeBudget, Function &&processResult)
+	{
+		auto deadline = std::chrono::steady_clock::now() + timeBudget;
+		std::deque<T> results;
+
+		{
+			std::scoped_lock lock(m_mutex);
+			results.swap(m_results);
+		}
+
+		while (!results.empty())
+		{
+			processResult(results.front());
+			results.pop_front();
+
+			if (std::chrono::steady_clock::now() >= deadline)
+			{
+				break;
+			}
+		}
+
+		std::scoped_lock lock(m_mutex);
+
+		if (!results.empty())
+		{
+			// The remaining results go back ahead of any that were pushed in the meantime.
+			results.insert(results.end(), std::make_move_iterator(m_results.begin()),
+				std::make_move_iterator(m_results.end()));
+			m_results.swap(results);
+		}
+
+		if (!m_results.empty())
+		{
+			return true;
+		}
+
+		m_notified = false;
+		return false;
+	}
+
+	// Discards any results that haven't been processed yet. Results pushed after this call (e.g.
+	// by tasks that were already running) will still be delivered, so the consumer should be able
+	// to recognize and ignore them.
+	void Clear()
+	{
+		std::scoped_lock lock(m_mutex);
+		m_results.clear();
+		m_notified = false;
+	}
+
+private:
+	const NotificationCallback m_notificationCallback;
+
+	std::mutex m_mutex;
+	std::deque<T> m_results;
+	bool m_notified = false;
+};
\ No newline at end of file
@@ -0,0 +1,33 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "SectionChangeTracker.h"
+
+bool SectionChangeTracker::HasChanged(
+	const std::wstring &section, std::wstring_view contents) const
+{
+	std::scoped_lock lock(m_mutex);
+
+	auto itr = m_savedHashes.find(section);
+
+	if (itr == m_savedHashes.end())
+	{
+		return true;
+	}
+
+	return itr->second != std::hash<std::wstring_view>{}(contents);
+}
+
+void SectionChangeTracker::MarkSaved(const std::wstring &section, std::wstring_view contents)
+{
+	std::scoped_lock lock(m_mutex);
+	m_savedHashes[section] = std::hash<std::wstring_view>{}(contents);
+}
+
+void SectionChangeTracker::Reset()
+{
+	std::scoped_lock lock(m_mutex);
+	m_savedHashes.clear();
+}
\ No newline at end of file
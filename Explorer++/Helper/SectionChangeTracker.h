@@ -0,0 +1,27 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Tracks the contents of a set of named sections (e.g. the sections within a settings file), so
+// that it's possible to determine which of them have changed since they were last saved. Only a
+// hash of each section is retained. Can be used from multiple threads.
+class SectionChangeTracker
+{
+public:
+	bool HasChanged(const std::wstring &section, std::wstring_view contents) const;
+	void MarkSaved(const std::wstring &section, std::wstring_view contents);
+
+	// Causes every section to be treated as changed, until it's next marked as saved.
+	void Reset();
+
+private:
+	mutable std::mutex m_mutex;
+	std::unordered_map<std::wstring, size_t> m_savedHashes;
+};
\ No newline at end of file
@@ -0,0 +1,57 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "SharedPidl.h"
+
+SharedPidl::SharedPidl(PCIDLIST_ABSOLUTE pidl) :
+	SharedPidl(unique_pidl_absolute(pidl ? ILCloneFull(pidl) : nullptr))
+{
+}
+
+SharedPidl::SharedPidl(unique_pidl_absolute pidl)
+{
+	if (pidl)
+	{
+		m_pidl = std::make_shared<const unique_pidl_absolute>(std::move(pidl));
+	}
+}
+
+PCIDLIST_ABSOLUTE SharedPidl::get() const
+{
+	if (!m_pidl)
+	{
+		return nullptr;
+	}
+
+	return m_pidl->get();
+}
+
+unique_pidl_absolute SharedPidl::Clone() const
+{
+	if (!m_pidl)
+	{
+		return nullptr;
+	}
+
+	return unique_pidl_absolute(ILCloneFull(m_pidl->get()));
+}
+
+SharedPidl::operator bool() const
+{
+	return m_pidl != nullptr;
+}
+
+std::vector<PCIDLIST_ABSOLUTE> ShallowCopyPidls(const std::vector<SharedPidl> &pidls)
+{
+	std::vector<PCIDLIST_ABSOLUTE> rawPidls;
+	rawPidls.reserve(pidls.size());
+
+	for (const auto &pidl : pidls)
+	{
+		rawPidls.push_back(pidl.get());
+	}
+
+	return rawPidls;
+}
\ No newline at end of file
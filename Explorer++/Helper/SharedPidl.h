@@ -0,0 +1,36 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "ShellHelper.h"
+#include <memory>
+#include <vector>
+
+// An immutable, reference counted absolute PIDL. Copying an instance only adds a reference, so a
+// PIDL can be returned from an accessor, or held by a caller, without having to be cloned. The
+// reference count is thread-safe, so instances can also be passed to background tasks.
+//
+// PIDLs that are retained in large numbers for a long time (e.g. the history of closed tabs) can
+// instead be stored in a SharedPidlStore, which shares the storage for common prefixes.
+class SharedPidl
+{
+public:
+	SharedPidl() = default;
+	explicit SharedPidl(PCIDLIST_ABSOLUTE pidl);
+	SharedPidl(unique_pidl_absolute pidl);
+
+	PCIDLIST_ABSOLUTE get() const;
+
+	// Returns a copy of the PIDL that the caller owns. Only needed when the PIDL is passed to
+	// something that takes ownership of it.
+	unique_pidl_absolute Clone() const;
+
+	explicit operator bool() const;
+
+private:
+	std::shared_ptr<const unique_pidl_absolute> m_pidl;
+};
+
+std::vector<PCIDLIST_ABSOLUTE> ShallowCopyPidls(const std::vector<SharedPidl> &pidls);
\ No newline at end of file
@@ -0,0 +1,140 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "SharedPidlStore.h"
+#include <unordered_set>
+
+SharedPidlStore::SharedPidlStore() : m_root(std::make_shared<Node>())
+{
+}
+
+SharedPidlStore::Handle SharedPidlStore::Intern(PCIDLIST_ABSOLUTE pidl)
+{
+	Handle node = m_root;
+
+	for (PCUIDLIST_RELATIVE child = pidl; !ILIsEmpty(child); child = ILNext(child))
+	{
+		node = GetOrCreateChild(node,
+			std::span(reinterpret_cast<const BYTE *>(&child->mkid), child->mkid.cb));
+	}
+
+	return node;
+}
+
+SharedPidlStore::Handle SharedPidlStore::GetRoot() const
+{
+	return m_root;
+}
+
+SharedPidlStore::Handle SharedPidlStore::GetOrCreateChild(
+	const Handle &parent, std::span<const BYTE> itemId)
+{
+	// The item ID must consist of at least the size field and that field must match the size of the
+	// data, otherwise the materialized PIDL wouldn't be valid.
+	if (itemId.size() <= sizeof(USHORT))
+	{
+		return nullptr;
+	}
+
+	USHORT size;
+	memcpy(&size, itemId.data(), sizeof(size));
+
+	if (size != itemId.size())
+	{
+		return nullptr;
+	}
+
+	// Nodes are only ever created by this class and are only exposed as const to callers, so
+	// casting away the constness here is safe.
+	auto mutableParent = std::const_pointer_cast<Node>(parent);
+	std::shared_ptr<Node> existingChild;
+
+	// Children that are no longer referenced are removed here, so that the list of children doesn't
+	// grow indefinitely.
+	std::erase_if(mutableParent->children, [&itemId, &existingChild](const auto &weakChild) {
+		auto child = weakChild.lock();
+
+		if (!child)
+		{
+			return true;
+		}
+
+		if (!existingChild && std::ranges::equal(child->itemId, itemId))
+		{
+			existingChild = child;
+		}
+
+		return false;
+	});
+
+	if (existingChild)
+	{
+		return existingChild;
+	}
+
+	auto child = std::make_shared<Node>();
+	child->parent = mutableParent;
+	child->itemId.assign(itemId.begin(), itemId.end());
+	mutableParent->children.push_back(child);
+
+	return child;
+}
+
+unique_pidl_absolute SharedPidlStore::Materialize(const Handle &handle)
+{
+	std::vector<const Node *> chain;
+	size_t totalSize = sizeof(USHORT);
+
+	for (const Node *node = handle.get(); node && node->parent; node = node->parent.get())
+	{
+		chain.push_back(node);
+		totalSize += node->itemId.size();
+	}
+
+	auto *data = static_cast<BYTE *>(CoTaskMemAlloc(totalSize));
+
+	if (!data)
+	{
+		return nullptr;
+	}
+
+	BYTE *current = data;
+
+	for (auto itr = chain.rbegin(); itr != chain.rend(); ++itr)
+	{
+		std::copy((*itr)->itemId.begin(), (*itr)->itemId.end(), current);
+		current += (*itr)->itemId.size();
+	}
+
+	// The terminating item ID.
+	memset(current, 0, sizeof(USHORT));
+
+	return unique_pidl_absolute(reinterpret_cast<PIDLIST_ABSOLUTE>(data));
+}
+
+size_t SharedPidlStore::CalculateMemoryUsage(const std::vector<Handle> &handles)
+{
+	std::unordered_set<const Node *> visitedNodes;
+	size_t memoryUsage = 0;
+
+	for (const auto &handle : handles)
+	{
+		for (const Node *node = handle.get(); node; node = node->parent.get())
+		{
+			auto [itr, inserted] = visitedNodes.insert(node);
+
+			if (!inserted)
+			{
+				// The rest of the chain has already been counted.
+				break;
+			}
+
+			memoryUsage += sizeof(Node) + node->itemId.capacity()
+				+ (node->children.capacity() * sizeof(std::weak_ptr<Node>));
+		}
+	}
+
+	return memoryUsage;
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "ShellHelper.h"
+#include <memory>
+#include <span>
+#include <vector>
+
+// Stores absolute PIDLs as chains of item IDs, with each item ID stored once per parent. PIDLs that
+// share a prefix (e.g. those for items within the same folder) therefore share the storage for that
+// prefix. Interning the same PIDL twice returns the same handle.
+//
+// Nodes are reference counted and are freed once there are no handles left that refer to them (or
+// to any of their children). This class isn't thread-safe.
+class SharedPidlStore
+{
+public:
+	struct Node
+	{
+		// Null for the root node, which represents the desktop.
+		std::shared_ptr<Node> parent;
+
+		// A single SHITEMID, including its size prefix. Empty for the root node.
+		std::vector<BYTE> itemId;
+
+		std::vector<std::weak_ptr<Node>> children;
+	};
+
+	using Handle = std::shared_ptr<const Node>;
+
+	SharedPidlStore();
+
+	Handle Intern(PCIDLIST_ABSOLUTE pidl);
+	Handle GetRoot() const;
+
+	// Returns the child of the specified node with the given item ID, creating it if necessary.
+	// Returns null if the item ID isn't valid.
+	Handle GetOrCreateChild(const Handle &parent, std::span<const BYTE> itemId);
+
+	static unique_pidl_absolute Materialize(const Handle &handle);
+
+	// Returns the approximate number of bytes used by the nodes the handles refer to. Each node is
+	// only counted once, regardless of how many handles share it.
+	static size_t CalculateMemoryUsage(const std::vector<Handle> &handles);
+
+private:
+	std::shared_ptr<Node> m_root;
+};
\ No newline at end of file
@@ -22,6 +22,16 @@ HWND ShellDropTargetWindow<DropTargetItemIdentifierType>::GetHWND() const
 	return m_hwnd;
 }
 
+template <typename DropTargetItemIdentifierType>
+void ShellDropTargetWindow<DropTargetItemIdentifierType>::ResetWindow(HWND hwnd)
+{
+	ResetDropState();
+
+	m_hwnd = hwnd;
+	m_dropTargetWindow =
+		winrt::make_self<DropTargetWindow>(hwnd, static_cast<DropTargetInternal *>(this));
+}
+
 template <typename DropTargetItemIdentifierType>
 DWORD ShellDropTargetWindow<DropTargetItemIdentifierType>::DragEnter(
 	IDataObject *dataObject, DWORD keyState, POINT pt, DWORD effect)
@@ -219,6 +229,18 @@ DWORD ShellDropTargetWindow<DropTargetItemIdentifierType>::PerformDrop(
 	}
 
 	DWORD targetEffect;
+
+	if (m_dropType == DropType::LeftClick
+		&& PerformInternalDrop(targetItem, dataObject, keyState, allowedEffects, targetEffect))
+	{
+		if (dropTargetInfo.dropTargetInitialised)
+		{
+			dropTargetInfo.dropTarget->DragLeave();
+		}
+
+		return targetEffect;
+	}
+
 	HRESULT hr;
 
 	if (!dropTargetInfo.dropTargetInitialised)
@@ -250,6 +272,20 @@ DWORD ShellDropTargetWindow<DropTargetItemIdentifierType>::PerformDrop(
 	return targetEffect;
 }
 
+template <typename DropTargetItemIdentifierType>
+bool ShellDropTargetWindow<DropTargetItemIdentifierType>::PerformInternalDrop(
+	DropTargetItemIdentifierType targetItem, IDataObject *dataObject, DWORD keyState,
+	DWORD allowedEffects, DWORD &targetEffect)
+{
+	UNREFERENCED_PARAMETER(targetItem);
+	UNREFERENCED_PARAMETER(dataObject);
+	UNREFERENCED_PARAMETER(keyState);
+	UNREFERENCED_PARAMETER(allowedEffects);
+	UNREFERENCED_PARAMETER(targetEffect);
+
+	return false;
+}
+
 template <typename DropTargetItemIdentifierType>
 void ShellDropTargetWindow<DropTargetItemIdentifierType>::ResetDropState()
 {
@@ -23,7 +23,10 @@ protected:
 
 	wil::com_ptr_nothrow<IDropTarget> GetDropTargetForPidl(PCIDLIST_ABSOLUTE pidl);
 
-	const HWND m_hwnd;
+	// Should be called if the underlying window is destroyed and replaced with a new window.
+	void ResetWindow(HWND hwnd);
+
+	HWND m_hwnd;
 
 private:
 	enum class DropType
@@ -53,6 +56,12 @@ private:
 	virtual void UpdateUiForDrop(DropTargetItemIdentifierType targetItem, const POINT &pt) = 0;
 	virtual void ResetDropUiState() = 0;
 
+	// Allows a left-click drop to be performed directly, rather than by the shell drop target for
+	// the item (e.g. when the data object was created by this process). Returns true if the drop
+	// was performed, in which case targetEffect should be set to the effect of the drop.
+	virtual bool PerformInternalDrop(DropTargetItemIdentifierType targetItem,
+		IDataObject *dataObject, DWORD keyState, DWORD allowedEffects, DWORD &targetEffect);
+
 	DWORD OnDragInWindow(IDataObject *dataObject, DWORD keyState, POINT pt, DWORD effect);
 	DWORD GetDropEffect(DropTargetItemIdentifierType targetItem, IDataObject *dataObject,
 		DWORD keyState, POINT pt, DWORD allowedEffects);
@@ -124,6 +124,21 @@ HRESULT GetItemAttributes(PCIDLIST_ABSOLUTE pidl, SFGAOF *pItemAttributes)
 	return hr;
 }
 
+HRESULT GetItemAttributes(PCIDLIST_ABSOLUTE pidlParent, const std::vector<PCITEMID_CHILD> &children,
+	SFGAOF *pItemAttributes)
+{
+	if (pidlParent == nullptr || children.empty() || pItemAttributes == nullptr)
+	{
+		return E_FAIL;
+	}
+
+	wil::com_ptr_nothrow<IShellFolder> parent;
+	RETURN_IF_FAILED(BindToIdl(pidlParent, IID_PPV_ARGS(&parent)));
+
+	return parent->GetAttributesOf(
+		static_cast<UINT>(children.size()), children.data(), pItemAttributes);
+}
+
 BOOL ExecuteFileAction(HWND hwnd, const TCHAR *szVerb, const TCHAR *szParameters,
 	const TCHAR *szStartDirectory, LPCITEMIDLIST pidl)
 {
@@ -1313,10 +1328,9 @@ private:
 	}
 };
 
-// This performs the same function as SHSimpleIDListFromPath(), which is deprecated.
-// The path provided should be relative to the parent. If parent is null, the path should be
-// absolute.
-HRESULT CreateSimplePidl(const std::wstring &path, PIDLIST_ABSOLUTE *pidl, IShellFolder *parent)
+// Creates a bind context that causes a parsed filesystem item to take on the provided find data,
+// rather than the item being queried.
+static HRESULT CreateFileSystemBindCtx(const WIN32_FIND_DATA *wfd, IBindCtx **bindCtxOut)
 {
 	wil::com_ptr_nothrow<IBindCtx> bindCtx;
 	RETURN_IF_FAILED(CreateBindCtx(0, &bindCtx));
@@ -1324,13 +1338,27 @@ HRESULT CreateSimplePidl(const std::wstring &path, PIDLIST_ABSOLUTE *pidl, IShel
 	BIND_OPTS opts = { sizeof(opts), 0, STGM_CREATE, 0 };
 	RETURN_IF_FAILED(bindCtx->SetBindOptions(&opts));
 
-	WIN32_FIND_DATA wfd = {};
-	wfd.dwFileAttributes = FILE_ATTRIBUTE_NORMAL;
-	auto fsBindData = FileSystemBindData::Create(&wfd);
+	auto fsBindData = FileSystemBindData::Create(wfd);
 
 	RETURN_IF_FAILED(
 		bindCtx->RegisterObjectParam(const_cast<PWSTR>(STR_FILE_SYS_BIND_DATA), fsBindData.get()));
 
+	*bindCtxOut = bindCtx.detach();
+
+	return S_OK;
+}
+
+// This performs the same function as SHSimpleIDListFromPath(), which is deprecated.
+// The path provided should be relative to the parent. If parent is null, the path should be
+// absolute.
+HRESULT CreateSimplePidl(const std::wstring &path, PIDLIST_ABSOLUTE *pidl, IShellFolder *parent)
+{
+	WIN32_FIND_DATA wfd = {};
+	wfd.dwFileAttributes = FILE_ATTRIBUTE_NORMAL;
+
+	wil::com_ptr_nothrow<IBindCtx> bindCtx;
+	RETURN_IF_FAILED(CreateFileSystemBindCtx(&wfd, &bindCtx));
+
 	if (!parent)
 	{
 		return SHParseDisplayName(path.c_str(), bindCtx.get(), pidl, 0, nullptr);
@@ -1348,6 +1376,28 @@ HRESULT CreateSimplePidl(const std::wstring &path, PIDLIST_ABSOLUTE *pidl, IShel
 	return S_OK;
 }
 
+// Creates a child pidl for an item within a filesystem folder, using find data that's already
+// been retrieved for the item (e.g. by FindFirstFile()). Since the item isn't queried, this is
+// much cheaper than retrieving the pidl through the folder's enumerator.
+HRESULT CreateSimpleChildPidl(IShellFolder *parent, const WIN32_FIND_DATA &wfd, PITEMID_CHILD *pidl)
+{
+	wil::com_ptr_nothrow<IBindCtx> bindCtx;
+	RETURN_IF_FAILED(CreateFileSystemBindCtx(&wfd, &bindCtx));
+
+	unique_pidl_relative pidlRelative;
+	RETURN_IF_FAILED(parent->ParseDisplayName(nullptr, bindCtx.get(),
+		const_cast<LPWSTR>(wfd.cFileName), nullptr, wil::out_param(pidlRelative), nullptr));
+
+	if (!ILIsChild(pidlRelative.get()))
+	{
+		return E_UNEXPECTED;
+	}
+
+	*pidl = ILCloneChild(static_cast<PCITEMID_CHILD>(pidlRelative.get()));
+
+	return *pidl ? S_OK : E_OUTOFMEMORY;
+}
+
 // This performs the same function as SHGetRealIDL, which is deprecated.
 HRESULT SimplePidlToFullPidl(PCIDLIST_ABSOLUTE simplePidl, PIDLIST_ABSOLUTE *fullPidl)
 {
@@ -89,6 +89,11 @@ BOOL LoadContextMenuHandlers(const TCHAR *szRegKey,
 BOOL LoadIUnknownFromCLSID(const TCHAR *szCLSID, ContextMenuHandler *pContextMenuHandler);
 HRESULT GetItemAttributes(const TCHAR *szItemParsingPath, SFGAOF *pItemAttributes);
 HRESULT GetItemAttributes(PCIDLIST_ABSOLUTE pidl, SFGAOF *pItemAttributes);
+
+// Retrieves the attributes that are common to all of the specified children of the parent folder.
+// The parent is only bound to once and the attributes are requested in a single call.
+HRESULT GetItemAttributes(PCIDLIST_ABSOLUTE pidlParent, const std::vector<PCITEMID_CHILD> &children,
+	SFGAOF *pItemAttributes);
 BOOL ExecuteFileAction(HWND hwnd, const TCHAR *szVerb, const TCHAR *szParameters,
 	const TCHAR *szStartDirectory, LPCITEMIDLIST pidl);
 BOOL ExecuteAndShowCurrentProcess(HWND hwnd, const TCHAR *szParameters);
@@ -103,6 +108,8 @@ BOOL CompareVirtualFolders(const TCHAR *szDirectory, UINT uFolderCSIDL);
 bool IsChildOfLibrariesFolder(PCIDLIST_ABSOLUTE pidl);
 HRESULT CreateSimplePidl(
 	const std::wstring &path, PIDLIST_ABSOLUTE *pidl, IShellFolder *parent = nullptr);
+HRESULT CreateSimpleChildPidl(
+	IShellFolder *parent, const WIN32_FIND_DATA &wfd, PITEMID_CHILD *pidl);
 HRESULT SimplePidlToFullPidl(PCIDLIST_ABSOLUTE simplePidl, PIDLIST_ABSOLUTE *fullPidl);
 std::vector<unique_pidl_absolute> DeepCopyPidls(const std::vector<PCIDLIST_ABSOLUTE> &pidls);
 std::vector<unique_pidl_absolute> DeepCopyPidls(const std::vector<unique_pidl_absolute> &pidls);
@@ -4,12 +4,11 @@
 
 #include "stdafx.h"
 #include "StringHelper.h"
+#include "DisplayFormatter.h"
 #include "Macros.h"
+#include "WildcardMatcher.h"
 #include <codecvt>
 
-BOOL CheckWildcardMatchInternal(
-	const TCHAR *szWildcard, const TCHAR *szString, BOOL bCaseSensitive);
-
 void FormatSizeString(ULARGE_INTEGER lFileSize, TCHAR *pszFileSize, size_t cchBuf)
 {
 	FormatSizeString(lFileSize, pszFileSize, cchBuf, FALSE, SizeDisplayFormat::None);
@@ -18,102 +17,9 @@ void FormatSizeString(ULARGE_INTEGER lFileSize, TCHAR *pszFileSize, size_t cchBu
 void FormatSizeString(ULARGE_INTEGER lFileSize, TCHAR *pszFileSize, size_t cchBuf, BOOL bForceSize,
 	SizeDisplayFormat sdf)
 {
-	static const TCHAR *SIZE_STRINGS[] = { _T("bytes"), _T("KB"), _T("MB"), _T("GB"), _T("TB"),
-		_T("PB") };
-
-	auto fFileSize = static_cast<double>(lFileSize.QuadPart);
-	int iSizeIndex = 0;
-
-	if (bForceSize)
-	{
-		switch (sdf)
-		{
-		case SizeDisplayFormat::Bytes:
-			iSizeIndex = 0;
-			break;
-
-		case SizeDisplayFormat::KB:
-			iSizeIndex = 1;
-			break;
-
-		case SizeDisplayFormat::MB:
-			iSizeIndex = 2;
-			break;
-
-		case SizeDisplayFormat::GB:
-			iSizeIndex = 3;
-			break;
-
-		case SizeDisplayFormat::TB:
-			iSizeIndex = 4;
-			break;
-
-		case SizeDisplayFormat::PB:
-			iSizeIndex = 5;
-			break;
-		}
-
-		for (int i = 0; i < iSizeIndex; i++)
-		{
-			fFileSize /= 1024;
-		}
-	}
-	else
-	{
-		while ((fFileSize / 1024) >= 1)
-		{
-			fFileSize /= 1024;
-
-			iSizeIndex++;
-		}
-
-		if (iSizeIndex > (SIZEOF_ARRAY(SIZE_STRINGS) - 1))
-		{
-			StringCchCopy(pszFileSize, cchBuf, EMPTY_STRING);
-			return;
-		}
-	}
-
-	int iPrecision;
-
-	if (iSizeIndex == 0)
-	{
-		iPrecision = 0;
-	}
-	else
-	{
-		if (fFileSize < 10)
-		{
-			iPrecision = 2;
-		}
-		else if (fFileSize < 100)
-		{
-			iPrecision = 1;
-		}
-		else
-		{
-			iPrecision = 0;
-		}
-	}
-
-	int iLeast =
-		static_cast<int>((fFileSize - static_cast<int>(fFileSize)) * pow(10.0, iPrecision + 1));
-
-	/* Setting the precision will cause automatic rounding. Therefore,
-	if the least significant digit to be dropped is greater than 0.5,
-	reduce it to below 0.5. */
-	if (iLeast >= 5)
-	{
-		fFileSize -= 5.0 * pow(10.0, -(iPrecision + 1));
-	}
-
-	std::wstringstream ss;
-	ss.imbue(std::locale(""));
-	ss.precision(iPrecision);
-
-	ss << std::fixed << fFileSize << _T(" ") << SIZE_STRINGS[iSizeIndex];
-	std::wstring str = ss.str();
-	StringCchCopy(pszFileSize, cchBuf, str.c_str());
+	std::wstring formattedSize =
+		GetDisplayFormatter().FormatSize(lFileSize.QuadPart, bForceSize, sdf);
+	StringCchCopy(pszFileSize, cchBuf, formattedSize.c_str());
 }
 
 TCHAR *PrintComma(unsigned long nPrint)
@@ -161,138 +67,10 @@ TCHAR *PrintCommaLargeNum(LARGE_INTEGER lPrint)
 
 BOOL CheckWildcardMatch(const TCHAR *szWildcard, const TCHAR *szString, BOOL bCaseSensitive)
 {
-	/* Handles multiple wildcard patterns. If the wildcard pattern contains ':',
-	split the pattern into multiple subpatterns.
-	For example "*.h: *.cpp" would match against "*.h" and "*.cpp" */
-	BOOL bMultiplePattern = FALSE;
-
-	for (int i = 0; i < lstrlen(szWildcard); i++)
-	{
-		if (szWildcard[i] == ':')
-		{
-			bMultiplePattern = TRUE;
-			break;
-		}
-	}
-
-	if (!bMultiplePattern)
-	{
-		return CheckWildcardMatchInternal(szWildcard, szString, bCaseSensitive);
-	}
-	else
-	{
-		TCHAR szWildcardPattern[512];
-		TCHAR *szSinglePattern = nullptr;
-		TCHAR *szSearchPattern = nullptr;
-		TCHAR *szRemainingPattern = nullptr;
-
-		StringCchCopy(szWildcardPattern, SIZEOF_ARRAY(szWildcardPattern), szWildcard);
-
-		szSinglePattern = wcstok_s(szWildcardPattern, _T(":"), &szRemainingPattern);
-		PathRemoveBlanks(szSinglePattern);
-
-		while (szSinglePattern != nullptr)
-		{
-			if (CheckWildcardMatchInternal(szSinglePattern, szString, bCaseSensitive))
-			{
-				return TRUE;
-			}
-
-			szSearchPattern = szRemainingPattern;
-			szSinglePattern = wcstok_s(szSearchPattern, _T(":"), &szRemainingPattern);
-			PathRemoveBlanks(szSinglePattern);
-		}
-	}
-
-	return FALSE;
-}
-
-BOOL CheckWildcardMatchInternal(const TCHAR *szWildcard, const TCHAR *szString, BOOL bCaseSensitive)
-{
-	BOOL bMatched;
-	BOOL bCurrentMatch = TRUE;
-
-	while (*szWildcard != '\0' && *szString != '\0' && bCurrentMatch)
-	{
-		switch (*szWildcard)
-		{
-			/* Match against the next part of the wildcard string.
-			If there is a match, then return true, else consume
-			the next character, and check again. */
-		case '*':
-			bMatched = FALSE;
-
-			if (*(szWildcard + 1) != '\0')
-			{
-				bMatched = CheckWildcardMatch(++szWildcard, szString, bCaseSensitive);
-			}
-
-			while (*szWildcard != '\0' && *szString != '\0' && !bMatched)
-			{
-				/* Consume one more character on the input string,
-				and keep (recursively) trying to match. */
-				bMatched = CheckWildcardMatch(szWildcard, ++szString, bCaseSensitive);
-			}
-
-			if (bMatched)
-			{
-				while (*szWildcard != '\0')
-				{
-					szWildcard++;
-				}
-
-				szWildcard--;
-
-				while (*szString != '\0')
-				{
-					szString++;
-				}
-			}
-
-			bCurrentMatch = bMatched;
-			break;
-
-		case '?':
-			szString++;
-			break;
-
-		default:
-			if (bCaseSensitive)
-			{
-				bCurrentMatch = (*szWildcard == *szString);
-			}
-			else
-			{
-				TCHAR szCharacter1[1];
-				LCMapString(LOCALE_USER_DEFAULT, LCMAP_LOWERCASE, szWildcard, 1, szCharacter1,
-					SIZEOF_ARRAY(szCharacter1));
-
-				TCHAR szCharacter2[1];
-				LCMapString(LOCALE_USER_DEFAULT, LCMAP_LOWERCASE, szString, 1, szCharacter2,
-					SIZEOF_ARRAY(szCharacter2));
-
-				bCurrentMatch = (szCharacter1[0] == szCharacter2[0]);
-			}
-
-			szString++;
-			break;
-		}
-
-		szWildcard++;
-	}
-
-	/* Skip past any trailing wildcards. */
-	while (*szWildcard == '*')
-	{
-		szWildcard++;
-	}
-
-	if (*szWildcard == '\0' && *szString == '\0' && bCurrentMatch)
-	{
-		return TRUE;
-	}
-
-	return FALSE;
+	/* Callers that match the same pattern repeatedly should
+	create a WildcardMatcher once and reuse it instead. */
+	WildcardMatcher matcher(szWildcard, bCaseSensitive);
+	return matcher.Matches(szString);
 }
 
 void ReplaceCharacter(TCHAR *str, TCHAR ch, TCHAR chReplacement)
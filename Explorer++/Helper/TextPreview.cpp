@@ -0,0 +1,268 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "TextPreview.h"
+#include <wil/resource.h>
+#include <algorithm>
+
+namespace
+{
+
+const char UTF8_BOM[] = "\xEF\xBB\xBF";
+const char UTF16_LE_BOM[] = "\xFF\xFE";
+const char UTF16_BE_BOM[] = "\xFE\xFF";
+
+// Returns the start of the text, up to and including the newline that ends line number maxLines.
+template <typename CharType>
+std::basic_string_view<CharType> GetLinesPrefix(
+	std::basic_string_view<CharType> text, size_t maxLines, bool truncated)
+{
+	size_t offset = 0;
+
+	for (size_t i = 0; i < maxLines; i++)
+	{
+		auto position = text.find(static_cast<CharType>('\n'), offset);
+
+		if (position == std::basic_string_view<CharType>::npos)
+		{
+			if (truncated && offset > 0)
+			{
+				return text.substr(0, offset);
+			}
+
+			return text;
+		}
+
+		offset = position + 1;
+	}
+
+	return text.substr(0, offset);
+}
+
+// Removes a multi-byte UTF-8 sequence that's been cut off at the end of the text.
+std::string_view TrimIncompleteUtf8Sequence(std::string_view text)
+{
+	for (size_t i = 1; i <= (std::min)(text.size(), size_t{ 3 }); i++)
+	{
+		auto c = static_cast<unsigned char>(text[text.size() - i]);
+
+		if ((c & 0xC0) == 0x80)
+		{
+			// A continuation byte.
+			continue;
+		}
+
+		size_t sequenceLength = 1;
+
+		if ((c & 0xE0) == 0xC0)
+		{
+			sequenceLength = 2;
+		}
+		else if ((c & 0xF0) == 0xE0)
+		{
+			sequenceLength = 3;
+		}
+		else if ((c & 0xF8) == 0xF0)
+		{
+			sequenceLength = 4;
+		}
+
+		if (sequenceLength > i)
+		{
+			return text.substr(0, text.size() - i);
+		}
+
+		break;
+	}
+
+	return text;
+}
+
+std::optional<std::wstring> ConvertToWideString(std::string_view text, UINT codePage, DWORD flags)
+{
+	if (text.empty())
+	{
+		return std::wstring();
+	}
+
+	int length = MultiByteToWideChar(
+		codePage, flags, text.data(), static_cast<int>(text.size()), nullptr, 0);
+
+	if (length == 0)
+	{
+		return std::nullopt;
+	}
+
+	std::wstring output(length, '\0');
+	MultiByteToWideChar(
+		codePage, flags, text.data(), static_cast<int>(text.size()), output.data(), length);
+
+	return output;
+}
+
+std::vector<std::wstring> SplitLines(std::wstring_view text, size_t maxLines)
+{
+	std::vector<std::wstring> lines;
+	size_t offset = 0;
+
+	while (offset < text.size() && lines.size() < maxLines)
+	{
+		auto position = text.find('\n', offset);
+		auto line = text.substr(
+			offset, position == std::wstring_view::npos ? std::wstring_view::npos : position - offset);
+
+		if (!line.empty() && line.back() == '\r')
+		{
+			line.remove_suffix(1);
+		}
+
+		lines.emplace_back(line);
+
+		if (position == std::wstring_view::npos)
+		{
+			break;
+		}
+
+		offset = position + 1;
+	}
+
+	return lines;
+}
+
+std::vector<std::wstring> DecodeUtf16Lines(
+	std::string_view data, size_t maxLines, bool truncated, bool bigEndian)
+{
+	std::wstring text(data.size() / sizeof(wchar_t), '\0');
+	memcpy(text.data(), data.data(), text.size() * sizeof(wchar_t));
+
+	if (bigEndian)
+	{
+		for (auto &c : text)
+		{
+			c = static_cast<wchar_t>(((c & 0xFF) << 8) | ((c >> 8) & 0xFF));
+		}
+	}
+
+	auto prefix = GetLinesPrefix(std::wstring_view(text), maxLines, truncated);
+	return SplitLines(prefix, maxLines);
+}
+
+// Copies the mapped data. Reading from a mapped view raises an exception (rather than returning an
+// error) if the underlying file can't be read, so that's handled here.
+bool CopyMappedView(const void *view, void *output, size_t size)
+{
+	__try
+	{
+		memcpy(output, view, size);
+	}
+	__except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER
+															: EXCEPTION_CONTINUE_SEARCH)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+}
+
+namespace TextPreview
+{
+
+std::vector<std::wstring> DecodeLines(std::string_view data, size_t maxLines, bool truncated)
+{
+	if (data.starts_with(UTF16_LE_BOM))
+	{
+		return DecodeUtf16Lines(data.substr(2), maxLines, truncated, false);
+	}
+	else if (data.starts_with(UTF16_BE_BOM))
+	{
+		return DecodeUtf16Lines(data.substr(2), maxLines, truncated, true);
+	}
+
+	bool hasUtf8Bom = data.starts_with(UTF8_BOM);
+
+	if (hasUtf8Bom)
+	{
+		data.remove_prefix(3);
+	}
+
+	// Only the lines that will be shown are converted.
+	auto prefix = GetLinesPrefix(data, maxLines, truncated);
+
+	if (truncated && prefix.size() == data.size())
+	{
+		prefix = TrimIncompleteUtf8Sequence(prefix);
+	}
+
+	auto text = ConvertToWideString(prefix, CP_UTF8, MB_ERR_INVALID_CHARS);
+
+	if (!text && !hasUtf8Bom)
+	{
+		text = ConvertToWideString(prefix, CP_ACP, 0);
+	}
+
+	if (!text)
+	{
+		return {};
+	}
+
+	return SplitLines(*text, maxLines);
+}
+
+std::optional<std::vector<std::wstring>> ReadLines(const std::wstring &path, size_t maxLines)
+{
+	wil::unique_hfile file(CreateFile(path.c_str(), GENERIC_READ,
+		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL, nullptr));
+
+	if (!file)
+	{
+		return std::nullopt;
+	}
+
+	LARGE_INTEGER fileSize;
+
+	if (!GetFileSizeEx(file.get(), &fileSize))
+	{
+		return std::nullopt;
+	}
+
+	// A mapping can't be created for an empty file.
+	if (fileSize.QuadPart == 0)
+	{
+		return std::vector<std::wstring>();
+	}
+
+	auto viewSize = static_cast<size_t>(
+		(std::min)(static_cast<ULONGLONG>(fileSize.QuadPart), ULONGLONG{ MAX_PREVIEW_BYTES }));
+
+	wil::unique_handle mapping(
+		CreateFileMapping(file.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+
+	if (!mapping)
+	{
+		return std::nullopt;
+	}
+
+	// Only the start of the file is mapped, regardless of how large the file is.
+	wil::unique_mapview_ptr<void> view(MapViewOfFile(mapping.get(), FILE_MAP_READ, 0, 0, viewSize));
+
+	if (!view)
+	{
+		return std::nullopt;
+	}
+
+	std::string data(viewSize, '\0');
+
+	if (!CopyMappedView(view.get(), data.data(), viewSize))
+	{
+		return std::nullopt;
+	}
+
+	return DecodeLines(data, maxLines, static_cast<ULONGLONG>(fileSize.QuadPart) > viewSize);
+}
+
+}
\ No newline at end of file
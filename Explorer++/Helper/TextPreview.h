@@ -0,0 +1,31 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Builds a preview of a text file from the first few lines of the file. Only the start of the file
+// is mapped into memory and only the lines that are needed are decoded, so the time taken doesn't
+// depend on the size of the file.
+namespace TextPreview
+{
+
+// The maximum amount of the file that's mapped.
+inline constexpr size_t MAX_PREVIEW_BYTES = 64 * 1024;
+
+// Splits the start of a text file into (at most) maxLines lines. The encoding is taken from the
+// byte order mark, if there is one. Otherwise, the text is treated as UTF-8 if it's valid UTF-8
+// and as ANSI text if it isn't. If the data is truncated (i.e. it's only the start of the file),
+// an unterminated final line is dropped, since it's likely to be incomplete, unless it's the only
+// line.
+std::vector<std::wstring> DecodeLines(std::string_view data, size_t maxLines, bool truncated);
+
+// Reads the first lines of the specified file. Returns std::nullopt if the file can't be read.
+std::optional<std::vector<std::wstring>> ReadLines(const std::wstring &path, size_t maxLines);
+
+}
\ No newline at end of file
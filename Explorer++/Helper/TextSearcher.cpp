@@ -0,0 +1,455 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "TextSearcher.h"
+#include <wil/resource.h>
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+
+std::wstring FoldCase(std::wstring_view str)
+{
+	std::wstring folded(str);
+
+	if (str.empty())
+	{
+		return folded;
+	}
+
+	int length = LCMapString(LOCALE_USER_DEFAULT, LCMAP_LOWERCASE, str.data(),
+		static_cast<int>(str.size()), folded.data(), static_cast<int>(folded.size()));
+
+	if (length == 0)
+	{
+		return std::wstring(str);
+	}
+
+	folded.resize(length);
+	return folded;
+}
+
+// Moves the specified position back, so that it doesn't fall in the middle of a UTF-8 sequence.
+size_t MoveToUtf8Boundary(std::string_view data, size_t position)
+{
+	while (position > 0 && position < data.size()
+		&& (static_cast<unsigned char>(data[position]) & 0xC0) == 0x80)
+	{
+		position--;
+	}
+
+	return position;
+}
+
+bool IsValidUtf8(std::string_view data)
+{
+	if (data.empty())
+	{
+		return true;
+	}
+
+	return MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS, data.data(),
+			   static_cast<int>(data.size()), nullptr, 0)
+		!= 0;
+}
+
+void ByteSwap(std::wstring &str)
+{
+	for (auto &ch : str)
+	{
+		ch = static_cast<wchar_t>(((ch & 0xFF) << 8) | ((ch >> 8) & 0xFF));
+	}
+}
+
+// Reading from a mapped view raises an exception (rather than returning an error) if the data
+// can't be paged in (e.g. because the file is on a network share that's been disconnected). That's
+// handled here. The search is run in a separate function, since __try can't be used in a function
+// that has objects requiring unwinding.
+void RunSearch(const TextSearcher *searcher, std::string_view data,
+	const std::stop_token *stopToken, std::optional<TextSearcher::Match> *match)
+{
+	*match = searcher->SearchData(data, *stopToken);
+}
+
+bool SearchMappedData(const TextSearcher *searcher, std::string_view data,
+	const std::stop_token *stopToken, std::optional<TextSearcher::Match> *match)
+{
+	__try
+	{
+		RunSearch(searcher, data, stopToken, match);
+	}
+	__except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER
+															: EXCEPTION_CONTINUE_SEARCH)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+}
+
+TextSearcher::TextSearcher(
+	std::wstring_view text, bool useRegularExpressions, bool caseInsensitive) :
+	m_caseInsensitive(caseInsensitive)
+{
+	if (useRegularExpressions)
+	{
+		m_regex.emplace(text, caseInsensitive);
+	}
+	else
+	{
+		m_text = caseInsensitive ? FoldCase(text) : std::wstring(text);
+	}
+}
+
+std::optional<TextSearcher::Match> TextSearcher::SearchFile(
+	const std::wstring &path, std::stop_token stopToken) const
+{
+	wil::unique_hfile file(CreateFile(path.c_str(), GENERIC_READ,
+		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+		FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+
+	if (!file)
+	{
+		return std::nullopt;
+	}
+
+	LARGE_INTEGER fileSize;
+	BOOL res = GetFileSizeEx(file.get(), &fileSize);
+
+	// An empty file can't be mapped (and wouldn't contain anything to match). A file that's larger
+	// than the address space can't be mapped in a single view, so is skipped.
+	if (!res || fileSize.QuadPart == 0
+		|| static_cast<ULONGLONG>(fileSize.QuadPart) > (std::numeric_limits<size_t>::max)())
+	{
+		return std::nullopt;
+	}
+
+	wil::unique_handle mapping(
+		CreateFileMapping(file.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+
+	if (!mapping)
+	{
+		return std::nullopt;
+	}
+
+	wil::unique_mapview_ptr<void> view(MapViewOfFile(mapping.get(), FILE_MAP_READ, 0, 0, 0));
+
+	if (!view)
+	{
+		return std::nullopt;
+	}
+
+	std::string_view data(
+		static_cast<const char *>(view.get()), static_cast<size_t>(fileSize.QuadPart));
+	std::optional<Match> match;
+
+	if (!SearchMappedData(this, data, &stopToken, &match))
+	{
+		return std::nullopt;
+	}
+
+	return match;
+}
+
+std::optional<TextSearcher::Match> TextSearcher::SearchData(
+	std::string_view data, std::stop_token stopToken) const
+{
+	auto encoding = DetectEncoding(data);
+
+	if (!encoding)
+	{
+		return std::nullopt;
+	}
+
+	if (*encoding == Encoding::Utf16LittleEndian || *encoding == Encoding::Utf16BigEndian)
+	{
+		// Any trailing partial character is ignored.
+		data = data.substr(0, data.size() & ~static_cast<size_t>(1));
+	}
+
+	std::wstring chunk;
+	std::wstring foldBuffer;
+	size_t lineNumber = 1;
+	size_t start = 0;
+
+	while (start < data.size())
+	{
+		if (stopToken.stop_requested())
+		{
+			return std::nullopt;
+		}
+
+		size_t end = GetChunkEnd(data, start, *encoding);
+		DecodeChunk(data.substr(start, end - start), *encoding, chunk);
+		start = end;
+
+		size_t matchLength;
+		auto position = FindInChunk(chunk, foldBuffer, matchLength);
+
+		if (!position)
+		{
+			lineNumber += std::count(chunk.begin(), chunk.end(), '\n');
+			continue;
+		}
+
+		size_t lineStart = 0;
+
+		if (*position > 0)
+		{
+			size_t previousNewline = chunk.rfind('\n', *position - 1);
+
+			if (previousNewline != std::wstring::npos)
+			{
+				lineStart = previousNewline + 1;
+			}
+		}
+
+		size_t lineEnd = chunk.find('\n', *position);
+
+		if (lineEnd == std::wstring::npos)
+		{
+			lineEnd = chunk.size();
+		}
+
+		if (lineEnd > lineStart && chunk[lineEnd - 1] == '\r')
+		{
+			lineEnd--;
+		}
+
+		lineNumber += std::count(chunk.begin(), chunk.begin() + lineStart, '\n');
+
+		// If the line is too long to be shown in full, the part that's shown is centered on the
+		// match.
+		size_t offset = lineStart;
+
+		if (lineEnd - lineStart > MAX_LINE_LENGTH && *position - lineStart > MAX_LINE_LENGTH / 2)
+		{
+			offset = (std::min)(*position - MAX_LINE_LENGTH / 2, lineEnd - MAX_LINE_LENGTH);
+		}
+
+		std::wstring line = chunk.substr(offset, (std::min)(lineEnd - offset, MAX_LINE_LENGTH));
+		line.erase(0, line.find_first_not_of(L" \t"));
+
+		return Match{ lineNumber, std::move(line) };
+	}
+
+	return std::nullopt;
+}
+
+bool TextSearcher::IsBinary(std::string_view data)
+{
+	return data.substr(0, BINARY_CHECK_SIZE).find('\0') != std::string_view::npos;
+}
+
+std::optional<TextSearcher::Encoding> TextSearcher::DetectEncoding(std::string_view &data)
+{
+	if (data.starts_with("\xFF\xFE"))
+	{
+		data.remove_prefix(2);
+		return Encoding::Utf16LittleEndian;
+	}
+	else if (data.starts_with("\xFE\xFF"))
+	{
+		data.remove_prefix(2);
+		return Encoding::Utf16BigEndian;
+	}
+	else if (data.starts_with("\xEF\xBB\xBF"))
+	{
+		data.remove_prefix(3);
+		return Encoding::Utf8;
+	}
+
+	if (IsBinary(data))
+	{
+		return std::nullopt;
+	}
+
+	auto start = data.substr(0, MoveToUtf8Boundary(data, CHUNK_SIZE));
+
+	if (IsValidUtf8(start))
+	{
+		return Encoding::Utf8;
+	}
+
+	return Encoding::Ansi;
+}
+
+size_t TextSearcher::GetChunkEnd(std::string_view data, size_t start, Encoding encoding)
+{
+	bool utf16 =
+		(encoding == Encoding::Utf16LittleEndian || encoding == Encoding::Utf16BigEndian);
+
+	if (data.size() - start <= CHUNK_SIZE)
+	{
+		return data.size();
+	}
+
+	size_t searchStart = start + CHUNK_SIZE;
+	size_t searchEnd = (std::min)(data.size(), start + MAX_CHUNK_SIZE);
+
+	if (utf16)
+	{
+		// The newline is searched for as a UTF-16 code unit, which is stored in the same byte order
+		// as the rest of the data.
+		const auto *units = reinterpret_cast<const wchar_t *>(data.data());
+		auto newline =
+			static_cast<wchar_t>(encoding == Encoding::Utf16LittleEndian ? 0x000A : 0x0A00);
+		const wchar_t *found =
+			wmemchr(units + searchStart / 2, newline, (searchEnd - searchStart) / 2);
+
+		if (found)
+		{
+			return (found - units + 1) * 2;
+		}
+
+		return searchEnd;
+	}
+
+	const auto *found = static_cast<const char *>(
+		memchr(data.data() + searchStart, '\n', searchEnd - searchStart));
+
+	if (found)
+	{
+		return found - data.data() + 1;
+	}
+
+	if (encoding == Encoding::Utf8)
+	{
+		return MoveToUtf8Boundary(data, searchEnd);
+	}
+
+	return searchEnd;
+}
+
+void TextSearcher::DecodeChunk(std::string_view chunk, Encoding encoding, std::wstring &output)
+{
+	switch (encoding)
+	{
+	case Encoding::Utf16LittleEndian:
+	case Encoding::Utf16BigEndian:
+		output.assign(reinterpret_cast<const wchar_t *>(chunk.data()), chunk.size() / 2);
+
+		if (encoding == Encoding::Utf16BigEndian)
+		{
+			ByteSwap(output);
+		}
+		break;
+
+	case Encoding::Utf8:
+	case Encoding::Ansi:
+	{
+		UINT codePage = (encoding == Encoding::Utf8) ? CP_UTF8 : CP_ACP;
+		int length = MultiByteToWideChar(
+			codePage, 0, chunk.data(), static_cast<int>(chunk.size()), nullptr, 0);
+
+		output.resize(length);
+
+		if (length > 0)
+		{
+			MultiByteToWideChar(codePage, 0, chunk.data(), static_cast<int>(chunk.size()),
+				output.data(), length);
+		}
+	}
+	break;
+	}
+}
+
+std::optional<size_t> TextSearcher::FindInChunk(
+	std::wstring_view chunk, std::wstring &foldBuffer, size_t &matchLength) const
+{
+	if (m_regex)
+	{
+		size_t lineStart = 0;
+
+		while (lineStart < chunk.size())
+		{
+			size_t lineEnd = chunk.find('\n', lineStart);
+
+			if (lineEnd == std::wstring_view::npos)
+			{
+				lineEnd = chunk.size();
+			}
+
+			auto line = chunk.substr(lineStart, lineEnd - lineStart);
+
+			if (!line.empty() && line.back() == '\r')
+			{
+				line.remove_suffix(1);
+			}
+
+			auto match = m_regex->Search(line);
+
+			if (match)
+			{
+				matchLength = match->length;
+				return lineStart + match->position;
+			}
+
+			lineStart = lineEnd + 1;
+		}
+
+		return std::nullopt;
+	}
+
+	matchLength = m_text.size();
+
+	if (!m_caseInsensitive || chunk.empty())
+	{
+		return FindLiteral(chunk);
+	}
+
+	// LCMAP_LOWERCASE maps each character individually, so positions within the folded text
+	// correspond to positions within the original text.
+	foldBuffer.resize(chunk.size());
+	int length = LCMapString(LOCALE_USER_DEFAULT, LCMAP_LOWERCASE, chunk.data(),
+		static_cast<int>(chunk.size()), foldBuffer.data(), static_cast<int>(foldBuffer.size()));
+
+	if (length != static_cast<int>(chunk.size()))
+	{
+		return FindLiteral(chunk);
+	}
+
+	return FindLiteral(foldBuffer);
+}
+
+std::optional<size_t> TextSearcher::FindLiteral(std::wstring_view str) const
+{
+	if (m_text.empty())
+	{
+		return 0;
+	}
+
+	if (str.size() < m_text.size())
+	{
+		return std::nullopt;
+	}
+
+	// Candidate positions are found using wmemchr, which is vectorized, so is significantly faster
+	// than comparing the text at each position in turn.
+	const wchar_t *current = str.data();
+	const wchar_t *last = str.data() + (str.size() - m_text.size());
+
+	while (current <= last)
+	{
+		current = wmemchr(current, m_text[0], last - current + 1);
+
+		if (!current)
+		{
+			break;
+		}
+
+		if (wmemcmp(current + 1, m_text.data() + 1, m_text.size() - 1) == 0)
+		{
+			return current - str.data();
+		}
+
+		current++;
+	}
+
+	return std::nullopt;
+}
\ No newline at end of file
@@ -0,0 +1,82 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "Regex.h"
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <string_view>
+
+// Searches the contents of text files for either a literal string or a regular expression. Text is
+// matched a line at a time (as with grep), so the search text can't span multiple lines.
+//
+// Files that start with a UTF-16 or UTF-8 byte order mark are decoded accordingly. Otherwise, a
+// file is treated as UTF-8 if its first block is valid UTF-8 and as being in the current ANSI code
+// page if not. Files that appear to be binary are skipped.
+//
+// Once constructed, an instance is immutable, so it can be shared between threads.
+class TextSearcher
+{
+public:
+	struct Match
+	{
+		// One-based.
+		size_t lineNumber;
+
+		// The line containing the match, without any line terminator. Long lines are truncated.
+		std::wstring line;
+	};
+
+	static constexpr size_t MAX_LINE_LENGTH = 512;
+
+	// Throws std::invalid_argument if a regular expression is used and is invalid.
+	TextSearcher(std::wstring_view text, bool useRegularExpressions, bool caseInsensitive);
+
+	// Returns the first match within the file. The file is memory-mapped, rather than read into a
+	// buffer. Returns nullopt if there's no match, the file can't be read, the file appears to be
+	// binary, or a stop is requested.
+	std::optional<Match> SearchFile(const std::wstring &path, std::stop_token stopToken) const;
+
+	// Returns the first match within the specified file contents.
+	std::optional<Match> SearchData(std::string_view data, std::stop_token stopToken = {}) const;
+
+	// A file is considered to be binary if it contains a null byte within its first block (which
+	// can't occur in text encoded in UTF-8 or an ANSI code page).
+	static bool IsBinary(std::string_view data);
+
+private:
+	enum class Encoding
+	{
+		Utf16LittleEndian,
+		Utf16BigEndian,
+		Utf8,
+		Ansi
+	};
+
+	// Data is decoded and searched in chunks of roughly this size, so that large files don't need
+	// to be decoded all at once. Chunks are split at line boundaries.
+	static constexpr size_t CHUNK_SIZE = 1024 * 1024;
+
+	// A line that's longer than this will be split across chunks, so a match that spans the split
+	// won't be found.
+	static constexpr size_t MAX_CHUNK_SIZE = 16 * 1024 * 1024;
+
+	static constexpr size_t BINARY_CHECK_SIZE = 8000;
+
+	// Removes any byte order mark from the data. Returns nullopt if the data appears to be binary.
+	static std::optional<Encoding> DetectEncoding(std::string_view &data);
+	static size_t GetChunkEnd(std::string_view data, size_t start, Encoding encoding);
+	static void DecodeChunk(std::string_view chunk, Encoding encoding, std::wstring &output);
+
+	std::optional<size_t> FindInChunk(
+		std::wstring_view chunk, std::wstring &foldBuffer, size_t &matchLength) const;
+	std::optional<size_t> FindLiteral(std::wstring_view str) const;
+
+	std::wstring m_text;
+	bool m_caseInsensitive;
+
+	std::optional<Regex> m_regex;
+};
\ No newline at end of file
@@ -0,0 +1,108 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ThemeResourceCache.h"
+#include "DpiCompatibility.h"
+
+HBRUSH ThemeResourceCache::GetSolidBrush(COLORREF color)
+{
+	auto itr = m_brushes.find(color);
+
+	if (itr == m_brushes.end())
+	{
+		itr = m_brushes.emplace(color, CreateSolidBrush(color)).first;
+	}
+
+	return itr->second.get();
+}
+
+HFONT ThemeResourceCache::GetCaptionFont(UINT dpi)
+{
+	auto itr = m_captionFonts.find(dpi);
+
+	if (itr != m_captionFonts.end())
+	{
+		return itr->second.get();
+	}
+
+	NONCLIENTMETRICS metrics;
+	metrics.cbSize = sizeof(metrics);
+	BOOL res = DpiCompatibility::GetInstance().SystemParametersInfoForDpi(
+		SPI_GETNONCLIENTMETRICS, sizeof(metrics), &metrics, 0, dpi);
+
+	wil::unique_hfont font;
+
+	if (res)
+	{
+		font.reset(CreateFontIndirect(&metrics.lfCaptionFont));
+	}
+
+	// A failure is cached as well, as there's no reason to think that retrying during the next
+	// paint would succeed.
+	itr = m_captionFonts.emplace(dpi, std::move(font)).first;
+
+	return itr->second.get();
+}
+
+HTHEME ThemeResourceCache::GetTheme(const std::wstring &classList, UINT dpi)
+{
+	ThemeKey key(classList, dpi);
+	auto itr = m_themes.find(key);
+
+	if (itr == m_themes.end())
+	{
+		wil::unique_htheme theme;
+
+		if (IsAppThemed())
+		{
+			theme.reset(
+				DpiCompatibility::GetInstance().OpenThemeDataForDpi(nullptr, classList.c_str(), dpi));
+		}
+
+		itr = m_themes.emplace(key, std::move(theme)).first;
+	}
+
+	return itr->second.get();
+}
+
+std::optional<SIZE> ThemeResourceCache::GetThemePartSize(
+	const std::wstring &classList, UINT dpi, int partId, int stateId)
+{
+	PartSizeKey key(classList, dpi, partId, stateId);
+	auto itr = m_partSizes.find(key);
+
+	if (itr != m_partSizes.end())
+	{
+		return itr->second;
+	}
+
+	std::optional<SIZE> partSize;
+	HTHEME theme = GetTheme(classList, dpi);
+
+	if (theme)
+	{
+		wil::unique_hdc_window screenDC(GetDC(nullptr));
+
+		SIZE size;
+		HRESULT hr =
+			::GetThemePartSize(theme, screenDC.get(), partId, stateId, nullptr, TS_DRAW, &size);
+
+		if (SUCCEEDED(hr))
+		{
+			partSize = size;
+		}
+	}
+
+	m_partSizes.emplace(key, partSize);
+
+	return partSize;
+}
+
+void ThemeResourceCache::Clear()
+{
+	m_partSizes.clear();
+	m_themes.clear();
+	m_captionFonts.clear();
+}
\ No newline at end of file
@@ -0,0 +1,49 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <wil/resource.h>
+#include <uxtheme.h>
+#include <map>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+
+// Custom drawn controls (e.g. the dark mode checkboxes and group boxes) need brushes, fonts and
+// theme handles each time they're painted. Creating those objects during every paint is
+// relatively expensive, so this class creates each object once (per DPI, where relevant) and
+// shares it between all windows.
+//
+// Fonts and theme handles remain valid until Clear() is called, which should happen whenever the
+// system theme or metrics change, so they shouldn't be held beyond the current message. Solid
+// brushes don't depend on the theme and remain valid for the lifetime of the cache. The class
+// isn't thread-safe and should only be used on the UI thread.
+class ThemeResourceCache
+{
+public:
+	HBRUSH GetSolidBrush(COLORREF color);
+
+	// Returns the caption font from the system's non-client metrics, scaled for the specified DPI.
+	HFONT GetCaptionFont(UINT dpi);
+
+	// Returns a handle to the theme data for the specified class list, or nullptr if visual styles
+	// aren't active.
+	HTHEME GetTheme(const std::wstring &classList, UINT dpi);
+
+	std::optional<SIZE> GetThemePartSize(
+		const std::wstring &classList, UINT dpi, int partId, int stateId);
+
+	void Clear();
+
+private:
+	using ThemeKey = std::tuple<std::wstring, UINT>;
+	using PartSizeKey = std::tuple<std::wstring, UINT, int, int>;
+
+	std::unordered_map<COLORREF, wil::unique_hbrush> m_brushes;
+	std::unordered_map<UINT, wil::unique_hfont> m_captionFonts;
+	std::map<ThemeKey, wil::unique_htheme> m_themes;
+	std::map<PartSizeKey, std::optional<SIZE>> m_partSizes;
+};
\ No newline at end of file
@@ -0,0 +1,102 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ThreadQos.h"
+
+namespace
+{
+
+// The power throttling declarations are only available when targeting Windows 10 (version 1709)
+// or later, so they're reproduced here. On earlier versions, SetThreadInformation() either doesn't
+// exist or rejects the information class, and the thread simply isn't throttled.
+constexpr int THREAD_POWER_THROTTLING_INFORMATION_CLASS = 3;
+constexpr ULONG THREAD_POWER_THROTTLING_VERSION = 1;
+constexpr ULONG THREAD_POWER_THROTTLING_EXECUTION_SPEED = 0x1;
+
+struct ThreadPowerThrottlingState
+{
+	ULONG version;
+	ULONG controlMask;
+	ULONG stateMask;
+};
+
+using SetThreadInformationType = BOOL(WINAPI *)(HANDLE thread, int informationClass,
+	LPVOID information, DWORD informationSize);
+
+thread_local TaskClass g_currentTaskClass = TaskClass::Interactive;
+
+bool IsBackgroundTaskClass(TaskClass taskClass)
+{
+	return taskClass == TaskClass::Background || taskClass == TaskClass::Bulk;
+}
+
+int GetThreadPriorityForTaskClass(TaskClass taskClass)
+{
+	switch (taskClass)
+	{
+	case TaskClass::VisiblePrefetch:
+		return THREAD_PRIORITY_BELOW_NORMAL;
+
+	case TaskClass::Background:
+		return THREAD_PRIORITY_BELOW_NORMAL;
+
+	case TaskClass::Bulk:
+		return THREAD_PRIORITY_LOWEST;
+
+	case TaskClass::Interactive:
+	default:
+		return THREAD_PRIORITY_NORMAL;
+	}
+}
+
+// Enabling execution speed throttling opts the thread into EcoQoS. Disabling it clears the control
+// mask, which returns the decision to the system, rather than explicitly opting out.
+void SetExecutionSpeedThrottling(bool enable)
+{
+	static const auto setThreadInformation = reinterpret_cast<SetThreadInformationType>(
+		GetProcAddress(GetModuleHandle(L"kernel32.dll"), "SetThreadInformation"));
+
+	if (!setThreadInformation)
+	{
+		return;
+	}
+
+	ThreadPowerThrottlingState state;
+	state.version = THREAD_POWER_THROTTLING_VERSION;
+	state.controlMask = enable ? THREAD_POWER_THROTTLING_EXECUTION_SPEED : 0;
+	state.stateMask = enable ? THREAD_POWER_THROTTLING_EXECUTION_SPEED : 0;
+	setThreadInformation(
+		GetCurrentThread(), THREAD_POWER_THROTTLING_INFORMATION_CLASS, &state, sizeof(state));
+}
+
+}
+
+void SetCurrentThreadTaskClass(TaskClass taskClass)
+{
+	if (taskClass == g_currentTaskClass)
+	{
+		return;
+	}
+
+	bool background = IsBackgroundTaskClass(taskClass);
+
+	if (background != IsBackgroundTaskClass(g_currentTaskClass))
+	{
+		// Background processing mode is what lowers the I/O and memory priority of the thread. It
+		// can only be entered and left by the thread itself.
+		SetThreadPriority(GetCurrentThread(),
+			background ? THREAD_MODE_BACKGROUND_BEGIN : THREAD_MODE_BACKGROUND_END);
+		SetExecutionSpeedThrottling(background);
+	}
+
+	SetThreadPriority(GetCurrentThread(), GetThreadPriorityForTaskClass(taskClass));
+
+	g_currentTaskClass = taskClass;
+}
+
+TaskClass GetCurrentThreadTaskClass()
+{
+	return g_currentTaskClass;
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+// Describes how urgently the work on a thread is needed, which determines the CPU, I/O and memory
+// priority the thread runs at.
+enum class TaskClass
+{
+	// Work that the user is waiting on (e.g. the column text for the visible items).
+	Interactive,
+
+	// Work for items that are likely to be needed soon (e.g. the items just beyond the visible
+	// area). Runs at a slightly lower CPU priority.
+	VisiblePrefetch,
+
+	// Work whose results aren't immediately visible (e.g. folder size calculations). The thread is
+	// put into background processing mode, which lowers its I/O and memory priority, and is
+	// scheduled for efficiency (EcoQoS) where that's supported.
+	Background,
+
+	// Large jobs (e.g. hashing or searching a tree of files). As above, but at the lowest CPU
+	// priority.
+	Bulk
+};
+
+// Applies the priorities for the task class to the calling thread. The class is remembered for
+// each thread, so calling this with the class the thread already has does nothing.
+void SetCurrentThreadTaskClass(TaskClass taskClass);
+TaskClass GetCurrentThreadTaskClass();
\ No newline at end of file
@@ -0,0 +1,169 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "TieredThumbnailCache.h"
+#include "ImageScaler.h"
+#include <algorithm>
+
+TieredThumbnailCache::TieredThumbnailCache(size_t maxBytes) : m_maxBytes(maxBytes)
+{
+}
+
+void TieredThumbnailCache::Insert(const std::wstring &key, Image image)
+{
+	auto original = std::make_shared<const Image>(std::move(image));
+	size_t sizeInBytes = GetImageSizeInBytes(*original);
+
+	std::scoped_lock lock(m_mutex);
+
+	auto itr = m_index.find(key);
+
+	if (itr != m_index.end())
+	{
+		m_sizeInBytes -= itr->second->sizeInBytes;
+		m_entries.erase(itr->second);
+		m_index.erase(itr);
+	}
+
+	m_entries.push_front({ key, original, {}, sizeInBytes });
+	m_index.insert({ key, m_entries.begin() });
+	m_sizeInBytes += sizeInBytes;
+
+	RemoveLeastRecentlyUsed();
+}
+
+std::shared_ptr<const TieredThumbnailCache::Image> TieredThumbnailCache::Get(
+	const std::wstring &key, int size)
+{
+	std::shared_ptr<const Image> original;
+
+	{
+		std::scoped_lock lock(m_mutex);
+
+		auto itr = m_index.find(key);
+
+		if (itr == m_index.end())
+		{
+			return nullptr;
+		}
+
+		Entry &entry = *itr->second;
+		m_entries.splice(m_entries.begin(), m_entries, itr->second);
+
+		if ((std::max)(entry.original->width, entry.original->height) <= size)
+		{
+			return entry.original;
+		}
+
+		auto scaledItr = entry.scaled.find(size);
+
+		if (scaledItr != entry.scaled.end())
+		{
+			return scaledItr->second;
+		}
+
+		original = entry.original;
+	}
+
+	// Scaling is done without the lock held, so that other threads can use the cache in the
+	// meantime.
+	auto scaled = std::make_shared<const Image>(ScaleImage(*original, size));
+
+	std::scoped_lock lock(m_mutex);
+
+	auto itr = m_index.find(key);
+
+	// The scaled image is only stored if the original is still the current version of the
+	// thumbnail.
+	if (itr != m_index.end() && itr->second->original == original)
+	{
+		auto [scaledItr, inserted] = itr->second->scaled.insert({ size, scaled });
+
+		if (inserted)
+		{
+			size_t sizeInBytes = GetImageSizeInBytes(*scaled);
+			itr->second->sizeInBytes += sizeInBytes;
+			m_sizeInBytes += sizeInBytes;
+
+			RemoveLeastRecentlyUsed();
+		}
+	}
+
+	return scaled;
+}
+
+void TieredThumbnailCache::Clear()
+{
+	std::scoped_lock lock(m_mutex);
+
+	m_entries.clear();
+	m_index.clear();
+	m_sizeInBytes = 0;
+}
+
+size_t TieredThumbnailCache::GetSizeInBytes() const
+{
+	std::scoped_lock lock(m_mutex);
+	return m_sizeInBytes;
+}
+
+void TieredThumbnailCache::TrimToSize(size_t maxBytes)
+{
+	std::scoped_lock lock(m_mutex);
+
+	while (m_sizeInBytes > maxBytes && !m_entries.empty())
+	{
+		const Entry &entry = m_entries.back();
+		m_sizeInBytes -= entry.sizeInBytes;
+		m_index.erase(entry.key);
+		m_entries.pop_back();
+	}
+}
+
+TieredThumbnailCache::Image TieredThumbnailCache::ScaleImage(const Image &image, int size)
+{
+	if ((std::max)(image.width, image.height) <= size)
+	{
+		return image;
+	}
+
+	auto [width, height] = GetScaledDimensions(image.width, image.height, size);
+
+	Image scaledImage;
+	scaledImage.width = width;
+	scaledImage.height = height;
+	scaledImage.pixels.resize(static_cast<size_t>(width) * height);
+	DownscaleImage(image.pixels.data(), image.width, image.height, scaledImage.pixels.data(),
+		width, height);
+
+	return scaledImage;
+}
+
+std::pair<int, int> TieredThumbnailCache::GetScaledDimensions(int width, int height, int size)
+{
+	if (width >= height)
+	{
+		return { size, (std::max)((height * size + width / 2) / width, 1) };
+	}
+
+	return { (std::max)((width * size + height / 2) / height, 1), size };
+}
+
+size_t TieredThumbnailCache::GetImageSizeInBytes(const Image &image)
+{
+	return sizeof(Image) + image.pixels.size() * sizeof(uint32_t);
+}
+
+// The most recently used entry is always kept, even if it's larger than the limit on its own.
+void TieredThumbnailCache::RemoveLeastRecentlyUsed()
+{
+	while (m_sizeInBytes > m_maxBytes && m_entries.size() > 1)
+	{
+		const Entry &entry = m_entries.back();
+		m_sizeInBytes -= entry.sizeInBytes;
+		m_index.erase(entry.key);
+		m_entries.pop_back();
+	}
+}
\ No newline at end of file
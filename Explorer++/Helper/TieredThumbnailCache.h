@@ -0,0 +1,78 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Stores a single, large version of each item's thumbnail, along with any smaller versions that
+// have been generated from it. That means that when the thumbnail size changes (e.g. because the
+// DPI has changed), the thumbnails can be regenerated without having to request them from the
+// shell again.
+//
+// The cache is bounded by the approximate amount of memory used by the images. Once that limit is
+// reached, the images for the least recently used items are removed. The cache can be used
+// concurrently from multiple threads.
+class TieredThumbnailCache
+{
+public:
+	// A 32-bit image, stored row by row.
+	struct Image
+	{
+		int width;
+		int height;
+		std::vector<uint32_t> pixels;
+	};
+
+	explicit TieredThumbnailCache(size_t maxBytes);
+
+	// Stores the largest available version of the item's thumbnail, replacing any previous
+	// versions.
+	void Insert(const std::wstring &key, Image image);
+
+	// Returns the item's thumbnail, scaled down (preserving its aspect ratio) so that it fits
+	// within a square of the specified size. The image is never enlarged. Returns nullptr if no
+	// thumbnail has been stored for the item.
+	std::shared_ptr<const Image> Get(const std::wstring &key, int size);
+
+	void Clear();
+	size_t GetSizeInBytes() const;
+
+	// Removes the least recently used items until the images use at most the specified amount of
+	// memory. Unlike the limit passed to the constructor, this may remove every item.
+	void TrimToSize(size_t maxBytes);
+
+	// Scales the image in the same way as Get(), for images that aren't stored in the cache.
+	static Image ScaleImage(const Image &image, int size);
+	static std::pair<int, int> GetScaledDimensions(int width, int height, int size);
+
+private:
+	struct Entry
+	{
+		std::wstring key;
+		std::shared_ptr<const Image> original;
+		std::map<int, std::shared_ptr<const Image>> scaled;
+		size_t sizeInBytes;
+	};
+
+	static size_t GetImageSizeInBytes(const Image &image);
+	void RemoveLeastRecentlyUsed();
+
+	const size_t m_maxBytes;
+
+	mutable std::mutex m_mutex;
+
+	// Ordered from most to least recently used.
+	std::list<Entry> m_entries;
+	std::unordered_map<std::wstring, std::list<Entry>::iterator> m_index;
+	size_t m_sizeInBytes = 0;
+};
\ No newline at end of file
@@ -4,6 +4,7 @@
 
 #include "stdafx.h"
 #include "TimeHelper.h"
+#include "DisplayFormatter.h"
 
 BOOL LocalSystemTimeToFileTime(const SYSTEMTIME *lpLocalTime, FILETIME *lpFileTime)
 {
@@ -20,15 +21,15 @@ BOOL LocalSystemTimeToFileTime(const SYSTEMTIME *lpLocalTime, FILETIME *lpFileTi
 
 BOOL FileTimeToLocalSystemTime(const FILETIME *lpFileTime, SYSTEMTIME *lpLocalTime)
 {
-	SYSTEMTIME systemTime;
-	BOOL result = FileTimeToSystemTime(lpFileTime, &systemTime);
+	auto localTime = GetDisplayFormatter().ConvertToLocalTime(*lpFileTime);
 
-	if (result)
+	if (!localTime)
 	{
-		result = SystemTimeToTzSpecificLocalTime(nullptr, &systemTime, lpLocalTime);
+		return FALSE;
 	}
 
-	return result;
+	*lpLocalTime = *localTime;
+	return TRUE;
 }
 
 void MergeDateTime(SYSTEMTIME *pstOutput, const SYSTEMTIME *pstDate, const SYSTEMTIME *pstTime)
@@ -0,0 +1,19 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "ShellHelper.h"
+#include <unknwn.h>
+#include <vector>
+
+// Implemented by data objects that this process creates for a set of shell items. When one of
+// those objects is dropped or pasted within the process, the original items can be retrieved
+// through this interface, rather than having to be extracted from the formats the object offers.
+// Since the items are returned directly, this is only usable from within the process.
+struct __declspec(uuid("a1a0c56f-46b7-4b15-a0ba-3ea2c25f3d32")) ITransferItemsSource :
+	public IUnknown
+{
+	virtual const std::vector<unique_pidl_absolute> &GetTransferItems() = 0;
+};
\ No newline at end of file
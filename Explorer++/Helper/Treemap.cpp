@@ -0,0 +1,115 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "Treemap.h"
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+
+// Returns the worst (i.e. largest) aspect ratio of the rectangles in a row containing items with
+// the specified total area and smallest and largest areas, laid out along a side of the specified
+// length.
+double GetWorstAspectRatio(double rowArea, double minArea, double maxArea, double sideLength)
+{
+	if (rowArea <= 0 || minArea <= 0)
+	{
+		return (std::numeric_limits<double>::max)();
+	}
+
+	double sideSquared = sideLength * sideLength;
+	double rowAreaSquared = rowArea * rowArea;
+	return (std::max)(
+		(sideSquared * maxArea) / rowAreaSquared, rowAreaSquared / (sideSquared * minArea));
+}
+
+}
+
+std::vector<TreemapRect> LayoutSquarifiedTreemap(
+	const std::vector<double> &sizes, const TreemapRect &bounds)
+{
+	std::vector<TreemapRect> rects(sizes.size(), { bounds.left, bounds.top, 0, 0 });
+
+	double totalSize = 0;
+
+	for (double size : sizes)
+	{
+		totalSize += (std::max)(size, 0.0);
+	}
+
+	if (totalSize <= 0 || bounds.width <= 0 || bounds.height <= 0)
+	{
+		return rects;
+	}
+
+	double scale = (bounds.width * bounds.height) / totalSize;
+	TreemapRect remaining = bounds;
+	size_t rowStart = 0;
+
+	while (rowStart < sizes.size() && sizes[rowStart] > 0)
+	{
+		double sideLength = (std::min)(remaining.width, remaining.height);
+
+		double rowArea = sizes[rowStart] * scale;
+		double minArea = rowArea;
+		double maxArea = rowArea;
+		size_t rowEnd = rowStart + 1;
+
+		for (; rowEnd < sizes.size() && sizes[rowEnd] > 0; rowEnd++)
+		{
+			double area = sizes[rowEnd] * scale;
+			double currentRatio = GetWorstAspectRatio(rowArea, minArea, maxArea, sideLength);
+			double extendedRatio = GetWorstAspectRatio(rowArea + area, (std::min)(minArea, area),
+				(std::max)(maxArea, area), sideLength);
+
+			if (extendedRatio > currentRatio)
+			{
+				break;
+			}
+
+			rowArea += area;
+			minArea = (std::min)(minArea, area);
+			maxArea = (std::max)(maxArea, area);
+		}
+
+		// The row is placed along the shorter side of the remaining space, after which that
+		// space shrinks by the thickness of the row.
+		bool vertical = remaining.width >= remaining.height;
+		double thickness = (sideLength > 0) ? rowArea / sideLength : 0;
+		double offset = 0;
+
+		for (size_t i = rowStart; i < rowEnd; i++)
+		{
+			double length = (thickness > 0) ? (sizes[i] * scale) / thickness : 0;
+
+			if (vertical)
+			{
+				rects[i] = { remaining.left, remaining.top + offset, thickness, length };
+			}
+			else
+			{
+				rects[i] = { remaining.left + offset, remaining.top, length, thickness };
+			}
+
+			offset += length;
+		}
+
+		if (vertical)
+		{
+			remaining.left += thickness;
+			remaining.width = (std::max)(remaining.width - thickness, 0.0);
+		}
+		else
+		{
+			remaining.top += thickness;
+			remaining.height = (std::max)(remaining.height - thickness, 0.0);
+		}
+
+		rowStart = rowEnd;
+	}
+
+	return rects;
+}
\ No newline at end of file
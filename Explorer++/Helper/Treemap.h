@@ -0,0 +1,26 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <vector>
+
+struct TreemapRect
+{
+	double left;
+	double top;
+	double width;
+	double height;
+};
+
+// Divides the bounds into one rectangle per item, with the area of each rectangle proportional to
+// the size of the item. The squarified algorithm (Bruls, Huizing and van Wijk) is used: items are
+// placed in rows along the shorter side of the remaining space, with each row extended for as
+// long as doing so improves the worst aspect ratio within it. That keeps the rectangles close to
+// square, which makes them easier to compare and to click on.
+//
+// The sizes should be sorted in descending order, since the algorithm relies on that to produce
+// a good layout. Items with a size of zero (or less) are given an empty rectangle.
+std::vector<TreemapRect> LayoutSquarifiedTreemap(
+	const std::vector<double> &sizes, const TreemapRect &bounds);
\ No newline at end of file
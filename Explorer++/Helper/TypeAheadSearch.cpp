@@ -0,0 +1,88 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "TypeAheadSearch.h"
+#include <algorithm>
+#include <cwctype>
+
+TypeAheadSearch::TypeAheadSearch(std::chrono::milliseconds timeout) : m_timeout(timeout)
+{
+}
+
+std::optional<TypeAheadSearch::Query> TypeAheadSearch::AddCharacter(
+	wchar_t character, std::chrono::steady_clock::time_point now)
+{
+	if (!m_text.empty() && (now - m_lastCharacterTime) > m_timeout)
+	{
+		m_text.clear();
+	}
+
+	if (character < L' ' || (character == L' ' && m_text.empty()))
+	{
+		return std::nullopt;
+	}
+
+	m_text += character;
+	m_lastCharacterTime = now;
+
+	if (IsRepeatedCharacter())
+	{
+		return Query{ m_text.substr(0, 1), true };
+	}
+
+	return Query{ m_text, m_text.size() == 1 };
+}
+
+void TypeAheadSearch::Reset()
+{
+	m_text.clear();
+}
+
+bool TypeAheadSearch::IsRepeatedCharacter() const
+{
+	if (m_text.size() < 2)
+	{
+		return false;
+	}
+
+	wchar_t first = std::towlower(m_text[0]);
+
+	return std::all_of(m_text.begin() + 1, m_text.end(),
+		[first](wchar_t character) { return std::towlower(character) == first; });
+}
+
+std::optional<size_t> TypeAheadSearch::FindNextMatch(
+	const std::vector<int> &matchingPositions, int start, int numItems)
+{
+	if (numItems <= 0)
+	{
+		return std::nullopt;
+	}
+
+	start = ((start % numItems) + numItems) % numItems;
+
+	std::optional<size_t> nextMatch;
+	int smallestDistance = numItems;
+
+	for (size_t i = 0; i < matchingPositions.size(); i++)
+	{
+		int position = matchingPositions[i];
+
+		if (position < 0 || position >= numItems)
+		{
+			continue;
+		}
+
+		int distance = (position - start + numItems) % numItems;
+
+		if (distance < smallestDistance)
+		{
+			smallestDistance = distance;
+			nextMatch = i;
+		}
+	}
+
+	return nextMatch;
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <chrono>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Tracks the characters typed into a list in order to jump to an item, in the same way as the
+// list view's own incremental search. Characters typed in quick succession are combined into a
+// single prefix, while typing the same character repeatedly cycles through the items that start
+// with that character. Finding the items that match is left to the caller.
+class TypeAheadSearch
+{
+public:
+	struct Query
+	{
+		std::wstring prefix;
+
+		// If set, the search starts at the item after the current one, so that the current item
+		// is only matched again once every other matching item has been visited. Otherwise, the
+		// search starts at the current item, so that it remains selected while it still matches.
+		bool startAfterCurrent;
+	};
+
+	explicit TypeAheadSearch(std::chrono::milliseconds timeout);
+
+	// Returns the query to run, or std::nullopt if the character isn't part of a search (e.g. a
+	// control character, or a space typed when there's no search in progress), in which case it
+	// should be handled normally.
+	std::optional<Query> AddCharacter(
+		wchar_t character, std::chrono::steady_clock::time_point now);
+	void Reset();
+
+	// Given the positions of the items that match, returns the index (within matchingPositions)
+	// of the first match at or after start, wrapping around to the beginning of the list if
+	// necessary.
+	static std::optional<size_t> FindNextMatch(
+		const std::vector<int> &matchingPositions, int start, int numItems);
+
+private:
+	bool IsRepeatedCharacter() const;
+
+	const std::chrono::milliseconds m_timeout;
+	std::wstring m_text;
+	std::chrono::steady_clock::time_point m_lastCharacterTime;
+};
\ No newline at end of file
@@ -0,0 +1,306 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "UnbufferedIo.h"
+#include <algorithm>
+#include <cassert>
+
+wil::unique_virtualalloc_ptr<std::byte> AllocateUnbufferedIoBuffer(size_t size)
+{
+	return wil::unique_virtualalloc_ptr<std::byte>(static_cast<std::byte *>(
+		VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE)));
+}
+
+bool PreallocateFileSpace(HANDLE file, ULONGLONG size)
+{
+	FILE_ALLOCATION_INFO allocationInfo;
+	allocationInfo.AllocationSize.QuadPart = size;
+	return SetFileInformationByHandle(
+		file, FileAllocationInfo, &allocationInfo, sizeof(allocationInfo));
+}
+
+bool SetFileSize(HANDLE file, ULONGLONG size)
+{
+	FILE_END_OF_FILE_INFO endOfFileInfo;
+	endOfFileInfo.EndOfFile.QuadPart = size;
+	return SetFileInformationByHandle(
+		file, FileEndOfFileInfo, &endOfFileInfo, sizeof(endOfFileInfo));
+}
+
+OverlappedOperation::OverlappedOperation() : m_overlapped({})
+{
+	m_event.create(wil::EventOptions::ManualReset);
+}
+
+OverlappedOperation::~OverlappedOperation()
+{
+	if (m_inProgress)
+	{
+		// The operation refers to memory owned by the caller, so it has to finish (or be
+		// cancelled) before this object goes away.
+		CancelIoEx(m_file, &m_overlapped);
+		Wait();
+	}
+}
+
+bool OverlappedOperation::StartRead(HANDLE file, void *buffer, DWORD size, ULONGLONG offset)
+{
+	assert(!m_inProgress);
+
+	if (!m_event)
+	{
+		return false;
+	}
+
+	m_overlapped = {};
+	m_overlapped.Offset = static_cast<DWORD>(offset);
+	m_overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+	m_overlapped.hEvent = m_event.get();
+
+	BOOL res = ReadFile(file, buffer, size, nullptr, &m_overlapped);
+	return OnStarted(file, res);
+}
+
+bool OverlappedOperation::StartWrite(
+	HANDLE file, const void *buffer, DWORD size, ULONGLONG offset)
+{
+	assert(!m_inProgress);
+
+	if (!m_event)
+	{
+		return false;
+	}
+
+	m_overlapped = {};
+	m_overlapped.Offset = static_cast<DWORD>(offset);
+	m_overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+	m_overlapped.hEvent = m_event.get();
+
+	BOOL res = WriteFile(file, buffer, size, nullptr, &m_overlapped);
+	return OnStarted(file, res);
+}
+
+bool OverlappedOperation::StartControl(
+	HANDLE file, DWORD controlCode, void *input, DWORD inputSize)
+{
+	assert(!m_inProgress);
+
+	if (!m_event)
+	{
+		return false;
+	}
+
+	m_overlapped = {};
+	m_overlapped.hEvent = m_event.get();
+
+	BOOL res =
+		DeviceIoControl(file, controlCode, input, inputSize, nullptr, 0, nullptr, &m_overlapped);
+	return OnStarted(file, res);
+}
+
+bool OverlappedOperation::OnStarted(HANDLE file, BOOL res)
+{
+	if (!res)
+	{
+		DWORD error = GetLastError();
+
+		if (error == ERROR_HANDLE_EOF)
+		{
+			// The read started at the end of the file, so there's nothing to wait for.
+			return true;
+		}
+		else if (error != ERROR_IO_PENDING)
+		{
+			return false;
+		}
+	}
+
+	// Even if the operation completed synchronously, the event will have been signaled and the
+	// result can be retrieved in the usual way.
+	m_file = file;
+	m_inProgress = true;
+	return true;
+}
+
+std::optional<DWORD> OverlappedOperation::Wait()
+{
+	if (!m_inProgress)
+	{
+		return 0;
+	}
+
+	DWORD numBytesTransferred;
+	BOOL res = GetOverlappedResult(m_file, &m_overlapped, &numBytesTransferred, TRUE);
+	m_inProgress = false;
+
+	if (!res)
+	{
+		if (GetLastError() == ERROR_HANDLE_EOF)
+		{
+			return 0;
+		}
+
+		return std::nullopt;
+	}
+
+	return numBytesTransferred;
+}
+
+bool OverlappedOperation::IsInProgress() const
+{
+	return m_inProgress;
+}
+
+UnbufferedFileWriter::UnbufferedFileWriter(
+	HANDLE file, size_t bufferSize, int numBuffers, ULONGLONG startOffset) :
+	m_file(file),
+	m_bufferSize(bufferSize),
+	m_currentBufferOffset(startOffset)
+{
+	assert(bufferSize % UNBUFFERED_IO_ALIGNMENT == 0);
+	assert(startOffset % UNBUFFERED_IO_ALIGNMENT == 0);
+	assert(numBuffers > 0);
+
+	for (int i = 0; i < numBuffers; i++)
+	{
+		auto buffer = std::make_unique<Buffer>();
+		buffer->data = AllocateUnbufferedIoBuffer(bufferSize);
+
+		if (!buffer->data)
+		{
+			m_buffers.clear();
+			return;
+		}
+
+		m_buffers.push_back(std::move(buffer));
+	}
+}
+
+bool UnbufferedFileWriter::IsValid() const
+{
+	return !m_buffers.empty();
+}
+
+std::span<std::byte> UnbufferedFileWriter::GetWritableSpace()
+{
+	return { m_buffers[m_currentBuffer]->data.get() + m_currentBufferUsed,
+		m_bufferSize - m_currentBufferUsed };
+}
+
+bool UnbufferedFileWriter::Commit(size_t size)
+{
+	assert(m_currentBufferUsed + size <= m_bufferSize);
+
+	m_currentBufferUsed += size;
+
+	if (m_currentBufferUsed == m_bufferSize)
+	{
+		WriteCurrentBuffer(m_bufferSize);
+	}
+
+	return !m_failed;
+}
+
+bool UnbufferedFileWriter::Write(std::span<const std::byte> data)
+{
+	while (!data.empty() && !m_failed)
+	{
+		auto space = GetWritableSpace();
+		size_t amount = (std::min)(space.size(), data.size());
+		std::copy_n(data.begin(), amount, space.begin());
+		Commit(amount);
+
+		data = data.subspan(amount);
+	}
+
+	return !m_failed;
+}
+
+bool UnbufferedFileWriter::FlushAndSkip(ULONGLONG size)
+{
+	assert(m_currentBufferUsed % UNBUFFERED_IO_ALIGNMENT == 0);
+	assert(size % UNBUFFERED_IO_ALIGNMENT == 0);
+
+	if (m_currentBufferUsed > 0)
+	{
+		WriteCurrentBuffer(m_currentBufferUsed);
+	}
+
+	WaitForAllWrites();
+
+	m_currentBufferOffset += size;
+
+	return !m_failed;
+}
+
+bool UnbufferedFileWriter::Finish()
+{
+	ULONGLONG finalSize = GetPosition();
+
+	if (m_currentBufferUsed > 0)
+	{
+		auto alignedSize =
+			static_cast<size_t>(AlignUp(m_currentBufferUsed, UNBUFFERED_IO_ALIGNMENT));
+		auto space = GetWritableSpace();
+		std::fill_n(space.begin(), alignedSize - m_currentBufferUsed, std::byte { 0 });
+		WriteCurrentBuffer(alignedSize);
+	}
+
+	WaitForAllWrites();
+
+	if (m_failed)
+	{
+		return false;
+	}
+
+	return SetFileSize(m_file, finalSize);
+}
+
+ULONGLONG UnbufferedFileWriter::GetPosition() const
+{
+	return m_currentBufferOffset + m_currentBufferUsed;
+}
+
+bool UnbufferedFileWriter::WriteCurrentBuffer(size_t size)
+{
+	auto &buffer = m_buffers[m_currentBuffer];
+
+	if (!m_failed
+		&& !buffer->operation.StartWrite(m_file, buffer->data.get(), static_cast<DWORD>(size),
+			m_currentBufferOffset))
+	{
+		m_failed = true;
+	}
+
+	m_currentBufferOffset += m_currentBufferUsed;
+	m_currentBufferUsed = 0;
+
+	// The next buffer can only be reused once the write that was last issued from it has
+	// finished.
+	m_currentBuffer = (m_currentBuffer + 1) % m_buffers.size();
+	auto result = m_buffers[m_currentBuffer]->operation.Wait();
+
+	if (!result)
+	{
+		m_failed = true;
+	}
+
+	return !m_failed;
+}
+
+bool UnbufferedFileWriter::WaitForAllWrites()
+{
+	for (auto &buffer : m_buffers)
+	{
+		auto result = buffer->operation.Wait();
+
+		if (!result)
+		{
+			m_failed = true;
+		}
+	}
+
+	return !m_failed;
+}
\ No newline at end of file
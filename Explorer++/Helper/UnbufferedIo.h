@@ -0,0 +1,132 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <wil/resource.h>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+// Unbuffered I/O (i.e. I/O on a file opened with FILE_FLAG_NO_BUFFERING) bypasses the system file
+// cache, so copying a large file doesn't evict everything else from the cache. It does, however,
+// require that buffer addresses, file offsets and transfer sizes are all multiples of the volume's
+// sector size. Sector sizes are at most 4 KB in practice, so that alignment is used throughout.
+constexpr DWORD UNBUFFERED_IO_ALIGNMENT = 4096;
+
+constexpr ULONGLONG AlignUp(ULONGLONG value, ULONGLONG alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+constexpr ULONGLONG AlignDown(ULONGLONG value, ULONGLONG alignment)
+{
+	return value / alignment * alignment;
+}
+
+// Memory returned by VirtualAlloc is page-aligned, so is suitable for unbuffered I/O.
+wil::unique_virtualalloc_ptr<std::byte> AllocateUnbufferedIoBuffer(size_t size);
+
+// Reserves space for a file, without changing its size. That allows the file system to allocate
+// the file in as few fragments as possible, rather than extending it on each write.
+bool PreallocateFileSpace(HANDLE file, ULONGLONG size);
+
+bool SetFileSize(HANDLE file, ULONGLONG size);
+
+// A single read, write or control operation on a file opened with FILE_FLAG_OVERLAPPED. Only one
+// operation can be in progress at a time, though any number of instances can be used with the
+// same file.
+class OverlappedOperation
+{
+public:
+	OverlappedOperation();
+	~OverlappedOperation();
+
+	OverlappedOperation(const OverlappedOperation &) = delete;
+	OverlappedOperation &operator=(const OverlappedOperation &) = delete;
+
+	bool StartRead(HANDLE file, void *buffer, DWORD size, ULONGLONG offset);
+	bool StartWrite(HANDLE file, const void *buffer, DWORD size, ULONGLONG offset);
+	bool StartControl(HANDLE file, DWORD controlCode, void *input, DWORD inputSize);
+
+	// Waits for the operation to finish. Returns the number of bytes transferred, or nullopt if
+	// the operation failed. A read that starts at (or beyond) the end of the file transfers 0
+	// bytes. If no operation is in progress, this returns 0 immediately.
+	std::optional<DWORD> Wait();
+
+	bool IsInProgress() const;
+
+private:
+	bool OnStarted(HANDLE file, BOOL res);
+
+	OVERLAPPED m_overlapped;
+	wil::unique_event_nothrow m_event;
+	HANDLE m_file = nullptr;
+	bool m_inProgress = false;
+};
+
+// Writes a sequential stream of data to a file opened with both FILE_FLAG_NO_BUFFERING and
+// FILE_FLAG_OVERLAPPED. Data is accumulated in a set of fixed-size buffers. Once a buffer is full,
+// it's written in the background, while the next buffer is filled.
+//
+// Data can be placed directly into the current buffer (via GetWritableSpace() and Commit()), so a
+// caller can read into it without an intermediate copy.
+class UnbufferedFileWriter
+{
+public:
+	// The buffer size must be a multiple of UNBUFFERED_IO_ALIGNMENT.
+	UnbufferedFileWriter(HANDLE file, size_t bufferSize, int numBuffers,
+		ULONGLONG startOffset = 0);
+
+	// Returns false if the buffers couldn't be allocated.
+	bool IsValid() const;
+
+	// The space remaining in the current buffer. The start of this space is aligned for unbuffered
+	// I/O whenever the current position is.
+	std::span<std::byte> GetWritableSpace();
+
+	// Marks the specified number of bytes (written to the start of the writable space) as
+	// complete. Returns false if a previous write has failed.
+	bool Commit(size_t size);
+
+	// Copies the data into the buffers.
+	bool Write(std::span<const std::byte> data);
+
+	// Writes and waits for all buffered data, then skips forward by the specified number of bytes.
+	// That allows data to be placed in the file by other means (e.g. by cloning a range of another
+	// file). The current position must be aligned.
+	bool FlushAndSkip(ULONGLONG size);
+
+	// Writes any remaining data and waits for all writes to finish. Since unbuffered writes have to
+	// be aligned, the final write may extend past the current position; the file is truncated
+	// afterwards, so that its size matches the amount of data written.
+	bool Finish();
+
+	// The total number of bytes committed, relative to the start of the file.
+	ULONGLONG GetPosition() const;
+
+private:
+	struct Buffer
+	{
+		wil::unique_virtualalloc_ptr<std::byte> data;
+		OverlappedOperation operation;
+	};
+
+	bool WriteCurrentBuffer(size_t size);
+	bool WaitForAllWrites();
+
+	const HANDLE m_file;
+	const size_t m_bufferSize;
+
+	std::vector<std::unique_ptr<Buffer>> m_buffers;
+	size_t m_currentBuffer = 0;
+	size_t m_currentBufferUsed = 0;
+
+	// The file offset at which the current buffer will be written.
+	ULONGLONG m_currentBufferOffset;
+
+	bool m_failed = false;
+};
\ No newline at end of file
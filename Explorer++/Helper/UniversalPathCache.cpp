@@ -0,0 +1,219 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "UniversalPathCache.h"
+#include <cwctype>
+
+namespace
+{
+
+// The number of characters at the start of a path (e.g. Z:\) that are replaced by the universal
+// name of the drive.
+size_t GetDrivePathLength(const std::wstring &path)
+{
+	return std::min<size_t>(path.size(), 3);
+}
+
+}
+
+UniversalPathCache::UniversalPathCache(QueryFunction query) : m_query(query)
+{
+}
+
+UniversalPathCache &UniversalPathCache::GetInstance()
+{
+	static UniversalPathCache universalPathCache;
+	return universalPathCache;
+}
+
+std::optional<std::wstring> UniversalPathCache::QueryUniversalName(const std::wstring &root)
+{
+	std::vector<BYTE> buffer(1024);
+
+	while (true)
+	{
+		auto bufferSize = static_cast<DWORD>(buffer.size());
+		DWORD res = WNetGetUniversalName(
+			root.c_str(), UNIVERSAL_NAME_INFO_LEVEL, buffer.data(), &bufferSize);
+
+		if (res == ERROR_MORE_DATA && bufferSize > buffer.size())
+		{
+			buffer.resize(bufferSize);
+			continue;
+		}
+
+		if (res != NO_ERROR)
+		{
+			return std::nullopt;
+		}
+
+		return reinterpret_cast<const UNIVERSAL_NAME_INFO *>(buffer.data())->lpUniversalName;
+	}
+}
+
+std::wstring UniversalPathCache::GetUniversalPath(const std::wstring &path)
+{
+	auto driveLetter = GetDriveLetter(path);
+
+	if (!driveLetter)
+	{
+		return path;
+	}
+
+	DrivePrefixes drivePrefixes;
+	drivePrefixes[*driveLetter] = GetDrivePrefix(*driveLetter);
+
+	std::wstring universalPath;
+	AppendUniversalPath(universalPath, path, drivePrefixes);
+
+	return universalPath;
+}
+
+std::wstring UniversalPathCache::GetUniversalPaths(
+	const std::vector<std::wstring> &paths, std::wstring_view separator)
+{
+	// Each drive is looked up once, regardless of how many of the paths it contains.
+	DrivePrefixes drivePrefixes;
+
+	for (const auto &path : paths)
+	{
+		auto driveLetter = GetDriveLetter(path);
+
+		if (driveLetter && !drivePrefixes.contains(*driveLetter))
+		{
+			drivePrefixes[*driveLetter] = GetDrivePrefix(*driveLetter);
+		}
+	}
+
+	size_t totalLength = 0;
+
+	for (const auto &path : paths)
+	{
+		totalLength += GetUniversalPathLength(path, drivePrefixes);
+	}
+
+	if (!paths.empty())
+	{
+		totalLength += (paths.size() - 1) * separator.size();
+	}
+
+	std::wstring output;
+	output.reserve(totalLength);
+
+	for (size_t i = 0; i < paths.size(); i++)
+	{
+		if (i != 0)
+		{
+			output += separator;
+		}
+
+		AppendUniversalPath(output, paths[i], drivePrefixes);
+	}
+
+	return output;
+}
+
+void UniversalPathCache::AppendUniversalPath(
+	std::wstring &output, const std::wstring &path, const DrivePrefixes &drivePrefixes)
+{
+	auto driveLetter = GetDriveLetter(path);
+
+	if (driveLetter)
+	{
+		const auto &prefix = drivePrefixes.at(*driveLetter);
+
+		if (prefix)
+		{
+			output += *prefix;
+			output.append(path, GetDrivePathLength(path));
+			return;
+		}
+	}
+
+	output += path;
+}
+
+size_t UniversalPathCache::GetUniversalPathLength(
+	const std::wstring &path, const DrivePrefixes &drivePrefixes)
+{
+	auto driveLetter = GetDriveLetter(path);
+
+	if (driveLetter)
+	{
+		const auto &prefix = drivePrefixes.at(*driveLetter);
+
+		if (prefix)
+		{
+			return prefix->size() + path.size() - GetDrivePathLength(path);
+		}
+	}
+
+	return path.size();
+}
+
+std::optional<std::wstring> UniversalPathCache::GetDrivePrefix(wchar_t driveLetter)
+{
+	{
+		std::scoped_lock lock(m_mutex);
+
+		auto itr = m_drivePrefixes.find(driveLetter);
+
+		if (itr != m_drivePrefixes.end())
+		{
+			return itr->second;
+		}
+	}
+
+	// The query is run without the lock being held, so that a slow network provider doesn't block
+	// lookups for other drives.
+	auto prefix = m_query(std::wstring(1, driveLetter) + L":\\");
+
+	if (prefix && (prefix->empty() || prefix->back() != '\\'))
+	{
+		*prefix += '\\';
+	}
+
+	std::scoped_lock lock(m_mutex);
+	m_drivePrefixes[driveLetter] = prefix;
+
+	return prefix;
+}
+
+// Returns the uppercase drive letter if the path is on a drive (e.g. Z:\Reports).
+std::optional<wchar_t> UniversalPathCache::GetDriveLetter(const std::wstring &path)
+{
+	if (path.size() < 2 || path[1] != ':' || (path.size() > 2 && path[2] != '\\'))
+	{
+		return std::nullopt;
+	}
+
+	wchar_t driveLetter = static_cast<wchar_t>(std::towupper(path[0]));
+
+	if (driveLetter < 'A' || driveLetter > 'Z')
+	{
+		return std::nullopt;
+	}
+
+	return driveLetter;
+}
+
+void UniversalPathCache::InvalidateDrive(const std::wstring &root)
+{
+	auto driveLetter = GetDriveLetter(root);
+
+	if (!driveLetter)
+	{
+		return;
+	}
+
+	std::scoped_lock lock(m_mutex);
+	m_drivePrefixes.erase(*driveLetter);
+}
+
+void UniversalPathCache::Clear()
+{
+	std::scoped_lock lock(m_mutex);
+	m_drivePrefixes.clear();
+}
\ No newline at end of file
@@ -0,0 +1,65 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Converts paths on mapped network drives (e.g. Z:\Reports\2021.xlsx) to their universal form
+// (e.g. \\server\share\Reports\2021.xlsx). Each call to WNetGetUniversalName() is a round trip
+// to the network provider, so rather than calling it once for each path, the universal name of each
+// drive is queried once and cached. Other paths on the drive are then converted by replacing the
+// drive prefix.
+//
+// Entries are kept until the drive is invalidated, which should happen whenever a drive is
+// connected or disconnected. Safe to use from multiple threads.
+class UniversalPathCache
+{
+public:
+	// Returns the universal name of the root of a drive (e.g. Z:\). Only replaced in tests.
+	using QueryFunction = std::function<std::optional<std::wstring>(const std::wstring &root)>;
+
+	explicit UniversalPathCache(QueryFunction query = QueryUniversalName);
+
+	static UniversalPathCache &GetInstance();
+
+	// Returns the path unchanged if it isn't on a mapped network drive.
+	std::wstring GetUniversalPath(const std::wstring &path);
+
+	// Converts each of the paths and joins the results using the separator. The output is built in
+	// a single allocation, so this is suitable for large numbers of paths.
+	std::wstring GetUniversalPaths(
+		const std::vector<std::wstring> &paths, std::wstring_view separator);
+
+	void InvalidateDrive(const std::wstring &root);
+	void Clear();
+
+private:
+	using DrivePrefixes = std::unordered_map<wchar_t, std::optional<std::wstring>>;
+
+	static std::optional<std::wstring> QueryUniversalName(const std::wstring &root);
+	static std::optional<wchar_t> GetDriveLetter(const std::wstring &path);
+	static void AppendUniversalPath(
+		std::wstring &output, const std::wstring &path, const DrivePrefixes &drivePrefixes);
+	static size_t GetUniversalPathLength(
+		const std::wstring &path, const DrivePrefixes &drivePrefixes);
+
+	// Returns the universal name of the root of the drive (ending in a backslash), or nothing if
+	// the drive isn't a mapped network drive.
+	std::optional<std::wstring> GetDrivePrefix(wchar_t driveLetter);
+
+	const QueryFunction m_query;
+
+	std::mutex m_mutex;
+
+	// Keyed by the (uppercase) drive letter. Drives that aren't mapped network drives are cached
+	// as well, so that they're only queried once.
+	DrivePrefixes m_drivePrefixes;
+};
\ No newline at end of file
@@ -0,0 +1,81 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "Utf8FileWriter.h"
+
+Utf8FileWriter::Utf8FileWriter(HANDLE file) : m_file(file)
+{
+	m_buffer.reserve(BUFFER_SIZE);
+}
+
+void Utf8FileWriter::WriteByteOrderMark()
+{
+	Write(L"\xFEFF");
+}
+
+void Utf8FileWriter::Write(std::wstring_view text)
+{
+	while (!text.empty())
+	{
+		size_t count = (std::min)(text.size(), BUFFER_SIZE - m_buffer.size());
+		m_buffer.append(text.substr(0, count));
+		text.remove_prefix(count);
+
+		if (m_buffer.size() == BUFFER_SIZE)
+		{
+			WriteBuffer(true);
+		}
+	}
+}
+
+bool Utf8FileWriter::Flush()
+{
+	WriteBuffer(false);
+	return !m_failed;
+}
+
+void Utf8FileWriter::WriteBuffer(bool holdBackPartialCharacter)
+{
+	if (m_buffer.empty() || m_failed)
+	{
+		m_buffer.clear();
+		return;
+	}
+
+	// A surrogate pair split across the end of the buffer has to be converted as a unit, so the
+	// leading half is held back until the next write.
+	size_t length = m_buffer.size();
+	std::wstring heldBack;
+
+	if (holdBackPartialCharacter && IS_HIGH_SURROGATE(m_buffer.back()))
+	{
+		length--;
+		heldBack = m_buffer.back();
+	}
+
+	// Each UTF-16 code unit converts to at most 3 bytes of UTF-8.
+	m_convertedBuffer.resize(length * 3);
+
+	int convertedLength = WideCharToMultiByte(CP_UTF8, 0, m_buffer.data(),
+		static_cast<int>(length), m_convertedBuffer.data(),
+		static_cast<int>(m_convertedBuffer.size()), nullptr, nullptr);
+
+	m_buffer = heldBack;
+
+	if (length > 0 && convertedLength == 0)
+	{
+		m_failed = true;
+		return;
+	}
+
+	DWORD numBytesWritten;
+	BOOL res = WriteFile(m_file, m_convertedBuffer.data(), convertedLength, &numBytesWritten,
+		nullptr);
+
+	if (!res || numBytesWritten != static_cast<DWORD>(convertedLength))
+	{
+		m_failed = true;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,33 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <string>
+#include <string_view>
+
+// Writes UTF-16 text out to a file as UTF-8. The text is buffered and converted in large chunks,
+// so that writing many small strings doesn't result in a correspondingly large number of calls to
+// WriteFile().
+class Utf8FileWriter
+{
+public:
+	explicit Utf8FileWriter(HANDLE file);
+
+	void WriteByteOrderMark();
+	void Write(std::wstring_view text);
+
+	// Writes out any buffered text. Returns false if any write (including earlier writes) failed.
+	bool Flush();
+
+private:
+	void WriteBuffer(bool holdBackPartialCharacter);
+
+	static constexpr size_t BUFFER_SIZE = 64 * 1024;
+
+	const HANDLE m_file;
+	std::wstring m_buffer;
+	std::string m_convertedBuffer;
+	bool m_failed = false;
+};
\ No newline at end of file
@@ -0,0 +1,20 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <uxtheme.h>
+
+// As with WinUserBackwardsCompatibility.h, the declarations below are copied from Uxtheme.h, so
+// that functions that don't exist in the minimum supported version of Windows can be called
+// dynamically.
+
+// clang-format off
+HTHEME
+WINAPI
+OpenThemeDataForDpi(
+	_In_opt_ HWND hwnd,
+	_In_ LPCWSTR pszClassList,
+	_In_ UINT dpi);
+// clang-format on
\ No newline at end of file
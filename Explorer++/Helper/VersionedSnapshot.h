@@ -0,0 +1,44 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <memory>
+
+// Holds an immutable copy of a value (typically a set of settings) that can be shared by any
+// number of background tasks. Each task captures the pointer returned by Update(), rather than
+// copying the value itself. The copy is only replaced when the value changes, at which point the
+// version is incremented. Tasks can record the version they were given, so that results computed
+// from an out-of-date copy can be detected and discarded.
+template <typename T>
+class VersionedSnapshot
+{
+public:
+	struct Snapshot
+	{
+		int version;
+		T value;
+	};
+
+	// Returns the current snapshot, first replacing it if it doesn't match the specified value.
+	std::shared_ptr<const Snapshot> Update(const T &value)
+	{
+		if (!m_snapshot || !(m_snapshot->value == value))
+		{
+			m_snapshot = std::make_shared<const Snapshot>(Snapshot{ m_nextVersion++, value });
+		}
+
+		return m_snapshot;
+	}
+
+	// Returns true if the version is that of the current snapshot.
+	bool IsCurrent(int version) const
+	{
+		return m_snapshot && m_snapshot->version == version;
+	}
+
+private:
+	std::shared_ptr<const Snapshot> m_snapshot;
+	int m_nextVersion = 0;
+};
\ No newline at end of file
@@ -0,0 +1,455 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "VirtualFileExtraction.h"
+#include "ParallelWalk.h"
+#include <wil/com.h>
+#include <wil/resource.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <string_view>
+
+namespace
+{
+
+// Streams are copied in blocks of this size, which keeps the number of (potentially cross-process)
+// calls to IStream::Read() low.
+const ULONG COPY_BUFFER_SIZE = 1024 * 1024;
+
+struct VirtualFile
+{
+	LONG index;
+	std::wstring path;
+	std::wstring topLevelName;
+	std::optional<ULONGLONG> size;
+	std::optional<FILETIME> lastWriteTime;
+};
+
+struct ExtractionState
+{
+	DWORD dataObjectCookie;
+	CLIPFORMAT fileContentsFormat;
+
+	std::atomic<ULONGLONG> bytesWritten = 0;
+	std::atomic<int> filesExtracted = 0;
+	std::atomic<int> filesFailed = 0;
+	std::atomic<HRESULT> firstError = S_OK;
+};
+
+FORMATETC GetFileDescriptorFormatEtc()
+{
+	static FORMATETC formatEtc = {
+		static_cast<CLIPFORMAT>(RegisterClipboardFormat(CFSTR_FILEDESCRIPTORW)), nullptr,
+		DVASPECT_CONTENT, -1, TYMED_HGLOBAL
+	};
+	return formatEtc;
+}
+
+CLIPFORMAT GetFileContentsFormat()
+{
+	static CLIPFORMAT format =
+		static_cast<CLIPFORMAT>(RegisterClipboardFormat(CFSTR_FILECONTENTS));
+	return format;
+}
+
+// The names in a file descriptor are relative paths, which come from another application. A name
+// that would result in an item being created outside the destination folder is rejected.
+bool IsSafeRelativePath(const std::wstring &path)
+{
+	if (path.empty() || path[0] == '\\' || path[0] == '/'
+		|| path.find(':') != std::wstring::npos)
+	{
+		return false;
+	}
+
+	size_t start = 0;
+
+	while (start <= path.size())
+	{
+		size_t end = path.find_first_of(L"\\/", start);
+
+		if (end == std::wstring::npos)
+		{
+			end = path.size();
+		}
+
+		std::wstring_view component(path.data() + start, end - start);
+
+		if (component.empty() || component == L"." || component == L"..")
+		{
+			return false;
+		}
+
+		start = end + 1;
+	}
+
+	return true;
+}
+
+std::wstring GetTopLevelName(const std::wstring &path)
+{
+	return path.substr(0, path.find_first_of(L"\\/"));
+}
+
+void RecordError(ExtractionState &state, HRESULT hr)
+{
+	state.filesFailed++;
+
+	HRESULT expected = S_OK;
+	state.firstError.compare_exchange_strong(expected, hr);
+}
+
+HRESULT CopyStreamToFile(IStream *stream, HANDLE file, ExtractionState &state,
+	std::stop_token stopToken)
+{
+	auto buffer = std::make_unique<BYTE[]>(COPY_BUFFER_SIZE);
+
+	while (!stopToken.stop_requested())
+	{
+		ULONG bytesRead = 0;
+		HRESULT hr = stream->Read(buffer.get(), COPY_BUFFER_SIZE, &bytesRead);
+
+		if (FAILED(hr))
+		{
+			return hr;
+		}
+
+		if (bytesRead == 0)
+		{
+			break;
+		}
+
+		DWORD bytesWritten;
+
+		if (!WriteFile(file, buffer.get(), bytesRead, &bytesWritten, nullptr))
+		{
+			return HRESULT_FROM_WIN32(GetLastError());
+		}
+
+		state.bytesWritten += bytesWritten;
+
+		if (hr == S_FALSE)
+		{
+			break;
+		}
+	}
+
+	return stopToken.stop_requested() ? HRESULT_FROM_WIN32(ERROR_CANCELLED) : S_OK;
+}
+
+HRESULT CopyGlobalToFile(HGLOBAL global, const VirtualFile &virtualFile, HANDLE file,
+	ExtractionState &state)
+{
+	wil::unique_hglobal_locked mem(global);
+
+	if (!mem)
+	{
+		return E_FAIL;
+	}
+
+	// The size of the allocation can be larger than the size of the file, so the size from the
+	// descriptor is preferred, where it's available.
+	SIZE_T size = GlobalSize(global);
+
+	if (virtualFile.size)
+	{
+		size = static_cast<SIZE_T>((std::min)(static_cast<ULONGLONG>(size), *virtualFile.size));
+	}
+
+	auto *data = static_cast<const BYTE *>(mem.get());
+
+	while (size > 0)
+	{
+		auto chunkSize =
+			static_cast<DWORD>((std::min)(size, static_cast<SIZE_T>(COPY_BUFFER_SIZE)));
+		DWORD bytesWritten;
+
+		if (!WriteFile(file, data, chunkSize, &bytesWritten, nullptr))
+		{
+			return HRESULT_FROM_WIN32(GetLastError());
+		}
+
+		state.bytesWritten += bytesWritten;
+		data += bytesWritten;
+		size -= bytesWritten;
+	}
+
+	return S_OK;
+}
+
+HRESULT ExtractFile(const VirtualFile &virtualFile, ExtractionState &state,
+	std::stop_token stopToken)
+{
+	// The worker threads are placed in the multithreaded apartment. The calling thread will already
+	// have initialized COM, in which case this call fails, which is harmless.
+	HRESULT hrInitialize = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+	auto uninitialize = wil::scope_exit([hrInitialize]() {
+		if (SUCCEEDED(hrInitialize))
+		{
+			CoUninitialize();
+		}
+	});
+
+	wil::com_ptr_nothrow<IGlobalInterfaceTable> globalInterfaceTable;
+	RETURN_IF_FAILED(CoCreateInstance(CLSID_StdGlobalInterfaceTable, nullptr,
+		CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&globalInterfaceTable)));
+
+	wil::com_ptr_nothrow<IDataObject> dataObject;
+	RETURN_IF_FAILED(globalInterfaceTable->GetInterfaceFromGlobal(state.dataObjectCookie,
+		IID_PPV_ARGS(&dataObject)));
+
+	FORMATETC formatEtc = { state.fileContentsFormat, nullptr, DVASPECT_CONTENT,
+		virtualFile.index, TYMED_ISTREAM | TYMED_HGLOBAL };
+	wil::unique_stg_medium stgMedium;
+	RETURN_IF_FAILED(dataObject->GetData(&formatEtc, &stgMedium));
+
+	if (stgMedium.tymed != TYMED_ISTREAM && stgMedium.tymed != TYMED_HGLOBAL)
+	{
+		return DV_E_TYMED;
+	}
+
+	wil::unique_hfile file(CreateFile(virtualFile.path.c_str(), GENERIC_WRITE, 0, nullptr,
+		CREATE_NEW, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+
+	if (!file)
+	{
+		return HRESULT_FROM_WIN32(GetLastError());
+	}
+
+	if (virtualFile.size)
+	{
+		// Setting the size up front allows the file system to allocate the space in one go.
+		FILE_END_OF_FILE_INFO endOfFileInfo;
+		endOfFileInfo.EndOfFile.QuadPart = *virtualFile.size;
+		SetFileInformationByHandle(
+			file.get(), FileEndOfFileInfo, &endOfFileInfo, sizeof(endOfFileInfo));
+	}
+
+	HRESULT hr;
+
+	if (stgMedium.tymed == TYMED_ISTREAM)
+	{
+		hr = CopyStreamToFile(stgMedium.pstm, file.get(), state, stopToken);
+	}
+	else
+	{
+		hr = CopyGlobalToFile(stgMedium.hGlobal, virtualFile, file.get(), state);
+	}
+
+	if (SUCCEEDED(hr))
+	{
+		// The size reported by the descriptor may have been wrong, so the file is truncated to
+		// the amount actually written.
+		if (!SetEndOfFile(file.get()))
+		{
+			hr = HRESULT_FROM_WIN32(GetLastError());
+		}
+	}
+
+	if (SUCCEEDED(hr) && virtualFile.lastWriteTime)
+	{
+		SetFileTime(file.get(), nullptr, nullptr, &*virtualFile.lastWriteTime);
+	}
+
+	if (FAILED(hr))
+	{
+		// A partially written file isn't of any use.
+		file.reset();
+		DeleteFile(virtualFile.path.c_str());
+	}
+
+	return hr;
+}
+
+}
+
+bool HasVirtualFiles(IDataObject *dataObject)
+{
+	FORMATETC formatEtc = GetFileDescriptorFormatEtc();
+	return dataObject->QueryGetData(&formatEtc) == S_OK;
+}
+
+VirtualFileExtractionResult ExtractVirtualFiles(IDataObject *dataObject,
+	const std::wstring &destinationFolder, std::stop_token stopToken,
+	const VirtualFileExtractionProgressCallback &progressCallback)
+{
+	VirtualFileExtractionResult result;
+
+	FORMATETC formatEtc = GetFileDescriptorFormatEtc();
+	wil::unique_stg_medium stgMedium;
+	HRESULT hr = dataObject->GetData(&formatEtc, &stgMedium);
+
+	if (FAILED(hr))
+	{
+		result.firstError = hr;
+		return result;
+	}
+
+	wil::unique_hglobal_locked mem(stgMedium.hGlobal);
+
+	if (!mem || GlobalSize(stgMedium.hGlobal) < sizeof(FILEGROUPDESCRIPTORW))
+	{
+		result.firstError = E_FAIL;
+		return result;
+	}
+
+	auto *groupDescriptor = static_cast<const FILEGROUPDESCRIPTORW *>(mem.get());
+	SIZE_T maxItems = (GlobalSize(stgMedium.hGlobal) - offsetof(FILEGROUPDESCRIPTORW, fgd))
+		/ sizeof(FILEDESCRIPTORW);
+	UINT numItems = static_cast<UINT>(
+		(std::min)(static_cast<SIZE_T>(groupDescriptor->cItems), maxItems));
+
+	ExtractionState state;
+	state.fileContentsFormat = GetFileContentsFormat();
+
+	std::vector<VirtualFile> files;
+	ULONGLONG totalBytes = 0;
+
+	// Folders are listed before their contents, so they're all created here, in order, before any
+	// of the files are written.
+	for (UINT i = 0; i < numItems; i++)
+	{
+		const FILEDESCRIPTORW &descriptor = groupDescriptor->fgd[i];
+		std::wstring name(descriptor.cFileName,
+			wcsnlen(descriptor.cFileName, std::size(descriptor.cFileName)));
+
+		if (!IsSafeRelativePath(name))
+		{
+			RecordError(state, HRESULT_FROM_WIN32(ERROR_INVALID_NAME));
+			continue;
+		}
+
+		std::wstring path = destinationFolder;
+
+		if (!path.empty() && path.back() != '\\')
+		{
+			path += L"\\";
+		}
+
+		path += name;
+
+		bool isFolder = WI_IsFlagSet(descriptor.dwFlags, FD_ATTRIBUTES)
+			&& WI_IsFlagSet(descriptor.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY);
+
+		if (isFolder)
+		{
+			// This will also create any parent folders that weren't explicitly listed.
+			int res = SHCreateDirectoryEx(nullptr, path.c_str(), nullptr);
+
+			if (res != ERROR_SUCCESS && res != ERROR_ALREADY_EXISTS)
+			{
+				RecordError(state, HRESULT_FROM_WIN32(res));
+				continue;
+			}
+
+			std::wstring topLevelName = GetTopLevelName(name);
+
+			if (std::find(result.createdItems.begin(), result.createdItems.end(), topLevelName)
+				== result.createdItems.end())
+			{
+				result.createdItems.push_back(topLevelName);
+			}
+
+			continue;
+		}
+
+		VirtualFile file;
+		file.index = static_cast<LONG>(i);
+		file.path = path;
+		file.topLevelName = GetTopLevelName(name);
+
+		if (WI_IsFlagSet(descriptor.dwFlags, FD_FILESIZE))
+		{
+			ULARGE_INTEGER size;
+			size.LowPart = descriptor.nFileSizeLow;
+			size.HighPart = descriptor.nFileSizeHigh;
+			file.size = size.QuadPart;
+			totalBytes += size.QuadPart;
+		}
+
+		if (WI_IsFlagSet(descriptor.dwFlags, FD_WRITESTIME))
+		{
+			file.lastWriteTime = descriptor.ftLastWriteTime;
+		}
+
+		files.push_back(file);
+	}
+
+	mem.reset();
+	stgMedium.reset();
+
+	int totalFiles = static_cast<int>(files.size());
+
+	wil::com_ptr_nothrow<IGlobalInterfaceTable> globalInterfaceTable;
+	hr = CoCreateInstance(CLSID_StdGlobalInterfaceTable, nullptr, CLSCTX_INPROC_SERVER,
+		IID_PPV_ARGS(&globalInterfaceTable));
+
+	if (SUCCEEDED(hr))
+	{
+		hr = globalInterfaceTable->RegisterInterfaceInGlobal(
+			dataObject, IID_IDataObject, &state.dataObjectCookie);
+	}
+
+	if (FAILED(hr))
+	{
+		result.filesFailed = state.filesFailed + totalFiles;
+		result.firstError = (state.firstError == S_OK) ? hr : state.firstError.load();
+		return result;
+	}
+
+	std::mutex createdItemsMutex;
+
+	auto reportProgress = [&state, totalBytes, totalFiles, &progressCallback]() {
+		if (!progressCallback)
+		{
+			return;
+		}
+
+		VirtualFileExtractionProgress progress;
+		progress.bytesWritten = state.bytesWritten;
+		progress.totalBytes = (std::max)(totalBytes, progress.bytesWritten);
+		progress.filesExtracted = state.filesExtracted;
+		progress.totalFiles = totalFiles;
+		progressCallback(progress);
+	};
+
+	ParallelWalk<VirtualFile>::Run(
+		std::move(files),
+		[&state, &result, &createdItemsMutex, stopToken](const VirtualFile &file,
+			ParallelWalk<VirtualFile>::Worker &worker) {
+			UNREFERENCED_PARAMETER(worker);
+
+			HRESULT hrExtract = ExtractFile(file, state, stopToken);
+
+			if (FAILED(hrExtract))
+			{
+				RecordError(state, hrExtract);
+				return;
+			}
+
+			state.filesExtracted++;
+
+			std::scoped_lock lock(createdItemsMutex);
+
+			if (std::find(result.createdItems.begin(), result.createdItems.end(),
+					file.topLevelName)
+				== result.createdItems.end())
+			{
+				result.createdItems.push_back(file.topLevelName);
+			}
+		},
+		stopToken, reportProgress);
+
+	reportProgress();
+
+	globalInterfaceTable->RevokeInterfaceFromGlobal(state.dataObjectCookie);
+
+	result.filesExtracted = state.filesExtracted;
+	result.filesFailed = state.filesFailed;
+	result.firstError = state.firstError;
+	return result;
+}
\ No newline at end of file
@@ -0,0 +1,54 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <functional>
+#include <stop_token>
+#include <string>
+#include <vector>
+
+struct VirtualFileExtractionProgress
+{
+	ULONGLONG bytesWritten;
+
+	// Not every source reports the size of each file, so this may be an underestimate.
+	ULONGLONG totalBytes;
+
+	int filesExtracted;
+	int totalFiles;
+};
+
+struct VirtualFileExtractionResult
+{
+	// The top-level items that were created in the destination folder (i.e. files, or folders
+	// that contain extracted files). Only the names of the items are included.
+	std::vector<std::wstring> createdItems;
+
+	int filesExtracted = 0;
+	int filesFailed = 0;
+	HRESULT firstError = S_OK;
+};
+
+// Invoked periodically on the calling thread while files are being extracted.
+using VirtualFileExtractionProgressCallback =
+	std::function<void(const VirtualFileExtractionProgress &progress)>;
+
+// Returns true if the data object contains virtual files (i.e. CFSTR_FILEDESCRIPTOR and
+// CFSTR_FILECONTENTS), as offered by sources such as email attachments and the contents of zip
+// files.
+bool HasVirtualFiles(IDataObject *dataObject);
+
+// Writes each of the virtual files within the data object out to the destination folder. Any
+// folders described by the data object are created first. The contents of the files are then
+// retrieved in parallel, using the threads shared with ParallelWalk, with each stream being copied
+// using large reads and writes.
+//
+// This must be called on a thread that has initialized COM. The data object is accessed from the
+// worker threads through the global interface table, so if the calling thread is a
+// single-threaded apartment, the progress callback should pump messages. Existing files are never
+// overwritten. If a stop is requested, files already written are left in place.
+VirtualFileExtractionResult ExtractVirtualFiles(IDataObject *dataObject,
+	const std::wstring &destinationFolder, std::stop_token stopToken = {},
+	const VirtualFileExtractionProgressCallback &progressCallback = nullptr);
\ No newline at end of file
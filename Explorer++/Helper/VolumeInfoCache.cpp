@@ -0,0 +1,160 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "VolumeInfoCache.h"
+#include "DriveInfo.h"
+#include "Macros.h"
+
+VolumeInfoCache::VolumeInfoCache(
+	Clock::duration timeToLive, const Queries &queries, NowFunction nowFunction) :
+	m_timeToLive(timeToLive),
+	m_queries(queries),
+	m_nowFunction(nowFunction)
+{
+}
+
+VolumeInfoCache &VolumeInfoCache::GetInstance()
+{
+	static VolumeInfoCache volumeInfoCache(DEFAULT_TIME_TO_LIVE);
+	return volumeInfoCache;
+}
+
+VolumeInfoCache::Queries VolumeInfoCache::GetDefaultQueries()
+{
+	Queries queries;
+
+	queries.getClusterSize = [](const std::wstring &root) -> std::optional<DWORD>
+	{
+		DWORD clusterSize;
+		BOOL res = ::GetClusterSize(root.c_str(), &clusterSize);
+
+		if (!res || clusterSize == 0)
+		{
+			return std::nullopt;
+		}
+
+		return clusterSize;
+	};
+
+	queries.getFileSystemName = [](const std::wstring &root) -> std::optional<std::wstring>
+	{
+		TCHAR fileSystemName[MAX_PATH];
+		BOOL res = GetVolumeInformation(root.c_str(), nullptr, 0, nullptr, nullptr, nullptr,
+			fileSystemName, SIZEOF_ARRAY(fileSystemName));
+
+		if (!res)
+		{
+			return std::nullopt;
+		}
+
+		return fileSystemName;
+	};
+
+	queries.getSpaceInfo = [](const std::wstring &root) -> std::optional<SpaceInfo>
+	{
+		SpaceInfo spaceInfo;
+		BOOL res =
+			GetDiskFreeSpaceEx(root.c_str(), nullptr, &spaceInfo.totalBytes, &spaceInfo.freeBytes);
+
+		if (!res || spaceInfo.totalBytes.QuadPart == 0)
+		{
+			return std::nullopt;
+		}
+
+		return spaceInfo;
+	};
+
+	return queries;
+}
+
+std::optional<DWORD> VolumeInfoCache::GetClusterSize(const std::wstring &root)
+{
+	return GetValue(root, &VolumeEntry::clusterSize, m_queries.getClusterSize);
+}
+
+std::optional<std::wstring> VolumeInfoCache::GetFileSystemName(const std::wstring &root)
+{
+	return GetValue(root, &VolumeEntry::fileSystemName, m_queries.getFileSystemName);
+}
+
+std::optional<VolumeInfoCache::SpaceInfo> VolumeInfoCache::GetSpaceInfo(const std::wstring &root)
+{
+	return GetValue(root, &VolumeEntry::spaceInfo, m_queries.getSpaceInfo);
+}
+
+template <typename T>
+std::optional<T> VolumeInfoCache::GetValue(const std::wstring &root,
+	std::optional<CachedValue<T>> VolumeEntry::*member,
+	const std::function<std::optional<T>(const std::wstring &root)> &query)
+{
+	auto normalizedRoot = NormalizeRoot(root);
+	auto key = GetKey(normalizedRoot);
+
+	{
+		std::scoped_lock lock(m_mutex);
+
+		const auto &cachedValue = m_entries[key].*member;
+
+		if (cachedValue && m_nowFunction() < cachedValue->expiryTime)
+		{
+			return cachedValue->value;
+		}
+	}
+
+	// If multiple threads request the same value at the same time, each may query the volume. That
+	// only happens once per expiry period, though.
+	auto value = query(normalizedRoot);
+
+	std::scoped_lock lock(m_mutex);
+	m_entries[key].*member = CachedValue<T>{ value, m_nowFunction() + m_timeToLive };
+
+	return value;
+}
+
+void VolumeInfoCache::InvalidateVolume(const std::wstring &root)
+{
+	std::scoped_lock lock(m_mutex);
+	m_entries.erase(GetKey(NormalizeRoot(root)));
+}
+
+void VolumeInfoCache::Clear()
+{
+	std::scoped_lock lock(m_mutex);
+	m_entries.clear();
+}
+
+std::optional<std::wstring> VolumeInfoCache::GetRoot(const std::wstring &path)
+{
+	std::wstring root = path;
+
+	if (!PathStripToRoot(root.data()))
+	{
+		return std::nullopt;
+	}
+
+	root.resize(wcslen(root.c_str()));
+
+	return NormalizeRoot(root);
+}
+
+// The volume functions require the root of a share to end with a backslash (e.g.
+// \\server\share\), though PathStripToRoot() and PathIsRoot() don't.
+std::wstring VolumeInfoCache::NormalizeRoot(const std::wstring &root)
+{
+	if (root.empty() || root.back() == '\\')
+	{
+		return root;
+	}
+
+	return root + L'\\';
+}
+
+std::wstring VolumeInfoCache::GetKey(const std::wstring &normalizedRoot)
+{
+	std::wstring key = normalizedRoot;
+	CharLowerBuff(key.data(), static_cast<DWORD>(key.size()));
+
+	return key;
+}
\ No newline at end of file
@@ -0,0 +1,100 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <windows.h>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+// Caches information about each volume, keyed by the root of the volume (e.g. C:\ or
+// \\server\share\). Columns such as the real size column need the cluster size of the volume
+// containing each item and would otherwise query the volume once per item.
+//
+// Each value expires once the time-to-live has passed, so that changes (in particular, changes to
+// the amount of free space) are eventually picked up. Failed queries are cached as well, so that an
+// unavailable volume (e.g. an empty removable drive) isn't queried repeatedly.
+//
+// Safe to use from multiple threads. The volume itself is queried without the lock being held, so
+// a slow volume doesn't block lookups for other volumes.
+class VolumeInfoCache
+{
+public:
+	using Clock = std::chrono::steady_clock;
+	using NowFunction = std::function<Clock::time_point()>;
+
+	struct SpaceInfo
+	{
+		ULARGE_INTEGER totalBytes;
+		ULARGE_INTEGER freeBytes;
+	};
+
+	// The functions used to query a volume. These are only replaced in tests.
+	struct Queries
+	{
+		std::function<std::optional<DWORD>(const std::wstring &root)> getClusterSize;
+		std::function<std::optional<std::wstring>(const std::wstring &root)> getFileSystemName;
+		std::function<std::optional<SpaceInfo>(const std::wstring &root)> getSpaceInfo;
+	};
+
+	VolumeInfoCache(Clock::duration timeToLive, const Queries &queries = GetDefaultQueries(),
+		NowFunction nowFunction = Clock::now);
+
+	static VolumeInfoCache &GetInstance();
+
+	// Each of these accepts the root of a volume (including a mounted folder, such as one returned
+	// by GetVolumePathName()).
+	std::optional<DWORD> GetClusterSize(const std::wstring &root);
+	std::optional<std::wstring> GetFileSystemName(const std::wstring &root);
+	std::optional<SpaceInfo> GetSpaceInfo(const std::wstring &root);
+
+	// Should be called when a volume is added or removed (e.g. when media is inserted into a
+	// drive), since its information will typically have changed.
+	void InvalidateVolume(const std::wstring &root);
+
+	void Clear();
+
+	// Returns the drive or share that contains the path (e.g. C:\ for C:\Windows), without
+	// accessing the filesystem. Mounted folders aren't detected, so the result is the root of the
+	// volume the mounted folder appears on.
+	static std::optional<std::wstring> GetRoot(const std::wstring &path);
+
+private:
+	// The free space on a volume can change at any time, so values are only kept briefly.
+	static constexpr auto DEFAULT_TIME_TO_LIVE = std::chrono::seconds(2);
+
+	template <typename T>
+	struct CachedValue
+	{
+		std::optional<T> value;
+		Clock::time_point expiryTime;
+	};
+
+	struct VolumeEntry
+	{
+		std::optional<CachedValue<DWORD>> clusterSize;
+		std::optional<CachedValue<std::wstring>> fileSystemName;
+		std::optional<CachedValue<SpaceInfo>> spaceInfo;
+	};
+
+	static Queries GetDefaultQueries();
+	static std::wstring NormalizeRoot(const std::wstring &root);
+	static std::wstring GetKey(const std::wstring &normalizedRoot);
+
+	template <typename T>
+	std::optional<T> GetValue(const std::wstring &root,
+		std::optional<CachedValue<T>> VolumeEntry::*member,
+		const std::function<std::optional<T>(const std::wstring &root)> &query);
+
+	const Clock::duration m_timeToLive;
+	const Queries m_queries;
+	const NowFunction m_nowFunction;
+
+	std::mutex m_mutex;
+	std::unordered_map<std::wstring, VolumeEntry> m_entries;
+};
\ No newline at end of file
@@ -0,0 +1,288 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "WicImageLoader.h"
+#include "ImageHelper.h"
+#include <wil/com.h>
+#include <wincodec.h>
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+
+wil::com_ptr_nothrow<IWICBitmapFrameDecode> GetFirstFrame(
+	IWICImagingFactory *factory, const std::wstring &path)
+{
+	wil::com_ptr_nothrow<IWICBitmapDecoder> decoder;
+	HRESULT hr = factory->CreateDecoderFromFilename(path.c_str(), nullptr, GENERIC_READ,
+		WICDecodeMetadataCacheOnDemand, &decoder);
+
+	if (FAILED(hr))
+	{
+		return nullptr;
+	}
+
+	wil::com_ptr_nothrow<IWICBitmapFrameDecode> frame;
+	hr = decoder->GetFrame(0, &frame);
+
+	if (FAILED(hr))
+	{
+		return nullptr;
+	}
+
+	return frame;
+}
+
+UINT GetBitsPerPixel(IWICImagingFactory *factory, REFWICPixelFormatGUID pixelFormat)
+{
+	wil::com_ptr_nothrow<IWICComponentInfo> componentInfo;
+	HRESULT hr = factory->CreateComponentInfo(pixelFormat, &componentInfo);
+
+	if (FAILED(hr))
+	{
+		return 0;
+	}
+
+	auto pixelFormatInfo = componentInfo.try_query<IWICPixelFormatInfo>();
+
+	if (!pixelFormatInfo)
+	{
+		return 0;
+	}
+
+	UINT bitsPerPixel;
+	hr = pixelFormatInfo->GetBitsPerPixel(&bitsPerPixel);
+
+	if (FAILED(hr))
+	{
+		return 0;
+	}
+
+	return bitsPerPixel;
+}
+
+// Decodes the frame at (or near) the specified size, using the codec's own scaling. Codecs such as
+// JPEG can decode directly to a fraction of the full size, which is significantly faster than
+// decoding the full image. Returns nullptr if the codec can't scale the image.
+wil::com_ptr_nothrow<IWICBitmapSource> DecodeWithSourceTransform(
+	IWICImagingFactory *factory, IWICBitmapFrameDecode *frame, UINT width, UINT height)
+{
+	wil::com_ptr_nothrow<IWICBitmapSourceTransform> sourceTransform;
+	HRESULT hr = frame->QueryInterface(IID_PPV_ARGS(&sourceTransform));
+
+	if (FAILED(hr))
+	{
+		return nullptr;
+	}
+
+	UINT closestWidth = width;
+	UINT closestHeight = height;
+	hr = sourceTransform->GetClosestSize(&closestWidth, &closestHeight);
+
+	if (FAILED(hr) || closestWidth == 0 || closestHeight == 0)
+	{
+		return nullptr;
+	}
+
+	WICPixelFormatGUID pixelFormat = GUID_WICPixelFormat32bppBGRA;
+	hr = sourceTransform->GetClosestPixelFormat(&pixelFormat);
+
+	if (FAILED(hr)
+		|| (pixelFormat != GUID_WICPixelFormat32bppBGRA
+			&& pixelFormat != GUID_WICPixelFormat32bppBGR))
+	{
+		return nullptr;
+	}
+
+	UINT stride = closestWidth * 4;
+	std::vector<BYTE> pixels(static_cast<size_t>(stride) * closestHeight);
+	hr = sourceTransform->CopyPixels(nullptr, closestWidth, closestHeight, &pixelFormat,
+		WICBitmapTransformRotate0, stride, static_cast<UINT>(pixels.size()), pixels.data());
+
+	if (FAILED(hr))
+	{
+		return nullptr;
+	}
+
+	wil::com_ptr_nothrow<IWICBitmap> bitmap;
+	hr = factory->CreateBitmapFromMemory(closestWidth, closestHeight, pixelFormat, stride,
+		static_cast<UINT>(pixels.size()), pixels.data(), &bitmap);
+
+	if (FAILED(hr))
+	{
+		return nullptr;
+	}
+
+	return bitmap;
+}
+
+}
+
+namespace WicImageLoader
+{
+
+std::optional<ImageInfo> GetImageInfo(const std::wstring &path)
+{
+	wil::com_ptr_nothrow<IWICImagingFactory> factory;
+	HRESULT hr = CoCreateInstance(
+		CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory));
+
+	if (FAILED(hr))
+	{
+		return std::nullopt;
+	}
+
+	auto frame = GetFirstFrame(factory.get(), path);
+
+	if (!frame)
+	{
+		return std::nullopt;
+	}
+
+	ImageInfo info;
+	hr = frame->GetSize(&info.width, &info.height);
+
+	if (FAILED(hr))
+	{
+		return std::nullopt;
+	}
+
+	hr = frame->GetResolution(&info.horizontalResolution, &info.verticalResolution);
+
+	if (FAILED(hr))
+	{
+		info.horizontalResolution = 0;
+		info.verticalResolution = 0;
+	}
+
+	WICPixelFormatGUID pixelFormat;
+	hr = frame->GetPixelFormat(&pixelFormat);
+	info.bitsPerPixel = SUCCEEDED(hr) ? GetBitsPerPixel(factory.get(), pixelFormat) : 0;
+
+	return info;
+}
+
+wil::unique_hbitmap LoadImageAtSize(const std::wstring &path, int maxWidth, int maxHeight)
+{
+	if (maxWidth <= 0 || maxHeight <= 0)
+	{
+		return nullptr;
+	}
+
+	wil::com_ptr_nothrow<IWICImagingFactory> factory;
+	HRESULT hr = CoCreateInstance(
+		CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory));
+
+	if (FAILED(hr))
+	{
+		return nullptr;
+	}
+
+	auto frame = GetFirstFrame(factory.get(), path);
+
+	if (!frame)
+	{
+		return nullptr;
+	}
+
+	UINT originalWidth;
+	UINT originalHeight;
+	hr = frame->GetSize(&originalWidth, &originalHeight);
+
+	if (FAILED(hr) || originalWidth == 0 || originalHeight == 0)
+	{
+		return nullptr;
+	}
+
+	double scale = (std::min)({ 1.0, static_cast<double>(maxWidth) / originalWidth,
+		static_cast<double>(maxHeight) / originalHeight });
+	UINT width = (std::max)(1u, static_cast<UINT>(originalWidth * scale));
+	UINT height = (std::max)(1u, static_cast<UINT>(originalHeight * scale));
+
+	wil::com_ptr_nothrow<IWICBitmapSource> source;
+
+	if (width < originalWidth || height < originalHeight)
+	{
+		source = DecodeWithSourceTransform(factory.get(), frame.get(), width, height);
+	}
+
+	if (!source)
+	{
+		source = frame;
+	}
+
+	UINT sourceWidth;
+	UINT sourceHeight;
+	hr = source->GetSize(&sourceWidth, &sourceHeight);
+
+	if (FAILED(hr))
+	{
+		return nullptr;
+	}
+
+	// The codec may only be able to scale to a size close to the one requested, so any remaining
+	// scaling is done here.
+	if (sourceWidth != width || sourceHeight != height)
+	{
+		wil::com_ptr_nothrow<IWICBitmapScaler> scaler;
+		hr = factory->CreateBitmapScaler(&scaler);
+
+		if (FAILED(hr))
+		{
+			return nullptr;
+		}
+
+		hr = scaler->Initialize(source.get(), width, height, WICBitmapInterpolationModeFant);
+
+		if (FAILED(hr))
+		{
+			return nullptr;
+		}
+
+		source = scaler;
+	}
+
+	wil::com_ptr_nothrow<IWICFormatConverter> converter;
+	hr = factory->CreateFormatConverter(&converter);
+
+	if (FAILED(hr))
+	{
+		return nullptr;
+	}
+
+	hr = converter->Initialize(source.get(), GUID_WICPixelFormat32bppPBGRA,
+		WICBitmapDitherTypeNone, nullptr, 0.0, WICBitmapPaletteTypeCustom);
+
+	if (FAILED(hr))
+	{
+		return nullptr;
+	}
+
+	// A negative height results in a top-down bitmap.
+	BITMAPINFO bmi;
+	ImageHelper::InitBitmapInfo(&bmi, sizeof(bmi), width, -static_cast<LONG>(height), 32);
+
+	void *bits;
+	wil::unique_hbitmap bitmap(CreateDIBSection(nullptr, &bmi, DIB_RGB_COLORS, &bits, nullptr, 0));
+
+	if (!bitmap)
+	{
+		return nullptr;
+	}
+
+	UINT stride = width * 4;
+	hr = converter->CopyPixels(
+		nullptr, stride, stride * height, static_cast<BYTE *>(bits));
+
+	if (FAILED(hr))
+	{
+		return nullptr;
+	}
+
+	return bitmap;
+}
+
+}
\ No newline at end of file
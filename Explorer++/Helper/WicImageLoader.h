@@ -0,0 +1,36 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <wil/resource.h>
+#include <optional>
+#include <string>
+
+// Reads images through WIC, decoding no more of the image than is needed. The properties of an
+// image are read from its header, without decoding any pixels, and scaled versions are decoded by
+// the codec at (or close to) the requested size where the codec supports that (e.g. JPEG), rather
+// than being decoded at full resolution and then scaled down.
+namespace WicImageLoader
+{
+
+struct ImageInfo
+{
+	UINT width;
+	UINT height;
+
+	// 0 if the bit depth is unknown.
+	UINT bitsPerPixel;
+
+	double horizontalResolution;
+	double verticalResolution;
+};
+
+std::optional<ImageInfo> GetImageInfo(const std::wstring &path);
+
+// Returns a 32-bit, top-down bitmap that fits within the specified size, preserving the image's
+// aspect ratio. Images are never enlarged.
+wil::unique_hbitmap LoadImageAtSize(const std::wstring &path, int maxWidth, int maxHeight);
+
+}
\ No newline at end of file
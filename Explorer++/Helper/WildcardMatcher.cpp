@@ -0,0 +1,381 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "WildcardMatcher.h"
+#include <algorithm>
+#include <array>
+
+namespace
+{
+
+// Lowercases each character, in the same way as the character-by-character comparison previously
+// performed by CheckWildcardMatch. Returns the number of characters written, or 0 on failure.
+int FoldCase(std::wstring_view str, wchar_t *output)
+{
+	if (str.empty())
+	{
+		return 0;
+	}
+
+	return LCMapString(LOCALE_USER_DEFAULT, LCMAP_LOWERCASE, str.data(),
+		static_cast<int>(str.size()), output, static_cast<int>(str.size()));
+}
+
+std::wstring FoldCase(std::wstring_view str)
+{
+	std::wstring folded(str);
+	int length = FoldCase(str, folded.data());
+
+	if (length == 0)
+	{
+		return std::wstring(str);
+	}
+
+	folded.resize(length);
+	return folded;
+}
+
+std::wstring_view TrimSpaces(std::wstring_view str)
+{
+	size_t start = str.find_first_not_of(' ');
+
+	if (start == std::wstring_view::npos)
+	{
+		return {};
+	}
+
+	size_t end = str.find_last_not_of(' ');
+	return str.substr(start, end - start + 1);
+}
+
+// Determines whether the pattern matches every string the other pattern can match, by matching the
+// pattern against the text of the other pattern. A '*' can absorb anything (including wildcards), a
+// '?' can absorb any single character other than a '*' and any other character has to appear
+// literally.
+bool PatternCovers(std::wstring_view pattern, std::wstring_view otherPattern)
+{
+	// matches[i] indicates whether the part of the pattern processed so far covers the first i
+	// characters of the other pattern.
+	std::vector<bool> matches(otherPattern.size() + 1, false);
+	matches[0] = true;
+
+	for (wchar_t patternChar : pattern)
+	{
+		std::vector<bool> nextMatches(otherPattern.size() + 1, false);
+
+		if (patternChar == '*')
+		{
+			nextMatches[0] = matches[0];
+
+			for (size_t i = 1; i <= otherPattern.size(); i++)
+			{
+				nextMatches[i] = matches[i] || nextMatches[i - 1];
+			}
+		}
+		else
+		{
+			for (size_t i = 1; i <= otherPattern.size(); i++)
+			{
+				wchar_t otherChar = otherPattern[i - 1];
+				bool charCovered =
+					(patternChar == '?') ? (otherChar != '*') : (otherChar == patternChar);
+				nextMatches[i] = matches[i - 1] && charCovered;
+			}
+		}
+
+		matches = std::move(nextMatches);
+	}
+
+	return matches[otherPattern.size()];
+}
+
+}
+
+WildcardMatcher::WildcardMatcher(std::wstring_view pattern, bool caseSensitive) :
+	m_caseSensitive(caseSensitive)
+{
+	std::wstring storedPattern = caseSensitive ? std::wstring(pattern) : FoldCase(pattern);
+	std::wstring_view patternView = storedPattern;
+
+	if (patternView.find(':') == std::wstring_view::npos)
+	{
+		m_subpatterns.push_back(ParseSubpattern(patternView));
+		return;
+	}
+
+	// Each subpattern has surrounding spaces removed, so that a list like "*.h: *.cpp" works as
+	// expected. Empty subpatterns are ignored.
+	size_t start = 0;
+
+	while (start <= patternView.size())
+	{
+		size_t end = patternView.find(':', start);
+
+		if (end == std::wstring_view::npos)
+		{
+			end = patternView.size();
+		}
+
+		auto subpattern = TrimSpaces(patternView.substr(start, end - start));
+
+		if (!subpattern.empty())
+		{
+			m_subpatterns.push_back(ParseSubpattern(subpattern));
+		}
+
+		start = end + 1;
+	}
+}
+
+WildcardMatcher::Subpattern WildcardMatcher::ParseSubpattern(std::wstring_view subpattern)
+{
+	Subpattern parsedSubpattern;
+	size_t start = 0;
+
+	while (true)
+	{
+		size_t end = subpattern.find('*', start);
+		bool lastSegment = (end == std::wstring_view::npos);
+
+		if (lastSegment)
+		{
+			end = subpattern.size();
+		}
+
+		auto segment = subpattern.substr(start, end - start);
+
+		// Consecutive '*' characters are equivalent to a single '*', so the empty segments between
+		// them aren't needed. The first and last segments are always kept, since they're anchored.
+		if (!segment.empty() || parsedSubpattern.segments.empty() || lastSegment)
+		{
+			parsedSubpattern.segments.push_back(ParseSegment(segment));
+			parsedSubpattern.minLength += segment.size();
+		}
+
+		if (lastSegment)
+		{
+			break;
+		}
+
+		parsedSubpattern.containsStar = true;
+		start = end + 1;
+	}
+
+	return parsedSubpattern;
+}
+
+WildcardMatcher::Segment WildcardMatcher::ParseSegment(std::wstring_view segment)
+{
+	Segment parsedSegment;
+	parsedSegment.text = segment;
+
+	size_t start = 0;
+
+	while (start < segment.size())
+	{
+		size_t end = segment.find('?', start);
+
+		if (end == std::wstring_view::npos)
+		{
+			end = segment.size();
+		}
+
+		if (end - start > parsedSegment.literalLength)
+		{
+			parsedSegment.literalOffset = start;
+			parsedSegment.literalLength = end - start;
+		}
+
+		start = end + 1;
+	}
+
+	return parsedSegment;
+}
+
+bool WildcardMatcher::Matches(std::wstring_view str) const
+{
+	if (m_caseSensitive || str.empty())
+	{
+		return MatchesFolded(str);
+	}
+
+	// Most strings (e.g. filenames) will fit within this buffer, which avoids an allocation each
+	// time a string is matched.
+	std::array<wchar_t, MAX_PATH> buffer;
+	std::wstring longBuffer;
+	wchar_t *output = buffer.data();
+
+	if (str.size() > buffer.size())
+	{
+		longBuffer.resize(str.size());
+		output = longBuffer.data();
+	}
+
+	int length = FoldCase(str, output);
+
+	if (length == 0)
+	{
+		return MatchesFolded(str);
+	}
+
+	return MatchesFolded({ output, static_cast<size_t>(length) });
+}
+
+bool WildcardMatcher::MatchesFolded(std::wstring_view str) const
+{
+	for (const auto &subpattern : m_subpatterns)
+	{
+		if (MatchesSubpattern(subpattern, str))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+std::wstring WildcardMatcher::FoldString(std::wstring_view str)
+{
+	return FoldCase(str);
+}
+
+bool WildcardMatcher::IsSubsetOf(const WildcardMatcher &other) const
+{
+	// Both sets of subpatterns have been folded in the same way only if the case sensitivity
+	// matches.
+	if (m_caseSensitive != other.m_caseSensitive)
+	{
+		return false;
+	}
+
+	return std::all_of(m_subpatterns.begin(), m_subpatterns.end(),
+		[&other](const Subpattern &subpattern) {
+			std::wstring text = GetSubpatternText(subpattern);
+
+			return std::any_of(other.m_subpatterns.begin(), other.m_subpatterns.end(),
+				[&text](const Subpattern &otherSubpattern) {
+					return PatternCovers(GetSubpatternText(otherSubpattern), text);
+				});
+		});
+}
+
+std::wstring WildcardMatcher::GetSubpatternText(const Subpattern &subpattern)
+{
+	std::wstring text;
+
+	for (size_t i = 0; i < subpattern.segments.size(); i++)
+	{
+		if (i > 0)
+		{
+			text += '*';
+		}
+
+		text += subpattern.segments[i].text;
+	}
+
+	return text;
+}
+
+bool WildcardMatcher::MatchesSubpattern(const Subpattern &subpattern, std::wstring_view str)
+{
+	if (str.size() < subpattern.minLength)
+	{
+		return false;
+	}
+
+	const Segment &firstSegment = subpattern.segments.front();
+
+	if (!subpattern.containsStar)
+	{
+		return str.size() == firstSegment.text.size() && SegmentMatchesAt(firstSegment, str.data());
+	}
+
+	if (!SegmentMatchesAt(firstSegment, str.data()))
+	{
+		return false;
+	}
+
+	const Segment &lastSegment = subpattern.segments.back();
+	size_t position = firstSegment.text.size();
+	size_t end = str.size() - lastSegment.text.size();
+
+	// Since a '*' can absorb any number of characters, taking the earliest match for each of the
+	// inner segments always leaves the most room for the segments that follow. That means no
+	// backtracking is required.
+	for (size_t i = 1; i + 1 < subpattern.segments.size(); i++)
+	{
+		const Segment &segment = subpattern.segments[i];
+		auto match = FindSegment(segment, str, position, end);
+
+		if (!match)
+		{
+			return false;
+		}
+
+		position = *match + segment.text.size();
+	}
+
+	return SegmentMatchesAt(lastSegment, str.data() + end);
+}
+
+std::optional<size_t> WildcardMatcher::FindSegment(
+	const Segment &segment, std::wstring_view str, size_t start, size_t end)
+{
+	size_t segmentLength = segment.text.size();
+
+	if (end - start < segmentLength)
+	{
+		return std::nullopt;
+	}
+
+	// The segment consists entirely of '?' characters, so matches at any position.
+	if (segment.literalLength == 0)
+	{
+		return start;
+	}
+
+	// Candidate positions are found by searching for the first character of the segment's
+	// literal. The search is performed by wmemchr, which is vectorized and significantly faster
+	// than examining each position in turn.
+	wchar_t firstLiteralChar = segment.text[segment.literalOffset];
+	size_t searchPosition = start + segment.literalOffset;
+	size_t searchEnd = end - segmentLength + segment.literalOffset + 1;
+
+	while (searchPosition < searchEnd)
+	{
+		auto *found =
+			wmemchr(str.data() + searchPosition, firstLiteralChar, searchEnd - searchPosition);
+
+		if (!found)
+		{
+			return std::nullopt;
+		}
+
+		size_t foundPosition = found - str.data();
+		size_t candidate = foundPosition - segment.literalOffset;
+
+		if (SegmentMatchesAt(segment, str.data() + candidate))
+		{
+			return candidate;
+		}
+
+		searchPosition = foundPosition + 1;
+	}
+
+	return std::nullopt;
+}
+
+bool WildcardMatcher::SegmentMatchesAt(const Segment &segment, const wchar_t *str)
+{
+	for (size_t i = 0; i < segment.text.size(); i++)
+	{
+		if (segment.text[i] != '?' && segment.text[i] != str[i])
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
\ No newline at end of file
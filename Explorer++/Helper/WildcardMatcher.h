@@ -0,0 +1,77 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A wildcard pattern that's parsed once, so that it can be matched against any number of strings
+// without being interpreted again each time. '*' matches any sequence of characters and '?' matches
+// any single character.
+//
+// As with CheckWildcardMatch, the pattern can consist of several subpatterns separated by ':' (e.g.
+// "*.h: *.cpp"). A string matches if it matches any one of the subpatterns.
+class WildcardMatcher
+{
+public:
+	WildcardMatcher(std::wstring_view pattern, bool caseSensitive);
+
+	bool Matches(std::wstring_view str) const;
+
+	// Matches a string that has already been passed through FoldString (or, if the match is
+	// case-sensitive, a string that's used as is). This allows the folding to be performed once for
+	// strings that are matched repeatedly.
+	bool MatchesFolded(std::wstring_view str) const;
+
+	// Lowercases the string in the same way that strings are lowercased before being matched
+	// against a case-insensitive pattern.
+	static std::wstring FoldString(std::wstring_view str);
+
+	// Returns true if every string that matches this pattern is guaranteed to also match the other
+	// pattern (e.g. "*abc*" is a subset of "*ab*"). The check is conservative, so it may return
+	// false for some patterns that are in fact narrower.
+	bool IsSubsetOf(const WildcardMatcher &other) const;
+
+private:
+	// A part of a subpattern that's delimited by '*' characters. The segment may contain '?'.
+	struct Segment
+	{
+		std::wstring text;
+
+		// The location of the longest run of characters in the segment that doesn't contain '?'.
+		// Candidate positions for the segment are found by searching for this literal.
+		size_t literalOffset = 0;
+		size_t literalLength = 0;
+	};
+
+	// For example, "ab*c?d**e" consists of the segments "ab", "c?d" and "e". The first and last
+	// segments are anchored to the start and end of the string (and may be empty). The segments in
+	// between can appear anywhere, provided that they appear in order and don't overlap.
+	struct Subpattern
+	{
+		std::vector<Segment> segments;
+		bool containsStar = false;
+
+		// The combined length of all the segments, which is the shortest string that can match.
+		size_t minLength = 0;
+	};
+
+	static Subpattern ParseSubpattern(std::wstring_view subpattern);
+	static Segment ParseSegment(std::wstring_view segment);
+
+	static bool MatchesSubpattern(const Subpattern &subpattern, std::wstring_view str);
+	static std::optional<size_t> FindSegment(
+		const Segment &segment, std::wstring_view str, size_t start, size_t end);
+	static bool SegmentMatchesAt(const Segment &segment, const wchar_t *str);
+
+	static std::wstring GetSubpatternText(const Subpattern &subpattern);
+
+	const bool m_caseSensitive;
+
+	// If the match is case-insensitive, the subpatterns are stored in lowercase.
+	std::vector<Subpattern> m_subpatterns;
+};
\ No newline at end of file
@@ -0,0 +1,93 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "XmlStreamReader.h"
+
+const std::wstring *XmlStreamReader::Element::GetAttribute(std::wstring_view attributeName) const
+{
+	for (const auto &[name, value] : attributes)
+	{
+		if (name == attributeName)
+		{
+			return &value;
+		}
+	}
+
+	return nullptr;
+}
+
+std::unique_ptr<XmlStreamReader> XmlStreamReader::Create(IStream *stream)
+{
+	wil::com_ptr_nothrow<IXmlReader> reader;
+	HRESULT hr = CreateXmlReader(IID_PPV_ARGS(&reader), nullptr);
+
+	if (FAILED(hr))
+	{
+		return nullptr;
+	}
+
+	hr = reader->SetProperty(XmlReaderProperty_DtdProcessing, DtdProcessing_Prohibit);
+
+	if (FAILED(hr))
+	{
+		return nullptr;
+	}
+
+	hr = reader->SetInput(stream);
+
+	if (FAILED(hr))
+	{
+		return nullptr;
+	}
+
+	return std::unique_ptr<XmlStreamReader>(new XmlStreamReader(std::move(reader)));
+}
+
+XmlStreamReader::XmlStreamReader(wil::com_ptr_nothrow<IXmlReader> reader) :
+	m_reader(std::move(reader))
+{
+}
+
+bool XmlStreamReader::ReadNextElement(Element &element)
+{
+	XmlNodeType nodeType;
+
+	while (m_reader->Read(&nodeType) == S_OK)
+	{
+		if (nodeType != XmlNodeType_Element)
+		{
+			continue;
+		}
+
+		const WCHAR *name;
+		UINT nameLength;
+		m_reader->GetLocalName(&name, &nameLength);
+		element.name.assign(name, nameLength);
+
+		m_reader->GetDepth(&element.depth);
+
+		element.attributes.clear();
+
+		HRESULT hr = m_reader->MoveToFirstAttribute();
+
+		while (hr == S_OK)
+		{
+			const WCHAR *value;
+			UINT valueLength;
+			m_reader->GetLocalName(&name, &nameLength);
+			m_reader->GetValue(&value, &valueLength);
+			element.attributes.emplace_back(
+				std::wstring(name, nameLength), std::wstring(value, valueLength));
+
+			hr = m_reader->MoveToNextAttribute();
+		}
+
+		m_reader->MoveToElement();
+
+		return true;
+	}
+
+	return false;
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <wil/com.h>
+#include <xmllite.h>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Reads the elements in an XML document one at a time, in document order, using IXmlReader. Unlike
+// loading the document through MSXML, no tree is built, so the cost of reading a large document is
+// proportional to its size, rather than to the number of nodes that are queried.
+class XmlStreamReader
+{
+public:
+	struct Element
+	{
+		std::wstring name;
+
+		// The number of ancestors the element has. The root element has a depth of 0.
+		UINT depth = 0;
+
+		std::vector<std::pair<std::wstring, std::wstring>> attributes;
+
+		const std::wstring *GetAttribute(std::wstring_view attributeName) const;
+	};
+
+	// The stream is read from its current position.
+	static std::unique_ptr<XmlStreamReader> Create(IStream *stream);
+
+	// Reads the next element. Returns false once the end of the document has been reached, or if
+	// the document is malformed.
+	bool ReadNextElement(Element &element);
+
+private:
+	explicit XmlStreamReader(wil::com_ptr_nothrow<IXmlReader> reader);
+
+	wil::com_ptr_nothrow<IXmlReader> m_reader;
+};
\ No newline at end of file
@@ -0,0 +1,719 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ZipArchive.h"
+#include <wil/resource.h>
+#include <wil/result.h>
+#include <algorithm>
+
+namespace
+{
+
+const DWORD END_OF_CENTRAL_DIRECTORY_SIGNATURE = 0x06054b50;
+const DWORD ZIP64_END_OF_CENTRAL_DIRECTORY_LOCATOR_SIGNATURE = 0x07064b50;
+const DWORD ZIP64_END_OF_CENTRAL_DIRECTORY_SIGNATURE = 0x06064b50;
+const DWORD CENTRAL_DIRECTORY_HEADER_SIGNATURE = 0x02014b50;
+
+const size_t END_OF_CENTRAL_DIRECTORY_SIZE = 22;
+const size_t ZIP64_END_OF_CENTRAL_DIRECTORY_LOCATOR_SIZE = 20;
+const size_t ZIP64_END_OF_CENTRAL_DIRECTORY_SIZE = 56;
+const size_t CENTRAL_DIRECTORY_HEADER_SIZE = 46;
+const size_t MAX_ARCHIVE_COMMENT_SIZE = 0xffff;
+
+// The central directory is read into memory in full, so its size is limited.
+const ULONGLONG MAX_CENTRAL_DIRECTORY_SIZE = 512 * 1024 * 1024;
+
+const WORD EXTRA_FIELD_ZIP64 = 0x0001;
+const WORD EXTRA_FIELD_NTFS = 0x000a;
+const WORD EXTRA_FIELD_EXTENDED_TIMESTAMP = 0x5455;
+
+const WORD NTFS_TIMESTAMPS_TAG = 0x0001;
+
+// Set if the name of an entry is encoded as UTF-8. Otherwise, it's encoded using code page 437.
+const WORD FLAG_UTF8_NAME = 1 << 11;
+const UINT DEFAULT_NAME_CODE_PAGE = 437;
+
+// The system the archive was created on (the high byte of the "version made by" field), which
+// determines how the external attributes are interpreted.
+const BYTE HOST_SYSTEM_MSDOS = 0;
+const BYTE HOST_SYSTEM_UNIX = 3;
+const BYTE HOST_SYSTEM_NTFS = 10;
+const BYTE HOST_SYSTEM_VFAT = 14;
+
+const DWORD DOS_ATTRIBUTES_MASK = FILE_ATTRIBUTE_READONLY | FILE_ATTRIBUTE_HIDDEN
+	| FILE_ATTRIBUTE_SYSTEM | FILE_ATTRIBUTE_DIRECTORY | FILE_ATTRIBUTE_ARCHIVE;
+const DWORD UNIX_FILE_TYPE_MASK = 0170000;
+const DWORD UNIX_FILE_TYPE_DIRECTORY = 0040000;
+
+// The number of 100-nanosecond intervals between 1601-01-01 and 1970-01-01.
+const ULONGLONG UNIX_EPOCH_AS_FILETIME = 116444736000000000ULL;
+
+WORD ReadWord(const BYTE *data)
+{
+	return static_cast<WORD>(data[0] | (data[1] << 8));
+}
+
+DWORD ReadDword(const BYTE *data)
+{
+	return static_cast<DWORD>(ReadWord(data)) | (static_cast<DWORD>(ReadWord(data + 2)) << 16);
+}
+
+ULONGLONG ReadQword(const BYTE *data)
+{
+	return static_cast<ULONGLONG>(ReadDword(data))
+		| (static_cast<ULONGLONG>(ReadDword(data + 4)) << 32);
+}
+
+FILETIME ToFileTime(ULONGLONG value)
+{
+	ULARGE_INTEGER largeInteger;
+	largeInteger.QuadPart = value;
+	return { largeInteger.LowPart, largeInteger.HighPart };
+}
+
+// Times in the header are stored in MS-DOS format, in local time.
+FILETIME DosDateTimeToUtcFileTime(WORD date, WORD time)
+{
+	FILETIME localFileTime;
+	FILETIME fileTime;
+
+	if (!DosDateTimeToFileTime(date, time, &localFileTime)
+		|| !LocalFileTimeToFileTime(&localFileTime, &fileTime))
+	{
+		return {};
+	}
+
+	return fileTime;
+}
+
+// Reading from a mapped view raises an exception if the underlying file can't be read (e.g.
+// because it's on a network share that's been disconnected).
+bool CopyFromView(void *destination, const void *source, size_t size)
+{
+	__try
+	{
+		memcpy(destination, source, size);
+		return true;
+	}
+	__except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER
+															: EXCEPTION_CONTINUE_SEARCH)
+	{
+		return false;
+	}
+}
+
+HRESULT ReadMappedRange(HANDLE mapping, ULONGLONG offset, size_t size, std::vector<BYTE> &output)
+{
+	SYSTEM_INFO systemInfo;
+	GetSystemInfo(&systemInfo);
+
+	// Views have to start on an allocation granularity boundary.
+	ULARGE_INTEGER viewOffset;
+	viewOffset.QuadPart = offset - (offset % systemInfo.dwAllocationGranularity);
+	auto offsetWithinView = static_cast<size_t>(offset - viewOffset.QuadPart);
+
+	wil::unique_mapview_ptr<BYTE> view(static_cast<BYTE *>(MapViewOfFile(mapping, FILE_MAP_READ,
+		viewOffset.HighPart, viewOffset.LowPart, offsetWithinView + size)));
+	RETURN_LAST_ERROR_IF_NULL(view);
+
+	output.resize(size);
+
+	if (!CopyFromView(output.data(), view.get() + offsetWithinView, size))
+	{
+		return HRESULT_FROM_WIN32(ERROR_READ_FAULT);
+	}
+
+	return S_OK;
+}
+
+std::wstring DecodeName(const BYTE *name, size_t size, bool utf8)
+{
+	if (size == 0)
+	{
+		return {};
+	}
+
+	UINT codePage = utf8 ? CP_UTF8 : DEFAULT_NAME_CODE_PAGE;
+	int length = MultiByteToWideChar(codePage, 0, reinterpret_cast<LPCCH>(name),
+		static_cast<int>(size), nullptr, 0);
+
+	if (length <= 0)
+	{
+		return {};
+	}
+
+	std::wstring decodedName(length, '\0');
+	MultiByteToWideChar(codePage, 0, reinterpret_cast<LPCCH>(name), static_cast<int>(size),
+		decodedName.data(), length);
+	return decodedName;
+}
+
+// Either separator may be used. Returns false if the path contains a ".." component, since such a
+// path would refer to something outside the archive.
+bool SplitArchivePath(const std::wstring &path, std::vector<std::wstring> &components)
+{
+	size_t start = 0;
+
+	while (start <= path.size())
+	{
+		size_t end = path.find_first_of(L"/\\", start);
+
+		if (end == std::wstring::npos)
+		{
+			end = path.size();
+		}
+
+		std::wstring component = path.substr(start, end - start);
+
+		if (component == L"..")
+		{
+			return false;
+		}
+
+		if (!component.empty() && component != L".")
+		{
+			components.push_back(std::move(component));
+		}
+
+		start = end + 1;
+	}
+
+	return true;
+}
+
+std::wstring JoinArchivePath(const std::vector<std::wstring> &components, size_t count)
+{
+	std::wstring path;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		if (i > 0)
+		{
+			path += '\\';
+		}
+
+		path += components[i];
+	}
+
+	return path;
+}
+
+}
+
+HRESULT ZipArchive::Open(const std::wstring &path, std::unique_ptr<ZipArchive> &archive)
+{
+	wil::unique_hfile file(CreateFile(path.c_str(), GENERIC_READ,
+		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL, nullptr));
+	RETURN_LAST_ERROR_IF(!file);
+
+	BY_HANDLE_FILE_INFORMATION fileInfo;
+	RETURN_IF_WIN32_BOOL_FALSE(GetFileInformationByHandle(file.get(), &fileInfo));
+
+	ULARGE_INTEGER fileSize;
+	fileSize.LowPart = fileInfo.nFileSizeLow;
+	fileSize.HighPart = fileInfo.nFileSizeHigh;
+
+	std::vector<DirectoryRecord> records;
+	RETURN_IF_FAILED(ReadDirectoryRecords(file.get(), fileSize.QuadPart, records));
+
+	std::unique_ptr<ZipArchive> newArchive(new ZipArchive());
+	newArchive->m_fileSize = fileSize.QuadPart;
+	newArchive->m_lastWriteTime = fileInfo.ftLastWriteTime;
+	newArchive->GetOrCreateFolder(L"");
+
+	for (auto &record : records)
+	{
+		newArchive->AddRecord(std::move(record));
+	}
+
+	for (auto &folder : newArchive->m_folders)
+	{
+		folder.entryIndexes = {};
+		newArchive->m_numEntries += folder.entries.size();
+	}
+
+	archive = std::move(newArchive);
+
+	return S_OK;
+}
+
+HRESULT ZipArchive::ReadDirectoryRecords(
+	HANDLE file, ULONGLONG fileSize, std::vector<DirectoryRecord> &records)
+{
+	if (fileSize < END_OF_CENTRAL_DIRECTORY_SIZE)
+	{
+		return HRESULT_FROM_WIN32(ERROR_BAD_FORMAT);
+	}
+
+	wil::unique_handle mapping(CreateFileMapping(file, nullptr, PAGE_READONLY, 0, 0, nullptr));
+	RETURN_LAST_ERROR_IF_NULL(mapping);
+
+	// The end of central directory record is followed by a comment of up to 64 KB, so it's found
+	// by searching backwards from the end of the file.
+	auto tailSize = static_cast<size_t>((std::min)(fileSize,
+		static_cast<ULONGLONG>(END_OF_CENTRAL_DIRECTORY_SIZE + MAX_ARCHIVE_COMMENT_SIZE
+			+ ZIP64_END_OF_CENTRAL_DIRECTORY_LOCATOR_SIZE)));
+	std::vector<BYTE> tail;
+	RETURN_IF_FAILED(ReadMappedRange(mapping.get(), fileSize - tailSize, tailSize, tail));
+
+	std::optional<size_t> endRecordOffset;
+
+	for (size_t offset = tail.size() - END_OF_CENTRAL_DIRECTORY_SIZE;; offset--)
+	{
+		if (ReadDword(&tail[offset]) == END_OF_CENTRAL_DIRECTORY_SIGNATURE
+			&& offset + END_OF_CENTRAL_DIRECTORY_SIZE + ReadWord(&tail[offset + 20])
+				<= tail.size())
+		{
+			endRecordOffset = offset;
+			break;
+		}
+
+		if (offset == 0)
+		{
+			break;
+		}
+	}
+
+	if (!endRecordOffset)
+	{
+		return HRESULT_FROM_WIN32(ERROR_BAD_FORMAT);
+	}
+
+	const BYTE *endRecord = &tail[*endRecordOffset];
+	ULONGLONG numRecords = ReadWord(endRecord + 10);
+	ULONGLONG directorySize = ReadDword(endRecord + 12);
+	ULONGLONG directoryOffset = ReadDword(endRecord + 16);
+
+	// Values that don't fit in the record are stored in the ZIP64 end of central directory record
+	// instead, which is found through the locator that immediately precedes this record.
+	if (numRecords == 0xffff || directorySize == 0xffffffff || directoryOffset == 0xffffffff)
+	{
+		if (*endRecordOffset < ZIP64_END_OF_CENTRAL_DIRECTORY_LOCATOR_SIZE)
+		{
+			return HRESULT_FROM_WIN32(ERROR_BAD_FORMAT);
+		}
+
+		const BYTE *locator = endRecord - ZIP64_END_OF_CENTRAL_DIRECTORY_LOCATOR_SIZE;
+
+		if (ReadDword(locator) != ZIP64_END_OF_CENTRAL_DIRECTORY_LOCATOR_SIGNATURE)
+		{
+			return HRESULT_FROM_WIN32(ERROR_BAD_FORMAT);
+		}
+
+		ULONGLONG zip64RecordOffset = ReadQword(locator + 8);
+
+		if (zip64RecordOffset > fileSize - ZIP64_END_OF_CENTRAL_DIRECTORY_SIZE)
+		{
+			return HRESULT_FROM_WIN32(ERROR_BAD_FORMAT);
+		}
+
+		std::vector<BYTE> zip64Record;
+		RETURN_IF_FAILED(ReadMappedRange(mapping.get(), zip64RecordOffset,
+			ZIP64_END_OF_CENTRAL_DIRECTORY_SIZE, zip64Record));
+
+		if (ReadDword(zip64Record.data()) != ZIP64_END_OF_CENTRAL_DIRECTORY_SIGNATURE)
+		{
+			return HRESULT_FROM_WIN32(ERROR_BAD_FORMAT);
+		}
+
+		numRecords = ReadQword(&zip64Record[32]);
+		directorySize = ReadQword(&zip64Record[40]);
+		directoryOffset = ReadQword(&zip64Record[48]);
+	}
+
+	if (directorySize > MAX_CENTRAL_DIRECTORY_SIZE || directoryOffset > fileSize
+		|| directorySize > fileSize - directoryOffset)
+	{
+		return HRESULT_FROM_WIN32(ERROR_BAD_FORMAT);
+	}
+
+	if (directorySize == 0)
+	{
+		return S_OK;
+	}
+
+	std::vector<BYTE> directory;
+	RETURN_IF_FAILED(ReadMappedRange(mapping.get(), directoryOffset,
+		static_cast<size_t>(directorySize), directory));
+
+	records.reserve(static_cast<size_t>(
+		(std::min)(numRecords, directorySize / CENTRAL_DIRECTORY_HEADER_SIZE)));
+
+	size_t offset = 0;
+
+	while (offset < directory.size())
+	{
+		DirectoryRecord record;
+		size_t recordSize;
+
+		// Anything following the last record (e.g. a digital signature) is ignored.
+		if (!ParseDirectoryRecord(
+				&directory[offset], directory.size() - offset, recordSize, record))
+		{
+			break;
+		}
+
+		offset += recordSize;
+
+		if (!record.path.empty())
+		{
+			records.push_back(std::move(record));
+		}
+	}
+
+	if (offset == 0)
+	{
+		return HRESULT_FROM_WIN32(ERROR_BAD_FORMAT);
+	}
+
+	return S_OK;
+}
+
+bool ZipArchive::ParseDirectoryRecord(
+	const BYTE *data, size_t remaining, size_t &recordSize, DirectoryRecord &record)
+{
+	if (remaining < CENTRAL_DIRECTORY_HEADER_SIZE
+		|| ReadDword(data) != CENTRAL_DIRECTORY_HEADER_SIGNATURE)
+	{
+		return false;
+	}
+
+	BYTE hostSystem = data[5];
+	WORD flags = ReadWord(data + 8);
+	WORD modificationTime = ReadWord(data + 12);
+	WORD modificationDate = ReadWord(data + 14);
+	DWORD size32 = ReadDword(data + 24);
+	WORD nameSize = ReadWord(data + 28);
+	WORD extraSize = ReadWord(data + 30);
+	WORD commentSize = ReadWord(data + 32);
+	DWORD externalAttributes = ReadDword(data + 38);
+
+	recordSize = CENTRAL_DIRECTORY_HEADER_SIZE + nameSize + extraSize + commentSize;
+
+	if (recordSize > remaining)
+	{
+		return false;
+	}
+
+	record.path = DecodeName(
+		data + CENTRAL_DIRECTORY_HEADER_SIZE, nameSize, WI_IsFlagSet(flags, FLAG_UTF8_NAME));
+	record.isFolder =
+		!record.path.empty() && (record.path.back() == '/' || record.path.back() == '\\');
+
+	DWORD attributes = 0;
+
+	if (hostSystem == HOST_SYSTEM_MSDOS || hostSystem == HOST_SYSTEM_NTFS
+		|| hostSystem == HOST_SYSTEM_VFAT)
+	{
+		attributes = externalAttributes & DOS_ATTRIBUTES_MASK;
+	}
+	else if (hostSystem == HOST_SYSTEM_UNIX)
+	{
+		DWORD mode = externalAttributes >> 16;
+		record.isFolder |= ((mode & UNIX_FILE_TYPE_MASK) == UNIX_FILE_TYPE_DIRECTORY);
+	}
+
+	record.isFolder |= WI_IsFlagSet(attributes, FILE_ATTRIBUTE_DIRECTORY);
+	WI_UpdateFlag(attributes, FILE_ATTRIBUTE_DIRECTORY, record.isFolder);
+
+	if (attributes == 0)
+	{
+		attributes = FILE_ATTRIBUTE_NORMAL;
+	}
+
+	record.entry.attributes = attributes;
+	record.entry.size = size32;
+	record.entry.lastWriteTime = DosDateTimeToUtcFileTime(modificationDate, modificationTime);
+
+	ApplyExtraFields(data + CENTRAL_DIRECTORY_HEADER_SIZE + nameSize, extraSize, size32,
+		record.entry);
+
+	if (record.isFolder)
+	{
+		record.entry.size = 0;
+	}
+
+	return true;
+}
+
+void ZipArchive::ApplyExtraFields(
+	const BYTE *extra, size_t extraSize, DWORD size32, ZipArchiveEntry &entry)
+{
+	std::optional<FILETIME> extendedLastWriteTime;
+	bool hasNtfsTimes = false;
+	size_t offset = 0;
+
+	while (offset + 4 <= extraSize)
+	{
+		WORD id = ReadWord(extra + offset);
+		WORD fieldSize = ReadWord(extra + offset + 2);
+		const BYTE *field = extra + offset + 4;
+
+		if (offset + 4 + fieldSize > extraSize)
+		{
+			break;
+		}
+
+		switch (id)
+		{
+		case EXTRA_FIELD_ZIP64:
+			// Only the values that didn't fit in the header are included, with the uncompressed
+			// size first.
+			if (size32 == 0xffffffff && fieldSize >= 8)
+			{
+				entry.size = ReadQword(field);
+			}
+			break;
+
+		case EXTRA_FIELD_NTFS:
+			// A reserved value, followed by a set of tagged attributes.
+			for (size_t tagOffset = 4; tagOffset + 4 <= fieldSize;)
+			{
+				WORD tag = ReadWord(field + tagOffset);
+				WORD tagSize = ReadWord(field + tagOffset + 2);
+
+				if (tag == NTFS_TIMESTAMPS_TAG && tagSize >= 24
+					&& tagOffset + 4 + 24 <= fieldSize)
+				{
+					// The last write, last access and creation times, in that order.
+					entry.lastWriteTime = ToFileTime(ReadQword(field + tagOffset + 4));
+					entry.creationTime = ToFileTime(ReadQword(field + tagOffset + 20));
+					hasNtfsTimes = true;
+				}
+
+				tagOffset += 4 + tagSize;
+			}
+			break;
+
+		case EXTRA_FIELD_EXTENDED_TIMESTAMP:
+			// The first bit of the flags indicates that the last write time is present, as a Unix
+			// timestamp.
+			if (fieldSize >= 5 && (field[0] & 1))
+			{
+				auto unixTime = static_cast<LONGLONG>(static_cast<LONG>(ReadDword(field + 1)));
+				extendedLastWriteTime = ToFileTime(unixTime * 10000000 + UNIX_EPOCH_AS_FILETIME);
+			}
+			break;
+		}
+
+		offset += 4 + fieldSize;
+	}
+
+	// NTFS timestamps are more precise, so they take precedence.
+	if (extendedLastWriteTime && !hasNtfsTimes)
+	{
+		entry.lastWriteTime = *extendedLastWriteTime;
+	}
+}
+
+void ZipArchive::AddRecord(DirectoryRecord &&record)
+{
+	std::vector<std::wstring> components;
+
+	if (!SplitArchivePath(record.path, components) || components.empty())
+	{
+		return;
+	}
+
+	// Each of the folders leading up to the entry is added, since archives don't necessarily
+	// contain entries for them.
+	for (size_t i = 0; i + 1 < components.size(); i++)
+	{
+		auto &folder = m_folders[GetOrCreateFolder(JoinArchivePath(components, i))];
+
+		if (folder.entryIndexes.contains(components[i]))
+		{
+			continue;
+		}
+
+		ZipArchiveEntry impliedFolder;
+		impliedFolder.name = components[i];
+		impliedFolder.attributes = FILE_ATTRIBUTE_DIRECTORY;
+		folder.entryIndexes.insert({ impliedFolder.name, folder.entries.size() });
+		folder.entries.push_back(std::move(impliedFolder));
+	}
+
+	if (record.isFolder)
+	{
+		// Ensures that empty folders can be browsed.
+		GetOrCreateFolder(JoinArchivePath(components, components.size()));
+	}
+
+	size_t folderIndex = GetOrCreateFolder(JoinArchivePath(components, components.size() - 1));
+	auto &folder = m_folders[folderIndex];
+	record.entry.name = components.back();
+
+	auto itr = folder.entryIndexes.find(record.entry.name);
+
+	if (itr != folder.entryIndexes.end())
+	{
+		// The entry either replaces a folder that was previously implied, or is a duplicate, in
+		// which case the last entry wins.
+		folder.entries[itr->second] = std::move(record.entry);
+		return;
+	}
+
+	folder.entryIndexes.insert({ record.entry.name, folder.entries.size() });
+	folder.entries.push_back(std::move(record.entry));
+}
+
+size_t ZipArchive::GetOrCreateFolder(const std::wstring &folderPath)
+{
+	auto [itr, inserted] = m_folderIndexes.try_emplace(folderPath, m_folders.size());
+
+	if (inserted)
+	{
+		m_folders.emplace_back();
+	}
+
+	return itr->second;
+}
+
+const std::vector<ZipArchiveEntry> *ZipArchive::GetFolderContents(
+	const std::wstring &folderPath) const
+{
+	std::vector<std::wstring> components;
+
+	if (!SplitArchivePath(folderPath, components))
+	{
+		return nullptr;
+	}
+
+	auto itr = m_folderIndexes.find(JoinArchivePath(components, components.size()));
+
+	if (itr == m_folderIndexes.end())
+	{
+		return nullptr;
+	}
+
+	return &m_folders[itr->second].entries;
+}
+
+size_t ZipArchive::GetNumEntries() const
+{
+	return m_numEntries;
+}
+
+ULONGLONG ZipArchive::GetFileSize() const
+{
+	return m_fileSize;
+}
+
+FILETIME ZipArchive::GetLastWriteTime() const
+{
+	return m_lastWriteTime;
+}
+
+std::optional<ZipArchiveLocation> GetZipArchiveLocation(const std::wstring &path)
+{
+	const std::wstring_view extension = L".zip";
+	size_t end = 0;
+
+	// Each of the prefixes of the path that ends in a complete component is checked in turn.
+	do
+	{
+		end = path.find('\\', end + 1);
+
+		if (end == std::wstring::npos)
+		{
+			end = path.size();
+		}
+
+		if (end >= extension.size()
+			&& CompareStringOrdinal(path.c_str() + end - extension.size(),
+				   static_cast<int>(extension.size()), extension.data(),
+				   static_cast<int>(extension.size()), true)
+				== CSTR_EQUAL)
+		{
+			std::wstring archivePath = path.substr(0, end);
+			DWORD attributes = GetFileAttributes(archivePath.c_str());
+
+			if (attributes != INVALID_FILE_ATTRIBUTES
+				&& WI_IsFlagClear(attributes, FILE_ATTRIBUTE_DIRECTORY))
+			{
+				std::wstring folderPath = (end < path.size()) ? path.substr(end + 1) : L"";
+
+				while (!folderPath.empty() && folderPath.back() == '\\')
+				{
+					folderPath.pop_back();
+				}
+
+				return ZipArchiveLocation{ std::move(archivePath), std::move(folderPath) };
+			}
+		}
+	} while (end < path.size());
+
+	return std::nullopt;
+}
+
+ZipArchiveCache &ZipArchiveCache::GetInstance()
+{
+	static ZipArchiveCache zipArchiveCache;
+	return zipArchiveCache;
+}
+
+std::shared_ptr<const ZipArchive> ZipArchiveCache::GetArchive(const std::wstring &path)
+{
+	WIN32_FILE_ATTRIBUTE_DATA attributeData;
+
+	if (!GetFileAttributesEx(path.c_str(), GetFileExInfoStandard, &attributeData))
+	{
+		return nullptr;
+	}
+
+	ULARGE_INTEGER fileSize;
+	fileSize.LowPart = attributeData.nFileSizeLow;
+	fileSize.HighPart = attributeData.nFileSizeHigh;
+
+	auto isCurrent = [&fileSize, &attributeData](const ZipArchive &archive) {
+		FILETIME lastWriteTime = archive.GetLastWriteTime();
+		return archive.GetFileSize() == fileSize.QuadPart
+			&& CompareFileTime(&lastWriteTime, &attributeData.ftLastWriteTime) == 0;
+	};
+
+	{
+		std::scoped_lock lock(m_mutex);
+
+		auto itr = std::find_if(m_archives.begin(), m_archives.end(),
+			[&path](const CachedArchive &cachedArchive) { return cachedArchive.path == path; });
+
+		if (itr != m_archives.end())
+		{
+			if (isCurrent(*itr->archive))
+			{
+				m_archives.splice(m_archives.begin(), m_archives, itr);
+				return m_archives.front().archive;
+			}
+
+			m_archives.erase(itr);
+		}
+	}
+
+	// The archive is read without the lock being held, so that reading one archive doesn't hold
+	// up requests for any others.
+	std::unique_ptr<ZipArchive> archive;
+	HRESULT hr = ZipArchive::Open(path, archive);
+
+	if (FAILED(hr))
+	{
+		return nullptr;
+	}
+
+	std::shared_ptr<const ZipArchive> sharedArchive = std::move(archive);
+
+	std::scoped_lock lock(m_mutex);
+
+	std::erase_if(m_archives,
+		[&path](const CachedArchive &cachedArchive) { return cachedArchive.path == path; });
+	m_archives.push_front({ path, sharedArchive });
+
+	if (m_archives.size() > MAX_CACHED_ARCHIVES)
+	{
+		m_archives.pop_back();
+	}
+
+	return sharedArchive;
+}
\ No newline at end of file
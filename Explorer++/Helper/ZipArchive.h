@@ -0,0 +1,133 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// A file or folder within a zip archive, as described by the archive's central directory.
+struct ZipArchiveEntry
+{
+	// The name of the item within its folder.
+	std::wstring name;
+
+	// The FILE_ATTRIBUTE_* values for the item. FILE_ATTRIBUTE_DIRECTORY is always set for
+	// folders.
+	DWORD attributes = 0;
+
+	// The uncompressed size. Always 0 for folders.
+	ULONGLONG size = 0;
+
+	// The creation time is only available if the archive stores NTFS timestamps. Otherwise, it's
+	// left as zero.
+	FILETIME lastWriteTime = {};
+	FILETIME creationTime = {};
+};
+
+// The location of a folder within a zip archive.
+struct ZipArchiveLocation
+{
+	std::wstring archivePath;
+
+	// Relative to the root of the archive, with components separated by backslashes. Empty for
+	// the root itself.
+	std::wstring folderPath;
+};
+
+// Provides the contents of a zip archive by reading its central directory directly, which is much
+// faster than enumerating the archive through the shell. Only the central directory is read; the
+// entries themselves aren't touched, so opening an archive costs the same regardless of how large
+// the files within it are. The directory is read through a mapped view of the file.
+//
+// Folders that are only implied by the paths of the entries within them (i.e. that don't have
+// their own entry) are included. Entries whose paths contain ".." components are ignored.
+class ZipArchive
+{
+public:
+	static HRESULT Open(const std::wstring &path, std::unique_ptr<ZipArchive> &archive);
+
+	// Returns the items directly within the specified folder (see ZipArchiveLocation), or nullptr
+	// if there's no such folder.
+	const std::vector<ZipArchiveEntry> *GetFolderContents(const std::wstring &folderPath) const;
+
+	size_t GetNumEntries() const;
+
+	// The size and last write time of the archive file at the point it was read.
+	ULONGLONG GetFileSize() const;
+	FILETIME GetLastWriteTime() const;
+
+private:
+	// A record from the central directory.
+	struct DirectoryRecord
+	{
+		std::wstring path;
+		bool isFolder;
+		ZipArchiveEntry entry;
+	};
+
+	ZipArchive() = default;
+
+	static HRESULT ReadDirectoryRecords(HANDLE file, ULONGLONG fileSize,
+		std::vector<DirectoryRecord> &records);
+	static bool ParseDirectoryRecord(
+		const BYTE *data, size_t remaining, size_t &recordSize, DirectoryRecord &record);
+	static void ApplyExtraFields(
+		const BYTE *extra, size_t extraSize, DWORD size32, ZipArchiveEntry &entry);
+
+	void AddRecord(DirectoryRecord &&record);
+	size_t GetOrCreateFolder(const std::wstring &folderPath);
+
+	struct Folder
+	{
+		std::vector<ZipArchiveEntry> entries;
+
+		// Maps the name of each entry to its index. Only used while the archive is being read.
+		std::unordered_map<std::wstring, size_t> entryIndexes;
+	};
+
+	std::vector<Folder> m_folders;
+	std::unordered_map<std::wstring, size_t> m_folderIndexes;
+	size_t m_numEntries = 0;
+
+	ULONGLONG m_fileSize = 0;
+	FILETIME m_lastWriteTime = {};
+};
+
+// Returns the archive containing the specified path and the location of the path within that
+// archive. Only the filesystem path leading up to the archive is checked (the archive isn't opened
+// here), so the folder within the archive isn't guaranteed to exist.
+std::optional<ZipArchiveLocation> GetZipArchiveLocation(const std::wstring &path);
+
+// Retains recently opened archives, so that navigating between the folders in an archive doesn't
+// require the archive to be read again each time. A cached archive is only used while the size
+// and last write time of the file remain unchanged. This class is thread-safe.
+class ZipArchiveCache
+{
+public:
+	static ZipArchiveCache &GetInstance();
+
+	std::shared_ptr<const ZipArchive> GetArchive(const std::wstring &path);
+
+private:
+	static const size_t MAX_CACHED_ARCHIVES = 4;
+
+	struct CachedArchive
+	{
+		std::wstring path;
+		std::shared_ptr<const ZipArchive> archive;
+	};
+
+	ZipArchiveCache() = default;
+
+	std::mutex m_mutex;
+
+	// Ordered from most to least recently used.
+	std::list<CachedArchive> m_archives;
+};
\ No newline at end of file
@@ -4,11 +4,16 @@
 
 #include "stdafx.h"
 #include "iDirectoryMonitor.h"
-#include "Macros.h"
-#include <list>
-
-DWORD WINAPI Thread_DirModifiedInternal(LPVOID Container);
-
+#include "DirectoryReader.h"
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+// All watches are served by a single I/O completion port. Each watch has at most one read
+// outstanding at a time and the worker threads simply wait on the port for those reads to
+// complete.
 class DirectoryMonitor : public IDirectoryMonitor
 {
 public:
@@ -26,49 +31,96 @@ public:
 	BOOL StopDirectoryMonitor(int iStopId);
 
 private:
-#define PRIMARY_BUFFER_SIZE 1000 * sizeof(FILE_NOTIFY_INFORMATION)
+	static constexpr int NUM_WORKER_THREADS = 2;
+	static constexpr ULONG_PTR WATCH_COMPLETION_KEY = 1;
+	static constexpr ULONG_PTR SHUTDOWN_COMPLETION_KEY = 2;
+
+	// ReadDirectoryChangesW fails on network paths if the buffer is larger than 64KB.
+	static constexpr DWORD NETWORK_BUFFER_SIZE = 64 * 1024;
 
-	/* These function are only ever queued as APC's. */
-	static void CALLBACK WatchAndCreateDirectoryInternal(ULONG_PTR dwParam);
-	static void CALLBACK CompletionRoutine(
-		DWORD dwErrorCode, DWORD NumberOfBytesTransferred, LPOVERLAPPED lpOverlapped);
-	static void CALLBACK StopDirectoryWatch(ULONG_PTR dwParam);
+	// A watch over an entire tree (e.g. a drive) can generate a large number of changes in a
+	// short period, so it gets a larger buffer than a watch over a single directory.
+	static constexpr DWORD SUBTREE_BUFFER_SIZE = 256 * 1024;
+	static constexpr DWORD DEFAULT_BUFFER_SIZE = 16 * 1024;
 
-	/* This function is called as an APC, and stops
-	the worker thread on exit. */
-	static void CALLBACK ExitWorkerThread(ULONG_PTR dwParam);
+	static constexpr DWORD SHUTDOWN_TIMEOUT_MS = 5000;
 
-	/* These are only called in the context of the
-	worker thread (i.e. they are called from APC's,
-	but are not queued as APC's themselves). */
-	static void CALLBACK WatchDirectoryInternal(ULONG_PTR dwParam);
-	static void DeleteRequest(ULONG_PTR dwParam);
+	// ReadDirectoryChangesExW and the associated types are only declared when targeting Windows 10
+	// version 1709 or later, so they're defined here. The function is loaded at runtime.
+	static constexpr DWORD READ_DIRECTORY_NOTIFY_EXTENDED_INFORMATION = 2;
 
-	class DirInfo
+	using ReadDirectoryChangesExWType = BOOL(WINAPI *)(HANDLE hDirectory, LPVOID lpBuffer,
+		DWORD nBufferLength, BOOL bWatchSubtree, DWORD dwNotifyFilter, LPDWORD lpBytesReturned,
+		LPOVERLAPPED lpOverlapped, LPOVERLAPPED_COMPLETION_ROUTINE lpCompletionRoutine,
+		DWORD ReadDirectoryNotifyInformationClass);
+
+	struct FileNotifyExtendedInformation
 	{
-	public:
-		OnDirectoryAltered m_OnDirectoryAltered;
+		DWORD NextEntryOffset;
+		DWORD Action;
+		LARGE_INTEGER CreationTime;
+		LARGE_INTEGER LastModificationTime;
+		LARGE_INTEGER LastChangeTime;
+		LARGE_INTEGER LastAccessTime;
+		LARGE_INTEGER AllocatedLength;
+		LARGE_INTEGER FileSize;
+		DWORD FileAttributes;
+		DWORD ReparsePointTag;
+		LARGE_INTEGER FileId;
+		LARGE_INTEGER ParentFileId;
+		DWORD FileNameLength;
+		WCHAR FileName[1];
+	};
 
-		DirectoryMonitor *m_pDirectoryMonitor;
-		FILE_NOTIFY_INFORMATION *m_FileNotifyBuffer;
-		HANDLE m_hThread;
-		HANDLE m_hDirectory;
+	struct DirInfo
+	{
+		// This needs to be the first member, so that the watch can be retrieved from the
+		// OVERLAPPED pointer that's returned when a read completes.
 		OVERLAPPED m_Async;
-		LPVOID m_pData;
-		TCHAR m_DirPath[MAX_PATH];
+
+		int m_UniqueId;
+		HANDLE m_hDirectory;
+		std::wstring m_DirPath;
 		UINT m_WatchFlags;
 		BOOL m_bWatchSubTree;
-		BOOL m_bMarkedForDeletion;
-		BOOL m_bDirMonitored;
-		int m_UniqueId;
+		OnDirectoryAltered m_OnDirectoryAltered;
+		void *m_pData;
+
+		// Extended notification entries contain 64-bit fields, so the buffer is kept
+		// QWORD-aligned.
+		std::vector<ULONGLONG> m_Buffer;
+
+		// Set if the extended notifications are supported for this directory. Some file
+		// systems (e.g. FAT32 and network shares) don't support them.
+		bool m_bUseExtendedInformation;
+
+		bool m_bReadPending;
+		bool m_bStopping;
 	};
 
+	int AddWatch(HANDLE hDirectory, const TCHAR *Directory, UINT WatchFlags,
+		OnDirectoryAltered onDirectoryAltered, BOOL bWatchSubTree, void *pData);
+	static DWORD GetBufferSize(const std::wstring &path, BOOL watchSubTree);
+
+	void WorkerThread();
+	void OnReadCompleted(DirInfo *dirInfo, BOOL succeeded, DWORD numBytesTransferred);
+	static std::vector<DirectoryChange> ParseChanges(
+		const DirInfo *dirInfo, DWORD numBytesTransferred);
+	static std::vector<DirectoryChange> ParseExtendedChanges(
+		const DirInfo *dirInfo, DWORD numBytesTransferred);
+	static FILETIME LargeIntegerToFileTime(const LARGE_INTEGER &value);
+
+	// These must be called with m_mutex held.
+	bool IssueRead(DirInfo *dirInfo);
+	void DeleteWatch(DirInfo *dirInfo);
+
 	int m_iRefCount;
-	DWORD m_ThreadId;
-	HANDLE m_hThread;
-	std::list<DirInfo> m_DirWatchInfoList;
-	CRITICAL_SECTION m_cs;
-	HANDLE m_hStopThreadEvent;
+	ReadDirectoryChangesExWType m_readDirectoryChangesEx;
+	HANDLE m_completionPort;
+	std::vector<std::thread> m_threads;
+	std::unordered_map<int, std::unique_ptr<DirInfo>> m_watches;
+	std::mutex m_mutex;
+	std::condition_variable m_watchesEmptyCondition;
 	int m_UniqueId;
 };
 
@@ -79,32 +131,62 @@ HRESULT CreateDirectoryMonitor(IDirectoryMonitor **pDirectoryMonitor)
 	return S_OK;
 }
 
-DirectoryMonitor::DirectoryMonitor()
+DirectoryMonitor::DirectoryMonitor() : m_iRefCount(1), m_UniqueId(0)
 {
-	m_iRefCount = 1;
-	m_UniqueId = 0;
-	m_hThread = CreateThread(nullptr, 0, Thread_DirModifiedInternal, nullptr, 0, &m_ThreadId);
+	m_readDirectoryChangesEx = reinterpret_cast<ReadDirectoryChangesExWType>(
+		GetProcAddress(GetModuleHandle(L"kernel32.dll"), "ReadDirectoryChangesExW"));
 
-	InitializeCriticalSection(&m_cs);
+	m_completionPort = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 0);
 
-	m_hStopThreadEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+	if (m_completionPort)
+	{
+		for (int i = 0; i < NUM_WORKER_THREADS; i++)
+		{
+			m_threads.emplace_back(&DirectoryMonitor::WorkerThread, this);
+		}
+	}
 }
 
 DirectoryMonitor::~DirectoryMonitor()
 {
-	/* Queue the APC that will stop the worker
-	thread. */
-	QueueUserAPC(ExitWorkerThread, m_hThread, (ULONG_PTR) this);
-	CloseHandle(m_hThread);
-
-	/* Wait for the worker thread to stop. Once it
-	has been stopped, delete any dependent data
-	(such as any critical sections). */
-	WaitForSingleObject(m_hStopThreadEvent, INFINITE);
-
-	DeleteCriticalSection(&m_cs);
-	m_DirWatchInfoList.clear();
-	CloseHandle(m_hStopThreadEvent);
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		for (auto &entry : m_watches)
+		{
+			DirInfo *dirInfo = entry.second.get();
+
+			if (!dirInfo->m_bStopping && dirInfo->m_bReadPending)
+			{
+				CloseHandle(dirInfo->m_hDirectory);
+				dirInfo->m_hDirectory = INVALID_HANDLE_VALUE;
+			}
+
+			dirInfo->m_bStopping = true;
+		}
+
+		// Closing each directory handle will cancel the outstanding read, which will then be
+		// completed by one of the worker threads. The watches can't be freed until that's
+		// happened, since the system still holds a pointer to each of the OVERLAPPED
+		// structures.
+		m_watchesEmptyCondition.wait_for(lock, std::chrono::milliseconds(SHUTDOWN_TIMEOUT_MS),
+			[this] { return m_watches.empty(); });
+	}
+
+	for (size_t i = 0; i < m_threads.size(); i++)
+	{
+		PostQueuedCompletionStatus(m_completionPort, 0, SHUTDOWN_COMPLETION_KEY, nullptr);
+	}
+
+	for (auto &thread : m_threads)
+	{
+		thread.join();
+	}
+
+	if (m_completionPort)
+	{
+		CloseHandle(m_completionPort);
+	}
 }
 
 /* IUnknown interface members. */
@@ -144,296 +226,328 @@ ULONG __stdcall DirectoryMonitor::Release()
 	return m_iRefCount;
 }
 
-DWORD WINAPI Thread_DirModifiedInternal(LPVOID lpParameter)
-{
-	UNREFERENCED_PARAMETER(lpParameter);
-
-	/* This is the main thread. Sleeps until woken up by a
-	change notification, and then goes back to sleep. */
-
-	SetErrorMode(SEM_FAILCRITICALERRORS);
-
-/* Warning C4127 (conditional expression is
-constant) temporarily disabled for this function. */
-#pragma warning(push)
-#pragma warning(disable : 4127)
-	while (TRUE)
-	{
-		SleepEx(INFINITE, TRUE);
-	}
-#pragma warning(pop)
-
-	return 0;
-}
-
-void CALLBACK DirectoryMonitor::ExitWorkerThread(ULONG_PTR dwParam)
-{
-	DirectoryMonitor *pdm = nullptr;
-
-	pdm = (DirectoryMonitor *) dwParam;
-
-	/* Set the event indicating that it is now
-	safe to destroy data that is shared between
-	threads. */
-	SetEvent(pdm->m_hStopThreadEvent);
-
-	ExitThread(0);
-}
-
 int DirectoryMonitor::WatchDirectory(const TCHAR *Directory, UINT WatchFlags,
 	OnDirectoryAltered onDirectoryAltered, BOOL bWatchSubTree, void *pData)
 {
-	DirInfo pDirInfo;
-
 	if (Directory == nullptr)
 	{
+		free(pData);
 		return -1;
 	}
 
-	pDirInfo.m_pDirectoryMonitor = this;
-	pDirInfo.m_hThread = m_hThread;
-	pDirInfo.m_WatchFlags = WatchFlags;
-	pDirInfo.m_UniqueId = m_UniqueId;
-	pDirInfo.m_OnDirectoryAltered = onDirectoryAltered;
-	pDirInfo.m_pData = pData;
-	pDirInfo.m_bWatchSubTree = bWatchSubTree;
-	pDirInfo.m_bMarkedForDeletion = FALSE;
-
 	/* This suppresses crtical error message boxes, such as the one
 	that mey arise from CreateFile() when opening attempting to
 	open a floppy drive that doesn't have a floppy disk (also
 	CD/DVD drives etc). */
 	SetErrorMode(SEM_FAILCRITICALERRORS);
 
-	StringCchCopy(pDirInfo.m_DirPath, SIZEOF_ARRAY(pDirInfo.m_DirPath), Directory);
-
-	pDirInfo.m_hDirectory = CreateFile(pDirInfo.m_DirPath, FILE_LIST_DIRECTORY,
+	HANDLE hDirectory = CreateFile(Directory, FILE_LIST_DIRECTORY,
 		FILE_SHARE_READ | FILE_SHARE_DELETE | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING,
 		FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
 
-	if (pDirInfo.m_hDirectory == INVALID_HANDLE_VALUE)
+	if (hDirectory == INVALID_HANDLE_VALUE)
 	{
 		free(pData);
 		return -1;
 	}
 
-	EnterCriticalSection(&m_cs);
-
-	/* TODO: This operation alters the list, including the
-	previously inserted item (e.g by updating list pointers).
-	Therefore, need to lock access between this function and
-	other reads of the inserted item. */
-	m_DirWatchInfoList.push_back(pDirInfo);
-
-	m_DirWatchInfoList.back().m_Async.hEvent = &m_DirWatchInfoList.back();
-	QueueUserAPC(WatchDirectoryInternal, m_hThread, (ULONG_PTR) &m_DirWatchInfoList.back());
-
-	LeaveCriticalSection(&m_cs);
-
-	return m_UniqueId++;
+	return AddWatch(hDirectory, Directory, WatchFlags, onDirectoryAltered, bWatchSubTree, pData);
 }
 
 int DirectoryMonitor::WatchDirectory(HANDLE hDirectory, const TCHAR *Directory, UINT WatchFlags,
 	OnDirectoryAltered onDirectoryAltered, BOOL bWatchSubTree, void *pData)
 {
-	DirInfo pDirInfo;
-
 	if (Directory == nullptr)
 	{
+		CloseHandle(hDirectory);
+		free(pData);
 		return -1;
 	}
 
-	pDirInfo.m_pDirectoryMonitor = this;
-	pDirInfo.m_hThread = m_hThread;
-	pDirInfo.m_WatchFlags = WatchFlags;
-	pDirInfo.m_UniqueId = m_UniqueId;
-	pDirInfo.m_OnDirectoryAltered = onDirectoryAltered;
-	pDirInfo.m_pData = pData;
-	pDirInfo.m_bWatchSubTree = bWatchSubTree;
-	pDirInfo.m_bMarkedForDeletion = FALSE;
+	return AddWatch(hDirectory, Directory, WatchFlags, onDirectoryAltered, bWatchSubTree, pData);
+}
 
-	/* This suppresses crtical error message boxes, such as the one
-	that mey arise from CreateFile() when opening attempting to
-	open a floppy drive that doesn't have a floppy disk (also
-	CD/DVD drives etc). */
-	SetErrorMode(SEM_FAILCRITICALERRORS);
+// Takes ownership of both the directory handle and the data pointer. Both will be freed once
+// the watch ends or if it can't be started.
+int DirectoryMonitor::AddWatch(HANDLE hDirectory, const TCHAR *Directory, UINT WatchFlags,
+	OnDirectoryAltered onDirectoryAltered, BOOL bWatchSubTree, void *pData)
+{
+	if (!m_completionPort
+		|| !CreateIoCompletionPort(hDirectory, m_completionPort, WATCH_COMPLETION_KEY, 0))
+	{
+		CloseHandle(hDirectory);
+		free(pData);
+		return -1;
+	}
 
-	StringCchCopy(pDirInfo.m_DirPath, SIZEOF_ARRAY(pDirInfo.m_DirPath), Directory);
+	auto dirInfo = std::make_unique<DirInfo>();
+	dirInfo->m_Async = {};
+	dirInfo->m_hDirectory = hDirectory;
+	dirInfo->m_DirPath = Directory;
+	dirInfo->m_WatchFlags = WatchFlags;
+	dirInfo->m_bWatchSubTree = bWatchSubTree;
+	dirInfo->m_OnDirectoryAltered = onDirectoryAltered;
+	dirInfo->m_pData = pData;
+	dirInfo->m_Buffer.resize(
+		GetBufferSize(dirInfo->m_DirPath, bWatchSubTree) / sizeof(ULONGLONG));
+	dirInfo->m_bUseExtendedInformation = (m_readDirectoryChangesEx != nullptr);
+	dirInfo->m_bReadPending = false;
+	dirInfo->m_bStopping = false;
 
-	pDirInfo.m_hDirectory = hDirectory;
+	std::scoped_lock lock(m_mutex);
 
-	EnterCriticalSection(&m_cs);
+	dirInfo->m_UniqueId = m_UniqueId++;
 
-	m_DirWatchInfoList.push_back(pDirInfo);
-	m_DirWatchInfoList.back().m_Async.hEvent = &m_DirWatchInfoList.back();
-	// QueueUserAPC(WatchAndCreateDirectoryInternal,m_hThread,(ULONG_PTR)&m_DirWatchInfoList.back());
-	QueueUserAPC(WatchDirectoryInternal, m_hThread, (ULONG_PTR) &m_DirWatchInfoList.back());
+	DirInfo *rawDirInfo = dirInfo.get();
+	m_watches.emplace(rawDirInfo->m_UniqueId, std::move(dirInfo));
 
-	LeaveCriticalSection(&m_cs);
+	if (!IssueRead(rawDirInfo))
+	{
+		DeleteWatch(rawDirInfo);
+		return -1;
+	}
 
-	return m_UniqueId++;
+	return rawDirInfo->m_UniqueId;
 }
 
-/* These functions (CreateFile and ReadDirectoryChangesW) DO NOT appear
-to put the thread in an alertable wait state. */
-void CALLBACK DirectoryMonitor::WatchAndCreateDirectoryInternal(ULONG_PTR dwParam)
+DWORD DirectoryMonitor::GetBufferSize(const std::wstring &path, BOOL watchSubTree)
 {
-	DirInfo *pDirInfo = nullptr;
-
-	pDirInfo = reinterpret_cast<DirInfo *>(dwParam);
+	if (PathIsNetworkPath(path.c_str()))
+	{
+		return NETWORK_BUFFER_SIZE;
+	}
 
-	pDirInfo->m_hDirectory = CreateFile(pDirInfo->m_DirPath, FILE_LIST_DIRECTORY,
-		FILE_SHARE_READ | FILE_SHARE_DELETE | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING,
-		FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+	if (watchSubTree)
+	{
+		return SUBTREE_BUFFER_SIZE;
+	}
 
-	WatchDirectoryInternal(dwParam);
+	return DEFAULT_BUFFER_SIZE;
 }
 
-void DirectoryMonitor::WatchDirectoryInternal(ULONG_PTR dwParam)
+void DirectoryMonitor::WorkerThread()
 {
-	DirInfo *pDirInfo = nullptr;
-
-	pDirInfo = reinterpret_cast<DirInfo *>(dwParam);
+	SetErrorMode(SEM_FAILCRITICALERRORS);
 
-	if (pDirInfo->m_hDirectory == INVALID_HANDLE_VALUE)
+	while (true)
 	{
-		free(pDirInfo->m_pData);
+		DWORD numBytesTransferred;
+		ULONG_PTR completionKey;
+		OVERLAPPED *overlapped;
+		BOOL res = GetQueuedCompletionStatus(
+			m_completionPort, &numBytesTransferred, &completionKey, &overlapped, INFINITE);
 
-		return;
-	}
-
-	pDirInfo->m_FileNotifyBuffer = (FILE_NOTIFY_INFORMATION *) malloc(PRIMARY_BUFFER_SIZE);
+		if (completionKey == SHUTDOWN_COMPLETION_KEY)
+		{
+			break;
+		}
 
-	pDirInfo->m_bDirMonitored = ReadDirectoryChangesW(pDirInfo->m_hDirectory,
-		pDirInfo->m_FileNotifyBuffer, PRIMARY_BUFFER_SIZE, pDirInfo->m_bWatchSubTree,
-		pDirInfo->m_WatchFlags, nullptr, &pDirInfo->m_Async, CompletionRoutine);
+		if (!overlapped)
+		{
+			continue;
+		}
 
-	if (!pDirInfo->m_bDirMonitored)
-	{
-		free(pDirInfo->m_FileNotifyBuffer);
-		CancelIo(pDirInfo->m_hDirectory);
-		CloseHandle(pDirInfo->m_hDirectory);
+		auto *dirInfo = CONTAINING_RECORD(overlapped, DirInfo, m_Async);
+		OnReadCompleted(dirInfo, res, numBytesTransferred);
 	}
 }
 
-void CALLBACK DirectoryMonitor::CompletionRoutine(
-	DWORD dwErrorCode, DWORD NumberOfBytesTransferred, LPOVERLAPPED lpOverlapped)
+void DirectoryMonitor::OnReadCompleted(
+	DirInfo *dirInfo, BOOL succeeded, DWORD numBytesTransferred)
 {
-	DirInfo *pDirInfo = nullptr;
-	FILE_NOTIFY_INFORMATION *pfni = nullptr;
-	TCHAR szFileName[MAX_PATH];
+	DWORD error = succeeded ? ERROR_SUCCESS : GetLastError();
 
-	if ((dwErrorCode == ERROR_SUCCESS) && (NumberOfBytesTransferred != 0))
 	{
-		if (lpOverlapped->hEvent == nullptr)
+		std::scoped_lock lock(m_mutex);
+
+		dirInfo->m_bReadPending = false;
+
+		// ERROR_OPERATION_ABORTED will be returned once the directory handle has been closed.
+		// Any other error (e.g. ERROR_ACCESS_DENIED when the directory itself is deleted)
+		// means the directory can no longer be watched.
+		if (dirInfo->m_bStopping || (error != ERROR_SUCCESS && error != ERROR_NOTIFY_ENUM_DIR))
 		{
+			DeleteWatch(dirInfo);
 			return;
 		}
+	}
 
-		pDirInfo = reinterpret_cast<DirInfo *>(lpOverlapped->hEvent);
-
-		pfni = pDirInfo->m_FileNotifyBuffer;
-		int i = 0;
+	// If the buffer overflowed, the system will complete the read without returning any
+	// changes. All that can be done at that point is to inform the caller, so that they can
+	// rescan the directory.
+	bool overflowed = (error == ERROR_NOTIFY_ENUM_DIR) || (numBytesTransferred == 0);
+	std::vector<DirectoryChange> changes;
 
-		do
+	if (!overflowed)
+	{
+		if (dirInfo->m_bUseExtendedInformation)
 		{
-			if (i != 0)
-			{
-				pfni = (FILE_NOTIFY_INFORMATION *) ((LPBYTE) pfni + pfni->NextEntryOffset);
-			}
+			changes = ParseExtendedChanges(dirInfo, numBytesTransferred);
+		}
+		else
+		{
+			changes = ParseChanges(dirInfo, numBytesTransferred);
+		}
+	}
 
-			/* FileNameLength is size in bytes NOT characters. */
-			StringCchCopyN(szFileName, SIZEOF_ARRAY(szFileName), pfni->FileName,
-				pfni->FileNameLength / sizeof(TCHAR));
-			pDirInfo->m_OnDirectoryAltered(szFileName, pfni->Action, pDirInfo->m_pData);
+	// The watch can't be freed while there's no read pending, so it's safe to access it here,
+	// without the lock held.
+	dirInfo->m_OnDirectoryAltered(changes, overflowed, dirInfo->m_pData);
 
-			i++;
-		} while (pfni->NextEntryOffset != 0);
+	std::scoped_lock lock(m_mutex);
 
-		free(pDirInfo->m_FileNotifyBuffer);
+	if (dirInfo->m_bStopping || !IssueRead(dirInfo))
+	{
+		DeleteWatch(dirInfo);
+	}
+}
 
-		pDirInfo->m_FileNotifyBuffer = nullptr;
+std::vector<DirectoryChange> DirectoryMonitor::ParseChanges(
+	const DirInfo *dirInfo, DWORD numBytesTransferred)
+{
+	std::vector<DirectoryChange> changes;
+	auto *buffer = reinterpret_cast<const BYTE *>(dirInfo->m_Buffer.data());
+	DWORD offset = 0;
 
-		/* Rewatch the directory. */
-		WatchDirectoryInternal((ULONG_PTR) pDirInfo);
-	}
-	else if (dwErrorCode == ERROR_OPERATION_ABORTED)
+	while (offset + sizeof(FILE_NOTIFY_INFORMATION) <= numBytesTransferred)
 	{
-		pDirInfo = reinterpret_cast<DirInfo *>(lpOverlapped->hEvent);
+		auto *fni = reinterpret_cast<const FILE_NOTIFY_INFORMATION *>(buffer + offset);
+
+		/* FileNameLength is size in bytes NOT characters. */
+		changes.push_back(
+			{ std::wstring(fni->FileName, fni->FileNameLength / sizeof(WCHAR)), fni->Action });
+
+		if (fni->NextEntryOffset == 0)
+		{
+			break;
+		}
 
-		/* The specified directory has stop been watched.
-		Remove its entry from the queue. */
-		DeleteRequest((ULONG_PTR) pDirInfo);
+		offset += fni->NextEntryOffset;
 	}
+
+	return changes;
 }
 
-void DirectoryMonitor::DeleteRequest(ULONG_PTR dwParam)
+// The extended notifications include the state of each item after the change, which means that
+// the caller doesn't have to query the item again to find out what changed.
+std::vector<DirectoryChange> DirectoryMonitor::ParseExtendedChanges(
+	const DirInfo *dirInfo, DWORD numBytesTransferred)
 {
-	DirInfo *pDirInfo = nullptr;
-	DirectoryMonitor *pDirectoryMonitor = nullptr;
-	std::list<DirInfo>::iterator itr;
-
-	pDirInfo = reinterpret_cast<DirInfo *>(dwParam);
+	std::vector<DirectoryChange> changes;
+	auto *buffer = reinterpret_cast<const BYTE *>(dirInfo->m_Buffer.data());
+	DWORD offset = 0;
 
-	pDirectoryMonitor = pDirInfo->m_pDirectoryMonitor;
+	while (offset + sizeof(FileNotifyExtendedInformation) <= numBytesTransferred)
+	{
+		auto *fnei = reinterpret_cast<const FileNotifyExtendedInformation *>(buffer + offset);
 
-	free(pDirInfo->m_FileNotifyBuffer);
-	free(pDirInfo->m_pData);
+		DirectoryChangeDetails details;
+		details.creationTime = LargeIntegerToFileTime(fnei->CreationTime);
+		details.lastWriteTime = LargeIntegerToFileTime(fnei->LastModificationTime);
+		details.lastAccessTime = LargeIntegerToFileTime(fnei->LastAccessTime);
+		details.fileSize.QuadPart = fnei->FileSize.QuadPart;
+		details.attributes = fnei->FileAttributes;
+		details.fileId = DirectoryReader::GetFileIdFromLargeInteger(fnei->FileId);
 
-	EnterCriticalSection(&pDirectoryMonitor->m_cs);
+		changes.push_back(
+			{ std::wstring(fnei->FileName, fnei->FileNameLength / sizeof(WCHAR)), fnei->Action,
+				details });
 
-	for (itr = pDirectoryMonitor->m_DirWatchInfoList.begin();
-		 itr != pDirectoryMonitor->m_DirWatchInfoList.end(); itr++)
-	{
-		if (itr->m_UniqueId == pDirInfo->m_UniqueId)
+		if (fnei->NextEntryOffset == 0)
 		{
-			pDirectoryMonitor->m_DirWatchInfoList.erase(itr);
 			break;
 		}
+
+		offset += fnei->NextEntryOffset;
 	}
 
-	LeaveCriticalSection(&pDirectoryMonitor->m_cs);
+	return changes;
 }
 
-BOOL DirectoryMonitor::StopDirectoryMonitor(int iStopId)
+FILETIME DirectoryMonitor::LargeIntegerToFileTime(const LARGE_INTEGER &value)
 {
-	std::list<DirInfo>::iterator itr;
+	FILETIME fileTime;
+	fileTime.dwLowDateTime = value.LowPart;
+	fileTime.dwHighDateTime = static_cast<DWORD>(value.HighPart);
+	return fileTime;
+}
 
-	if (iStopId < 0)
-	{
-		return FALSE;
-	}
+bool DirectoryMonitor::IssueRead(DirInfo *dirInfo)
+{
+	dirInfo->m_Async = {};
 
-	EnterCriticalSection(&m_cs);
+	auto bufferSize = static_cast<DWORD>(dirInfo->m_Buffer.size() * sizeof(ULONGLONG));
 
-	for (itr = m_DirWatchInfoList.begin(); itr != m_DirWatchInfoList.end(); itr++)
+	if (dirInfo->m_bUseExtendedInformation)
 	{
-		if (itr->m_UniqueId == iStopId)
-		{
-			/* Only stop monitoring the directory if it was
-			actually monitored in the first place! */
-			if (itr->m_bDirMonitored)
-			{
-				QueueUserAPC(StopDirectoryWatch, m_hThread, (ULONG_PTR) itr->m_hDirectory);
-			}
+		BOOL res = m_readDirectoryChangesEx(dirInfo->m_hDirectory, dirInfo->m_Buffer.data(),
+			bufferSize, dirInfo->m_bWatchSubTree, dirInfo->m_WatchFlags, nullptr,
+			&dirInfo->m_Async, nullptr, READ_DIRECTORY_NOTIFY_EXTENDED_INFORMATION);
 
-			break;
+		if (res)
+		{
+			dirInfo->m_bReadPending = true;
+			return true;
 		}
+
+		// The file system doesn't support extended notifications, so fall back to the standard
+		// notifications for this directory.
+		dirInfo->m_bUseExtendedInformation = false;
+		dirInfo->m_Async = {};
 	}
 
-	LeaveCriticalSection(&m_cs);
+	BOOL res = ReadDirectoryChangesW(dirInfo->m_hDirectory, dirInfo->m_Buffer.data(), bufferSize,
+		dirInfo->m_bWatchSubTree, dirInfo->m_WatchFlags, nullptr, &dirInfo->m_Async, nullptr);
 
-	return TRUE;
+	dirInfo->m_bReadPending = res;
+
+	return res;
 }
 
-void CALLBACK DirectoryMonitor::StopDirectoryWatch(ULONG_PTR dwParam)
+void DirectoryMonitor::DeleteWatch(DirInfo *dirInfo)
 {
-	HANDLE hDirectory;
+	if (dirInfo->m_hDirectory != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(dirInfo->m_hDirectory);
+	}
 
-	hDirectory = reinterpret_cast<HANDLE>(dwParam);
+	free(dirInfo->m_pData);
 
-	CancelIo(hDirectory);
-	CloseHandle(hDirectory);
+	m_watches.erase(dirInfo->m_UniqueId);
 
-	hDirectory = nullptr;
+	if (m_watches.empty())
+	{
+		m_watchesEmptyCondition.notify_all();
+	}
+}
+
+BOOL DirectoryMonitor::StopDirectoryMonitor(int iStopId)
+{
+	if (iStopId < 0)
+	{
+		return FALSE;
+	}
+
+	std::scoped_lock lock(m_mutex);
+
+	auto itr = m_watches.find(iStopId);
+
+	if (itr == m_watches.end() || itr->second->m_bStopping)
+	{
+		return TRUE;
+	}
+
+	DirInfo *dirInfo = itr->second.get();
+	dirInfo->m_bStopping = true;
+
+	// If a read is pending, closing the handle will cancel it and the watch will be freed once
+	// the cancellation has been processed. Otherwise, a worker thread is currently processing
+	// a set of changes for this directory and will free the watch once it's done.
+	if (dirInfo->m_bReadPending)
+	{
+		CloseHandle(dirInfo->m_hDirectory);
+		dirInfo->m_hDirectory = INVALID_HANDLE_VALUE;
+	}
+
+	return TRUE;
 }
\ No newline at end of file
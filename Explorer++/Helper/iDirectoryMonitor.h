@@ -5,8 +5,41 @@
 #pragma once
 
 #include <windows.h>
+#include <optional>
+#include <string>
+#include <vector>
 
-typedef void (*OnDirectoryAltered)(const TCHAR *szFileName, DWORD dwAction, void *pData);
+/* The state of the item after the change. This is only
+provided when the system supports extended change
+notifications (Windows 10 version 1709 and later) and the
+file system reports them. */
+struct DirectoryChangeDetails
+{
+	FILETIME creationTime;
+	FILETIME lastWriteTime;
+	FILETIME lastAccessTime;
+	ULARGE_INTEGER fileSize;
+	DWORD attributes;
+
+	/* DirectoryReader::UNKNOWN_FILE_ID if the file system
+	didn't report an ID. */
+	ULONGLONG fileId;
+};
+
+struct DirectoryChange
+{
+	std::wstring fileName;
+	DWORD action;
+	std::optional<DirectoryChangeDetails> details;
+};
+
+/* Changes are delivered in batches, one batch for each set of
+changes reported by the system. If more changes occurred than
+could be recorded, the batch will be empty and overflowed will be
+set. In that case, the directory (and its subdirectories, if they
+were being watched) should be rescanned. */
+typedef void (*OnDirectoryAltered)(
+	const std::vector<DirectoryChange> &changes, bool overflowed, void *pData);
 
 /* Main exported interface. */
 __interface IDirectoryMonitor : IUnknown
@@ -0,0 +1,518 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "ChurnScenario.h"
+#include "HarnessCoreInterface.h"
+#include "PerformanceScenario.h"
+#include "../Explorer++/ShellBrowser/ShellBrowser.h"
+#include "../Explorer++/ShellBrowser/ShellNavigationController.h"
+#include "../Explorer++/ShellTreeView/ShellTreeView.h"
+#include "../Helper/ShellHelper.h"
+#include "../Helper/WindowSubclassWrapper.h"
+#include <Psapi.h>
+#include <algorithm>
+#include <tuple>
+
+namespace
+{
+
+// Returns the number of expected names that aren't shown and the number of shown names that
+// aren't expected.
+std::pair<size_t, size_t> CompareItemNames(const std::unordered_set<std::wstring> &expectedNames,
+	const std::unordered_set<std::wstring> &shownNames)
+{
+	auto numMissing = std::count_if(expectedNames.begin(), expectedNames.end(),
+		[&shownNames](const std::wstring &name) { return !shownNames.contains(name); });
+	auto numUnexpected = std::count_if(shownNames.begin(), shownNames.end(),
+		[&expectedNames](const std::wstring &name) { return !expectedNames.contains(name); });
+
+	return { static_cast<size_t>(numMissing), static_cast<size_t>(numUnexpected) };
+}
+
+}
+
+const std::chrono::milliseconds ChurnScenario::MESSAGE_POLL_INTERVAL(10);
+const std::chrono::milliseconds ChurnScenario::MEMORY_SAMPLE_INTERVAL(100);
+
+ChurnScenario::ChurnScenario(HWND owner, HarnessCoreInterface *coreInterface,
+	const std::filesystem::path &directory, const ChurnSettings &settings,
+	std::chrono::milliseconds settleTimeout) :
+	m_owner(owner),
+	m_coreInterface(coreInterface),
+	m_directory(directory),
+	m_churnDuration(settings.duration),
+	m_settleTimeout(settleTimeout),
+	m_churn(directory, settings)
+{
+	CreateDirectoryMonitor(m_treeDirectoryMonitor.put());
+
+	m_shellTreeView = std::make_unique<ShellTreeView>(m_owner, m_coreInterface,
+		m_treeDirectoryMonitor.get(), nullptr, &m_fileActionHandler,
+		m_coreInterface->GetCachedIcons());
+
+	m_hostSubclass = std::make_unique<WindowSubclassWrapper>(m_owner,
+		std::bind_front(&ChurnScenario::HostWndProc, this), HOST_SUBCLASS_ID);
+}
+
+ChurnScenario::~ChurnScenario() = default;
+
+ChurnRunResult ChurnScenario::Run(ChurnNotificationSource source)
+{
+	ChurnRunResult result;
+	result.source = source;
+
+	m_churn.Reset();
+	m_browserTracker = {};
+	m_treeTracker = {};
+
+	m_coreInterface->SetRegisterForShellNotifications(
+		source == ChurnNotificationSource::ShellNotifications);
+
+	auto shellBrowser = ShellBrowser::CreateNew(BROWSER_ID, m_owner, m_coreInterface,
+		m_coreInterface, &m_fileActionHandler,
+		m_coreInterface->GetConfig()->defaultFolderSettings, std::nullopt);
+	m_shellBrowser = shellBrowser.get();
+	m_coreInterface->SetActiveShellBrowser(m_shellBrowser);
+	PositionWindows(m_shellBrowser->GetListView());
+
+	auto connection = m_shellBrowser->AddNavigationCompletedObserver(
+		[this](PCIDLIST_ABSOLUTE pidlDirectory)
+		{
+			UNREFERENCED_PARAMETER(pidlDirectory);
+
+			m_navigationCompleted = true;
+		});
+
+	m_navigationCompleted = false;
+	m_shellBrowser->GetNavigationController()->BrowseFolder(m_directory.wstring());
+
+	auto setupDeadline = std::chrono::steady_clock::now() + m_settleTimeout;
+	result.settledBeforeChurn = DispatchMessagesUntil(
+		[this]
+		{
+			return m_navigationCompleted
+				&& PerformanceScenario::IsIdle(m_shellBrowser->GetDiagnostics())
+				&& !m_shellTreeView->IsOpeningDrives();
+		},
+		setupDeadline);
+
+	// Declared after the browser, so that it's destroyed first.
+	wil::com_ptr_nothrow<IDirectoryMonitor> browserDirectoryMonitor;
+
+	if (source == ChurnNotificationSource::DirectoryMonitor)
+	{
+		CreateDirectoryMonitor(browserDirectoryMonitor.put());
+		WatchBrowserDirectory(browserDirectoryMonitor.get());
+	}
+
+	// The directory was recreated above, which the tree may still be in the process of
+	// reflecting.
+	result.settledBeforeChurn = result.settledBeforeChurn
+		&& DispatchMessagesUntil([this] { return AreViewsConsistent(); }, setupDeadline);
+
+	result.privateBytesStart = GetPrivateBytes();
+	result.browserItemInfoBytesStart = m_shellBrowser->GetDiagnostics().itemInfoBytes;
+	m_privateBytesPeak = result.privateBytesStart;
+	m_dispatchTime = {};
+	m_numMessagesDispatched = 0;
+	auto cpuTimeStart = GetThreadCpuTime();
+
+	auto churnStartTime = std::chrono::steady_clock::now();
+	m_churn.Start();
+
+	// The churn stops by itself once the duration has elapsed. The deadline only guards against
+	// the churn thread being stalled.
+	DispatchMessagesUntil([this] { return m_churn.IsFinished(); },
+		churnStartTime + m_churnDuration + m_settleTimeout);
+	m_churn.Stop();
+
+	auto churnEndTime = std::chrono::steady_clock::now();
+	result.churnDuration =
+		std::chrono::duration_cast<std::chrono::microseconds>(churnEndTime - churnStartTime);
+
+	result.settledAfterChurn = DispatchMessagesUntil(
+		[this]
+		{
+			return m_browserTracker.pendingOperations.empty()
+				&& m_treeTracker.pendingOperations.empty();
+		},
+		churnEndTime + m_settleTimeout);
+	result.settleDuration = std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now() - churnEndTime);
+
+	result.uiThreadBusy = m_dispatchTime;
+	result.numMessagesDispatched = m_numMessagesDispatched;
+	result.uiThreadCpu = GetThreadCpuTime() - cpuTimeStart;
+	result.privateBytesEnd = GetPrivateBytes();
+	result.privateBytesPeak = std::max(m_privateBytesPeak, result.privateBytesEnd);
+	result.browserItemInfoBytesEnd = m_shellBrowser->GetDiagnostics().itemInfoBytes;
+
+	result.numOperations = m_browserTracker.result.numOperations;
+	result.numFailedOperations = m_churn.GetNumFailedOperations();
+	result.numSkippedOperations = m_churn.GetNumSkippedOperations();
+
+	m_browserTracker.result.numDropped = m_browserTracker.pendingOperations.size();
+	m_treeTracker.result.numDropped = m_treeTracker.pendingOperations.size();
+	Reconcile();
+
+	result.shellBrowser = std::move(m_browserTracker.result);
+	result.shellTreeView = std::move(m_treeTracker.result);
+
+	browserDirectoryMonitor.reset();
+	connection.disconnect();
+	m_coreInterface->SetActiveShellBrowser(nullptr);
+	m_shellBrowser = nullptr;
+
+	return result;
+}
+
+void ChurnScenario::PositionWindows(HWND listView)
+{
+	RECT rc;
+	GetClientRect(m_owner, &rc);
+	SetWindowPos(m_shellTreeView->GetHWND(), nullptr, 0, 0, TREE_VIEW_WIDTH, rc.bottom,
+		SWP_NOZORDER);
+	SetWindowPos(listView, nullptr, TREE_VIEW_WIDTH, 0, rc.right - TREE_VIEW_WIDTH, rc.bottom,
+		SWP_NOZORDER);
+}
+
+// This mirrors Explorerplusplus::HandleDirectoryMonitoring().
+void ChurnScenario::WatchBrowserDirectory(IDirectoryMonitor *directoryMonitor)
+{
+	auto *watchData = static_cast<BrowserWatchData *>(malloc(sizeof(BrowserWatchData)));
+	watchData->shellBrowser = m_shellBrowser;
+	watchData->uniqueFolderId = m_shellBrowser->GetUniqueFolderId();
+
+	int monitorId = directoryMonitor->WatchDirectory(m_shellBrowser->GetDirectory().c_str(),
+		FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_DIR_NAME
+			| FILE_NOTIFY_CHANGE_ATTRIBUTES | FILE_NOTIFY_CHANGE_LAST_WRITE
+			| FILE_NOTIFY_CHANGE_LAST_ACCESS | FILE_NOTIFY_CHANGE_CREATION
+			| FILE_NOTIFY_CHANGE_SECURITY,
+		OnBrowserDirectoryAltered, FALSE, watchData);
+	m_shellBrowser->SetDirMonitorId(monitorId);
+}
+
+// Called on one of the directory monitor's threads.
+void ChurnScenario::OnBrowserDirectoryAltered(
+	const std::vector<DirectoryChange> &changes, bool overflowed, void *data)
+{
+	auto *watchData = static_cast<BrowserWatchData *>(data);
+	watchData->shellBrowser->FilesModified(
+		changes, overflowed, BROWSER_ID, watchData->uniqueFolderId);
+}
+
+// Once the changes passed to FilesModified() are ready to be applied, the browser sends this
+// message to its owner, which is expected to call back into the browser. The application does the
+// same thing in its main window procedure.
+LRESULT ChurnScenario::HostWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
+{
+	if (msg == WM_USER_FILESADDED && m_shellBrowser && static_cast<int>(wParam) == BROWSER_ID)
+	{
+		m_shellBrowser->DirectoryAltered();
+		return 0;
+	}
+
+	return DefSubclassProc(hwnd, msg, wParam, lParam);
+}
+
+// The views are checked after each batch of messages, since that's the only time they can change.
+// The time taken by the checks isn't included in the busy time, as they're only performed by the
+// harness.
+bool ChurnScenario::DispatchMessagesUntil(
+	const std::function<bool()> &predicate, std::chrono::steady_clock::time_point deadline)
+{
+	while (true)
+	{
+		ProcessOperations();
+		SampleMemory();
+
+		if (predicate())
+		{
+			return true;
+		}
+
+		auto now = std::chrono::steady_clock::now();
+
+		if (now >= deadline)
+		{
+			return false;
+		}
+
+		auto timeout = std::min(
+			std::chrono::ceil<std::chrono::milliseconds>(deadline - now), MESSAGE_POLL_INTERVAL);
+		MsgWaitForMultipleObjectsEx(
+			0, nullptr, static_cast<DWORD>(timeout.count()), QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+
+		MSG msg;
+
+		while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
+		{
+			auto dispatchStartTime = std::chrono::steady_clock::now();
+
+			TranslateMessage(&msg);
+			DispatchMessage(&msg);
+
+			m_dispatchTime += std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::steady_clock::now() - dispatchStartTime);
+			m_numMessagesDispatched++;
+		}
+	}
+}
+
+void ChurnScenario::ProcessOperations()
+{
+	for (const auto &operation : m_churn.TakeOperations())
+	{
+		TrackOperation(m_browserTracker, operation);
+
+		// The tree only shows folders.
+		if (operation.isFolder)
+		{
+			TrackOperation(m_treeTracker, operation);
+		}
+	}
+
+	// No messages are dispatched while the views are being checked, so this is the time at which
+	// their state was observed.
+	auto now = std::chrono::steady_clock::now();
+
+	UpdateTracker(m_browserTracker, std::bind_front(&ChurnScenario::IsVisibleInBrowser, this), now);
+
+	if (!m_treeTracker.pendingOperations.empty())
+	{
+		auto treeItemNames = GetTreeItemNames();
+		UpdateTracker(m_treeTracker,
+			[&treeItemNames](const ChurnOperation &operation)
+			{
+				return IsVisibleInTree(operation, treeItemNames);
+			},
+			now);
+	}
+}
+
+void ChurnScenario::TrackOperation(ViewTracker &tracker, const ChurnOperation &operation)
+{
+	tracker.result.numOperations++;
+
+	bool inserted = tracker.pendingOperations.insert_or_assign(operation.itemId, operation).second;
+
+	if (!inserted)
+	{
+		tracker.result.numSuperseded++;
+	}
+}
+
+void ChurnScenario::UpdateTracker(ViewTracker &tracker,
+	const std::function<bool(const ChurnOperation &)> &isVisible,
+	std::chrono::steady_clock::time_point now)
+{
+	std::erase_if(tracker.pendingOperations,
+		[&tracker, &isVisible, now](const auto &entry)
+		{
+			const auto &operation = entry.second;
+
+			if (!isVisible(operation))
+			{
+				return false;
+			}
+
+			tracker.result.latencies[operation.type].push_back(
+				std::chrono::duration<double, std::milli>(now - operation.completed).count());
+			return true;
+		});
+}
+
+bool ChurnScenario::IsVisibleInBrowser(const ChurnOperation &operation) const
+{
+	int index = m_shellBrowser->LocateFileItemIndex(operation.name.c_str());
+
+	switch (operation.type)
+	{
+	case ChurnOperationType::Create:
+		return index != -1;
+
+	case ChurnOperationType::Modify:
+	{
+		if (index == -1)
+		{
+			return false;
+		}
+
+		auto findData = m_shellBrowser->GetItemFileFindData(index);
+		return findData.nFileSizeHigh == 0 && findData.nFileSizeLow == operation.size;
+	}
+
+	case ChurnOperationType::Rename:
+		return index != -1
+			&& m_shellBrowser->LocateFileItemIndex(operation.previousName.c_str()) == -1;
+
+	case ChurnOperationType::Delete:
+		return index == -1;
+	}
+
+	return false;
+}
+
+bool ChurnScenario::IsVisibleInTree(
+	const ChurnOperation &operation, const std::unordered_set<std::wstring> &treeItemNames)
+{
+	switch (operation.type)
+	{
+	case ChurnOperationType::Create:
+	case ChurnOperationType::Modify:
+		return treeItemNames.contains(operation.name);
+
+	case ChurnOperationType::Rename:
+		return treeItemNames.contains(operation.name)
+			&& !treeItemNames.contains(operation.previousName);
+
+	case ChurnOperationType::Delete:
+		return !treeItemNames.contains(operation.name);
+	}
+
+	return false;
+}
+
+bool ChurnScenario::AreViewsConsistent()
+{
+	const std::pair<size_t, size_t> noDifferences(0, 0);
+
+	return CompareItemNames(GetExpectedItemNames(false), GetBrowserItemNames()) == noDifferences
+		&& CompareItemNames(GetExpectedItemNames(true), GetTreeItemNames()) == noDifferences;
+}
+
+// Latencies only show how quickly individual changes appear. This catches changes that were
+// applied incorrectly (e.g. an item that was renamed twice, but is shown under its first name).
+void ChurnScenario::Reconcile()
+{
+	std::tie(m_browserTracker.result.numMissingItems, m_browserTracker.result.numUnexpectedItems) =
+		CompareItemNames(GetExpectedItemNames(false), GetBrowserItemNames());
+	std::tie(m_treeTracker.result.numMissingItems, m_treeTracker.result.numUnexpectedItems) =
+		CompareItemNames(GetExpectedItemNames(true), GetTreeItemNames());
+}
+
+std::unordered_set<std::wstring> ChurnScenario::GetExpectedItemNames(bool foldersOnly) const
+{
+	std::unordered_set<std::wstring> names = { DirectoryChurn::ANCHOR_FOLDER_NAME };
+
+	for (const auto &item : m_churn.GetItems())
+	{
+		if (!foldersOnly || item.isFolder)
+		{
+			names.insert(item.name);
+		}
+	}
+
+	return names;
+}
+
+std::unordered_set<std::wstring> ChurnScenario::GetBrowserItemNames() const
+{
+	std::unordered_set<std::wstring> names;
+
+	for (int i = 0; i < m_shellBrowser->GetNumItems(); i++)
+	{
+		names.insert(m_shellBrowser->GetItemName(i));
+	}
+
+	return names;
+}
+
+// The directory is located through the anchor folder each time, since the item representing the
+// directory is replaced if the directory is recreated. Locating the anchor folder also ensures
+// that the directory is expanded, which is necessary for changes within it to be shown.
+std::unordered_set<std::wstring> ChurnScenario::GetTreeItemNames()
+{
+	std::unordered_set<std::wstring> names;
+
+	unique_pidl_absolute anchorPidl;
+	HRESULT hr =
+		SHParseDisplayName((m_directory / DirectoryChurn::ANCHOR_FOLDER_NAME).c_str(), nullptr,
+			wil::out_param(anchorPidl), 0, nullptr);
+
+	if (FAILED(hr))
+	{
+		return names;
+	}
+
+	HTREEITEM anchorItem = m_shellTreeView->LocateItem(anchorPidl.get());
+
+	if (!anchorItem)
+	{
+		return names;
+	}
+
+	HWND treeView = m_shellTreeView->GetHWND();
+	HTREEITEM directoryItem = TreeView_GetParent(treeView, anchorItem);
+
+	for (HTREEITEM item = TreeView_GetChild(treeView, directoryItem); item;
+		 item = TreeView_GetNextSibling(treeView, item))
+	{
+		if (m_shellTreeView->IsLoadingPlaceholder(item))
+		{
+			continue;
+		}
+
+		std::wstring name;
+		hr = GetDisplayName(
+			m_shellTreeView->GetItemPidl(item).get(), SHGDN_INFOLDER | SHGDN_FORPARSING, name);
+
+		if (SUCCEEDED(hr))
+		{
+			names.insert(name);
+		}
+	}
+
+	return names;
+}
+
+void ChurnScenario::SampleMemory()
+{
+	auto now = std::chrono::steady_clock::now();
+
+	if (now - m_lastMemorySample < MEMORY_SAMPLE_INTERVAL)
+	{
+		return;
+	}
+
+	m_privateBytesPeak = std::max(m_privateBytesPeak, GetPrivateBytes());
+	m_lastMemorySample = now;
+}
+
+uint64_t ChurnScenario::GetPrivateBytes()
+{
+	PROCESS_MEMORY_COUNTERS_EX counters = {};
+	BOOL res = GetProcessMemoryInfo(GetCurrentProcess(),
+		reinterpret_cast<PROCESS_MEMORY_COUNTERS *>(&counters), sizeof(counters));
+
+	if (!res)
+	{
+		return 0;
+	}
+
+	return counters.PrivateUsage;
+}
+
+std::chrono::microseconds ChurnScenario::GetThreadCpuTime()
+{
+	FILETIME creationTime;
+	FILETIME exitTime;
+	FILETIME kernelTime;
+	FILETIME userTime;
+	BOOL res = GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime);
+
+	if (!res)
+	{
+		return {};
+	}
+
+	// The times are in 100 nanosecond intervals.
+	auto toMicroseconds = [](const FILETIME &time)
+	{
+		return std::chrono::microseconds(
+			((static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime) / 10);
+	};
+
+	return toMicroseconds(kernelTime) + toMicroseconds(userTime);
+}
\ No newline at end of file
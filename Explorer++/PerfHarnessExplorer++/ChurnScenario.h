@@ -0,0 +1,188 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "DirectoryChurn.h"
+#include "../Helper/FileActionHandler.h"
+#include "../Helper/iDirectoryMonitor.h"
+#include "../Helper/Macros.h"
+#include <wil/com.h>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class HarnessCoreInterface;
+class ShellBrowser;
+class ShellTreeView;
+class WindowSubclassWrapper;
+
+enum class ChurnNotificationSource
+{
+	// The browser registers for shell change notifications itself.
+	ShellNotifications,
+
+	// The harness watches the folder with an IDirectoryMonitor instance and forwards the changes
+	// to the browser, in the same way the application does.
+	DirectoryMonitor
+};
+
+struct ChurnViewResult
+{
+	size_t numOperations = 0;
+
+	// The time from each operation completing to its result being visible, in milliseconds.
+	std::map<ChurnOperationType, std::vector<double>> latencies;
+
+	// Operations that were followed by another operation on the same item before they became
+	// visible. These have no meaningful latency, since the view may skip straight to the final
+	// state.
+	size_t numSuperseded = 0;
+
+	// Operations that still weren't visible once the settle timeout had expired.
+	size_t numDropped = 0;
+
+	// Once everything has settled, the number of items that exist but aren't shown and the number
+	// of items that are shown but don't exist.
+	size_t numMissingItems = 0;
+	size_t numUnexpectedItems = 0;
+};
+
+struct ChurnRunResult
+{
+	ChurnNotificationSource source;
+
+	size_t numOperations = 0;
+	size_t numFailedOperations = 0;
+	size_t numSkippedOperations = 0;
+
+	std::chrono::microseconds churnDuration = {};
+
+	// The time from the churn finishing to every operation being visible in both views.
+	std::chrono::microseconds settleDuration = {};
+
+	// The time spent within DispatchMessage() over the churn and settle periods. That's the time
+	// the UI thread would have been unavailable for input in the application.
+	std::chrono::microseconds uiThreadBusy = {};
+	size_t numMessagesDispatched = 0;
+
+	// The CPU time consumed by the UI thread over the same period. Unlike the busy time, this
+	// includes the (small) cost of checking the views.
+	std::chrono::microseconds uiThreadCpu = {};
+
+	uint64_t privateBytesStart = 0;
+	uint64_t privateBytesPeak = 0;
+	uint64_t privateBytesEnd = 0;
+
+	// The browser's own estimate of the memory used by its items.
+	size_t browserItemInfoBytesStart = 0;
+	size_t browserItemInfoBytesEnd = 0;
+
+	// Whether the views were consistent with the directory before the churn started and
+	// consistent again within the settle timeout.
+	bool settledBeforeChurn = false;
+	bool settledAfterChurn = false;
+
+	ChurnViewResult shellBrowser;
+
+	// The tree only shows folders, so only operations on folders are tracked.
+	ChurnViewResult shellTreeView;
+};
+
+// Churns a directory while it's displayed in a real ShellBrowser, with a real ShellTreeView
+// expanded to the same directory, and measures how the two views keep up. The tree always uses
+// its own IDirectoryMonitor instance, as it does in the application.
+class ChurnScenario
+{
+public:
+	ChurnScenario(HWND owner, HarnessCoreInterface *coreInterface,
+		const std::filesystem::path &directory, const ChurnSettings &settings,
+		std::chrono::milliseconds settleTimeout);
+	~ChurnScenario();
+
+	// Each run resets the directory and uses a new browser. Throws
+	// std::filesystem::filesystem_error if the directory can't be reset.
+	ChurnRunResult Run(ChurnNotificationSource source);
+
+private:
+	DISALLOW_COPY_AND_ASSIGN(ChurnScenario);
+
+	struct ViewTracker
+	{
+		// Operations that aren't visible yet, keyed by item id. Only the most recent operation
+		// on each item is tracked.
+		std::unordered_map<uint64_t, ChurnOperation> pendingOperations;
+
+		ChurnViewResult result;
+	};
+
+	// The data passed to the directory monitor. This is freed by the monitor.
+	struct BrowserWatchData
+	{
+		ShellBrowser *shellBrowser;
+		int uniqueFolderId;
+	};
+
+	static const int BROWSER_ID = 0;
+	static const UINT_PTR HOST_SUBCLASS_ID = 0;
+	static const int TREE_VIEW_WIDTH = 250;
+	static const std::chrono::milliseconds MESSAGE_POLL_INTERVAL;
+	static const std::chrono::milliseconds MEMORY_SAMPLE_INTERVAL;
+
+	void PositionWindows(HWND listView);
+	void WatchBrowserDirectory(IDirectoryMonitor *directoryMonitor);
+	static void OnBrowserDirectoryAltered(
+		const std::vector<DirectoryChange> &changes, bool overflowed, void *data);
+	LRESULT HostWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
+
+	bool DispatchMessagesUntil(
+		const std::function<bool()> &predicate, std::chrono::steady_clock::time_point deadline);
+	void ProcessOperations();
+	static void TrackOperation(ViewTracker &tracker, const ChurnOperation &operation);
+	static void UpdateTracker(ViewTracker &tracker,
+		const std::function<bool(const ChurnOperation &)> &isVisible,
+		std::chrono::steady_clock::time_point now);
+	bool IsVisibleInBrowser(const ChurnOperation &operation) const;
+	static bool IsVisibleInTree(
+		const ChurnOperation &operation, const std::unordered_set<std::wstring> &treeItemNames);
+	bool AreViewsConsistent();
+	void Reconcile();
+	std::unordered_set<std::wstring> GetExpectedItemNames(bool foldersOnly) const;
+	std::unordered_set<std::wstring> GetBrowserItemNames() const;
+	std::unordered_set<std::wstring> GetTreeItemNames();
+	void SampleMemory();
+	static uint64_t GetPrivateBytes();
+	static std::chrono::microseconds GetThreadCpuTime();
+
+	HWND m_owner;
+	HarnessCoreInterface *m_coreInterface;
+	const std::filesystem::path m_directory;
+	const std::chrono::seconds m_churnDuration;
+	const std::chrono::milliseconds m_settleTimeout;
+	FileActionHandler m_fileActionHandler;
+	DirectoryChurn m_churn;
+
+	std::unique_ptr<ShellTreeView> m_shellTreeView;
+
+	// Declared after the tree, so that it's destroyed first. Destroying the monitor stops every
+	// watch and waits for any callbacks that are in progress.
+	wil::com_ptr_nothrow<IDirectoryMonitor> m_treeDirectoryMonitor;
+
+	std::unique_ptr<WindowSubclassWrapper> m_hostSubclass;
+
+	// State for the run in progress.
+	ShellBrowser *m_shellBrowser = nullptr;
+	bool m_navigationCompleted = false;
+	ViewTracker m_browserTracker;
+	ViewTracker m_treeTracker;
+	std::chrono::microseconds m_dispatchTime = {};
+	size_t m_numMessagesDispatched = 0;
+	uint64_t m_privateBytesPeak = 0;
+	std::chrono::steady_clock::time_point m_lastMemorySample;
+};
\ No newline at end of file
@@ -0,0 +1,381 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "DirectoryChurn.h"
+#include <boost/format.hpp>
+#include <wil/resource.h>
+#include <array>
+
+namespace
+{
+
+const uint64_t CHURN_SEED = 0x4578706c6f726572;
+
+const DWORD MAX_FILE_SIZE = 64 * 1024;
+
+// Modifications are only made to files, so a number of items are tried before the modification is
+// skipped.
+const int MAX_ITEM_CHOICE_ATTEMPTS = 8;
+
+}
+
+const std::chrono::milliseconds DirectoryChurn::SCHEDULE_INTERVAL(1);
+
+DirectoryChurn::DirectoryChurn(
+	const std::filesystem::path &directory, const ChurnSettings &settings) :
+	m_directory(directory),
+	m_settings(settings),
+	m_buffer(MAX_FILE_SIZE, 'x')
+{
+}
+
+DirectoryChurn::~DirectoryChurn()
+{
+	Stop();
+}
+
+void DirectoryChurn::Reset()
+{
+	std::filesystem::remove_all(m_directory);
+	std::filesystem::create_directories(m_directory / ANCHOR_FOLDER_NAME);
+
+	m_generator.seed(CHURN_SEED);
+	m_items.clear();
+	m_itemIdCounter = 0;
+	m_nameCounter = 0;
+	m_numFailedOperations = 0;
+	m_numSkippedOperations = 0;
+	m_finished = false;
+	m_operations.clear();
+
+	for (size_t i = 0; i < m_settings.numInitialFiles; i++)
+	{
+		uint64_t id = m_itemIdCounter++;
+		auto name = GenerateName(id, false);
+		DWORD size = std::uniform_int_distribution<DWORD>(0, MAX_FILE_SIZE)(m_generator);
+
+		if (!WriteFileContents(m_directory / name, size, CREATE_NEW))
+		{
+			throw std::filesystem::filesystem_error("Couldn't create file", m_directory / name,
+				std::error_code(static_cast<int>(GetLastError()), std::system_category()));
+		}
+
+		m_items.emplace_back(id, name, false, size);
+	}
+}
+
+void DirectoryChurn::Start()
+{
+	m_thread = std::jthread(std::bind_front(&DirectoryChurn::Run, this));
+}
+
+void DirectoryChurn::Stop()
+{
+	if (m_thread.joinable())
+	{
+		m_thread.request_stop();
+		m_thread.join();
+	}
+}
+
+bool DirectoryChurn::IsFinished() const
+{
+	return m_finished;
+}
+
+std::vector<ChurnOperation> DirectoryChurn::TakeOperations()
+{
+	std::scoped_lock lock(m_operationsMutex);
+	return std::exchange(m_operations, {});
+}
+
+std::vector<ChurnItem> DirectoryChurn::GetItems() const
+{
+	std::vector<ChurnItem> items;
+
+	for (const auto &item : m_items)
+	{
+		items.emplace_back(item.name, item.isFolder);
+	}
+
+	return items;
+}
+
+size_t DirectoryChurn::GetNumFailedOperations() const
+{
+	return m_numFailedOperations;
+}
+
+size_t DirectoryChurn::GetNumSkippedOperations() const
+{
+	return m_numSkippedOperations;
+}
+
+const char *DirectoryChurn::GetOperationTypeName(ChurnOperationType type)
+{
+	switch (type)
+	{
+	case ChurnOperationType::Create:
+		return "create";
+
+	case ChurnOperationType::Modify:
+		return "modify";
+
+	case ChurnOperationType::Rename:
+		return "rename";
+
+	case ChurnOperationType::Delete:
+		return "delete";
+	}
+
+	return "unknown";
+}
+
+void DirectoryChurn::Run(std::stop_token stopToken)
+{
+	const std::array<std::pair<ChurnOperationType, double>, 4> rates = {
+		{ { ChurnOperationType::Create, m_settings.createRate },
+			{ ChurnOperationType::Modify, m_settings.modifyRate },
+			{ ChurnOperationType::Rename, m_settings.renameRate },
+			{ ChurnOperationType::Delete, m_settings.deleteRate } }
+	};
+	std::array<uint64_t, rates.size()> numPerformed = {};
+
+	auto startTime = std::chrono::steady_clock::now();
+	auto endTime = startTime + m_settings.duration;
+
+	while (!stopToken.stop_requested())
+	{
+		auto now = std::chrono::steady_clock::now();
+
+		if (now >= endTime)
+		{
+			break;
+		}
+
+		double elapsedSeconds = std::chrono::duration<double>(now - startTime).count();
+		bool anyDue = false;
+
+		// A single operation of each type that's due is performed on each pass, so that the
+		// different types are interleaved, rather than performed in bursts.
+		for (size_t i = 0; i < rates.size(); i++)
+		{
+			auto numDue = static_cast<uint64_t>(rates[i].second * elapsedSeconds);
+
+			if (numPerformed[i] < numDue)
+			{
+				PerformOperation(rates[i].first);
+				numPerformed[i]++;
+				anyDue = true;
+			}
+		}
+
+		if (!anyDue)
+		{
+			std::this_thread::sleep_for(SCHEDULE_INTERVAL);
+		}
+	}
+
+	m_finished = true;
+}
+
+void DirectoryChurn::PerformOperation(ChurnOperationType type)
+{
+	std::optional<ChurnOperation> operation;
+
+	switch (type)
+	{
+	case ChurnOperationType::Create:
+		operation = CreateItem();
+		break;
+
+	case ChurnOperationType::Modify:
+		operation = ModifyItem();
+		break;
+
+	case ChurnOperationType::Rename:
+		operation = RenameItem();
+		break;
+
+	case ChurnOperationType::Delete:
+		operation = DeleteItem();
+		break;
+	}
+
+	if (!operation)
+	{
+		return;
+	}
+
+	operation->completed = std::chrono::steady_clock::now();
+
+	std::scoped_lock lock(m_operationsMutex);
+	m_operations.push_back(std::move(*operation));
+}
+
+std::optional<ChurnOperation> DirectoryChurn::CreateItem()
+{
+	uint64_t id = m_itemIdCounter++;
+	bool isFolder =
+		std::uniform_int_distribution<int>(0, 99)(m_generator) < m_settings.folderPercentage;
+	auto name = GenerateName(id, isFolder);
+	DWORD size = 0;
+	bool succeeded;
+
+	if (isFolder)
+	{
+		succeeded = CreateDirectory((m_directory / name).c_str(), nullptr);
+	}
+	else
+	{
+		size = std::uniform_int_distribution<DWORD>(0, MAX_FILE_SIZE)(m_generator);
+		succeeded = WriteFileContents(m_directory / name, size, CREATE_NEW);
+	}
+
+	if (!succeeded)
+	{
+		m_numFailedOperations++;
+		return std::nullopt;
+	}
+
+	m_items.emplace_back(id, name, isFolder, size);
+
+	return ChurnOperation{ ChurnOperationType::Create, id, isFolder, name, L"", size };
+}
+
+std::optional<ChurnOperation> DirectoryChurn::ModifyItem()
+{
+	auto index = ChooseItem(true);
+
+	if (!index)
+	{
+		m_numSkippedOperations++;
+		return std::nullopt;
+	}
+
+	auto &item = m_items[*index];
+
+	// The size always changes, so that the modification can be distinguished from the original
+	// file.
+	DWORD size = std::uniform_int_distribution<DWORD>(0, MAX_FILE_SIZE - 1)(m_generator);
+
+	if (size >= item.size)
+	{
+		size++;
+	}
+
+	if (!WriteFileContents(m_directory / item.name, size, OPEN_EXISTING))
+	{
+		m_numFailedOperations++;
+		return std::nullopt;
+	}
+
+	item.size = size;
+
+	return ChurnOperation{ ChurnOperationType::Modify, item.id, false, item.name, L"", size };
+}
+
+std::optional<ChurnOperation> DirectoryChurn::RenameItem()
+{
+	auto index = ChooseItem(false);
+
+	if (!index)
+	{
+		m_numSkippedOperations++;
+		return std::nullopt;
+	}
+
+	auto &item = m_items[*index];
+	auto newName = GenerateName(item.id, item.isFolder);
+
+	if (!MoveFile((m_directory / item.name).c_str(), (m_directory / newName).c_str()))
+	{
+		m_numFailedOperations++;
+		return std::nullopt;
+	}
+
+	auto previousName = std::exchange(item.name, newName);
+
+	return ChurnOperation{ ChurnOperationType::Rename, item.id, item.isFolder, item.name,
+		previousName, item.size };
+}
+
+std::optional<ChurnOperation> DirectoryChurn::DeleteItem()
+{
+	auto index = ChooseItem(false);
+
+	if (!index)
+	{
+		m_numSkippedOperations++;
+		return std::nullopt;
+	}
+
+	auto &item = m_items[*index];
+	auto path = m_directory / item.name;
+	BOOL res = item.isFolder ? RemoveDirectory(path.c_str()) : DeleteFile(path.c_str());
+
+	if (!res)
+	{
+		m_numFailedOperations++;
+		return std::nullopt;
+	}
+
+	ChurnOperation operation{ ChurnOperationType::Delete, item.id, item.isFolder, item.name, L"",
+		item.size };
+
+	if (*index != m_items.size() - 1)
+	{
+		item = std::move(m_items.back());
+	}
+
+	m_items.pop_back();
+
+	return operation;
+}
+
+std::optional<size_t> DirectoryChurn::ChooseItem(bool filesOnly)
+{
+	if (m_items.empty())
+	{
+		return std::nullopt;
+	}
+
+	std::uniform_int_distribution<size_t> distribution(0, m_items.size() - 1);
+
+	for (int i = 0; i < MAX_ITEM_CHOICE_ATTEMPTS; i++)
+	{
+		size_t index = distribution(m_generator);
+
+		if (!filesOnly || !m_items[index].isFolder)
+		{
+			return index;
+		}
+	}
+
+	return std::nullopt;
+}
+
+bool DirectoryChurn::WriteFileContents(
+	const std::filesystem::path &path, DWORD size, DWORD disposition)
+{
+	wil::unique_hfile file(CreateFile(
+		path.c_str(), GENERIC_WRITE, 0, nullptr, disposition, FILE_ATTRIBUTE_NORMAL, nullptr));
+
+	if (!file)
+	{
+		return false;
+	}
+
+	DWORD numBytesWritten;
+
+	return WriteFile(file.get(), m_buffer.data(), size, &numBytesWritten, nullptr)
+		&& SetEndOfFile(file.get());
+}
+
+// Renamed items keep their id, so a counter is included to make the new name unique.
+std::wstring DirectoryChurn::GenerateName(uint64_t id, bool isFolder)
+{
+	return (boost::wformat(L"churn%d-%d%s") % id % m_nameCounter++ % (isFolder ? L"" : L".txt"))
+		.str();
+}
\ No newline at end of file
@@ -0,0 +1,151 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "../Helper/Macros.h"
+#include <windows.h>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct ChurnSettings
+{
+	// Each rate is the number of operations of that type performed per second.
+	double createRate;
+	double modifyRate;
+	double renameRate;
+	double deleteRate;
+
+	std::chrono::seconds duration;
+
+	// The percentage of created items that are folders, rather than files.
+	int folderPercentage;
+
+	// The number of files the directory contains before the churn starts.
+	size_t numInitialFiles;
+};
+
+enum class ChurnOperationType
+{
+	Create,
+	Modify,
+	Rename,
+	Delete
+};
+
+struct ChurnOperation
+{
+	ChurnOperationType type;
+
+	// Identifies the item across renames.
+	uint64_t itemId;
+
+	bool isFolder;
+
+	// The name of the item once the operation has completed. For a deletion, this is the name of
+	// the item that was deleted.
+	std::wstring name;
+
+	// Only set for renames.
+	std::wstring previousName;
+
+	// The size of the file once the operation has completed. Always 0 for folders.
+	DWORD size;
+
+	std::chrono::steady_clock::time_point completed;
+};
+
+struct ChurnItem
+{
+	std::wstring name;
+	bool isFolder;
+};
+
+// Creates, modifies, renames and deletes items within a directory on a background thread, at fixed
+// rates. The items and operations are generated from a fixed seed, so each run performs the same
+// sequence of operations, provided the file system keeps up with the requested rates. If it
+// doesn't, the operations are performed as quickly as possible.
+class DirectoryChurn
+{
+public:
+	// A folder that's created alongside the initial files and never changed. It gives tree views
+	// an item within the directory that can be located.
+	static constexpr wchar_t ANCHOR_FOLDER_NAME[] = L"anchor";
+
+	DirectoryChurn(const std::filesystem::path &directory, const ChurnSettings &settings);
+	~DirectoryChurn();
+
+	// Deletes the directory and recreates it with the initial set of items. Throws
+	// std::filesystem::filesystem_error on failure. Can't be called while the churn is running.
+	void Reset();
+
+	void Start();
+	void Stop();
+	bool IsFinished() const;
+
+	// Returns the operations that have completed since the last call.
+	std::vector<ChurnOperation> TakeOperations();
+
+	// Returns the items (other than the anchor folder) that currently exist within the directory.
+	// Only valid once the churn has finished.
+	std::vector<ChurnItem> GetItems() const;
+
+	// Operations that were attempted, but that the file system rejected.
+	size_t GetNumFailedOperations() const;
+
+	// Operations that couldn't be attempted, because there was no suitable item (e.g. a
+	// modification when every remaining item was a folder).
+	size_t GetNumSkippedOperations() const;
+
+	static const char *GetOperationTypeName(ChurnOperationType type);
+
+private:
+	DISALLOW_COPY_AND_ASSIGN(DirectoryChurn);
+
+	struct Item
+	{
+		uint64_t id;
+		std::wstring name;
+		bool isFolder;
+		DWORD size;
+	};
+
+	static const std::chrono::milliseconds SCHEDULE_INTERVAL;
+
+	void Run(std::stop_token stopToken);
+	void PerformOperation(ChurnOperationType type);
+	std::optional<ChurnOperation> CreateItem();
+	std::optional<ChurnOperation> ModifyItem();
+	std::optional<ChurnOperation> RenameItem();
+	std::optional<ChurnOperation> DeleteItem();
+	std::optional<size_t> ChooseItem(bool filesOnly);
+	bool WriteFileContents(const std::filesystem::path &path, DWORD size, DWORD disposition);
+	std::wstring GenerateName(uint64_t id, bool isFolder);
+
+	const std::filesystem::path m_directory;
+	const ChurnSettings m_settings;
+
+	// Only accessed by the churn thread while the churn is running.
+	std::mt19937_64 m_generator;
+	std::vector<Item> m_items;
+	uint64_t m_itemIdCounter = 0;
+	uint64_t m_nameCounter = 0;
+	std::vector<char> m_buffer;
+
+	std::atomic<size_t> m_numFailedOperations = 0;
+	std::atomic<size_t> m_numSkippedOperations = 0;
+	std::atomic<bool> m_finished = false;
+
+	std::mutex m_operationsMutex;
+	std::vector<ChurnOperation> m_operations;
+
+	std::jthread m_thread;
+};
\ No newline at end of file
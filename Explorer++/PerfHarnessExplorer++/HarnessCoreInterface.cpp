@@ -0,0 +1,256 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "HarnessCoreInterface.h"
+#include "../Explorer++/ShellBrowser/ShellBrowser.h"
+
+HarnessCoreInterface::HarnessCoreInterface(HWND mainWindow) :
+	m_mainWindow(mainWindow),
+	m_cachedIcons(MAX_CACHED_ICONS_SIZE),
+	m_iconResourceLoader(std::make_unique<IconResourceLoader>(m_config.iconTheme))
+{
+}
+
+void HarnessCoreInterface::SetActiveShellBrowser(ShellBrowser *shellBrowser)
+{
+	m_activeShellBrowser = shellBrowser;
+}
+
+void HarnessCoreInterface::NotifyApplicationShuttingDown()
+{
+	m_applicationShuttingDownSignal();
+}
+
+void HarnessCoreInterface::SetRegisterForShellNotifications(bool registerForShellNotifications)
+{
+	m_config.registerForShellNotifications = registerForShellNotifications;
+}
+
+const Config *HarnessCoreInterface::GetConfig() const
+{
+	return &m_config;
+}
+
+// The strings are compiled into the harness executable itself.
+HMODULE HarnessCoreInterface::GetLanguageModule() const
+{
+	return GetModuleHandle(nullptr);
+}
+
+HWND HarnessCoreInterface::GetMainWindow() const
+{
+	return m_mainWindow;
+}
+
+HWND HarnessCoreInterface::GetActiveListView() const
+{
+	return m_activeShellBrowser ? m_activeShellBrowser->GetListView() : nullptr;
+}
+
+ShellBrowser *HarnessCoreInterface::GetActiveShellBrowser() const
+{
+	return m_activeShellBrowser;
+}
+
+TabContainer *HarnessCoreInterface::GetTabContainer() const
+{
+	return nullptr;
+}
+
+TabRestorer *HarnessCoreInterface::GetTabRestorer() const
+{
+	return nullptr;
+}
+
+IDirectoryMonitor *HarnessCoreInterface::GetDirectoryMonitor() const
+{
+	return nullptr;
+}
+
+FileOperationQueue *HarnessCoreInterface::GetFileOperationQueue() const
+{
+	return nullptr;
+}
+
+Plugins::PluginManager *HarnessCoreInterface::GetPluginManager() const
+{
+	return nullptr;
+}
+
+IconResourceLoader *HarnessCoreInterface::GetIconResourceLoader() const
+{
+	return m_iconResourceLoader.get();
+}
+
+CachedIcons *HarnessCoreInterface::GetCachedIcons()
+{
+	return &m_cachedIcons;
+}
+
+HWND HarnessCoreInterface::GetTreeView() const
+{
+	return nullptr;
+}
+
+void HarnessCoreInterface::OpenItem(
+	const TCHAR *itemPath, OpenFolderDisposition openFolderDisposition)
+{
+	UNREFERENCED_PARAMETER(itemPath);
+	UNREFERENCED_PARAMETER(openFolderDisposition);
+}
+
+void HarnessCoreInterface::OpenItem(
+	PCIDLIST_ABSOLUTE pidlItem, OpenFolderDisposition openFolderDisposition)
+{
+	UNREFERENCED_PARAMETER(pidlItem);
+	UNREFERENCED_PARAMETER(openFolderDisposition);
+}
+
+StatusBar *HarnessCoreInterface::GetStatusBar()
+{
+	return nullptr;
+}
+
+void HarnessCoreInterface::OpenFileItem(PCIDLIST_ABSOLUTE pidlItem, const TCHAR *szParameters)
+{
+	UNREFERENCED_PARAMETER(pidlItem);
+	UNREFERENCED_PARAMETER(szParameters);
+}
+
+wil::unique_hmenu HarnessCoreInterface::BuildViewsMenu()
+{
+	return wil::unique_hmenu(CreatePopupMenu());
+}
+
+bool HarnessCoreInterface::CanCreate() const
+{
+	return false;
+}
+
+BOOL HarnessCoreInterface::CanCut() const
+{
+	return FALSE;
+}
+
+BOOL HarnessCoreInterface::CanCopy() const
+{
+	return FALSE;
+}
+
+BOOL HarnessCoreInterface::CanRename() const
+{
+	return FALSE;
+}
+
+BOOL HarnessCoreInterface::CanDelete() const
+{
+	return FALSE;
+}
+
+BOOL HarnessCoreInterface::CanShowFileProperties() const
+{
+	return FALSE;
+}
+
+BOOL HarnessCoreInterface::CanPaste() const
+{
+	return FALSE;
+}
+
+BOOL HarnessCoreInterface::OnMouseWheel(
+	MousewheelSource mousewheelSource, WPARAM wParam, LPARAM lParam)
+{
+	UNREFERENCED_PARAMETER(mousewheelSource);
+	UNREFERENCED_PARAMETER(wParam);
+	UNREFERENCED_PARAMETER(lParam);
+
+	return FALSE;
+}
+
+void HarnessCoreInterface::ShowTabBar()
+{
+}
+
+void HarnessCoreInterface::HideTabBar()
+{
+}
+
+void HarnessCoreInterface::SetListViewInitialPosition(HWND hListView)
+{
+	RECT rc;
+	GetClientRect(m_mainWindow, &rc);
+	SetWindowPos(hListView, nullptr, 0, 0, rc.right, rc.bottom, SWP_NOZORDER);
+}
+
+void HarnessCoreInterface::FocusChanged(WindowFocusSource windowFocusSource)
+{
+	m_focusChangedSignal(windowFocusSource);
+}
+
+void HarnessCoreInterface::SaveAllSettings()
+{
+}
+
+BOOL HarnessCoreInterface::GetSavePreferencesToXmlFile() const
+{
+	return FALSE;
+}
+
+void HarnessCoreInterface::SetSavePreferencesToXmlFile(BOOL savePreferencesToXmlFile)
+{
+	UNREFERENCED_PARAMETER(savePreferencesToXmlFile);
+}
+
+int HarnessCoreInterface::CloseApplication()
+{
+	return 0;
+}
+
+boost::signals2::connection HarnessCoreInterface::AddTabsInitializedObserver(
+	const TabsInitializedSignal::slot_type &observer)
+{
+	return m_tabsInitializedSignal.connect(observer);
+}
+
+boost::signals2::connection HarnessCoreInterface::AddMainMenuPreShowObserver(
+	const MainMenuPreShowSignal::slot_type &observer)
+{
+	return m_mainMenuPreShowSignal.connect(observer);
+}
+
+boost::signals2::connection HarnessCoreInterface::AddMainMenuPopupObserver(
+	const MainMenuPopupSignal::slot_type &observer)
+{
+	return m_mainMenuPopupSignal.connect(observer);
+}
+
+boost::signals2::connection HarnessCoreInterface::AddToolbarContextMenuObserver(
+	const ToolbarContextMenuSignal::slot_type &observer)
+{
+	return m_toolbarContextMenuSignal.connect(observer);
+}
+
+boost::signals2::connection HarnessCoreInterface::AddFocusChangeObserver(
+	const FocusChangedSignal::slot_type &observer)
+{
+	return m_focusChangedSignal.connect(observer);
+}
+
+boost::signals2::connection HarnessCoreInterface::AddApplicationShuttingDownObserver(
+	const ApplicationShuttingDownSignal::slot_type &observer)
+{
+	return m_applicationShuttingDownSignal.connect(observer);
+}
+
+// Navigations that would open a new tab aren't part of any scenario.
+void HarnessCoreInterface::CreateNewTab(PCIDLIST_ABSOLUTE pidlDirectory, bool selected)
+{
+	UNREFERENCED_PARAMETER(pidlDirectory);
+	UNREFERENCED_PARAMETER(selected);
+}
+
+void HarnessCoreInterface::SelectTabById(int tabId)
+{
+	UNREFERENCED_PARAMETER(tabId);
+}
\ No newline at end of file
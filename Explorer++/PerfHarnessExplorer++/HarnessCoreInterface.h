@@ -0,0 +1,101 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "../Explorer++/Config.h"
+#include "../Explorer++/CoreInterface.h"
+#include "../Explorer++/IconResourceLoader.h"
+#include "../Explorer++/TabNavigationInterface.h"
+#include "../Helper/CachedIcons.h"
+#include "../Helper/Macros.h"
+#include <boost/signals2.hpp>
+#include <ShlObj.h>
+
+// Provides the small part of the application that a ShellBrowser instance depends on. The browser
+// is hosted directly in the main window, there are no tabs and none of the other UI components
+// exist, so the remaining methods do nothing.
+class HarnessCoreInterface : public IExplorerplusplus, public TabNavigationInterface
+{
+public:
+	explicit HarnessCoreInterface(HWND mainWindow);
+
+	void SetActiveShellBrowser(ShellBrowser *shellBrowser);
+	void NotifyApplicationShuttingDown();
+
+	// Determines whether browsers created after this call use SHChangeNotifyRegister() to watch
+	// the folder they're displaying. Otherwise, the host is responsible for watching the folder.
+	void SetRegisterForShellNotifications(bool registerForShellNotifications);
+
+	// IExplorerplusplus
+	const Config *GetConfig() const override;
+	HMODULE GetLanguageModule() const override;
+	HWND GetMainWindow() const override;
+	HWND GetActiveListView() const override;
+	ShellBrowser *GetActiveShellBrowser() const override;
+	TabContainer *GetTabContainer() const override;
+	TabRestorer *GetTabRestorer() const override;
+	IDirectoryMonitor *GetDirectoryMonitor() const override;
+	FileOperationQueue *GetFileOperationQueue() const override;
+	Plugins::PluginManager *GetPluginManager() const override;
+	IconResourceLoader *GetIconResourceLoader() const override;
+	CachedIcons *GetCachedIcons() override;
+	HWND GetTreeView() const override;
+	void OpenItem(const TCHAR *itemPath, OpenFolderDisposition openFolderDisposition) override;
+	void OpenItem(
+		PCIDLIST_ABSOLUTE pidlItem, OpenFolderDisposition openFolderDisposition) override;
+	StatusBar *GetStatusBar() override;
+	void OpenFileItem(PCIDLIST_ABSOLUTE pidlItem, const TCHAR *szParameters) override;
+	wil::unique_hmenu BuildViewsMenu() override;
+	bool CanCreate() const override;
+	BOOL CanCut() const override;
+	BOOL CanCopy() const override;
+	BOOL CanRename() const override;
+	BOOL CanDelete() const override;
+	BOOL CanShowFileProperties() const override;
+	BOOL CanPaste() const override;
+	BOOL OnMouseWheel(MousewheelSource mousewheelSource, WPARAM wParam, LPARAM lParam) override;
+	void ShowTabBar() override;
+	void HideTabBar() override;
+	void SetListViewInitialPosition(HWND hListView) override;
+	void FocusChanged(WindowFocusSource windowFocusSource) override;
+	void SaveAllSettings() override;
+	BOOL GetSavePreferencesToXmlFile() const override;
+	void SetSavePreferencesToXmlFile(BOOL savePreferencesToXmlFile) override;
+	int CloseApplication() override;
+	boost::signals2::connection AddTabsInitializedObserver(
+		const TabsInitializedSignal::slot_type &observer) override;
+	boost::signals2::connection AddMainMenuPreShowObserver(
+		const MainMenuPreShowSignal::slot_type &observer) override;
+	boost::signals2::connection AddMainMenuPopupObserver(
+		const MainMenuPopupSignal::slot_type &observer) override;
+	boost::signals2::connection AddToolbarContextMenuObserver(
+		const ToolbarContextMenuSignal::slot_type &observer) override;
+	boost::signals2::connection AddFocusChangeObserver(
+		const FocusChangedSignal::slot_type &observer) override;
+	boost::signals2::connection AddApplicationShuttingDownObserver(
+		const ApplicationShuttingDownSignal::slot_type &observer) override;
+
+	// TabNavigationInterface
+	void CreateNewTab(PCIDLIST_ABSOLUTE pidlDirectory, bool selected) override;
+	void SelectTabById(int tabId) override;
+
+private:
+	DISALLOW_COPY_AND_ASSIGN(HarnessCoreInterface);
+
+	static const size_t MAX_CACHED_ICONS_SIZE = 1024 * 1024;
+
+	HWND m_mainWindow;
+	Config m_config;
+	CachedIcons m_cachedIcons;
+	std::unique_ptr<IconResourceLoader> m_iconResourceLoader;
+	ShellBrowser *m_activeShellBrowser = nullptr;
+
+	TabsInitializedSignal m_tabsInitializedSignal;
+	MainMenuPreShowSignal m_mainMenuPreShowSignal;
+	MainMenuPopupSignal m_mainMenuPopupSignal;
+	ToolbarContextMenuSignal m_toolbarContextMenuSignal;
+	FocusChangedSignal m_focusChangedSignal;
+	ApplicationShuttingDownSignal m_applicationShuttingDownSignal;
+};
\ No newline at end of file
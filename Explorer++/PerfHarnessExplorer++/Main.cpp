@@ -0,0 +1,656 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "ChurnScenario.h"
+#include "HarnessCoreInterface.h"
+#include "PerformanceScenario.h"
+#include "SyntheticFolderTree.h"
+#include "../Helper/PerformanceTrace.h"
+#include "../Helper/StringHelper.h"
+#include "../ThirdParty/CLI11/CLI11.hpp"
+#include <boost/log/core.hpp>
+#include <nlohmann/json.hpp>
+#include <wil/resource.h>
+#include <CommCtrl.h>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <thread>
+
+namespace
+{
+
+const wchar_t HOST_WINDOW_CLASS_NAME[] = L"ExplorerPlusPlusPerfHarness";
+
+// The browser is shown, so that the time taken to first paint the listview is included.
+const int HOST_WINDOW_WIDTH = 1024;
+const int HOST_WINDOW_HEIGHT = 768;
+
+enum class ChurnNotificationSelection
+{
+	Both,
+	ShellNotifications,
+	DirectoryMonitor
+};
+
+struct HarnessSettings
+{
+	size_t numFiles = 10000;
+	TreeShape shape = TreeShape::Flat;
+	int iterations = 3;
+	int stepTimeoutSeconds = 600;
+	std::string root;
+	std::string output;
+	std::string label;
+
+	bool churn = false;
+	double churnCreateRate = 50;
+	double churnModifyRate = 50;
+	double churnRenameRate = 20;
+	double churnDeleteRate = 40;
+	int churnDurationSeconds = 30;
+	int churnFolderPercentage = 10;
+	size_t churnInitialFiles = 1000;
+	int churnSettleSeconds = 30;
+	ChurnNotificationSelection churnNotifications = ChurnNotificationSelection::Both;
+};
+
+std::optional<int> ParseCommandLine(int argc, wchar_t *argv[], HarnessSettings &settings)
+{
+	CLI::App app("Runs a ShellBrowser instance through a fixed scenario against a synthetic folder "
+				 "tree and writes the timings as JSON");
+
+	app.add_option("--files", settings.numFiles, "The number of files in the tree")
+		->check(CLI::Range(size_t{ 1 }, size_t{ 10'000'000 }));
+
+	app.add_option("--shape", settings.shape, "The shape of the tree")
+		->transform(CLI::CheckedTransformer(CLI::TransformPairs<TreeShape>{
+			{ "flat", TreeShape::Flat }, { "wide", TreeShape::Wide },
+			{ "deep", TreeShape::Deep } }));
+
+	app.add_option("--iterations", settings.iterations,
+		   "The number of times the scenario is run, each time with a new browser")
+		->check(CLI::PositiveNumber);
+
+	app.add_option("--step-timeout", settings.stepTimeoutSeconds,
+		   "The maximum number of seconds a single step can take")
+		->check(CLI::PositiveNumber);
+
+	app.add_option("--root", settings.root,
+		"The directory the tree is created in. Trees are reused between runs, so this can be left "
+		"as-is when comparing builds. Defaults to a directory within the temporary directory.");
+
+	app.add_option("--output", settings.output,
+		"The file the results are written to. If not set, the results are written to stdout.");
+
+	app.add_option("--label", settings.label,
+		"An arbitrary string (e.g. a commit hash) that's included in the results, to help "
+		"identify the build that was measured");
+
+	app.add_flag("--churn", settings.churn,
+		"Instead of running the scenario, repeatedly change the contents of a folder while it's "
+		"displayed and measure how quickly the changes are shown. The tree options are ignored.");
+
+	app.add_option("--churn-creates", settings.churnCreateRate,
+		   "The number of items created each second")
+		->check(CLI::NonNegativeNumber);
+
+	app.add_option("--churn-modifies", settings.churnModifyRate,
+		   "The number of files modified each second")
+		->check(CLI::NonNegativeNumber);
+
+	app.add_option("--churn-renames", settings.churnRenameRate,
+		   "The number of items renamed each second")
+		->check(CLI::NonNegativeNumber);
+
+	app.add_option("--churn-deletes", settings.churnDeleteRate,
+		   "The number of items deleted each second")
+		->check(CLI::NonNegativeNumber);
+
+	app.add_option("--churn-duration", settings.churnDurationSeconds,
+		   "The number of seconds the folder is changed for in each run")
+		->check(CLI::PositiveNumber);
+
+	app.add_option("--churn-folders", settings.churnFolderPercentage,
+		   "The percentage of created items that are folders")
+		->check(CLI::Range(0, 100));
+
+	app.add_option("--churn-initial-files", settings.churnInitialFiles,
+		"The number of files in the folder when each run starts");
+
+	app.add_option("--churn-settle-timeout", settings.churnSettleSeconds,
+		   "The maximum number of seconds to wait for the changes to be shown once the churn has "
+		   "finished. Changes that still haven't been shown are counted as dropped.")
+		->check(CLI::PositiveNumber);
+
+	app.add_option("--churn-notifications", settings.churnNotifications,
+		   "The way the browser is notified of changes. Each run is repeated for each way "
+		   "selected.")
+		->transform(CLI::CheckedTransformer(CLI::TransformPairs<ChurnNotificationSelection>{
+			{ "both", ChurnNotificationSelection::Both },
+			{ "shell", ChurnNotificationSelection::ShellNotifications },
+			{ "monitor", ChurnNotificationSelection::DirectoryMonitor } }));
+
+	std::vector<std::string> utf8Args;
+
+	// See the equivalent conversion in CommandLine::ProcessCommandLine().
+	for (int i = argc - 1; i > 0; i--)
+	{
+		utf8Args.emplace_back(wstrToUtf8Str(argv[i]));
+	}
+
+	try
+	{
+		app.parse(utf8Args);
+	}
+	catch (const CLI::ParseError &e)
+	{
+		return app.exit(e);
+	}
+
+	return std::nullopt;
+}
+
+wil::unique_hwnd CreateHostWindow()
+{
+	WNDCLASSEX windowClass = {};
+	windowClass.cbSize = sizeof(windowClass);
+	windowClass.lpfnWndProc = DefWindowProc;
+	windowClass.hInstance = GetModuleHandle(nullptr);
+	windowClass.hCursor = LoadCursor(nullptr, IDC_ARROW);
+	windowClass.lpszClassName = HOST_WINDOW_CLASS_NAME;
+	RegisterClassEx(&windowClass);
+
+	wil::unique_hwnd window(CreateWindow(HOST_WINDOW_CLASS_NAME, L"Explorer++ performance harness",
+		WS_OVERLAPPEDWINDOW | WS_CLIPCHILDREN, CW_USEDEFAULT, CW_USEDEFAULT, HOST_WINDOW_WIDTH,
+		HOST_WINDOW_HEIGHT, nullptr, nullptr, GetModuleHandle(nullptr), nullptr));
+
+	if (window)
+	{
+		ShowWindow(window.get(), SW_SHOWNOACTIVATE);
+	}
+
+	return window;
+}
+
+double ToMilliseconds(std::chrono::microseconds duration)
+{
+	return static_cast<double>(duration.count()) / 1000.0;
+}
+
+nlohmann::json NavigationTimingToJson(const NavigationTiming &timing)
+{
+	return { { "bindMs", ToMilliseconds(timing.bind) },
+		{ "enumerateMs", ToMilliseconds(timing.enumerate) },
+		{ "itemInfoMs", ToMilliseconds(timing.itemInfo) },
+		{ "insertMs", ToMilliseconds(timing.insert) }, { "sortMs", ToMilliseconds(timing.sort) },
+		{ "firstPaintMs", ToMilliseconds(timing.firstPaint) },
+		{ "totalMs", ToMilliseconds(timing.total) }, { "fromSnapshot", timing.fromSnapshot },
+		{ "painted", timing.painted } };
+}
+
+nlohmann::json StepResultToJson(const ScenarioStepResult &result)
+{
+	nlohmann::json json = { { "name", result.name },
+		{ "durationMs", ToMilliseconds(result.duration) },
+		{ "settledMs", ToMilliseconds(result.settled) }, { "numItems", result.numItems },
+		{ "timedOut", result.timedOut } };
+
+	if (result.navigation)
+	{
+		json["navigation"] = NavigationTimingToJson(*result.navigation);
+	}
+
+	return json;
+}
+
+double GetMedian(std::vector<double> values)
+{
+	std::sort(values.begin(), values.end());
+	size_t middle = values.size() / 2;
+
+	if (values.size() % 2 == 0)
+	{
+		return (values[middle - 1] + values[middle]) / 2.0;
+	}
+
+	return values[middle];
+}
+
+// The medians are what would typically be compared between two builds. Steps that timed out are
+// excluded, since their durations are meaningless.
+nlohmann::json BuildSummary(const std::vector<std::vector<ScenarioStepResult>> &iterations)
+{
+	std::vector<std::string> stepNames;
+	std::map<std::string, std::pair<std::vector<double>, std::vector<double>>> stepDurations;
+
+	for (const auto &iteration : iterations)
+	{
+		for (const auto &result : iteration)
+		{
+			if (result.timedOut)
+			{
+				continue;
+			}
+
+			if (std::find(stepNames.begin(), stepNames.end(), result.name) == stepNames.end())
+			{
+				stepNames.push_back(result.name);
+			}
+
+			auto &[durations, settledDurations] = stepDurations[result.name];
+			durations.push_back(ToMilliseconds(result.duration));
+			settledDurations.push_back(ToMilliseconds(result.settled));
+		}
+	}
+
+	auto summary = nlohmann::json::array();
+
+	for (const auto &name : stepNames)
+	{
+		const auto &[durations, settledDurations] = stepDurations[name];
+		summary.push_back({ { "name", name }, { "medianDurationMs", GetMedian(durations) },
+			{ "medianSettledMs", GetMedian(settledDurations) },
+			{ "samples", durations.size() } });
+	}
+
+	return summary;
+}
+
+// Uses the nearest-rank method. The values must be sorted.
+double GetPercentile(const std::vector<double> &sortedValues, int percentile)
+{
+	auto rank = static_cast<size_t>(
+		std::ceil(static_cast<double>(percentile) / 100.0 * sortedValues.size()));
+
+	return sortedValues[std::max(rank, size_t{ 1 }) - 1];
+}
+
+nlohmann::json LatenciesToJson(std::vector<double> latencies)
+{
+	nlohmann::json json = { { "samples", latencies.size() } };
+
+	if (latencies.empty())
+	{
+		return json;
+	}
+
+	std::sort(latencies.begin(), latencies.end());
+	json["medianMs"] = GetMedian(latencies);
+	json["p95Ms"] = GetPercentile(latencies, 95);
+	json["maxMs"] = latencies.back();
+
+	return json;
+}
+
+std::vector<double> GetAllLatencies(const ChurnViewResult &result)
+{
+	std::vector<double> allLatencies;
+
+	for (const auto &[type, latencies] : result.latencies)
+	{
+		allLatencies.insert(allLatencies.end(), latencies.begin(), latencies.end());
+	}
+
+	return allLatencies;
+}
+
+nlohmann::json ChurnViewResultToJson(const ChurnViewResult &result)
+{
+	nlohmann::json latenciesJson = { { "all", LatenciesToJson(GetAllLatencies(result)) } };
+
+	for (const auto &[type, latencies] : result.latencies)
+	{
+		latenciesJson[DirectoryChurn::GetOperationTypeName(type)] = LatenciesToJson(latencies);
+	}
+
+	return { { "operations", result.numOperations }, { "superseded", result.numSuperseded },
+		{ "dropped", result.numDropped }, { "missingItems", result.numMissingItems },
+		{ "unexpectedItems", result.numUnexpectedItems }, { "latencies", latenciesJson } };
+}
+
+const char *GetChurnNotificationSourceName(ChurnNotificationSource source)
+{
+	switch (source)
+	{
+	case ChurnNotificationSource::ShellNotifications:
+		return "shell";
+
+	case ChurnNotificationSource::DirectoryMonitor:
+		return "monitor";
+	}
+
+	return "unknown";
+}
+
+nlohmann::json ChurnRunResultToJson(const ChurnRunResult &result)
+{
+	return { { "notifications", GetChurnNotificationSourceName(result.source) },
+		{ "operations", result.numOperations },
+		{ "failedOperations", result.numFailedOperations },
+		{ "skippedOperations", result.numSkippedOperations },
+		{ "churnMs", ToMilliseconds(result.churnDuration) },
+		{ "settleMs", ToMilliseconds(result.settleDuration) },
+		{ "uiThreadBusyMs", ToMilliseconds(result.uiThreadBusy) },
+		{ "uiThreadCpuMs", ToMilliseconds(result.uiThreadCpu) },
+		{ "messagesDispatched", result.numMessagesDispatched },
+		{ "settledBeforeChurn", result.settledBeforeChurn },
+		{ "settledAfterChurn", result.settledAfterChurn },
+		{ "memory",
+			{ { "privateBytesStart", result.privateBytesStart },
+				{ "privateBytesPeak", result.privateBytesPeak },
+				{ "privateBytesEnd", result.privateBytesEnd },
+				{ "browserItemInfoBytesStart", result.browserItemInfoBytesStart },
+				{ "browserItemInfoBytesEnd", result.browserItemInfoBytesEnd } } },
+		{ "shellBrowser", ChurnViewResultToJson(result.shellBrowser) },
+		{ "shellTreeView", ChurnViewResultToJson(result.shellTreeView) } };
+}
+
+// Latencies are pooled across the runs for each notification source, while the other values are
+// the medians of the individual runs.
+nlohmann::json BuildChurnSummary(const std::vector<ChurnRunResult> &runs)
+{
+	auto summary = nlohmann::json::array();
+
+	for (auto source :
+		{ ChurnNotificationSource::ShellNotifications, ChurnNotificationSource::DirectoryMonitor })
+	{
+		std::vector<double> busyDurations;
+		std::vector<double> cpuDurations;
+		std::vector<double> settleDurations;
+		std::vector<double> privateBytesGrowth;
+		std::vector<double> browserLatencies;
+		std::vector<double> treeLatencies;
+		size_t numDropped = 0;
+
+		for (const auto &run : runs)
+		{
+			if (run.source != source)
+			{
+				continue;
+			}
+
+			busyDurations.push_back(ToMilliseconds(run.uiThreadBusy));
+			cpuDurations.push_back(ToMilliseconds(run.uiThreadCpu));
+			settleDurations.push_back(ToMilliseconds(run.settleDuration));
+			privateBytesGrowth.push_back(static_cast<double>(run.privateBytesEnd)
+				- static_cast<double>(run.privateBytesStart));
+
+			auto runBrowserLatencies = GetAllLatencies(run.shellBrowser);
+			browserLatencies.insert(
+				browserLatencies.end(), runBrowserLatencies.begin(), runBrowserLatencies.end());
+
+			auto runTreeLatencies = GetAllLatencies(run.shellTreeView);
+			treeLatencies.insert(
+				treeLatencies.end(), runTreeLatencies.begin(), runTreeLatencies.end());
+
+			numDropped += run.shellBrowser.numDropped + run.shellTreeView.numDropped;
+		}
+
+		if (busyDurations.empty())
+		{
+			continue;
+		}
+
+		summary.push_back({ { "notifications", GetChurnNotificationSourceName(source) },
+			{ "samples", busyDurations.size() },
+			{ "medianUiThreadBusyMs", GetMedian(busyDurations) },
+			{ "medianUiThreadCpuMs", GetMedian(cpuDurations) },
+			{ "medianSettleMs", GetMedian(settleDurations) },
+			{ "medianPrivateBytesGrowth", GetMedian(privateBytesGrowth) },
+			{ "shellBrowserLatencies", LatenciesToJson(browserLatencies) },
+			{ "shellTreeViewLatencies", LatenciesToJson(treeLatencies) },
+			{ "dropped", numDropped } });
+	}
+
+	return summary;
+}
+
+nlohmann::json GetBuildInformation()
+{
+#ifdef _DEBUG
+	const char *configuration = "Debug";
+#else
+	const char *configuration = "Release";
+#endif
+
+#ifdef _WIN64
+	const char *platform = "x64";
+#else
+	const char *platform = "Win32";
+#endif
+
+	return { { "configuration", configuration }, { "platform", platform },
+		{ "compilerVersion", _MSC_FULL_VER } };
+}
+
+nlohmann::json CreateResults(const HarnessSettings &settings)
+{
+	nlohmann::json json;
+	json["label"] = settings.label;
+	json["build"] = GetBuildInformation();
+	json["logicalProcessors"] = std::thread::hardware_concurrency();
+	return json;
+}
+
+bool WriteResults(const nlohmann::json &json, const std::string &output)
+{
+	if (output.empty())
+	{
+		std::cout << json.dump(4) << std::endl;
+		return true;
+	}
+
+	std::ofstream outputFile(std::filesystem::path(utf8StrToWstr(output)));
+	outputFile << json.dump(4) << std::endl;
+
+	if (!outputFile)
+	{
+		std::cerr << "Couldn't write the results file" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+std::vector<ChurnNotificationSource> GetChurnNotificationSources(
+	ChurnNotificationSelection selection)
+{
+	switch (selection)
+	{
+	case ChurnNotificationSelection::ShellNotifications:
+		return { ChurnNotificationSource::ShellNotifications };
+
+	case ChurnNotificationSelection::DirectoryMonitor:
+		return { ChurnNotificationSource::DirectoryMonitor };
+	}
+
+	return { ChurnNotificationSource::ShellNotifications,
+		ChurnNotificationSource::DirectoryMonitor };
+}
+
+int RunChurnBenchmark(const HarnessSettings &settings, const std::filesystem::path &root)
+{
+	auto hostWindow = CreateHostWindow();
+
+	if (!hostWindow)
+	{
+		std::wcerr << L"Couldn't create the host window" << std::endl;
+		return 1;
+	}
+
+	HarnessCoreInterface coreInterface(hostWindow.get());
+
+	ChurnSettings churnSettings = { settings.churnCreateRate, settings.churnModifyRate,
+		settings.churnRenameRate, settings.churnDeleteRate,
+		std::chrono::seconds(settings.churnDurationSeconds), settings.churnFolderPercentage,
+		settings.churnInitialFiles };
+	auto directory = root / L"Churn";
+
+	std::vector<ChurnRunResult> runs;
+
+	{
+		ChurnScenario scenario(hostWindow.get(), &coreInterface, directory, churnSettings,
+			std::chrono::seconds(settings.churnSettleSeconds));
+
+		try
+		{
+			// The notification sources are alternated, so that any drift over the course of the
+			// benchmark (e.g. from the file system warming up) affects each source equally.
+			for (int i = 0; i < settings.iterations; i++)
+			{
+				for (auto source : GetChurnNotificationSources(settings.churnNotifications))
+				{
+					runs.push_back(scenario.Run(source));
+				}
+			}
+		}
+		catch (const std::filesystem::filesystem_error &e)
+		{
+			std::cerr << "Couldn't reset the churn folder: " << e.what() << std::endl;
+			return 1;
+		}
+
+		coreInterface.NotifyApplicationShuttingDown();
+	}
+
+	auto json = CreateResults(settings);
+	json["churn"] = { { "createRate", settings.churnCreateRate },
+		{ "modifyRate", settings.churnModifyRate }, { "renameRate", settings.churnRenameRate },
+		{ "deleteRate", settings.churnDeleteRate },
+		{ "durationSeconds", settings.churnDurationSeconds },
+		{ "folderPercentage", settings.churnFolderPercentage },
+		{ "initialFiles", settings.churnInitialFiles },
+		{ "settleTimeoutSeconds", settings.churnSettleSeconds },
+		{ "directory", wstrToUtf8Str(directory) } };
+	json["summary"] = BuildChurnSummary(runs);
+
+	auto &runsJson = json["runs"] = nlohmann::json::array();
+
+	for (const auto &run : runs)
+	{
+		runsJson.push_back(ChurnRunResultToJson(run));
+	}
+
+	if (!WriteResults(json, settings.output))
+	{
+		return 1;
+	}
+
+	bool anyUnsettled = std::any_of(runs.begin(), runs.end(),
+		[](const ChurnRunResult &run)
+		{
+			return !run.settledBeforeChurn || !run.settledAfterChurn;
+		});
+
+	return anyUnsettled ? 1 : 0;
+}
+
+}
+
+int wmain(int argc, wchar_t *argv[])
+{
+	HarnessSettings settings;
+	auto exitCode = ParseCommandLine(argc, argv, settings);
+
+	if (exitCode)
+	{
+		return *exitCode;
+	}
+
+	// Logging would add its own overhead to the measurements.
+	boost::log::core::get()->set_logging_enabled(false);
+
+	HRESULT hr = OleInitialize(nullptr);
+
+	if (FAILED(hr))
+	{
+		std::wcerr << L"Couldn't initialize OLE" << std::endl;
+		return 1;
+	}
+
+	auto oleCleanup = wil::scope_exit([] { OleUninitialize(); });
+
+	INITCOMMONCONTROLSEX commonControls = {};
+	commonControls.dwSize = sizeof(commonControls);
+	commonControls.dwICC = ICC_LISTVIEW_CLASSES | ICC_TREEVIEW_CLASSES | ICC_STANDARD_CLASSES;
+	InitCommonControlsEx(&commonControls);
+
+	RegisterPerformanceTraceProvider();
+	auto traceCleanup = wil::scope_exit([] { UnregisterPerformanceTraceProvider(); });
+
+	std::filesystem::path root = settings.root.empty()
+		? std::filesystem::temp_directory_path() / L"ExplorerPlusPlusPerfHarness"
+		: std::filesystem::path(utf8StrToWstr(settings.root));
+
+	if (settings.churn)
+	{
+		return RunChurnBenchmark(settings, root);
+	}
+
+	std::filesystem::path browsedFolder;
+
+	try
+	{
+		browsedFolder = CreateSyntheticFolderTree(root, { settings.numFiles, settings.shape });
+	}
+	catch (const std::filesystem::filesystem_error &e)
+	{
+		std::cerr << "Couldn't create the folder tree: " << e.what() << std::endl;
+		return 1;
+	}
+
+	auto hostWindow = CreateHostWindow();
+
+	if (!hostWindow)
+	{
+		std::wcerr << L"Couldn't create the host window" << std::endl;
+		return 1;
+	}
+
+	HarnessCoreInterface coreInterface(hostWindow.get());
+	PerformanceScenario scenario(hostWindow.get(), &coreInterface,
+		std::chrono::seconds(settings.stepTimeoutSeconds));
+
+	std::vector<std::vector<ScenarioStepResult>> iterations;
+	bool anyTimedOut = false;
+
+	for (int i = 0; i < settings.iterations; i++)
+	{
+		auto results = scenario.Run(browsedFolder);
+		anyTimedOut |= std::any_of(results.begin(), results.end(),
+			[](const ScenarioStepResult &result) { return result.timedOut; });
+		iterations.push_back(std::move(results));
+	}
+
+	coreInterface.NotifyApplicationShuttingDown();
+
+	auto json = CreateResults(settings);
+	json["tree"] = { { "shape", wstrToUtf8Str(GetTreeShapeName(settings.shape)) },
+		{ "numFiles", settings.numFiles }, { "browsedFolder", wstrToUtf8Str(browsedFolder) } };
+	json["summary"] = BuildSummary(iterations);
+
+	auto &iterationsJson = json["iterations"] = nlohmann::json::array();
+
+	for (const auto &iteration : iterations)
+	{
+		auto steps = nlohmann::json::array();
+
+		for (const auto &result : iteration)
+		{
+			steps.push_back(StepResultToJson(result));
+		}
+
+		iterationsJson.push_back({ { "steps", steps } });
+	}
+
+	if (!WriteResults(json, settings.output))
+	{
+		return 1;
+	}
+
+	return anyTimedOut ? 1 : 0;
+}
\ No newline at end of file
@@ -0,0 +1,206 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "PerformanceScenario.h"
+#include "HarnessCoreInterface.h"
+#include "../Explorer++/ShellBrowser/ShellBrowser.h"
+#include "../Explorer++/ShellBrowser/ShellNavigationController.h"
+#include "../Helper/PerformanceTrace.h"
+#include <algorithm>
+
+namespace
+{
+
+// The wildcard matches roughly one in every eleven of the generated files.
+const wchar_t SCENARIO_FILTER[] = L"*.txt";
+
+const std::chrono::milliseconds MESSAGE_POLL_INTERVAL(10);
+
+}
+
+PerformanceScenario::PerformanceScenario(HWND owner, HarnessCoreInterface *coreInterface,
+	std::chrono::milliseconds stepTimeout) :
+	m_owner(owner),
+	m_coreInterface(coreInterface),
+	m_stepTimeout(stepTimeout)
+{
+}
+
+// Each run uses a new browser, so that the results of one run don't depend on the state left
+// behind by the previous run. Process-wide caches (such as the shell's own caches) are retained,
+// though, so the first run will typically be slower than later runs.
+std::vector<ScenarioStepResult> PerformanceScenario::Run(const std::filesystem::path &folder)
+{
+	auto shellBrowser = ShellBrowser::CreateNew(0, m_owner, m_coreInterface, m_coreInterface,
+		&m_fileActionHandler, m_coreInterface->GetConfig()->defaultFolderSettings, std::nullopt);
+	m_coreInterface->SetActiveShellBrowser(shellBrowser.get());
+	m_coreInterface->SetListViewInitialPosition(shellBrowser->GetListView());
+
+	auto connection = shellBrowser->AddNavigationCompletedObserver(
+		[this](PCIDLIST_ABSOLUTE pidlDirectory)
+		{
+			UNREFERENCED_PARAMETER(pidlDirectory);
+
+			m_navigationCompleted = true;
+		});
+
+	std::vector<ScenarioStepResult> results;
+
+	for (const auto &step : GetSteps(folder))
+	{
+		auto result = RunStep(shellBrowser.get(), step);
+		bool timedOut = result.timedOut;
+		results.push_back(std::move(result));
+
+		// The remaining steps depend on the state produced by this step, so there's no point in
+		// running them.
+		if (timedOut)
+		{
+			break;
+		}
+	}
+
+	connection.disconnect();
+	m_coreInterface->SetActiveShellBrowser(nullptr);
+
+	return results;
+}
+
+std::vector<PerformanceScenario::StepDefinition> PerformanceScenario::GetSteps(
+	const std::filesystem::path &folder)
+{
+	// clang-format off
+	return {
+		{ L"HarnessNavigate", "navigate", true,
+			[this, folder](ShellBrowser *shellBrowser) {
+				return StartNavigation([shellBrowser, folder] {
+					shellBrowser->GetNavigationController()->BrowseFolder(folder.wstring());
+				});
+			} },
+		{ L"HarnessSort", "sort", false,
+			[](ShellBrowser *shellBrowser) {
+				return RunSynchronously([shellBrowser] {
+					shellBrowser->SortFolder(SortMode::Size);
+				});
+			} },
+		{ L"HarnessGroup", "group", false,
+			[](ShellBrowser *shellBrowser) {
+				return RunSynchronously([shellBrowser] {
+					shellBrowser->SetShowInGroups(TRUE);
+				});
+			} },
+		{ L"HarnessFilter", "filter", false,
+			[](ShellBrowser *shellBrowser) {
+				shellBrowser->SetFilter(SCENARIO_FILTER);
+				shellBrowser->SetFilterStatus(TRUE);
+
+				return std::function<bool()>([shellBrowser] {
+					return !shellBrowser->GetDiagnostics().filterEvaluationPending;
+				});
+			} },
+		{ L"HarnessSelectAll", "selectAll", false,
+			[](ShellBrowser *shellBrowser) {
+				return RunSynchronously([shellBrowser] {
+					shellBrowser->SelectAllItems();
+				});
+			} },
+		{ L"HarnessRefresh", "refresh", true,
+			[this](ShellBrowser *shellBrowser) {
+				return StartNavigation([shellBrowser] {
+					shellBrowser->GetNavigationController()->Refresh();
+				});
+			} }
+	};
+	// clang-format on
+}
+
+ScenarioStepResult PerformanceScenario::RunStep(
+	ShellBrowser *shellBrowser, const StepDefinition &step)
+{
+	PerformanceTraceActivity traceActivity(step.activityName);
+
+	ScenarioStepResult result;
+	result.name = step.name;
+
+	auto startTime = std::chrono::steady_clock::now();
+	auto deadline = startTime + m_stepTimeout;
+
+	auto isComplete = step.start(shellBrowser);
+	result.timedOut = !PumpMessagesUntil(isComplete, deadline);
+	result.duration = std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now() - startTime);
+
+	if (!result.timedOut)
+	{
+		result.timedOut =
+			!PumpMessagesUntil([shellBrowser] { return IsIdle(shellBrowser->GetDiagnostics()); },
+				deadline);
+	}
+
+	result.settled = std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now() - startTime);
+
+	auto diagnostics = shellBrowser->GetDiagnostics();
+	result.numItems = diagnostics.numItems;
+
+	if (step.navigates)
+	{
+		result.navigation = diagnostics.lastNavigation;
+	}
+
+	return result;
+}
+
+std::function<bool()> PerformanceScenario::StartNavigation(std::function<void()> navigate)
+{
+	m_navigationCompleted = false;
+	navigate();
+
+	return [this] { return m_navigationCompleted; };
+}
+
+std::function<bool()> PerformanceScenario::RunSynchronously(std::function<void()> action)
+{
+	action();
+
+	return [] { return true; };
+}
+
+// Background results are delivered to the browser through window messages, so they need to be
+// dispatched while waiting, in the same way the main message loop in the application would.
+bool PerformanceScenario::PumpMessagesUntil(
+	const std::function<bool()> &predicate, std::chrono::steady_clock::time_point deadline)
+{
+	while (!predicate())
+	{
+		auto now = std::chrono::steady_clock::now();
+
+		if (now >= deadline)
+		{
+			return false;
+		}
+
+		auto timeout = std::min(
+			std::chrono::ceil<std::chrono::milliseconds>(deadline - now), MESSAGE_POLL_INTERVAL);
+		MsgWaitForMultipleObjectsEx(
+			0, nullptr, static_cast<DWORD>(timeout.count()), QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+
+		MSG msg;
+
+		while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
+		{
+			TranslateMessage(&msg);
+			DispatchMessage(&msg);
+		}
+	}
+
+	return true;
+}
+
+bool PerformanceScenario::IsIdle(const BrowserDiagnostics &diagnostics)
+{
+	return diagnostics.lastNavigation.completed && diagnostics.pendingColumnTasks == 0
+		&& diagnostics.pendingThumbnailTasks == 0 && diagnostics.pendingIconTasks == 0
+		&& !diagnostics.filterEvaluationPending;
+}
\ No newline at end of file
@@ -0,0 +1,81 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "../Explorer++/ShellBrowser/NavigationDiagnostics.h"
+#include "../Helper/FileActionHandler.h"
+#include "../Helper/Macros.h"
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+class HarnessCoreInterface;
+class ShellBrowser;
+
+struct ScenarioStepResult
+{
+	std::string name;
+
+	// The time taken for the step itself to complete (e.g. for a navigation, the time until the
+	// enumeration has finished and every item has been inserted).
+	std::chrono::microseconds duration = {};
+
+	// The time taken until the browser was idle again, including any background work (such as
+	// column text, icons and filtering) that was queued by the step.
+	std::chrono::microseconds settled = {};
+
+	size_t numItems = 0;
+	bool timedOut = false;
+
+	// Only set for steps that navigate.
+	std::optional<NavigationTiming> navigation;
+};
+
+// Drives a real ShellBrowser through the sequence navigate, sort, group, filter, select all and
+// refresh. Each step is wrapped in a trace activity, so that the work done by the browser can be
+// attributed to the step in a trace.
+class PerformanceScenario
+{
+public:
+	PerformanceScenario(HWND owner, HarnessCoreInterface *coreInterface,
+		std::chrono::milliseconds stepTimeout);
+
+	std::vector<ScenarioStepResult> Run(const std::filesystem::path &folder);
+
+	// Returns true once the browser has finished navigating and has no background work queued.
+	static bool IsIdle(const BrowserDiagnostics &diagnostics);
+
+private:
+	DISALLOW_COPY_AND_ASSIGN(PerformanceScenario);
+
+	struct StepDefinition
+	{
+		// Used as the name of the trace activity, so must be a string literal.
+		const wchar_t *activityName;
+
+		const char *name;
+
+		bool navigates;
+
+		// Starts the step and returns a function that indicates whether the step has completed.
+		std::function<std::function<bool()>(ShellBrowser *shellBrowser)> start;
+	};
+
+	std::vector<StepDefinition> GetSteps(const std::filesystem::path &folder);
+	ScenarioStepResult RunStep(ShellBrowser *shellBrowser, const StepDefinition &step);
+	std::function<bool()> StartNavigation(std::function<void()> navigate);
+	static std::function<bool()> RunSynchronously(std::function<void()> action);
+	bool PumpMessagesUntil(
+		const std::function<bool()> &predicate, std::chrono::steady_clock::time_point deadline);
+
+	HWND m_owner;
+	HarnessCoreInterface *m_coreInterface;
+	const std::chrono::milliseconds m_stepTimeout;
+	FileActionHandler m_fileActionHandler;
+	bool m_navigationCompleted = false;
+};
\ No newline at end of file
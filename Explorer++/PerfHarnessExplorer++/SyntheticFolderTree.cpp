@@ -0,0 +1,241 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "SyntheticFolderTree.h"
+#include <boost/format.hpp>
+#include <wil/resource.h>
+#include <windows.h>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+const wchar_t COMPLETION_MARKER_EXTENSION[] = L".complete";
+
+const int DEEP_TREE_LEVELS = 16;
+
+const wchar_t *const NAME_PREFIXES[] = { L"Document ", L"IMG_", L"report-v", L"Photo (",
+	L"data_", L"Meeting notes ", L"setup", L"~temp" };
+
+const wchar_t *const EXTENSIONS[] = { L".txt", L".jpg", L".png", L".docx", L".pdf", L".cpp",
+	L".h", L".zip", L".mp3", L".log", L"" };
+
+// The files are small, so that a tree with a million files can be created in a reasonable amount of
+// time, but their sizes still differ enough to make sorting by size meaningful.
+const DWORD MAX_FILE_SIZE = 4096;
+
+class TreeWriter
+{
+public:
+	explicit TreeWriter(const SyntheticTreeOptions &options) :
+		m_generator(options.numFiles * 3 + static_cast<size_t>(options.shape)),
+		m_prefixDistribution(0, std::size(NAME_PREFIXES) - 1),
+		m_extensionDistribution(0, std::size(EXTENSIONS) - 1),
+		m_sizeDistribution(0, MAX_FILE_SIZE),
+		m_timeDistribution(125911584000000000ULL, 133801632000000000ULL),
+		m_buffer(MAX_FILE_SIZE, 'x')
+	{
+	}
+
+	void CreateFiles(const std::filesystem::path &directory, size_t numFiles)
+	{
+		std::filesystem::create_directories(directory);
+
+		for (size_t i = 0; i < numFiles; i++)
+		{
+			WriteSyntheticFile(directory);
+		}
+	}
+
+private:
+	void WriteSyntheticFile(const std::filesystem::path &directory)
+	{
+		// The counter is appended to make each name unique.
+		auto name = (boost::wformat(L"%s%d%s") % NAME_PREFIXES[m_prefixDistribution(m_generator)]
+			% m_fileCounter++ % EXTENSIONS[m_extensionDistribution(m_generator)]).str();
+
+		wil::unique_hfile file(CreateFileW((directory / name).c_str(), GENERIC_WRITE, 0, nullptr,
+			CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+
+		if (!file)
+		{
+			throw std::filesystem::filesystem_error("Couldn't create file", directory / name,
+				std::error_code(static_cast<int>(GetLastError()), std::system_category()));
+		}
+
+		DWORD size = m_sizeDistribution(m_generator);
+		DWORD numBytesWritten;
+		WriteFile(file.get(), m_buffer.data(), size, &numBytesWritten, nullptr);
+
+		uint64_t time = m_timeDistribution(m_generator);
+		FILETIME fileTime = { static_cast<DWORD>(time), static_cast<DWORD>(time >> 32) };
+		SetFileTime(file.get(), &fileTime, nullptr, &fileTime);
+	}
+
+	std::mt19937_64 m_generator;
+	std::uniform_int_distribution<size_t> m_prefixDistribution;
+	std::uniform_int_distribution<size_t> m_extensionDistribution;
+	std::uniform_int_distribution<DWORD> m_sizeDistribution;
+
+	// Timestamps between 2000 and 2025.
+	std::uniform_int_distribution<uint64_t> m_timeDistribution;
+
+	std::vector<char> m_buffer;
+	size_t m_fileCounter = 0;
+};
+
+std::wstring GetLevelName(int level)
+{
+	return (boost::wformat(L"Level %d") % level).str();
+}
+
+std::filesystem::path CreateFlatTree(
+	TreeWriter &writer, const std::filesystem::path &treeDirectory, size_t numFiles)
+{
+	writer.CreateFiles(treeDirectory, numFiles);
+	return treeDirectory;
+}
+
+std::filesystem::path CreateWideTree(
+	TreeWriter &writer, const std::filesystem::path &treeDirectory, size_t numFiles)
+{
+	size_t numRootFiles = numFiles / 2;
+	writer.CreateFiles(treeDirectory, numRootFiles);
+
+	size_t remainingFiles = numFiles - numRootFiles;
+	auto numFolders = std::max<size_t>(
+		static_cast<size_t>(std::sqrt(static_cast<double>(numFiles))), 1);
+
+	for (size_t i = 0; i < numFolders; i++)
+	{
+		// Any files that don't divide evenly are placed in the first folders.
+		size_t numFolderFiles =
+			remainingFiles / numFolders + ((i < remainingFiles % numFolders) ? 1 : 0);
+		writer.CreateFiles(
+			treeDirectory / (boost::wformat(L"Folder %d") % i).str(), numFolderFiles);
+	}
+
+	return treeDirectory;
+}
+
+std::filesystem::path CreateDeepTree(
+	TreeWriter &writer, const std::filesystem::path &treeDirectory, size_t numFiles)
+{
+	std::filesystem::path currentDirectory = treeDirectory;
+	size_t filesPerLevel = numFiles / DEEP_TREE_LEVELS;
+
+	for (int level = 0; level < DEEP_TREE_LEVELS; level++)
+	{
+		currentDirectory /= GetLevelName(level);
+
+		// The innermost folder (which is the one that's browsed) receives any remaining files.
+		size_t numLevelFiles = (level == DEEP_TREE_LEVELS - 1)
+			? numFiles - filesPerLevel * (DEEP_TREE_LEVELS - 1)
+			: filesPerLevel;
+		writer.CreateFiles(currentDirectory, numLevelFiles);
+	}
+
+	return currentDirectory;
+}
+
+std::filesystem::path GetBrowsedFolder(
+	const std::filesystem::path &treeDirectory, TreeShape shape)
+{
+	if (shape != TreeShape::Deep)
+	{
+		return treeDirectory;
+	}
+
+	std::filesystem::path currentDirectory = treeDirectory;
+
+	for (int level = 0; level < DEEP_TREE_LEVELS; level++)
+	{
+		currentDirectory /= GetLevelName(level);
+	}
+
+	return currentDirectory;
+}
+
+}
+
+std::filesystem::path CreateSyntheticFolderTree(
+	const std::filesystem::path &root, const SyntheticTreeOptions &options)
+{
+	auto treeName =
+		(boost::wformat(L"%s-%d") % GetTreeShapeName(options.shape) % options.numFiles).str();
+	auto treeDirectory = root / treeName;
+
+	// The marker is stored next to the tree, rather than within it, so that it's not one of the
+	// items that are shown.
+	auto completionMarker = root / (treeName + COMPLETION_MARKER_EXTENSION);
+
+	if (std::filesystem::exists(completionMarker))
+	{
+		return GetBrowsedFolder(treeDirectory, options.shape);
+	}
+
+	// A tree that was only partially created is removed, so that the result doesn't depend on how
+	// far a previous run got.
+	std::filesystem::remove_all(treeDirectory);
+
+	TreeWriter writer(options);
+	std::filesystem::path browsedFolder;
+
+	switch (options.shape)
+	{
+	case TreeShape::Flat:
+		browsedFolder = CreateFlatTree(writer, treeDirectory, options.numFiles);
+		break;
+
+	case TreeShape::Wide:
+		browsedFolder = CreateWideTree(writer, treeDirectory, options.numFiles);
+		break;
+
+	case TreeShape::Deep:
+		browsedFolder = CreateDeepTree(writer, treeDirectory, options.numFiles);
+		break;
+	}
+
+	wil::unique_hfile marker(CreateFileW(completionMarker.c_str(), GENERIC_WRITE, 0, nullptr,
+		CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+
+	return browsedFolder;
+}
+
+std::optional<TreeShape> ParseTreeShape(std::wstring_view name)
+{
+	if (name == L"flat")
+	{
+		return TreeShape::Flat;
+	}
+	else if (name == L"wide")
+	{
+		return TreeShape::Wide;
+	}
+	else if (name == L"deep")
+	{
+		return TreeShape::Deep;
+	}
+
+	return std::nullopt;
+}
+
+const wchar_t *GetTreeShapeName(TreeShape shape)
+{
+	switch (shape)
+	{
+	case TreeShape::Flat:
+		return L"flat";
+
+	case TreeShape::Wide:
+		return L"wide";
+
+	case TreeShape::Deep:
+		return L"deep";
+	}
+
+	return L"";
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <string_view>
+
+enum class TreeShape
+{
+	// Every file is placed directly in the browsed folder.
+	Flat,
+
+	// The browsed folder contains half of the files, along with a large number of subfolders that
+	// share the rest.
+	Wide,
+
+	// The files are spread evenly across a chain of nested folders. The innermost folder is
+	// browsed.
+	Deep
+};
+
+struct SyntheticTreeOptions
+{
+	size_t numFiles;
+	TreeShape shape;
+};
+
+// Creates the tree beneath the root directory and returns the folder that should be browsed. The
+// names, extensions, sizes and timestamps are generated from a seed derived from the options, so
+// the same options always produce the same tree. A tree that was fully created by a previous run is
+// reused.
+std::filesystem::path CreateSyntheticFolderTree(
+	const std::filesystem::path &root, const SyntheticTreeOptions &options);
+
+std::optional<TreeShape> ParseTreeShape(std::wstring_view name);
+const wchar_t *GetTreeShapeName(TreeShape shape);
\ No newline at end of file
@@ -0,0 +1,104 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/AccountNameCache.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <map>
+
+class AccountNameCacheTest : public testing::Test
+{
+protected:
+	AccountNameCacheTest() :
+		m_cache(
+			[this](const std::wstring &sid) -> std::optional<std::wstring>
+			{
+				m_lookups[sid]++;
+
+				if (sid == L"S-1-5-21-1-2-3-1001")
+				{
+					return L"DOMAIN\\user";
+				}
+
+				return std::nullopt;
+			})
+	{
+	}
+
+	std::map<std::wstring, int> m_lookups;
+
+	AccountNameCache m_cache;
+};
+
+TEST_F(AccountNameCacheTest, SidReturnedUntilResolved)
+{
+	EXPECT_EQ(m_cache.GetAccountName(L"S-1-5-21-1-2-3-1001"), L"S-1-5-21-1-2-3-1001");
+
+	m_cache.WaitForPendingLookups();
+
+	EXPECT_EQ(m_cache.GetAccountName(L"S-1-5-21-1-2-3-1001"), L"DOMAIN\\user");
+	EXPECT_EQ(m_cache.GetResolvedAccountName(L"S-1-5-21-1-2-3-1001"), L"DOMAIN\\user");
+	EXPECT_EQ(m_lookups[L"S-1-5-21-1-2-3-1001"], 1);
+}
+
+TEST_F(AccountNameCacheTest, FailedLookupsCached)
+{
+	EXPECT_EQ(m_cache.GetAccountName(L"S-1-5-21-1-2-3-1002"), L"S-1-5-21-1-2-3-1002");
+	m_cache.WaitForPendingLookups();
+
+	// The SID continues to be used, but it isn't looked up again.
+	EXPECT_EQ(m_cache.GetAccountName(L"S-1-5-21-1-2-3-1002"), L"S-1-5-21-1-2-3-1002");
+	EXPECT_EQ(m_cache.GetResolvedAccountName(L"S-1-5-21-1-2-3-1002"), std::nullopt);
+	m_cache.WaitForPendingLookups();
+
+	EXPECT_EQ(m_lookups[L"S-1-5-21-1-2-3-1002"], 1);
+}
+
+TEST_F(AccountNameCacheTest, LookupQueuedOnce)
+{
+	for (int i = 0; i < 10; i++)
+	{
+		m_cache.GetAccountName(L"S-1-5-21-1-2-3-1001");
+	}
+
+	m_cache.WaitForPendingLookups();
+
+	EXPECT_EQ(m_lookups[L"S-1-5-21-1-2-3-1001"], 1);
+}
+
+TEST_F(AccountNameCacheTest, ResolvedNameNotQueued)
+{
+	// Checking for a resolved name shouldn't result in a lookup.
+	EXPECT_EQ(m_cache.GetResolvedAccountName(L"S-1-5-21-1-2-3-1001"), std::nullopt);
+	m_cache.WaitForPendingLookups();
+
+	EXPECT_EQ(m_lookups[L"S-1-5-21-1-2-3-1001"], 0);
+}
+
+TEST_F(AccountNameCacheTest, ObserversNotified)
+{
+	std::atomic<int> numNotifications = 0;
+	auto connection = m_cache.AddNamesResolvedObserver([&numNotifications] { numNotifications++; });
+
+	m_cache.GetAccountName(L"S-1-5-21-1-2-3-1001");
+	m_cache.WaitForPendingLookups();
+
+	EXPECT_GE(numNotifications, 1);
+
+	connection.disconnect();
+}
+
+TEST_F(AccountNameCacheTest, Clear)
+{
+	m_cache.GetAccountName(L"S-1-5-21-1-2-3-1001");
+	m_cache.WaitForPendingLookups();
+
+	m_cache.Clear();
+	EXPECT_EQ(m_cache.GetResolvedAccountName(L"S-1-5-21-1-2-3-1001"), std::nullopt);
+
+	m_cache.GetAccountName(L"S-1-5-21-1-2-3-1001");
+	m_cache.WaitForPendingLookups();
+
+	EXPECT_EQ(m_lookups[L"S-1-5-21-1-2-3-1001"], 2);
+}
\ No newline at end of file
@@ -0,0 +1,138 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "Bookmarks/BookmarkJournal.h"
+#include "BookmarkStorageHelper.h"
+#include "Bookmarks/BookmarkTree.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+
+using namespace testing;
+
+class BookmarkJournalTest : public Test
+{
+protected:
+	void SetUp() override
+	{
+		m_filePath = std::filesystem::temp_directory_path()
+			/ (L"BookmarkJournalTest" + std::to_wstring(GetCurrentProcessId()) + L".dat");
+	}
+
+	void TearDown() override
+	{
+		std::filesystem::remove(m_filePath);
+	}
+
+	// Makes a set of changes to the tree, covering each of the operations that are journaled.
+	static void ModifyTree(BookmarkTree *bookmarkTree)
+	{
+		auto folder = std::make_unique<BookmarkItem>(std::nullopt, L"Folder", std::nullopt);
+		folder->AddChild(std::make_unique<BookmarkItem>(std::nullopt, L"Nested", L"C:\\Nested"));
+		auto rawFolder = bookmarkTree->AddBookmarkItem(
+			bookmarkTree->GetBookmarksToolbarFolder(), std::move(folder), 0);
+
+		auto rawFirst = bookmarkTree->AddBookmarkItem(bookmarkTree->GetBookmarksMenuFolder(),
+			std::make_unique<BookmarkItem>(std::nullopt, L"First", L"C:\\First"), 0);
+		auto rawSecond = bookmarkTree->AddBookmarkItem(bookmarkTree->GetBookmarksMenuFolder(),
+			std::make_unique<BookmarkItem>(std::nullopt, L"Second", L"C:\\Second"), 1);
+		auto rawThird = bookmarkTree->AddBookmarkItem(bookmarkTree->GetBookmarksMenuFolder(),
+			std::make_unique<BookmarkItem>(std::nullopt, L"Third", L"C:\\Third"), 2);
+
+		rawFirst->SetName(L"First (renamed)");
+		rawSecond->SetLocation(L"D:\\Second");
+
+		bookmarkTree->MoveBookmarkItem(rawThird, bookmarkTree->GetBookmarksMenuFolder(), 0);
+		bookmarkTree->MoveBookmarkItem(rawSecond, rawFolder, 1);
+		bookmarkTree->RemoveBookmarkItem(rawFirst);
+	}
+
+	std::filesystem::path m_filePath;
+};
+
+TEST_F(BookmarkJournalTest, Replay)
+{
+	BookmarkTree bookmarkTree;
+	BookmarkJournal journal(&bookmarkTree, m_filePath);
+	ModifyTree(&bookmarkTree);
+
+	BookmarkTree replayedBookmarkTree;
+	BookmarkJournal replayedJournal(&replayedBookmarkTree, m_filePath);
+	EXPECT_GT(replayedJournal.Replay(), 0u);
+
+	CompareBookmarkTrees(&replayedBookmarkTree, &bookmarkTree, true);
+}
+
+TEST_F(BookmarkJournalTest, ReplayIsIdempotent)
+{
+	BookmarkTree bookmarkTree;
+	BookmarkJournal journal(&bookmarkTree, m_filePath);
+	ModifyTree(&bookmarkTree);
+
+	// The tree already reflects every record, so replaying them shouldn't change anything.
+	journal.Replay();
+
+	BookmarkTree replayedBookmarkTree;
+	BookmarkJournal replayedJournal(&replayedBookmarkTree, m_filePath);
+	replayedJournal.Replay();
+	replayedJournal.Replay();
+
+	CompareBookmarkTrees(&replayedBookmarkTree, &bookmarkTree, true);
+}
+
+TEST_F(BookmarkJournalTest, Compact)
+{
+	BookmarkTree bookmarkTree;
+	BookmarkJournal journal(&bookmarkTree, m_filePath);
+
+	bookmarkTree.AddBookmarkItem(bookmarkTree.GetBookmarksMenuFolder(),
+		std::make_unique<BookmarkItem>(std::nullopt, L"Saved", L"C:\\Saved"), 0);
+	uint64_t savedSequenceNumber = journal.GetLastSequenceNumber();
+
+	bookmarkTree.AddBookmarkItem(bookmarkTree.GetBookmarksToolbarFolder(),
+		std::make_unique<BookmarkItem>(std::nullopt, L"Unsaved", L"C:\\Unsaved"), 0);
+
+	EXPECT_TRUE(journal.Compact(savedSequenceNumber));
+
+	// Only the record made after the save should remain.
+	BookmarkTree replayedBookmarkTree;
+	BookmarkJournal replayedJournal(&replayedBookmarkTree, m_filePath);
+	EXPECT_EQ(replayedJournal.GetLastSequenceNumber(), journal.GetLastSequenceNumber());
+	replayedJournal.Replay();
+
+	EXPECT_TRUE(replayedBookmarkTree.GetBookmarksMenuFolder()->GetChildren().empty());
+	ASSERT_EQ(replayedBookmarkTree.GetBookmarksToolbarFolder()->GetChildren().size(), 1u);
+	EXPECT_EQ(replayedBookmarkTree.GetBookmarksToolbarFolder()->GetChildren()[0]->GetName(),
+		L"Unsaved");
+}
+
+TEST_F(BookmarkJournalTest, PartialRecordIgnored)
+{
+	{
+		BookmarkTree bookmarkTree;
+		BookmarkJournal journal(&bookmarkTree, m_filePath);
+		bookmarkTree.AddBookmarkItem(bookmarkTree.GetBookmarksMenuFolder(),
+			std::make_unique<BookmarkItem>(std::nullopt, L"Complete", L"C:\\Complete"), 0);
+	}
+
+	// Simulates a record that was only partially written.
+	{
+		std::ofstream stream(m_filePath, std::ios::binary | std::ios::app);
+		stream.write("\x40\x00\x00\x00\x01\x02", 6);
+	}
+
+	BookmarkTree bookmarkTree;
+	BookmarkJournal journal(&bookmarkTree, m_filePath);
+
+	// Records appended after the partial record should still be readable.
+	bookmarkTree.AddBookmarkItem(bookmarkTree.GetBookmarksToolbarFolder(),
+		std::make_unique<BookmarkItem>(std::nullopt, L"Appended", L"C:\\Appended"), 0);
+
+	BookmarkTree replayedBookmarkTree;
+	BookmarkJournal replayedJournal(&replayedBookmarkTree, m_filePath);
+	EXPECT_EQ(replayedJournal.Replay(), 2u);
+
+	EXPECT_EQ(replayedBookmarkTree.GetBookmarksMenuFolder()->GetChildren().size(), 1u);
+	EXPECT_EQ(replayedBookmarkTree.GetBookmarksToolbarFolder()->GetChildren().size(), 1u);
+}
\ No newline at end of file
@@ -78,6 +78,32 @@ TEST_F(BookmarkRegistryStorageTest, V2Save)
 	CompareBookmarkTrees(&loadedBookmarkTree, &referenceBookmarkTree, true);
 }
 
+TEST_F(BookmarkRegistryStorageTest, V2IncrementalSave)
+{
+	BookmarkTree referenceBookmarkTree;
+	BuildV2LoadSaveReferenceTree(&referenceBookmarkTree);
+
+	BookmarkRegistryStorage::Save(g_applicationTestKey, &referenceBookmarkTree);
+	uint64_t savedChange = referenceBookmarkTree.GetChangeCounter();
+
+	auto *menuFolder = referenceBookmarkTree.GetBookmarksMenuFolder();
+	auto *rawFolder = referenceBookmarkTree.AddBookmarkItem(menuFolder,
+		std::make_unique<BookmarkItem>(std::nullopt, L"Added folder", std::nullopt), 0);
+	referenceBookmarkTree.AddBookmarkItem(rawFolder,
+		std::make_unique<BookmarkItem>(std::nullopt, L"Added bookmark", L"C:\\Added"), 0);
+
+	auto *toolbarFolder = referenceBookmarkTree.GetBookmarksToolbarFolder();
+	ASSERT_FALSE(toolbarFolder->GetChildren().empty());
+	toolbarFolder->GetChildren()[0]->SetName(L"Renamed");
+
+	BookmarkRegistryStorage::Save(g_applicationTestKey, &referenceBookmarkTree, savedChange);
+
+	BookmarkTree loadedBookmarkTree;
+	BookmarkRegistryStorage::Load(g_applicationTestKey, &loadedBookmarkTree);
+
+	CompareBookmarkTrees(&loadedBookmarkTree, &referenceBookmarkTree, true);
+}
+
 TEST_F(BookmarkRegistryStorageTest, V1BasicLoad)
 {
 	BookmarkTree referenceBookmarkTree;
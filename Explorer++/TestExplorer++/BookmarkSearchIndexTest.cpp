@@ -0,0 +1,148 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "Bookmarks/BookmarkSearchIndex.h"
+#include "Bookmarks/BookmarkTree.h"
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using namespace testing;
+
+class BookmarkSearchIndexTest : public Test
+{
+protected:
+	BookmarkItem *AddBookmark(BookmarkItem *parent, const std::wstring &name,
+		const std::wstring &location)
+	{
+		auto bookmark = std::make_unique<BookmarkItem>(std::nullopt, name, location);
+		return m_bookmarkTree.AddBookmarkItem(
+			parent, std::move(bookmark), parent->GetChildren().size());
+	}
+
+	BookmarkItem *AddFolder(BookmarkItem *parent, const std::wstring &name)
+	{
+		auto folder = std::make_unique<BookmarkItem>(std::nullopt, name, std::nullopt);
+		return m_bookmarkTree.AddBookmarkItem(
+			parent, std::move(folder), parent->GetChildren().size());
+	}
+
+	BookmarkTree m_bookmarkTree;
+};
+
+TEST_F(BookmarkSearchIndexTest, ExistingItems)
+{
+	auto *bookmark =
+		AddBookmark(m_bookmarkTree.GetBookmarksToolbarFolder(), L"Windows", L"C:\\Windows");
+
+	BookmarkSearchIndex searchIndex(&m_bookmarkTree);
+
+	EXPECT_THAT(searchIndex.Search(L"Windows"), ElementsAre(bookmark));
+}
+
+TEST_F(BookmarkSearchIndexTest, NameAndLocation)
+{
+	BookmarkSearchIndex searchIndex(&m_bookmarkTree);
+
+	auto *bookmark1 =
+		AddBookmark(m_bookmarkTree.GetBookmarksToolbarFolder(), L"System", L"C:\\Windows\\System32");
+	auto *bookmark2 =
+		AddBookmark(m_bookmarkTree.GetBookmarksMenuFolder(), L"Program Files", L"C:\\Program Files");
+	auto *bookmark3 =
+		AddBookmark(m_bookmarkTree.GetOtherBookmarksFolder(), L"Files", L"D:\\Files");
+
+	// Items whose name starts with the text should be returned first, followed by those whose name
+	// contains the text, followed by those that only match on location.
+	EXPECT_THAT(searchIndex.Search(L"files"), ElementsAre(bookmark3, bookmark2));
+	EXPECT_THAT(searchIndex.Search(L"windows"), ElementsAre(bookmark1));
+	EXPECT_THAT(searchIndex.Search(L"sys"), ElementsAre(bookmark1));
+	EXPECT_THAT(searchIndex.Search(L"c:\\"), UnorderedElementsAre(bookmark1, bookmark2));
+	EXPECT_THAT(searchIndex.Search(L"does not exist"), IsEmpty());
+	EXPECT_THAT(searchIndex.Search(L""), IsEmpty());
+}
+
+TEST_F(BookmarkSearchIndexTest, CaseInsensitive)
+{
+	BookmarkSearchIndex searchIndex(&m_bookmarkTree);
+
+	auto *bookmark =
+		AddBookmark(m_bookmarkTree.GetBookmarksToolbarFolder(), L"Documents", L"C:\\Documents");
+
+	EXPECT_THAT(searchIndex.Search(L"DOCUMENTS"), ElementsAre(bookmark));
+	EXPECT_THAT(searchIndex.Search(L"cUmEn"), ElementsAre(bookmark));
+}
+
+TEST_F(BookmarkSearchIndexTest, ShortQuery)
+{
+	BookmarkSearchIndex searchIndex(&m_bookmarkTree);
+
+	auto *bookmark1 = AddBookmark(m_bookmarkTree.GetBookmarksToolbarFolder(), L"qx", L"C:\\");
+	auto *bookmark2 = AddBookmark(m_bookmarkTree.GetBookmarksToolbarFolder(), L"xq", L"D:\\");
+
+	// Queries shorter than three characters don't contain any trigrams, but should still work.
+	EXPECT_THAT(searchIndex.Search(L"q"), ElementsAre(bookmark1, bookmark2));
+	EXPECT_THAT(searchIndex.Search(L"qx"), ElementsAre(bookmark1));
+	EXPECT_THAT(searchIndex.Search(L"d:"), ElementsAre(bookmark2));
+}
+
+TEST_F(BookmarkSearchIndexTest, MaxResults)
+{
+	BookmarkSearchIndex searchIndex(&m_bookmarkTree);
+
+	AddBookmark(m_bookmarkTree.GetBookmarksToolbarFolder(), L"Test 1", L"C:\\");
+	AddBookmark(m_bookmarkTree.GetBookmarksToolbarFolder(), L"Test 2", L"C:\\");
+	AddBookmark(m_bookmarkTree.GetBookmarksToolbarFolder(), L"Test 3", L"C:\\");
+
+	EXPECT_EQ(searchIndex.Search(L"test", 2).size(), 2u);
+	EXPECT_EQ(searchIndex.Search(L"test").size(), 3u);
+}
+
+TEST_F(BookmarkSearchIndexTest, Update)
+{
+	BookmarkSearchIndex searchIndex(&m_bookmarkTree);
+
+	auto *bookmark =
+		AddBookmark(m_bookmarkTree.GetBookmarksToolbarFolder(), L"Old name", L"C:\\Old");
+
+	bookmark->SetName(L"New name");
+	EXPECT_THAT(searchIndex.Search(L"old name"), IsEmpty());
+	EXPECT_THAT(searchIndex.Search(L"new name"), ElementsAre(bookmark));
+
+	bookmark->SetLocation(L"C:\\New");
+	EXPECT_THAT(searchIndex.Search(L"c:\\old"), IsEmpty());
+	EXPECT_THAT(searchIndex.Search(L"c:\\new"), ElementsAre(bookmark));
+}
+
+TEST_F(BookmarkSearchIndexTest, Remove)
+{
+	BookmarkSearchIndex searchIndex(&m_bookmarkTree);
+
+	auto *folder = AddFolder(m_bookmarkTree.GetBookmarksToolbarFolder(), L"Folder");
+	AddBookmark(folder, L"Nested item", L"C:\\");
+	auto *otherBookmark =
+		AddBookmark(m_bookmarkTree.GetBookmarksToolbarFolder(), L"Other item", L"D:\\");
+
+	EXPECT_EQ(searchIndex.Search(L"item").size(), 2u);
+
+	// Removing a folder should also remove the items it contains.
+	m_bookmarkTree.RemoveBookmarkItem(folder);
+	EXPECT_THAT(searchIndex.Search(L"folder"), IsEmpty());
+	EXPECT_THAT(searchIndex.Search(L"item"), ElementsAre(otherBookmark));
+
+	// IDs of removed items can be reused, so adding a new item shouldn't affect anything else.
+	auto *newBookmark =
+		AddBookmark(m_bookmarkTree.GetBookmarksToolbarFolder(), L"New item", L"E:\\");
+	EXPECT_THAT(searchIndex.Search(L"item"), UnorderedElementsAre(otherBookmark, newBookmark));
+}
+
+TEST_F(BookmarkSearchIndexTest, AddFolderWithChildren)
+{
+	BookmarkSearchIndex searchIndex(&m_bookmarkTree);
+
+	auto folder = std::make_unique<BookmarkItem>(std::nullopt, L"Folder", std::nullopt);
+	auto *rawBookmark = folder->AddChild(
+		std::make_unique<BookmarkItem>(std::nullopt, L"Nested bookmark", L"C:\\"));
+	m_bookmarkTree.AddBookmarkItem(m_bookmarkTree.GetBookmarksToolbarFolder(), std::move(folder), 0);
+
+	EXPECT_THAT(searchIndex.Search(L"nested"), ElementsAre(rawBookmark));
+}
\ No newline at end of file
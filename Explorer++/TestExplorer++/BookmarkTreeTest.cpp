@@ -138,6 +138,80 @@ TEST(BookmarkTreeTest, RemoveChildren)
 	EXPECT_EQ(bookmarkTree.GetOtherBookmarksFolder()->GetChildren().size(), 0);
 }
 
+TEST(BookmarkTreeTest, GetBookmarkItemById)
+{
+	BookmarkTree bookmarkTree;
+
+	EXPECT_EQ(bookmarkTree.GetBookmarkItemById(bookmarkTree.GetRoot()->GetGUID()),
+		bookmarkTree.GetRoot());
+	EXPECT_EQ(bookmarkTree.GetBookmarkItemById(bookmarkTree.GetBookmarksMenuFolder()->GetGUID()),
+		bookmarkTree.GetBookmarksMenuFolder());
+	EXPECT_EQ(bookmarkTree.GetBookmarkItemById(L"unknown"), nullptr);
+
+	auto folder = std::make_unique<BookmarkItem>(std::nullopt, L"Test folder", std::nullopt);
+	auto rawFolder = folder.get();
+
+	auto bookmark = std::make_unique<BookmarkItem>(std::nullopt, L"Test bookmark", L"C:\\");
+	auto rawBookmark = bookmark.get();
+	std::wstring bookmarkGuid = bookmark->GetGUID();
+	folder->AddChild(std::move(bookmark));
+
+	// Items nested within an added folder should also be indexed.
+	bookmarkTree.AddBookmarkItem(bookmarkTree.GetBookmarksMenuFolder(), std::move(folder), 0);
+	EXPECT_EQ(bookmarkTree.GetBookmarkItemById(rawFolder->GetGUID()), rawFolder);
+	EXPECT_EQ(bookmarkTree.GetBookmarkItemById(bookmarkGuid), rawBookmark);
+
+	bookmarkTree.MoveBookmarkItem(rawFolder, bookmarkTree.GetBookmarksToolbarFolder(), 0);
+	EXPECT_EQ(bookmarkTree.GetBookmarkItemById(bookmarkGuid), rawBookmark);
+
+	std::wstring folderGuid = rawFolder->GetGUID();
+	bookmarkTree.RemoveBookmarkItem(rawFolder);
+	EXPECT_EQ(bookmarkTree.GetBookmarkItemById(folderGuid), nullptr);
+	EXPECT_EQ(bookmarkTree.GetBookmarkItemById(bookmarkGuid), nullptr);
+}
+
+TEST(BookmarkTreeTest, ChangeTracking)
+{
+	BookmarkTree bookmarkTree;
+
+	auto folder = std::make_unique<BookmarkItem>(std::nullopt, L"Test folder", std::nullopt);
+	auto rawFolder = bookmarkTree.AddBookmarkItem(
+		bookmarkTree.GetBookmarksMenuFolder(), std::move(folder), 0);
+
+	auto bookmark = std::make_unique<BookmarkItem>(std::nullopt, L"Test bookmark", L"C:\\");
+	auto rawBookmark = bookmarkTree.AddBookmarkItem(rawFolder, std::move(bookmark), 0);
+
+	uint64_t savedChange = bookmarkTree.GetChangeCounter();
+	EXPECT_GT(savedChange, 0u);
+	EXPECT_EQ(bookmarkTree.GetPropertiesChange(rawBookmark), 0u);
+
+	// Updating an item should only affect the item itself and the subtrees that contain it.
+	rawBookmark->SetName(L"Updated name");
+	EXPECT_GT(bookmarkTree.GetPropertiesChange(rawBookmark), savedChange);
+	EXPECT_LE(bookmarkTree.GetChildrenChange(rawFolder), savedChange);
+	EXPECT_GT(bookmarkTree.GetSubtreeChange(rawFolder), savedChange);
+	EXPECT_GT(bookmarkTree.GetSubtreeChange(bookmarkTree.GetBookmarksMenuFolder()), savedChange);
+	EXPECT_LE(
+		bookmarkTree.GetSubtreeChange(bookmarkTree.GetBookmarksToolbarFolder()), savedChange);
+
+	savedChange = bookmarkTree.GetChangeCounter();
+
+	bookmarkTree.MoveBookmarkItem(rawBookmark, bookmarkTree.GetBookmarksToolbarFolder(), 0);
+	EXPECT_GT(bookmarkTree.GetChildrenChange(rawFolder), savedChange);
+	EXPECT_GT(bookmarkTree.GetChildrenChange(bookmarkTree.GetBookmarksToolbarFolder()),
+		savedChange);
+	EXPECT_LE(bookmarkTree.GetChildrenChange(bookmarkTree.GetOtherBookmarksFolder()),
+		savedChange);
+
+	savedChange = bookmarkTree.GetChangeCounter();
+
+	bookmarkTree.RemoveBookmarkItem(rawFolder);
+	EXPECT_GT(bookmarkTree.GetChildrenChange(bookmarkTree.GetBookmarksMenuFolder()),
+		savedChange);
+	EXPECT_LE(bookmarkTree.GetSubtreeChange(bookmarkTree.GetBookmarksToolbarFolder()),
+		savedChange);
+}
+
 TEST_F(BookmarkTreeObserverTest, Add)
 {
 	m_bookmarkTree.bookmarkItemAddedSignal.AddObserver(
@@ -10,6 +10,7 @@
 #include <gtest/gtest.h>
 #include <wil/com.h>
 #include <wil/resource.h>
+#include <Shlwapi.h>
 #include <optional>
 
 using namespace testing;
@@ -48,6 +49,21 @@ protected:
 
 		CompareBookmarkTrees(&loadedBookmarkTree, referenceBookmarkTree, compareGuids);
 	}
+
+	void PerformStreamLoadTest(
+		const std::wstring &filename, BookmarkTree *referenceBookmarkTree, bool compareGuids)
+	{
+		std::wstring xmlFilePath = GetResourcePath(filename);
+		wil::com_ptr_nothrow<IStream> stream;
+		HRESULT hr = SHCreateStreamOnFileEx(
+			xmlFilePath.c_str(), STGM_READ, FILE_ATTRIBUTE_NORMAL, FALSE, nullptr, &stream);
+		ASSERT_HRESULT_SUCCEEDED(hr);
+
+		BookmarkTree loadedBookmarkTree;
+		BookmarkXmlStorage::Load(stream.get(), &loadedBookmarkTree);
+
+		CompareBookmarkTrees(&loadedBookmarkTree, referenceBookmarkTree, compareGuids);
+	}
 };
 
 TEST_F(BookmarkXmlStorageTest, V2Load)
@@ -58,6 +74,14 @@ TEST_F(BookmarkXmlStorageTest, V2Load)
 	PerformLoadTest(L"bookmarks-v2-config.xml", &referenceBookmarkTree, true);
 }
 
+TEST_F(BookmarkXmlStorageTest, V2StreamLoad)
+{
+	BookmarkTree referenceBookmarkTree;
+	BuildV2LoadSaveReferenceTree(&referenceBookmarkTree);
+
+	PerformStreamLoadTest(L"bookmarks-v2-config.xml", &referenceBookmarkTree, true);
+}
+
 TEST_F(BookmarkXmlStorageTest, V2Save)
 {
 	BookmarkTree referenceBookmarkTree;
@@ -92,6 +116,23 @@ TEST_F(BookmarkXmlStorageTest, V1NestedShowOnToolbarLoad)
 		L"bookmarks-v1-config-nested-show-on-toolbar.xml", &referenceBookmarkTree, false);
 }
 
+TEST_F(BookmarkXmlStorageTest, V1BasicStreamLoad)
+{
+	BookmarkTree referenceBookmarkTree;
+	BuildV1BasicLoadReferenceTree(&referenceBookmarkTree);
+
+	PerformStreamLoadTest(L"bookmarks-v1-config.xml", &referenceBookmarkTree, false);
+}
+
+TEST_F(BookmarkXmlStorageTest, V1NestedShowOnToolbarStreamLoad)
+{
+	BookmarkTree referenceBookmarkTree;
+	BuildV1NestedShowOnToolbarLoadReferenceTree(&referenceBookmarkTree);
+
+	PerformStreamLoadTest(
+		L"bookmarks-v1-config-nested-show-on-toolbar.xml", &referenceBookmarkTree, false);
+}
+
 wil::com_ptr_nothrow<IXMLDOMDocument> LoadXmlDocument(const std::wstring &filePath)
 {
 	wil::com_ptr_nothrow<IXMLDOMDocument> xmlDocument;
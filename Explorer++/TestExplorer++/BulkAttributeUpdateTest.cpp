@@ -0,0 +1,123 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/BulkAttributeUpdate.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+
+using namespace testing;
+
+class BulkAttributeUpdateTest : public Test
+{
+protected:
+	void SetUp() override
+	{
+		m_root = std::filesystem::temp_directory_path()
+			/ (L"BulkAttributeUpdateTest" + std::to_wstring(GetCurrentProcessId()));
+		std::filesystem::create_directories(m_root / L"Folder");
+
+		for (int i = 0; i < NUM_FILES; i++)
+		{
+			std::ofstream stream(GetFilePath(i));
+		}
+	}
+
+	void TearDown() override
+	{
+		// Read-only files can't be removed.
+		for (int i = 0; i < NUM_FILES; i++)
+		{
+			SetFileAttributes(GetFilePath(i).c_str(), FILE_ATTRIBUTE_NORMAL);
+		}
+
+		std::filesystem::remove_all(m_root);
+	}
+
+	std::filesystem::path GetFilePath(int index) const
+	{
+		return m_root / (L"File" + std::to_wstring(index) + L".txt");
+	}
+
+	static FILETIME GetLastWriteTime(const std::filesystem::path &path)
+	{
+		WIN32_FILE_ATTRIBUTE_DATA data;
+		BOOL res = GetFileAttributesEx(path.c_str(), GetFileExInfoStandard, &data);
+		EXPECT_TRUE(res);
+		return data.ftLastWriteTime;
+	}
+
+	static constexpr int NUM_FILES = 50;
+
+	std::filesystem::path m_root;
+};
+
+TEST_F(BulkAttributeUpdateTest, AttributesAndTimes)
+{
+	std::vector<FileBasicInfoUpdate> updates;
+
+	for (int i = 0; i < NUM_FILES; i++)
+	{
+		updates.push_back({ GetFilePath(i).wstring(), FILE_ATTRIBUTE_READONLY });
+	}
+
+	// 2000-01-01 00:00:00 UTC.
+	FILETIME lastWriteTime = { 0x256d4000, 0x01bf53eb };
+
+	FileTimestamps timestamps;
+	timestamps.lastWriteTime = lastWriteTime;
+
+	int numProgressUpdates = 0;
+	auto result = UpdateFileBasicInfo(updates, timestamps, {},
+		[&numProgressUpdates](const FileBasicInfoUpdateProgress &progress) {
+			EXPECT_EQ(progress.totalFiles, NUM_FILES);
+			numProgressUpdates++;
+		});
+
+	EXPECT_EQ(result.filesUpdated, NUM_FILES);
+	EXPECT_EQ(result.filesFailed, 0);
+	EXPECT_GT(numProgressUpdates, 0);
+
+	for (int i = 0; i < NUM_FILES; i++)
+	{
+		EXPECT_EQ(GetFileAttributes(GetFilePath(i).c_str()),
+			static_cast<DWORD>(FILE_ATTRIBUTE_READONLY));
+
+		FILETIME updatedLastWriteTime = GetLastWriteTime(GetFilePath(i));
+		EXPECT_EQ(CompareFileTime(&updatedLastWriteTime, &lastWriteTime), 0);
+	}
+}
+
+TEST_F(BulkAttributeUpdateTest, UnchangedValues)
+{
+	SetFileAttributes(GetFilePath(0).c_str(), FILE_ATTRIBUTE_HIDDEN);
+	FILETIME originalLastWriteTime = GetLastWriteTime(GetFilePath(0));
+
+	FileTimestamps timestamps;
+	timestamps.creationTime = FILETIME{ 0x256d4000, 0x01bf53eb };
+
+	auto result = UpdateFileBasicInfo({ { GetFilePath(0).wstring(), std::nullopt } }, timestamps);
+	EXPECT_EQ(result.filesUpdated, 1);
+
+	// Neither the attributes nor the last write time should have been changed.
+	EXPECT_EQ(GetFileAttributes(GetFilePath(0).c_str()), static_cast<DWORD>(FILE_ATTRIBUTE_HIDDEN));
+
+	FILETIME updatedLastWriteTime = GetLastWriteTime(GetFilePath(0));
+	EXPECT_EQ(CompareFileTime(&updatedLastWriteTime, &originalLastWriteTime), 0);
+}
+
+TEST_F(BulkAttributeUpdateTest, Errors)
+{
+	std::wstring missingPath = (m_root / L"Missing.txt").wstring();
+
+	std::vector<FileBasicInfoUpdate> updates;
+	updates.push_back({ GetFilePath(0).wstring(), FILE_ATTRIBUTE_NORMAL });
+	updates.push_back({ missingPath, FILE_ATTRIBUTE_NORMAL });
+
+	auto result = UpdateFileBasicInfo(updates, {});
+	EXPECT_EQ(result.filesUpdated, 1);
+	EXPECT_EQ(result.filesFailed, 1);
+	EXPECT_EQ(result.firstError, static_cast<DWORD>(ERROR_FILE_NOT_FOUND));
+	EXPECT_EQ(result.firstFailedPath, missingPath);
+}
\ No newline at end of file
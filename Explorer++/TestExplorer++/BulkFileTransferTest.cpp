@@ -0,0 +1,163 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/BulkFileTransfer.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+using namespace testing;
+
+class BulkFileTransferTest : public Test
+{
+protected:
+	void SetUp() override
+	{
+		m_root = std::filesystem::temp_directory_path()
+			/ (L"BulkFileTransferTest" + std::to_wstring(GetCurrentProcessId()));
+		m_source = m_root / L"Source";
+		m_destination = m_root / L"Destination";
+
+		std::filesystem::create_directories(m_source / L"Folder" / L"Subfolder");
+		std::filesystem::create_directories(m_destination);
+
+		WriteFile(m_source / L"Folder" / L"File1.txt", "first");
+		WriteFile(m_source / L"Folder" / L"Subfolder" / L"File2.txt", "second");
+		WriteFile(m_source / L"File3.txt", "third");
+	}
+
+	void TearDown() override
+	{
+		std::filesystem::remove_all(m_root);
+	}
+
+	static void WriteFile(const std::filesystem::path &path, const std::string &contents)
+	{
+		std::ofstream stream(path, std::ios::binary);
+		stream << contents;
+	}
+
+	static std::string ReadFile(const std::filesystem::path &path)
+	{
+		std::ifstream stream(path, std::ios::binary);
+		return std::string(std::istreambuf_iterator<char>(stream), {});
+	}
+
+	std::vector<std::wstring> GetSourcePaths() const
+	{
+		return { (m_source / L"Folder").wstring(), (m_source / L"File3.txt").wstring() };
+	}
+
+	std::filesystem::path m_root;
+	std::filesystem::path m_source;
+	std::filesystem::path m_destination;
+};
+
+TEST_F(BulkFileTransferTest, Copy)
+{
+	HRESULT hr = TransferFiles(GetSourcePaths(), m_destination.wstring(), false);
+	ASSERT_HRESULT_SUCCEEDED(hr);
+
+	EXPECT_EQ(ReadFile(m_destination / L"Folder" / L"File1.txt"), "first");
+	EXPECT_EQ(ReadFile(m_destination / L"Folder" / L"Subfolder" / L"File2.txt"), "second");
+	EXPECT_EQ(ReadFile(m_destination / L"File3.txt"), "third");
+
+	// The original items should be left in place.
+	EXPECT_TRUE(std::filesystem::exists(m_source / L"Folder" / L"Subfolder" / L"File2.txt"));
+	EXPECT_TRUE(std::filesystem::exists(m_source / L"File3.txt"));
+}
+
+TEST_F(BulkFileTransferTest, ExistingItemNotSupported)
+{
+	WriteFile(m_destination / L"File3.txt", "existing");
+
+	HRESULT hr = TransferFiles(GetSourcePaths(), m_destination.wstring(), false);
+	EXPECT_EQ(hr, HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED));
+
+	// Nothing should have been written.
+	EXPECT_FALSE(std::filesystem::exists(m_destination / L"Folder"));
+	EXPECT_EQ(ReadFile(m_destination / L"File3.txt"), "existing");
+}
+
+TEST_F(BulkFileTransferTest, CopyIntoSelfNotSupported)
+{
+	HRESULT hr = TransferFiles({ (m_source / L"Folder").wstring() },
+		(m_source / L"Folder" / L"Subfolder").wstring(), false);
+	EXPECT_EQ(hr, HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED));
+}
+
+TEST_F(BulkFileTransferTest, MoveWithinVolumeNotSupported)
+{
+	HRESULT hr = TransferFiles(GetSourcePaths(), m_destination.wstring(), true);
+	EXPECT_EQ(hr, HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED));
+}
+
+TEST_F(BulkFileTransferTest, CopyReplacingExisting)
+{
+	std::filesystem::create_directories(m_destination / L"Folder");
+	WriteFile(m_destination / L"Folder" / L"File1.txt", "existing");
+	WriteFile(m_destination / L"Folder" / L"Existing.txt", "existing");
+
+	HRESULT hr = CopyItemsReplacingExisting(
+		{ { (m_source / L"Folder").wstring(), (m_destination / L"Folder").wstring() },
+			{ (m_source / L"File3.txt").wstring(), (m_destination / L"Renamed.txt").wstring() } });
+	ASSERT_HRESULT_SUCCEEDED(hr);
+
+	EXPECT_EQ(ReadFile(m_destination / L"Folder" / L"File1.txt"), "first");
+	EXPECT_EQ(ReadFile(m_destination / L"Folder" / L"Subfolder" / L"File2.txt"), "second");
+	EXPECT_EQ(ReadFile(m_destination / L"Renamed.txt"), "third");
+
+	// Items that only exist in the destination should be left alone.
+	EXPECT_EQ(ReadFile(m_destination / L"Folder" / L"Existing.txt"), "existing");
+}
+
+TEST_F(BulkFileTransferTest, Resume)
+{
+	// This simulates a transfer that was interrupted after the first file had been copied and
+	// while the last file was being copied.
+	std::filesystem::create_directories(m_destination / L"Folder");
+	std::filesystem::copy_file(
+		m_source / L"Folder" / L"File1.txt", m_destination / L"Folder" / L"File1.txt");
+	WriteFile(m_destination / L"File3.txt", "th");
+
+	HRESULT hr = ResumeTransferFiles(GetSourcePaths(), m_destination.wstring(), false);
+	ASSERT_HRESULT_SUCCEEDED(hr);
+
+	EXPECT_EQ(ReadFile(m_destination / L"Folder" / L"File1.txt"), "first");
+	EXPECT_EQ(ReadFile(m_destination / L"Folder" / L"Subfolder" / L"File2.txt"), "second");
+	EXPECT_EQ(ReadFile(m_destination / L"File3.txt"), "third");
+}
+
+TEST_F(BulkFileTransferTest, StopWhilePaused)
+{
+	FileTransferThrottle throttle;
+	throttle.SetPaused(true);
+
+	std::stop_source stopSource;
+	std::jthread stopThread(
+		[&stopSource]
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+			stopSource.request_stop();
+		});
+
+	HRESULT hr = TransferFiles(GetSourcePaths(), m_destination.wstring(), false,
+		stopSource.get_token(), nullptr, &throttle);
+	EXPECT_EQ(hr, HRESULT_FROM_WIN32(ERROR_CANCELLED));
+
+	// No files should have been copied while the transfer was paused.
+	EXPECT_FALSE(std::filesystem::exists(m_destination / L"File3.txt"));
+}
+
+TEST_F(BulkFileTransferTest, Cancel)
+{
+	std::stop_source stopSource;
+	stopSource.request_stop();
+
+	HRESULT hr =
+		TransferFiles(GetSourcePaths(), m_destination.wstring(), false, stopSource.get_token());
+	EXPECT_EQ(hr, HRESULT_FROM_WIN32(ERROR_CANCELLED));
+}
\ No newline at end of file
@@ -4,85 +4,134 @@
 
 #include "../Helper/CachedIcons.h"
 #include <gtest/gtest.h>
+#include <thread>
 
-TEST(CachedIconsTest, TestMaxSize)
+namespace
 {
-	CachedIcons cachedIcons(2);
 
-	CachedIcon cachedIcon;
-	cachedIcon.filePath = L"C:\\file1";
-	cachedIcon.iconIndex = 0;
-	cachedIcons.insert(cachedIcon);
+// All the paths used below are the same length, so each entry takes up the same amount of space.
+std::size_t GetCapacityForEntries(std::size_t numEntries)
+{
+	return numEntries * CachedIcons::getEntrySize(L"C:\\file1");
+}
 
-	cachedIcon.filePath = L"C:\\file2";
-	cachedIcon.iconIndex = 0;
-	cachedIcons.insert(cachedIcon);
+}
 
-	auto itr = cachedIcons.findByPath(L"C:\\file1");
-	EXPECT_TRUE(itr != cachedIcons.end());
+TEST(CachedIconsTest, TestMaxSize)
+{
+	CachedIcons cachedIcons(GetCapacityForEntries(2), 1);
 
-	cachedIcon.filePath = L"C:\\file3";
-	cachedIcon.iconIndex = 0;
-	cachedIcons.insert(cachedIcon);
+	cachedIcons.addOrUpdateFileIcon(L"C:\\file1", 0);
+	cachedIcons.addOrUpdateFileIcon(L"C:\\file2", 0);
+	EXPECT_EQ(cachedIcons.getSizeInBytes(), GetCapacityForEntries(2));
+
+	cachedIcons.addOrUpdateFileIcon(L"C:\\file3", 0);
 
 	// The cache can hold a maximum of 2 icons, so the addition of the third
 	// icon above should have pushed out the oldest item.
-	itr = cachedIcons.findByPath(L"C:\\file1");
-	EXPECT_TRUE(itr == cachedIcons.end());
+	EXPECT_FALSE(cachedIcons.findByPath(L"C:\\file1"));
 
 	// But the second item should still be there.
-	itr = cachedIcons.findByPath(L"C:\\file2");
-	EXPECT_TRUE(itr != cachedIcons.end());
+	EXPECT_TRUE(cachedIcons.findByPath(L"C:\\file2"));
+	EXPECT_EQ(cachedIcons.getSizeInBytes(), GetCapacityForEntries(2));
 }
 
 TEST(CachedIconsTest, TestLookup)
 {
-	CachedIcons cachedIcons(2);
-
-	CachedIcon cachedIcon;
-	cachedIcon.filePath = L"C:\\file1";
-	cachedIcon.iconIndex = 0;
-	cachedIcons.insert(cachedIcon);
+	CachedIcons cachedIcons(GetCapacityForEntries(2), 1);
 
-	auto itr = cachedIcons.findByPath(L"C:\\file1");
-	EXPECT_TRUE(itr != cachedIcons.end());
+	cachedIcons.addOrUpdateFileIcon(L"C:\\file1", 7);
 
-	itr = cachedIcons.findByPath(L"C:\\non-existent");
-	EXPECT_TRUE(itr == cachedIcons.end());
+	EXPECT_EQ(cachedIcons.findByPath(L"C:\\file1"), 7);
+	EXPECT_FALSE(cachedIcons.findByPath(L"C:\\non-existent"));
 }
 
 TEST(CachedIconsTest, TestReplace)
 {
-	CachedIcons cachedIcons(2);
-
-	CachedIcon cachedIcon;
-	cachedIcon.filePath = L"C:\\file1";
-	cachedIcon.iconIndex = 0;
-	cachedIcons.insert(cachedIcon);
+	CachedIcons cachedIcons(GetCapacityForEntries(2), 1);
 
-	cachedIcon.filePath = L"C:\\file2";
-	cachedIcon.iconIndex = 0;
-	cachedIcons.insert(cachedIcon);
+	cachedIcons.addOrUpdateFileIcon(L"C:\\file1", 0);
+	cachedIcons.addOrUpdateFileIcon(L"C:\\file2", 0);
+	cachedIcons.addOrUpdateFileIcon(L"C:\\file1", 1);
 
-	auto itr = cachedIcons.findByPath(L"C:\\file1");
-	cachedIcon = *itr;
-	cachedIcon.iconIndex = 1;
-	cachedIcons.replace(itr, cachedIcon);
+	EXPECT_EQ(cachedIcons.findByPath(L"C:\\file1"), 1);
 
-	itr = cachedIcons.findByPath(L"C:\\file1");
-	EXPECT_EQ(itr->iconIndex, 1);
+	// Replacing an item doesn't add a new entry.
+	EXPECT_EQ(cachedIcons.getSizeInBytes(), GetCapacityForEntries(2));
 
-	cachedIcon.filePath = L"C:\\file3";
-	cachedIcon.iconIndex = 0;
-	cachedIcons.insert(cachedIcon);
+	cachedIcons.addOrUpdateFileIcon(L"C:\\file3", 0);
 
-	// Replacing the item above should have moved it to the front of the
-	// list. This means that when the third item was inserted, the
-	// second item is what should have been removed.
-	itr = cachedIcons.findByPath(L"C:\\file2");
-	EXPECT_TRUE(itr == cachedIcons.end());
+	// Replacing the item above should have marked it as recently used. This
+	// means that when the third item was inserted, the second item is what
+	// should have been removed.
+	EXPECT_FALSE(cachedIcons.findByPath(L"C:\\file2"));
 
 	// The replaced item should still exist.
-	itr = cachedIcons.findByPath(L"C:\\file1");
-	EXPECT_TRUE(itr != cachedIcons.end());
+	EXPECT_TRUE(cachedIcons.findByPath(L"C:\\file1"));
+}
+
+TEST(CachedIconsTest, TestLookupMarksRecentlyUsed)
+{
+	CachedIcons cachedIcons(GetCapacityForEntries(2), 1);
+
+	cachedIcons.addOrUpdateFileIcon(L"C:\\file1", 0);
+	cachedIcons.addOrUpdateFileIcon(L"C:\\file2", 0);
+
+	EXPECT_TRUE(cachedIcons.findByPath(L"C:\\file1"));
+
+	cachedIcons.addOrUpdateFileIcon(L"C:\\file3", 0);
+
+	// The first item was looked up more recently than the second, so the second is evicted.
+	EXPECT_TRUE(cachedIcons.findByPath(L"C:\\file1"));
+	EXPECT_FALSE(cachedIcons.findByPath(L"C:\\file2"));
+	EXPECT_TRUE(cachedIcons.findByPath(L"C:\\file3"));
+}
+
+TEST(CachedIconsTest, TestConcurrentAccess)
+{
+	const int numThreads = 4;
+	const int numPathsPerThread = 1000;
+
+	CachedIcons cachedIcons(GetCapacityForEntries(numThreads * numPathsPerThread) * 2);
+	std::vector<std::thread> threads;
+
+	for (int i = 0; i < numThreads; i++)
+	{
+		threads.emplace_back([&cachedIcons, i]() {
+			for (int j = 0; j < numPathsPerThread; j++)
+			{
+				std::wstring path = L"C:\\" + std::to_wstring(i) + L"\\" + std::to_wstring(j);
+				cachedIcons.addOrUpdateFileIcon(path, j);
+				EXPECT_EQ(cachedIcons.findByPath(path), j);
+			}
+		});
+	}
+
+	for (auto &thread : threads)
+	{
+		thread.join();
+	}
+
+	EXPECT_EQ(cachedIcons.findByPath(L"C:\\2\\500"), 500);
+}
+
+TEST(CachedIconsTest, TestTrimToSize)
+{
+	CachedIcons cachedIcons(GetCapacityForEntries(4), 1);
+
+	cachedIcons.addOrUpdateFileIcon(L"C:\\file1", 0);
+	cachedIcons.addOrUpdateFileIcon(L"C:\\file2", 0);
+	cachedIcons.addOrUpdateFileIcon(L"C:\\file3", 0);
+
+	cachedIcons.trimToSize(GetCapacityForEntries(1));
+	EXPECT_EQ(cachedIcons.getSizeInBytes(), GetCapacityForEntries(1));
+	EXPECT_FALSE(cachedIcons.findByPath(L"C:\\file1"));
+	EXPECT_FALSE(cachedIcons.findByPath(L"C:\\file2"));
+	EXPECT_TRUE(cachedIcons.findByPath(L"C:\\file3"));
+
+	// The cache can still grow back to its original capacity.
+	cachedIcons.addOrUpdateFileIcon(L"C:\\file4", 0);
+	cachedIcons.addOrUpdateFileIcon(L"C:\\file5", 0);
+	cachedIcons.addOrUpdateFileIcon(L"C:\\file6", 0);
+	EXPECT_EQ(cachedIcons.getSizeInBytes(), GetCapacityForEntries(4));
 }
\ No newline at end of file
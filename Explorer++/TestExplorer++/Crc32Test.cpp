@@ -0,0 +1,86 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/Crc32.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+uint32_t CalculateCrc(const void *data, size_t size)
+{
+	Crc32 crc;
+	crc.Update(data, size);
+	return crc.GetValue();
+}
+
+// A straightforward bit-at-a-time implementation, used to check the table-based one.
+uint32_t CalculateReferenceCrc(const std::vector<uint8_t> &data)
+{
+	uint32_t crc = 0xFFFFFFFF;
+
+	for (uint8_t byte : data)
+	{
+		crc ^= byte;
+
+		for (int bit = 0; bit < 8; bit++)
+		{
+			crc = (crc & 1) ? ((crc >> 1) ^ 0xEDB88320) : (crc >> 1);
+		}
+	}
+
+	return ~crc;
+}
+
+}
+
+TEST(Crc32Test, KnownValues)
+{
+	EXPECT_EQ(CalculateCrc("", 0), 0x00000000U);
+
+	std::string check = "123456789";
+	EXPECT_EQ(CalculateCrc(check.data(), check.size()), 0xCBF43926U);
+
+	std::string text = "The quick brown fox jumps over the lazy dog";
+	EXPECT_EQ(CalculateCrc(text.data(), text.size()), 0x414FA339U);
+}
+
+TEST(Crc32Test, MatchesReference)
+{
+	std::vector<uint8_t> data;
+
+	for (size_t i = 0; i < 1000; i++)
+	{
+		EXPECT_EQ(CalculateCrc(data.data(), data.size()), CalculateReferenceCrc(data));
+
+		data.push_back(static_cast<uint8_t>((i * 7919) ^ (i >> 3)));
+	}
+}
+
+TEST(Crc32Test, Incremental)
+{
+	std::vector<uint8_t> data(5000);
+
+	for (size_t i = 0; i < data.size(); i++)
+	{
+		data[i] = static_cast<uint8_t>(i * 31 + 17);
+	}
+
+	uint32_t expected = CalculateCrc(data.data(), data.size());
+
+	for (size_t blockSize : { 1, 3, 8, 13, 64, 4999 })
+	{
+		Crc32 crc;
+
+		for (size_t offset = 0; offset < data.size(); offset += blockSize)
+		{
+			crc.Update(data.data() + offset, (std::min)(blockSize, data.size() - offset));
+		}
+
+		EXPECT_EQ(crc.GetValue(), expected);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,139 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/DelayedRenderDataObject.h"
+#include "../Helper/DataExchangeHelper.h"
+#include "../Helper/DragDropHelper.h"
+#include "../Helper/Macros.h"
+#include "../Helper/ShellHelper.h"
+#include "../Helper/TransferItemsSource.h"
+#include <gtest/gtest.h>
+#include <wil/com.h>
+#include <wil/resource.h>
+#include <filesystem>
+
+using namespace testing;
+
+class DelayedRenderDataObjectTest : public Test
+{
+protected:
+	DelayedRenderDataObjectTest()
+	{
+		auto tempDirectory = std::filesystem::temp_directory_path();
+		m_paths = { tempDirectory.wstring(), tempDirectory.parent_path().wstring() };
+
+		for (const auto &path : m_paths)
+		{
+			unique_pidl_absolute pidl;
+			HRESULT hr = SHParseDisplayName(path.c_str(), nullptr, wil::out_param(pidl), 0, nullptr);
+			EXPECT_HRESULT_SUCCEEDED(hr);
+
+			m_pidls.push_back(std::move(pidl));
+		}
+	}
+
+	wil::com_ptr_nothrow<IDataObject> CreateDataObject(size_t numItems)
+	{
+		std::vector<PCIDLIST_ABSOLUTE> items;
+
+		for (size_t i = 0; i < numItems; i++)
+		{
+			items.push_back(m_pidls[i].get());
+		}
+
+		wil::com_ptr_nothrow<IDataObject> dataObject;
+		EXPECT_HRESULT_SUCCEEDED(CreateDelayedRenderDataObjectForShellTransfer(items, &dataObject));
+		return dataObject;
+	}
+
+	std::vector<std::wstring> m_paths;
+	std::vector<unique_pidl_absolute> m_pidls;
+};
+
+TEST_F(DelayedRenderDataObjectTest, Hdrop)
+{
+	auto dataObject = CreateDataObject(m_pidls.size());
+
+	FORMATETC formatEtc = { CF_HDROP, nullptr, DVASPECT_CONTENT, -1, TYMED_HGLOBAL };
+	wil::unique_stg_medium stgMedium;
+	ASSERT_HRESULT_SUCCEEDED(dataObject->GetData(&formatEtc, &stgMedium));
+
+	auto drop = static_cast<HDROP>(stgMedium.hGlobal);
+	ASSERT_EQ(DragQueryFile(drop, 0xFFFFFFFF, nullptr, 0), m_paths.size());
+
+	for (UINT i = 0; i < m_paths.size(); i++)
+	{
+		TCHAR path[MAX_PATH];
+		DragQueryFile(drop, i, path, SIZEOF_ARRAY(path));
+		EXPECT_EQ(_wcsicmp(path, m_paths[i].c_str()), 0);
+	}
+}
+
+TEST_F(DelayedRenderDataObjectTest, ShellIdList)
+{
+	auto dataObject = CreateDataObject(m_pidls.size());
+
+	FORMATETC formatEtc = { static_cast<CLIPFORMAT>(RegisterClipboardFormat(CFSTR_SHELLIDLIST)),
+		nullptr, DVASPECT_CONTENT, -1, TYMED_HGLOBAL };
+	wil::unique_stg_medium stgMedium;
+	ASSERT_HRESULT_SUCCEEDED(dataObject->GetData(&formatEtc, &stgMedium));
+
+	wil::unique_hglobal_locked lock(stgMedium.hGlobal);
+	auto *cida = static_cast<CIDA *>(lock.get());
+	ASSERT_EQ(cida->cidl, m_pidls.size());
+
+	auto *parent = reinterpret_cast<PCIDLIST_ABSOLUTE>(
+		reinterpret_cast<const BYTE *>(cida) + cida->aoffset[0]);
+
+	for (UINT i = 0; i < cida->cidl; i++)
+	{
+		auto *child = reinterpret_cast<PCUIDLIST_RELATIVE>(
+			reinterpret_cast<const BYTE *>(cida) + cida->aoffset[i + 1]);
+
+		unique_pidl_absolute combined(ILCombine(parent, child));
+		EXPECT_TRUE(ILIsEqual(combined.get(), m_pidls[i].get()));
+	}
+}
+
+TEST_F(DelayedRenderDataObjectTest, TransferItems)
+{
+	auto dataObject = CreateDataObject(m_pidls.size());
+
+	wil::com_ptr_nothrow<ITransferItemsSource> transferItemsSource;
+	ASSERT_HRESULT_SUCCEEDED(dataObject->QueryInterface(IID_PPV_ARGS(&transferItemsSource)));
+
+	const auto &items = transferItemsSource->GetTransferItems();
+	ASSERT_EQ(items.size(), m_pidls.size());
+
+	for (size_t i = 0; i < items.size(); i++)
+	{
+		EXPECT_TRUE(ILIsEqual(items[i].get(), m_pidls[i].get()));
+	}
+}
+
+TEST_F(DelayedRenderDataObjectTest, ExtraFormats)
+{
+	auto dataObject = CreateDataObject(1);
+
+	ASSERT_HRESULT_SUCCEEDED(SetPreferredDropEffect(dataObject.get(), DROPEFFECT_MOVE));
+
+	FORMATETC formatEtc = { static_cast<CLIPFORMAT>(
+								RegisterClipboardFormat(CFSTR_PREFERREDDROPEFFECT)),
+		nullptr, DVASPECT_CONTENT, -1, TYMED_HGLOBAL };
+	EXPECT_HRESULT_SUCCEEDED(dataObject->QueryGetData(&formatEtc));
+
+	wil::com_ptr_nothrow<IEnumFORMATETC> enumerator;
+	ASSERT_HRESULT_SUCCEEDED(dataObject->EnumFormatEtc(DATADIR_GET, &enumerator));
+
+	std::vector<CLIPFORMAT> formats;
+	FORMATETC currentFormat;
+
+	while (enumerator->Next(1, &currentFormat, nullptr) == S_OK)
+	{
+		formats.push_back(currentFormat.cfFormat);
+	}
+
+	EXPECT_NE(std::find(formats.begin(), formats.end(), CF_HDROP), formats.end());
+	EXPECT_NE(std::find(formats.begin(), formats.end(), formatEtc.cfFormat), formats.end());
+}
\ No newline at end of file
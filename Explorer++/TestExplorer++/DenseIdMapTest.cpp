@@ -0,0 +1,97 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/DenseIdMap.h"
+#include <gtest/gtest.h>
+#include <string>
+
+TEST(DenseIdMapTest, InsertAndGet)
+{
+	DenseIdMap<std::wstring> map;
+	map.Insert(0, L"first");
+	map.Insert(1, L"second");
+
+	EXPECT_EQ(map.Size(), 2U);
+	EXPECT_EQ(map.Get(0), L"first");
+	EXPECT_EQ(map.Get(1), L"second");
+
+	map.Get(1) = L"updated";
+	EXPECT_EQ(map.Get(1), L"updated");
+}
+
+TEST(DenseIdMapTest, MissingIds)
+{
+	DenseIdMap<std::wstring> map;
+	map.Insert(2, L"item");
+
+	EXPECT_TRUE(map.Contains(2));
+	EXPECT_FALSE(map.Contains(0));
+	EXPECT_FALSE(map.Contains(3));
+	EXPECT_FALSE(map.Contains(-1));
+
+	EXPECT_EQ(map.Find(1), nullptr);
+	EXPECT_THROW(map.Get(1), std::out_of_range);
+	EXPECT_THROW(map.Get(10), std::out_of_range);
+}
+
+TEST(DenseIdMapTest, Erase)
+{
+	DenseIdMap<std::wstring> map;
+	map.Insert(0, L"first");
+	map.Insert(1, L"second");
+
+	map.Erase(0);
+	EXPECT_FALSE(map.Contains(0));
+	EXPECT_TRUE(map.Contains(1));
+	EXPECT_EQ(map.Size(), 1U);
+
+	// Erasing an ID that isn't in use should have no effect.
+	map.Erase(0);
+	map.Erase(5);
+	EXPECT_EQ(map.Size(), 1U);
+
+	map.Clear();
+	EXPECT_EQ(map.Size(), 0U);
+	EXPECT_FALSE(map.Contains(1));
+}
+
+TEST(DenseIdMapTest, ReferencesRemainValid)
+{
+	DenseIdMap<std::wstring> map;
+	std::wstring &value = map.Insert(0, L"first");
+
+	for (int i = 1; i < 100; i++)
+	{
+		map.Insert(i, std::to_wstring(i));
+	}
+
+	EXPECT_EQ(&value, &map.Get(0));
+}
+
+TEST(DenseIdMapTest, Iteration)
+{
+	DenseIdMap<std::wstring> map;
+	map.Insert(1, L"a");
+	map.Insert(3, L"b");
+	map.Insert(4, L"c");
+	map.Erase(4);
+
+	std::vector<std::pair<int, std::wstring>> items;
+
+	for (const auto &[id, value] : std::as_const(map))
+	{
+		items.emplace_back(id, value);
+	}
+
+	std::vector<std::pair<int, std::wstring>> expected = { { 1, L"a" }, { 3, L"b" } };
+	EXPECT_EQ(items, expected);
+
+	for (auto [id, value] : map)
+	{
+		value += L"!";
+	}
+
+	EXPECT_EQ(map.Get(1), L"a!");
+	EXPECT_EQ(map.Get(3), L"b!");
+}
\ No newline at end of file
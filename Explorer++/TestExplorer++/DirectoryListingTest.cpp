@@ -0,0 +1,95 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/DirectoryListing.h"
+#include <gtest/gtest.h>
+
+using Format = DirectoryListingFormatter::Format;
+
+namespace
+{
+
+std::wstring FormatListing(
+	Format format, std::initializer_list<DirectoryListingFormatter::Entry> entries)
+{
+	std::wstring output;
+	DirectoryListingFormatter formatter(
+		format, [&output](std::wstring_view text) { output += text; });
+
+	formatter.Begin(L"C:\\Test", L"Now");
+
+	for (const auto &entry : entries)
+	{
+		formatter.AddEntry(entry);
+	}
+
+	formatter.End();
+
+	return output;
+}
+
+}
+
+TEST(DirectoryListingTest, EscapeCsvField)
+{
+	EXPECT_EQ(DirectoryListingFormatter::EscapeCsvField(L"plain.txt"), L"plain.txt");
+	EXPECT_EQ(DirectoryListingFormatter::EscapeCsvField(L"a,b.txt"), L"\"a,b.txt\"");
+	EXPECT_EQ(DirectoryListingFormatter::EscapeCsvField(L"say \"hi\""), L"\"say \"\"hi\"\"\"");
+	EXPECT_EQ(DirectoryListingFormatter::EscapeCsvField(L""), L"");
+}
+
+TEST(DirectoryListingTest, EscapeJsonString)
+{
+	EXPECT_EQ(DirectoryListingFormatter::EscapeJsonString(L"dir\\file"), L"dir\\\\file");
+	EXPECT_EQ(DirectoryListingFormatter::EscapeJsonString(L"\"quoted\""), L"\\\"quoted\\\"");
+	EXPECT_EQ(DirectoryListingFormatter::EscapeJsonString(L"a\tb\x01"), L"a\\tb\\u0001");
+}
+
+TEST(DirectoryListingTest, Csv)
+{
+	auto output = FormatListing(Format::Csv,
+		{ { L"Folder", true, 0, L"2024-01-02T03:04:05Z" },
+			{ L"Folder\\a,b.txt", false, 1234, L"2024-01-02T03:04:06Z" } });
+
+	EXPECT_EQ(output,
+		L"Path,Type,Size,Date Modified\r\n"
+		L"Folder,folder,0,2024-01-02T03:04:05Z\r\n"
+		L"\"Folder\\a,b.txt\",file,1234,2024-01-02T03:04:06Z\r\n");
+}
+
+TEST(DirectoryListingTest, Json)
+{
+	auto output = FormatListing(Format::Json,
+		{ { L"Folder", true, 0, L"2024-01-02T03:04:05Z" },
+			{ L"Folder\\file.txt", false, 10, L"2024-01-02T03:04:06Z" },
+			{ L"other.txt", false, 20, L"2024-01-02T03:04:07Z" } });
+
+	EXPECT_EQ(output,
+		L"{\r\n"
+		L"\t\"directory\": \"C:\\\\Test\",\r\n"
+		L"\t\"date\": \"Now\",\r\n"
+		L"\t\"items\": [\r\n"
+		L"\t\t{ \"path\": \"Folder\", \"type\": \"folder\", \"size\": 0, "
+		L"\"dateModified\": \"2024-01-02T03:04:05Z\" },\r\n"
+		L"\t\t{ \"path\": \"Folder\\\\file.txt\", \"type\": \"file\", \"size\": 10, "
+		L"\"dateModified\": \"2024-01-02T03:04:06Z\" },\r\n"
+		L"\t\t{ \"path\": \"other.txt\", \"type\": \"file\", \"size\": 20, "
+		L"\"dateModified\": \"2024-01-02T03:04:07Z\" }\r\n"
+		L"\t],\r\n"
+		L"\t\"statistics\": { \"folders\": 1, \"files\": 2, \"totalSize\": 30 }\r\n"
+		L"}\r\n");
+}
+
+TEST(DirectoryListingTest, JsonEmpty)
+{
+	auto output = FormatListing(Format::Json, {});
+
+	EXPECT_EQ(output,
+		L"{\r\n"
+		L"\t\"directory\": \"C:\\\\Test\",\r\n"
+		L"\t\"date\": \"Now\",\r\n"
+		L"\t\"items\": [],\r\n"
+		L"\t\"statistics\": { \"folders\": 0, \"files\": 0, \"totalSize\": 0 }\r\n"
+		L"}\r\n");
+}
\ No newline at end of file
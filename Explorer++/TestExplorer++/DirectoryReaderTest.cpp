@@ -0,0 +1,124 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/DirectoryReader.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <map>
+
+using namespace testing;
+
+class DirectoryReaderTest : public Test
+{
+protected:
+	struct Entry
+	{
+		WIN32_FIND_DATA findData;
+		ULONGLONG fileId;
+	};
+
+	void SetUp() override
+	{
+		m_root = std::filesystem::temp_directory_path()
+			/ (L"DirectoryReaderTest" + std::to_wstring(GetCurrentProcessId()));
+		std::filesystem::create_directories(m_root / L"Folder");
+	}
+
+	void TearDown() override
+	{
+		std::filesystem::remove_all(m_root);
+	}
+
+	static void WriteFile(const std::filesystem::path &path, const std::string &contents)
+	{
+		std::ofstream stream(path, std::ios::binary);
+		stream << contents;
+	}
+
+	std::map<std::wstring, Entry> ReadEntries()
+	{
+		std::map<std::wstring, Entry> entries;
+		DirectoryReader reader(m_root.wstring());
+		EXPECT_TRUE(reader.IsOpen());
+
+		Entry entry;
+
+		while (reader.Next(entry.findData, entry.fileId))
+		{
+			entries.emplace(entry.findData.cFileName, entry);
+		}
+
+		EXPECT_EQ(reader.GetError(), static_cast<DWORD>(ERROR_NO_MORE_FILES));
+
+		return entries;
+	}
+
+	std::filesystem::path m_root;
+};
+
+TEST_F(DirectoryReaderTest, ReadEntries)
+{
+	WriteFile(m_root / L"File.txt", "contents");
+
+	auto entries = ReadEntries();
+
+	ASSERT_TRUE(entries.contains(L"File.txt"));
+	const auto &file = entries[L"File.txt"].findData;
+	EXPECT_EQ(file.nFileSizeLow, 8u);
+	EXPECT_EQ(file.nFileSizeHigh, 0u);
+	EXPECT_TRUE(WI_IsFlagClear(file.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY));
+
+	ASSERT_TRUE(entries.contains(L"Folder"));
+	EXPECT_TRUE(
+		WI_IsFlagSet(entries[L"Folder"].findData.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY));
+}
+
+TEST_F(DirectoryReaderTest, FileIdSurvivesRename)
+{
+	WriteFile(m_root / L"Original.txt", "contents");
+
+	auto entries = ReadEntries();
+	ASSERT_TRUE(entries.contains(L"Original.txt"));
+	ULONGLONG fileId = entries[L"Original.txt"].fileId;
+
+	if (fileId == DirectoryReader::UNKNOWN_FILE_ID)
+	{
+		GTEST_SKIP() << "The temporary directory isn't on a volume with stable file IDs";
+	}
+
+	EXPECT_NE(fileId, entries[L"Folder"].fileId);
+
+	std::filesystem::rename(m_root / L"Original.txt", m_root / L"Renamed.txt");
+
+	entries = ReadEntries();
+	EXPECT_FALSE(entries.contains(L"Original.txt"));
+	ASSERT_TRUE(entries.contains(L"Renamed.txt"));
+	EXPECT_EQ(entries[L"Renamed.txt"].fileId, fileId);
+}
+
+TEST_F(DirectoryReaderTest, MissingDirectory)
+{
+	DirectoryReader reader((m_root / L"Missing").wstring());
+	EXPECT_FALSE(reader.IsOpen());
+
+	WIN32_FIND_DATA findData;
+	ULONGLONG fileId;
+	EXPECT_FALSE(reader.Next(findData, fileId));
+}
+
+TEST(DirectoryReaderFileIdTest, InvalidIds)
+{
+	constexpr ULONGLONG unknownId = DirectoryReader::UNKNOWN_FILE_ID;
+	LARGE_INTEGER fileId;
+
+	fileId.QuadPart = 0;
+	EXPECT_EQ(DirectoryReader::GetFileIdFromLargeInteger(fileId), unknownId);
+
+	fileId.QuadPart = -1;
+	EXPECT_EQ(DirectoryReader::GetFileIdFromLargeInteger(fileId), unknownId);
+
+	fileId.QuadPart = 0x0001000000001234;
+	EXPECT_EQ(DirectoryReader::GetFileIdFromLargeInteger(fileId), 0x0001000000001234ull);
+}
\ No newline at end of file
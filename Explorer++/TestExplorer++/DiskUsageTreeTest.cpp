@@ -0,0 +1,101 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/DiskUsageTree.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+using namespace testing;
+
+class DiskUsageTreeTest : public Test
+{
+protected:
+	void SetUp() override
+	{
+		m_root = std::filesystem::temp_directory_path()
+			/ (L"DiskUsageTreeTest" + std::to_wstring(GetCurrentProcessId()));
+		std::filesystem::create_directories(m_root / L"Folder1" / L"Nested");
+		std::filesystem::create_directories(m_root / L"Folder2");
+	}
+
+	void TearDown() override
+	{
+		std::filesystem::remove_all(m_root);
+	}
+
+	static void WriteFile(const std::filesystem::path &path, size_t size)
+	{
+		std::ofstream stream(path, std::ios::binary);
+		stream << std::string(size, 'a');
+	}
+
+	static const DiskUsageNode *FindChild(const DiskUsageNode &node, const std::wstring &name)
+	{
+		auto itr = std::find_if(node.children.begin(), node.children.end(),
+			[&name](const auto &child) { return child->name == name; });
+
+		if (itr == node.children.end())
+		{
+			return nullptr;
+		}
+
+		return itr->get();
+	}
+
+	std::filesystem::path m_root;
+};
+
+TEST_F(DiskUsageTreeTest, Sizes)
+{
+	WriteFile(m_root / L"File.txt", 10);
+	WriteFile(m_root / L"Folder1" / L"File.txt", 20);
+	WriteFile(m_root / L"Folder1" / L"Nested" / L"File1.txt", 30);
+	WriteFile(m_root / L"Folder1" / L"Nested" / L"File2.txt", 40);
+
+	DiskUsageTree tree(m_root.wstring());
+	tree.Build();
+	EXPECT_TRUE(tree.IsComplete());
+
+	tree.Read([this, &tree](const DiskUsageNode &root) {
+		EXPECT_TRUE(root.visited);
+		EXPECT_EQ(root.filesSize, 10U);
+		EXPECT_EQ(root.numFiles, 1);
+		EXPECT_EQ(root.totalSize, 100U);
+		ASSERT_EQ(root.children.size(), 2U);
+
+		const auto *folder1 = FindChild(root, L"Folder1");
+		ASSERT_NE(folder1, nullptr);
+		EXPECT_EQ(folder1->filesSize, 20U);
+		EXPECT_EQ(folder1->totalSize, 90U);
+		EXPECT_EQ(folder1->parent, &root);
+
+		const auto *nested = FindChild(*folder1, L"Nested");
+		ASSERT_NE(nested, nullptr);
+		EXPECT_EQ(nested->numFiles, 2);
+		EXPECT_EQ(nested->totalSize, 70U);
+		EXPECT_EQ(tree.GetPath(*nested), (m_root / L"Folder1" / L"Nested").wstring());
+
+		const auto *folder2 = FindChild(root, L"Folder2");
+		ASSERT_NE(folder2, nullptr);
+		EXPECT_TRUE(folder2->visited);
+		EXPECT_EQ(folder2->totalSize, 0U);
+		EXPECT_TRUE(folder2->children.empty());
+
+		EXPECT_EQ(tree.GetPath(root), m_root.wstring());
+	});
+}
+
+TEST_F(DiskUsageTreeTest, Stop)
+{
+	WriteFile(m_root / L"Folder1" / L"File.txt", 20);
+
+	std::stop_source stopSource;
+	stopSource.request_stop();
+
+	DiskUsageTree tree(m_root.wstring());
+	tree.Build(stopSource.get_token());
+	EXPECT_FALSE(tree.IsComplete());
+}
\ No newline at end of file
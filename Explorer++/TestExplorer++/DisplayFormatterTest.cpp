@@ -0,0 +1,163 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/DisplayFormatter.h"
+#include <gtest/gtest.h>
+
+using namespace testing;
+
+class DisplayFormatterTest : public Test
+{
+protected:
+	static DisplayFormatter::LocaleFormat GetTestLocaleFormat()
+	{
+		DisplayFormatter::LocaleFormat localeFormat;
+		localeFormat.timeFormat = L"h:mm:ss tt";
+		localeFormat.amDesignator = L"AM";
+		localeFormat.pmDesignator = L"PM";
+		localeFormat.decimalSeparator = L".";
+		localeFormat.thousandSeparator = L",";
+		localeFormat.grouping = { 3 };
+		localeFormat.repeatLastGroup = true;
+		return localeFormat;
+	}
+
+	static SYSTEMTIME MakeTime(WORD hour, WORD minute, WORD second)
+	{
+		SYSTEMTIME systemTime = {};
+		systemTime.wYear = 2020;
+		systemTime.wMonth = 6;
+		systemTime.wDay = 15;
+		systemTime.wHour = hour;
+		systemTime.wMinute = minute;
+		systemTime.wSecond = second;
+		return systemTime;
+	}
+};
+
+TEST_F(DisplayFormatterTest, FormatSize)
+{
+	DisplayFormatter formatter(GetTestLocaleFormat());
+
+	EXPECT_EQ(formatter.FormatSize(0), L"0 bytes");
+	EXPECT_EQ(formatter.FormatSize(1), L"1 bytes");
+	EXPECT_EQ(formatter.FormatSize(1023), L"1,023 bytes");
+	EXPECT_EQ(formatter.FormatSize(1024), L"1.00 KB");
+	EXPECT_EQ(formatter.FormatSize(1536), L"1.50 KB");
+	EXPECT_EQ(formatter.FormatSize(1024 * 1024 * 2), L"2.00 MB");
+	EXPECT_EQ(formatter.FormatSize(48169402368), L"44.8 GB");
+	EXPECT_EQ(formatter.FormatSize(517637815320), L"482 GB");
+	EXPECT_EQ(formatter.FormatSize(1000202039296), L"931 GB");
+
+	// The fraction is truncated, rather than rounded.
+	EXPECT_EQ(formatter.FormatSize(2047), L"1.99 KB");
+
+	// Sizes of 1024 PB and above can't be shown in any of the units.
+	EXPECT_EQ(formatter.FormatSize(1ULL << 60), L"");
+}
+
+TEST_F(DisplayFormatterTest, FormatSizeForced)
+{
+	DisplayFormatter formatter(GetTestLocaleFormat());
+
+	EXPECT_EQ(formatter.FormatSize(1234567, true, SizeDisplayFormat::Bytes), L"1,234,567 bytes");
+	EXPECT_EQ(formatter.FormatSize(512, true, SizeDisplayFormat::KB), L"0.50 KB");
+	EXPECT_EQ(formatter.FormatSize(1024 * 1024 * 1500, true, SizeDisplayFormat::MB), L"1,500 MB");
+	EXPECT_EQ(formatter.FormatSize(1024, true, SizeDisplayFormat::GB), L"0.00 GB");
+}
+
+TEST_F(DisplayFormatterTest, FormatNumber)
+{
+	auto localeFormat = GetTestLocaleFormat();
+	DisplayFormatter formatter(localeFormat);
+	EXPECT_EQ(formatter.FormatNumber(0), L"0");
+	EXPECT_EQ(formatter.FormatNumber(999), L"999");
+	EXPECT_EQ(formatter.FormatNumber(1234567890), L"1,234,567,890");
+
+	localeFormat.grouping = { 3, 2 };
+	DisplayFormatter variableGroupFormatter(localeFormat);
+	EXPECT_EQ(variableGroupFormatter.FormatNumber(123456789), L"12,34,56,789");
+
+	localeFormat.grouping = { 3 };
+	localeFormat.repeatLastGroup = false;
+	DisplayFormatter singleGroupFormatter(localeFormat);
+	EXPECT_EQ(singleGroupFormatter.FormatNumber(1234567), L"1234,567");
+
+	localeFormat.grouping = {};
+	DisplayFormatter ungroupedFormatter(localeFormat);
+	EXPECT_EQ(ungroupedFormatter.FormatNumber(1234567), L"1234567");
+}
+
+TEST_F(DisplayFormatterTest, FormatTime)
+{
+	auto localeFormat = GetTestLocaleFormat();
+	DisplayFormatter formatter(localeFormat);
+	EXPECT_EQ(formatter.FormatTime(MakeTime(13, 5, 9)), L"1:05:09 PM");
+	EXPECT_EQ(formatter.FormatTime(MakeTime(0, 0, 0)), L"12:00:00 AM");
+	EXPECT_EQ(formatter.FormatTime(MakeTime(11, 59, 59)), L"11:59:59 AM");
+
+	localeFormat.timeFormat = L"HH:mm t";
+	DisplayFormatter twentyFourHourFormatter(localeFormat);
+	EXPECT_EQ(twentyFourHourFormatter.FormatTime(MakeTime(9, 30, 0)), L"09:30 A");
+
+	localeFormat.timeFormat = L"'at' h 'o''clock'";
+	DisplayFormatter literalFormatter(localeFormat);
+	EXPECT_EQ(literalFormatter.FormatTime(MakeTime(15, 0, 0)), L"at 3 o'clock");
+}
+
+TEST_F(DisplayFormatterTest, ConvertToLocalTime)
+{
+	DisplayFormatter formatter(GetTestLocaleFormat());
+
+	SYSTEMTIME startTime = {};
+	startTime.wYear = 2018;
+	startTime.wMonth = 1;
+	startTime.wDay = 1;
+
+	FILETIME fileTime;
+	ASSERT_TRUE(SystemTimeToFileTime(&startTime, &fileTime));
+
+	ULARGE_INTEGER time;
+	time.LowPart = fileTime.dwLowDateTime;
+	time.HighPart = fileTime.dwHighDateTime;
+
+	// Steps through several years in increments that don't divide evenly into a day, so that times
+	// on either side of any daylight saving transitions are checked.
+	const ULONGLONG step = 97ULL * 60 * 10'000'000;
+
+	for (int i = 0; i < 5000; i++)
+	{
+		FILETIME utcTime = { time.LowPart, time.HighPart };
+
+		SYSTEMTIME systemTime;
+		SYSTEMTIME expectedLocalTime;
+		ASSERT_TRUE(FileTimeToSystemTime(&utcTime, &systemTime));
+		ASSERT_TRUE(SystemTimeToTzSpecificLocalTime(nullptr, &systemTime, &expectedLocalTime));
+
+		auto localTime = formatter.ConvertToLocalTime(utcTime);
+		ASSERT_TRUE(localTime);
+		EXPECT_EQ(memcmp(&*localTime, &expectedLocalTime, sizeof(SYSTEMTIME)), 0);
+
+		time.QuadPart += step;
+	}
+}
+
+TEST_F(DisplayFormatterTest, FormatSystemTime)
+{
+	DisplayFormatter formatter(GetTestLocaleFormat());
+
+	SYSTEMTIME localTime = MakeTime(13, 5, 9);
+
+	WCHAR expectedDate[256];
+	ASSERT_NE(GetDateFormat(LOCALE_USER_DEFAULT, LOCALE_USE_CP_ACP, &localTime, nullptr,
+				  expectedDate, static_cast<int>(std::size(expectedDate))),
+		0);
+
+	// The second call is answered from the cache.
+	for (int i = 0; i < 2; i++)
+	{
+		EXPECT_EQ(formatter.FormatSystemTime(localTime, false),
+			std::wstring(expectedDate) + L" 1:05:09 PM");
+	}
+}
\ No newline at end of file
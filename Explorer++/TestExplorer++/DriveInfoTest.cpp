@@ -0,0 +1,72 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/DriveInfo.h"
+#include "../Helper/UnbufferedIo.h"
+#include <gtest/gtest.h>
+
+using namespace std::chrono_literals;
+
+TEST(DriveInfoTest, RecommendedParallelism)
+{
+	auto rotational = GetRecommendedIoSettings(StorageKind::Rotational, BusTypeSata, std::nullopt);
+	auto sataSsd = GetRecommendedIoSettings(StorageKind::SolidState, BusTypeSata, std::nullopt);
+	auto nvme = GetRecommendedIoSettings(StorageKind::SolidState, BusTypeNvme, std::nullopt);
+	auto usbFlash = GetRecommendedIoSettings(StorageKind::SolidState, BusTypeUsb, std::nullopt);
+	auto usbUnknown = GetRecommendedIoSettings(StorageKind::Unknown, BusTypeUsb, std::nullopt);
+
+	EXPECT_EQ(rotational.parallelism, 1);
+	EXPECT_EQ(usbUnknown.parallelism, 1);
+	EXPECT_GT(sataSsd.parallelism, usbFlash.parallelism);
+	EXPECT_GT(nvme.parallelism, sataSsd.parallelism);
+}
+
+TEST(DriveInfoTest, RemoteLatency)
+{
+	auto local = GetRecommendedIoSettings(StorageKind::Remote, BusTypeUnknown, 300us);
+	auto distant = GetRecommendedIoSettings(StorageKind::Remote, BusTypeUnknown, 40ms);
+	auto unmeasured = GetRecommendedIoSettings(StorageKind::Remote, BusTypeUnknown, std::nullopt);
+
+	// More (and larger) requests are kept in flight as the latency increases.
+	EXPECT_GT(distant.parallelism, local.parallelism);
+	EXPECT_GT(distant.bufferSize, local.bufferSize);
+
+	EXPECT_EQ(unmeasured.parallelism, local.parallelism);
+	EXPECT_EQ(unmeasured.bufferSize, local.bufferSize);
+}
+
+TEST(DriveInfoTest, BufferSizeAlignment)
+{
+	for (auto kind : { StorageKind::Unknown, StorageKind::Rotational, StorageKind::SolidState,
+			 StorageKind::Remote })
+	{
+		for (auto busType : { BusTypeUnknown, BusTypeSata, BusTypeUsb, BusTypeNvme })
+		{
+			for (auto latency : { 0us, 500us, 50000us })
+			{
+				auto settings = GetRecommendedIoSettings(kind, busType, latency);
+
+				EXPECT_GT(settings.parallelism, 0);
+				EXPECT_GT(settings.bufferSize, 0U);
+				EXPECT_EQ(settings.bufferSize % UNBUFFERED_IO_ALIGNMENT, 0U);
+			}
+		}
+	}
+}
+
+TEST(DriveInfoTest, GetStorageInfo)
+{
+	wchar_t tempPath[MAX_PATH];
+	ASSERT_NE(GetTempPath(static_cast<DWORD>(std::size(tempPath)), tempPath), 0U);
+
+	auto storageInfo = GetStorageInfo(tempPath);
+	EXPECT_FALSE(storageInfo.diskId.empty());
+	EXPECT_GT(storageInfo.ioSettings.parallelism, 0);
+
+	// The result is cached, so a second query returns the same information.
+	auto cachedStorageInfo = GetStorageInfo(tempPath);
+	EXPECT_EQ(cachedStorageInfo.diskId, storageInfo.diskId);
+	EXPECT_EQ(cachedStorageInfo.kind, storageInfo.kind);
+	EXPECT_EQ(cachedStorageInfo.ioSettings.parallelism, storageInfo.ioSettings.parallelism);
+}
\ No newline at end of file
@@ -0,0 +1,123 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/DuplicateFinder.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+
+using namespace testing;
+
+class DuplicateFinderTest : public Test
+{
+protected:
+	void SetUp() override
+	{
+		m_root = std::filesystem::temp_directory_path()
+			/ (L"DuplicateFinderTest" + std::to_wstring(GetCurrentProcessId()));
+		std::filesystem::create_directories(m_root / L"Folder");
+	}
+
+	void TearDown() override
+	{
+		std::filesystem::remove_all(m_root);
+	}
+
+	static void WriteFile(const std::filesystem::path &path, const std::string &contents)
+	{
+		std::ofstream stream(path, std::ios::binary);
+		stream << contents;
+	}
+
+	std::vector<DuplicateFileGroup> FindDuplicates(const std::vector<std::wstring> &folders)
+	{
+		std::vector<DuplicateFileGroup> groups;
+		HRESULT hr = FindDuplicateFiles(folders, groups);
+		EXPECT_HRESULT_SUCCEEDED(hr);
+		return groups;
+	}
+
+	std::vector<std::wstring> GetPaths(const std::vector<std::wstring> &names)
+	{
+		std::vector<std::wstring> paths;
+
+		for (const auto &name : names)
+		{
+			paths.push_back((m_root / name).wstring());
+		}
+
+		return paths;
+	}
+
+	std::filesystem::path m_root;
+};
+
+TEST_F(DuplicateFinderTest, SmallFiles)
+{
+	WriteFile(m_root / L"Copy1.txt", "contents");
+	WriteFile(m_root / L"Folder" / L"Copy2.txt", "contents");
+
+	// These are the same size as the files above, but have different contents.
+	WriteFile(m_root / L"Different.txt", "CONTENTS");
+
+	WriteFile(m_root / L"Unique.txt", "unique");
+
+	// Empty files are always identical, so they're ignored.
+	WriteFile(m_root / L"Empty1.txt", "");
+	WriteFile(m_root / L"Empty2.txt", "");
+
+	auto groups = FindDuplicates({ m_root.wstring() });
+	ASSERT_EQ(groups.size(), 1U);
+	EXPECT_EQ(groups[0].size, 8U);
+	EXPECT_EQ(groups[0].paths, GetPaths({ L"Copy1.txt", L"Folder\\Copy2.txt" }));
+}
+
+TEST_F(DuplicateFinderTest, LargeFiles)
+{
+	// These files share a prefix, so they can only be told apart by hashing them in full.
+	std::string prefix(64 * 1024, 'a');
+	WriteFile(m_root / L"Large1.bin", prefix + "end");
+	WriteFile(m_root / L"Large2.bin", prefix + "end");
+	WriteFile(m_root / L"Large3.bin", prefix + "END");
+
+	// Larger files are listed first.
+	WriteFile(m_root / L"Small1.txt", "small");
+	WriteFile(m_root / L"Small2.txt", "small");
+
+	auto groups = FindDuplicates({ m_root.wstring() });
+	ASSERT_EQ(groups.size(), 2U);
+	EXPECT_EQ(groups[0].paths, GetPaths({ L"Large1.bin", L"Large2.bin" }));
+	EXPECT_EQ(groups[1].paths, GetPaths({ L"Small1.txt", L"Small2.txt" }));
+}
+
+TEST_F(DuplicateFinderTest, OverlappingFolders)
+{
+	WriteFile(m_root / L"Folder" / L"File1.txt", "contents");
+	WriteFile(m_root / L"Folder" / L"File2.txt", "different");
+
+	// The files within the subfolder are found twice, but they shouldn't be reported as
+	// duplicates of themselves.
+	auto groups = FindDuplicates({ m_root.wstring(), (m_root / L"Folder").wstring() });
+	EXPECT_TRUE(groups.empty());
+}
+
+TEST_F(DuplicateFinderTest, InvalidFolder)
+{
+	std::vector<DuplicateFileGroup> groups;
+	HRESULT hr = FindDuplicateFiles({ (m_root / L"Missing").wstring() }, groups);
+	EXPECT_HRESULT_FAILED(hr);
+}
+
+TEST_F(DuplicateFinderTest, Cancel)
+{
+	WriteFile(m_root / L"Copy1.txt", "contents");
+	WriteFile(m_root / L"Copy2.txt", "contents");
+
+	std::stop_source stopSource;
+	stopSource.request_stop();
+
+	std::vector<DuplicateFileGroup> groups;
+	HRESULT hr = FindDuplicateFiles({ m_root.wstring() }, groups, stopSource.get_token());
+	EXPECT_EQ(hr, HRESULT_FROM_WIN32(ERROR_CANCELLED));
+}
\ No newline at end of file
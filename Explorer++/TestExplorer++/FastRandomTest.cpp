@@ -0,0 +1,60 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/FastRandom.h"
+#include <gtest/gtest.h>
+#include <array>
+#include <vector>
+
+TEST(FastRandomTest, Deterministic)
+{
+	std::vector<std::byte> first(1000);
+	FastRandom(42).Fill(first);
+
+	std::vector<std::byte> second(1000);
+	FastRandom(42).Fill(second);
+
+	EXPECT_EQ(first, second);
+
+	std::vector<std::byte> other(1000);
+	FastRandom(43).Fill(other);
+
+	EXPECT_NE(first, other);
+}
+
+TEST(FastRandomTest, Distribution)
+{
+	std::vector<std::byte> data(256 * 1024);
+	FastRandom(1).Fill(data);
+
+	std::array<size_t, 256> counts = {};
+
+	for (auto byte : data)
+	{
+		counts[static_cast<uint8_t>(byte)]++;
+	}
+
+	// Each value is expected to appear 1024 times. The bounds here are well over 10 standard
+	// deviations away from that.
+	for (size_t count : counts)
+	{
+		EXPECT_GT(count, 700U);
+		EXPECT_LT(count, 1350U);
+	}
+}
+
+TEST(FastRandomTest, PartialBlocks)
+{
+	FastRandom random(7);
+
+	for (size_t size : { 0, 1, 7, 31, 32, 33, 100 })
+	{
+		// The guard bytes on either side of the filled region shouldn't be touched.
+		std::vector<std::byte> data(size + 2, std::byte { 0xAB });
+		random.Fill(std::span(data).subspan(1, size));
+
+		EXPECT_EQ(data.front(), std::byte { 0xAB });
+		EXPECT_EQ(data.back(), std::byte { 0xAB });
+	}
+}
\ No newline at end of file
@@ -0,0 +1,148 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/FileHash.h"
+#include "../Helper/FileHashCache.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+
+using namespace testing;
+
+class FileHashTest : public Test
+{
+protected:
+	void SetUp() override
+	{
+		m_root = std::filesystem::temp_directory_path()
+			/ (L"FileHashTest" + std::to_wstring(GetCurrentProcessId()));
+		std::filesystem::create_directories(m_root);
+	}
+
+	void TearDown() override
+	{
+		FileHashCache::GetInstance().Clear();
+		std::filesystem::remove_all(m_root);
+	}
+
+	static void WriteFile(const std::filesystem::path &path, const std::string &contents)
+	{
+		std::ofstream stream(path, std::ios::binary);
+		stream << contents;
+	}
+
+	// Writes a file whose contents follow a simple repeating pattern.
+	static void WritePatternFile(const std::filesystem::path &path, size_t size)
+	{
+		std::string contents(size, '\0');
+
+		for (size_t i = 0; i < size; i++)
+		{
+			contents[i] = static_cast<char>(i % 251);
+		}
+
+		WriteFile(path, contents);
+	}
+
+	static std::wstring GetFormattedHash(const std::filesystem::path &path)
+	{
+		auto hash = CalculateFileHash(path);
+		EXPECT_TRUE(hash.has_value());
+
+		if (!hash)
+		{
+			return {};
+		}
+
+		return FormatFileHash(*hash);
+	}
+
+	std::filesystem::path m_root;
+};
+
+TEST_F(FileHashTest, SmallFiles)
+{
+	WriteFile(m_root / L"Empty.txt", "");
+	EXPECT_EQ(GetFormattedHash(m_root / L"Empty.txt"),
+		L"e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+
+	WriteFile(m_root / L"Abc.txt", "abc");
+	EXPECT_EQ(GetFormattedHash(m_root / L"Abc.txt"),
+		L"ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+}
+
+TEST_F(FileHashTest, LargeFiles)
+{
+	// A file that spans several read buffers, with a partial buffer at the end.
+	WritePatternFile(m_root / L"Large.bin", 10 * 1024 * 1024 + 123);
+	EXPECT_EQ(GetFormattedHash(m_root / L"Large.bin"),
+		L"890ffd33c0bed76c0006781d0fa68a6b3d8e865e4696e19aad8e45d0512ce6d9");
+
+	// A file that ends exactly on a buffer boundary.
+	WritePatternFile(m_root / L"Aligned.bin", 4 * 1024 * 1024);
+	EXPECT_EQ(GetFormattedHash(m_root / L"Aligned.bin"),
+		L"a117210941a0b00dcb2d8577e680d84b6fa0eaf760d2afc654c953b9859d54fa");
+}
+
+TEST_F(FileHashTest, MissingFile)
+{
+	EXPECT_FALSE(CalculateFileHash(m_root / L"Missing.txt").has_value());
+}
+
+TEST_F(FileHashTest, Cancel)
+{
+	WritePatternFile(m_root / L"Large.bin", 10 * 1024 * 1024);
+
+	std::stop_source stopSource;
+	stopSource.request_stop();
+
+	EXPECT_FALSE(CalculateFileHash(m_root / L"Large.bin", stopSource.get_token()).has_value());
+}
+
+TEST_F(FileHashTest, Cache)
+{
+	auto path = m_root / L"File.txt";
+	WriteFile(path, "abc");
+
+	auto &cache = FileHashCache::GetInstance();
+	auto hash = cache.GetFileHash(path);
+	ASSERT_TRUE(hash.has_value());
+
+	WIN32_FILE_ATTRIBUTE_DATA attributeData;
+	ASSERT_TRUE(GetFileAttributesEx(path.c_str(), GetFileExInfoStandard, &attributeData));
+
+	auto cachedHash = cache.GetCachedFileHash(path, 3, attributeData.ftLastWriteTime);
+	ASSERT_TRUE(cachedHash.has_value());
+	EXPECT_EQ(*cachedHash, *hash);
+
+	// The cached hash is only used while the size and last write time match.
+	EXPECT_FALSE(cache.GetCachedFileHash(path, 4, attributeData.ftLastWriteTime).has_value());
+
+	FILETIME updatedLastWriteTime = attributeData.ftLastWriteTime;
+	updatedLastWriteTime.dwLowDateTime++;
+	EXPECT_FALSE(cache.GetCachedFileHash(path, 3, updatedLastWriteTime).has_value());
+}
+
+TEST_F(FileHashTest, MultipleFiles)
+{
+	WriteFile(m_root / L"Abc.txt", "abc");
+	WriteFile(m_root / L"Empty.txt", "");
+
+	std::vector<std::wstring> paths = { m_root / L"Abc.txt", m_root / L"Missing.txt",
+		m_root / L"Empty.txt" };
+
+	int lastProgress = -1;
+	auto hashes = FileHashCache::GetInstance().GetFileHashes(paths, {},
+		[&lastProgress](int numFilesHashed) { lastProgress = numFilesHashed; });
+
+	ASSERT_EQ(hashes.size(), 3U);
+	ASSERT_TRUE(hashes[0].has_value());
+	EXPECT_EQ(FormatFileHash(*hashes[0]),
+		L"ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+	EXPECT_FALSE(hashes[1].has_value());
+	ASSERT_TRUE(hashes[2].has_value());
+	EXPECT_EQ(FormatFileHash(*hashes[2]),
+		L"e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+	EXPECT_EQ(lastProgress, 3);
+}
\ No newline at end of file
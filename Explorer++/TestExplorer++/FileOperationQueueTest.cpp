@@ -0,0 +1,117 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/FileOperationQueue.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+using namespace testing;
+
+class FileOperationQueueTest : public Test
+{
+protected:
+	void SetUp() override
+	{
+		m_root = std::filesystem::temp_directory_path()
+			/ (L"FileOperationQueueTest" + std::to_wstring(GetCurrentProcessId()));
+		m_source = m_root / L"Source";
+		m_destination = m_root / L"Destination";
+		m_stateFilePath = m_root / L"FileOperationQueue.dat";
+
+		std::filesystem::create_directories(m_source);
+		std::filesystem::create_directories(m_destination);
+
+		std::ofstream stream(m_source / L"File.txt", std::ios::binary);
+		stream << "contents";
+	}
+
+	void TearDown() override
+	{
+		std::filesystem::remove_all(m_root);
+	}
+
+	std::unique_ptr<FileOperationQueue> CreateQueue() const
+	{
+		return std::make_unique<FileOperationQueue>(m_stateFilePath.wstring(), [] {});
+	}
+
+	int AddJob(FileOperationQueue &queue) const
+	{
+		return queue.AddJob({ (m_source / L"File.txt").wstring() }, m_destination.wstring(), false);
+	}
+
+	static std::vector<FileOperationQueue::FinishedJob> WaitForFinishedJobs(
+		FileOperationQueue &queue, size_t numJobs)
+	{
+		std::vector<FileOperationQueue::FinishedJob> finishedJobs;
+
+		for (int i = 0; i < 1000 && finishedJobs.size() < numJobs; i++)
+		{
+			auto newFinishedJobs = queue.TakeFinishedJobs();
+			finishedJobs.insert(finishedJobs.end(), newFinishedJobs.begin(), newFinishedJobs.end());
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+
+		return finishedJobs;
+	}
+
+	std::string ReadDestinationFile() const
+	{
+		std::ifstream stream(m_destination / L"File.txt", std::ios::binary);
+		return std::string(std::istreambuf_iterator<char>(stream), {});
+	}
+
+	std::filesystem::path m_root;
+	std::filesystem::path m_source;
+	std::filesystem::path m_destination;
+	std::filesystem::path m_stateFilePath;
+};
+
+TEST_F(FileOperationQueueTest, Copy)
+{
+	auto queue = CreateQueue();
+	int id = AddJob(*queue);
+
+	auto finishedJobs = WaitForFinishedJobs(*queue, 1);
+	ASSERT_EQ(finishedJobs.size(), 1U);
+	EXPECT_EQ(finishedJobs[0].job.id, id);
+	EXPECT_HRESULT_SUCCEEDED(finishedJobs[0].result);
+	EXPECT_EQ(ReadDestinationFile(), "contents");
+
+	EXPECT_EQ(queue->GetStatus().numPendingJobs, 0);
+}
+
+TEST_F(FileOperationQueueTest, PendingJobsRestored)
+{
+	{
+		auto queue = CreateQueue();
+		queue->SetPaused(true);
+		AddJob(*queue);
+	}
+
+	auto queue = CreateQueue();
+	EXPECT_EQ(queue->RestorePendingJobs(), 1U);
+
+	auto finishedJobs = WaitForFinishedJobs(*queue, 1);
+	ASSERT_EQ(finishedJobs.size(), 1U);
+	EXPECT_HRESULT_SUCCEEDED(finishedJobs[0].result);
+	EXPECT_EQ(ReadDestinationFile(), "contents");
+}
+
+TEST_F(FileOperationQueueTest, CancelledJobNotRestored)
+{
+	{
+		auto queue = CreateQueue();
+		queue->SetPaused(true);
+		int id = AddJob(*queue);
+		queue->CancelJob(id);
+	}
+
+	auto queue = CreateQueue();
+	EXPECT_EQ(queue->RestorePendingJobs(), 0U);
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/FileTypeNameCache.h"
+#include <gtest/gtest.h>
+
+TEST(FileTypeNameCacheTest, Lookup)
+{
+	FileTypeNameCache cache;
+	EXPECT_EQ(cache.GetTypeName(L".txt"), std::nullopt);
+
+	cache.SetTypeName(L".txt", L"Text Document");
+	EXPECT_EQ(cache.GetTypeName(L".txt"), L"Text Document");
+	EXPECT_EQ(cache.GetTypeName(L".jpg"), std::nullopt);
+}
+
+TEST(FileTypeNameCacheTest, CaseInsensitive)
+{
+	FileTypeNameCache cache;
+	cache.SetTypeName(L".TXT", L"Text Document");
+	EXPECT_EQ(cache.GetTypeName(L".txt"), L"Text Document");
+	EXPECT_EQ(cache.GetTypeName(L".Txt"), L"Text Document");
+}
+
+TEST(FileTypeNameCacheTest, NoExtension)
+{
+	FileTypeNameCache cache;
+	cache.SetTypeName(L"", L"File");
+	EXPECT_EQ(cache.GetTypeName(L""), L"File");
+}
+
+TEST(FileTypeNameCacheTest, Clear)
+{
+	FileTypeNameCache cache;
+	cache.SetTypeName(L".txt", L"Text Document");
+	cache.Clear();
+	EXPECT_EQ(cache.GetTypeName(L".txt"), std::nullopt);
+}
\ No newline at end of file
@@ -0,0 +1,155 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/FilterExpression.h"
+#include <gtest/gtest.h>
+
+namespace
+{
+
+constexpr uint64_t TICKS_PER_DAY = 24ULL * 60 * 60 * 10'000'000;
+constexpr uint64_t CURRENT_TIME = 1000 * TICKS_PER_DAY;
+
+FilterItemTable::Item MakeItem(uint64_t size, uint64_t ageInDays, std::wstring_view extension)
+{
+	FilterItemTable::Item item;
+	item.size = size;
+	item.modified = CURRENT_TIME - ageInDays * TICKS_PER_DAY;
+	item.created = item.modified;
+	item.accessed = CURRENT_TIME;
+	item.extension = extension;
+	return item;
+}
+
+bool Matches(std::wstring_view text, const FilterItemTable::Item &item,
+	std::wstring_view name = L"file")
+{
+	auto expression = FilterExpression::Parse(text, false, CURRENT_TIME);
+	EXPECT_TRUE(expression.has_value());
+
+	return expression && expression->Matches(item, name);
+}
+
+}
+
+TEST(FilterExpressionTest, Size)
+{
+	auto item = MakeItem(200 * 1024 * 1024, 0, L".log");
+
+	EXPECT_TRUE(Matches(L"size > 100MB", item));
+	EXPECT_FALSE(Matches(L"size > 1GB", item));
+	EXPECT_TRUE(Matches(L"size >= 200mb", item));
+	EXPECT_TRUE(Matches(L"size <= 0.5gb", item));
+	EXPECT_TRUE(Matches(L"size = 209715200", item));
+	EXPECT_FALSE(Matches(L"size != 209715200", item));
+}
+
+TEST(FilterExpressionTest, Age)
+{
+	auto item = MakeItem(0, 3, L"");
+
+	EXPECT_TRUE(Matches(L"modified < 7d", item));
+	EXPECT_FALSE(Matches(L"modified < 2d", item));
+	EXPECT_TRUE(Matches(L"modified > 48h", item));
+	EXPECT_TRUE(Matches(L"created >= 3d", item));
+	EXPECT_TRUE(Matches(L"accessed < 1m", item));
+	EXPECT_FALSE(Matches(L"modified > 1w", item));
+}
+
+TEST(FilterExpressionTest, Extension)
+{
+	auto item = MakeItem(0, 0, L".TMP");
+
+	EXPECT_TRUE(Matches(L"ext in (log, tmp)", item));
+	EXPECT_TRUE(Matches(L"ext = .tmp", item));
+	EXPECT_FALSE(Matches(L"ext != tmp", item));
+	EXPECT_FALSE(Matches(L"ext in (log,txt)", item));
+
+	auto noExtension = MakeItem(0, 0, L"");
+
+	EXPECT_FALSE(Matches(L"ext in (log, tmp)", noExtension));
+}
+
+TEST(FilterExpressionTest, Name)
+{
+	auto item = MakeItem(0, 0, L".txt");
+
+	EXPECT_TRUE(Matches(L"name = *.TXT", item, L"Notes.txt"));
+	EXPECT_FALSE(Matches(L"name != \"notes*\"", item, L"Notes.txt"));
+
+	auto caseSensitive = FilterExpression::Parse(L"name = *.TXT", true, CURRENT_TIME);
+	ASSERT_TRUE(caseSensitive.has_value());
+	EXPECT_FALSE(caseSensitive->Matches(item, L"Notes.txt"));
+}
+
+TEST(FilterExpressionTest, LogicalOperators)
+{
+	auto item = MakeItem(200 * 1024 * 1024, 3, L".log");
+
+	EXPECT_TRUE(Matches(L"size > 100MB and modified < 7d and ext in (log,tmp)", item));
+	EXPECT_FALSE(Matches(L"size > 100MB and modified < 1d", item));
+	EXPECT_TRUE(Matches(L"size > 1GB or ext = log", item));
+	EXPECT_FALSE(Matches(L"not ext = log", item));
+	EXPECT_TRUE(Matches(L"NOT (size > 1GB OR ext = txt)", item));
+
+	// "and" binds more tightly than "or".
+	EXPECT_TRUE(Matches(L"ext = log or size > 1GB and ext = txt", item));
+	EXPECT_FALSE(Matches(L"(ext = log or size > 1GB) and ext = txt", item));
+}
+
+TEST(FilterExpressionTest, Evaluate)
+{
+	FilterItemTable table;
+	table.AddItem(MakeItem(10, 1, L".log"));
+	table.AddItem(MakeItem(2000, 1, L".LOG"));
+	table.AddItem(MakeItem(2000, 30, L".log"));
+	table.AddItem(MakeItem(2000, 1, L".txt"));
+	table.AddItem(MakeItem(5000, 1, L""));
+
+	auto expression = FilterExpression::Parse(L"size > 1KB and modified < 7d and ext = log",
+		false, CURRENT_TIME);
+	ASSERT_TRUE(expression.has_value());
+
+	auto results = expression->Evaluate(table, [](size_t) { return std::wstring_view(); });
+	EXPECT_EQ(results, (std::vector<uint8_t>{ 0, 1, 0, 0, 0 }));
+}
+
+TEST(FilterExpressionTest, EvaluateNames)
+{
+	FilterItemTable table;
+	table.AddItem(MakeItem(0, 0, L".txt"));
+	table.AddItem(MakeItem(0, 0, L".txt"));
+	table.AddItem(MakeItem(0, 0, L".txt"));
+
+	std::vector<std::wstring> names = { L"a.txt", L"b.txt", L"ab.txt" };
+
+	auto expression = FilterExpression::Parse(L"name = a*", true, CURRENT_TIME);
+	ASSERT_TRUE(expression.has_value());
+
+	auto results = expression->Evaluate(
+		table, [&names](size_t index) -> std::wstring_view { return names[index]; });
+	EXPECT_EQ(results, (std::vector<uint8_t>{ 1, 0, 1 }));
+}
+
+TEST(FilterExpressionTest, Invalid)
+{
+	// Plain wildcard patterns aren't expressions, which allows them to be used as before.
+	EXPECT_FALSE(FilterExpression::Parse(L"*.txt", false, CURRENT_TIME));
+	EXPECT_FALSE(FilterExpression::Parse(L"size", false, CURRENT_TIME));
+	EXPECT_FALSE(FilterExpression::Parse(L"", false, CURRENT_TIME));
+
+	EXPECT_FALSE(FilterExpression::Parse(L"size > 10XB", false, CURRENT_TIME));
+	EXPECT_FALSE(FilterExpression::Parse(L"size > -1", false, CURRENT_TIME));
+	EXPECT_FALSE(FilterExpression::Parse(L"modified < 7", false, CURRENT_TIME));
+	EXPECT_FALSE(FilterExpression::Parse(L"modified = 7d", false, CURRENT_TIME));
+	EXPECT_FALSE(FilterExpression::Parse(L"ext < log", false, CURRENT_TIME));
+	EXPECT_FALSE(FilterExpression::Parse(L"ext in (log, tmp", false, CURRENT_TIME));
+	EXPECT_FALSE(FilterExpression::Parse(L"(size > 1", false, CURRENT_TIME));
+	EXPECT_FALSE(FilterExpression::Parse(L"size > 1 and", false, CURRENT_TIME));
+	EXPECT_FALSE(FilterExpression::Parse(L"size > 1 size < 2", false, CURRENT_TIME));
+	EXPECT_FALSE(FilterExpression::Parse(L"colour = red", false, CURRENT_TIME));
+	EXPECT_FALSE(FilterExpression::Parse(L"name = \"unterminated", false, CURRENT_TIME));
+	EXPECT_FALSE(FilterExpression::Parse(
+		std::wstring(100, '(') + L"size > 1" + std::wstring(100, ')'), false, CURRENT_TIME));
+}
\ No newline at end of file
@@ -0,0 +1,185 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/FolderComparison.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+
+using namespace testing;
+
+class FolderComparisonTest : public Test
+{
+protected:
+	void SetUp() override
+	{
+		m_root = std::filesystem::temp_directory_path()
+			/ (L"FolderComparisonTest" + std::to_wstring(GetCurrentProcessId()));
+		m_source = m_root / L"Source";
+		m_destination = m_root / L"Destination";
+
+		for (const auto &folder : { m_source, m_destination })
+		{
+			std::filesystem::create_directories(folder / L"Folder");
+			WriteFile(folder / L"Same.txt", "same");
+			WriteFile(folder / L"Folder" / L"Same.txt", "same");
+		}
+
+		WriteFile(m_source / L"SourceOnly.txt", "source");
+		std::filesystem::create_directories(m_source / L"SourceOnlyFolder");
+		WriteFile(m_source / L"SourceOnlyFolder" / L"File.txt", "source");
+		WriteFile(m_destination / L"DestinationOnly.txt", "destination");
+
+		WriteFile(m_source / L"Folder" / L"Resized.txt", "longer contents");
+		WriteFile(m_destination / L"Folder" / L"Resized.txt", "contents");
+
+		// Names are matched case-insensitively.
+		WriteFile(m_source / L"Kind", "file");
+		std::filesystem::create_directories(m_destination / L"KIND");
+
+		// The identical files are given identical modification times, so that they're treated as
+		// unchanged, regardless of how long the writes above took.
+		SynchronizeModificationTimes();
+	}
+
+	void TearDown() override
+	{
+		std::filesystem::remove_all(m_root);
+	}
+
+	static void WriteFile(const std::filesystem::path &path, const std::string &contents)
+	{
+		std::ofstream stream(path, std::ios::binary);
+		stream << contents;
+	}
+
+	static std::string ReadFile(const std::filesystem::path &path)
+	{
+		std::ifstream stream(path, std::ios::binary);
+		return std::string(std::istreambuf_iterator<char>(stream), {});
+	}
+
+	void SynchronizeModificationTimes()
+	{
+		for (const auto &relativePath : { L"Same.txt", L"Folder\\Same.txt" })
+		{
+			std::filesystem::last_write_time(m_destination / relativePath,
+				std::filesystem::last_write_time(m_source / relativePath));
+		}
+	}
+
+	std::vector<FolderDifference> Compare(const FolderComparisonOptions &options = {})
+	{
+		std::vector<FolderDifference> differences;
+		HRESULT hr =
+			CompareFolders(m_source.wstring(), m_destination.wstring(), options, differences);
+		EXPECT_HRESULT_SUCCEEDED(hr);
+		return differences;
+	}
+
+	static std::vector<std::pair<FolderDifferenceType, std::wstring>> Summarize(
+		const std::vector<FolderDifference> &differences)
+	{
+		std::vector<std::pair<FolderDifferenceType, std::wstring>> summary;
+
+		for (const auto &difference : differences)
+		{
+			summary.emplace_back(difference.type, difference.relativePath);
+		}
+
+		return summary;
+	}
+
+	std::filesystem::path m_root;
+	std::filesystem::path m_source;
+	std::filesystem::path m_destination;
+};
+
+TEST_F(FolderComparisonTest, Compare)
+{
+	auto differences = Compare();
+
+	std::vector<std::pair<FolderDifferenceType, std::wstring>> expected = {
+		{ FolderDifferenceType::DestinationOnly, L"DestinationOnly.txt" },
+		{ FolderDifferenceType::Modified, L"Folder\\Resized.txt" },
+		{ FolderDifferenceType::KindMismatch, L"Kind" },
+		{ FolderDifferenceType::SourceOnly, L"SourceOnly.txt" },
+		{ FolderDifferenceType::SourceOnly, L"SourceOnlyFolder" }
+	};
+	EXPECT_EQ(Summarize(differences), expected);
+}
+
+TEST_F(FolderComparisonTest, CompareModificationTimes)
+{
+	auto sameFile = m_destination / L"Same.txt";
+	std::filesystem::last_write_time(
+		sameFile, std::filesystem::last_write_time(sameFile) + std::chrono::hours(1));
+
+	auto differences = Compare();
+	auto summary = Summarize(differences);
+
+	EXPECT_NE(std::find(summary.begin(), summary.end(),
+				  std::make_pair(FolderDifferenceType::Modified, std::wstring(L"Same.txt"))),
+		summary.end());
+}
+
+TEST_F(FolderComparisonTest, CompareContents)
+{
+	// The modification time should be ignored when the contents are compared.
+	auto sameFile = m_destination / L"Same.txt";
+	std::filesystem::last_write_time(
+		sameFile, std::filesystem::last_write_time(sameFile) + std::chrono::hours(1));
+
+	WriteFile(m_destination / L"Folder" / L"Same.txt", "SAME");
+
+	FolderComparisonOptions options;
+	options.compareContents = true;
+	auto differences = Compare(options);
+	auto summary = Summarize(differences);
+
+	EXPECT_EQ(std::find(summary.begin(), summary.end(),
+				  std::make_pair(FolderDifferenceType::Modified, std::wstring(L"Same.txt"))),
+		summary.end());
+	EXPECT_NE(std::find(summary.begin(), summary.end(),
+				  std::make_pair(
+					  FolderDifferenceType::Modified, std::wstring(L"Folder\\Same.txt"))),
+		summary.end());
+}
+
+TEST_F(FolderComparisonTest, CopyDifferences)
+{
+	auto differences = Compare();
+
+	HRESULT hr = CopyFolderDifferences(m_source.wstring(), m_destination.wstring(), differences);
+	ASSERT_HRESULT_SUCCEEDED(hr);
+
+	EXPECT_EQ(ReadFile(m_destination / L"SourceOnly.txt"), "source");
+	EXPECT_EQ(ReadFile(m_destination / L"SourceOnlyFolder" / L"File.txt"), "source");
+	EXPECT_EQ(ReadFile(m_destination / L"Folder" / L"Resized.txt"), "longer contents");
+
+	// Nothing should be removed from the destination and items that differ in kind should be left
+	// alone.
+	EXPECT_EQ(ReadFile(m_destination / L"DestinationOnly.txt"), "destination");
+	EXPECT_TRUE(std::filesystem::is_directory(m_destination / L"KIND"));
+
+	// Only the items that exist solely in the destination (or differ in kind) should remain.
+	std::vector<std::pair<FolderDifferenceType, std::wstring>> expected = {
+		{ FolderDifferenceType::DestinationOnly, L"DestinationOnly.txt" },
+		{ FolderDifferenceType::KindMismatch, L"Kind" }
+	};
+	EXPECT_EQ(Summarize(Compare()), expected);
+}
+
+TEST_F(FolderComparisonTest, Cancel)
+{
+	std::stop_source stopSource;
+	stopSource.request_stop();
+
+	std::vector<FolderDifference> differences;
+	HRESULT hr = CompareFolders(
+		m_source.wstring(), m_destination.wstring(), {}, differences, stopSource.get_token());
+	EXPECT_EQ(hr, HRESULT_FROM_WIN32(ERROR_CANCELLED));
+}
\ No newline at end of file
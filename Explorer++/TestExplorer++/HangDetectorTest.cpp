@@ -0,0 +1,73 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/HangDetector.h"
+#include <gtest/gtest.h>
+
+using namespace std::chrono_literals;
+using Action = HangDetector::Action;
+
+class HangDetectorTest : public testing::Test
+{
+protected:
+	HangDetectorTest() : m_detector(5s)
+	{
+	}
+
+	HangDetector::Clock::time_point m_now;
+	HangDetector m_detector;
+};
+
+TEST_F(HangDetectorTest, ResponsiveThread)
+{
+	for (int i = 0; i < 10; i++)
+	{
+		EXPECT_EQ(m_detector.Check(m_now, m_detector.GetPendingPingId()), Action::SendPing);
+
+		uint64_t pingId = m_detector.GetPendingPingId();
+		m_now += 1s;
+
+		// Once a ping has been acknowledged, a new ping should be sent straight away.
+		EXPECT_EQ(m_detector.Check(m_now, pingId), Action::SendPing);
+		EXPECT_EQ(m_detector.GetPendingPingId(), pingId + 1);
+		m_now += 1s;
+	}
+}
+
+TEST_F(HangDetectorTest, HangReportedOnce)
+{
+	EXPECT_EQ(m_detector.Check(m_now, 0), Action::SendPing);
+	uint64_t pingId = m_detector.GetPendingPingId();
+
+	m_now += 4s;
+	EXPECT_EQ(m_detector.Check(m_now, 0), Action::None);
+
+	m_now += 1s;
+	EXPECT_EQ(m_detector.Check(m_now, 0), Action::ReportHang);
+	EXPECT_EQ(m_detector.GetHangDuration(m_now), 5s);
+
+	m_now += 1s;
+	EXPECT_EQ(m_detector.Check(m_now, 0), Action::None);
+
+	m_now += 1s;
+	EXPECT_EQ(m_detector.Check(m_now, pingId), Action::HangEnded);
+	EXPECT_EQ(m_detector.GetHangDuration(m_now), 7s);
+
+	EXPECT_EQ(m_detector.Check(m_now, pingId), Action::SendPing);
+}
+
+TEST_F(HangDetectorTest, WatchdogSuspended)
+{
+	EXPECT_EQ(m_detector.Check(m_now, 0), Action::SendPing);
+
+	// A long gap between checks shouldn't be treated as a hang.
+	m_now += 1h;
+	EXPECT_EQ(m_detector.Check(m_now, 0), Action::None);
+
+	m_now += 4s;
+	EXPECT_EQ(m_detector.Check(m_now, 0), Action::None);
+
+	m_now += 1s;
+	EXPECT_EQ(m_detector.Check(m_now, 0), Action::ReportHang);
+}
\ No newline at end of file
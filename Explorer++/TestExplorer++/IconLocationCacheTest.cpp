@@ -0,0 +1,98 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/IconLocationCache.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+
+using namespace testing;
+
+class IconLocationCacheTest : public Test
+{
+protected:
+	void SetUp() override
+	{
+		m_filePath = std::filesystem::temp_directory_path()
+			/ (L"IconLocationCacheTest" + std::to_wstring(GetCurrentProcessId()) + L".dat");
+	}
+
+	void TearDown() override
+	{
+		std::filesystem::remove(m_filePath);
+	}
+
+	static FILETIME MakeFileTime(DWORD value)
+	{
+		return { value, 0 };
+	}
+
+	std::filesystem::path m_filePath;
+};
+
+TEST_F(IconLocationCacheTest, Lookup)
+{
+	IconLocationCache cache;
+	IconLocationCache::IconLocation location = { L"C:\\Windows\\System32\\shell32.dll", 3, 0 };
+	cache.SetIconLocation(L"C:\\Folder", MakeFileTime(1), location);
+
+	EXPECT_EQ(cache.GetIconLocation(L"C:\\Folder", MakeFileTime(1)), location);
+
+	// Lookups are case-insensitive.
+	EXPECT_EQ(cache.GetIconLocation(L"c:\\FOLDER", MakeFileTime(1)), location);
+
+	EXPECT_EQ(cache.GetIconLocation(L"C:\\Other", MakeFileTime(1)), std::nullopt);
+}
+
+TEST_F(IconLocationCacheTest, ChangedItem)
+{
+	IconLocationCache cache;
+	cache.SetIconLocation(
+		L"C:\\File.exe", MakeFileTime(1), { L"C:\\File.exe", 0, GIL_PERINSTANCE });
+
+	// The item has been modified since its location was recorded, so the location can't be used.
+	EXPECT_EQ(cache.GetIconLocation(L"C:\\File.exe", MakeFileTime(2)), std::nullopt);
+}
+
+TEST_F(IconLocationCacheTest, SaveAndLoad)
+{
+	IconLocationCache cache;
+	IconLocationCache::IconLocation location1 = { L"C:\\Windows\\System32\\shell32.dll", 3, 0 };
+	IconLocationCache::IconLocation location2 = { L"C:\\File.exe", -101, GIL_PERINSTANCE };
+	cache.SetIconLocation(L"C:\\Folder1", MakeFileTime(1), location1);
+	cache.SetIconLocation(L"C:\\Folder2", MakeFileTime(2), location1);
+	cache.SetIconLocation(L"C:\\File.exe", MakeFileTime(3), location2);
+	ASSERT_TRUE(cache.SaveToFile(m_filePath.wstring()));
+
+	IconLocationCache loadedCache;
+	ASSERT_TRUE(loadedCache.LoadFromFile(m_filePath.wstring()));
+
+	EXPECT_EQ(loadedCache.GetIconLocation(L"C:\\Folder1", MakeFileTime(1)), location1);
+	EXPECT_EQ(loadedCache.GetIconLocation(L"C:\\Folder2", MakeFileTime(2)), location1);
+	EXPECT_EQ(loadedCache.GetIconLocation(L"C:\\File.exe", MakeFileTime(3)), location2);
+}
+
+TEST_F(IconLocationCacheTest, LoadTruncatedFile)
+{
+	IconLocationCache cache;
+	cache.SetIconLocation(
+		L"C:\\Folder", MakeFileTime(1), { L"C:\\Windows\\System32\\shell32.dll", 3, 0 });
+	ASSERT_TRUE(cache.SaveToFile(m_filePath.wstring()));
+
+	std::filesystem::resize_file(m_filePath, std::filesystem::file_size(m_filePath) - 1);
+
+	IconLocationCache loadedCache;
+	EXPECT_FALSE(loadedCache.LoadFromFile(m_filePath.wstring()));
+}
+
+TEST_F(IconLocationCacheTest, LoadInvalidFile)
+{
+	{
+		std::ofstream stream(m_filePath, std::ios::binary);
+		stream << "not an icon cache";
+	}
+
+	IconLocationCache cache;
+	EXPECT_FALSE(cache.LoadFromFile(m_filePath.wstring()));
+}
\ No newline at end of file
@@ -0,0 +1,90 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/IconLookupThrottle.h"
+#include <gtest/gtest.h>
+
+using namespace std::chrono_literals;
+using Decision = IconLookupThrottle::Decision;
+
+class IconLookupThrottleTest : public testing::Test
+{
+protected:
+	IconLookupThrottleTest() : m_throttle(5s, 60s, [this] { return m_now; })
+	{
+	}
+
+	IconLookupThrottle::Clock::time_point m_now;
+	IconLookupThrottle m_throttle;
+};
+
+TEST_F(IconLookupThrottleTest, ConcurrentRequestsShareLookup)
+{
+	EXPECT_EQ(m_throttle.OnRequest(L"C:\\Folder"), Decision::StartLookup);
+	EXPECT_EQ(m_throttle.OnRequest(L"C:\\Folder"), Decision::JoinLookup);
+	EXPECT_EQ(m_throttle.OnRequest(L"C:\\Other"), Decision::StartLookup);
+
+	m_throttle.OnLookupFinished(L"C:\\Folder", true, 10ms);
+
+	// Once the lookup has finished, a further request needs a new lookup.
+	EXPECT_EQ(m_throttle.OnRequest(L"C:\\Folder"), Decision::StartLookup);
+}
+
+TEST_F(IconLookupThrottleTest, FailedPathCoolDown)
+{
+	EXPECT_EQ(m_throttle.OnRequest(L"C:\\Missing"), Decision::StartLookup);
+	m_throttle.OnLookupFinished(L"C:\\Missing", false, 10ms);
+
+	EXPECT_EQ(m_throttle.OnRequest(L"C:\\Missing"), Decision::Reject);
+
+	// A quick failure shouldn't affect other paths within the same root.
+	EXPECT_EQ(m_throttle.OnRequest(L"C:\\Folder"), Decision::StartLookup);
+
+	m_now += 61s;
+	EXPECT_EQ(m_throttle.OnRequest(L"C:\\Missing"), Decision::StartLookup);
+}
+
+TEST_F(IconLookupThrottleTest, SlowFailureMarksRootUnreachable)
+{
+	EXPECT_EQ(m_throttle.OnRequest(L"\\\\server\\share\\first"), Decision::StartLookup);
+	m_throttle.OnLookupFinished(L"\\\\server\\share\\first", false, 30s);
+
+	EXPECT_EQ(m_throttle.OnRequest(L"\\\\server\\share\\second"), Decision::Reject);
+	EXPECT_EQ(m_throttle.OnRequest(L"\\\\SERVER\\Share\\third"), Decision::Reject);
+	EXPECT_EQ(m_throttle.OnRequest(L"\\\\server\\other\\first"), Decision::StartLookup);
+
+	m_now += 61s;
+	EXPECT_EQ(m_throttle.OnRequest(L"\\\\server\\share\\second"), Decision::StartLookup);
+}
+
+TEST_F(IconLookupThrottleTest, LongRunningLookupMarksRootUnreachable)
+{
+	EXPECT_EQ(m_throttle.OnRequest(L"\\\\server\\share\\first"), Decision::StartLookup);
+
+	m_now += 1s;
+	EXPECT_EQ(m_throttle.OnRequest(L"\\\\server\\share\\second"), Decision::StartLookup);
+
+	m_now += 10s;
+	EXPECT_EQ(m_throttle.OnRequest(L"\\\\server\\share\\third"), Decision::Reject);
+
+	// If the lookup eventually succeeds, the root is reachable after all.
+	m_throttle.OnLookupFinished(L"\\\\server\\share\\first", true, 11s);
+	m_throttle.OnLookupFinished(L"\\\\server\\share\\second", true, 10s);
+	EXPECT_EQ(m_throttle.OnRequest(L"\\\\server\\share\\third"), Decision::StartLookup);
+}
+
+TEST_F(IconLookupThrottleTest, ForgetRunningLookups)
+{
+	EXPECT_EQ(m_throttle.OnRequest(L"C:\\Folder"), Decision::StartLookup);
+	m_throttle.ForgetRunningLookups();
+	EXPECT_EQ(m_throttle.OnRequest(L"C:\\Folder"), Decision::StartLookup);
+}
+
+TEST(IconLookupThrottleRootTest, GetRoot)
+{
+	EXPECT_EQ(IconLookupThrottle::GetRoot(L"C:\\Folder\\File.txt"), L"c:\\");
+	EXPECT_EQ(IconLookupThrottle::GetRoot(L"\\\\Server\\Share\\Folder"), L"\\\\server\\share");
+	EXPECT_EQ(IconLookupThrottle::GetRoot(L"::{645FF040-5081-101B-9F08-00AA002F954E}"),
+		L"::{645FF040-5081-101B-9F08-00AA002F954E}");
+}
\ No newline at end of file
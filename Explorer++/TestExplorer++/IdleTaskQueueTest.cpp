@@ -0,0 +1,90 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/IdleTaskQueue.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+class IdleTaskQueueTest : public testing::Test
+{
+protected:
+	IdleTaskQueueTest() :
+		m_queue([this] { m_numSchedules++; }, [this] { return m_interrupt; })
+	{
+	}
+
+	IdleTaskQueue::Task RecordTask(int id)
+	{
+		return [this, id] { m_ran.push_back(id); };
+	}
+
+	IdleTaskQueue m_queue;
+	int m_numSchedules = 0;
+	bool m_interrupt = false;
+	std::vector<int> m_ran;
+
+	// Used as owners.
+	int m_owners[3] = {};
+};
+
+TEST_F(IdleTaskQueueTest, RunInPriorityOrder)
+{
+	m_queue.ScheduleTask(&m_owners[0], 2, RecordTask(1));
+	m_queue.ScheduleTask(&m_owners[1], 0, RecordTask(2));
+	m_queue.ScheduleTask(&m_owners[2], 2, RecordTask(3));
+
+	EXPECT_FALSE(m_queue.RunTasks());
+	EXPECT_EQ(m_ran, (std::vector<int>{ 2, 1, 3 }));
+	EXPECT_FALSE(m_queue.HasTasks());
+}
+
+TEST_F(IdleTaskQueueTest, ReplaceTaskForOwner)
+{
+	m_queue.ScheduleTask(&m_owners[0], 0, RecordTask(1));
+	m_queue.ScheduleTask(&m_owners[1], 1, RecordTask(2));
+	m_queue.ScheduleTask(&m_owners[0], 0, RecordTask(3));
+
+	m_queue.RunTasks();
+	EXPECT_EQ(m_ran, (std::vector<int>{ 3, 2 }));
+}
+
+TEST_F(IdleTaskQueueTest, ScheduleOncePerBatch)
+{
+	m_queue.ScheduleTask(&m_owners[0], 0, RecordTask(1));
+	m_queue.ScheduleTask(&m_owners[1], 0, RecordTask(2));
+	EXPECT_EQ(m_numSchedules, 1);
+
+	m_queue.RunTasks();
+
+	m_queue.ScheduleTask(&m_owners[0], 0, RecordTask(3));
+	EXPECT_EQ(m_numSchedules, 2);
+}
+
+TEST_F(IdleTaskQueueTest, Interrupt)
+{
+	m_queue.ScheduleTask(&m_owners[0], 0, RecordTask(1));
+	m_queue.ScheduleTask(&m_owners[1], 1, RecordTask(2));
+
+	m_interrupt = true;
+
+	// A task should always be run, even if the queue is immediately interrupted.
+	EXPECT_TRUE(m_queue.RunTasks());
+	EXPECT_EQ(m_ran, (std::vector<int>{ 1 }));
+
+	m_interrupt = false;
+
+	EXPECT_FALSE(m_queue.RunTasks());
+	EXPECT_EQ(m_ran, (std::vector<int>{ 1, 2 }));
+}
+
+TEST_F(IdleTaskQueueTest, CancelTask)
+{
+	m_queue.ScheduleTask(&m_owners[0], 0, RecordTask(1));
+	m_queue.ScheduleTask(&m_owners[1], 0, RecordTask(2));
+
+	m_queue.CancelTask(&m_owners[0]);
+
+	m_queue.RunTasks();
+	EXPECT_EQ(m_ran, (std::vector<int>{ 2 }));
+}
\ No newline at end of file
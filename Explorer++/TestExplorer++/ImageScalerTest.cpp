@@ -0,0 +1,57 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/ImageScaler.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+TEST(ImageScalerTest, SameSize)
+{
+	std::vector<uint32_t> source = { 0x11223344, 0x55667788, 0x99AABBCC, 0xDDEEFF00 };
+	std::vector<uint32_t> destination(4);
+	DownscaleImage(source.data(), 2, 2, destination.data(), 2, 2);
+
+	EXPECT_EQ(destination, source);
+}
+
+TEST(ImageScalerTest, HalfSize)
+{
+	// clang-format off
+	std::vector<uint32_t> source = {
+		0x00000000, 0x04040404, 0xFF000000, 0xFF000000,
+		0x08080808, 0x0C0C0C0C, 0xFF000000, 0xFF000000,
+		0x10203040, 0x10203040, 0x000000FF, 0x000000FF,
+		0x10203040, 0x10203040, 0x000000FF, 0x000000FF
+	};
+	// clang-format on
+
+	std::vector<uint32_t> destination(4);
+	DownscaleImage(source.data(), 4, 4, destination.data(), 2, 2);
+
+	std::vector<uint32_t> expected = { 0x06060606, 0xFF000000, 0x10203040, 0x000000FF };
+	EXPECT_EQ(destination, expected);
+}
+
+TEST(ImageScalerTest, UnevenSize)
+{
+	// Three columns are reduced to two, so the second destination pixel covers two of the source
+	// pixels.
+	std::vector<uint32_t> source = { 0x00000010, 0x00000020, 0x00000040 };
+	std::vector<uint32_t> destination(2);
+	DownscaleImage(source.data(), 3, 1, destination.data(), 2, 1);
+
+	std::vector<uint32_t> expected = { 0x00000010, 0x00000030 };
+	EXPECT_EQ(destination, expected);
+}
+
+TEST(ImageScalerTest, OddWidth)
+{
+	// The pixels in each block are processed in pairs, with the last pixel in a block that has an
+	// odd width being handled separately.
+	std::vector<uint32_t> source = { 0x03030303, 0x06060606, 0x09090909 };
+	std::vector<uint32_t> destination(1);
+	DownscaleImage(source.data(), 3, 1, destination.data(), 1, 1);
+
+	EXPECT_EQ(destination[0], 0x06060606u);
+}
\ No newline at end of file
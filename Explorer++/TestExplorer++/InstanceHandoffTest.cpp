@@ -0,0 +1,44 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "InstanceHandoff.h"
+#include <gtest/gtest.h>
+
+using namespace testing;
+
+TEST(InstanceHandoffTest, RoundTrip)
+{
+	InstanceHandoff::Request request;
+	request.baseDirectory = L"C:\\Program Files\\Explorer++\\";
+	request.paths = { L"C:\\", L"..\\Relative", L"::{26EE0668-A00A-44D7-9371-BEB064C98683}" };
+
+	auto decodedRequest = InstanceHandoff::DecodeRequest(InstanceHandoff::EncodeRequest(request));
+	ASSERT_TRUE(decodedRequest.has_value());
+	EXPECT_EQ(decodedRequest->baseDirectory, request.baseDirectory);
+	EXPECT_EQ(decodedRequest->paths, request.paths);
+}
+
+TEST(InstanceHandoffTest, RoundTripNoPaths)
+{
+	InstanceHandoff::Request request;
+	request.baseDirectory = L"C:\\";
+
+	auto decodedRequest = InstanceHandoff::DecodeRequest(InstanceHandoff::EncodeRequest(request));
+	ASSERT_TRUE(decodedRequest.has_value());
+	EXPECT_EQ(decodedRequest->baseDirectory, request.baseDirectory);
+	EXPECT_TRUE(decodedRequest->paths.empty());
+}
+
+TEST(InstanceHandoffTest, InvalidMessage)
+{
+	EXPECT_FALSE(InstanceHandoff::DecodeRequest(L"").has_value());
+
+	// Unknown protocol.
+	EXPECT_FALSE(InstanceHandoff::DecodeRequest(std::wstring(L"Unknown\0C:\\\0", 12)).has_value());
+
+	// Missing terminator.
+	auto message = InstanceHandoff::EncodeRequest({ L"C:\\", { L"D:\\" } });
+	message.pop_back();
+	EXPECT_FALSE(InstanceHandoff::DecodeRequest(message).has_value());
+}
\ No newline at end of file
@@ -0,0 +1,100 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/ItemAttributeCache.h"
+#include <gtest/gtest.h>
+
+using namespace testing;
+
+class ItemAttributeCacheTest : public Test
+{
+protected:
+	ItemAttributeCacheTest() :
+		m_cache(std::chrono::seconds(10), [this]() { return m_currentTime; })
+	{
+	}
+
+	std::chrono::steady_clock::time_point m_currentTime;
+	ItemAttributeCache m_cache;
+};
+
+TEST_F(ItemAttributeCacheTest, Lookup)
+{
+	m_cache.SetAttributes(L"C:\\Folder", SFGAO_HASSUBFOLDER | SFGAO_FOLDER, SFGAO_FOLDER);
+
+	EXPECT_EQ(m_cache.GetCachedAttributes(L"C:\\Folder", SFGAO_HASSUBFOLDER), 0u);
+	EXPECT_EQ(m_cache.GetCachedAttributes(L"C:\\Folder", SFGAO_HASSUBFOLDER | SFGAO_FOLDER),
+		static_cast<SFGAOF>(SFGAO_FOLDER));
+
+	// Lookups are case-insensitive.
+	EXPECT_EQ(m_cache.GetCachedAttributes(L"c:\\FOLDER", SFGAO_FOLDER),
+		static_cast<SFGAOF>(SFGAO_FOLDER));
+
+	EXPECT_EQ(m_cache.GetCachedAttributes(L"C:\\Other", SFGAO_FOLDER), std::nullopt);
+}
+
+TEST_F(ItemAttributeCacheTest, UnknownAttributes)
+{
+	m_cache.SetAttributes(L"C:\\Folder", SFGAO_FOLDER, SFGAO_FOLDER);
+
+	// Only some of the requested attributes are known.
+	EXPECT_EQ(m_cache.GetCachedAttributes(L"C:\\Folder", SFGAO_FOLDER | SFGAO_HASSUBFOLDER),
+		std::nullopt);
+
+	m_cache.SetAttributes(L"C:\\Folder", SFGAO_HASSUBFOLDER, SFGAO_HASSUBFOLDER);
+
+	EXPECT_EQ(m_cache.GetCachedAttributes(L"C:\\Folder", SFGAO_FOLDER | SFGAO_HASSUBFOLDER),
+		static_cast<SFGAOF>(SFGAO_FOLDER | SFGAO_HASSUBFOLDER));
+}
+
+TEST_F(ItemAttributeCacheTest, Expiry)
+{
+	m_cache.SetAttributes(L"C:\\Folder", SFGAO_FOLDER, SFGAO_FOLDER);
+
+	m_currentTime += std::chrono::seconds(5);
+	m_cache.SetAttributes(L"C:\\Folder", SFGAO_HASSUBFOLDER, 0);
+
+	m_currentTime += std::chrono::seconds(4);
+	EXPECT_EQ(m_cache.GetCachedAttributes(L"C:\\Folder", SFGAO_HASSUBFOLDER), 0u);
+
+	// Adding attributes to the entry shouldn't have extended its lifetime.
+	m_currentTime += std::chrono::seconds(1);
+	EXPECT_EQ(m_cache.GetCachedAttributes(L"C:\\Folder", SFGAO_FOLDER), std::nullopt);
+	EXPECT_EQ(m_cache.GetCachedAttributes(L"C:\\Folder", SFGAO_HASSUBFOLDER), std::nullopt);
+}
+
+TEST_F(ItemAttributeCacheTest, InvalidateItem)
+{
+	m_cache.SetAttributes(L"C:\\", SFGAO_HASSUBFOLDER, SFGAO_HASSUBFOLDER);
+	m_cache.SetAttributes(L"C:\\Folder", SFGAO_HASSUBFOLDER, SFGAO_HASSUBFOLDER);
+	m_cache.SetAttributes(L"C:\\Folder\\Subfolder", SFGAO_HASSUBFOLDER, 0);
+	m_cache.SetAttributes(L"C:\\Other", SFGAO_HASSUBFOLDER, 0);
+
+	// The item itself and its parent are removed.
+	m_cache.InvalidateItem(L"C:\\Folder\\Subfolder");
+	EXPECT_EQ(m_cache.GetCachedAttributes(L"C:\\Folder\\Subfolder", SFGAO_HASSUBFOLDER),
+		std::nullopt);
+	EXPECT_EQ(m_cache.GetCachedAttributes(L"C:\\Folder", SFGAO_HASSUBFOLDER), std::nullopt);
+	EXPECT_EQ(m_cache.GetCachedAttributes(L"C:\\", SFGAO_HASSUBFOLDER),
+		static_cast<SFGAOF>(SFGAO_HASSUBFOLDER));
+
+	// The parent of a top-level folder is the drive.
+	m_cache.InvalidateItem(L"C:\\Other");
+	EXPECT_EQ(m_cache.GetCachedAttributes(L"C:\\Other", SFGAO_HASSUBFOLDER), std::nullopt);
+	EXPECT_EQ(m_cache.GetCachedAttributes(L"C:\\", SFGAO_HASSUBFOLDER), std::nullopt);
+}
+
+TEST_F(ItemAttributeCacheTest, OnFolderEnumerated)
+{
+	m_cache.OnFolderEnumerated(L"C:\\Folder1", true, false);
+	EXPECT_EQ(m_cache.GetCachedAttributes(L"C:\\Folder1", SFGAO_HASSUBFOLDER),
+		static_cast<SFGAOF>(SFGAO_HASSUBFOLDER));
+
+	m_cache.OnFolderEnumerated(L"C:\\Folder2", false, true);
+	EXPECT_EQ(m_cache.GetCachedAttributes(L"C:\\Folder2", SFGAO_HASSUBFOLDER), 0u);
+
+	// There may be hidden subfolders that weren't enumerated.
+	m_cache.OnFolderEnumerated(L"C:\\Folder3", false, false);
+	EXPECT_EQ(m_cache.GetCachedAttributes(L"C:\\Folder3", SFGAO_HASSUBFOLDER), std::nullopt);
+}
\ No newline at end of file
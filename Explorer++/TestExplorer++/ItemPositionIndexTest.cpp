@@ -0,0 +1,98 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/ItemPositionIndex.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+
+class ItemPositionIndexTest : public testing::Test
+{
+protected:
+	std::optional<int> Find(int id)
+	{
+		m_numLookups = 0;
+
+		return m_index.Find(id, static_cast<int>(m_items.size()), [this](int position) {
+			m_numLookups++;
+			return m_items[position];
+		});
+	}
+
+	ItemPositionIndex m_index;
+	std::vector<int> m_items = { 4, 2, 7, 0 };
+	int m_numLookups = 0;
+};
+
+TEST_F(ItemPositionIndexTest, Find)
+{
+	EXPECT_EQ(Find(4), 0);
+	EXPECT_EQ(Find(2), 1);
+	EXPECT_EQ(Find(7), 2);
+	EXPECT_EQ(Find(0), 3);
+
+	EXPECT_EQ(Find(1), std::nullopt);
+	EXPECT_EQ(Find(100), std::nullopt);
+	EXPECT_EQ(Find(-1), std::nullopt);
+}
+
+TEST_F(ItemPositionIndexTest, NoRebuildWhenUnchanged)
+{
+	Find(4);
+
+	// Once the index has been built, a lookup should only need to check the single item.
+	EXPECT_EQ(Find(7), 2);
+	EXPECT_EQ(m_numLookups, 1);
+
+	EXPECT_EQ(Find(1), std::nullopt);
+	EXPECT_EQ(m_numLookups, 0);
+}
+
+TEST_F(ItemPositionIndexTest, Invalidate)
+{
+	Find(4);
+
+	std::reverse(m_items.begin(), m_items.end());
+	m_index.Invalidate();
+
+	EXPECT_EQ(Find(1), std::nullopt);
+	EXPECT_EQ(Find(4), 3);
+	EXPECT_EQ(Find(0), 0);
+}
+
+TEST_F(ItemPositionIndexTest, Append)
+{
+	Find(4);
+
+	m_items.push_back(9);
+	m_index.OnItemAppended(9, 4);
+
+	EXPECT_EQ(Find(9), 4);
+	EXPECT_EQ(m_numLookups, 1);
+
+	// An item that isn't appended to the end of the list invalidates the index.
+	m_items.insert(m_items.begin(), 5);
+	m_index.OnItemAppended(5, 0);
+
+	EXPECT_EQ(Find(5), 0);
+	EXPECT_EQ(Find(9), 5);
+}
+
+TEST_F(ItemPositionIndexTest, UnreportedChanges)
+{
+	Find(4);
+
+	// The number of items has changed, so the index should be rebuilt, even though it wasn't
+	// invalidated.
+	m_items.erase(m_items.begin());
+
+	EXPECT_EQ(Find(4), std::nullopt);
+	EXPECT_EQ(Find(2), 0);
+
+	// The number of items is the same here, but the position that's stored for the item will no
+	// longer be correct.
+	std::swap(m_items[0], m_items[1]);
+
+	EXPECT_EQ(Find(2), 1);
+	EXPECT_EQ(Find(7), 0);
+}
\ No newline at end of file
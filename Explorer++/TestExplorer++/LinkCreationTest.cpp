@@ -0,0 +1,118 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/LinkCreation.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+
+using namespace testing;
+
+class LinkCreationTest : public Test
+{
+protected:
+	void SetUp() override
+	{
+		m_root = std::filesystem::temp_directory_path()
+			/ (L"LinkCreationTest" + std::to_wstring(GetCurrentProcessId()));
+		m_source = m_root / L"Source";
+		m_destination = m_root / L"Destination";
+
+		std::filesystem::create_directories(m_source / L"Folder" / L"Subfolder");
+		std::filesystem::create_directories(m_destination);
+
+		std::ofstream(m_source / L"File.txt") << "Test";
+		std::ofstream(m_source / L"Folder" / L"File.txt") << "Test";
+		std::ofstream(m_source / L"Folder" / L"Subfolder" / L"File.txt") << "Test";
+	}
+
+	void TearDown() override
+	{
+		std::filesystem::remove_all(m_root);
+	}
+
+	static DWORD GetNumberOfLinks(const std::filesystem::path &path)
+	{
+		HANDLE file = CreateFile(path.c_str(), FILE_READ_ATTRIBUTES,
+			FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, 0,
+			nullptr);
+		EXPECT_NE(file, INVALID_HANDLE_VALUE);
+
+		BY_HANDLE_FILE_INFORMATION fileInfo = {};
+		BOOL res = GetFileInformationByHandle(file, &fileInfo);
+		EXPECT_TRUE(res);
+
+		CloseHandle(file);
+
+		return fileInfo.nNumberOfLinks;
+	}
+
+	std::filesystem::path m_root;
+	std::filesystem::path m_source;
+	std::filesystem::path m_destination;
+};
+
+TEST_F(LinkCreationTest, HardLinks)
+{
+	std::vector<std::wstring> targetPaths = { (m_source / L"File.txt").wstring(),
+		(m_source / L"Folder").wstring() };
+
+	int numProgressUpdates = 0;
+	auto result = CreateLinks(targetPaths, m_destination.wstring(), LinkType::HardLink, {},
+		[&numProgressUpdates](const LinkCreationProgress &progress) {
+			EXPECT_LE(progress.itemsProcessed, progress.totalItems);
+			numProgressUpdates++;
+		});
+
+	// The file, along with the two folders and two files that make up the mirrored folder.
+	EXPECT_EQ(result.itemsCreated, 5);
+	EXPECT_EQ(result.itemsFailed, 0);
+	EXPECT_GT(numProgressUpdates, 0);
+
+	EXPECT_EQ(GetNumberOfLinks(m_destination / L"File.txt"), 2u);
+	EXPECT_EQ(GetNumberOfLinks(m_destination / L"Folder" / L"File.txt"), 2u);
+	EXPECT_EQ(GetNumberOfLinks(m_destination / L"Folder" / L"Subfolder" / L"File.txt"), 2u);
+	EXPECT_FALSE(std::filesystem::is_symlink(m_destination / L"Folder"));
+}
+
+TEST_F(LinkCreationTest, Junction)
+{
+	std::vector<std::wstring> targetPaths = { (m_source / L"Folder").wstring() };
+
+	auto result = CreateLinks(targetPaths, m_destination.wstring(), LinkType::Junction);
+	EXPECT_EQ(result.itemsCreated, 1);
+	EXPECT_EQ(result.itemsFailed, 0);
+
+	DWORD attributes = GetFileAttributes((m_destination / L"Folder").c_str());
+	ASSERT_NE(attributes, INVALID_FILE_ATTRIBUTES);
+	EXPECT_TRUE(attributes & FILE_ATTRIBUTE_REPARSE_POINT);
+	EXPECT_TRUE(std::filesystem::exists(m_destination / L"Folder" / L"Subfolder" / L"File.txt"));
+
+	// Removing the junction shouldn't affect the target.
+	EXPECT_TRUE(RemoveDirectory((m_destination / L"Folder").c_str()));
+	EXPECT_TRUE(std::filesystem::exists(m_source / L"Folder" / L"File.txt"));
+}
+
+TEST_F(LinkCreationTest, JunctionToFile)
+{
+	std::vector<std::wstring> targetPaths = { (m_source / L"File.txt").wstring() };
+
+	auto result = CreateLinks(targetPaths, m_destination.wstring(), LinkType::Junction);
+	EXPECT_EQ(result.itemsCreated, 0);
+	EXPECT_EQ(result.itemsFailed, 1);
+	EXPECT_EQ(result.firstError, static_cast<DWORD>(ERROR_DIRECTORY));
+	EXPECT_FALSE(std::filesystem::exists(m_destination / L"File.txt"));
+}
+
+TEST_F(LinkCreationTest, Errors)
+{
+	std::vector<std::wstring> targetPaths = { (m_source / L"File.txt").wstring(),
+		(m_source / L"Missing.txt").wstring() };
+
+	auto result = CreateLinks(targetPaths, m_destination.wstring(), LinkType::HardLink);
+	EXPECT_EQ(result.itemsCreated, 1);
+	EXPECT_EQ(result.itemsFailed, 1);
+	EXPECT_EQ(result.firstError, static_cast<DWORD>(ERROR_FILE_NOT_FOUND));
+	EXPECT_NE(result.firstFailedPath.find(L"Missing.txt"), std::wstring::npos);
+}
\ No newline at end of file
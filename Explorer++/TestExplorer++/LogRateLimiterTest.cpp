@@ -0,0 +1,41 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/LogRateLimiter.h"
+#include <gtest/gtest.h>
+
+using namespace std::chrono_literals;
+
+TEST(LogRateLimiterTest, OneMessagePerInterval)
+{
+	LogRateLimiter rateLimiter(10s);
+	LogRateLimiter::Clock::time_point now;
+
+	EXPECT_TRUE(rateLimiter.ShouldLog(now));
+	EXPECT_FALSE(rateLimiter.ShouldLog(now));
+	EXPECT_FALSE(rateLimiter.ShouldLog(now + 9s));
+
+	EXPECT_TRUE(rateLimiter.ShouldLog(now + 10s));
+	EXPECT_FALSE(rateLimiter.ShouldLog(now + 15s));
+	EXPECT_TRUE(rateLimiter.ShouldLog(now + 20s));
+}
+
+TEST(LogRateLimiterTest, SuppressedCount)
+{
+	LogRateLimiter rateLimiter(10s);
+	LogRateLimiter::Clock::time_point now;
+
+	EXPECT_TRUE(rateLimiter.ShouldLog(now));
+	EXPECT_EQ(rateLimiter.TakeSuppressedCount(), 0U);
+
+	EXPECT_FALSE(rateLimiter.ShouldLog(now + 1s));
+	EXPECT_FALSE(rateLimiter.ShouldLog(now + 2s));
+	EXPECT_FALSE(rateLimiter.ShouldLog(now + 3s));
+
+	EXPECT_TRUE(rateLimiter.ShouldLog(now + 10s));
+	EXPECT_EQ(rateLimiter.TakeSuppressedCount(), 3U);
+
+	// The count should be reset once it's been retrieved.
+	EXPECT_EQ(rateLimiter.TakeSuppressedCount(), 0U);
+}
\ No newline at end of file
@@ -0,0 +1,114 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/LruSlotAllocator.h"
+#include <gtest/gtest.h>
+
+TEST(LruSlotAllocatorTest, AllocateFreeSlots)
+{
+	LruSlotAllocator allocator(2);
+
+	auto allocation1 = allocator.Allocate(10);
+	ASSERT_TRUE(allocation1);
+	EXPECT_EQ(allocation1->slot, 0);
+	EXPECT_EQ(allocation1->evictedOwner, std::nullopt);
+
+	auto allocation2 = allocator.Allocate(20);
+	ASSERT_TRUE(allocation2);
+	EXPECT_EQ(allocation2->slot, 1);
+	EXPECT_EQ(allocation2->evictedOwner, std::nullopt);
+
+	EXPECT_EQ(allocator.GetSlot(10), 0);
+	EXPECT_EQ(allocator.GetSlot(20), 1);
+	EXPECT_EQ(allocator.GetSlot(30), std::nullopt);
+}
+
+TEST(LruSlotAllocatorTest, ExistingOwner)
+{
+	LruSlotAllocator allocator(2);
+	allocator.Allocate(10);
+
+	auto allocation = allocator.Allocate(10);
+	ASSERT_TRUE(allocation);
+	EXPECT_EQ(allocation->slot, 0);
+	EXPECT_EQ(allocation->evictedOwner, std::nullopt);
+}
+
+TEST(LruSlotAllocatorTest, EvictLeastRecentlyUsed)
+{
+	LruSlotAllocator allocator(2);
+	allocator.Allocate(10);
+	allocator.Allocate(20);
+
+	// Owner 10 is now the most recently used, so owner 20 should be evicted.
+	allocator.Allocate(10);
+
+	auto allocation = allocator.Allocate(30);
+	ASSERT_TRUE(allocation);
+	EXPECT_EQ(allocation->slot, 1);
+	EXPECT_EQ(allocation->evictedOwner, 20);
+	EXPECT_EQ(allocator.GetSlot(20), std::nullopt);
+	EXPECT_EQ(allocator.GetSlot(30), 1);
+}
+
+TEST(LruSlotAllocatorTest, CanEvictCallback)
+{
+	LruSlotAllocator allocator(2);
+	allocator.Allocate(10);
+	allocator.Allocate(20);
+
+	auto allocation = allocator.Allocate(30, [](int owner) { return owner != 10; });
+	ASSERT_TRUE(allocation);
+	EXPECT_EQ(allocation->evictedOwner, 20);
+
+	allocation = allocator.Allocate(40, [](int) { return false; });
+	EXPECT_EQ(allocation, std::nullopt);
+}
+
+TEST(LruSlotAllocatorTest, Release)
+{
+	LruSlotAllocator allocator(1);
+	allocator.Allocate(10);
+	allocator.Release(10);
+
+	EXPECT_EQ(allocator.GetSlot(10), std::nullopt);
+
+	auto allocation = allocator.Allocate(20);
+	ASSERT_TRUE(allocation);
+	EXPECT_EQ(allocation->slot, 0);
+	EXPECT_EQ(allocation->evictedOwner, std::nullopt);
+}
+
+TEST(LruSlotAllocatorTest, Clear)
+{
+	LruSlotAllocator allocator(2);
+	allocator.Allocate(10);
+	allocator.Allocate(20);
+	allocator.Clear();
+
+	EXPECT_EQ(allocator.GetSlot(10), std::nullopt);
+	EXPECT_EQ(allocator.GetSlot(20), std::nullopt);
+
+	auto allocation = allocator.Allocate(30);
+	ASSERT_TRUE(allocation);
+	EXPECT_EQ(allocation->slot, 0);
+}
+
+TEST(LruSlotAllocatorTest, Reset)
+{
+	LruSlotAllocator allocator(1);
+	allocator.Allocate(10);
+	allocator.Reset(3);
+
+	EXPECT_EQ(allocator.GetCapacity(), 3);
+	EXPECT_EQ(allocator.GetSlot(10), std::nullopt);
+
+	for (int i = 0; i < 3; i++)
+	{
+		auto allocation = allocator.Allocate(20 + i);
+		ASSERT_TRUE(allocation);
+		EXPECT_EQ(allocation->slot, i);
+		EXPECT_EQ(allocation->evictedOwner, std::nullopt);
+	}
+}
\ No newline at end of file
@@ -25,4 +25,52 @@ TEST(ManifestTest, TestParsing)
 	EXPECT_EQ(manifest.file, L"plugin.lua");
 	EXPECT_EQ(manifest.version, L"1.0");
 	EXPECT_EQ(manifest.author, L"John Smith");
+}
+
+TEST(ManifestTest, MemorySettings)
+{
+	// clang-format off
+	nlohmann::json json = {
+		{"name", "Test plugin"},
+		{"file", "plugin.lua"},
+		{"version", "1.0"}
+	};
+	// clang-format on
+
+	Plugins::Manifest manifest = json.get<Plugins::Manifest>();
+
+	EXPECT_EQ(manifest.memory.softLimit, Plugins::MemorySettings::DEFAULT_SOFT_LIMIT);
+	EXPECT_EQ(manifest.memory.hardLimit, Plugins::MemorySettings::DEFAULT_HARD_LIMIT);
+	EXPECT_FALSE(manifest.memory.gcPause);
+	EXPECT_FALSE(manifest.memory.gcStepMultiplier);
+
+	// clang-format off
+	json["memory"] = {
+		{"soft_limit_mb", 8},
+		{"hard_limit_mb", 16},
+		{"gc_pause", 150},
+		{"gc_step_multiplier", 400}
+	};
+	// clang-format on
+
+	manifest = json.get<Plugins::Manifest>();
+
+	EXPECT_EQ(manifest.memory.softLimit, 8U * 1024 * 1024);
+	EXPECT_EQ(manifest.memory.hardLimit, 16U * 1024 * 1024);
+	EXPECT_EQ(manifest.memory.gcPause, 150);
+	EXPECT_EQ(manifest.memory.gcStepMultiplier, 400);
+
+	// The soft limit can't exceed the hard limit and the hard limit itself is
+	// capped.
+	// clang-format off
+	json["memory"] = {
+		{"soft_limit_mb", 1000000},
+		{"hard_limit_mb", 1000000}
+	};
+	// clang-format on
+
+	manifest = json.get<Plugins::Manifest>();
+
+	EXPECT_EQ(manifest.memory.hardLimit, Plugins::MemorySettings::MAX_HARD_LIMIT);
+	EXPECT_EQ(manifest.memory.softLimit, Plugins::MemorySettings::MAX_HARD_LIMIT);
 }
\ No newline at end of file
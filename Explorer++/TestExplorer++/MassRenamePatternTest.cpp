@@ -0,0 +1,41 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Explorer++/MassRenamePattern.h"
+#include <gtest/gtest.h>
+
+TEST(MassRenamePatternTest, Literal)
+{
+	MassRenamePattern pattern(L"new name");
+	EXPECT_EQ(pattern.Apply(L"file.txt", 0), L"new name");
+}
+
+TEST(MassRenamePatternTest, FilenameParts)
+{
+	MassRenamePattern pattern(L"/B - copy/E");
+	EXPECT_EQ(pattern.Apply(L"file.txt", 0), L"file - copy.txt");
+	EXPECT_EQ(pattern.Apply(L"archive.tar.gz", 0), L"archive.tar - copy.gz");
+	EXPECT_EQ(pattern.Apply(L"README", 0), L"README - copy");
+
+	MassRenamePattern filenamePattern(L"/F/F");
+	EXPECT_EQ(filenamePattern.Apply(L"file.txt", 0), L"file.txtfile.txt");
+}
+
+TEST(MassRenamePatternTest, Counter)
+{
+	MassRenamePattern pattern(L"/N");
+	EXPECT_EQ(pattern.Apply(L"file.txt", 7), L"7");
+	EXPECT_EQ(pattern.Apply(L"file.txt", 123), L"123");
+
+	// Each zero increases the minimum width by one.
+	MassRenamePattern paddedPattern(L"image /00N/E");
+	EXPECT_EQ(paddedPattern.Apply(L"photo.jpg", 7), L"image 007.jpg");
+	EXPECT_EQ(paddedPattern.Apply(L"photo.jpg", 1234), L"image 1234.jpg");
+}
+
+TEST(MassRenamePatternTest, UnrecognizedSequences)
+{
+	MassRenamePattern pattern(L"a/b/0F/");
+	EXPECT_EQ(pattern.Apply(L"file.txt", 0), L"a/b/0F/");
+}
\ No newline at end of file
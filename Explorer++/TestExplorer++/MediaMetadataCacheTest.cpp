@@ -0,0 +1,91 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Explorer++/ShellBrowser/MediaMetadataCache.h"
+#include <gtest/gtest.h>
+#include <map>
+
+class MediaMetadataCacheTest : public testing::Test
+{
+protected:
+	MediaMetadataCacheTest() :
+		m_cache(
+			[this](const std::wstring &path)
+			{
+				m_reads[path]++;
+
+				MediaMetadataCache::MediaMetadata metadata;
+				metadata[MediaMetadataType::AlbumTitle] = L"Album " + std::to_wstring(m_reads[path]);
+				metadata[MediaMetadataType::Genre] = L"Jazz";
+				return metadata;
+			})
+	{
+	}
+
+	std::map<std::wstring, int> m_reads;
+
+	MediaMetadataCache m_cache;
+};
+
+TEST_F(MediaMetadataCacheTest, FileReadOnceForAllTypes)
+{
+	FILETIME lastWriteTime = { 1, 0 };
+
+	EXPECT_EQ(m_cache.GetMetadataText(L"C:\\music\\track.mp3", lastWriteTime,
+				  MediaMetadataType::AlbumTitle),
+		L"Album 1");
+	EXPECT_EQ(m_cache.GetMetadataText(L"C:\\music\\track.mp3", lastWriteTime,
+				  MediaMetadataType::Genre),
+		L"Jazz");
+
+	// Types the file doesn't have are also answered from the cached entry.
+	EXPECT_EQ(m_cache.GetMetadataText(L"C:\\music\\track.mp3", lastWriteTime,
+				  MediaMetadataType::Composer),
+		L"");
+
+	// Paths are compared case-insensitively.
+	EXPECT_EQ(m_cache.GetMetadataText(L"C:\\MUSIC\\TRACK.MP3", lastWriteTime,
+				  MediaMetadataType::AlbumTitle),
+		L"Album 1");
+
+	EXPECT_EQ(m_reads[L"C:\\music\\track.mp3"], 1);
+	EXPECT_EQ(m_reads[L"C:\\MUSIC\\TRACK.MP3"], 0);
+}
+
+TEST_F(MediaMetadataCacheTest, ModifiedFileReadAgain)
+{
+	FILETIME lastWriteTime = { 1, 0 };
+	FILETIME updatedLastWriteTime = { 2, 0 };
+
+	EXPECT_EQ(m_cache.GetMetadataText(L"C:\\music\\track.mp3", lastWriteTime,
+				  MediaMetadataType::AlbumTitle),
+		L"Album 1");
+	EXPECT_EQ(m_cache.GetMetadataText(L"C:\\music\\track.mp3", updatedLastWriteTime,
+				  MediaMetadataType::AlbumTitle),
+		L"Album 2");
+	EXPECT_EQ(m_cache.GetMetadataText(L"C:\\music\\track.mp3", updatedLastWriteTime,
+				  MediaMetadataType::AlbumTitle),
+		L"Album 2");
+
+	EXPECT_EQ(m_reads[L"C:\\music\\track.mp3"], 2);
+}
+
+TEST_F(MediaMetadataCacheTest, NotCachedWithoutLastWriteTime)
+{
+	m_cache.GetMetadataText(L"C:\\music\\track.mp3", std::nullopt, MediaMetadataType::AlbumTitle);
+	m_cache.GetMetadataText(L"C:\\music\\track.mp3", std::nullopt, MediaMetadataType::AlbumTitle);
+
+	EXPECT_EQ(m_reads[L"C:\\music\\track.mp3"], 2);
+}
+
+TEST_F(MediaMetadataCacheTest, Clear)
+{
+	FILETIME lastWriteTime = { 1, 0 };
+
+	m_cache.GetMetadataText(L"C:\\music\\track.mp3", lastWriteTime, MediaMetadataType::Genre);
+	m_cache.Clear();
+	m_cache.GetMetadataText(L"C:\\music\\track.mp3", lastWriteTime, MediaMetadataType::Genre);
+
+	EXPECT_EQ(m_reads[L"C:\\music\\track.mp3"], 2);
+}
\ No newline at end of file
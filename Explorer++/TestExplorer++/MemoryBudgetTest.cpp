@@ -0,0 +1,127 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/MemoryBudget.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+// A consumer whose usage is simply a number of bytes, which is reduced when it's trimmed.
+struct TestConsumer
+{
+	TestConsumer(MemoryBudget &memoryBudget, MemoryBudget::Priority priority, size_t usage,
+		std::vector<std::wstring> &trimOrder, const std::wstring &name) :
+		usage(usage)
+	{
+		id = memoryBudget.AddConsumer(
+			priority, [this] { return this->usage; },
+			[this, &trimOrder, name](size_t maxBytes)
+			{
+				this->usage = (std::min)(this->usage, maxBytes);
+				trimOrder.push_back(name);
+			});
+	}
+
+	int id;
+	size_t usage;
+};
+
+}
+
+TEST(MemoryBudgetTest, Usage)
+{
+	MemoryBudget memoryBudget(1000);
+	std::vector<std::wstring> trimOrder;
+
+	TestConsumer icons(memoryBudget, MemoryBudget::Priority::Icons, 100, trimOrder, L"icons");
+	TestConsumer thumbnails(
+		memoryBudget, MemoryBudget::Priority::Thumbnails, 200, trimOrder, L"thumbnails");
+	TestConsumer moreIcons(memoryBudget, MemoryBudget::Priority::Icons, 50, trimOrder, L"icons");
+
+	EXPECT_EQ(memoryBudget.GetUsage(), 350U);
+	EXPECT_EQ(memoryBudget.GetUsage(MemoryBudget::Priority::Icons), 150U);
+	EXPECT_EQ(memoryBudget.GetUsage(MemoryBudget::Priority::ColumnText), 0U);
+
+	memoryBudget.RemoveConsumer(icons.id);
+	EXPECT_EQ(memoryBudget.GetUsage(), 250U);
+}
+
+TEST(MemoryBudgetTest, TrimInPriorityOrder)
+{
+	MemoryBudget memoryBudget(1000);
+	std::vector<std::wstring> trimOrder;
+
+	// The consumers are added in a different order to the order in which they should be trimmed.
+	TestConsumer columnText(
+		memoryBudget, MemoryBudget::Priority::ColumnText, 100, trimOrder, L"columnText");
+	TestConsumer icons(memoryBudget, MemoryBudget::Priority::Icons, 100, trimOrder, L"icons");
+	TestConsumer snapshots(
+		memoryBudget, MemoryBudget::Priority::FolderSnapshots, 100, trimOrder, L"snapshots");
+	TestConsumer thumbnails(
+		memoryBudget, MemoryBudget::Priority::Thumbnails, 100, trimOrder, L"thumbnails");
+
+	EXPECT_EQ(memoryBudget.TrimToSize(0), 400U);
+	EXPECT_EQ(trimOrder,
+		(std::vector<std::wstring>{ L"snapshots", L"thumbnails", L"icons", L"columnText" }));
+}
+
+TEST(MemoryBudgetTest, TrimStopsOnceUnderLimit)
+{
+	MemoryBudget memoryBudget(1000);
+	std::vector<std::wstring> trimOrder;
+
+	TestConsumer snapshots(
+		memoryBudget, MemoryBudget::Priority::FolderSnapshots, 100, trimOrder, L"snapshots");
+	TestConsumer thumbnails(
+		memoryBudget, MemoryBudget::Priority::Thumbnails, 300, trimOrder, L"thumbnails");
+	TestConsumer icons(memoryBudget, MemoryBudget::Priority::Icons, 100, trimOrder, L"icons");
+
+	// Releasing 250 bytes requires all the snapshots to be removed, along with some of the
+	// thumbnails. The icons don't need to be trimmed.
+	EXPECT_EQ(memoryBudget.TrimToSize(250), 250U);
+	EXPECT_EQ(snapshots.usage, 0U);
+	EXPECT_EQ(thumbnails.usage, 150U);
+	EXPECT_EQ(icons.usage, 100U);
+	EXPECT_EQ(trimOrder, (std::vector<std::wstring>{ L"snapshots", L"thumbnails" }));
+}
+
+TEST(MemoryBudgetTest, OverBudget)
+{
+	MemoryBudget memoryBudget(1000);
+	std::vector<std::wstring> trimOrder;
+
+	TestConsumer thumbnails(
+		memoryBudget, MemoryBudget::Priority::Thumbnails, 300, trimOrder, L"thumbnails");
+
+	// Under budget, so nothing should be trimmed.
+	EXPECT_EQ(memoryBudget.OnMemoryPressure(900, false), 0U);
+	EXPECT_TRUE(trimOrder.empty());
+
+	EXPECT_EQ(memoryBudget.OnMemoryPressure(1100, false), 100U);
+	EXPECT_EQ(thumbnails.usage, 200U);
+
+	// The consumers can only release the memory they use.
+	EXPECT_EQ(memoryBudget.OnMemoryPressure(5000, false), 200U);
+	EXPECT_EQ(thumbnails.usage, 0U);
+}
+
+TEST(MemoryBudgetTest, LowMemory)
+{
+	MemoryBudget memoryBudget(1000);
+	std::vector<std::wstring> trimOrder;
+
+	TestConsumer thumbnails(
+		memoryBudget, MemoryBudget::Priority::Thumbnails, 300, trimOrder, L"thumbnails");
+	TestConsumer icons(memoryBudget, MemoryBudget::Priority::Icons, 100, trimOrder, L"icons");
+
+	// Even though the process is under budget, half the memory used by the consumers should be
+	// released.
+	EXPECT_EQ(memoryBudget.OnMemoryPressure(500, true), 200U);
+	EXPECT_EQ(thumbnails.usage, 100U);
+	EXPECT_EQ(icons.usage, 100U);
+}
\ No newline at end of file
@@ -0,0 +1,67 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/NetworkLocationPolicy.h"
+#include <gtest/gtest.h>
+
+using namespace std::chrono_literals;
+
+TEST(NetworkLocationPolicyTest, GetServerNameFromUncPath)
+{
+	EXPECT_EQ(NetworkLocationPolicy::GetServerNameFromUncPath(L"\\\\server\\share\\folder"),
+		L"SERVER");
+	EXPECT_EQ(NetworkLocationPolicy::GetServerNameFromUncPath(L"\\\\Server"), L"SERVER");
+	EXPECT_EQ(NetworkLocationPolicy::GetServerNameFromUncPath(L"\\\\?\\UNC\\server\\share"),
+		L"SERVER");
+
+	EXPECT_EQ(NetworkLocationPolicy::GetServerNameFromUncPath(L"C:\\Windows"), L"");
+	EXPECT_EQ(NetworkLocationPolicy::GetServerNameFromUncPath(L"\\\\?\\C:\\Windows"), L"");
+	EXPECT_EQ(NetworkLocationPolicy::GetServerNameFromUncPath(L"\\\\.\\PhysicalDrive0"), L"");
+	EXPECT_EQ(NetworkLocationPolicy::GetServerNameFromUncPath(
+				  L"::{20D04FE0-3AEA-1069-A2D8-08002B30309D}"),
+		L"");
+}
+
+TEST(NetworkLocationPolicyTest, IsReduced)
+{
+	auto &policy = NetworkLocationPolicy::GetInstance();
+	const std::wstring server = L"TESTSERVER";
+
+	EXPECT_EQ(policy.GetMode(server), NetworkLocationMode::Automatic);
+	EXPECT_FALSE(policy.IsReduced(server, std::nullopt));
+	EXPECT_FALSE(policy.IsReduced(server, 10ms));
+	EXPECT_TRUE(policy.IsReduced(server, 500ms));
+
+	policy.SetMode(server, NetworkLocationMode::Full);
+	EXPECT_FALSE(policy.IsReduced(server, 500ms));
+
+	policy.SetMode(server, NetworkLocationMode::Reduced);
+	EXPECT_TRUE(policy.IsReduced(server, std::nullopt));
+
+	policy.SetMode(server, NetworkLocationMode::Automatic);
+	EXPECT_EQ(policy.GetMode(server), NetworkLocationMode::Automatic);
+}
+TEST(NetworkLocationPolicyTest, UnreachableServers)
+{
+	auto &policy = NetworkLocationPolicy::GetInstance();
+	const std::wstring server = L"UNREACHABLESERVER";
+
+	EXPECT_FALSE(policy.IsServerUnreachable(server));
+
+	policy.OnServerUnreachable(server);
+	EXPECT_TRUE(policy.IsServerUnreachable(server));
+	EXPECT_FALSE(policy.IsServerUnreachable(L"OTHERSERVER"));
+
+	policy.OnServerReachable(server);
+	EXPECT_FALSE(policy.IsServerUnreachable(server));
+}
+
+TEST(NetworkLocationPolicyTest, IsServerUnreachableError)
+{
+	EXPECT_TRUE(NetworkLocationPolicy::IsServerUnreachableError(
+		HRESULT_FROM_WIN32(ERROR_BAD_NETPATH)));
+	EXPECT_FALSE(NetworkLocationPolicy::IsServerUnreachableError(
+		HRESULT_FROM_WIN32(ERROR_BAD_NET_NAME)));
+	EXPECT_FALSE(NetworkLocationPolicy::IsServerUnreachableError(E_ACCESSDENIED));
+}
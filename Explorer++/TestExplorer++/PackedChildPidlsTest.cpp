@@ -0,0 +1,71 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/PackedChildPidls.h"
+#include <gtest/gtest.h>
+
+using namespace testing;
+
+TEST(PackedChildPidlsTest, Empty)
+{
+	PackedChildPidls packedPidls;
+	EXPECT_TRUE(packedPidls.IsEmpty());
+	EXPECT_EQ(packedPidls.GetCount(), 0U);
+	EXPECT_TRUE(packedPidls.GetPidls().empty());
+
+	PackedChildPidls packedEmptyList(std::vector<PCITEMID_CHILD>{});
+	EXPECT_TRUE(packedEmptyList.IsEmpty());
+}
+
+TEST(PackedChildPidlsTest, RoundTrip)
+{
+	std::vector<unique_pidl_absolute> pidls;
+
+	for (const auto *path : { L"C:\\Fake\\Item1", L"C:\\Fake\\Item2.txt",
+			 L"C:\\Fake\\An item with a longer name" })
+	{
+		unique_pidl_absolute pidl(SHSimpleIDListFromPath(path));
+		ASSERT_NE(pidl, nullptr);
+		pidls.push_back(std::move(pidl));
+	}
+
+	std::vector<PCITEMID_CHILD> childPidls;
+
+	for (const auto &pidl : pidls)
+	{
+		childPidls.push_back(ILFindLastID(pidl.get()));
+	}
+
+	PackedChildPidls packedPidls(childPidls);
+	EXPECT_FALSE(packedPidls.IsEmpty());
+	EXPECT_EQ(packedPidls.GetCount(), childPidls.size());
+
+	auto unpackedPidls = packedPidls.GetPidls();
+	ASSERT_EQ(unpackedPidls.size(), childPidls.size());
+
+	for (size_t i = 0; i < childPidls.size(); i++)
+	{
+		ASSERT_EQ(ILGetSize(unpackedPidls[i]), ILGetSize(childPidls[i]));
+		EXPECT_EQ(memcmp(unpackedPidls[i], childPidls[i], ILGetSize(childPidls[i])), 0);
+	}
+}
+
+TEST(PackedChildPidlsTest, Copy)
+{
+	unique_pidl_absolute pidl(SHSimpleIDListFromPath(L"C:\\Fake\\Item"));
+	ASSERT_NE(pidl, nullptr);
+
+	std::vector<PCITEMID_CHILD> childPidls = { ILFindLastID(pidl.get()) };
+	PackedChildPidls packedPidls(childPidls);
+	PackedChildPidls copy = packedPidls;
+
+	auto originalPidls = packedPidls.GetPidls();
+	auto copiedPidls = copy.GetPidls();
+	ASSERT_EQ(copiedPidls.size(), 1U);
+
+	// The copy has its own storage.
+	EXPECT_NE(copiedPidls[0], originalPidls[0]);
+	EXPECT_EQ(ILGetSize(copiedPidls[0]), ILGetSize(originalPidls[0]));
+	EXPECT_EQ(memcmp(copiedPidls[0], originalPidls[0], ILGetSize(originalPidls[0])), 0);
+}
\ No newline at end of file
@@ -0,0 +1,178 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/ParallelWalk.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <thread>
+
+namespace
+{
+
+// Each item n has the children 2n + 1 and 2n + 2, which produces a complete binary tree.
+const int NUM_ITEMS = 10000;
+
+}
+
+TEST(ParallelWalkTest, ProcessesEachItemOnce)
+{
+	std::mutex mutex;
+	std::multiset<int> processedItems;
+
+	ParallelWalk<int>::Run(0, [&mutex, &processedItems](const int &item, auto &worker) {
+		{
+			std::scoped_lock lock(mutex);
+			processedItems.insert(item);
+		}
+
+		for (int child : { 2 * item + 1, 2 * item + 2 })
+		{
+			if (child < NUM_ITEMS)
+			{
+				worker.AddItem(child);
+			}
+		}
+	});
+
+	ASSERT_EQ(processedItems.size(), static_cast<size_t>(NUM_ITEMS));
+
+	int expectedItem = 0;
+
+	for (int item : processedItems)
+	{
+		EXPECT_EQ(item, expectedItem++);
+	}
+}
+
+TEST(ParallelWalkTest, MultipleRoots)
+{
+	std::mutex mutex;
+	std::multiset<int> processedItems;
+
+	ParallelWalk<int>::Run(std::vector<int>{ 1, 2, 3 },
+		[&mutex, &processedItems](const int &item, auto &worker) {
+			{
+				std::scoped_lock lock(mutex);
+				processedItems.insert(item);
+			}
+
+			if (item < 10)
+			{
+				worker.AddItem(item * 10);
+			}
+		});
+
+	EXPECT_EQ(processedItems, (std::multiset<int>{ 1, 2, 3, 10, 20, 30 }));
+
+	bool processed = false;
+	ParallelWalk<int>::Run(
+		std::vector<int>{}, [&processed](const int &, auto &) { processed = true; });
+	EXPECT_FALSE(processed);
+}
+
+TEST(ParallelWalkTest, UsesMultipleThreads)
+{
+	std::mutex mutex;
+	std::set<std::thread::id> threadIds;
+
+	ParallelWalk<int>::Run(0, [&mutex, &threadIds](const int &item, auto &worker) {
+		{
+			std::scoped_lock lock(mutex);
+			threadIds.insert(std::this_thread::get_id());
+		}
+
+		// Each item takes long enough that idle threads will take the queued items.
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+		for (int child : { 2 * item + 1, 2 * item + 2 })
+		{
+			if (child < 255)
+			{
+				worker.AddItem(child);
+			}
+		}
+	});
+
+	EXPECT_GT(threadIds.size(), 1U);
+}
+
+TEST(ParallelWalkTest, MaxThreads)
+{
+	std::mutex mutex;
+	std::set<std::thread::id> threadIds;
+
+	ParallelWalk<int>::Run(
+		0,
+		[&mutex, &threadIds](const int &item, auto &worker) {
+			{
+				std::scoped_lock lock(mutex);
+				threadIds.insert(std::this_thread::get_id());
+			}
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+			for (int child : { 2 * item + 1, 2 * item + 2 })
+			{
+				if (child < 255)
+				{
+					worker.AddItem(child);
+				}
+			}
+		},
+		{}, nullptr, ParallelWalk<int>::DEFAULT_PERIODIC_INTERVAL, 1);
+
+	// With a single thread allowed, every item is processed on the calling thread.
+	EXPECT_EQ(threadIds, (std::set<std::thread::id>{ std::this_thread::get_id() }));
+}
+
+TEST(ParallelWalkTest, Stop)
+{
+	std::stop_source stopSource;
+	std::atomic<int> numProcessed = 0;
+
+	ParallelWalk<int>::Run(
+		0,
+		[&stopSource, &numProcessed](const int &item, auto &worker) {
+			if (++numProcessed == 100)
+			{
+				stopSource.request_stop();
+			}
+
+			// Without the stop, this would never finish.
+			worker.AddItem(item + 1);
+			worker.AddItem(item + 2);
+		},
+		stopSource.get_token());
+
+	// Each thread may have been about to take another item when the stop was requested.
+	EXPECT_GE(numProcessed, 100);
+	EXPECT_LE(numProcessed, 100 + 2 * (GetParallelWalkThreadPool().size() + 1));
+}
+
+TEST(ParallelWalkTest, PeriodicCallback)
+{
+	int numCallbacks = 0;
+	std::thread::id callingThreadId = std::this_thread::get_id();
+
+	ParallelWalk<int>::Run(
+		0,
+		[](const int &item, auto &worker) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+			if (item < 20)
+			{
+				worker.AddItem(item + 1);
+			}
+		},
+		{},
+		[&numCallbacks, callingThreadId]() {
+			EXPECT_EQ(std::this_thread::get_id(), callingThreadId);
+			numCallbacks++;
+		},
+		std::chrono::milliseconds(20));
+
+	EXPECT_GT(numCallbacks, 0);
+}
\ No newline at end of file
@@ -0,0 +1,130 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/ParsedPathCache.h"
+#include <gtest/gtest.h>
+#include <map>
+
+class ParsedPathCacheTest : public testing::Test
+{
+protected:
+	ParsedPathCacheTest() :
+		m_cache(MAX_ENTRIES,
+			[this](const std::wstring &path, PIDLIST_ABSOLUTE *pidl)
+			{
+				m_parses[path]++;
+
+				if (path.starts_with(L"X:\\"))
+				{
+					return HRESULT_FROM_WIN32(ERROR_PATH_NOT_FOUND);
+				}
+
+				*pidl = SHSimpleIDListFromPath(path.c_str());
+				return *pidl ? S_OK : E_FAIL;
+			})
+	{
+	}
+
+	static constexpr size_t MAX_ENTRIES = 3;
+
+	std::wstring ParsePath(const std::wstring &path)
+	{
+		unique_pidl_absolute pidl;
+		HRESULT hr = m_cache.ParsePath(path, wil::out_param(pidl));
+
+		if (FAILED(hr))
+		{
+			return {};
+		}
+
+		std::wstring parsingPath;
+		GetDisplayName(pidl.get(), SHGDN_FORPARSING, parsingPath);
+		return parsingPath;
+	}
+
+	ParsedPathCache m_cache;
+	std::map<std::wstring, int> m_parses;
+};
+
+TEST_F(ParsedPathCacheTest, ParsePath)
+{
+	EXPECT_EQ(ParsePath(L"C:\\Fake\\Folder"), L"C:\\Fake\\Folder");
+	EXPECT_EQ(ParsePath(L"C:\\Fake\\Folder"), L"C:\\Fake\\Folder");
+
+	// Paths should be compared case-insensitively, ignoring any trailing backslash.
+	EXPECT_EQ(ParsePath(L"c:\\fake\\folder\\"), L"C:\\Fake\\Folder");
+
+	EXPECT_EQ(m_parses[L"C:\\Fake\\Folder"], 1);
+	EXPECT_EQ(m_cache.GetSize(), 1U);
+}
+
+TEST_F(ParsedPathCacheTest, FailuresNotCached)
+{
+	EXPECT_EQ(ParsePath(L"X:\\Missing"), L"");
+	EXPECT_EQ(ParsePath(L"X:\\Missing"), L"");
+
+	EXPECT_EQ(m_parses[L"X:\\Missing"], 2);
+	EXPECT_EQ(m_cache.GetSize(), 0U);
+}
+
+TEST_F(ParsedPathCacheTest, LeastRecentlyUsedEvicted)
+{
+	ParsePath(L"C:\\Fake\\1");
+	ParsePath(L"C:\\Fake\\2");
+	ParsePath(L"C:\\Fake\\3");
+
+	// This makes the second path the least recently used.
+	ParsePath(L"C:\\Fake\\1");
+
+	ParsePath(L"C:\\Fake\\4");
+	EXPECT_EQ(m_cache.GetSize(), MAX_ENTRIES);
+
+	ParsePath(L"C:\\Fake\\1");
+	ParsePath(L"C:\\Fake\\2");
+
+	EXPECT_EQ(m_parses[L"C:\\Fake\\1"], 1);
+	EXPECT_EQ(m_parses[L"C:\\Fake\\2"], 2);
+}
+
+TEST_F(ParsedPathCacheTest, ParseChildPath)
+{
+	WIN32_FIND_DATA wfd = {};
+	wcscpy_s(wfd.cFileName, L"file.txt");
+	wfd.dwFileAttributes = FILE_ATTRIBUTE_NORMAL;
+
+	for (int i = 0; i < 2; i++)
+	{
+		unique_pidl_absolute pidl;
+		ASSERT_HRESULT_SUCCEEDED(
+			m_cache.ParseChildPath(L"C:\\Fake\\Folder", wfd, wil::out_param(pidl)));
+
+		std::wstring parsingPath;
+		GetDisplayName(pidl.get(), SHGDN_FORPARSING, parsingPath);
+		EXPECT_EQ(parsingPath, L"C:\\Fake\\Folder\\file.txt");
+	}
+
+	// Only the parent folder should have been parsed.
+	EXPECT_EQ(m_parses.size(), 1U);
+	EXPECT_EQ(m_parses[L"C:\\Fake\\Folder"], 1);
+}
+
+TEST_F(ParsedPathCacheTest, InvalidateFolderContents)
+{
+	ParsePath(L"C:\\Fake");
+	ParsePath(L"C:\\Fake\\Folder");
+	ParsePath(L"C:\\Fake2");
+
+	m_cache.InvalidateFolderContents(L"C:\\Fake");
+
+	ParsePath(L"C:\\Fake");
+	ParsePath(L"C:\\Fake\\Folder");
+	ParsePath(L"C:\\Fake2");
+
+	EXPECT_EQ(m_parses[L"C:\\Fake"], 1);
+	EXPECT_EQ(m_parses[L"C:\\Fake\\Folder"], 2);
+	EXPECT_EQ(m_parses[L"C:\\Fake2"], 1);
+
+	m_cache.Clear();
+	EXPECT_EQ(m_cache.GetSize(), 0U);
+}
\ No newline at end of file
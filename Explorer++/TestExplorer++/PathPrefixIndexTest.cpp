@@ -0,0 +1,80 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/PathPrefixIndex.h"
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using namespace testing;
+
+TEST(PathPrefixIndexTest, GetChildren)
+{
+	PathPrefixIndex index;
+	index.AddPath(L"C:\\Windows");
+	index.AddPath(L"C:\\Users");
+	index.AddPath(L"D:\\Data");
+
+	EXPECT_THAT(index.GetChildren(L"C:\\", 10), ElementsAre(L"C:\\Users", L"C:\\Windows"));
+	EXPECT_THAT(index.GetChildren(L"D:", 10), ElementsAre(L"D:\\Data"));
+	EXPECT_THAT(index.GetChildren(L"E:\\", 10), IsEmpty());
+}
+
+TEST(PathPrefixIndexTest, IntermediateFoldersReturned)
+{
+	PathPrefixIndex index;
+	index.AddPath(L"C:\\Users\\Public\\Documents");
+	index.AddPath(L"C:\\Users\\Public\\Music");
+	index.AddPath(L"C:\\Users Old");
+
+	// Each child is only returned once, regardless of how many paths it appears in.
+	EXPECT_THAT(
+		index.GetChildren(L"C:\\", 10), UnorderedElementsAre(L"C:\\Users", L"C:\\Users Old"));
+	EXPECT_THAT(index.GetChildren(L"C:\\Users\\", 10), ElementsAre(L"C:\\Users\\Public"));
+	EXPECT_THAT(index.GetChildren(L"C:\\Users\\Public", 10),
+		ElementsAre(L"C:\\Users\\Public\\Documents", L"C:\\Users\\Public\\Music"));
+}
+
+TEST(PathPrefixIndexTest, CaseInsensitive)
+{
+	PathPrefixIndex index;
+	index.AddPath(L"C:\\Users\\Public");
+	index.AddPath(L"c:\\users\\public");
+
+	// The case of the path that was added first is retained.
+	EXPECT_EQ(index.GetNumPaths(), 1u);
+	EXPECT_THAT(index.GetChildren(L"c:\\USERS", 10), ElementsAre(L"C:\\Users\\Public"));
+}
+
+TEST(PathPrefixIndexTest, MaxResults)
+{
+	PathPrefixIndex index;
+	index.AddPath(L"C:\\Folder1");
+	index.AddPath(L"C:\\Folder2");
+	index.AddPath(L"C:\\Folder3");
+
+	EXPECT_THAT(index.GetChildren(L"C:\\", 2), ElementsAre(L"C:\\Folder1", L"C:\\Folder2"));
+}
+
+TEST(PathPrefixIndexTest, NetworkPaths)
+{
+	PathPrefixIndex index;
+	index.AddPath(L"\\\\server\\share\\folder");
+
+	EXPECT_THAT(index.GetChildren(L"\\\\server\\", 10), ElementsAre(L"\\\\server\\share"));
+	EXPECT_THAT(
+		index.GetChildren(L"\\\\server\\share", 10), ElementsAre(L"\\\\server\\share\\folder"));
+}
+
+TEST(PathPrefixIndexTest, ListedDirectories)
+{
+	PathPrefixIndex index;
+	index.AddListedDirectory(L"C:\\Windows\\");
+
+	EXPECT_TRUE(index.IsDirectoryListed(L"C:\\Windows"));
+	EXPECT_TRUE(index.IsDirectoryListed(L"c:\\windows\\"));
+	EXPECT_FALSE(index.IsDirectoryListed(L"C:\\"));
+
+	// The directory itself is also known.
+	EXPECT_THAT(index.GetChildren(L"C:\\", 10), ElementsAre(L"C:\\Windows"));
+}
\ No newline at end of file
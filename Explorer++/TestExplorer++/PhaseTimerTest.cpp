@@ -0,0 +1,51 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/PhaseTimer.h"
+#include <gtest/gtest.h>
+
+using namespace std::chrono_literals;
+
+class PhaseTimerTest : public testing::Test
+{
+protected:
+	PhaseTimerTest() : m_timer([this]() { return m_now; })
+	{
+	}
+
+	PhaseTimer::Clock::time_point m_now;
+	PhaseTimer m_timer;
+};
+
+TEST_F(PhaseTimerTest, Phases)
+{
+	m_now += 10ms;
+	m_timer.EndPhase(L"First");
+
+	m_now += 25ms;
+	m_timer.EndPhase(L"Second");
+
+	const auto &phases = m_timer.GetPhases();
+	ASSERT_EQ(phases.size(), 2U);
+	EXPECT_EQ(phases[0].name, L"First");
+	EXPECT_EQ(phases[0].duration, 10ms);
+	EXPECT_EQ(phases[1].name, L"Second");
+	EXPECT_EQ(phases[1].duration, 25ms);
+}
+
+TEST_F(PhaseTimerTest, TotalDuration)
+{
+	EXPECT_EQ(m_timer.GetTotalDuration(), 0ms);
+
+	m_now += 5ms;
+	m_timer.EndPhase(L"First");
+
+	m_now += 15ms;
+	m_timer.EndPhase(L"Second");
+
+	// Time that's passed since the last phase ended isn't included.
+	m_now += 100ms;
+
+	EXPECT_EQ(m_timer.GetTotalDuration(), 20ms);
+}
\ No newline at end of file
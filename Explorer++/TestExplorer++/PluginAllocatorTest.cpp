@@ -0,0 +1,91 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "Plugins/PluginAllocator.h"
+#include "SolWrapper.h"
+#include <gtest/gtest.h>
+#include <cstring>
+
+using namespace Plugins;
+
+TEST(PluginAllocatorTest, Accounting)
+{
+	PluginAllocator allocator(1024 * 1024, 4 * 1024 * 1024);
+
+	// When allocating a new block, Lua passes the object type in place of
+	// the old size.
+	void *small = allocator.reallocate(nullptr, LUA_TSTRING, 24);
+	void *large = allocator.reallocate(nullptr, LUA_TTABLE, 4096);
+	ASSERT_NE(small, nullptr);
+	ASSERT_NE(large, nullptr);
+
+	EXPECT_EQ(allocator.getStats().bytesInUse, 24U + 4096U);
+	EXPECT_EQ(allocator.getStats().numAllocations, 2U);
+
+	allocator.reallocate(small, 24, 0);
+	EXPECT_EQ(allocator.getStats().bytesInUse, 4096U);
+
+	allocator.reallocate(large, 4096, 0);
+	EXPECT_EQ(allocator.getStats().bytesInUse, 0U);
+	EXPECT_EQ(allocator.getStats().peakBytesInUse, 24U + 4096U);
+}
+
+TEST(PluginAllocatorTest, PooledBlocksReused)
+{
+	PluginAllocator allocator(1024 * 1024, 4 * 1024 * 1024);
+
+	void *block = allocator.reallocate(nullptr, 0, 40);
+	allocator.reallocate(block, 40, 0);
+
+	// Blocks in the same size class come from the same free list.
+	void *newBlock = allocator.reallocate(nullptr, 0, 48);
+	EXPECT_EQ(newBlock, block);
+
+	// Resizing within the size class leaves the block in place.
+	EXPECT_EQ(allocator.reallocate(newBlock, 48, 36), newBlock);
+	EXPECT_EQ(allocator.getStats().bytesInUse, 36U);
+
+	allocator.reallocate(newBlock, 36, 0);
+}
+
+TEST(PluginAllocatorTest, ResizePreservesContents)
+{
+	PluginAllocator allocator(1024 * 1024, 4 * 1024 * 1024);
+
+	auto *block = static_cast<char *>(allocator.reallocate(nullptr, 0, 16));
+	ASSERT_NE(block, nullptr);
+	memcpy(block, "0123456789abcde", 16);
+
+	// Small to large, then large to small.
+	block = static_cast<char *>(allocator.reallocate(block, 16, 2000));
+	ASSERT_NE(block, nullptr);
+	EXPECT_STREQ(block, "0123456789abcde");
+
+	block = static_cast<char *>(allocator.reallocate(block, 2000, 16));
+	ASSERT_NE(block, nullptr);
+	EXPECT_STREQ(block, "0123456789abcde");
+
+	allocator.reallocate(block, 16, 0);
+	EXPECT_EQ(allocator.getStats().bytesInUse, 0U);
+}
+
+TEST(PluginAllocatorTest, Limits)
+{
+	PluginAllocator allocator(1000, 2000);
+
+	void *block = allocator.reallocate(nullptr, 0, 1500);
+	ASSERT_NE(block, nullptr);
+	EXPECT_TRUE(allocator.isOverSoftLimit());
+
+	// Growth beyond the hard limit is refused, but shrinking always succeeds.
+	EXPECT_EQ(allocator.reallocate(nullptr, 0, 600), nullptr);
+	EXPECT_EQ(allocator.reallocate(block, 1500, 2500), nullptr);
+	EXPECT_EQ(allocator.getStats().numRefusedAllocations, 2U);
+
+	block = allocator.reallocate(block, 1500, 800);
+	ASSERT_NE(block, nullptr);
+	EXPECT_FALSE(allocator.isOverSoftLimit());
+
+	allocator.reallocate(block, 800, 0);
+}
\ No newline at end of file
@@ -0,0 +1,154 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "Plugins/PluginDirectoryWatcher.h"
+#include "Plugins/PluginEventQueue.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+
+using namespace Plugins;
+
+class PluginDirectoryWatcherTest : public testing::Test
+{
+protected:
+	PluginDirectoryWatcherTest() :
+		m_eventQueue([] {}),
+		m_watcher(&m_eventQueue, [this] { OnDeliveryScheduled(); })
+	{
+	}
+
+	void SetUp() override
+	{
+		m_directory = std::filesystem::temp_directory_path()
+			/ (L"PluginDirectoryWatcherTest" + std::to_wstring(GetCurrentProcessId()));
+		std::filesystem::create_directories(m_directory);
+
+		ASSERT_EQ(CreateDirectoryMonitor(&m_directoryMonitor), S_OK);
+	}
+
+	void TearDown() override
+	{
+		m_directoryMonitor->Release();
+		std::filesystem::remove_all(m_directory);
+	}
+
+	void OnDeliveryScheduled()
+	{
+		std::scoped_lock lock(m_mutex);
+		m_deliveryScheduled = true;
+		m_condition.notify_one();
+	}
+
+	bool WaitForDeliveryScheduled()
+	{
+		std::unique_lock lock(m_mutex);
+		bool scheduled = m_condition.wait_for(lock, std::chrono::seconds(5),
+			[this] { return m_deliveryScheduled; });
+		m_deliveryScheduled = false;
+		return scheduled;
+	}
+
+	// Delivers batches until one that mentions the specified item arrives.
+	std::optional<PluginDirectoryWatcher::Change> WaitForChange(const std::wstring &name)
+	{
+		while (WaitForDeliveryScheduled())
+		{
+			m_watcher.deliverChanges();
+			m_eventQueue.deliverEvents();
+
+			for (const auto &change : m_changes)
+			{
+				if (change.name == name)
+				{
+					return change;
+				}
+			}
+		}
+
+		return std::nullopt;
+	}
+
+	std::optional<int> AddWatch()
+	{
+		return m_watcher.addWatch(m_directoryMonitor, 1, m_directory.wstring(), false,
+			[this](int, const PluginDirectoryWatcher::ChangeBatch &batch) {
+				m_numBatches++;
+				m_changes.insert(m_changes.end(), batch.changes.begin(), batch.changes.end());
+			});
+	}
+
+	static void WriteTestFile(const std::filesystem::path &path)
+	{
+		std::ofstream stream(path, std::ios::binary);
+		stream << "contents";
+	}
+
+	std::filesystem::path m_directory;
+	IDirectoryMonitor *m_directoryMonitor = nullptr;
+
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	bool m_deliveryScheduled = false;
+
+	std::vector<PluginDirectoryWatcher::Change> m_changes;
+	int m_numBatches = 0;
+
+	PluginEventQueue m_eventQueue;
+	PluginDirectoryWatcher m_watcher;
+};
+
+TEST_F(PluginDirectoryWatcherTest, AddedItem)
+{
+	ASSERT_TRUE(AddWatch());
+
+	WriteTestFile(m_directory / L"file.txt");
+
+	auto change = WaitForChange(L"file.txt");
+	ASSERT_TRUE(change);
+
+	// Any modifications made while the file is being written are merged into the addition.
+	EXPECT_EQ(change->type, PluginDirectoryWatcher::ChangeType::Added);
+}
+
+TEST_F(PluginDirectoryWatcherTest, RenamedItem)
+{
+	WriteTestFile(m_directory / L"old.txt");
+
+	ASSERT_TRUE(AddWatch());
+
+	std::filesystem::rename(m_directory / L"old.txt", m_directory / L"new.txt");
+
+	auto change = WaitForChange(L"new.txt");
+	ASSERT_TRUE(change);
+	EXPECT_EQ(change->type, PluginDirectoryWatcher::ChangeType::Renamed);
+	EXPECT_EQ(change->oldName, L"old.txt");
+}
+
+TEST_F(PluginDirectoryWatcherTest, RemovedWatch)
+{
+	auto watchId = AddWatch();
+	ASSERT_TRUE(watchId);
+
+	WriteTestFile(m_directory / L"file.txt");
+	ASSERT_TRUE(WaitForDeliveryScheduled());
+
+	// The changes that have already been collected should be dropped.
+	m_watcher.removeWatch(m_directoryMonitor, *watchId);
+	m_watcher.deliverChanges();
+	m_eventQueue.deliverEvents();
+
+	EXPECT_EQ(m_numBatches, 0);
+}
+
+TEST_F(PluginDirectoryWatcherTest, InvalidDirectory)
+{
+	auto watchId = m_watcher.addWatch(m_directoryMonitor, 1,
+		(m_directory / L"missing").wstring(), false,
+		[](int, const PluginDirectoryWatcher::ChangeBatch &) {});
+	EXPECT_FALSE(watchId);
+}
\ No newline at end of file
@@ -0,0 +1,133 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "Plugins/PluginEventQueue.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+
+using namespace Plugins;
+using namespace std::chrono_literals;
+
+class PluginEventQueueTest : public testing::Test
+{
+protected:
+	PluginEventQueueTest() :
+		m_queue([this] { m_numDeliveriesScheduled++; }, 16ms, [this] { return m_now; })
+	{
+	}
+
+	PluginEventQueue::Clock::time_point m_now;
+	int m_numDeliveriesScheduled = 0;
+	PluginEventQueue m_queue;
+};
+
+TEST_F(PluginEventQueueTest, EventsDeliveredInBatch)
+{
+	std::vector<int> delivered;
+
+	m_queue.queueEvent(1, [&delivered] { delivered.push_back(1); });
+	m_queue.queueEvent(2, [&delivered] { delivered.push_back(2); });
+	m_queue.queueEvent(1, [&delivered] { delivered.push_back(3); });
+
+	// Nothing should be delivered until the queue is explicitly processed and
+	// only a single delivery should be scheduled for the batch.
+	EXPECT_TRUE(delivered.empty());
+	EXPECT_EQ(m_numDeliveriesScheduled, 1);
+
+	m_queue.deliverEvents();
+	EXPECT_EQ(delivered, (std::vector<int>{ 1, 2, 3 }));
+
+	m_queue.queueEvent(1, [&delivered] { delivered.push_back(4); });
+	EXPECT_EQ(m_numDeliveriesScheduled, 2);
+}
+
+TEST_F(PluginEventQueueTest, EventsQueuedDuringDelivery)
+{
+	int numDelivered = 0;
+
+	m_queue.queueEvent(1, [this, &numDelivered] {
+		numDelivered++;
+		m_queue.queueEvent(1, [&numDelivered] { numDelivered++; });
+	});
+
+	m_queue.deliverEvents();
+
+	// The nested event should be left for the next batch.
+	EXPECT_EQ(numDelivered, 1);
+	EXPECT_EQ(m_numDeliveriesScheduled, 2);
+
+	m_queue.deliverEvents();
+	EXPECT_EQ(numDelivered, 2);
+}
+
+TEST_F(PluginEventQueueTest, DiscardEvents)
+{
+	std::vector<int> delivered;
+
+	m_queue.queueEvent(1, [this, &delivered] {
+		delivered.push_back(1);
+		m_queue.discardEvents(2);
+	});
+	m_queue.queueEvent(2, [&delivered] { delivered.push_back(2); });
+	m_queue.queueEvent(3, [&delivered] { delivered.push_back(3); });
+	m_queue.discardEvents(3);
+
+	m_queue.deliverEvents();
+	EXPECT_EQ(delivered, (std::vector<int>{ 1 }));
+}
+
+TEST_F(PluginEventQueueTest, Timing)
+{
+	m_queue.registerPlugin(1, L"Slow plugin");
+
+	m_queue.queueEvent(1, [this] { m_now += 10ms; });
+	m_queue.queueEvent(1, [this] { m_now += 10ms; });
+	m_queue.queueEvent(2, [this] { m_now += 5ms; });
+	m_queue.deliverEvents();
+
+	auto timing = m_queue.getPluginTiming(1);
+	EXPECT_EQ(timing.totalTime, 20ms);
+	EXPECT_EQ(timing.longestBatchTime, 20ms);
+	EXPECT_EQ(timing.numEventsDelivered, 2);
+	EXPECT_EQ(timing.numBatchesOverBudget, 1);
+
+	timing = m_queue.getPluginTiming(2);
+	EXPECT_EQ(timing.totalTime, 5ms);
+	EXPECT_EQ(timing.numEventsDelivered, 1);
+	EXPECT_EQ(timing.numBatchesOverBudget, 0);
+
+	m_queue.queueEvent(1, [this] { m_now += 1ms; });
+	m_queue.deliverEvents();
+
+	timing = m_queue.getPluginTiming(1);
+	EXPECT_EQ(timing.totalTime, 21ms);
+	EXPECT_EQ(timing.longestBatchTime, 20ms);
+	EXPECT_EQ(timing.numBatchesOverBudget, 1);
+}
+
+TEST_F(PluginEventQueueTest, BatchDeliveredCallback)
+{
+	std::vector<int> batchesDelivered;
+
+	m_queue.registerPlugin(1, L"Plugin 1", [&batchesDelivered] { batchesDelivered.push_back(1); });
+	m_queue.registerPlugin(2, L"Plugin 2", [&batchesDelivered] { batchesDelivered.push_back(2); });
+	m_queue.registerPlugin(3, L"Plugin 3", [&batchesDelivered] { batchesDelivered.push_back(3); });
+
+	// The callback should be invoked once per batch, after all of the
+	// plugin's events have been delivered.
+	m_queue.queueEvent(1, [&batchesDelivered] { EXPECT_TRUE(batchesDelivered.empty()); });
+	m_queue.queueEvent(1, [&batchesDelivered] { EXPECT_TRUE(batchesDelivered.empty()); });
+	m_queue.queueEvent(3, [] {});
+	m_queue.deliverEvents();
+
+	std::sort(batchesDelivered.begin(), batchesDelivered.end());
+	EXPECT_EQ(batchesDelivered, (std::vector<int>{ 1, 3 }));
+
+	// Once a plugin's events have been discarded, its callback shouldn't be
+	// invoked again.
+	batchesDelivered.clear();
+	m_queue.queueEvent(1, [this] { m_queue.discardEvents(1); });
+	m_queue.deliverEvents();
+	EXPECT_TRUE(batchesDelivered.empty());
+}
\ No newline at end of file
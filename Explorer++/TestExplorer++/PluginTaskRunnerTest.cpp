@@ -0,0 +1,67 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "Plugins/PluginTaskRunner.h"
+#include "Plugins/PluginEventQueue.h"
+#include <gtest/gtest.h>
+#include <future>
+#include <thread>
+
+using namespace Plugins;
+
+class PluginTaskRunnerTest : public testing::Test
+{
+protected:
+	PluginTaskRunnerTest() :
+		m_eventQueue([] {}),
+		m_taskRunner(&m_eventQueue, [this] { m_deliveryScheduled.set_value(); })
+	{
+	}
+
+	std::promise<void> m_deliveryScheduled;
+	PluginEventQueue m_eventQueue;
+	PluginTaskRunner m_taskRunner;
+};
+
+TEST_F(PluginTaskRunnerTest, CompletionDeliveredOnCallingThread)
+{
+	auto callingThreadId = std::this_thread::get_id();
+	std::thread::id taskThreadId;
+	std::thread::id completionThreadId;
+
+	m_taskRunner.runTask(1, this, [&taskThreadId, &completionThreadId] {
+		taskThreadId = std::this_thread::get_id();
+
+		return [&completionThreadId] { completionThreadId = std::this_thread::get_id(); };
+	});
+
+	m_deliveryScheduled.get_future().wait();
+
+	EXPECT_NE(taskThreadId, callingThreadId);
+	EXPECT_EQ(completionThreadId, std::thread::id());
+
+	// The completion is handed over to the event queue, so it's only invoked once the queued
+	// events have been delivered.
+	m_taskRunner.deliverCompletions();
+	EXPECT_EQ(completionThreadId, std::thread::id());
+
+	m_eventQueue.deliverEvents();
+	EXPECT_EQ(completionThreadId, callingThreadId);
+}
+
+TEST_F(PluginTaskRunnerTest, CompletionDiscardedWithPlugin)
+{
+	bool completionInvoked = false;
+
+	m_taskRunner.runTask(1, this, [&completionInvoked] {
+		return [&completionInvoked] { completionInvoked = true; };
+	});
+
+	m_deliveryScheduled.get_future().wait();
+	m_taskRunner.deliverCompletions();
+
+	m_eventQueue.discardEvents(1);
+	m_eventQueue.deliverEvents();
+	EXPECT_FALSE(completionInvoked);
+}
\ No newline at end of file
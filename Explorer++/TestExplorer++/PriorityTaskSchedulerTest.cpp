@@ -0,0 +1,287 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/PriorityTaskScheduler.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <climits>
+#include <mutex>
+#include <vector>
+
+class PriorityTaskSchedulerTest : public testing::Test
+{
+protected:
+	PriorityTaskSchedulerTest() : m_scheduler(1)
+	{
+	}
+
+	// Queues a task that occupies the single worker thread until ReleaseWorker() is called, so
+	// that the order of any subsequently queued tasks can be checked.
+	void BlockWorker()
+	{
+		m_blockingTask = m_scheduler.PushTask(&m_blockingOwner, std::nullopt, INT_MIN,
+			[future = m_releasePromise.get_future()]() mutable { future.wait(); });
+	}
+
+	void ReleaseWorker()
+	{
+		m_releasePromise.set_value();
+		m_blockingTask.wait();
+	}
+
+	std::future<void> PushRecordingTask(
+		const void *owner, std::optional<int> key, int priority, int id)
+	{
+		return m_scheduler.PushTask(owner, key, priority, [this, id]() {
+			std::scoped_lock lock(m_mutex);
+			m_order.push_back(id);
+		});
+	}
+
+	std::vector<int> GetOrder()
+	{
+		std::scoped_lock lock(m_mutex);
+		return m_order;
+	}
+
+	PriorityTaskScheduler m_scheduler;
+	int m_owner1 = 0;
+	int m_owner2 = 0;
+
+private:
+	int m_blockingOwner = 0;
+	std::promise<void> m_releasePromise;
+	std::future<void> m_blockingTask;
+
+	std::mutex m_mutex;
+	std::vector<int> m_order;
+};
+
+TEST_F(PriorityTaskSchedulerTest, Result)
+{
+	auto future = m_scheduler.PushTask(&m_owner1, std::nullopt, 0, []() { return 42; });
+	EXPECT_EQ(future.get(), 42);
+}
+
+TEST_F(PriorityTaskSchedulerTest, PriorityOrder)
+{
+	BlockWorker();
+
+	std::vector<std::future<void>> futures;
+	futures.push_back(PushRecordingTask(&m_owner1, std::nullopt, 2, 1));
+	futures.push_back(PushRecordingTask(&m_owner1, std::nullopt, 0, 2));
+	futures.push_back(PushRecordingTask(&m_owner2, std::nullopt, 1, 3));
+	futures.push_back(PushRecordingTask(&m_owner1, std::nullopt, 0, 4));
+
+	ReleaseWorker();
+
+	for (auto &future : futures)
+	{
+		future.wait();
+	}
+
+	EXPECT_EQ(GetOrder(), (std::vector<int>{ 2, 4, 3, 1 }));
+}
+
+TEST_F(PriorityTaskSchedulerTest, UpdatePriorities)
+{
+	BlockWorker();
+
+	std::vector<std::future<void>> futures;
+	futures.push_back(PushRecordingTask(&m_owner1, 0, 0, 1));
+	futures.push_back(PushRecordingTask(&m_owner1, 1, 0, 2));
+	futures.push_back(PushRecordingTask(&m_owner1, 2, 0, 3));
+
+	// Tasks from other owners and tasks without a key shouldn't be affected.
+	futures.push_back(PushRecordingTask(&m_owner2, 0, 5, 4));
+	futures.push_back(PushRecordingTask(&m_owner1, std::nullopt, 5, 5));
+
+	m_scheduler.UpdatePriorities(&m_owner1, [](int key) { return 10 - key; });
+
+	ReleaseWorker();
+
+	for (auto &future : futures)
+	{
+		future.wait();
+	}
+
+	EXPECT_EQ(GetOrder(), (std::vector<int>{ 4, 5, 3, 2, 1 }));
+}
+
+TEST_F(PriorityTaskSchedulerTest, UpdatePrioritiesCancel)
+{
+	BlockWorker();
+
+	int numCancelled = 0;
+	auto cancelledTask = m_scheduler.PushTask(
+		&m_owner1, 0, 0, []() {}, [&numCancelled]() { numCancelled++; });
+	auto keptTask = PushRecordingTask(&m_owner1, 1, 0, 1);
+
+	m_scheduler.UpdatePriorities(&m_owner1,
+		[](int key) { return key == 0 ? std::nullopt : std::optional<int>(0); });
+	EXPECT_EQ(numCancelled, 1);
+
+	ReleaseWorker();
+	keptTask.wait();
+
+	EXPECT_EQ(GetOrder(), (std::vector<int>{ 1 }));
+}
+
+TEST_F(PriorityTaskSchedulerTest, PreferredOwners)
+{
+	BlockWorker();
+
+	std::vector<std::future<void>> futures;
+	futures.push_back(PushRecordingTask(&m_owner1, std::nullopt, 0, 1));
+	futures.push_back(PushRecordingTask(&m_owner2, 0, 5, 2));
+	futures.push_back(PushRecordingTask(&m_owner1, std::nullopt, 1, 3));
+
+	// Tasks that are already queued should be moved ahead, as should tasks queued later.
+	m_scheduler.SetPreferredOwners({ &m_owner2 });
+	futures.push_back(PushRecordingTask(&m_owner2, 1, 10, 4));
+
+	// Within the preferred owner's tasks, priorities should still be respected.
+	m_scheduler.UpdatePriorities(&m_owner2, [](int key) { return key == 0 ? 20 : 10; });
+
+	ReleaseWorker();
+
+	for (auto &future : futures)
+	{
+		future.wait();
+	}
+
+	EXPECT_EQ(GetOrder(), (std::vector<int>{ 4, 2, 1, 3 }));
+}
+
+TEST_F(PriorityTaskSchedulerTest, TaskClasses)
+{
+	BlockWorker();
+
+	m_scheduler.SetOwnerTaskClass(&m_owner1, TaskClass::Bulk);
+
+	std::vector<std::future<void>> futures;
+	futures.push_back(PushRecordingTask(&m_owner1, std::nullopt, 0, 1));
+	futures.push_back(PushRecordingTask(&m_owner2, std::nullopt, 5, 2));
+
+	// Tasks in a more urgent class run first, regardless of priority or preferred owners.
+	m_scheduler.SetPreferredOwners({ &m_owner1 });
+	futures.push_back(PushRecordingTask(&m_owner2, std::nullopt, 10, 3));
+
+	auto taskClass = m_scheduler.PushTask(
+		&m_owner1, std::nullopt, 0, []() { return GetCurrentThreadTaskClass(); });
+
+	ReleaseWorker();
+
+	for (auto &future : futures)
+	{
+		future.wait();
+	}
+
+	EXPECT_EQ(GetOrder(), (std::vector<int>{ 2, 3, 1 }));
+
+	// Each task runs with its class applied to the worker thread.
+	EXPECT_EQ(taskClass.get(), TaskClass::Bulk);
+}
+
+TEST_F(PriorityTaskSchedulerTest, CancelTasks)
+{
+	BlockWorker();
+
+	int numCancelled = 0;
+	auto cancelledTask = m_scheduler.PushTask(
+		&m_owner1, 0, 0, []() {}, [&numCancelled]() { numCancelled++; });
+	auto keptTask = PushRecordingTask(&m_owner2, std::nullopt, 0, 1);
+
+	m_scheduler.CancelTasks(&m_owner1);
+
+	ReleaseWorker();
+	keptTask.wait();
+
+	// Cancelled callbacks are only invoked by UpdatePriorities().
+	EXPECT_EQ(numCancelled, 0);
+	EXPECT_EQ(GetOrder(), (std::vector<int>{ 1 }));
+}
+
+TEST_F(PriorityTaskSchedulerTest, CancelTasksWaitsForRunningTasks)
+{
+	std::promise<void> startedPromise;
+	std::promise<void> releasePromise;
+	bool finished = false;
+
+	auto task = m_scheduler.PushTask(&m_owner1, std::nullopt, 0,
+		[&startedPromise, releaseFuture = releasePromise.get_future(), &finished]() mutable {
+			startedPromise.set_value();
+			releaseFuture.wait();
+			finished = true;
+		});
+
+	startedPromise.get_future().wait();
+
+	std::thread releaseThread([&releasePromise]() { releasePromise.set_value(); });
+	m_scheduler.CancelTasks(&m_owner1, true);
+	EXPECT_TRUE(finished);
+
+	releaseThread.join();
+}
+TEST_F(PriorityTaskSchedulerTest, ResourceLimit)
+{
+	PriorityTaskScheduler scheduler(3);
+	scheduler.SetOwnerResource(&m_owner1, L"server");
+	scheduler.SetResourceLimit(L"server", 1);
+
+	std::mutex mutex;
+	int numRunning = 0;
+	int maxRunning = 0;
+
+	std::vector<std::future<void>> futures;
+
+	for (int i = 0; i < 6; i++)
+	{
+		futures.push_back(scheduler.PushTask(&m_owner1, std::nullopt, 0, [&]() {
+			{
+				std::scoped_lock lock(mutex);
+				numRunning++;
+				maxRunning = std::max(maxRunning, numRunning);
+			}
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+			std::scoped_lock lock(mutex);
+			numRunning--;
+		}));
+	}
+
+	// Tasks for other owners shouldn't be held up by the limit.
+	auto otherTask = scheduler.PushTask(&m_owner2, std::nullopt, 0, []() { return 1; });
+	EXPECT_EQ(otherTask.get(), 1);
+
+	for (auto &future : futures)
+	{
+		future.wait();
+	}
+
+	EXPECT_EQ(maxRunning, 1);
+}
+
+TEST_F(PriorityTaskSchedulerTest, ResourceLatency)
+{
+	EXPECT_EQ(m_scheduler.GetResourceLatency(L"server"), std::nullopt);
+
+	m_scheduler.SetOwnerResource(&m_owner1, L"server");
+	m_scheduler.PushTask(&m_owner1, std::nullopt, 0,
+		[]() { std::this_thread::sleep_for(std::chrono::milliseconds(10)); });
+
+	// Once the owner's tasks have finished, the latency will have been recorded.
+	m_scheduler.CancelTasks(&m_owner1, true);
+
+	auto latency = m_scheduler.GetResourceLatency(L"server");
+	ASSERT_TRUE(latency.has_value());
+	EXPECT_GE(*latency, std::chrono::milliseconds(10));
+
+	// Tasks queued after the association is removed aren't counted against the resource.
+	m_scheduler.SetOwnerResource(&m_owner1, L"");
+	m_scheduler.PushTask(&m_owner1, std::nullopt, 0, []() {});
+	m_scheduler.CancelTasks(&m_owner1, true);
+	EXPECT_EQ(m_scheduler.GetResourceLatency(L"server"), latency);
+}
@@ -0,0 +1,169 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/Regex.h"
+#include <gtest/gtest.h>
+#include <stdexcept>
+
+TEST(RegexTest, Matches)
+{
+	Regex regex(L"ab+c");
+
+	EXPECT_TRUE(regex.Matches(L"abc"));
+	EXPECT_TRUE(regex.Matches(L"abbbc"));
+	EXPECT_FALSE(regex.Matches(L"ac"));
+	EXPECT_FALSE(regex.Matches(L"xabc"));
+	EXPECT_FALSE(regex.Matches(L"abcx"));
+
+	Regex alternation(L"(?:foo|bar)\\.txt");
+
+	EXPECT_TRUE(alternation.Matches(L"foo.txt"));
+	EXPECT_TRUE(alternation.Matches(L"bar.txt"));
+	EXPECT_FALSE(alternation.Matches(L"foobar.txt"));
+	EXPECT_FALSE(alternation.Matches(L"fooxtxt"));
+}
+
+TEST(RegexTest, Repetition)
+{
+	Regex regex(L"a{2,3}");
+
+	EXPECT_FALSE(regex.Matches(L"a"));
+	EXPECT_TRUE(regex.Matches(L"aa"));
+	EXPECT_TRUE(regex.Matches(L"aaa"));
+	EXPECT_FALSE(regex.Matches(L"aaaa"));
+
+	Regex exact(L"x{3}");
+
+	EXPECT_TRUE(exact.Matches(L"xxx"));
+	EXPECT_FALSE(exact.Matches(L"xx"));
+
+	Regex unbounded(L"x{2,}");
+
+	EXPECT_FALSE(unbounded.Matches(L"x"));
+	EXPECT_TRUE(unbounded.Matches(L"xxxxxxxx"));
+
+	// A brace that doesn't form a valid quantifier is treated as a literal.
+	Regex literalBrace(L"a{b");
+
+	EXPECT_TRUE(literalBrace.Matches(L"a{b"));
+}
+
+TEST(RegexTest, Search)
+{
+	Regex regex(L"\\d+");
+
+	auto match = regex.Search(L"file123_45");
+	ASSERT_TRUE(match.has_value());
+	EXPECT_EQ(match->position, 4U);
+	EXPECT_EQ(match->length, 3U);
+
+	match = regex.Search(L"file123_45", 7);
+	ASSERT_TRUE(match.has_value());
+	EXPECT_EQ(match->position, 8U);
+	EXPECT_EQ(match->length, 2U);
+
+	EXPECT_FALSE(regex.Search(L"file").has_value());
+
+	// As with a backtracking implementation, the first alternative that matches is preferred, as
+	// is the shortest match for a lazy quantifier.
+	Regex alternation(L"a|ab");
+	match = alternation.Search(L"ab");
+	ASSERT_TRUE(match.has_value());
+	EXPECT_EQ(match->length, 1U);
+
+	Regex lazy(L"<.+?>");
+	match = lazy.Search(L"<a><b>");
+	ASSERT_TRUE(match.has_value());
+	EXPECT_EQ(match->position, 0U);
+	EXPECT_EQ(match->length, 3U);
+}
+
+TEST(RegexTest, Anchors)
+{
+	Regex begin(L"^abc");
+
+	EXPECT_TRUE(begin.Search(L"abcdef").has_value());
+	EXPECT_FALSE(begin.Search(L"xabc").has_value());
+
+	Regex end(L"abc$");
+
+	EXPECT_TRUE(end.Search(L"xabc").has_value());
+	EXPECT_FALSE(end.Search(L"abcx").has_value());
+
+	Regex wordBoundary(L"\\bpart\\b");
+
+	EXPECT_TRUE(wordBoundary.Search(L"file part 1").has_value());
+	EXPECT_FALSE(wordBoundary.Search(L"file.parts").has_value());
+}
+
+TEST(RegexTest, Classes)
+{
+	Regex regex(L"[a-c_]+[^0-9]");
+
+	EXPECT_TRUE(regex.Matches(L"ab_x"));
+	EXPECT_FALSE(regex.Matches(L"ab_1"));
+	EXPECT_FALSE(regex.Matches(L"dab"));
+
+	Regex escapes(L"\\w+\\s\\S\\D");
+
+	EXPECT_TRUE(escapes.Matches(L"word x!"));
+	EXPECT_FALSE(escapes.Matches(L"word x1"));
+}
+
+TEST(RegexTest, CaseInsensitive)
+{
+	Regex regex(L"File[A-C]\\.TXT", true);
+
+	EXPECT_TRUE(regex.Matches(L"fileb.txt"));
+	EXPECT_TRUE(regex.Matches(L"FILEB.TXT"));
+	EXPECT_FALSE(regex.Matches(L"filed.txt"));
+
+	Regex negated(L"[^a]", true);
+
+	EXPECT_FALSE(negated.Matches(L"a"));
+	EXPECT_FALSE(negated.Matches(L"A"));
+	EXPECT_TRUE(negated.Matches(L"b"));
+
+	Regex caseSensitive(L"File");
+
+	EXPECT_FALSE(caseSensitive.Matches(L"file"));
+}
+
+TEST(RegexTest, Invalid)
+{
+	EXPECT_THROW(Regex(L"(abc"), std::invalid_argument);
+	EXPECT_THROW(Regex(L"abc)"), std::invalid_argument);
+	EXPECT_THROW(Regex(L"[abc"), std::invalid_argument);
+	EXPECT_THROW(Regex(L"*abc"), std::invalid_argument);
+	EXPECT_THROW(Regex(L"a**"), std::invalid_argument);
+	EXPECT_THROW(Regex(L"a{3,2}"), std::invalid_argument);
+	EXPECT_THROW(Regex(L"[z-a]"), std::invalid_argument);
+	EXPECT_THROW(Regex(L"abc\\"), std::invalid_argument);
+
+	// Backreferences and lookaheads aren't supported.
+	EXPECT_THROW(Regex(L"(a)\\1"), std::invalid_argument);
+	EXPECT_THROW(Regex(L"a(?=b)"), std::invalid_argument);
+}
+
+TEST(RegexTest, LinearTime)
+{
+	// With a backtracking implementation, this takes exponential time.
+	Regex regex(L"(a*)*b");
+	std::wstring str(10000, 'a');
+
+	EXPECT_FALSE(regex.Matches(str));
+	EXPECT_FALSE(regex.Search(str).has_value());
+}
+
+TEST(RegexTest, ReplaceAll)
+{
+	Regex regex(L"[\\.]?part[0-9]+", true);
+
+	EXPECT_EQ(regex.ReplaceAll(L"archive.PART01", L""), L"archive");
+	EXPECT_EQ(regex.ReplaceAll(L"apart1bpart2", L"-"), L"a-b-");
+
+	Regex empty(L"x*");
+
+	EXPECT_EQ(empty.ReplaceAll(L"abc", L"-"), L"-a-b-c-");
+}
\ No newline at end of file
@@ -0,0 +1,102 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/RegistryValueCache.h"
+#include "../Helper/RegistrySettings.h"
+#include <gtest/gtest.h>
+#include <wil/resource.h>
+#include <Shlwapi.h>
+
+namespace
+{
+
+const TCHAR TEST_KEY[] = _T("Software\\Explorer++Test\\RegistryValueCache");
+
+}
+
+class RegistryValueCacheTest : public testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		LONG res = RegCreateKeyEx(HKEY_CURRENT_USER, TEST_KEY, 0, nullptr, REG_OPTION_NON_VOLATILE,
+			KEY_READ | KEY_WRITE, nullptr, &m_key, nullptr);
+		ASSERT_EQ(res, ERROR_SUCCESS);
+
+		RegistrySettings::SaveDword(m_key.get(), L"Number", 42);
+		RegistrySettings::SaveString(m_key.get(), L"Text", L"Value");
+		RegistrySettings::SaveStringList(m_key.get(), L"Item", { L"First", L"Second" });
+	}
+
+	void TearDown() override
+	{
+		m_key.reset();
+
+		LSTATUS res = SHDeleteKey(HKEY_CURRENT_USER, L"Software\\Explorer++Test");
+		ASSERT_EQ(res, ERROR_SUCCESS);
+	}
+
+	wil::unique_hkey m_key;
+};
+
+TEST_F(RegistryValueCacheTest, Read)
+{
+	RegistryValueCache cache(m_key.get());
+	EXPECT_EQ(cache.GetNumValues(), 4U);
+	EXPECT_EQ(RegistryValueCache::FindForKey(m_key.get()), &cache);
+
+	DWORD number;
+	EXPECT_EQ(RegistrySettings::ReadDword(m_key.get(), L"Number", &number), ERROR_SUCCESS);
+	EXPECT_EQ(number, 42U);
+
+	// Value names aren't case sensitive.
+	std::wstring text;
+	EXPECT_EQ(RegistrySettings::ReadString(m_key.get(), L"TEXT", text), ERROR_SUCCESS);
+	EXPECT_EQ(text, L"Value");
+
+	std::list<std::wstring> items;
+	EXPECT_EQ(RegistrySettings::ReadStringList(m_key.get(), L"Item", items), ERROR_SUCCESS);
+	EXPECT_EQ(items, (std::list<std::wstring>{ L"First", L"Second" }));
+
+	EXPECT_EQ(RegistrySettings::ReadDword(m_key.get(), L"Missing", &number), ERROR_FILE_NOT_FOUND);
+}
+
+TEST_F(RegistryValueCacheTest, QueryValue)
+{
+	RegistryValueCache cache(m_key.get());
+
+	DWORD type;
+	DWORD size;
+	EXPECT_EQ(RegistrySettings::QueryValue(m_key.get(), L"Text", &type, nullptr, &size),
+		ERROR_SUCCESS);
+	EXPECT_EQ(type, static_cast<DWORD>(REG_SZ));
+	EXPECT_EQ(size, sizeof(L"Value"));
+
+	// The string is larger than a DWORD.
+	DWORD number;
+	size = sizeof(number);
+	EXPECT_EQ(RegistrySettings::QueryValue(
+				  m_key.get(), L"Text", nullptr, reinterpret_cast<BYTE *>(&number), &size),
+		ERROR_MORE_DATA);
+	EXPECT_EQ(size, sizeof(L"Value"));
+}
+
+TEST_F(RegistryValueCacheTest, ValuesReadOnce)
+{
+	DWORD number;
+
+	{
+		RegistryValueCache cache(m_key.get());
+
+		// While the cache exists, values are read from the cache, rather than the registry.
+		RegistrySettings::SaveDword(m_key.get(), L"Number", 7);
+		RegistrySettings::ReadDword(m_key.get(), L"Number", &number);
+		EXPECT_EQ(number, 42U);
+	}
+
+	EXPECT_EQ(RegistryValueCache::FindForKey(m_key.get()), nullptr);
+
+	RegistrySettings::ReadDword(m_key.get(), L"Number", &number);
+	EXPECT_EQ(number, 7U);
+}
\ No newline at end of file
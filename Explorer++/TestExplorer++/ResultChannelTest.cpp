@@ -0,0 +1,81 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/ResultChannel.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+class ResultChannelTest : public testing::Test
+{
+protected:
+	ResultChannelTest() : m_channel([this] { m_numNotifications++; })
+	{
+	}
+
+	std::vector<int> ProcessAll()
+	{
+		std::vector<int> processed;
+		m_channel.ProcessResults(1h, [&processed](int result) { processed.push_back(result); });
+		return processed;
+	}
+
+	ResultChannel<int> m_channel;
+	int m_numNotifications = 0;
+};
+
+TEST_F(ResultChannelTest, ProcessInOrder)
+{
+	m_channel.Push(1);
+	m_channel.Push(2);
+	m_channel.Push(3);
+
+	EXPECT_EQ(ProcessAll(), (std::vector<int>{ 1, 2, 3 }));
+	EXPECT_TRUE(ProcessAll().empty());
+}
+
+TEST_F(ResultChannelTest, NotifyOncePerBatch)
+{
+	m_channel.Push(1);
+	m_channel.Push(2);
+	EXPECT_EQ(m_numNotifications, 1);
+
+	ProcessAll();
+
+	m_channel.Push(3);
+	EXPECT_EQ(m_numNotifications, 2);
+}
+
+TEST_F(ResultChannelTest, BudgetExceeded)
+{
+	m_channel.Push(1);
+	m_channel.Push(2);
+	m_channel.Push(3);
+
+	// A zero budget should still result in a single result being processed.
+	std::vector<int> processed;
+	bool resultsRemaining =
+		m_channel.ProcessResults(0s, [&processed](int result) { processed.push_back(result); });
+	EXPECT_TRUE(resultsRemaining);
+	EXPECT_EQ(processed, (std::vector<int>{ 1 }));
+
+	// The channel is still in the notified state, so pushing another result shouldn't trigger a
+	// notification.
+	m_channel.Push(4);
+	EXPECT_EQ(m_numNotifications, 1);
+
+	EXPECT_EQ(ProcessAll(), (std::vector<int>{ 2, 3, 4 }));
+}
+
+TEST_F(ResultChannelTest, Clear)
+{
+	m_channel.Push(1);
+	m_channel.Clear();
+	EXPECT_TRUE(ProcessAll().empty());
+
+	m_channel.Push(2);
+	EXPECT_EQ(m_numNotifications, 2);
+	EXPECT_EQ(ProcessAll(), (std::vector<int>{ 2 }));
+}
\ No newline at end of file
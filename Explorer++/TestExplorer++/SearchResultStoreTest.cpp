@@ -0,0 +1,115 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Explorer++/SearchResultStore.h"
+#include <gtest/gtest.h>
+
+TEST(SearchResultStoreTest, Add)
+{
+	SearchResultStore store;
+	store.Add(L"C:\\Folder\\file.txt", L"matching line", FILE_ATTRIBUTE_ARCHIVE);
+	store.Add(L"C:\\root.txt", L"", FILE_ATTRIBUTE_NORMAL);
+
+	ASSERT_EQ(store.GetCount(), 2U);
+
+	EXPECT_EQ(store.GetName(0), L"file.txt");
+	EXPECT_EQ(store.GetFolder(0), L"C:\\Folder");
+	EXPECT_EQ(store.GetPath(0), L"C:\\Folder\\file.txt");
+	EXPECT_EQ(store.GetMatchingLine(0), L"matching line");
+	EXPECT_EQ(store.GetAttributes(0), static_cast<DWORD>(FILE_ATTRIBUTE_ARCHIVE));
+
+	EXPECT_EQ(store.GetName(1), L"root.txt");
+	EXPECT_EQ(store.GetFolder(1), L"C:\\");
+	EXPECT_EQ(store.GetPath(1), L"C:\\root.txt");
+	EXPECT_EQ(store.GetMatchingLine(1), L"");
+
+	store.Clear();
+	EXPECT_EQ(store.GetCount(), 0U);
+}
+
+TEST(SearchResultStoreTest, SortByName)
+{
+	SearchResultStore store;
+	store.Add(L"C:\\a\\file10.txt", L"", FILE_ATTRIBUTE_NORMAL);
+	store.Add(L"C:\\b\\File2.txt", L"", FILE_ATTRIBUTE_NORMAL);
+	store.Add(L"C:\\c\\file1.txt", L"", FILE_ATTRIBUTE_NORMAL);
+
+	store.Sort(SearchResultStore::SortMode::Name, true);
+	EXPECT_EQ(store.GetName(0), L"file1.txt");
+	EXPECT_EQ(store.GetName(1), L"File2.txt");
+	EXPECT_EQ(store.GetName(2), L"file10.txt");
+
+	store.Sort(SearchResultStore::SortMode::Name, false);
+	EXPECT_EQ(store.GetName(0), L"file10.txt");
+	EXPECT_EQ(store.GetName(1), L"File2.txt");
+	EXPECT_EQ(store.GetName(2), L"file1.txt");
+
+	// Results added after a sort are appended.
+	store.Add(L"C:\\d\\file0.txt", L"", FILE_ATTRIBUTE_NORMAL);
+	EXPECT_EQ(store.GetName(3), L"file0.txt");
+	EXPECT_EQ(store.GetResultId(3), 3U);
+}
+
+TEST(SearchResultStoreTest, SortByPath)
+{
+	SearchResultStore store;
+	store.Add(L"C:\\Folder10\\first.txt", L"", FILE_ATTRIBUTE_NORMAL);
+	store.Add(L"C:\\Folder2\\second.txt", L"", FILE_ATTRIBUTE_NORMAL);
+	store.Add(L"C:\\Folder10\\third.txt", L"", FILE_ATTRIBUTE_NORMAL);
+
+	// Results in the same folder stay in the order they were added.
+	store.Sort(SearchResultStore::SortMode::Path, true);
+	EXPECT_EQ(store.GetName(0), L"second.txt");
+	EXPECT_EQ(store.GetName(1), L"first.txt");
+	EXPECT_EQ(store.GetName(2), L"third.txt");
+
+	store.Sort(SearchResultStore::SortMode::Path, false);
+	EXPECT_EQ(store.GetName(0), L"first.txt");
+	EXPECT_EQ(store.GetName(1), L"third.txt");
+	EXPECT_EQ(store.GetName(2), L"second.txt");
+}
+
+TEST(SearchResultStoreTest, SortByMatchingLine)
+{
+	SearchResultStore store;
+	store.Add(L"C:\\file1.txt", L"line b", FILE_ATTRIBUTE_NORMAL);
+	store.Add(L"C:\\file2.txt", L"", FILE_ATTRIBUTE_NORMAL);
+	store.Add(L"C:\\file3.txt", L"line a", FILE_ATTRIBUTE_NORMAL);
+
+	store.Sort(SearchResultStore::SortMode::MatchingLine, true);
+	EXPECT_EQ(store.GetName(0), L"file2.txt");
+	EXPECT_EQ(store.GetName(1), L"file3.txt");
+	EXPECT_EQ(store.GetName(2), L"file1.txt");
+}
+
+TEST(SearchResultStoreTest, IconIndexFollowsResult)
+{
+	SearchResultStore store;
+	store.Add(L"C:\\b.txt", L"", FILE_ATTRIBUTE_NORMAL);
+	store.Add(L"C:\\a.txt", L"", FILE_ATTRIBUTE_NORMAL);
+
+	EXPECT_EQ(store.GetIconIndex(0), std::nullopt);
+	store.SetIconIndex(0, 5);
+
+	store.Sort(SearchResultStore::SortMode::Name, true);
+	EXPECT_EQ(store.GetIconIndex(0), std::nullopt);
+	EXPECT_EQ(store.GetIconIndex(1), 5);
+	EXPECT_EQ(store.GetResultId(1), 0U);
+}
+
+TEST(SearchResultStoreTest, FindByName)
+{
+	SearchResultStore store;
+	store.Add(L"C:\\apple.txt", L"", FILE_ATTRIBUTE_NORMAL);
+	store.Add(L"C:\\banana.txt", L"", FILE_ATTRIBUTE_NORMAL);
+	store.Add(L"C:\\Apricot.txt", L"", FILE_ATTRIBUTE_NORMAL);
+
+	EXPECT_EQ(store.FindByName(L"ap", true, 0, false), 0U);
+	EXPECT_EQ(store.FindByName(L"ap", true, 1, false), 2U);
+	EXPECT_EQ(store.FindByName(L"BANANA.TXT", false, 0, false), 1U);
+	EXPECT_EQ(store.FindByName(L"banana", false, 0, false), std::nullopt);
+
+	EXPECT_EQ(store.FindByName(L"banana", true, 2, false), std::nullopt);
+	EXPECT_EQ(store.FindByName(L"banana", true, 2, true), 1U);
+}
\ No newline at end of file
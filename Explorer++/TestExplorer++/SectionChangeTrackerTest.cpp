@@ -0,0 +1,37 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/SectionChangeTracker.h"
+#include <gtest/gtest.h>
+
+TEST(SectionChangeTrackerTest, UnsavedSection)
+{
+	SectionChangeTracker tracker;
+	EXPECT_TRUE(tracker.HasChanged(L"Tabs", L"contents"));
+	EXPECT_TRUE(tracker.HasChanged(L"Tabs", L""));
+}
+
+TEST(SectionChangeTrackerTest, SavedSection)
+{
+	SectionChangeTracker tracker;
+	tracker.MarkSaved(L"Tabs", L"contents");
+
+	EXPECT_FALSE(tracker.HasChanged(L"Tabs", L"contents"));
+	EXPECT_TRUE(tracker.HasChanged(L"Tabs", L"updated contents"));
+
+	// Sections are tracked independently.
+	EXPECT_TRUE(tracker.HasChanged(L"Bookmarks", L"contents"));
+}
+
+TEST(SectionChangeTrackerTest, Reset)
+{
+	SectionChangeTracker tracker;
+	tracker.MarkSaved(L"Tabs", L"contents");
+	tracker.MarkSaved(L"Bookmarks", L"contents");
+
+	tracker.Reset();
+
+	EXPECT_TRUE(tracker.HasChanged(L"Tabs", L"contents"));
+	EXPECT_TRUE(tracker.HasChanged(L"Bookmarks", L"contents"));
+}
\ No newline at end of file
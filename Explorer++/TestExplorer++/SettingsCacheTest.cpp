@@ -0,0 +1,121 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "SettingsCache.h"
+#include "BookmarkStorageHelper.h"
+#include "Bookmarks/BookmarkTree.h"
+#include <gtest/gtest.h>
+
+using namespace testing;
+
+namespace
+{
+
+SettingsCache::SourceFileKey BuildSourceFileKey(ULONGLONG size, DWORD lowDateTime)
+{
+	return { size, { lowDateTime, 0 } };
+}
+
+SettingsCache::Contents BuildContents()
+{
+	SettingsCache::Contents contents;
+
+	BookmarkTree bookmarkTree;
+	BuildV2LoadSaveReferenceTree(&bookmarkTree);
+	SettingsCache::CaptureBookmarks(&bookmarkTree, contents);
+
+	NColorRuleHelper::ColorRule colorRule;
+	colorRule.strDescription = L"Text files";
+	colorRule.strFilterPattern = L"*.txt";
+	colorRule.caseInsensitive = TRUE;
+	colorRule.dwFilterAttributes = FILE_ATTRIBUTE_ARCHIVE;
+	colorRule.rgbColour = RGB(10, 20, 30);
+	contents.colorRules.push_back(colorRule);
+
+	contents.defaultColumns.realFolderColumns = { { ColumnType::Name, TRUE, 150 },
+		{ ColumnType::Size, FALSE, 80 } };
+	contents.defaultColumns.recycleBinColumns = { { ColumnType::DateModified, TRUE, 120 } };
+
+	contents.toolbarBands = { { 1, 4, 200 }, { 2, 0, 350 } };
+
+	return contents;
+}
+
+}
+
+TEST(SettingsCacheTest, RoundTrip)
+{
+	auto sourceFileKey = BuildSourceFileKey(1024, 5);
+	auto contents = BuildContents();
+
+	auto loadedContents =
+		SettingsCache::Deserialize(SettingsCache::Serialize(contents, sourceFileKey), sourceFileKey);
+	ASSERT_TRUE(loadedContents);
+
+	BookmarkTree referenceBookmarkTree;
+	BuildV2LoadSaveReferenceTree(&referenceBookmarkTree);
+
+	BookmarkTree loadedBookmarkTree;
+	SettingsCache::RestoreBookmarks(*loadedContents, &loadedBookmarkTree);
+	CompareBookmarkTrees(&loadedBookmarkTree, &referenceBookmarkTree, true);
+
+	ASSERT_EQ(loadedContents->colorRules.size(), 1U);
+	const auto &colorRule = loadedContents->colorRules[0];
+	EXPECT_EQ(colorRule.strDescription, L"Text files");
+	EXPECT_EQ(colorRule.strFilterPattern, L"*.txt");
+	EXPECT_EQ(colorRule.caseInsensitive, TRUE);
+	EXPECT_EQ(colorRule.dwFilterAttributes, static_cast<DWORD>(FILE_ATTRIBUTE_ARCHIVE));
+	EXPECT_EQ(colorRule.rgbColour, RGB(10, 20, 30));
+
+	const auto &realFolderColumns = loadedContents->defaultColumns.realFolderColumns;
+	ASSERT_EQ(realFolderColumns.size(), 2U);
+	EXPECT_EQ(realFolderColumns[1].type, ColumnType::Size);
+	EXPECT_EQ(realFolderColumns[1].bChecked, FALSE);
+	EXPECT_EQ(realFolderColumns[1].iWidth, 80);
+	EXPECT_EQ(loadedContents->defaultColumns.recycleBinColumns.size(), 1U);
+	EXPECT_TRUE(loadedContents->defaultColumns.printersColumns.empty());
+
+	ASSERT_EQ(loadedContents->toolbarBands.size(), 2U);
+	EXPECT_EQ(loadedContents->toolbarBands[0].style, 4U);
+	EXPECT_EQ(loadedContents->toolbarBands[1].id, 2U);
+	EXPECT_EQ(loadedContents->toolbarBands[1].length, 350U);
+}
+
+TEST(SettingsCacheTest, RestoresDates)
+{
+	auto sourceFileKey = BuildSourceFileKey(1024, 5);
+	auto contents = BuildContents();
+
+	auto loadedContents =
+		SettingsCache::Deserialize(SettingsCache::Serialize(contents, sourceFileKey), sourceFileKey);
+	ASSERT_TRUE(loadedContents);
+
+	BookmarkTree loadedBookmarkTree;
+	SettingsCache::RestoreBookmarks(*loadedContents, &loadedBookmarkTree);
+
+	const auto *toolbarFolder = loadedBookmarkTree.GetBookmarksToolbarFolder();
+	FILETIME dateModified = toolbarFolder->GetDateModified();
+	EXPECT_EQ(CompareFileTime(&dateModified, &contents.bookmarksToolbar.dateModified), 0);
+}
+
+TEST(SettingsCacheTest, SourceFileChanged)
+{
+	auto contents = BuildContents();
+	std::string data = SettingsCache::Serialize(contents, BuildSourceFileKey(1024, 5));
+
+	EXPECT_FALSE(SettingsCache::Deserialize(data, BuildSourceFileKey(1025, 5)));
+	EXPECT_FALSE(SettingsCache::Deserialize(data, BuildSourceFileKey(1024, 6)));
+}
+
+TEST(SettingsCacheTest, InvalidData)
+{
+	auto sourceFileKey = BuildSourceFileKey(1024, 5);
+	std::string data = SettingsCache::Serialize(BuildContents(), sourceFileKey);
+
+	EXPECT_FALSE(SettingsCache::Deserialize({}, sourceFileKey));
+	EXPECT_FALSE(SettingsCache::Deserialize(data.substr(0, data.size() / 2), sourceFileKey));
+
+	data[0] = ~data[0];
+	EXPECT_FALSE(SettingsCache::Deserialize(data, sourceFileKey));
+}
\ No newline at end of file
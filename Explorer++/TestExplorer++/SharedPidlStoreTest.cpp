@@ -0,0 +1,102 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/SharedPidlStore.h"
+#include <gtest/gtest.h>
+
+using namespace testing;
+
+TEST(SharedPidlStoreTest, RoundTrip)
+{
+	SharedPidlStore store;
+
+	unique_pidl_absolute pidl(SHSimpleIDListFromPath(L"C:\\Fake\\Folder"));
+	ASSERT_NE(pidl, nullptr);
+
+	auto handle = store.Intern(pidl.get());
+	ASSERT_NE(handle, nullptr);
+
+	auto materializedPidl = SharedPidlStore::Materialize(handle);
+	ASSERT_NE(materializedPidl, nullptr);
+	EXPECT_EQ(ILGetSize(materializedPidl.get()), ILGetSize(pidl.get()));
+	EXPECT_TRUE(ArePidlsEquivalent(materializedPidl.get(), pidl.get()));
+}
+
+TEST(SharedPidlStoreTest, Desktop)
+{
+	SharedPidlStore store;
+
+	unique_pidl_absolute pidl;
+	HRESULT hr = SHGetKnownFolderIDList(FOLDERID_Desktop, KF_FLAG_DEFAULT, nullptr,
+		wil::out_param(pidl));
+	ASSERT_HRESULT_SUCCEEDED(hr);
+
+	auto handle = store.Intern(pidl.get());
+	EXPECT_EQ(handle, store.GetRoot());
+
+	auto materializedPidl = SharedPidlStore::Materialize(handle);
+	ASSERT_NE(materializedPidl, nullptr);
+	EXPECT_TRUE(ILIsEmpty(materializedPidl.get()));
+}
+
+TEST(SharedPidlStoreTest, SamePidlShared)
+{
+	SharedPidlStore store;
+
+	unique_pidl_absolute pidl1(SHSimpleIDListFromPath(L"C:\\Fake\\Folder"));
+	unique_pidl_absolute pidl2(SHSimpleIDListFromPath(L"C:\\Fake\\Folder"));
+	ASSERT_NE(pidl1, nullptr);
+	ASSERT_NE(pidl2, nullptr);
+
+	EXPECT_EQ(store.Intern(pidl1.get()), store.Intern(pidl2.get()));
+}
+
+TEST(SharedPidlStoreTest, PrefixShared)
+{
+	SharedPidlStore store;
+
+	unique_pidl_absolute pidl1(SHSimpleIDListFromPath(L"C:\\Fake\\Folder1"));
+	unique_pidl_absolute pidl2(SHSimpleIDListFromPath(L"C:\\Fake\\Folder2"));
+	ASSERT_NE(pidl1, nullptr);
+	ASSERT_NE(pidl2, nullptr);
+
+	auto handle1 = store.Intern(pidl1.get());
+	auto handle2 = store.Intern(pidl2.get());
+	EXPECT_NE(handle1, handle2);
+	EXPECT_EQ(handle1->parent, handle2->parent);
+
+	// The shared prefix should only be counted once.
+	size_t memoryUsage1 = SharedPidlStore::CalculateMemoryUsage({ handle1 });
+	size_t memoryUsage2 = SharedPidlStore::CalculateMemoryUsage({ handle2 });
+	size_t combinedMemoryUsage = SharedPidlStore::CalculateMemoryUsage({ handle1, handle2 });
+	EXPECT_LT(combinedMemoryUsage, memoryUsage1 + memoryUsage2);
+	EXPECT_EQ(SharedPidlStore::CalculateMemoryUsage({ handle1, handle1 }), memoryUsage1);
+}
+
+TEST(SharedPidlStoreTest, UnreferencedNodesReleased)
+{
+	SharedPidlStore store;
+
+	unique_pidl_absolute pidl(SHSimpleIDListFromPath(L"C:\\Fake\\Folder"));
+	ASSERT_NE(pidl, nullptr);
+
+	std::weak_ptr<const SharedPidlStore::Node> weakHandle = store.Intern(pidl.get());
+	EXPECT_TRUE(weakHandle.expired());
+}
+
+TEST(SharedPidlStoreTest, InvalidItemId)
+{
+	SharedPidlStore store;
+
+	// The size field doesn't match the size of the data.
+	std::vector<BYTE> itemId = { 10, 0, 1, 2 };
+	EXPECT_EQ(store.GetOrCreateChild(store.GetRoot(), itemId), nullptr);
+
+	// Too small to contain any data.
+	itemId = { 2, 0 };
+	EXPECT_EQ(store.GetOrCreateChild(store.GetRoot(), itemId), nullptr);
+
+	itemId = { 4, 0, 1, 2 };
+	EXPECT_NE(store.GetOrCreateChild(store.GetRoot(), itemId), nullptr);
+}
\ No newline at end of file
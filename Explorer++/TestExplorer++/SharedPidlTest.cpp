@@ -0,0 +1,69 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/SharedPidl.h"
+#include <gtest/gtest.h>
+
+using namespace testing;
+
+TEST(SharedPidlTest, Empty)
+{
+	SharedPidl pidl;
+	EXPECT_FALSE(pidl);
+	EXPECT_EQ(pidl.get(), nullptr);
+	EXPECT_EQ(pidl.Clone(), nullptr);
+
+	SharedPidl nullPidl(unique_pidl_absolute(nullptr));
+	EXPECT_FALSE(nullPidl);
+}
+
+TEST(SharedPidlTest, CopiesShareStorage)
+{
+	unique_pidl_absolute original(SHSimpleIDListFromPath(L"C:\\Fake\\Folder"));
+	ASSERT_NE(original, nullptr);
+
+	SharedPidl pidl(original.get());
+	ASSERT_TRUE(pidl);
+
+	// Constructing from a raw PIDL takes a copy.
+	EXPECT_NE(pidl.get(), original.get());
+	EXPECT_TRUE(ArePidlsEquivalent(pidl.get(), original.get()));
+
+	SharedPidl copy = pidl;
+	EXPECT_EQ(copy.get(), pidl.get());
+}
+
+TEST(SharedPidlTest, TakeOwnership)
+{
+	unique_pidl_absolute original(SHSimpleIDListFromPath(L"C:\\Fake\\Folder"));
+	ASSERT_NE(original, nullptr);
+	PCIDLIST_ABSOLUTE rawPidl = original.get();
+
+	SharedPidl pidl(std::move(original));
+	EXPECT_EQ(pidl.get(), rawPidl);
+}
+
+TEST(SharedPidlTest, Clone)
+{
+	SharedPidl pidl(unique_pidl_absolute(SHSimpleIDListFromPath(L"C:\\Fake\\Folder")));
+	ASSERT_TRUE(pidl);
+
+	auto clone = pidl.Clone();
+	ASSERT_NE(clone, nullptr);
+	EXPECT_NE(clone.get(), pidl.get());
+	EXPECT_TRUE(ArePidlsEquivalent(clone.get(), pidl.get()));
+}
+
+TEST(SharedPidlTest, ShallowCopy)
+{
+	std::vector<SharedPidl> pidls = {
+		SharedPidl(unique_pidl_absolute(SHSimpleIDListFromPath(L"C:\\Fake\\Folder1"))),
+		SharedPidl(unique_pidl_absolute(SHSimpleIDListFromPath(L"C:\\Fake\\Folder2")))
+	};
+
+	auto rawPidls = ShallowCopyPidls(pidls);
+	ASSERT_EQ(rawPidls.size(), pidls.size());
+	EXPECT_EQ(rawPidls[0], pidls[0].get());
+	EXPECT_EQ(rawPidls[1], pidls[1].get());
+}
\ No newline at end of file
@@ -0,0 +1,177 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Explorer++/ShellBrowser/ShellChangeCoalescer.h"
+#include <gtest/gtest.h>
+
+using Coalescer = ShellChangeCoalescer<int>;
+using ChangeType = Coalescer::ChangeType;
+
+TEST(ShellChangeCoalescerTest, SingleChanges)
+{
+	Coalescer coalescer;
+	coalescer.AddItem(L"a", 1);
+	coalescer.ModifyItem(L"b", 2);
+	coalescer.RemoveItem(L"c", 3);
+	coalescer.RenameItem(L"d", 4, L"e", 5);
+
+	auto changes = coalescer.TakeChanges();
+	ASSERT_EQ(changes.size(), 4U);
+
+	// Removals should always come first.
+	EXPECT_EQ(changes[0].type, ChangeType::Removed);
+	EXPECT_EQ(changes[0].originalKey, L"c");
+	EXPECT_EQ(changes[0].originalData, 3);
+
+	EXPECT_EQ(changes[1].type, ChangeType::Added);
+	EXPECT_EQ(changes[1].key, L"a");
+	EXPECT_EQ(changes[1].data, 1);
+
+	EXPECT_EQ(changes[2].type, ChangeType::Modified);
+	EXPECT_EQ(changes[2].key, L"b");
+	EXPECT_EQ(changes[2].data, 2);
+
+	EXPECT_EQ(changes[3].type, ChangeType::Renamed);
+	EXPECT_EQ(changes[3].originalKey, L"d");
+	EXPECT_EQ(changes[3].originalData, 4);
+	EXPECT_EQ(changes[3].key, L"e");
+	EXPECT_EQ(changes[3].data, 5);
+}
+
+TEST(ShellChangeCoalescerTest, AddThenRemove)
+{
+	Coalescer coalescer;
+	coalescer.AddItem(L"a", 1);
+	coalescer.ModifyItem(L"a", 2);
+	coalescer.RemoveItem(L"a", 3);
+
+	EXPECT_TRUE(coalescer.TakeChanges().empty());
+}
+
+TEST(ShellChangeCoalescerTest, AddThenModify)
+{
+	Coalescer coalescer;
+	coalescer.AddItem(L"a", 1);
+	coalescer.ModifyItem(L"a", 2);
+	coalescer.ModifyItem(L"a", 3);
+
+	auto changes = coalescer.TakeChanges();
+	ASSERT_EQ(changes.size(), 1U);
+	EXPECT_EQ(changes[0].type, ChangeType::Added);
+	EXPECT_EQ(changes[0].data, 3);
+}
+
+TEST(ShellChangeCoalescerTest, RemoveThenAdd)
+{
+	Coalescer coalescer;
+	coalescer.RemoveItem(L"a", 1);
+	coalescer.AddItem(L"a", 2);
+
+	auto changes = coalescer.TakeChanges();
+	ASSERT_EQ(changes.size(), 1U);
+	EXPECT_EQ(changes[0].type, ChangeType::Modified);
+	EXPECT_EQ(changes[0].originalData, 1);
+	EXPECT_EQ(changes[0].data, 2);
+}
+
+TEST(ShellChangeCoalescerTest, ModifyThenRemove)
+{
+	Coalescer coalescer;
+	coalescer.ModifyItem(L"a", 1);
+	coalescer.ModifyItem(L"a", 2);
+	coalescer.RemoveItem(L"a", 3);
+
+	auto changes = coalescer.TakeChanges();
+	ASSERT_EQ(changes.size(), 1U);
+	EXPECT_EQ(changes[0].type, ChangeType::Removed);
+	EXPECT_EQ(changes[0].originalKey, L"a");
+}
+
+TEST(ShellChangeCoalescerTest, MultipleRenames)
+{
+	Coalescer coalescer;
+	coalescer.RenameItem(L"a", 1, L"b", 2);
+	coalescer.ModifyItem(L"b", 3);
+	coalescer.RenameItem(L"b", 4, L"c", 5);
+
+	auto changes = coalescer.TakeChanges();
+	ASSERT_EQ(changes.size(), 1U);
+	EXPECT_EQ(changes[0].type, ChangeType::Renamed);
+	EXPECT_EQ(changes[0].originalKey, L"a");
+	EXPECT_EQ(changes[0].originalData, 1);
+	EXPECT_EQ(changes[0].key, L"c");
+	EXPECT_EQ(changes[0].data, 5);
+}
+
+TEST(ShellChangeCoalescerTest, RenameBackToOriginalName)
+{
+	Coalescer coalescer;
+	coalescer.RenameItem(L"a", 1, L"b", 2);
+	coalescer.RenameItem(L"b", 3, L"a", 4);
+
+	EXPECT_TRUE(coalescer.TakeChanges().empty());
+}
+
+TEST(ShellChangeCoalescerTest, AddThenRename)
+{
+	Coalescer coalescer;
+	coalescer.AddItem(L"a", 1);
+	coalescer.RenameItem(L"a", 2, L"b", 3);
+
+	auto changes = coalescer.TakeChanges();
+	ASSERT_EQ(changes.size(), 1U);
+	EXPECT_EQ(changes[0].type, ChangeType::Added);
+	EXPECT_EQ(changes[0].key, L"b");
+	EXPECT_EQ(changes[0].data, 3);
+}
+
+TEST(ShellChangeCoalescerTest, RenameOverRemovedItem)
+{
+	Coalescer coalescer;
+	coalescer.RemoveItem(L"b", 1);
+	coalescer.RenameItem(L"a", 2, L"b", 3);
+
+	auto changes = coalescer.TakeChanges();
+	ASSERT_EQ(changes.size(), 2U);
+
+	EXPECT_EQ(changes[0].type, ChangeType::Removed);
+	EXPECT_EQ(changes[0].originalKey, L"b");
+	EXPECT_EQ(changes[0].originalData, 1);
+
+	EXPECT_EQ(changes[1].type, ChangeType::Renamed);
+	EXPECT_EQ(changes[1].originalKey, L"a");
+	EXPECT_EQ(changes[1].key, L"b");
+}
+
+TEST(ShellChangeCoalescerTest, SwapNames)
+{
+	Coalescer coalescer;
+	coalescer.RenameItem(L"a", 1, L"temp", 2);
+	coalescer.RenameItem(L"b", 3, L"a", 4);
+	coalescer.RenameItem(L"temp", 5, L"b", 6);
+
+	auto changes = coalescer.TakeChanges();
+	ASSERT_EQ(changes.size(), 2U);
+
+	EXPECT_EQ(changes[0].type, ChangeType::Renamed);
+	EXPECT_EQ(changes[0].originalKey, L"b");
+	EXPECT_EQ(changes[0].key, L"a");
+
+	EXPECT_EQ(changes[1].type, ChangeType::Renamed);
+	EXPECT_EQ(changes[1].originalKey, L"a");
+	EXPECT_EQ(changes[1].key, L"b");
+}
+
+TEST(ShellChangeCoalescerTest, StateResetAfterTake)
+{
+	Coalescer coalescer;
+	coalescer.AddItem(L"a", 1);
+	EXPECT_EQ(coalescer.TakeChanges().size(), 1U);
+
+	coalescer.RemoveItem(L"a", 2);
+
+	auto changes = coalescer.TakeChanges();
+	ASSERT_EQ(changes.size(), 1U);
+	EXPECT_EQ(changes[0].type, ChangeType::Removed);
+}
\ No newline at end of file
@@ -32,12 +32,34 @@ public:
 	HRESULT BrowseFolder(const HistoryEntry &entry) override
 	{
 		m_navigationStartedSignal(entry.GetPidl().get());
+
+		if (m_deferCommit)
+		{
+			m_deferredPidl.reset(ILCloneFull(entry.GetPidl().get()));
+			return S_OK;
+		}
+
 		m_navigationCommittedSignal(entry.GetPidl().get(), false);
 		m_navigationCompletedSignal(entry.GetPidl().get());
 
 		return S_OK;
 	}
 
+	// When set, navigations to history entries are left pending until
+	// CommitDeferredNavigation() is called, as happens when a remote folder is bound in the
+	// background.
+	void SetDeferCommit(bool deferCommit)
+	{
+		m_deferCommit = deferCommit;
+	}
+
+	void CommitDeferredNavigation()
+	{
+		auto pidl = std::move(m_deferredPidl);
+		m_navigationCommittedSignal(pidl.get(), false);
+		m_navigationCompletedSignal(pidl.get());
+	}
+
 	boost::signals2::connection AddNavigationStartedObserver(
 		const NavigationStartedSignal::slot_type &observer,
 		boost::signals2::connect_position position = boost::signals2::at_back) override
@@ -71,6 +93,9 @@ private:
 	NavigationCommittedSignal m_navigationCommittedSignal;
 	NavigationCompletedSignal m_navigationCompletedSignal;
 	NavigationFailedSignal m_navigationFailedSignal;
+
+	bool m_deferCommit = false;
+	unique_pidl_absolute m_deferredPidl;
 };
 
 class NavigatorMock : public NavigatorInterface
@@ -165,6 +190,11 @@ public:
 		return AddNavigationFailedObserverImpl(observer, position);
 	}
 
+	NavigatorFake &GetFake()
+	{
+		return m_fake;
+	}
+
 private:
 	NavigatorFake m_fake;
 };
@@ -247,7 +277,7 @@ protected:
 		}
 
 		HistoryEntry entry(pidl.get(), displayName);
-		return std::make_unique<PreservedHistoryEntry>(entry);
+		return std::make_unique<PreservedHistoryEntry>(entry, m_pidlStore);
 	}
 
 	NavigatorMock m_navigator;
@@ -255,6 +285,7 @@ protected:
 	IconFetcherMock m_iconFetcher;
 	std::unique_ptr<ShellNavigationController> m_navigationController;
 
+	SharedPidlStore m_pidlStore;
 	std::vector<std::unique_ptr<PreservedHistoryEntry>> m_preservedEntries;
 };
 
@@ -332,6 +363,27 @@ TEST_F(ShellNavigationControllerTest, BackForward)
 	EXPECT_EQ(m_navigationController.GetNumHistoryEntries(), 2);
 }
 
+TEST_F(ShellNavigationControllerTest, BackCommittedAsynchronously)
+{
+	HRESULT hr = NavigateToFolder(L"C:\\Fake1");
+	ASSERT_HRESULT_SUCCEEDED(hr);
+
+	hr = NavigateToFolder(L"C:\\Fake2");
+	ASSERT_HRESULT_SUCCEEDED(hr);
+
+	m_navigator.GetFake().SetDeferCommit(true);
+
+	hr = m_navigationController.GoBack();
+	ASSERT_HRESULT_SUCCEEDED(hr);
+
+	// The current entry shouldn't change until the navigation has been committed.
+	EXPECT_EQ(m_navigationController.GetCurrentIndex(), 1);
+
+	m_navigator.GetFake().CommitDeferredNavigation();
+	EXPECT_EQ(m_navigationController.GetCurrentIndex(), 0);
+	EXPECT_EQ(m_navigationController.GetNumHistoryEntries(), 2);
+}
+
 TEST_F(ShellNavigationControllerTest, RetrieveHistory)
 {
 	HRESULT hr = NavigateToFolder(L"C:\\Fake1");
@@ -526,6 +578,7 @@ TEST_F(ShellNavigationControllerPreservedTest, CheckEntries)
 	{
 		auto entry = m_navigationController->GetEntryAtIndex(static_cast<int>(i));
 		ASSERT_NE(entry, nullptr);
-		EXPECT_TRUE(ArePidlsEquivalent(entry->GetPidl().get(), m_preservedEntries[i]->pidl.get()));
+		EXPECT_TRUE(
+			ArePidlsEquivalent(entry->GetPidl().get(), m_preservedEntries[i]->GetPidl().get()));
 	}
 }
\ No newline at end of file
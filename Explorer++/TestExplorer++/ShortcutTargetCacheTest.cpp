@@ -0,0 +1,86 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Explorer++/ShellBrowser/ShortcutTargetCache.h"
+#include "../Helper/FileOperations.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <map>
+
+class ShortcutTargetCacheTest : public testing::Test
+{
+protected:
+	ShortcutTargetCacheTest() :
+		m_cache(
+			[this](const std::wstring &path)
+			{
+				m_reads[path]++;
+				return L"C:\\Target " + std::to_wstring(m_reads[path]);
+			})
+	{
+	}
+
+	std::map<std::wstring, int> m_reads;
+
+	ShortcutTargetCache m_cache;
+};
+
+TEST_F(ShortcutTargetCacheTest, ShortcutReadOnce)
+{
+	FILETIME lastWriteTime = { 1, 0 };
+
+	EXPECT_EQ(m_cache.GetTarget(L"C:\\links\\link.lnk", lastWriteTime), L"C:\\Target 1");
+	EXPECT_EQ(m_cache.GetTarget(L"C:\\links\\link.lnk", lastWriteTime), L"C:\\Target 1");
+
+	// Paths are compared case-insensitively.
+	EXPECT_EQ(m_cache.GetTarget(L"C:\\LINKS\\LINK.LNK", lastWriteTime), L"C:\\Target 1");
+
+	EXPECT_EQ(m_reads[L"C:\\links\\link.lnk"], 1);
+}
+
+TEST_F(ShortcutTargetCacheTest, ModifiedShortcutReadAgain)
+{
+	FILETIME lastWriteTime = { 1, 0 };
+	FILETIME updatedLastWriteTime = { 2, 0 };
+
+	EXPECT_EQ(m_cache.GetTarget(L"C:\\links\\link.lnk", lastWriteTime), L"C:\\Target 1");
+	EXPECT_EQ(
+		m_cache.GetTarget(L"C:\\links\\link.lnk", updatedLastWriteTime), L"C:\\Target 2");
+	EXPECT_EQ(
+		m_cache.GetTarget(L"C:\\links\\link.lnk", updatedLastWriteTime), L"C:\\Target 2");
+}
+
+TEST_F(ShortcutTargetCacheTest, NotCachedWithoutLastWriteTime)
+{
+	EXPECT_EQ(m_cache.GetTarget(L"C:\\links\\link.lnk", std::nullopt), L"C:\\Target 1");
+	EXPECT_EQ(m_cache.GetTarget(L"C:\\links\\link.lnk", std::nullopt), L"C:\\Target 2");
+}
+
+TEST(ShortcutTargetCacheReadTest, MissingTargetNotResolved)
+{
+	CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
+
+	auto directory = std::filesystem::temp_directory_path()
+		/ (L"ShortcutTargetCacheTest" + std::to_wstring(GetCurrentProcessId()));
+	std::filesystem::create_directory(directory);
+
+	auto target = directory / L"target.txt";
+	auto link = directory / L"link.lnk";
+
+	std::ofstream(target) << "Test";
+
+	ASSERT_EQ(NFileOperations::CreateLinkToFile(target.wstring(), link.wstring(), L""), S_OK);
+
+	// The stored path is returned, even though the target no longer exists.
+	std::filesystem::remove(target);
+	EXPECT_EQ(ShortcutTargetCache::ReadShortcutTarget(link.wstring()), target.wstring());
+
+	// Other files aren't treated as shortcuts.
+	EXPECT_EQ(ShortcutTargetCache::ReadShortcutTarget(target.wstring()), L"");
+
+	std::filesystem::remove_all(directory);
+
+	CoUninitialize();
+}
\ No newline at end of file
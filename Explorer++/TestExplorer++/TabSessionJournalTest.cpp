@@ -0,0 +1,207 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "TabSessionJournal.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+
+using namespace testing;
+
+class TabSessionJournalTest : public Test
+{
+protected:
+	void SetUp() override
+	{
+		m_filePath = std::filesystem::temp_directory_path()
+			/ (L"TabSessionJournalTest" + std::to_wstring(GetCurrentProcessId()) + L".dat");
+	}
+
+	void TearDown() override
+	{
+		std::filesystem::remove(m_filePath);
+	}
+
+	// Builds a pidl containing a single item ID. The journal only checks that the pidl is well
+	// formed, so the contents of the item don't matter.
+	static std::vector<BYTE> BuildDirectory(BYTE value)
+	{
+		return { 3, 0, value, 0, 0 };
+	}
+
+	static TabSessionJournal::TabState BuildTabState(int tabId, BYTE directoryValue)
+	{
+		TabSessionJournal::TabState tabState;
+		tabState.tabId = tabId;
+		tabState.directory = BuildDirectory(directoryValue);
+		return tabState;
+	}
+
+	std::filesystem::path m_filePath;
+};
+
+TEST_F(TabSessionJournalTest, Replay)
+{
+	{
+		TabSessionJournal journal(m_filePath);
+		ASSERT_TRUE(journal.IsOpen());
+
+		journal.RecordTabCreated(1, BuildTabState(-1, 'c'));
+		journal.RecordTabNavigated(0, BuildDirectory('d'));
+		journal.RecordTabUpdated(2, L"Custom", Tab::LockState::Locked);
+		journal.RecordTabMoved(2, 0);
+		journal.RecordTabClosed(2);
+
+		EXPECT_EQ(journal.GetLastSequenceNumber(), 5U);
+	}
+
+	TabSessionJournal journal(m_filePath);
+	EXPECT_EQ(journal.GetLastSequenceNumber(), 5U);
+
+	std::vector<TabSessionJournal::TabState> tabs = { BuildTabState(1, 'a'),
+		BuildTabState(2, 'b') };
+	EXPECT_EQ(journal.Replay(tabs), 5U);
+
+	// The tabs start out as [1, 2]. A new tab is inserted between them, the first tab is
+	// navigated, the second tab is renamed, locked and moved to the front and the new tab is then
+	// closed.
+	ASSERT_EQ(tabs.size(), 2U);
+
+	EXPECT_EQ(tabs[0].tabId, 2);
+	EXPECT_EQ(tabs[0].directory, BuildDirectory('b'));
+	EXPECT_EQ(tabs[0].customName, L"Custom");
+	EXPECT_EQ(tabs[0].lockState, Tab::LockState::Locked);
+
+	EXPECT_EQ(tabs[1].tabId, 1);
+	EXPECT_EQ(tabs[1].directory, BuildDirectory('d'));
+	EXPECT_EQ(tabs[1].customName, L"");
+	EXPECT_EQ(tabs[1].lockState, Tab::LockState::NotLocked);
+}
+
+TEST_F(TabSessionJournalTest, NewTabs)
+{
+	{
+		TabSessionJournal journal(m_filePath);
+		journal.RecordTabCreated(0, BuildTabState(-1, 'b'));
+
+		auto tabState = BuildTabState(-1, 'c');
+		tabState.customName = L"Named";
+		tabState.lockState = Tab::LockState::AddressLocked;
+		journal.RecordTabCreated(10, tabState);
+	}
+
+	TabSessionJournal journal(m_filePath);
+
+	std::vector<TabSessionJournal::TabState> tabs = { BuildTabState(1, 'a') };
+	journal.Replay(tabs);
+
+	// The index of the second tab is out of range, so it should be added at the end.
+	ASSERT_EQ(tabs.size(), 3U);
+	EXPECT_EQ(tabs[0].tabId, -1);
+	EXPECT_EQ(tabs[0].directory, BuildDirectory('b'));
+	EXPECT_EQ(tabs[1].tabId, 1);
+	EXPECT_EQ(tabs[2].tabId, -1);
+	EXPECT_EQ(tabs[2].directory, BuildDirectory('c'));
+	EXPECT_EQ(tabs[2].customName, L"Named");
+	EXPECT_EQ(tabs[2].lockState, Tab::LockState::AddressLocked);
+}
+
+TEST_F(TabSessionJournalTest, InvalidRecords)
+{
+	{
+		TabSessionJournal journal(m_filePath);
+
+		// None of these records fit the tabs they're applied to below.
+		journal.RecordTabNavigated(5, BuildDirectory('b'));
+		journal.RecordTabNavigated(0, { 10, 0, 'b', 0, 0 });
+		journal.RecordTabUpdated(-1, L"Custom", Tab::LockState::Locked);
+		journal.RecordTabMoved(0, 1);
+		journal.RecordTabClosed(1);
+		journal.RecordTabCreated(0, TabSessionJournal::TabState());
+	}
+
+	TabSessionJournal journal(m_filePath);
+
+	std::vector<TabSessionJournal::TabState> tabs = { BuildTabState(1, 'a') };
+	EXPECT_EQ(journal.Replay(tabs), 6U);
+
+	ASSERT_EQ(tabs.size(), 1U);
+	EXPECT_EQ(tabs[0].tabId, 1);
+	EXPECT_EQ(tabs[0].directory, BuildDirectory('a'));
+	EXPECT_EQ(tabs[0].customName, L"");
+	EXPECT_EQ(tabs[0].lockState, Tab::LockState::NotLocked);
+}
+
+TEST_F(TabSessionJournalTest, Compact)
+{
+	TabSessionJournal journal(m_filePath);
+	journal.RecordTabNavigated(0, BuildDirectory('b'));
+	journal.RecordTabNavigated(0, BuildDirectory('c'));
+
+	uint64_t sequenceNumber = journal.GetLastSequenceNumber();
+
+	journal.RecordTabCreated(1, BuildTabState(-1, 'd'));
+
+	EXPECT_TRUE(journal.Compact(sequenceNumber));
+
+	// Only the record made after the compaction point should remain.
+	std::vector<TabSessionJournal::TabState> tabs = { BuildTabState(1, 'a') };
+	EXPECT_EQ(journal.Replay(tabs), 1U);
+
+	ASSERT_EQ(tabs.size(), 2U);
+	EXPECT_EQ(tabs[0].directory, BuildDirectory('a'));
+	EXPECT_EQ(tabs[1].directory, BuildDirectory('d'));
+
+	// The numbering continues from where it was.
+	journal.RecordTabClosed(1);
+	EXPECT_EQ(journal.GetLastSequenceNumber(), sequenceNumber + 2);
+
+	EXPECT_TRUE(journal.Compact(journal.GetLastSequenceNumber()));
+	EXPECT_EQ(std::filesystem::file_size(m_filePath), 0U);
+}
+
+TEST_F(TabSessionJournalTest, PartialRecord)
+{
+	{
+		TabSessionJournal journal(m_filePath);
+		journal.RecordTabNavigated(0, BuildDirectory('b'));
+	}
+
+	{
+		// Simulates a record that was only partially written.
+		std::ofstream stream(m_filePath, std::ios::binary | std::ios::app);
+		uint32_t size = 100;
+		stream.write(reinterpret_cast<const char *>(&size), sizeof(size));
+		stream.write("abc", 3);
+	}
+
+	{
+		// The partial record should be removed, so that this record can be read back.
+		TabSessionJournal journal(m_filePath);
+		journal.RecordTabCreated(1, BuildTabState(-1, 'c'));
+	}
+
+	TabSessionJournal journal(m_filePath);
+
+	std::vector<TabSessionJournal::TabState> tabs = { BuildTabState(1, 'a') };
+	EXPECT_EQ(journal.Replay(tabs), 2U);
+
+	ASSERT_EQ(tabs.size(), 2U);
+	EXPECT_EQ(tabs[0].directory, BuildDirectory('b'));
+	EXPECT_EQ(tabs[1].directory, BuildDirectory('c'));
+}
+
+TEST_F(TabSessionJournalTest, SingleInstance)
+{
+	TabSessionJournal journal(m_filePath);
+	EXPECT_TRUE(journal.IsOpen());
+
+	// The file is already in use, so a second journal shouldn't be able to use it.
+	TabSessionJournal secondJournal(m_filePath);
+	EXPECT_FALSE(secondJournal.IsOpen());
+
+	secondJournal.RecordTabClosed(0);
+	EXPECT_EQ(secondJournal.GetLastSequenceNumber(), 0U);
+	EXPECT_EQ(journal.GetLastSequenceNumber(), 0U);
+}
\ No newline at end of file
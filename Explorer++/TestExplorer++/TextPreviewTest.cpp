@@ -0,0 +1,53 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/TextPreview.h"
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using namespace testing;
+using namespace std::string_view_literals;
+
+TEST(TextPreviewTest, SplitLines)
+{
+	EXPECT_THAT(TextPreview::DecodeLines("first\r\nsecond\nthird", 10, false),
+		ElementsAre(L"first", L"second", L"third"));
+	EXPECT_THAT(TextPreview::DecodeLines("", 10, false), IsEmpty());
+}
+
+TEST(TextPreviewTest, MaxLines)
+{
+	EXPECT_THAT(
+		TextPreview::DecodeLines("1\n2\n3\n4\n", 2, false), ElementsAre(L"1", L"2"));
+}
+
+TEST(TextPreviewTest, TruncatedData)
+{
+	// The final line may be incomplete, so it's dropped.
+	EXPECT_THAT(TextPreview::DecodeLines("first\nsecond\nthi", 10, true),
+		ElementsAre(L"first", L"second"));
+
+	// Unless it's the only line.
+	EXPECT_THAT(TextPreview::DecodeLines("a very long line", 10, true),
+		ElementsAre(L"a very long line"));
+
+	// A multi-byte character that's been cut off is removed.
+	EXPECT_THAT(TextPreview::DecodeLines("caf\xC3\xA9 \xC3", 10, true),
+		ElementsAre(L"caf\u00E9 "));
+}
+
+TEST(TextPreviewTest, Utf8)
+{
+	EXPECT_THAT(TextPreview::DecodeLines("\xEF\xBB\xBF" "caf\xC3\xA9", 10, false),
+		ElementsAre(L"caf\u00E9"));
+	EXPECT_THAT(TextPreview::DecodeLines("caf\xC3\xA9", 10, false), ElementsAre(L"caf\u00E9"));
+}
+
+TEST(TextPreviewTest, Utf16)
+{
+	EXPECT_THAT(TextPreview::DecodeLines("\xFF\xFE" "a\0\n\0b\0"sv, 10, false),
+		ElementsAre(L"a", L"b"));
+	EXPECT_THAT(TextPreview::DecodeLines("\xFE\xFF" "\0a\0\n\0b"sv, 10, false),
+		ElementsAre(L"a", L"b"));
+}
\ No newline at end of file
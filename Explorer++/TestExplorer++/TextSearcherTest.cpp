@@ -0,0 +1,100 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/TextSearcher.h"
+#include <gtest/gtest.h>
+#include <stdexcept>
+
+using namespace std::string_view_literals;
+
+TEST(TextSearcherTest, Literal)
+{
+	TextSearcher searcher(L"error", false, false);
+
+	auto match = searcher.SearchData("first line\r\nsecond line\r\n\tan error occurred\r\nlast");
+	ASSERT_TRUE(match.has_value());
+	EXPECT_EQ(match->lineNumber, 3U);
+	EXPECT_EQ(match->line, L"an error occurred");
+
+	EXPECT_FALSE(searcher.SearchData("no match\nERROR\n").has_value());
+	EXPECT_FALSE(searcher.SearchData("").has_value());
+}
+
+TEST(TextSearcherTest, CaseInsensitive)
+{
+	TextSearcher searcher(L"Error", false, true);
+
+	auto match = searcher.SearchData("line\nAN ERROR\n");
+	ASSERT_TRUE(match.has_value());
+	EXPECT_EQ(match->lineNumber, 2U);
+	EXPECT_EQ(match->line, L"AN ERROR");
+}
+
+TEST(TextSearcherTest, RegularExpression)
+{
+	TextSearcher searcher(L"^id=\\d+$", true, false);
+
+	auto match = searcher.SearchData("xid=1\nid=12x\nid=123\r\nid=4\n");
+	ASSERT_TRUE(match.has_value());
+	EXPECT_EQ(match->lineNumber, 3U);
+	EXPECT_EQ(match->line, L"id=123");
+
+	EXPECT_THROW(TextSearcher(L"(", true, false), std::invalid_argument);
+}
+
+TEST(TextSearcherTest, Encodings)
+{
+	TextSearcher searcher(L"caf\u00E9", false, false);
+
+	auto match = searcher.SearchData("\xEF\xBB\xBFmenu\ncaf\xC3\xA9\n");
+	ASSERT_TRUE(match.has_value());
+	EXPECT_EQ(match->lineNumber, 2U);
+
+	// Without a byte order mark, valid UTF-8 is detected.
+	match = searcher.SearchData("caf\xC3\xA9");
+	ASSERT_TRUE(match.has_value());
+	EXPECT_EQ(match->line, L"caf\u00E9");
+
+	// The same text, encoded in UTF-16 (in both byte orders).
+	match = searcher.SearchData("\xFF\xFEx\0\n\0c\0a\0f\0\xE9\0"sv);
+	ASSERT_TRUE(match.has_value());
+	EXPECT_EQ(match->lineNumber, 2U);
+	EXPECT_EQ(match->line, L"caf\u00E9");
+
+	match = searcher.SearchData("\xFE\xFF\0x\0\n\0c\0a\0f\0\xE9"sv);
+	ASSERT_TRUE(match.has_value());
+	EXPECT_EQ(match->lineNumber, 2U);
+	EXPECT_EQ(match->line, L"caf\u00E9");
+}
+
+TEST(TextSearcherTest, Binary)
+{
+	TextSearcher searcher(L"text", false, false);
+
+	EXPECT_TRUE(TextSearcher::IsBinary("text\0text"sv));
+	EXPECT_FALSE(TextSearcher::IsBinary("text text"));
+	EXPECT_FALSE(searcher.SearchData("text\0text"sv).has_value());
+}
+
+TEST(TextSearcherTest, LargeData)
+{
+	TextSearcher searcher(L"needle", false, false);
+
+	// The data is searched in chunks, so line numbers need to be carried over between them.
+	std::string data;
+
+	for (int i = 0; i < 300000; i++)
+	{
+		data += "haystack\n";
+	}
+
+	data += "a long line with a needle in it";
+	data += std::string(2000, 'x');
+
+	auto match = searcher.SearchData(data);
+	ASSERT_TRUE(match.has_value());
+	EXPECT_EQ(match->lineNumber, 300001U);
+	EXPECT_EQ(match->line.size(), TextSearcher::MAX_LINE_LENGTH);
+	EXPECT_EQ(match->line.find(L"a long line"), 0U);
+}
\ No newline at end of file
@@ -0,0 +1,57 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/ThemeResourceCache.h"
+#include <gtest/gtest.h>
+
+TEST(ThemeResourceCacheTest, SolidBrushReused)
+{
+	ThemeResourceCache cache;
+
+	HBRUSH brush = cache.GetSolidBrush(RGB(32, 32, 32));
+	ASSERT_NE(brush, nullptr);
+	EXPECT_EQ(cache.GetSolidBrush(RGB(32, 32, 32)), brush);
+
+	LOGBRUSH logBrush;
+	ASSERT_EQ(GetObject(brush, sizeof(logBrush), &logBrush), static_cast<int>(sizeof(logBrush)));
+	EXPECT_EQ(logBrush.lbColor, RGB(32, 32, 32));
+
+	EXPECT_NE(cache.GetSolidBrush(RGB(255, 255, 255)), brush);
+}
+
+TEST(ThemeResourceCacheTest, SolidBrushKeptAfterClear)
+{
+	ThemeResourceCache cache;
+
+	HBRUSH brush = cache.GetSolidBrush(RGB(32, 32, 32));
+	cache.Clear();
+	EXPECT_EQ(cache.GetSolidBrush(RGB(32, 32, 32)), brush);
+}
+
+TEST(ThemeResourceCacheTest, CaptionFontPerDpi)
+{
+	ThemeResourceCache cache;
+
+	HFONT font = cache.GetCaptionFont(USER_DEFAULT_SCREEN_DPI);
+	ASSERT_NE(font, nullptr);
+	EXPECT_EQ(cache.GetCaptionFont(USER_DEFAULT_SCREEN_DPI), font);
+
+	HFONT scaledFont = cache.GetCaptionFont(USER_DEFAULT_SCREEN_DPI * 2);
+	ASSERT_NE(scaledFont, nullptr);
+	EXPECT_NE(scaledFont, font);
+}
+
+TEST(ThemeResourceCacheTest, CaptionFontRecreatedAfterClear)
+{
+	ThemeResourceCache cache;
+
+	cache.GetCaptionFont(USER_DEFAULT_SCREEN_DPI);
+	cache.Clear();
+
+	HFONT font = cache.GetCaptionFont(USER_DEFAULT_SCREEN_DPI);
+	ASSERT_NE(font, nullptr);
+
+	LOGFONT logFont;
+	EXPECT_EQ(GetObject(font, sizeof(logFont), &logFont), static_cast<int>(sizeof(logFont)));
+}
\ No newline at end of file
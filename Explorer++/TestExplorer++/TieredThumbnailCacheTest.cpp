@@ -0,0 +1,133 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/TieredThumbnailCache.h"
+#include <gtest/gtest.h>
+
+namespace
+{
+
+TieredThumbnailCache::Image MakeImage(int width, int height, uint32_t color)
+{
+	TieredThumbnailCache::Image image;
+	image.width = width;
+	image.height = height;
+	image.pixels.resize(static_cast<size_t>(width) * height, color);
+	return image;
+}
+
+}
+
+TEST(TieredThumbnailCacheTest, Missing)
+{
+	TieredThumbnailCache cache(1024 * 1024);
+	EXPECT_EQ(cache.Get(L"item", 100), nullptr);
+}
+
+TEST(TieredThumbnailCacheTest, OriginalSize)
+{
+	TieredThumbnailCache cache(1024 * 1024);
+	cache.Insert(L"item", MakeImage(64, 32, 0xFF0000FF));
+
+	// The image is never enlarged.
+	auto image = cache.Get(L"item", 100);
+	ASSERT_NE(image, nullptr);
+	EXPECT_EQ(image->width, 64);
+	EXPECT_EQ(image->height, 32);
+}
+
+TEST(TieredThumbnailCacheTest, Scaled)
+{
+	TieredThumbnailCache cache(1024 * 1024);
+	cache.Insert(L"item", MakeImage(256, 128, 0xFF0000FF));
+
+	auto image = cache.Get(L"item", 64);
+	ASSERT_NE(image, nullptr);
+	EXPECT_EQ(image->width, 64);
+	EXPECT_EQ(image->height, 32);
+	EXPECT_EQ(image->pixels.size(), 64u * 32u);
+	EXPECT_EQ(image->pixels[0], 0xFF0000FFu);
+
+	// The scaled version is retained.
+	EXPECT_EQ(cache.Get(L"item", 64), image);
+
+	auto tallImage = cache.Get(L"item", 32);
+	ASSERT_NE(tallImage, nullptr);
+	EXPECT_EQ(tallImage->width, 32);
+	EXPECT_EQ(tallImage->height, 16);
+}
+
+TEST(TieredThumbnailCacheTest, Replace)
+{
+	TieredThumbnailCache cache(1024 * 1024);
+	cache.Insert(L"item", MakeImage(128, 128, 0xFF0000FF));
+	cache.Get(L"item", 64);
+
+	// Replacing the original should also discard the scaled versions that were generated from it.
+	cache.Insert(L"item", MakeImage(128, 128, 0xFF00FF00));
+
+	auto image = cache.Get(L"item", 64);
+	ASSERT_NE(image, nullptr);
+	EXPECT_EQ(image->pixels[0], 0xFF00FF00u);
+}
+
+TEST(TieredThumbnailCacheTest, Eviction)
+{
+	// Enough space for two of the images (plus some overhead), but not three.
+	const size_t maxBytes = (64 * 64 * sizeof(uint32_t) + 1024) * 2;
+	TieredThumbnailCache cache(maxBytes);
+	cache.Insert(L"item1", MakeImage(64, 64, 0));
+	cache.Insert(L"item2", MakeImage(64, 64, 0));
+
+	// item1 is now the most recently used item, so item2 should be removed when the next item is
+	// added.
+	cache.Get(L"item1", 64);
+	cache.Insert(L"item3", MakeImage(64, 64, 0));
+
+	EXPECT_NE(cache.Get(L"item1", 64), nullptr);
+	EXPECT_EQ(cache.Get(L"item2", 64), nullptr);
+	EXPECT_NE(cache.Get(L"item3", 64), nullptr);
+	EXPECT_LE(cache.GetSizeInBytes(), maxBytes);
+}
+
+TEST(TieredThumbnailCacheTest, TrimToSize)
+{
+	TieredThumbnailCache cache(1024 * 1024);
+	cache.Insert(L"item1", MakeImage(64, 64, 0));
+	cache.Insert(L"item2", MakeImage(64, 64, 0));
+	cache.Insert(L"item3", MakeImage(64, 64, 0));
+
+	cache.Get(L"item1", 64);
+	cache.TrimToSize(cache.GetSizeInBytes() - 1);
+
+	// item2 is the least recently used item.
+	EXPECT_NE(cache.Get(L"item1", 64), nullptr);
+	EXPECT_EQ(cache.Get(L"item2", 64), nullptr);
+	EXPECT_NE(cache.Get(L"item3", 64), nullptr);
+
+	cache.TrimToSize(0);
+	EXPECT_EQ(cache.Get(L"item1", 64), nullptr);
+	EXPECT_EQ(cache.Get(L"item3", 64), nullptr);
+	EXPECT_EQ(cache.GetSizeInBytes(), 0U);
+}
+
+TEST(TieredThumbnailCacheTest, GetScaledDimensions)
+{
+	EXPECT_EQ(TieredThumbnailCache::GetScaledDimensions(200, 100, 50), std::make_pair(50, 25));
+	EXPECT_EQ(TieredThumbnailCache::GetScaledDimensions(100, 200, 50), std::make_pair(25, 50));
+	EXPECT_EQ(TieredThumbnailCache::GetScaledDimensions(1000, 1, 50), std::make_pair(50, 1));
+}
+
+TEST(TieredThumbnailCacheTest, ScaleImage)
+{
+	auto scaled = TieredThumbnailCache::ScaleImage(MakeImage(200, 100, 0xFF00FF00), 50);
+	EXPECT_EQ(scaled.width, 50);
+	EXPECT_EQ(scaled.height, 25);
+	EXPECT_EQ(scaled.pixels.size(), 50u * 25u);
+	EXPECT_EQ(scaled.pixels[0], 0xFF00FF00);
+
+	auto unscaled = TieredThumbnailCache::ScaleImage(MakeImage(20, 10, 0), 50);
+	EXPECT_EQ(unscaled.width, 20);
+	EXPECT_EQ(unscaled.height, 10);
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/Treemap.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+
+using namespace testing;
+
+namespace
+{
+
+bool IsWithinBounds(const TreemapRect &rect, const TreemapRect &bounds)
+{
+	const double tolerance = 1e-9;
+
+	return rect.left >= bounds.left - tolerance && rect.top >= bounds.top - tolerance
+		&& rect.left + rect.width <= bounds.left + bounds.width + tolerance
+		&& rect.top + rect.height <= bounds.top + bounds.height + tolerance;
+}
+
+bool DoRectsOverlap(const TreemapRect &rect1, const TreemapRect &rect2)
+{
+	const double tolerance = 1e-9;
+
+	return rect1.left + tolerance < rect2.left + rect2.width
+		&& rect2.left + tolerance < rect1.left + rect1.width
+		&& rect1.top + tolerance < rect2.top + rect2.height
+		&& rect2.top + tolerance < rect1.top + rect1.height;
+}
+
+}
+
+TEST(TreemapTest, AreasAreProportional)
+{
+	std::vector<double> sizes = { 6, 6, 4, 3, 2, 2, 1 };
+	TreemapRect bounds = { 10, 20, 600, 400 };
+	auto rects = LayoutSquarifiedTreemap(sizes, bounds);
+
+	ASSERT_EQ(rects.size(), sizes.size());
+
+	double scale = (bounds.width * bounds.height) / 24;
+
+	for (size_t i = 0; i < rects.size(); i++)
+	{
+		EXPECT_NEAR(rects[i].width * rects[i].height, sizes[i] * scale, 1e-6);
+		EXPECT_TRUE(IsWithinBounds(rects[i], bounds));
+
+		for (size_t j = i + 1; j < rects.size(); j++)
+		{
+			EXPECT_FALSE(DoRectsOverlap(rects[i], rects[j]));
+		}
+	}
+}
+
+TEST(TreemapTest, EqualSizesAreSquare)
+{
+	auto rects = LayoutSquarifiedTreemap({ 1, 1, 1, 1 }, { 0, 0, 100, 100 });
+
+	ASSERT_EQ(rects.size(), 4U);
+
+	for (const auto &rect : rects)
+	{
+		EXPECT_NEAR(rect.width, 50, 1e-9);
+		EXPECT_NEAR(rect.height, 50, 1e-9);
+	}
+}
+
+TEST(TreemapTest, AspectRatios)
+{
+	// Laying these out as a single row would produce very thin rectangles.
+	std::vector<double> sizes(20, 1);
+	auto rects = LayoutSquarifiedTreemap(sizes, { 0, 0, 500, 400 });
+
+	for (const auto &rect : rects)
+	{
+		double aspectRatio =
+			(std::max)(rect.width, rect.height) / (std::min)(rect.width, rect.height);
+		EXPECT_LT(aspectRatio, 3);
+	}
+}
+
+TEST(TreemapTest, EmptyItems)
+{
+	auto rects = LayoutSquarifiedTreemap({ 3, 1, 0 }, { 0, 0, 40, 10 });
+
+	ASSERT_EQ(rects.size(), 3U);
+	EXPECT_NEAR(rects[0].width * rects[0].height, 300, 1e-9);
+	EXPECT_NEAR(rects[1].width * rects[1].height, 100, 1e-9);
+	EXPECT_EQ(rects[2].width * rects[2].height, 0);
+
+	rects = LayoutSquarifiedTreemap({ 0, 0 }, { 0, 0, 40, 10 });
+
+	for (const auto &rect : rects)
+	{
+		EXPECT_EQ(rect.width * rect.height, 0);
+	}
+}
\ No newline at end of file
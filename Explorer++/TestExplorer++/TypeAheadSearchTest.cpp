@@ -0,0 +1,101 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/TypeAheadSearch.h"
+#include <gtest/gtest.h>
+
+using namespace std::chrono_literals;
+
+class TypeAheadSearchTest : public testing::Test
+{
+protected:
+	TypeAheadSearchTest() : m_search(1000ms)
+	{
+	}
+
+	std::optional<TypeAheadSearch::Query> AddCharacter(
+		wchar_t character, std::chrono::milliseconds delay = 100ms)
+	{
+		m_now += delay;
+		return m_search.AddCharacter(character, m_now);
+	}
+
+	TypeAheadSearch m_search;
+	std::chrono::steady_clock::time_point m_now;
+};
+
+TEST_F(TypeAheadSearchTest, CharactersAreCombined)
+{
+	auto query = AddCharacter(L'r');
+	ASSERT_TRUE(query);
+	EXPECT_EQ(query->prefix, L"r");
+	EXPECT_TRUE(query->startAfterCurrent);
+
+	query = AddCharacter(L'e');
+	ASSERT_TRUE(query);
+	EXPECT_EQ(query->prefix, L"re");
+	EXPECT_FALSE(query->startAfterCurrent);
+
+	query = AddCharacter(L' ');
+	ASSERT_TRUE(query);
+	EXPECT_EQ(query->prefix, L"re ");
+}
+
+TEST_F(TypeAheadSearchTest, Timeout)
+{
+	AddCharacter(L'a');
+	AddCharacter(L'b');
+
+	auto query = AddCharacter(L'c', 2000ms);
+	ASSERT_TRUE(query);
+	EXPECT_EQ(query->prefix, L"c");
+	EXPECT_TRUE(query->startAfterCurrent);
+}
+
+TEST_F(TypeAheadSearchTest, RepeatedCharacterCycles)
+{
+	AddCharacter(L'd');
+
+	auto query = AddCharacter(L'd');
+	ASSERT_TRUE(query);
+	EXPECT_EQ(query->prefix, L"d");
+	EXPECT_TRUE(query->startAfterCurrent);
+
+	query = AddCharacter(L'D');
+	ASSERT_TRUE(query);
+	EXPECT_EQ(query->prefix, L"d");
+	EXPECT_TRUE(query->startAfterCurrent);
+}
+
+TEST_F(TypeAheadSearchTest, IgnoredCharacters)
+{
+	EXPECT_FALSE(AddCharacter(L' '));
+	EXPECT_FALSE(AddCharacter(L'\b'));
+	EXPECT_FALSE(AddCharacter(L'\r'));
+
+	AddCharacter(L'a');
+	m_search.Reset();
+	EXPECT_FALSE(AddCharacter(L' '));
+}
+
+TEST(TypeAheadSearchFindNextMatchTest, WrapsAround)
+{
+	std::vector<int> positions = { 7, 2, 5 };
+
+	EXPECT_EQ(TypeAheadSearch::FindNextMatch(positions, 0, 10), 1u);
+	EXPECT_EQ(TypeAheadSearch::FindNextMatch(positions, 2, 10), 1u);
+	EXPECT_EQ(TypeAheadSearch::FindNextMatch(positions, 3, 10), 2u);
+	EXPECT_EQ(TypeAheadSearch::FindNextMatch(positions, 6, 10), 0u);
+	EXPECT_EQ(TypeAheadSearch::FindNextMatch(positions, 8, 10), 1u);
+
+	// A start position past the end of the list wraps around.
+	EXPECT_EQ(TypeAheadSearch::FindNextMatch(positions, 10, 10), 1u);
+}
+
+TEST(TypeAheadSearchFindNextMatchTest, NoMatch)
+{
+	EXPECT_EQ(TypeAheadSearch::FindNextMatch({}, 0, 10), std::nullopt);
+	EXPECT_EQ(TypeAheadSearch::FindNextMatch({ 12 }, 0, 10), std::nullopt);
+	EXPECT_EQ(TypeAheadSearch::FindNextMatch({ 1 }, 0, 0), std::nullopt);
+}
\ No newline at end of file
@@ -0,0 +1,98 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/UniversalPathCache.h"
+#include <gtest/gtest.h>
+#include <map>
+
+class UniversalPathCacheTest : public testing::Test
+{
+protected:
+	UniversalPathCacheTest() :
+		m_cache([this](const std::wstring &root) -> std::optional<std::wstring>
+			{
+				m_queries[root]++;
+
+				if (root == L"Z:\\")
+				{
+					return L"\\\\server\\share";
+				}
+				else if (root == L"Y:\\")
+				{
+					return L"\\\\server\\share\\folder\\";
+				}
+
+				return std::nullopt;
+			})
+	{
+	}
+
+	UniversalPathCache m_cache;
+	std::map<std::wstring, int> m_queries;
+};
+
+TEST_F(UniversalPathCacheTest, GetUniversalPath)
+{
+	EXPECT_EQ(m_cache.GetUniversalPath(L"Z:\\Reports\\2021.xlsx"),
+		L"\\\\server\\share\\Reports\\2021.xlsx");
+	EXPECT_EQ(m_cache.GetUniversalPath(L"z:\\Reports"), L"\\\\server\\share\\Reports");
+	EXPECT_EQ(m_cache.GetUniversalPath(L"Z:\\"), L"\\\\server\\share\\");
+	EXPECT_EQ(m_cache.GetUniversalPath(L"Y:\\file.txt"), L"\\\\server\\share\\folder\\file.txt");
+
+	// Paths that aren't on a mapped network drive should be returned unchanged.
+	EXPECT_EQ(m_cache.GetUniversalPath(L"C:\\Windows"), L"C:\\Windows");
+	EXPECT_EQ(m_cache.GetUniversalPath(L"\\\\server\\share\\file.txt"),
+		L"\\\\server\\share\\file.txt");
+	EXPECT_EQ(m_cache.GetUniversalPath(L"::{20D04FE0-3AEA-1069-A2D8-08002B30309D}"),
+		L"::{20D04FE0-3AEA-1069-A2D8-08002B30309D}");
+}
+
+TEST_F(UniversalPathCacheTest, GetUniversalPaths)
+{
+	std::vector<std::wstring> paths = { L"Z:\\a.txt", L"C:\\b.txt", L"Z:\\folder\\c.txt",
+		L"Y:\\d.txt" };
+
+	EXPECT_EQ(m_cache.GetUniversalPaths(paths, L"\r\n"),
+		L"\\\\server\\share\\a.txt\r\nC:\\b.txt\r\n\\\\server\\share\\folder\\c.txt\r\n"
+		L"\\\\server\\share\\folder\\d.txt");
+
+	EXPECT_EQ(m_cache.GetUniversalPaths({}, L"\r\n"), L"");
+}
+
+TEST_F(UniversalPathCacheTest, DrivesQueriedOnce)
+{
+	std::vector<std::wstring> paths;
+
+	for (int i = 0; i < 100; i++)
+	{
+		paths.push_back(L"Z:\\file" + std::to_wstring(i));
+		paths.push_back(L"C:\\file" + std::to_wstring(i));
+	}
+
+	m_cache.GetUniversalPaths(paths, L"\r\n");
+	m_cache.GetUniversalPath(L"Z:\\file");
+	m_cache.GetUniversalPath(L"C:\\file");
+
+	EXPECT_EQ(m_queries[L"Z:\\"], 1);
+	EXPECT_EQ(m_queries[L"C:\\"], 1);
+}
+
+TEST_F(UniversalPathCacheTest, InvalidateDrive)
+{
+	m_cache.GetUniversalPath(L"Z:\\file");
+	m_cache.GetUniversalPath(L"C:\\file");
+
+	m_cache.InvalidateDrive(L"Z:\\");
+
+	m_cache.GetUniversalPath(L"Z:\\file");
+	m_cache.GetUniversalPath(L"C:\\file");
+
+	EXPECT_EQ(m_queries[L"Z:\\"], 2);
+	EXPECT_EQ(m_queries[L"C:\\"], 1);
+
+	m_cache.Clear();
+	m_cache.GetUniversalPath(L"C:\\file");
+
+	EXPECT_EQ(m_queries[L"C:\\"], 2);
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/VersionedSnapshot.h"
+#include <gtest/gtest.h>
+#include <string>
+
+TEST(VersionedSnapshotTest, SnapshotSharedWhileUnchanged)
+{
+	VersionedSnapshot<std::wstring> versionedSnapshot;
+
+	auto snapshot1 = versionedSnapshot.Update(L"value");
+	auto snapshot2 = versionedSnapshot.Update(L"value");
+
+	EXPECT_EQ(snapshot1, snapshot2);
+	EXPECT_EQ(snapshot1->value, L"value");
+	EXPECT_TRUE(versionedSnapshot.IsCurrent(snapshot1->version));
+}
+
+TEST(VersionedSnapshotTest, SnapshotReplacedOnChange)
+{
+	VersionedSnapshot<std::wstring> versionedSnapshot;
+
+	auto snapshot1 = versionedSnapshot.Update(L"first");
+	auto snapshot2 = versionedSnapshot.Update(L"second");
+
+	EXPECT_NE(snapshot1, snapshot2);
+	EXPECT_NE(snapshot1->version, snapshot2->version);
+
+	// The previous snapshot remains valid for anything still holding it.
+	EXPECT_EQ(snapshot1->value, L"first");
+	EXPECT_EQ(snapshot2->value, L"second");
+
+	EXPECT_FALSE(versionedSnapshot.IsCurrent(snapshot1->version));
+	EXPECT_TRUE(versionedSnapshot.IsCurrent(snapshot2->version));
+}
+
+TEST(VersionedSnapshotTest, NoSnapshot)
+{
+	VersionedSnapshot<int> versionedSnapshot;
+	EXPECT_FALSE(versionedSnapshot.IsCurrent(0));
+}
\ No newline at end of file
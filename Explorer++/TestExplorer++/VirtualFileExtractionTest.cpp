@@ -0,0 +1,172 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/VirtualFileExtraction.h"
+#include "../Helper/DataExchangeHelper.h"
+#include "../Helper/DragDropHelper.h"
+#include "../Helper/iDataObject.h"
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <wil/com.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+using namespace testing;
+
+class VirtualFileExtractionTest : public Test
+{
+protected:
+	VirtualFileExtractionTest()
+	{
+		// The data object used here doesn't support marshalling, so the worker threads need to be
+		// in the same apartment as this thread.
+		CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+		m_dataObject.attach(CreateDataObject(nullptr, nullptr, 0));
+	}
+
+	~VirtualFileExtractionTest()
+	{
+		m_dataObject.reset();
+		CoUninitialize();
+	}
+
+	void SetUp() override
+	{
+		m_destination = std::filesystem::temp_directory_path()
+			/ (L"VirtualFileExtractionTest" + std::to_wstring(GetCurrentProcessId()));
+		std::filesystem::create_directories(m_destination);
+	}
+
+	void TearDown() override
+	{
+		std::filesystem::remove_all(m_destination);
+	}
+
+	void SetDescriptors(const std::vector<FILEDESCRIPTORW> &descriptors)
+	{
+		std::string data(offsetof(FILEGROUPDESCRIPTORW, fgd)
+				+ descriptors.size() * sizeof(FILEDESCRIPTORW),
+			'\0');
+
+		auto *groupDescriptor = reinterpret_cast<FILEGROUPDESCRIPTORW *>(data.data());
+		groupDescriptor->cItems = static_cast<UINT>(descriptors.size());
+		std::copy(descriptors.begin(), descriptors.end(), groupDescriptor->fgd);
+
+		SetGlobalData(CFSTR_FILEDESCRIPTORW, data);
+	}
+
+	// The data object returns the same contents for each file.
+	void SetContents(const std::string &contents)
+	{
+		SetGlobalData(CFSTR_FILECONTENTS, contents);
+	}
+
+	static FILEDESCRIPTORW BuildFileDescriptor(const std::wstring &name, ULONGLONG size)
+	{
+		FILEDESCRIPTORW descriptor = {};
+		descriptor.dwFlags = FD_FILESIZE | FD_UNICODE;
+		descriptor.nFileSizeLow = static_cast<DWORD>(size);
+		descriptor.nFileSizeHigh = static_cast<DWORD>(size >> 32);
+		wcsncpy_s(descriptor.cFileName, name.c_str(), _TRUNCATE);
+		return descriptor;
+	}
+
+	static FILEDESCRIPTORW BuildFolderDescriptor(const std::wstring &name)
+	{
+		FILEDESCRIPTORW descriptor = {};
+		descriptor.dwFlags = FD_ATTRIBUTES | FD_UNICODE;
+		descriptor.dwFileAttributes = FILE_ATTRIBUTE_DIRECTORY;
+		wcsncpy_s(descriptor.cFileName, name.c_str(), _TRUNCATE);
+		return descriptor;
+	}
+
+	static std::string ReadFile(const std::filesystem::path &path)
+	{
+		std::ifstream stream(path, std::ios::binary);
+		std::stringstream contents;
+		contents << stream.rdbuf();
+		return contents.str();
+	}
+
+	wil::com_ptr_nothrow<IDataObject> m_dataObject;
+	std::filesystem::path m_destination;
+
+private:
+	void SetGlobalData(const TCHAR *format, const std::string &data)
+	{
+		FORMATETC formatEtc = { static_cast<CLIPFORMAT>(RegisterClipboardFormat(format)), nullptr,
+			DVASPECT_CONTENT, -1, TYMED_HGLOBAL };
+
+		auto global = WriteBinaryDataToGlobal(data);
+		ASSERT_NE(global, nullptr);
+
+		STGMEDIUM stgMedium = GetStgMediumForGlobal(global.get());
+		HRESULT hr = m_dataObject->SetData(&formatEtc, &stgMedium, TRUE);
+		ASSERT_HRESULT_SUCCEEDED(hr);
+
+		global.release();
+	}
+};
+
+TEST_F(VirtualFileExtractionTest, HasVirtualFiles)
+{
+	EXPECT_FALSE(HasVirtualFiles(m_dataObject.get()));
+
+	SetDescriptors({ BuildFileDescriptor(L"File.txt", 0) });
+	EXPECT_TRUE(HasVirtualFiles(m_dataObject.get()));
+}
+
+TEST_F(VirtualFileExtractionTest, Extract)
+{
+	std::string contents = "Virtual file contents";
+
+	SetDescriptors({ BuildFolderDescriptor(L"Folder"),
+		BuildFileDescriptor(L"Folder\\Nested.txt", contents.size()),
+		BuildFileDescriptor(L"File.txt", contents.size()) });
+	SetContents(contents);
+
+	int numProgressUpdates = 0;
+	auto result = ExtractVirtualFiles(m_dataObject.get(), m_destination.wstring(), {},
+		[&numProgressUpdates](const VirtualFileExtractionProgress &progress) {
+			EXPECT_EQ(progress.totalFiles, 2);
+			numProgressUpdates++;
+		});
+
+	EXPECT_EQ(result.filesExtracted, 2);
+	EXPECT_EQ(result.filesFailed, 0);
+	EXPECT_GT(numProgressUpdates, 0);
+	EXPECT_THAT(result.createdItems, UnorderedElementsAre(L"Folder", L"File.txt"));
+
+	EXPECT_EQ(ReadFile(m_destination / L"Folder" / L"Nested.txt"), contents);
+	EXPECT_EQ(ReadFile(m_destination / L"File.txt"), contents);
+}
+
+TEST_F(VirtualFileExtractionTest, UnsafeNames)
+{
+	SetDescriptors({ BuildFileDescriptor(L"..\\Outside.txt", 4),
+		BuildFileDescriptor(L"C:\\Outside.txt", 4), BuildFileDescriptor(L"\\Outside.txt", 4) });
+	SetContents("Test");
+
+	auto result = ExtractVirtualFiles(m_dataObject.get(), m_destination.wstring());
+	EXPECT_EQ(result.filesExtracted, 0);
+	EXPECT_EQ(result.filesFailed, 3);
+	EXPECT_EQ(result.firstError, HRESULT_FROM_WIN32(ERROR_INVALID_NAME));
+	EXPECT_FALSE(std::filesystem::exists(m_destination.parent_path() / L"Outside.txt"));
+}
+
+TEST_F(VirtualFileExtractionTest, ExistingFile)
+{
+	std::ofstream(m_destination / L"File.txt") << "Original";
+
+	SetDescriptors({ BuildFileDescriptor(L"File.txt", 4) });
+	SetContents("Test");
+
+	auto result = ExtractVirtualFiles(m_dataObject.get(), m_destination.wstring());
+	EXPECT_EQ(result.filesExtracted, 0);
+	EXPECT_EQ(result.filesFailed, 1);
+	EXPECT_EQ(result.firstError, HRESULT_FROM_WIN32(ERROR_FILE_EXISTS));
+	EXPECT_EQ(ReadFile(m_destination / L"File.txt"), "Original");
+}
\ No newline at end of file
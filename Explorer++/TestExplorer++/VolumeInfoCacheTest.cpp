@@ -0,0 +1,141 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/VolumeInfoCache.h"
+#include <gtest/gtest.h>
+#include <map>
+
+using namespace std::chrono_literals;
+
+class VolumeInfoCacheTest : public testing::Test
+{
+protected:
+	VolumeInfoCacheTest() : m_cache(2s, CreateQueries(), [this] { return m_now; })
+	{
+	}
+
+	VolumeInfoCache::Queries CreateQueries()
+	{
+		VolumeInfoCache::Queries queries;
+
+		queries.getClusterSize = [this](const std::wstring &root) -> std::optional<DWORD>
+		{
+			m_clusterSizeQueries[root]++;
+
+			if (root == L"E:\\")
+			{
+				return std::nullopt;
+			}
+
+			return 4096;
+		};
+
+		queries.getFileSystemName = [this](const std::wstring &root) -> std::optional<std::wstring>
+		{
+			m_fileSystemNameQueries[root]++;
+			return L"NTFS";
+		};
+
+		queries.getSpaceInfo = [this](const std::wstring &root)
+		{
+			m_spaceInfoQueries[root]++;
+
+			VolumeInfoCache::SpaceInfo spaceInfo;
+			spaceInfo.totalBytes.QuadPart = 1000;
+			spaceInfo.freeBytes.QuadPart = m_freeBytes;
+			return std::optional<VolumeInfoCache::SpaceInfo>(spaceInfo);
+		};
+
+		return queries;
+	}
+
+	VolumeInfoCache::Clock::time_point m_now;
+	ULONGLONG m_freeBytes = 100;
+
+	std::map<std::wstring, int> m_clusterSizeQueries;
+	std::map<std::wstring, int> m_fileSystemNameQueries;
+	std::map<std::wstring, int> m_spaceInfoQueries;
+
+	VolumeInfoCache m_cache;
+};
+
+TEST_F(VolumeInfoCacheTest, ValuesCached)
+{
+	EXPECT_EQ(m_cache.GetClusterSize(L"C:\\"), 4096u);
+	EXPECT_EQ(m_cache.GetClusterSize(L"C:\\"), 4096u);
+	EXPECT_EQ(m_cache.GetFileSystemName(L"C:\\"), L"NTFS");
+	EXPECT_EQ(m_cache.GetFileSystemName(L"C:\\"), L"NTFS");
+
+	EXPECT_EQ(m_clusterSizeQueries[L"C:\\"], 1);
+	EXPECT_EQ(m_fileSystemNameQueries[L"C:\\"], 1);
+
+	// Each value is queried independently.
+	EXPECT_EQ(m_spaceInfoQueries[L"C:\\"], 0);
+}
+
+TEST_F(VolumeInfoCacheTest, ValuesExpire)
+{
+	auto spaceInfo = m_cache.GetSpaceInfo(L"C:\\");
+	ASSERT_TRUE(spaceInfo);
+	EXPECT_EQ(spaceInfo->freeBytes.QuadPart, 100u);
+
+	m_freeBytes = 50;
+	m_now += 1s;
+
+	spaceInfo = m_cache.GetSpaceInfo(L"C:\\");
+	ASSERT_TRUE(spaceInfo);
+	EXPECT_EQ(spaceInfo->freeBytes.QuadPart, 100u);
+
+	m_now += 2s;
+
+	spaceInfo = m_cache.GetSpaceInfo(L"C:\\");
+	ASSERT_TRUE(spaceInfo);
+	EXPECT_EQ(spaceInfo->freeBytes.QuadPart, 50u);
+	EXPECT_EQ(m_spaceInfoQueries[L"C:\\"], 2);
+}
+
+TEST_F(VolumeInfoCacheTest, FailuresCached)
+{
+	EXPECT_EQ(m_cache.GetClusterSize(L"E:\\"), std::nullopt);
+	EXPECT_EQ(m_cache.GetClusterSize(L"E:\\"), std::nullopt);
+	EXPECT_EQ(m_clusterSizeQueries[L"E:\\"], 1);
+
+	m_now += 3s;
+
+	EXPECT_EQ(m_cache.GetClusterSize(L"E:\\"), std::nullopt);
+	EXPECT_EQ(m_clusterSizeQueries[L"E:\\"], 2);
+}
+
+TEST_F(VolumeInfoCacheTest, RootsNormalized)
+{
+	m_cache.GetClusterSize(L"\\\\server\\share");
+	m_cache.GetClusterSize(L"\\\\SERVER\\Share\\");
+
+	// The query should always receive a root that ends with a backslash.
+	EXPECT_EQ(m_clusterSizeQueries[L"\\\\server\\share\\"], 1);
+	EXPECT_EQ(m_clusterSizeQueries.size(), 1u);
+}
+
+TEST_F(VolumeInfoCacheTest, InvalidateVolume)
+{
+	m_cache.GetClusterSize(L"C:\\");
+	m_cache.GetClusterSize(L"D:\\");
+
+	m_cache.InvalidateVolume(L"c:\\");
+
+	m_cache.GetClusterSize(L"C:\\");
+	m_cache.GetClusterSize(L"D:\\");
+
+	EXPECT_EQ(m_clusterSizeQueries[L"C:\\"], 2);
+	EXPECT_EQ(m_clusterSizeQueries[L"D:\\"], 1);
+}
+
+TEST(VolumeInfoCacheRootTest, GetRoot)
+{
+	EXPECT_EQ(VolumeInfoCache::GetRoot(L"C:\\Windows\\System32"), L"C:\\");
+	EXPECT_EQ(VolumeInfoCache::GetRoot(L"\\\\server\\share\\folder\\file.txt"),
+		L"\\\\server\\share\\");
+	EXPECT_EQ(VolumeInfoCache::GetRoot(L"::{20D04FE0-3AEA-1069-A2D8-08002B30309D}"),
+		std::nullopt);
+}
\ No newline at end of file
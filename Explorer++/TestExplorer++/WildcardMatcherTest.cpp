@@ -0,0 +1,134 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/WildcardMatcher.h"
+#include <gtest/gtest.h>
+
+TEST(WildcardMatcherTest, Literal)
+{
+	WildcardMatcher matcher(L"file.txt", true);
+
+	EXPECT_TRUE(matcher.Matches(L"file.txt"));
+	EXPECT_FALSE(matcher.Matches(L"file.tx"));
+	EXPECT_FALSE(matcher.Matches(L"file.txt2"));
+	EXPECT_FALSE(matcher.Matches(L"File.txt"));
+}
+
+TEST(WildcardMatcherTest, Stars)
+{
+	WildcardMatcher matcher(L"a*b*c", true);
+
+	EXPECT_TRUE(matcher.Matches(L"abc"));
+	EXPECT_TRUE(matcher.Matches(L"a123b456c"));
+	EXPECT_TRUE(matcher.Matches(L"abbbc"));
+	EXPECT_TRUE(matcher.Matches(L"acbc"));
+	EXPECT_FALSE(matcher.Matches(L"ab"));
+	EXPECT_FALSE(matcher.Matches(L"acb"));
+	EXPECT_FALSE(matcher.Matches(L"abcd"));
+
+	WildcardMatcher matchAll(L"*", true);
+
+	EXPECT_TRUE(matchAll.Matches(L""));
+	EXPECT_TRUE(matchAll.Matches(L"anything"));
+
+	// The final segment can't overlap with the first.
+	WildcardMatcher overlapping(L"ab*ba", true);
+
+	EXPECT_TRUE(overlapping.Matches(L"abba"));
+	EXPECT_FALSE(overlapping.Matches(L"aba"));
+}
+
+TEST(WildcardMatcherTest, QuestionMarks)
+{
+	WildcardMatcher matcher(L"*a?c*", true);
+
+	EXPECT_TRUE(matcher.Matches(L"abc"));
+	EXPECT_TRUE(matcher.Matches(L"xxaacxx"));
+	EXPECT_TRUE(matcher.Matches(L"aaxc"));
+	EXPECT_FALSE(matcher.Matches(L"ac"));
+	EXPECT_FALSE(matcher.Matches(L"abbc"));
+
+	WildcardMatcher onlyQuestionMarks(L"???", true);
+
+	EXPECT_TRUE(onlyQuestionMarks.Matches(L"abc"));
+	EXPECT_FALSE(onlyQuestionMarks.Matches(L"ab"));
+	EXPECT_FALSE(onlyQuestionMarks.Matches(L"abcd"));
+}
+
+TEST(WildcardMatcherTest, MultiplePatterns)
+{
+	WildcardMatcher matcher(L"*.h: *.cpp", true);
+
+	EXPECT_TRUE(matcher.Matches(L"file.h"));
+	EXPECT_TRUE(matcher.Matches(L"file.cpp"));
+	EXPECT_FALSE(matcher.Matches(L"file.txt"));
+	EXPECT_FALSE(matcher.Matches(L"file.cpp.bak"));
+
+	WildcardMatcher emptyPatterns(L"::", true);
+
+	EXPECT_FALSE(emptyPatterns.Matches(L"file.txt"));
+}
+
+TEST(WildcardMatcherTest, CaseInsensitive)
+{
+	WildcardMatcher matcher(L"*.TXT", false);
+
+	EXPECT_TRUE(matcher.Matches(L"file.txt"));
+	EXPECT_TRUE(matcher.Matches(L"FILE.TXT"));
+	EXPECT_TRUE(matcher.Matches(L"File.Txt"));
+	EXPECT_FALSE(matcher.Matches(L"file.txt2"));
+
+	// Strings that are longer than MAX_PATH are handled separately.
+	std::wstring longName(1000, 'A');
+	longName += L".TXT";
+	EXPECT_TRUE(matcher.Matches(longName));
+}
+
+TEST(WildcardMatcherTest, IsSubsetOf)
+{
+	auto isSubsetOf = [](const wchar_t *pattern, const wchar_t *otherPattern,
+						  bool caseSensitive = true) {
+		return WildcardMatcher(pattern, caseSensitive)
+			.IsSubsetOf(WildcardMatcher(otherPattern, caseSensitive));
+	};
+
+	EXPECT_TRUE(isSubsetOf(L"*abc*", L"*ab*"));
+	EXPECT_TRUE(isSubsetOf(L"*ab*", L"*ab*"));
+	EXPECT_TRUE(isSubsetOf(L"file.txt", L"*.txt"));
+	EXPECT_TRUE(isSubsetOf(L"a?c", L"a??"));
+	EXPECT_TRUE(isSubsetOf(L"*a*b*", L"*"));
+	EXPECT_FALSE(isSubsetOf(L"*ab*", L"*abc*"));
+
+	// A trailing literal is anchored, so appending to it doesn't narrow the pattern.
+	EXPECT_FALSE(isSubsetOf(L"*.cpp", L"*.cp"));
+
+	// A '?' matches exactly one character, whereas a '*' can match any number.
+	EXPECT_FALSE(isSubsetOf(L"a*", L"a?"));
+
+	EXPECT_TRUE(isSubsetOf(L"*.h", L"*.h: *.cpp"));
+	EXPECT_TRUE(isSubsetOf(L"*.h: *.cpp", L"*.h: *.cpp"));
+	EXPECT_FALSE(isSubsetOf(L"*.h: *.cpp", L"*.h"));
+
+	EXPECT_TRUE(isSubsetOf(L"*ABC*", L"*ab*", false));
+
+	WildcardMatcher caseSensitive(L"*abc*", true);
+	WildcardMatcher caseInsensitive(L"*ab*", false);
+	EXPECT_FALSE(caseSensitive.IsSubsetOf(caseInsensitive));
+}
+
+TEST(WildcardMatcherTest, MatchesFolded)
+{
+	WildcardMatcher matcher(L"*.TXT", false);
+
+	std::wstring folded = WildcardMatcher::FoldString(L"File.Txt");
+	EXPECT_EQ(folded, L"file.txt");
+	EXPECT_TRUE(matcher.MatchesFolded(folded));
+
+	// The string is assumed to have already been folded, so it's not lowercased again.
+	EXPECT_FALSE(matcher.MatchesFolded(L"File.Txt"));
+
+	WildcardMatcher caseSensitiveMatcher(L"*.TXT", true);
+	EXPECT_TRUE(caseSensitiveMatcher.MatchesFolded(L"FILE.TXT"));
+	EXPECT_FALSE(caseSensitiveMatcher.MatchesFolded(L"file.txt"));
+}
\ No newline at end of file
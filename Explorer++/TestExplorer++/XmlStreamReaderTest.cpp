@@ -0,0 +1,80 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/XmlStreamReader.h"
+#include <gtest/gtest.h>
+#include <wil/com.h>
+#include <Shlwapi.h>
+#include <string>
+
+namespace
+{
+
+wil::com_ptr_nothrow<IStream> CreateStream(const std::string &xml)
+{
+	wil::com_ptr_nothrow<IStream> stream;
+	stream.attach(SHCreateMemStream(
+		reinterpret_cast<const BYTE *>(xml.data()), static_cast<UINT>(xml.size())));
+	return stream;
+}
+
+}
+
+TEST(XmlStreamReaderTest, Elements)
+{
+	auto stream = CreateStream("<?xml version='1.0'?>\n"
+							   "<Root>\n"
+							   "\t<Section name=\"first\" Value=\"1\">\n"
+							   "\t\t<Item name=\"nested\"/>\n"
+							   "\t</Section>\n"
+							   "\t<Section name=\"second\"/>\n"
+							   "</Root>");
+	ASSERT_TRUE(stream);
+
+	auto reader = XmlStreamReader::Create(stream.get());
+	ASSERT_TRUE(reader);
+
+	XmlStreamReader::Element element;
+
+	ASSERT_TRUE(reader->ReadNextElement(element));
+	EXPECT_EQ(element.name, L"Root");
+	EXPECT_EQ(element.depth, 0U);
+	EXPECT_TRUE(element.attributes.empty());
+
+	ASSERT_TRUE(reader->ReadNextElement(element));
+	EXPECT_EQ(element.name, L"Section");
+	EXPECT_EQ(element.depth, 1U);
+	ASSERT_NE(element.GetAttribute(L"name"), nullptr);
+	EXPECT_EQ(*element.GetAttribute(L"name"), L"first");
+	ASSERT_NE(element.GetAttribute(L"Value"), nullptr);
+	EXPECT_EQ(*element.GetAttribute(L"Value"), L"1");
+	EXPECT_EQ(element.GetAttribute(L"Missing"), nullptr);
+
+	ASSERT_TRUE(reader->ReadNextElement(element));
+	EXPECT_EQ(element.name, L"Item");
+	EXPECT_EQ(element.depth, 2U);
+
+	ASSERT_TRUE(reader->ReadNextElement(element));
+	EXPECT_EQ(element.name, L"Section");
+	EXPECT_EQ(element.depth, 1U);
+	ASSERT_NE(element.GetAttribute(L"name"), nullptr);
+	EXPECT_EQ(*element.GetAttribute(L"name"), L"second");
+	EXPECT_EQ(element.GetAttribute(L"Value"), nullptr);
+
+	EXPECT_FALSE(reader->ReadNextElement(element));
+}
+
+TEST(XmlStreamReaderTest, MalformedDocument)
+{
+	auto stream = CreateStream("<Root><Section></Root>");
+	ASSERT_TRUE(stream);
+
+	auto reader = XmlStreamReader::Create(stream.get());
+	ASSERT_TRUE(reader);
+
+	XmlStreamReader::Element element;
+	EXPECT_TRUE(reader->ReadNextElement(element));
+	EXPECT_TRUE(reader->ReadNextElement(element));
+	EXPECT_FALSE(reader->ReadNextElement(element));
+}
\ No newline at end of file
@@ -0,0 +1,326 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/ZipArchive.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+
+using namespace testing;
+
+namespace
+{
+
+struct TestEntry
+{
+	std::string path;
+	std::string contents;
+	WORD flags = 0;
+	DWORD externalAttributes = 0;
+	std::string extra;
+
+	// Overrides the uncompressed size stored in the header (e.g. to indicate that the size is
+	// stored in a ZIP64 extra field instead).
+	std::optional<DWORD> headerSize;
+};
+
+void AppendWord(std::string &output, WORD value)
+{
+	output += static_cast<char>(value & 0xff);
+	output += static_cast<char>((value >> 8) & 0xff);
+}
+
+void AppendDword(std::string &output, DWORD value)
+{
+	AppendWord(output, static_cast<WORD>(value & 0xffff));
+	AppendWord(output, static_cast<WORD>(value >> 16));
+}
+
+void AppendQword(std::string &output, ULONGLONG value)
+{
+	AppendDword(output, static_cast<DWORD>(value & 0xffffffff));
+	AppendDword(output, static_cast<DWORD>(value >> 32));
+}
+
+// Builds an archive in which each entry is stored without compression. The CRCs aren't filled in,
+// since they're not read.
+std::string BuildArchive(const std::vector<TestEntry> &entries, const std::string &comment = "")
+{
+	std::string archive;
+	std::string directory;
+
+	for (const auto &entry : entries)
+	{
+		auto localHeaderOffset = static_cast<DWORD>(archive.size());
+		auto size = static_cast<DWORD>(entry.contents.size());
+
+		AppendDword(archive, 0x04034b50);
+		AppendWord(archive, 20);
+		AppendWord(archive, entry.flags);
+		AppendWord(archive, 0);
+		AppendDword(archive, 0);
+		AppendDword(archive, 0);
+		AppendDword(archive, size);
+		AppendDword(archive, size);
+		AppendWord(archive, static_cast<WORD>(entry.path.size()));
+		AppendWord(archive, 0);
+		archive += entry.path;
+		archive += entry.contents;
+
+		// Created on MS-DOS, so that the external attributes are DOS attributes. The date is
+		// 2020-06-15 12:30:00.
+		AppendDword(directory, 0x02014b50);
+		AppendWord(directory, 20);
+		AppendWord(directory, 20);
+		AppendWord(directory, entry.flags);
+		AppendWord(directory, 0);
+		AppendWord(directory, (12 << 11) | (30 << 5));
+		AppendWord(directory, ((2020 - 1980) << 9) | (6 << 5) | 15);
+		AppendDword(directory, 0);
+		AppendDword(directory, size);
+		AppendDword(directory, entry.headerSize.value_or(size));
+		AppendWord(directory, static_cast<WORD>(entry.path.size()));
+		AppendWord(directory, static_cast<WORD>(entry.extra.size()));
+		AppendWord(directory, 0);
+		AppendWord(directory, 0);
+		AppendWord(directory, 0);
+		AppendDword(directory, entry.externalAttributes);
+		AppendDword(directory, localHeaderOffset);
+		directory += entry.path;
+		directory += entry.extra;
+	}
+
+	auto directoryOffset = static_cast<DWORD>(archive.size());
+	archive += directory;
+
+	AppendDword(archive, 0x06054b50);
+	AppendWord(archive, 0);
+	AppendWord(archive, 0);
+	AppendWord(archive, static_cast<WORD>(entries.size()));
+	AppendWord(archive, static_cast<WORD>(entries.size()));
+	AppendDword(archive, static_cast<DWORD>(directory.size()));
+	AppendDword(archive, directoryOffset);
+	AppendWord(archive, static_cast<WORD>(comment.size()));
+	archive += comment;
+
+	return archive;
+}
+
+const ZipArchiveEntry *FindEntry(
+	const std::vector<ZipArchiveEntry> &entries, const std::wstring &name)
+{
+	auto itr = std::find_if(entries.begin(), entries.end(),
+		[&name](const ZipArchiveEntry &entry) { return entry.name == name; });
+
+	if (itr == entries.end())
+	{
+		return nullptr;
+	}
+
+	return &*itr;
+}
+
+}
+
+class ZipArchiveTest : public Test
+{
+protected:
+	void SetUp() override
+	{
+		m_root = std::filesystem::temp_directory_path()
+			/ (L"ZipArchiveTest" + std::to_wstring(GetCurrentProcessId()));
+		std::filesystem::create_directories(m_root);
+	}
+
+	void TearDown() override
+	{
+		std::filesystem::remove_all(m_root);
+	}
+
+	std::unique_ptr<ZipArchive> OpenArchive(const std::string &contents)
+	{
+		auto path = m_root / L"Archive.zip";
+
+		{
+			std::ofstream stream(path, std::ios::binary);
+			stream << contents;
+		}
+
+		std::unique_ptr<ZipArchive> archive;
+		HRESULT hr = ZipArchive::Open(path.wstring(), archive);
+		EXPECT_HRESULT_SUCCEEDED(hr);
+		return archive;
+	}
+
+	std::filesystem::path m_root;
+};
+
+TEST_F(ZipArchiveTest, Folders)
+{
+	auto archive = OpenArchive(BuildArchive({ { "File.txt", "contents" },
+		{ "Folder/", "", 0, FILE_ATTRIBUTE_DIRECTORY }, { "Folder/Nested.txt", "abc" },
+		{ "Folder/Empty/", "" }, { "Implied/Deeper/File.txt", "12345" } }));
+	ASSERT_NE(archive, nullptr);
+
+	const auto *root = archive->GetFolderContents(L"");
+	ASSERT_NE(root, nullptr);
+	ASSERT_EQ(root->size(), 3U);
+
+	const auto *file = FindEntry(*root, L"File.txt");
+	ASSERT_NE(file, nullptr);
+	EXPECT_EQ(file->size, 8U);
+	EXPECT_TRUE(WI_IsFlagClear(file->attributes, FILE_ATTRIBUTE_DIRECTORY));
+
+	SYSTEMTIME lastWriteTime;
+	FILETIME localLastWriteTime;
+	FileTimeToLocalFileTime(&file->lastWriteTime, &localLastWriteTime);
+	FileTimeToSystemTime(&localLastWriteTime, &lastWriteTime);
+	EXPECT_EQ(lastWriteTime.wYear, 2020);
+	EXPECT_EQ(lastWriteTime.wMonth, 6);
+	EXPECT_EQ(lastWriteTime.wDay, 15);
+	EXPECT_EQ(lastWriteTime.wHour, 12);
+	EXPECT_EQ(lastWriteTime.wMinute, 30);
+
+	for (const auto *name : { L"Folder", L"Implied" })
+	{
+		const auto *folder = FindEntry(*root, name);
+		ASSERT_NE(folder, nullptr);
+		EXPECT_TRUE(WI_IsFlagSet(folder->attributes, FILE_ATTRIBUTE_DIRECTORY));
+		EXPECT_EQ(folder->size, 0U);
+	}
+
+	const auto *folder = archive->GetFolderContents(L"Folder");
+	ASSERT_NE(folder, nullptr);
+	EXPECT_EQ(folder->size(), 2U);
+	EXPECT_NE(FindEntry(*folder, L"Nested.txt"), nullptr);
+	EXPECT_NE(FindEntry(*folder, L"Empty"), nullptr);
+
+	const auto *empty = archive->GetFolderContents(L"Folder\\Empty");
+	ASSERT_NE(empty, nullptr);
+	EXPECT_TRUE(empty->empty());
+
+	// Either separator can be used.
+	const auto *deeper = archive->GetFolderContents(L"Implied/Deeper/");
+	ASSERT_NE(deeper, nullptr);
+	ASSERT_EQ(deeper->size(), 1U);
+	EXPECT_EQ((*deeper)[0].name, L"File.txt");
+	EXPECT_EQ((*deeper)[0].size, 5U);
+
+	EXPECT_EQ(archive->GetFolderContents(L"Missing"), nullptr);
+	EXPECT_EQ(archive->GetFolderContents(L"File.txt"), nullptr);
+	EXPECT_EQ(archive->GetNumEntries(), 7U);
+}
+
+TEST_F(ZipArchiveTest, Names)
+{
+	// U+00E9 in UTF-8 and in code page 437, respectively.
+	auto archive = OpenArchive(BuildArchive(
+		{ { "Utf8\xc3\xa9.txt", "", 1 << 11 }, { "Cp437\x82.txt", "" } }, "A comment"));
+	ASSERT_NE(archive, nullptr);
+
+	const auto *root = archive->GetFolderContents(L"");
+	ASSERT_NE(root, nullptr);
+	EXPECT_NE(FindEntry(*root, L"Utf8\u00e9.txt"), nullptr);
+	EXPECT_NE(FindEntry(*root, L"Cp437\u00e9.txt"), nullptr);
+}
+
+TEST_F(ZipArchiveTest, UnsafePaths)
+{
+	auto archive = OpenArchive(
+		BuildArchive({ { "../Outside.txt", "" }, { "Folder/../../Outside.txt", "" },
+			{ "./Inside.txt", "" } }));
+	ASSERT_NE(archive, nullptr);
+
+	const auto *root = archive->GetFolderContents(L"");
+	ASSERT_NE(root, nullptr);
+	ASSERT_EQ(root->size(), 1U);
+	EXPECT_EQ((*root)[0].name, L"Inside.txt");
+}
+
+TEST_F(ZipArchiveTest, ExtraFields)
+{
+	std::string zip64Extra;
+	AppendWord(zip64Extra, 0x0001);
+	AppendWord(zip64Extra, 8);
+	AppendQword(zip64Extra, 5ULL * 1024 * 1024 * 1024);
+
+	const ULONGLONG lastWriteTime = 132000000000000000ULL;
+	const ULONGLONG creationTime = 131000000000000000ULL;
+
+	std::string ntfsExtra;
+	AppendWord(ntfsExtra, 0x000a);
+	AppendWord(ntfsExtra, 32);
+	AppendDword(ntfsExtra, 0);
+	AppendWord(ntfsExtra, 0x0001);
+	AppendWord(ntfsExtra, 24);
+	AppendQword(ntfsExtra, lastWriteTime);
+	AppendQword(ntfsExtra, lastWriteTime);
+	AppendQword(ntfsExtra, creationTime);
+
+	auto archive = OpenArchive(BuildArchive({ { "Large.bin", "", 0, 0, zip64Extra, 0xffffffff },
+		{ "Times.txt", "", 0, FILE_ATTRIBUTE_HIDDEN, ntfsExtra } }));
+	ASSERT_NE(archive, nullptr);
+
+	const auto *root = archive->GetFolderContents(L"");
+	ASSERT_NE(root, nullptr);
+
+	const auto *large = FindEntry(*root, L"Large.bin");
+	ASSERT_NE(large, nullptr);
+	EXPECT_EQ(large->size, 5ULL * 1024 * 1024 * 1024);
+
+	const auto *times = FindEntry(*root, L"Times.txt");
+	ASSERT_NE(times, nullptr);
+	EXPECT_TRUE(WI_IsFlagSet(times->attributes, FILE_ATTRIBUTE_HIDDEN));
+
+	ULARGE_INTEGER value;
+	value.LowPart = times->lastWriteTime.dwLowDateTime;
+	value.HighPart = times->lastWriteTime.dwHighDateTime;
+	EXPECT_EQ(value.QuadPart, lastWriteTime);
+
+	value.LowPart = times->creationTime.dwLowDateTime;
+	value.HighPart = times->creationTime.dwHighDateTime;
+	EXPECT_EQ(value.QuadPart, creationTime);
+}
+
+TEST_F(ZipArchiveTest, Invalid)
+{
+	auto path = m_root / L"Invalid.zip";
+
+	{
+		std::ofstream stream(path, std::ios::binary);
+		stream << "This isn't an archive";
+	}
+
+	std::unique_ptr<ZipArchive> archive;
+	HRESULT hr = ZipArchive::Open(path.wstring(), archive);
+	EXPECT_HRESULT_FAILED(hr);
+}
+
+TEST_F(ZipArchiveTest, GetZipArchiveLocation)
+{
+	auto archivePath = m_root / L"Archive.zip";
+
+	{
+		std::ofstream stream(archivePath, std::ios::binary);
+		stream << BuildArchive({});
+	}
+
+	auto location = GetZipArchiveLocation(archivePath.wstring());
+	ASSERT_TRUE(location.has_value());
+	EXPECT_EQ(location->archivePath, archivePath.wstring());
+	EXPECT_EQ(location->folderPath, L"");
+
+	location = GetZipArchiveLocation((archivePath / L"Folder" / L"Nested").wstring());
+	ASSERT_TRUE(location.has_value());
+	EXPECT_EQ(location->archivePath, archivePath.wstring());
+	EXPECT_EQ(location->folderPath, L"Folder\\Nested");
+
+	// A folder with the same extension isn't an archive.
+	auto folderPath = m_root / L"Folder.zip";
+	std::filesystem::create_directories(folderPath);
+	EXPECT_FALSE(GetZipArchiveLocation((folderPath / L"Child").wstring()).has_value());
+
+	EXPECT_FALSE(GetZipArchiveLocation(m_root.wstring()).has_value());
+}
\ No newline at end of file